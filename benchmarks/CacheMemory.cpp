@@ -0,0 +1,67 @@
+/**
+ * @file
+ * @brief Benchmarks for openshot::CacheMemory
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "openshot_catch.h"
+
+#include "CacheMemory.h"
+#include "Frame.h"
+
+using namespace openshot;
+
+TEST_CASE( "CacheMemory", "[libopenshot][benchmark][cachememory]" )
+{
+	// Frames with a small image and a frame of audio
+	std::vector<std::shared_ptr<Frame>> frames;
+	for (int64_t number = 1; number <= 2000; number++)
+		frames.push_back(std::make_shared<Frame>(number, 320, 180, "#000000", 1470, 2));
+
+	BENCHMARK_ADVANCED("Add (2000 frames)")(Benchmark::Chronometer meter) {
+		std::vector<CacheMemory> caches(meter.runs());
+		meter.measure([&frames, &caches](int run) {
+			for (const auto& frame : frames)
+				caches[run].Add(frame);
+			return caches[run].Count();
+		});
+	};
+
+	BENCHMARK_ADVANCED("Add and evict (2000 frames, 500 cached)")(Benchmark::Chronometer meter) {
+		std::vector<CacheMemory> caches(meter.runs());
+		for (CacheMemory& cache : caches)
+			cache.SetMaxBytes(frames[0]->GetBytes() * 500);
+		meter.measure([&frames, &caches](int run) {
+			for (const auto& frame : frames)
+				caches[run].Add(frame);
+			return caches[run].Count();
+		});
+	};
+
+	// The same (pseudo-random) frame numbers for every run
+	CacheMemory cache;
+	for (const auto& frame : frames)
+		cache.Add(frame);
+	std::mt19937 generator(1);
+	std::uniform_int_distribution<int64_t> distribution(1, 2000);
+	std::vector<int64_t> numbers(2000);
+	for (int64_t& number : numbers)
+		number = distribution(generator);
+
+	BENCHMARK("Get (2000 random frames)") {
+		int64_t checksum = 0;
+		for (int64_t number : numbers)
+			checksum += cache.GetFrame(number)->number;
+		return checksum;
+	};
+}
@@ -0,0 +1,57 @@
+/**
+ * @file
+ * @brief Benchmarks for each effect (in src/effects and src/audio_effects)
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "openshot_catch.h"
+
+#include "EffectBase.h"
+#include "EffectInfo.h"
+#include "FFmpegReader.h"
+#include "Frame.h"
+
+using namespace openshot;
+
+TEST_CASE( "Effects GetFrame", "[libopenshot][benchmark][effects]" )
+{
+	// A 720p frame (with a frame of stereo audio)
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	FFmpegReader r(path.str());
+	r.Open();
+	std::shared_ptr<Frame> source = r.GetFrame(100);
+	r.Close();
+
+	Json::Value effects = EffectInfo::JsonValue();
+	for (const Json::Value& info : effects) {
+		const std::string class_name = info["class_name"].asString();
+
+		// The OpenCV effects need their (pre-processed) tracking data
+		if (class_name == "Stabilizer" || class_name == "Tracker" || class_name == "ObjectDetection")
+			continue;
+		std::unique_ptr<EffectBase> effect(EffectInfo().CreateEffect(class_name));
+		REQUIRE(effect);
+
+		BENCHMARK_ADVANCED(class_name)(Benchmark::Chronometer meter) {
+			// Effects change the frame, so each run gets its own copy
+			std::vector<std::shared_ptr<Frame>> frames;
+			for (int run = 0; run < meter.runs(); run++)
+				frames.push_back(std::make_shared<Frame>(*source));
+			meter.measure([&effect, &frames](int run) {
+				return effect->GetFrame(frames[run], 100);
+			});
+		};
+	}
+}
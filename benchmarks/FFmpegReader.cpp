@@ -0,0 +1,72 @@
+/**
+ * @file
+ * @brief Benchmarks for openshot::FFmpegReader
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <random>
+#include <sstream>
+
+#include "openshot_catch.h"
+
+#include "FFmpegReader.h"
+#include "Frame.h"
+#include "Settings.h"
+
+using namespace openshot;
+
+TEST_CASE( "FFmpegReader GetFrame", "[libopenshot][benchmark][ffmpegreader]" )
+{
+	// Decode every frame (don't share the decoded frames between readers of the same file)
+	Settings::Instance()->ENABLE_SOURCE_FRAME_CACHE = false;
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	FFmpegReader r(path.str());
+	r.Open();
+
+	BENCHMARK_ADVANCED("Sequential (48 frames)")(Benchmark::Chronometer meter) {
+		meter.measure([&r]() {
+			r.GetCache()->Clear();
+			int64_t checksum = 0;
+			for (int64_t number = 1; number <= 48; number++)
+				checksum += r.GetFrame(number)->number;
+			return checksum;
+		});
+	};
+
+	// The same (pseudo-random) frame numbers for every run
+	std::mt19937 generator(1);
+	std::uniform_int_distribution<int64_t> distribution(1, r.info.video_length);
+	std::vector<int64_t> numbers(16);
+	for (int64_t& number : numbers)
+		number = distribution(generator);
+
+	BENCHMARK_ADVANCED("Random (16 frames)")(Benchmark::Chronometer meter) {
+		meter.measure([&r, &numbers]() {
+			r.GetCache()->Clear();
+			int64_t checksum = 0;
+			for (int64_t number : numbers)
+				checksum += r.GetFrame(number)->number;
+			return checksum;
+		});
+	};
+
+	BENCHMARK_ADVANCED("Reverse (48 frames)")(Benchmark::Chronometer meter) {
+		meter.measure([&r]() {
+			r.GetCache()->Clear();
+			int64_t checksum = 0;
+			for (int64_t number = 348; number > 300; number--)
+				checksum += r.GetFrame(number)->number;
+			return checksum;
+		});
+	};
+
+	r.Close();
+	Settings::Instance()->ENABLE_SOURCE_FRAME_CACHE = true;
+}
@@ -0,0 +1,57 @@
+/**
+ * @file
+ * @brief Benchmarks for openshot::FFmpegWriter
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include "openshot_catch.h"
+
+#include "FFmpegReader.h"
+#include "FFmpegWriter.h"
+#include "Frame.h"
+
+using namespace openshot;
+
+TEST_CASE( "FFmpegWriter WriteFrame", "[libopenshot][benchmark][ffmpegwriter]" )
+{
+	// Decode the frames first (so only the encoding is measured)
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	FFmpegReader r(path.str());
+	r.Open();
+	std::vector<std::shared_ptr<Frame>> frames;
+	for (int64_t number = 1; number <= 24; number++)
+		frames.push_back(std::make_shared<Frame>(*r.GetFrame(number)));
+	r.Close();
+
+	BENCHMARK("MPEG-4 / AAC 720p (24 frames)") {
+		FFmpegWriter w("benchmark-output.mp4");
+		w.SetAudioOptions(true, "aac", 44100, 2, LAYOUT_STEREO, 128000);
+		w.SetVideoOptions(true, "mpeg4", Fraction(24, 1), 1280, 720, Fraction(1, 1), false, false, 3000000);
+		w.Open();
+		for (const auto& frame : frames)
+			w.WriteFrame(frame);
+		w.Close();
+		return frames.size();
+	};
+
+	BENCHMARK("MJPEG 720p, no audio (24 frames)") {
+		FFmpegWriter w("benchmark-output.avi");
+		w.SetVideoOptions(true, "mjpeg", Fraction(24, 1), 1280, 720, Fraction(1, 1), false, false, 4000000);
+		w.Open();
+		for (const auto& frame : frames)
+			w.WriteFrame(frame);
+		w.Close();
+		return frames.size();
+	};
+}
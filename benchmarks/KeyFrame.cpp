@@ -0,0 +1,67 @@
+/**
+ * @file
+ * @brief Benchmarks for openshot::Keyframe
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <random>
+#include <vector>
+
+#include "openshot_catch.h"
+
+#include "KeyFrame.h"
+
+using namespace openshot;
+
+TEST_CASE( "Keyframe GetValue", "[libopenshot][benchmark][keyframe]" )
+{
+	// A Bezier curve with 20 points (over 10000 frames)
+	Keyframe curve;
+	for (int index = 0; index < 20; index++)
+		curve.AddPoint(1 + index * 500, (index % 2) ? 1.0 : -1.0, BEZIER);
+
+	// A curve which is too long to bake (so its values are always interpolated)
+	Keyframe long_curve;
+	long_curve.AddPoint(1, 0.0, BEZIER);
+	long_curve.AddPoint(1000000, 1.0, BEZIER);
+
+	// The same (pseudo-random) frame numbers for every run
+	std::mt19937 generator(1);
+	std::uniform_int_distribution<int64_t> distribution(1, 10000);
+	std::vector<int64_t> numbers(1000);
+	for (int64_t& number : numbers)
+		number = distribution(generator);
+
+	BENCHMARK("Bezier GetValue (1000 random frames)") {
+		double sum = 0.0;
+		for (int64_t number : numbers)
+			sum += curve.GetValue(number);
+		return sum;
+	};
+
+	BENCHMARK("Bezier GetValue (1000 sequential frames)") {
+		double sum = 0.0;
+		for (int64_t number = 1; number <= 1000; number++)
+			sum += curve.GetValue(number);
+		return sum;
+	};
+
+	std::vector<double> values(1000);
+	BENCHMARK("Bezier GetValues (1000 sequential frames)") {
+		curve.GetValues(1, 1000, values.data());
+		return values.back();
+	};
+
+	BENCHMARK("Long Bezier GetValue (1000 random frames)") {
+		double sum = 0.0;
+		for (int64_t number : numbers)
+			sum += long_curve.GetValue(number * 100);
+		return sum;
+	};
+}
@@ -0,0 +1,58 @@
+/**
+ * @file
+ * @brief Benchmarks for openshot::Timeline
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include "openshot_catch.h"
+
+#include "Clip.h"
+#include "Frame.h"
+#include "Timeline.h"
+
+using namespace openshot;
+
+TEST_CASE( "Timeline GetFrame", "[libopenshot][benchmark][timeline]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+
+	for (int layers : {1, 4, 8}) {
+		// Stack the layers (each one a little smaller, so all of them are visible)
+		Timeline t(1280, 720, Fraction(24, 1), 44100, 2, LAYOUT_STEREO);
+		std::vector<std::unique_ptr<Clip>> clips;
+		for (int layer = 0; layer < layers; layer++) {
+			clips.emplace_back(new Clip(path.str()));
+			clips.back()->Layer(layer);
+			clips.back()->scale_x = Keyframe(1.0 - 0.1 * layer);
+			clips.back()->scale_y = Keyframe(1.0 - 0.1 * layer);
+			clips.back()->alpha = Keyframe(0.8);
+			t.AddClip(clips.back().get());
+		}
+		t.Open();
+
+		std::stringstream name;
+		name << layers << " layer(s) (24 frames)";
+		BENCHMARK_ADVANCED(name.str())(Benchmark::Chronometer meter) {
+			meter.measure([&t]() {
+				t.ClearAllCache();
+				int64_t checksum = 0;
+				for (int64_t number = 1; number <= 24; number++)
+					checksum += t.GetFrame(number)->number;
+				return checksum;
+			});
+		};
+
+		t.Close();
+	}
+}
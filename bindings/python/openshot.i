@@ -9,6 +9,11 @@
 //
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
+/* Thread support: every wrapped call releases the GIL while it runs (and takes it back before returning,
+   or raising an exception), so long-running calls (i.e. Timeline::GetFrame, Clip::GetFrame,
+   FFmpegWriter::WriteFrame, AudioWaveformer::ExtractSamples, ClipProcessingJobs::processClip) don't block
+   other Python threads, and Python threads can render frames in parallel. Wrapped code which creates
+   Python objects must keep the GIL (mark it with %nothread). */
 %module("threads"=1) openshot
 
 /* Suppress warnings about ignored operator= */
@@ -40,12 +45,15 @@
 #endif
 %shared_ptr(juce::AudioBuffer<float>)
 %shared_ptr(openshot::Frame)
+%shared_ptr(openshot::FrameIterator)
+%shared_ptr(openshot::FrameRequest)
 
 /* Instantiate the required template specializations */
 %template() std::map<std::string, int>;
 %template() std::pair<int, int>;
 %template() std::vector<int>;
 %template() std::vector<float>;
+%template() std::vector<double>;
 %template() std::pair<double, double>;
 %template() std::pair<float, float>;
 %template() std::pair<std::string, std::string>;
@@ -61,6 +69,9 @@
 #include "CacheBase.h"
 #include "CacheDisk.h"
 #include "CacheMemory.h"
+#include "CacheMemorySharded.h"
+#include "CacheTiered.h"
+#include "Calibration.h"
 #include "ChannelLayouts.h"
 #include "ChunkReader.h"
 #include "ChunkWriter.h"
@@ -78,17 +89,29 @@
 #include "FFmpegWriter.h"
 #include "Fraction.h"
 #include "Frame.h"
+#include "FrameIterator.h"
+#include "FrameRequest.h"
 #include "FrameMapper.h"
+#include "ImageSequenceReader.h"
 #include "PlayerBase.h"
 #include "Point.h"
 #include "Profiles.h"
+#include "ProxyGenerator.h"
 #include "QtHtmlReader.h"
 #include "QtImageReader.h"
 #include "QtPlayer.h"
 #include "QtTextReader.h"
 #include "KeyFrame.h"
+#include "LiveReader.h"
+#include "MultiWriter.h"
 #include "RendererBase.h"
+#include "RenderTrace.h"
+#include "RenderFarm.h"
+#include "SegmentedWriter.h"
+#include "SharedMemoryReader.h"
+#include "SharedMemoryWriter.h"
 #include "Settings.h"
+#include "ThumbnailExtractor.h"
 #include "TimelineBase.h"
 #include "Timeline.h"
 #include "ZmqLogger.h"
@@ -249,6 +272,136 @@
     %}
 }
 
+/* Read-only buffers over the pixels and audio samples of a Frame (without copying them) */
+%{
+    #include <QImage>
+
+    /* A Python object which shares the image (or audio buffer) of a Frame, and exposes it
+       with the buffer protocol (i.e. to memoryview or numpy.asarray) */
+    struct openshot_FrameBuffer {
+        PyObject_HEAD
+        std::shared_ptr<void> *owner;
+        const void *data;
+        int ndim;
+        Py_ssize_t itemsize;
+        const char *format;
+        Py_ssize_t shape[3];
+        Py_ssize_t strides[3];
+    };
+
+    static int openshot_FrameBuffer_getbuffer(PyObject *obj, Py_buffer *view, int flags) {
+        openshot_FrameBuffer *self = (openshot_FrameBuffer *) obj;
+        if (flags & PyBUF_WRITABLE) {
+            PyErr_SetString(PyExc_BufferError, "Frame buffers are read-only (copy them to modify)");
+            view->obj = NULL;
+            return -1;
+        }
+        view->buf = (void *) self->data;
+        view->obj = obj;
+        Py_INCREF(obj);
+        view->len = self->itemsize;
+        for (int i = 0; i < self->ndim; i++)
+            view->len *= self->shape[i];
+        view->readonly = 1;
+        view->itemsize = self->itemsize;
+        view->format = (flags & PyBUF_FORMAT) ? (char *) self->format : NULL;
+        view->ndim = self->ndim;
+        view->shape = (flags & PyBUF_ND) ? self->shape : NULL;
+        view->strides = ((flags & PyBUF_STRIDES) == PyBUF_STRIDES) ? self->strides : NULL;
+        view->suboffsets = NULL;
+        view->internal = NULL;
+        return 0;
+    }
+
+    static void openshot_FrameBuffer_dealloc(PyObject *obj) {
+        delete ((openshot_FrameBuffer *) obj)->owner;
+        PyTypeObject *type = Py_TYPE(obj);
+        type->tp_free(obj);
+        Py_DECREF(type);
+    }
+
+    /* Create a buffer object (which keeps the owner of the data alive) */
+    static PyObject *openshot_frame_buffer(std::shared_ptr<void> owner, const void *data, int ndim,
+        const Py_ssize_t *shape, const Py_ssize_t *strides, Py_ssize_t itemsize, const char *format) {
+        static PyObject *buffer_type = NULL;
+        if (!buffer_type) {
+            static PyType_Slot slots[] = {
+                {Py_bf_getbuffer, (void *) openshot_FrameBuffer_getbuffer},
+                {Py_tp_dealloc, (void *) openshot_FrameBuffer_dealloc},
+                {0, NULL}
+            };
+            static PyType_Spec spec = {
+                "openshot.FrameBuffer", sizeof(openshot_FrameBuffer), 0, Py_TPFLAGS_DEFAULT, slots
+            };
+            buffer_type = PyType_FromSpec(&spec);
+            if (!buffer_type)
+                return NULL;
+        }
+
+        openshot_FrameBuffer *self = PyObject_New(openshot_FrameBuffer, (PyTypeObject *) buffer_type);
+        if (!self)
+            return NULL;
+        self->owner = new std::shared_ptr<void>(owner);
+        self->data = data;
+        self->ndim = ndim;
+        self->itemsize = itemsize;
+        self->format = format;
+        for (int i = 0; i < ndim; i++) {
+            self->shape[i] = shape[i];
+            self->strides[i] = strides[i];
+        }
+        return (PyObject *) self;
+    }
+%}
+
+/* These create Python objects, so they hold the GIL (every other call releases it, i.e. GetFrame) */
+%nothread _FrameImageBuffer;
+%nothread _FrameAudioBuffer;
+%inline %{
+    /* The pixels of a Frame (height x width x RGBA bytes, premultiplied) */
+    PyObject *_FrameImageBuffer(std::shared_ptr<openshot::Frame> frame) {
+        std::shared_ptr<QImage> image = frame->GetImage();
+        const Py_ssize_t shape[3] = {image->height(), image->width(), 4};
+        const Py_ssize_t strides[3] = {image->bytesPerLine(), 4, 1};
+        return openshot_frame_buffer(image, image->constBits(), 3, shape, strides, 1, "B");
+    }
+
+    /* The samples of one audio channel of a Frame (32-bit floats) */
+    PyObject *_FrameAudioBuffer(std::shared_ptr<openshot::Frame> frame, int channel) {
+        if (!frame->audio || channel < 0 || channel >= frame->GetAudioChannelsCount()) {
+            PyErr_SetString(PyExc_IndexError, "Invalid audio channel");
+            return NULL;
+        }
+        const Py_ssize_t shape[1] = {frame->GetAudioSamplesCount()};
+        const Py_ssize_t strides[1] = {sizeof(float)};
+        return openshot_frame_buffer(frame->audio, frame->audio->getReadPointer(channel), 1, shape, strides, sizeof(float), "f");
+    }
+%}
+
+%extend openshot::Frame {
+    /* Views of the frame data, which share it (i.e. numpy.asarray(frame.GetImageBuffer())) */
+    %pythoncode %{
+        def GetImageBuffer(self):
+            """Get a read-only memoryview of the pixels (height x width x 4 RGBA bytes), without copying them"""
+            return memoryview(_FrameImageBuffer(self))
+        def GetAudioBuffer(self, channel):
+            """Get a read-only memoryview of the samples of an audio channel (floats), without copying them"""
+            return memoryview(_FrameAudioBuffer(self, channel))
+    %}
+}
+
+/* Make openshot.FrameIterator a Python iterator (i.e. for f in reader.Frames(1, 300)) */
+%extend openshot::FrameIterator {
+    %pythoncode %{
+        def __iter__(self):
+            return self
+        def __next__(self):
+            if not self.HasNext():
+                raise StopIteration
+            return self.Next()
+    %}
+}
+
 %extend openshot::OpenShotVersion {
         // Give the struct a string representation
     const std::string __str__() {
@@ -270,6 +423,9 @@
 %include "CacheBase.h"
 %include "CacheDisk.h"
 %include "CacheMemory.h"
+%include "CacheMemorySharded.h"
+%include "CacheTiered.h"
+%include "Calibration.h"
 %include "ChannelLayouts.h"
 %include "ChunkReader.h"
 %include "ChunkWriter.h"
@@ -287,17 +443,29 @@
 %include "FFmpegWriter.h"
 %include "Fraction.h"
 %include "Frame.h"
+%include "FrameIterator.h"
+%include "FrameRequest.h"
 %include "FrameMapper.h"
+%include "ImageSequenceReader.h"
 %include "PlayerBase.h"
 %include "Point.h"
 %include "Profiles.h"
+%include "ProxyGenerator.h"
 %include "QtHtmlReader.h"
 %include "QtImageReader.h"
 %include "QtPlayer.h"
 %include "QtTextReader.h"
 %include "KeyFrame.h"
+%include "LiveReader.h"
+%include "MultiWriter.h"
 %include "RendererBase.h"
+%include "RenderTrace.h"
+%include "RenderFarm.h"
+%include "SegmentedWriter.h"
+%include "SharedMemoryReader.h"
+%include "SharedMemoryWriter.h"
 %include "Settings.h"
+%include "ThumbnailExtractor.h"
 %include "TimelineBase.h"
 %include "Timeline.h"
 %include "ZmqLogger.h"
@@ -324,6 +492,7 @@
 %include "effects/Crop.h"
 %include "effects/Deinterlace.h"
 %include "effects/Hue.h"
+%include "effects/LUT3D.h"
 %include "effects/Mask.h"
 %include "effects/Negate.h"
 %include "effects/Pixelate.h"
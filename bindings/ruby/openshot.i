@@ -40,12 +40,15 @@
 #endif
 %shared_ptr(juce::AudioBuffer<float>)
 %shared_ptr(openshot::Frame)
+%shared_ptr(openshot::FrameIterator)
+%shared_ptr(openshot::FrameRequest)
 
 /* Instantiate the required template specializations */
 %template() std::map<std::string, int>;
 %template() std::pair<int, int>;
 %template() std::vector<int>;
 %template() std::vector<float>;
+%template() std::vector<double>;
 %template() std::pair<double, double>;
 %template() std::pair<float, float>;
 %template() std::pair<std::string, std::string>;
@@ -69,6 +72,9 @@
 #include "CacheBase.h"
 #include "CacheDisk.h"
 #include "CacheMemory.h"
+#include "CacheMemorySharded.h"
+#include "CacheTiered.h"
+#include "Calibration.h"
 #include "ChannelLayouts.h"
 #include "ChunkReader.h"
 #include "ChunkWriter.h"
@@ -86,17 +92,29 @@
 #include "FFmpegWriter.h"
 #include "Fraction.h"
 #include "Frame.h"
+#include "FrameIterator.h"
+#include "FrameRequest.h"
 #include "FrameMapper.h"
+#include "ImageSequenceReader.h"
 #include "PlayerBase.h"
 #include "Point.h"
 #include "Profiles.h"
+#include "ProxyGenerator.h"
 #include "QtHtmlReader.h"
 #include "QtImageReader.h"
 #include "QtPlayer.h"
 #include "QtTextReader.h"
 #include "KeyFrame.h"
+#include "LiveReader.h"
+#include "MultiWriter.h"
 #include "RendererBase.h"
+#include "RenderTrace.h"
+#include "RenderFarm.h"
+#include "SegmentedWriter.h"
+#include "SharedMemoryReader.h"
+#include "SharedMemoryWriter.h"
 #include "Settings.h"
+#include "ThumbnailExtractor.h"
 #include "TimelineBase.h"
 #include "Timeline.h"
 #include "ZmqLogger.h"
@@ -140,6 +158,9 @@
 %include "CacheBase.h"
 %include "CacheDisk.h"
 %include "CacheMemory.h"
+%include "CacheMemorySharded.h"
+%include "CacheTiered.h"
+%include "Calibration.h"
 %include "ChannelLayouts.h"
 %include "ChunkReader.h"
 %include "ChunkWriter.h"
@@ -178,17 +199,29 @@
 
 %include "Fraction.h"
 %include "Frame.h"
+%include "FrameIterator.h"
+%include "FrameRequest.h"
 %include "FrameMapper.h"
+%include "ImageSequenceReader.h"
 %include "PlayerBase.h"
 %include "Point.h"
 %include "Profiles.h"
+%include "ProxyGenerator.h"
 %include "QtHtmlReader.h"
 %include "QtImageReader.h"
 %include "QtPlayer.h"
 %include "QtTextReader.h"
 %include "KeyFrame.h"
+%include "LiveReader.h"
+%include "MultiWriter.h"
 %include "RendererBase.h"
+%include "RenderTrace.h"
+%include "RenderFarm.h"
+%include "SegmentedWriter.h"
+%include "SharedMemoryReader.h"
+%include "SharedMemoryWriter.h"
 %include "Settings.h"
+%include "ThumbnailExtractor.h"
 %include "TimelineBase.h"
 %include "Timeline.h"
 %include "ZmqLogger.h"
@@ -209,6 +242,7 @@
 %include "effects/Crop.h"
 %include "effects/Deinterlace.h"
 %include "effects/Hue.h"
+%include "effects/LUT3D.h"
 %include "effects/Mask.h"
 %include "effects/Negate.h"
 %include "effects/Pixelate.h"
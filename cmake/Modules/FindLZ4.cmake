@@ -0,0 +1,51 @@
+# SPDX-FileCopyrightText: 2021 OpenShot Studios, LLC
+#
+# SPDX-License-Identifier: LGPL-3.0-or-later
+
+find_package(PkgConfig)
+pkg_check_modules(PC_LZ4 liblz4)
+
+set(LZ4_VERSION ${PC_LZ4_VERSION})
+
+find_path(LZ4_INCLUDE_DIR
+  NAMES lz4.h
+  HINTS
+    ${LZ4_DIR}/include
+    ${PC_LZ4_INCLUDE_DIRS}
+  DOC "LZ4 include dir"
+)
+
+find_library(LZ4_LIBRARY
+  NAMES lz4
+  HINTS
+    ${LZ4_DIR}/lib
+    ${PC_LZ4_LIBDIR}
+    ${PC_LZ4_LIBRARY_DIRS}
+  DOC "LZ4 library"
+)
+
+set ( LZ4_LIBRARIES ${LZ4_LIBRARY} )
+set ( LZ4_INCLUDE_DIRS ${LZ4_INCLUDE_DIR} )
+
+if (LZ4_INCLUDE_DIRS AND LZ4_LIBRARIES)
+  set(LZ4_FOUND TRUE)
+endif()
+
+if(LZ4_FOUND AND NOT TARGET LZ4::LZ4)
+	add_library(LZ4::LZ4 UNKNOWN IMPORTED)
+
+	set_property(TARGET LZ4::LZ4 PROPERTY
+		INTERFACE_INCLUDE_DIRECTORIES ${LZ4_INCLUDE_DIR})
+	set_property(TARGET LZ4::LZ4 PROPERTY
+		IMPORTED_LOCATION ${LZ4_LIBRARY})
+endif()
+
+include ( FindPackageHandleStandardArgs )
+# handle the QUIETLY and REQUIRED arguments and set LZ4_FOUND to TRUE
+# if all listed variables are TRUE
+find_package_handle_standard_args(LZ4
+  REQUIRED_VARS
+    LZ4_INCLUDE_DIR
+    LZ4_LIBRARY
+  VERSION_VAR
+    LZ4_VERSION)
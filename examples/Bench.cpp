@@ -0,0 +1,401 @@
+/**
+ * @file
+ * @brief Source file for the render benchmark executable (openshot-bench)
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
+#include "Clip.h"
+#include "DummyReader.h"
+#include "EffectBase.h"
+#include "FFmpegReader.h"
+#include "FFmpegWriter.h"
+#include "Frame.h"
+#include "Json.h"
+#include "OpenShotVersion.h"
+#include "Settings.h"
+#include "Timeline.h"
+#include "effects/Blur.h"
+#include "effects/Brightness.h"
+
+using namespace openshot;
+
+namespace {
+
+    /// The options of a benchmark run
+    struct BenchOptions {
+        std::string project;        ///< A project file to load (instead of synthesizing one)
+        std::string source = "dummy"; ///< The source of each synthesized layer ("dummy" or a media file)
+        int layers = 4;             ///< The number of synthesized layers
+        int effects = 1;            ///< The number of effects on each synthesized layer
+        int width = 1920;
+        int height = 1080;
+        int fps = 30;
+        int frames = 300;           ///< The number of frames of each scenario
+        int scrubs = 60;            ///< The number of jumps of the scrub scenario
+        int cache_frames = 0;       ///< The size of the timeline cache (in frames, 0 = default)
+        std::vector<std::string> scenarios = {"playback", "scrub", "export"};
+        std::string export_path;    ///< The file of the export scenario (default: a temporary file, removed afterwards)
+        std::string output;         ///< The file to write the results to (default: stdout)
+    };
+
+    void usage() {
+        std::cerr
+            << "Usage: openshot-bench [options]\n"
+            << "  --project FILE        Load a project (*.osp) instead of synthesizing one\n"
+            << "  --source dummy|FILE   Source of each synthesized layer (default: dummy)\n"
+            << "  --layers N            Synthesized layers (default: 4)\n"
+            << "  --effects N           Effects on each synthesized layer (default: 1)\n"
+            << "  --size WxH            Timeline size (default: 1920x1080)\n"
+            << "  --fps N               Timeline frame rate (default: 30)\n"
+            << "  --frames N            Frames rendered by each scenario (default: 300)\n"
+            << "  --scrubs N            Jumps of the scrub scenario (default: 60)\n"
+            << "  --scenarios LIST      Comma separated: playback,scrub,export (default: all)\n"
+            << "  --export-path FILE    Output of the export scenario (default: a temporary file)\n"
+            << "  --omp-threads N       Settings::OMP_THREADS\n"
+            << "  --ff-threads N        Settings::FF_THREADS\n"
+            << "  --cache-frames N      Size of the timeline cache (in frames)\n"
+            << "  --cache-budget-mb N   Settings::CACHE_BUDGET_MB\n"
+            << "  --output FILE         Write the JSON results to a file (default: stdout)\n";
+    }
+
+    // Split a comma separated list
+    std::vector<std::string> split(const std::string& list) {
+        std::vector<std::string> items;
+        std::stringstream stream(list);
+        std::string item;
+        while (std::getline(stream, item, ','))
+            if (!item.empty())
+                items.push_back(item);
+        return items;
+    }
+
+    // Parse the command line (returns false on a bad option)
+    bool parse_options(int argc, char* argv[], BenchOptions& options) {
+        Settings *s = Settings::Instance();
+        for (int i = 1; i < argc; i++) {
+            const std::string option = argv[i];
+            if (option == "--help" || option == "-h" || i + 1 >= argc)
+                return false;
+            const std::string value = argv[++i];
+            try {
+                if (option == "--project")
+                    options.project = value;
+                else if (option == "--source")
+                    options.source = value;
+                else if (option == "--layers")
+                    options.layers = std::stoi(value);
+                else if (option == "--effects")
+                    options.effects = std::stoi(value);
+                else if (option == "--size") {
+                    const size_t x = value.find('x');
+                    if (x == std::string::npos)
+                        return false;
+                    options.width = std::stoi(value.substr(0, x));
+                    options.height = std::stoi(value.substr(x + 1));
+                }
+                else if (option == "--fps")
+                    options.fps = std::stoi(value);
+                else if (option == "--frames")
+                    options.frames = std::stoi(value);
+                else if (option == "--scrubs")
+                    options.scrubs = std::stoi(value);
+                else if (option == "--scenarios")
+                    options.scenarios = split(value);
+                else if (option == "--export-path")
+                    options.export_path = value;
+                else if (option == "--omp-threads")
+                    s->OMP_THREADS = std::stoi(value);
+                else if (option == "--ff-threads")
+                    s->FF_THREADS = std::stoi(value);
+                else if (option == "--cache-frames")
+                    options.cache_frames = std::stoi(value);
+                else if (option == "--cache-budget-mb")
+                    s->CACHE_BUDGET_MB = std::stoi(value);
+                else if (option == "--output")
+                    options.output = value;
+                else
+                    return false;
+            } catch (const std::exception&) {
+                std::cerr << "Invalid value for " << option << ": " << value << std::endl;
+                return false;
+            }
+        }
+        return options.layers > 0 && options.frames > 0 && options.width > 0 && options.height > 0 && options.fps > 0;
+    }
+
+    // Get the peak resident memory of this process (in megabytes, 0 if unknown)
+    double peak_rss_mb() {
+#if defined(_WIN32)
+        return 0.0;
+#else
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+            return 0.0;
+#if defined(__APPLE__)
+        return usage.ru_maxrss / (1024.0 * 1024.0); // bytes
+#else
+        return usage.ru_maxrss / 1024.0; // kilobytes
+#endif
+#endif
+    }
+
+    // Get a percentile of sorted latencies
+    double percentile(const std::vector<double>& sorted, double fraction) {
+        if (sorted.empty())
+            return 0.0;
+        const size_t index = std::min(sorted.size() - 1, size_t(fraction * (sorted.size() - 1) + 0.5));
+        return sorted[index];
+    }
+
+    /// The timeline under test, and the objects it does not delete itself
+    struct BenchProject {
+        std::vector<std::unique_ptr<ReaderBase>> readers;
+        std::vector<std::unique_ptr<EffectBase>> effects;
+        std::vector<std::unique_ptr<Clip>> clips;
+        std::unique_ptr<Timeline> timeline;
+
+        ~BenchProject() {
+            // The timeline goes first (it still points to the clips)
+            timeline.reset();
+        }
+    };
+
+    // Load or synthesize the timeline
+    void create_project(const BenchOptions& options, BenchProject& project) {
+        if (!options.project.empty()) {
+            project.timeline.reset(new Timeline(options.project, true));
+            return;
+        }
+
+        project.timeline.reset(new Timeline(options.width, options.height, Fraction(options.fps, 1),
+                                            44100, 2, LAYOUT_STEREO));
+        const float duration = float(options.frames) / options.fps;
+        for (int layer = 0; layer < options.layers; layer++) {
+            // Each layer a little smaller (and translucent), so all of them are composited
+            if (options.source == "dummy") {
+                DummyReader *reader = new DummyReader(Fraction(options.fps, 1), options.width, options.height,
+                                                      44100, 2, duration);
+                reader->SetProcedural(true, 220.0 * (layer + 1));
+                project.readers.emplace_back(reader);
+            } else {
+                project.readers.emplace_back(new FFmpegReader(options.source));
+            }
+            Clip *clip = new Clip(project.readers.back().get());
+            project.clips.emplace_back(clip);
+            clip->Layer(layer);
+            clip->scale = SCALE_NONE;
+            clip->scale_x = Keyframe(1.0 - 0.5 * layer / options.layers);
+            clip->scale_y = Keyframe(1.0 - 0.5 * layer / options.layers);
+            clip->alpha = Keyframe(0.8);
+
+            for (int e = 0; e < options.effects; e++) {
+                // Alternate a cheap and an expensive effect
+                EffectBase *effect;
+                if (e % 2 == 0)
+                    effect = new Brightness(Keyframe(0.1), Keyframe(3.0));
+                else
+                    effect = new Blur(Keyframe(3.0), Keyframe(3.0), Keyframe(3.0), Keyframe(1.0));
+                project.effects.emplace_back(effect);
+                clip->AddEffect(effect);
+            }
+            project.timeline->AddClip(clip);
+        }
+    }
+
+    /// Times the frames of a scenario, and collects the stats of the timeline
+    class ScenarioTimer {
+    private:
+        Timeline *timeline;
+        std::vector<double> latencies_ms;
+        std::chrono::steady_clock::time_point start;
+
+    public:
+        explicit ScenarioTimer(Timeline *timeline) : timeline(timeline) {
+            timeline->ClearAllCache(true);
+            timeline->ResetRenderStats();
+            timeline->ResetCacheStats();
+            start = std::chrono::steady_clock::now();
+        }
+
+        // Time one frame (rendered by a function)
+        template <typename F>
+        void Time(F render) {
+            const auto frame_start = std::chrono::steady_clock::now();
+            render();
+            latencies_ms.push_back(std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - frame_start).count());
+        }
+
+        // Get the results of the scenario
+        Json::Value Results(double frame_budget_ms) {
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::vector<double> sorted = latencies_ms;
+            std::sort(sorted.begin(), sorted.end());
+            double total_ms = 0.0;
+            int64_t late = 0;
+            for (double latency : sorted) {
+                total_ms += latency;
+                if (latency > frame_budget_ms)
+                    late++;
+            }
+
+            Json::Value root;
+            root["frames"] = Json::Int64(sorted.size());
+            root["seconds"] = seconds;
+            root["fps"] = seconds > 0.0 ? sorted.size() / seconds : 0.0;
+            root["latency_ms"]["mean"] = sorted.empty() ? 0.0 : total_ms / sorted.size();
+            root["latency_ms"]["p50"] = percentile(sorted, 0.50);
+            root["latency_ms"]["p99"] = percentile(sorted, 0.99);
+            root["latency_ms"]["max"] = sorted.empty() ? 0.0 : sorted.back();
+            // Frames slower than the frame rate (which a player would drop)
+            root["late_frames"] = Json::Int64(late);
+            root["peak_rss_mb"] = peak_rss_mb();
+            root["cache"] = openshot::stringToJson(timeline->CacheStatsJson());
+            root["stages"] = openshot::stringToJson(timeline->GetRenderStats());
+            return root;
+        }
+    };
+
+    // Play the frames in order (as the preview does)
+    Json::Value run_playback(Timeline *t, int64_t frames) {
+        ScenarioTimer timer(t);
+        for (int64_t number = 1; number <= frames; number++)
+            timer.Time([&]() { t->GetFrame(number); });
+        return timer.Results(1000.0 / t->info.fps.ToDouble());
+    }
+
+    // Jump to random frames, and play a few frames after each jump (as dragging the playhead does)
+    Json::Value run_scrub(Timeline *t, int64_t frames, int scrubs) {
+        std::mt19937 random(1);
+        std::uniform_int_distribution<int64_t> positions(1, frames);
+        ScenarioTimer timer(t);
+        for (int scrub = 0; scrub < scrubs; scrub++) {
+            const int64_t position = positions(random);
+            for (int64_t number = position; number < position + 5 && number <= frames; number++)
+                timer.Time([&]() { t->GetFrame(number); });
+        }
+        return timer.Results(1000.0 / t->info.fps.ToDouble());
+    }
+
+    // Render and encode the frames (as an export does)
+    Json::Value run_export(Timeline *t, int64_t frames, const std::string& path) {
+        FFmpegWriter w(path);
+        w.SetVideoOptions(true, "libx264", t->info.fps, t->info.width, t->info.height, Fraction(1, 1),
+                          false, false, 15000000);
+        w.SetAudioOptions(true, "aac", t->info.sample_rate, t->info.channels, t->info.channel_layout, 192000);
+        w.Open();
+
+        ScenarioTimer timer(t);
+        for (int64_t number = 1; number <= frames; number++)
+            timer.Time([&]() { w.WriteFrame(t->GetFrame(number)); });
+        w.Close();
+        return timer.Results(1000.0 / t->info.fps.ToDouble());
+    }
+
+    // Get the settings which affect the results
+    Json::Value settings_json(const BenchOptions& options, Timeline *t) {
+        Settings *s = Settings::Instance();
+        Json::Value root;
+        root["omp_threads"] = s->OMP_THREADS;
+        root["ff_threads"] = s->FF_THREADS;
+        root["cache_budget_mb"] = s->CACHE_BUDGET_MB;
+        root["cache_max_bytes"] = Json::Int64(t->GetCache() ? t->GetCache()->GetMaxBytes() : 0);
+        root["hardware_decoder"] = s->HARDWARE_DECODER;
+        root["hardware_concurrency"] = std::thread::hardware_concurrency();
+        root["project"] = options.project;
+        root["source"] = options.project.empty() ? options.source : "";
+        root["layers"] = options.project.empty() ? options.layers : int(t->Clips().size());
+        root["effects_per_layer"] = options.project.empty() ? options.effects : 0;
+        root["width"] = t->info.width;
+        root["height"] = t->info.height;
+        root["fps"] = t->info.fps.ToDouble();
+        return root;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    if (!parse_options(argc, argv, options)) {
+        usage();
+        return 1;
+    }
+    Settings::Instance()->ENABLE_RENDER_STATS = true;
+
+    Json::Value root;
+    root["version"] = OPENSHOT_VERSION_FULL;
+    try {
+        BenchProject project;
+        create_project(options, project);
+        Timeline *t = project.timeline.get();
+        if (options.cache_frames > 0 && t->GetCache())
+            t->GetCache()->SetMaxBytesFromInfo(options.cache_frames, t->info.width, t->info.height,
+                                               t->info.sample_rate, t->info.channels);
+        t->Open();
+
+        // Never render past the end of a loaded project
+        int64_t frames = options.frames;
+        if (!options.project.empty())
+            frames = std::max<int64_t>(1, std::min<int64_t>(frames, t->GetMaxFrame()));
+
+        root["settings"] = settings_json(options, t);
+        for (const std::string& scenario : options.scenarios) {
+            std::cerr << "Running " << scenario << "..." << std::endl;
+            if (scenario == "playback") {
+                root["scenarios"]["playback"] = run_playback(t, frames);
+            } else if (scenario == "scrub") {
+                root["scenarios"]["scrub"] = run_scrub(t, frames, options.scrubs);
+            } else if (scenario == "export") {
+                const bool temporary = options.export_path.empty();
+                const std::string path = temporary ? "openshot-bench-export.mp4" : options.export_path;
+                root["scenarios"]["export"] = run_export(t, frames, path);
+                if (temporary)
+                    std::remove(path.c_str());
+            } else {
+                std::cerr << "Unknown scenario: " << scenario << std::endl;
+                usage();
+                return 1;
+            }
+        }
+        t->Close();
+    } catch (const std::exception& e) {
+        std::cerr << "Benchmark failed: " << e.what() << std::endl;
+        return 2;
+    }
+    root["peak_rss_mb"] = peak_rss_mb();
+
+    // Write the results
+    if (options.output.empty()) {
+        std::cout << root.toStyledString();
+    } else {
+        std::ofstream output(options.output);
+        output << root.toStyledString();
+        if (!output) {
+            std::cerr << "Can't write " << options.output << std::endl;
+            return 2;
+        }
+    }
+    return 0;
+}
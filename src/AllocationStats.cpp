@@ -0,0 +1,186 @@
+/**
+ * @file
+ * @brief Source file for AllocationStats class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "AllocationStats.h"
+
+#include <cstdlib>
+#include <new>
+
+using namespace openshot;
+
+namespace {
+	// The counters are plain statics (constant initialized), so counting never allocates
+	AllocationScopeStats scope_stats[ALLOCATION_SCOPE_COUNT];
+
+	// The scope of each thread
+	thread_local int current_scope = ALLOCATION_SCOPE_OTHER;
+}
+
+// Forget all allocations
+void AllocationScopeStats::Reset()
+{
+	allocations = 0;
+	bytes = 0;
+	images = 0;
+	image_bytes = 0;
+	audio_buffers = 0;
+	audio_bytes = 0;
+}
+
+// Generate Json::Value for this object
+Json::Value AllocationScopeStats::JsonValue(int64_t frames) const
+{
+	Json::Value root;
+	root["allocations"] = Json::Int64(allocations.load(std::memory_order_relaxed));
+	root["bytes"] = Json::Int64(bytes.load(std::memory_order_relaxed));
+	root["images"] = Json::Int64(images.load(std::memory_order_relaxed));
+	root["image_bytes"] = Json::Int64(image_bytes.load(std::memory_order_relaxed));
+	root["audio_buffers"] = Json::Int64(audio_buffers.load(std::memory_order_relaxed));
+	root["audio_bytes"] = Json::Int64(audio_bytes.load(std::memory_order_relaxed));
+	if (frames > 0) {
+		for (const auto& name : root.getMemberNames())
+			root["per_frame"][name] = root[name].asDouble() / frames;
+	}
+	return root;
+}
+
+// Get the name of a scope
+std::string AllocationStats::ScopeName(AllocationScope scope)
+{
+	switch (scope) {
+		case ALLOCATION_SCOPE_OTHER: return "other";
+		case ALLOCATION_SCOPE_READER: return "reader";
+		case ALLOCATION_SCOPE_MAPPER: return "mapper";
+		case ALLOCATION_SCOPE_CLIP: return "clip";
+		case ALLOCATION_SCOPE_EFFECT: return "effect";
+		case ALLOCATION_SCOPE_TIMELINE: return "timeline";
+		case ALLOCATION_SCOPE_WRITER: return "writer";
+		default: return "";
+	}
+}
+
+// Get the scope of the calling thread
+AllocationScope AllocationStats::CurrentScope()
+{
+	return AllocationScope(current_scope);
+}
+
+// Set the scope of the calling thread
+AllocationScope AllocationStats::SetCurrentScope(AllocationScope scope)
+{
+	const AllocationScope previous = AllocationScope(current_scope);
+	current_scope = scope;
+	return previous;
+}
+
+// Get the allocations of a scope
+const AllocationScopeStats& AllocationStats::Scope(AllocationScope scope)
+{
+	return scope_stats[scope];
+}
+
+// Count an allocation in the scope of the calling thread
+void AllocationStats::AddAllocation(size_t bytes)
+{
+	AllocationScopeStats& stats = scope_stats[current_scope];
+	stats.allocations.fetch_add(1, std::memory_order_relaxed);
+	stats.bytes.fetch_add(int64_t(bytes), std::memory_order_relaxed);
+}
+
+#if USE_ALLOCATION_TRACKING
+// Count an image added to a frame
+void AllocationStats::AddImage(int64_t bytes)
+{
+	AllocationScopeStats& stats = scope_stats[current_scope];
+	stats.images.fetch_add(1, std::memory_order_relaxed);
+	stats.image_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+// Count an audio buffer created for a frame
+void AllocationStats::AddAudioBuffer(int64_t bytes)
+{
+	AllocationScopeStats& stats = scope_stats[current_scope];
+	stats.audio_buffers.fetch_add(1, std::memory_order_relaxed);
+	stats.audio_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+#endif
+
+// Forget the allocations of all scopes
+void AllocationStats::Reset()
+{
+	for (auto& stats : scope_stats)
+		stats.Reset();
+}
+
+// Generate Json::Value for the allocations of all scopes
+Json::Value AllocationStats::JsonValue(int64_t frames)
+{
+	Json::Value root;
+	root["enabled"] = Enabled();
+	if (!Enabled())
+		return root;
+
+	AllocationScopeStats total;
+	for (int scope = 0; scope < ALLOCATION_SCOPE_COUNT; scope++) {
+		const AllocationScopeStats& stats = scope_stats[scope];
+		root["scopes"][ScopeName(AllocationScope(scope))] = stats.JsonValue(frames);
+		total.allocations += stats.allocations.load(std::memory_order_relaxed);
+		total.bytes += stats.bytes.load(std::memory_order_relaxed);
+		total.images += stats.images.load(std::memory_order_relaxed);
+		total.image_bytes += stats.image_bytes.load(std::memory_order_relaxed);
+		total.audio_buffers += stats.audio_buffers.load(std::memory_order_relaxed);
+		total.audio_bytes += stats.audio_bytes.load(std::memory_order_relaxed);
+	}
+	root["total"] = total.JsonValue(frames);
+	root["frames"] = Json::Int64(frames);
+	return root;
+}
+
+#if USE_ALLOCATION_TRACKING
+// Replace the global operator new (and delete, to pair it with free), to count the allocations of each scope
+void* operator new(std::size_t size)
+{
+	AllocationStats::AddAllocation(size);
+	void *memory = std::malloc(size ? size : 1);
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new[](std::size_t size)
+{
+	AllocationStats::AddAllocation(size);
+	void *memory = std::malloc(size ? size : 1);
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	AllocationStats::AddAllocation(size);
+	return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	AllocationStats::AddAllocation(size);
+	return std::malloc(size ? size : 1);
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+#endif // USE_ALLOCATION_TRACKING
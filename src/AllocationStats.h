@@ -0,0 +1,145 @@
+/**
+ * @file
+ * @brief Header file for AllocationStats class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_ALLOCATION_STATS_H
+#define OPENSHOT_ALLOCATION_STATS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "Json.h"
+
+namespace openshot {
+
+	/// The subsystems which heap allocations are attributed to (see AllocationStats)
+	enum AllocationScope
+	{
+		ALLOCATION_SCOPE_OTHER,    ///< Outside of any scope (i.e. the threads of a player or an application)
+		ALLOCATION_SCOPE_READER,   ///< Readers, called by a clip or frame mapper (decoding, scaling, ...)
+		ALLOCATION_SCOPE_MAPPER,   ///< FrameMapper (mapping frame rates, resampling audio)
+		ALLOCATION_SCOPE_CLIP,     ///< Clip (copying frames, keyframes, compositing a layer)
+		ALLOCATION_SCOPE_EFFECT,   ///< The effects of a clip or timeline
+		ALLOCATION_SCOPE_TIMELINE, ///< Timeline (canvases, layers, mixing audio)
+		ALLOCATION_SCOPE_WRITER,   ///< FFmpegWriter (converting and encoding frames)
+		ALLOCATION_SCOPE_COUNT
+	};
+
+	/**
+	 * @brief The heap allocations of one scope (lock-free, so it can be updated by any thread)
+	 */
+	struct AllocationScopeStats {
+		std::atomic<int64_t> allocations{0};   ///< Calls of operator new (and new[])
+		std::atomic<int64_t> bytes{0};         ///< Bytes requested by those calls
+		std::atomic<int64_t> images{0};        ///< Images added to frames (their pixels are not allocated with new)
+		std::atomic<int64_t> image_bytes{0};   ///< Bytes of those images
+		std::atomic<int64_t> audio_buffers{0}; ///< Audio buffers created for frames
+		std::atomic<int64_t> audio_bytes{0};   ///< Bytes of those audio buffers
+
+		/// Forget all allocations
+		void Reset();
+
+		/// @brief Generate Json::Value (the counters, and the counters per frame)
+		/// @param frames The number of frames rendered meanwhile (0 = don't add the counters per frame)
+		Json::Value JsonValue(int64_t frames) const;
+	};
+
+	/**
+	 * @brief This class counts the heap allocations of each subsystem (reader, mapper, clip, effect, timeline, writer)
+	 *
+	 * Allocations are only counted when libopenshot is built with ENABLE_ALLOCATION_TRACKING (which defines
+	 * USE_ALLOCATION_TRACKING=1). That build replaces the global operator new (of the whole process), and
+	 * counts the images and audio buffers added to frames (whose samples and pixels are not allocated with new).
+	 * Each allocation is attributed to the innermost AllocationScopeGuard of the calling thread. Otherwise,
+	 * Enabled() is false, and the guards and counters compile to nothing.
+	 *
+	 * The counters are added to the render stats (as "allocations", see RenderStats::JsonValue() and
+	 * Timeline::GetRenderStats()), with the counters per rendered timeline frame, and reset with them.
+	 */
+	class AllocationStats {
+	public:
+		/// Is libopenshot built with allocation tracking?
+		static constexpr bool Enabled() {
+#if USE_ALLOCATION_TRACKING
+			return true;
+#else
+			return false;
+#endif
+		}
+
+		/// Get the name of a scope (as used in the JSON)
+		static std::string ScopeName(openshot::AllocationScope scope);
+
+		/// Get the scope of the calling thread
+		static openshot::AllocationScope CurrentScope();
+
+		/// @brief Set the scope of the calling thread
+		/// @returns The previous scope
+		static openshot::AllocationScope SetCurrentScope(openshot::AllocationScope scope);
+
+		/// Get the allocations of a scope
+		static const openshot::AllocationScopeStats& Scope(openshot::AllocationScope scope);
+
+		/// Count an allocation (of operator new) in the scope of the calling thread
+		static void AddAllocation(size_t bytes);
+
+#if USE_ALLOCATION_TRACKING
+		/// Count an image added to a frame (in the scope of the calling thread)
+		static void AddImage(int64_t bytes);
+
+		/// Count an audio buffer created for a frame (in the scope of the calling thread)
+		static void AddAudioBuffer(int64_t bytes);
+#else
+		static void AddImage(int64_t) {}
+		static void AddAudioBuffer(int64_t) {}
+#endif
+
+		/// Forget the allocations of all scopes
+		static void Reset();
+
+		/// @brief Generate Json::Value for the allocations of all scopes (and their total)
+		/// @param frames The number of frames rendered meanwhile (0 = don't add the counters per frame)
+		static Json::Value JsonValue(int64_t frames);
+	};
+
+	/**
+	 * @brief Attribute the allocations of the calling thread to a scope, until destruction (then restore the previous scope)
+	 *
+	 * \code
+	 * std::shared_ptr<Frame> Clip::GetFrame(...) {
+	 *     AllocationScopeGuard allocations(ALLOCATION_SCOPE_CLIP);
+	 *     ...
+	 * }
+	 * \endcode
+	 */
+	class AllocationScopeGuard {
+#if USE_ALLOCATION_TRACKING
+	private:
+		openshot::AllocationScope previous;
+
+	public:
+		explicit AllocationScopeGuard(openshot::AllocationScope scope)
+			: previous(AllocationStats::SetCurrentScope(scope)) {}
+		~AllocationScopeGuard() { AllocationStats::SetCurrentScope(previous); }
+#else
+	public:
+		explicit AllocationScopeGuard(openshot::AllocationScope) {}
+#endif
+
+		AllocationScopeGuard(AllocationScopeGuard const&) = delete;
+		AllocationScopeGuard & operator=(AllocationScopeGuard const&) = delete;
+	};
+
+}
+
+#endif
@@ -0,0 +1,152 @@
+/**
+ * @file
+ * @brief Source file for AudioBufferPool class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+#include <iterator>
+
+#include <AppConfig.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+
+#include "AudioBufferPool.h"
+#include "AllocationStats.h"
+
+using namespace openshot;
+
+// Get the size of the samples of a pooled buffer (in bytes)
+static int64_t bucket_bytes(int channels, int capacity) {
+	return int64_t(channels) * capacity * sizeof(float);
+}
+
+// Global reference to the pool
+AudioBufferPool *AudioBufferPool::m_pInstance = nullptr;
+
+// Default constructor (default to 64 MB of idle buffers)
+AudioBufferPool::AudioBufferPool() : idle_bytes(0), max_bytes(64 * 1024 * 1024) { }
+
+// Create or Get an instance of the pool singleton
+AudioBufferPool *AudioBufferPool::Instance()
+{
+	// Create the actual instance of the pool only once (frames are created on many threads)
+	static std::once_flag created;
+	std::call_once(created, []() { m_pInstance = new AudioBufferPool; });
+
+	return m_pInstance;
+}
+
+// Get an idle buffer with room for a number of channels and samples
+juce::AudioBuffer<float> *AudioBufferPool::acquire(int channels, int capacity) {
+	const std::lock_guard<std::mutex> lock(poolMutex);
+
+	auto idle = idle_buffers.find(BufferSize(channels, capacity));
+	if (idle == idle_buffers.end() || idle->second.empty())
+		return nullptr;
+
+	juce::AudioBuffer<float> *buffer = idle->second.back();
+	idle->second.pop_back();
+	idle_bytes -= bucket_bytes(channels, capacity);
+	return buffer;
+}
+
+// Return a buffer to the pool
+void AudioBufferPool::release(juce::AudioBuffer<float> *buffer, BufferSize size) {
+	const int64_t bytes = bucket_bytes(size.first, size.second);
+	{
+		const std::lock_guard<std::mutex> lock(poolMutex);
+
+		// Keep this buffer (if the pool has room for it)
+		if (idle_bytes + bytes <= max_bytes) {
+			idle_buffers[size].push_back(buffer);
+			idle_bytes += bytes;
+			return;
+		}
+	}
+
+	// Pool is full, free buffer
+	delete buffer;
+}
+
+// Wrap a buffer in a shared_ptr (which returns it to the pool)
+std::shared_ptr<juce::AudioBuffer<float>> AudioBufferPool::wrap(juce::AudioBuffer<float> *buffer, int channels, int capacity) {
+	return std::shared_ptr<juce::AudioBuffer<float>>(buffer, [channels, capacity](juce::AudioBuffer<float> *released) {
+		// A frame may have grown the buffer (which reallocated it to its new size)
+		BufferSize size(channels, capacity);
+		if (released->getNumChannels() != channels || released->getNumSamples() > capacity)
+			size = BufferSize(released->getNumChannels(), (released->getNumSamples() / BUCKET_SAMPLES) * BUCKET_SAMPLES);
+		Instance()->release(released, size);
+	});
+}
+
+// Create a pooled audio buffer
+std::shared_ptr<juce::AudioBuffer<float>> AudioBufferPool::Create(int channels, int samples) {
+	channels = std::max(channels, 0);
+	samples = std::max(samples, 0);
+	const int capacity = ((samples + BUCKET_SAMPLES - 1) / BUCKET_SAMPLES) * BUCKET_SAMPLES;
+
+	// Re-use an idle buffer of the same size (or allocate one outside the lock), and shrink it to the
+	// requested samples without reallocating it
+	juce::AudioBuffer<float> *buffer = acquire(channels, capacity);
+	if (!buffer) {
+		buffer = new juce::AudioBuffer<float>(channels, capacity);
+		AllocationStats::AddAudioBuffer(bucket_bytes(channels, capacity));
+	}
+	buffer->setSize(channels, samples, false, false, true);
+	return wrap(buffer, channels, capacity);
+}
+
+// Create a pooled copy of an audio buffer
+std::shared_ptr<juce::AudioBuffer<float>> AudioBufferPool::Copy(const juce::AudioBuffer<float>& other) {
+	std::shared_ptr<juce::AudioBuffer<float>> buffer = Create(other.getNumChannels(), other.getNumSamples());
+	buffer->makeCopyOf(other, true);
+	return buffer;
+}
+
+// Free all idle buffers
+void AudioBufferPool::Clear() {
+	const std::lock_guard<std::mutex> lock(poolMutex);
+
+	for (auto& idle : idle_buffers) {
+		for (juce::AudioBuffer<float> *buffer : idle.second)
+			delete buffer;
+	}
+	idle_buffers.clear();
+	idle_bytes = 0;
+}
+
+// Get the total size of all idle buffers
+int64_t AudioBufferPool::GetIdleBytes() {
+	const std::lock_guard<std::mutex> lock(poolMutex);
+	return idle_bytes;
+}
+
+// Get the max size of all idle buffers
+int64_t AudioBufferPool::GetMaxBytes() {
+	const std::lock_guard<std::mutex> lock(poolMutex);
+	return max_bytes;
+}
+
+// Set the max size of all idle buffers (0 disables pooling)
+void AudioBufferPool::SetMaxBytes(int64_t number_of_bytes) {
+	const std::lock_guard<std::mutex> lock(poolMutex);
+	max_bytes = number_of_bytes;
+
+	// Free idle buffers until they fit (most channels and largest sizes first)
+	while (idle_bytes > max_bytes && !idle_buffers.empty()) {
+		auto largest = std::prev(idle_buffers.end());
+		if (largest->second.empty()) {
+			idle_buffers.erase(largest);
+			continue;
+		}
+		delete largest->second.back();
+		largest->second.pop_back();
+		idle_bytes -= bucket_bytes(largest->first.first, largest->first.second);
+	}
+}
@@ -0,0 +1,106 @@
+/**
+ * @file
+ * @brief Header file for AudioBufferPool class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_AUDIO_BUFFER_POOL_H
+#define OPENSHOT_AUDIO_BUFFER_POOL_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace juce {
+	template <typename Type> class AudioBuffer;
+}
+
+namespace openshot {
+
+	/**
+	 * @brief This singleton class re-uses the audio buffers of frames
+	 *
+	 * Rendering a frame creates several frames (the decoded frame, the mapped frame, the clip's copy and the
+	 * timeline frame), each with its own audio buffer. Instead of freeing a buffer when its last frame is
+	 * deleted, it is returned to this pool, and handed out again for the next buffer with the same number of
+	 * channels and a similar number of samples. Buffers are grouped by size (rounded up to a multiple of
+	 * BUCKET_SAMPLES), so the slightly different sample counts of consecutive frames (i.e. 1470 and 1471
+	 * samples at 44100 Hz and 30 fps) use the same buffers. Only up to GetMaxBytes() of idle buffers are kept.
+	 *
+	 * \code
+	 * // Create a pooled buffer (it returns to the pool when the last copy of the shared_ptr is deleted)
+	 * std::shared_ptr<juce::AudioBuffer<float>> audio = AudioBufferPool::Instance()->Create(2, 1470);
+	 * audio->clear();
+	 * \endcode
+	 */
+	class AudioBufferPool {
+	private:
+		/// The size of an idle buffer (channels, and the number of samples it has room for)
+		typedef std::pair<int, int> BufferSize;
+
+		std::mutex poolMutex;
+		std::map<BufferSize, std::vector<juce::AudioBuffer<float> *>> idle_buffers; ///< Idle buffers (grouped by size)
+		int64_t idle_bytes; ///< Total size of all idle buffers
+		int64_t max_bytes; ///< Max size of all idle buffers (more buffers are freed instead)
+
+		/// Private variable to keep track of singleton instance
+		static AudioBufferPool *m_pInstance;
+
+		/// Default constructor
+		AudioBufferPool();
+
+		/// Don't allow the user to copy or assign this instance
+		AudioBufferPool(AudioBufferPool const&) = delete;
+		AudioBufferPool & operator=(AudioBufferPool const&) = delete;
+
+		/// Get a buffer with room for a number of channels and samples (or nullptr, if none is idle)
+		juce::AudioBuffer<float> *acquire(int channels, int capacity);
+
+		/// Return a buffer to the pool (or free it, if the pool is full)
+		void release(juce::AudioBuffer<float> *buffer, BufferSize size);
+
+		/// Wrap a buffer in a shared_ptr (which returns it to the pool)
+		std::shared_ptr<juce::AudioBuffer<float>> wrap(juce::AudioBuffer<float> *buffer, int channels, int capacity);
+
+	public:
+		/// The number of samples a buffer is rounded up to (its size in the pool)
+		static const int BUCKET_SAMPLES = 512;
+
+		/// Create or get an instance of this pool singleton (invoke the class with this method)
+		static AudioBufferPool *Instance();
+
+		/// @brief Create a pooled audio buffer (the samples are not initialized)
+		/// @param channels The number of channels
+		/// @param samples The number of samples (of each channel)
+		std::shared_ptr<juce::AudioBuffer<float>> Create(int channels, int samples);
+
+		/// @brief Create a pooled copy of an audio buffer
+		/// @param other The buffer to copy (its channels and samples)
+		std::shared_ptr<juce::AudioBuffer<float>> Copy(const juce::AudioBuffer<float>& other);
+
+		/// Free all idle buffers
+		void Clear();
+
+		/// Get the total size of all idle buffers (in bytes)
+		int64_t GetIdleBytes();
+
+		/// Get the max size of all idle buffers (in bytes)
+		int64_t GetMaxBytes();
+
+		/// @brief Set the max size of all idle buffers (in bytes). Set to 0 to disable pooling.
+		/// @param number_of_bytes The max number of bytes of idle buffers to keep
+		void SetMaxBytes(int64_t number_of_bytes);
+	};
+
+}
+
+#endif
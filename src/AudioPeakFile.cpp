@@ -0,0 +1,300 @@
+/**
+ * @file
+ * @brief Source file for AudioPeakFile class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include "AudioPeakFile.h"
+#include "FFmpegReader.h"
+#include "OpenMPUtilities.h"
+
+using namespace openshot;
+
+// The first bytes of every peak file
+static const char PEAK_FILE_MAGIC[8] = {'O', 'S', 'P', 'E', 'A', 'K', 'S', '\0'};
+static const int32_t PEAK_FILE_VERSION = 1;
+
+// Constructor
+AudioPeakFile::AudioPeakFile(const std::string& path)
+	: file(QString::fromStdString(path)), peaks(nullptr), channels(0), sample_rate(0), samples(0) { }
+
+// Get the number of buckets of each channel of a level
+int64_t AudioPeakFile::level_buckets(int64_t samples, int level)
+{
+	const int64_t bucket_size = int64_t(BASE_BUCKET_SIZE) << level;
+	return (samples + bucket_size - 1) / bucket_size;
+}
+
+// Get the number of levels of a file (the top level is a single bucket)
+int AudioPeakFile::level_count(int64_t samples)
+{
+	int level = 0;
+	while (level_buckets(samples, level) > 1)
+		level++;
+	return level + 1;
+}
+
+// Get the path of the peak file of a media file
+std::string AudioPeakFile::GetPath(const std::string& directory, const std::string& media_path)
+{
+	QFileInfo info(QString::fromStdString(media_path));
+	if (directory.empty() || !info.exists() || !info.isFile())
+		return "";
+
+	// Name the peak file after the media file (a changed file gets a new peak file)
+	const std::string key = info.absoluteFilePath().toStdString() + '\n' + std::to_string(info.size()) + '\n' +
+		std::to_string(info.lastModified().toMSecsSinceEpoch());
+	return directory + "/" + std::to_string(std::hash<std::string>()(key)) + ".peaks";
+}
+
+// Decode the audio stream of a reader, and write its peak file
+bool AudioPeakFile::Create(FFmpegReader* reader, const std::string& path)
+{
+	if (!reader || path.empty() || !reader->info.has_audio || reader->info.channels <= 0 || reader->info.sample_rate <= 0)
+		return false;
+
+	const int channels = reader->info.channels;
+	const int sample_rate = reader->info.sample_rate;
+	const int64_t samples = std::llround(reader->info.duration * sample_rate);
+	if (samples <= 0)
+		return false;
+
+	// The first bucket of each level
+	const int levels = level_count(samples);
+	std::vector<int64_t> offsets;
+	int64_t total_buckets = 0;
+	for (int level = 0; level < levels; level++) {
+		offsets.push_back(total_buckets);
+		total_buckets += level_buckets(samples, level) * channels;
+	}
+	std::vector<AudioPeak> buckets(total_buckets);
+
+	// Split long files into segments (of whole buckets), which are decoded in parallel
+	// (each segment seeks and decodes with its own decoder). Short files use 1 segment.
+	const int64_t base_buckets = level_buckets(samples, 0);
+	const int64_t buckets_per_second = std::max(1, sample_rate / BASE_BUCKET_SIZE);
+	const int segments = (int) std::max<int64_t>(1, std::min<int64_t>(OPEN_MP_NUM_PROCESSORS, base_buckets / (buckets_per_second * 30)));
+	const int64_t buckets_per_segment = (base_buckets + segments - 1) / segments;
+	bool failed = false;
+
+	#pragma omp parallel for schedule(dynamic) if (segments > 1)
+	for (int segment = 0; segment < segments; segment++) {
+		const int64_t first_bucket = segment * buckets_per_segment;
+		const int64_t end_bucket = std::min(base_buckets, first_bucket + buckets_per_segment);
+		if (first_bucket >= end_bucket)
+			continue;
+
+		// Current bucket (of this segment)
+		int64_t bucket_index = -1;
+		int64_t bucket_samples = 0;
+		std::vector<float> bucket_min(channels), bucket_max(channels);
+		std::vector<double> squared_sum(channels), absolute_sum(channels);
+
+		// Save a bucket of the finest level
+		auto save_bucket = [&]() {
+			if (bucket_index < first_bucket || bucket_index >= end_bucket || bucket_samples == 0)
+				return;
+			for (int channel = 0; channel < channels; channel++) {
+				AudioPeak& peak = buckets[channel * base_buckets + bucket_index];
+				peak.min = bucket_min[channel];
+				peak.max = bucket_max[channel];
+				peak.rms = std::sqrt(squared_sum[channel] / bucket_samples);
+				peak.average = absolute_sum[channel] / bucket_samples;
+			}
+		};
+
+		try {
+			reader->ReadAudioSamples(
+				[&](const float *const *block, int64_t position, int sample_count) {
+					int offset = 0;
+					while (offset < sample_count) {
+						// Samples (of this block) which belong to the same bucket
+						const int64_t sample_position = position + offset;
+						const int64_t index = sample_position / BASE_BUCKET_SIZE;
+						const int run = (int) std::min<int64_t>(sample_count - offset,
+																(index + 1) * BASE_BUCKET_SIZE - sample_position);
+						if (index != bucket_index) {
+							save_bucket();
+							bucket_index = index;
+							bucket_samples = 0;
+							std::fill(bucket_min.begin(), bucket_min.end(), std::numeric_limits<float>::max());
+							std::fill(bucket_max.begin(), bucket_max.end(), std::numeric_limits<float>::lowest());
+							std::fill(squared_sum.begin(), squared_sum.end(), 0.0);
+							std::fill(absolute_sum.begin(), absolute_sum.end(), 0.0);
+						}
+
+						for (int channel = 0; channel < channels; channel++) {
+							const float *channel_samples = block[channel] + offset;
+							for (int s = 0; s < run; s++) {
+								const float value = channel_samples[s];
+								bucket_min[channel] = std::min(bucket_min[channel], value);
+								bucket_max[channel] = std::max(bucket_max[channel], value);
+								squared_sum[channel] += value * value;
+								absolute_sum[channel] += std::abs(value);
+							}
+						}
+						bucket_samples += run;
+						offset += run;
+					}
+				},
+				first_bucket * BASE_BUCKET_SIZE, std::min(samples, end_bucket * BASE_BUCKET_SIZE));
+			save_bucket();
+		} catch (...) {
+			// Exceptions can't leave the parallel region
+			#pragma omp critical (audio_peak_file_error)
+			failed = true;
+		}
+	}
+	if (failed)
+		return false;
+
+	// Each level above merges pairs of buckets of the level below
+	for (int level = 1; level < levels; level++) {
+		const int64_t below_count = level_buckets(samples, level - 1);
+		const int64_t count = level_buckets(samples, level);
+		const int64_t below_size = int64_t(BASE_BUCKET_SIZE) << (level - 1);
+		for (int channel = 0; channel < channels; channel++) {
+			const AudioPeak *below = buckets.data() + offsets[level - 1] + channel * below_count;
+			AudioPeak *merged = buckets.data() + offsets[level] + channel * count;
+			for (int64_t index = 0; index < count; index++) {
+				AudioPeak& peak = merged[index];
+				peak = below[index * 2];
+				if (index * 2 + 1 >= below_count)
+					continue;
+
+				// Weight each half by its number of samples (the last bucket can be partial)
+				const AudioPeak& second = below[index * 2 + 1];
+				const double first_samples = below_size;
+				const double second_samples = std::min(below_size, samples - (index * 2 + 1) * below_size);
+				const double total_samples = first_samples + second_samples;
+				peak.min = std::min(peak.min, second.min);
+				peak.max = std::max(peak.max, second.max);
+				peak.rms = std::sqrt((peak.rms * peak.rms * first_samples + second.rms * second.rms * second_samples) / total_samples);
+				peak.average = (peak.average * first_samples + second.average * second_samples) / total_samples;
+			}
+		}
+	}
+
+	// Write the file (the previous file, if any, is only replaced once the new one is complete)
+	QDir().mkpath(QFileInfo(QString::fromStdString(path)).absolutePath());
+	QSaveFile output(QString::fromStdString(path));
+	if (!output.open(QIODevice::WriteOnly))
+		return false;
+
+	Header header;
+	std::memcpy(header.magic, PEAK_FILE_MAGIC, sizeof(header.magic));
+	header.version = PEAK_FILE_VERSION;
+	header.channels = channels;
+	header.sample_rate = sample_rate;
+	header.levels = levels;
+	header.samples = samples;
+	const int64_t data_bytes = total_buckets * int64_t(sizeof(AudioPeak));
+	if (output.write((const char *) &header, sizeof(header)) != int64_t(sizeof(header)) ||
+		output.write((const char *) buckets.data(), data_bytes) != data_bytes) {
+		output.cancelWriting();
+		return false;
+	}
+	return output.commit();
+}
+
+// Map a peak file
+std::shared_ptr<AudioPeakFile> AudioPeakFile::Open(const std::string& path)
+{
+	std::shared_ptr<AudioPeakFile> peak_file(new AudioPeakFile(path));
+	if (path.empty() || !peak_file->file.open(QIODevice::ReadOnly))
+		return nullptr;
+
+	const int64_t size = peak_file->file.size();
+	if (size < int64_t(sizeof(Header)))
+		return nullptr;
+	const uchar *data = peak_file->file.map(0, size);
+	if (!data)
+		return nullptr;
+
+	Header header;
+	std::memcpy(&header, data, sizeof(header));
+	if (std::memcmp(header.magic, PEAK_FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != PEAK_FILE_VERSION ||
+		header.channels <= 0 || header.sample_rate <= 0 || header.samples <= 0 || header.levels != level_count(header.samples))
+		return nullptr;
+
+	int64_t total_buckets = 0;
+	for (int level = 0; level < header.levels; level++) {
+		peak_file->level_offsets.push_back(total_buckets);
+		total_buckets += level_buckets(header.samples, level) * header.channels;
+	}
+	if (size != int64_t(sizeof(Header)) + total_buckets * int64_t(sizeof(AudioPeak)))
+		return nullptr;
+
+	peak_file->peaks = (const AudioPeak *) (data + sizeof(Header));
+	peak_file->channels = header.channels;
+	peak_file->sample_rate = header.sample_rate;
+	peak_file->samples = header.samples;
+	return peak_file;
+}
+
+// Get the buckets of a channel on one level
+const AudioPeak* AudioPeakFile::GetBuckets(int level, int channel, int64_t& count) const
+{
+	count = 0;
+	if (level < 0 || level >= Levels() || channel < 0 || channel >= channels)
+		return nullptr;
+
+	count = level_buckets(samples, level);
+	return peaks + level_offsets[level] + channel * count;
+}
+
+// Summarize a range of samples of a channel
+AudioPeak AudioPeakFile::Read(int channel, int64_t start_sample, int64_t end_sample) const
+{
+	AudioPeak result;
+	start_sample = std::max<int64_t>(0, start_sample);
+	end_sample = std::min(samples, end_sample);
+	if (channel < 0 || channel >= channels || end_sample <= start_sample)
+		return result;
+
+	// The coarsest level with at least 8 buckets in the range
+	const int64_t range = end_sample - start_sample;
+	int level = 0;
+	while (level + 1 < Levels() && range / (int64_t(BASE_BUCKET_SIZE) << (level + 1)) >= 8)
+		level++;
+
+	int64_t count = 0;
+	const AudioPeak *buckets = GetBuckets(level, channel, count);
+	const int64_t bucket_size = int64_t(BASE_BUCKET_SIZE) << level;
+	const int64_t first = start_sample / bucket_size;
+	const int64_t last = (end_sample - 1) / bucket_size;
+
+	double squared_sum = 0.0;
+	double absolute_sum = 0.0;
+	result.min = buckets[first].min;
+	result.max = buckets[first].max;
+	for (int64_t index = first; index <= last; index++) {
+		const AudioPeak& peak = buckets[index];
+		const int64_t bucket_start = index * bucket_size;
+		const int64_t overlap = std::min(end_sample, bucket_start + bucket_size) - std::max(start_sample, bucket_start);
+		result.min = std::min(result.min, peak.min);
+		result.max = std::max(result.max, peak.max);
+		squared_sum += double(peak.rms) * peak.rms * overlap;
+		absolute_sum += double(peak.average) * overlap;
+	}
+	result.rms = std::sqrt(squared_sum / range);
+	result.average = absolute_sum / range;
+	return result;
+}
@@ -0,0 +1,145 @@
+/**
+ * @file
+ * @brief Header file for AudioPeakFile class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_AUDIO_PEAK_FILE_H
+#define OPENSHOT_AUDIO_PEAK_FILE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <QFile>
+
+namespace openshot {
+
+	// Forward decl
+	class FFmpegReader;
+
+	/// The summary of the samples of one bucket (or range) of a channel
+	struct AudioPeak {
+		float min = 0.0; ///< The smallest sample value
+		float max = 0.0; ///< The largest sample value
+		float rms = 0.0; ///< The root mean square of the sample values
+		float average = 0.0; ///< The mean of the absolute sample values
+	};
+
+	/**
+	 * @brief This class writes and reads the peak file of an audio source (a multi-resolution summary of its samples)
+	 *
+	 * Drawing the waveform of a file at any zoom level only needs the min/max/RMS of each pixel's samples, but
+	 * decoding the audio again for each zoom level (and for each file of a project, whenever it's opened) is
+	 * slow. A peak file summarizes each channel once, in buckets of BASE_BUCKET_SIZE samples, and then in
+	 * buckets of twice as many samples on each level above (until a single bucket covers the whole file). The
+	 * file is memory-mapped, so a range of samples is summarized from the few buckets of the coarsest level
+	 * which still resolves it, i.e. in O(visible buckets) instead of O(samples).
+	 *
+	 * Peak files are named after the path, size and modification time of their source (see GetPath), so a
+	 * changed file gets a new peak file. openshot::AudioWaveformer uses them when Settings::AUDIO_PEAK_PATH
+	 * is set.
+	 *
+	 * \code
+	 * std::string peak_path = AudioPeakFile::GetPath("/home/user/.openshot_qt/peaks", "piano.wav");
+	 * std::shared_ptr<AudioPeakFile> peaks = AudioPeakFile::Open(peak_path);
+	 * if (!peaks && AudioPeakFile::Create(&reader, peak_path))
+	 *     peaks = AudioPeakFile::Open(peak_path);
+	 *
+	 * // Summarize the first second of the left channel
+	 * AudioPeak peak = peaks->Read(0, 0, peaks->SampleRate());
+	 * \endcode
+	 */
+	class AudioPeakFile {
+	public:
+		/// The number of samples of each bucket of the finest level
+		static constexpr int BASE_BUCKET_SIZE = 256;
+
+	private:
+		/// The header at the start of a peak file (followed by the buckets of each level, channel by channel)
+		struct Header {
+			char magic[8];
+			int32_t version;
+			int32_t channels;
+			int32_t sample_rate;
+			int32_t levels;
+			int64_t samples;
+		};
+
+		QFile file;
+		const AudioPeak *peaks; ///< The mapped buckets
+		int channels;
+		int sample_rate;
+		int64_t samples;
+		std::vector<int64_t> level_offsets; ///< The index of the first bucket of each level
+
+		/// Constructor (use Open)
+		AudioPeakFile(const std::string& path);
+
+		/// Get the number of buckets of each channel of a level
+		static int64_t level_buckets(int64_t samples, int level);
+
+		/// Get the number of levels of a file
+		static int level_count(int64_t samples);
+
+	public:
+		/// Don't allow the user to copy or assign a peak file
+		AudioPeakFile(AudioPeakFile const&) = delete;
+		AudioPeakFile & operator=(AudioPeakFile const&) = delete;
+
+		/// @brief Get the path of the peak file of a media file (named after its path, size and modification time)
+		/// @returns The path, or an empty string if the media file doesn't exist
+		/// @param directory The directory of the peak files
+		/// @param media_path The path of the media file
+		static std::string GetPath(const std::string& directory, const std::string& media_path);
+
+		/// @brief Decode the audio stream of a reader, and write its peak file
+		/// @returns false if the reader has no audio, or the file can't be written
+		/// @param reader The reader (which must be open)
+		/// @param path The path of the peak file
+		static bool Create(openshot::FFmpegReader* reader, const std::string& path);
+
+		/// @brief Map a peak file
+		/// @returns The peak file, or nullptr if it doesn't exist (or is not a valid peak file)
+		/// @param path The path of the peak file
+		static std::shared_ptr<AudioPeakFile> Open(const std::string& path);
+
+		/// Get the number of channels
+		int Channels() const { return channels; };
+
+		/// Get the sample rate of the source
+		int SampleRate() const { return sample_rate; };
+
+		/// Get the number of samples of each channel
+		int64_t Samples() const { return samples; };
+
+		/// Get the number of levels
+		int Levels() const { return (int) level_offsets.size(); };
+
+		/// @brief Get the buckets of a channel on one level
+		/// @param level The level (0 = BASE_BUCKET_SIZE samples per bucket, each level above doubles that)
+		/// @param channel The channel
+		/// @param count The number of buckets
+		const AudioPeak* GetBuckets(int level, int channel, int64_t& count) const;
+
+		/// @brief Summarize a range of samples of a channel
+		///
+		/// The range is read from the coarsest level with at least 8 buckets in the range, and the buckets at
+		/// the edges of the range are weighted by how much of them is in the range (their min and max are used
+		/// as a whole).
+		/// @param channel The channel
+		/// @param start_sample The first sample
+		/// @param end_sample The sample after the last one
+		AudioPeak Read(int channel, int64_t start_sample, int64_t end_sample) const;
+	};
+
+}
+
+#endif
@@ -11,6 +11,8 @@
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
 #include "AudioReaderSource.h"
+#include "AudioRingBuffer.h"
+#include "CacheBase.h"
 #include "Exceptions.h"
 #include "Frame.h"
 
@@ -20,8 +22,7 @@ using namespace openshot;
 
 // Constructor that reads samples from a reader
 AudioReaderSource::AudioReaderSource(ReaderBase *audio_reader, int64_t starting_frame_number)
-	: reader(audio_reader), frame_position(starting_frame_number), videoCache(NULL), frame(NULL),
-      sample_position(0), speed(1), stream_position(0) {
+	: stream_position(0), frame_position(starting_frame_number), speed(1), reader(audio_reader), videoCache(NULL) {
 }
 
 // Destructor
@@ -33,63 +34,36 @@ AudioReaderSource::~AudioReaderSource()
 void AudioReaderSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& info)
 {
 	if (info.numSamples > 0) {
-	    int remaining_samples = info.numSamples;
-	    int remaining_position = info.startSample;
-
 		// Pause and fill buffer with silence (wait for pre-roll)
-		if (speed != 1 || !videoCache->isReady()) {
+		if (speed != 1 || !videoCache || !videoCache->isReady()) {
 			info.buffer->clear();
 			return;
 		}
 
-        while (remaining_samples > 0) {
-
-            try {
-                // Get current frame object
-                if (reader) {
-                    frame = reader->GetFrame(frame_position);
-                }
-            }
-            catch (const ReaderClosed & e) { }
-            catch (const OutOfBoundsFrame & e) { }
-
-            // Get audio samples
-            if (reader && frame) {
-                if (sample_position + remaining_samples <= frame->GetAudioSamplesCount()) {
-                    // Success, we have enough samples
-                    for (int channel = 0; channel < frame->GetAudioChannelsCount(); channel++) {
-                        if (channel < info.buffer->getNumChannels()) {
-                            info.buffer->addFrom(channel, remaining_position, *frame->GetAudioSampleBuffer(),
-                                                 channel, sample_position, remaining_samples);
-                        }
-                    }
-                    sample_position += remaining_samples;
-                    remaining_position += remaining_samples;
-                    remaining_samples = 0;
+		// Copy the queued audio (the rest of the block is silent, if the renderer is behind)
+		AudioRingBuffer *ring = videoCache->getAudioRing();
+		info.buffer->clear(info.startSample, info.numSamples);
+		ring->Read(*info.buffer, info.startSample, info.numSamples);
+		frame_position = ring->CurrentFrame();
+	}
+}
 
-                } else if (sample_position + remaining_samples > frame->GetAudioSamplesCount()) {
-                    // Not enough samples, take what we can
-                    int amount_to_copy = frame->GetAudioSamplesCount() - sample_position;
-                    for (int channel = 0; channel < frame->GetAudioChannelsCount(); channel++) {
-                        if (channel < info.buffer->getNumChannels()) {
-                            info.buffer->addFrom(channel, remaining_position, *frame->GetAudioSampleBuffer(), channel,
-                                                 sample_position, amount_to_copy);
-                        }
-                    }
-                    sample_position += amount_to_copy;
-                    remaining_position += amount_to_copy;
-                    remaining_samples -= amount_to_copy;
-                }
+// Seek to a specific frame
+void AudioReaderSource::Seek(int64_t new_position)
+{
+	frame_position = new_position;
 
-                // Increment frame position (if samples are all used up)
-                if (sample_position == frame->GetAudioSamplesCount()) {
-                    frame_position += speed;
-                    sample_position = 0; // reset for new frame
-                }
+	// Restart the queued audio at the new frame
+	if (videoCache)
+		videoCache->getAudioRing()->Reset(new_position);
+}
 
-            }
-		}
-	}
+// Return the current frame object (if cached)
+std::shared_ptr<Frame> AudioReaderSource::getFrame() const
+{
+	if (reader && reader->GetCache())
+		return reader->GetCache()->GetFrame(frame_position);
+	return std::shared_ptr<Frame>();
 }
 
 // Prepare to play this audio source
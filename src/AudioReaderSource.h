@@ -26,7 +26,9 @@ namespace openshot
 	/**
 	 * @brief This class is used to expose any ReaderBase derived class as an AudioSource in JUCE.
 	 *
-	 * This allows any reader to play audio through JUCE (our audio framework).
+	 * This allows any reader to play audio through JUCE (our audio framework). The audio is rendered
+	 * ahead by openshot::VideoCacheThread into an openshot::AudioRingBuffer, so the audio device thread
+	 * only copies samples (and never waits on the reader).
 	 */
 	class AudioReaderSource : public juce::PositionableAudioSource
 	{
@@ -36,9 +38,7 @@ namespace openshot
 		int speed;          /// The speed and direction to playback a reader (1=normal, 2=fast, 3=faster, -1=rewind, etc...)
 
 		ReaderBase *reader; /// The reader to pull samples from
-		std::shared_ptr<Frame> frame; /// The current frame object that is being read
-		int64_t sample_position; /// The position of the current frame's audio buffer
-        openshot::VideoCacheThread *videoCache; /// The cache thread (for pre-roll checking)
+        openshot::VideoCacheThread *videoCache; /// The cache thread (for pre-roll checking, and which queues the rendered audio)
 
 	public:
 
@@ -77,8 +77,8 @@ namespace openshot
 		/// @param shouldLoop Determines if the audio source should repeat when it reaches the end
 		void setLooping (bool shouldLoop) {  };
 
-	    /// Return the current frame object
-	    std::shared_ptr<Frame> getFrame() const { return frame; }
+	    /// Return the current frame object (if cached)
+	    std::shared_ptr<Frame> getFrame() const;
 
 	    /// Set Speed (The speed and direction to playback a reader (1=normal, 2=fast, 3=faster, -1=rewind, etc...)
 	    void setSpeed(int new_speed) { speed = new_speed; }
@@ -94,7 +94,7 @@ namespace openshot
 	    ReaderBase* Reader() const { return reader; }
 
 	    /// Seek to a specific frame
-	    void Seek(int64_t new_position) { frame_position = new_position; sample_position=0; }
+	    void Seek(int64_t new_position);
 
 	};
 
@@ -10,48 +10,130 @@
 //
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <utility>
+
 #include "AudioResampler.h"
+#include "Settings.h"
 
 using namespace std;
 using namespace openshot;
 
-// Default constructor, max frames to cache is 20 // resample_source(NULL), buffer_source(NULL), num_of_samples(0), new_num_of_samples(0), dest_ratio(0), source_ratio(0), resampled_buffer(NULL), isPrepared(false)
+namespace {
+	// The filters of each quality
+	struct QualityParameters {
+		int zero_crossings; ///< Zero crossings of the sinc on each side (at the full cutoff)
+		int max_half_taps; ///< The longest filters (for large ratios), which is also the delay of the output
+		int phases; ///< Fractions of a sample
+		double kaiser_beta; ///< Shape of the window (higher = less ripple, wider transition)
+		double rolloff; ///< Cutoff, as a fraction of the Nyquist frequency
+		bool interpolate; ///< Interpolate between phases
+	};
+
+	const QualityParameters& quality_parameters(ResampleQuality quality) {
+		static const QualityParameters draft = {4, 32, 64, 5.0, 0.90, false};
+		static const QualityParameters normal = {12, 64, 256, 8.0, 0.94, true};
+		static const QualityParameters high = {32, 128, 1024, 10.0, 0.97, true};
+		switch (quality) {
+			case RESAMPLE_QUALITY_DRAFT: return draft;
+			case RESAMPLE_QUALITY_HIGH: return high;
+			default: return normal;
+		}
+	}
+
+	// The cutoffs of the shared filter banks are rounded down to steps of 1/64th of the Nyquist frequency
+	const int CUTOFF_STEPS = 64;
+
+	// Zeroth order modified Bessel function of the first kind (for the Kaiser window)
+	double bessel_i0(double x) {
+		double sum = 1.0;
+		double term = 1.0;
+		for (int k = 1; k < 50; k++) {
+			term *= (x / (2.0 * k)) * (x / (2.0 * k));
+			sum += term;
+			if (term < sum * 1e-12)
+				break;
+		}
+		return sum;
+	}
+}
+
+// Get the (shared) filter bank of a quality and a resampling ratio
+std::shared_ptr<const ResamplerFilterBank> ResamplerFilterBank::Get(ResampleQuality quality, double ratio)
+{
+	// Speeding up (more than 1 input sample per output sample) needs a lower cutoff, to prevent aliasing
+	const int cutoff_step = std::max(1, std::min(CUTOFF_STEPS, int(std::floor(CUTOFF_STEPS / std::max(ratio, 1.0)))));
+
+	static std::mutex banksMutex;
+	static std::map<std::pair<int, int>, std::shared_ptr<const ResamplerFilterBank>> banks;
+	const std::lock_guard<std::mutex> lock(banksMutex);
+	std::shared_ptr<const ResamplerFilterBank>& cached = banks[std::make_pair(int(quality), cutoff_step)];
+	if (cached)
+		return cached;
+
+	// Longer filters for lower cutoffs (to keep the same number of zero crossings, up to the max length)
+	const QualityParameters& parameters = quality_parameters(quality);
+	const double cutoff = parameters.rolloff * cutoff_step / CUTOFF_STEPS;
+	auto bank = std::make_shared<ResamplerFilterBank>();
+	bank->half_taps = std::min(parameters.max_half_taps, int(std::ceil(parameters.zero_crossings / cutoff)));
+	bank->taps = bank->half_taps * 2;
+	bank->phases = parameters.phases;
+	bank->interpolate = parameters.interpolate;
+	bank->coefficients.resize(size_t(bank->phases + 1) * bank->taps);
+
+	// Kaiser windowed sinc, for each fraction of a sample (normalized to a gain of 1.0)
+	const double window_norm = bessel_i0(parameters.kaiser_beta);
+	for (int phase = 0; phase <= bank->phases; phase++) {
+		const double fraction = double(phase) / bank->phases;
+		float *coefficients = &bank->coefficients[size_t(phase) * bank->taps];
+		double sum = 0.0;
+		for (int tap = 0; tap < bank->taps; tap++) {
+			// Distance of this input sample from the output sample
+			const double t = (tap - (bank->half_taps - 1)) - fraction;
+			const double x = M_PI * cutoff * t;
+			const double sinc = (std::fabs(x) < 1e-9) ? 1.0 : std::sin(x) / x;
+			const double w = t / bank->half_taps;
+			const double window = (std::fabs(w) >= 1.0) ? 0.0
+				: bessel_i0(parameters.kaiser_beta * std::sqrt(1.0 - w * w)) / window_norm;
+			coefficients[tap] = float(cutoff * sinc * window);
+			sum += coefficients[tap];
+		}
+		for (int tap = 0; tap < bank->taps; tap++)
+			coefficients[tap] = float(coefficients[tap] / sum);
+	}
+
+	cached = bank;
+	return cached;
+}
+
+// Default constructor
 AudioResampler::AudioResampler(int numChannels)
 {
 	buffer = NULL;
-	resample_source = NULL;
-	buffer_source = NULL;
+	num_channels = numChannels;
 	num_of_samples = 0;
 	new_num_of_samples = 0;
-	dest_ratio = 0;
-	source_ratio = 0;
-	resampled_buffer = NULL;
-	isPrepared = false;
-
-	// Init buffer source
-	buffer_source = new AudioBufferSource(buffer);
-
-	// Init resampling source
-	resample_source = new juce::ResamplingAudioSource(buffer_source, false, numChannels);
+	dest_ratio = 1.0;
+	source_ratio = 1.0;
+	position = 0.0;
+	quality = ResampleQuality(std::max(0, std::min(2, Settings::Instance()->AUDIO_RESAMPLE_QUALITY)));
 
 	// Init resampled buffer
-	resampled_buffer = new juce::AudioBuffer<float>(2, 1);
+	resampled_buffer = new juce::AudioBuffer<float>(num_channels, 1);
 	resampled_buffer->clear();
 
-	// Init callback buffer
-	resample_callback_buffer.buffer = resampled_buffer;
-	resample_callback_buffer.numSamples = 1;
-	resample_callback_buffer.startSample = 0;
+	// Init filters and history
+	update_filters();
+	Reset();
 }
 
 // Descructor
 AudioResampler::~AudioResampler()
 {
 	// Clean up
-	if (buffer_source)
-		delete buffer_source;
-	if (resample_source)
-		delete resample_source;
 	if (resampled_buffer)
 		delete resampled_buffer;
 }
@@ -74,40 +156,123 @@ void AudioResampler::SetBuffer(juce::AudioBuffer<float> *new_buffer, double samp
 // Sets the audio buffer and key settings
 void AudioResampler::SetBuffer(juce::AudioBuffer<float> *new_buffer, double ratio)
 {
-	// Update buffer & buffer source
+	if (ratio <= 0.0)
+		ratio = 1.0;
+
+	// Update buffer (and restart, if the # of channels changed)
 	buffer = new_buffer;
-	buffer_source->setBuffer(buffer);
+	if (buffer->getNumChannels() != num_channels) {
+		num_channels = buffer->getNumChannels();
+		Reset();
+	}
 
 	// Set the sample ratio (the ratio of sample rate change)
 	source_ratio = ratio;
 	dest_ratio = 1.0 / ratio;
 	num_of_samples = buffer->getNumSamples();
 	new_num_of_samples = round(num_of_samples * dest_ratio);
-
-	// Set resample ratio
-	resample_source->setResamplingRatio(source_ratio);
-
-	// Prepare to play resample source
-	if (!isPrepared)
-	{
-		// Prepare to play the audio sources (and set the # of samples per chunk to a little more than expected)
-		resample_source->prepareToPlay(num_of_samples + 10, 0);
-		isPrepared = true;
-	}
+	update_filters();
 
 	// Resize buffer for the newly resampled data
-	resampled_buffer->setSize(buffer->getNumChannels(), new_num_of_samples, true, true, true);
-	resample_callback_buffer.numSamples = new_num_of_samples;
-	resample_callback_buffer.startSample = 0;
-	resample_callback_buffer.clearActiveBufferRegion();
+	resampled_buffer->setSize(num_channels, new_num_of_samples, true, true, true);
+}
+
+// Get the filters for the current ratio
+void AudioResampler::update_filters()
+{
+	filters = ResamplerFilterBank::Get(quality, source_ratio);
 }
 
 // Get the resampled audio buffer
 juce::AudioBuffer<float>* AudioResampler::GetResampledBuffer()
 {
-	// Resample the current frame's audio buffer (into the temp callback buffer)
-	resample_source->getNextAudioBlock(resample_callback_buffer);
+	if (!buffer)
+		return resampled_buffer;
+
+	const ResamplerFilterBank& bank = *filters;
+	const int max_half_taps = quality_parameters(quality).max_half_taps;
+	const int channels = num_channels;
+	const int output_samples = new_num_of_samples;
+
+	// Append the new samples to the history of each channel
+	for (int channel = 0; channel < channels; channel++) {
+		const float *input = buffer->getReadPointer(channel);
+		history[channel].insert(history[channel].end(), input, input + num_of_samples);
+	}
+
+	// Samples past the end of the input are silent (only if the ratio doesn't match the # of samples)
+	if (output_samples > 0) {
+		const double last_position = position + (output_samples - 1) * source_ratio;
+		const size_t needed = size_t(last_position) + bank.half_taps + 1;
+		for (auto& samples : history)
+			if (samples.size() < needed)
+				samples.resize(needed, 0.0f);
+	}
+
+	// Filter all channels at each output position (looking up the phase once)
+	std::vector<float *> outputs(channels);
+	for (int channel = 0; channel < channels; channel++)
+		outputs[channel] = resampled_buffer->getWritePointer(channel);
+	const int taps = bank.taps;
+	for (int sample = 0; sample < output_samples; sample++) {
+		const double center = position + sample * source_ratio;
+		const int64_t index = int64_t(center);
+		const double phase_position = (center - index) * bank.phases;
+		int phase = int(phase_position);
+		const float weight = float(phase_position - phase);
+		if (!bank.interpolate && weight >= 0.5f)
+			phase++;
+
+		const float * __restrict h0 = &bank.coefficients[size_t(phase) * taps];
+		const float * __restrict h1 = bank.interpolate ? h0 + taps : h0;
+		const int64_t first = index - bank.half_taps + 1;
+		for (int channel = 0; channel < channels; channel++) {
+			const float * __restrict x = history[channel].data() + first;
+			float sum0 = 0.0f;
+			float sum1 = 0.0f;
+			#pragma omp simd reduction(+:sum0,sum1)
+			for (int tap = 0; tap < taps; tap++) {
+				sum0 += x[tap] * h0[tap];
+				sum1 += x[tap] * h1[tap];
+			}
+			outputs[channel][sample] = sum0 + weight * (sum1 - sum0);
+		}
+	}
+	position += output_samples * source_ratio;
+
+	// Drop the samples which are no longer needed (keeping enough left context for the longest filters)
+	int64_t drop = int64_t(position) - max_half_taps + 1;
+
+	// Skip ahead, if more samples were added than read (so the delay of the output can't grow)
+	const int64_t pending = int64_t(history.empty() ? 0 : history[0].size()) - int64_t(position);
+	const int64_t max_pending = int64_t(num_of_samples) * 2 + max_half_taps * 2;
+	if (pending > max_pending) {
+		position += pending - max_pending;
+		drop += pending - max_pending;
+	}
+	if (drop > 0) {
+		for (auto& samples : history)
+			samples.erase(samples.begin(), samples.begin() + std::min<int64_t>(drop, samples.size()));
+		position -= drop;
+	}
 
 	// Return buffer pointer to this newly resampled buffer
 	return resampled_buffer;
 }
+
+// Forget the previous samples
+void AudioResampler::Reset()
+{
+	// Start with silence: the left context of the longest filters, and as many samples of delay
+	const int max_half_taps = quality_parameters(quality).max_half_taps;
+	history.assign(std::max(num_channels, 0), std::vector<float>(max_half_taps * 2, 0.0f));
+	position = max_half_taps - 1;
+}
+
+// Set the quality of the filters
+void AudioResampler::SetQuality(ResampleQuality new_quality)
+{
+	quality = new_quality;
+	update_filters();
+	Reset();
+}
@@ -13,33 +13,62 @@
 #ifndef OPENSHOT_RESAMPLER_H
 #define OPENSHOT_RESAMPLER_H
 
-#include "AudioBufferSource.h"
+#include <memory>
+#include <vector>
+
+#include "Enums.h"
 
 #include <AppConfig.h>
 #include <juce_audio_basics/juce_audio_basics.h>
-#include <juce_audio_devices/juce_audio_devices.h>
 
 namespace openshot {
 
+	/**
+	 * @brief The windowed-sinc filters of a polyphase resampler (for one cutoff and quality)
+	 *
+	 * Each phase is the filter for one fraction of a sample (phases + 1 of them, so neighbouring
+	 * phases can be interpolated), and has taps coefficients. The banks are shared by all resamplers
+	 * (see Get()), since they only depend on the quality and the cutoff frequency.
+	 */
+	struct ResamplerFilterBank {
+		int half_taps; ///< The number of input samples on each side of an output sample
+		int taps; ///< The number of coefficients of each phase (2 * half_taps)
+		int phases; ///< The number of phases (fractions of a sample)
+		bool interpolate; ///< Interpolate between the two nearest phases (instead of using the nearest one)
+		std::vector<float> coefficients; ///< (phases + 1) * taps coefficients
+
+		/// @brief Get the (shared) filter bank of a quality and a resampling ratio
+		/// @param quality The quality of the filters
+		/// @param ratio The number of input samples per output sample (> 1.0 needs a lower cutoff, to prevent aliasing)
+		static std::shared_ptr<const ResamplerFilterBank> Get(openshot::ResampleQuality quality, double ratio);
+	};
+
 	/**
 	 * @brief This class is used to resample audio data for many sequential frames.
 	 *
-	 * It maintains some data from the last call to GetResampledBuffer(), so there
-	 * are no pops and clicks between frames.
+	 * It is a polyphase windowed-sinc resampler, which keeps the last input samples of each call to
+	 * GetResampledBuffer(), so there are no pops and clicks between frames. The output is delayed by
+	 * the half length of its filters. All channels are filtered together, with the phase of each output
+	 * sample looked up once (and the taps of each channel vectorized). The quality (length of the filters)
+	 * is set by Settings::AUDIO_RESAMPLE_QUALITY, or SetQuality().
 	 */
 	class AudioResampler {
 	private:
 		juce::AudioBuffer<float> *buffer;
 		juce::AudioBuffer<float> *resampled_buffer;
-		openshot::AudioBufferSource *buffer_source;
-		juce::ResamplingAudioSource *resample_source;
-		juce::AudioSourceChannelInfo resample_callback_buffer;
+		std::vector<std::vector<float>> history; ///< The input samples of each channel which are still needed (with left context)
+		std::shared_ptr<const ResamplerFilterBank> filters;
+		openshot::ResampleQuality quality;
+		double position; ///< The position of the next output sample in history (in input samples)
 
+		int num_channels;
 		int num_of_samples;
 		int new_num_of_samples;
 		double dest_ratio;
 		double source_ratio;
-		bool isPrepared;
+
+		/// Get the filters for the current ratio (and restart the history, if their length changed)
+		void update_filters();
 
 	public:
 		/// Default constructor
@@ -61,6 +90,15 @@ namespace openshot {
 
 		/// Get the resampled audio buffer
 		juce::AudioBuffer<float>* GetResampledBuffer();
+
+		/// Forget the previous samples (i.e. after a seek), so unrelated audio is not interpolated
+		void Reset();
+
+		/// Get the quality of the filters
+		openshot::ResampleQuality Quality() const { return quality; }
+
+		/// Set the quality of the filters (this forgets the previous samples)
+		void SetQuality(openshot::ResampleQuality new_quality);
 	};
 
 }
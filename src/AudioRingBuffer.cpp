@@ -0,0 +1,123 @@
+/**
+ * @file
+ * @brief Source file for AudioRingBuffer class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+
+#include "AudioRingBuffer.h"
+
+using namespace openshot;
+
+// Constructor
+AudioRingBuffer::AudioRingBuffer(int number_of_frames)
+	: slots(std::max(1, number_of_frames)), write_index(0), read_index(0), generation(0), start_frame(1),
+	  current_frame(1), consumed(false), producer_generation(-1), producer_frame(1), read_offset(0)
+{
+}
+
+// Start a new generation at a frame
+void AudioRingBuffer::Reset(int64_t frame_number, bool force)
+{
+	// Nothing was played since the last reset (i.e. seeking to the same frame while paused)
+	const bool was_consumed = consumed.exchange(false);
+	if (!force && frame_number == start_frame.load(std::memory_order_relaxed) && !was_consumed)
+		return;
+
+	start_frame.store(frame_number, std::memory_order_relaxed);
+	current_frame.store(frame_number, std::memory_order_relaxed);
+	generation.fetch_add(1, std::memory_order_release);
+}
+
+// Get the next frame the producer should push
+bool AudioRingBuffer::NextFrame(int64_t& frame_number)
+{
+	// Restart at the new frame (after a reset)
+	const int64_t current_generation = generation.load(std::memory_order_acquire);
+	if (current_generation != producer_generation) {
+		producer_generation = current_generation;
+		producer_frame = start_frame.load(std::memory_order_relaxed);
+	}
+
+	// Queue is full
+	if (write_index.load(std::memory_order_relaxed) - read_index.load(std::memory_order_acquire) >= (int64_t) slots.size())
+		return false;
+
+	frame_number = producer_frame;
+	return true;
+}
+
+// Copy the audio of a frame into the queue
+void AudioRingBuffer::Push(int64_t frame_number, const juce::AudioBuffer<float>& samples, int sample_count)
+{
+	const int64_t index = write_index.load(std::memory_order_relaxed);
+	Slot& slot = slots[index % slots.size()];
+
+	// Re-use the slot's memory (it only grows)
+	sample_count = std::max(0, std::min(sample_count, samples.getNumSamples()));
+	slot.samples.setSize(samples.getNumChannels(), sample_count, false, false, true);
+	for (int channel = 0; channel < samples.getNumChannels(); channel++)
+		slot.samples.copyFrom(channel, 0, samples, channel, 0, sample_count);
+	slot.sample_count = sample_count;
+	slot.frame_number = frame_number;
+	slot.generation = producer_generation;
+
+	// Publish the slot to the consumer
+	write_index.store(index + 1, std::memory_order_release);
+	producer_frame = frame_number + 1;
+}
+
+// Add queued samples to a buffer
+int AudioRingBuffer::Read(juce::AudioBuffer<float>& buffer, int start_sample, int num_samples)
+{
+	const int64_t current_generation = generation.load(std::memory_order_acquire);
+	int copied = 0;
+
+	while (copied < num_samples) {
+		const int64_t index = read_index.load(std::memory_order_relaxed);
+		if (index == write_index.load(std::memory_order_acquire))
+			// Queue is empty
+			break;
+
+		// Skip slots from before the last reset
+		Slot& slot = slots[index % slots.size()];
+		if (slot.generation != current_generation) {
+			read_offset = 0;
+			read_index.store(index + 1, std::memory_order_release);
+			continue;
+		}
+
+		// Copy as many samples as possible from this slot
+		const int amount = std::min(slot.sample_count - read_offset, num_samples - copied);
+		const int channels = std::min(buffer.getNumChannels(), slot.samples.getNumChannels());
+		for (int channel = 0; channel < channels; channel++)
+			buffer.addFrom(channel, start_sample + copied, slot.samples, channel, read_offset, amount);
+		current_frame.store(slot.frame_number, std::memory_order_relaxed);
+		read_offset += amount;
+		copied += amount;
+
+		// Release the slot to the producer (once all samples are used up)
+		if (read_offset >= slot.sample_count) {
+			read_offset = 0;
+			read_index.store(index + 1, std::memory_order_release);
+		}
+	}
+
+	if (copied > 0)
+		consumed.store(true, std::memory_order_relaxed);
+
+	return copied;
+}
+
+// Get the number of queued frames
+int64_t AudioRingBuffer::Count() const
+{
+	return write_index.load(std::memory_order_acquire) - read_index.load(std::memory_order_acquire);
+}
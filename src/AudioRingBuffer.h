@@ -0,0 +1,111 @@
+/**
+ * @file
+ * @brief Header file for AudioRingBuffer class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_AUDIO_RING_BUFFER_H
+#define OPENSHOT_AUDIO_RING_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <AppConfig.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+
+namespace openshot
+{
+	/**
+	 * @brief A lock-free queue of rendered audio, between a single producer and a single (real-time) consumer.
+	 *
+	 * The producer (openshot::VideoCacheThread) renders frames in order, and copies their audio samples into
+	 * a fixed number of slots. The consumer (openshot::AudioReaderSource, on the audio device thread) only copies
+	 * samples out of the slots, so it never waits on a mutex, a reader, or a memory allocation.
+	 *
+	 * Seeking (from any thread) starts a new generation. The producer restarts at the new frame, and the
+	 * consumer skips any slots of an older generation.
+	 *
+	 * \code
+	 * // Producer
+	 * int64_t frame_number;
+	 * while (ring.NextFrame(frame_number)) {
+	 *     std::shared_ptr<Frame> f = reader->GetFrame(frame_number);
+	 *     ring.Push(frame_number, *f->GetAudioSampleBuffer(), f->GetAudioSamplesCount());
+	 * }
+	 *
+	 * // Consumer
+	 * int copied = ring.Read(*info.buffer, info.startSample, info.numSamples);
+	 * \endcode
+	 */
+	class AudioRingBuffer
+	{
+	private:
+		/// The audio samples of a single frame
+		struct Slot
+		{
+			juce::AudioBuffer<float> samples;
+			int sample_count = 0;
+			int64_t frame_number = 0;
+			int64_t generation = 0;
+		};
+
+		std::vector<Slot> slots;
+		std::atomic<int64_t> write_index; ///< Number of slots pushed (only changed by the producer)
+		std::atomic<int64_t> read_index; ///< Number of slots read (only changed by the consumer)
+		std::atomic<int64_t> generation; ///< Incremented by every Reset()
+		std::atomic<int64_t> start_frame; ///< The first frame of the current generation
+		std::atomic<int64_t> current_frame; ///< The frame the consumer is reading
+		std::atomic<bool> consumed; ///< Samples were read since the last Reset()
+
+		// Producer state
+		int64_t producer_generation;
+		int64_t producer_frame;
+
+		// Consumer state
+		int read_offset;
+
+	public:
+		/// @brief Constructor
+		/// @param number_of_frames The number of frames (of audio) which can be queued
+		AudioRingBuffer(int number_of_frames = 16);
+
+		/// @brief Start a new generation at a frame (i.e. when seeking). This can be called from any thread.
+		/// Resetting to the same frame again (with no samples read since) is ignored, unless forced.
+		/// @param frame_number The next frame to play
+		/// @param force Always drop the queued samples (i.e. when they were queued at another sample rate)
+		void Reset(int64_t frame_number, bool force = false);
+
+		/// @brief Get the next frame the producer should push (only called by the producer)
+		/// @returns False if the queue is full
+		/// @param frame_number Receives the frame number
+		bool NextFrame(int64_t& frame_number);
+
+		/// @brief Copy the audio of a frame into the queue (only called by the producer, after NextFrame())
+		/// @param frame_number The frame number (returned by NextFrame())
+		/// @param samples The audio samples of the frame
+		/// @param sample_count The number of samples to copy
+		void Push(int64_t frame_number, const juce::AudioBuffer<float>& samples, int sample_count);
+
+		/// @brief Add queued samples to a buffer (only called by the consumer). This never blocks.
+		/// @returns The number of samples added (less than num_samples when the queue runs empty)
+		/// @param buffer The buffer to add samples to
+		/// @param start_sample The first sample of the buffer to add to
+		/// @param num_samples The number of samples needed
+		int Read(juce::AudioBuffer<float>& buffer, int start_sample, int num_samples);
+
+		/// Get the number of queued frames
+		int64_t Count() const;
+
+		/// Get the frame the consumer is reading
+		int64_t CurrentFrame() const { return current_frame.load(std::memory_order_relaxed); }
+	};
+}
+
+#endif // OPENSHOT_AUDIO_RING_BUFFER_H
@@ -0,0 +1,159 @@
+/**
+ * @file
+ * @brief Source file for AudioTimeStretcher class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "AudioTimeStretcher.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace openshot;
+
+// Constructor
+AudioTimeStretcher::AudioTimeStretcher(int channels, int window_size) :
+	channels(std::max(channels, 1)), window_size(std::max(window_size / 2, 16) * 2)
+{
+	hop_size = this->window_size / 2;
+	tolerance = this->window_size / 4;
+
+	// A periodic Hann window (overlapping windows, half a window apart, add up to 1.0)
+	window.resize(this->window_size);
+	for (int index = 0; index < this->window_size; index++)
+		window[index] = 0.5f - 0.5f * std::cos(2.0 * M_PI * index / this->window_size);
+
+	input.resize(this->channels);
+	overlap.resize(this->channels);
+	output.resize(this->channels);
+	Reset();
+}
+
+// Forget all input and output, and start again with silence (as long as the look-ahead of a segment)
+void AudioTimeStretcher::Reset()
+{
+	for (int channel = 0; channel < channels; channel++) {
+		input[channel].clear();
+		overlap[channel].assign(hop_size, 0.0f);
+		output[channel].assign(window_size + tolerance, 0.0f);
+	}
+	input_start = 0;
+	analysis_position = 0.0;
+	previous_segment = -1;
+}
+
+// Find the position of the next segment (the one which best matches the continuation of the last segment)
+int64_t AudioTimeStretcher::find_segment(int64_t first, int64_t last)
+{
+	// Compare the mono mix of the samples (the same shift is used for every channel)
+	auto mono = [this](int64_t position) {
+		float sample = 0.0f;
+		for (int channel = 0; channel < channels; channel++)
+			sample += input[channel][position - input_start];
+		return sample;
+	};
+	std::vector<float> reference(hop_size);
+	for (int index = 0; index < hop_size; index++)
+		reference[index] = mono(previous_segment + hop_size + index);
+	std::vector<float> candidates(last - first + hop_size);
+	for (int64_t index = 0; index < (int64_t) candidates.size(); index++)
+		candidates[index] = mono(first + index);
+
+	// Normalized cross-correlation of each shift with the continuation of the last segment
+	int64_t best_position = first;
+	double best_score = -1e30;
+	for (int64_t position = first; position <= last; position++) {
+		const float *candidate = candidates.data() + (position - first);
+		double correlation = 0.0;
+		double energy = 0.0;
+		for (int index = 0; index < hop_size; index++) {
+			correlation += candidate[index] * reference[index];
+			energy += candidate[index] * candidate[index];
+		}
+		const double score = correlation / std::sqrt(energy + 1e-9);
+		if (score > best_score) {
+			best_score = score;
+			best_position = position;
+		}
+	}
+	return best_position;
+}
+
+// Add the next segment to the output
+bool AudioTimeStretcher::add_segment(double speed)
+{
+	// The last position with a whole segment of input
+	const int64_t latest = input_start + (int64_t) input[0].size() - window_size;
+	if (latest < input_start)
+		return false;
+
+	// Search around the nominal position (or take the latest segment, if the input is behind, i.e. when
+	// slowing down, so the output never runs dry)
+	const int64_t nominal_position = std::max(input_start, (int64_t) std::llround(analysis_position));
+	int64_t segment = std::min(nominal_position, latest);
+	if (previous_segment >= 0) {
+		const int64_t first = std::max(input_start, std::min(nominal_position, latest) - tolerance);
+		const int64_t last = std::min(nominal_position + tolerance, latest);
+		segment = find_segment(first, last);
+	}
+
+	// Overlap-add the first half of the segment to the second half of the last segment
+	for (int channel = 0; channel < channels; channel++) {
+		const float *samples = input[channel].data() + (segment - input_start);
+		std::vector<float> &channel_output = output[channel];
+		std::vector<float> &channel_overlap = overlap[channel];
+		for (int index = 0; index < hop_size; index++) {
+			channel_output.push_back(channel_overlap[index] + window[index] * samples[index]);
+			channel_overlap[index] = window[hop_size + index] * samples[hop_size + index];
+		}
+	}
+	previous_segment = segment;
+	analysis_position += hop_size * speed;
+
+	// Drop the input which no segment can use any more (in batches)
+	const int64_t keep = std::min((int64_t) std::llround(analysis_position) - tolerance, previous_segment);
+	if (keep - input_start > window_size * 4) {
+		for (int channel = 0; channel < channels; channel++)
+			input[channel].erase(input[channel].begin(), input[channel].begin() + (keep - input_start));
+		input_start = keep;
+	}
+	return true;
+}
+
+// Stretch the next source samples to an exact number of output samples
+void AudioTimeStretcher::Process(const juce::AudioBuffer<float>& source, int source_count, juce::AudioBuffer<float>& destination, int target_count)
+{
+	source_count = std::max(0, std::min(source_count, source.getNumSamples()));
+	if (target_count <= 0)
+		return;
+	const double speed = double(source_count) / target_count;
+
+	// Add the source samples to the input (missing channels are silent)
+	for (int channel = 0; channel < channels; channel++) {
+		if (channel < source.getNumChannels()) {
+			const float *samples = source.getReadPointer(channel);
+			input[channel].insert(input[channel].end(), samples, samples + source_count);
+		} else {
+			input[channel].resize(input[channel].size() + source_count, 0.0f);
+		}
+	}
+
+	// Add segments until there are enough output samples (or no input at all)
+	while ((int) output[0].size() < target_count && add_segment(speed)) {}
+
+	// Return the oldest output samples (with silence, if there are not enough yet)
+	const int available = std::min((int) output[0].size(), target_count);
+	for (int channel = 0; channel < std::min(channels, destination.getNumChannels()); channel++) {
+		destination.copyFrom(channel, 0, output[channel].data(), available);
+		if (available < target_count)
+			destination.clear(channel, available, target_count - available);
+	}
+	for (int channel = 0; channel < channels; channel++)
+		output[channel].erase(output[channel].begin(), output[channel].begin() + available);
+}
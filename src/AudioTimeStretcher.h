@@ -0,0 +1,83 @@
+/**
+ * @file
+ * @brief Header file for AudioTimeStretcher class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_AUDIO_TIME_STRETCHER_H
+#define OPENSHOT_AUDIO_TIME_STRETCHER_H
+
+#include <cstdint>
+#include <vector>
+
+#include <AppConfig.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+
+namespace openshot {
+
+	/**
+	 * @brief This class changes the speed of audio without changing its pitch (for many sequential frames)
+	 *
+	 * It uses WSOLA (waveform similarity overlap-add): the output is built from overlapping, windowed
+	 * segments of the input, taken at the speed of the audio. Each segment is shifted a little (within a
+	 * tolerance) to the position where it best matches the continuation of the previous segment, so the
+	 * waveforms line up and there are no phasing artifacts.
+	 *
+	 * The input and the output are kept between calls to Process(), so consecutive frames are stretched
+	 * as one continuous stream (even when the speed changes between frames). The output is delayed by
+	 * the look-ahead of a segment (1.25 windows, about 30 ms), which is filled with silence after Reset().
+	 *
+	 * \code
+	 * AudioTimeStretcher stretcher(2);
+	 * // Play 1470 source samples in 735 samples (twice the speed, at the same pitch)
+	 * stretcher.Process(source_buffer, 1470, output_buffer, 735);
+	 * \endcode
+	 */
+	class AudioTimeStretcher {
+	private:
+		int channels;
+		int window_size; ///< The length of each segment
+		int hop_size; ///< The distance between output segments (half a window)
+		int tolerance; ///< How far a segment can be shifted (to match the previous segment)
+		std::vector<float> window; ///< The Hann window of each segment
+
+		std::vector<std::vector<float>> input; ///< The input samples of each channel (not used yet)
+		int64_t input_start; ///< The position (in the input stream) of the first sample of input
+		double analysis_position; ///< The position (in the input stream) of the next segment (before it is shifted)
+		int64_t previous_segment; ///< The position (in the input stream) of the last segment (or -1)
+
+		std::vector<std::vector<float>> overlap; ///< The second half of the last windowed segment of each channel
+		std::vector<std::vector<float>> output; ///< The output samples of each channel (not returned yet)
+
+		/// Find the position (between first and last) of the next segment, which best matches the continuation of the last segment
+		int64_t find_segment(int64_t first, int64_t last);
+
+		/// Add the next segment to the output (returns false if there is not a whole segment of input yet)
+		bool add_segment(double speed);
+
+	public:
+		/// @brief Constructor
+		/// @param channels The number of audio channels
+		/// @param window_size The length of each segment (in samples)
+		AudioTimeStretcher(int channels = 2, int window_size = 1024);
+
+		/// Forget all input and output (i.e. after a seek), and start again with silence
+		void Reset();
+
+		/// @brief Stretch the next source samples to an exact number of output samples
+		/// @param source The source samples (of every channel)
+		/// @param source_count The number of source samples to use
+		/// @param destination Set to the output samples (it must hold at least target_count samples)
+		/// @param target_count The number of output samples (source_count / target_count is the speed)
+		void Process(const juce::AudioBuffer<float>& source, int source_count, juce::AudioBuffer<float>& destination, int target_count);
+	};
+
+}
+
+#endif
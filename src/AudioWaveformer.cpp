@@ -11,11 +11,49 @@
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
 #include "AudioWaveformer.h"
+#include "AudioPeakFile.h"
+#include "FFmpegReader.h"
+#include "OpenMPUtilities.h"
+#include "Settings.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <vector>
 
 
 using namespace std;
 using namespace openshot;
 
+// Compile the reduction kernel for several instruction sets, and let the loader pick the best one
+// for this CPU (this requires ifunc support, so other platforms use the compiler's baseline)
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__linux__) && defined(__has_attribute)
+    #if __has_attribute(target_clones)
+        #define WAVEFORM_KERNEL __attribute__((target_clones("avx2", "sse4.1", "default")))
+    #endif
+#endif
+#ifndef WAVEFORM_KERNEL
+    #define WAVEFORM_KERNEL
+#endif
+
+// Reduce a block of samples to their largest absolute value (and add their absolute values to a sum)
+WAVEFORM_KERNEL
+static float reduce_block(const float * __restrict samples, int sample_count, float& absolute_sum)
+{
+    float block_max = 0.0f;
+    float block_sum = 0.0f;
+
+    #pragma omp simd reduction(max:block_max) reduction(+:block_sum)
+    for (int s = 0; s < sample_count; s++) {
+        const float value = std::abs(samples[s]);
+        block_max = std::max(block_max, value);
+        block_sum += value;
+    }
+
+    absolute_sum += block_sum;
+    return block_max;
+}
+
 
 // Default constructor
 AudioWaveformer::AudioWaveformer(ReaderBase* new_reader) : reader(new_reader)
@@ -73,47 +111,54 @@ AudioWaveformData AudioWaveformer::ExtractSamples(int channel, int num_per_secon
             channel_count = reader->info.channels;
         }
 
-        for (auto f = 1; f <= reader->info.video_length; f++) {
-            // Get next frame
-            shared_ptr<openshot::Frame> frame = reader->GetFrame(f);
-
-            // Cache channels for this frame, to reduce # of calls to frame->GetAudioSamples
-            float* channels[channel_count];
-            for (auto channel_index = 0; channel_index < reader->info.channels; channel_index++) {
-                if (channel == channel_index || channel == -1) {
-                    channels[channel_index] = frame->GetAudioSamples(channel_index);
-                }
-            }
+        FFmpegReader *ffmpeg_reader = dynamic_cast<FFmpegReader*>(reader);
+        if (ffmpeg_reader && sample_divisor > 0 &&
+            ExtractPeakSamples(ffmpeg_reader, channel, sample_divisor, total_samples, data, samples_max)) {
+            // Summarized from the peak file (no decoding)
+        } else if (ffmpeg_reader && sample_divisor > 0) {
+            // Decode the audio stream directly (no video decoding, frames, or cache)
+            samples_max = ExtractStreamSamples(ffmpeg_reader, channel, sample_divisor, total_samples, data);
+        } else if (sample_divisor > 0) {
+            for (auto f = 1; f <= reader->info.video_length && extracted_index < total_samples; f++) {
+                // Get next frame
+                shared_ptr<openshot::Frame> frame = reader->GetFrame(f);
 
-            // Get sample value from a specific channel (or all channels)
-            for (auto s = 0; s < frame->GetAudioSamplesCount(); s++) {
+                // Cache channels for this frame, to reduce # of calls to frame->GetAudioSamples
+                std::vector<float*> channels(reader->info.channels, nullptr);
                 for (auto channel_index = 0; channel_index < reader->info.channels; channel_index++) {
                     if (channel == channel_index || channel == -1) {
-                        float *samples = channels[channel_index];
-                        float rms_sample_value = std::sqrt(samples[s] * samples[s]);
-
-                        // Accumulate sample averages
-                        chunk_squared_sum += rms_sample_value;
-                        chunk_max = std::max(chunk_max, rms_sample_value);
+                        channels[channel_index] = frame->GetAudioSamples(channel_index);
                     }
                 }
 
-                sample_index += 1;
+                // Reduce each run of samples (which belong to the same chunk) from a specific channel (or all channels)
+                const int frame_samples = frame->GetAudioSamplesCount();
+                int offset = 0;
+                while (offset < frame_samples && extracted_index < total_samples) {
+                    const int run = std::min(frame_samples - offset, sample_divisor - sample_index);
+                    for (auto channel_index = 0; channel_index < reader->info.channels; channel_index++) {
+                        if (channels[channel_index]) {
+                            chunk_max = std::max(chunk_max, reduce_block(channels[channel_index] + offset, run, chunk_squared_sum));
+                        }
+                    }
+                    sample_index += run;
+                    offset += run;
 
-                // Cut-off reached
-                if (sample_index % sample_divisor == 0) {
-                    float avg_squared_sum = chunk_squared_sum / (sample_divisor * channel_count);
-                    data.max_samples[extracted_index] = chunk_max;
-                    data.rms_samples[extracted_index] = avg_squared_sum;
-                    extracted_index++;
+                    // Cut-off reached
+                    if (sample_index == sample_divisor) {
+                        float avg_squared_sum = chunk_squared_sum / (sample_divisor * channel_count);
+                        data.max_samples[extracted_index] = chunk_max;
+                        data.rms_samples[extracted_index] = avg_squared_sum;
+                        extracted_index++;
 
-                    // Track max/min values
-                    samples_max = std::max(samples_max, chunk_max);
+                        // Track max/min values
+                        samples_max = std::max(samples_max, chunk_max);
 
-                    // reset sample total and index
-                    sample_index = 0;
-                    chunk_max = 0.0;
-                    chunk_squared_sum = 0.0;
+                        // reset sample total and index
+                        sample_index = 0;
+                        chunk_max = 0.0;
+                        chunk_squared_sum = 0.0;
+                    }
                 }
             }
         }
@@ -132,3 +177,128 @@ AudioWaveformData AudioWaveformer::ExtractSamples(int channel, int num_per_secon
 
     return data;
 }
+
+// Extract samples by decoding only the audio stream of a FFmpegReader
+float AudioWaveformer::ExtractStreamSamples(FFmpegReader* ffmpeg_reader, int channel, int sample_divisor,
+                                            int total_samples, AudioWaveformData& data) {
+    const int reader_channels = ffmpeg_reader->info.channels;
+    const int first_channel = (channel == -1) ? 0 : channel;
+    const int last_channel = (channel == -1) ? reader_channels - 1 : channel;
+    const int channel_count = last_channel - first_channel + 1;
+    if (first_channel < 0 || last_channel >= reader_channels)
+        return 0.0;
+
+    // Split long files into segments (of whole chunks), which are decoded in parallel
+    // (each segment seeks and decodes with its own decoder). Short files use 1 segment.
+    const int chunks_per_second = std::max(1, ffmpeg_reader->info.sample_rate / sample_divisor);
+    const int segments = std::max(1, std::min(OPEN_MP_NUM_PROCESSORS, total_samples / (chunks_per_second * 30)));
+    const int chunks_per_segment = (total_samples + segments - 1) / segments;
+
+    float samples_max = 0.0;
+    std::exception_ptr error;
+
+    #pragma omp parallel for schedule(dynamic) reduction(max:samples_max) if (segments > 1)
+    for (int segment = 0; segment < segments; segment++) {
+        const int first_chunk = segment * chunks_per_segment;
+        const int end_chunk = std::min(total_samples, first_chunk + chunks_per_segment);
+        if (first_chunk >= end_chunk)
+            continue;
+
+        // Current chunk (of this segment)
+        int64_t chunk_index = -1;
+        int64_t chunk_samples = 0;
+        float chunk_max = 0.0;
+        float chunk_squared_sum = 0.0;
+        float segment_max = 0.0;
+
+        // Save a completed chunk (partial chunks at the end of the stream are dropped)
+        auto save_chunk = [&]() {
+            if (chunk_index >= first_chunk && chunk_index < end_chunk && chunk_samples == sample_divisor) {
+                data.max_samples[chunk_index] = chunk_max;
+                data.rms_samples[chunk_index] = chunk_squared_sum / (sample_divisor * channel_count);
+                segment_max = std::max(segment_max, chunk_max);
+            }
+        };
+
+        try {
+            ffmpeg_reader->ReadAudioSamples(
+                [&](const float *const *samples, int64_t position, int sample_count) {
+                    int offset = 0;
+                    while (offset < sample_count) {
+                        // Samples (of this block) which belong to the same chunk
+                        const int64_t sample_position = position + offset;
+                        const int64_t index = sample_position / sample_divisor;
+                        const int run = (int) std::min<int64_t>(sample_count - offset,
+                                                                (index + 1) * sample_divisor - sample_position);
+                        if (index != chunk_index) {
+                            save_chunk();
+                            chunk_index = index;
+                            chunk_samples = 0;
+                            chunk_max = 0.0;
+                            chunk_squared_sum = 0.0;
+                        }
+
+                        // Accumulate sample averages
+                        for (int channel_index = first_channel; channel_index <= last_channel; channel_index++) {
+                            chunk_max = std::max(chunk_max, reduce_block(samples[channel_index] + offset, run, chunk_squared_sum));
+                        }
+                        chunk_samples += run;
+                        offset += run;
+                    }
+                },
+                int64_t(first_chunk) * sample_divisor, int64_t(end_chunk) * sample_divisor);
+            save_chunk();
+        } catch (...) {
+            // Exceptions can't leave the parallel region
+            #pragma omp critical (audio_waveformer_error)
+            error = std::current_exception();
+        }
+
+        samples_max = std::max(samples_max, segment_max);
+    }
+
+    if (error)
+        std::rethrow_exception(error);
+
+    return samples_max;
+}
+
+// Extract samples from the peak file of a FFmpegReader
+bool AudioWaveformer::ExtractPeakSamples(FFmpegReader* ffmpeg_reader, int channel, int sample_divisor,
+                                         int total_samples, AudioWaveformData& data, float& samples_max) {
+    // Buckets smaller than the finest level of a peak file are decoded instead
+    const std::string directory = Settings::Instance()->AUDIO_PEAK_PATH;
+    if (directory.empty() || sample_divisor < AudioPeakFile::BASE_BUCKET_SIZE)
+        return false;
+
+    // Map the peak file (writing it first, the first time this file is summarized)
+    const std::string peak_path = AudioPeakFile::GetPath(directory, ffmpeg_reader->JsonValue()["path"].asString());
+    std::shared_ptr<AudioPeakFile> peaks = AudioPeakFile::Open(peak_path);
+    if (!peaks && AudioPeakFile::Create(ffmpeg_reader, peak_path))
+        peaks = AudioPeakFile::Open(peak_path);
+    if (!peaks || peaks->SampleRate() != ffmpeg_reader->info.sample_rate)
+        return false;
+
+    const int first_channel = (channel == -1) ? 0 : channel;
+    const int last_channel = (channel == -1) ? peaks->Channels() - 1 : channel;
+    const int channel_count = last_channel - first_channel + 1;
+    if (first_channel < 0 || last_channel >= peaks->Channels())
+        return false;
+
+    // Summarize each chunk (partial chunks at the end of the stream are dropped)
+    samples_max = 0.0;
+    for (int64_t chunk = 0; chunk < total_samples && (chunk + 1) * sample_divisor <= peaks->Samples(); chunk++) {
+        float chunk_max = 0.0;
+        float chunk_average = 0.0;
+        for (int channel_index = first_channel; channel_index <= last_channel; channel_index++) {
+            AudioPeak peak = peaks->Read(channel_index, chunk * sample_divisor, (chunk + 1) * sample_divisor);
+            chunk_max = std::max(chunk_max, std::max(std::abs(peak.min), std::abs(peak.max)));
+            chunk_average += peak.average;
+        }
+        data.max_samples[chunk] = chunk_max;
+        data.rms_samples[chunk] = chunk_average / channel_count;
+        samples_max = std::max(samples_max, chunk_max);
+    }
+
+    return true;
+}
@@ -68,6 +68,8 @@ namespace openshot {
         }
     };
 
+    class FFmpegReader;
+
     /**
      * @brief This class is used to extra audio data used for generating waveforms.
      *
@@ -75,11 +77,27 @@ namespace openshot {
      * and sample down the dataset to a much smaller set - more useful for generating
      * waveforms. For example, take 44100 samples per second, and reduce it to 20
      * "max" or "average" samples per second - much easier to graph.
+     *
+     * Audio files and videos read by an openshot::FFmpegReader are decoded directly
+     * (audio stream only, in parallel segments), skipping video decoding and frames.
+     * When Settings::AUDIO_PEAK_PATH is set, their audio is only decoded once, into a
+     * openshot::AudioPeakFile, which answers every later request (at any number of values
+     * per second) without decoding.
      */
     class AudioWaveformer {
     private:
         ReaderBase* reader;
 
+        /// Extract samples by decoding only the audio stream of a FFmpegReader (without building frames),
+        /// and return the largest sample value
+        float ExtractStreamSamples(FFmpegReader* ffmpeg_reader, int channel, int sample_divisor,
+                                   int total_samples, AudioWaveformData& data);
+
+        /// Extract samples from the peak file of a FFmpegReader (writing the peak file first, if needed), and return
+        /// false if there is no peak file (see Settings::AUDIO_PEAK_PATH)
+        bool ExtractPeakSamples(FFmpegReader* ffmpeg_reader, int channel, int sample_divisor,
+                                int total_samples, AudioWaveformData& data, float& samples_max);
+
     public:
         /// Default constructor
         AudioWaveformer(ReaderBase* reader);
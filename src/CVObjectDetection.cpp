@@ -11,12 +11,19 @@
 //
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <mutex>
+#include <thread>
 
 #include "CVObjectDetection.h"
 #include "Exceptions.h"
+#include "OpenCVUtilities.h"
 
 #include "objdetectdata.pb.h"
 #include <google/protobuf/util/time_util.h>
@@ -26,7 +33,8 @@ using namespace openshot;
 using google::protobuf::util::TimeUtil;
 
 CVObjectDetection::CVObjectDetection(std::string processInfoJson, ProcessingController &processingController)
-: processingController(&processingController), processingDevice("CPU"){
+: processingController(&processingController), processingDevice("CPU"), batchSize(8),
+  detectionInterval(1), sceneChangeThreshold(0.0), nextFrameId(0){
     SetJson(processInfoJson);
     confThreshold = 0.5;
     nmsThreshold = 0.1;
@@ -37,6 +45,10 @@ void CVObjectDetection::setProcessingDevice(){
         net.setPreferableBackend(cv::dnn::DNN_BACKEND_CUDA);
         net.setPreferableTarget(cv::dnn::DNN_TARGET_CUDA);
     }
+    else if(processingDevice == "OpenCL" || (processingDevice == "CPU" && UseOpenCL())){
+        net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+        net.setPreferableTarget(cv::dnn::DNN_TARGET_OPENCL);
+    }
     else if(processingDevice == "CPU"){
         net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
         net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
@@ -56,16 +68,19 @@ void CVObjectDetection::detectObjectsClip(openshot::Clip &video, size_t _start,
 
     processingController->SetError(false, "");
 
-    // Load names of classes
-    std::ifstream ifs(classesFile.c_str());
-    std::string line;
-    while (std::getline(ifs, line)) classNames.push_back(line);
-
-    // Load the network
+    // Get a warm network (and the names of its classes), which is only loaded by the first job of the model
     if(classesFile == "" || modelConfiguration == "" || modelWeights == "")
         return;
-    net = cv::dnn::readNetFromDarknet(modelConfiguration, modelWeights);
-    setProcessingDevice();
+    const std::string device = processingDevice + (UseOpenCL() ? "+OpenCL" : "");
+    model = DnnModelCache::Instance()->Acquire(modelConfiguration, modelWeights, classesFile, device,
+        [this](cv::dnn::Net& loaded) { net = loaded; setProcessingDevice(); });
+    if(!model){
+        processingController->SetError(true, "Could not load the model " + modelWeights);
+        error = true;
+        return;
+    }
+    net = model->net;
+    classNames = model->class_names;
 
     size_t frame_number;
     if(!process_interval || end <= 1 || end-start == 0){
@@ -74,35 +89,132 @@ void CVObjectDetection::detectObjectsClip(openshot::Clip &video, size_t _start,
         end = (int)(video.End() * video.Reader()->info.fps.ToFloat());
     }
 
-    for (frame_number = start; frame_number <= end; frame_number++)
+    // Decode frames on a separate thread, so the network never waits for the decoder
+    std::deque<std::pair<size_t, cv::Mat>> decoded;
+    std::mutex decoded_mutex;
+    std::condition_variable decoded_condition;
+    bool decoding_done = false;
+    bool stop_decoding = false;
+    std::exception_ptr decoding_error;
+    const size_t max_decoded = 2 * batchSize;
+
+    std::thread decoder([&]() {
+        try {
+            size_t last_detection = start;
+            cv::Mat previous_thumbnail;
+            for (size_t number = start; number <= end; number++) {
+                // Run the detector every detectionInterval frames (the tracker fills in the frames between)
+                bool detect = (number == start || number - last_detection >= detectionInterval);
+
+                // Detection is skipped: no need to decode the frame (unless looking for scene changes)
+                if (!detect && sceneChangeThreshold <= 0.0)
+                    continue;
+
+                std::shared_ptr<openshot::Frame> f = video.GetFrame(number);
+
+                // Also run the detector when the scene changes (compare a small grayscale thumbnail)
+                if (sceneChangeThreshold > 0.0) {
+                    cv::Mat thumbnail = GetAnalysisImageCV(f, cv::Size(64, 36), cv::COLOR_RGBA2GRAY);
+                    if (!previous_thumbnail.empty()) {
+                        double difference = cv::norm(thumbnail, previous_thumbnail, cv::NORM_L1) / (thumbnail.total() * 255.0);
+                        if (difference > sceneChangeThreshold)
+                            detect = true;
+                    }
+                    previous_thumbnail = thumbnail;
+                    if (!detect)
+                        continue;
+                }
+
+                // Grab OpenCV Mat image (scaled down to the analysis size)
+                cv::Size frameDims(f->GetImage()->width(), f->GetImage()->height());
+                cv::Mat cvimage = GetAnalysisImageCV(f, AnalysisSize(frameDims, analysisHeight));
+                last_detection = number;
+
+                std::unique_lock<std::mutex> lock(decoded_mutex);
+                decoded_condition.wait(lock, [&]() { return stop_decoding || decoded.size() < max_decoded; });
+                if (stop_decoding)
+                    break;
+                decoded.emplace_back(number, cvimage);
+                decoded_condition.notify_all();
+            }
+        } catch (...) {
+            const std::lock_guard<std::mutex> lock(decoded_mutex);
+            decoding_error = std::current_exception();
+        }
+        const std::lock_guard<std::mutex> lock(decoded_mutex);
+        decoding_done = true;
+        decoded_condition.notify_all();
+    });
+
+    // Stop (and wait for) the decoder thread
+    auto stopDecoder = [&]() {
+        {
+            const std::lock_guard<std::mutex> lock(decoded_mutex);
+            stop_decoding = true;
+        }
+        decoded_condition.notify_all();
+        decoder.join();
+    };
+
+    nextFrameId = start;
+    while (true)
     {
-         // Stop the feature tracker process
+        // Stop the feature tracker process
         if(processingController->ShouldStop()){
+            stopDecoder();
             return;
         }
 
-        std::shared_ptr<openshot::Frame> f = video.GetFrame(frame_number);
-
-        // Grab OpenCV Mat image
-        cv::Mat cvimage = f->GetImageCV();
-
-        DetectObjects(cvimage, frame_number);
+        // Wait for the next batch of frames
+        std::vector<cv::Mat> frames;
+        std::vector<size_t> frameIds;
+        {
+            std::unique_lock<std::mutex> lock(decoded_mutex);
+            decoded_condition.wait(lock, [&]() { return decoding_done || decoded.size() >= batchSize; });
+            while (!decoded.empty() && frames.size() < batchSize) {
+                frameIds.push_back(decoded.front().first);
+                frames.push_back(decoded.front().second);
+                decoded.pop_front();
+            }
+            decoded_condition.notify_all();
+        }
+        if (frames.empty())
+            break;
+
+        try {
+            DetectObjects(frames, frameIds);
+        } catch (...) {
+            stopDecoder();
+            throw;
+        }
+        frame_number = frameIds.back();
 
         // Update progress
         processingController->SetProgress(uint(100*(frame_number-start)/(end-start)));
-
     }
+    stopDecoder();
+
+    // Report decoding errors
+    if (decoding_error)
+        std::rethrow_exception(decoding_error);
+
+    // Track the objects through the frames after the last detection
+    propagateObjects(end + 1);
+
+    // Let the next job use the network
+    net = cv::dnn::Net();
+    model.reset();
 }
 
-void CVObjectDetection::DetectObjects(const cv::Mat &frame, size_t frameId){
+void CVObjectDetection::DetectObjects(const std::vector<cv::Mat> &frames, const std::vector<size_t> &frameIds){
     // Get frame as OpenCV Mat
     cv::Mat blob;
 
-    // Create a 4D blob from the frame.
+    // Create a 4D blob from the frames (one image per frame).
     int inpWidth, inpHeight;
     inpWidth = inpHeight = 416;
 
-    cv::dnn::blobFromImage(frame, blob, 1/255.0, cv::Size(inpWidth, inpHeight), cv::Scalar(0,0,0), true, false);
+    cv::dnn::blobFromImages(frames, blob, 1/255.0, cv::Size(inpWidth, inpHeight), cv::Scalar(0,0,0), true, false);
 
     //Sets the input to the network
     net.setInput(blob);
@@ -111,9 +223,62 @@ void CVObjectDetection::DetectObjects(const cv::Mat &frame, size_t frameId){
     std::vector<cv::Mat> outs;
     net.forward(outs, getOutputsNames(net));
 
-    // Remove the bounding boxes with low confidence
-    postprocess(frame.size(), outs, frameId);
+    // Remove the bounding boxes with low confidence (one frame at a time, in order, for the SORT tracker)
+    const int batch = (int) frames.size();
+    for (int index = 0; index < batch; ++index)
+    {
+        // Split the outputs of this frame from the batch (a 3D [batch, boxes, values] Mat,
+        // or a 2D Mat with the boxes of each frame one after another)
+        std::vector<cv::Mat> frameOuts;
+        for (const cv::Mat &out : outs)
+        {
+            if (out.dims == 3)
+                frameOuts.push_back(cv::Mat(out.size[1], out.size[2], out.type(), (void*)out.ptr<float>(index)));
+            else {
+                const int rows = out.rows / batch;
+                frameOuts.push_back(out.rowRange(index * rows, (index + 1) * rows));
+            }
+        }
+
+        // Track the objects through the frames skipped since the last detection
+        propagateObjects(frameIds[index]);
+
+        postprocess(frames[index].size(), frameOuts, frameIds[index]);
+    }
+}
+
+// Move the tracked objects (with the SORT tracker's motion model) to the frames before frameId
+void CVObjectDetection::propagateObjects(size_t frameId){
+    for (; nextFrameId < frameId; nextFrameId++)
+    {
+        sort.propagate(nextFrameId);
+
+        // Keep the objects found on the previous frame (the same boxes survived postprocessing)
+        std::vector<int> classIds;
+        std::vector<float> confidences;
+        std::vector<cv::Rect_<float>> normalized_boxes;
+        std::vector<int> objectIds;
+        const CVDetectionData previous = GetDetectionData(nextFrameId - 1);
+        for (const auto &TBox : sort.frameTrackingResult)
+        {
+            if (std::find(previous.objectIds.begin(), previous.objectIds.end(), TBox.id) == previous.objectIds.end())
+                continue;
+
+            // Normalize boxes coordinates
+            cv::Rect_<float> normalized_box;
+            normalized_box.x = TBox.box.x / (float)lastFrameDims.width;
+            normalized_box.y = TBox.box.y / (float)lastFrameDims.height;
+            normalized_box.width = TBox.box.width / (float)lastFrameDims.width;
+            normalized_box.height = TBox.box.height / (float)lastFrameDims.height;
 
+            classIds.push_back(TBox.classId);
+            confidences.push_back(TBox.confidence);
+            normalized_boxes.push_back(normalized_box);
+            objectIds.push_back(TBox.id);
+        }
+
+        detectionsData[nextFrameId] = CVDetectionData(classIds, confidences, normalized_boxes, nextFrameId, objectIds);
+    }
 }
 
 
@@ -243,6 +408,8 @@ void CVObjectDetection::postprocess(const cv::Size &frameDims, const std::vector
     }
 
     detectionsData[frameId] = CVDetectionData(classIds, confidences, normalized_boxes, frameId, objectIds);
+    lastFrameDims = frameDims;
+    nextFrameId = frameId + 1;
 }
 
 // Compute IOU between 2 boxes
@@ -327,9 +494,6 @@ bool CVObjectDetection::SaveObjDetectedData(){
         }
     }
 
-    // Delete all global objects allocated by libprotobuf.
-    google::protobuf::ShutdownProtobufLibrary();
-
     return true;
 
 }
@@ -383,6 +547,18 @@ void CVObjectDetection::SetJsonValue(const Json::Value root) {
     if (!root["processing-device"].isNull()){
 		processingDevice = (root["processing-device"].asString());
 	}
+    if (!root["analysis-height"].isNull()){
+        analysisHeight = root["analysis-height"].asInt();
+    }
+    if (!root["batch-size"].isNull()){
+        batchSize = std::max(1, root["batch-size"].asInt());
+    }
+    if (!root["detection-interval"].isNull()){
+        detectionInterval = std::max(1, root["detection-interval"].asInt());
+    }
+    if (!root["scene-change-threshold"].isNull()){
+        sceneChangeThreshold = root["scene-change-threshold"].asFloat();
+    }
     if (!root["model-config"].isNull()){
 		modelConfiguration = (root["model-config"].asString());
         std::ifstream infile(modelConfiguration);
@@ -478,8 +654,5 @@ bool CVObjectDetection::_LoadObjDetectdData(){
         detectionsData[id] = CVDetectionData(classIds, confidences, boxes, id, objectIds);
     }
 
-    // Delete all global objects allocated by libprotobuf.
-    google::protobuf::ShutdownProtobufLibrary();
-
     return true;
 }
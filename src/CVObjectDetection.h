@@ -23,6 +23,7 @@
 #include "Json.h"
 #include "ProcessingController.h"
 #include "Clip.h"
+#include "DnnModelCache.h"
 
 #include "sort_filter/sort.hpp"
 
@@ -65,6 +66,7 @@ namespace openshot
 
         private:
 
+        std::shared_ptr<DnnModel> model; ///< The network used by this job (from the DnnModelCache)
         cv::dnn::Net net;
         std::vector<std::string> classNames;
         float confThreshold, nmsThreshold;
@@ -74,6 +76,9 @@ namespace openshot
         std::string modelWeights;
         std::string processingDevice;
         std::string protobuf_data_path;
+        size_t batchSize; ///< The number of frames in each forward pass of the network
+        size_t detectionInterval; ///< Run the detector every Nth frame (the tracker moves the objects in between)
+        float sceneChangeThreshold; ///< Also run the detector when a frame differs this much from the previous one (0 = off)
 
         SortTracker sort;
 
@@ -81,16 +86,22 @@ namespace openshot
 
         size_t start;
         size_t end;
+        size_t nextFrameId; ///< The first frame without detection data
+        cv::Size lastFrameDims;
 
         bool error = false;
+        int analysisHeight = 0; ///< The max height frames are analysed at (0 = full size)
 
         /// Will handle a Thread safely comutication between ClipProcessingJobs and the processing effect classes
         ProcessingController *processingController;
 
         void setProcessingDevice();
 
-        // Detect onbects on a single frame
-        void DetectObjects(const cv::Mat &frame, size_t frame_number);
+        // Detect objects on a batch of frames
+        void DetectObjects(const std::vector<cv::Mat> &frames, const std::vector<size_t> &frame_numbers);
+
+        // Move the tracked objects to the frames (without a detection) before frame_number
+        void propagateObjects(size_t frame_number);
 
         bool iou(cv::Rect pred_box, cv::Rect sort_box);
 
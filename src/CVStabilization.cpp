@@ -11,12 +11,18 @@
 //
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <thread>
 
 #include "CVStabilization.h"
 #include "Exceptions.h"
+#include "OpenCVUtilities.h"
+#include "OpenMPUtilities.h"
 
 #include "stabilizedata.pb.h"
 #include <google/protobuf/util/time_util.h>
@@ -25,6 +31,9 @@ using namespace std;
 using namespace openshot;
 using google::protobuf::util::TimeUtil;
 
+// The shortest segment worth tracking on its own thread (with its own reader)
+static const size_t MIN_SEGMENT_FRAMES = 100;
+
 // Set default smoothing window value to compute stabilization
 CVStabilization::CVStabilization(std::string processInfoJson, ProcessingController &processingController)
 : processingController(&processingController){
@@ -46,39 +55,85 @@ void CVStabilization::stabilizeClip(openshot::Clip& video, size_t _start, size_t
     avr_dx=0; avr_dy=0; avr_da=0; max_dx=0; max_dy=0; max_da=0;
 
     video.Open();
-    // Save original video width and height
+    // Save original video width and height (and the smaller size the frames are analysed at)
     cv::Size readerDims(video.Reader()->info.width, video.Reader()->info.height);
+    cv::Size analysisDims = openshot::AnalysisSize(readerDims, analysisHeight);
+    analysisScale = analysisDims.width / (double)readerDims.width;
 
-    size_t frame_number;
     if(!process_interval || end <= 1 || end-start == 0){
         // Get total number of frames in video
         start = (int)(video.Start() * video.Reader()->info.fps.ToFloat()) + 1;
         end = (int)(video.End() * video.Reader()->info.fps.ToFloat()) + 1;
     }
 
-    // Extract and track opticalflow features for each frame
-    for (frame_number = start; frame_number <= end; frame_number++)
-    {
-        // Stop the feature tracker process
-        if(processingController->ShouldStop()){
+    // Split long clips into segments, which are tracked in parallel (each with its own copy of the clip)
+    const size_t total_frames = end - start + 1;
+    size_t segments = std::min<size_t>(OPEN_MP_NUM_PROCESSORS, total_frames / MIN_SEGMENT_FRAMES);
+    std::atomic<size_t> processed_frames(0);
+
+    if(segments <= 1){
+        // Extract and track opticalflow features for each frame
+        if(!TrackSegment(video, start, end, analysisDims, processed_frames)){
             return;
         }
+    }
+    else{
+        std::vector<CVStabilization> workers(segments, *this);
+        std::vector<std::thread> threads;
+        std::vector<std::exception_ptr> errors(segments);
+
+        for(size_t segment = 0; segment < segments; segment++){
+            // Each segment (except the first) also reads the last frame of the previous segment,
+            // which is the reference for the transformation to its own first frame
+            size_t first = start + segment * total_frames / segments;
+            size_t last = start + (segment + 1) * total_frames / segments - 1;
+            if(segment > 0)
+                first--;
+
+            CVStabilization &worker = workers[segment];
+            worker.prev_to_cur_transform.clear();
+            worker.prev_grey = cv::Mat();
+            worker.prev_grey_gpu = cv::UMat();
+            worker.last_T = cv::Mat();
+            worker.avr_dx=0; worker.avr_dy=0; worker.avr_da=0; worker.max_dx=0; worker.max_dy=0; worker.max_da=0;
+
+            threads.emplace_back([&, segment, first, last]() {
+                try {
+                    openshot::Clip segment_clip;
+                    segment_clip.SetJson(video.Json());
+                    segment_clip.Open();
+                    workers[segment].TrackSegment(segment_clip, first, last, analysisDims, processed_frames);
+                    segment_clip.Close();
+                } catch (...) {
+                    errors[segment] = std::current_exception();
+                }
+            });
+        }
+        for(auto &thread : threads)
+            thread.join();
 
-        std::shared_ptr<openshot::Frame> f = video.GetFrame(frame_number);
-
-        // Grab OpenCV Mat image
-        cv::Mat cvimage = f->GetImageCV();
-        // Resize frame to original video width and height if they differ
-        if(cvimage.size().width != readerDims.width || cvimage.size().height != readerDims.height)
-            cv::resize(cvimage, cvimage, cv::Size(readerDims.width, readerDims.height));
-        cv::cvtColor(cvimage, cvimage, cv::COLOR_RGB2GRAY);
+        for(auto &segment_error : errors){
+            if(segment_error)
+                std::rethrow_exception(segment_error);
+        }
 
-        if(!TrackFrameFeatures(cvimage, frame_number)){
-            prev_to_cur_transform.push_back(TransformParam(0, 0, 0));
+        // Stop the feature tracker process
+        if(processingController->ShouldStop()){
+            return;
         }
 
-        // Update progress
-        processingController->SetProgress(uint(100*(frame_number-start)/(end-start)));
+        // Stitch the segments together (the transformations are relative to the previous frame,
+        // so the overlapping frames join the trajectories of consecutive segments)
+        for(auto &worker : workers){
+            prev_to_cur_transform.insert(prev_to_cur_transform.end(), worker.prev_to_cur_transform.begin(), worker.prev_to_cur_transform.end());
+            avr_dx+=worker.avr_dx; avr_dy+=worker.avr_dy; avr_da+=worker.avr_da;
+            if(fabs(worker.max_dx) > fabs(max_dx))
+                max_dx = worker.max_dx;
+            if(fabs(worker.max_dy) > fabs(max_dy))
+                max_dy = worker.max_dy;
+            if(fabs(worker.max_da) > fabs(max_da))
+                max_da = worker.max_da;
+        }
     }
 
     // Calculate trajectory data
@@ -92,16 +147,44 @@ void CVStabilization::stabilizeClip(openshot::Clip& video, size_t _start, size_t
 
     // Normalize smoothed trajectory data
     for(auto &dataToNormalize : trajectoryData){
-        dataToNormalize.second.x/=readerDims.width;
-        dataToNormalize.second.y/=readerDims.height;
+        dataToNormalize.second.x/=analysisDims.width;
+        dataToNormalize.second.y/=analysisDims.height;
     }
     // Normalize transformation data
     for(auto &dataToNormalize : transformationData){
-        dataToNormalize.second.dx/=readerDims.width;
-        dataToNormalize.second.dy/=readerDims.height;
+        dataToNormalize.second.dx/=analysisDims.width;
+        dataToNormalize.second.dy/=analysisDims.height;
     }
 }
 
+// Extract and track opticalflow features for each frame in [first, last]
+bool CVStabilization::TrackSegment(openshot::Clip& video, size_t first, size_t last, cv::Size analysisDims, std::atomic<size_t> &processed_frames){
+
+    for (size_t frame_number = first; frame_number <= last; frame_number++)
+    {
+        // Stop the feature tracker process
+        if(processingController->ShouldStop()){
+            return false;
+        }
+
+        std::shared_ptr<openshot::Frame> f = video.GetFrame(frame_number);
+
+        // Grab OpenCV Mat image (at the analysis size, even if the frame is a different size)
+        cv::Mat cvimage = openshot::GetAnalysisImageCV(f, analysisDims, cv::COLOR_RGBA2GRAY);
+
+        // The first frame of a later segment is only the reference for the next frame
+        bool reference_only = (frame_number == first && first != start);
+        if(!TrackFrameFeatures(cvimage, frame_number) && !reference_only){
+            prev_to_cur_transform.push_back(TransformParam(0, 0, 0));
+        }
+
+        // Update progress (the overlapping frames are not counted twice)
+        if(!reference_only)
+            processingController->SetProgress(uint(100*(processed_frames++)/(end-start)));
+    }
+    return true;
+}
+
 // Track current frame features and find the relative transformation
 bool CVStabilization::TrackFrameFeatures(cv::Mat frame, size_t frameNum){
     // Check if there are black frames
@@ -109,9 +192,16 @@ bool CVStabilization::TrackFrameFeatures(cv::Mat frame, size_t frameNum){
         return false;
     }
 
+    // With OpenCL, each frame is uploaded once (and kept on the device as the next previous frame)
+    const bool opencl = UseOpenCL();
+    cv::UMat frame_gpu;
+    if(opencl)
+        frame.copyTo(frame_gpu);
+
     // Initialize prev_grey if not
     if(prev_grey.empty()){
         prev_grey = frame;
+        prev_grey_gpu = frame_gpu;
         return true;
     }
 
@@ -120,10 +210,19 @@ bool CVStabilization::TrackFrameFeatures(cv::Mat frame, size_t frameNum){
     std::vector <cv::Point2f> prev_corner2, cur_corner2;
     std::vector <uchar> status;
     std::vector <float> err;
-    // Extract new image features
-    cv::goodFeaturesToTrack(prev_grey, prev_corner, 200, 0.01, 30);
-    // Track features
-    cv::calcOpticalFlowPyrLK(prev_grey, frame, prev_corner, cur_corner, status, err);
+    if(opencl){
+        if(prev_grey_gpu.empty())
+            prev_grey.copyTo(prev_grey_gpu);
+        // Extract new image features, and track them (on the OpenCL device)
+        cv::goodFeaturesToTrack(prev_grey_gpu, prev_corner, 200, 0.01, std::max(1.0, 30 * analysisScale));
+        cv::calcOpticalFlowPyrLK(prev_grey_gpu, frame_gpu, prev_corner, cur_corner, status, err);
+    }
+    else{
+        // Extract new image features
+        cv::goodFeaturesToTrack(prev_grey, prev_corner, 200, 0.01, std::max(1.0, 30 * analysisScale));
+        // Track features
+        cv::calcOpticalFlowPyrLK(prev_grey, frame, prev_corner, cur_corner, status, err);
+    }
     // Remove untracked features
     for(size_t i=0; i < status.size(); i++) {
         if(status[i]) {
@@ -161,7 +260,7 @@ bool CVStabilization::TrackFrameFeatures(cv::Mat frame, size_t frameNum){
     }
 
     // Filter transformations parameters, if they are higher than these: return
-    if(dx > 200 || dy > 200 || da > 0.1){
+    if(dx > 200 * analysisScale || dy > 200 * analysisScale || da > 0.1){
         return false;
     }
 
@@ -180,6 +279,7 @@ bool CVStabilization::TrackFrameFeatures(cv::Mat frame, size_t frameNum){
 
     prev_to_cur_transform.push_back(TransformParam(dx, dy, da));
     frame.copyTo(prev_grey);
+    prev_grey_gpu = frame_gpu;
 
     return true;
 }
@@ -288,9 +388,6 @@ bool CVStabilization::SaveStabilizedData(){
         return false;
     }
 
-    // Delete all global objects allocated by libprotobuf.
-    google::protobuf::ShutdownProtobufLibrary();
-
     return true;
 }
 
@@ -362,6 +459,9 @@ void CVStabilization::SetJsonValue(const Json::Value root) {
     if (!root["smoothing-window"].isNull()){
 		smoothingWindow = (root["smoothing-window"].asInt());
 	}
+    if (!root["analysis-height"].isNull()){
+		analysisHeight = (root["analysis-height"].asInt());
+	}
 }
 
 /*
@@ -410,8 +510,5 @@ bool CVStabilization::_LoadStabilizedData(){
         transformationData[id] = TransformParam(dx,dy,da);
     }
 
-    // Delete all global objects allocated by libprotobuf.
-    google::protobuf::ShutdownProtobufLibrary();
-
     return true;
 }
@@ -21,6 +21,7 @@
 #undef uint64
 #undef int64
 
+#include <atomic>
 #include <map>
 #include <string>
 #include <vector>
@@ -71,12 +72,16 @@ struct CamTrajectory
  *
  * The relative motion between two consecutive frames is computed to obtain the global camera trajectory.
  * The camera trajectory is then smoothed to reduce jittering.
+ *
+ * Long clips are split into segments which are tracked in parallel, each with its own copy of the clip.
  */
 class CVStabilization {
 
     private:
 
     int smoothingWindow; // In frames. The larger the more stable the video, but less reactive to sudden panning
+    int analysisHeight = 0; // The max height frames are analysed at (0 = full size)
+    double analysisScale = 1.0; // The analysis size / the original video size
 
     size_t start;
     size_t end;
@@ -84,6 +89,7 @@ class CVStabilization {
 
     cv::Mat last_T;
     cv::Mat prev_grey;
+    cv::UMat prev_grey_gpu; ///< The previous frame on the OpenCL device (see Settings::OPENCV_USE_OPENCL)
     std::vector <TransformParam> prev_to_cur_transform; // Previous to current
     std::string protobuf_data_path;
 
@@ -93,6 +99,9 @@ class CVStabilization {
     /// Will handle a Thread safely comutication between ClipProcessingJobs and the processing effect classes
     ProcessingController *processingController;
 
+    /// Extract and track opticalflow features for each frame of a segment (returns false if stopped)
+    bool TrackSegment(openshot::Clip& video, size_t first, size_t last, cv::Size analysisDims, std::atomic<size_t> &processed_frames);
+
     /// Track current frame features and find the relative transformation
     bool TrackFrameFeatures(cv::Mat frame, size_t frameNum);
 
@@ -12,6 +12,7 @@
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
 #include <fstream>
+#include <future>
 #include <iomanip>
 #include <iostream>
 
@@ -79,6 +80,18 @@ void CVTracker::trackClip(openshot::Clip& video, size_t _start, size_t _end, boo
     processingController->SetError(false, "");
     bool trackerInit = false;
 
+    // Decode the next frame on another thread, while the tracker works on the current frame
+    auto decodeFrame = [this, &video](size_t frame_number) {
+        std::shared_ptr<openshot::Frame> f = video.GetFrame(frame_number);
+
+        // Grab OpenCV Mat image (scaled down to the analysis size)
+        cv::Size frameDims(f->GetImage()->width(), f->GetImage()->height());
+        return GetAnalysisImageCV(f, AnalysisSize(frameDims, analysisHeight));
+    };
+    std::future<cv::Mat> next_image;
+    if(start <= end)
+        next_image = std::async(std::launch::async, decodeFrame, start);
+
     size_t frame;
     // Loop through video
     for (frame = start; frame <= end; frame++)
@@ -91,10 +104,9 @@ void CVTracker::trackClip(openshot::Clip& video, size_t _start, size_t _end, boo
 
         size_t frame_number = frame;
         // Get current frame
-        std::shared_ptr<openshot::Frame> f = video.GetFrame(frame_number);
-
-        // Grab OpenCV Mat image
-        cv::Mat cvimage = f->GetImageCV();
+        cv::Mat cvimage = next_image.get();
+        if(frame < end)
+            next_image = std::async(std::launch::async, decodeFrame, frame + 1);
 
         if(frame == start){
             // Take the normalized inital bounding box and multiply to the current video shape
@@ -227,9 +239,6 @@ bool CVTracker::SaveTrackedData(){
         }
     }
 
-    // Delete all global objects allocated by libprotobuf.
-    google::protobuf::ShutdownProtobufLibrary();
-
     return true;
 
 }
@@ -290,6 +299,9 @@ void CVTracker::SetJsonValue(const Json::Value root) {
     if (!root["tracker-type"].isNull()){
         trackerType = (root["tracker-type"].asString());
     }
+    if (!root["analysis-height"].isNull()){
+        analysisHeight = (root["analysis-height"].asInt());
+    }
 
     if (!root["region"].isNull()){
         double x = root["region"]["normalized_x"].asDouble();
@@ -360,8 +372,5 @@ bool CVTracker::_LoadTrackedData(){
         trackedDataById[id] = FrameData(id, rotation, x1, y1, x2, y2);
     }
 
-    // Delete all global objects allocated by libprotobuf.
-    google::protobuf::ShutdownProtobufLibrary();
-
     return true;
 }
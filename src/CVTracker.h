@@ -93,6 +93,7 @@ namespace openshot
 			size_t end;
 
 			bool error = false;
+			int analysisHeight = 0; // The max height frames are analysed at (0 = full size)
 
 			// Initialize the tracker
 			bool initTracker(cv::Mat &frame, size_t frameId);
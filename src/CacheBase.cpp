@@ -10,13 +10,72 @@
 //
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
+#include <iterator>
 #include <sstream>
 
 #include "CacheBase.h"
+#include "RenderTrace.h"
+#include "Settings.h"
 
 using namespace std;
 using namespace openshot;
 
+// Copy the counters of another cache
+CacheStats& CacheStats::operator=(const CacheStats& other)
+{
+	hits = other.hits.load(std::memory_order_relaxed);
+	misses = other.misses.load(std::memory_order_relaxed);
+	insertions = other.insertions.load(std::memory_order_relaxed);
+	evictions = other.evictions.load(std::memory_order_relaxed);
+	evicted_bytes = other.evicted_bytes.load(std::memory_order_relaxed);
+	lock_wait_ns = other.lock_wait_ns.load(std::memory_order_relaxed);
+	lock_held_ns = other.lock_held_ns.load(std::memory_order_relaxed);
+	return *this;
+}
+
+// Add the counters of another cache
+CacheStats& CacheStats::operator+=(const CacheStats& other)
+{
+	hits += other.hits.load(std::memory_order_relaxed);
+	misses += other.misses.load(std::memory_order_relaxed);
+	insertions += other.insertions.load(std::memory_order_relaxed);
+	evictions += other.evictions.load(std::memory_order_relaxed);
+	evicted_bytes += other.evicted_bytes.load(std::memory_order_relaxed);
+	lock_wait_ns += other.lock_wait_ns.load(std::memory_order_relaxed);
+	lock_held_ns += other.lock_held_ns.load(std::memory_order_relaxed);
+	return *this;
+}
+
+// Reset all counters to zero
+void CacheStats::Reset()
+{
+	hits = 0;
+	misses = 0;
+	insertions = 0;
+	evictions = 0;
+	evicted_bytes = 0;
+	lock_wait_ns = 0;
+	lock_held_ns = 0;
+}
+
+// Generate Json::Value for this object
+Json::Value CacheStats::JsonValue() const
+{
+	const int64_t found = hits.load(std::memory_order_relaxed);
+	const int64_t requests = found + misses.load(std::memory_order_relaxed);
+
+	Json::Value root;
+	root["hits"] = Json::Int64(found);
+	root["misses"] = Json::Int64(misses.load(std::memory_order_relaxed));
+	root["hit_rate"] = requests > 0 ? double(found) / requests : 0.0;
+	root["insertions"] = Json::Int64(insertions.load(std::memory_order_relaxed));
+	root["evictions"] = Json::Int64(evictions.load(std::memory_order_relaxed));
+	root["evicted_bytes"] = Json::Int64(evicted_bytes.load(std::memory_order_relaxed));
+	root["lock_wait_ms"] = lock_wait_ns.load(std::memory_order_relaxed) / 1000000.0;
+	root["lock_held_ms"] = lock_held_ns.load(std::memory_order_relaxed) / 1000000.0;
+	return root;
+}
+
 // Default constructor, no max frames
 CacheBase::CacheBase() : CacheBase::CacheBase(0) { }
 
@@ -26,6 +85,37 @@ CacheBase::CacheBase(int64_t max_bytes) : max_bytes(max_bytes) {
 	cacheMutex = new std::recursive_mutex();
 }
 
+// Lock cacheMutex (recording the wait, and the hold time of the outermost lock)
+CacheBase::ScopedLock::ScopedLock(CacheBase *cache) :
+	cache(cache), timed(Settings::Instance()->ENABLE_RENDER_STATS)
+{
+	std::recursive_mutex &mutex = *cache->cacheMutex;
+	if (!timed && !RenderTrace::Enabled()) {
+		mutex.lock();
+		cache->lock_depth++;
+		return;
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	if (!mutex.try_lock()) {
+		RenderTraceSpan span("wait " + cache->cache_type + "::cacheMutex", "lock");
+		mutex.lock();
+	}
+	locked = std::chrono::steady_clock::now();
+	if (timed)
+		cache->stats.lock_wait_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(locked - start).count();
+	cache->lock_depth++;
+}
+
+// Unlock cacheMutex
+CacheBase::ScopedLock::~ScopedLock()
+{
+	if (--cache->lock_depth == 0 && timed)
+		cache->stats.lock_held_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - locked).count();
+	cache->cacheMutex->unlock();
+}
+
 // Set maximum bytes to a different amount based on a ReaderInfo struct
 void CacheBase::SetMaxBytesFromInfo(int64_t number_of_frames, int width, int height, int sample_rate, int channels)
 {
@@ -34,68 +124,120 @@ void CacheBase::SetMaxBytesFromInfo(int64_t number_of_frames, int width, int hei
 	SetMaxBytes(bytes);
 }
 
+// Add a frame to the ranges of frames
+void CacheBase::AddRange(int64_t frame_number) {
+	// The range after this frame, and the range before it (if any)
+	auto next = frame_ranges.upper_bound(frame_number);
+	auto previous = (next == frame_ranges.begin()) ? frame_ranges.end() : std::prev(next);
+	if (previous != frame_ranges.end() && previous->second >= frame_number)
+		return;
+
+	// Join the ranges next to this frame (if any)
+	const bool joins_previous = previous != frame_ranges.end() && previous->second == frame_number - 1;
+	const bool joins_next = next != frame_ranges.end() && next->first == frame_number + 1;
+	if (joins_previous && joins_next) {
+		previous->second = next->second;
+		frame_ranges.erase(next);
+	} else if (joins_previous) {
+		previous->second = frame_number;
+	} else if (joins_next) {
+		const int64_t ending_frame = next->second;
+		frame_ranges.emplace_hint(frame_ranges.erase(next), frame_number, ending_frame);
+	} else {
+		frame_ranges.emplace_hint(next, frame_number, frame_number);
+	}
+	frame_ranges_changed = true;
+}
+
+// Remove a frame from the ranges of frames
+void CacheBase::RemoveRange(int64_t frame_number) {
+	auto range = frame_ranges.upper_bound(frame_number);
+	if (range == frame_ranges.begin())
+		return;
+	range--;
+	const int64_t starting_frame = range->first;
+	const int64_t ending_frame = range->second;
+	if (ending_frame < frame_number)
+		return;
+
+	// Shrink (or split) the range of this frame
+	if (starting_frame == frame_number) {
+		auto hint = frame_ranges.erase(range);
+		if (ending_frame > frame_number)
+			frame_ranges.emplace_hint(hint, frame_number + 1, ending_frame);
+	} else {
+		range->second = frame_number - 1;
+		if (ending_frame > frame_number)
+			frame_ranges.emplace_hint(std::next(range), frame_number + 1, ending_frame);
+	}
+	frame_ranges_changed = true;
+}
+
+// Remove all frames from the ranges of frames
+void CacheBase::ClearRanges() {
+	if (!frame_ranges.empty())
+		frame_ranges_changed = true;
+	frame_ranges.clear();
+}
+
 // Calculate ranges of frames
 void CacheBase::CalculateRanges() {
-	// Only calculate when something has changed
+	// Create a scoped lock, to protect the cache from multiple threads
+	const ScopedLock lock(this);
+
+	// Caches which don't update their ranges on each change re-calculate them from their frame numbers
+	UpdateFrameNumbers();
 	if (needs_range_processing) {
+		std::sort(ordered_frame_numbers.begin(), ordered_frame_numbers.end());
+		frame_ranges.clear();
+		for (const int64_t frame_number : ordered_frame_numbers) {
+			if (!frame_ranges.empty() && frame_number - frame_ranges.rbegin()->second <= 1)
+				frame_ranges.rbegin()->second = std::max(frame_ranges.rbegin()->second, frame_number);
+			else
+				frame_ranges.emplace_hint(frame_ranges.end(), frame_number, frame_number);
+		}
+		needs_range_processing = false;
+		frame_ranges_changed = true;
+	}
 
-		// Create a scoped lock, to protect the cache from multiple threads
-		const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+	// Only generate the JSON ranges when something has changed (in O(ranges))
+	if (!frame_ranges_changed)
+		return;
+	range_version++;
+	frame_ranges_changed = false;
 
-		// Sort ordered frame #s, and calculate JSON ranges
-		std::sort(ordered_frame_numbers.begin(), ordered_frame_numbers.end());
+	Json::Value ranges = Json::Value(Json::arrayValue);
+	for (const auto& frame_range : frame_ranges) {
+		// Add JSON object with start/end attributes
+		// Use strings, since int64_ts are not supported in JSON
+		Json::Value range;
+		range["start"] = std::to_string(frame_range.first);
+		range["end"] = std::to_string(frame_range.second);
+		ranges.append(range);
+	}
+
+	// Cache range JSON as string
+	json_ranges = openshot::jsonToString(ranges);
+	ranges_value = ranges;
+}
+
+// Get the ranges of cached frames
+std::vector<CacheRange> CacheBase::GetRanges() {
+	const ScopedLock lock(this);
+	CalculateRanges();
+
+	std::vector<CacheRange> ranges;
+	ranges.reserve(frame_ranges.size());
+	for (const auto& frame_range : frame_ranges)
+		ranges.push_back({frame_range.first, frame_range.second});
+	return ranges;
+}
 
-		// Clear existing JSON variable
-		Json::Value ranges = Json::Value(Json::arrayValue);
-
-		// Increment range version
-		range_version++;
-
-		std::vector<int64_t>::iterator itr_ordered;
-
-        int64_t starting_frame = 0;
-        int64_t ending_frame = 0;
-        if (ordered_frame_numbers.size() > 0) {
-            starting_frame = *ordered_frame_numbers.begin();
-            ending_frame = *ordered_frame_numbers.begin();
-
-            // Loop through all known frames (in sequential order)
-            for (itr_ordered = ordered_frame_numbers.begin(); itr_ordered != ordered_frame_numbers.end(); ++itr_ordered) {
-                int64_t frame_number = *itr_ordered;
-                if (frame_number - ending_frame > 1) {
-                    // End of range detected
-                    Json::Value range;
-
-                    // Add JSON object with start/end attributes
-                    // Use strings, since int64_ts are supported in JSON
-                    range["start"] = std::to_string(starting_frame);
-                    range["end"] = std::to_string(ending_frame);
-                    ranges.append(range);
-
-                    // Set new starting range
-                    starting_frame = frame_number;
-                }
-
-                // Set current frame as end of range, and keep looping
-                ending_frame = frame_number;
-            }
-        }
-
-        // APPEND FINAL VALUE
-        Json::Value range;
-
-        // Add JSON object with start/end attributes
-        // Use strings, since int64_ts are not supported in JSON
-        range["start"] = std::to_string(starting_frame);
-        range["end"] = std::to_string(ending_frame);
-        ranges.append(range);
-
-        // Cache range JSON as string
-        json_ranges = ranges.toStyledString();
-
-        // Reset needs_range_processing
-        needs_range_processing = false;
-    }
+// Get the version of the ranges of cached frames
+int64_t CacheBase::GetRangeVersion() {
+	const ScopedLock lock(this);
+	CalculateRanges();
+	return range_version;
 }
 
 // Generate Json::Value for this object
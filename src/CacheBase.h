@@ -18,12 +18,52 @@
 #include <memory>
 #include <mutex>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 
+#include "Enums.h"
 #include "Json.h"
 
 namespace openshot {
 	class Frame;
 
+	/**
+	 * @brief The hit, miss and eviction counters of a cache (lock-free, so they can be updated by any thread)
+	 *
+	 * The time spent waiting for and holding the cache lock is only measured while
+	 * Settings::ENABLE_RENDER_STATS is enabled (since it reads the clock twice per lock).
+	 */
+	struct CacheStats {
+#ifndef SWIG
+		std::atomic<int64_t> hits{0};          ///< GetFrame() calls which found the frame
+		std::atomic<int64_t> misses{0};        ///< GetFrame() calls which did not find the frame
+		std::atomic<int64_t> insertions{0};    ///< Frames added (which were not cached yet)
+		std::atomic<int64_t> evictions{0};     ///< Frames removed to stay below the max bytes
+		std::atomic<int64_t> evicted_bytes{0}; ///< Bytes freed by evictions
+		std::atomic<int64_t> lock_wait_ns{0};  ///< Time spent waiting for the cache lock (in nanoseconds)
+		std::atomic<int64_t> lock_held_ns{0};  ///< Time spent holding the cache lock (in nanoseconds)
+#endif
+
+		CacheStats() = default;
+		CacheStats(const CacheStats& other) { *this = other; }
+		CacheStats& operator=(const CacheStats& other);
+
+		/// Add the counters of another cache (i.e. to aggregate the caches of a reader)
+		CacheStats& operator+=(const CacheStats& other);
+
+		/// Reset all counters to zero
+		void Reset();
+
+		/// Generate Json::Value (the counters, hit_rate, lock_wait_ms and lock_held_ms)
+		Json::Value JsonValue() const;
+	};
+
+	/// A range of cached frames (including both the start and end frame)
+	struct CacheRange {
+		int64_t start; ///< The first frame of the range
+		int64_t end; ///< The last frame of the range
+	};
+
 	/**
 	 * @brief All cache managers in libopenshot are based on this CacheBase class
 	 *
@@ -37,16 +77,55 @@ namespace openshot {
 		std::string cache_type; ///< This is a friendly type name of the derived cache instance
 		int64_t max_bytes; ///< This is the max number of bytes to cache (0 = no limit)
 
-		bool needs_range_processing; ///< Something has changed, and the range data needs to be re-calculated
+		bool needs_range_processing; ///< ordered_frame_numbers has changed, and the ranges need to be re-calculated from it
+		bool frame_ranges_changed = false; ///< frame_ranges has changed, and the JSON ranges need to be generated again
 		std::string json_ranges; ///< JSON ranges of frame numbers
+		Json::Value ranges_value; ///< The ranges of json_ranges (so JsonValue doesn't need to parse them again)
 		std::vector<int64_t> ordered_frame_numbers; ///< Ordered list of frame numbers used by cache
-		std::map<int64_t, int64_t> frame_ranges;	///< This map holds the ranges of frames, useful for quickly displaying the contents of the cache
+		std::map<int64_t, int64_t> frame_ranges;	///< The ranges of frames (start frame -> end frame), useful for quickly displaying the contents of the cache
 		int64_t range_version; ///< The version of the JSON range data (incremented with each change)
         
 		/// Mutex for multiple threads
 		std::recursive_mutex *cacheMutex;
+		int lock_depth = 0; ///< How many times the calling thread holds cacheMutex (only changed while holding it)
+
+		CacheStats stats; ///< The hit, miss and eviction counters of this cache
 
-		/// Calculate ranges of frames
+		std::atomic<int64_t> playhead_frame{0}; ///< The frame at the playhead (0 = unknown), see SetPlayhead()
+		std::atomic<int> playhead_direction{1}; ///< The direction of playback (1 = forward, -1 = backward)
+
+		/// @brief Lock cacheMutex (until destroyed), and add the wait and hold time to the stats
+		///
+		/// Only the outermost lock of a thread counts the hold time (cacheMutex is recursive), and waits
+		/// for a contended lock are recorded as spans of the RenderTrace.
+		class ScopedLock {
+		private:
+			CacheBase *cache;
+			bool timed;
+			std::chrono::steady_clock::time_point locked;
+
+		public:
+			explicit ScopedLock(CacheBase *cache);
+			~ScopedLock();
+			ScopedLock(ScopedLock const&) = delete;
+			ScopedLock & operator=(ScopedLock const&) = delete;
+		};
+
+		/// @brief Add a frame to the ranges of frames (for caches which update their ranges on each change, in
+		/// O(log ranges), instead of re-calculating them from ordered_frame_numbers)
+		void AddRange(int64_t frame_number);
+
+		/// Remove a frame from the ranges of frames
+		void RemoveRange(int64_t frame_number);
+
+		/// Remove all frames from the ranges of frames
+		void ClearRanges();
+
+		/// Update ordered_frame_numbers (and set needs_range_processing), for caches which don't update their
+		/// ranges on each change
+		virtual void UpdateFrameNumbers() { };
+
+		/// Calculate ranges of frames (and the JSON ranges, if they have changed)
 		void CalculateRanges();
 
 	public:
@@ -96,9 +175,30 @@ namespace openshot {
 		/// Gets the maximum bytes value
 		int64_t GetMaxBytes() { return max_bytes; };
 
+		/// Get the ranges of cached frames (sorted by frame number), i.e. to draw the cached ranges of a timeline
+		std::vector<openshot::CacheRange> GetRanges();
+
+		/// Get the version of the ranges of cached frames (incremented when they change, so a UI can skip
+		/// drawing the same ranges again)
+		int64_t GetRangeVersion();
+
+		/// Get the hit, miss and eviction counters of this cache (composite caches add up their parts)
+		virtual openshot::CacheStats GetStats() { return stats; };
+
+		/// Reset the hit, miss and eviction counters of this cache
+		virtual void ResetStats() { stats.Reset(); };
+
+		/// @brief Set the position of the playhead (a hint for the CACHE_EVICT_PLAYHEAD eviction policy)
+		/// @param frame_number The frame at the playhead (0 = unknown)
+		/// @param direction The direction of playback (1 = forward, -1 = backward)
+		virtual void SetPlayhead(int64_t frame_number, int direction) {
+			playhead_frame = frame_number;
+			playhead_direction = (direction < 0) ? -1 : 1;
+		};
+
 		/// @brief Set maximum bytes to a different amount
 		/// @param number_of_bytes The maximum bytes to allow in the cache. Once exceeded, the cache will purge the oldest frames.
-		void SetMaxBytes(int64_t number_of_bytes) { max_bytes = number_of_bytes; };
+		virtual void SetMaxBytes(int64_t number_of_bytes) { max_bytes = number_of_bytes; };
 
 		/// @brief Set maximum bytes to a different amount based on a ReaderInfo struct
 		/// @param number_of_frames The maximum number of frames to hold in cache
@@ -0,0 +1,214 @@
+/**
+ * @file
+ * @brief Source file for CacheBudget class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "CacheBudget.h"
+#include "CacheMemory.h"
+#include "RenderTrace.h"
+#include "Settings.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+
+using namespace openshot;
+
+// Global reference to the budget
+CacheBudget *CacheBudget::m_pInstance = nullptr;
+
+// Create or Get an instance of the budget singleton
+CacheBudget *CacheBudget::Instance()
+{
+	// Create the actual instance only once (caches are used on many threads)
+	static std::once_flag created;
+	std::call_once(created, []() { m_pInstance = new CacheBudget; });
+
+	return m_pInstance;
+}
+
+// Register a cache
+void CacheBudget::Register(CacheMemory* cache)
+{
+	{
+		const std::lock_guard<std::mutex> lock(registryMutex);
+		caches.insert(cache);
+	}
+
+	// Start watching the memory pressure (once, the singleton is never destroyed)
+	if (Settings::Instance()->CACHE_BUDGET_MEMORY_PRESSURE)
+		std::call_once(monitor_started, [this]() { std::thread(&CacheBudget::monitor_pressure, this).detach(); });
+}
+
+// Unregister a cache
+void CacheBudget::Unregister(CacheMemory* cache)
+{
+	const std::lock_guard<std::mutex> lock(registryMutex);
+	caches.erase(cache);
+}
+
+// Count a buffer which was added to a cache
+void CacheBudget::Reference(const void* buffer, int64_t bytes)
+{
+	const std::lock_guard<std::mutex> lock(budgetMutex);
+	Buffer& counted = buffers[buffer];
+	if (counted.caches++ == 0) {
+		// First cache holding this buffer
+		counted.bytes = bytes;
+		total_bytes += bytes;
+	}
+}
+
+// Release a buffer which was removed from a cache
+void CacheBudget::Release(const void* buffer)
+{
+	const std::lock_guard<std::mutex> lock(budgetMutex);
+	auto counted = buffers.find(buffer);
+	if (counted != buffers.end() && --counted->second.caches == 0) {
+		// Last cache holding this buffer
+		total_bytes -= counted->second.bytes;
+		buffers.erase(counted);
+	}
+}
+
+// Is a buffer held by more than one cache?
+bool CacheBudget::IsShared(const void* buffer)
+{
+	const std::lock_guard<std::mutex> lock(budgetMutex);
+	auto counted = buffers.find(buffer);
+	return counted != buffers.end() && counted->second.caches > 1;
+}
+
+// Get the bytes held by all caches
+int64_t CacheBudget::GetBytes()
+{
+	const std::lock_guard<std::mutex> lock(budgetMutex);
+	return total_bytes;
+}
+
+// Get the max bytes of all caches together
+int64_t CacheBudget::GetMaxBytes()
+{
+	const int64_t max_bytes = int64_t(Settings::Instance()->CACHE_BUDGET_MB) * 1024 * 1024;
+	const std::lock_guard<std::mutex> lock(budgetMutex);
+	if (pressure_max_bytes > 0 && (max_bytes <= 0 || pressure_max_bytes < max_bytes))
+		return pressure_max_bytes;
+	return std::max<int64_t>(max_bytes, 0);
+}
+
+// Do all caches together hold more than the max bytes?
+bool CacheBudget::IsOverBudget()
+{
+	const int64_t max_bytes = GetMaxBytes();
+	return max_bytes > 0 && GetBytes() > max_bytes;
+}
+
+// Evict frames across all caches, until they hold less than the max bytes
+void CacheBudget::Enforce()
+{
+	// Another thread is already evicting frames (or this thread is, and an eviction callback added a frame)
+	static thread_local bool is_enforcing = false;
+	if (is_enforcing)
+		return;
+	std::unique_lock<std::mutex> enforcing(enforceMutex, std::try_to_lock);
+	if (!enforcing.owns_lock())
+		return;
+	is_enforcing = true;
+
+	// Caches are not destroyed while their frames are evicted
+	const std::lock_guard<std::mutex> lock(registryMutex);
+	while (IsOverBudget())
+	{
+		// The next frame of the cache with the lowest priority, and then the least recently used frame
+		CacheMemory *victim = nullptr;
+		int victim_priority = 0;
+		int64_t victim_last_used = 0;
+		for (CacheMemory *cache : caches) {
+			int64_t last_used = 0;
+			if (!cache->BudgetCandidate(last_used))
+				continue;
+			const int priority = cache->GetBudgetPriority();
+			if (!victim || priority < victim_priority || (priority == victim_priority && last_used < victim_last_used)) {
+				victim = cache;
+				victim_priority = priority;
+				victim_last_used = last_used;
+			}
+		}
+
+		// Stop, once no frame can be evicted (readers and the playback cache wait, see IsOverBudget)
+		if (!victim || !victim->EvictForBudget())
+			break;
+	}
+	is_enforcing = false;
+}
+
+// Read the memory usage and limit of the process' cgroup
+bool CacheBudget::read_cgroup_memory(int64_t& usage, int64_t& limit)
+{
+#ifdef __linux__
+	// Read a number of bytes from a cgroup file (which is "max" without a limit)
+	auto read_bytes = [](const std::string& path, int64_t& bytes) {
+		std::ifstream file(path);
+		std::string text;
+		if (!(file >> text) || text == "max")
+			return false;
+		char *end = nullptr;
+		bytes = std::strtoll(text.c_str(), &end, 10);
+		return end && *end == '\0';
+	};
+
+	// cgroup v2 (the path of the process' cgroup is the "0::" line)
+	std::ifstream cgroup("/proc/self/cgroup");
+	std::string line;
+	while (std::getline(cgroup, line)) {
+		if (line.rfind("0::", 0) != 0)
+			continue;
+		const std::string path = "/sys/fs/cgroup" + line.substr(3);
+		if (read_bytes(path + "/memory.max", limit) && read_bytes(path + "/memory.current", usage))
+			return true;
+	}
+
+	// cgroup v1 (which reports a huge limit when there is none)
+	if (read_bytes("/sys/fs/cgroup/memory/memory.limit_in_bytes", limit) &&
+		read_bytes("/sys/fs/cgroup/memory/memory.usage_in_bytes", usage))
+		return limit < (int64_t(1) << 60);
+#endif
+	return false;
+}
+
+// Watch the memory pressure of the cgroup
+void CacheBudget::monitor_pressure()
+{
+	RenderTrace::Instance()->SetThreadName("CacheBudget monitor");
+	while (true)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+		int64_t usage = 0;
+		int64_t limit = 0;
+		const bool watched = Settings::Instance()->CACHE_BUDGET_MEMORY_PRESSURE && read_cgroup_memory(usage, limit);
+		{
+			const std::lock_guard<std::mutex> lock(budgetMutex);
+			if (!watched || usage < limit / 10 * 8) {
+				// No (more) memory pressure
+				pressure_max_bytes = 0;
+			} else if (usage > limit / 10 * 9) {
+				// Reduce the caches by the excess (the rest of the process can't be reduced here)
+				const int64_t excess = usage - limit / 10 * 9;
+				const int64_t cached_bytes = pressure_max_bytes > 0 ? std::min(pressure_max_bytes, total_bytes) : total_bytes;
+				pressure_max_bytes = std::max<int64_t>(1, cached_bytes - excess);
+			}
+		}
+		Enforce();
+	}
+}
@@ -0,0 +1,133 @@
+/**
+ * @file
+ * @brief Header file for CacheBudget class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_CACHE_BUDGET_H
+#define OPENSHOT_CACHE_BUDGET_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+
+namespace openshot {
+
+	// Forward decl
+	class CacheMemory;
+
+	/**
+	 * @brief This singleton class limits the memory held by all the CacheMemory objects together
+	 *
+	 * The same frame is often cached at several levels: in the reader's cache, in the FrameMapper's cache
+	 * (which passes through the reader's frames when the frame rate and sample rate match), and in the cache
+	 * of the clip (whose frames are copy-on-write copies of the reader's frames). Each cache references the
+	 * pixel and sample buffers of its frames, and every buffer is counted once here, no matter how many
+	 * caches hold it.
+	 *
+	 * Every CacheMemory registers itself here, and the total is limited to Settings::CACHE_BUDGET_MB. Once
+	 * it is exceeded, frames are evicted across all caches: the next frame of the cache with the lowest
+	 * priority (see CacheMemory::SetBudgetPriority()) is evicted first, and between caches of the same
+	 * priority, the frame which was used the longest time ago (global LRU). Frames which would free no
+	 * memory (since another cache, or a clip or effect, still holds them) are never evicted for the budget,
+	 * and each cache keeps at least MIN_FRAMES frames (so the frames being rendered are not evicted).
+	 *
+	 * While the budget is exceeded, the readers stop decoding ahead and the playback cache stops caching
+	 * ahead (back-pressure), see IsOverBudget().
+	 *
+	 * With Settings::CACHE_BUDGET_MEMORY_PRESSURE (on Linux), the memory limit of the process' cgroup is
+	 * watched too: once the cgroup uses more than 90% of its limit, the caches are reduced by the excess
+	 * (even below the budget), until it uses less than 80% again.
+	 */
+	class CacheBudget {
+	private:
+		/// The size of a buffer, and the number of caches holding it
+		struct Buffer {
+			int64_t bytes = 0;
+			int64_t caches = 0;
+		};
+
+		std::mutex budgetMutex;
+		std::map<const void*, Buffer> buffers; ///< All buffers held by any cache
+		int64_t total_bytes = 0; ///< Total bytes of all buffers (each buffer is counted once)
+		int64_t pressure_max_bytes = 0; ///< The max bytes while the cgroup is under memory pressure (0 = none)
+		std::atomic<int64_t> ticks{0}; ///< Clock of the global LRU
+
+		std::mutex registryMutex;
+		std::set<CacheMemory*> caches; ///< All registered caches
+		std::mutex enforceMutex; ///< Only one thread evicts frames at a time
+
+		std::once_flag monitor_started; ///< The memory pressure monitor is started by the first cache (if enabled)
+
+		/// Private variable to keep track of singleton instance
+		static CacheBudget *m_pInstance;
+
+		/// Default constructor
+		CacheBudget() = default;
+
+		/// Don't allow the user to copy or assign this instance
+		CacheBudget(CacheBudget const&) = delete;
+		CacheBudget & operator=(CacheBudget const&) = delete;
+
+		/// Read the memory usage and limit of the process' cgroup (returns false if there is no limit)
+		static bool read_cgroup_memory(int64_t& usage, int64_t& limit);
+
+		/// Watch the memory pressure of the cgroup (the body of the monitor thread)
+		void monitor_pressure();
+
+	public:
+		/// The number of frames each cache keeps (even when the budget is exceeded)
+		static constexpr int64_t MIN_FRAMES = 8;
+
+		/// Create or get an instance of this singleton (invoke the class with this method)
+		static CacheBudget *Instance();
+
+		/// @brief Register a cache (so its frames can be evicted for the budget)
+		/// @param cache The cache (called by the CacheMemory constructor)
+		void Register(openshot::CacheMemory* cache);
+
+		/// @brief Unregister a cache (waiting for the frames being evicted, if any)
+		/// @param cache The cache (called by the CacheMemory destructor)
+		void Unregister(openshot::CacheMemory* cache);
+
+		/// @brief Count a buffer which was added to a cache (the first cache holding it adds its size)
+		/// @param buffer The address of the buffer
+		/// @param bytes The size of the buffer in bytes
+		void Reference(const void* buffer, int64_t bytes);
+
+		/// @brief Release a buffer which was removed from a cache (the last cache holding it removes its size)
+		/// @param buffer The address of the buffer
+		void Release(const void* buffer);
+
+		/// Is a buffer held by more than one cache?
+		bool IsShared(const void* buffer);
+
+		/// Get the next time of the global LRU clock (when a frame is added or used)
+		int64_t NextTick() { return ++ticks; };
+
+		/// Get the bytes held by all caches (buffers shared by several caches are counted once)
+		int64_t GetBytes();
+
+		/// Get the max bytes of all caches together (Settings::CACHE_BUDGET_MB, or less under memory
+		/// pressure, 0 = no limit)
+		int64_t GetMaxBytes();
+
+		/// Do all caches together hold more than the max bytes? (so no frames should be decoded or cached ahead)
+		bool IsOverBudget();
+
+		/// Evict frames across all caches, until they hold less than the max bytes (or no frame can be
+		/// evicted). Returns right away if another thread is evicting frames.
+		void Enforce();
+	};
+
+}
+
+#endif
@@ -13,7 +13,12 @@
 #include "CacheDisk.h"
 #include "Exceptions.h"
 #include "Frame.h"
+#include "PixelKernels.h"
 #include "QtUtilities.h"
+#include "Settings.h"
+
+#include <algorithm>
+#include <cmath>
 
 #include <Qt>
 #include <QString>
@@ -29,6 +34,7 @@ CacheDisk::CacheDisk(std::string cache_path, std::string format, float quality,
 	range_version = 0;
 	needs_range_processing = false;
 	frame_size_bytes = 0;
+	is_stopping = false;
 	image_format = format;
 	image_quality = quality;
 	image_scale = scale;
@@ -45,6 +51,7 @@ CacheDisk::CacheDisk(std::string cache_path, std::string format, float quality,
 	range_version = 0;
 	needs_range_processing = false;
 	frame_size_bytes = 0;
+	is_stopping = false;
 	image_format = format;
 	image_quality = quality;
 	image_scale = scale;
@@ -73,22 +80,173 @@ void CacheDisk::InitPath(std::string cache_path) {
 	if (!path.exists())
 		// Create
 		path.mkpath(qpath);
+
+	// Init segment files (for the RAW and LZ4 formats)
+	QString format = QString(image_format.c_str()).toLower();
+	if (format == "raw" || format == "lz4")
+		segment_store.reset(new CacheSegmentStore(path.path(), format == "lz4"));
+	else
+		segment_store.reset();
 }
 
 // Default destructor
 CacheDisk::~CacheDisk()
 {
+	// Stop background thread (frames which are not written yet are discarded)
+	{
+		const std::lock_guard<std::mutex> lock(writer_mutex);
+		is_stopping = true;
+		write_queue.clear();
+	}
+	writer_condition.notify_all();
+	if (writer_thread.joinable())
+		writer_thread.join();
+
 	Clear();
 
 	// remove mutex
 	delete cacheMutex;
 }
 
+// Get the path of a frame's image file
+QString CacheDisk::ImagePath(int64_t frame_number)
+{
+	return path.path() + "/" + QString("%1.").arg(frame_number) + QString(image_format.c_str()).toLower();
+}
+
+// Get the path of a frame's audio file
+QString CacheDisk::AudioPath(int64_t frame_number)
+{
+	return path.path() + "/" + QString("%1").arg(frame_number) + ".audio";
+}
+
+// Encode and write the image and audio files of a frame
+void CacheDisk::WriteFiles(std::shared_ptr<Frame> frame)
+{
+	// Save image to disk (if needed)
+	QString frame_path(ImagePath(frame->number));
+	frame->Save(frame_path.toStdString(), image_scale, image_format, image_quality);
+
+	// Save audio data (if needed)
+	if (frame->has_audio_data) {
+		QFile audio_file(AudioPath(frame->number));
+
+		if (audio_file.open(QIODevice::WriteOnly)) {
+			QTextStream audio_stream(&audio_file);
+			audio_stream << frame->SampleRate() << Qt::endl;
+			audio_stream << frame->GetAudioChannelsCount() << Qt::endl;
+			audio_stream << frame->GetAudioSamplesCount() << Qt::endl;
+			audio_stream << frame->ChannelsLayout() << Qt::endl;
+
+			// Loop through all samples
+			for (int channel = 0; channel < frame->GetAudioChannelsCount(); channel++)
+			{
+				// Get audio for this channel
+				float *samples = frame->GetAudioSamples(channel);
+				for (int sample = 0; sample < frame->GetAudioSamplesCount(); sample++)
+					audio_stream << samples[sample] << Qt::endl;
+			}
+
+		}
+
+	}
+}
+
+// Remove the image and audio files of a frame (if they exist)
+void CacheDisk::RemoveFiles(int64_t frame_number)
+{
+	// Remove the image file (if it exists)
+	QFile image_file(ImagePath(frame_number));
+	if (image_file.exists())
+		image_file.remove();
+
+	// Remove audio file (if it exists)
+	QFile audio_file(AudioPath(frame_number));
+	if (audio_file.exists())
+		audio_file.remove();
+}
+
+// Write queued frames to disk (runs on the background thread)
+void CacheDisk::WriterLoop()
+{
+	std::unique_lock<std::mutex> lock(writer_mutex);
+	while (true) {
+		writer_condition.wait(lock, [this] { return is_stopping || !write_queue.empty(); });
+		if (is_stopping)
+			break;
+
+		// Take the oldest added frame
+		std::shared_ptr<Frame> frame = write_queue.front();
+		write_queue.pop_front();
+		writing_frame = frame;
+
+		// Encode and write frame (without blocking Add or GetFrame)
+		lock.unlock();
+		try {
+			WriteFiles(frame);
+		} catch (...) { }
+		lock.lock();
+
+		if (writing_frame != frame) {
+			// The frame was removed while it was written, so the files are stale
+			RemoveFiles(frame->number);
+
+		} else if (frame_size_bytes == 0) {
+			// Get compressed size of frame image (to correctly apply max size against)
+			QFile image_file(ImagePath(frame->number));
+			frame_size_bytes = image_file.size();
+		}
+		writing_frame.reset();
+
+		// Wake up Add and WaitForWrites (if waiting)
+		writer_condition.notify_all();
+	}
+}
+
+// Find a frame which is waiting to be written to disk
+std::shared_ptr<Frame> CacheDisk::FindPendingFrame(int64_t frame_number)
+{
+	if (writing_frame && writing_frame->number == frame_number)
+		return writing_frame;
+
+	for (auto itr = write_queue.rbegin(); itr != write_queue.rend(); ++itr)
+		if ((*itr)->number == frame_number)
+			return *itr;
+
+	return std::shared_ptr<Frame>();
+}
+
+// Remove frames which are waiting to be written to disk
+void CacheDisk::RemovePendingFrames(int64_t start_frame_number, int64_t end_frame_number)
+{
+	// Cancel the frame being written (the background thread removes its files)
+	if (writing_frame && writing_frame->number >= start_frame_number && writing_frame->number <= end_frame_number)
+		writing_frame.reset();
+
+	write_queue.erase(std::remove_if(write_queue.begin(), write_queue.end(),
+		[=](const std::shared_ptr<Frame>& f) { return f->number >= start_frame_number && f->number <= end_frame_number; }),
+		write_queue.end());
+}
+
+// Wait until all added frames have been written to disk
+void CacheDisk::WaitForWrites()
+{
+	std::unique_lock<std::mutex> lock(writer_mutex);
+	writer_condition.wait(lock, [this] { return is_stopping || (write_queue.empty() && !writing_frame); });
+}
+
 // Add a Frame to the cache
 void CacheDisk::Add(std::shared_ptr<Frame> frame)
 {
+	// Wait for room in the write queue (before locking the cache, so frames can still be loaded meanwhile)
+	const size_t write_behind_frames = std::max(0, Settings::Instance()->CACHE_DISK_WRITE_BEHIND_FRAMES);
+	if (write_behind_frames > 0) {
+		std::unique_lock<std::mutex> lock(writer_mutex);
+		writer_condition.wait(lock, [&] { return is_stopping || write_queue.size() < write_behind_frames; });
+	}
+
 	// Create a scoped lock, to protect the cache from multiple threads
-	const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+	const ScopedLock lock(this);
 	int64_t frame_number = frame->number;
 
 	// Freshen frame if it already exists
@@ -103,39 +261,32 @@ void CacheDisk::Add(std::shared_ptr<Frame> frame)
 		frame_numbers.push_front(frame_number);
 		ordered_frame_numbers.push_back(frame_number);
 		needs_range_processing = true;
+		stats.insertions++;
 
-		// Save image to disk (if needed)
-		QString frame_path(path.path() + "/" + QString("%1.").arg(frame_number) + QString(image_format.c_str()).toLower());
-		frame->Save(frame_path.toStdString(), image_scale, image_format, image_quality);
-		if (frame_size_bytes == 0) {
-			// Get compressed size of frame image (to correctly apply max size against)
-			QFile image_file(frame_path);
-			frame_size_bytes = image_file.size();
-		}
-
-		// Save audio data (if needed)
-		if (frame->has_audio_data) {
-			QString audio_path(path.path() + "/" + QString("%1").arg(frame_number) + ".audio");
-			QFile audio_file(audio_path);
-
-			if (audio_file.open(QIODevice::WriteOnly)) {
-				QTextStream audio_stream(&audio_file);
-				audio_stream << frame->SampleRate() << Qt::endl;
-				audio_stream << frame->GetAudioChannelsCount() << Qt::endl;
-				audio_stream << frame->GetAudioSamplesCount() << Qt::endl;
-				audio_stream << frame->ChannelsLayout() << Qt::endl;
-
-				// Loop through all samples
-				for (int channel = 0; channel < frame->GetAudioChannelsCount(); channel++)
-				{
-					// Get audio for this channel
-					float *samples = frame->GetAudioSamples(channel);
-					for (int sample = 0; sample < frame->GetAudioSamplesCount(); sample++)
-						audio_stream << samples[sample] << Qt::endl;
-				}
+		if (segment_store) {
+			// Append image & audio to a segment file
+			if (!segment_store->Add(frame, image_scale))
+				// Unable to write to a segment file (i.e. disk is full), don't cache this frame
+				Remove(frame_number);
 
+		} else if (write_behind_frames > 0) {
+			// Queue frame, to be encoded and written by the background thread
+			{
+				const std::lock_guard<std::mutex> writer_lock(writer_mutex);
+				if (!writer_thread.joinable())
+					writer_thread = std::thread(&CacheDisk::WriterLoop, this);
+				write_queue.push_back(frame);
+			}
+			writer_condition.notify_all();
+
+		} else {
+			// Save image & audio to disk
+			WriteFiles(frame);
+			if (frame_size_bytes == 0) {
+				// Get compressed size of frame image (to correctly apply max size against)
+				QFile image_file(ImagePath(frame_number));
+				frame_size_bytes = image_file.size();
 			}
-
 		}
 
 		// Clean up old frames
@@ -145,6 +296,9 @@ void CacheDisk::Add(std::shared_ptr<Frame> frame)
 
 // Check if frame is already contained in cache
 bool CacheDisk::Contains(int64_t frame_number) {
+	// Create a scoped lock, to protect the cache from multiple threads
+	const ScopedLock lock(this);
+
 	if (frames.count(frame_number) > 0) {
 		return true;
 	} else {
@@ -156,20 +310,48 @@ bool CacheDisk::Contains(int64_t frame_number) {
 std::shared_ptr<Frame> CacheDisk::GetFrame(int64_t frame_number)
 {
 	// Create a scoped lock, to protect the cache from multiple threads
-	const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+	const ScopedLock lock(this);
 
 	// Does frame exists in cache?
-	if (frames.count(frame_number)) {
+	if (frames.count(frame_number) && segment_store) {
+		// Load frame from segment file
+		std::shared_ptr<Frame> frame = segment_store->GetFrame(frame_number);
+		if (frame)
+			stats.hits++;
+		else
+			stats.misses++;
+		return frame;
+
+	} else if (frames.count(frame_number)) {
+		// Is frame still waiting to be written to disk
+		std::shared_ptr<Frame> pending;
+		{
+			const std::lock_guard<std::mutex> writer_lock(writer_mutex);
+			pending = FindPendingFrame(frame_number);
+		}
+		if (pending) {
+			// Copy frame, scaled the same as the image file will be
+			auto frame = std::make_shared<Frame>(*pending);
+			if (fabs(image_scale) > 1.001 || fabs(image_scale) < 0.999) {
+				std::shared_ptr<QImage> image = pending->GetImage();
+				frame->AddImage(std::make_shared<QImage>(image->scaled(
+						image->width() * image_scale, image->height() * image_scale,
+						Qt::KeepAspectRatio, Qt::SmoothTransformation)));
+			}
+			stats.hits++;
+			return frame;
+		}
+
 		// Does frame exist on disk
-		QString frame_path(path.path() + "/" + QString("%1.").arg(frame_number) + QString(image_format.c_str()).toLower());
+		QString frame_path(ImagePath(frame_number));
 		if (path.exists(frame_path)) {
 
 			// Load image file
 			auto image = std::make_shared<QImage>();
 			image->load(frame_path);
 
-			// Set pixel formatimage->
-			image = std::make_shared<QImage>(image->convertToFormat(QImage::Format_RGBA8888_Premultiplied));
+			// Set pixel format
+			PixelKernels::ToPremultipliedRGBA(*image);
 
 			// Create frame object
 			auto frame = std::make_shared<Frame>();
@@ -177,8 +359,7 @@ std::shared_ptr<Frame> CacheDisk::GetFrame(int64_t frame_number)
 			frame->AddImage(image);
 
 			// Get audio data (if found)
-			QString audio_path(path.path() + "/" + QString("%1").arg(frame_number) + ".audio");
-			QFile audio_file(audio_path);
+			QFile audio_file(AudioPath(frame_number));
 			if (audio_file.exists()) {
 				// Open audio file
 				QTextStream in(&audio_file);
@@ -214,11 +395,13 @@ std::shared_ptr<Frame> CacheDisk::GetFrame(int64_t frame_number)
 			}
 
 			// return the Frame object
+			stats.hits++;
 			return frame;
 		}
 	}
 
 	// no Frame found
+	stats.misses++;
 	return std::shared_ptr<Frame>();
 }
 
@@ -226,7 +409,7 @@ std::shared_ptr<Frame> CacheDisk::GetFrame(int64_t frame_number)
 std::vector<std::shared_ptr<openshot::Frame>> CacheDisk::GetFrames()
 {
 	// Create a scoped lock, to protect the cache from multiple threads
-	const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+	const ScopedLock lock(this);
 
 	std::vector<std::shared_ptr<openshot::Frame>> all_frames;
 	std::vector<int64_t>::iterator itr_ordered;
@@ -243,7 +426,7 @@ std::vector<std::shared_ptr<openshot::Frame>> CacheDisk::GetFrames()
 std::shared_ptr<Frame> CacheDisk::GetSmallestFrame()
 {
 	// Create a scoped lock, to protect the cache from multiple threads
-	const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+	const ScopedLock lock(this);
 
 	// Loop through frame numbers
 	std::deque<int64_t>::iterator itr;
@@ -266,7 +449,11 @@ std::shared_ptr<Frame> CacheDisk::GetSmallestFrame()
 int64_t CacheDisk::GetBytes()
 {
 	// Create a scoped lock, to protect the cache from multiple threads
-	const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+	const ScopedLock lock(this);
+
+	// Segment files know the exact size of each frame
+	if (segment_store)
+		return segment_store->GetBytes();
 
 	int64_t  total_bytes = 0;
 
@@ -288,7 +475,13 @@ void CacheDisk::Remove(int64_t frame_number)
 void CacheDisk::Remove(int64_t start_frame_number, int64_t end_frame_number)
 {
 	// Create a scoped lock, to protect the cache from multiple threads
-	const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+	const ScopedLock lock(this);
+
+	// Don't write removed frames to disk
+	{
+		const std::lock_guard<std::mutex> writer_lock(writer_mutex);
+		RemovePendingFrames(start_frame_number, end_frame_number);
+	}
 
 	// Loop through frame numbers
 	std::deque<int64_t>::iterator itr;
@@ -312,17 +505,14 @@ void CacheDisk::Remove(int64_t start_frame_number, int64_t end_frame_number)
 			// erase frame number
 			frames.erase(*itr_ordered);
 
-			// Remove the image file (if it exists)
-			QString frame_path(path.path() + "/" + QString("%1.").arg(*itr_ordered) + QString(image_format.c_str()).toLower());
-			QFile image_file(frame_path);
-			if (image_file.exists())
-				image_file.remove();
+			if (segment_store) {
+				// Remove frame from segment files
+				segment_store->Remove(*itr_ordered);
 
-			// Remove audio file (if it exists)
-			QString audio_path(path.path() + "/" + QString("%1").arg(*itr_ordered) + ".audio");
-			QFile audio_file(audio_path);
-			if (audio_file.exists())
-				audio_file.remove();
+			} else {
+				// Remove the image & audio files (if they exist)
+				RemoveFiles(*itr_ordered);
+			}
 
 			itr_ordered = ordered_frame_numbers.erase(itr_ordered);
 		} else
@@ -340,7 +530,7 @@ void CacheDisk::MoveToFront(int64_t frame_number)
 	if (frames.count(frame_number))
 	{
 		// Create a scoped lock, to protect the cache from multiple threads
-		const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+		const ScopedLock lock(this);
 
 		// Loop through frame numbers
 		std::deque<int64_t>::iterator itr;
@@ -363,7 +553,16 @@ void CacheDisk::MoveToFront(int64_t frame_number)
 void CacheDisk::Clear()
 {
 	// Create a scoped lock, to protect the cache from multiple threads
-	const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+	const ScopedLock lock(this);
+
+	// Don't write any queued frames to disk (and wait for the frame being written)
+	{
+		std::unique_lock<std::mutex> writer_lock(writer_mutex);
+		write_queue.clear();
+		writer_condition.notify_all();
+		writer_condition.wait(writer_lock, [this] { return !writing_frame; });
+	}
+	frame_size_bytes = 0;
 
 	// Clear all containers
 	frames.clear();
@@ -372,7 +571,10 @@ void CacheDisk::Clear()
 	ordered_frame_numbers.clear();
 	ordered_frame_numbers.shrink_to_fit();
 	needs_range_processing = true;
-	frame_size_bytes = 0;
+
+	// Close and delete all segment files
+	if (segment_store)
+		segment_store->Clear();
 
 	// Delete cache directory, and recreate it
 	QString current_path = path.path();
@@ -386,7 +588,7 @@ void CacheDisk::Clear()
 int64_t CacheDisk::Count()
 {
 	// Create a scoped lock, to protect the cache from multiple threads
-	const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+	const ScopedLock lock(this);
 
 	// Return the number of frames in the cache
 	return frames.size();
@@ -399,7 +601,7 @@ void CacheDisk::CleanUp()
 	if (max_bytes > 0)
 	{
 		// Create a scoped lock, to protect the cache from multiple threads
-		const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+		const ScopedLock lock(this);
 
 		while (GetBytes() > max_bytes && frame_numbers.size() > 20)
 		{
@@ -407,7 +609,10 @@ void CacheDisk::CleanUp()
 			int64_t frame_to_remove = frame_numbers.back();
 
 			// Remove frame_number and frame
+			const int64_t previous_bytes = GetBytes();
 			Remove(frame_to_remove);
+			stats.evictions++;
+			stats.evicted_bytes += previous_bytes - GetBytes();
 		}
 	}
 }
@@ -416,7 +621,7 @@ void CacheDisk::CleanUp()
 std::string CacheDisk::Json() {
 
 	// Return formatted string
-	return JsonValue().toStyledString();
+	return openshot::jsonToString(JsonValue());
 }
 
 // Generate Json::Value for this object
@@ -435,12 +640,9 @@ Json::Value CacheDisk::JsonValue() {
 	range_version_str << range_version;
 	root["version"] = range_version_str.str();
 
-	// Parse and append range data (if any)
-	// Parse and append range data (if any)
-	try {
-		const Json::Value ranges = openshot::stringToJson(json_ranges);
-		root["ranges"] = ranges;
-	} catch (...) { }
+	// Append range data (if any)
+	if (!ranges_value.isNull())
+		root["ranges"] = ranges_value;
 
 	// return JsonValue
 	return root;
@@ -14,7 +14,14 @@
 #define OPENSHOT_CACHE_DISK_H
 
 #include "CacheBase.h"
-
+#include "CacheSegmentStore.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <QDir>
 
 namespace openshot {
@@ -26,6 +33,14 @@ namespace openshot {
 	 * It is used by the Timeline class, if enabled, to cache video and audio frames to disk, to cut down on CPU
 	 * and memory utilization. This will thrash a user's disk, but save their memory and CPU. It's a trade off that
 	 * sometimes makes perfect sense. You can also set the max number of bytes to cache.
+	 *
+	 * The "RAW" and "LZ4" formats store frames as raw premultiplied RGBA (LZ4 compressed, if libopenshot was
+	 * built with LZ4) in a few large memory-mapped segment files, instead of one image file (and audio file)
+	 * per frame. This avoids encoding, decoding and filesystem overhead, which is much faster for large caches.
+	 *
+	 * The image formats (PPM, JPG and PNG) are written behind: Add() only queues the frame, and a background
+	 * thread encodes and writes it to disk. Until then, the frame is loaded from the queue (see
+	 * Settings::CACHE_DISK_WRITE_BEHIND_FRAMES).
 	 */
 	class CacheDisk : public CacheBase {
 	private:
@@ -35,7 +50,15 @@ namespace openshot {
 		std::string image_format;
 		float image_quality;
 		float image_scale;
-		int64_t frame_size_bytes; ///< The size of the cached frame in bytes
+		std::atomic<int64_t> frame_size_bytes; ///< The size of the cached frame in bytes
+		std::unique_ptr<CacheSegmentStore> segment_store; ///< Memory-mapped segment files (for the RAW and LZ4 formats)
+
+		std::thread writer_thread; ///< Background thread, which writes added frames to disk (started by the first Add)
+		std::mutex writer_mutex;
+		std::condition_variable writer_condition;
+		std::deque<std::shared_ptr<openshot::Frame>> write_queue; ///< Added frames waiting to be written to disk
+		std::shared_ptr<openshot::Frame> writing_frame; ///< The frame being written to disk (if any)
+		bool is_stopping; ///< Stop the background thread
 
 		/// Clean up cached frames that exceed the max number of bytes
 		void CleanUp();
@@ -43,17 +66,38 @@ namespace openshot {
 		/// Init path directory
 		void InitPath(std::string cache_path);
 
+		/// Get the path of a frame's image file
+		QString ImagePath(int64_t frame_number);
+
+		/// Get the path of a frame's audio file
+		QString AudioPath(int64_t frame_number);
+
+		/// Encode and write the image and audio files of a frame
+		void WriteFiles(std::shared_ptr<openshot::Frame> frame);
+
+		/// Remove the image and audio files of a frame (if they exist)
+		void RemoveFiles(int64_t frame_number);
+
+		/// Write queued frames to disk (runs on the background thread)
+		void WriterLoop();
+
+		/// Find a frame which is waiting to be written to disk (writer_mutex must be locked)
+		std::shared_ptr<openshot::Frame> FindPendingFrame(int64_t frame_number);
+
+		/// Remove frames which are waiting to be written to disk (writer_mutex must be locked)
+		void RemovePendingFrames(int64_t start_frame_number, int64_t end_frame_number);
+
 	public:
 		/// @brief Default constructor, no max bytes
 		/// @param cache_path The folder path of the cache directory (empty string = /tmp/preview-cache/)
-		/// @param format The image format for disk caching (ppm, jpg, png)
+		/// @param format The image format for disk caching (ppm, jpg, png, or raw / lz4 for segment files)
 		/// @param quality The quality of the image (1.0=highest quality/slowest speed, 0.0=worst quality/fastest speed)
 		/// @param scale The scale factor for the preview images (1.0 = original size, 0.5=half size, 0.25=quarter size, etc...)
 		CacheDisk(std::string cache_path, std::string format, float quality, float scale);
 
 		/// @brief Constructor that sets the max bytes to cache
 		/// @param cache_path The folder path of the cache directory (empty string = /tmp/preview-cache/)
-		/// @param format The image format for disk caching (ppm, jpg, png)
+		/// @param format The image format for disk caching (ppm, jpg, png, or raw / lz4 for segment files)
 		/// @param quality The quality of the image (1.0=highest quality/slowest speed, 0.0=worst quality/fastest speed)
 		/// @param scale The scale factor for the preview images (1.0 = original size, 0.5=half size, 0.25=quarter size, etc...)
 		/// @param max_bytes The maximum bytes to allow in the cache. Once exceeded, the cache will purge the oldest frames.
@@ -89,6 +133,9 @@ namespace openshot {
 		/// Get the smallest frame number
 		std::shared_ptr<openshot::Frame> GetSmallestFrame();
 
+		/// Wait until all added frames have been written to disk
+		void WaitForWrites();
+
 		/// @brief Move frame to front of queue (so it lasts longer)
 		/// @param frame_number The frame number of the cached frame
 		void MoveToFront(int64_t frame_number);
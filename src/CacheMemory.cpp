@@ -11,31 +11,133 @@
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
 #include "CacheMemory.h"
+#include "CacheBudget.h"
 #include "Exceptions.h"
 #include "Frame.h"
+#include "ImageBufferPool.h"
+#include "RenderStats.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#if USE_LZ4
+#include <lz4.h>
+#endif
 
 using namespace std;
 using namespace openshot;
 
+namespace openshot {
+	/// A cold frame of a CacheMemory, with its image compressed (and a copy of its audio)
+	struct CacheMemoryCompressedFrame {
+		int width;
+		int height;
+		int pixel_ratio_num;
+		int pixel_ratio_den;
+		std::vector<char> image; ///< The LZ4 compressed RGBA8888 (premultiplied) pixels
+		int sample_rate;
+		int channels;
+		int samples;
+		int channel_layout;
+		std::vector<float> audio; ///< The samples of each channel (one channel after another)
+
+		/// The bytes used by this frame
+		int64_t Bytes() const { return image.size() + audio.size() * sizeof(float); }
+	};
+}
+
+// Compress the image of a frame (or return nullptr, if it can't be compressed, or doesn't get smaller)
+static std::shared_ptr<CacheMemoryCompressedFrame> compress_frame(std::shared_ptr<Frame> frame)
+{
+#if USE_LZ4
+	// Solid color frames have no pixels to compress
+	if (frame->GetSolidColor().isValid())
+		return nullptr;
+
+	std::shared_ptr<QImage> image = frame->GetImage();
+	if (!image || image->isNull() || image->format() != QImage::Format_RGBA8888_Premultiplied)
+		return nullptr;
+	const int64_t raw_image_bytes = int64_t(image->width()) * image->height() * 4;
+	if (raw_image_bytes > LZ4_MAX_INPUT_SIZE)
+		return nullptr;
+
+	auto compressed = std::make_shared<CacheMemoryCompressedFrame>();
+	compressed->width = image->width();
+	compressed->height = image->height();
+	compressed->pixel_ratio_num = frame->GetPixelRatio().num;
+	compressed->pixel_ratio_den = frame->GetPixelRatio().den;
+
+	// Compress the pixels (scanlines of RGBA8888 have no padding)
+	compressed->image.resize(LZ4_compressBound((int) raw_image_bytes));
+	const int compressed_bytes = LZ4_compress_default((const char *) image->constBits(), compressed->image.data(),
+		(int) raw_image_bytes, (int) compressed->image.size());
+	if (compressed_bytes <= 0 || compressed_bytes >= raw_image_bytes)
+		return nullptr;
+	compressed->image.resize(compressed_bytes);
+	compressed->image.shrink_to_fit();
+
+	// Copy the audio
+	compressed->sample_rate = frame->SampleRate();
+	compressed->channels = frame->has_audio_data ? frame->GetAudioChannelsCount() : 0;
+	compressed->samples = frame->has_audio_data ? frame->GetAudioSamplesCount() : 0;
+	compressed->channel_layout = frame->ChannelsLayout();
+	compressed->audio.resize(int64_t(compressed->channels) * compressed->samples);
+	for (int channel = 0; channel < compressed->channels; channel++)
+		std::memcpy(compressed->audio.data() + int64_t(channel) * compressed->samples,
+			frame->GetAudioSamples(channel), compressed->samples * sizeof(float));
+	return compressed;
+#else
+	return nullptr;
+#endif
+}
+
+// Create a new frame from a compressed frame
+static std::shared_ptr<Frame> decompress_frame(int64_t frame_number, const CacheMemoryCompressedFrame& compressed)
+{
+	auto frame = std::make_shared<Frame>();
+	frame->number = frame_number;
+	frame->SetPixelRatio(compressed.pixel_ratio_num, compressed.pixel_ratio_den);
+
+#if USE_LZ4
+	std::shared_ptr<QImage> image = ImageBufferPool::Instance()->CreateImage(compressed.width, compressed.height, QImage::Format_RGBA8888_Premultiplied);
+	LZ4_decompress_safe(compressed.image.data(), (char *) image->bits(), (int) compressed.image.size(),
+		(int) (int64_t(compressed.width) * compressed.height * 4));
+	frame->AddImage(image);
+#endif
+
+	if (compressed.channels > 0) {
+		frame->ResizeAudio(compressed.channels, compressed.samples, compressed.sample_rate, (ChannelLayout) compressed.channel_layout);
+		for (int channel = 0; channel < compressed.channels; channel++)
+			frame->AddAudio(true, channel, 0, compressed.audio.data() + int64_t(channel) * compressed.samples, compressed.samples, 1.0);
+	}
+	return frame;
+}
+
 // Default constructor, no max bytes
-CacheMemory::CacheMemory() : CacheBase(0) {
+CacheMemory::CacheMemory() : CacheBase(0), total_bytes(0), eviction_policy(CACHE_EVICT_LRU), hot_frames(0), budget_priority(0),
+	min_frames(20), lookup_requested(false), lookup_active(false) {
 	// Set cache type name
 	cache_type = "CacheMemory";
 	range_version = 0;
 	needs_range_processing = false;
+	CacheBudget::Instance()->Register(this);
 }
 
 // Constructor that sets the max bytes to cache
-CacheMemory::CacheMemory(int64_t max_bytes) : CacheBase(max_bytes) {
+CacheMemory::CacheMemory(int64_t max_bytes) : CacheBase(max_bytes), total_bytes(0), eviction_policy(CACHE_EVICT_LRU), hot_frames(0), budget_priority(0),
+	min_frames(20), lookup_requested(false), lookup_active(false) {
 	// Set cache type name
 	cache_type = "CacheMemory";
 	range_version = 0;
 	needs_range_processing = false;
+	CacheBudget::Instance()->Register(this);
 }
 
 // Default destructor
 CacheMemory::~CacheMemory()
 {
+	CacheBudget::Instance()->Unregister(this);
 	Clear();
 
 	// remove mutex
@@ -45,66 +147,144 @@ CacheMemory::~CacheMemory()
 // Add a Frame to the cache
 void CacheMemory::Add(std::shared_ptr<Frame> frame)
 {
-	// Create a scoped lock, to protect the cache from multiple threads
-	const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
-	int64_t frame_number = frame->number;
-
-	// Freshen frame if it already exists
-	if (frames.count(frame_number))
-		// Move frame to front of queue
-		MoveToFront(frame_number);
-
-	else
 	{
-		// Add frame to queue and map
-		frames[frame_number] = frame;
-		frame_numbers.push_front(frame_number);
-		ordered_frame_numbers.push_back(frame_number);
-		needs_range_processing = true;
-
-		// Clean up old frames
-		CleanUp();
+		// Create a scoped lock, to protect the cache from multiple threads
+		const ScopedLock lock(this);
+		int64_t frame_number = frame->number;
+
+		// Freshen frame if it already exists
+		auto existing = frames.find(frame_number);
+		if (existing != frames.end()) {
+			// Move frame to front of queue (refreshing a frame is not a use of it)
+			Touch(existing->second, false);
+			existing->second.last_used = CacheBudget::Instance()->NextTick();
+
+			// Refresh the buffers of the frame (since images and audio are often added after caching), and
+			// keep it uncompressed while it changes
+			RemoveBuffers(existing->second);
+			if (existing->second.compressed) {
+				existing->second.compressed.reset();
+				existing->second.frame = frame;
+			}
+			existing->second.buffers = existing->second.frame->GetBuffers();
+			AddBuffers(existing->second);
+			MakeHot(frame_number, existing->second);
+			Publish(frame_number, existing->second);
+		}
+		else
+		{
+			// Add frame to queue and map (frames which were evicted recently are used again, and protected)
+			CacheMemoryEntry& entry = frames[frame_number];
+			entry = CacheMemoryEntry{frame, frame_numbers.end(), frame->GetBuffers()};
+			entry.last_used = CacheBudget::Instance()->NextTick();
+			auto ghost = std::find(ghost_numbers.begin(), ghost_numbers.end(), frame_number);
+			if (ghost != ghost_numbers.end()) {
+				ghost_numbers.erase(ghost);
+				protected_numbers.push_front(frame_number);
+				entry.position = protected_numbers.begin();
+				entry.is_protected = true;
+			} else {
+				frame_numbers.push_front(frame_number);
+				entry.position = frame_numbers.begin();
+			}
+			AddBuffers(entry);
+			MakeHot(frame_number, entry);
+			Publish(frame_number, entry);
+			AddRange(frame_number);
+			stats.insertions++;
+		}
 	}
+
+	// Compress older frames (without holding the lock while compressing), and clean up old frames
+	CompressColdFrames();
+	CleanUp();
 }
 
 // Check if frame is already contained in cache
 bool CacheMemory::Contains(int64_t frame_number) {
-	if (frames.count(frame_number) > 0) {
+	// Published frames are found without locking (see SetLockFreeLookup)
+	if (Lookup(frame_number))
 		return true;
-	} else {
-		return false;
-	}
+
+	// Create a scoped lock, to protect the cache from multiple threads
+	const ScopedLock lock(this);
+
+	return frames.count(frame_number) > 0;
 }
 
 // Get a frame from the cache (or NULL shared_ptr if no frame is found)
 std::shared_ptr<Frame> CacheMemory::GetFrame(int64_t frame_number)
 {
-	// Create a scoped lock, to protect the cache from multiple threads
-	const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+	RenderStageTimer timer(RENDER_STAGE_CACHE);
+
+	// Published frames are found without locking (see SetLockFreeLookup)
+	std::shared_ptr<CacheMemoryLookup> hit = Lookup(frame_number);
+	if (hit) {
+		stats.hits++;
+		hit->last_used = CacheBudget::Instance()->NextTick();
+		return hit->frame;
+	}
 
-	// Does frame exists in cache?
-	if (frames.count(frame_number))
-		// return the Frame object
-		return frames[frame_number];
+	std::shared_ptr<CacheMemoryCompressedFrame> compressed;
+	{
+		// Create a scoped lock, to protect the cache from multiple threads
+		const ScopedLock lock(this);
+
+		// Does frame exists in cache?
+		auto existing = frames.find(frame_number);
+		if (existing == frames.end()) {
+			// no Frame found
+			stats.misses++;
+			return std::shared_ptr<Frame>();
+		}
 
-	else
-		// no Frame found
-		return std::shared_ptr<Frame>();
+		stats.hits++;
+		existing->second.last_used = CacheBudget::Instance()->NextTick();
+		if (eviction_policy == CACHE_EVICT_2Q)
+			Touch(existing->second, true);
+		if (!existing->second.compressed) {
+			// return the Frame object
+			MakeHot(frame_number, existing->second);
+			return existing->second.frame;
+		}
+		compressed = existing->second.compressed;
+	}
+
+	// Decompress the frame (without holding the lock)
+	std::shared_ptr<Frame> frame = decompress_frame(frame_number, *compressed);
+	{
+		const ScopedLock lock(this);
+
+		// Keep the decompressed frame (unless the frame was replaced or removed meanwhile)
+		auto existing = frames.find(frame_number);
+		if (existing != frames.end() && existing->second.compressed == compressed) {
+			RemoveBuffers(existing->second);
+			existing->second.compressed.reset();
+			existing->second.frame = frame;
+			existing->second.buffers = frame->GetBuffers();
+			AddBuffers(existing->second);
+			MakeHot(frame_number, existing->second);
+			Publish(frame_number, existing->second);
+		}
+	}
+
+	// The frame is hot again, so compress the coldest frame (and clean up, since it has grown)
+	CompressColdFrames();
+	CleanUp();
+	return frame;
 }
 
 // @brief Get an array of all Frames
 std::vector<std::shared_ptr<openshot::Frame>> CacheMemory::GetFrames()
 {
 	// Create a scoped lock, to protect the cache from multiple threads
-	const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+	const ScopedLock lock(this);
 
+	// Frames are sorted by frame number
 	std::vector<std::shared_ptr<openshot::Frame>> all_frames;
-	std::vector<int64_t>::iterator itr_ordered;
-	for(itr_ordered = ordered_frame_numbers.begin(); itr_ordered != ordered_frame_numbers.end(); ++itr_ordered)
-	{
-		int64_t frame_number = *itr_ordered;
-		all_frames.push_back(GetFrame(frame_number));
-	}
+	all_frames.reserve(frames.size());
+	for (const auto& entry : frames)
+		all_frames.push_back(EntryFrame(entry.first, entry.second));
 
 	return all_frames;
 }
@@ -113,20 +293,11 @@ std::vector<std::shared_ptr<openshot::Frame>> CacheMemory::GetFrames()
 std::shared_ptr<Frame> CacheMemory::GetSmallestFrame()
 {
 	// Create a scoped lock, to protect the cache from multiple threads
-	const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
-
-	// Loop through frame numbers
-	std::deque<int64_t>::iterator itr;
-	int64_t smallest_frame = -1;
-	for(itr = frame_numbers.begin(); itr != frame_numbers.end(); ++itr)
-	{
-		if (*itr < smallest_frame || smallest_frame == -1)
-			smallest_frame = *itr;
-	}
+	const ScopedLock lock(this);
 
 	// Return frame (if any)
-	if (smallest_frame != -1) {
-		return frames[smallest_frame];
+	if (!frames.empty()) {
+		return EntryFrame(frames.begin()->first, frames.begin()->second);
 	} else {
 		return NULL;
 	}
@@ -136,18 +307,52 @@ std::shared_ptr<Frame> CacheMemory::GetSmallestFrame()
 int64_t CacheMemory::GetBytes()
 {
 	// Create a scoped lock, to protect the cache from multiple threads
-	const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+	const ScopedLock lock(this);
 
-	int64_t total_bytes = 0;
+	return total_bytes;
+}
 
-	// Loop through frames, and calculate total bytes
-	std::deque<int64_t>::reverse_iterator itr;
-	for(itr = frame_numbers.rbegin(); itr != frame_numbers.rend(); ++itr)
-	{
-		total_bytes += frames[*itr]->GetBytes();
+// Count the buffers of a cached frame
+void CacheMemory::AddBuffers(const CacheMemoryEntry& entry)
+{
+	for (const auto& buffer : entry.buffers) {
+		CacheMemoryBuffer& cached_buffer = buffers[buffer.first];
+		if (cached_buffer.references++ == 0) {
+			// First frame using this buffer
+			cached_buffer.bytes = buffer.second;
+			total_bytes += buffer.second;
+			CacheBudget::Instance()->Reference(buffer.first, buffer.second);
+		}
 	}
+}
 
-	return total_bytes;
+// Release the buffers of a cached frame
+void CacheMemory::RemoveBuffers(const CacheMemoryEntry& entry)
+{
+	for (const auto& buffer : entry.buffers) {
+		auto cached_buffer = buffers.find(buffer.first);
+		if (cached_buffer != buffers.end() && --cached_buffer->second.references == 0) {
+			// Last frame using this buffer
+			total_bytes -= cached_buffer->second.bytes;
+			CacheBudget::Instance()->Release(cached_buffer->first);
+			buffers.erase(cached_buffer);
+		}
+	}
+}
+
+// Remove a frame (and its bookkeeping), and return the next entry
+std::map<int64_t, CacheMemoryEntry>::iterator CacheMemory::RemoveEntry(std::map<int64_t, CacheMemoryEntry>::iterator entry)
+{
+	if (entry->second.is_protected)
+		protected_numbers.erase(entry->second.position);
+	else
+		frame_numbers.erase(entry->second.position);
+	if (entry->second.is_hot)
+		hot_numbers.erase(entry->second.hot_position);
+	Unpublish(entry->first, entry->second);
+	RemoveBuffers(entry->second);
+	RemoveRange(entry->first);
+	return frames.erase(entry);
 }
 
 // Remove a specific frame
@@ -160,82 +365,269 @@ void CacheMemory::Remove(int64_t frame_number)
 void CacheMemory::Remove(int64_t start_frame_number, int64_t end_frame_number)
 {
 	// Create a scoped lock, to protect the cache from multiple threads
-	const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+	const ScopedLock lock(this);
 
-	// Loop through frame numbers
-	std::deque<int64_t>::iterator itr;
-	for(itr = frame_numbers.begin(); itr != frame_numbers.end();)
-	{
-		if (*itr >= start_frame_number && *itr <= end_frame_number)
-		{
-			// erase frame number
-			itr = frame_numbers.erase(itr);
-		}else
-			itr++;
+	// Loop through the (sorted) frames in this range only
+	auto itr = frames.lower_bound(start_frame_number);
+	while (itr != frames.end() && itr->first <= end_frame_number)
+		itr = RemoveEntry(itr);
+}
+
+// Move frame to front of queue (so it lasts longer)
+void CacheMemory::MoveToFront(int64_t frame_number)
+{
+	// Create a scoped lock, to protect the cache from multiple threads
+	const ScopedLock lock(this);
+
+	// Does frame exists in cache?
+	auto existing = frames.find(frame_number);
+	if (existing != frames.end()) {
+		// Move frame number to 'front' of queue
+		Touch(existing->second, true);
+		existing->second.last_used = CacheBudget::Instance()->NextTick();
 	}
+}
 
-	// Loop through ordered frame numbers
-	std::vector<int64_t>::iterator itr_ordered;
-	for(itr_ordered = ordered_frame_numbers.begin(); itr_ordered != ordered_frame_numbers.end();)
-	{
-		if (*itr_ordered >= start_frame_number && *itr_ordered <= end_frame_number)
-		{
-			// erase frame number
-			frames.erase(*itr_ordered);
-			itr_ordered = ordered_frame_numbers.erase(itr_ordered);
-		}else
-			itr_ordered++;
+// Move a frame to the front of its list (or into the protected list)
+void CacheMemory::Touch(CacheMemoryEntry& entry, bool promote)
+{
+	if (entry.is_protected) {
+		protected_numbers.splice(protected_numbers.begin(), protected_numbers, entry.position);
+	} else if (promote && eviction_policy == CACHE_EVICT_2Q) {
+		// The frame is used again (so it is no longer a candidate of a scan)
+		protected_numbers.splice(protected_numbers.begin(), frame_numbers, entry.position);
+		entry.is_protected = true;
+	} else {
+		frame_numbers.splice(frame_numbers.begin(), frame_numbers, entry.position);
+	}
+}
+
+// Set which frames are evicted first
+void CacheMemory::SetEvictionPolicy(CacheEvictionPolicy policy)
+{
+	// Create a scoped lock, to protect the cache from multiple threads
+	const ScopedLock lock(this);
+
+	// Only 2Q uses the protected frames (which are the most recently used)
+	if (policy != CACHE_EVICT_2Q) {
+		for (auto& entry : frames)
+			entry.second.is_protected = false;
+		frame_numbers.splice(frame_numbers.begin(), protected_numbers);
+		ghost_numbers.clear();
 	}
+	eviction_policy = policy;
+	UpdateLookup();
+}
+
+// Set the number of frames which are kept, even if they exceed the max bytes
+void CacheMemory::SetMinFrames(int64_t number_of_frames)
+{
+	// Create a scoped lock, to protect the cache from multiple threads
+	const ScopedLock lock(this);
 
-	// Needs range processing (since cache has changed)
-	needs_range_processing = true;
+	min_frames = std::max<int64_t>(0, number_of_frames);
 }
 
-// Move frame to front of queue (so it lasts longer)
-void CacheMemory::MoveToFront(int64_t frame_number)
+// Find cached frames without locking the cache
+void CacheMemory::SetLockFreeLookup(bool enabled)
 {
 	// Create a scoped lock, to protect the cache from multiple threads
-	const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+	const ScopedLock lock(this);
 
-	// Does frame exists in cache?
-	if (frames.count(frame_number))
-	{
-		// Loop through frame numbers
-		std::deque<int64_t>::iterator itr;
-		for(itr = frame_numbers.begin(); itr != frame_numbers.end(); ++itr)
-		{
-			if (*itr == frame_number)
-			{
-				// erase frame number
-				frame_numbers.erase(itr);
+	lookup_requested = enabled;
+	if (enabled && !lookup_slots)
+		lookup_slots.reset(new std::shared_ptr<CacheMemoryLookup>[LOOKUP_SLOTS]);
+	UpdateLookup();
+}
 
-				// add frame number to 'front' of queue
-				frame_numbers.push_front(frame_number);
-				break;
+// Publish all frames (or clear the lookup table)
+void CacheMemory::UpdateLookup()
+{
+	if (!lookup_slots)
+		return;
+
+	// Stop lock-free lookups first (so they don't find frames which are no longer maintained)
+	const bool active = lookup_requested && eviction_policy != CACHE_EVICT_2Q;
+	lookup_active = false;
+	for (auto& entry : frames)
+		Unpublish(entry.first, entry.second);
+	lookup_active = active;
+	for (auto& entry : frames)
+		Publish(entry.first, entry.second);
+}
+
+// Add (or replace) the lookup record of an uncompressed frame
+void CacheMemory::Publish(int64_t frame_number, CacheMemoryEntry& entry)
+{
+	if (!lookup_active || entry.compressed || !entry.frame) {
+		Unpublish(frame_number, entry);
+		return;
+	}
+
+	// The record is replaced, since readers may hold the previous one (frames which map to the same slot
+	// replace each other, and the replaced frame is found with the lock)
+	auto record = std::make_shared<CacheMemoryLookup>();
+	record->number = frame_number;
+	record->frame = entry.frame;
+	record->last_used = entry.lookup ? std::max(entry.last_used, entry.lookup->last_used.load()) : entry.last_used;
+	entry.lookup = record;
+	std::atomic_store(&lookup_slots[frame_number & (LOOKUP_SLOTS - 1)], record);
+}
+
+// Remove the lookup record of a frame
+void CacheMemory::Unpublish(int64_t frame_number, CacheMemoryEntry& entry)
+{
+	if (!entry.lookup)
+		return;
+
+	std::shared_ptr<CacheMemoryLookup>& slot = lookup_slots[frame_number & (LOOKUP_SLOTS - 1)];
+	if (std::atomic_load(&slot) == entry.lookup)
+		std::atomic_store(&slot, std::shared_ptr<CacheMemoryLookup>());
+	entry.last_used = std::max(entry.last_used, entry.lookup->last_used.load());
+	entry.lookup.reset();
+}
+
+// Find the lookup record of a frame without locking the cache
+std::shared_ptr<CacheMemoryLookup> CacheMemory::Lookup(int64_t frame_number)
+{
+	if (!lookup_active)
+		return nullptr;
+
+	std::shared_ptr<CacheMemoryLookup> record = std::atomic_load(&lookup_slots[frame_number & (LOOKUP_SLOTS - 1)]);
+	if (record && record->number == frame_number)
+		return record;
+	return nullptr;
+}
+
+// Compress the frames which were not used recently (keeping the most recently used frames uncompressed)
+void CacheMemory::SetCompression(bool enabled, int64_t hot)
+{
+	{
+		// Create a scoped lock, to protect the cache from multiple threads
+		const ScopedLock lock(this);
+
+		for (auto& entry : frames)
+			entry.second.is_hot = false;
+		hot_numbers.clear();
+		hot_frames = enabled ? std::max(int64_t(1), hot) : 0;
+		if (!enabled)
+			return;
+
+		// The uncompressed frames are hot (from the most to the least recently used)
+		for (const auto& numbers : {&protected_numbers, &frame_numbers})
+			for (int64_t frame_number : *numbers) {
+				CacheMemoryEntry& entry = frames[frame_number];
+				if (!entry.compressed) {
+					hot_numbers.push_back(frame_number);
+					entry.hot_position = std::prev(hot_numbers.end());
+					entry.is_hot = true;
+				}
 			}
+	}
+	CompressColdFrames();
+}
+
+// Mark a frame as the most recently used uncompressed frame
+void CacheMemory::MakeHot(int64_t frame_number, CacheMemoryEntry& entry)
+{
+	if (hot_frames <= 0)
+		return;
+	if (entry.is_hot) {
+		hot_numbers.splice(hot_numbers.begin(), hot_numbers, entry.hot_position);
+	} else {
+		hot_numbers.push_front(frame_number);
+		entry.hot_position = hot_numbers.begin();
+		entry.is_hot = true;
+	}
+}
+
+// Compress the least recently used frames, until only the hot frames are uncompressed
+void CacheMemory::CompressColdFrames()
+{
+	while (true) {
+		int64_t frame_number;
+		std::shared_ptr<Frame> frame;
+		std::vector<std::pair<const void*, int64_t>> frame_buffers;
+		{
+			// Create a scoped lock, to protect the cache from multiple threads
+			const ScopedLock lock(this);
+			if (hot_frames <= 0 || int64_t(hot_numbers.size()) <= hot_frames)
+				return;
+
+			// The least recently used uncompressed frame
+			frame_number = hot_numbers.back();
+			hot_numbers.pop_back();
+			CacheMemoryEntry& entry = frames[frame_number];
+			entry.is_hot = false;
+
+			// Frames which share their buffers with other cached frames stay uncompressed (compressing
+			// them would not free any memory)
+			bool shared = false;
+			for (const auto& buffer : entry.buffers)
+				shared = shared || buffers[buffer.first].references > 1;
+			if (shared)
+				continue;
+			frame = entry.frame;
+			frame_buffers = entry.buffers;
 		}
+
+		// Compress the frame (without holding the lock), unless it was changed since it was cached
+		if (frame->GetBuffers() != frame_buffers)
+			continue;
+		std::shared_ptr<CacheMemoryCompressedFrame> compressed = compress_frame(frame);
+		if (!compressed)
+			continue;
+
+		// Replace the frame (unless it was used, changed or removed meanwhile)
+		const ScopedLock lock(this);
+		auto existing = frames.find(frame_number);
+		if (existing == frames.end() || existing->second.is_hot || existing->second.compressed ||
+			existing->second.frame != frame || existing->second.buffers != frame_buffers)
+			continue;
+		Unpublish(frame_number, existing->second);
+		RemoveBuffers(existing->second);
+		existing->second.frame.reset();
+		existing->second.compressed = compressed;
+		existing->second.buffers = {{compressed.get(), compressed->Bytes()}};
+		AddBuffers(existing->second);
 	}
 }
 
+// Get the frame of an entry (decompressing it, if needed)
+std::shared_ptr<Frame> CacheMemory::EntryFrame(int64_t frame_number, const CacheMemoryEntry& entry)
+{
+	if (entry.compressed)
+		return decompress_frame(frame_number, *entry.compressed);
+	return entry.frame;
+}
+
 // Clear the cache of all frames
 void CacheMemory::Clear()
 {
 	// Create a scoped lock, to protect the cache from multiple threads
-	const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+	const ScopedLock lock(this);
 
+	if (lookup_slots) {
+		for (int64_t slot = 0; slot < LOOKUP_SLOTS; slot++)
+			std::atomic_store(&lookup_slots[slot], std::shared_ptr<CacheMemoryLookup>());
+	}
 	frames.clear();
 	frame_numbers.clear();
-	frame_numbers.shrink_to_fit();
-	ordered_frame_numbers.clear();
-	ordered_frame_numbers.shrink_to_fit();
-	needs_range_processing = true;
+	protected_numbers.clear();
+	ghost_numbers.clear();
+	hot_numbers.clear();
+	for (const auto& buffer : buffers)
+		CacheBudget::Instance()->Release(buffer.first);
+	buffers.clear();
+	ClearRanges();
+	total_bytes = 0;
 }
 
 // Count the frames in the queue
 int64_t CacheMemory::Count()
 {
 	// Create a scoped lock, to protect the cache from multiple threads
-	const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+	const ScopedLock lock(this);
 
 	// Return the number of frames in the cache
 	return frames.size();
@@ -248,17 +640,120 @@ void CacheMemory::CleanUp()
 	if (max_bytes > 0)
 	{
 		// Create a scoped lock, to protect the cache from multiple threads
-		const std::lock_guard<std::recursive_mutex> lock(*cacheMutex);
+		const ScopedLock lock(this);
 
-		while (GetBytes() > max_bytes && frame_numbers.size() > 20)
-		{
-			// Get the oldest frame number.
-			int64_t frame_to_remove = frame_numbers.back();
+		while (total_bytes > max_bytes && int64_t(frames.size()) > min_frames)
+			Evict(EvictionCandidate());
+	}
+
+	// Evict frames across all caches, if they exceed their budget together (without holding this cache's lock)
+	CacheBudget *budget = CacheBudget::Instance();
+	if (budget->IsOverBudget())
+		budget->Enforce();
+}
+
+// Remove the next frame (and pass it to the eviction callback, if any)
+void CacheMemory::Evict(std::map<int64_t, CacheMemoryEntry>::iterator candidate)
+{
+	std::shared_ptr<Frame> evicted_frame;
+	if (eviction_callback)
+		evicted_frame = EntryFrame(candidate->first, candidate->second);
+	const int64_t previous_bytes = total_bytes;
+	RemoveEntry(candidate);
+	stats.evictions++;
+	stats.evicted_bytes += previous_bytes - total_bytes;
+	if (eviction_callback)
+		eviction_callback(evicted_frame);
+}
+
+// Would removing a cached frame free any memory?
+bool CacheMemory::FreesMemory(const CacheMemoryEntry& entry)
+{
+	// The frame is still used outside of this cache (i.e. by another cache, or a clip being rendered). The
+	// lookup record of the frame (if any) holds it too.
+	if (entry.frame && entry.frame.use_count() > (entry.lookup ? 2 : 1))
+		return false;
+
+	// At least one buffer is only held by this frame
+	for (const auto& buffer : entry.buffers) {
+		if (buffer.second > 0 && buffers[buffer.first].references == 1 && !CacheBudget::Instance()->IsShared(buffer.first))
+			return true;
+	}
+	return false;
+}
+
+// Find the next frame to evict for the budget of all caches
+bool CacheMemory::BudgetCandidate(int64_t& last_used)
+{
+	// Create a scoped lock, to protect the cache from multiple threads
+	const ScopedLock lock(this);
 
-			// Remove frame_number and frame
-			Remove(frame_to_remove);
+	if (int64_t(frames.size()) <= CacheBudget::MIN_FRAMES)
+		return false;
+	auto candidate = EvictionCandidate(false);
+	if (!FreesMemory(candidate->second))
+		return false;
+	last_used = candidate->second.last_used;
+	if (candidate->second.lookup)
+		last_used = std::max(last_used, candidate->second.lookup->last_used.load());
+	return true;
+}
+
+// Evict the next frame for the budget of all caches
+bool CacheMemory::EvictForBudget()
+{
+	// Create a scoped lock, to protect the cache from multiple threads
+	const ScopedLock lock(this);
+
+	if (int64_t(frames.size()) <= CacheBudget::MIN_FRAMES || !FreesMemory(EvictionCandidate(false)->second))
+		return false;
+	Evict(EvictionCandidate());
+	return true;
+}
+
+// Choose the next frame to evict
+std::map<int64_t, CacheMemoryEntry>::iterator CacheMemory::EvictionCandidate(bool evicted)
+{
+	const int64_t playhead = playhead_frame;
+	if (eviction_policy == CACHE_EVICT_PLAYHEAD && playhead > 0) {
+		// The farthest frame is the first or the last frame (frames behind the playhead count double,
+		// since they are less likely to be displayed again soon)
+		auto first = frames.begin();
+		auto last = std::prev(frames.end());
+		const int direction = playhead_direction;
+		auto distance = [playhead, direction](int64_t frame_number) {
+			const int64_t offset = (frame_number - playhead) * direction;
+			return offset < 0 ? -offset * 2 : offset;
+		};
+		return distance(first->first) >= distance(last->first) ? first : last;
+	}
+
+	if (eviction_policy == CACHE_EVICT_2Q) {
+		// Evict frames used only once, unless they are less than a quarter of the cache
+		if (!frame_numbers.empty() && (protected_numbers.empty() || frame_numbers.size() * 4 > frames.size())) {
+			// Remember the evicted frame, so it is protected if it is added again soon
+			const int64_t frame_number = frame_numbers.back();
+			if (evicted) {
+				ghost_numbers.push_front(frame_number);
+				if (ghost_numbers.size() > std::max<size_t>(20, frames.size() / 2))
+					ghost_numbers.pop_back();
+			}
+			return frames.find(frame_number);
 		}
+		return frames.find(protected_numbers.back());
 	}
+
+	// The least recently added (or refreshed) frame
+	return frames.find(frame_numbers.back());
+}
+
+// Set a callback which receives each frame evicted by CleanUp
+void CacheMemory::SetEvictionCallback(std::function<void(std::shared_ptr<openshot::Frame>)> callback)
+{
+	// Create a scoped lock, to protect the cache from multiple threads
+	const ScopedLock lock(this);
+
+	eviction_callback = callback;
 }
 
 
@@ -266,13 +761,13 @@ void CacheMemory::CleanUp()
 std::string CacheMemory::Json() {
 
 	// Return formatted string
-	return JsonValue().toStyledString();
+	return openshot::jsonToString(JsonValue());
 }
 
 // Generate Json::Value for this object
 Json::Value CacheMemory::JsonValue() {
 
-	// Process range data (if anything has changed)
+	// Process range data (if anything has changed, the ranges are updated with each change)
 	CalculateRanges();
 
 	// Create root json object
@@ -281,11 +776,9 @@ Json::Value CacheMemory::JsonValue() {
 
 	root["version"] = std::to_string(range_version);
 
-	// Parse and append range data (if any)
-	try {
-		const Json::Value ranges = openshot::stringToJson(json_ranges);
-		root["ranges"] = ranges;
-	} catch (...) { }
+	// Append range data (if any)
+	if (!ranges_value.isNull())
+		root["ranges"] = ranges_value;
 
 	// return JsonValue
 	return root;
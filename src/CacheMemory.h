@@ -15,8 +15,51 @@
 
 #include "CacheBase.h"
 
+#include <atomic>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
 namespace openshot {
 	class Frame;
+	struct CacheMemoryCompressedFrame;
+
+	/// An uncompressed frame of a CacheMemory, as found by lock-free lookups (see CacheMemory::SetLockFreeLookup)
+	struct CacheMemoryLookup {
+		int64_t number; ///< The frame number
+		std::shared_ptr<openshot::Frame> frame; ///< The cached frame
+#ifndef SWIG
+		std::atomic<int64_t> last_used{0}; ///< When a lock-free lookup last found the frame (see CacheBudget::NextTick)
+#endif
+	};
+
+	/**
+	 * @brief This struct holds a cached Frame, and its bookkeeping in a CacheMemory object
+	 *
+	 * Keeping the position in the LRU list (and the buffers of the frame) next to the frame
+	 * makes touching, evicting and removing a frame O(1), and the total bytes of the cache
+	 * can be maintained incrementally.
+	 */
+	struct CacheMemoryEntry {
+		std::shared_ptr<openshot::Frame> frame; ///< The cached frame
+		std::list<int64_t>::iterator position;  ///< Position of this frame number in the LRU list (or the protected list)
+		std::vector<std::pair<const void*, int64_t>> buffers; ///< Buffers of the frame (when it was added or last refreshed)
+		bool is_protected = false; ///< The frame is in the protected list (it was used again, see CACHE_EVICT_2Q)
+		std::shared_ptr<openshot::CacheMemoryCompressedFrame> compressed; ///< The compressed frame (instead of frame), see CacheMemory::SetCompression()
+		std::list<int64_t>::iterator hot_position; ///< Position of this frame number in the list of uncompressed frames
+		bool is_hot = false; ///< The frame is in the list of uncompressed frames
+		int64_t last_used = 0; ///< When the frame was added or last used (see CacheBudget::NextTick)
+		std::shared_ptr<openshot::CacheMemoryLookup> lookup; ///< The lookup record of the frame (with lock-free lookups)
+	};
+
+	/// This struct holds the size of a buffer in a CacheMemory object, and the number of cached frames using it
+	struct CacheMemoryBuffer {
+		int64_t bytes;      ///< Size of the buffer
+		int64_t references; ///< Number of cached frames using this buffer
+	};
 
 	/**
 	 * @brief This class is a memory-based cache manager for Frame objects.
@@ -25,11 +68,92 @@ namespace openshot {
 	 * high cost of decoding streams, once a frame is decoded, converted to RGB, and a Frame object is created,
 	 * it critical to keep these Frames cached for performance reasons.  However, the larger the cache, the more memory
 	 * is required.  You can set the max number of bytes to cache.
+	 *
+	 * Once the cache exceeds its max bytes, frames are evicted based on the eviction policy (see
+	 * SetEvictionPolicy()): the least recently added frames (LRU), frames which were only used once
+	 * (2Q), or the frames farthest from the playhead (see SetPlayhead()).
+	 *
+	 * With compression (see SetCompression()), only the most recently used frames are kept as they are,
+	 * and the images of older frames are compressed with LZ4 (and decompressed by GetFrame()), so about
+	 * three times as many frames fit in the same max bytes.
 	 */
 	class CacheMemory : public CacheBase {
 	private:
-		std::map<int64_t, std::shared_ptr<openshot::Frame> > frames;	///< This map holds the frame number and Frame objects
-		std::deque<int64_t> frame_numbers;	///< This queue holds a sequential list of cached Frame numbers
+		std::map<int64_t, CacheMemoryEntry> frames;	///< This map holds the frame number and cached Frame objects (sorted by frame number)
+		std::list<int64_t> frame_numbers;	///< This list holds the cached Frame numbers, most recently used first
+		std::list<int64_t> protected_numbers;	///< The cached Frame numbers which were used again, most recently used first (CACHE_EVICT_2Q)
+		std::list<int64_t> ghost_numbers;	///< The Frame numbers recently evicted after being used once, newest first (CACHE_EVICT_2Q)
+		openshot::CacheEvictionPolicy eviction_policy; ///< Which frames are evicted first
+		std::list<int64_t> hot_numbers;	///< The uncompressed Frame numbers, most recently used first (with compression)
+		int64_t hot_frames;	///< The number of frames kept uncompressed (0 = no compression)
+		std::map<const void*, CacheMemoryBuffer> buffers;	///< All buffers used by cached frames (shared buffers are only counted once)
+		int64_t total_bytes;	///< Total bytes of all buffers (maintained on each add/remove)
+		std::function<void(std::shared_ptr<openshot::Frame>)> eviction_callback; ///< Receives frames evicted by CleanUp (if set)
+		int budget_priority; ///< Caches with a lower priority are reduced first, when all caches exceed their budget
+		int64_t min_frames; ///< The number of frames which are kept, even if they exceed the max bytes
+
+		/// The number of slots of the lock-free lookup table (a power of 2)
+		static constexpr int64_t LOOKUP_SLOTS = 1024;
+
+		/// @brief The lock-free lookup table (allocated once it is enabled, and kept until this cache is deleted)
+		///
+		/// Each slot holds the lookup record of a frame whose number maps to it (frame_number & (LOOKUP_SLOTS - 1)),
+		/// or nullptr. Slots are only written while holding cacheMutex, and read with std::atomic_load without it.
+		std::unique_ptr<std::shared_ptr<openshot::CacheMemoryLookup>[]> lookup_slots;
+		bool lookup_requested; ///< Lock-free lookups are enabled (see SetLockFreeLookup)
+		std::atomic<bool> lookup_active; ///< The lookup table is maintained (not with CACHE_EVICT_2Q, whose hits need the lock)
+
+		/// Add (or replace) the lookup record of an uncompressed frame (or remove it, if the frame is compressed)
+		void Publish(int64_t frame_number, CacheMemoryEntry& entry);
+
+		/// Remove the lookup record of a frame (keeping when it was last found)
+		void Unpublish(int64_t frame_number, CacheMemoryEntry& entry);
+
+		/// Publish all frames (or clear the lookup table), after lock-free lookups are enabled or disabled
+		void UpdateLookup();
+
+		/// Find the lookup record of a frame without locking the cache (or nullptr, if the frame is not published)
+		std::shared_ptr<openshot::CacheMemoryLookup> Lookup(int64_t frame_number);
+
+		/// Remove a frame (and its bookkeeping) from the cache, and return the next entry
+		std::map<int64_t, CacheMemoryEntry>::iterator RemoveEntry(std::map<int64_t, CacheMemoryEntry>::iterator entry);
+
+		/// Count the buffers of a cached frame (the first reference to a buffer adds its size)
+		void AddBuffers(const CacheMemoryEntry& entry);
+
+		/// Release the buffers of a cached frame (the last reference to a buffer removes its size)
+		void RemoveBuffers(const CacheMemoryEntry& entry);
+
+		/// Move a frame to the front of its list (or into the protected list, with CACHE_EVICT_2Q)
+		void Touch(CacheMemoryEntry& entry, bool promote);
+
+		/// Choose the next frame to evict (based on the eviction policy), and remember it (for CACHE_EVICT_2Q) if it is evicted
+		std::map<int64_t, CacheMemoryEntry>::iterator EvictionCandidate(bool evicted = true);
+
+		/// Remove the next frame (and pass it to the eviction callback, if any)
+		void Evict(std::map<int64_t, CacheMemoryEntry>::iterator candidate);
+
+		/// Would removing a cached frame free any memory? (not if its buffers are also held elsewhere)
+		bool FreesMemory(const CacheMemoryEntry& entry);
+
+		/// @brief Find the next frame to evict for the budget of all caches (see CacheBudget)
+		/// @returns false if no frame can be evicted (the cache is too small, or no frame would free memory)
+		/// @param last_used When the frame was last used
+		bool BudgetCandidate(int64_t& last_used);
+
+		/// Evict the next frame for the budget of all caches (returns false if no frame can be evicted)
+		bool EvictForBudget();
+
+		friend class CacheBudget;
+
+		/// Move a frame to the front of the list of uncompressed frames (with compression)
+		void MakeHot(int64_t frame_number, CacheMemoryEntry& entry);
+
+		/// Compress the least recently used frames, until only hot_frames are uncompressed (locking the cache only while choosing and replacing each frame)
+		void CompressColdFrames();
+
+		/// Get the frame of an entry (decompressing a copy, if needed)
+		std::shared_ptr<openshot::Frame> EntryFrame(int64_t frame_number, const CacheMemoryEntry& entry);
 
 		/// Clean up cached frames that exceed the max number of bytes
 		void CleanUp();
@@ -85,6 +209,56 @@ namespace openshot {
 		/// @param end_frame_number The ending frame number of the cached frame
 		void Remove(int64_t start_frame_number, int64_t end_frame_number);
 
+		/// Get the priority of this cache, when all caches exceed their budget (see CacheBudget)
+		int GetBudgetPriority() { return budget_priority; };
+
+		/// @brief Set the priority of this cache, when all caches exceed their budget (see Settings::CACHE_BUDGET_MB)
+		/// @param priority The frames of the caches with the lowest priority are evicted first (the default is 0)
+		void SetBudgetPriority(int priority) { budget_priority = priority; };
+
+		/// Get the eviction policy
+		openshot::CacheEvictionPolicy GetEvictionPolicy() { return eviction_policy; };
+
+		/// @brief Set which frames are evicted first, once the cache exceeds its max bytes (the default is CACHE_EVICT_LRU)
+		/// @param policy The eviction policy
+		void SetEvictionPolicy(openshot::CacheEvictionPolicy policy);
+
+		/// @brief Set the number of frames which are kept, even if they exceed the max bytes (the default is 20)
+		/// @param number_of_frames The number of frames which are never evicted by the max bytes
+		void SetMinFrames(int64_t number_of_frames);
+
+		/// Get the number of frames which are kept, even if they exceed the max bytes
+		int64_t GetMinFrames() { return min_frames; }
+
+		/// Are older frames compressed?
+		bool IsCompressionEnabled() { return hot_frames > 0; };
+
+		/// @brief Compress the images of older frames with LZ4 (if libopenshot was built with LZ4)
+		///
+		/// Compressed frames are decompressed by GetFrame(), and become uncompressed again (since they are
+		/// used). Only use this for caches of finished frames (i.e. the timeline cache), since images which
+		/// are still changing are not compressed.
+		/// @param enabled Compress older frames (disabling keeps the compressed frames, until they are used)
+		/// @param hot The number of most recently used frames to keep uncompressed
+		void SetCompression(bool enabled, int64_t hot = 30);
+
+		/// Are frames found without locking the cache?
+		bool IsLockFreeLookupEnabled() { return lookup_requested; };
+
+		/// @brief Find cached frames without locking the cache (i.e. for the Timeline's final cache)
+		///
+		/// GetFrame() and Contains() find uncompressed frames in a lock-free table first, so cache hits never wait
+		/// for a thread which is adding or evicting frames. These hits don't reorder the frames kept uncompressed
+		/// (see SetCompression()), and lookups are not lock-free with CACHE_EVICT_2Q (which reorders frames on hits).
+		/// @param enabled Use the lock-free table (which is 16 KB, and allocated once enabled)
+		void SetLockFreeLookup(bool enabled);
+
+		/// @brief Set a callback which receives each frame evicted to stay under the max bytes (i.e. to move
+		/// it to a slower cache). Frames removed with Remove() or Clear() are not passed to the callback.
+		/// The callback is invoked while this cache is locked, so it must not call back into this cache.
+		/// @param callback The function to call with each evicted frame (or an empty function to disable)
+		void SetEvictionCallback(std::function<void(std::shared_ptr<openshot::Frame>)> callback);
+
 		// Get and Set JSON methods
 		std::string Json(); ///< Generate JSON string of this object
 		void SetJson(const std::string value); ///< Load JSON string into this object
@@ -0,0 +1,268 @@
+/**
+ * @file
+ * @brief Source file for CacheMemorySharded class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "CacheMemorySharded.h"
+#include "Exceptions.h"
+#include "Frame.h"
+#include "OpenMPUtilities.h"
+
+using namespace std;
+using namespace openshot;
+
+// Default constructor, no max bytes
+CacheMemorySharded::CacheMemorySharded(int number_of_shards) : CacheMemorySharded(number_of_shards, 0) { }
+
+// Constructor that sets the max bytes to cache
+CacheMemorySharded::CacheMemorySharded(int number_of_shards, int64_t max_bytes) : CacheBase(max_bytes) {
+	// Set cache type name
+	cache_type = "CacheMemorySharded";
+	range_version = 0;
+	needs_range_processing = false;
+	ranges_changed = false;
+
+	// Default to one shard per processor
+	if (number_of_shards <= 0)
+		number_of_shards = OPEN_MP_NUM_PROCESSORS;
+
+	// Create shards (the 20 frames a CacheMemory always keeps are spread over all shards, so the whole cache
+	// keeps about 20 frames, instead of 20 frames per shard)
+	const int64_t min_frames = (20 + number_of_shards - 1) / number_of_shards;
+	for (int s = 0; s < number_of_shards; s++) {
+		shards.push_back(std::make_unique<CacheMemory>());
+		shards.back()->SetMinFrames(min_frames);
+	}
+
+	// Divide max bytes between shards
+	SetMaxBytes(max_bytes);
+}
+
+// Default destructor
+CacheMemorySharded::~CacheMemorySharded()
+{
+	Clear();
+
+	// remove mutex
+	delete cacheMutex;
+}
+
+// Get the shard which holds a frame number (consecutive frames land on different shards)
+CacheMemory* CacheMemorySharded::Shard(int64_t frame_number)
+{
+	int64_t count = shards.size();
+	return shards[((frame_number % count) + count) % count].get();
+}
+
+// Add a Frame to the cache
+void CacheMemorySharded::Add(std::shared_ptr<Frame> frame)
+{
+	Shard(frame->number)->Add(frame);
+
+	// Needs range processing (since cache has changed)
+	ranges_changed = true;
+}
+
+// Check if frame is already contained in cache
+bool CacheMemorySharded::Contains(int64_t frame_number) {
+	return Shard(frame_number)->Contains(frame_number);
+}
+
+// Get a frame from the cache (or NULL shared_ptr if no frame is found)
+std::shared_ptr<Frame> CacheMemorySharded::GetFrame(int64_t frame_number)
+{
+	return Shard(frame_number)->GetFrame(frame_number);
+}
+
+// Add up the counters of all shards
+CacheStats CacheMemorySharded::GetStats()
+{
+	CacheStats total;
+	for (auto& shard : shards)
+		total += shard->GetStats();
+	return total;
+}
+
+// Reset the counters of all shards
+void CacheMemorySharded::ResetStats()
+{
+	for (auto& shard : shards)
+		shard->ResetStats();
+}
+
+// Set the eviction policy of all shards
+void CacheMemorySharded::SetEvictionPolicy(CacheEvictionPolicy policy)
+{
+	for (auto& shard : shards)
+		shard->SetEvictionPolicy(policy);
+}
+
+// Set the position of the playhead (of all shards)
+void CacheMemorySharded::SetPlayhead(int64_t frame_number, int direction)
+{
+	CacheBase::SetPlayhead(frame_number, direction);
+	for (auto& shard : shards)
+		shard->SetPlayhead(frame_number, direction);
+}
+
+// @brief Get an array of all Frames
+std::vector<std::shared_ptr<openshot::Frame>> CacheMemorySharded::GetFrames()
+{
+	std::vector<std::shared_ptr<openshot::Frame>> all_frames;
+	for (const auto& shard : shards) {
+		std::vector<std::shared_ptr<openshot::Frame>> shard_frames = shard->GetFrames();
+		all_frames.insert(all_frames.end(), shard_frames.begin(), shard_frames.end());
+	}
+
+	// Sort by frame number
+	std::sort(all_frames.begin(), all_frames.end(),
+		[](const std::shared_ptr<Frame>& a, const std::shared_ptr<Frame>& b) { return a->number < b->number; });
+
+	return all_frames;
+}
+
+// Get the smallest frame number (or NULL shared_ptr if no frame is found)
+std::shared_ptr<Frame> CacheMemorySharded::GetSmallestFrame()
+{
+	std::shared_ptr<Frame> smallest_frame;
+	for (const auto& shard : shards) {
+		std::shared_ptr<Frame> f = shard->GetSmallestFrame();
+		if (f && (!smallest_frame || f->number < smallest_frame->number))
+			smallest_frame = f;
+	}
+	return smallest_frame;
+}
+
+// Gets the maximum bytes value
+int64_t CacheMemorySharded::GetBytes()
+{
+	int64_t total_bytes = 0;
+	for (const auto& shard : shards)
+		total_bytes += shard->GetBytes();
+	return total_bytes;
+}
+
+// Remove a specific frame
+void CacheMemorySharded::Remove(int64_t frame_number)
+{
+	Shard(frame_number)->Remove(frame_number);
+
+	// Needs range processing (since cache has changed)
+	ranges_changed = true;
+}
+
+// Remove range of frames
+void CacheMemorySharded::Remove(int64_t start_frame_number, int64_t end_frame_number)
+{
+	for (const auto& shard : shards)
+		shard->Remove(start_frame_number, end_frame_number);
+
+	// Needs range processing (since cache has changed)
+	ranges_changed = true;
+}
+
+// Set maximum bytes (divided evenly between all shards)
+void CacheMemorySharded::SetMaxBytes(int64_t number_of_bytes)
+{
+	max_bytes = number_of_bytes;
+	for (const auto& shard : shards)
+		shard->SetMaxBytes(number_of_bytes / shards.size());
+}
+
+// Clear the cache of all frames
+void CacheMemorySharded::Clear()
+{
+	for (const auto& shard : shards)
+		shard->Clear();
+
+	// Needs range processing (since cache has changed)
+	ranges_changed = true;
+}
+
+// Count the frames in the queue
+int64_t CacheMemorySharded::Count()
+{
+	int64_t count = 0;
+	for (const auto& shard : shards)
+		count += shard->Count();
+	return count;
+}
+
+// Generate JSON string of this object
+std::string CacheMemorySharded::Json() {
+
+	// Return formatted string
+	return openshot::jsonToString(JsonValue());
+}
+
+// Update the frame numbers of the range data
+void CacheMemorySharded::UpdateFrameNumbers() {
+	if (ranges_changed.exchange(false)) {
+		// Collect the frame numbers of all shards
+		ordered_frame_numbers.clear();
+		for (const auto& f : GetFrames())
+			ordered_frame_numbers.push_back(f->number);
+		needs_range_processing = true;
+	}
+}
+
+// Generate Json::Value for this object
+Json::Value CacheMemorySharded::JsonValue() {
+
+	// Process range data (if anything has changed)
+	CalculateRanges();
+
+	// Create root json object
+	Json::Value root = CacheBase::JsonValue(); // get parent properties
+	root["type"] = cache_type;
+	root["shards"] = GetShardCount();
+
+	root["version"] = std::to_string(range_version);
+
+	// Append range data (if any)
+	if (!ranges_value.isNull())
+		root["ranges"] = ranges_value;
+
+	// return JsonValue
+	return root;
+}
+
+// Load JSON string into this object
+void CacheMemorySharded::SetJson(const std::string value) {
+
+	try
+	{
+		// Parse string to Json::Value
+		const Json::Value root = openshot::stringToJson(value);
+		// Set all values that match
+		SetJsonValue(root);
+	}
+	catch (const std::exception& e)
+	{
+		// Error parsing JSON (or missing keys)
+		throw InvalidJSON("JSON is invalid (missing keys or invalid data types)");
+	}
+}
+
+// Load Json::Value into this object
+void CacheMemorySharded::SetJsonValue(const Json::Value root) {
+
+	// Remove all cached frames
+	Clear();
+
+	// Set parent data
+	CacheBase::SetJsonValue(root);
+
+	// Divide (possibly changed) max bytes between shards
+	SetMaxBytes(max_bytes);
+
+	if (!root["type"].isNull())
+		cache_type = root["type"].asString();
+}
@@ -0,0 +1,130 @@
+/**
+ * @file
+ * @brief Header file for CacheMemorySharded class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_CACHE_MEMORY_SHARDED_H
+#define OPENSHOT_CACHE_MEMORY_SHARDED_H
+
+#include "CacheBase.h"
+#include "CacheMemory.h"
+
+#include <atomic>
+
+namespace openshot {
+	class Frame;
+
+	/**
+	 * @brief This class is a memory-based cache manager, which stripes Frame objects across multiple shards.
+	 *
+	 * Each shard is a CacheMemory instance (with its own lock), and frames are assigned to a shard by
+	 * frame number. Threads working on different frames therefore rarely contend on the same lock, which
+	 * helps when many render threads share a cache (such as the Timeline final cache). The max bytes are
+	 * divided evenly between the shards, and each shard evicts its own least recently used frames. Like a
+	 * CacheMemory, the whole cache keeps at least 20 frames (spread over the shards).
+	 *
+	 * This is a drop-in replacement for CacheMemory, for example:
+	 * @code
+	 * openshot::CacheMemorySharded cache(8);
+	 * cache.SetMaxBytesFromInfo(100, 1920, 1080, 48000, 2);
+	 * timeline.SetCache(&cache);
+	 * @endcode
+	 */
+	class CacheMemorySharded : public CacheBase {
+	private:
+		std::vector<std::unique_ptr<openshot::CacheMemory>> shards; ///< The CacheMemory shards
+		std::atomic<bool> ranges_changed; ///< Frames were added or removed (without locking all shards)
+
+		/// Get the shard which holds a frame number
+		openshot::CacheMemory* Shard(int64_t frame_number);
+
+	protected:
+		/// Update the frame numbers of the range data (from all shards)
+		void UpdateFrameNumbers() override;
+
+	public:
+		/// @brief Constructor with no max bytes
+		/// @param number_of_shards The number of stripes (0 = one per processor)
+		CacheMemorySharded(int number_of_shards=0);
+
+		/// @brief Constructor that sets the max bytes to cache
+		/// @param number_of_shards The number of stripes (0 = one per processor)
+		/// @param max_bytes The maximum bytes to allow in the cache. Once exceeded, the cache will purge the oldest frames.
+		CacheMemorySharded(int number_of_shards, int64_t max_bytes);
+
+		// Default destructor
+		virtual ~CacheMemorySharded();
+
+		/// @brief Add a Frame to the cache
+		/// @param frame The openshot::Frame object needing to be cached.
+		void Add(std::shared_ptr<openshot::Frame> frame);
+
+		/// Clear the cache of all frames
+		void Clear();
+
+		/// @brief Check if frame is already contained in cache
+		/// @param frame_number The frame number to be checked
+		bool Contains(int64_t frame_number);
+
+		/// Count the frames in the queue
+		int64_t Count();
+
+		/// @brief Get a frame from the cache
+		/// @param frame_number The frame number of the cached frame
+		std::shared_ptr<openshot::Frame> GetFrame(int64_t frame_number);
+
+		/// @brief Get an array of all Frames (sorted by frame number)
+		std::vector<std::shared_ptr<openshot::Frame>> GetFrames();
+
+		/// Gets the maximum bytes value
+		int64_t GetBytes();
+
+		/// Get the smallest frame number
+		std::shared_ptr<openshot::Frame> GetSmallestFrame();
+
+		/// Get the number of shards
+		int GetShardCount() { return shards.size(); };
+
+		/// Add up the counters of all shards
+		openshot::CacheStats GetStats() override;
+
+		/// Reset the counters of all shards
+		void ResetStats() override;
+
+		/// @brief Set the eviction policy of all shards
+		/// @param policy The eviction policy
+		void SetEvictionPolicy(openshot::CacheEvictionPolicy policy);
+
+		/// Set the position of the playhead (of all shards)
+		void SetPlayhead(int64_t frame_number, int direction) override;
+
+		/// @brief Remove a specific frame
+		/// @param frame_number The frame number of the cached frame
+		void Remove(int64_t frame_number);
+
+		/// @brief Remove a range of frames
+		/// @param start_frame_number The starting frame number of the cached frame
+		/// @param end_frame_number The ending frame number of the cached frame
+		void Remove(int64_t start_frame_number, int64_t end_frame_number);
+
+		/// @brief Set maximum bytes to a different amount (divided evenly between all shards)
+		/// @param number_of_bytes The maximum bytes to allow in the cache. Once exceeded, the cache will purge the oldest frames.
+		void SetMaxBytes(int64_t number_of_bytes) override;
+
+		// Get and Set JSON methods
+		std::string Json(); ///< Generate JSON string of this object
+		void SetJson(const std::string value); ///< Load JSON string into this object
+		Json::Value JsonValue(); ///< Generate Json::Value for this object
+		void SetJsonValue(const Json::Value root); ///< Load Json::Value into this object
+	};
+
+}
+
+#endif
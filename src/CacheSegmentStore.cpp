@@ -0,0 +1,248 @@
+/**
+ * @file
+ * @brief Source file for CacheSegmentStore class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include <QImage>
+
+#if USE_LZ4
+#include <lz4.h>
+#endif
+
+#include "CacheSegmentStore.h"
+#include "Frame.h"
+#include "ImageBufferPool.h"
+#include "PixelKernels.h"
+
+using namespace openshot;
+
+// Keep each image and audio block aligned (so samples can be read straight from the mapped file)
+static const int64_t RECORD_ALIGNMENT = 64;
+
+// Round a size up to the record alignment
+static int64_t AlignSize(int64_t bytes) {
+	return ((bytes + RECORD_ALIGNMENT - 1) / RECORD_ALIGNMENT) * RECORD_ALIGNMENT;
+}
+
+// Constructor
+CacheSegmentStore::CacheSegmentStore(const QString& folder, bool compress, int64_t segment_size)
+	: folder(folder), compress(compress), segment_size(segment_size), current_segment(-1), total_bytes(0) { }
+
+// Destructor
+CacheSegmentStore::~CacheSegmentStore() {
+	Clear();
+}
+
+// Determine if images are compressed
+bool CacheSegmentStore::IsCompressed() const {
+#if USE_LZ4
+	return compress;
+#else
+	return false;
+#endif
+}
+
+// Get the file path of a segment
+QString CacheSegmentStore::SegmentPath(int64_t segment_number) const {
+	return folder + "/" + QString("segment-%1.cache").arg(segment_number);
+}
+
+// Reserve space at the end of a segment
+bool CacheSegmentStore::Reserve(int64_t bytes, int64_t& segment_number, int64_t& offset) {
+	// Append to the current segment (if there is room)
+	auto current = segments.find(current_segment);
+	if (current != segments.end() && current->second.size - current->second.used >= bytes) {
+		segment_number = current_segment;
+		offset = current->second.used;
+		current->second.used += bytes;
+		return true;
+	}
+
+	// Start a new segment (large enough for this frame)
+	int64_t new_segment_number = current_segment + 1;
+	Segment segment;
+	segment.size = std::max(segment_size, bytes);
+	segment.file.reset(new QFile(SegmentPath(new_segment_number)));
+	if (!segment.file->open(QIODevice::ReadWrite | QIODevice::Truncate) || !segment.file->resize(segment.size))
+		return false;
+	segment.data = segment.file->map(0, segment.size);
+	if (!segment.data) {
+		segment.file->close();
+		segment.file->remove();
+		return false;
+	}
+	segment.used = bytes;
+
+	// The previous segment is no longer appended to (delete it, if it has no frames left)
+	if (current != segments.end() && current->second.frames == 0) {
+		CloseSegment(current->second);
+		segments.erase(current);
+	}
+
+	segments[new_segment_number] = std::move(segment);
+	current_segment = new_segment_number;
+	segment_number = new_segment_number;
+	offset = 0;
+	return true;
+}
+
+// Unmap, close and delete a segment file
+void CacheSegmentStore::CloseSegment(Segment& segment) {
+	if (segment.file) {
+		if (segment.data)
+			segment.file->unmap(segment.data);
+		segment.file->close();
+		segment.file->remove();
+	}
+	segment.data = nullptr;
+}
+
+// Store the image and audio of a frame
+bool CacheSegmentStore::Add(std::shared_ptr<Frame> frame, float scale) {
+	// Replace previous version (if any)
+	Remove(frame->number);
+
+	// Get image (and scale it, if needed)
+	QImage image = *frame->GetImage();
+	if (std::fabs(scale) > 1.001 || std::fabs(scale) < 0.999)
+		image = image.scaled(image.width() * scale, image.height() * scale, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+	PixelKernels::ToPremultipliedRGBA(image);
+
+	Record record;
+	record.width = image.width();
+	record.height = image.height();
+	record.pixel_ratio_num = frame->GetPixelRatio().num;
+	record.pixel_ratio_den = frame->GetPixelRatio().den;
+	record.compressed = false;
+	const int64_t raw_image_bytes = int64_t(record.width) * record.height * 4;
+	record.image_bytes = raw_image_bytes;
+
+	// Compress image (if enabled, and it actually gets smaller)
+	std::vector<char> compressed_image;
+#if USE_LZ4
+	if (compress && raw_image_bytes > 0 && raw_image_bytes <= LZ4_MAX_INPUT_SIZE) {
+		compressed_image.resize(LZ4_compressBound((int) raw_image_bytes));
+		int compressed_bytes = LZ4_compress_default((const char *) image.constBits(), compressed_image.data(),
+													(int) raw_image_bytes, (int) compressed_image.size());
+		if (compressed_bytes > 0 && compressed_bytes < raw_image_bytes) {
+			record.compressed = true;
+			record.image_bytes = compressed_bytes;
+		}
+	}
+#endif
+
+	// Get audio properties
+	record.sample_rate = frame->SampleRate();
+	record.channels = frame->has_audio_data ? frame->GetAudioChannelsCount() : 0;
+	record.samples = frame->has_audio_data ? frame->GetAudioSamplesCount() : 0;
+	record.channel_layout = frame->ChannelsLayout();
+	const int64_t audio_bytes = int64_t(record.channels) * record.samples * sizeof(float);
+
+	// Reserve space in a segment for the image & audio
+	record.audio_offset = AlignSize(record.image_bytes);
+	record.bytes = record.audio_offset + AlignSize(audio_bytes);
+	if (!Reserve(record.bytes, record.segment, record.offset))
+		return false;
+	uchar *destination = segments[record.segment].data + record.offset;
+
+	// Copy image (scanlines of RGBA8888 have no padding)
+	if (record.compressed)
+		std::memcpy(destination, compressed_image.data(), record.image_bytes);
+	else if (raw_image_bytes > 0)
+		std::memcpy(destination, image.constBits(), raw_image_bytes);
+
+	// Copy audio (one channel after another)
+	float *audio_destination = reinterpret_cast<float *>(destination + record.audio_offset);
+	for (int channel = 0; channel < record.channels; channel++)
+		std::memcpy(audio_destination + int64_t(channel) * record.samples, frame->GetAudioSamples(channel), record.samples * sizeof(float));
+
+	// Add to index
+	segments[record.segment].frames++;
+	records[frame->number] = record;
+	total_bytes += record.bytes;
+	return true;
+}
+
+// Load a new copy of a stored frame
+std::shared_ptr<Frame> CacheSegmentStore::GetFrame(int64_t frame_number) const {
+	auto found = records.find(frame_number);
+	if (found == records.end())
+		return std::shared_ptr<Frame>();
+	const Record& record = found->second;
+	const uchar *source = segments.at(record.segment).data + record.offset;
+
+	// Create frame object
+	auto frame = std::make_shared<Frame>();
+	frame->number = frame_number;
+	frame->SetPixelRatio(record.pixel_ratio_num, record.pixel_ratio_den);
+
+	// Copy image (no decoding or format conversion needed)
+	if (record.width > 0 && record.height > 0) {
+		std::shared_ptr<QImage> image = ImageBufferPool::Instance()->CreateImage(record.width, record.height, QImage::Format_RGBA8888_Premultiplied);
+		const int64_t raw_image_bytes = int64_t(record.width) * record.height * 4;
+#if USE_LZ4
+		if (record.compressed) {
+			LZ4_decompress_safe((const char *) source, (char *) image->bits(), (int) record.image_bytes, (int) raw_image_bytes);
+		} else
+#endif
+		std::memcpy(image->bits(), source, raw_image_bytes);
+		frame->AddImage(image);
+	}
+
+	// Copy audio
+	if (record.channels > 0) {
+		frame->ResizeAudio(record.channels, record.samples, record.sample_rate, (ChannelLayout) record.channel_layout);
+		const float *audio_source = reinterpret_cast<const float *>(source + record.audio_offset);
+		for (int channel = 0; channel < record.channels; channel++)
+			frame->AddAudio(true, channel, 0, audio_source + int64_t(channel) * record.samples, record.samples, 1.0);
+	}
+
+	// return the Frame object
+	return frame;
+}
+
+// Remove a stored frame
+void CacheSegmentStore::Remove(int64_t frame_number) {
+	auto found = records.find(frame_number);
+	if (found == records.end())
+		return;
+
+	// Remove from index
+	const Record record = found->second;
+	records.erase(found);
+	total_bytes -= record.bytes;
+
+	// Delete segment (once it has no frames left)
+	auto segment = segments.find(record.segment);
+	if (segment != segments.end() && --segment->second.frames == 0) {
+		if (record.segment == current_segment) {
+			// Re-use the current segment from the start
+			segment->second.used = 0;
+		} else {
+			CloseSegment(segment->second);
+			segments.erase(segment);
+		}
+	}
+}
+
+// Remove all stored frames
+void CacheSegmentStore::Clear() {
+	for (auto& segment : segments)
+		CloseSegment(segment.second);
+	segments.clear();
+	records.clear();
+	current_segment = -1;
+	total_bytes = 0;
+}
@@ -0,0 +1,122 @@
+/**
+ * @file
+ * @brief Header file for CacheSegmentStore class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_CACHE_SEGMENT_STORE_H
+#define OPENSHOT_CACHE_SEGMENT_STORE_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+
+#include <QFile>
+#include <QString>
+
+namespace openshot {
+	class Frame;
+
+	/**
+	 * @brief This class stores frames in large, append-only, memory-mapped segment files.
+	 *
+	 * It is used by openshot::CacheDisk (with the "RAW" or "LZ4" format) instead of one image file and
+	 * one audio file per frame. Each frame is appended to the current segment as raw premultiplied RGBA
+	 * (optionally LZ4-compressed) followed by its float audio samples, and an in-memory index maps frame
+	 * numbers to their location. A segment file is deleted once none of its frames are left in the cache.
+	 *
+	 * This class is not thread-safe (CacheDisk locks its own mutex around every call).
+	 */
+	class CacheSegmentStore {
+	private:
+		/// A memory-mapped segment file
+		struct Segment {
+			std::unique_ptr<QFile> file;
+			uchar *data = nullptr; ///< Mapped contents of the file
+			int64_t size = 0; ///< Size of the file (in bytes)
+			int64_t used = 0; ///< Bytes appended so far
+			int64_t frames = 0; ///< Number of cached frames still stored in this segment
+		};
+
+		/// The location and properties of a stored frame
+		struct Record {
+			int64_t segment;
+			int64_t offset;
+			int64_t bytes; ///< Total bytes used in the segment (image + audio + alignment)
+			int64_t image_bytes; ///< Stored (possibly compressed) image bytes
+			int width;
+			int height;
+			int pixel_ratio_num;
+			int pixel_ratio_den;
+			bool compressed;
+			int64_t audio_offset;
+			int sample_rate;
+			int channels;
+			int samples;
+			int channel_layout;
+		};
+
+		QString folder; ///< The folder for all segment files
+		bool compress; ///< Compress images with LZ4 (if supported)
+		int64_t segment_size; ///< Default size of each segment file (in bytes)
+		std::map<int64_t, Segment> segments; ///< Segment number -> segment
+		std::map<int64_t, Record> records; ///< Frame number -> record
+		int64_t current_segment; ///< The segment frames are appended to
+		int64_t total_bytes; ///< Total bytes of all stored frames
+
+		/// Get the file path of a segment
+		QString SegmentPath(int64_t segment_number) const;
+
+		/// Reserve space at the end of a segment (returns false if no segment could be created)
+		bool Reserve(int64_t bytes, int64_t& segment_number, int64_t& offset);
+
+		/// Unmap, close and delete a segment file
+		void CloseSegment(Segment& segment);
+
+	public:
+		/// @brief Constructor
+		/// @param folder The folder for all segment files (which must exist)
+		/// @param compress Compress images with LZ4 (ignored if libopenshot was built without LZ4)
+		/// @param segment_size The size of each segment file (in bytes)
+		CacheSegmentStore(const QString& folder, bool compress, int64_t segment_size=256 * 1024 * 1024);
+
+		/// Destructor (deletes all segment files)
+		~CacheSegmentStore();
+
+		/// @brief Store the image and audio of a frame (replacing any previous version)
+		/// @param frame The frame to store
+		/// @param scale The scale factor for the stored image (1.0 = original size, 0.5 = half size, etc...)
+		/// @returns false if the frame could not be stored
+		bool Add(std::shared_ptr<openshot::Frame> frame, float scale);
+
+		/// @brief Load a new copy of a stored frame (or a NULL shared_ptr if it's not stored)
+		/// @param frame_number The frame number of the stored frame
+		std::shared_ptr<openshot::Frame> GetFrame(int64_t frame_number) const;
+
+		/// @brief Check if a frame is stored
+		/// @param frame_number The frame number to check
+		bool Contains(int64_t frame_number) const { return records.count(frame_number) > 0; };
+
+		/// @brief Remove a stored frame
+		/// @param frame_number The frame number of the stored frame
+		void Remove(int64_t frame_number);
+
+		/// Remove all stored frames (and delete all segment files)
+		void Clear();
+
+		/// Get the total bytes of all stored frames
+		int64_t GetBytes() const { return total_bytes; };
+
+		/// Determine if images are compressed (requested, and libopenshot was built with LZ4)
+		bool IsCompressed() const;
+	};
+
+}
+
+#endif
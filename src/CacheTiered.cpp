@@ -0,0 +1,454 @@
+/**
+ * @file
+ * @brief Source file for CacheTiered class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+
+#include "CacheTiered.h"
+#include "Exceptions.h"
+#include "Frame.h"
+#include "ZmqLogger.h"
+
+using namespace std;
+using namespace openshot;
+
+// Constructor
+CacheTiered::CacheTiered(int64_t memory_bytes, int64_t disk_bytes, std::string cache_path, std::string format, float scale)
+	: CacheBase(memory_bytes), spill_queue_bytes(0), is_stopping(false) {
+	// Set cache type name
+	cache_type = "CacheTiered";
+	range_version = 0;
+	needs_range_processing = false;
+
+	// Create tiers
+	memory_cache = std::make_unique<CacheMemory>(memory_bytes);
+	disk_cache = std::make_unique<CacheDisk>(cache_path, format, 1.0, scale, disk_bytes);
+
+	// Frames evicted from memory are moved to disk (instead of being dropped)
+	memory_cache->SetEvictionCallback([this](std::shared_ptr<Frame> frame) { QueueSpill(frame); });
+	spill_thread = std::thread(&CacheTiered::SpillLoop, this);
+}
+
+// Default destructor
+CacheTiered::~CacheTiered()
+{
+	// Stop background thread
+	{
+		const std::lock_guard<std::mutex> lock(spill_mutex);
+		is_stopping = true;
+		spill_queue.clear();
+		spill_queue_bytes = 0;
+	}
+	spill_condition.notify_all();
+	spill_thread.join();
+
+	memory_cache->SetEvictionCallback(nullptr);
+	Clear();
+
+	// remove mutex
+	delete cacheMutex;
+}
+
+// Queue a frame evicted from the memory tier
+void CacheTiered::QueueSpill(std::shared_ptr<Frame> frame)
+{
+	const int64_t frame_bytes = frame->GetBytes();
+	{
+		// Wait for the disk tier, if it is too far behind (so the queue never grows without limit)
+		std::unique_lock<std::mutex> lock(spill_mutex);
+		const int64_t max_spill_bytes = memory_cache->GetMaxBytes() / 2;
+		spill_condition.wait(lock, [this, frame_bytes, max_spill_bytes] {
+			return is_stopping || spill_queue.empty() || spill_queue_bytes + frame_bytes <= max_spill_bytes; });
+		if (is_stopping)
+			return;
+
+		spill_queue.push_back(frame);
+		spill_queue_bytes += frame_bytes;
+	}
+	spill_condition.notify_all();
+}
+
+// Write queued frames to the disk tier (until stopped)
+void CacheTiered::SpillLoop()
+{
+	std::unique_lock<std::mutex> lock(spill_mutex);
+	while (true) {
+		spill_condition.wait(lock, [this] { return is_stopping || !spill_queue.empty(); });
+		if (is_stopping)
+			break;
+
+		// Take the oldest evicted frame
+		std::shared_ptr<Frame> frame = spill_queue.front();
+		spill_queue.pop_front();
+		spill_queue_bytes = spill_queue.empty() ? 0 : spill_queue_bytes - frame->GetBytes();
+		spilling_frame = frame;
+
+		// Write frame to disk (without blocking the other tier). A frame which can't be written is dropped.
+		lock.unlock();
+		try {
+			disk_cache->Add(frame);
+		} catch (const std::exception& e) {
+			ZMQ_DEBUG(
+				"CacheTiered::SpillLoop (failed to write frame to disk: " + std::string(e.what()) + ")",
+				"frame->number", frame->number);
+		} catch (...) {
+			ZMQ_DEBUG(
+				"CacheTiered::SpillLoop (failed to write frame to disk)",
+				"frame->number", frame->number);
+		}
+		lock.lock();
+
+		// The frame was removed (or replaced) while it was written, so the disk copy is stale
+		if (spilling_frame != frame)
+			disk_cache->Remove(frame->number);
+		spilling_frame.reset();
+
+		// Wake up WaitForSpill (if waiting)
+		spill_condition.notify_all();
+	}
+}
+
+// Find a frame which is waiting to be written to disk
+std::shared_ptr<Frame> CacheTiered::FindPendingFrame(int64_t frame_number)
+{
+	if (spilling_frame && spilling_frame->number == frame_number)
+		return spilling_frame;
+
+	for (auto itr = spill_queue.rbegin(); itr != spill_queue.rend(); ++itr)
+		if ((*itr)->number == frame_number)
+			return *itr;
+
+	return std::shared_ptr<Frame>();
+}
+
+// Remove frames which are waiting to be written to disk
+void CacheTiered::RemovePendingFrames(int64_t start_frame_number, int64_t end_frame_number)
+{
+	// Cancel the frame being written (the background thread removes it from disk)
+	if (spilling_frame && spilling_frame->number >= start_frame_number && spilling_frame->number <= end_frame_number)
+		spilling_frame.reset();
+
+	auto removed = std::remove_if(spill_queue.begin(), spill_queue.end(),
+		[=](const std::shared_ptr<Frame>& f) { return f->number >= start_frame_number && f->number <= end_frame_number; });
+	for (auto itr = removed; itr != spill_queue.end(); ++itr)
+		spill_queue_bytes -= (*itr)->GetBytes();
+	spill_queue.erase(removed, spill_queue.end());
+	if (spill_queue.empty())
+		spill_queue_bytes = 0;
+
+	// Wake up QueueSpill (if waiting for room in the queue)
+	spill_condition.notify_all();
+}
+
+// Add a Frame to the cache
+void CacheTiered::Add(std::shared_ptr<Frame> frame)
+{
+	// This (newer) frame replaces any copy waiting for, or already on disk
+	{
+		const std::lock_guard<std::mutex> lock(spill_mutex);
+		RemovePendingFrames(frame->number, frame->number);
+	}
+	if (disk_cache->Contains(frame->number))
+		disk_cache->Remove(frame->number);
+
+	// Add to memory (this might evict older frames to disk)
+	memory_cache->Add(frame);
+	needs_range_processing = true;
+	stats.insertions++;
+}
+
+// Check if frame is already contained in cache
+bool CacheTiered::Contains(int64_t frame_number) {
+	if (memory_cache->Contains(frame_number))
+		return true;
+	{
+		const std::lock_guard<std::mutex> lock(spill_mutex);
+		if (FindPendingFrame(frame_number))
+			return true;
+	}
+	return disk_cache->Contains(frame_number);
+}
+
+// Get a frame from the cache (or NULL shared_ptr if no frame is found)
+std::shared_ptr<Frame> CacheTiered::GetFrame(int64_t frame_number)
+{
+	// Hot frame
+	std::shared_ptr<Frame> frame = memory_cache->GetFrame(frame_number);
+	if (frame) {
+		stats.hits++;
+		return frame;
+	}
+
+	// Evicted frame, which is not written to disk yet (no need to write it anymore)
+	{
+		const std::lock_guard<std::mutex> lock(spill_mutex);
+		frame = FindPendingFrame(frame_number);
+		if (frame && frame != spilling_frame)
+			RemovePendingFrames(frame_number, frame_number);
+	}
+
+	// Cold frame (the disk copy is kept, so it doesn't need to be written again when evicted)
+	if (!frame)
+		frame = disk_cache->GetFrame(frame_number);
+
+	// Promote frame back into memory
+	if (frame) {
+		memory_cache->Add(frame);
+		stats.hits++;
+	} else {
+		stats.misses++;
+	}
+
+	return frame;
+}
+
+// Get the counters of this cache (frames only leave the cache when evicted from the disk tier)
+CacheStats CacheTiered::GetStats()
+{
+	CacheStats tiered_stats = stats;
+	const CacheStats memory_stats = memory_cache->GetStats();
+	const CacheStats disk_stats = disk_cache->GetStats();
+	tiered_stats.evictions = disk_stats.evictions.load();
+	tiered_stats.evicted_bytes = disk_stats.evicted_bytes.load();
+	tiered_stats.lock_wait_ns += memory_stats.lock_wait_ns + disk_stats.lock_wait_ns;
+	tiered_stats.lock_held_ns += memory_stats.lock_held_ns + disk_stats.lock_held_ns;
+	return tiered_stats;
+}
+
+// Reset the counters of this cache (and both tiers)
+void CacheTiered::ResetStats()
+{
+	stats.Reset();
+	memory_cache->ResetStats();
+	disk_cache->ResetStats();
+}
+
+// Set the position of the playhead (of the memory tier)
+void CacheTiered::SetPlayhead(int64_t frame_number, int direction)
+{
+	CacheBase::SetPlayhead(frame_number, direction);
+	memory_cache->SetPlayhead(frame_number, direction);
+}
+
+// Get a frame from either tier, without promoting it into memory
+std::shared_ptr<Frame> CacheTiered::PeekFrame(int64_t frame_number)
+{
+	std::shared_ptr<Frame> frame = memory_cache->GetFrame(frame_number);
+	if (!frame) {
+		const std::lock_guard<std::mutex> lock(spill_mutex);
+		frame = FindPendingFrame(frame_number);
+	}
+	if (!frame)
+		frame = disk_cache->GetFrame(frame_number);
+	return frame;
+}
+
+// Get the sorted frame numbers of both tiers
+std::vector<int64_t> CacheTiered::FrameNumbers()
+{
+	std::vector<int64_t> numbers;
+
+	// Frames in memory
+	for (const auto& f : memory_cache->GetFrames())
+		numbers.push_back(f->number);
+
+	// Frames waiting to be written to disk
+	{
+		const std::lock_guard<std::mutex> lock(spill_mutex);
+		if (spilling_frame)
+			numbers.push_back(spilling_frame->number);
+		for (const auto& f : spill_queue)
+			numbers.push_back(f->number);
+	}
+
+	// Frames on disk (from its ranges, to avoid loading every frame)
+	const Json::Value disk_ranges = disk_cache->JsonValue()["ranges"];
+	for (const auto& range : disk_ranges) {
+		int64_t start = std::stoll(range["start"].asString());
+		int64_t end = std::stoll(range["end"].asString());
+		for (int64_t number = start; number <= end; number++)
+			numbers.push_back(number);
+	}
+
+	// Sort (and remove frames found in more than one tier)
+	std::sort(numbers.begin(), numbers.end());
+	numbers.erase(std::unique(numbers.begin(), numbers.end()), numbers.end());
+	return numbers;
+}
+
+// @brief Get an array of all Frames
+std::vector<std::shared_ptr<openshot::Frame>> CacheTiered::GetFrames()
+{
+	std::vector<std::shared_ptr<openshot::Frame>> all_frames;
+	for (int64_t frame_number : FrameNumbers()) {
+		std::shared_ptr<Frame> frame = PeekFrame(frame_number);
+		if (frame)
+			all_frames.push_back(frame);
+	}
+	return all_frames;
+}
+
+// Get the smallest frame number (or NULL shared_ptr if no frame is found)
+std::shared_ptr<Frame> CacheTiered::GetSmallestFrame()
+{
+	std::vector<int64_t> numbers = FrameNumbers();
+	if (numbers.empty())
+		return NULL;
+	return PeekFrame(numbers.front());
+}
+
+// Gets the total bytes of both tiers
+int64_t CacheTiered::GetBytes()
+{
+	int64_t total_bytes = memory_cache->GetBytes() + disk_cache->GetBytes();
+
+	// Frames waiting to be written to disk are still in memory
+	const std::lock_guard<std::mutex> lock(spill_mutex);
+	return total_bytes + spill_queue_bytes;
+}
+
+// Remove a specific frame
+void CacheTiered::Remove(int64_t frame_number)
+{
+	Remove(frame_number, frame_number);
+}
+
+// Remove range of frames
+void CacheTiered::Remove(int64_t start_frame_number, int64_t end_frame_number)
+{
+	// Remove from memory first (so these frames can't be evicted to disk again)
+	memory_cache->Remove(start_frame_number, end_frame_number);
+	{
+		const std::lock_guard<std::mutex> lock(spill_mutex);
+		RemovePendingFrames(start_frame_number, end_frame_number);
+	}
+	disk_cache->Remove(start_frame_number, end_frame_number);
+
+	// Needs range processing (since cache has changed)
+	needs_range_processing = true;
+}
+
+// Set maximum bytes of the memory tier
+void CacheTiered::SetMaxBytes(int64_t number_of_bytes)
+{
+	max_bytes = number_of_bytes;
+	if (memory_cache)
+		memory_cache->SetMaxBytes(number_of_bytes);
+}
+
+// Set maximum bytes of the disk tier
+void CacheTiered::SetDiskMaxBytes(int64_t number_of_bytes)
+{
+	disk_cache->SetMaxBytes(number_of_bytes);
+}
+
+// Wait until all evicted frames have been written to the disk tier
+void CacheTiered::WaitForSpill()
+{
+	std::unique_lock<std::mutex> lock(spill_mutex);
+	spill_condition.wait(lock, [this] { return is_stopping || (spill_queue.empty() && !spilling_frame); });
+}
+
+// Clear the cache of all frames
+void CacheTiered::Clear()
+{
+	memory_cache->Clear();
+	{
+		const std::lock_guard<std::mutex> lock(spill_mutex);
+		spill_queue.clear();
+		spill_queue_bytes = 0;
+		spilling_frame.reset();
+	}
+	spill_condition.notify_all();
+	disk_cache->Clear();
+
+	// Needs range processing (since cache has changed)
+	needs_range_processing = true;
+}
+
+// Count the frames in the queue
+int64_t CacheTiered::Count()
+{
+	return FrameNumbers().size();
+}
+
+// Generate JSON string of this object
+std::string CacheTiered::Json() {
+
+	// Return formatted string
+	return openshot::jsonToString(JsonValue());
+}
+
+// Update the frame numbers of the range data
+void CacheTiered::UpdateFrameNumbers() {
+	// Frames also move between tiers (and age out of the disk tier) on their own
+	std::vector<int64_t> numbers = FrameNumbers();
+	if (numbers != ordered_frame_numbers) {
+		ordered_frame_numbers = numbers;
+		needs_range_processing = true;
+	}
+}
+
+// Generate Json::Value for this object
+Json::Value CacheTiered::JsonValue() {
+
+	// Process range data (if anything has changed)
+	CalculateRanges();
+
+	// Create root json object
+	Json::Value root = CacheBase::JsonValue(); // get parent properties
+	root["type"] = cache_type;
+	root["disk_max_bytes"] = std::to_string(disk_cache->GetMaxBytes());
+
+	root["version"] = std::to_string(range_version);
+
+	// Append range data (if any)
+	if (!ranges_value.isNull())
+		root["ranges"] = ranges_value;
+
+	// return JsonValue
+	return root;
+}
+
+// Load JSON string into this object
+void CacheTiered::SetJson(const std::string value) {
+
+	try
+	{
+		// Parse string to Json::Value
+		const Json::Value root = openshot::stringToJson(value);
+		// Set all values that match
+		SetJsonValue(root);
+	}
+	catch (const std::exception& e)
+	{
+		// Error parsing JSON (or missing keys)
+		throw InvalidJSON("JSON is invalid (missing keys or invalid data types)");
+	}
+}
+
+// Load Json::Value into this object
+void CacheTiered::SetJsonValue(const Json::Value root) {
+
+	// Remove all cached frames
+	Clear();
+
+	// Set parent data
+	CacheBase::SetJsonValue(root);
+
+	// Apply (possibly changed) max bytes to the memory tier
+	SetMaxBytes(max_bytes);
+
+	if (!root["type"].isNull())
+		cache_type = root["type"].asString();
+	if (!root["disk_max_bytes"].isNull())
+		SetDiskMaxBytes(std::stoll(root["disk_max_bytes"].asString()));
+}
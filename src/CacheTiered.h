@@ -0,0 +1,168 @@
+/**
+ * @file
+ * @brief Header file for CacheTiered class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_CACHE_TIERED_H
+#define OPENSHOT_CACHE_TIERED_H
+
+#include "CacheBase.h"
+#include "CacheDisk.h"
+#include "CacheMemory.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace openshot {
+	class Frame;
+
+	/**
+	 * @brief This class is a two-tier cache manager, with a CacheMemory in front of a CacheDisk.
+	 *
+	 * Recently used frames are kept in memory. Instead of dropping the oldest frames when the memory tier is
+	 * full, they are queued, and written to the disk tier on a background thread. When a frame is requested
+	 * which is only on disk, it is loaded and promoted back into memory. Scrubbing back over an already rendered
+	 * region is then a disk read, instead of a full re-render.
+	 *
+	 * The queue of frames waiting for the disk holds at most half the bytes of the memory tier. While the disk
+	 * keeps up, adding frames never waits for it, but once the queue is full, Add() (which evicts frames into the
+	 * queue) waits until the disk tier has written enough frames. A slow disk therefore slows down the callers of
+	 * Add() (i.e. the render path), instead of the queue growing without limit.
+	 *
+	 * SetMaxBytes() (and SetMaxBytesFromInfo()) set the size of the memory tier, and SetDiskMaxBytes() sets
+	 * the size of the disk tier. For example:
+	 * @code
+	 * openshot::CacheTiered cache(512 * 1024 * 1024, 8LL * 1024 * 1024 * 1024, "/tmp/preview-cache/");
+	 * timeline.SetCache(&cache);
+	 * @endcode
+	 */
+	class CacheTiered : public CacheBase {
+	private:
+		std::unique_ptr<openshot::CacheMemory> memory_cache; ///< The hot (memory) tier
+		std::unique_ptr<openshot::CacheDisk> disk_cache; ///< The cold (disk) tier
+
+		std::thread spill_thread; ///< Background thread, which writes evicted frames to the disk tier
+		std::mutex spill_mutex;
+		std::condition_variable spill_condition;
+		std::deque<std::shared_ptr<openshot::Frame>> spill_queue; ///< Evicted frames waiting to be written to disk
+		int64_t spill_queue_bytes; ///< The bytes of the frames waiting to be written to disk
+		std::shared_ptr<openshot::Frame> spilling_frame; ///< The frame being written to disk (if any)
+		bool is_stopping; ///< Stop the background thread
+
+		/// Queue a frame evicted from the memory tier (called by the memory tier). The queue holds at most half
+		/// the bytes of the memory tier, so if the disk can't keep up, this waits for it.
+		void QueueSpill(std::shared_ptr<openshot::Frame> frame);
+
+		/// Write queued frames to the disk tier (runs on the background thread)
+		void SpillLoop();
+
+		/// Find a frame which is waiting to be written to disk (spill_mutex must be locked)
+		std::shared_ptr<openshot::Frame> FindPendingFrame(int64_t frame_number);
+
+		/// Remove frames which are waiting to be written to disk (spill_mutex must be locked)
+		void RemovePendingFrames(int64_t start_frame_number, int64_t end_frame_number);
+
+		/// Get a frame from either tier, without promoting it into memory
+		std::shared_ptr<openshot::Frame> PeekFrame(int64_t frame_number);
+
+		/// Get the sorted frame numbers of both tiers (and frames waiting to be written to disk)
+		std::vector<int64_t> FrameNumbers();
+
+	protected:
+		/// Update the frame numbers of the range data (frames move between tiers on their own)
+		void UpdateFrameNumbers() override;
+
+	public:
+		/// @brief Constructor
+		/// @param memory_bytes The maximum bytes of the memory tier
+		/// @param disk_bytes The maximum bytes of the disk tier (0 = no limit)
+		/// @param cache_path The folder path of the disk tier (empty string = /tmp/preview-cache/)
+		/// @param format The disk tier format (see CacheDisk, the default stores LZ4 compressed segment files)
+		/// @param scale The scale factor for images stored on disk (1.0 = original size, 0.5 = half size, etc...)
+		CacheTiered(int64_t memory_bytes, int64_t disk_bytes, std::string cache_path="", std::string format="LZ4", float scale=1.0);
+
+		// Default destructor
+		virtual ~CacheTiered();
+
+		/// @brief Add a Frame to the cache
+		/// @param frame The openshot::Frame object needing to be cached.
+		void Add(std::shared_ptr<openshot::Frame> frame);
+
+		/// Clear the cache of all frames (in both tiers)
+		void Clear();
+
+		/// @brief Check if frame is already contained in cache (in either tier)
+		/// @param frame_number The frame number to be checked
+		bool Contains(int64_t frame_number);
+
+		/// Count the frames in the queue (in either tier)
+		int64_t Count();
+
+		/// @brief Get a frame from the cache (frames on disk are promoted back into memory)
+		/// @param frame_number The frame number of the cached frame
+		std::shared_ptr<openshot::Frame> GetFrame(int64_t frame_number);
+
+		/// @brief Get an array of all Frames (sorted by frame number)
+		std::vector<std::shared_ptr<openshot::Frame>> GetFrames();
+
+		/// Gets the total bytes of both tiers
+		int64_t GetBytes();
+
+		/// Get the smallest frame number
+		std::shared_ptr<openshot::Frame> GetSmallestFrame();
+
+		/// Get the memory tier
+		openshot::CacheMemory* GetMemoryCache() { return memory_cache.get(); };
+
+		/// Get the counters of this cache (the hits and misses of both tiers, and the evictions of the disk tier)
+		openshot::CacheStats GetStats() override;
+
+		/// Reset the counters of this cache (and both tiers)
+		void ResetStats() override;
+
+		/// Set the position of the playhead (of the memory tier, see CacheMemory::SetEvictionPolicy)
+		void SetPlayhead(int64_t frame_number, int direction) override;
+
+		/// Get the disk tier
+		openshot::CacheDisk* GetDiskCache() { return disk_cache.get(); };
+
+		/// @brief Remove a specific frame
+		/// @param frame_number The frame number of the cached frame
+		void Remove(int64_t frame_number);
+
+		/// @brief Remove a range of frames
+		/// @param start_frame_number The starting frame number of the cached frame
+		/// @param end_frame_number The ending frame number of the cached frame
+		void Remove(int64_t start_frame_number, int64_t end_frame_number);
+
+		/// @brief Set maximum bytes of the memory tier
+		/// @param number_of_bytes The maximum bytes to keep in memory. Once exceeded, the oldest frames are moved to disk.
+		void SetMaxBytes(int64_t number_of_bytes) override;
+
+		/// @brief Set maximum bytes of the disk tier
+		/// @param number_of_bytes The maximum bytes to keep on disk. Once exceeded, the oldest frames are removed.
+		void SetDiskMaxBytes(int64_t number_of_bytes);
+
+		/// Wait until all evicted frames have been written to the disk tier
+		void WaitForSpill();
+
+		// Get and Set JSON methods
+		std::string Json(); ///< Generate JSON string of this object
+		void SetJson(const std::string value); ///< Load JSON string into this object
+		Json::Value JsonValue(); ///< Generate Json::Value for this object
+		void SetJsonValue(const Json::Value root); ///< Load Json::Value into this object
+	};
+
+}
+
+#endif
@@ -0,0 +1,368 @@
+/**
+ * @file
+ * @brief Source file for Calibration class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <QDir>
+#include <QSysInfo>
+
+#include "Calibration.h"
+#include "Clip.h"
+#include "DummyReader.h"
+#include "Exceptions.h"
+#include "FFmpegWriter.h"
+#include "Frame.h"
+#include "KeyFrame.h"
+#include "OpenMPUtilities.h"
+#include "RenderStats.h"
+#include "Settings.h"
+#include "Timeline.h"
+#include "ZmqLogger.h"
+
+using namespace openshot;
+
+namespace {
+	// The thread counts to try: powers of 2 below the number of cores, and all cores
+	std::vector<int> thread_counts() {
+		const int cores = std::max(2, omp_get_num_procs());
+		std::vector<int> counts;
+		for (int count = 2; count < cores; count *= 2)
+			counts.push_back(count);
+		counts.push_back(cores);
+		return counts;
+	}
+
+	// The fastest thread count (a count must be 5% faster than the smaller counts, to be worth its threads)
+	struct Fastest {
+		int count = 0;
+		double seconds = std::numeric_limits<double>::infinity();
+
+		void Add(int new_count, double new_seconds) {
+			if (new_seconds < seconds * 0.95) {
+				count = new_count;
+				seconds = new_seconds;
+			}
+		}
+	};
+
+	// Seconds since a time
+	double seconds_since(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// Encode frames with a codec (returns the seconds, or a negative number if the codec can't be used)
+	double encode_probe(const std::string& codec, int width, int height, const std::vector<std::shared_ptr<Frame>>& frames) {
+		const std::string path = (QDir::tempPath() + QString("/openshot-calibration.mkv")).toStdString();
+		double seconds = -1.0;
+		try {
+			FFmpegWriter w(path);
+			w.SetVideoOptions(true, codec, Fraction(30, 1), width, height, Fraction(1, 1), false, false, 8000000);
+			const auto start = std::chrono::steady_clock::now();
+			w.Open();
+			for (const auto& frame : frames)
+				w.WriteFrame(frame);
+			w.Close();
+			seconds = seconds_since(start);
+		} catch (const ExceptionBase& e) {
+			// i.e. the codec is not available
+		}
+		std::remove(path.c_str());
+		return seconds;
+	}
+
+	// Read the calibration file (or an empty object)
+	Json::Value read_file(const std::string& path) {
+		std::ifstream input(path);
+		if (!input.good())
+			return Json::Value(Json::objectValue);
+		const std::string contents((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+		try {
+			Json::Value root = openshot::stringToJson(contents);
+			if (root.isObject())
+				return root;
+		} catch (const ExceptionBase& e) {
+			// A damaged file is replaced
+		}
+		return Json::Value(Json::objectValue);
+	}
+
+	// Write the calibration file (through a temporary file, so a partial file is never loaded)
+	bool write_file(const std::string& path, const Json::Value& root) {
+		const std::string temp_path = path + ".tmp";
+		std::ofstream output(temp_path, std::ios::out | std::ios::trunc);
+		output << root.toStyledString();
+		output.close();
+		if (!output.good()) {
+			std::remove(temp_path.c_str());
+			return false;
+		}
+		std::remove(path.c_str());
+		return std::rename(temp_path.c_str(), path.c_str()) == 0;
+	}
+
+	// The state of the runtime tuning (see Calibration::Adjust)
+	struct Tuning {
+		std::mutex mutex;
+		int64_t frames = 0; ///< The frame count of the last adjustment
+		int64_t stage_ns[RENDER_STAGE_COUNT] = {}; ///< The stage times of the last adjustment
+		double frame_ms = 0.0; ///< The average time of a frame, before the last step
+		int *stepped = NULL; ///< The setting of the last step (or NULL)
+		int step = 0;
+		bool ff_stopped = false; ///< A step of FF_THREADS made the frames slower
+		bool omp_stopped = false; ///< A step of OMP_THREADS made the frames slower
+	};
+	Tuning tuning;
+}
+
+// Time the probes, and set the fastest thread counts and cache sizes
+Json::Value Calibration::Run(ReaderBase* media, int frames, const std::string& codec) {
+	Settings *s = Settings::Instance();
+	frames = std::max(frames, 4);
+	const std::vector<int> counts = thread_counts();
+	const bool has_media = media && media->info.has_video && media->info.video_length > 0;
+	const bool was_open = media && media->IsOpen();
+
+	// Probe at the size and frame rate of the media (encoders need even sizes)
+	const int width = has_media ? std::max(2, media->info.width & ~1) : 1920;
+	const int height = has_media ? std::max(2, media->info.height & ~1) : 1080;
+	const double fps = (has_media && media->info.fps.ToDouble() > 0.0) ? media->info.fps.ToDouble() : 30.0;
+
+	DummyReader patterns(Fraction(30, 1), width, height, 44100, 2, 3600.0);
+	patterns.SetProcedural(true);
+	patterns.Open();
+	std::vector<std::shared_ptr<Frame>> pattern_frames;
+	for (int64_t number = 1; number <= frames; number++)
+		pattern_frames.push_back(patterns.GetFrame(number));
+
+	// Decode and encode (FF_THREADS): each thread count decodes other frames (so no cache has them)
+	Json::Value result;
+	Fastest ff;
+	double decode_seconds = 0.0;
+	double encode_seconds = 0.0;
+	bool can_encode = !codec.empty();
+	const int original_ff_threads = s->FF_THREADS;
+	for (size_t index = 0; index < counts.size() && (has_media || can_encode); index++) {
+		s->FF_THREADS = counts[index];
+		double decode = 0.0;
+		if (has_media) {
+			const int64_t range = std::max<int64_t>(1, media->info.video_length - frames);
+			const int64_t first = 1 + (int64_t(index) * frames) % range;
+			media->Close();
+			media->Open();
+			const auto start = std::chrono::steady_clock::now();
+			for (int64_t number = first; number < first + frames; number++)
+				media->GetFrame(number);
+			decode = seconds_since(start);
+		}
+		double encode = can_encode ? encode_probe(codec, width, height, pattern_frames) : 0.0;
+		if (encode < 0.0) {
+			can_encode = false;
+			encode = 0.0;
+		}
+		const double before = ff.seconds;
+		ff.Add(counts[index], decode + encode);
+		if (ff.seconds != before) {
+			decode_seconds = decode;
+			encode_seconds = encode;
+		}
+	}
+	s->FF_THREADS = (has_media || can_encode) ? ff.count : original_ff_threads;
+	if (has_media || can_encode) {
+		result["FF_THREADS"] = ff.count;
+		if (has_media)
+			result["decode_ms"] = decode_seconds * 1000.0 / frames;
+		if (can_encode)
+			result["encode_ms"] = encode_seconds * 1000.0 / frames;
+	}
+
+	// Composite (OMP_THREADS): 3 blended layers (the media on the bottom layer)
+	Fastest omp;
+	{
+		Timeline t(width, height, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+		std::vector<std::unique_ptr<Clip>> clips;
+		for (int layer = 1; layer <= 3; layer++) {
+			clips.push_back(std::make_unique<Clip>((layer == 1 && has_media) ? media : &patterns));
+			clips.back()->Layer(layer);
+			if (layer > 1)
+				clips.back()->alpha = Keyframe(0.6);
+			t.AddClip(clips.back().get());
+		}
+		t.Open();
+		const int64_t length = has_media ? std::max<int64_t>(1, media->info.video_length - frames) : 3600 * 30;
+		for (size_t index = 0; index < counts.size(); index++) {
+			s->OMP_THREADS = counts[index];
+			const int64_t first = 1 + (int64_t(index) * frames) % length;
+			const auto start = std::chrono::steady_clock::now();
+			for (int64_t number = first; number < first + frames; number++)
+				t.GetFrame(number);
+			omp.Add(counts[index], seconds_since(start));
+		}
+		t.Close();
+	}
+	patterns.Close();
+	if (media) {
+		// The probe's clip is gone
+		media->ParentClip(NULL);
+		if (was_open && !media->IsOpen())
+			media->Open();
+		else if (!was_open && media->IsOpen())
+			media->Close();
+	}
+	result["OMP_THREADS"] = omp.count;
+	const double frame_seconds = omp.seconds / frames;
+	result["composite_ms"] = frame_seconds * 1000.0;
+
+	// Cache: enough frames rendered at once to keep up with playback (with some headroom), and
+	// half a second of preroll (more, if the frames still render slower than they play)
+	const int cores = std::max(2, omp_get_num_procs());
+	const int cache_threads = std::min(cores, std::max(1, int(std::ceil(frame_seconds * fps * 1.5))));
+	const double slowdown = std::max(1.0, frame_seconds * fps / cache_threads);
+	const int min_preroll = std::min(120, std::max(8, int(std::ceil(fps * 0.5 * slowdown))));
+	result["VIDEO_CACHE_THREADS"] = cache_threads;
+	result["VIDEO_CACHE_MIN_PREROLL_FRAMES"] = min_preroll;
+	result["VIDEO_CACHE_MAX_PREROLL_FRAMES"] = min_preroll * 2;
+
+	Apply(result);
+
+	// Keep the results of this machine
+	if (!s->CALIBRATION_PATH.empty()) {
+		Json::Value root = read_file(s->CALIBRATION_PATH);
+		root["machines"][MachineKey()] = result;
+		write_file(s->CALIBRATION_PATH, root);
+	}
+
+	ZMQ_DEBUG(
+		"Calibration::Run",
+		"OMP_THREADS", s->OMP_THREADS,
+		"FF_THREADS", s->FF_THREADS,
+		"VIDEO_CACHE_THREADS", s->VIDEO_CACHE_THREADS,
+		"composite_ms", frame_seconds * 1000.0);
+	return result;
+}
+
+// Apply the settings calibrated on this machine
+bool Calibration::Load() {
+	const std::string path = Settings::Instance()->CALIBRATION_PATH;
+	if (path.empty())
+		return false;
+
+	const Json::Value root = read_file(path);
+	const Json::Value machine = root["machines"][MachineKey()];
+	if (!machine.isObject())
+		return false;
+	Apply(machine);
+	return true;
+}
+
+// Apply calibrated settings
+void Calibration::Apply(const Json::Value& settings) {
+	Settings *s = Settings::Instance();
+	if (settings["OMP_THREADS"].isInt())
+		s->OMP_THREADS = settings["OMP_THREADS"].asInt();
+	if (settings["FF_THREADS"].isInt())
+		s->FF_THREADS = settings["FF_THREADS"].asInt();
+	if (settings["VIDEO_CACHE_THREADS"].isInt())
+		s->VIDEO_CACHE_THREADS = settings["VIDEO_CACHE_THREADS"].asInt();
+	if (settings["VIDEO_CACHE_MIN_PREROLL_FRAMES"].isInt())
+		s->VIDEO_CACHE_MIN_PREROLL_FRAMES = settings["VIDEO_CACHE_MIN_PREROLL_FRAMES"].asInt();
+	if (settings["VIDEO_CACHE_MAX_PREROLL_FRAMES"].isInt())
+		s->VIDEO_CACHE_MAX_PREROLL_FRAMES = settings["VIDEO_CACHE_MAX_PREROLL_FRAMES"].asInt();
+}
+
+// Tune the thread counts while rendering
+void Calibration::Adjust() {
+	Settings *s = Settings::Instance();
+	if (!s->ENABLE_AUTO_TUNING || !s->ENABLE_RENDER_STATS)
+		return;
+
+	// Only one thread adjusts (the others keep rendering)
+	std::unique_lock<std::mutex> lock(tuning.mutex, std::try_to_lock);
+	if (!lock.owns_lock())
+		return;
+
+	RenderStats *stats = RenderStats::Instance();
+	const int64_t frames = stats->Stage(RENDER_STAGE_FRAME).count.load(std::memory_order_relaxed);
+	const int64_t window = (s->RENDER_STATS_LOG_FRAMES > 0) ? s->RENDER_STATS_LOG_FRAMES : 100;
+	if (frames >= tuning.frames && frames < tuning.frames + window)
+		return;
+
+	// The stage times of the frames since the last adjustment
+	int64_t stage_ns[RENDER_STAGE_COUNT];
+	for (int stage = 0; stage < RENDER_STAGE_COUNT; stage++) {
+		const int64_t total = stats->Stage(RenderStage(stage)).total_ns.load(std::memory_order_relaxed);
+		stage_ns[stage] = total - tuning.stage_ns[stage];
+		tuning.stage_ns[stage] = total;
+	}
+	const int64_t window_frames = frames - tuning.frames;
+	tuning.frames = frames;
+	if (window_frames <= 0) {
+		// The stats were reset (start again from here)
+		tuning.stepped = NULL;
+		return;
+	}
+	const double frame_ms = stage_ns[RENDER_STAGE_FRAME] / 1000000.0 / window_frames;
+
+	// Undo a step which made the frames slower (and stop growing that setting)
+	if (tuning.stepped && frame_ms > tuning.frame_ms * 1.05) {
+		*tuning.stepped -= tuning.step;
+		if (tuning.stepped == &s->FF_THREADS)
+			tuning.ff_stopped = true;
+		else
+			tuning.omp_stopped = true;
+		tuning.stepped = NULL;
+		ZMQ_DEBUG(
+			"Calibration::Adjust (undo)",
+			"OMP_THREADS", s->OMP_THREADS,
+			"FF_THREADS", s->FF_THREADS,
+			"frame_ms", frame_ms);
+		return;
+	}
+	tuning.frame_ms = frame_ms;
+	tuning.stepped = NULL;
+
+	// Grow the threads of the slowest stage
+	const int cores = std::max(2, omp_get_num_procs());
+	const int64_t decode_ns = stage_ns[RENDER_STAGE_DECODE] + stage_ns[RENDER_STAGE_SCALE];
+	const int64_t render_ns = stage_ns[RENDER_STAGE_COMPOSITE] + stage_ns[RENDER_STAGE_TRANSFORM] + stage_ns[RENDER_STAGE_EFFECT];
+	int *setting = NULL;
+	if (decode_ns > render_ns && !tuning.ff_stopped && s->FF_THREADS < cores)
+		setting = &s->FF_THREADS;
+	else if (render_ns >= decode_ns && !tuning.omp_stopped && s->OMP_THREADS < cores)
+		setting = &s->OMP_THREADS;
+	if (!setting)
+		return;
+
+	tuning.step = std::min(2, cores - *setting);
+	*setting += tuning.step;
+	tuning.stepped = setting;
+
+	ZMQ_DEBUG(
+		"Calibration::Adjust",
+		"OMP_THREADS", s->OMP_THREADS,
+		"FF_THREADS", s->FF_THREADS,
+		"frame_ms", frame_ms);
+}
+
+// Get the key of this machine in the calibration file
+std::string Calibration::MachineKey() {
+	return QSysInfo::machineHostName().toStdString() + "/" + QSysInfo::currentCpuArchitecture().toStdString() +
+		"/" + std::to_string(omp_get_num_procs());
+}
@@ -0,0 +1,85 @@
+/**
+ * @file
+ * @brief Header file for Calibration class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_CALIBRATION_H
+#define OPENSHOT_CALIBRATION_H
+
+#include <string>
+
+#include "Json.h"
+
+namespace openshot {
+
+	// Forward declaration
+	class ReaderBase;
+
+	/**
+	 * @brief This class tunes the thread counts and cache sizes of the Settings for the machine (and media) it runs on
+	 *
+	 * The defaults of Settings::OMP_THREADS, Settings::FF_THREADS and the VIDEO_CACHE_* settings are guesses.
+	 * Run() times short probes with a few thread counts, and keeps the fastest ones:
+	 *
+	 * - Decode and encode: frames of the media are decoded (reopening it for each thread count, since
+	 *   decoders get their threads when they are opened), and test patterns are encoded with the export
+	 *   codec, to pick FF_THREADS.
+	 * - Composite: a timeline of 3 blended layers (of the media, or of test patterns) is rendered, to
+	 *   pick OMP_THREADS.
+	 * - Cache: the time of a composited frame sets how many frames are rendered ahead of the playhead at
+	 *   once (VIDEO_CACHE_THREADS), and the preroll (VIDEO_CACHE_MIN_PREROLL_FRAMES and
+	 *   VIDEO_CACHE_MAX_PREROLL_FRAMES).
+	 *
+	 * The results are kept by machine (host name, processor architecture and core count) in the JSON file
+	 * of Settings::CALIBRATION_PATH, so each machine of a render farm keeps its own, and Load() applies
+	 * them in the next session. While rendering, Adjust() keeps tuning the thread counts from the stage
+	 * times of RenderStats (see Settings::ENABLE_AUTO_TUNING).
+	 *
+	 * \code
+	 * Settings::Instance()->CALIBRATION_PATH = "/home/user/.openshot_qt/calibration.json";
+	 * if (!Calibration::Load()) {
+	 *     FFmpegReader r("typical-source.mp4");
+	 *     Calibration::Run(&r, 24, "libx264");
+	 * }
+	 * \endcode
+	 */
+	class Calibration {
+	public:
+		/// @brief Time the probes, set the fastest thread counts and cache sizes, and keep them (if
+		/// Settings::CALIBRATION_PATH is set). This takes a few seconds.
+		/// @returns The chosen settings, and the time of a frame of each probe (in milliseconds)
+		/// @param media A reader of typical media (opened and closed by the probes), or NULL for test patterns only
+		/// @param frames The number of frames of each probe
+		/// @param codec The video codec of the encode probe (or empty to skip it)
+		static Json::Value Run(openshot::ReaderBase* media = NULL, int frames = 24, const std::string& codec = "mpeg4");
+
+		/// @brief Apply the settings calibrated on this machine (from Settings::CALIBRATION_PATH)
+		/// @returns false if this machine has not been calibrated
+		static bool Load();
+
+		/// @brief Apply calibrated settings (as returned by Run)
+		/// @param settings The chosen settings
+		static void Apply(const Json::Value& settings);
+
+		/// @brief Tune the thread counts while rendering (called by the timeline, if Settings::ENABLE_AUTO_TUNING).
+		///
+		/// Every Settings::RENDER_STATS_LOG_FRAMES frames, the stage times of the frames since the last
+		/// adjustment are compared: the thread count of the slowest stage (FF_THREADS for decoding, and
+		/// OMP_THREADS for compositing, transforms and effects) grows by one step, and a step which made
+		/// the frames slower is undone. Decoders get the new FF_THREADS when they are opened again.
+		static void Adjust();
+
+		/// Get the key of this machine in the calibration file (host name, processor architecture and core count)
+		static std::string MachineKey();
+	};
+
+}
+
+#endif
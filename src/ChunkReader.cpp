@@ -21,7 +21,8 @@
 using namespace openshot;
 
 ChunkReader::ChunkReader(std::string path, ChunkVersion chunk_version)
-		: path(path), chunk_size(24 * 3), is_open(false), version(chunk_version), local_reader(NULL)
+		: path(path), chunk_size(24 * 3), is_open(false), version(chunk_version), local_reader(NULL),
+		  reader_pool_size(3), prefetch_number(0)
 {
 	// Check if folder exists?
 	if (!does_folder_exist(path))
@@ -37,6 +38,11 @@ ChunkReader::ChunkReader(std::string path, ChunkVersion chunk_version)
 	Close();
 }
 
+ChunkReader::~ChunkReader()
+{
+	Close();
+}
+
 // Check if folder path existing
 bool ChunkReader::does_folder_exist(std::string path)
 {
@@ -151,6 +157,13 @@ void ChunkReader::Close()
 	// Close all objects, if reader is 'open'
 	if (is_open)
 	{
+		// Close the open chunks (and the chunk being opened in the background)
+		cancel_prefetch();
+		open_chunks.clear();
+		local_reader = NULL;
+		previous_location.number = 0;
+		previous_location.frame = 0;
+
 		// Mark as "closed"
 		is_open = false;
 	}
@@ -179,51 +192,117 @@ std::string ChunkReader::get_chunk_path(int64_t chunk_number, std::string folder
 		return "";
 }
 
-// Get an openshot::Frame object for a specific frame number of this reader.
-std::shared_ptr<Frame> ChunkReader::GetFrame(int64_t requested_frame)
+// Open the video of a chunk, or return nullptr if it is missing or invalid
+std::unique_ptr<FFmpegReader> ChunkReader::open_chunk(int64_t chunk_number)
 {
-	// Determine what chunk contains this frame
-	ChunkLocation location = find_chunk_frame(requested_frame);
+	// Determine version of chunk
+	std::string folder_name = "";
+	switch (version)
+	{
+	case THUMBNAIL:
+		folder_name = "thumb";
+		break;
+	case PREVIEW:
+		folder_name = "preview";
+		break;
+	case FINAL:
+		folder_name = "final";
+		break;
+	}
 
-	// New Chunk (Close the old reader, and open the new one)
-	if (previous_location.number != location.number)
+	// Load path of chunk video
+	std::string chunk_video_path = get_chunk_path(chunk_number, folder_name, ".webm");
+
+	try
 	{
-		// Determine version of chunk
-		std::string folder_name = "";
-		switch (version)
-		{
-		case THUMBNAIL:
-			folder_name = "thumb";
-			break;
-		case PREVIEW:
-			folder_name = "preview";
-			break;
-		case FINAL:
-			folder_name = "final";
-			break;
-		}
+		// Load new FFmpegReader (without inspecting it first, since the chunk info is already known,
+		// so the chunk is only probed once, by Open)
+		std::unique_ptr<FFmpegReader> reader(new FFmpegReader(chunk_video_path, false));
+		reader->Open(); // open reader
+		return reader;
 
-		// Load path of chunk video
-		std::string chunk_video_path = get_chunk_path(location.number, folder_name, ".webm");
+	} catch (const ExceptionBase&)
+	{
+		// Invalid Chunk (possibly it is not found)
+		return nullptr;
+	}
+}
 
-		// Close existing reader (if needed)
-		if (local_reader)
-		{
-			// Close and delete old reader
-			local_reader->Close();
-			delete local_reader;
+// Get the open reader of a chunk
+FFmpegReader* ChunkReader::get_chunk_reader(int64_t chunk_number)
+{
+	// A different chunk is being opened in the background (i.e. after a seek), so close it (otherwise
+	// the next chunk is never opened in the background again)
+	if (prefetch_number != 0 && prefetch_number != chunk_number)
+		cancel_prefetch();
+
+	// Already open (move it to the front of the pool)
+	for (auto chunk = open_chunks.begin(); chunk != open_chunks.end(); ++chunk) {
+		if (chunk->number == chunk_number) {
+			open_chunks.splice(open_chunks.begin(), open_chunks, chunk);
+			return open_chunks.front().reader.get();
 		}
+	}
 
-		try
-		{
-			// Load new FFmpegReader
-			local_reader = new FFmpegReader(chunk_video_path);
-			local_reader->Open(); // open reader
+	// Being opened in the background (wait for it), or open it now
+	std::unique_ptr<FFmpegReader> reader;
+	if (prefetch_number == chunk_number) {
+		reader = prefetch_reader.get();
+		prefetch_number = 0;
+	} else {
+		reader = open_chunk(chunk_number);
+	}
+	if (!reader)
+		return nullptr;
 
-		} catch (const InvalidFile& e)
-		{
+	open_chunks.push_front(OpenChunk{chunk_number, std::move(reader)});
+	trim_open_chunks();
+	return open_chunks.front().reader.get();
+}
+
+// Wait for the background opening of a chunk (and close it)
+void ChunkReader::cancel_prefetch()
+{
+	if (prefetch_number == 0)
+		return;
+	prefetch_reader.get();
+	prefetch_number = 0;
+}
+
+// Close the least recently used chunks
+void ChunkReader::trim_open_chunks()
+{
+	while (open_chunks.size() > size_t(reader_pool_size))
+		open_chunks.pop_back();
+}
+
+// Get an openshot::Frame object for a specific frame number of this reader.
+std::shared_ptr<Frame> ChunkReader::GetFrame(int64_t requested_frame)
+{
+	// Only one frame is read at a time (the open chunks are shared)
+	const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+
+	// Determine what chunk contains this frame
+	ChunkLocation location = find_chunk_frame(requested_frame);
+
+	// New Chunk (switch to its reader, which is opened if needed)
+	if (previous_location.number != location.number)
+	{
+		local_reader = get_chunk_reader(location.number);
+		if (!local_reader)
 			// Invalid Chunk (possibly it is not found)
 			throw ChunkNotFound(path, requested_frame, location.number, location.frame);
+
+		// Reading in order, so open the next chunk in the background
+		if (location.number == previous_location.number + 1 && prefetch_number == 0) {
+			const int64_t next_number = location.number + 1;
+			bool next_open = false;
+			for (const auto& chunk : open_chunks)
+				next_open = next_open || chunk.number == next_number;
+			if (!next_open) {
+				prefetch_number = next_number;
+				prefetch_reader = std::async(std::launch::async, &ChunkReader::open_chunk, this, next_number);
+			}
 		}
 
 		// Set the new location
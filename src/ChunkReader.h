@@ -13,6 +13,8 @@
 #ifndef OPENSHOT_CHUNK_READER_H
 #define OPENSHOT_CHUNK_READER_H
 
+#include <future>
+#include <list>
 #include <string>
 #include <memory>
 
@@ -22,6 +24,7 @@
 namespace openshot
 {
 	class CacheBase;
+	class FFmpegReader;
 	class Frame;
 	/**
 	 * @brief This struct holds the location of a frame within a chunk.
@@ -74,6 +77,11 @@ namespace openshot
 	 * // Close the reader
 	 * r.Close();
 	 * \endcode
+	 *
+	 * The most recently used chunks stay open (see SetReaderPoolSize), so scrubbing back and forth across
+	 * a chunk boundary does not re-open the chunks. While frames are read in order, the next chunk is
+	 * opened in the background. Chunks are not probed when their reader is created, since the info of the
+	 * chunks is already known (from the info.json file of the chunk folder).
 	 */
 	class ChunkReader : public ReaderBase
 	{
@@ -86,6 +94,16 @@ namespace openshot
 		ChunkVersion version;
 		std::shared_ptr<openshot::Frame> last_frame;
 
+		/// An open chunk (most recently used first)
+		struct OpenChunk {
+			int64_t number;
+			std::unique_ptr<openshot::FFmpegReader> reader;
+		};
+		std::list<OpenChunk> open_chunks;
+		int reader_pool_size;
+		int64_t prefetch_number; ///< The chunk being opened in the background (0 = none)
+		std::future<std::unique_ptr<openshot::FFmpegReader>> prefetch_reader;
+
 		/// Check if folder path existing
 		bool does_folder_exist(std::string path);
 
@@ -98,6 +116,18 @@ namespace openshot
 		/// Load JSON meta data about this chunk folder
 		void load_json();
 
+		/// Open the video of a chunk (of the chosen version), or return nullptr if it is missing or invalid
+		std::unique_ptr<openshot::FFmpegReader> open_chunk(int64_t chunk_number);
+
+		/// Get the open reader of a chunk (re-using an open or prefetched chunk, if possible)
+		openshot::FFmpegReader* get_chunk_reader(int64_t chunk_number);
+
+		/// Wait for the background opening of a chunk (and close it)
+		void cancel_prefetch();
+
+		/// Close the least recently used chunks, until only reader_pool_size chunks are open
+		void trim_open_chunks();
+
 	public:
 
 		/// @brief Constructor for ChunkReader.  This automatically opens the chunk file or folder and loads
@@ -106,6 +136,9 @@ namespace openshot
 		/// @param chunk_version	Choose the video version / quality (THUMBNAIL, PREVIEW, or FINAL)
 		ChunkReader(std::string path, ChunkVersion chunk_version);
 
+		/// Destructor
+		virtual ~ChunkReader();
+
 		/// Close the reader
 		void Close() override;
 
@@ -117,6 +150,16 @@ namespace openshot
 		/// @param new_size		The number of frames per chunk
 		void SetChunkSize(int64_t new_size) { chunk_size = new_size; };
 
+		/// Get the number of chunks which are kept open
+		int GetReaderPoolSize() { return reader_pool_size; };
+
+		/// @brief Set the number of chunks which are kept open (the most recently used chunks)
+		/// @param new_size		The number of open chunks (at least 1)
+		void SetReaderPoolSize(int new_size) { reader_pool_size = (new_size < 1) ? 1 : new_size; };
+
+		/// Get the chunk being opened in the background (0 = none)
+		int64_t GetPrefetchChunk() { return prefetch_number; };
+
 		/// Get the cache object used by this reader (always return NULL for this reader)
 		openshot::CacheBase* GetCache() override { return nullptr; };
 
@@ -13,6 +13,7 @@
 #include "ChunkWriter.h"
 #include "Exceptions.h"
 #include "Frame.h"
+#include "RenderTrace.h"
 
 using namespace openshot;
 
@@ -37,6 +38,19 @@ ChunkWriter::ChunkWriter(std::string path, ReaderBase *reader) :
 	local_reader->Open();
 }
 
+// Destructor
+ChunkWriter::~ChunkWriter()
+{
+	// Stop the encoding threads of an unfinished chunk
+	if (is_writing) {
+		try {
+			finish_chunk();
+		} catch (...) {
+			// Errors can't be thrown from a destructor
+		}
+	}
+}
+
 // get a formatted path of a specific chunk
 std::string ChunkWriter::get_chunk_path(int64_t chunk_number, std::string folder, std::string extension)
 {
@@ -73,33 +87,8 @@ void ChunkWriter::WriteFrame(std::shared_ptr<openshot::Frame> frame)
 		// Save thumbnail of chunk start frame
 		frame->Save(get_chunk_path(chunk_count, "", ".jpeg"), 1.0);
 
-		// Create FFmpegWriter (FINAL quality)
-		create_folder(get_chunk_path(chunk_count, "final", ""));
-		writer_final = new FFmpegWriter(get_chunk_path(chunk_count, "final", default_extension));
-		writer_final->SetAudioOptions(true, default_acodec, info.sample_rate, info.channels, info.channel_layout, 128000);
-		writer_final->SetVideoOptions(true, default_vcodec, info.fps, info.width, info.height, info.pixel_ratio, false, false, info.video_bit_rate);
-
-		// Create FFmpegWriter (PREVIEW quality)
-		create_folder(get_chunk_path(chunk_count, "preview", ""));
-		writer_preview = new FFmpegWriter(get_chunk_path(chunk_count, "preview", default_extension));
-		writer_preview->SetAudioOptions(true, default_acodec, info.sample_rate, info.channels, info.channel_layout, 128000);
-		writer_preview->SetVideoOptions(true, default_vcodec, info.fps, info.width * 0.5, info.height * 0.5, info.pixel_ratio, false, false, info.video_bit_rate * 0.5);
-
-		// Create FFmpegWriter (LOW quality)
-		create_folder(get_chunk_path(chunk_count, "thumb", ""));
-		writer_thumb = new FFmpegWriter(get_chunk_path(chunk_count, "thumb", default_extension));
-		writer_thumb->SetAudioOptions(true, default_acodec, info.sample_rate, info.channels, info.channel_layout, 128000);
-		writer_thumb->SetVideoOptions(true, default_vcodec, info.fps, info.width * 0.25, info.height * 0.25, info.pixel_ratio, false, false, info.video_bit_rate * 0.25);
-
-		// Prepare Streams
-		writer_final->PrepareStreams();
-		writer_preview->PrepareStreams();
-		writer_thumb->PrepareStreams();
-
-		// Write header
-		writer_final->WriteHeader();
-		writer_preview->WriteHeader();
-		writer_thumb->WriteHeader();
+		// Create the writers (final, preview and thumb quality)
+		start_chunk();
 
 		// Keep track that a chunk is being written
 		is_writing = true;
@@ -113,18 +102,14 @@ void ChunkWriter::WriteFrame(std::shared_ptr<openshot::Frame> frame)
 		if (last_frame)
 		{
 			// Write the previous chunks LAST FRAME to the current chunk
-			writer_final->WriteFrame(last_frame);
-			writer_preview->WriteFrame(last_frame);
-			writer_thumb->WriteFrame(last_frame);
+			write_renditions(last_frame);
 		} else {
 			// Write the 1st frame (of the 1st chunk)... since no previous chunk is available
 			auto blank_frame = std::make_shared<Frame>(
 				1, info.width, info.height, "#000000",
 				info.sample_rate, info.channels);
 			blank_frame->AddColor(info.width, info.height, "#000000");
-			writer_final->WriteFrame(blank_frame);
-			writer_preview->WriteFrame(blank_frame);
-			writer_thumb->WriteFrame(blank_frame);
+			write_renditions(blank_frame);
 		}
 
 		// disable last frame
@@ -134,33 +119,18 @@ void ChunkWriter::WriteFrame(std::shared_ptr<openshot::Frame> frame)
 
 	//////////////////////////////////////////////////
 	// WRITE THE CURRENT FRAME TO THE CURRENT CHUNK
-	writer_final->WriteFrame(frame);
-	writer_preview->WriteFrame(frame);
-	writer_thumb->WriteFrame(frame);
+	write_renditions(frame);
 	//////////////////////////////////////////////////
 
 
 	// Write the frames once it reaches the correct chunk size
 	if (frame_count % chunk_size == 0 && frame_count >= chunk_size)
 	{
-		// Pad an additional 12 frames
-		for (int z = 0; z<12; z++)
-		{
-			// Repeat frame
-			writer_final->WriteFrame(frame);
-			writer_preview->WriteFrame(frame);
-			writer_thumb->WriteFrame(frame);
-		}
-
-		// Write Footer
-		writer_final->WriteTrailer();
-		writer_preview->WriteTrailer();
-		writer_thumb->WriteTrailer();
+		// Pad an additional 12 frames (repeat frame)
+		write_renditions(frame, 12);
 
-		// Close writer & reader
-		writer_final->Close();
-		writer_preview->Close();
-		writer_thumb->Close();
+		// Write Footer, and close the writers
+		finish_chunk();
 
 		// Increment chunk count
 		chunk_count++;
@@ -176,6 +146,136 @@ void ChunkWriter::WriteFrame(std::shared_ptr<openshot::Frame> frame)
 	last_frame = frame;
 }
 
+// Create a copy of a frame, with its image scaled to a new size
+static std::shared_ptr<Frame> scaled_frame(std::shared_ptr<Frame> frame, int width, int height)
+{
+	std::shared_ptr<QImage> image = frame->GetImage();
+	if (!image || (image->width() == width && image->height() == height))
+		return frame;
+
+	const int channels = frame->has_audio_data ? frame->GetAudioChannelsCount() : 0;
+	const int samples = frame->has_audio_data ? frame->GetAudioSamplesCount() : 0;
+	auto scaled = std::make_shared<Frame>(frame->number, width, height, "#000000", samples, channels);
+	scaled->SetPixelRatio(frame->GetPixelRatio().num, frame->GetPixelRatio().den);
+	scaled->AddImage(std::make_shared<QImage>(
+		image->scaled(width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation)));
+
+	// Copy the audio (each encoder reads it on its own thread)
+	scaled->SampleRate(frame->SampleRate());
+	scaled->ChannelsLayout(frame->ChannelsLayout());
+	for (int channel = 0; channel < channels; channel++)
+		scaled->AddAudio(true, channel, 0, frame->GetAudioSamples(channel), samples, 1.0);
+	return scaled;
+}
+
+// Create the writers of a new chunk, and start their encoding threads
+void ChunkWriter::start_chunk()
+{
+	if (renditions.empty()) {
+		for (const auto& size : {std::make_pair("final", 1.0), std::make_pair("preview", 0.5), std::make_pair("thumb", 0.25)}) {
+			auto rendition = std::make_unique<ChunkRendition>();
+			rendition->folder = size.first;
+			rendition->scale = size.second;
+			rendition->width = info.width * size.second;
+			rendition->height = info.height * size.second;
+			renditions.push_back(std::move(rendition));
+		}
+	}
+
+	for (auto& rendition : renditions) {
+		// Create FFmpegWriter (of this size)
+		create_folder(get_chunk_path(chunk_count, rendition->folder, ""));
+		rendition->writer = new FFmpegWriter(get_chunk_path(chunk_count, rendition->folder, default_extension));
+		rendition->writer->SetAudioOptions(true, default_acodec, info.sample_rate, info.channels, info.channel_layout, 128000);
+		rendition->writer->SetVideoOptions(true, default_vcodec, info.fps, rendition->width, rendition->height, info.pixel_ratio,
+			false, false, info.video_bit_rate * rendition->scale);
+
+		// Prepare Streams, and write header
+		rendition->writer->PrepareStreams();
+		rendition->writer->WriteHeader();
+
+		// Encode the frames of this size on its own thread
+		rendition->error = nullptr;
+		rendition->thread = std::thread(&ChunkWriter::encode_rendition, rendition.get());
+	}
+}
+
+// Scale a frame for each rendition (each from the previous size), and queue it
+void ChunkWriter::write_renditions(std::shared_ptr<openshot::Frame> frame, int repeat)
+{
+	std::shared_ptr<Frame> source = frame;
+	for (auto& rendition : renditions) {
+		std::shared_ptr<Frame> rendition_frame = scaled_frame(source, rendition->width, rendition->height);
+		for (int z = 0; z < repeat; z++)
+			queue_frame(*rendition, rendition_frame);
+		source = rendition_frame;
+	}
+}
+
+// Queue a frame for a rendition (waiting while its queue is full)
+void ChunkWriter::queue_frame(ChunkRendition& rendition, std::shared_ptr<openshot::Frame> frame)
+{
+	{
+		std::unique_lock<std::mutex> lock(rendition.queueMutex);
+		rendition.queueChanged.wait(lock, [&rendition]() { return rendition.queue.size() < 8; });
+		rendition.queue.push_back(frame);
+	}
+	rendition.queueChanged.notify_all();
+}
+
+// Wait for the encoding threads to write and close the chunk
+void ChunkWriter::finish_chunk()
+{
+	// The end of the chunk (the encoders write their footer, and close)
+	for (auto& rendition : renditions)
+		queue_frame(*rendition, nullptr);
+
+	std::exception_ptr error;
+	for (auto& rendition : renditions) {
+		rendition->thread.join();
+		delete rendition->writer;
+		rendition->writer = nullptr;
+		if (rendition->error && !error)
+			error = rendition->error;
+	}
+	if (error)
+		std::rethrow_exception(error);
+}
+
+// Encode the queued frames of a rendition, until the end of the chunk
+void ChunkWriter::encode_rendition(ChunkRendition* rendition)
+{
+	RenderTrace::Instance()->SetThreadName("ChunkWriter " + rendition->folder + " encoder");
+	while (true) {
+		std::shared_ptr<Frame> frame;
+		{
+			std::unique_lock<std::mutex> lock(rendition->queueMutex);
+			rendition->queueChanged.wait(lock, [rendition]() { return !rendition->queue.empty(); });
+			frame = rendition->queue.front();
+			rendition->queue.pop_front();
+		}
+		rendition->queueChanged.notify_all();
+
+		// After an error, the remaining frames of the chunk are skipped
+		try {
+			if (!frame) {
+				if (!rendition->error) {
+					// Write Footer, and close the writer
+					rendition->writer->WriteTrailer();
+					rendition->writer->Close();
+				}
+				return;
+			}
+			if (!rendition->error)
+				rendition->writer->WriteFrame(frame);
+		} catch (...) {
+			rendition->error = std::current_exception();
+			if (!frame)
+				return;
+		}
+	}
+}
+
 
 // Write a block of frames from a reader
 void ChunkWriter::WriteFrame(ReaderBase* reader, int64_t start, int64_t length)
@@ -211,24 +311,11 @@ void ChunkWriter::Close()
 	// Write the frames once it reaches the correct chunk size
 	if (is_writing)
 	{
-		// Pad an additional 12 frames
-		for (int z = 0; z<12; z++)
-		{
-			// Repeat frame
-			writer_final->WriteFrame(last_frame);
-			writer_preview->WriteFrame(last_frame);
-			writer_thumb->WriteFrame(last_frame);
-		}
-
-		// Write Footer
-		writer_final->WriteTrailer();
-		writer_preview->WriteTrailer();
-		writer_thumb->WriteTrailer();
+		// Pad an additional 12 frames (repeat frame)
+		write_renditions(last_frame, 12);
 
-		// Close writer & reader
-		writer_final->Close();
-		writer_preview->Close();
-		writer_thumb->Close();
+		// Write Footer, and close the writers
+		finish_chunk();
 
 		// Increment chunk count
 		chunk_count++;
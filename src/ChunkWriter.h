@@ -20,11 +20,18 @@
 #include "Json.h"
 
 #include <cmath>
+#include <condition_variable>
 #include <ctime>
+#include <deque>
+#include <exception>
 #include <iostream>
 #include <fstream>
 #include <cstdio>
+#include <memory>
+#include <mutex>
 #include <sstream>
+#include <thread>
+#include <vector>
 #include <unistd.h>
 #include <omp.h>
 #include <QtCore/QDir>
@@ -58,6 +65,10 @@ namespace openshot
 	 * w.Close();
 	 * r.Close();
 	 * @endcode
+	 *
+	 * Each chunk is written in 3 sizes (final, preview and thumb). Each frame is scaled once per size, in a
+	 * cascade (final -> preview -> thumb), and each size is encoded on its own thread, so writing the chunks
+	 * takes about as long as encoding the final size alone.
 	 */
 	class ChunkWriter : public WriterBase
 	{
@@ -69,9 +80,21 @@ namespace openshot
 		bool is_open;
 		bool is_writing;
 		openshot::ReaderBase *local_reader;
-		openshot::FFmpegWriter *writer_thumb;
-		openshot::FFmpegWriter *writer_preview;
-		openshot::FFmpegWriter *writer_final;
+
+		/// One size of the chunks (i.e. "preview"), which is encoded on its own thread
+		struct ChunkRendition {
+			std::string folder; ///< The folder of this size ("final", "preview" or "thumb")
+			double scale; ///< The size and bit rate of this rendition (relative to the final size)
+			int width;
+			int height;
+			openshot::FFmpegWriter *writer = nullptr;
+			std::thread thread;
+			std::deque<std::shared_ptr<openshot::Frame>> queue; ///< Frames waiting to be encoded (nullptr = end of the chunk)
+			std::mutex queueMutex;
+			std::condition_variable queueChanged;
+			std::exception_ptr error; ///< The first error of the encoder (thrown when the chunk is finished)
+		};
+		std::vector<std::unique_ptr<ChunkRendition>> renditions; ///< From the largest to the smallest size
 	    std::shared_ptr<Frame> last_frame;
 	    bool last_frame_needed;
 	    std::string default_extension;
@@ -90,6 +113,21 @@ namespace openshot
 		/// write json meta data
 		void write_json_meta_data();
 
+		/// Create the writers of a new chunk, and start their encoding threads
+		void start_chunk();
+
+		/// Scale a frame for each rendition (each from the previous size), and queue it (repeat times)
+		void write_renditions(std::shared_ptr<openshot::Frame> frame, int repeat=1);
+
+		/// Wait for the encoding threads to write and close the chunk (and throw the first error of any encoder)
+		void finish_chunk();
+
+		/// Queue a frame for a rendition (waiting while its queue is full)
+		void queue_frame(ChunkRendition& rendition, std::shared_ptr<openshot::Frame> frame);
+
+		/// Encode the queued frames of a rendition, until the end of the chunk (the body of its thread)
+		static void encode_rendition(ChunkRendition* rendition);
+
 	public:
 
 		/// @brief Constructor for ChunkWriter. Throws one of the following exceptions.
@@ -97,6 +135,9 @@ namespace openshot
 		/// @param reader The initial reader to base this chunk file's meta data on (such as fps, height, width, etc...)
 		ChunkWriter(std::string path, openshot::ReaderBase *reader);
 
+		/// Destructor (finishes the current chunk, if Close() was not called)
+		virtual ~ChunkWriter();
+
 		/// Close the writer
 		void Close();
 
@@ -12,13 +12,26 @@
 
 #include "Clip.h"
 
+#include "AllocationStats.h"
 #include "AudioResampler.h"
+#include "AudioTimeStretcher.h"
 #include "Exceptions.h"
+#include "FrameRequest.h"
 #include "FFmpegReader.h"
 #include "FrameMapper.h"
+#include "GpuCompositor.h"
+#include "ImageBufferPool.h"
+#include "ImageSequenceReader.h"
+#include "PixelKernels.h"
 #include "QtImageReader.h"
+#include "RenderCache.h"
 #include "ChunkReader.h"
 #include "DummyReader.h"
+#include "RenderTrace.h"
+#include "Settings.h"
+#include "TaskExecutor.h"
+#include "LiveReader.h"
+#include "SharedMemoryReader.h"
 #include "Timeline.h"
 #include "ZmqLogger.h"
 
@@ -28,6 +41,10 @@
 	#include "TextReader.h"
 #endif
 
+#include <algorithm>
+#include <atomic>
+#include <future>
+
 #include <Qt>
 
 using namespace openshot;
@@ -45,6 +62,7 @@ void Clip::init_settings()
 	anchor = ANCHOR_CANVAS;
 	display = FRAME_DISPLAY_NONE;
 	mixing = VOLUME_MIX_NONE;
+	time_stretch = TIME_STRETCH_RESAMPLE;
 	waveform = false;
 	previous_properties = "";
 	parentObjectId = "";
@@ -132,14 +150,14 @@ void Clip::init_reader_rotation() {
 }
 
 // Default Constructor for a clip
-Clip::Clip() : resampler(NULL), reader(NULL), allocated_reader(NULL), is_open(false)
+Clip::Clip() : resampler(NULL), stretcher(NULL), time_samples(NULL), reader(NULL), allocated_reader(NULL), is_open(false)
 {
 	// Init all default settings
 	init_settings();
 }
 
 // Constructor with reader
-Clip::Clip(ReaderBase* new_reader) : resampler(NULL), reader(new_reader), allocated_reader(NULL), is_open(false)
+Clip::Clip(ReaderBase* new_reader) : resampler(NULL), stretcher(NULL), time_samples(NULL), reader(new_reader), allocated_reader(NULL), is_open(false)
 {
 	// Init all default settings
 	init_settings();
@@ -158,7 +176,7 @@ Clip::Clip(ReaderBase* new_reader) : resampler(NULL), reader(new_reader), alloca
 }
 
 // Constructor with filepath
-Clip::Clip(std::string path) : resampler(NULL), reader(NULL), allocated_reader(NULL), is_open(false)
+Clip::Clip(std::string path) : resampler(NULL), stretcher(NULL), time_samples(NULL), reader(NULL), allocated_reader(NULL), is_open(false)
 {
 	// Init all default settings
 	init_settings();
@@ -167,9 +185,21 @@ Clip::Clip(std::string path) : resampler(NULL), reader(NULL), allocated_reader(N
 	std::string ext = get_file_extension(path);
 	std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
 
+	// Determine if image sequences of common image formats (decoded ahead in parallel)
+	if (path.find("%") != std::string::npos && (ext=="png" || ext=="jpg" || ext=="jpeg" || ext=="tif" ||
+		ext=="tiff" || ext=="exr" || ext=="bmp" || ext=="webp" || ext=="tga"))
+	{
+		try
+		{
+			// Open image sequence
+			reader = new openshot::ImageSequenceReader(path);
+
+		} catch(...) { }
+	}
+
 	// Determine if common video formats (or image sequences)
-	if (ext=="avi" || ext=="mov" || ext=="mkv" ||  ext=="mpg" || ext=="mpeg" || ext=="mp3" || ext=="mp4" || ext=="mts" ||
-		ext=="ogg" || ext=="wav" || ext=="wmv" || ext=="webm" || ext=="vob" || path.find("%") != std::string::npos)
+	if (!reader && (ext=="avi" || ext=="mov" || ext=="mkv" ||  ext=="mpg" || ext=="mpeg" || ext=="mp3" || ext=="mp4" || ext=="mts" ||
+		ext=="ogg" || ext=="wav" || ext=="wmv" || ext=="webm" || ext=="vob" || path.find("%") != std::string::npos))
 	{
 		try
 		{
@@ -233,6 +263,16 @@ Clip::~Clip()
 		resampler = NULL;
 	}
 
+	// Close the time stretcher
+	if (stretcher) {
+		delete stretcher;
+		stretcher = NULL;
+	}
+	if (time_samples) {
+		delete time_samples;
+		time_samples = NULL;
+	}
+
 	// Close clip
 	Close();
 }
@@ -335,11 +375,35 @@ void Clip::Open()
 		throw ReaderClosed("No Reader has been initialized for this Clip.  Call Reader(*reader) before calling this method.");
 }
 
+// Get the counters of the cache of this clip, and of its reader
+CacheStats Clip::GetCacheStats()
+{
+	CacheStats stats = final_cache.GetStats();
+	if (reader)
+		stats += reader->GetCacheStats();
+	return stats;
+}
+
+// Reset the counters of the cache of this clip, and of its reader
+void Clip::ResetCacheStats()
+{
+	final_cache.ResetStats();
+	if (reader)
+		reader->ResetCacheStats();
+}
+
+// Pass the sequential hint to the reader of this clip
+void Clip::SetSequentialHint(bool sequential)
+{
+	if (reader)
+		reader->SetSequentialHint(sequential);
+}
+
 // Close the internal reader
 void Clip::Close()
 {
 	if (is_open && reader) {
-		ZmqLogger::Instance()->AppendDebugMethod("Clip::Close");
+		ZMQ_DEBUG("Clip::Close");
 
 		// Close the reader
 		reader->Close();
@@ -347,6 +411,7 @@ void Clip::Close()
 
 	// Clear cache
 	final_cache.Clear();
+	waveform_renderer.Clear();
 	is_open = false;
 }
 
@@ -403,6 +468,9 @@ std::shared_ptr<Frame> Clip::GetFrame(std::shared_ptr<openshot::Frame> backgroun
 // Use an existing openshot::Frame object and draw this Clip's frame onto it
 std::shared_ptr<Frame> Clip::GetFrame(std::shared_ptr<openshot::Frame> background_frame, int64_t clip_frame_number, openshot::TimelineInfoStruct* options)
 {
+	RenderTraceSpan span("Clip::GetFrame", "clip");
+	AllocationScopeGuard allocations(ALLOCATION_SCOPE_CLIP);
+
 	// Check for open reader (or throw exception)
 	if (!is_open)
 		throw ReaderClosed("The Clip is closed.  Call Open() before calling this method.");
@@ -416,7 +484,7 @@ std::shared_ptr<Frame> Clip::GetFrame(std::shared_ptr<openshot::Frame> backgroun
 		frame = final_cache.GetFrame(clip_frame_number);
 		if (frame) {
 			// Debug output
-			ZmqLogger::Instance()->AppendDebugMethod(
+			ZMQ_DEBUG(
 					"Clip::GetFrame (Cached frame found)",
 					"requested_frame", clip_frame_number);
 
@@ -424,33 +492,13 @@ std::shared_ptr<Frame> Clip::GetFrame(std::shared_ptr<openshot::Frame> backgroun
 			return frame;
 		}
 
-		// Generate clip frame
-		frame = GetOrCreateFrame(clip_frame_number);
-
-		if (!background_frame) {
-			// Create missing background_frame w/ transparent color (if needed)
-			background_frame = std::make_shared<Frame>(clip_frame_number, frame->GetWidth(), frame->GetHeight(),
-													   "#00000000",  frame->GetAudioSamplesCount(),
-													   frame->GetAudioChannelsCount());
-		}
-
-		// Get time mapped frame object (used to increase speed, change direction, etc...)
-		apply_timemapping(frame);
-
-		// Apply waveform image (if any)
-		apply_waveform(frame, background_frame);
-
-		// Apply effects BEFORE applying keyframes (if any local or global effects are used)
-		apply_effects(frame, background_frame, options, true);
-
-		// Apply keyframe / transforms to current clip image
-		apply_keyframes(frame, background_frame);
-
-		// Apply effects AFTER applying keyframes (if any local or global effects are used)
-		apply_effects(frame, background_frame, options, false);
+		// Generate clip frame (with all effects and keyframes applied)
+		QRect layer_rect;
+		frame = render_frame(background_frame, clip_frame_number, options, layer_rect);
 
 		// Apply background canvas (i.e. flatten this image onto previous layer image)
-		apply_background(frame, background_frame);
+		if (!options || !options->is_audio_only)
+			apply_background(frame, background_frame, layer_rect);
 
 		// Add final frame to cache
 		final_cache.Add(frame);
@@ -463,6 +511,72 @@ std::shared_ptr<Frame> Clip::GetFrame(std::shared_ptr<openshot::Frame> backgroun
 		throw ReaderClosed("No Reader has been initialized for this Clip.  Call Reader(*reader) before calling this method.");
 }
 
+// Get this clip's frame for a timeline frame, without compositing it onto the timeline frame
+std::shared_ptr<Frame> Clip::GetLayerFrame(std::shared_ptr<openshot::Frame> background_frame, int64_t clip_frame_number, openshot::TimelineInfoStruct* options, QRect& layer_rect,
+										   GpuLayer* gpu_layer)
+{
+	// Check for open reader (or throw exception)
+	if (!is_open)
+		throw ReaderClosed("The Clip is closed.  Call Open() before calling this method.");
+	if (!reader)
+		throw ReaderClosed("No Reader has been initialized for this Clip.  Call Reader(*reader) before calling this method.");
+
+	return render_frame(background_frame, clip_frame_number, options, layer_rect, gpu_layer);
+}
+
+// Generate a frame of this clip, with all effects and keyframes applied (but not composited)
+std::shared_ptr<Frame> Clip::render_frame(std::shared_ptr<openshot::Frame>& background_frame, int64_t clip_frame_number, openshot::TimelineInfoStruct* options, QRect& layer_rect,
+										  GpuLayer* gpu_layer)
+{
+	// Stop here, if this frame is no longer needed (i.e. the user scrubbed past it)
+	FrameRequest::ThrowIfCancelled(clip_frame_number);
+
+	// Generate clip frame
+	std::shared_ptr<Frame> frame = GetOrCreateFrame(clip_frame_number);
+
+	// Only the audio is needed (i.e. an audio-only export), so skip all image processing
+	// (the waveform, keyframes, video effects, transitions and background)
+	if (options && options->is_audio_only) {
+		apply_timemapping(frame);
+		for (bool before_keyframes : {true, false}) {
+			for (auto effect : effects) {
+				if (effect->info.apply_before_clip == before_keyframes && effect->info.has_audio && !effect->info.has_video)
+					effect->GetFrame(frame, frame->number);
+			}
+		}
+		layer_rect = QRect();
+		return frame;
+	}
+
+	if (!background_frame) {
+		// Create missing background_frame w/ transparent color (if needed)
+		background_frame = std::make_shared<Frame>(clip_frame_number, frame->GetWidth(), frame->GetHeight(),
+												   "#00000000",  frame->GetAudioSamplesCount(),
+												   frame->GetAudioChannelsCount());
+	}
+
+	// Get time mapped frame object (used to increase speed, change direction, etc...)
+	apply_timemapping(frame);
+
+	// Apply waveform image (if any)
+	apply_waveform(frame, background_frame);
+
+	// The GPU compositor applies the transform and the last point-wise effects (unless the clip draws onto the transformed image)
+	if (gpu_layer && !can_defer_to_gpu())
+		gpu_layer = nullptr;
+
+	// Apply effects BEFORE applying keyframes (if any local or global effects are used)
+	apply_effects(frame, background_frame, options, true, gpu_layer ? &gpu_layer->operations : nullptr);
+
+	// Apply keyframe / transforms to current clip image (and get the region of the canvas it covers)
+	layer_rect = apply_keyframes(frame, background_frame, gpu_layer);
+
+	// Apply effects AFTER applying keyframes (if any local or global effects are used)
+	apply_effects(frame, background_frame, options, false);
+
+	return frame;
+}
+
 // Look up an effect by ID
 openshot::EffectBase* Clip::GetEffect(const std::string& id)
 {
@@ -475,6 +589,55 @@ openshot::EffectBase* Clip::GetEffect(const std::string& id)
 	return nullptr;
 }
 
+// Get the max size of this clip's source images which is still visible
+QSize Clip::GetMaxSourceSize(int width, int height, int max_width, int max_height)
+{
+	if (ParentTimeline()) {
+		// Set max width/height based on the timeline's preview size
+		max_width = ParentTimeline()->preview_width;
+		max_height = ParentTimeline()->preview_height;
+	}
+	if (scale == SCALE_FIT || scale == SCALE_STRETCH) {
+		// Best fit or Stretch scaling (based on max timeline size * scaling keyframes)
+		float max_scale_x = scale_x.GetMaxPoint().co.Y;
+		float max_scale_y = scale_y.GetMaxPoint().co.Y;
+		max_width = std::max(float(max_width), max_width * max_scale_x);
+		max_height = std::max(float(max_height), max_height * max_scale_y);
+
+	} else if (scale == SCALE_CROP) {
+		// Cropping scale mode (based on max timeline size * cropped size * scaling keyframes)
+		float max_scale_x = scale_x.GetMaxPoint().co.Y;
+		float max_scale_y = scale_y.GetMaxPoint().co.Y;
+		QSize width_size(max_width * max_scale_x,
+						 round(max_width / (float(width) / float(height))));
+		QSize height_size(round(max_height / (float(height) / float(width))),
+						  max_height * max_scale_y);
+		// respect aspect ratio
+		if (width_size.width() >= max_width && width_size.height() >= max_height) {
+			max_width = std::max(max_width, width_size.width());
+			max_height = std::max(max_height, width_size.height());
+		} else {
+			max_width = std::max(max_width, height_size.width());
+			max_height = std::max(max_height, height_size.height());
+		}
+
+	} else {
+		// Scale to the equivalent unscaled size. Since the preview window can change sizes,
+		// always scale against the ratio of the source size to the timeline size.
+		float preview_ratio = 1.0;
+		if (ParentTimeline()) {
+			Timeline *t = (Timeline *) ParentTimeline();
+			preview_ratio = t->preview_width / float(t->info.width);
+		}
+		float max_scale_x = scale_x.GetMaxPoint().co.Y;
+		float max_scale_y = scale_y.GetMaxPoint().co.Y;
+		max_width = width * max_scale_x * preview_ratio;
+		max_height = height * max_scale_y * preview_ratio;
+	}
+
+	return QSize(max_width, max_height);
+}
+
 // Get file extension
 std::string Clip::get_file_extension(std::string path)
 {
@@ -490,6 +653,7 @@ void Clip::reverse_buffer(juce::AudioBuffer<float>* buffer)
 
 	// Reverse array (create new buffer to hold the reversed version)
 	auto *reversed = new juce::AudioBuffer<float>(channels, number_of_samples);
+	AllocationStats::AddAudioBuffer(int64_t(channels) * number_of_samples * sizeof(float));
 	reversed->clear();
 
 	for (int channel = 0; channel < channels; channel++)
@@ -525,9 +689,6 @@ void Clip::apply_timemapping(std::shared_ptr<Frame> frame)
 		int64_t clip_frame_number = frame->number;
 		int64_t new_frame_number = adjust_frame_number_minimum(time.GetLong(clip_frame_number));
 
-		// create buffer
-		juce::AudioBuffer<float> *source_samples = nullptr;
-
 		// Get delta (difference from this frame to the next time mapped frame: Y value)
 		double delta = time.GetDelta(clip_frame_number + 1);
 		bool is_increasing = time.IsIncreasing(clip_frame_number + 1);
@@ -542,26 +703,28 @@ void Clip::apply_timemapping(std::shared_ptr<Frame> frame)
 		int source_sample_count = round(target_sample_count * fabs(delta));
 
 		// Determine starting audio location
+		const int channels = Reader()->info.channels;
 		AudioLocation location;
 		if (previous_location.frame == 0 || abs(new_frame_number - previous_location.frame) > 2) {
 			// No previous location OR gap detected
 			location.frame = new_frame_number;
 			location.sample_start = 0;
+			time_source_frame.reset();
 
-			// Create / Reset resampler
+			// Reset the resampler and time stretcher (they are only re-created if the # of channels changes)
 			// We don't want to interpolate between unrelated audio data
-			if (resampler) {
+			if (!time_samples || time_samples->getNumChannels() != channels) {
 				delete resampler;
+				delete stretcher;
+				delete time_samples;
+				// Init with # channels from Reader (should match the timeline)
+				resampler = new AudioResampler(channels);
+				stretcher = new AudioTimeStretcher(channels);
+				time_samples = new juce::AudioBuffer<float>(channels, source_sample_count);
+			} else {
+				stretcher->Reset();
 			}
-			// Init resampler with # channels from Reader (should match the timeline)
-			resampler = new AudioResampler(Reader()->info.channels);
-
-			// Allocate buffer of silence to initialize some data inside the resampler
-			// To prevent it from becoming input limited
-			juce::AudioBuffer<float> init_samples(Reader()->info.channels, 64);
-			init_samples.clear();
-			resampler->SetBuffer(&init_samples, 1.0);
-			resampler->GetResampledBuffer();
+			resampler->Reset();
 
 		} else {
 			// Use previous location
@@ -574,18 +737,24 @@ void Clip::apply_timemapping(std::shared_ptr<Frame> frame)
 			return;
 		}
 
-		// Allocate a new sample buffer for these delta frames
-		source_samples = new juce::AudioBuffer<float>(Reader()->info.channels, source_sample_count);
-		source_samples->clear();
+		// Re-use the sample buffer for these delta frames (it only grows)
+		time_samples->setSize(channels, source_sample_count, false, false, true);
+		time_samples->clear();
+		juce::AudioBuffer<float> *source_samples = time_samples;
 
-		// Determine ending audio location
+		// Copy the source samples (a whole source frame at a time)
 		int remaining_samples = source_sample_count;
 		int source_pos = 0;
 		while (remaining_samples > 0) {
-			std::shared_ptr<Frame> source_frame = GetOrCreateFrame(location.frame, false);
+			// Re-use the last source frame (if it was only partially used)
+			std::shared_ptr<Frame> source_frame = time_source_frame;
+			if (!source_frame || source_frame->number != location.frame)
+				source_frame = GetOrCreateFrame(location.frame, false);
 			int frame_sample_count = source_frame->GetAudioSamplesCount() - location.sample_start;
+			int copy_channels = std::min(source_frame->GetAudioChannelsCount(), channels);
+			time_source_frame.reset();
 
-			if (frame_sample_count == 0) {
+			if (frame_sample_count <= 0) {
 				// No samples found in source frame (fill with silence)
 				if (is_increasing) {
 					location.frame++;
@@ -597,26 +766,27 @@ void Clip::apply_timemapping(std::shared_ptr<Frame> frame)
 			}
 			if (remaining_samples - frame_sample_count >= 0) {
 				// Use all frame samples & increment location
-				for (int channel = 0; channel < source_frame->GetAudioChannelsCount(); channel++) {
-					source_samples->addFrom(channel, source_pos, source_frame->GetAudioSamples(channel) + location.sample_start, frame_sample_count, 1.0f);
+				for (int channel = 0; channel < copy_channels; channel++) {
+					source_samples->copyFrom(channel, source_pos, source_frame->GetAudioSamples(channel) + location.sample_start, frame_sample_count);
 				}
 				if (is_increasing) {
 					location.frame++;
 				} else {
-					location.frame--;   
+					location.frame--;
 				}
 				location.sample_start = 0;
 				remaining_samples -= frame_sample_count;
 				source_pos += frame_sample_count;
 
 			} else {
-				// Use just what is needed (and reverse samples)
-				for (int channel = 0; channel < source_frame->GetAudioChannelsCount(); channel++) {
-					source_samples->addFrom(channel, source_pos, source_frame->GetAudioSamples(channel) + location.sample_start, remaining_samples, 1.0f);
+				// Use just what is needed (and keep the rest of the frame for the next time mapped frame)
+				for (int channel = 0; channel < copy_channels; channel++) {
+					source_samples->copyFrom(channel, source_pos, source_frame->GetAudioSamples(channel) + location.sample_start, remaining_samples);
 				}
 				location.sample_start += remaining_samples;
-				remaining_samples = 0;
 				source_pos += remaining_samples;
+				remaining_samples = 0;
+				time_source_frame = source_frame;
 			}
 
 		}
@@ -625,7 +795,17 @@ void Clip::apply_timemapping(std::shared_ptr<Frame> frame)
 		// We are fixing to clobber this with actual audio data (possibly resampled)
 		frame->AddAudioSilence(target_sample_count);
 
-		if (source_sample_count != target_sample_count) {
+		if (time_stretch == TIME_STRETCH_PRESERVE_PITCH) {
+			// Stretch audio without changing the pitch (always, so the output stays continuous
+			// when the speed changes to or from 1.0)
+			juce::AudioBuffer<float> stretched_buffer(channels, target_sample_count);
+			stretcher->Process(*source_samples, source_sample_count, stretched_buffer, target_sample_count);
+
+			// Fill the frame with stretched data
+			for (int channel = 0; channel < channels; channel++) {
+				frame->AddAudio(true, channel, 0, stretched_buffer.getReadPointer(channel, 0), target_sample_count, 1.0f);
+			}
+		} else if (source_sample_count != target_sample_count) {
 			// Resample audio (if needed)
 			double resample_ratio = double(source_sample_count) / double(target_sample_count);
 			resampler->SetBuffer(source_samples, resample_ratio);
@@ -634,21 +814,18 @@ void Clip::apply_timemapping(std::shared_ptr<Frame> frame)
 			juce::AudioBuffer<float> *resampled_buffer = resampler->GetResampledBuffer();
 
 			// Fill the frame with resampled data
-			for (int channel = 0; channel < Reader()->info.channels; channel++) {
+			for (int channel = 0; channel < channels; channel++) {
 				// Add new (slower) samples, to the frame object
 				frame->AddAudio(true, channel, 0, resampled_buffer->getReadPointer(channel, 0), std::min(resampled_buffer->getNumSamples(), target_sample_count), 1.0f);
 			}
 		} else {
 			// Fill the frame
-			for (int channel = 0; channel < Reader()->info.channels; channel++) {
+			for (int channel = 0; channel < channels; channel++) {
 				// Add new (slower) samples, to the frame object
 				frame->AddAudio(true, channel, 0, source_samples->getReadPointer(channel, 0), target_sample_count, 1.0f);
 			}
 		}
 
-		// Clean up
-		delete source_samples;
-
 		// Set previous location
 		previous_location = location;
 	}
@@ -678,23 +855,27 @@ std::shared_ptr<Frame> Clip::GetOrCreateFrame(int64_t number, bool enable_time)
 		}
 
 		// Debug output
-		ZmqLogger::Instance()->AppendDebugMethod(
+		ZMQ_DEBUG(
 				"Clip::GetOrCreateFrame (from reader)",
 				"number", number, "clip_frame_number", clip_frame_number);
 
 		// Attempt to get a frame (but this could fail if a reader has just been closed)
-		auto reader_frame = reader->GetFrame(clip_frame_number);
-		reader_frame->number = number; // Override frame # (due to time-mapping might change it)
-
+		std::shared_ptr<Frame> reader_frame;
+		{
+			AllocationScopeGuard allocations(ALLOCATION_SCOPE_READER);
+			reader_frame = reader->GetFrame(clip_frame_number);
+		}
 		// Return real frame
 		if (reader_frame) {
 			// Create a new copy of reader frame
 			// This allows a clip to modify the pixels and audio of this frame without
-			// changing the underlying reader's frame data
+			// changing the underlying reader's frame data (which other clips of the same
+			// file can share, see SourceFrameCache)
 			auto reader_copy = std::make_shared<Frame>(*reader_frame.get());
+			reader_copy->number = number; // Override frame # (due to time-mapping might change it)
 			if (has_video.GetInt(number) == 0) {
 				// No video, so add transparent pixels
-				reader_copy->AddColor(QColor(Qt::transparent));
+				reader_copy->AddSolidColor(QColor(Qt::transparent));
 			}
 			if (has_audio.GetInt(number) == 0 || number > reader->info.video_length) {
 				// No audio, so include silence (also, mute audio if past end of reader)
@@ -713,7 +894,7 @@ std::shared_ptr<Frame> Clip::GetOrCreateFrame(int64_t number, bool enable_time)
 	int estimated_samples_in_frame = Frame::GetSamplesPerFrame(number, reader->info.fps, reader->info.sample_rate, reader->info.channels);
 
 	// Debug output
-	ZmqLogger::Instance()->AppendDebugMethod(
+	ZMQ_DEBUG(
 		"Clip::GetOrCreateFrame (create blank)",
 		"number", number,
 		"estimated_samples_in_frame", estimated_samples_in_frame);
@@ -736,7 +917,7 @@ std::string Clip::Json() const {
 }
 
 // Get all properties for a specific frame
-std::string Clip::PropertiesJSON(int64_t requested_frame) const {
+Json::Value Clip::PropertiesJsonValue(int64_t requested_frame) const {
 
 	// Generate JSON properties list
 	Json::Value root;
@@ -750,6 +931,7 @@ std::string Clip::PropertiesJSON(int64_t requested_frame) const {
 	root["scale"] = add_property_json("Scale", scale, "int", "", NULL, 0, 3, false, requested_frame);
 	root["display"] = add_property_json("Frame Number", display, "int", "", NULL, 0, 3, false, requested_frame);
 	root["mixing"] = add_property_json("Volume Mixing", mixing, "int", "", NULL, 0, 2, false, requested_frame);
+	root["time_stretch"] = add_property_json("Time Stretch", time_stretch, "int", "", NULL, 0, 1, false, requested_frame);
 	root["waveform"] = add_property_json("Waveform", waveform, "int", "", NULL, 0, 1, false, requested_frame);
 	root["parentObjectId"] = add_property_json("Parent", 0.0, "string", parentObjectId, NULL, -1, -1, false, requested_frame);
 
@@ -781,6 +963,10 @@ std::string Clip::PropertiesJSON(int64_t requested_frame) const {
 	root["mixing"]["choices"].append(add_property_choice_json("Average", VOLUME_MIX_AVERAGE, mixing));
 	root["mixing"]["choices"].append(add_property_choice_json("Reduce", VOLUME_MIX_REDUCE, mixing));
 
+	// Add time stretch choices (dropdown style)
+	root["time_stretch"]["choices"].append(add_property_choice_json("Resample", TIME_STRETCH_RESAMPLE, time_stretch));
+	root["time_stretch"]["choices"].append(add_property_choice_json("Preserve Pitch", TIME_STRETCH_PRESERVE_PITCH, time_stretch));
+
 	// Add waveform choices (dropdown style)
 	root["waveform"]["choices"].append(add_property_choice_json("Yes", true, waveform));
 	root["waveform"]["choices"].append(add_property_choice_json("No", false, waveform));
@@ -879,7 +1065,7 @@ std::string Clip::PropertiesJSON(int64_t requested_frame) const {
 
 
 	// Return formatted string
-	return root.toStyledString();
+	return root;
 }
 
 // Generate Json::Value for this object
@@ -893,6 +1079,7 @@ Json::Value Clip::JsonValue() const {
 	root["anchor"] = anchor;
 	root["display"] = display;
 	root["mixing"] = mixing;
+	root["time_stretch"] = time_stretch;
 	root["waveform"] = waveform;
 	root["scale_x"] = scale_x.JsonValue();
 	root["scale_y"] = scale_y.JsonValue();
@@ -981,6 +1168,8 @@ void Clip::SetJsonValue(const Json::Value root) {
 		display = (FrameDisplayType) root["display"].asInt();
 	if (!root["mixing"].isNull())
 		mixing = (VolumeMixType) root["mixing"].asInt();
+	if (!root["time_stretch"].isNull())
+		time_stretch = (TimeStretchType) root["time_stretch"].asInt();
 	if (!root["waveform"].isNull())
 		waveform = root["waveform"].asBool();
 	if (!root["scale_x"].isNull())
@@ -1086,6 +1275,12 @@ void Clip::SetJsonValue(const Json::Value root) {
 				reader = new openshot::QtImageReader(root["reader"]["path"].asString(), false);
 				reader->SetJsonValue(root["reader"]);
 
+			} else if (type == "ImageSequenceReader") {
+
+				// Create new reader
+				reader = new openshot::ImageSequenceReader(root["reader"]["path"].asString(), openshot::Fraction(25, 1), false);
+				reader->SetJsonValue(root["reader"]);
+
 #ifdef USE_IMAGEMAGICK
 			} else if (type == "ImageReader") {
 
@@ -1106,6 +1301,18 @@ void Clip::SetJsonValue(const Json::Value root) {
 				reader = new openshot::ChunkReader(root["reader"]["path"].asString(), (ChunkVersion) root["reader"]["chunk_version"].asInt());
 				reader->SetJsonValue(root["reader"]);
 
+			} else if (type == "SharedMemoryReader") {
+
+				// Create new reader (which attaches to the ring when opened)
+				reader = new openshot::SharedMemoryReader(root["reader"]["key"].asString());
+				reader->SetJsonValue(root["reader"]);
+
+			} else if (type == "LiveReader") {
+
+				// Create new reader (which starts capturing when opened)
+				reader = new openshot::LiveReader(root["reader"]["url"].asString());
+				reader->SetJsonValue(root["reader"]);
+
 			} else if (type == "DummyReader") {
 
 				// Create new reader
@@ -1200,32 +1407,241 @@ void Clip::RemoveEffect(EffectBase* effect)
 }
 
 // Apply background image to the current clip image (i.e. flatten this image onto previous layer)
-void Clip::apply_background(std::shared_ptr<openshot::Frame> frame, std::shared_ptr<openshot::Frame> background_frame) {
+void Clip::apply_background(std::shared_ptr<openshot::Frame> frame, std::shared_ptr<openshot::Frame> background_frame, const QRect& layer_rect) {
 	// Add background canvas
 	std::shared_ptr<QImage> background_canvas = background_frame->GetImage();
-	QPainter painter(background_canvas.get());
-	painter.setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform | QPainter::TextAntialiasing, true);
 
-	// Composite a new layer onto the image
-	painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
-	painter.drawImage(0, 0, *frame->GetImage());
-	painter.end();
+	// Only blend the region covered by this layer (nothing to blend if it is off-canvas)
+	PixelLayer layer;
+	RenderStageTimer timer(RENDER_STAGE_COMPOSITE);
+	if (!layer_rect.isEmpty() && GetPixelLayer(frame, layer_rect, layer))
+		PixelKernels::Composite(background_canvas->bits(), background_canvas->width(), background_canvas->height(),
+								background_canvas->bytesPerLine(), { layer });
 
 	// Add new QImage to frame
 	frame->AddImage(background_canvas);
 }
 
+// Describe the image of a frame from GetLayerFrame (as a layer of the timeline frame)
+bool Clip::GetPixelLayer(std::shared_ptr<openshot::Frame> frame, const QRect& layer_rect, PixelLayer& layer)
+{
+	if (layer_rect.isEmpty())
+		return false;
+
+	// Solid color images are composited as a fill (without filling an image first)
+	const QColor solid_color = frame->GetSolidColor();
+	if (solid_color.isValid()) {
+		if (solid_color.alpha() == 0)
+			return false;
+		const QRgb color = qPremultiply(solid_color.rgba());
+		layer.pixels = nullptr;
+		layer.bytes_per_line = 0;
+		layer.solid = true;
+		layer.color[0] = (unsigned char) qRed(color);
+		layer.color[1] = (unsigned char) qGreen(color);
+		layer.color[2] = (unsigned char) qBlue(color);
+		layer.color[3] = (unsigned char) qAlpha(color);
+		layer.x = layer_rect.x();
+		layer.y = layer_rect.y();
+		layer.width = frame->GetWidth();
+		layer.height = frame->GetHeight();
+		return true;
+	}
+
+	std::shared_ptr<QImage> image = frame->GetImage();
+	if (!image || image->isNull())
+		return false;
+
+	// Frame images are always premultiplied RGBA8888 (see Frame::AddImage)
+	if (image->format() != QImage::Format_RGBA8888_Premultiplied) {
+		image = std::make_shared<QImage>(*image);
+		PixelKernels::ToPremultipliedRGBA(*image);
+		frame->AddImage(image);
+	}
+
+	layer.pixels = image->constBits();
+	layer.bytes_per_line = image->bytesPerLine();
+	layer.x = layer_rect.x();
+	layer.y = layer_rect.y();
+	layer.width = image->width();
+	layer.height = image->height();
+	return true;
+}
+
+// Get the key of this clip's source image (if the clip's image only changes when its source image does)
+int64_t Clip::StaticImageKey(int64_t clip_frame_number)
+{
+	if (!is_open || !reader || waveform || !effects.empty() || parentTrackedObject || parentClipObject ||
+		display != FRAME_DISPLAY_NONE)
+		return 0;
+
+	// Every keyframe which changes the image must be constant
+	for (const Keyframe* keyframe : {&scale_x, &scale_y, &location_x, &location_y, &alpha, &rotation, &shear_x, &shear_y,
+									 &origin_x, &origin_y, &time, &has_video,
+									 &perspective_c1_x, &perspective_c1_y, &perspective_c2_x, &perspective_c2_y,
+									 &perspective_c3_x, &perspective_c3_y, &perspective_c4_x, &perspective_c4_y}) {
+		if (!keyframe->IsConstant())
+			return 0;
+	}
+
+	try {
+		// Find the source frame (the same way as GetOrCreateFrame)
+		int64_t source_frame_number = adjust_frame_number_minimum(clip_frame_number);
+		if (time.GetLength() > 1)
+			source_frame_number = adjust_frame_number_minimum(time.GetLong(source_frame_number));
+
+		std::shared_ptr<Frame> source_frame = reader->GetFrame(source_frame_number);
+		if (source_frame && source_frame->has_image_data)
+			return source_frame->GetImage()->cacheKey();
+
+	} catch (const ReaderClosed & e) {
+		// ...
+	} catch (const OutOfBoundsFrame & e) {
+		// ...
+	}
+	return 0;
+}
+
+// Is a reader (or the reader it wraps) a live source, whose frames change every time they are read
+static bool is_live_source(const Json::Value& reader)
+{
+	const std::string type = reader["type"].asString();
+	if (type == "LiveReader" || type == "SharedMemoryReader")
+		return true;
+	return reader["reader"].isObject() && is_live_source(reader["reader"]);
+}
+
+// Add everything this clip's rendered frame depends on to its key in the RenderCache
+bool Clip::AddRenderKey(RenderKey& key, int64_t clip_frame_number)
+{
+	// Attached clips also depend on the object they are attached to
+	if (!reader || parentTrackedObject || parentClipObject)
+		return false;
+
+	Json::Value state = JsonValue();
+	if (is_live_source(state["reader"]))
+		return false;
+
+	// The clip's id and place on the timeline don't change its frames (unless it displays the timeline's frame number)
+	state.removeMember("id");
+	state.removeMember("layer");
+	if (display == FRAME_DISPLAY_NONE || display == FRAME_DISPLAY_CLIP)
+		state.removeMember("position");
+	for (Json::Value& effect : state["effects"])
+		effect.removeMember("id");
+
+	// Find the source frame (the same way as GetOrCreateFrame)
+	int64_t source_frame_number = adjust_frame_number_minimum(clip_frame_number);
+	if (time.GetLength() > 1)
+		source_frame_number = adjust_frame_number_minimum(time.GetLong(source_frame_number));
+
+	key.Add(std::string("Clip"));
+	key.Add(clip_frame_number);
+	key.Add(source_frame_number);
+	key.AddState(state, clip_frame_number);
+	return true;
+}
+
+// Apply a chain of fused (point-wise) effects to a frame, in a single pass over its image
+static void apply_pixel_operations(std::shared_ptr<Frame> frame, std::vector<PixelOperation>& operations)
+{
+	if (operations.empty())
+		return;
+
+	RenderStageTimer timer(RENDER_STAGE_EFFECT);
+	std::shared_ptr<QImage> frame_image = frame->GetImage();
+	if (frame_image) {
+		unsigned char *pixels = (unsigned char *) frame_image->bits();
+		PixelKernels::Apply(pixels, int64_t(frame_image->width()) * frame_image->height(), operations);
+	}
+	operations.clear();
+}
+
 // Apply effects to the source frame (if any)
-void Clip::apply_effects(std::shared_ptr<Frame> frame, std::shared_ptr<Frame> background_frame, TimelineInfoStruct* options, bool before_keyframes)
+void Clip::apply_effects(std::shared_ptr<Frame> frame, std::shared_ptr<Frame> background_frame, TimelineInfoStruct* options, bool before_keyframes,
+						 std::vector<PixelOperation>* deferred_operations)
 {
+	AllocationScopeGuard allocations(ALLOCATION_SCOPE_EFFECT);
+
+	// Consecutive point-wise effects are collected, and applied together
+	const bool fuse_effects = Settings::Instance()->ENABLE_EFFECT_FUSION;
+	std::vector<PixelOperation> operations;
+
+	// Audio-only effects never touch the image, so they are applied by a worker of the TaskExecutor (in
+	// order), while the video effects are applied on this thread
+	std::vector<EffectBase*> audio_effects;
+	std::vector<EffectBase*> video_effects;
 	for (auto effect : effects)
 	{
-		// Apply the effect to this frame
-		if (effect->info.apply_before_clip && before_keyframes) {
+		// Skip effects applied at the other stage (before or after the clip's keyframes)
+		if (effect->info.apply_before_clip != before_keyframes)
+			continue;
+
+		if (effect->info.has_audio && !effect->info.has_video)
+			audio_effects.push_back(effect);
+		else
+			video_effects.push_back(effect);
+	}
+
+	auto apply_audio_effects = [frame, audio_effects]() {
+		for (auto effect : audio_effects) {
+			RenderStageTimer timer(RENDER_STAGE_EFFECT, &effect->render_stats);
+			RenderTraceSpan span(effect->info.class_name, "effect");
 			effect->GetFrame(frame, frame->number);
-		} else if (!effect->info.apply_before_clip && !before_keyframes) {
+		}
+	};
+	// The audio chain runs on this thread instead, if no worker has started it when the video effects are done
+	// (so this never waits for a task which has not started)
+	std::future<void> audio_chain;
+	auto audio_chain_started = std::make_shared<std::atomic<bool>>(false);
+	if (!audio_effects.empty()) {
+		if (video_effects.empty()) {
+			apply_audio_effects();
+		} else {
+			FrameRequest* request = FrameRequest::Current();
+			audio_chain = TaskExecutor::Instance()->Async([audio_chain_started, request, apply_audio_effects]() {
+				if (!audio_chain_started->exchange(true))
+					FrameRequest::RunAs(request, apply_audio_effects);
+			});
+		}
+	}
+
+	try {
+		for (auto effect : video_effects)
+		{
+			// Add point-wise effect to the current chain
+			PixelOperation operation;
+			if (fuse_effects && effect->GetPixelOperation(frame->number, operation)) {
+				operations.push_back(operation);
+				continue;
+			}
+
+			// Apply the effect to this frame (after the chain of effects before it)
+			apply_pixel_operations(frame, operations);
+			RenderStageTimer timer(RENDER_STAGE_EFFECT, &effect->render_stats);
+			RenderTraceSpan span(effect->info.class_name, "effect");
 			effect->GetFrame(frame, frame->number);
 		}
+		if (deferred_operations) {
+			// The shaders of the GPU compositor apply the last operations (and the clip applies the rest)
+			const size_t applied = operations.size() - std::min<size_t>(operations.size(), GpuCompositor::MAX_OPERATIONS);
+			deferred_operations->assign(operations.begin() + applied, operations.end());
+			operations.resize(applied);
+		}
+		apply_pixel_operations(frame, operations);
+	} catch (...) {
+		// Never leave the audio chain running (or queued) on a frame which failed
+		if (audio_chain.valid() && audio_chain_started->exchange(true))
+			audio_chain.wait();
+		throw;
+	}
+
+	// Wait for the audio effects (and re-throw their exceptions, if any)
+	if (audio_chain.valid()) {
+		if (!audio_chain_started->exchange(true))
+			apply_audio_effects();
+		else
+			audio_chain.get();
 	}
 
 	if (timeline != NULL && options != NULL) {
@@ -1242,34 +1658,111 @@ bool Clip::isEqual(double a, double b)
 	return fabs(a - b) < 0.000001;
 }
 
+// Can the GPU compositor apply the transform and last point-wise effects of this clip
+bool Clip::can_defer_to_gpu()
+{
+	// Effects applied after the keyframes (and frame numbers) draw onto the transformed image
+	if (display != FRAME_DISPLAY_NONE)
+		return false;
+	for (auto effect : effects) {
+		if (!effect->info.apply_before_clip)
+			return false;
+	}
+
+	// Timeline effects are applied after the clip's effects (and onto the transformed image)
+	return !(timeline && !static_cast<Timeline *>(timeline)->Effects().empty());
+}
+
 // Apply keyframes to the source frame (if any)
-void Clip::apply_keyframes(std::shared_ptr<Frame> frame, std::shared_ptr<Frame> background_frame) {
+QRect Clip::apply_keyframes(std::shared_ptr<Frame> frame, std::shared_ptr<Frame> background_frame, GpuLayer* gpu_layer) {
+	RenderStageTimer timer(RENDER_STAGE_TRANSFORM);
+
 	// Skip out if video was disabled or only an audio frame (no visualisation in use)
 	if (!frame->has_image_data) {
 		// Skip the rest of the image processing for performance reasons
-		return;
+		return QRect(0, 0, frame->GetWidth(), frame->GetHeight());
+	}
+
+	// Get the size of the canvas (without filling a solid color background)
+	int canvas_width = background_frame->GetWidth();
+	int canvas_height = background_frame->GetHeight();
+
+	// Get transform from clip's keyframes
+	QTransform transform = get_transform(frame, canvas_width, canvas_height);
+
+	// Fast path: an untransformed, full-size image would be copied unchanged onto the
+	// transparent canvas, so keep the source image as is (a solid color stays a fill)
+	if (transform.isIdentity() && frame->GetWidth() == canvas_width &&
+		frame->GetHeight() == canvas_height && display == FRAME_DISPLAY_NONE) {
+		return QRect(0, 0, canvas_width, canvas_height);
 	}
 
-	// Get image from clip, and create transparent background image
+	// Get image from clip
 	std::shared_ptr<QImage> source_image = frame->GetImage();
-	std::shared_ptr<QImage> background_canvas = std::make_shared<QImage>(background_frame->GetImage()->width(),
-																		 background_frame->GetImage()->height(),
-																		 QImage::Format_RGBA8888_Premultiplied);
+
+	// Effects applied after the keyframes (and frame numbers) can draw anywhere on the canvas
+	bool needs_full_canvas = (display != FRAME_DISPLAY_NONE);
+	for (auto effect : effects) {
+		if (!effect->info.apply_before_clip)
+			needs_full_canvas = true;
+	}
+	if (timeline && !static_cast<Timeline *>(timeline)->Effects().empty())
+		needs_full_canvas = true;
+
+	// Determine the region of the canvas covered by the transformed image (with 1 extra
+	// pixel for antialiased edges). Only this region is allocated, painted and blended.
+	QRect canvas_rect(0, 0, canvas_width, canvas_height);
+	QRect layer_rect = canvas_rect;
+	if (!needs_full_canvas) {
+		layer_rect = transform.mapRect(QRectF(source_image->rect())).toAlignedRect()
+			.adjusted(-1, -1, 1, 1).intersected(canvas_rect);
+		if (layer_rect.isEmpty()) {
+			// Layer is completely off-canvas (nothing to paint)
+			return QRect();
+		}
+	}
+
+	if (gpu_layer) {
+		// The GPU compositor transforms the source image (in the canvas' coordinates)
+		gpu_layer->transform = transform;
+		gpu_layer->transformed = true;
+		gpu_layer->smooth = !(timeline && timeline->IsDraftQuality());
+		return layer_rect;
+	}
+
+	// Create transparent background image (for the covered region)
+	std::shared_ptr<QImage> background_canvas = ImageBufferPool::Instance()->CreateImage(layer_rect.width(),
+																						 layer_rect.height(),
+																						 QImage::Format_RGBA8888_Premultiplied);
 	background_canvas->fill(QColor(Qt::transparent));
 
-	// Get transform from clip's keyframes
-	QTransform transform = get_transform(frame, background_canvas->width(), background_canvas->height());
+	// Move the transform into the region's coordinates
+	transform = transform * QTransform::fromTranslate(-layer_rect.x(), -layer_rect.y());
 
 	// Load timeline's new frame image into a QPainter
 	QPainter painter(background_canvas.get());
-	painter.setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform | QPainter::TextAntialiasing, true);
-
-	// Apply transform (translate, rotate, scale)
-	painter.setTransform(transform);
 
-	// Composite a new layer onto the image
-	painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
-	painter.drawImage(0, 0, *source_image);
+	if (transform.type() <= QTransform::TxTranslate &&
+		transform.dx() == std::round(transform.dx()) && transform.dy() == std::round(transform.dy())) {
+		// Fast path: integer translations are a plain copy onto the transparent
+		// canvas (no filtering, and no blending needed)
+		painter.setRenderHint(QPainter::TextAntialiasing, true);
+		painter.setCompositionMode(QPainter::CompositionMode_Source);
+		painter.drawImage(int(transform.dx()), int(transform.dy()), *source_image);
+		painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+	} else {
+		// Draft quality previews skip the filtering (the nearest pixels are used, with aliased edges)
+		const bool smooth = !(timeline && timeline->IsDraftQuality());
+		painter.setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform, smooth);
+		painter.setRenderHint(QPainter::TextAntialiasing, true);
+
+		// Apply transform (translate, rotate, scale)
+		painter.setTransform(transform);
+
+		// Composite a new layer onto the image
+		painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+		painter.drawImage(0, 0, *source_image);
+	}
 
 	if (timeline) {
 		Timeline *t = static_cast<Timeline *>(timeline);
@@ -1304,6 +1797,9 @@ void Clip::apply_keyframes(std::shared_ptr<Frame> frame, std::shared_ptr<Frame>
 
 	// Add new QImage to frame
 	frame->AddImage(background_canvas);
+
+	// Return the region of the canvas covered by the new image
+	return layer_rect;
 }
 
 // Apply apply_waveform image to the source frame (if any)
@@ -1314,17 +1810,17 @@ void Clip::apply_waveform(std::shared_ptr<Frame> frame, std::shared_ptr<Frame> b
 		return;
 	}
 
-	// Get image from clip
-	std::shared_ptr<QImage> source_image = frame->GetImage();
-	std::shared_ptr<QImage> background_canvas = background_frame->GetImage();
+	// Get the size of the canvas (without filling a solid color background)
+	const int canvas_width = background_frame->GetWidth();
+	const int canvas_height = background_frame->GetHeight();
 
 	// Debug output
-	ZmqLogger::Instance()->AppendDebugMethod(
+	ZMQ_DEBUG(
 			"Clip::apply_waveform (Generate Waveform Image)",
 			"frame->number", frame->number,
 			"Waveform()", Waveform(),
-			"background_canvas->width()", background_canvas->width(),
-			"background_canvas->height()", background_canvas->height());
+			"canvas_width", canvas_width,
+			"canvas_height", canvas_height);
 
 	// Get the color of the waveform
 	int red = wave_color.red.GetInt(frame->number);
@@ -1332,45 +1828,51 @@ void Clip::apply_waveform(std::shared_ptr<Frame> frame, std::shared_ptr<Frame> b
 	int blue = wave_color.blue.GetInt(frame->number);
 	int alpha = wave_color.alpha.GetInt(frame->number);
 
-	// Generate Waveform Dynamically (the size of the timeline)
-	source_image = frame->GetWaveform(background_canvas->width(), background_canvas->height(), red, green, blue, alpha);
+	// Generate Waveform Dynamically (the size of the timeline), re-using the last image if it's the same waveform
+	std::shared_ptr<QImage> source_image = waveform_renderer.Render(frame, canvas_width, canvas_height, QColor(red, green, blue, alpha));
 	frame->AddImage(source_image);
 }
 
 // Apply keyframes to the source frame (if any)
 QTransform Clip::get_transform(std::shared_ptr<Frame> frame, int width, int height)
 {
-	// Get image from clip
-	std::shared_ptr<QImage> source_image = frame->GetImage();
-
 	/* ALPHA & OPACITY */
 	if (alpha.GetValue(frame->number) != 1.0)
 	{
 		float alpha_value = alpha.GetValue(frame->number);
 
-		// Get source image's pixels
-		unsigned char *pixels = source_image->bits();
+		const QColor solid_color = frame->GetSolidColor();
+		if (solid_color.isValid()) {
+			// Fade the color of a solid color image (instead of filling and fading its pixels)
+			QColor faded_color = solid_color;
+			faded_color.setAlphaF(qBound(0.0, solid_color.alphaF() * alpha_value, 1.0));
+			frame->AddSolidColor(faded_color);
+		} else {
+			// Get source image's pixels
+			std::shared_ptr<QImage> source_image = frame->GetImage();
+			unsigned char *pixels = source_image->bits();
 
-		// Loop through pixels
-		for (int pixel = 0, byte_index=0; pixel < source_image->width() * source_image->height(); pixel++, byte_index+=4)
-		{
-			// Apply alpha to pixel values (since we use a premultiplied value, we must
-			// multiply the alpha with all colors).
-			pixels[byte_index + 0] *= alpha_value;
-			pixels[byte_index + 1] *= alpha_value;
-			pixels[byte_index + 2] *= alpha_value;
-			pixels[byte_index + 3] *= alpha_value;
+			// Loop through pixels
+			for (int pixel = 0, byte_index=0; pixel < source_image->width() * source_image->height(); pixel++, byte_index+=4)
+			{
+				// Apply alpha to pixel values (since we use a premultiplied value, we must
+				// multiply the alpha with all colors).
+				pixels[byte_index + 0] *= alpha_value;
+				pixels[byte_index + 1] *= alpha_value;
+				pixels[byte_index + 2] *= alpha_value;
+				pixels[byte_index + 3] *= alpha_value;
+			}
 		}
 
 		// Debug output
-		ZmqLogger::Instance()->AppendDebugMethod(
+		ZMQ_DEBUG(
 			"Clip::get_transform (Set Alpha & Opacity)",
 			"alpha_value", alpha_value,
 			"frame->number", frame->number);
 	}
 
 	/* RESIZE SOURCE IMAGE - based on scale type */
-	QSize source_size = source_image->size();
+	QSize source_size(frame->GetWidth(), frame->GetHeight());
 
 	// Apply stretch scale to correctly fit the bounding-box
 	if (parentTrackedObject){
@@ -1383,7 +1885,7 @@ QTransform Clip::get_transform(std::shared_ptr<Frame> frame, int width, int heig
 			source_size.scale(width, height, Qt::KeepAspectRatio);
 
 			// Debug output
-			ZmqLogger::Instance()->AppendDebugMethod(
+			ZMQ_DEBUG(
 				"Clip::get_transform (Scale: SCALE_FIT)",
 				"frame->number", frame->number,
 				"source_width", source_size.width(),
@@ -1394,7 +1896,7 @@ QTransform Clip::get_transform(std::shared_ptr<Frame> frame, int width, int heig
 			source_size.scale(width, height, Qt::IgnoreAspectRatio);
 
 			// Debug output
-			ZmqLogger::Instance()->AppendDebugMethod(
+			ZMQ_DEBUG(
 				"Clip::get_transform (Scale: SCALE_STRETCH)",
 				"frame->number", frame->number,
 				"source_width", source_size.width(),
@@ -1405,7 +1907,7 @@ QTransform Clip::get_transform(std::shared_ptr<Frame> frame, int width, int heig
 			source_size.scale(width, height, Qt::KeepAspectRatioByExpanding);
 
 			// Debug output
-			ZmqLogger::Instance()->AppendDebugMethod(
+			ZMQ_DEBUG(
 				"Clip::get_transform (Scale: SCALE_CROP)",
 				"frame->number", frame->number,
 				"source_width", source_size.width(),
@@ -1417,7 +1919,7 @@ QTransform Clip::get_transform(std::shared_ptr<Frame> frame, int width, int heig
 			// to the preview window size (i.e. timeline / preview ratio). No further
 			// scaling is needed here.
 			// Debug output
-			ZmqLogger::Instance()->AppendDebugMethod(
+			ZMQ_DEBUG(
 				"Clip::get_transform (Scale: SCALE_NONE)",
 				"frame->number", frame->number,
 				"source_width", source_size.width(),
@@ -1547,7 +2049,7 @@ QTransform Clip::get_transform(std::shared_ptr<Frame> frame, int width, int heig
 	}
 
 	// Debug output
-	ZmqLogger::Instance()->AppendDebugMethod(
+	ZMQ_DEBUG(
 		"Clip::get_transform (Gravity)",
 		"frame->number", frame->number,
 		"source_clip->gravity", gravity,
@@ -1566,7 +2068,7 @@ QTransform Clip::get_transform(std::shared_ptr<Frame> frame, int width, int heig
 	float origin_y_value = origin_y.GetValue(frame->number);
 
 	// Transform source image (if needed)
-	ZmqLogger::Instance()->AppendDebugMethod(
+	ZMQ_DEBUG(
 		"Clip::get_transform (Build QTransform - if needed)",
 		"frame->number", frame->number,
 		"x", x, "y", y,
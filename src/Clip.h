@@ -26,6 +26,8 @@
 #include <memory>
 #include <string>
 
+#include <QSize>
+
 #include "AudioLocation.h"
 #include "ClipBase.h"
 #include "ReaderBase.h"
@@ -36,11 +38,17 @@
 #include "EffectInfo.h"
 #include "KeyFrame.h"
 #include "TrackedObjectBase.h"
+#include "WaveformRenderer.h"
 
 namespace openshot {
 	class AudioResampler;
+	class AudioTimeStretcher;
 	class EffectInfo;
 	class Frame;
+	struct GpuLayer;
+	struct PixelLayer;
+	struct PixelOperation;
+	class RenderKey;
 
 	/// Comparison method for sorting effect pointers (by Position, Layer, and Order). Effects are sorted
 	/// from lowest layer to top layer (since that is sequence clips are combined), and then by
@@ -113,10 +121,22 @@ namespace openshot {
 
 		/// Final cache object used to hold final frames
 		CacheMemory final_cache;
+
+		/// Renders the waveform images (and re-uses the last one, if Waveform() is enabled)
+		openshot::WaveformRenderer waveform_renderer;
 		
 		// Audio resampler (if time mapping)
 		openshot::AudioResampler *resampler;
 
+		// Audio time stretcher (if time mapping, and preserving the pitch)
+		openshot::AudioTimeStretcher *stretcher;
+
+		// Source samples of the current time mapped frame (re-used for each frame)
+		juce::AudioBuffer<float> *time_samples;
+
+		// Last source frame of time mapped audio (which may only be partially used)
+		std::shared_ptr<openshot::Frame> time_source_frame;
+
 		// File Reader object
 		openshot::ReaderBase* reader;
 
@@ -127,14 +147,28 @@ namespace openshot {
 		/// Adjust frame number minimum value
 		int64_t adjust_frame_number_minimum(int64_t frame_number);
 
-		/// Apply background image to the current clip image (i.e. flatten this image onto previous layer)
-		void apply_background(std::shared_ptr<openshot::Frame> frame, std::shared_ptr<openshot::Frame> background_frame);
+		/// Apply background image to the current clip image (i.e. flatten this image onto previous layer).
+		/// Only the region (layer_rect) of the background covered by the clip image is blended.
+		void apply_background(std::shared_ptr<openshot::Frame> frame, std::shared_ptr<openshot::Frame> background_frame, const QRect& layer_rect);
+
+		/// Apply effects to the source frame (if any). The last point-wise effects are added to deferred_operations
+		/// instead of being applied (if set).
+		void apply_effects(std::shared_ptr<openshot::Frame> frame, std::shared_ptr<openshot::Frame> background_frame, TimelineInfoStruct* options, bool before_keyframes,
+						   std::vector<openshot::PixelOperation>* deferred_operations = nullptr);
 
-		/// Apply effects to the source frame (if any)
-		void apply_effects(std::shared_ptr<openshot::Frame> frame, std::shared_ptr<openshot::Frame> background_frame, TimelineInfoStruct* options, bool before_keyframes);
+		/// Apply keyframes to an openshot::Frame and use an existing background frame (if any).
+		/// Returns the region of the background covered by the transformed image (empty if off-canvas).
+		/// The transform is set in gpu_layer instead of being applied (if set).
+		QRect apply_keyframes(std::shared_ptr<Frame> frame, std::shared_ptr<Frame> background_frame, openshot::GpuLayer* gpu_layer = nullptr);
 
-		/// Apply keyframes to an openshot::Frame and use an existing background frame (if any)
-		void apply_keyframes(std::shared_ptr<Frame> frame, std::shared_ptr<Frame> background_frame);
+		/// Can the transform and last point-wise effects of this clip be applied by the GpuCompositor (nothing is
+		/// drawn onto the transformed image)
+		bool can_defer_to_gpu();
+
+		/// Generate a frame of this clip, with all effects and keyframes applied (but not composited onto the background).
+		/// A transparent background frame is created if there is none. Sets the region of the background covered by the frame.
+		std::shared_ptr<openshot::Frame> render_frame(std::shared_ptr<openshot::Frame>& background_frame, int64_t clip_frame_number, TimelineInfoStruct* options, QRect& layer_rect,
+													  openshot::GpuLayer* gpu_layer = nullptr);
 
 		/// Apply waveform image to an openshot::Frame and use an existing background frame (if any)
 		void apply_waveform(std::shared_ptr<Frame> frame, std::shared_ptr<Frame> background_frame);
@@ -170,6 +204,7 @@ namespace openshot {
 		openshot::AnchorType anchor;	 ///< The anchor determines what parent a clip should snap to
 		openshot::FrameDisplayType display; ///< The format to display the frame number (if any)
 		openshot::VolumeMixType mixing;  ///< What strategy should be followed when mixing audio with other clips
+		openshot::TimeStretchType time_stretch; ///< How the audio is stretched when the time curve changes its speed
 
 		#ifdef USE_OPENCV
 			bool COMPILED_WITH_CV = true;
@@ -194,6 +229,15 @@ namespace openshot {
 		/// Get the cache object (always return NULL for this reader)
 		openshot::CacheMemory* GetCache() override { return &final_cache; };
 
+		/// Get the counters of the cache of this clip, and of its reader
+		openshot::CacheStats GetCacheStats() override;
+
+		/// Reset the counters of the cache of this clip, and of its reader
+		void ResetCacheStats() override;
+
+		/// Pass the sequential hint to the reader of this clip (see ReaderBase::SetSequentialHint)
+		void SetSequentialHint(bool sequential) override;
+
 		/// Determine if reader is open or closed
 		bool IsOpen() override { return is_open; };
 
@@ -230,6 +274,16 @@ namespace openshot {
 		/// Look up an effect by ID
 		openshot::EffectBase* GetEffect(const std::string& id);
 
+		/// @brief Get the max size of this clip's source images which is still visible (used by readers to
+		/// decode, scale or render smaller images). This is based on the preview size of the parent timeline
+		/// (if any), the scale mode and the max of the scaling keyframes.
+		/// @returns The max size
+		/// @param width The width of the source images
+		/// @param height The height of the source images
+		/// @param max_width The max width (if the clip has no parent timeline)
+		/// @param max_height The max height (if the clip has no parent timeline)
+		QSize GetMaxSourceSize(int width, int height, int max_width, int max_height);
+
 		/// @brief Get an openshot::Frame object for a specific frame number of this clip. The image size and number
 		/// of samples match the source reader.
 		///
@@ -263,6 +317,48 @@ namespace openshot {
 		/// such as, if it's a top clip. This info is used to apply global transitions and masks, if needed.
 		std::shared_ptr<openshot::Frame> GetFrame(std::shared_ptr<openshot::Frame> background_frame, int64_t clip_frame_number, openshot::TimelineInfoStruct* options);
 
+		/// @brief Get this clip's frame for a timeline frame, with all keyframes and clip effects rendered, but without
+		/// compositing it onto the timeline frame (see GetPixelLayer). Used to render the clips of a timeline frame in
+		/// parallel, and then composite them in layer order.
+		///
+		/// The clip's cache is not used, since the frame is not composited yet.
+		///
+		/// @returns The rendered openshot::Frame object (its image only covers layer_rect)
+		/// @param background_frame The timeline frame (only its size is used, its image is not changed)
+		/// @param clip_frame_number The frame number (starting at 1) of the clip on the timeline
+		/// @param options The openshot::TimelineInfoStruct pointer, with more details about this specific timeline clip
+		/// @param layer_rect Set to the region of the timeline frame covered by the returned frame (empty if off-canvas)
+		/// @param gpu_layer If set, the frame is composited by the GpuCompositor: when possible, the clip's transform
+		/// and last point-wise effects are set in gpu_layer, and the returned image is not transformed
+		std::shared_ptr<openshot::Frame> GetLayerFrame(std::shared_ptr<openshot::Frame> background_frame, int64_t clip_frame_number, openshot::TimelineInfoStruct* options, QRect& layer_rect,
+													   openshot::GpuLayer* gpu_layer = nullptr);
+
+		/// @brief Describe the image of a frame from GetLayerFrame as a layer of the timeline frame (to composite
+		/// the layers of all clips together, with PixelKernels::Composite)
+		/// @returns False if the frame covers nothing
+		/// @param frame The frame returned by GetLayerFrame (it must be kept until the layer is composited)
+		/// @param layer_rect The region set by GetLayerFrame
+		/// @param layer Set to the pixels and the position of the frame's image
+		static bool GetPixelLayer(std::shared_ptr<openshot::Frame> frame, const QRect& layer_rect, openshot::PixelLayer& layer);
+
+		/// @brief Get the key of this clip's source image, if the clip's rendered image only changes when its source
+		/// image does (i.e. a still image, with no effects and constant keyframes)
+		///
+		/// Readers of still images return the same cached QImage for every frame, so two frames with the same key
+		/// render the same image (which lets the Timeline re-use a composited frame).
+		///
+		/// @returns The QImage::cacheKey() of the source image (or 0, if the clip's image can change between frames)
+		/// @param clip_frame_number The frame number (starting at 1) of the clip on the timeline
+		int64_t StaticImageKey(int64_t clip_frame_number);
+
+		/// @brief Add everything this clip's rendered frame depends on to its key in the RenderCache: its source file
+		/// and source frame, and its state (with its effects) at the frame. The Timeline adds the size of its frames
+		/// (and its own effects) to the key.
+		/// @returns False if the clip's frames can't be cached (i.e. a live source, or a clip attached to another object)
+		/// @param key The key to add to
+		/// @param clip_frame_number The frame number (starting at 1) of the clip on the timeline
+		bool AddRenderKey(openshot::RenderKey& key, int64_t clip_frame_number);
+
 		/// Open the internal reader
 		void Open() override;
 
@@ -287,7 +383,7 @@ namespace openshot {
 
 		/// Get all properties for a specific frame (perfect for a UI to display the current state
 		/// of all properties at any time)
-		std::string PropertiesJSON(int64_t requested_frame) const override;
+		Json::Value PropertiesJsonValue(int64_t requested_frame) const override;
 
 		/// @brief Remove an effect from the clip
 		/// @param effect Remove an effect from the clip.
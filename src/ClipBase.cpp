@@ -15,6 +15,21 @@
 
 using namespace openshot;
 
+// Set the Id of this clip object
+void ClipBase::Id(std::string value) {
+	if (value == id)
+		return;
+
+	const std::string old_id = id;
+	id = value;
+
+	if (ParentTimeline()) {
+		// Update the timeline's lookups by id
+		Timeline *parentTimeline = (Timeline *) ParentTimeline();
+		parentTimeline->UpdateId(this, old_id);
+	}
+}
+
 // Set position on timeline (in seconds)
 void ClipBase::Position(float value) {
 
@@ -129,6 +144,34 @@ Json::Value ClipBase::add_property_json(std::string name, float value, std::stri
 	return prop;
 }
 
+// Get the properties which changed since the last call
+std::string ClipBase::PropertiesJSONDiff(int64_t requested_frame, bool binary) {
+
+	const Json::Value properties = PropertiesJsonValue(requested_frame);
+	const Json::Value& previous = previous_property_values;
+
+	// Only keep the changed (and removed) properties
+	Json::Value changes = Json::Value(Json::objectValue);
+	for (auto property = properties.begin(); property != properties.end(); property++) {
+		const std::string name = property.name();
+		if (!previous.isMember(name) || previous[name] != *property)
+			changes[name] = *property;
+	}
+	for (auto property = previous.begin(); property != previous.end(); property++) {
+		if (!properties.isMember(property.name()))
+			changes[property.name()] = Json::Value(Json::nullValue);
+	}
+	previous_property_values = properties;
+
+	if (binary)
+		return jsonToBinary(changes);
+
+	// Write compact JSON
+	Json::StreamWriterBuilder builder;
+	builder["indentation"] = "";
+	return Json::writeString(builder, changes);
+}
+
 Json::Value ClipBase::add_property_choice_json(std::string name, int value, int selected_value) const {
 
 	// Create choice
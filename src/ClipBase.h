@@ -38,6 +38,7 @@ namespace openshot {
 		float start; ///< The position in seconds to start playing (used to trim the beginning of a clip)
 		float end; ///< The position in seconds to end playing (used to trim the ending of a clip)
 		std::string previous_properties; ///< This string contains the previous JSON properties
+		Json::Value previous_property_values; ///< The properties of the last call to PropertiesJSONDiff
 		openshot::TimelineBase* timeline; ///< Pointer to the parent timeline instance (if any)
 
 		/// Generate JSON for a property
@@ -91,7 +92,7 @@ namespace openshot {
 		virtual openshot::TimelineBase* ParentTimeline() { return timeline; } ///< Get the associated Timeline pointer (if any)
 
 		// Set basic properties
-		void Id(std::string value) { id = value; } ///> Set the Id of this clip object
+		void Id(std::string value); ///> Set the Id of this clip object
 		void Position(float value); ///< Set position on timeline (in seconds)
 		void Layer(int value); ///< Set layer of clip on timeline (lower number is covered by higher numbers)
 		void Start(float value); ///< Set start position (in seconds) of clip (trim start of video)
@@ -104,9 +105,25 @@ namespace openshot {
 		virtual Json::Value JsonValue() const = 0; ///< Generate Json::Value for this object
 		virtual void SetJsonValue(const Json::Value root) = 0; ///< Load Json::Value into this object
 
+		/// Get all properties for a specific frame (as a Json::Value)
+		virtual Json::Value PropertiesJsonValue(int64_t requested_frame) const = 0;
+
 		/// Get all properties for a specific frame (perfect for a UI to display the current state
 		/// of all properties at any time)
-		virtual std::string PropertiesJSON(int64_t requested_frame) const = 0;
+		virtual std::string PropertiesJSON(int64_t requested_frame) const { return PropertiesJsonValue(requested_frame).toStyledString(); }
+
+		/// @brief Get the properties which changed since the last call, for a UI which updates its properties
+		/// on every move of the playhead
+		///
+		/// Only the properties whose value (or keyframe state) differ from the previous call are returned (the
+		/// first call returns all of them), as compact JSON (or the binary JSON of jsonToBinary()). Removed
+		/// properties are null. Call it from a single thread (i.e. the UI thread).
+		/// @param requested_frame The frame number
+		/// @param binary Return binary JSON (see binaryToJson()) instead of JSON text
+		std::string PropertiesJSONDiff(int64_t requested_frame, bool binary=false);
+
+		/// Forget the properties of the last call to PropertiesJSONDiff (so the next call returns all of them)
+		void ResetPropertiesDiff() { previous_property_values = Json::Value(); }
 
 		virtual ~ClipBase() = default;
 	};
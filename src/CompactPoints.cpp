@@ -0,0 +1,178 @@
+/**
+ * @file
+ * @brief Source file for CompactPoints class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+
+#include "CompactPoints.h"
+
+using namespace openshot;
+
+// A point has handles which are not the defaults
+static const uint8_t HAS_HANDLES = 4;
+
+// Determine if a point has the default handles (which are not stored)
+bool CompactPoints::has_default_handles(const Point& p) {
+	return p.handle_type == AUTO &&
+		p.handle_left.X == 0.5 && p.handle_left.Y == 1.0 &&
+		p.handle_right.X == 0.5 && p.handle_right.Y == 0.0;
+}
+
+// Find the handles of a point (or NULL)
+const CompactPoints::Handles* CompactPoints::find_handles(int64_t index) const {
+	std::vector<Handles>::const_iterator found = std::lower_bound(begin(handles), end(handles), index,
+		[](const Handles& h, int64_t value) { return h.index < value; });
+	if (found == end(handles) || found->index != index)
+		return NULL;
+	return &(*found);
+}
+
+// Store the Y value of a point (switching to doubles, if needed)
+void CompactPoints::set_y(int64_t index, double value) {
+	if (!y_is_double && double(float(value)) != value) {
+		// This value needs a double (so all of them are doubles from now on)
+		y_double.assign(begin(y_float), end(y_float));
+		std::vector<float>().swap(y_float);
+		y_is_double = true;
+	}
+	if (y_is_double)
+		y_double[index] = value;
+	else
+		y_float[index] = float(value);
+}
+
+// Store the interpolation and handles of a point
+void CompactPoints::set_details(int64_t index, const Point& p) {
+	std::vector<Handles>::iterator found = std::lower_bound(begin(handles), end(handles), index,
+		[](const Handles& h, int64_t value) { return h.index < value; });
+	const bool stored = found != end(handles) && found->index == index;
+
+	if (has_default_handles(p)) {
+		flags[index] = uint8_t(p.interpolation);
+		if (stored)
+			handles.erase(found);
+	} else {
+		flags[index] = uint8_t(p.interpolation) | HAS_HANDLES;
+		Handles h = {index, p.handle_left, p.handle_right, p.handle_type};
+		if (stored)
+			*found = h;
+		else
+			handles.insert(found, h);
+	}
+}
+
+// Remove all points (and free their memory)
+void CompactPoints::clear() {
+	std::vector<double>().swap(x);
+	std::vector<float>().swap(y_float);
+	std::vector<double>().swap(y_double);
+	std::vector<uint8_t>().swap(flags);
+	std::vector<Handles>().swap(handles);
+	y_is_double = false;
+}
+
+// Reserve memory for a number of points
+void CompactPoints::reserve(int64_t count) {
+	x.reserve(count);
+	if (y_is_double)
+		y_double.reserve(count);
+	else
+		y_float.reserve(count);
+	flags.reserve(count);
+}
+
+// Get a point (with its handles)
+Point CompactPoints::Get(int64_t index) const {
+	Point p(Coordinate(x[index], Y(index)), Interpolation(index));
+	if (flags[index] & HAS_HANDLES) {
+		const Handles* h = find_handles(index);
+		p.handle_left = h->left;
+		p.handle_right = h->right;
+		p.handle_type = h->type;
+	}
+	return p;
+}
+
+// Get the index of the first point with an X which is not less than a value
+int64_t CompactPoints::LowerBound(double value) const {
+	return std::lower_bound(begin(x), end(x), value) - begin(x);
+}
+
+// Replace a point
+void CompactPoints::Set(int64_t index, const Point& p) {
+	x[index] = p.co.X;
+	set_y(index, p.co.Y);
+	set_details(index, p);
+}
+
+// Insert a point before an index
+void CompactPoints::Insert(int64_t index, const Point& p) {
+	x.insert(begin(x) + index, p.co.X);
+	if (y_is_double)
+		y_double.insert(begin(y_double) + index, 0.0);
+	else
+		y_float.insert(begin(y_float) + index, 0.0f);
+	flags.insert(begin(flags) + index, 0);
+
+	// The handles of the following points move with them
+	for (auto& h : handles) {
+		if (h.index >= index)
+			h.index++;
+	}
+	set_y(index, p.co.Y);
+	set_details(index, p);
+}
+
+// Add a point after the last point
+void CompactPoints::PushBack(const Point& p) {
+	Insert(size(), p);
+}
+
+// Add points after the last point (from separate X and Y values, all with the same interpolation)
+void CompactPoints::Append(const std::vector<double>& x_values, const std::vector<double>& y_values, InterpolationType interpolation) {
+	const int64_t first = size();
+	const int64_t count = std::min(x_values.size(), y_values.size());
+	reserve(first + count);
+	x.insert(end(x), begin(x_values), begin(x_values) + count);
+	flags.insert(end(flags), count, uint8_t(interpolation));
+	if (y_is_double) {
+		y_double.insert(end(y_double), begin(y_values), begin(y_values) + count);
+	} else {
+		y_float.resize(first + count);
+		for (int64_t index = 0; index < count; index++)
+			set_y(first + index, y_values[index]);
+	}
+}
+
+// Remove a point
+void CompactPoints::Erase(int64_t index) {
+	if (flags[index] & HAS_HANDLES) {
+		handles.erase(std::lower_bound(begin(handles), end(handles), index,
+			[](const Handles& h, int64_t value) { return h.index < value; }));
+	}
+	for (auto& h : handles) {
+		if (h.index > index)
+			h.index--;
+	}
+	x.erase(begin(x) + index);
+	if (y_is_double)
+		y_double.erase(begin(y_double) + index);
+	else
+		y_float.erase(begin(y_float) + index);
+	flags.erase(begin(flags) + index);
+}
+
+// Get the memory used by the points (in bytes)
+int64_t CompactPoints::MemoryUsage() const {
+	return sizeof(CompactPoints) + x.capacity() * sizeof(double) + y_float.capacity() * sizeof(float) +
+		y_double.capacity() * sizeof(double) + flags.capacity() * sizeof(uint8_t) +
+		handles.capacity() * sizeof(Handles);
+}
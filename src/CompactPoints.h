@@ -0,0 +1,119 @@
+/**
+ * @file
+ * @brief Header file for CompactPoints class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_COMPACT_POINTS_H
+#define OPENSHOT_COMPACT_POINTS_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Point.h"
+
+namespace openshot {
+
+	/**
+	 * @brief The points of a Keyframe, stored as separate arrays (sorted by X)
+	 *
+	 * A Point is 3 coordinates of doubles (plus its interpolation and handle type), but most points only need
+	 * their X and Y: curves generated from tracking or audio data have many thousands of linear points, and
+	 * Bezier points usually keep the default handles. This stores the X values, the Y values and the
+	 * interpolations in separate arrays, and only the handles which are not the defaults (in a sparse array).
+	 * Searching for an X only touches the X array.
+	 *
+	 * The Y values are floats while every Y value is exactly a float (i.e. points created from floats), and
+	 * doubles once one isn't, so a point is always returned with the same values it was stored with.
+	 */
+	class CompactPoints {
+	private:
+		/// The handles of a point which are not the defaults
+		struct Handles {
+			int64_t index; ///< The index of the point
+			Coordinate left; ///< The left handle
+			Coordinate right; ///< The right handle
+			HandleType type; ///< The handle mode
+		};
+
+		std::vector<double> x; ///< The X of each point
+		std::vector<float> y_float; ///< The Y of each point (while every Y is exactly a float)
+		std::vector<double> y_double; ///< The Y of each point (once a Y is not exactly a float)
+		bool y_is_double = false; ///< Which array holds the Y values
+		std::vector<uint8_t> flags; ///< The interpolation of each point (and whether it has handles)
+		std::vector<Handles> handles; ///< The handles which are not the defaults (sorted by index)
+
+		/// Determine if a point has the default handles (which are not stored)
+		static bool has_default_handles(const Point& p);
+
+		/// Find the handles of a point (or NULL)
+		const Handles* find_handles(int64_t index) const;
+
+		/// Store the Y value of a point (switching to doubles, if needed)
+		void set_y(int64_t index, double value);
+
+		/// Store the interpolation and handles of a point
+		void set_details(int64_t index, const Point& p);
+
+	public:
+		/// Get the number of points
+		int64_t size() const { return x.size(); }
+
+		/// Determine if there are no points
+		bool empty() const { return x.empty(); }
+
+		/// Remove all points (and free their memory)
+		void clear();
+
+		/// Reserve memory for a number of points
+		void reserve(int64_t count);
+
+		/// Get the X of a point
+		double X(int64_t index) const { return x[index]; }
+
+		/// Get the Y of a point
+		double Y(int64_t index) const { return y_is_double ? y_double[index] : double(y_float[index]); }
+
+		/// Get the interpolation of a point
+		InterpolationType Interpolation(int64_t index) const { return InterpolationType(flags[index] & 3); }
+
+		/// Get a point (with its handles)
+		Point Get(int64_t index) const;
+
+		/// Get the index of the first point with an X which is not less than a value (or size(), if none)
+		int64_t LowerBound(double value) const;
+
+		/// Replace a point
+		void Set(int64_t index, const Point& p);
+
+		/// Insert a point before an index
+		void Insert(int64_t index, const Point& p);
+
+		/// Add a point after the last point
+		void PushBack(const Point& p);
+
+		/// Add points after the last point (from separate X and Y values, all with the same interpolation)
+		void Append(const std::vector<double>& x_values, const std::vector<double>& y_values, InterpolationType interpolation);
+
+		/// Remove a point
+		void Erase(int64_t index);
+
+		/// Change the X of a point
+		void SetX(int64_t index, double value) { x[index] = value; }
+
+		/// Change the Y of a point
+		void SetY(int64_t index, double value) { set_y(index, value); }
+
+		/// Get the memory used by the points (in bytes)
+		int64_t MemoryUsage() const;
+	};
+
+}
+
+#endif
@@ -0,0 +1,151 @@
+/**
+ * @file
+ * @brief Source file for DecoderPool class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <QDateTime>
+#include <QFileInfo>
+
+#include "DecoderPool.h"
+#include "HardwareDevices.h"
+#include "Settings.h"
+
+using namespace openshot;
+
+// Free the contexts
+DecoderContexts::~DecoderContexts()
+{
+	if (video_context)
+		AV_FREE_CONTEXT(video_context);
+	if (audio_context)
+		AV_FREE_CONTEXT(audio_context);
+	if (hw_device_context)
+		av_buffer_unref(&hw_device_context);
+	HardwareDevices::Instance()->Release(HARDWARE_DECODE_SESSION, hw_device_index);
+
+	// Close the file (and then its read-ahead I/O, if any)
+	if (format_context)
+		avformat_close_input(&format_context);
+	read_ahead_io.reset();
+}
+
+// Hand the contexts over to a reader
+void DecoderContexts::Detach()
+{
+	format_context = NULL;
+	video_context = NULL;
+	audio_context = NULL;
+	hw_device_context = NULL;
+	hw_device_index = -1;
+}
+
+// Global reference to the pool
+DecoderPool *DecoderPool::m_pInstance = nullptr;
+
+// Create or Get an instance of the pool singleton
+DecoderPool *DecoderPool::Instance()
+{
+	// Create the actual instance of the pool only once (readers are opened on many threads)
+	static std::once_flag created;
+	std::call_once(created, []() { m_pInstance = new DecoderPool; });
+
+	return m_pInstance;
+}
+
+// Get the modification time and size of a file
+bool DecoderPool::file_stamp(const std::string& path, int64_t& modified, int64_t& size)
+{
+	QFileInfo file(QString::fromStdString(path));
+	if (!file.exists() || !file.isFile())
+		return false;
+
+	modified = file.lastModified().toMSecsSinceEpoch();
+	size = file.size();
+	return true;
+}
+
+// Take the idle contexts of a file, rewound to its start
+std::unique_ptr<DecoderContexts> DecoderPool::Acquire(const std::string& path, int hardware_decoder, int decoder_threads, bool slice_threading)
+{
+	int64_t modified, size;
+	if (!file_stamp(path, modified, size))
+		return nullptr;
+
+	std::unique_ptr<DecoderContexts> contexts;
+	{
+		const std::lock_guard<std::mutex> lock(poolMutex);
+		for (auto it = idle_contexts.begin(); it != idle_contexts.end(); ++it) {
+			const DecoderContexts& idle = **it;
+			if (idle.path == path && idle.hardware_decoder == hardware_decoder && idle.decoder_threads == decoder_threads &&
+				idle.slice_threading == slice_threading) {
+				contexts = std::move(*it);
+				idle_contexts.erase(it);
+				break;
+			}
+		}
+	}
+	if (!contexts)
+		return nullptr;
+
+	// The file changed since it was closed (i.e. a regenerated proxy)
+	if (contexts->modified != modified || contexts->size != size)
+		return nullptr;
+
+	// Rewind to the start of the file (the contexts are freed if the file can't seek)
+	AVFormatContext *format_context = contexts->format_context;
+	const int64_t start = (format_context->start_time != AV_NOPTS_VALUE) ? format_context->start_time : 0;
+	if (avformat_seek_file(format_context, -1, INT64_MIN, start, start, 0) < 0)
+		return nullptr;
+
+	return contexts;
+}
+
+// Keep the contexts of a closed reader
+void DecoderPool::Release(std::unique_ptr<DecoderContexts> contexts)
+{
+	const int max_contexts = Settings::Instance()->DECODER_POOL_SIZE;
+	if (!contexts || !contexts->format_context || max_contexts <= 0 ||
+		!file_stamp(contexts->path, contexts->modified, contexts->size))
+		return;
+
+	// Release the decoded pictures held by the decoders
+	if (contexts->video_context && avcodec_is_open(contexts->video_context))
+		avcodec_flush_buffers(contexts->video_context);
+	if (contexts->audio_context && avcodec_is_open(contexts->audio_context))
+		avcodec_flush_buffers(contexts->audio_context);
+
+	// Free the least recently closed contexts (outside of the lock, since closing files can be slow)
+	std::list<std::unique_ptr<DecoderContexts>> freed_contexts;
+	{
+		const std::lock_guard<std::mutex> lock(poolMutex);
+		idle_contexts.push_front(std::move(contexts));
+		while ((int) idle_contexts.size() > max_contexts) {
+			freed_contexts.push_back(std::move(idle_contexts.back()));
+			idle_contexts.pop_back();
+		}
+	}
+}
+
+// Free all idle contexts
+void DecoderPool::Clear()
+{
+	std::list<std::unique_ptr<DecoderContexts>> freed_contexts;
+	{
+		const std::lock_guard<std::mutex> lock(poolMutex);
+		freed_contexts.swap(idle_contexts);
+	}
+}
+
+// Get the number of idle contexts
+int DecoderPool::Count()
+{
+	const std::lock_guard<std::mutex> lock(poolMutex);
+	return (int) idle_contexts.size();
+}
@@ -0,0 +1,117 @@
+/**
+ * @file
+ * @brief Header file for DecoderPool class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_DECODER_POOL_H
+#define OPENSHOT_DECODER_POOL_H
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "FFmpegUtilities.h"
+#include "ReadAheadIO.h"
+
+namespace openshot {
+
+	/// The demuxer and decoders of a closed FFmpegReader (which are freed with this object, unless they are detached)
+	struct DecoderContexts {
+		std::string path; ///< The path of the file
+		int64_t modified = 0; ///< The modification time of the file (in ms since the epoch)
+		int64_t size = 0; ///< The size of the file (in bytes)
+		int hardware_decoder = 0; ///< The hardware decoder the video decoder was opened with (see Settings::HARDWARE_DECODER)
+		int decoder_threads = 0; ///< The number of threads the decoders were opened with
+		bool slice_threading = false; ///< The video decoder only uses slice threads (see Settings::DECODER_THREAD_TYPE)
+		int hw_de_supported = 0; ///< The video decoder is a hardware decoder
+		int hw_device_index = -1; ///< The GPU of the hardware decoder (its session is released with the contexts)
+
+		AVFormatContext *format_context = NULL;
+		AVCodecContext *video_context = NULL;
+		AVCodecContext *audio_context = NULL;
+		AVBufferRef *hw_device_context = NULL;
+		std::unique_ptr<openshot::ReadAheadIO> read_ahead_io; ///< The read-ahead I/O of the format context (if any)
+
+		DecoderContexts() = default;
+		DecoderContexts(DecoderContexts const&) = delete;
+		DecoderContexts & operator=(DecoderContexts const&) = delete;
+
+		/// Destructor (frees the contexts)
+		~DecoderContexts();
+
+		/// Hand the contexts over to a reader, so they are no longer freed with this object (read_ahead_io is moved separately)
+		void Detach();
+	};
+
+	/**
+	 * @brief This singleton class keeps the demuxers and decoders of closed FFmpegReaders open, to re-open them quickly
+	 *
+	 * Timelines open the readers of clips as the playhead reaches them, and close them again after the clips end.
+	 * Opening a file probes its streams, and opens its decoders (and hardware devices), which dominates the time
+	 * spent on timelines with many short clips. Instead of freeing its contexts, a closed reader returns them to
+	 * this pool, and the next reader which opens the same (unchanged) file, with the same decoder settings,
+	 * re-uses them (rewound to the start of the file).
+	 *
+	 * Only up to Settings::DECODER_POOL_SIZE idle files are kept open (the least recently closed are freed first).
+	 *
+	 * \code
+	 * // The second Open() re-uses the demuxer and decoders of the first
+	 * FFmpegReader r("video.mp4");
+	 * r.Open();
+	 * r.Close();
+	 * r.Open();
+	 * \endcode
+	 */
+	class DecoderPool {
+	private:
+		std::mutex poolMutex;
+		std::list<std::unique_ptr<DecoderContexts>> idle_contexts; ///< The idle contexts (the most recently closed first)
+
+		/// Private variable to keep track of singleton instance
+		static DecoderPool *m_pInstance;
+
+		/// Default constructor
+		DecoderPool() = default;
+
+		/// Don't allow the user to copy or assign this instance
+		DecoderPool(DecoderPool const&) = delete;
+		DecoderPool & operator=(DecoderPool const&) = delete;
+
+		/// Get the modification time and size of a file (returns false if it's not a local file)
+		static bool file_stamp(const std::string& path, int64_t& modified, int64_t& size);
+
+	public:
+		/// Create or get an instance of this pool singleton (invoke the class with this method)
+		static DecoderPool *Instance();
+
+		/// @brief Take the idle contexts of a file, rewound to its start
+		/// @returns The contexts, or nullptr if no contexts of the (unchanged) file were opened with the same settings
+		/// @param path The path of the file
+		/// @param hardware_decoder The hardware decoder (see Settings::HARDWARE_DECODER)
+		/// @param decoder_threads The number of decoder threads
+		/// @param slice_threading The video decoder only uses slice threads
+		std::unique_ptr<DecoderContexts> Acquire(const std::string& path, int hardware_decoder, int decoder_threads, bool slice_threading);
+
+		/// @brief Keep the contexts of a closed reader (or free them, if pooling is disabled or the file is not a local file)
+		/// @param contexts The contexts (with their path and settings)
+		void Release(std::unique_ptr<DecoderContexts> contexts);
+
+		/// Free all idle contexts
+		void Clear();
+
+		/// Get the number of idle contexts
+		int Count();
+	};
+
+}
+
+#endif
@@ -0,0 +1,108 @@
+/**
+ * @file
+ * @brief Source file for DnnModelCache class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <filesystem>
+#include <fstream>
+
+#include "DnnModelCache.h"
+#include "ZmqLogger.h"
+
+using namespace openshot;
+
+namespace {
+	// Get the modification time of a file (so a replaced model is loaded again)
+	std::string file_version(const std::string& path) {
+		std::error_code error;
+		const auto time = std::filesystem::last_write_time(path, error);
+		return error ? "" : std::to_string(time.time_since_epoch().count());
+	}
+}
+
+// Global reference to the cache
+DnnModelCache *DnnModelCache::m_pInstance = nullptr;
+
+// Create or Get an instance of the cache singleton
+DnnModelCache *DnnModelCache::Instance()
+{
+	// Create the actual instance of the cache only once (jobs run on many threads)
+	static std::once_flag created;
+	std::call_once(created, []() { m_pInstance = new DnnModelCache; });
+
+	return m_pInstance;
+}
+
+// Get a network of a Darknet model
+std::shared_ptr<DnnModel> DnnModelCache::Acquire(const std::string& config, const std::string& weights, const std::string& classes,
+												 const std::string& device, std::function<void(cv::dnn::Net&)> configure)
+{
+	const std::string key = config + '\n' + file_version(config) + '\n' + weights + '\n' + file_version(weights) + '\n' +
+		classes + '\n' + file_version(classes) + '\n' + device;
+
+	// Re-use an idle network of the model
+	std::shared_ptr<DnnModel> model;
+	{
+		const std::lock_guard<std::mutex> lock(cacheMutex);
+		auto entry = idle.find(key);
+		if (entry != idle.end() && !entry->second.empty()) {
+			model = entry->second.back();
+			entry->second.pop_back();
+		}
+	}
+
+	// Or load a new network (outside the lock, since it takes a while)
+	if (!model) {
+		model = std::make_shared<DnnModel>();
+		std::ifstream ifs(classes.c_str());
+		std::string line;
+		while (std::getline(ifs, line))
+			model->class_names.push_back(line);
+
+		try {
+			model->net = cv::dnn::readNetFromDarknet(config, weights);
+		} catch (const cv::Exception&) {
+			return nullptr;
+		}
+		if (model->net.empty())
+			return nullptr;
+		if (configure)
+			configure(model->net);
+
+		ZMQ_DEBUG("DnnModelCache::Acquire (loaded model)", "classes", model->class_names.size());
+	}
+
+	// The network is idle again once the caller releases it
+	return std::shared_ptr<DnnModel>(model.get(), [this, key, model](DnnModel*) { release(key, model); });
+}
+
+// Put a released network back with the idle networks
+void DnnModelCache::release(const std::string& key, std::shared_ptr<DnnModel> model)
+{
+	const std::lock_guard<std::mutex> lock(cacheMutex);
+	idle[key].push_back(model);
+}
+
+// Release all idle networks
+void DnnModelCache::Clear()
+{
+	const std::lock_guard<std::mutex> lock(cacheMutex);
+	idle.clear();
+}
+
+// Get the number of idle networks
+int64_t DnnModelCache::Count()
+{
+	const std::lock_guard<std::mutex> lock(cacheMutex);
+	int64_t count = 0;
+	for (const auto& entry : idle)
+		count += entry.second.size();
+	return count;
+}
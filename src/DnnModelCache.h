@@ -0,0 +1,90 @@
+/**
+ * @file
+ * @brief Header file for DnnModelCache class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_DNN_MODEL_CACHE_H
+#define OPENSHOT_DNN_MODEL_CACHE_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <opencv2/dnn.hpp>
+
+namespace openshot {
+
+	/// A loaded network, and the names of its classes
+	struct DnnModel {
+		cv::dnn::Net net;
+		std::vector<std::string> class_names;
+	};
+
+	/**
+	 * @brief This singleton class keeps the loaded (and initialized) detection networks, so the object
+	 * detection jobs of many clips don't read the same weights, and initialize the same backend, each time
+	 *
+	 * A network can only run one forward pass at a time, so each job gets a network of its own: Acquire()
+	 * returns an idle network of the same model (configuration, weights, classes and device), or loads a new
+	 * one, and the network is idle again once the returned model is released. The idle networks are kept
+	 * until Clear() is called.
+	 *
+	 * \code
+	 * std::shared_ptr<DnnModel> model = DnnModelCache::Instance()->Acquire(config, weights, classes, "CPU",
+	 *     [](cv::dnn::Net& net) { net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU); });
+	 * model->net.setInput(blob);
+	 * \endcode
+	 */
+	class DnnModelCache {
+	private:
+		std::mutex cacheMutex;
+		std::map<std::string, std::vector<std::shared_ptr<DnnModel>>> idle; ///< Keyed by model files and device
+
+		/// Private variable to keep track of singleton instance
+		static DnnModelCache *m_pInstance;
+
+		/// Default constructor
+		DnnModelCache() = default;
+
+		/// Don't allow the user to copy or assign this instance
+		DnnModelCache(DnnModelCache const&) = delete;
+		DnnModelCache & operator=(DnnModelCache const&) = delete;
+
+		/// Put a released network back with the idle networks
+		void release(const std::string& key, std::shared_ptr<DnnModel> model);
+
+	public:
+		/// Create or get an instance of this cache singleton (invoke the class with this method)
+		static DnnModelCache *Instance();
+
+		/// @brief Get a network of a Darknet model, which is used by the caller only (until it is released)
+		/// @returns nullptr if the model could not be loaded
+		/// @param config The path of the network configuration (.cfg)
+		/// @param weights The path of the network weights
+		/// @param classes The path of the class names (one per line)
+		/// @param device The name of the device the network runs on (part of the key)
+		/// @param configure Sets the backend and target of a newly loaded network (for the device)
+		std::shared_ptr<DnnModel> Acquire(const std::string& config, const std::string& weights, const std::string& classes,
+										  const std::string& device, std::function<void(cv::dnn::Net&)> configure);
+
+		/// Release all idle networks (the networks in use are released when their jobs finish)
+		void Clear();
+
+		/// Get the number of idle networks
+		int64_t Count();
+	};
+
+}
+
+#endif
@@ -11,8 +11,16 @@
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
 #include "DummyReader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <QPainter>
+
 #include "Exceptions.h"
 #include "Frame.h"
+#include "ImageBufferPool.h"
 
 using namespace openshot;
 
@@ -47,7 +55,8 @@ void DummyReader::init(Fraction fps, int width, int height, int sample_rate, int
 }
 
 // Blank constructor for DummyReader, with default settings.
-DummyReader::DummyReader() : dummy_cache(NULL), last_cached_frame(NULL), image_frame(NULL), is_open(false) {
+DummyReader::DummyReader() : dummy_cache(NULL), last_cached_frame(NULL), image_frame(NULL), is_open(false),
+	procedural(false), tone_frequency(440.0) {
 
 	// Initialize important variables
 	init(Fraction(24,1), 1280, 768, 44100, 2, 30.0);
@@ -55,7 +64,7 @@ DummyReader::DummyReader() : dummy_cache(NULL), last_cached_frame(NULL), image_f
 
 // Constructor for DummyReader.  Pass a framerate and samplerate.
 DummyReader::DummyReader(Fraction fps, int width, int height, int sample_rate, int channels, float duration) :
-    dummy_cache(NULL), last_cached_frame(NULL), image_frame(NULL), is_open(false) {
+    dummy_cache(NULL), last_cached_frame(NULL), image_frame(NULL), is_open(false), procedural(false), tone_frequency(440.0) {
 
 	// Initialize important variables
 	init(fps, width, height, sample_rate, channels, duration);
@@ -63,7 +72,8 @@ DummyReader::DummyReader(Fraction fps, int width, int height, int sample_rate, i
 
 // Constructor which also takes a cache object
 DummyReader::DummyReader(Fraction fps, int width, int height, int sample_rate, int channels, float duration,
-                         CacheBase* cache) :  last_cached_frame(NULL), image_frame(NULL), is_open(false) {
+                         CacheBase* cache) :  last_cached_frame(NULL), image_frame(NULL), is_open(false),
+                         procedural(false), tone_frequency(440.0) {
 
 	// Initialize important variables
 	init(fps, width, height, sample_rate, channels, duration);
@@ -84,6 +94,10 @@ void DummyReader::Open()
 		// Create or get frame object
 		image_frame = std::make_shared<Frame>(1, info.width, info.height, "#000000", info.sample_rate, info.channels);
 
+		// Draw the color bars of the test patterns
+		if (procedural)
+			init_pattern();
+
 		// Mark as "open"
 		is_open = true;
 	}
@@ -95,6 +109,8 @@ void DummyReader::Close()
 	// Close all objects, if reader is 'open'
 	if (is_open)
 	{
+		pattern_background.reset();
+
 		// Mark as "closed"
 		is_open = false;
 	}
@@ -108,6 +124,10 @@ std::shared_ptr<Frame> DummyReader::GetFrame(int64_t requested_frame)
 	if (!is_open)
 		throw ReaderClosed("The ImageReader is closed.  Call Open() before calling this method.", "dummy");
 
+	// Generate a test pattern (without a lock, so frames are generated in parallel)
+	if (procedural)
+		return generate_frame(std::max(requested_frame, int64_t(1)));
+
 	int dummy_cache_count = 0;
 	if (dummy_cache) {
 		dummy_cache_count = dummy_cache->Count();
@@ -145,6 +165,96 @@ std::shared_ptr<Frame> DummyReader::GetFrame(int64_t requested_frame)
 		throw InvalidFile("No frame could be created from this type of file.", "dummy");
 }
 
+// Generate a test pattern for each frame
+void DummyReader::SetProcedural(bool generate, float frequency)
+{
+	const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+	procedural = generate;
+	tone_frequency = frequency;
+	info.has_audio = generate && info.channels > 0 && info.sample_rate > 0;
+	if (info.channels == 1)
+		info.channel_layout = LAYOUT_MONO;
+	else if (info.channels == 2)
+		info.channel_layout = LAYOUT_STEREO;
+
+	if (is_open && procedural)
+		init_pattern();
+	else
+		pattern_background.reset();
+}
+
+// Draw the color bars of procedural frames
+void DummyReader::init_pattern()
+{
+	// 75% color bars
+	static const QColor bars[] = {
+		QColor(191, 191, 191), QColor(191, 191, 0), QColor(0, 191, 191), QColor(0, 191, 0),
+		QColor(191, 0, 191), QColor(191, 0, 0), QColor(0, 0, 191)
+	};
+	auto background = std::make_shared<QImage>(std::max(info.width, 1), std::max(info.height, 1), QImage::Format_RGBA8888_Premultiplied);
+	QPainter painter(background.get());
+	const int bar_count = sizeof(bars) / sizeof(bars[0]);
+	for (int bar = 0; bar < bar_count; bar++) {
+		const int left = background->width() * bar / bar_count;
+		const int right = background->width() * (bar + 1) / bar_count;
+		painter.fillRect(left, 0, right - left, background->height(), bars[bar]);
+	}
+	painter.end();
+	pattern_background = background;
+}
+
+// Generate a procedural frame
+std::shared_ptr<Frame> DummyReader::generate_frame(int64_t number)
+{
+	std::shared_ptr<QImage> background = pattern_background;
+	if (!background)
+		throw ReaderClosed("The DummyReader is closed.  Call Open() before calling this method.", "dummy");
+	const int width = background->width();
+	const int height = background->height();
+
+	// Copy the color bars
+	std::shared_ptr<QImage> image = ImageBufferPool::Instance()->CreateImage(width, height, QImage::Format_RGBA8888_Premultiplied);
+	for (int y = 0; y < height; y++)
+		memcpy(image->scanLine(y), background->constScanLine(y), width * 4);
+
+	QPainter painter(image.get());
+
+	// A box which moves from the left to the right edge every 2 seconds
+	const int64_t period = std::max(int64_t(info.fps.ToDouble() * 2.0), int64_t(1));
+	const int box = std::max(height / 6, 1);
+	const int box_x = int(double((number - 1) % period) / period * std::max(width - box, 0));
+	painter.fillRect(box_x, (height - box) / 2, box, box, Qt::white);
+
+	// The bits of the frame number (lowest first), as black and white cells along the bottom
+	const int cell_width = std::max(width / 32, 1);
+	const int cell_height = std::max(height / 16, 1);
+	for (int bit = 0; bit < 32 && bit * cell_width < width; bit++) {
+		const bool set = (number >> bit) & 1;
+		painter.fillRect(bit * cell_width, height - cell_height, cell_width, cell_height, set ? Qt::white : Qt::black);
+	}
+	painter.end();
+
+	// A tone on each channel (continuous across frames)
+	const int samples = info.has_audio ? Frame::GetSamplesPerFrame(number, info.fps, info.sample_rate, info.channels) : 0;
+	auto frame = std::make_shared<Frame>(number, width, height, "#000000", samples, info.channels);
+	frame->AddImage(image);
+	frame->SampleRate(info.sample_rate);
+	frame->ChannelsLayout(info.channel_layout);
+	if (samples > 0) {
+		const int64_t first_sample = Frame::GetSamplesBefore(number, info.fps, info.sample_rate, info.channels);
+		std::vector<float> tone(samples);
+		for (int channel = 0; channel < info.channels; channel++) {
+			const double frequency = double(tone_frequency) * (channel + 1);
+			for (int s = 0; s < samples; s++) {
+				const double cycles = frequency * double(first_sample + s) / info.sample_rate;
+				tone[s] = 0.5f * float(std::sin(2.0 * M_PI * (cycles - std::floor(cycles))));
+			}
+			frame->AddAudio(true, channel, 0, tone.data(), samples, 1.0f);
+		}
+	}
+	return frame;
+}
+
 // Generate JSON string of this object
 std::string DummyReader::Json() const {
 
@@ -158,6 +268,8 @@ Json::Value DummyReader::JsonValue() const {
 	// Create root json object
 	Json::Value root = ReaderBase::JsonValue(); // get parent properties
 	root["type"] = "DummyReader";
+	root["procedural"] = procedural;
+	root["tone_frequency"] = tone_frequency;
 
 	// return JsonValue
 	return root;
@@ -186,4 +298,9 @@ void DummyReader::SetJsonValue(const Json::Value root) {
 	// Set parent data
 	ReaderBase::SetJsonValue(root);
 
+	// Set data from Json (if key is found)
+	if (!root["procedural"].isNull())
+		SetProcedural(root["procedural"].asBool(),
+					  root["tone_frequency"].isNull() ? tone_frequency : root["tone_frequency"].asFloat());
+
 }
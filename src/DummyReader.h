@@ -24,6 +24,8 @@
 #include "CacheMemory.h"
 #include "Fraction.h"
 
+class QImage;
+
 namespace openshot
 {
 	/**
@@ -34,6 +36,12 @@ namespace openshot
 	 * A dummy reader can be created with any framerate or samplerate. This is useful in unit
 	 * tests that need to test different framerates or samplerates.
 	 *
+	 * For benchmarks, SetProcedural() generates a different frame for each frame number instead:
+	 * color bars, a box which moves across the image (once every 2 seconds), the frame number
+	 * as a row of black and white cells (its bits, lowest first) along the bottom, and a tone on
+	 * each channel. The frames cost next to nothing to generate, so the performance of timelines,
+	 * effects, caches and writers can be measured without decoding any files.
+	 *
 	 * @note Timeline does buffering by requesting more frames than it
 	 * strictly needs. Thus if you use this DummyReader with a custom
 	 * cache in a Timeline, make sure it has enough
@@ -80,6 +88,10 @@ namespace openshot
 	 * // Clean up
 	 * r.Close();
 	 * cache.Clear()
+	 *
+	 * // Generate 10 minutes of 4K test patterns (with a 440 Hz tone), to benchmark an export
+	 * openshot::DummyReader pattern(openshot::Fraction(60, 1), 3840, 2160, 48000, 2, 600.0);
+	 * pattern.SetProcedural(true);
 	 * @endcode
 	 */
 	class DummyReader : public ReaderBase
@@ -89,10 +101,19 @@ namespace openshot
 		std::shared_ptr<openshot::Frame> image_frame;
         std::shared_ptr<openshot::Frame> last_cached_frame;
 		bool is_open;
+		bool procedural;
+		float tone_frequency;
+		std::shared_ptr<QImage> pattern_background; ///< The color bars of procedural frames (drawn once)
 
 		/// Initialize variables used by constructor
 		void init(Fraction fps, int width, int height, int sample_rate, int channels, float duration);
 
+		/// Draw the color bars of procedural frames
+		void init_pattern();
+
+		/// Generate a procedural frame
+		std::shared_ptr<openshot::Frame> generate_frame(int64_t number);
+
 	public:
 
 		/// Blank constructor for DummyReader, with default settings.
@@ -122,9 +143,17 @@ namespace openshot
 		/// Determine if reader is open or closed
 		bool IsOpen() override { return is_open; };
 
+		/// Determine if the frames are generated test patterns (see SetProcedural)
+		bool IsProcedural() const { return procedural; };
+
 		/// Return the type name of the class
 		std::string Name() override { return "DummyReader"; };
 
+		/// @brief Generate a test pattern (and tone) for each frame, instead of a blank frame (or the frames of the cache)
+		/// @param procedural Generate the frames
+		/// @param tone_frequency The frequency (in Hz) of the tone of the first channel (the next channels are its multiples)
+		void SetProcedural(bool procedural, float tone_frequency = 440.0);
+
 		// Get and Set JSON methods
 		std::string Json() const override; ///< Generate JSON string of this object
 		void SetJson(const std::string value) override; ///< Load JSON string into this object
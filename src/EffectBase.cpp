@@ -239,3 +239,11 @@ std::string EffectBase::ParentClipId() const{
 	else
 		return "";
 }
+
+// Is the timeline of this effect (or of its parent clip) rendering draft quality previews?
+bool EffectBase::IsDraftQuality() {
+	TimelineBase* parent_timeline = ParentTimeline();
+	if (!parent_timeline && clip)
+		parent_timeline = clip->ParentTimeline();
+	return parent_timeline && parent_timeline->IsDraftQuality();
+}
@@ -16,6 +16,7 @@
 #include "ClipBase.h"
 
 #include "Json.h"
+#include "RenderStats.h"
 #include "TrackedObjectBase.h"
 
 #include <memory>
@@ -24,6 +25,8 @@
 
 namespace openshot
 {
+	struct PixelOperation;
+
 	/**
 	 * @brief This struct contains info about an effect, such as the name, video or audio effect, etc...
 	 *
@@ -68,6 +71,9 @@ namespace openshot
 		/// Information about the current effect
 		EffectInfoStruct info;
 
+		/// The time spent applying this effect (if Settings::ENABLE_RENDER_STATS is enabled)
+		openshot::RenderStageStats render_stats;
+
 		/// Display effect information in the standard output stream (stdout)
 		void DisplayInfo(std::ostream* out=&std::cout);
 
@@ -90,6 +96,20 @@ namespace openshot
 		/// Return the ID of this effect's parent clip
 		std::string ParentClipId() const;
 
+		/// @brief Is the timeline of this effect (or of its parent clip) rendering draft quality previews?
+		///
+		/// Expensive effects can use approximate (faster) kernels for draft quality. See Timeline::SetRenderQuality.
+		bool IsDraftQuality();
+
+		/// @brief Get the point-wise color adjustment of this effect (if it has one)
+		///
+		/// Effects which only change each pixel's color (based on that pixel alone) can describe their adjustment
+		/// as a PixelOperation, so that consecutive effects can be applied in a single pass over the image.
+		/// @returns False if this effect can't be described as a point-wise color adjustment (the default).
+		/// @param frame_number The frame number (of the effect) whose keyframe values are used
+		/// @param operation The adjustment (set by this method)
+		virtual bool GetPixelOperation(int64_t frame_number, openshot::PixelOperation& operation) { return false; };
+
 		/// Get the indexes and IDs of all visible objects in the given frame
 		virtual std::string GetVisibleObjects(int64_t frame_number) const {return {}; };
 
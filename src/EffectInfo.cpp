@@ -10,11 +10,77 @@
 //
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
+#include <unordered_map>
+
 #include "EffectInfo.h"
 #include "Effects.h"
 
 using namespace openshot;
 
+namespace {
+	// The info and constructor of an effect (so listing the effects doesn't create them)
+	struct EffectRegistration {
+		const char *class_name;
+		const char *name;
+		const char *description;
+		bool has_video;
+		bool has_audio;
+		EffectBase* (*create)();
+	};
+
+	template <class T>
+	EffectBase* create_effect() { return new T(); }
+
+	// All supported effects (in the order they are listed). The info must match each
+	// effect's init_effect_details() (see the EffectInfo unit tests).
+	const EffectRegistration registered_effects[] = {
+		{"Bars", "Bars", "Add colored bars around your video.", true, false, &create_effect<Bars>},
+		{"Blur", "Blur", "Adjust the blur of the frame's image.", true, false, &create_effect<Blur>},
+		{"Brightness", "Brightness & Contrast", "Adjust the brightness and contrast of the frame's image.", true, false, &create_effect<Brightness>},
+		{"Caption", "Caption", "Add text captions on top of your video.", true, false, &create_effect<Caption>},
+		{"ChromaKey", "Chroma Key (Greenscreen)", "Replaces the color (or chroma) of the frame with transparency (i.e. keys out the color).", true, false, &create_effect<ChromaKey>},
+		{"ColorShift", "Color Shift", "Shift the colors of an image up, down, left, and right (with infinite wrapping).", true, false, &create_effect<ColorShift>},
+		{"Crop", "Crop", "Crop out any part of your video.", true, false, &create_effect<Crop>},
+		{"Deinterlace", "Deinterlace", "Remove interlacing from a video (i.e. even or odd horizontal lines)", true, false, &create_effect<Deinterlace>},
+		{"Hue", "Hue", "Adjust the hue / color of the frame's image.", true, false, &create_effect<Hue>},
+		{"LUT3D", "3D LUT", "Apply a color grading look-up table (.cube file) to the frame's image.", true, false, &create_effect<LUT3D>},
+		{"Mask", "Alpha Mask / Wipe Transition", "Uses a grayscale mask image to gradually wipe / transition between 2 images.", true, false, &create_effect<Mask>},
+		{"Negate", "Negative", "Negates the colors, producing a negative of the image.", true, false, &create_effect<Negate>},
+		{"Pixelate", "Pixelate", "Pixelate (increase or decrease) the number of visible pixels.", true, false, &create_effect<Pixelate>},
+		{"Saturation", "Color Saturation", "Adjust the color saturation.", true, false, &create_effect<Saturation>},
+		{"Shift", "Shift", "Shift the image up, down, left, and right (with infinite wrapping).", true, false, &create_effect<Shift>},
+		{"Wave", "Wave", "Distort the frame's image into a wave pattern.", true, false, &create_effect<Wave>},
+		/* Audio */
+		{"Noise", "Noise", "Random signal having equal intensity at different frequencies.", false, true, &create_effect<Noise>},
+		{"Delay", "Delay", "Adjust the synchronism between the audio and video track.", false, true, &create_effect<Delay>},
+		{"Echo", "Echo", "Reflection of sound with a delay after the direct sound.", false, true, &create_effect<Echo>},
+		{"Distortion", "Distortion", "Alter the audio by clipping the signal.", false, true, &create_effect<Distortion>},
+		{"ParametricEQ", "Parametric EQ", "Filter that allows you to adjust the volume level of a frequency in the audio track.", false, true, &create_effect<ParametricEQ>},
+		{"Compressor", "Compressor", "Reduce the volume of loud sounds or amplify quiet sounds.", false, true, &create_effect<Compressor>},
+		{"Expander", "Expander", "Louder parts of audio becomes relatively louder and quieter parts becomes quieter.", false, true, &create_effect<Expander>},
+		{"Robotization", "Robotization", "Transform the voice present in an audio track into a robotic voice effect.", false, true, &create_effect<Robotization>},
+		{"Whisperization", "Whisperization", "Transform the voice present in an audio track into a whispering voice effect.", false, true, &create_effect<Whisperization>},
+	#ifdef USE_OPENCV
+		{"Stabilizer", "Stabilizer", "Stabilize video clip to remove undesired shaking and jitter.", true, false, &create_effect<Stabilizer>},
+		{"Tracker", "Tracker", "Track the selected bounding box through the video.", true, false, &create_effect<Tracker>},
+		{"ObjectDetection", "Object Detector", "Detect objects through the video.", true, false, &create_effect<ObjectDetection>},
+	#endif
+	};
+
+	// Find a registered effect by its class name
+	const EffectRegistration* find_effect(const std::string& class_name) {
+		static const std::unordered_map<std::string, const EffectRegistration*> effects_by_class_name = [] {
+			std::unordered_map<std::string, const EffectRegistration*> effects;
+			for (const EffectRegistration& effect : registered_effects)
+				effects.emplace(effect.class_name, &effect);
+			return effects;
+		}();
+
+		auto effect = effects_by_class_name.find(class_name);
+		return (effect == effects_by_class_name.end()) ? nullptr : effect->second;
+	}
+}
+
 // Generate JSON string of this object
 std::string EffectInfo::Json() {
 
@@ -25,88 +91,9 @@ std::string EffectInfo::Json() {
 // Create a new effect instance
 EffectBase* EffectInfo::CreateEffect(std::string effect_type) {
 	// Init the matching effect object
-	if (effect_type == "Bars")
-		return new Bars();
-
-	if (effect_type == "Blur")
-		return new Blur();
-
-	else if (effect_type == "Brightness")
-		return new Brightness();
-
-	else if (effect_type == "Caption")
-		return new Caption();
-
-	else if (effect_type == "ChromaKey")
-		return new ChromaKey();
-
-	else if (effect_type == "ColorShift")
-		return new ColorShift();
-
-	else if (effect_type == "Crop")
-		return new Crop();
-
-	else if (effect_type == "Deinterlace")
-		return new Deinterlace();
-
-	else if (effect_type == "Hue")
-		return new Hue();
-
-	else if (effect_type == "Mask")
-		return new Mask();
-
-	else if (effect_type == "Negate")
-		return new Negate();
-
-	else if (effect_type == "Pixelate")
-		return new Pixelate();
-
-	else if (effect_type == "Saturation")
-		return new Saturation();
-
-	else if (effect_type == "Shift")
-		return new Shift();
-
-	else if (effect_type == "Wave")
-		return new Wave();
-
-	else if(effect_type == "Noise")
-		return new Noise();
-
-	else if(effect_type == "Delay")
-		return new Delay();
-
-	else if(effect_type == "Echo")
-		return new Echo();
-
-	else if(effect_type == "Distortion")
-		return new Distortion();
-
-	else if(effect_type == "ParametricEQ")
-		return new ParametricEQ();
-
-	else if(effect_type == "Compressor")
-		return new Compressor();
-
-	else if(effect_type == "Expander")
-		return new Expander();
-
-	else if(effect_type == "Robotization")
-		return new Robotization();
-
-	else if(effect_type == "Whisperization")
-		return new Whisperization();
-
-	#ifdef USE_OPENCV
-	else if(effect_type == "Stabilizer")
-		return new Stabilizer();
-
-	else if(effect_type == "Tracker")
-		return new Tracker();
-
-	else if(effect_type == "ObjectDetection")
-		return new ObjectDetection();
-	#endif
+	const EffectRegistration* effect = find_effect(effect_type);
+	if (effect)
+		return effect->create();
 
 	return NULL;
 }
@@ -117,38 +104,16 @@ Json::Value EffectInfo::JsonValue() {
 	// Create root json object
 	Json::Value root;
 
-	// Append info JSON from each supported effect
-	root.append(Bars().JsonInfo());
-	root.append(Blur().JsonInfo());
-	root.append(Brightness().JsonInfo());
-	root.append(Caption().JsonInfo());
-	root.append(ChromaKey().JsonInfo());
-	root.append(ColorShift().JsonInfo());
-	root.append(Crop().JsonInfo());
-	root.append(Deinterlace().JsonInfo());
-	root.append(Hue().JsonInfo());
-	root.append(Mask().JsonInfo());
-	root.append(Negate().JsonInfo());
-	root.append(Pixelate().JsonInfo());
-	root.append(Saturation().JsonInfo());
-	root.append(Shift().JsonInfo());
-	root.append(Wave().JsonInfo());
-	/* Audio */
-	root.append(Noise().JsonInfo());
-	root.append(Delay().JsonInfo());
-	root.append(Echo().JsonInfo());
-	root.append(Distortion().JsonInfo());
-	root.append(ParametricEQ().JsonInfo());
-	root.append(Compressor().JsonInfo());
-	root.append(Expander().JsonInfo());
-	root.append(Robotization().JsonInfo());
-	root.append(Whisperization().JsonInfo());
-
-	#ifdef USE_OPENCV
-	root.append(Stabilizer().JsonInfo());
-	root.append(Tracker().JsonInfo());
-	root.append(ObjectDetection().JsonInfo());
-	#endif
+	// Append info JSON from each supported effect (the same as its JsonInfo(), without creating it)
+	for (const EffectRegistration& effect : registered_effects) {
+		Json::Value info;
+		info["name"] = effect.name;
+		info["class_name"] = effect.class_name;
+		info["description"] = effect.description;
+		info["has_video"] = effect.has_video;
+		info["has_audio"] = effect.has_audio;
+		root.append(info);
+	}
 
 	// return JsonValue
 	return root;
@@ -23,7 +23,9 @@ namespace openshot
 	 * @brief This class returns a listing of all effects supported by libopenshot
 	 *
 	 * Use this class to return a listing of all supported effects, and their
-	 * descriptions.
+	 * descriptions. The effects are registered in a static table (with their info
+	 * and a constructor), so listing them doesn't create any effect (i.e. loading
+	 * the models of the OpenCV effects), and CreateEffect() is a single lookup.
 	 */
 	class EffectInfo
 	{
@@ -64,6 +64,36 @@ enum VolumeMixType
 	VOLUME_MIX_REDUCE 	///< Reduce volume by about %25, and then mix (louder, but could cause pops if the sum exceeds 100%)
 };
 
+/// This enumeration determines how the audio of a time mapped clip is stretched
+enum TimeStretchType
+{
+	TIME_STRETCH_RESAMPLE,      	///< Resample the audio (the pitch changes with the speed, like a tape)
+	TIME_STRETCH_PRESERVE_PITCH 	///< Stretch the audio with WSOLA (the pitch does not change with the speed)
+};
+
+/// This enumeration determines the quality (and speed) of resampled audio
+enum ResampleQuality
+{
+	RESAMPLE_QUALITY_DRAFT,  	///< Short filters (fastest, some aliasing, i.e. for previews)
+	RESAMPLE_QUALITY_NORMAL, 	///< Medium filters (no audible aliasing)
+	RESAMPLE_QUALITY_HIGH    	///< Long filters with a steep cutoff (slowest, i.e. for exports)
+};
+
+/// This enumeration determines which frames a memory cache evicts first, once it exceeds its max bytes
+enum CacheEvictionPolicy
+{
+	CACHE_EVICT_LRU,      	///< The least recently added or refreshed frame
+	CACHE_EVICT_2Q,       	///< Frames used only once first (so a scan through many frames does not evict frames which are used again)
+	CACHE_EVICT_PLAYHEAD  	///< The frame farthest from the playhead (frames behind the playhead count double), see CacheBase::SetPlayhead()
+};
+
+/// This enumeration determines the quality of the frames rendered by a Timeline
+enum RenderQuality
+{
+	RENDER_QUALITY_FINAL,	///< Full quality (for exporting, and still previews)
+	RENDER_QUALITY_DRAFT 	///< Faster, lower quality previews (i.e. while scrubbing): no deblocking, nearest neighbor scaling, no antialiasing, and approximate effects
+};
+
 
 /// This enumeration determines the distortion type of Distortion Effect.
 enum DistortionType
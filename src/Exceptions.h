@@ -153,6 +153,21 @@ namespace openshot {
 		virtual ~ErrorEncodingVideo() noexcept {}
 	};
 
+	/// Exception when a frame request is cancelled (see openshot::FrameRequest)
+	class FrameRequestCancelled : public FrameExceptionBase
+	{
+	public:
+		/**
+		 * @brief Constructor
+		 *
+		 * @param message A message to accompany the exception
+		 * @param frame_number The frame number being processed
+		 */
+		FrameRequestCancelled(std::string message, int64_t frame_number=-1)
+			: FrameExceptionBase(message, frame_number) { }
+		virtual ~FrameRequestCancelled() noexcept {}
+	};
+
 	/// Exception when an invalid # of audio channels are detected
 	class InvalidChannels : public FileExceptionBase
 	{
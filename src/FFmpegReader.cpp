@@ -13,14 +13,28 @@
 //
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
+#include <algorithm>
 #include <thread>	// for std::this_thread::sleep_for
 #include <chrono>	// for std::chrono::milliseconds
+#include <fstream>
+#include <iterator>
 #include <unistd.h>
 
 #include "FFmpegUtilities.h"
 
 #include "FFmpegReader.h"
+#include "CacheBudget.h"
+#include "DecoderPool.h"
 #include "Exceptions.h"
+#include "FrameRequest.h"
+#include "HardwareDevices.h"
+#include "ImageBufferPool.h"
+#include "PixelKernels.h"
+#include "ProbeCache.h"
+#include "RenderStats.h"
+#include "RenderTrace.h"
+#include "SourceFrameCache.h"
+#include "ThreadAffinity.h"
 #include "Timeline.h"
 #include "ZmqLogger.h"
 
@@ -74,8 +88,11 @@ FFmpegReader::FFmpegReader(const std::string &path, bool inspect_reader)
 		  seek_audio_frame_found(0), seek_video_frame_found(0),is_duration_known(false), largest_frame_processed(0),
 		  current_video_frame(0), packet(NULL), max_concurrent_frames(OPEN_MP_NUM_PROCESSORS), audio_pts(0),
 		  video_pts(0), pFormatCtx(NULL), videoStream(-1), audioStream(-1), pCodecCtx(NULL), aCodecCtx(NULL),
-		  pStream(NULL), aStream(NULL), pFrame(NULL), previous_packet_location{-1,0},
-		  hold_packet(false) {
+		  pStream(NULL), aStream(NULL), pFrame(NULL), img_convert_ctx(NULL), avr(NULL), audio_converted(NULL),
+		  audio_converted_linesize(0), audio_converted_capacity(0), previous_packet_location{-1,0},
+		  hold_packet(false), decode_ahead_stop(false), decode_ahead_next(0), decode_ahead_target(0),
+		  last_requested_frame(0), sequential_requests(0), sequential_hint(false), slice_threading(false), open_hardware_decoder(0), open_decoder_threads(0), scrub_seeks(0), sequential_decodes(0), reverse_requests(0), reverse_chunk_start(0), reverse_chunk_end(0),
+		  reverse_prefetch_frame(0), reverse_prefetch_requested(0), reverse_cache_enlarged(false), is_estimated_length(false), probe_stop(false), probe_done(false) {
 
 	// Initialize FFMpeg, and register all formats and codecs
 	AV_REGISTER_ALL
@@ -90,10 +107,15 @@ FFmpegReader::FFmpegReader(const std::string &path, bool inspect_reader)
 	working_cache.SetMaxBytesFromInfo(max_concurrent_frames * info.fps.ToDouble() * 2, info.width, info.height, info.sample_rate, info.channels);
 	final_cache.SetMaxBytesFromInfo(max_concurrent_frames * 2, info.width, info.height, info.sample_rate, info.channels);
 
-	// Open and Close the reader, to populate its attributes (such as height, width, etc...)
-	if (inspect_reader) {
+	// Open and Close the reader, to populate its attributes (such as height, width, etc...),
+	// unless this file was already probed (and hasn't changed since)
+	if (inspect_reader && !ProbeCache::Instance()->Lookup("FFmpegReader", path, info)) {
 		Open();
 		Close();
+
+		// An estimated length is stored once the frames are counted (see CountFrames)
+		if (!is_estimated_length)
+			ProbeCache::Instance()->Insert("FFmpegReader", path, info);
 	}
 }
 
@@ -101,6 +123,8 @@ FFmpegReader::~FFmpegReader() {
 	if (is_open)
 		// Auto close reader if not already done
 		Close();
+	StopDecodeAhead();
+	StopProbe();
 }
 
 // This struct holds the associated video frame and starting sample # for an audio packet.
@@ -180,7 +204,7 @@ static enum AVPixelFormat get_hw_dec_format(AVCodecContext *ctx, const enum AVPi
 				break;
 		}
 	}
-	ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::get_hw_dec_format (Unable to decode this file using hardware decode)");
+	ZMQ_DEBUG("FFmpegReader::get_hw_dec_format (Unable to decode this file using hardware decode)");
 	return AV_PIX_FMT_NONE;
 }
 
@@ -210,20 +234,65 @@ void FFmpegReader::Open() {
 		// Prevent async calls to the following code
 		const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
 
+		// Start the decoder threads on the NUMA node of the render (if any, see Settings::NUMA_NODE)
+		ScopedNodeAffinity affinity;
+
 		// Initialize format context
 		pFormatCtx = NULL;
+		// The parent timeline can override the global thread and decoder settings
+		TimelineBase *timeline = ParentTimeline();
+		const int hardware_decoder = timeline ? timeline->HardwareDecoder() : openshot::Settings::Instance()->HARDWARE_DECODER;
+		const int decoder_threads = std::min(timeline ? timeline->FFThreads() : FF_NUM_PROCESSORS, 16);
 		{
-			hw_de_on = (openshot::Settings::Instance()->HARDWARE_DECODER == 0 ? 0 : 1);
-			ZmqLogger::Instance()->AppendDebugMethod("Decode hardware acceleration settings", "hw_de_on", hw_de_on, "HARDWARE_DECODER", openshot::Settings::Instance()->HARDWARE_DECODER);
+			hw_de_on = (hardware_decoder == 0 ? 0 : 1);
+			ZMQ_DEBUG("Decode hardware acceleration settings", "hw_de_on", hw_de_on, "HARDWARE_DECODER", hardware_decoder);
 		}
 
-		// Open video file
-		if (avformat_open_input(&pFormatCtx, path.c_str(), NULL, NULL) != 0)
-			throw InvalidFile("File could not be opened.", path);
+		// Re-use the demuxer and decoders of a closed reader of this file (if any, see DecoderPool)
+		std::unique_ptr<DecoderContexts> pooled = DecoderPool::Instance()->Acquire(path, hardware_decoder, decoder_threads, slice_threading);
+		const bool warm = (pooled != nullptr);
+		open_hardware_decoder = hardware_decoder;
+		open_decoder_threads = decoder_threads;
+		if (warm) {
+			pFormatCtx = pooled->format_context;
+			pCodecCtx = pooled->video_context;
+			aCodecCtx = pooled->audio_context;
+#if USE_HW_ACCEL
+			hw_device_ctx = pooled->hw_device_context;
+			hw_de_supported = pooled->hw_de_supported;
+			hw_device_index = pooled->hw_device_index;
+#endif
+			read_ahead_io = std::move(pooled->read_ahead_io);
+			pooled->Detach();
+		} else {
+			// Read the file with a background read-ahead thread (if enabled, and the file is a local or mounted file)
+			openshot::Settings *settings = openshot::Settings::Instance();
+			if (settings->ENABLE_READ_AHEAD_IO) {
+				const int block_size = 1024 * 1024;
+				read_ahead_io.reset(new ReadAheadIO(path, block_size, std::max(1, settings->READ_AHEAD_MB), settings->READ_AHEAD_CACHE_PATH));
+				pFormatCtx = read_ahead_io->Open() ? avformat_alloc_context() : NULL;
+				if (pFormatCtx) {
+					pFormatCtx->pb = read_ahead_io->Context();
+					pFormatCtx->flags |= AVFMT_FLAG_CUSTOM_IO;
+				} else {
+					read_ahead_io.reset();
+				}
+			}
+
+			// Open video file
+			if (avformat_open_input(&pFormatCtx, path.c_str(), NULL, NULL) != 0) {
+				read_ahead_io.reset();
+				throw InvalidFile("File could not be opened.", path);
+			}
+
+			// Analyze less of the streams (the container's metadata is used for the rest)
+			if (openshot::Settings::Instance()->ENABLE_FAST_PROBE)
+				pFormatCtx->max_analyze_duration = AV_TIME_BASE / 2;
 
-		// Retrieve stream information
-		if (avformat_find_stream_info(pFormatCtx, NULL) < 0)
-			throw NoStreamsFound("No streams found in file.", path);
+			// Retrieve stream information
+			if (avformat_find_stream_info(pFormatCtx, NULL) < 0)
+				throw NoStreamsFound("No streams found in file.", path);
+		}
 
 		videoStream = -1;
 		audioStream = -1;
@@ -264,67 +333,63 @@ void FFmpegReader::Open() {
 
 			// Get codec and codec context from stream
 			const AVCodec *pCodec = avcodec_find_decoder(codecId);
-			AVDictionary *opts = NULL;
-			int retry_decode_open = 2;
-			// If hw accel is selected but hardware cannot handle repeat with software decoding
-			do {
-				pCodecCtx = AV_GET_CODEC_CONTEXT(pStream, pCodec);
+			// Open the video decoder (unless it is re-used)
+			if (!warm) {
+				AVDictionary *opts = NULL;
+				int retry_decode_open = 2;
 #if USE_HW_ACCEL
-				if (hw_de_on && (retry_decode_open==2)) {
-					// Up to here no decision is made if hardware or software decode
-					hw_de_supported = IsHardwareDecodeSupported(pCodecCtx->codec_id);
-				}
+				// What was found out the last time a GPU opened this kind of stream (see HardwareDevices::DecodeSupport)
+				int cached_support = -1;
+				int decode_codec_id = 0, decode_profile = 0, decode_width = 0, decode_height = 0;
 #endif
-				retry_decode_open = 0;
+				// If hw accel is selected but hardware cannot handle repeat with software decoding
+				do {
+					pCodecCtx = AV_GET_CODEC_CONTEXT(pStream, pCodec);
+#if USE_HW_ACCEL
+					if (hw_de_on && (retry_decode_open==2)) {
+						// Up to here no decision is made if hardware or software decode
+						hw_de_supported = IsHardwareDecodeSupported(pCodecCtx->codec_id);
+					}
+					// The kind of stream, as known before opening the decoder (which is what the answer is cached for)
+					decode_codec_id = pCodecCtx->codec_id;
+					decode_profile = pCodecCtx->profile;
+					decode_width = pCodecCtx->width;
+					decode_height = pCodecCtx->height;
+#endif
+					retry_decode_open = 0;
 
-				// Set number of threads equal to number of processors (not to exceed 16)
-				pCodecCtx->thread_count = std::min(FF_NUM_PROCESSORS, 16);
+					// Set number of threads equal to number of processors (not to exceed 16)
+					pCodecCtx->thread_count = decoder_threads;
 
-				if (pCodec == NULL) {
-					throw InvalidCodec("A valid video codec could not be found for this file.", path);
-				}
+					if (pCodec == NULL) {
+						throw InvalidCodec("A valid video codec could not be found for this file.", path);
+					}
 
-				// Init options
-				av_dict_set(&opts, "strict", "experimental", 0);
+					// Init options
+					av_dict_set(&opts, "strict", "experimental", 0);
 #if USE_HW_ACCEL
-				if (hw_de_on && hw_de_supported) {
-					// Open Hardware Acceleration
-					int i_decoder_hw = 0;
-					char adapter[256];
-					char *adapter_ptr = NULL;
-					int adapter_num;
-					adapter_num = openshot::Settings::Instance()->HW_DE_DEVICE_SET;
-					fprintf(stderr, "Hardware decoding device number: %d\n", adapter_num);
-
-					// Set hardware pix format (callback)
-					pCodecCtx->get_format = get_hw_dec_format;
-
-					if (adapter_num < 3 && adapter_num >=0) {
+					if (hw_de_on && hw_de_supported) {
+						// Open Hardware Acceleration
+						int i_decoder_hw = hardware_decoder;
 #if defined(__linux__)
-						snprintf(adapter,sizeof(adapter),"/dev/dri/renderD%d", adapter_num+128);
-						adapter_ptr = adapter;
-						i_decoder_hw = openshot::Settings::Instance()->HARDWARE_DECODER;
 						switch (i_decoder_hw) {
-								case 1:
-									hw_de_av_device_type = AV_HWDEVICE_TYPE_VAAPI;
-									break;
-								case 2:
-									hw_de_av_device_type = AV_HWDEVICE_TYPE_CUDA;
-									break;
-								case 6:
-									hw_de_av_device_type = AV_HWDEVICE_TYPE_VDPAU;
-									break;
-								case 7:
-									hw_de_av_device_type = AV_HWDEVICE_TYPE_QSV;
-									break;
-								default:
-									hw_de_av_device_type = AV_HWDEVICE_TYPE_VAAPI;
-									break;
-							}
-
+							case 1:
+								hw_de_av_device_type = AV_HWDEVICE_TYPE_VAAPI;
+								break;
+							case 2:
+								hw_de_av_device_type = AV_HWDEVICE_TYPE_CUDA;
+								break;
+							case 6:
+								hw_de_av_device_type = AV_HWDEVICE_TYPE_VDPAU;
+								break;
+							case 7:
+								hw_de_av_device_type = AV_HWDEVICE_TYPE_QSV;
+								break;
+							default:
+								hw_de_av_device_type = AV_HWDEVICE_TYPE_VAAPI;
+								break;
+						}
 #elif defined(_WIN32)
-						adapter_ptr = NULL;
-						i_decoder_hw = openshot::Settings::Instance()->HARDWARE_DECODER;
 						switch (i_decoder_hw) {
 							case 2:
 								hw_de_av_device_type = AV_HWDEVICE_TYPE_CUDA;
@@ -343,8 +408,6 @@ void FFmpegReader::Open() {
 								break;
 						}
 #elif defined(__APPLE__)
-						adapter_ptr = NULL;
-						i_decoder_hw = openshot::Settings::Instance()->HARDWARE_DECODER;
 						switch (i_decoder_hw) {
 							case 5:
 								hw_de_av_device_type =  AV_HWDEVICE_TYPE_VIDEOTOOLBOX;
@@ -358,152 +421,150 @@ void FFmpegReader::Open() {
 						}
 #endif
 
-					} else {
-						adapter_ptr = NULL; // Just to be sure
-					}
-
-					// Check if it is there and writable
-#if defined(__linux__)
-					if( adapter_ptr != NULL && access( adapter_ptr, W_OK ) == 0 ) {
-#elif defined(_WIN32)
-					if( adapter_ptr != NULL ) {
-#elif defined(__APPLE__)
-					if( adapter_ptr != NULL ) {
-#endif
-						ZmqLogger::Instance()->AppendDebugMethod("Decode Device present using device");
-					}
-					else {
-						adapter_ptr = NULL;  // use default
-						ZmqLogger::Instance()->AppendDebugMethod("Decode Device not present using default");
-					}
-
-					hw_device_ctx = NULL;
-					// Here the first hardware initialisations are made
-					if (av_hwdevice_ctx_create(&hw_device_ctx, hw_de_av_device_type, adapter_ptr, NULL, 0) >= 0) {
-						if (!(pCodecCtx->hw_device_ctx = av_buffer_ref(hw_device_ctx))) {
-							throw InvalidCodec("Hardware device reference create failed.", path);
+						// Take a decode session on one of the GPUs (see Settings::HW_DEVICE_POLICY)
+						hw_device_ctx = NULL;
+						hw_device_index = HardwareDevices::Instance()->Acquire(HARDWARE_DECODE_SESSION);
+						if (hw_device_index >= 0) {
+							const std::string adapter = HardwareDevices::DeviceName(hw_de_av_device_type, hw_device_index);
+							ZMQ_DEBUG("Decode Device [" + adapter + "]", "hw_device_index", hw_device_index);
+
+							// Skip the GPU if it could not decode this kind of stream before (without creating a device to find out again)
+							cached_support = HardwareDevices::Instance()->DecodeSupport(hw_de_av_device_type, hw_device_index,
+								decode_codec_id, decode_profile, decode_width, decode_height);
+							if (cached_support != 0) {
+								// Here the first hardware initialisations are made (the device context is shared by the readers on this GPU)
+								hw_device_ctx = HardwareDevices::Instance()->DeviceContext(hw_de_av_device_type, hw_device_index);
+							}
 						}
 
-						/*
-						av_buffer_unref(&ist->hw_frames_ctx);
-						ist->hw_frames_ctx = av_hwframe_ctx_alloc(hw_device_ctx);
-						if (!ist->hw_frames_ctx) {
-							av_log(avctx, AV_LOG_ERROR, "Error creating a CUDA frames context\n");
-							return AVERROR(ENOMEM);
+						if (hw_device_ctx) {
+							// Set hardware pix format (callback)
+							pCodecCtx->get_format = get_hw_dec_format;
+							if (!(pCodecCtx->hw_device_ctx = av_buffer_ref(hw_device_ctx))) {
+								throw InvalidCodec("Hardware device reference create failed.", path);
+							}
 						}
-
-						frames_ctx = (AVHWFramesContext*)ist->hw_frames_ctx->data;
-
-						frames_ctx->format = AV_PIX_FMT_CUDA;
-						frames_ctx->sw_format = avctx->sw_pix_fmt;
-						frames_ctx->width = avctx->width;
-						frames_ctx->height = avctx->height;
-
-						av_log(avctx, AV_LOG_DEBUG, "Initializing CUDA frames context: sw_format = %s, width = %d, height = %d\n",
-								av_get_pix_fmt_name(frames_ctx->sw_format), frames_ctx->width, frames_ctx->height);
-
-
-						ret = av_hwframe_ctx_init(pCodecCtx->hw_device_ctx);
-						ret = av_hwframe_ctx_init(ist->hw_frames_ctx);
-						if (ret < 0) {
-						  av_log(avctx, AV_LOG_ERROR, "Error initializing a CUDA frame pool\n");
-						  return ret;
+						else {
+							// Every GPU is busy (or the device could not be created), so decode in software
+							ZMQ_DEBUG("Decode Device not available, using software decoding", "hw_device_index", hw_device_index);
+							HardwareDevices::Instance()->Release(HARDWARE_DECODE_SESSION, hw_device_index);
+							hw_device_index = -1;
+							hw_de_supported = 0;
 						}
-						*/
-					}
-					else {
-						  throw InvalidCodec("Hardware device create failed.", path);
 					}
-				}
 #endif // USE_HW_ACCEL
 
-				// Disable per-frame threading for album arts
-				// Using FF_THREAD_FRAME adds one frame decoding delay per thread,
-				// but there's only one frame in this case.
-				if (HasAlbumArt())
-				{
-					pCodecCtx->thread_type &= ~FF_THREAD_FRAME;
-				}
+					// Disable per-frame threading for album arts
+					// Using FF_THREAD_FRAME adds one frame decoding delay per thread,
+					// but there's only one frame in this case.
+					if (HasAlbumArt())
+					{
+						pCodecCtx->thread_type &= ~FF_THREAD_FRAME;
+					}
 
-				// Open video codec
-				int avcodec_return = avcodec_open2(pCodecCtx, pCodec, &opts);
-				if (avcodec_return < 0) {
-					std::stringstream avcodec_error_msg;
-					avcodec_error_msg << "A video codec was found, but could not be opened. Error: " << av_err2string(avcodec_return);
-					throw InvalidCodec(avcodec_error_msg.str(), path);
-				}
+					// Use slice threads only (no frame delay) while seeking, or if requested
+					const int thread_type = openshot::Settings::Instance()->DECODER_THREAD_TYPE;
+					if (thread_type == 2 || (thread_type == 0 && slice_threading))
+					{
+						pCodecCtx->thread_type &= ~FF_THREAD_FRAME;
+					}
+
+					// Open video codec
+					int avcodec_return = avcodec_open2(pCodecCtx, pCodec, &opts);
+					if (avcodec_return < 0) {
+						std::stringstream avcodec_error_msg;
+						avcodec_error_msg << "A video codec was found, but could not be opened. Error: " << av_err2string(avcodec_return);
+						throw InvalidCodec(avcodec_error_msg.str(), path);
+					}
 
 #if USE_HW_ACCEL
-				if (hw_de_on && hw_de_supported) {
-					AVHWFramesConstraints *constraints = NULL;
-					void *hwconfig = NULL;
-					hwconfig = av_hwdevice_hwconfig_alloc(hw_device_ctx);
+					if (hw_de_on && hw_de_supported && cached_support == 1) {
+						// This GPU already decoded this kind of stream, so don't query its constraints again
+						ZMQ_DEBUG("\nDecode hardware acceleration is used (cached)\n", "Frame width :", pCodecCtx->coded_width, "Frame height :", pCodecCtx->coded_height);
+					}
+					else if (hw_de_on && hw_de_supported) {
+						AVHWFramesConstraints *constraints = NULL;
+						void *hwconfig = NULL;
+						hwconfig = av_hwdevice_hwconfig_alloc(hw_device_ctx);
 
-// TODO: needs va_config!
+	// TODO: needs va_config!
 #if ENABLE_VAAPI
-					((AVVAAPIHWConfig *)hwconfig)->config_id = ((VAAPIDecodeContext *)(pCodecCtx->priv_data))->va_config;
-					constraints = av_hwdevice_get_hwframe_constraints(hw_device_ctx,hwconfig);
+						((AVVAAPIHWConfig *)hwconfig)->config_id = ((VAAPIDecodeContext *)(pCodecCtx->priv_data))->va_config;
+						constraints = av_hwdevice_get_hwframe_constraints(hw_device_ctx,hwconfig);
 #endif // ENABLE_VAAPI
-					if (constraints) {
-						if (pCodecCtx->coded_width < constraints->min_width  	||
-								pCodecCtx->coded_height < constraints->min_height ||
-								pCodecCtx->coded_width > constraints->max_width  	||
-								pCodecCtx->coded_height > constraints->max_height) {
-							ZmqLogger::Instance()->AppendDebugMethod("DIMENSIONS ARE TOO LARGE for hardware acceleration\n");
-							hw_de_supported = 0;
-							retry_decode_open = 1;
-							AV_FREE_CONTEXT(pCodecCtx);
-							if (hw_device_ctx) {
-								av_buffer_unref(&hw_device_ctx);
-								hw_device_ctx = NULL;
+						if (constraints) {
+							if (pCodecCtx->coded_width < constraints->min_width  	||
+									pCodecCtx->coded_height < constraints->min_height ||
+									pCodecCtx->coded_width > constraints->max_width  	||
+									pCodecCtx->coded_height > constraints->max_height) {
+								ZMQ_DEBUG("DIMENSIONS ARE TOO LARGE for hardware acceleration\n");
+								HardwareDevices::Instance()->SetDecodeSupport(hw_de_av_device_type, hw_device_index,
+									decode_codec_id, decode_profile, decode_width, decode_height, false);
+								hw_de_supported = 0;
+								retry_decode_open = 1;
+								AV_FREE_CONTEXT(pCodecCtx);
+								if (hw_device_ctx) {
+									av_buffer_unref(&hw_device_ctx);
+									hw_device_ctx = NULL;
+								}
+								HardwareDevices::Instance()->Release(HARDWARE_DECODE_SESSION, hw_device_index);
+								hw_device_index = -1;
 							}
-						}
-						else {
-							// All is just peachy
-							ZmqLogger::Instance()->AppendDebugMethod("\nDecode hardware acceleration is used\n", "Min width :", constraints->min_width, "Min Height :", constraints->min_height, "MaxWidth :", constraints->max_width, "MaxHeight :", constraints->max_height, "Frame width :", pCodecCtx->coded_width, "Frame height :", pCodecCtx->coded_height);
-							retry_decode_open = 0;
-						}
-						av_hwframe_constraints_free(&constraints);
-						if (hwconfig) {
-							av_freep(&hwconfig);
-						}
-					}
-					else {
-						int max_h, max_w;
-						//max_h = ((getenv( "LIMIT_HEIGHT_MAX" )==NULL) ? MAX_SUPPORTED_HEIGHT : atoi(getenv( "LIMIT_HEIGHT_MAX" )));
-						max_h = openshot::Settings::Instance()->DE_LIMIT_HEIGHT_MAX;
-						//max_w = ((getenv( "LIMIT_WIDTH_MAX" )==NULL) ? MAX_SUPPORTED_WIDTH : atoi(getenv( "LIMIT_WIDTH_MAX" )));
-						max_w = openshot::Settings::Instance()->DE_LIMIT_WIDTH_MAX;
-						ZmqLogger::Instance()->AppendDebugMethod("Constraints could not be found using default limit\n");
-						//cerr << "Constraints could not be found using default limit\n";
-						if (pCodecCtx->coded_width < 0  	||
-								pCodecCtx->coded_height < 0 	||
-								pCodecCtx->coded_width > max_w ||
-								pCodecCtx->coded_height > max_h ) {
-							ZmqLogger::Instance()->AppendDebugMethod("DIMENSIONS ARE TOO LARGE for hardware acceleration\n", "Max Width :", max_w, "Max Height :", max_h, "Frame width :", pCodecCtx->coded_width, "Frame height :", pCodecCtx->coded_height);
-							hw_de_supported = 0;
-							retry_decode_open = 1;
-							AV_FREE_CONTEXT(pCodecCtx);
-							if (hw_device_ctx) {
-								av_buffer_unref(&hw_device_ctx);
-								hw_device_ctx = NULL;
+							else {
+								// All is just peachy
+								ZMQ_DEBUG("\nDecode hardware acceleration is used\n", "Min width :", constraints->min_width, "Min Height :", constraints->min_height, "MaxWidth :", constraints->max_width, "MaxHeight :", constraints->max_height, "Frame width :", pCodecCtx->coded_width, "Frame height :", pCodecCtx->coded_height);
+								HardwareDevices::Instance()->SetDecodeSupport(hw_de_av_device_type, hw_device_index,
+									decode_codec_id, decode_profile, decode_width, decode_height, true);
+								retry_decode_open = 0;
+							}
+							av_hwframe_constraints_free(&constraints);
+							if (hwconfig) {
+								av_freep(&hwconfig);
 							}
 						}
 						else {
-							ZmqLogger::Instance()->AppendDebugMethod("\nDecode hardware acceleration is used\n", "Max Width :", max_w, "Max Height :", max_h, "Frame width :", pCodecCtx->coded_width, "Frame height :", pCodecCtx->coded_height);
-							retry_decode_open = 0;
+							int max_h, max_w;
+							//max_h = ((getenv( "LIMIT_HEIGHT_MAX" )==NULL) ? MAX_SUPPORTED_HEIGHT : atoi(getenv( "LIMIT_HEIGHT_MAX" )));
+							max_h = openshot::Settings::Instance()->DE_LIMIT_HEIGHT_MAX;
+							//max_w = ((getenv( "LIMIT_WIDTH_MAX" )==NULL) ? MAX_SUPPORTED_WIDTH : atoi(getenv( "LIMIT_WIDTH_MAX" )));
+							max_w = openshot::Settings::Instance()->DE_LIMIT_WIDTH_MAX;
+							ZMQ_DEBUG("Constraints could not be found using default limit\n");
+							//cerr << "Constraints could not be found using default limit\n";
+							if (pCodecCtx->coded_width < 0  	||
+									pCodecCtx->coded_height < 0 	||
+									pCodecCtx->coded_width > max_w ||
+									pCodecCtx->coded_height > max_h ) {
+								ZMQ_DEBUG("DIMENSIONS ARE TOO LARGE for hardware acceleration\n", "Max Width :", max_w, "Max Height :", max_h, "Frame width :", pCodecCtx->coded_width, "Frame height :", pCodecCtx->coded_height);
+								HardwareDevices::Instance()->SetDecodeSupport(hw_de_av_device_type, hw_device_index,
+									decode_codec_id, decode_profile, decode_width, decode_height, false);
+								hw_de_supported = 0;
+								retry_decode_open = 1;
+								AV_FREE_CONTEXT(pCodecCtx);
+								if (hw_device_ctx) {
+									av_buffer_unref(&hw_device_ctx);
+									hw_device_ctx = NULL;
+								}
+								HardwareDevices::Instance()->Release(HARDWARE_DECODE_SESSION, hw_device_index);
+								hw_device_index = -1;
+							}
+							else {
+								ZMQ_DEBUG("\nDecode hardware acceleration is used\n", "Max Width :", max_w, "Max Height :", max_h, "Frame width :", pCodecCtx->coded_width, "Frame height :", pCodecCtx->coded_height);
+								HardwareDevices::Instance()->SetDecodeSupport(hw_de_av_device_type, hw_device_index,
+									decode_codec_id, decode_profile, decode_width, decode_height, true);
+								retry_decode_open = 0;
+							}
 						}
+					} // if hw_de_on && hw_de_supported
+					else {
+						ZMQ_DEBUG("\nDecode in software is used\n");
 					}
-				} // if hw_de_on && hw_de_supported
-				else {
-					ZmqLogger::Instance()->AppendDebugMethod("\nDecode in software is used\n");
-				}
 #else
-				retry_decode_open = 0;
+					retry_decode_open = 0;
 #endif // USE_HW_ACCEL
-			} while (retry_decode_open); // retry_decode_open
-			// Free options
-			av_dict_free(&opts);
+				} while (retry_decode_open); // retry_decode_open
+				// Free options
+				av_dict_free(&opts);
+			}
 
 			// Update the File Info struct with video details (if a video stream is found)
 			UpdateVideoInfo();
@@ -522,25 +583,28 @@ void FFmpegReader::Open() {
 
 			// Get codec and codec context from stream
 			const AVCodec *aCodec = avcodec_find_decoder(codecId);
-			aCodecCtx = AV_GET_CODEC_CONTEXT(aStream, aCodec);
+			// Open the audio decoder (unless it is re-used)
+			if (!warm) {
+				aCodecCtx = AV_GET_CODEC_CONTEXT(aStream, aCodec);
 
-			// Set number of threads equal to number of processors (not to exceed 16)
-			aCodecCtx->thread_count = std::min(FF_NUM_PROCESSORS, 16);
+				// Set number of threads equal to number of processors (not to exceed 16)
+				aCodecCtx->thread_count = decoder_threads;
 
-			if (aCodec == NULL) {
-				throw InvalidCodec("A valid audio codec could not be found for this file.", path);
-			}
+				if (aCodec == NULL) {
+					throw InvalidCodec("A valid audio codec could not be found for this file.", path);
+				}
 
-			// Init options
-			AVDictionary *opts = NULL;
-			av_dict_set(&opts, "strict", "experimental", 0);
+				// Init options
+				AVDictionary *opts = NULL;
+				av_dict_set(&opts, "strict", "experimental", 0);
 
-			// Open audio codec
-			if (avcodec_open2(aCodecCtx, aCodec, &opts) < 0)
-				throw InvalidCodec("An audio codec was found, but could not be opened.", path);
+				// Open audio codec
+				if (avcodec_open2(aCodecCtx, aCodec, &opts) < 0)
+					throw InvalidCodec("An audio codec was found, but could not be opened.", path);
 
-			// Free options
-			av_dict_free(&opts);
+				// Free options
+				av_dict_free(&opts);
+			}
 
 			// Update the File Info struct with audio details (if an audio stream is found)
 			UpdateAudioInfo();
@@ -566,16 +630,44 @@ void FFmpegReader::Open() {
 		// This method allows us to shift timestamps to ensure at least 1 stream is starting at zero.
 		UpdatePTSOffset();
 
+		// Use the frames counted by the probe thread (if finished since this file was last opened)
+		{
+			const std::lock_guard<std::mutex> probe_lock(probe_mutex);
+			if (probe_done && info.has_video) {
+				info.fps = probed_info.fps;
+				info.video_length = probed_info.video_length;
+				info.duration = probed_info.duration;
+				info.video_bit_rate = probed_info.video_bit_rate;
+				is_estimated_length = false;
+			}
+		}
+
 		// Override an invalid framerate
 		if (info.fps.ToFloat() > 240.0f || (info.fps.num <= 0 || info.fps.den <= 0) || info.video_length <= 0) {
-			// Calculate FPS, duration, video bit rate, and video length manually
-			// by scanning through all the video stream packets
-			CheckFPS();
+			if (openshot::Settings::Instance()->ENABLE_FAST_PROBE && info.duration > 0.0f && !probe_thread.joinable()) {
+				// Estimate the FPS and length for now, and count the frames on a background thread
+				// (instead of scanning through all the video stream packets while opening the file)
+				if (info.fps.ToFloat() > 240.0f || info.fps.num <= 0 || info.fps.den <= 0)
+					info.fps = Fraction(30, 1);
+				info.video_length = round(info.duration * info.fps.ToDouble());
+				is_estimated_length = true;
+				probe_stop = false;
+				probe_thread = std::thread(&FFmpegReader::CountFrames, this, info, pts_offset_seconds);
+			} else if (!is_estimated_length) {
+				// Calculate FPS, duration, video bit rate, and video length manually
+				// by scanning through all the video stream packets
+				CheckFPS();
+			}
 		}
 
 		// Mark as "open"
 		is_open = true;
 
+		// Open the proxy (if any)
+		std::shared_ptr<FFmpegReader> proxy = std::atomic_load(&proxy_reader);
+		if (proxy)
+			proxy->Open();
+
 		// Seek back to beginning of file (if not already seeking)
 		if (!is_seeking) {
 			Seek(1);
@@ -584,6 +676,9 @@ void FFmpegReader::Open() {
 }
 
 void FFmpegReader::Close() {
+	// Stop decoding ahead (before the decoders are closed)
+	StopDecodeAhead();
+
 	// Close all objects, if reader is 'open'
 	if (is_open) {
 		// Prevent async calls to the following code
@@ -600,7 +695,7 @@ void FFmpegReader::Close() {
 		int attempts = 0;
 		int max_attempts = 128;
 		while (packet_status.packets_decoded() < packet_status.packets_read() && attempts < max_attempts) {
-			ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::Close (Drain decoder loop)",
+			ZMQ_DEBUG("FFmpegReader::Close (Drain decoder loop)",
 													 "packets_read", packet_status.packets_read(),
 													 "packets_decoded", packet_status.packets_decoded(),
 													 "attempts", attempts);
@@ -618,37 +713,58 @@ void FFmpegReader::Close() {
 			RemoveAVPacket(recent_packet);
 		}
 
-		// Close the video codec
-		if (info.has_video) {
-			if(avcodec_is_open(pCodecCtx)) {
-				avcodec_flush_buffers(pCodecCtx);
-			}
-			AV_FREE_CONTEXT(pCodecCtx);
-#if USE_HW_ACCEL
-			if (hw_de_on) {
-				if (hw_device_ctx) {
-					av_buffer_unref(&hw_device_ctx);
-					hw_device_ctx = NULL;
-				}
-			}
-#endif // USE_HW_ACCEL
+		// Free the cached scaler
+		if (img_convert_ctx) {
+			sws_freeContext(img_convert_ctx);
+			img_convert_ctx = NULL;
 		}
 
-		// Close the audio codec
-		if (info.has_audio) {
-			if(avcodec_is_open(aCodecCtx)) {
-				avcodec_flush_buffers(aCodecCtx);
-			}
-			AV_FREE_CONTEXT(aCodecCtx);
+		// Free the cached audio resampler & output buffer
+		if (avr) {
+			SWR_CLOSE(avr);
+			SWR_FREE(&avr);
+			avr = NULL;
+		}
+		if (audio_converted) {
+			av_freep(&audio_converted[0]);
+			av_freep(&audio_converted);
+			audio_converted_capacity = 0;
 		}
 
-		// Clear final cache
+		// Clear final cache (and release the shared cache)
 		final_cache.Clear();
 		working_cache.Clear();
-
-		// Close the video file
-		avformat_close_input(&pFormatCtx);
-		av_freep(&pFormatCtx);
+		working_frame_numbers.clear();
+		shared_cache.reset();
+		shared_cache_size = QSize();
+
+		// Close the proxy (if any)
+		std::shared_ptr<FFmpegReader> proxy = std::atomic_load(&proxy_reader);
+		if (proxy)
+			proxy->Close();
+
+		// Keep the video file and its decoders open for the next reader of this file (see DecoderPool),
+		// or close them (and then the read-ahead I/O, if any)
+		std::unique_ptr<DecoderContexts> contexts(new DecoderContexts());
+		contexts->path = path;
+		contexts->hardware_decoder = open_hardware_decoder;
+		contexts->decoder_threads = open_decoder_threads;
+		contexts->slice_threading = slice_threading;
+		contexts->format_context = pFormatCtx;
+		contexts->video_context = (videoStream != -1) ? pCodecCtx : NULL;
+		contexts->audio_context = (audioStream != -1) ? aCodecCtx : NULL;
+#if USE_HW_ACCEL
+		contexts->hw_device_context = hw_device_ctx;
+		contexts->hw_de_supported = hw_de_supported;
+		contexts->hw_device_index = hw_device_index;
+		hw_device_ctx = NULL;
+		hw_device_index = -1;
+#endif // USE_HW_ACCEL
+		contexts->read_ahead_io = std::move(read_ahead_io);
+		pFormatCtx = NULL;
+		pCodecCtx = NULL;
+		aCodecCtx = NULL;
+		DecoderPool::Instance()->Release(std::move(contexts));
 
 		// Reset some variables
 		last_frame = 0;
@@ -774,11 +890,11 @@ void FFmpegReader::UpdateVideoInfo() {
 		info.fps.den = framerate.den;
 	}
 
-	ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::UpdateVideoInfo", "info.fps.num", info.fps.num, "info.fps.den", info.fps.den);
+	ZMQ_DEBUG("FFmpegReader::UpdateVideoInfo", "info.fps.num", info.fps.num, "info.fps.den", info.fps.den);
 
 	// TODO: remove excessive debug info in the next releases
 	// The debug info below is just for comparison and troubleshooting on users side during the transition period
-	ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::UpdateVideoInfo (pStream->avg_frame_rate)", "num", pStream->avg_frame_rate.num, "den", pStream->avg_frame_rate.den);
+	ZMQ_DEBUG("FFmpegReader::UpdateVideoInfo (pStream->avg_frame_rate)", "num", pStream->avg_frame_rate.num, "den", pStream->avg_frame_rate.den);
 
 	if (pStream->sample_aspect_ratio.num != 0) {
 		info.pixel_ratio.num = pStream->sample_aspect_ratio.num;
@@ -906,42 +1022,70 @@ std::shared_ptr<Frame> FFmpegReader::GetFrame(int64_t requested_frame) {
 		// Invalid duration of video file
 		throw InvalidFile("Could not detect the duration of the video or audio stream.", path);
 
+	// Read from the proxy instead (if the parent timeline only needs a small preview)
+	std::shared_ptr<FFmpegReader> proxy = std::atomic_load(&proxy_reader);
+	if (proxy && IsUsingProxy())
+		return proxy->GetFrame(requested_frame);
+
 	// Debug output
-	ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::GetFrame", "requested_frame", requested_frame, "last_frame", last_frame);
+	ZMQ_DEBUG("FFmpegReader::GetFrame", "requested_frame", requested_frame, "last_frame", last_frame);
+
+	// Decode the next frames in the background (if frames are requested in order)
+	const bool is_reverse = RequestDecodeAhead(requested_frame);
 
 	// Check the cache for this frame
 	std::shared_ptr<Frame> frame = final_cache.GetFrame(requested_frame);
 	if (frame) {
 		// Debug output
-		ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::GetFrame", "returned cached frame", requested_frame);
+		ZMQ_DEBUG("FFmpegReader::GetFrame", "returned cached frame", requested_frame);
 
 		// Return the cached frame
 		return frame;
 	} else {
 
 		// Prevent async calls to the remainder of this code
-		const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+		const auto lock = TraceLock(getFrameMutex, "wait FFmpegReader::getFrameMutex");
 
 		// Check the cache a 2nd time (due to the potential previous lock)
 		frame = final_cache.GetFrame(requested_frame);
 		if (frame) {
 			// Debug output
-			ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::GetFrame", "returned cached frame on 2nd look", requested_frame);
+			ZMQ_DEBUG("FFmpegReader::GetFrame", "returned cached frame on 2nd look", requested_frame);
 
 		} else {
 			// Frame is not in cache
+			// Stop here, if this frame is no longer needed (i.e. the user scrubbed past it)
+			FrameRequest::ThrowIfCancelled(requested_frame);
+
 			// Reset seek count
 			seek_count = 0;
 
+			// Check if another reader of this file already decoded this frame
+			frame = GetSharedFrame(requested_frame);
+			if (frame)
+				return frame;
+
+			// Shrink the final cache again (after reverse requests)
+			if (!is_reverse && reverse_cache_enlarged) {
+				final_cache.SetMaxBytesFromInfo(max_concurrent_frames * 2, info.width, info.height, info.sample_rate, info.channels);
+				reverse_cache_enlarged = false;
+			}
+
 			// Are we within X frames of the requested frame?
 			int64_t diff = requested_frame - last_frame;
-			if (diff >= 1 && diff <= 20) {
-				// Continue walking the stream
+			if (is_reverse && enable_seek) {
+				// Frames are requested backwards: decode the frames before this one at once (instead of seeking for each frame)
+				frame = DecodeReverseChunk(requested_frame);
+			} else if (diff >= 1 && diff <= 20) {
+				// Continue walking the stream (from a key frame, if the video decoder was reopened with frame threads)
+				if (UpdateDecoderThreading(false))
+					Seek(requested_frame);
 				frame = ReadStream(requested_frame);
 			} else {
 				// Greater than 30 frames away, or backwards, we need to seek to the nearest key frame
 				if (enable_seek) {
 					// Only seek if enabled
+					UpdateDecoderThreading(true);
 					Seek(requested_frame);
 
 				} else if (!enable_seek && diff < 0) {
@@ -958,14 +1102,304 @@ std::shared_ptr<Frame> FFmpegReader::GetFrame(int64_t requested_frame) {
 	}
 }
 
+// Switch the video decoder between slice and frame threads, for the access pattern
+bool FFmpegReader::UpdateDecoderThreading(bool seeking) {
+	// Scrubbing seeks again before frame threads fill up, and sequential decoding (i.e. playback and export)
+	// decodes more frames per second with frame threads
+	const int seeks_to_scrub = 2;
+	const int frames_to_play = 2 * std::max(max_concurrent_frames, 8);
+	if (seeking) {
+		sequential_decodes = 0;
+		scrub_seeks++;
+	} else {
+		sequential_decodes++;
+		if (sequential_decodes >= frames_to_play)
+			scrub_seeks = 0;
+	}
+
+	const bool slice_only = slice_threading ? sequential_decodes < frames_to_play : scrub_seeks >= seeks_to_scrub;
+	if (slice_only == slice_threading || openshot::Settings::Instance()->DECODER_THREAD_TYPE != 0 ||
+		!info.has_video || HasAlbumArt() || !pCodecCtx || !pStream || !enable_seek)
+		return false;
+#if USE_HW_ACCEL
+	// Hardware decoders don't use threads
+	if (hw_de_on && hw_de_supported)
+		return false;
+#endif
+
+#if IS_FFMPEG_3_2
+	// Open a new video decoder with the other thread type (the codec parameters are in the stream)
+	const AVCodec *codec = avcodec_find_decoder(AV_FIND_DECODER_CODEC_ID(pStream));
+	if (codec == NULL)
+		return false;
+	AVCodecContext *context = AV_GET_CODEC_CONTEXT(pStream, codec);
+	context->thread_count = pCodecCtx->thread_count;
+	context->thread_type = pCodecCtx->thread_type | FF_THREAD_SLICE;
+	if (slice_only)
+		context->thread_type &= ~FF_THREAD_FRAME;
+	else
+		context->thread_type |= FF_THREAD_FRAME;
+	AVDictionary *opts = NULL;
+	av_dict_set(&opts, "strict", "experimental", 0);
+	const int avcodec_return = avcodec_open2(context, codec, &opts);
+	av_dict_free(&opts);
+	if (avcodec_return < 0) {
+		AV_FREE_CONTEXT(context);
+		return false;
+	}
+
+	// Replace the video decoder (its reference frames are lost, so the stream continues from a key frame)
+	avcodec_flush_buffers(pCodecCtx);
+	AV_FREE_CONTEXT(pCodecCtx);
+	pCodecCtx = context;
+	slice_threading = slice_only;
+
+	ZMQ_DEBUG("FFmpegReader::UpdateDecoderThreading",
+									  "slice_threading", slice_threading,
+									  "scrub_seeks", scrub_seeks,
+									  "sequential_decodes", sequential_decodes,
+									  "thread_count", pCodecCtx->thread_count);
+	return true;
+#else
+	// The codec context belongs to the stream (and can't be replaced)
+	return false;
+#endif
+}
+
+// Track the requested frames, and decode ahead of sequential requests
+bool FFmpegReader::RequestDecodeAhead(int64_t requested_frame) {
+	// The window is limited by the final cache (so decoded frames are not evicted before they are used)
+	const int window = std::min(openshot::Settings::Instance()->DECODE_AHEAD_FRAMES, max_concurrent_frames);
+	const bool reverse_enabled = openshot::Settings::Instance()->REVERSE_DECODE_FRAMES > 0;
+	if (window <= 0 && !reverse_enabled)
+		return false;
+
+	std::unique_lock<std::mutex> lock(decode_ahead_mutex);
+	if (requested_frame == last_requested_frame)
+		return reverse_enabled && reverse_requests >= 2;
+	sequential_requests = (requested_frame == last_requested_frame + 1) ? sequential_requests + 1 : 0;
+	// Backwards by 1 or 2 frames (i.e. a reverse clip, or playing backwards at double speed)
+	reverse_requests = (!sequential_hint && requested_frame < last_requested_frame && requested_frame >= last_requested_frame - 2) ? reverse_requests + 1 : 0;
+	last_requested_frame = requested_frame;
+
+	if (reverse_enabled && reverse_requests >= 2) {
+		decode_ahead_target = 0;
+
+		// Decode the previous chunk in the background, once the requests reach the last decoded chunk
+		if (reverse_chunk_start > 1 && requested_frame >= reverse_chunk_start && requested_frame <= reverse_chunk_end &&
+			reverse_prefetch_requested != reverse_chunk_start - 1) {
+			reverse_prefetch_frame = reverse_chunk_start - 1;
+			reverse_prefetch_requested = reverse_prefetch_frame;
+			StartDecodeAhead(lock);
+		}
+		return true;
+	}
+
+	if (window <= 0 || (sequential_requests < 2 && !sequential_hint) || CacheBudget::Instance()->IsOverBudget()) {
+		// Random access (i.e. seeking or scrubbing), or all caches are full: don't decode ahead
+		decode_ahead_target = 0;
+		return false;
+	}
+	decode_ahead_next = std::max(decode_ahead_next, requested_frame + 1);
+	decode_ahead_target = sequential_hint ? std::max(decode_ahead_target, requested_frame + window) : requested_frame + window;
+	StartDecodeAhead(lock);
+	return false;
+}
+
+// Decode ahead from the first request, while frames are requested in order
+void FFmpegReader::SetSequentialHint(bool sequential) {
+	const std::lock_guard<std::mutex> lock(decode_ahead_mutex);
+	sequential_hint = sequential;
+}
+
+// Start the decode-ahead thread (if it's not running), and wake it up
+void FFmpegReader::StartDecodeAhead(std::unique_lock<std::mutex>& lock) {
+	// Start the thread (joining the previous one, if it was stopped by Close)
+	if (decode_ahead_stop || !decode_ahead_thread.joinable()) {
+		lock.unlock();
+		if (decode_ahead_thread.joinable())
+			decode_ahead_thread.join();
+		lock.lock();
+		decode_ahead_stop = false;
+		decode_ahead_thread = std::thread(&FFmpegReader::DecodeAhead, this);
+	}
+	decode_ahead_condition.notify_one();
+}
+
+// Stop (and join) the decode-ahead thread
+void FFmpegReader::StopDecodeAhead() {
+	{
+		const std::lock_guard<std::mutex> lock(decode_ahead_mutex);
+		decode_ahead_stop = true;
+		decode_ahead_target = 0;
+		decode_ahead_next = 0;
+		sequential_requests = 0;
+		reverse_chunk_start = 0;
+		reverse_chunk_end = 0;
+		reverse_prefetch_frame = 0;
+		reverse_prefetch_requested = 0;
+	}
+	decode_ahead_condition.notify_all();
+
+	// The thread can't join itself (it's joined by the next call instead)
+	if (decode_ahead_thread.joinable() && decode_ahead_thread.get_id() != std::this_thread::get_id())
+		decode_ahead_thread.join();
+}
+
+// Get a frame decoded by another reader of this file (if any)
+std::shared_ptr<Frame> FFmpegReader::GetSharedFrame(int64_t requested_frame) {
+	// Frames are only shared between readers which scale their images to the same size
+	// (the scaled size changes with the parent clip's scaling, and the timeline's preview size)
+	QSize scaled_size = info.has_video ? GetScaledImageSize() : QSize(0, 0);
+	if (!shared_cache || scaled_size != shared_cache_size) {
+		shared_cache = SourceFrameCache::Instance()->Acquire(path, scaled_size.width(), scaled_size.height(),
+			max_concurrent_frames * 4, info.sample_rate, info.channels);
+		shared_cache_size = scaled_size;
+	}
+	if (!shared_cache)
+		return nullptr;
+
+	std::shared_ptr<Frame> frame = shared_cache->GetFrame(requested_frame);
+	if (frame) {
+		// Debug output
+		ZMQ_DEBUG("FFmpegReader::GetSharedFrame", "returned shared frame", requested_frame);
+
+		final_cache.Add(frame);
+	}
+	return frame;
+}
+
+// Decode frames ahead of sequential requests (called on the decode-ahead thread)
+void FFmpegReader::DecodeAhead() {
+	RenderTrace::Instance()->SetThreadName("FFmpegReader::DecodeAhead");
+	while (true) {
+		int64_t number = 0;
+		bool is_reverse_chunk = false;
+		{
+			std::unique_lock<std::mutex> lock(decode_ahead_mutex);
+			decode_ahead_condition.wait(lock, [this]() {
+				return decode_ahead_stop || reverse_prefetch_frame > 0 || decode_ahead_next <= decode_ahead_target;
+			});
+			if (decode_ahead_stop)
+				return;
+			if (reverse_prefetch_frame > 0) {
+				// Decode the previous chunk of reverse requests
+				number = reverse_prefetch_frame;
+				reverse_prefetch_frame = 0;
+				is_reverse_chunk = true;
+			} else {
+				number = decode_ahead_next++;
+			}
+		}
+		if (final_cache.GetFrame(number))
+			continue;
+
+		// Wait for the consumer to finish decoding (without blocking Close, which may
+		// be called while holding getFrameMutex, i.e. by Seek)
+		std::unique_lock<std::recursive_mutex> frame_lock(getFrameMutex, std::defer_lock);
+		while (!frame_lock.try_lock()) {
+			{
+				const std::lock_guard<std::mutex> lock(decode_ahead_mutex);
+				if (decode_ahead_stop)
+					return;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		if (is_reverse_chunk) {
+			// Reverse chunks seek (the consumer only uses cached frames, until it reaches this chunk)
+			if (!is_open || is_seeking || final_cache.GetFrame(number))
+				continue;
+			try {
+				DecodeReverseChunk(number);
+			} catch (...) {
+				// GetFrame reports any error, when the frame is requested
+			}
+			continue;
+		}
+
+		// Only continue walking the stream (the consumer may have moved while waiting); seeking is left to GetFrame
+		{
+			const std::lock_guard<std::mutex> lock(decode_ahead_mutex);
+			if (decode_ahead_stop)
+				return;
+			if (number > decode_ahead_target)
+				continue;
+		}
+		const int64_t diff = number - last_frame;
+		if (!is_open || is_seeking || diff < 1 || diff > 20 ||
+			(is_duration_known && number > info.video_length) || final_cache.GetFrame(number))
+			continue;
+
+		try {
+			ReadStream(number);
+		} catch (...) {
+			// Stop decoding ahead (GetFrame reports any error, when the frame is requested)
+			const std::lock_guard<std::mutex> lock(decode_ahead_mutex);
+			decode_ahead_target = 0;
+		}
+	}
+}
+
+// Decode a chunk of frames which ends with a frame (for reverse requests)
+std::shared_ptr<Frame> FFmpegReader::DecodeReverseChunk(int64_t end_frame) {
+	// Prevent async calls to the following code
+	const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+
+	// Seek() starts decoding a little before its requested frame
+	const int chunk_length = std::max(openshot::Settings::Instance()->REVERSE_DECODE_FRAMES, 1);
+	const int seek_margin = std::max(max_concurrent_frames, 8);
+	int64_t start_frame = std::max(int64_t(1), end_frame - chunk_length + 1);
+	int64_t seek_frame = start_frame;
+
+	// Start the chunk after the key frame before the end frame, if it's indexed (so each GOP is decoded once)
+	int64_t keyframe_pts = 0;
+	int64_t keyframe_position = -1;
+	if (info.has_video && end_frame > 1 && !HasAlbumArt() &&
+		FindSeekIndexKeyFrame(ConvertFrameToVideoPTS(end_frame - 1), keyframe_pts, keyframe_position)) {
+		const int64_t keyframe = ConvertVideoPTStoFrame(keyframe_pts);
+		if (keyframe + 1 > start_frame) {
+			// The first decoded frame (the key frame) is discarded by the seek
+			start_frame = keyframe + 1;
+			seek_frame = std::min(keyframe + seek_margin, end_frame);
+		}
+	}
+
+	// Debug output
+	ZMQ_DEBUG("FFmpegReader::DecodeReverseChunk", "start_frame", start_frame, "end_frame", end_frame, "last_frame", last_frame);
+
+	// Seek to the start of the chunk (unless the stream is already just before it)
+	const int64_t diff = start_frame - last_frame;
+	if (diff < 1 || diff > 20)
+		Seek(seek_frame);
+
+	// Hold the chunk, and the previous chunk (which is decoded while this one is used)
+	// (Seek may re-open the file, which resets the final cache size)
+	if (chunk_length + seek_margin > max_concurrent_frames) {
+		final_cache.SetMaxBytesFromInfo((chunk_length + seek_margin) * 2, info.width, info.height, info.sample_rate, info.channels);
+		reverse_cache_enlarged = true;
+	}
+
+	// Decode the whole chunk (all its frames are added to the final cache)
+	std::shared_ptr<Frame> frame = ReadStream(end_frame);
+	{
+		const std::lock_guard<std::mutex> lock(decode_ahead_mutex);
+		reverse_chunk_start = start_frame;
+		reverse_chunk_end = end_frame;
+	}
+	return frame;
+}
+
 // Read the stream until we find the requested Frame
 std::shared_ptr<Frame> FFmpegReader::ReadStream(int64_t requested_frame) {
+	RenderTraceSpan span("FFmpegReader::ReadStream", "decode");
+
 	// Allocate video frame
 	bool check_seek = false;
 	int packet_error = -1;
 
 	// Debug output
-	ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::ReadStream", "requested_frame", requested_frame, "max_concurrent_frames", max_concurrent_frames);
+	ZMQ_DEBUG("FFmpegReader::ReadStream", "requested_frame", requested_frame, "max_concurrent_frames", max_concurrent_frames);
 
 	// Loop through the stream until the correct frame is found
 	while (true) {
@@ -991,7 +1425,7 @@ std::shared_ptr<Frame> FFmpegReader::ReadStream(int64_t requested_frame) {
 		}
 
 		// Debug output
-		ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::ReadStream (GetNextPacket)", "requested_frame", requested_frame,"packets_read", packet_status.packets_read(), "packets_decoded", packet_status.packets_decoded(), "is_seeking", is_seeking);
+		ZMQ_DEBUG("FFmpegReader::ReadStream (GetNextPacket)", "requested_frame", requested_frame,"packets_read", packet_status.packets_read(), "packets_decoded", packet_status.packets_decoded(), "is_seeking", is_seeking);
 
 		// Check the status of a seek (if any)
 		if (is_seeking) {
@@ -1044,7 +1478,7 @@ std::shared_ptr<Frame> FFmpegReader::ReadStream(int64_t requested_frame) {
 		if ((packet_status.packets_eof && packet_status.packets_read() == packet_status.packets_decoded()) || packet_status.end_of_file) {
 			// Force EOF (end of file) variables to true, if decoder does not support EOF detection.
 			// If we have no more packets, and all known packets have been decoded
-			ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::ReadStream (force EOF)", "packets_read", packet_status.packets_read(), "packets_decoded", packet_status.packets_decoded(), "packets_eof", packet_status.packets_eof, "video_eof", packet_status.video_eof, "audio_eof", packet_status.audio_eof, "end_of_file", packet_status.end_of_file);
+			ZMQ_DEBUG("FFmpegReader::ReadStream (force EOF)", "packets_read", packet_status.packets_read(), "packets_decoded", packet_status.packets_decoded(), "packets_eof", packet_status.packets_eof, "video_eof", packet_status.video_eof, "audio_eof", packet_status.audio_eof, "end_of_file", packet_status.end_of_file);
 			if (!packet_status.video_eof) {
 				packet_status.video_eof = true;
 			}
@@ -1057,7 +1491,7 @@ std::shared_ptr<Frame> FFmpegReader::ReadStream(int64_t requested_frame) {
 	} // end while
 
 	// Debug output
-	ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::ReadStream (Completed)",
+	ZMQ_DEBUG("FFmpegReader::ReadStream (Completed)",
 										  "packets_read", packet_status.packets_read(),
 										  "packets_decoded", packet_status.packets_decoded(),
 										  "end_of_file", packet_status.end_of_file,
@@ -1142,11 +1576,15 @@ int FFmpegReader::GetNextPacket() {
 
 // Get an AVFrame (if any)
 bool FFmpegReader::GetAVFrame() {
+	RenderStageTimer timer(RENDER_STAGE_DECODE);
 	int frameFinished = 0;
 
 	// Decode video frame
 	AVFrame *next_frame = AV_ALLOCATE_FRAME();
 
+	// Draft quality previews skip the deblocking (loop) filter, which is a large part of decoding H.264 and HEVC
+	pCodecCtx->skip_loop_filter = IsDraftQuality() ? AVDISCARD_ALL : AVDISCARD_DEFAULT;
+
 #if IS_FFMPEG_3_2
 	int send_packet_err = 0;
 	int64_t send_packet_pts = 0;
@@ -1156,7 +1594,7 @@ bool FFmpegReader::GetAVFrame() {
 		if (packet && send_packet_err >= 0) {
 			send_packet_pts = GetPacketPTS();
 			hold_packet = false;
-			ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::GetAVFrame (send packet succeeded)", "send_packet_err", send_packet_err, "send_packet_pts", send_packet_pts);
+			ZMQ_DEBUG("FFmpegReader::GetAVFrame (send packet succeeded)", "send_packet_err", send_packet_err, "send_packet_pts", send_packet_pts);
 		}
 	}
 
@@ -1166,16 +1604,16 @@ bool FFmpegReader::GetAVFrame() {
 		hw_de_av_device_type = hw_de_av_device_type_global;
 	#endif // USE_HW_ACCEL
 		if (send_packet_err < 0 && send_packet_err != AVERROR_EOF) {
-			ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::GetAVFrame (send packet: Not sent [" + av_err2string(send_packet_err) + "])", "send_packet_err", send_packet_err, "send_packet_pts", send_packet_pts);
+			ZMQ_DEBUG("FFmpegReader::GetAVFrame (send packet: Not sent [" + av_err2string(send_packet_err) + "])", "send_packet_err", send_packet_err, "send_packet_pts", send_packet_pts);
 			if (send_packet_err == AVERROR(EAGAIN)) {
 				hold_packet = true;
-				ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::GetAVFrame (send packet: AVERROR(EAGAIN): user must read output with avcodec_receive_frame()", "send_packet_pts", send_packet_pts);
+				ZMQ_DEBUG("FFmpegReader::GetAVFrame (send packet: AVERROR(EAGAIN): user must read output with avcodec_receive_frame()", "send_packet_pts", send_packet_pts);
 			}
 			if (send_packet_err == AVERROR(EINVAL)) {
-				ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::GetAVFrame (send packet: AVERROR(EINVAL): codec not opened, it is an encoder, or requires flush", "send_packet_pts", send_packet_pts);
+				ZMQ_DEBUG("FFmpegReader::GetAVFrame (send packet: AVERROR(EINVAL): codec not opened, it is an encoder, or requires flush", "send_packet_pts", send_packet_pts);
 			}
 			if (send_packet_err == AVERROR(ENOMEM)) {
-				ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::GetAVFrame (send packet: AVERROR(ENOMEM): failed to add packet to internal queue, or legitimate decoding errors", "send_packet_pts", send_packet_pts);
+				ZMQ_DEBUG("FFmpegReader::GetAVFrame (send packet: AVERROR(ENOMEM): failed to add packet to internal queue, or legitimate decoding errors", "send_packet_pts", send_packet_pts);
 			}
 		}
 
@@ -1198,25 +1636,25 @@ bool FFmpegReader::GetAVFrame() {
 			receive_frame_err = avcodec_receive_frame(pCodecCtx, next_frame2);
 
 			if (receive_frame_err != 0) {
-				ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::GetAVFrame (receive frame: frame not ready yet from decoder [\" + av_err2string(receive_frame_err) + \"])", "receive_frame_err", receive_frame_err, "send_packet_pts", send_packet_pts);
+				ZMQ_DEBUG("FFmpegReader::GetAVFrame (receive frame: frame not ready yet from decoder [\" + av_err2string(receive_frame_err) + \"])", "receive_frame_err", receive_frame_err, "send_packet_pts", send_packet_pts);
 
 				if (receive_frame_err == AVERROR_EOF) {
-					ZmqLogger::Instance()->AppendDebugMethod(
+					ZMQ_DEBUG(
 							"FFmpegReader::GetAVFrame (receive frame: AVERROR_EOF: EOF detected from decoder, flushing buffers)", "send_packet_pts", send_packet_pts);
 					avcodec_flush_buffers(pCodecCtx);
 					packet_status.video_eof = true;
 				}
 				if (receive_frame_err == AVERROR(EINVAL)) {
-					ZmqLogger::Instance()->AppendDebugMethod(
+					ZMQ_DEBUG(
 							"FFmpegReader::GetAVFrame (receive frame: AVERROR(EINVAL): invalid frame received, flushing buffers)", "send_packet_pts", send_packet_pts);
 					avcodec_flush_buffers(pCodecCtx);
 				}
 				if (receive_frame_err == AVERROR(EAGAIN)) {
-					ZmqLogger::Instance()->AppendDebugMethod(
+					ZMQ_DEBUG(
 							"FFmpegReader::GetAVFrame (receive frame: AVERROR(EAGAIN): output is not available in this state - user must try to send new input)", "send_packet_pts", send_packet_pts);
 				}
 				if (receive_frame_err == AVERROR_INPUT_CHANGED) {
-					ZmqLogger::Instance()->AppendDebugMethod(
+					ZMQ_DEBUG(
 							"FFmpegReader::GetAVFrame (receive frame: AVERROR_INPUT_CHANGED: current decoded frame has changed parameters with respect to first decoded frame)", "send_packet_pts", send_packet_pts);
 				}
 
@@ -1226,22 +1664,30 @@ bool FFmpegReader::GetAVFrame() {
 			}
 
 #if USE_HW_ACCEL
-			if (hw_de_on && hw_de_supported) {
+			if (hw_de_on && hw_de_supported && next_frame2->format == hw_de_av_pix_fmt) {
+				// Download the GPU surface straight into pFrame, in the surface's native software
+				// format (i.e. NV12), so each decoded image is only copied once into system memory
 				int err;
-				if (next_frame2->format == hw_de_av_pix_fmt) {
-					next_frame->format = AV_PIX_FMT_YUV420P;
-					if ((err = av_hwframe_transfer_data(next_frame,next_frame2,0)) < 0) {
-						ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::GetAVFrame (Failed to transfer data to output frame)", "hw_de_on", hw_de_on);
-					}
-					if ((err = av_frame_copy_props(next_frame,next_frame2)) < 0) {
-						ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::GetAVFrame (Failed to copy props to output frame)", "hw_de_on", hw_de_on);
-					}
+				if ((err = av_hwframe_transfer_data(pFrame, next_frame2, 0)) < 0) {
+					ZMQ_DEBUG("FFmpegReader::GetAVFrame (Failed to transfer data to output frame)", "hw_de_on", hw_de_on);
+				}
+				if ((err = av_frame_copy_props(pFrame, next_frame2)) < 0) {
+					ZMQ_DEBUG("FFmpegReader::GetAVFrame (Failed to copy props to output frame)", "hw_de_on", hw_de_on);
 				}
 			}
 			else
 #endif // USE_HW_ACCEL
-			{	// No hardware acceleration used -> no copy from GPU memory needed
-				next_frame = next_frame2;
+			if (next_frame2->buf[0]) {
+				// Take over the reference counted image (instead of copying it). The decoder
+				// allocates a new buffer for its next frame while this one is still referenced.
+				av_frame_move_ref(pFrame, next_frame2);
+			} else {
+				// Copy the decoded image, since the decoder re-uses its frames
+				av_image_alloc(pFrame->data, pFrame->linesize, info.width, info.height, (AVPixelFormat)(pStream->codecpar->format), 1);
+				av_image_copy(pFrame->data, pFrame->linesize, (const uint8_t**)next_frame2->data, next_frame2->linesize,
+											(AVPixelFormat)(pStream->codecpar->format), info.width, info.height);
+				av_frame_copy_props(pFrame, next_frame2);
+				pFrame->format = pStream->codecpar->format;
 			}
 
 			// TODO also handle possible further frames
@@ -1249,24 +1695,20 @@ bool FFmpegReader::GetAVFrame() {
 			frameFinished = 1;
 			packet_status.video_decoded++;
 
-			av_image_alloc(pFrame->data, pFrame->linesize, info.width, info.height, (AVPixelFormat)(pStream->codecpar->format), 1);
-			av_image_copy(pFrame->data, pFrame->linesize, (const uint8_t**)next_frame->data, next_frame->linesize,
-										(AVPixelFormat)(pStream->codecpar->format), info.width, info.height);
-
 			// Get display PTS from video frame, often different than packet->pts.
 			// Sending packets to the decoder (i.e. packet->pts) is async,
 			// and retrieving packets from the decoder (frame->pts) is async. In most decoders
 			// sending and retrieving are separated by multiple calls to this method.
-			if (next_frame->pts != AV_NOPTS_VALUE) {
+			if (pFrame->pts != AV_NOPTS_VALUE) {
 				// This is the current decoded frame (and should be the pts used) for
 				// processing this data
-				video_pts = next_frame->pts;
-			} else if (next_frame->pkt_dts != AV_NOPTS_VALUE) {
+				video_pts = pFrame->pts;
+			} else if (pFrame->pkt_dts != AV_NOPTS_VALUE) {
 				// Some videos only set this timestamp (fallback)
-				video_pts = next_frame->pkt_dts;
+				video_pts = pFrame->pkt_dts;
 			}
 
-			ZmqLogger::Instance()->AppendDebugMethod(
+			ZMQ_DEBUG(
 					"FFmpegReader::GetAVFrame (Successful frame received)", "video_pts", video_pts, "send_packet_pts", send_packet_pts);
 
 			// break out of loop after each successful image returned
@@ -1319,7 +1761,7 @@ bool FFmpegReader::CheckSeek(bool is_video) {
 		// determine if we are "before" the requested frame
 		if (max_seeked_frame >= seeking_frame) {
 			// SEEKED TOO FAR
-			ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::CheckSeek (Too far, seek again)",
+			ZMQ_DEBUG("FFmpegReader::CheckSeek (Too far, seek again)",
 											"is_video_seek", is_video_seek,
 											"max_seeked_frame", max_seeked_frame,
 											"seeking_frame", seeking_frame,
@@ -1331,7 +1773,7 @@ bool FFmpegReader::CheckSeek(bool is_video) {
 			Seek(seeking_frame - (10 * seek_count * seek_count));
 		} else {
 			// SEEK WORKED
-			ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::CheckSeek (Successful)",
+			ZMQ_DEBUG("FFmpegReader::CheckSeek (Successful)",
 											"is_video_seek", is_video_seek,
 											"packet->pts", GetPacketPTS(),
 											"seeking_pts", seeking_pts,
@@ -1350,6 +1792,102 @@ bool FFmpegReader::CheckSeek(bool is_video) {
 	return is_seeking;
 }
 
+// Get the size decoded images are scaled to (based on the parent clip & timeline)
+// Is the parent clip's timeline rendering draft quality previews?
+bool FFmpegReader::IsDraftQuality() {
+	TimelineBase *timeline = ParentTimeline();
+	return timeline && timeline->IsDraftQuality();
+}
+
+TimelineBase* FFmpegReader::ParentTimeline() {
+	Clip *parent = static_cast<Clip *>(ParentClip());
+	return parent ? parent->ParentTimeline() : nullptr;
+}
+
+QSize FFmpegReader::GetScaledImageSize() {
+	// Determine the max size of this source image (based on the timeline's size, the scaling mode,
+	// and the scaling keyframes). This is a performance improvement, to keep the images as small as possible,
+	// without losing quality. NOTE: We cannot go smaller than the timeline itself, or the add_layer timeline
+	// method will scale it back to timeline size before scaling it smaller again. This needs to be fixed in
+	// the future.
+	int max_width = info.width;
+	int max_height = info.height;
+
+	// Based on the parent clip (and its timeline's preview size)
+	Clip *parent = static_cast<Clip *>(ParentClip());
+	if (parent) {
+		QSize max_size = parent->GetMaxSourceSize(info.width, info.height, max_width, max_height);
+		max_width = max_size.width();
+		max_height = max_size.height();
+	}
+
+	// Determine if image needs to be scaled (for performance reasons)
+	int width = info.width;
+	int height = info.height;
+	if (max_width != 0 && max_height != 0 && max_width < info.width && max_height < info.height) {
+		// Override width and height (but maintain aspect ratio)
+		float ratio = float(info.width) / float(info.height);
+		int possible_width = round(max_height * ratio);
+		int possible_height = round(max_width / ratio);
+
+		if (possible_width <= max_width) {
+			// use calculated width, and max_height
+			width = possible_width;
+			height = max_height;
+		} else {
+			// use max_width, and calculated height
+			width = max_width;
+			height = possible_height;
+		}
+	}
+
+	return QSize(width, height);
+}
+
+// Release a decoded image wrapped by a QImage (see wrap_decoded_image)
+static void free_wrapped_avframe(void *info) {
+	AVFrame *av_frame = (AVFrame *) info;
+	AV_FREE_FRAME(&av_frame);
+}
+
+// Wrap a decoded RGBA or BGRA image in a QImage (without copying it), when it doesn't need to be scaled.
+// The QImage takes over the reference to the image buffer (which is released with the QImage), and the
+// image is converted in place (to premultiplied RGBA). Returns nullptr if the image can't be wrapped.
+static std::shared_ptr<QImage> wrap_decoded_image(AVFrame *av_frame, AVPixelFormat pix_fmt, int width, int height) {
+	if ((pix_fmt != AV_PIX_FMT_RGBA && pix_fmt != AV_PIX_FMT_BGRA) || !av_frame->buf[0] ||
+		av_frame->width != width || av_frame->height != height || av_frame->linesize[0] < width * 4)
+		return nullptr;
+
+	// The decoder must not use this image anymore (i.e. as a reference for the next images), since
+	// it's modified in place (here, and later by the effects)
+	if (!av_frame_is_writable(av_frame))
+		return nullptr;
+	AVFrame *wrapped = AV_ALLOCATE_FRAME();
+	if (!wrapped)
+		return nullptr;
+	av_frame_move_ref(wrapped, av_frame);
+
+	// Convert to premultiplied RGBA
+	const bool is_bgra = (pix_fmt == AV_PIX_FMT_BGRA);
+	#pragma omp parallel for
+	for (int y = 0; y < height; y++) {
+		uint8_t *pixel = wrapped->data[0] + (y * wrapped->linesize[0]);
+		for (int x = 0; x < width; x++, pixel += 4) {
+			if (is_bgra)
+				std::swap(pixel[0], pixel[2]);
+			const int alpha = pixel[3];
+			if (alpha != 255) {
+				pixel[0] = (pixel[0] * alpha + 127) / 255;
+				pixel[1] = (pixel[1] * alpha + 127) / 255;
+				pixel[2] = (pixel[2] * alpha + 127) / 255;
+			}
+		}
+	}
+
+	return std::make_shared<QImage>(wrapped->data[0], width, height, wrapped->linesize[0],
+		QImage::Format_RGBA8888_Premultiplied, (QImageCleanupFunction) &free_wrapped_avframe, (void *) wrapped);
+}
+
 // Process a video packet
 void FFmpegReader::ProcessVideoPacket(int64_t requested_frame) {
 	// Get the AVFrame from the current packet
@@ -1376,149 +1914,122 @@ void FFmpegReader::ProcessVideoPacket(int64_t requested_frame) {
 	// in working_cache at least once. Seek can clear the working_cache, so we must
 	// add the requested frame back to the working_cache here. If it already exists,
 	// it will be moved to the top of the working_cache.
-	working_cache.Add(CreateFrame(requested_frame));
+	AddWorkingFrame(CreateFrame(requested_frame));
 
 	// Debug output
-	ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::ProcessVideoPacket (Before)", "requested_frame", requested_frame, "current_frame", current_frame);
+	ZMQ_DEBUG("FFmpegReader::ProcessVideoPacket (Before)", "requested_frame", requested_frame, "current_frame", current_frame);
 
 	// Init some things local (for OpenMP)
 	PixelFormat pix_fmt = AV_GET_CODEC_PIXEL_FORMAT(pStream, pCodecCtx);
+	if (pFrame->format != AV_PIX_FMT_NONE) {
+		// Use the decoded image's own format (i.e. NV12 when downloaded from a hardware decoder)
+		pix_fmt = (PixelFormat) pFrame->format;
+	}
 	int height = info.height;
 	int width = info.width;
 	int64_t video_length = info.video_length;
 
-	// Create variables for a RGB Frame (since most videos are not in RGB, we must convert it)
-	AVFrame *pFrameRGB = nullptr;
-	uint8_t *buffer = nullptr;
-
-	// Allocate an AVFrame structure
-	pFrameRGB = AV_ALLOCATE_FRAME();
-	if (pFrameRGB == nullptr)
-		throw OutOfMemory("Failed to allocate frame buffer", path);
-
-	// Determine the max size of this source image (based on the timeline's size, the scaling mode,
-	// and the scaling keyframes). This is a performance improvement, to keep the images as small as possible,
-	// without losing quality. NOTE: We cannot go smaller than the timeline itself, or the add_layer timeline
-	// method will scale it back to timeline size before scaling it smaller again. This needs to be fixed in
-	// the future.
-	int max_width = info.width;
-	int max_height = info.height;
-
-	Clip *parent = static_cast<Clip *>(ParentClip());
-	if (parent) {
-		if (parent->ParentTimeline()) {
-			// Set max width/height based on parent clip's timeline (if attached to a timeline)
-			max_width = parent->ParentTimeline()->preview_width;
-			max_height = parent->ParentTimeline()->preview_height;
-		}
-		if (parent->scale == SCALE_FIT || parent->scale == SCALE_STRETCH) {
-			// Best fit or Stretch scaling (based on max timeline size * scaling keyframes)
-			float max_scale_x = parent->scale_x.GetMaxPoint().co.Y;
-			float max_scale_y = parent->scale_y.GetMaxPoint().co.Y;
-			max_width = std::max(float(max_width), max_width * max_scale_x);
-			max_height = std::max(float(max_height), max_height * max_scale_y);
-
-		} else if (parent->scale == SCALE_CROP) {
-			// Cropping scale mode (based on max timeline size * cropped size * scaling keyframes)
-			float max_scale_x = parent->scale_x.GetMaxPoint().co.Y;
-			float max_scale_y = parent->scale_y.GetMaxPoint().co.Y;
-			QSize width_size(max_width * max_scale_x,
-							 round(max_width / (float(info.width) / float(info.height))));
-			QSize height_size(round(max_height / (float(info.height) / float(info.width))),
-							  max_height * max_scale_y);
-			// respect aspect ratio
-			if (width_size.width() >= max_width && width_size.height() >= max_height) {
-				max_width = std::max(max_width, width_size.width());
-				max_height = std::max(max_height, width_size.height());
-			} else {
-				max_width = std::max(max_width, height_size.width());
-				max_height = std::max(max_height, height_size.height());
-			}
+	// Determine the size of the decoded image (for performance reasons)
+	QSize scaled_size = GetScaledImageSize();
+	int original_height = height;
+	width = scaled_size.width();
+	height = scaled_size.height();
+
+	// Use the decoded image as is, if it's already RGBA (or BGRA) and doesn't need to be scaled
+	std::shared_ptr<QImage> image;
+	if (width == info.width && height == info.height)
+		image = wrap_decoded_image(pFrame, pix_fmt, width, height);
+
+	if (!image) {
+		// Create variables for a RGB Frame (since most videos are not in RGB, we must convert it)
+		AVFrame *pFrameRGB = nullptr;
+		uint8_t *buffer = nullptr;
+
+		// Allocate an AVFrame structure
+		pFrameRGB = AV_ALLOCATE_FRAME();
+		if (pFrameRGB == nullptr)
+			throw OutOfMemory("Failed to allocate frame buffer", path);
+
+		// Determine required buffer size and allocate buffer
+		const int bytes_per_pixel = 4;
+		int buffer_size = (width * height * bytes_per_pixel) + 128;
+		buffer = ImageBufferPool::Instance()->Acquire(buffer_size);
+
+		// High bit depth sources are scaled to 16 bits per channel, and dithered down to the frame's 8 bits
+		// afterwards (instead of being truncated by the scaler), see Settings::HIGH_BIT_DEPTH
+		const bool has_alpha = ffmpeg_has_alpha(AV_GET_CODEC_PIXEL_FORMAT(pStream, pCodecCtx));
+		const bool high_bit_depth = openshot::Settings::Instance()->HIGH_BIT_DEPTH && ffmpeg_high_bit_depth(pix_fmt);
+		const PixelFormat rgb_fmt = high_bit_depth ? AV_PIX_FMT_RGBA64 : PIX_FMT_RGBA;
+		uint8_t *buffer16 = nullptr;
+		if (high_bit_depth)
+			buffer16 = ImageBufferPool::Instance()->Acquire((int64_t(width) * height * 8) + 128);
+
+		// Copy picture data from one AVFrame (or AVPicture) to another one.
+		AV_COPY_PICTURE_DATA(pFrameRGB, high_bit_depth ? buffer16 : buffer, rgb_fmt, width, height);
+
+		int scale_mode = SWS_FAST_BILINEAR;
+		if (IsDraftQuality()) {
+			scale_mode = SWS_POINT;
+		} else if (ParentTimeline() ? ParentTimeline()->HighQualityScaling() : openshot::Settings::Instance()->HIGH_QUALITY_SCALING) {
+			scale_mode = SWS_BICUBIC;
+		}
+		// Re-use the previous scaler, unless the source format, sizes or scale mode changed. Packets are
+		// processed while holding getFrameMutex, so only one thread uses this context at a time.
+		img_convert_ctx = sws_getCachedContext(img_convert_ctx, info.width, info.height, pix_fmt, width,
+											   height, rgb_fmt, scale_mode, NULL, NULL, NULL);
+		if (img_convert_ctx == NULL) {
+			AV_FREE_FRAME(&pFrameRGB);
+			ImageBufferPool::Instance()->Release(buffer);
+			if (buffer16)
+				ImageBufferPool::Instance()->Release(buffer16);
+			throw OutOfMemory("Failed to allocate image scaler", path);
+		}
 
-		} else {
-			// Scale video to equivalent unscaled size
-			// Since the preview window can change sizes, we want to always
-			// scale against the ratio of original video size to timeline size
-			float preview_ratio = 1.0;
-			if (parent->ParentTimeline()) {
-				Timeline *t = (Timeline *) parent->ParentTimeline();
-				preview_ratio = t->preview_width / float(t->info.width);
+		// Resize / Convert to RGB
+		{
+			RenderStageTimer timer(RENDER_STAGE_SCALE);
+			sws_scale(img_convert_ctx, pFrame->data, pFrame->linesize, 0,
+					  original_height, pFrameRGB->data, pFrameRGB->linesize);
+			if (high_bit_depth) {
+				PixelKernels::DitherRGBA64((const uint16_t *) pFrameRGB->data[0], pFrameRGB->linesize[0], buffer,
+										   width * bytes_per_pixel, width, height, has_alpha);
+				ImageBufferPool::Instance()->Release(buffer16);
 			}
-			float max_scale_x = parent->scale_x.GetMaxPoint().co.Y;
-			float max_scale_y = parent->scale_y.GetMaxPoint().co.Y;
-			max_width = info.width * max_scale_x * preview_ratio;
-			max_height = info.height * max_scale_y * preview_ratio;
 		}
-	}
 
-	// Determine if image needs to be scaled (for performance reasons)
-	int original_height = height;
-	if (max_width != 0 && max_height != 0 && max_width < width && max_height < height) {
-		// Override width and height (but maintain aspect ratio)
-		float ratio = float(width) / float(height);
-		int possible_width = round(max_height * ratio);
-		int possible_height = round(max_width / ratio);
-
-		if (possible_width <= max_width) {
-			// use calculated width, and max_height
-			width = possible_width;
-			height = max_height;
+		// Image data for the frame (the buffer returns to the pool when the image is deleted)
+		if (!has_alpha || high_bit_depth) {
+			// Image with no alpha channel (or already premultiplied by the dithering), Speed optimization
+			image = std::make_shared<QImage>(buffer, width, height, width * bytes_per_pixel,
+				QImage::Format_RGBA8888_Premultiplied, (QImageCleanupFunction) &ImageBufferPool::ReleaseImageBuffer, (void *) buffer);
 		} else {
-			// use max_width, and calculated height
-			width = max_width;
-			height = possible_height;
+			// Image with alpha channel (this will be converted to premultipled when needed, but is slower)
+			image = std::make_shared<QImage>(buffer, width, height, width * bytes_per_pixel,
+				QImage::Format_RGBA8888, (QImageCleanupFunction) &ImageBufferPool::ReleaseImageBuffer, (void *) buffer);
 		}
-	}
 
-	// Determine required buffer size and allocate buffer
-	const int bytes_per_pixel = 4;
-	int buffer_size = (width * height * bytes_per_pixel) + 128;
-	buffer = new unsigned char[buffer_size]();
-
-	// Copy picture data from one AVFrame (or AVPicture) to another one.
-	AV_COPY_PICTURE_DATA(pFrameRGB, buffer, PIX_FMT_RGBA, width, height);
-
-	int scale_mode = SWS_FAST_BILINEAR;
-	if (openshot::Settings::Instance()->HIGH_QUALITY_SCALING) {
-		scale_mode = SWS_BICUBIC;
+		// Free the RGB image
+		AV_FREE_FRAME(&pFrameRGB);
 	}
-	SwsContext *img_convert_ctx = sws_getContext(info.width, info.height, AV_GET_CODEC_PIXEL_FORMAT(pStream, pCodecCtx), width,
-												 height, PIX_FMT_RGBA, scale_mode, NULL, NULL, NULL);
 
-	// Resize / Convert to RGB
-	sws_scale(img_convert_ctx, pFrame->data, pFrame->linesize, 0,
-			  original_height, pFrameRGB->data, pFrameRGB->linesize);
-
-	// Create or get the existing frame object
+	// Create or get the existing frame object, and add the image
 	std::shared_ptr<Frame> f = CreateFrame(current_frame);
-
-	// Add Image data to frame
-	if (!ffmpeg_has_alpha(AV_GET_CODEC_PIXEL_FORMAT(pStream, pCodecCtx))) {
-		// Add image with no alpha channel, Speed optimization
-		f->AddImage(width, height, bytes_per_pixel, QImage::Format_RGBA8888_Premultiplied, buffer);
-	} else {
-		// Add image with alpha channel (this will be converted to premultipled when needed, but is slower)
-		f->AddImage(width, height, bytes_per_pixel, QImage::Format_RGBA8888, buffer);
-	}
+	f->AddImage(image);
 
 	// Update working cache
-	working_cache.Add(f);
+	AddWorkingFrame(f);
 
 	// Keep track of last last_video_frame
 	last_video_frame = f;
 
-	// Free the RGB image
-	AV_FREE_FRAME(&pFrameRGB);
-
 	// Remove frame and packet
 	RemoveAVFrame(pFrame);
-	sws_freeContext(img_convert_ctx);
 
 	// Get video PTS in seconds
 	video_pts_seconds = (double(video_pts) * info.video_timebase.ToDouble()) + pts_offset_seconds;
 
 	// Debug output
-	ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::ProcessVideoPacket (After)", "requested_frame", requested_frame, "current_frame", current_frame, "f->number", f->number, "video_pts_seconds", video_pts_seconds);
+	ZMQ_DEBUG("FFmpegReader::ProcessVideoPacket (After)", "requested_frame", requested_frame, "current_frame", current_frame, "f->number", f->number, "video_pts_seconds", video_pts_seconds);
 }
 
 // Process an audio packet
@@ -1538,10 +2049,10 @@ void FFmpegReader::ProcessAudioPacket(int64_t requested_frame) {
 	// in working_cache at least once. Seek can clear the working_cache, so we must
 	// add the requested frame back to the working_cache here. If it already exists,
 	// it will be moved to the top of the working_cache.
-	working_cache.Add(CreateFrame(requested_frame));
+	AddWorkingFrame(CreateFrame(requested_frame));
 
 	// Debug output
-	ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::ProcessAudioPacket (Before)",
+	ZMQ_DEBUG("FFmpegReader::ProcessAudioPacket (Before)",
 										  "requested_frame", requested_frame,
 										  "target_frame", location.frame,
 										  "starting_sample", location.sample_start);
@@ -1554,10 +2065,12 @@ void FFmpegReader::ProcessAudioPacket(int64_t requested_frame) {
 	int packet_samples = 0;
 	int data_size = 0;
 
+	{
 #if IS_FFMPEG_3_2
+		RenderStageTimer timer(RENDER_STAGE_DECODE);
 		int send_packet_err =  avcodec_send_packet(aCodecCtx, packet);
 		if (send_packet_err < 0 && send_packet_err != AVERROR_EOF) {
-			ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::ProcessAudioPacket (Packet not sent)");
+			ZMQ_DEBUG("FFmpegReader::ProcessAudioPacket (Packet not sent)");
 		}
 		else {
 			int receive_frame_err = avcodec_receive_frame(aCodecCtx, audio_frame);
@@ -1565,20 +2078,22 @@ void FFmpegReader::ProcessAudioPacket(int64_t requested_frame) {
 				frame_finished = 1;
 			}
 			if (receive_frame_err == AVERROR_EOF) {
-				ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::ProcessAudioPacket (EOF detected from decoder)");
+				ZMQ_DEBUG("FFmpegReader::ProcessAudioPacket (EOF detected from decoder)");
 				packet_status.audio_eof = true;
 			}
 			if (receive_frame_err == AVERROR(EINVAL) || receive_frame_err == AVERROR_EOF) {
-				ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::ProcessAudioPacket (invalid frame received or EOF from decoder)");
+				ZMQ_DEBUG("FFmpegReader::ProcessAudioPacket (invalid frame received or EOF from decoder)");
 				avcodec_flush_buffers(aCodecCtx);
 			}
 			if (receive_frame_err != 0) {
-				ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::ProcessAudioPacket (frame not ready yet from decoder)");
+				ZMQ_DEBUG("FFmpegReader::ProcessAudioPacket (frame not ready yet from decoder)");
 			}
 		}
 #else
+		RenderStageTimer timer(RENDER_STAGE_DECODE);
 		int used = avcodec_decode_audio4(aCodecCtx, audio_frame, &frame_finished, packet);
 #endif
+	}
 
 	if (frame_finished) {
 		packet_status.audio_decoded++;
@@ -1612,7 +2127,7 @@ void FFmpegReader::ProcessAudioPacket(int64_t requested_frame) {
 
 	// Bail if no samples found
 	if (pts_remaining_samples == 0) {
-		ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::ProcessAudioPacket (No samples, bailing)",
+		ZMQ_DEBUG("FFmpegReader::ProcessAudioPacket (No samples, bailing)",
 										   "packet_samples", packet_samples,
 										   "info.channels", info.channels,
 										   "pts_remaining_samples", pts_remaining_samples);
@@ -1641,96 +2156,61 @@ void FFmpegReader::ProcessAudioPacket(int64_t requested_frame) {
 		}
 	}
 
-	// Allocate audio buffer
-	int16_t *audio_buf = new int16_t[AVCODEC_MAX_AUDIO_FRAME_SIZE + MY_INPUT_BUFFER_PADDING_SIZE];
-
-	ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::ProcessAudioPacket (ReSample)",
+	ZMQ_DEBUG("FFmpegReader::ProcessAudioPacket (ReSample)",
 										  "packet_samples", packet_samples,
 										  "info.channels", info.channels,
 										  "info.sample_rate", info.sample_rate,
 										  "aCodecCtx->sample_fmt", AV_GET_SAMPLE_FORMAT(aStream, aCodecCtx),
-										  "AV_SAMPLE_FMT_S16", AV_SAMPLE_FMT_S16);
-
-	// Create output frame
-	AVFrame *audio_converted = AV_ALLOCATE_FRAME();
-	AV_RESET_FRAME(audio_converted);
-	audio_converted->nb_samples = audio_frame->nb_samples;
-	av_samples_alloc(audio_converted->data, audio_converted->linesize, info.channels, audio_frame->nb_samples, AV_SAMPLE_FMT_S16, 0);
-
-	SWRCONTEXT *avr = NULL;
-	int nb_samples = 0;
-
-	// setup resample context
-	avr = SWR_ALLOC();
-	av_opt_set_int(avr, "in_channel_layout", AV_GET_CODEC_ATTRIBUTES(aStream, aCodecCtx)->channel_layout, 0);
-	av_opt_set_int(avr, "out_channel_layout", AV_GET_CODEC_ATTRIBUTES(aStream, aCodecCtx)->channel_layout, 0);
-	av_opt_set_int(avr, "in_sample_fmt", AV_GET_SAMPLE_FORMAT(aStream, aCodecCtx), 0);
-	av_opt_set_int(avr, "out_sample_fmt", AV_SAMPLE_FMT_S16, 0);
-	av_opt_set_int(avr, "in_sample_rate", info.sample_rate, 0);
-	av_opt_set_int(avr, "out_sample_rate", info.sample_rate, 0);
-	av_opt_set_int(avr, "in_channels", info.channels, 0);
-	av_opt_set_int(avr, "out_channels", info.channels, 0);
-	SWR_INIT(avr);
+										  "AV_SAMPLE_FMT_FLTP", AV_SAMPLE_FMT_FLTP);
+
+	// Setup resample context (once per stream), which converts directly to float planar
+	// samples (the same layout as the Frame's juce::AudioBuffer<float>)
+	if (!avr) {
+		avr = SWR_ALLOC();
+		av_opt_set_int(avr, "in_channel_layout", AV_GET_CODEC_ATTRIBUTES(aStream, aCodecCtx)->channel_layout, 0);
+		av_opt_set_int(avr, "out_channel_layout", AV_GET_CODEC_ATTRIBUTES(aStream, aCodecCtx)->channel_layout, 0);
+		av_opt_set_int(avr, "in_sample_fmt", AV_GET_SAMPLE_FORMAT(aStream, aCodecCtx), 0);
+		av_opt_set_int(avr, "out_sample_fmt", AV_SAMPLE_FMT_FLTP, 0);
+		av_opt_set_int(avr, "in_sample_rate", info.sample_rate, 0);
+		av_opt_set_int(avr, "out_sample_rate", info.sample_rate, 0);
+		av_opt_set_int(avr, "in_channels", info.channels, 0);
+		av_opt_set_int(avr, "out_channels", info.channels, 0);
+		SWR_INIT(avr);
+	}
+
+	// Grow the re-used output buffer (if needed). One plane per channel, which
+	// also works for more channels than an AVFrame has data pointers.
+	if (!audio_converted || audio_converted_capacity < audio_frame->nb_samples) {
+		if (audio_converted) {
+			av_freep(&audio_converted[0]);
+			av_freep(&audio_converted);
+		}
+		if (av_samples_alloc_array_and_samples(&audio_converted, &audio_converted_linesize, info.channels,
+											   audio_frame->nb_samples, AV_SAMPLE_FMT_FLTP, 0) < 0) {
+			audio_converted = NULL;
+			audio_converted_capacity = 0;
+			AV_FREE_FRAME(&audio_frame);
+			throw OutOfMemory("Failed to allocate audio resample buffer", path);
+		}
+		audio_converted_capacity = audio_frame->nb_samples;
+	}
 
 	// Convert audio samples
-	nb_samples = SWR_CONVERT(avr,	// audio resample context
-							 audio_converted->data,		  // output data pointers
-							 audio_converted->linesize[0],   // output plane size, in bytes. (0 if unknown)
-							 audio_converted->nb_samples,	// maximum number of samples that the output buffer can hold
-							 audio_frame->data,			  // input data pointers
-							 audio_frame->linesize[0],	   // input plane size, in bytes (0 if unknown)
-							 audio_frame->nb_samples);	   // number of input samples to convert
-
-	// Copy audio samples over original samples
-	memcpy(audio_buf,
-		audio_converted->data[0],
-		static_cast<size_t>(audio_converted->nb_samples)
-		* av_get_bytes_per_sample(AV_SAMPLE_FMT_S16)
-		* info.channels);
-
-	// Deallocate resample buffer
-	SWR_CLOSE(avr);
-	SWR_FREE(&avr);
-	avr = NULL;
-
-	// Free AVFrames
-	av_free(audio_converted->data[0]);
-	AV_FREE_FRAME(&audio_converted);
+	SWR_CONVERT(avr,	// audio resample context
+				audio_converted,		  // output data pointers
+				audio_converted_linesize,   // output plane size, in bytes. (0 if unknown)
+				audio_converted_capacity,	// maximum number of samples that the output buffer can hold
+				audio_frame->data,			  // input data pointers
+				audio_frame->linesize[0],	   // input plane size, in bytes (0 if unknown)
+				audio_frame->nb_samples);	   // number of input samples to convert
 
 	int64_t starting_frame_number = -1;
 	bool partial_frame = true;
 	for (int channel_filter = 0; channel_filter < info.channels; channel_filter++) {
-		// Array of floats (to hold samples for each channel)
+		// Each plane already holds the float samples (-1.0 to 1.0) of one channel
 		starting_frame_number = location.frame;
 		int channel_buffer_size = packet_samples / info.channels;
-		float *channel_buffer = new float[channel_buffer_size];
-
-		// Init buffer array
-		for (int z = 0; z < channel_buffer_size; z++)
-			channel_buffer[z] = 0.0f;
-
-		// Loop through all samples and add them to our Frame based on channel.
-		// Toggle through each channel number, since channel data is stored like (left right left right)
-		int channel = 0;
-		int position = 0;
-		for (int sample = 0; sample < packet_samples; sample++) {
-			// Only add samples for current channel
-			if (channel_filter == channel) {
-				// Add sample (convert from (-32768 to 32768)  to (-1.0 to 1.0))
-				channel_buffer[position] = audio_buf[sample] * (1.0f / (1 << 15));
-
-				// Increment audio position
-				position++;
-			}
-
-			// increment channel (if needed)
-			if ((channel + 1) < info.channels)
-				// move to next channel
-				channel++;
-			else
-				// reset channel
-				channel = 0;
-		}
+		float *channel_buffer = (float *) audio_converted[channel_filter];
 
 		// Loop through samples, and add them to the correct frames
 		int start = location.sample_start;
@@ -1760,7 +2240,7 @@ void FFmpegReader::ProcessAudioPacket(int64_t requested_frame) {
 			   samples, 1.0f);
 
 			// Debug output
-			ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::ProcessAudioPacket (f->AddAudio)",
+			ZMQ_DEBUG("FFmpegReader::ProcessAudioPacket (f->AddAudio)",
 											"frame", starting_frame_number,
 											"start", start,
 											"samples", samples,
@@ -1769,7 +2249,7 @@ void FFmpegReader::ProcessAudioPacket(int64_t requested_frame) {
 											"samples_per_frame", samples_per_frame);
 
 			// Add or update cache
-			working_cache.Add(f);
+			AddWorkingFrame(f);
 
 			// Decrement remaining samples
 			remaining_samples -= samples;
@@ -1785,16 +2265,10 @@ void FFmpegReader::ProcessAudioPacket(int64_t requested_frame) {
 			start = 0;
 		}
 
-		// clear channel buffer
-		delete[] channel_buffer;
 		channel_buffer = NULL;
 		iterate_channel_buffer = NULL;
 	}
 
-	// Clean up some arrays
-	delete[] audio_buf;
-	audio_buf = NULL;
-
 	// Free audio frame
 	AV_FREE_FRAME(&audio_frame);
 
@@ -1802,7 +2276,7 @@ void FFmpegReader::ProcessAudioPacket(int64_t requested_frame) {
 	audio_pts_seconds = (double(audio_pts) * info.audio_timebase.ToDouble()) + pts_offset_seconds;
 
 	// Debug output
-	ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::ProcessAudioPacket (After)",
+	ZMQ_DEBUG("FFmpegReader::ProcessAudioPacket (After)",
 										  "requested_frame", requested_frame,
 										  "starting_frame", location.frame,
 										  "end_frame", starting_frame_number - 1,
@@ -1824,13 +2298,14 @@ void FFmpegReader::Seek(int64_t requested_frame) {
 	}
 
 	// Debug output
-	ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::Seek",
+	ZMQ_DEBUG("FFmpegReader::Seek",
 										  "requested_frame", requested_frame,
 										  "seek_count", seek_count,
 										  "last_frame", last_frame);
 
 	// Clear working cache (since we are seeking to another location in the file)
 	working_cache.Clear();
+	working_frame_numbers.clear();
 
 	// Reset the last frame variable
 	video_pts = 0.0;
@@ -1879,6 +2354,30 @@ void FFmpegReader::Seek(int64_t requested_frame) {
 		bool seek_worked = false;
 		int64_t seek_target = 0;
 
+		// Seek video stream to an indexed key frame (if the seek index is built or loaded)
+		int64_t keyframe_pts = 0;
+		int64_t keyframe_position = -1;
+		if (!seek_worked && info.has_video && !HasAlbumArt() &&
+			FindSeekIndexKeyFrame(ConvertFrameToVideoPTS(requested_frame - buffer_amount), keyframe_pts, keyframe_position)) {
+			// Formats with discontinuous timestamps (i.e. MPEG-TS) seek more reliably by byte position
+			if (keyframe_position >= 0 && (pFormatCtx->iformat->flags & AVFMT_TS_DISCONT) &&
+				!(pFormatCtx->iformat->flags & AVFMT_NO_BYTE_SEEK) &&
+				av_seek_frame(pFormatCtx, info.video_stream_index, keyframe_position, AVSEEK_FLAG_BYTE) >= 0) {
+				seek_worked = true;
+			} else if (av_seek_frame(pFormatCtx, info.video_stream_index, keyframe_pts, AVSEEK_FLAG_BACKWARD) >= 0) {
+				seek_worked = true;
+			}
+			if (seek_worked) {
+				// VIDEO SEEK (to a known key frame)
+				ZMQ_DEBUG("FFmpegReader::Seek (Using seek index)",
+												  "requested_frame", requested_frame,
+												  "keyframe_pts", keyframe_pts,
+												  "keyframe_position", keyframe_position);
+				seek_target = keyframe_pts;
+				is_video_seek = true;
+			}
+		}
+
 		// Seek video stream (if any), except album arts
 		if (!seek_worked && info.has_video && !HasAlbumArt()) {
 			seek_target = ConvertFrameToVideoPTS(requested_frame - buffer_amount);
@@ -2132,11 +2631,11 @@ AudioLocation FFmpegReader::GetAudioPTSLocation(int64_t pts) {
 			location.frame = previous_packet_location.frame;
 
 			// Debug output
-			ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::GetAudioPTSLocation (Audio Gap Detected)", "Source Frame", orig_frame, "Source Audio Sample", orig_start, "Target Frame", location.frame, "Target Audio Sample", location.sample_start, "pts", pts);
+			ZMQ_DEBUG("FFmpegReader::GetAudioPTSLocation (Audio Gap Detected)", "Source Frame", orig_frame, "Source Audio Sample", orig_start, "Target Frame", location.frame, "Target Audio Sample", location.sample_start, "pts", pts);
 
 		} else {
 			// Debug output
-			ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::GetAudioPTSLocation (Audio Gap Ignored - too big)", "Previous location frame", previous_packet_location.frame, "Target Frame", location.frame, "Target Audio Sample", location.sample_start, "pts", pts);
+			ZMQ_DEBUG("FFmpegReader::GetAudioPTSLocation (Audio Gap Ignored - too big)", "Previous location frame", previous_packet_location.frame, "Target Frame", location.frame, "Target Audio Sample", location.sample_start, "pts", pts);
 		}
 	}
 
@@ -2163,7 +2662,7 @@ std::shared_ptr<Frame> FFmpegReader::CreateFrame(int64_t requested_frame) {
 		output->ChannelsLayout(info.channel_layout); // update audio channel layout from the parent reader
 		output->SampleRate(info.sample_rate); // update the frame's sample rate of the parent reader
 
-		working_cache.Add(output);
+		AddWorkingFrame(output);
 
 		// Set the largest processed frame (if this is larger)
 		if (requested_frame > largest_frame_processed)
@@ -2190,132 +2689,143 @@ bool FFmpegReader::IsPartialFrame(int64_t requested_frame) {
 	return seek_trash;
 }
 
+// Add a frame to the working cache
+void FFmpegReader::AddWorkingFrame(std::shared_ptr<Frame> frame) {
+	const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+	working_cache.Add(frame);
+	working_frame_numbers.insert(frame->number);
+}
+
 // Check the working queue, and move finished frames to the finished queue
 void FFmpegReader::CheckWorkingFrames(int64_t requested_frame) {
 
 	// Prevent async calls to the following code
 	const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
 
-	// Get a list of current working queue frames in the cache (in-progress frames)
-	std::vector<std::shared_ptr<openshot::Frame>> working_frames = working_cache.GetFrames();
-	std::vector<std::shared_ptr<openshot::Frame>>::iterator working_itr;
+	// A frame is finished once the video and audio PTS are far enough past its PTS (or a stream ended, or it's
+	// a partial frame before a seek target). All of these hold for every earlier frame too, so the frames finish
+	// in PTS order: only the oldest working frames are checked, up to the first frame which is not finished yet.
+	const double recent_pts_seconds = std::max(video_pts_seconds, audio_pts_seconds);
+	while (!working_frame_numbers.empty()) {
+		const int64_t frame_number = *working_frame_numbers.begin();
 
-	// Loop through all working queue frames (sorted by frame #)
-	for(working_itr = working_frames.begin(); working_itr != working_frames.end(); ++working_itr)
-	{
-		// Get working frame
-		std::shared_ptr<Frame> f = *working_itr;
+		// Is frame requested yet?
+		if (frame_number > requested_frame)
+			break;
 
-		// Was a frame found? Is frame requested yet?
-		if (!f || f->number > requested_frame) {
-			// If not, skip to next one
+		// Get working frame (which the working cache may have dropped, if it was full)
+		std::shared_ptr<Frame> f = working_cache.GetFrame(frame_number);
+		if (!f) {
+			working_frame_numbers.erase(working_frame_numbers.begin());
 			continue;
 		}
 
-		// Calculate PTS in seconds (of working frame), and the most recent processed pts value
+		// Calculate PTS in seconds (of working frame)
 		double frame_pts_seconds = (double(f->number - 1) / info.fps.ToDouble()) + pts_offset_seconds;
-		double recent_pts_seconds = std::max(video_pts_seconds, audio_pts_seconds);
-
-		// Determine if video and audio are ready (based on timestamps)
-		bool is_video_ready = false;
-		bool is_audio_ready = false;
 		double recent_pts_diff = recent_pts_seconds - frame_pts_seconds;
-		if ((frame_pts_seconds <= video_pts_seconds)
+
+		// Video stream is past this frame (so it must be done)
+		// OR video stream is too far behind, missing, or end-of-file
+		bool is_video_ready = !info.has_video || (frame_pts_seconds <= video_pts_seconds)
 			|| (recent_pts_diff > 1.5)
-			|| packet_status.video_eof || packet_status.end_of_file) {
-			// Video stream is past this frame (so it must be done)
-			// OR video stream is too far behind, missing, or end-of-file
-			is_video_ready = true;
-			ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::CheckWorkingFrames (video ready)",
-											"frame_number", f->number, 
-											"frame_pts_seconds", frame_pts_seconds, 
-											"video_pts_seconds", video_pts_seconds, 
-											"recent_pts_diff", recent_pts_diff);
-			if (info.has_video && !f->has_image_data) {
-				// Frame has no image data (copy from previous frame)
-				// Loop backwards through final frames (looking for the nearest, previous frame image)
-				for (int64_t previous_frame = requested_frame - 1; previous_frame > 0; previous_frame--) {
-					std::shared_ptr<Frame> previous_frame_instance = final_cache.GetFrame(previous_frame);
-					if (previous_frame_instance && previous_frame_instance->has_image_data) {
-						// Copy image from last decoded frame
-						f->AddImage(std::make_shared<QImage>(previous_frame_instance->GetImage()->copy()));
-						break;
-					}
-				}
-				
-				if (last_video_frame && !f->has_image_data) {
+			|| packet_status.video_eof || packet_status.end_of_file;
+		if (is_video_ready && info.has_video && !f->has_image_data) {
+			// Frame has no image data (copy from previous frame)
+			// Loop backwards through final frames (looking for the nearest, previous frame image)
+			for (int64_t previous_frame = requested_frame - 1; previous_frame > 0; previous_frame--) {
+				std::shared_ptr<Frame> previous_frame_instance = final_cache.GetFrame(previous_frame);
+				if (previous_frame_instance && previous_frame_instance->has_image_data) {
 					// Copy image from last decoded frame
-					f->AddImage(std::make_shared<QImage>(last_video_frame->GetImage()->copy()));
-				} else if (!f->has_image_data) {
-					f->AddColor("#000000");
+					f->AddImage(std::make_shared<QImage>(previous_frame_instance->GetImage()->copy()));
+					break;
 				}
 			}
+
+			if (last_video_frame && !f->has_image_data) {
+				// Copy image from last decoded frame
+				f->AddImage(std::make_shared<QImage>(last_video_frame->GetImage()->copy()));
+			} else if (!f->has_image_data) {
+				f->AddSolidColor(QColor(Qt::black));
+			}
 		}
 
+		// Audio stream is past this frame (so it must be done)
+		// OR audio stream is too far behind, missing, or end-of-file
+		// Adding a bit of margin here, to allow for partial audio packets
 		double audio_pts_diff = audio_pts_seconds - frame_pts_seconds;
-		if ((frame_pts_seconds < audio_pts_seconds && audio_pts_diff > 1.0)
-		   || (recent_pts_diff > 1.5)
-		   || packet_status.audio_eof || packet_status.end_of_file) {
-			// Audio stream is past this frame (so it must be done)
-			// OR audio stream is too far behind, missing, or end-of-file
-			// Adding a bit of margin here, to allow for partial audio packets
-			is_audio_ready = true;
-			ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::CheckWorkingFrames (audio ready)",
-											"frame_number", f->number, 
-											"frame_pts_seconds", frame_pts_seconds, 
-											"audio_pts_seconds", audio_pts_seconds, 
-											"audio_pts_diff", audio_pts_diff, 
-											"recent_pts_diff", recent_pts_diff);
-		}
+		bool is_audio_ready = !info.has_audio || (frame_pts_seconds < audio_pts_seconds && audio_pts_diff > 1.0)
+			|| (recent_pts_diff > 1.5)
+			|| packet_status.audio_eof || packet_status.end_of_file;
 		bool is_seek_trash = IsPartialFrame(f->number);
 
-		// Adjust for available streams
-		if (!info.has_video) is_video_ready = true;
-		if (!info.has_audio) is_audio_ready = true;
+		// Check if working frame is final (if not, neither are the frames after it)
+		if (!(is_video_ready && is_audio_ready) && !packet_status.end_of_file && !is_seek_trash) {
+			ZMQ_DEBUG("FFmpegReader::CheckWorkingFrames (not ready)",
+											   "frame_number", f->number,
+											   "is_video_ready", is_video_ready,
+											   "is_audio_ready", is_audio_ready,
+											   "video_pts_seconds", video_pts_seconds,
+											   "audio_pts_seconds", audio_pts_seconds);
+			break;
+		}
 
 		// Debug output
-		ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::CheckWorkingFrames",
-										   "frame_number", f->number, 
-										   "is_video_ready", is_video_ready, 
-										   "is_audio_ready", is_audio_ready, 
-										   "video_eof", packet_status.video_eof,
-										   "audio_eof", packet_status.audio_eof,
-										   "end_of_file", packet_status.end_of_file);
-
-		// Check if working frame is final
-		if ((!packet_status.end_of_file && is_video_ready && is_audio_ready) || packet_status.end_of_file || is_seek_trash) {
-			// Debug output
-			ZmqLogger::Instance()->AppendDebugMethod("FFmpegReader::CheckWorkingFrames (mark frame as final)", 
-											"requested_frame", requested_frame, 
-											"f->number", f->number, 
-											"is_seek_trash", is_seek_trash, 
-											"Working Cache Count", working_cache.Count(), 
-											"Final Cache Count", final_cache.Count(), 
-											"end_of_file", packet_status.end_of_file);
-
-			if (!is_seek_trash) {
-				// Move frame to final cache
-				final_cache.Add(f);
-
-				// Remove frame from working cache
-				working_cache.Remove(f->number);
-
-				// Update last frame processed
-				last_frame = f->number;
-			} else {
-				// Seek trash, so delete the frame from the working cache, and never add it to the final cache.
-				working_cache.Remove(f->number);
-			}
-
+		ZMQ_DEBUG("FFmpegReader::CheckWorkingFrames (mark frame as final)",
+										"requested_frame", requested_frame,
+										"f->number", f->number,
+										"is_seek_trash", is_seek_trash,
+										"Working Cache Count", working_cache.Count(),
+										"Final Cache Count", final_cache.Count(),
+										"end_of_file", packet_status.end_of_file);
+
+		if (!is_seek_trash) {
+			// Move frame to final cache (and share it with the other readers of this file)
+			final_cache.Add(f);
+			if (shared_cache)
+				shared_cache->Add(f);
+
+			// Update last frame processed
+			last_frame = f->number;
 		}
-	}
 
-	// Clear vector of frames
-	working_frames.clear();
-	working_frames.shrink_to_fit();
+		// Remove frame from working cache (seek trash is never added to the final cache)
+		working_cache.Remove(f->number);
+		working_frame_numbers.erase(working_frame_numbers.begin());
+	}
 }
 
 // Check for the correct frames per second (FPS) value by scanning the 1st few seconds of video packets.
+// Update the FPS, duration, length and bit rate of a file (from the video packets counted by CheckFPS)
+static void update_fps_info(ReaderInfo &info, int starting_frames_detected, int fps_index, int max_fps_index, int all_frames_detected) {
+	// Calculate FPS (based on the first few seconds of video packets)
+	float avg_fps = 30.0;
+	if (starting_frames_detected > 0 && fps_index > 0) {
+		avg_fps = float(starting_frames_detected) / std::min(fps_index, max_fps_index);
+	}
+
+	// Verify average FPS is a reasonable value
+	if (avg_fps < 8.0) {
+		// Invalid FPS assumed, so switching to a sane default FPS instead
+		avg_fps = 30.0;
+	}
+
+	// Update FPS (truncate average FPS to Integer)
+	info.fps = Fraction(int(avg_fps), 1);
+
+	// Update Duration and Length
+	if (all_frames_detected > 0) {
+		// Use all video frames detected to calculate # of frames
+		info.video_length = all_frames_detected;
+		info.duration = all_frames_detected / avg_fps;
+	} else {
+		// Use previous duration to calculate # of frames
+		info.video_length = info.duration * avg_fps;
+	}
+
+	// Update video bit rate
+	info.video_bit_rate = info.file_size / info.duration;
+}
+
 void FFmpegReader::CheckFPS() {
 	if (check_fps) {
 		// Do not check FPS more than 1 time
@@ -2356,41 +2866,80 @@ void FFmpegReader::CheckFPS() {
 		}
 	}
 
-	// Calculate FPS (based on the first few seconds of video packets)
-	float avg_fps = 30.0;
-	if (starting_frames_detected > 0 && fps_index > 0) {
-		avg_fps = float(starting_frames_detected) / std::min(fps_index, max_fps_index);
+	// Update the FPS, duration and length
+	update_fps_info(info, starting_frames_detected, fps_index, max_fps_index, all_frames_detected);
+}
+
+// Count the video frames of the file (called on the probe thread)
+void FFmpegReader::CountFrames(ReaderInfo estimated_info, double pts_offset) {
+	// Open a separate format context (so the scan does not move any reader's position)
+	AVFormatContext *scanFormatCtx = NULL;
+	if (avformat_open_input(&scanFormatCtx, path.c_str(), NULL, NULL) != 0)
+		return;
+	if (avformat_find_stream_info(scanFormatCtx, NULL) < 0) {
+		avformat_close_input(&scanFormatCtx);
+		return;
 	}
 
-	// Verify average FPS is a reasonable value
-	if (avg_fps < 8.0) {
-		// Invalid FPS assumed, so switching to a sane default FPS instead
-		avg_fps = 30.0;
+	// Only the video stream's packets are needed
+	for (unsigned int i = 0; i < scanFormatCtx->nb_streams; i++) {
+		if ((int)i != estimated_info.video_stream_index)
+			scanFormatCtx->streams[i]->discard = AVDISCARD_ALL;
 	}
 
-	// Update FPS (truncate average FPS to Integer)
-	info.fps = Fraction(int(avg_fps), 1);
+	// Count the video packets (the same way as CheckFPS)
+	int frames_per_second[3] = {0,0,0};
+	int max_fps_index = sizeof(frames_per_second) / sizeof(frames_per_second[0]);
+	int fps_index = 0;
+	int all_frames_detected = 0;
+	int starting_frames_detected = 0;
+	AVPacket *scan_packet = new AVPacket();
+	while (!probe_stop && av_read_frame(scanFormatCtx, scan_packet) >= 0) {
+		if (scan_packet->stream_index == estimated_info.video_stream_index) {
+			int64_t scan_pts = (scan_packet->pts != AV_NOPTS_VALUE) ? scan_packet->pts : scan_packet->dts;
+			double video_seconds = (double(scan_pts) * estimated_info.video_timebase.ToDouble()) + pts_offset;
+			fps_index = int(video_seconds);
+			if (fps_index >= 0 && fps_index < max_fps_index) {
+				starting_frames_detected++;
+				frames_per_second[fps_index]++;
+			}
+			all_frames_detected++;
+		}
+		AV_FREE_PACKET(scan_packet);
+	}
+	delete scan_packet;
+	avformat_close_input(&scanFormatCtx);
+	if (probe_stop)
+		return;
 
-	// Update Duration and Length
-	if (all_frames_detected > 0) {
-		// Use all video frames detected to calculate # of frames
-		info.video_length = all_frames_detected;
-		info.duration = all_frames_detected / avg_fps;
-	} else {
-		// Use previous duration to calculate # of frames
-		info.video_length = info.duration * avg_fps;
+	// Keep the counted info (for the next Open, and for the next readers of this file)
+	update_fps_info(estimated_info, starting_frames_detected, fps_index, max_fps_index, all_frames_detected);
+	{
+		const std::lock_guard<std::mutex> lock(probe_mutex);
+		probed_info = estimated_info;
+		probe_done = true;
 	}
+	ProbeCache::Instance()->Insert("FFmpegReader", path, estimated_info);
 
-	// Update video bit rate
-	info.video_bit_rate = info.file_size / info.duration;
+	ZMQ_DEBUG("FFmpegReader::CountFrames", "video_length", estimated_info.video_length, "fps.num", estimated_info.fps.num);
+}
+
+// Stop (and join) the probe thread
+void FFmpegReader::StopProbe() {
+	probe_stop = true;
+	if (probe_thread.joinable())
+		probe_thread.join();
 }
 
 // Remove AVFrame from cache (and deallocate its memory)
 void FFmpegReader::RemoveAVFrame(AVFrame *remove_frame) {
 	// Remove pFrame (if exists)
 	if (remove_frame) {
-		// Free memory
-		av_freep(&remove_frame->data[0]);
+		// Free memory (frames downloaded from the GPU own reference counted buffers)
+		if (remove_frame->buf[0])
+			av_frame_unref(remove_frame);
+		else
+			av_freep(&remove_frame->data[0]);
 #ifndef WIN32
 		AV_FREE_FRAME(&remove_frame);
 #endif
@@ -2420,6 +2969,7 @@ Json::Value FFmpegReader::JsonValue() const {
 	Json::Value root = ReaderBase::JsonValue(); // get parent properties
 	root["type"] = "FFmpegReader";
 	root["path"] = path;
+	root["proxy_path"] = proxy_path;
 
 	// return JsonValue
 	return root;
@@ -2447,12 +2997,415 @@ void FFmpegReader::SetJsonValue(const Json::Value root) {
 	ReaderBase::SetJsonValue(root);
 
 	// Set data from Json (if key is found)
-	if (!root["path"].isNull())
+	if (!root["path"].isNull() && root["path"].asString() != path) {
 		path = root["path"].asString();
 
+		// The seek index & proxy belong to the previous file
+		ClearSeekIndex();
+		ClearProxy();
+	}
+
 	// Re-Open path, and re-init everything (if needed)
 	if (is_open) {
 		Close();
 		Open();
 	}
+
+	// Set proxy (if key is found)
+	if (!root["proxy_path"].isNull() && root["proxy_path"].asString() != proxy_path) {
+		if (root["proxy_path"].asString().empty()) {
+			ClearProxy();
+		} else {
+			try {
+				SetProxy(root["proxy_path"].asString());
+			}
+			catch (const ExceptionBase& e) {
+				// Missing (or mismatched) proxy, read all frames from the original file
+				ClearProxy();
+			}
+		}
+	}
+}
+
+// Find the nearest indexed key frame before a target
+bool FFmpegReader::FindSeekIndexKeyFrame(int64_t target_pts, int64_t& keyframe_pts, int64_t& keyframe_position) {
+	const std::lock_guard<std::mutex> lock(seek_index_mutex);
+
+	// Find the last key frame before the target (CheckSeek requires landing before the target frame)
+	auto keyframe = seek_index.lower_bound(target_pts);
+	if (keyframe == seek_index.begin())
+		return false;
+	--keyframe;
+
+	keyframe_pts = keyframe->first;
+	keyframe_position = keyframe->second;
+	return true;
+}
+
+// Build the seek index, by scanning all video packets of this file for key frames
+void FFmpegReader::BuildSeekIndex() {
+	// Check for open reader (to know which video stream is used)
+	if (!is_open)
+		throw ReaderClosed("The FFmpegReader is closed.  Call Open() before calling this method.", path);
+	if (!info.has_video)
+		return;
+
+	// Open a separate format context (so the scan does not move this reader's position)
+	AVFormatContext *scanFormatCtx = NULL;
+	if (avformat_open_input(&scanFormatCtx, path.c_str(), NULL, NULL) != 0)
+		throw InvalidFile("File could not be opened.", path);
+	if (avformat_find_stream_info(scanFormatCtx, NULL) < 0) {
+		avformat_close_input(&scanFormatCtx);
+		throw NoStreamsFound("No streams found in file.", path);
+	}
+
+	// Only the video stream's packets are needed
+	for (unsigned int i = 0; i < scanFormatCtx->nb_streams; i++) {
+		if ((int)i != info.video_stream_index)
+			scanFormatCtx->streams[i]->discard = AVDISCARD_ALL;
+	}
+
+	// Loop through all packets, and keep the key frames
+	std::map<int64_t, int64_t> scanned_index;
+	AVPacket *scan_packet = new AVPacket();
+	while (av_read_frame(scanFormatCtx, scan_packet) >= 0) {
+		if (scan_packet->stream_index == info.video_stream_index && (scan_packet->flags & AV_PKT_FLAG_KEY)) {
+			int64_t scan_pts = scan_packet->pts;
+			if (scan_pts == AV_NOPTS_VALUE)
+				scan_pts = scan_packet->dts;
+			if (scan_pts != AV_NOPTS_VALUE)
+				scanned_index[scan_pts] = scan_packet->pos;
+		}
+		AV_FREE_PACKET(scan_packet);
+	}
+	delete scan_packet;
+	avformat_close_input(&scanFormatCtx);
+
+	// Replace the seek index
+	const std::lock_guard<std::mutex> lock(seek_index_mutex);
+	seek_index.swap(scanned_index);
+
+	ZMQ_DEBUG("FFmpegReader::BuildSeekIndex", "key frames", (int64_t) seek_index.size());
+}
+
+// Remove all key frames from the seek index
+void FFmpegReader::ClearSeekIndex() {
+	const std::lock_guard<std::mutex> lock(seek_index_mutex);
+	seek_index.clear();
+}
+
+// Get the number of key frames in the seek index
+int64_t FFmpegReader::GetSeekIndexCount() {
+	const std::lock_guard<std::mutex> lock(seek_index_mutex);
+	return seek_index.size();
+}
+
+// Save the seek index to a (sidecar) JSON file
+void FFmpegReader::SaveSeekIndex(const std::string& index_path) {
+	// Create root json object
+	Json::Value root;
+	root["path"] = path;
+	root["video_stream_index"] = info.video_stream_index;
+
+	// The file the index belongs to (the same key as the ProbeCache)
+	int64_t modified = 0, size = 0;
+	if (ProbeCache::FileStamp(path, modified, size)) {
+		root["modified"] = Json::Int64(modified);
+		root["size"] = Json::Int64(size);
+	}
+	root["keyframes"] = Json::Value(Json::arrayValue);
+	{
+		const std::lock_guard<std::mutex> lock(seek_index_mutex);
+		for (const auto& keyframe : seek_index) {
+			Json::Value entry(Json::arrayValue);
+			entry.append(Json::Int64(keyframe.first));
+			entry.append(Json::Int64(keyframe.second));
+			root["keyframes"].append(entry);
+		}
+	}
+
+	// Write index file
+	std::ofstream index_file(index_path);
+	if (!index_file)
+		throw InvalidFile("Seek index file could not be written.", index_path);
+	index_file << root.toStyledString();
+}
+
+// Load the seek index from a (sidecar) JSON file
+void FFmpegReader::LoadSeekIndex(const std::string& index_path) {
+	// Read index file
+	std::ifstream index_file(index_path);
+	if (!index_file)
+		throw InvalidFile("Seek index file could not be opened.", index_path);
+	std::string contents((std::istreambuf_iterator<char>(index_file)), std::istreambuf_iterator<char>());
+
+	std::map<int64_t, int64_t> loaded_index;
+	int index_stream = -1;
+	std::string index_source;
+	int64_t index_modified = -1, index_size = -1;
+	try
+	{
+		const Json::Value root = openshot::stringToJson(contents);
+		index_stream = root["video_stream_index"].asInt();
+		index_source = root["path"].asString();
+		if (root.isMember("modified") && root.isMember("size")) {
+			index_modified = root["modified"].asInt64();
+			index_size = root["size"].asInt64();
+		}
+		for (const auto& entry : root["keyframes"])
+			loaded_index[entry[0].asInt64()] = entry[1].asInt64();
+	}
+	catch (const std::exception& e)
+	{
+		// Error parsing JSON (or missing keys)
+		throw InvalidJSON("Seek index JSON is invalid (missing keys or invalid data types)");
+	}
+
+	// Don't use an index of a different file (or of this file, before it was changed)
+	int64_t modified = 0, size = 0;
+	if (index_source != path || !ProbeCache::FileStamp(path, modified, size) ||
+		index_modified != modified || index_size != size)
+		throw InvalidJSON("Seek index does not match this file (or the file has changed).");
+
+	// Don't use an index of a different video stream
+	if (index_stream != info.video_stream_index)
+		throw InvalidJSON("Seek index does not match the video stream of this file.");
+
+	// Replace the seek index
+	const std::lock_guard<std::mutex> lock(seek_index_mutex);
+	seek_index.swap(loaded_index);
+}
+
+// Decode the audio stream only (without building frames), in a separate decoder
+int64_t FFmpegReader::ReadAudioSamples(std::function<void(const float *const *samples, int64_t position, int sample_count)> callback,
+									   int64_t start_sample, int64_t end_sample) {
+	// Check for open reader (to know which audio stream is used)
+	if (!is_open)
+		throw ReaderClosed("The FFmpegReader is closed.  Call Open() before calling this method.", path);
+	if (!info.has_audio || info.channels <= 0 || info.sample_rate <= 0)
+		return 0;
+	if (end_sample >= 0 && end_sample <= start_sample)
+		return 0;
+
+	// Open a separate format context (so this does not move this reader's position, and
+	// several segments of the same file can be read at once)
+	AVFormatContext *audioFormatCtx = NULL;
+	if (avformat_open_input(&audioFormatCtx, path.c_str(), NULL, NULL) != 0)
+		throw InvalidFile("File could not be opened.", path);
+	if (avformat_find_stream_info(audioFormatCtx, NULL) < 0) {
+		avformat_close_input(&audioFormatCtx);
+		throw NoStreamsFound("No streams found in file.", path);
+	}
+
+	// Only the audio stream's packets are needed (no video packets are read or decoded)
+	for (unsigned int i = 0; i < audioFormatCtx->nb_streams; i++) {
+		if ((int)i != info.audio_stream_index)
+			audioFormatCtx->streams[i]->discard = AVDISCARD_ALL;
+	}
+	AVStream *audioStream = audioFormatCtx->streams[info.audio_stream_index];
+
+	// Open the audio codec
+	const AVCodec *audioCodec = avcodec_find_decoder(AV_FIND_DECODER_CODEC_ID(audioStream));
+	if (audioCodec == NULL) {
+		avformat_close_input(&audioFormatCtx);
+		throw InvalidCodec("A valid audio codec could not be found for this file.", path);
+	}
+	AVCodecContext *audioCodecCtx = AV_GET_CODEC_CONTEXT(audioStream, audioCodec);
+	audioCodecCtx->thread_count = 1;
+	AVDictionary *opts = NULL;
+	av_dict_set(&opts, "strict", "experimental", 0);
+	if (avcodec_open2(audioCodecCtx, audioCodec, &opts) < 0) {
+		av_dict_free(&opts);
+		AV_FREE_CONTEXT(audioCodecCtx);
+		avformat_close_input(&audioFormatCtx);
+		throw InvalidCodec("An audio codec was found, but could not be opened.", path);
+	}
+	av_dict_free(&opts);
+
+	// Sample positions are relative to the start of the audio stream
+	const AVRational sample_time_base = {1, info.sample_rate};
+	const int64_t stream_start = (audioStream->start_time != AV_NOPTS_VALUE) ? audioStream->start_time : 0;
+
+	// Seek a little before the first sample (so the decoder has settled once it gets there)
+	if (start_sample > 0) {
+		const int64_t preroll_sample = std::max(int64_t(0), start_sample - info.sample_rate);
+		const int64_t seek_target = stream_start + av_rescale_q(preroll_sample, sample_time_base, audioStream->time_base);
+		if (av_seek_frame(audioFormatCtx, info.audio_stream_index, seek_target, AVSEEK_FLAG_BACKWARD) < 0)
+			ZMQ_DEBUG("FFmpegReader::ReadAudioSamples (seek failed, decoding from the start)", "start_sample", start_sample);
+	}
+
+	// Converts the decoded samples to float planar (the same layout as the Frame's juce::AudioBuffer<float>).
+	// It is set up with the format of the first decoded block.
+	SWRCONTEXT *audioResampler = NULL;
+	uint8_t **converted = NULL;
+	int converted_linesize = 0;
+	int converted_capacity = 0;
+	std::vector<const float *> channels(info.channels);
+
+	AVFrame *decoded_frame = AV_ALLOCATE_FRAME();
+	AVPacket *audio_packet = new AVPacket();
+	int64_t position = -1;
+	int64_t delivered = 0;
+	bool finished = false;
+	bool draining = false;
+
+	// Pass the samples of a decoded block to the callback (returns false once the end sample is reached)
+	auto deliver = [&]() {
+		// Position of the first block comes from its timestamp (the following blocks are contiguous)
+		if (position < 0) {
+			int64_t pts = decoded_frame->best_effort_timestamp;
+			if (pts == AV_NOPTS_VALUE)
+				pts = decoded_frame->pts;
+			position = (pts != AV_NOPTS_VALUE) ?
+				std::max(int64_t(0), av_rescale_q(pts - stream_start, audioStream->time_base, sample_time_base)) :
+				start_sample;
+		}
+
+		if (!audioResampler) {
+			audioResampler = SWR_ALLOC();
+			av_opt_set_int(audioResampler, "in_channel_layout", AV_GET_CODEC_ATTRIBUTES(aStream, aCodecCtx)->channel_layout, 0);
+			av_opt_set_int(audioResampler, "out_channel_layout", AV_GET_CODEC_ATTRIBUTES(aStream, aCodecCtx)->channel_layout, 0);
+			av_opt_set_int(audioResampler, "in_sample_fmt", decoded_frame->format, 0);
+			av_opt_set_int(audioResampler, "out_sample_fmt", AV_SAMPLE_FMT_FLTP, 0);
+			av_opt_set_int(audioResampler, "in_sample_rate", info.sample_rate, 0);
+			av_opt_set_int(audioResampler, "out_sample_rate", info.sample_rate, 0);
+			av_opt_set_int(audioResampler, "in_channels", info.channels, 0);
+			av_opt_set_int(audioResampler, "out_channels", info.channels, 0);
+			SWR_INIT(audioResampler);
+		}
+
+		// Grow the re-used output buffer (if needed)
+		if (!converted || converted_capacity < decoded_frame->nb_samples) {
+			if (converted) {
+				av_freep(&converted[0]);
+				av_freep(&converted);
+			}
+			if (av_samples_alloc_array_and_samples(&converted, &converted_linesize, info.channels,
+												   decoded_frame->nb_samples, AV_SAMPLE_FMT_FLTP, 0) < 0) {
+				converted = NULL;
+				converted_capacity = 0;
+				return false;
+			}
+			converted_capacity = decoded_frame->nb_samples;
+		}
+
+		const int sample_count = SWR_CONVERT(audioResampler, converted, converted_linesize, converted_capacity,
+											 decoded_frame->data, decoded_frame->linesize[0], decoded_frame->nb_samples);
+		AV_RESET_FRAME(decoded_frame);
+		if (sample_count <= 0)
+			return true;
+
+		// Skip the samples before the start (and after the end)
+		const int64_t first = std::max(position, start_sample);
+		int64_t last = position + sample_count;
+		bool keep_reading = true;
+		if (end_sample >= 0 && last >= end_sample) {
+			last = end_sample;
+			keep_reading = false;
+		}
+		if (last > first) {
+			for (int channel = 0; channel < info.channels; channel++)
+				channels[channel] = ((const float *) converted[channel]) + (first - position);
+			callback(channels.data(), first, int(last - first));
+			delivered += last - first;
+		}
+		position += sample_count;
+		return keep_reading;
+	};
+
+	while (!finished) {
+#if IS_FFMPEG_3_2
+		// Send the next audio packet to the decoder (or flush it at the end of the file)
+		if (!draining) {
+			if (av_read_frame(audioFormatCtx, audio_packet) < 0) {
+				draining = true;
+				avcodec_send_packet(audioCodecCtx, NULL);
+			} else {
+				if (audio_packet->stream_index == info.audio_stream_index)
+					avcodec_send_packet(audioCodecCtx, audio_packet);
+				AV_FREE_PACKET(audio_packet);
+			}
+		}
+
+		// Receive all decoded blocks
+		int receive_err = 0;
+		while (!finished && (receive_err = avcodec_receive_frame(audioCodecCtx, decoded_frame)) >= 0)
+			finished = !deliver();
+
+		// The decoder is empty (at the end of the file)
+		if (draining && receive_err < 0)
+			finished = true;
+#else
+		// Decode the next audio packet
+		if (av_read_frame(audioFormatCtx, audio_packet) < 0)
+			break;
+		int frame_finished = 0;
+		if (audio_packet->stream_index == info.audio_stream_index)
+			avcodec_decode_audio4(audioCodecCtx, decoded_frame, &frame_finished, audio_packet);
+		AV_FREE_PACKET(audio_packet);
+		if (frame_finished)
+			finished = !deliver();
+#endif
+	}
+
+	// Free everything
+	delete audio_packet;
+	AV_FREE_FRAME(&decoded_frame);
+	if (converted) {
+		av_freep(&converted[0]);
+		av_freep(&converted);
+	}
+	if (audioResampler) {
+		SWR_CLOSE(audioResampler);
+		SWR_FREE(&audioResampler);
+	}
+	AV_FREE_CONTEXT(audioCodecCtx);
+	avformat_close_input(&audioFormatCtx);
+
+	return delivered;
+}
+
+// Set a low resolution proxy of this file
+void FFmpegReader::SetProxy(const std::string& new_proxy_path) {
+	// Inspect the proxy (or throw exception)
+	std::shared_ptr<FFmpegReader> proxy = std::make_shared<FFmpegReader>(new_proxy_path);
+
+	// Proxy frames replace the frames of this file, so the frame rate, length and audio must match
+	bool same_fps = proxy->info.fps.num * info.fps.den == info.fps.num * proxy->info.fps.den;
+	bool same_length = std::abs(proxy->info.video_length - info.video_length) <= 1;
+	bool same_audio = proxy->info.has_audio == info.has_audio &&
+		(!info.has_audio || (proxy->info.sample_rate == info.sample_rate && proxy->info.channels == info.channels));
+	if (!proxy->info.has_video || !same_fps || !same_length || !same_audio)
+		throw InvalidFile("The proxy does not match the frame rate, length or audio of the original file.", new_proxy_path);
+
+	// Open the proxy (if this reader is already open)
+	if (is_open)
+		proxy->Open();
+
+	const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+	std::atomic_store(&proxy_reader, proxy);
+	proxy_path = new_proxy_path;
+}
+
+// Stop using the proxy (if any)
+void FFmpegReader::ClearProxy() {
+	const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+	std::atomic_store(&proxy_reader, std::shared_ptr<FFmpegReader>());
+	proxy_path.clear();
+}
+
+// Determine if frames are currently read from the proxy
+bool FFmpegReader::IsUsingProxy() {
+	std::shared_ptr<FFmpegReader> proxy = std::atomic_load(&proxy_reader);
+	if (!proxy || !proxy->IsOpen())
+		return false;
+
+	// Only read from the proxy for a timeline preview (a reader without a timeline always uses this file)
+	Clip *parent = static_cast<Clip *>(ParentClip());
+	if (!parent || !parent->ParentTimeline())
+		return false;
+
+	// Use the proxy if its images are as large as the (scaled) images from this file
+	QSize scaled_size = GetScaledImageSize();
+	return scaled_size.width() <= proxy->info.width && scaled_size.height() <= proxy->info.height;
 }
@@ -21,15 +21,25 @@
 // Include FFmpeg headers and macros
 #include "FFmpegUtilities.h"
 
+#include <atomic>
 #include <cmath>
+#include <condition_variable>
 #include <ctime>
+#include <functional>
 #include <iostream>
 #include <stdio.h>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+#include <QSize>
 #include "AudioLocation.h"
 #include "CacheMemory.h"
 #include "Clip.h"
 #include "OpenMPUtilities.h"
+#include "ReadAheadIO.h"
 #include "Settings.h"
 
 
@@ -107,10 +117,16 @@ namespace openshot {
 		AVCodecContext *pCodecCtx, *aCodecCtx;
 #if USE_HW_ACCEL
 		AVBufferRef *hw_device_ctx = NULL; //PM
+		int hw_device_index = -1; ///< The GPU of the hardware decoder (see HardwareDevices)
 #endif
 		AVStream *pStream, *aStream;
 		AVPacket *packet;
 		AVFrame *pFrame;
+		SwsContext *img_convert_ctx; ///< Cached scaler (re-used while the source format, sizes and scale mode match)
+		SWRCONTEXT *avr; ///< Cached audio resampler (decoded format to float planar)
+		uint8_t **audio_converted; ///< Re-used float planar output buffer for the audio resampler (one plane per channel)
+		int audio_converted_linesize; ///< Size of each audio_converted plane (in bytes)
+		int audio_converted_capacity; ///< Number of samples (per channel) audio_converted can hold
 		bool is_open;
 		bool is_duration_known;
 		bool check_interlace;
@@ -118,6 +134,7 @@ namespace openshot {
 		int max_concurrent_frames;
 
 		CacheMemory working_cache;
+		std::set<int64_t> working_frame_numbers; ///< The numbers of the frames in working_cache (in PTS order, so they finish in order)
 		AudioLocation previous_packet_location;
 
 		// DEBUG VARIABLES (FOR AUDIO ISSUES)
@@ -148,6 +165,84 @@ namespace openshot {
 		int64_t NO_PTS_OFFSET;
 		PacketStatus packet_status;
 
+		/// Seek index: PTS of each video key frame (in the video stream's timebase) -> byte position of its packet
+		std::map<int64_t, int64_t> seek_index;
+		std::mutex seek_index_mutex;
+
+		/// Low resolution proxy of this file (if any), used instead of this file for small previews
+		std::string proxy_path;
+		std::shared_ptr<openshot::FFmpegReader> proxy_reader;
+
+		/// Decode-ahead worker (see Settings::DECODE_AHEAD_FRAMES)
+		std::thread decode_ahead_thread;
+		std::mutex decode_ahead_mutex;
+		std::condition_variable decode_ahead_condition;
+		bool decode_ahead_stop;
+		int64_t decode_ahead_next; ///< The next frame to decode ahead
+		int64_t decode_ahead_target; ///< The last frame to decode ahead (0 = idle, until the next sequential request)
+		int64_t last_requested_frame; ///< The previous frame requested by GetFrame (to detect sequential access)
+		int sequential_requests; ///< The number of frames requested in a row
+		bool sequential_hint; ///< Frames are requested in order, even if the requests arrive out of order (see SetSequentialHint)
+
+		/// Decoder threading (see Settings::DECODER_THREAD_TYPE)
+		bool slice_threading; ///< The video decoder only uses slice threads
+		int open_hardware_decoder; ///< The hardware decoder setting the decoders were opened with (see DecoderPool)
+		int open_decoder_threads; ///< The number of threads the decoders were opened with (see DecoderPool)
+		int scrub_seeks; ///< The number of seeks since frames were last decoded in order
+		int sequential_decodes; ///< The number of frames decoded in order since the last seek
+
+		/// Reverse decoding (see Settings::REVERSE_DECODE_FRAMES)
+		int reverse_requests; ///< The number of frames requested in a row, backwards
+		int64_t reverse_chunk_start; ///< The first frame of the last chunk decoded for reverse requests
+		int64_t reverse_chunk_end; ///< The last frame of the last chunk decoded for reverse requests
+		int64_t reverse_prefetch_frame; ///< The last frame of the next chunk to decode on the decode-ahead thread (0 = idle)
+		int64_t reverse_prefetch_requested; ///< The last frame of the last chunk requested from the decode-ahead thread
+		bool reverse_cache_enlarged; ///< The final cache is enlarged to hold the reverse chunks
+
+		/// Decode frames ahead of sequential requests (called on the decode-ahead thread)
+		void DecodeAhead();
+
+		/// @brief Track the requested frames, and decode ahead of sequential requests (starting the thread if needed)
+		/// @returns True if the frames are requested backwards (and should be decoded with DecodeReverseChunk)
+		bool RequestDecodeAhead(int64_t requested_frame);
+
+		/// Start the decode-ahead thread (if it's not running), and wake it up
+		void StartDecodeAhead(std::unique_lock<std::mutex>& lock);
+
+		/// Decode a chunk of frames which ends with a frame (for reverse requests), with a single seek
+		std::shared_ptr<openshot::Frame> DecodeReverseChunk(int64_t end_frame);
+
+		/// Stop (and join) the decode-ahead thread
+		void StopDecodeAhead();
+
+		/// Background frame count, for files without a valid frame rate or length (see Settings::ENABLE_FAST_PROBE)
+		bool is_estimated_length; ///< The FPS and length are estimated (until the frames are counted)
+		std::thread probe_thread;
+		std::atomic<bool> probe_stop;
+		std::mutex probe_mutex;
+		bool probe_done; ///< The frames are counted (and probed_info is valid)
+		openshot::ReaderInfo probed_info; ///< The info with the counted FPS and length
+
+		/// Count the video frames of the file, like CheckFPS (called on the probe thread)
+		void CountFrames(openshot::ReaderInfo estimated_info, double pts_offset);
+
+		/// Stop (and join) the probe thread
+		void StopProbe();
+
+		/// Read-ahead I/O of the file (if enabled, see Settings::ENABLE_READ_AHEAD_IO)
+		std::unique_ptr<openshot::ReadAheadIO> read_ahead_io;
+
+		/// Decoded frames shared with the other readers of this file (see SourceFrameCache)
+		std::shared_ptr<openshot::CacheMemory> shared_cache;
+		QSize shared_cache_size; ///< The image size of the shared cache
+
+		/// Get a frame decoded by another reader of this file (if any)
+		std::shared_ptr<openshot::Frame> GetSharedFrame(int64_t requested_frame);
+
+		/// @brief Find the nearest indexed key frame before a target (if the seek index is loaded)
+		/// @returns True if an indexed key frame was found (and sets its PTS and byte position)
+		bool FindSeekIndexKeyFrame(int64_t target_pts, int64_t& keyframe_pts, int64_t& keyframe_position);
+
 		int hw_de_supported = 0;	// Is set by FFmpegReader
 #if USE_HW_ACCEL
 		AVPixelFormat hw_de_av_pix_fmt = AV_PIX_FMT_NONE;
@@ -176,6 +271,9 @@ namespace openshot {
 		/// Create a new Frame (or return an existing one) and add it to the working queue.
 		std::shared_ptr<openshot::Frame> CreateFrame(int64_t requested_frame);
 
+		/// Add a frame to the working cache (and track its number, for CheckWorkingFrames)
+		void AddWorkingFrame(std::shared_ptr<openshot::Frame> frame);
+
 		/// Calculate Starting video frame and sample # for an audio PTS
 		AudioLocation GetAudioPTSLocation(int64_t pts);
 
@@ -188,9 +286,23 @@ namespace openshot {
 		/// Get the PTS for the current packet
 		int64_t GetPacketPTS();
 
+		/// Get the size decoded images are scaled to (based on the parent clip & timeline)
+		QSize GetScaledImageSize();
+
+		/// Is the parent clip's timeline rendering draft quality previews? (see Timeline::SetRenderQuality)
+		bool IsDraftQuality();
+
+		/// Get the timeline of the parent clip (if any), which can override the global Settings
+		openshot::TimelineBase* ParentTimeline();
+
 		/// Check if there's an album art
 		bool HasAlbumArt();
 
+		/// @brief Switch the video decoder between slice and frame threads, for the access pattern (see Settings::DECODER_THREAD_TYPE)
+		/// @returns True if the video decoder was reopened (and the stream needs a seek to a key frame)
+		/// @param seeking Is the stream about to seek (otherwise it continues in order)
+		bool UpdateDecoderThreading(bool seeking);
+
 		/// Remove partial frames due to seek
 		bool IsPartialFrame(int64_t requested_frame);
 
@@ -269,8 +381,70 @@ namespace openshot {
 		/// Open File - which is called by the constructor automatically
 		void Open() override;
 
+		/// @brief Decode ahead from the first request, while frames are requested in order (i.e. by a
+		/// FrameIterator, whose parallel requests can arrive out of order)
+		void SetSequentialHint(bool sequential) override;
+
 		/// Return true if frame can be read with GetFrame()
 		bool GetIsDurationKnown();
+
+		/// @brief Build the seek index, by scanning all video packets of this file for key frames.
+		///
+		/// Once the seek index is built (or loaded), seeks jump directly to the nearest key frame before
+		/// the requested frame, instead of guessing a timestamp and seeking again if it lands too late.
+		/// This only reads packets (no decoding), and can be called from a background thread. The reader
+		/// must be open.
+		void BuildSeekIndex();
+
+		/// Remove all key frames from the seek index (seeks fall back to guessing a timestamp)
+		void ClearSeekIndex();
+
+		/// Get the number of key frames in the seek index (0 if it has not been built or loaded)
+		int64_t GetSeekIndexCount();
+
+		/// @brief Save the seek index to a (sidecar) JSON file
+		/// @param index_path The file to write (i.e. the media path with a ".seekindex" extension)
+		void SaveSeekIndex(const std::string& index_path);
+
+		/// @brief Load the seek index from a (sidecar) JSON file, saved with SaveSeekIndex()
+		///
+		/// Throws InvalidJSON if the index was saved for another file, or if the file has changed since (its
+		/// size or modification time).
+		/// @param index_path The file to read
+		void LoadSeekIndex(const std::string& index_path);
+
+		/// @brief Decode the audio stream only, without building (or caching) any frames.
+		///
+		/// The audio is demuxed and decoded by a separate decoder (so this reader's position does not change,
+		/// and several ranges of the same file can be read at once, from different threads). The samples are
+		/// converted to float planar, and passed to the callback in order. This is much faster than reading
+		/// every frame with GetFrame(), when only the audio is needed (i.e. openshot::AudioWaveformer).
+		/// The reader must be open.
+		/// @returns The number of samples passed to the callback
+		/// @param callback Receives the channel pointers, the position of the first sample (at info.sample_rate, from
+		/// the start of the audio stream) and the number of samples of each decoded block
+		/// @param start_sample The first sample to read
+		/// @param end_sample The sample after the last one to read (or -1 to read until the end of the stream)
+		int64_t ReadAudioSamples(std::function<void(const float *const *samples, int64_t position, int sample_count)> callback,
+								 int64_t start_sample = 0, int64_t end_sample = -1);
+
+		/// @brief Set a low resolution proxy of this file (i.e. generated with openshot::ProxyGenerator)
+		///
+		/// When the parent timeline only needs a small preview (see Timeline::SetMaxSize), frames are
+		/// read from the proxy instead of this file. When a larger image is needed (i.e. final export),
+		/// frames are read from this file again. The proxy must match the frame rate, length and
+		/// audio of this file.
+		/// @param proxy_path The proxy file to read
+		void SetProxy(const std::string& proxy_path);
+
+		/// Stop using the proxy (if any), and read all frames from this file
+		void ClearProxy();
+
+		/// Get the path of the proxy (or an empty string if no proxy has been set)
+		std::string GetProxy() const { return proxy_path; };
+
+		/// Determine if frames are currently read from the proxy (based on the parent timeline's preview size)
+		bool IsUsingProxy();
 	};
 
 }
@@ -33,6 +33,11 @@
 #define USE_SW FFMPEG_USE_SWRESAMPLE
 #endif
 
+// Slice threading in swscale (sws_scale_frame and the "threads" option)
+#ifndef USE_SWS_THREADS
+#define USE_SWS_THREADS (LIBSWSCALE_VERSION_INT >= AV_VERSION_INT(6, 1, 100))
+#endif
+
 // Include the FFmpeg headers
 extern "C" {
     #include <libavcodec/avcodec.h>
@@ -49,6 +54,7 @@ extern "C" {
     #include <libavresample/avresample.h>
 #endif
 
+    #include <libavutil/audio_fifo.h>
     #include <libavutil/mathematics.h>
     #include <libavutil/pixfmt.h>
     #include <libavutil/pixdesc.h>
@@ -121,6 +127,16 @@ inline static bool ffmpeg_has_alpha(PixelFormat pix_fmt) {
     return bool(fmt_desc->flags & AV_PIX_FMT_FLAG_ALPHA);
 }
 
+// Does ffmpeg pixel format have more than 8 bits per component (i.e. 10-bit video)?
+inline static bool ffmpeg_high_bit_depth(PixelFormat pix_fmt) {
+    const AVPixFmtDescriptor *fmt_desc = av_pix_fmt_desc_get(pix_fmt);
+#if LIBAVUTIL_VERSION_MAJOR >= 55
+    return fmt_desc && fmt_desc->comp[0].depth > 8;
+#else
+    return fmt_desc && fmt_desc->comp[0].depth_minus1 >= 8;
+#endif
+}
+
 // FFmpeg's libavutil/common.h defines an RSHIFT incompatible with Ruby's
 // definition in ruby/config.h, so we move it to FF_RSHIFT
 #ifdef RSHIFT
@@ -14,34 +14,81 @@
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
 #include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <exception>
+#include <fcntl.h>
 #include <iostream>
 #include <cmath>
+#include <cstring>
 #include <ctime>
+#include <map>
+#include <mutex>
+#include <thread>
 #include <unistd.h>
 
 #include "FFmpegUtilities.h"
 
 #include "FFmpegWriter.h"
+#include "AllocationStats.h"
 #include "Exceptions.h"
 #include "Frame.h"
+#include "HardwareDevices.h"
 #include "OpenMPUtilities.h"
+#include "RenderStats.h"
+#include "RenderTrace.h"
 #include "Settings.h"
+#include "ThreadAffinity.h"
 #include "ZmqLogger.h"
 
 using namespace openshot;
 
+// Get the muxer of a streaming URL (which has no file extension), or nullptr for files
+static const char *stream_format_name(const std::string& path)
+{
+	if (path.rfind("rtmp://", 0) == 0 || path.rfind("rtmps://", 0) == 0)
+		return "flv";
+	if (path.rfind("srt://", 0) == 0 || path.rfind("udp://", 0) == 0 || path.rfind("tcp://", 0) == 0)
+		return "mpegts";
+	return nullptr;
+}
+
+// The size of the output buffer of local files (when muxing asynchronously)
+static const int OUTPUT_BUFFER_SIZE = 8 * 1024 * 1024;
+
+// Direct I/O writes blocks (and memory) aligned to this size
+static const int DIRECT_IO_ALIGNMENT = 4096;
+
 // Multiplexer parameters temporary storage
 AVDictionary *mux_dict = NULL;
 
 #if USE_HW_ACCEL
-int hw_en_on = 1;					// Is set in UI
-int hw_en_supported = 0;	// Is set by FFmpegWriter
-AVPixelFormat hw_en_av_pix_fmt = AV_PIX_FMT_NONE;
-AVHWDeviceType hw_en_av_device_type = AV_HWDEVICE_TYPE_VAAPI;
-static AVBufferRef *hw_device_ctx = NULL;
-AVFrame *hw_frame = NULL;
-
-static int set_hwframe_ctx(AVCodecContext *ctx, AVBufferRef *hw_device_ctx, int64_t width, int64_t height)
+// Find the format to upload images in. RGBA is uploaded as is, when the encoder (i.e. NVENC)
+// converts it on the GPU, which skips the RGBA to YUV conversion on the CPU. Otherwise NV12.
+static AVPixelFormat hw_upload_pix_fmt(const AVCodec *codec, AVBufferRef *hw_device_ctx)
+{
+	bool encoder_rgba = false;
+	if (codec && codec->pix_fmts) {
+		for (const AVPixelFormat *p = codec->pix_fmts; *p != AV_PIX_FMT_NONE; p++)
+			if (*p == PIX_FMT_RGBA)
+				encoder_rgba = true;
+	}
+	if (!encoder_rgba)
+		return AV_PIX_FMT_NV12;
+
+	// The device must also support RGBA surfaces
+	AVPixelFormat pix_fmt = AV_PIX_FMT_NV12;
+	AVHWFramesConstraints *constraints = av_hwdevice_get_hwframe_constraints(hw_device_ctx, NULL);
+	if (constraints && constraints->valid_sw_formats) {
+		for (const AVPixelFormat *p = constraints->valid_sw_formats; *p != AV_PIX_FMT_NONE; p++)
+			if (*p == PIX_FMT_RGBA)
+				pix_fmt = PIX_FMT_RGBA;
+	}
+	av_hwframe_constraints_free(&constraints);
+	return pix_fmt;
+}
+
+static int set_hwframe_ctx(AVCodecContext *ctx, AVBufferRef *hw_device_ctx, AVPixelFormat format, AVPixelFormat sw_format, int64_t width, int64_t height, int pool_size)
 {
 	AVBufferRef *hw_frames_ref;
 	AVHWFramesContext *frames_ctx = NULL;
@@ -52,11 +99,11 @@ static int set_hwframe_ctx(AVCodecContext *ctx, AVBufferRef *hw_device_ctx, int6
 		return -1;
 	}
 	frames_ctx = (AVHWFramesContext *)(hw_frames_ref->data);
-	frames_ctx->format = hw_en_av_pix_fmt;
-	frames_ctx->sw_format = AV_PIX_FMT_NV12;
+	frames_ctx->format = format;
+	frames_ctx->sw_format = sw_format;
 	frames_ctx->width = width;
 	frames_ctx->height = height;
-	frames_ctx->initial_pool_size = 20;
+	frames_ctx->initial_pool_size = pool_size;
 	if ((err = av_hwframe_ctx_init(hw_frames_ref)) < 0) {
 		std::clog << "Failed to initialize HW frame context. " <<
 			"Error code: " << av_err2string(err) << "\n";
@@ -70,15 +117,34 @@ static int set_hwframe_ctx(AVCodecContext *ctx, AVBufferRef *hw_device_ctx, int6
 	av_buffer_unref(&hw_frames_ref);
 	return err;
 }
+
+// Find a software encoder of a codec (to encode with, when no GPU is available)
+static const AVCodec *find_software_encoder(AVCodecID codec_id)
+{
+#if (LIBAVCODEC_VERSION_MAJOR >= 58)
+	void *opaque = NULL;
+	const AVCodec *codec;
+	while ((codec = av_codec_iterate(&opaque))) {
+		if (av_codec_is_encoder(codec) && codec->id == codec_id && !(codec->capabilities & AV_CODEC_CAP_HARDWARE))
+			return codec;
+	}
+	return NULL;
+#else
+	return avcodec_find_encoder(codec_id);
+#endif
+}
 #endif // USE_HW_ACCEL
 
 FFmpegWriter::FFmpegWriter(const std::string& path) :
-		path(path), oc(NULL), audio_st(NULL), video_st(NULL), samples(NULL),
-		audio_outbuf(NULL), audio_outbuf_size(0), audio_input_frame_size(0), audio_input_position(0),
-		initial_audio_input_frame_size(0), img_convert_ctx(NULL), cache_size(1), num_of_rescalers(1),
-		rescaler_position(0), video_codec_ctx(NULL), audio_codec_ctx(NULL), is_writing(false), video_timestamp(0), audio_timestamp(0),
-		original_sample_rate(0), original_channels(0), avr(NULL), avr_planar(NULL), is_open(false), prepare_streams(false),
-		write_header(false), write_trailer(false), audio_encoder_buffer_size(0), audio_encoder_buffer(NULL) {
+		path(path), oc(NULL), audio_st(NULL), video_st(NULL), audio_fifo(NULL), audio_fifo_frame(NULL),
+		audio_converted(NULL), audio_converted_capacity(0), audio_input_frame_size(0),
+		initial_audio_input_frame_size(0), img_convert_ctx(NULL), cache_size(8), num_of_rescalers(OPEN_MP_NUM_PROCESSORS),
+		render_threads(1), video_codec_ctx(NULL), audio_codec_ctx(NULL), is_writing(false), video_timestamp(0), audio_timestamp(0),
+		original_sample_rate(0), original_channels(0), avr(NULL), is_open(false), prepare_streams(false),
+		write_header(false), write_trailer(false), audio_encoder_buffer_size(0), audio_encoder_buffer(NULL),
+		is_live(false), live_latency_ms(1000), live_frames(0), dropped_frames(0), live_wait_for_keyframe(false),
+		is_vfr(false), last_video_frame_elided(false), elided_frames(0), is_async(false), mux_buffer_bytes(64 * 1024 * 1024), mux_queued_bytes(0), mux_stopping(false), mux_error(0),
+		use_direct_io(false), output_fd(-1), output_direct_fd(-1), output_position(0), output_buffer(NULL) {
 
 	// Disable audio & video (so they can be independently enabled)
 	info.has_audio = false;
@@ -97,6 +163,9 @@ void FFmpegWriter::Open() {
 		// Open the writer
 		is_open = true;
 
+		// Start the encoder threads on the NUMA node of the render (if any, see Settings::NUMA_NODE)
+		ScopedNodeAffinity affinity;
+
 		// Prepare streams (if needed)
 		if (!prepare_streams)
 			PrepareStreams();
@@ -116,15 +185,21 @@ void FFmpegWriter::Open() {
 // auto detect format (from path)
 void FFmpegWriter::auto_detect_format() {
 
-	// Allocate the output media context
-	AV_OUTPUT_CONTEXT(&oc, path.c_str());
+	// Allocate the output media context (streaming URLs choose their muxer by protocol)
+	const char *format_name = stream_format_name(path);
+	if (format_name) {
+		avformat_network_init();
+		avformat_alloc_output_context2(&oc, NULL, format_name, path.c_str());
+	} else {
+		AV_OUTPUT_CONTEXT(&oc, path.c_str());
+	}
 	if (!oc) {
 		throw OutOfMemory(
 			"Could not allocate memory for AVFormatContext.", path);
 	}
 
 	// Determine what format to use when encoding this output filename
-	oc->oformat = av_guess_format(NULL, path.c_str(), NULL);
+	oc->oformat = av_guess_format(format_name, path.c_str(), NULL);
 	if (oc->oformat == nullptr) {
 		throw InvalidFormat(
 			"Could not deduce output format from file extension.", path);
@@ -141,7 +216,7 @@ void FFmpegWriter::auto_detect_format() {
 
 // initialize streams
 void FFmpegWriter::initialize_streams() {
-	ZmqLogger::Instance()->AppendDebugMethod(
+	ZMQ_DEBUG(
 		"FFmpegWriter::initialize_streams",
 		"oc->oformat->video_codec", oc->oformat->video_codec,
 		"oc->oformat->audio_codec", oc->oformat->audio_codec,
@@ -262,7 +337,7 @@ void FFmpegWriter::SetVideoOptions(bool has_video, std::string codec, Fraction f
 	info.display_ratio.num = size.num;
 	info.display_ratio.den = size.den;
 
-	ZmqLogger::Instance()->AppendDebugMethod(
+	ZMQ_DEBUG(
 		"FFmpegWriter::SetVideoOptions (" + codec + ")",
 		"width", width, "height", height,
 		"size.num", size.num, "size.den", size.den,
@@ -308,7 +383,7 @@ void FFmpegWriter::SetAudioOptions(bool has_audio, std::string codec, int sample
 	if (original_channels == 0)
 		original_channels = info.channels;
 
-	ZmqLogger::Instance()->AppendDebugMethod(
+	ZMQ_DEBUG(
 		"FFmpegWriter::SetAudioOptions (" + codec + ")",
 		"sample_rate", sample_rate,
 		"channels", channels,
@@ -329,6 +404,33 @@ void FFmpegWriter::SetAudioOptions(std::string codec, int sample_rate, int bit_r
 }
 
 
+// Stream in real time (instead of writing as fast as possible)
+void FFmpegWriter::SetLive(bool live, int max_latency_ms) {
+	if (is_open)
+		throw InvalidOptions("Live streaming must be set before the writer is opened.", path);
+
+	is_live = live;
+	live_latency_ms = std::max(max_latency_ms, 1);
+}
+
+// Elide repeated images from the video (a variable frame rate)
+void FFmpegWriter::SetVariableFrameRate(bool vfr) {
+	if (is_open)
+		throw InvalidOptions("Variable frame rate must be set before the writer is opened.", path);
+
+	is_vfr = vfr;
+}
+
+// Mux the encoded packets on a thread of their own
+void FFmpegWriter::SetAsyncMuxing(bool async, int buffer_mb, bool direct_io) {
+	if (is_open)
+		throw InvalidOptions("Asynchronous muxing must be set before the writer is opened.", path);
+
+	is_async = async;
+	mux_buffer_bytes = int64_t(std::max(buffer_mb, 1)) * 1024 * 1024;
+	use_direct_io = direct_io;
+}
+
 // Set custom options (some codecs accept additional params)
 void FFmpegWriter::SetOption(StreamType stream, std::string name, std::string value) {
 	// Declare codec context
@@ -578,7 +680,7 @@ void FFmpegWriter::SetOption(StreamType stream, std::string name, std::string va
 			AV_OPTION_SET(st, c->priv_data, name.c_str(), value.c_str(), c);
 		}
 
-		ZmqLogger::Instance()->AppendDebugMethod(
+		ZMQ_DEBUG(
 			"FFmpegWriter::SetOption (" + (std::string)name + ")",
 			"stream == VIDEO_STREAM", stream == VIDEO_STREAM);
 
@@ -616,7 +718,7 @@ void FFmpegWriter::PrepareStreams() {
 	if (!info.has_audio && !info.has_video)
 		throw InvalidOptions("No video or audio options have been set.  You must set has_video or has_audio (or both).", path);
 
-	ZmqLogger::Instance()->AppendDebugMethod(
+	ZMQ_DEBUG(
 		"FFmpegWriter::PrepareStreams [" + path + "]",
 		"info.has_audio", info.has_audio,
 		"info.has_video", info.has_video);
@@ -633,9 +735,15 @@ void FFmpegWriter::WriteHeader() {
 	if (!info.has_audio && !info.has_video)
 		throw InvalidOptions("No video or audio options have been set.  You must set has_video or has_audio (or both).", path);
 
-	// Open the output file, if needed
-	if (!(oc->oformat->flags & AVFMT_NOFILE)) {
-		if (avio_open(&oc->pb, path.c_str(), AVIO_FLAG_WRITE) < 0)
+	// Open the output file, if needed (a local file muxed asynchronously is written through a large buffer of
+	// our own, and a live stream gives up on a stalled connection, instead of blocking forever)
+	if (!(oc->oformat->flags & AVFMT_NOFILE) && !(is_async && !is_live && open_output_file())) {
+		AVDictionary *io_options = NULL;
+		if (is_live)
+			av_dict_set(&io_options, "rw_timeout", "5000000", 0);
+		const int error_code = avio_open2(&oc->pb, path.c_str(), AVIO_FLAG_WRITE, NULL, &io_options);
+		av_dict_free(&io_options);
+		if (error_code < 0)
 			throw InvalidFile("Could not open or write file.", path);
 	}
 
@@ -656,9 +764,24 @@ void FFmpegWriter::WriteHeader() {
 	if (is_mp4 || is_mov)
 		av_dict_copy(&dict, mux_dict, 0);
 
+	if (is_live) {
+		// Send each packet right away, and only wait for the other stream's packets within the latency
+		oc->flags |= AVFMT_FLAG_FLUSH_PACKETS;
+		oc->max_interleave_delta = int64_t(live_latency_ms) * 1000;
+
+		// Fragmented MP4, and a sliding window of HLS segments (so the stream can be played while it is written)
+		if (strcmp(oc->oformat->name, "mp4") == 0 || strcmp(oc->oformat->name, "mov") == 0) {
+			av_dict_set(&dict, "movflags", "frag_keyframe+empty_moov+default_base_moof", AV_DICT_DONT_OVERWRITE);
+		} else if (strcmp(oc->oformat->name, "hls") == 0) {
+			av_dict_set(&dict, "hls_time", "2", AV_DICT_DONT_OVERWRITE);
+			av_dict_set(&dict, "hls_list_size", "6", AV_DICT_DONT_OVERWRITE);
+			av_dict_set(&dict, "hls_flags", "delete_segments+independent_segments", AV_DICT_DONT_OVERWRITE);
+		}
+	}
+
 	// Write the stream header
 	if (avformat_write_header(oc, &dict) != 0) {
-		ZmqLogger::Instance()->AppendDebugMethod(
+		ZMQ_DEBUG(
 			"FFmpegWriter::WriteHeader (avformat_write_header)");
 		throw InvalidFile("Could not write header to file.", path);
 	};
@@ -670,24 +793,53 @@ void FFmpegWriter::WriteHeader() {
 	// Mark as 'written'
 	write_header = true;
 
-	ZmqLogger::Instance()->AppendDebugMethod("FFmpegWriter::WriteHeader");
+	// Start muxing the packets on a thread of their own
+	if (is_live || is_async) {
+		mux_stopping = false;
+		mux_error = 0;
+		mux_queued_bytes = 0;
+		ScopedNodeAffinity affinity;
+		mux_thread = std::thread(&FFmpegWriter::mux_queued_packets, this);
+	}
+
+	ZMQ_DEBUG("FFmpegWriter::WriteHeader");
 }
 
 // Add a frame to the queue waiting to be encoded.
 void FFmpegWriter::WriteFrame(std::shared_ptr<openshot::Frame> frame) {
+	AllocationScopeGuard allocations(ALLOCATION_SCOPE_WRITER);
+
 	// Check for open reader (or throw exception)
 	if (!is_open)
 		throw WriterClosed("The FFmpegWriter is closed.  Call Open() before calling this method.", path);
 
+	// Report the errors of the muxing thread
+	if (is_live || is_async) {
+		const std::lock_guard<std::mutex> lock(muxMutex);
+		if (mux_error != 0)
+			throw ErrorEncodingVideo("Error while writing packets [" + av_err2string(mux_error) + "]", frame->number);
+	}
+
+	// A live stream waits until the frame is due (and drops its image if it is too late)
+	bool drop_image = false;
+	if (is_live)
+		drop_image = !wait_for_live_frame();
+
 	// Add frame pointer to "queue", waiting to be processed the next
 	// time the WriteFrames() method is called.
-	if (info.has_video && video_st)
+	if (info.has_video && video_st && !drop_image)
 		spooled_video_frames.push_back(frame);
 
 	if (info.has_audio && audio_st)
 		spooled_audio_frames.push_back(frame);
 
-	ZmqLogger::Instance()->AppendDebugMethod(
+	// Leave a gap in the video timestamps for a dropped image (so the audio stays in sync)
+	if (info.has_video && video_st && drop_image) {
+		dropped_frames++;
+		video_timestamp += av_rescale_q(1, av_make_q(info.fps.den, info.fps.num), video_codec_ctx->time_base);
+	}
+
+	ZMQ_DEBUG(
 		"FFmpegWriter::WriteFrame",
 		"frame->number", frame->number,
 		"spooled_video_frames.size()", spooled_video_frames.size(),
@@ -695,8 +847,8 @@ void FFmpegWriter::WriteFrame(std::shared_ptr<openshot::Frame> frame) {
 		"cache_size", cache_size,
 		"is_writing", is_writing);
 
-	// Write the frames once it reaches the correct cache size
-	if ((int)spooled_video_frames.size() == cache_size || (int)spooled_audio_frames.size() == cache_size) {
+	// Write the frames once it reaches the correct cache size (a live stream encodes each frame right away)
+	if (is_live || (int)spooled_video_frames.size() == cache_size || (int)spooled_audio_frames.size() == cache_size) {
 		// Write frames to video file
 		write_queued_frames();
 	}
@@ -707,7 +859,9 @@ void FFmpegWriter::WriteFrame(std::shared_ptr<openshot::Frame> frame) {
 
 // Write all frames in the queue to the video file.
 void FFmpegWriter::write_queued_frames() {
-	ZmqLogger::Instance()->AppendDebugMethod(
+	RenderTraceSpan span("FFmpegWriter::write_queued_frames", "encode");
+
+	ZMQ_DEBUG(
 		"FFmpegWriter::write_queued_frames",
 		"spooled_video_frames.size()", spooled_video_frames.size(),
 		"spooled_audio_frames.size()", spooled_audio_frames.size());
@@ -725,54 +879,109 @@ void FFmpegWriter::write_queued_frames() {
 
 	// Create blank exception
 	bool has_error_encoding_video = false;
+	std::exception_ptr pipeline_error = nullptr;
 
-	// Process all audio frames (in a separate thread)
-	if (info.has_audio && audio_st && !queued_audio_frames.empty())
-		write_audio_packets(false);
-
-	// Loop through each queued image frame
-	while (!queued_video_frames.empty()) {
-		// Get front frame (from the queue)
-		std::shared_ptr<Frame> frame = queued_video_frames.front();
-
-		// Add to processed queue
-		processed_frames.push_back(frame);
-
-		// Encode and add the frame to the output file
-		if (info.has_video && video_st)
-			process_video_packet(frame);
-
-		// Remove front item
-		queued_video_frames.pop_front();
-
-	} // end while
-
-
-	// Loop back through the frames (in order), and write them to the video file
-	while (!processed_frames.empty()) {
-		// Get front frame (from the queue)
-		std::shared_ptr<Frame> frame = processed_frames.front();
+	// Copy the queued image frames (so each worker can index them directly)
+	std::vector<std::shared_ptr<Frame>> video_frames;
+	if (info.has_video && video_st)
+		video_frames.assign(queued_video_frames.begin(), queued_video_frames.end());
+	queued_video_frames.clear();
+
+	// Init rescalers (if not initialized yet), using the first frame which has an image.
+	// This must happen before the workers start, since each one owns a rescaler.
+	if (image_rescalers.empty()) {
+		for (auto& frame : video_frames) {
+			if (frame->GetWidth() != 1 || frame->GetHeight() != 1) {
+				InitScalers(frame->GetWidth(), frame->GetHeight());
+				break;
+			}
+		}
+	}
+	bool process_audio = info.has_audio && audio_st && !queued_audio_frames.empty();
+	int64_t video_frame_count = video_frames.size();
+
+	// Frames which repeat the image before them are not encoded (with a variable frame rate)
+	bool elide_images = is_vfr && !is_live;
+	std::vector<char> elided(video_frame_count, 0);
+	int64_t frame_duration = video_codec_ctx ? av_rescale_q(1, av_make_q(info.fps.den, info.fps.num), video_codec_ctx->time_base) : 1;
+
+	// Pipeline: one thread resamples & encodes the audio, while the rest of the team
+	// converts RGBA images to the codec's pixel format in parallel (one rescaler per thread).
+	// Converted frames are encoded & muxed in frame order (in the ordered section), so encoding
+	// frame N overlaps with the conversion of the frames after it. The spool (cache_size) bounds
+	// how many frames are in flight at once.
+	#pragma omp parallel num_threads(num_of_rescalers)
+	{
+		// Process all audio frames (on a single thread)
+		#pragma omp single nowait
+		{
+			if (process_audio) {
+				try {
+					write_audio_packets(false);
+				} catch (...) {
+					#pragma omp critical (write_queued_frames_error)
+					if (!pipeline_error)
+						pipeline_error = std::current_exception();
+				}
+			}
+		}
 
-		if (info.has_video && video_st) {
-			// Add to deallocate queue (so we can remove the AVFrames when we are done)
-			deallocate_frames.push_back(frame);
+		// Convert each image frame, and then encode it (in order)
+		#pragma omp for ordered schedule(dynamic, 1)
+		for (int64_t index = 0; index < video_frame_count; index++) {
+			std::shared_ptr<Frame> frame = video_frames[index];
+
+			try {
+				// Compare with the frame before it (the last frame of the previous block, for the first one)
+				std::shared_ptr<Frame> previous = (index > 0) ? video_frames[index - 1] : last_video_frame;
+				if (elide_images && previous && same_image(frame, previous))
+					elided[index] = 1;
+				else
+					process_video_packet(frame);
+			} catch (...) {
+				#pragma omp critical (write_queued_frames_error)
+				if (!pipeline_error)
+					pipeline_error = std::current_exception();
+			}
 
-			// Does this frame's AVFrame still exist
-			if (av_frames.count(frame)) {
-				// Get AVFrame
-				AVFrame *frame_final = av_frames[frame];
+			#pragma omp ordered
+			{
+				// Does this frame's AVFrame exist
+				AVFrame *frame_final = NULL;
+				#pragma omp critical (av_frames_section)
+				if (av_frames.count(frame))
+					frame_final = av_frames[frame];
+
+				// Leave a gap in the video timestamps for an elided image (so the frame before it lasts longer)
+				if (elided[index]) {
+					elided_frames++;
+					video_timestamp += frame_duration;
+				}
 
 				// Write frame to video file
-				bool success = write_video_packet(frame, frame_final);
-				if (!success)
-					has_error_encoding_video = true;
+				if (frame_final) {
+					try {
+						if (!write_video_packet(frame, frame_final))
+							has_error_encoding_video = true;
+					} catch (...) {
+						#pragma omp critical (write_queued_frames_error)
+						if (!pipeline_error)
+							pipeline_error = std::current_exception();
+					}
+				}
 			}
 		}
+	} // end omp parallel
 
-		// Remove front item
-		processed_frames.pop_front();
+	// Remember the last image frame (the next block is compared with it)
+	if (video_frame_count > 0) {
+		last_video_frame = video_frames.back();
+		last_video_frame_elided = elided.back();
 	}
 
+	// Add to deallocate queue (so we can remove the AVFrames when we are done)
+	deallocate_frames.insert(deallocate_frames.end(), video_frames.begin(), video_frames.end());
+
 	// Loop through, and deallocate AVFrames
 	while (!deallocate_frames.empty()) {
 		// Get front frame (from the queue)
@@ -783,8 +992,11 @@ void FFmpegWriter::write_queued_frames() {
 			// Get AVFrame
 			AVFrame *av_frame = av_frames[frame];
 
-			// Deallocate buffer and AVFrame
-			av_freep(&(av_frame->data[0]));
+			// Deallocate buffer and AVFrame (a GPU surface is released by the frame itself)
+#if USE_HW_ACCEL
+			if (!av_frame->hw_frames_ctx)
+#endif // USE_HW_ACCEL
+				av_freep(&(av_frame->data[0]));
 			AV_FREE_FRAME(&av_frame);
 			av_frames.erase(frame);
 		}
@@ -797,25 +1009,143 @@ void FFmpegWriter::write_queued_frames() {
 	is_writing = false;
 
 	// Raise exception from main thread
+	if (pipeline_error)
+		std::rethrow_exception(pipeline_error);
 	if (has_error_encoding_video)
 		throw ErrorEncodingVideo("Error while writing raw video frame", -1);
 }
 
 // Write a block of frames from a reader
 void FFmpegWriter::WriteFrame(ReaderBase *reader, int64_t start, int64_t length) {
-	ZmqLogger::Instance()->AppendDebugMethod(
+	ZMQ_DEBUG(
 		"FFmpegWriter::WriteFrame (from Reader)",
 		"start", start,
 		"length", length);
 
-	// Loop through each frame (and encoded it)
-	for (int64_t number = start; number <= length; number++) {
-		// Get the frame
-		std::shared_ptr<Frame> f = reader->GetFrame(number);
+	// A live stream renders each frame when it is due, and skips the frames it is too late for (their audio is silent)
+	if (is_live) {
+		for (int64_t number = start; number <= length; number++) {
+			std::shared_ptr<Frame> f;
+			if (live_frame_is_late()) {
+				f = std::make_shared<Frame>(number, 1, 1, "#000000",
+											Frame::GetSamplesPerFrame(number, info.fps, info.sample_rate, info.channels), info.channels);
+				f->SampleRate(info.sample_rate);
+				f->ChannelsLayout(info.channel_layout);
+			} else {
+				f = reader->GetFrame(number);
+			}
+			WriteFrame(f);
+		}
+		return;
+	}
+
+	// Without render threads, get & encode each frame synchronously
+	if (render_threads <= 1) {
+		// Loop through each frame (and encoded it)
+		for (int64_t number = start; number <= length; number++) {
+			// Get the frame
+			std::shared_ptr<Frame> f = reader->GetFrame(number);
 
-		// Encode frame
-		WriteFrame(f);
+			// Encode frame
+			WriteFrame(f);
+		}
+		return;
 	}
+
+	// Batched export: worker threads render frames ahead of the encoder into a
+	// reorder buffer, and this thread encodes them in order as they become ready.
+	std::mutex render_mutex;
+	std::condition_variable render_condition;
+	std::map<int64_t, std::shared_ptr<Frame>> rendered_frames;
+	std::exception_ptr render_error = nullptr;
+	int64_t next_render_frame = start;
+	int64_t next_write_frame = start;
+	int64_t max_frames_ahead = render_threads * 2;
+	bool cancel_render = false;
+
+	// Render frames until there are no more (or the batch is cancelled)
+	auto render_worker = [&]() {
+		RenderTrace::Instance()->SetThreadName("FFmpegWriter render worker");
+		while (true) {
+			int64_t number = 0;
+			{
+				// Wait for room in the reorder buffer
+				std::unique_lock<std::mutex> lock(render_mutex);
+				render_condition.wait(lock, [&]() {
+					return cancel_render || next_render_frame > length ||
+						next_render_frame < next_write_frame + max_frames_ahead;
+				});
+				if (cancel_render || next_render_frame > length)
+					return;
+				number = next_render_frame++;
+			}
+
+			try {
+				// Get the frame
+				std::shared_ptr<Frame> f = reader->GetFrame(number);
+
+				// Add to reorder buffer
+				const std::lock_guard<std::mutex> lock(render_mutex);
+				rendered_frames[number] = f;
+			} catch (...) {
+				// Stop all workers, and raise the exception from the encoding thread
+				const std::lock_guard<std::mutex> lock(render_mutex);
+				if (!render_error)
+					render_error = std::current_exception();
+				cancel_render = true;
+			}
+			render_condition.notify_all();
+		}
+	};
+
+	// Start render threads
+	std::vector<std::thread> render_workers;
+	for (int x = 0; x < render_threads; x++)
+		render_workers.emplace_back(render_worker);
+
+	// Stop & join all render threads
+	auto stop_workers = [&](bool cancel) {
+		{
+			const std::lock_guard<std::mutex> lock(render_mutex);
+			cancel_render = cancel_render || cancel;
+		}
+		render_condition.notify_all();
+		for (auto& worker : render_workers)
+			worker.join();
+	};
+
+	try {
+		// Loop through each frame (in order), and encode it
+		for (int64_t number = start; number <= length; number++) {
+			std::shared_ptr<Frame> f;
+			{
+				// Wait for the next frame to be rendered
+				std::unique_lock<std::mutex> lock(render_mutex);
+				render_condition.wait(lock, [&]() {
+					return cancel_render || rendered_frames.count(number);
+				});
+				if (!rendered_frames.count(number))
+					break;
+
+				// Remove from reorder buffer (making room for more frames)
+				f = rendered_frames[number];
+				rendered_frames.erase(number);
+				next_write_frame = number + 1;
+			}
+			render_condition.notify_all();
+
+			// Encode frame
+			WriteFrame(f);
+		}
+	} catch (...) {
+		stop_workers(true);
+		throw;
+	}
+	stop_workers(false);
+
+	// Raise any exception thrown while rendering
+	if (render_error)
+		std::rethrow_exception(render_error);
 }
 
 // Write the file trailer (after all frames are written)
@@ -823,6 +1153,17 @@ void FFmpegWriter::WriteTrailer() {
 	// Write any remaining queued frames to video file
 	write_queued_frames();
 
+	// Encode the last frame, if its image was elided (so the video lasts until the end of the last frame)
+	if (last_video_frame_elided && video_codec_ctx) {
+		std::shared_ptr<Frame> frame = last_video_frame;
+		last_video_frame.reset();
+		last_video_frame_elided = false;
+		elided_frames--;
+		video_timestamp -= av_rescale_q(1, av_make_q(info.fps.den, info.fps.num), video_codec_ctx->time_base);
+		spooled_video_frames.push_back(frame);
+		write_queued_frames();
+	}
+
 	// Process final audio frame (if any)
 	if (info.has_audio && audio_st)
 		write_audio_packets(true);
@@ -830,6 +1171,9 @@ void FFmpegWriter::WriteTrailer() {
 	// Flush encoders (who sometimes hold on to frames)
 	flush_encoders();
 
+	// Mux the queued packets (the trailer is written on this thread)
+	stop_mux_thread();
+
 	/* write the trailer, if any. The trailer must be written
 	 * before you close the CodecContexts open when you wrote the
 	 * header; otherwise write_trailer may try to use memory that
@@ -839,7 +1183,299 @@ void FFmpegWriter::WriteTrailer() {
 	// Mark as 'written'
 	write_trailer = true;
 
-	ZmqLogger::Instance()->AppendDebugMethod("FFmpegWriter::WriteTrailer");
+	ZMQ_DEBUG("FFmpegWriter::WriteTrailer");
+}
+
+// Is the next frame of a live stream later than the allowed latency
+bool FFmpegWriter::live_frame_is_late() {
+	if (live_frames == 0)
+		return false;
+
+	const auto due = live_start + std::chrono::microseconds(av_rescale(live_frames, int64_t(1000000) * info.fps.den, info.fps.num));
+	return std::chrono::steady_clock::now() > due + std::chrono::milliseconds(live_latency_ms);
+}
+
+// Wait for the wall clock time of the next frame of a live stream
+bool FFmpegWriter::wait_for_live_frame() {
+	// The stream starts with its first frame
+	if (live_frames == 0)
+		live_start = std::chrono::steady_clock::now();
+
+	// Frames can be written early (within the latency), and are too late after it
+	const bool is_late = live_frame_is_late();
+	if (!is_late) {
+		const auto due = live_start + std::chrono::microseconds(av_rescale(live_frames, int64_t(1000000) * info.fps.den, info.fps.num));
+		std::this_thread::sleep_until(due - std::chrono::milliseconds(live_latency_ms));
+	}
+	live_frames++;
+
+	if (is_late)
+		ZMQ_DEBUG(
+			"FFmpegWriter::wait_for_live_frame (frame is too late, dropping its image)",
+			"live_frames", live_frames,
+			"live_latency_ms", live_latency_ms);
+	return !is_late;
+}
+
+// Mux an encoded packet (or queue it for the muxing thread)
+int FFmpegWriter::write_packet(AVPacket *pkt) {
+	if (!is_live && !is_async)
+		return av_interleaved_write_frame(oc, pkt);
+
+	if (!is_live) {
+		// Only wait for the storage once the queued packets fill the buffer
+		std::unique_lock<std::mutex> lock(muxMutex);
+		mux_changed.wait(lock, [this]() { return mux_queued_bytes <= mux_buffer_bytes || mux_error != 0; });
+		if (mux_error != 0) {
+			av_packet_unref(pkt);
+			return mux_error;
+		}
+
+		AVPacket *queued = av_packet_alloc();
+		av_packet_move_ref(queued, pkt);
+		mux_queued_bytes += queued->size;
+		mux_packets.push_back(std::make_pair(queued, int64_t(0)));
+		mux_changed.notify_all();
+		return 0;
+	}
+
+	// The packet is sent at its decoding time (in microseconds)
+	const bool is_video = video_st && pkt->stream_index == video_st->index;
+	const int64_t timestamp = (pkt->dts != AV_NOPTS_VALUE) ? pkt->dts : pkt->pts;
+	const int64_t time = av_rescale_q(timestamp, oc->streams[pkt->stream_index]->time_base, AV_TIME_BASE_Q);
+
+	const std::lock_guard<std::mutex> lock(muxMutex);
+	if (is_video) {
+		// After dropping video packets, the video resumes at the next keyframe
+		if (pkt->flags & AV_PKT_FLAG_KEY)
+			live_wait_for_keyframe = false;
+		if (live_wait_for_keyframe) {
+			dropped_frames++;
+			av_packet_unref(pkt);
+			return 0;
+		}
+	}
+
+	// The network fell behind (the queued packets span more than twice the latency), so drop the queued video packets
+	if (!mux_packets.empty() && time - mux_packets.front().second > int64_t(live_latency_ms) * 2000) {
+		std::deque<std::pair<AVPacket *, int64_t>> audio_packets;
+		for (auto& queued : mux_packets) {
+			if (video_st && queued.first->stream_index == video_st->index) {
+				dropped_frames++;
+				mux_queued_bytes -= queued.first->size;
+				av_packet_free(&queued.first);
+			} else {
+				audio_packets.push_back(queued);
+			}
+		}
+		mux_packets.swap(audio_packets);
+		if (is_video && !(pkt->flags & AV_PKT_FLAG_KEY)) {
+			live_wait_for_keyframe = true;
+			dropped_frames++;
+			av_packet_unref(pkt);
+			return 0;
+		}
+		live_wait_for_keyframe = !is_video && video_st != NULL;
+
+		ZMQ_DEBUG(
+			"FFmpegWriter::write_packet (network is too slow, dropped video packets)",
+			"dropped_frames", dropped_frames);
+	}
+
+	// Queue the packet (the muxing thread owns it now)
+	AVPacket *queued = av_packet_alloc();
+	av_packet_move_ref(queued, pkt);
+	mux_queued_bytes += queued->size;
+	mux_packets.push_back(std::make_pair(queued, time));
+	mux_changed.notify_all();
+	return 0;
+}
+
+// Mux the queued packets (at their times, when streaming live)
+void FFmpegWriter::mux_queued_packets() {
+	RenderTrace::Instance()->SetThreadName(is_live ? "FFmpegWriter live stream" : "FFmpegWriter muxer");
+	int64_t first_time = AV_NOPTS_VALUE;
+	std::chrono::steady_clock::time_point first_sent;
+
+	std::unique_lock<std::mutex> lock(muxMutex);
+	while (true) {
+		mux_changed.wait(lock, [this]() { return mux_stopping || !mux_packets.empty(); });
+		if (mux_packets.empty())
+			break;
+
+		// Wait for the packet's time (relative to the first packet), unless the stream is stopping
+		if (is_live) {
+			const int64_t time = mux_packets.front().second;
+			if (first_time == AV_NOPTS_VALUE) {
+				first_time = time;
+				first_sent = std::chrono::steady_clock::now();
+			}
+			const auto due = first_sent + std::chrono::microseconds(time - first_time);
+			AVPacket *next = mux_packets.front().first;
+			mux_changed.wait_until(lock, due, [this]() { return mux_stopping; });
+
+			// The packet could have been dropped while waiting
+			if (mux_packets.empty() || mux_packets.front().first != next)
+				continue;
+		}
+
+		AVPacket *pkt = mux_packets.front().first;
+		mux_packets.pop_front();
+		mux_queued_bytes -= pkt->size;
+
+		// Mux the packet (without blocking the encoder, which keeps queueing packets)
+		if (mux_error == 0) {
+			lock.unlock();
+			const int error_code = av_interleaved_write_frame(oc, pkt);
+			lock.lock();
+			if (error_code < 0) {
+				mux_error = error_code;
+				ZMQ_DEBUG(
+					"FFmpegWriter::mux_queued_packets ERROR [" + av_err2string(error_code) + "]",
+					"error_code", error_code);
+			}
+		}
+		av_packet_free(&pkt);
+
+		// Wake the encoder (when it waits for room in the buffer)
+		mux_changed.notify_all();
+	}
+}
+
+// Stop the muxing thread (after muxing the queued packets)
+void FFmpegWriter::stop_mux_thread() {
+	if (!mux_thread.joinable())
+		return;
+
+	{
+		const std::lock_guard<std::mutex> lock(muxMutex);
+		mux_stopping = true;
+	}
+	mux_changed.notify_all();
+	mux_thread.join();
+
+	ZMQ_DEBUG(
+		"FFmpegWriter::stop_mux_thread",
+		"dropped_frames", dropped_frames);
+}
+
+// Open a local output file with a large buffer of our own
+bool FFmpegWriter::open_output_file() {
+	// Protocols (and pipes) are written by FFmpeg
+	std::string file_path = path;
+	if (file_path.rfind("file:", 0) == 0)
+		file_path = file_path.substr(5);
+	else if (file_path.find("://") != std::string::npos || file_path.rfind("pipe:", 0) == 0)
+		return false;
+
+	int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_BINARY
+	flags |= O_BINARY;
+#endif
+	output_fd = open(file_path.c_str(), flags, 0644);
+	if (output_fd < 0)
+		return false;
+#ifdef O_DIRECT
+	// A second descriptor writes the aligned blocks around the page cache (where the file system supports it)
+	if (use_direct_io)
+		output_direct_fd = open(file_path.c_str(), O_WRONLY | O_DIRECT);
+#endif
+
+	// The buffer is aligned for direct I/O (FFmpeg only writes the blocks of the buffer, and never frees it)
+	output_buffer = static_cast<unsigned char *>(av_malloc(OUTPUT_BUFFER_SIZE + DIRECT_IO_ALIGNMENT));
+	unsigned char *aligned_buffer = output_buffer ?
+		output_buffer + (DIRECT_IO_ALIGNMENT - reinterpret_cast<uintptr_t>(output_buffer) % DIRECT_IO_ALIGNMENT) % DIRECT_IO_ALIGNMENT : NULL;
+	output_position = 0;
+	oc->pb = aligned_buffer ? avio_alloc_context(aligned_buffer, OUTPUT_BUFFER_SIZE, 1, this, NULL, write_output, seek_output) : NULL;
+	if (!oc->pb) {
+		close_output_file();
+		return false;
+	}
+
+	ZMQ_DEBUG(
+		"FFmpegWriter::open_output_file",
+		"buffer_size", OUTPUT_BUFFER_SIZE,
+		"direct_io", output_direct_fd >= 0);
+	return true;
+}
+
+// Flush and close the output file opened by open_output_file()
+void FFmpegWriter::close_output_file() {
+	if (oc && oc->pb) {
+		avio_flush(oc->pb);
+#if (LIBAVFORMAT_VERSION_MAJOR >= 58)
+		avio_context_free(&oc->pb);
+#else
+		av_freep(&oc->pb);
+#endif
+	}
+	if (output_direct_fd >= 0)
+		close(output_direct_fd);
+	if (output_fd >= 0)
+		close(output_fd);
+	output_direct_fd = -1;
+	output_fd = -1;
+	av_freep(&output_buffer);
+}
+
+// Write the buffered output to the file
+int FFmpegWriter::write_output(void *opaque, uint8_t *buf, int buf_size) {
+	FFmpegWriter *writer = static_cast<FFmpegWriter *>(opaque);
+	int written = 0;
+	while (written < buf_size) {
+		const uint8_t *data = buf + written;
+		int size = buf_size - written;
+		ssize_t result = -1;
+#ifdef O_DIRECT
+		// Full aligned blocks are written directly (the rest goes through the page cache)
+		const bool aligned = writer->output_position % DIRECT_IO_ALIGNMENT == 0 &&
+			reinterpret_cast<uintptr_t>(data) % DIRECT_IO_ALIGNMENT == 0 && size >= DIRECT_IO_ALIGNMENT;
+		if (writer->output_direct_fd >= 0 && aligned) {
+			size -= size % DIRECT_IO_ALIGNMENT;
+			result = pwrite(writer->output_direct_fd, data, size, writer->output_position);
+			if (result < 0 && errno == EINVAL) {
+				// The file system doesn't support direct I/O after all
+				close(writer->output_direct_fd);
+				writer->output_direct_fd = -1;
+				continue;
+			}
+		} else
+#endif
+		{
+			if (lseek(writer->output_fd, writer->output_position, SEEK_SET) < 0)
+				return AVERROR(errno);
+			result = write(writer->output_fd, data, size);
+		}
+
+		if (result < 0) {
+			if (errno == EINTR)
+				continue;
+			return AVERROR(errno);
+		}
+		written += result;
+		writer->output_position += result;
+	}
+	return written;
+}
+
+// Seek the output file
+int64_t FFmpegWriter::seek_output(void *opaque, int64_t offset, int whence) {
+	FFmpegWriter *writer = static_cast<FFmpegWriter *>(opaque);
+	const int64_t file_size = lseek(writer->output_fd, 0, SEEK_END);
+	if (whence & AVSEEK_SIZE)
+		return (file_size < 0) ? AVERROR(errno) : file_size;
+
+	int64_t position = -1;
+	switch (whence & ~AVSEEK_FORCE) {
+		case SEEK_SET: position = offset; break;
+		case SEEK_CUR: position = writer->output_position + offset; break;
+		case SEEK_END: position = file_size + offset; break;
+	}
+	if (position < 0)
+		return AVERROR(EINVAL);
+
+	writer->output_position = position;
+	return position;
 }
 
 // Flush encoders
@@ -889,7 +1525,7 @@ void FFmpegWriter::flush_encoders() {
 				}
 				av_packet_rescale_ts(pkt, video_codec_ctx->time_base, video_st->time_base);
 				pkt->stream_index = video_st->index;
-				error_code = av_interleaved_write_frame(oc, pkt);
+				error_code = write_packet(pkt);
 			}
 #else // IS_FFMPEG_3_2
 
@@ -899,7 +1535,7 @@ void FFmpegWriter::flush_encoders() {
 #endif // IS_FFMPEG_3_2
 
 			if (error_code < 0) {
-				ZmqLogger::Instance()->AppendDebugMethod(
+				ZMQ_DEBUG(
 					"FFmpegWriter::flush_encoders ERROR ["
 						+ av_err2string(error_code) + "]",
 					"error_code", error_code);
@@ -913,9 +1549,9 @@ void FFmpegWriter::flush_encoders() {
 			pkt->stream_index = video_st->index;
 
 			// Write packet
-			error_code = av_interleaved_write_frame(oc, pkt);
+			error_code = write_packet(pkt);
 			if (error_code < 0) {
-				ZmqLogger::Instance()->AppendDebugMethod(
+				ZMQ_DEBUG(
 					"FFmpegWriter::flush_encoders ERROR ["
 						+ av_err2string(error_code) + "]",
 					"error_code", error_code);
@@ -945,7 +1581,7 @@ void FFmpegWriter::flush_encoders() {
 			error_code = avcodec_encode_audio2(audio_codec_ctx, pkt, NULL, &got_packet);
 #endif
 			if (error_code < 0) {
-				ZmqLogger::Instance()->AppendDebugMethod(
+				ZMQ_DEBUG(
 					"FFmpegWriter::flush_encoders ERROR ["
 						+ av_err2string(error_code) + "]",
 					"error_code", error_code);
@@ -966,9 +1602,9 @@ void FFmpegWriter::flush_encoders() {
 			pkt->flags |= AV_PKT_FLAG_KEY;
 
 			// Write packet
-			error_code = av_interleaved_write_frame(oc, pkt);
+			error_code = write_packet(pkt);
 			if (error_code < 0) {
-				ZmqLogger::Instance()->AppendDebugMethod(
+				ZMQ_DEBUG(
 					"FFmpegWriter::flush_encoders ERROR ["
 						+ av_err2string(error_code) + "]",
 					"error_code", error_code);
@@ -994,6 +1630,8 @@ void FFmpegWriter::close_video(AVFormatContext *oc, AVStream *st)
 			hw_device_ctx = NULL;
 		}
 	}
+	HardwareDevices::Instance()->Release(HARDWARE_ENCODE_SESSION, hw_device_index);
+	hw_device_index = -1;
 #endif // USE_HW_ACCEL
 
 	// Free any previous memory allocations
@@ -1007,12 +1645,19 @@ void FFmpegWriter::close_video(AVFormatContext *oc, AVStream *st)
 void FFmpegWriter::close_audio(AVFormatContext *oc, AVStream *st)
 {
 	// Clear buffers
-	delete[] samples;
-	delete[] audio_outbuf;
 	delete[] audio_encoder_buffer;
-	samples = NULL;
-	audio_outbuf = NULL;
 	audio_encoder_buffer = NULL;
+	if (audio_fifo) {
+		av_audio_fifo_free(audio_fifo);
+		audio_fifo = NULL;
+	}
+	if (audio_fifo_frame)
+		AV_FREE_FRAME(&audio_fifo_frame);
+	if (audio_converted) {
+		av_freep(&audio_converted[0]);
+		av_freep(&audio_converted);
+	}
+	audio_converted_capacity = 0;
 
 	// Deallocate resample buffer
 	if (avr) {
@@ -1021,12 +1666,6 @@ void FFmpegWriter::close_audio(AVFormatContext *oc, AVStream *st)
 		avr = NULL;
 	}
 
-	if (avr_planar) {
-		SWR_CLOSE(avr_planar);
-		SWR_FREE(&avr_planar);
-		avr_planar = NULL;
-	}
-
 	// Free any previous memory allocations
 	if (audio_codec_ctx != nullptr) {
 		AV_FREE_CONTEXT(audio_codec_ctx);
@@ -1039,6 +1678,7 @@ void FFmpegWriter::Close() {
 	// Write trailer (if needed)
 	if (!write_trailer)
 		WriteTrailer();
+	stop_mux_thread();
 
 	// Close each codec
 	if (video_st)
@@ -1050,7 +1690,10 @@ void FFmpegWriter::Close() {
 	if (image_rescalers.size() > 0)
 		RemoveScalers();
 
-	if (!(oc->oformat->flags & AVFMT_NOFILE)) {
+	if (output_fd >= 0) {
+		/* flush and close our own output file */
+		close_output_file();
+	} else if (!(oc->oformat->flags & AVFMT_NOFILE)) {
 		/* close the output file */
 		avio_close(oc->pb);
 	}
@@ -1058,6 +1701,9 @@ void FFmpegWriter::Close() {
 	// Reset frame counters
 	video_timestamp = 0;
 	audio_timestamp = 0;
+	live_frames = 0;
+	last_video_frame.reset();
+	last_video_frame_elided = false;
 
 	// Free the context which frees the streams too
 	avformat_free_context(oc);
@@ -1069,19 +1715,23 @@ void FFmpegWriter::Close() {
 	write_header = false;
 	write_trailer = false;
 
-	ZmqLogger::Instance()->AppendDebugMethod("FFmpegWriter::Close");
+	ZMQ_DEBUG("FFmpegWriter::Close");
 }
 
 // Add an AVFrame to the cache
 void FFmpegWriter::add_avframe(std::shared_ptr<Frame> frame, AVFrame *av_frame) {
 	// Add AVFrame to map (if it does not already exist)
-	if (!av_frames.count(frame)) {
-		// Add av_frame
-		av_frames[frame] = av_frame;
-	} else {
-		// Do not add, and deallocate this AVFrame
-		AV_FREE_FRAME(&av_frame);
+	bool added = false;
+	#pragma omp critical (av_frames_section)
+	{
+		added = (av_frames.count(frame) == 0);
+		if (added)
+			av_frames[frame] = av_frame;
 	}
+
+	// Do not add, and deallocate this AVFrame
+	if (!added)
+		AV_FREE_FRAME(&av_frame);
 }
 
 // Add an audio output stream
@@ -1171,7 +1821,7 @@ AVStream *FFmpegWriter::add_audio_stream() {
 
 	AV_COPY_PARAMS_FROM_CONTEXT(st, c);
 
-	ZmqLogger::Instance()->AppendDebugMethod(
+	ZMQ_DEBUG(
 		"FFmpegWriter::add_audio_stream",
 		"c->codec_id", c->codec_id,
 		"c->bit_rate", c->bit_rate,
@@ -1185,6 +1835,9 @@ AVStream *FFmpegWriter::add_audio_stream() {
 
 // Add a video output stream
 AVStream *FFmpegWriter::add_video_stream() {
+	// Open the GPU of a hardware encoder (or switch to a software encoder)
+	open_hw_device();
+
 	// Find the video codec
 	const AVCodec *codec = avcodec_find_encoder_by_name(info.vcodec.c_str());
 	if (codec == NULL)
@@ -1366,7 +2019,7 @@ AVStream *FFmpegWriter::add_video_stream() {
 	}
 
 	AV_COPY_PARAMS_FROM_CONTEXT(st, c);
-	ZmqLogger::Instance()->AppendDebugMethod(
+	ZMQ_DEBUG(
 		"FFmpegWriter::add_video_stream ("
 			+ (std::string)oc->oformat->name + " : "
 			+ (std::string)av_get_pix_fmt_name(c->pix_fmt) + ")",
@@ -1396,6 +2049,29 @@ void FFmpegWriter::open_audio(AVFormatContext *oc, AVStream *st) {
 	AVDictionary *opts = NULL;
 	av_dict_set(&opts, "strict", "experimental", 0);
 
+	if (is_live) {
+		// Low delay encoding: no B-frames (or lookahead), slice threads only (frame threads delay each frame),
+		// and a keyframe every 2 seconds (so viewers, and HLS segments, can start quickly)
+		video_codec_ctx->max_b_frames = 0;
+		video_codec_ctx->flags |= AV_CODEC_FLAG_LOW_DELAY;
+		video_codec_ctx->thread_type = FF_THREAD_SLICE;
+		video_codec_ctx->gop_size = std::max(1, (int) round(2.0 * info.fps.ToDouble()));
+		switch (video_codec_ctx->codec_id) {
+			case AV_CODEC_ID_H264:
+			case AV_CODEC_ID_HEVC:
+				av_dict_set(&opts, "preset", "veryfast", 0);
+				av_dict_set(&opts, "tune", "zerolatency", 0);
+				break;
+			case AV_CODEC_ID_VP8:
+			case AV_CODEC_ID_VP9:
+				av_dict_set(&opts, "deadline", "realtime", 0);
+				av_dict_set(&opts, "lag-in-frames", "0", 0);
+				break;
+			default:
+				break;
+		}
+	}
+
 	// Open the codec
 	if (avcodec_open2(audio_codec_ctx, codec, &opts) < 0)
 		throw InvalidCodec("Could not open audio codec", path);
@@ -1429,12 +2105,18 @@ void FFmpegWriter::open_audio(AVFormatContext *oc, AVStream *st) {
 	// Set the initial frame size (since it might change during resampling)
 	initial_audio_input_frame_size = audio_input_frame_size;
 
-	// Allocate array for samples
-	samples = new int16_t[AVCODEC_MAX_AUDIO_FRAME_SIZE];
-
-	// Set audio output buffer (used to store the encoded audio)
-	audio_outbuf_size = AVCODEC_MAX_AUDIO_FRAME_SIZE;
-	audio_outbuf = new uint8_t[audio_outbuf_size];
+	// The samples waiting to be encoded (in the encoder's format), and the frame the encoder reads them from
+	audio_fifo = av_audio_fifo_alloc(audio_codec_ctx->sample_fmt, info.channels, audio_input_frame_size * 2);
+	audio_fifo_frame = AV_ALLOCATE_FRAME();
+	if (!audio_fifo || !audio_fifo_frame)
+		throw OutOfMemory("Could not allocate the audio FIFO", path);
+	audio_fifo_frame->nb_samples = audio_input_frame_size;
+	audio_fifo_frame->format = audio_codec_ctx->sample_fmt;
+	audio_fifo_frame->channels = info.channels;
+	audio_fifo_frame->channel_layout = info.channel_layout;
+	audio_fifo_frame->sample_rate = info.sample_rate;
+	if (av_frame_get_buffer(audio_fifo_frame, 0) < 0)
+		throw OutOfMemory("Could not allocate the audio frame buffer", path);
 
 	// Set audio packet encoding buffer
 	audio_encoder_buffer_size = AUDIO_PACKET_ENCODING_SIZE;
@@ -1445,13 +2127,53 @@ void FFmpegWriter::open_audio(AVFormatContext *oc, AVStream *st) {
 		av_dict_set(&st->metadata, iter->first.c_str(), iter->second.c_str(), 0);
 	}
 
-	ZmqLogger::Instance()->AppendDebugMethod(
+	ZMQ_DEBUG(
 		"FFmpegWriter::open_audio",
 		"audio_codec_ctx->thread_count", audio_codec_ctx->thread_count,
 		"audio_input_frame_size", audio_input_frame_size,
 		"buffer_size", AVCODEC_MAX_AUDIO_FRAME_SIZE + MY_INPUT_BUFFER_PADDING_SIZE);
 }
 
+// Open a GPU for the hardware encoder
+void FFmpegWriter::open_hw_device() {
+#if USE_HW_ACCEL
+	if (!hw_en_on || !hw_en_supported || hw_device_ctx)
+		return;
+
+	// Take an encode session on one of the GPUs (see Settings::HW_DEVICE_POLICY)
+	hw_device_index = HardwareDevices::Instance()->Acquire(HARDWARE_ENCODE_SESSION);
+	if (hw_device_index >= 0) {
+		const std::string adapter = HardwareDevices::DeviceName(hw_en_av_device_type, hw_device_index);
+		ZMQ_DEBUG(
+			"Encode Device [" + adapter + "]",
+			"hw_device_index", hw_device_index);
+		if (av_hwdevice_ctx_create(&hw_device_ctx,
+				hw_en_av_device_type, adapter.empty() ? NULL : adapter.c_str(), NULL, 0) < 0)
+			hw_device_ctx = NULL;
+	}
+	if (hw_device_ctx)
+		return;
+
+	// Every GPU is busy (or the device could not be created), so encode with a software encoder of the codec
+	HardwareDevices::Instance()->Release(HARDWARE_ENCODE_SESSION, hw_device_index);
+	hw_device_index = -1;
+	const AVCodec *hw_codec = avcodec_find_encoder_by_name(info.vcodec.c_str());
+	const AVCodec *software_codec = hw_codec ? find_software_encoder(hw_codec->id) : NULL;
+	if (!software_codec) {
+		ZMQ_DEBUG(
+			"FFmpegWriter::open_hw_device ERROR creating hwdevice, Codec name:",
+			info.vcodec.c_str(), -1);
+		throw InvalidCodec("Could not create hwdevice", path);
+	}
+	ZMQ_DEBUG(
+		"FFmpegWriter::open_hw_device (no hardware device, using a software encoder: " + std::string(software_codec->name) + ")",
+		"hw_codec->id", hw_codec->id);
+	hw_en_on = 0;
+	hw_en_supported = 0;
+	info.vcodec = software_codec->name;
+#endif // USE_HW_ACCEL
+}
+
 // open video codec
 void FFmpegWriter::open_video(AVFormatContext *oc, AVStream *st) {
 	const AVCodec *codec;
@@ -1460,53 +2182,6 @@ void FFmpegWriter::open_video(AVFormatContext *oc, AVStream *st) {
 	// Set number of threads equal to number of processors (not to exceed 16)
 	video_codec_ctx->thread_count = std::min(FF_NUM_PROCESSORS, 16);
 
-#if USE_HW_ACCEL
-	if (hw_en_on && hw_en_supported) {
-		//char *dev_hw = NULL;
-		char adapter[256];
-		char *adapter_ptr = NULL;
-		int adapter_num;
-		// Use the hw device given in the environment variable HW_EN_DEVICE_SET or the default if not set
-		adapter_num = openshot::Settings::Instance()->HW_EN_DEVICE_SET;
-		std::clog << "Encoding Device Nr: " << adapter_num << "\n";
-		if (adapter_num < 3 && adapter_num >=0) {
-#if defined(__linux__)
-				snprintf(adapter,sizeof(adapter),"/dev/dri/renderD%d", adapter_num+128);
-				// Maybe 127 is better because the first card would be 1?!
-				adapter_ptr = adapter;
-#elif defined(_WIN32) || defined(__APPLE__)
-				adapter_ptr = NULL;
-#endif
-			}
-			else {
-				adapter_ptr = NULL; // Just to be sure
-			}
-// Check if it is there and writable
-#if defined(__linux__)
-		if( adapter_ptr != NULL && access( adapter_ptr, W_OK ) == 0 ) {
-#elif defined(_WIN32) || defined(__APPLE__)
-		if( adapter_ptr != NULL ) {
-#endif
-			ZmqLogger::Instance()->AppendDebugMethod(
-				"Encode Device present using device",
-				"adapter", adapter_num);
-		}
-		else {
-			adapter_ptr = NULL;  // use default
-			ZmqLogger::Instance()->AppendDebugMethod(
-				"Encode Device not present, using default");
-		}
-		if (av_hwdevice_ctx_create(&hw_device_ctx,
-				hw_en_av_device_type, adapter_ptr, NULL, 0) < 0)
-		{
-			ZmqLogger::Instance()->AppendDebugMethod(
-				"FFmpegWriter::open_video ERROR creating hwdevice, Codec name:",
-				info.vcodec.c_str(), -1);
-			throw InvalidCodec("Could not create hwdevice", path);
-		}
-	}
-#endif // USE_HW_ACCEL
-
 	/* find the video encoder */
 	codec = avcodec_find_encoder_by_name(info.vcodec.c_str());
 	if (!codec)
@@ -1559,17 +2234,19 @@ void FFmpegWriter::open_video(AVFormatContext *oc, AVStream *st) {
 				// tested to work with defaults
 				break;
 			default:
-				ZmqLogger::Instance()->AppendDebugMethod(
+				ZMQ_DEBUG(
 					"No codec-specific options defined for this codec. HW encoding may fail",
 					"codec_id", video_codec_ctx->codec_id);
 				break;
 		}
 
-		// set hw_frames_ctx for encoder's AVCodecContext
+		// set hw_frames_ctx for encoder's AVCodecContext (with a surface for each
+		// image being converted and uploaded in parallel, on top of the encoder's own)
+		hw_en_sw_pix_fmt = hw_upload_pix_fmt(codec, hw_device_ctx);
 		int err;
-		if ((err = set_hwframe_ctx(video_codec_ctx, hw_device_ctx, info.width, info.height)) < 0)
+		if ((err = set_hwframe_ctx(video_codec_ctx, hw_device_ctx, hw_en_av_pix_fmt, hw_en_sw_pix_fmt, info.width, info.height, 20 + num_of_rescalers)) < 0)
 		{
-			ZmqLogger::Instance()->AppendDebugMethod(
+			ZMQ_DEBUG(
 				"FFmpegWriter::open_video (set_hwframe_ctx) ERROR faled to set hwframe context",
 				"width", info.width,
 				"height", info.height,
@@ -1591,7 +2268,7 @@ void FFmpegWriter::open_video(AVFormatContext *oc, AVStream *st) {
 		av_dict_set(&st->metadata, iter->first.c_str(), iter->second.c_str(), 0);
 	}
 
-	ZmqLogger::Instance()->AppendDebugMethod(
+	ZMQ_DEBUG(
 		"FFmpegWriter::open_video",
 		"video_codec_ctx->thread_count", video_codec_ctx->thread_count);
 
@@ -1599,339 +2276,42 @@ void FFmpegWriter::open_video(AVFormatContext *oc, AVStream *st) {
 
 // write all queued frames' audio to the video file
 void FFmpegWriter::write_audio_packets(bool is_final) {
-	// Init audio buffers / variables
-	int total_frame_samples = 0;
-	int frame_position = 0;
-	int channels_in_frame = 0;
-	int sample_rate_in_frame = 0;
-	int samples_in_frame = 0;
-	ChannelLayout channel_layout_in_frame = LAYOUT_MONO; // default channel layout
-
-	// Create a new array (to hold all S16 audio samples, for the current queued frames
-	unsigned int all_queued_samples_size = sizeof(int16_t) * (queued_audio_frames.size() * AVCODEC_MAX_AUDIO_FRAME_SIZE);
-	int16_t *all_queued_samples = (int16_t *) av_malloc(all_queued_samples_size);
-	int16_t *all_resampled_samples = NULL;
-	int16_t *final_samples_planar = NULL;
-	int16_t *final_samples = NULL;
-
-	// Loop through each queued audio frame
-	while (!queued_audio_frames.empty()) {
-		// Get front frame (from the queue)
-		std::shared_ptr<Frame> frame = queued_audio_frames.front();
-
-		// Get the audio details from this frame
-		sample_rate_in_frame = frame->SampleRate();
-		samples_in_frame = frame->GetAudioSamplesCount();
-		channels_in_frame = frame->GetAudioChannelsCount();
-		channel_layout_in_frame = frame->ChannelsLayout();
-
-		// Get audio sample array
-		float *frame_samples_float = NULL;
-		// Get samples interleaved together (c1 c2 c1 c2 c1 c2)
-		frame_samples_float = frame->GetInterleavedAudioSamples(&samples_in_frame);
-
-		// Calculate total samples
-		total_frame_samples = samples_in_frame * channels_in_frame;
-
-		// Translate audio sample values back to 16 bit integers with saturation
-		const int16_t max16 = 32767;
-		const int16_t min16 = -32768;
-		for (int s = 0; s < total_frame_samples; s++, frame_position++) {
-			float valF = frame_samples_float[s] * (1 << 15);
-			int16_t conv;
-			if (valF > max16) {
-				conv = max16;
-			} else if (valF < min16) {
-				conv = min16;
-			} else {
-				conv = int(valF + 32768.5) - 32768; // +0.5 is for rounding
-			}
-
-			// Copy into buffer
-			all_queued_samples[frame_position] = conv;
-		}
-
-		// Deallocate float array
-		delete[] frame_samples_float;
+	RenderStageTimer timer(RENDER_STAGE_ENCODE);
+	RenderTraceSpan span("FFmpegWriter::write_audio_packets", "encode");
 
-		// Remove front item
+	// Add the samples of the queued frames to the FIFO (in the encoder's sample format)
+	while (!queued_audio_frames.empty()) {
+		fill_audio_fifo(queued_audio_frames.front());
 		queued_audio_frames.pop_front();
+	}
 
-	} // end while
-
-
-	// Update total samples (since we've combined all queued frames)
-	total_frame_samples = frame_position;
-	int remaining_frame_samples = total_frame_samples;
-	int samples_position = 0;
+	// The resampler holds back a few samples (which are flushed at the end)
+	if (is_final && avr)
+		convert_audio(NULL, 0);
 
+	// Only the last frame can be smaller than the encoder's frame size (or it is padded with silence)
+	const bool small_last_frame = audio_codec_ctx->frame_size <= 1 ||
+		(audio_codec_ctx->codec->capabilities & (AV_CODEC_CAP_VARIABLE_FRAME_SIZE | AV_CODEC_CAP_SMALL_LAST_FRAME));
 
-	ZmqLogger::Instance()->AppendDebugMethod(
+	ZMQ_DEBUG(
 		"FFmpegWriter::write_audio_packets",
 		"is_final", is_final,
-		"total_frame_samples", total_frame_samples,
-		"channel_layout_in_frame", channel_layout_in_frame,
-		"channels_in_frame", channels_in_frame,
-		"samples_in_frame", samples_in_frame,
-		"LAYOUT_MONO", LAYOUT_MONO);
-
-	// Keep track of the original sample format
-	AVSampleFormat output_sample_fmt = audio_codec_ctx->sample_fmt;
-
-	AVFrame *audio_frame = NULL;
-	if (!is_final) {
-		// Create input frame (and allocate arrays)
-		audio_frame = AV_ALLOCATE_FRAME();
-		AV_RESET_FRAME(audio_frame);
-		audio_frame->nb_samples = total_frame_samples / channels_in_frame;
-
-		// Fill input frame with sample data
-		int error_code = avcodec_fill_audio_frame(audio_frame, channels_in_frame, AV_SAMPLE_FMT_S16, (uint8_t *) all_queued_samples, all_queued_samples_size, 0);
-		if (error_code < 0) {
-			ZmqLogger::Instance()->AppendDebugMethod(
-				"FFmpegWriter::write_audio_packets ERROR ["
-					+ av_err2string(error_code) + "]",
-				"error_code", error_code);
-		}
-
-		// Do not convert audio to planar format (yet). We need to keep everything interleaved at this point.
-		switch (audio_codec_ctx->sample_fmt) {
-			case AV_SAMPLE_FMT_FLTP: {
-				output_sample_fmt = AV_SAMPLE_FMT_FLT;
-				break;
-			}
-			case AV_SAMPLE_FMT_S32P: {
-				output_sample_fmt = AV_SAMPLE_FMT_S32;
-				break;
-			}
-			case AV_SAMPLE_FMT_S16P: {
-				output_sample_fmt = AV_SAMPLE_FMT_S16;
-				break;
-			}
-			case AV_SAMPLE_FMT_U8P: {
-				output_sample_fmt = AV_SAMPLE_FMT_U8;
-				break;
-			}
-			default: {
-				// This is only here to silence unused-enum warnings
-				break;
-			}
-		}
-
-		// Update total samples & input frame size (due to bigger or smaller data types)
-		total_frame_samples *= (float(info.sample_rate) / sample_rate_in_frame); // adjust for different byte sizes
-		total_frame_samples *= (float(info.channels) / channels_in_frame); // adjust for different # of channels
-
-		// Create output frame (and allocate arrays)
-		AVFrame *audio_converted = AV_ALLOCATE_FRAME();
-		AV_RESET_FRAME(audio_converted);
-		audio_converted->nb_samples = total_frame_samples / channels_in_frame;
-		av_samples_alloc(audio_converted->data, audio_converted->linesize, info.channels, audio_converted->nb_samples, output_sample_fmt, 0);
-
-		ZmqLogger::Instance()->AppendDebugMethod(
-			"FFmpegWriter::write_audio_packets (1st resampling)",
-			"in_sample_fmt", AV_SAMPLE_FMT_S16,
-			"out_sample_fmt", output_sample_fmt,
-			"in_sample_rate", sample_rate_in_frame,
-			"out_sample_rate", info.sample_rate,
-			"in_channels", channels_in_frame,
-			"out_channels", info.channels);
-
-		// setup resample context
-		if (!avr) {
-			avr = SWR_ALLOC();
-			av_opt_set_int(avr, "in_channel_layout", channel_layout_in_frame, 0);
-			av_opt_set_int(avr, "out_channel_layout", info.channel_layout, 0);
-			av_opt_set_int(avr, "in_sample_fmt", AV_SAMPLE_FMT_S16, 0);
-			av_opt_set_int(avr, "out_sample_fmt", output_sample_fmt, 0); // planar not allowed here
-			av_opt_set_int(avr, "in_sample_rate", sample_rate_in_frame, 0);
-			av_opt_set_int(avr, "out_sample_rate", info.sample_rate, 0);
-			av_opt_set_int(avr, "in_channels", channels_in_frame, 0);
-			av_opt_set_int(avr, "out_channels", info.channels, 0);
-			SWR_INIT(avr);
-		}
-		// Convert audio samples
-		int nb_samples = SWR_CONVERT(
-			avr,	// audio resample context
-			audio_converted->data,		   // output data pointers
-			audio_converted->linesize[0],	// output plane size, in bytes. (0 if unknown)
-			audio_converted->nb_samples,	 // maximum number of samples that the output buffer can hold
-			audio_frame->data,			   // input data pointers
-			audio_frame->linesize[0],		// input plane size, in bytes (0 if unknown)
-			audio_frame->nb_samples		// number of input samples to convert
-		);
-
-		// Set remaining samples
-		remaining_frame_samples = total_frame_samples;
-
-		// Create a new array (to hold all resampled S16 audio samples)
-		all_resampled_samples = (int16_t *) av_malloc(
-			sizeof(int16_t) * nb_samples * info.channels
-			* (av_get_bytes_per_sample(output_sample_fmt) /
-			   av_get_bytes_per_sample(AV_SAMPLE_FMT_S16) )
-		);
-
-		// Copy audio samples over original samples
-		memcpy(all_resampled_samples, audio_converted->data[0],
-			   static_cast<size_t>(nb_samples)
-				   * info.channels
-				   * av_get_bytes_per_sample(output_sample_fmt));
-
-		// Remove converted audio
-		av_freep(&(audio_frame->data[0]));
-		AV_FREE_FRAME(&audio_frame);
-		av_freep(&audio_converted->data[0]);
-		AV_FREE_FRAME(&audio_converted);
-		all_queued_samples = NULL; // this array cleared with above call
-
-		ZmqLogger::Instance()->AppendDebugMethod(
-			"FFmpegWriter::write_audio_packets (Successfully completed 1st resampling)",
-			"nb_samples", nb_samples,
-			"remaining_frame_samples", remaining_frame_samples);
-	}
-
-	// Loop until no more samples
-	while (remaining_frame_samples > 0 || is_final) {
-		// Get remaining samples needed for this packet
-		int remaining_packet_samples = (audio_input_frame_size * info.channels) - audio_input_position;
-
-		// Determine how many samples we need
-		int diff = 0;
-		if (remaining_frame_samples >= remaining_packet_samples) {
-			diff = remaining_packet_samples;
-		} else {
-			diff = remaining_frame_samples;
-		}
-
-		// Copy frame samples into the packet samples array
-		if (!is_final)
-			//TODO: Make this more sane
-			memcpy(
-				samples + (audio_input_position
-					* (av_get_bytes_per_sample(output_sample_fmt) /
-					   av_get_bytes_per_sample(AV_SAMPLE_FMT_S16) )
-				),
-				all_resampled_samples + samples_position,
-				static_cast<size_t>(diff)
-					* av_get_bytes_per_sample(output_sample_fmt)
-			);
-
-		// Increment counters
-		audio_input_position += diff;
-		samples_position += diff * (av_get_bytes_per_sample(output_sample_fmt) / av_get_bytes_per_sample(AV_SAMPLE_FMT_S16));
-		remaining_frame_samples -= diff;
-
-		// Do we have enough samples to proceed?
-		if (audio_input_position < (audio_input_frame_size * info.channels) && !is_final)
-			// Not enough samples to encode... so wait until the next frame
-			break;
-
-		// Convert to planar (if needed by audio codec)
-		AVFrame *frame_final = AV_ALLOCATE_FRAME();
-		AV_RESET_FRAME(frame_final);
-		if (av_sample_fmt_is_planar(audio_codec_ctx->sample_fmt)) {
-			ZmqLogger::Instance()->AppendDebugMethod(
-				"FFmpegWriter::write_audio_packets (2nd resampling for Planar formats)",
-				"in_sample_fmt", output_sample_fmt,
-				"out_sample_fmt", audio_codec_ctx->sample_fmt,
-				"in_sample_rate", info.sample_rate,
-				"out_sample_rate", info.sample_rate,
-				"in_channels", info.channels,
-				"out_channels", info.channels
-			);
-
-			// setup resample context
-			if (!avr_planar) {
-				avr_planar = SWR_ALLOC();
-				av_opt_set_int(avr_planar, "in_channel_layout", info.channel_layout, 0);
-				av_opt_set_int(avr_planar, "out_channel_layout", info.channel_layout, 0);
-				av_opt_set_int(avr_planar, "in_sample_fmt", output_sample_fmt, 0);
-				av_opt_set_int(avr_planar, "out_sample_fmt", audio_codec_ctx->sample_fmt, 0); // planar not allowed here
-				av_opt_set_int(avr_planar, "in_sample_rate", info.sample_rate, 0);
-				av_opt_set_int(avr_planar, "out_sample_rate", info.sample_rate, 0);
-				av_opt_set_int(avr_planar, "in_channels", info.channels, 0);
-				av_opt_set_int(avr_planar, "out_channels", info.channels, 0);
-				SWR_INIT(avr_planar);
-			}
-
-			// Create input frame (and allocate arrays)
-			audio_frame = AV_ALLOCATE_FRAME();
-			AV_RESET_FRAME(audio_frame);
-			audio_frame->nb_samples = audio_input_position / info.channels;
-
-			// Create a new array
-			final_samples_planar = (int16_t *) av_malloc(
-				sizeof(int16_t) * audio_frame->nb_samples * info.channels
-				* (av_get_bytes_per_sample(output_sample_fmt) /
-				   av_get_bytes_per_sample(AV_SAMPLE_FMT_S16) )
-			);
-
-			// Copy audio into buffer for frame
-			memcpy(final_samples_planar, samples,
-				   static_cast<size_t>(audio_frame->nb_samples)
-					   * info.channels
-					   * av_get_bytes_per_sample(output_sample_fmt));
-
-			// Fill input frame with sample data
-			avcodec_fill_audio_frame(audio_frame, info.channels, output_sample_fmt,
-				(uint8_t *) final_samples_planar, audio_encoder_buffer_size, 0);
-
-			// Create output frame (and allocate arrays)
-			frame_final->nb_samples = audio_input_frame_size;
-			frame_final->channels = info.channels;
-			frame_final->format = audio_codec_ctx->sample_fmt;
-			frame_final->channel_layout = info.channel_layout;
-			av_samples_alloc(frame_final->data, frame_final->linesize, info.channels,
-				frame_final->nb_samples, audio_codec_ctx->sample_fmt, 0);
-
-			// Convert audio samples
-			int nb_samples = SWR_CONVERT(
-				avr_planar,				  // audio resample context
-				frame_final->data,		   // output data pointers
-				frame_final->linesize[0],	// output plane size, in bytes. (0 if unknown)
-				frame_final->nb_samples,	 // maximum number of samples that the output buffer can hold
-				audio_frame->data,		   // input data pointers
-				audio_frame->linesize[0],	// input plane size, in bytes (0 if unknown)
-				audio_frame->nb_samples	  // number of input samples to convert
-			);
-
-			// Copy audio samples over original samples
-			const auto copy_length = static_cast<size_t>(nb_samples)
-				* av_get_bytes_per_sample(audio_codec_ctx->sample_fmt)
-				* info.channels;
-
-			if (nb_samples > 0)
-				memcpy(samples, frame_final->data[0], copy_length);
-
-			// deallocate AVFrame
-			av_freep(&(audio_frame->data[0]));
-			AV_FREE_FRAME(&audio_frame);
-			all_queued_samples = NULL; // this array cleared with above call
-
-			ZmqLogger::Instance()->AppendDebugMethod(
-				"FFmpegWriter::write_audio_packets (Successfully completed 2nd resampling for Planar formats)",
-				"nb_samples", nb_samples);
-
-		} else {
-			// Create a new array
-			const auto buf_size = static_cast<size_t>(audio_input_position)
-				* (av_get_bytes_per_sample(audio_codec_ctx->sample_fmt) /
-				   av_get_bytes_per_sample(AV_SAMPLE_FMT_S16)
-				);
-			final_samples = reinterpret_cast<int16_t*>(
-					av_malloc(sizeof(int16_t) * buf_size));
-
-			// Copy audio into buffer for frame
-			memcpy(final_samples, samples,
-				audio_input_position * av_get_bytes_per_sample(audio_codec_ctx->sample_fmt));
-
-			// Init the nb_samples property
-			frame_final->nb_samples = audio_input_frame_size;
-
-			// Fill the final_frame AVFrame with audio (non planar)
-			avcodec_fill_audio_frame(frame_final, audio_codec_ctx->channels,
-				audio_codec_ctx->sample_fmt, (uint8_t *) final_samples,
-				audio_encoder_buffer_size, 0);
+		"fifo_samples", av_audio_fifo_size(audio_fifo),
+		"audio_input_frame_size", audio_input_frame_size);
+
+	// Encode each full frame of samples (and the rest, at the end)
+	while (av_audio_fifo_size(audio_fifo) >= audio_input_frame_size || (is_final && av_audio_fifo_size(audio_fifo) > 0)) {
+		// The encoder could still reference the previous samples
+		AVFrame *frame_final = audio_fifo_frame;
+		av_frame_make_writable(frame_final);
+		frame_final->nb_samples = audio_input_frame_size;
+		const int samples_read = av_audio_fifo_read(audio_fifo, (void **) frame_final->data, audio_input_frame_size);
+		if (samples_read < audio_input_frame_size) {
+			if (small_last_frame)
+				frame_final->nb_samples = samples_read;
+			else
+				av_samples_set_silence(frame_final->data, samples_read, audio_input_frame_size - samples_read,
+									   info.channels, audio_codec_ctx->sample_fmt);
 		}
 
 		// Set the AVFrame's PTS
@@ -1999,42 +2379,123 @@ void FFmpegWriter::write_audio_packets(bool is_final) {
 			pkt->stream_index = audio_st->index;
 			pkt->flags |= AV_PKT_FLAG_KEY;
 
-			/* write the compressed frame in the media file */
-			error_code = av_interleaved_write_frame(oc, pkt);
+			/* write the compressed frame in the media file (audio & video share the muxer) */
+			#pragma omp critical (write_packet)
+			error_code = write_packet(pkt);
 		}
 
 		if (error_code < 0) {
-			ZmqLogger::Instance()->AppendDebugMethod(
+			ZMQ_DEBUG(
 				"FFmpegWriter::write_audio_packets ERROR ["
 					+ av_err2string(error_code) + "]",
 				"error_code", error_code);
 		}
 
 		// Increment PTS (no pkt.duration, so calculate with maths)
-		audio_timestamp += FFMIN(audio_input_frame_size, audio_input_position);
-
-		// deallocate AVFrame
-		av_freep(&(frame_final->data[0]));
-		AV_FREE_FRAME(&frame_final);
+		audio_timestamp += frame_final->nb_samples;
 
 		// deallocate memory for packet
 		AV_FREE_PACKET(pkt);
+	}
+}
 
-		// Reset position
-		audio_input_position = 0;
-		is_final = false;
+// Add the samples of a frame to the audio FIFO
+void FFmpegWriter::fill_audio_fifo(std::shared_ptr<Frame> frame) {
+	const int frame_samples = frame->GetAudioSamplesCount();
+	const int frame_channels = frame->GetAudioChannelsCount();
+	if (frame_samples <= 0 || frame_channels <= 0)
+		return;
+
+	// The float channels of the frame are the input planes (no copies)
+	audio_planes.resize(frame_channels);
+	for (int channel = 0; channel < frame_channels; channel++)
+		audio_planes[channel] = reinterpret_cast<uint8_t *>(frame->GetAudioSamples(channel));
+
+	// Float samples at the output's rate and channels go straight into the FIFO
+	if (!avr && frame->SampleRate() == info.sample_rate && frame_channels == info.channels) {
+		if (audio_codec_ctx->sample_fmt == AV_SAMPLE_FMT_FLTP) {
+			av_audio_fifo_write(audio_fifo, (void **) audio_planes.data(), frame_samples);
+			return;
+		}
+		if (audio_codec_ctx->sample_fmt == AV_SAMPLE_FMT_FLT) {
+			frame->GetInterleavedAudioSamples(interleaved_samples);
+			void *interleaved = interleaved_samples.data();
+			av_audio_fifo_write(audio_fifo, &interleaved, frame_samples);
+			return;
+		}
 	}
 
-	// Delete arrays (if needed)
-	if (all_resampled_samples) {
-		av_freep(&all_resampled_samples);
-		all_resampled_samples = NULL;
+	// Other sample formats, rates and channels are converted (the resampler is set up by the first frame)
+	if (!avr) {
+		ZMQ_DEBUG(
+			"FFmpegWriter::fill_audio_fifo (resampling)",
+			"in_sample_rate", frame->SampleRate(),
+			"out_sample_rate", info.sample_rate,
+			"in_channels", frame_channels,
+			"out_channels", info.channels,
+			"out_sample_fmt", audio_codec_ctx->sample_fmt);
+
+		avr = SWR_ALLOC();
+		av_opt_set_int(avr, "in_channel_layout", frame->ChannelsLayout(), 0);
+		av_opt_set_int(avr, "out_channel_layout", info.channel_layout, 0);
+		av_opt_set_int(avr, "in_sample_fmt", AV_SAMPLE_FMT_FLTP, 0);
+		av_opt_set_int(avr, "out_sample_fmt", audio_codec_ctx->sample_fmt, 0);
+		av_opt_set_int(avr, "in_sample_rate", frame->SampleRate(), 0);
+		av_opt_set_int(avr, "out_sample_rate", info.sample_rate, 0);
+		av_opt_set_int(avr, "in_channels", frame_channels, 0);
+		av_opt_set_int(avr, "out_channels", info.channels, 0);
+		SWR_INIT(avr);
+	}
+	convert_audio(frame, frame_samples);
+}
+
+// Resample the samples of a frame (or flush the resampler) into the audio FIFO
+void FFmpegWriter::convert_audio(std::shared_ptr<Frame> frame, int frame_samples) {
+	// Room for the resampled samples (and the samples the resampler held back)
+	const int in_rate = frame ? frame->SampleRate() : info.sample_rate;
+	const int capacity = int(av_rescale_rnd(frame_samples, info.sample_rate, in_rate, AV_ROUND_UP)) + 1024;
+	if (capacity > audio_converted_capacity) {
+		if (audio_converted) {
+			av_freep(&audio_converted[0]);
+			av_freep(&audio_converted);
+		}
+		if (av_samples_alloc_array_and_samples(&audio_converted, NULL, info.channels, capacity, audio_codec_ctx->sample_fmt, 0) < 0) {
+			audio_converted = NULL;
+			audio_converted_capacity = 0;
+			throw OutOfMemory("Could not allocate the audio resample buffer", path);
+		}
+		audio_converted_capacity = capacity;
 	}
-	if (all_queued_samples) {
-		av_freep(&all_queued_samples);
-		all_queued_samples = NULL;
+
+	const int converted = SWR_CONVERT(
+		avr,						// audio resample context
+		audio_converted,			// output data pointers
+		0,							// output plane size, in bytes (0 if unknown)
+		audio_converted_capacity,	// maximum number of samples that the output buffer can hold
+		frame ? audio_planes.data() : NULL,	// input data pointers (NULL flushes the resampler)
+		0,							// input plane size, in bytes (0 if unknown)
+		frame_samples				// number of input samples to convert
+	);
+	if (converted > 0)
+		av_audio_fifo_write(audio_fifo, (void **) audio_converted, converted);
+}
+
+#if USE_SWS_THREADS
+// Free callback of a wrapped buffer (the buffer belongs to someone else)
+static void free_wrapped_buffer(void *opaque, uint8_t *data) {}
+
+// Point a reference counted AVFrame at the image of another AVFrame (without copying it)
+static void wrap_avframe(AVFrame *wrapper, const AVFrame *av_frame, AVPixelFormat pix_fmt, int width, int height, int buffer_size) {
+	for (int plane = 0; plane < AV_NUM_DATA_POINTERS; plane++) {
+		wrapper->data[plane] = av_frame->data[plane];
+		wrapper->linesize[plane] = av_frame->linesize[plane];
 	}
+	wrapper->width = width;
+	wrapper->height = height;
+	wrapper->format = pix_fmt;
+	wrapper->buf[0] = av_buffer_create(av_frame->data[0], buffer_size, free_wrapped_buffer, NULL, 0);
 }
+#endif // USE_SWS_THREADS
 
 // Allocate an AVFrame object
 AVFrame *FFmpegWriter::allocate_avframe(PixelFormat pix_fmt, int width, int height, int *buffer_size, uint8_t *new_buffer) {
@@ -2066,6 +2527,8 @@ AVFrame *FFmpegWriter::allocate_avframe(PixelFormat pix_fmt, int width, int heig
 
 // process video frame
 void FFmpegWriter::process_video_packet(std::shared_ptr<Frame> frame) {
+	RenderTraceSpan span("FFmpegWriter::process_video_packet", "encode");
+
 	// Determine the height & width of the source image
 	int source_image_width = frame->GetWidth();
 	int source_image_height = frame->GetHeight();
@@ -2079,10 +2542,7 @@ void FFmpegWriter::process_video_packet(std::shared_ptr<Frame> frame) {
 		InitScalers(source_image_width, source_image_height);
 
 	// Get a unique rescaler (for this thread)
-	SwsContext *scaler = image_rescalers[rescaler_position];
-	rescaler_position++;
-	if (rescaler_position == num_of_rescalers)
-		rescaler_position = 0;
+	SwsContext *scaler = image_rescalers[omp_get_thread_num() % image_rescalers.size()];
 
 	// Allocate an RGB frame & final output frame
 	int bytes_source = 0;
@@ -2099,7 +2559,7 @@ void FFmpegWriter::process_video_packet(std::shared_ptr<Frame> frame) {
 	AVFrame *frame_final;
 #if USE_HW_ACCEL
 	if (hw_en_on && hw_en_supported) {
-		frame_final = allocate_avframe(AV_PIX_FMT_NV12, info.width, info.height, &bytes_final, NULL);
+		frame_final = allocate_avframe(hw_en_sw_pix_fmt, info.width, info.height, &bytes_final, NULL);
 	} else
 #endif // USE_HW_ACCEL
 	{
@@ -2114,15 +2574,61 @@ void FFmpegWriter::process_video_packet(std::shared_ptr<Frame> frame) {
 
 	// Fill with data
 	AV_COPY_PICTURE_DATA(frame_source, (uint8_t *) pixels, PIX_FMT_RGBA, source_image_width, source_image_height);
-	ZmqLogger::Instance()->AppendDebugMethod(
+	ZMQ_DEBUG(
 		"FFmpegWriter::process_video_packet",
 		"frame->number", frame->number,
 		"bytes_source", bytes_source,
 		"bytes_final", bytes_final);
 
 	// Resize & convert pixel format
+#if USE_SWS_THREADS
+	// Convert in slices (on the rescaler's threads). sws_scale_frame() needs reference counted
+	// frames, so wrap the existing buffers (instead of letting it copy the source image).
+	AVFrame *src_ref = av_frame_alloc();
+	AVFrame *dst_ref = av_frame_alloc();
+	int sws_result = AVERROR(ENOMEM);
+	if (src_ref && dst_ref) {
+		wrap_avframe(src_ref, frame_source, PIX_FMT_RGBA, source_image_width, source_image_height, bytes_source);
+		wrap_avframe(dst_ref, frame_final, (AVPixelFormat) frame_final->format, info.width, info.height, bytes_final);
+		if (src_ref->buf[0] && dst_ref->buf[0])
+			sws_result = sws_scale_frame(scaler, dst_ref, src_ref);
+	}
+	av_frame_free(&src_ref);
+	av_frame_free(&dst_ref);
+	if (sws_result < 0) {
+		ZMQ_DEBUG(
+			"FFmpegWriter::process_video_packet ERROR [" + av_err2string(sws_result) + "]",
+			"frame->number", frame->number);
+	}
+#else
 	sws_scale(scaler, frame_source->data, frame_source->linesize, 0,
 			  source_image_height, frame_final->data, frame_final->linesize);
+#endif // USE_SWS_THREADS
+
+#if USE_HW_ACCEL
+	if (hw_en_on && hw_en_supported) {
+		// Upload to a GPU surface here (in parallel with the other frames), instead of on the encoding thread
+		AVFrame *hw_frame = av_frame_alloc();
+		if (!hw_frame || av_hwframe_get_buffer(video_codec_ctx->hw_frames_ctx, hw_frame, 0) < 0) {
+			std::clog << "Error code: av_hwframe_get_buffer\n";
+			av_frame_free(&hw_frame);
+		} else if (av_hwframe_transfer_data(hw_frame, frame_final, 0) < 0) {
+			std::clog << "Error while transferring frame data to surface.\n";
+			av_frame_free(&hw_frame);
+		} else {
+			av_frame_copy_props(hw_frame, frame_final);
+		}
+
+		// The surface replaces the converted image
+		av_freep(&(frame_final->data[0]));
+		AV_FREE_FRAME(&frame_final);
+		if (!hw_frame) {
+			AV_FREE_FRAME(&frame_source);
+			return;
+		}
+		frame_final = hw_frame;
+	}
+#endif // USE_HW_ACCEL
 
 	// Add resized AVFrame to av_frames map
 	add_avframe(frame, frame_final);
@@ -2131,11 +2637,36 @@ void FFmpegWriter::process_video_packet(std::shared_ptr<Frame> frame) {
 	AV_FREE_FRAME(&frame_source);
 }
 
+// Determine if a frame has the same image as the frame before it
+bool FFmpegWriter::same_image(std::shared_ptr<Frame> frame, std::shared_ptr<Frame> previous) {
+	if (frame->GetWidth() != previous->GetWidth() || frame->GetHeight() != previous->GetHeight())
+		return false;
+	if (frame->GetWidth() == 1 && frame->GetHeight() == 1)
+		return false; // no image (nothing is encoded)
+
+	// The same buffer (i.e. the timeline re-used the image of a still frame)
+	std::shared_ptr<QImage> image = frame->GetImage();
+	std::shared_ptr<QImage> previous_image = previous->GetImage();
+	if (image == previous_image || image->cacheKey() == previous_image->cacheKey())
+		return true;
+	if (image->format() != previous_image->format())
+		return false;
+
+	// Compare the pixels, row by row (changed images usually differ in their first rows)
+	const size_t row_bytes = size_t(image->width()) * image->depth() / 8;
+	for (int y = 0; y < image->height(); y++)
+		if (memcmp(image->constScanLine(y), previous_image->constScanLine(y), row_bytes) != 0)
+			return false;
+	return true;
+}
+
 // write video frame
 bool FFmpegWriter::write_video_packet(std::shared_ptr<Frame> frame, AVFrame *frame_final) {
+	RenderStageTimer timer(RENDER_STAGE_ENCODE);
+	RenderTraceSpan span("FFmpegWriter::write_video_packet", "encode");
 #if (LIBAVFORMAT_VERSION_MAJOR >= 58)
 	// FFmpeg 4.0+
-	ZmqLogger::Instance()->AppendDebugMethod(
+	ZMQ_DEBUG(
 		"FFmpegWriter::write_video_packet",
 		"frame->number", frame->number,
 		"oc->oformat->flags", oc->oformat->flags);
@@ -2145,7 +2676,7 @@ bool FFmpegWriter::write_video_packet(std::shared_ptr<Frame> frame, AVFrame *fra
 	// TODO: Should we have moved away from oc->oformat->flags / AVFMT_RAWPICTURE
 	// on ffmpeg < 4.0 as well?
 	// Does AV_CODEC_ID_RAWVIDEO not work in ffmpeg 3.x?
-	ZmqLogger::Instance()->AppendDebugMethod(
+	ZMQ_DEBUG(
 		"FFmpegWriter::write_video_packet",
 		"frame->number", frame->number,
 		"oc->oformat->flags & AVFMT_RAWPICTURE", oc->oformat->flags & AVFMT_RAWPICTURE);
@@ -2170,10 +2701,12 @@ bool FFmpegWriter::write_video_packet(std::shared_ptr<Frame> frame, AVFrame *fra
 		// Set PTS (in frames and scaled to the codec's timebase)
 		pkt->pts = video_timestamp;
 
-		/* write the compressed frame in the media file */
-		int error_code = av_interleaved_write_frame(oc, pkt);
+		/* write the compressed frame in the media file (audio & video share the muxer) */
+		int error_code = 0;
+		#pragma omp critical (write_packet)
+		error_code = write_packet(pkt);
 		if (error_code < 0) {
-			ZmqLogger::Instance()->AppendDebugMethod(
+			ZMQ_DEBUG(
 				"FFmpegWriter::write_video_packet ERROR ["
 					+ av_err2string(error_code) + "]",
 				"error_code", error_code);
@@ -2198,24 +2731,10 @@ bool FFmpegWriter::write_video_packet(std::shared_ptr<Frame> frame, AVFrame *fra
 
 		// Assign the initial AVFrame PTS from the frame counter
 		frame_final->pts = video_timestamp;
-#if USE_HW_ACCEL
-		if (hw_en_on && hw_en_supported) {
-			if (!(hw_frame = av_frame_alloc())) {
-				std::clog << "Error code: av_hwframe_alloc\n";
-			}
-			if (av_hwframe_get_buffer(video_codec_ctx->hw_frames_ctx, hw_frame, 0) < 0) {
-				std::clog << "Error code: av_hwframe_get_buffer\n";
-			}
-			if (!hw_frame->hw_frames_ctx) {
-				std::clog << "Error hw_frames_ctx.\n";
-			}
-			hw_frame->format = AV_PIX_FMT_NV12;
-			if ( av_hwframe_transfer_data(hw_frame, frame_final, 0) < 0) {
-				std::clog << "Error while transferring frame data to surface.\n";
-			}
-			av_frame_copy_props(hw_frame, frame_final);
-		}
-#endif // USE_HW_ACCEL
+
+		// A live stream resumes with a keyframe, after the network dropped video packets
+		if (is_live && live_wait_for_keyframe)
+			frame_final->pict_type = AV_PICTURE_TYPE_I;
 		/* encode the image */
 		int got_packet_ptr = 0;
 		int error_code = 0;
@@ -2223,17 +2742,11 @@ bool FFmpegWriter::write_video_packet(std::shared_ptr<Frame> frame, AVFrame *fra
 		// Write video packet
 		int ret;
 
-	#if USE_HW_ACCEL
-		if (hw_en_on && hw_en_supported) {
-			ret = avcodec_send_frame(video_codec_ctx, hw_frame);  //hw_frame!!!
-		} else
-	#endif // USE_HW_ACCEL
-		{
-			ret = avcodec_send_frame(video_codec_ctx, frame_final);
-		}
+		// (with hardware encoding, frame_final is already a GPU surface)
+		ret = avcodec_send_frame(video_codec_ctx, frame_final);
 		error_code = ret;
 		if (ret < 0 ) {
-			ZmqLogger::Instance()->AppendDebugMethod(
+			ZMQ_DEBUG(
 				"FFmpegWriter::write_video_packet (Frame not sent)");
 			if (ret == AVERROR(EAGAIN) ) {
 				std::clog << "Frame EAGAIN\n";
@@ -2262,13 +2775,13 @@ bool FFmpegWriter::write_video_packet(std::shared_ptr<Frame> frame, AVFrame *fra
 		// Write video packet (older than FFmpeg 3.2)
 		error_code = avcodec_encode_video2(video_codec_ctx, pkt, frame_final, &got_packet_ptr);
 		if (error_code != 0) {
-			ZmqLogger::Instance()->AppendDebugMethod(
+			ZMQ_DEBUG(
 				"FFmpegWriter::write_video_packet ERROR ["
 					+ av_err2string(error_code) + "]",
 				"error_code", error_code);
 		}
 		if (got_packet_ptr == 0) {
-			ZmqLogger::Instance()->AppendDebugMethod(
+			ZMQ_DEBUG(
 				"FFmpegWriter::write_video_packet (Frame gotpacket error)");
 		}
 #endif // IS_FFMPEG_3_2
@@ -2279,10 +2792,12 @@ bool FFmpegWriter::write_video_packet(std::shared_ptr<Frame> frame, AVFrame *fra
 			av_packet_rescale_ts(pkt, video_codec_ctx->time_base, video_st->time_base);
 			pkt->stream_index = video_st->index;
 
-			/* write the compressed frame in the media file */
-			int result = av_interleaved_write_frame(oc, pkt);
+			/* write the compressed frame in the media file (audio & video share the muxer) */
+			int result = 0;
+			#pragma omp critical (write_packet)
+			result = write_packet(pkt);
 			if (result < 0) {
-				ZmqLogger::Instance()->AppendDebugMethod(
+				ZMQ_DEBUG(
 					"FFmpegWriter::write_video_packet ERROR ["
 						+ av_err2string(result) + "]",
 					"result", result);
@@ -2293,12 +2808,9 @@ bool FFmpegWriter::write_video_packet(std::shared_ptr<Frame> frame, AVFrame *fra
 		// Deallocate packet
 		AV_FREE_PACKET(pkt);
 #if USE_HW_ACCEL
-		if (hw_en_on && hw_en_supported) {
-			if (hw_frame) {
-				av_frame_free(&hw_frame);
-				hw_frame = NULL;
-			}
-		}
+		// Return the surface to the pool (the encoder keeps its own reference)
+		if (frame_final->hw_frames_ctx)
+			av_frame_unref(frame_final);
 #endif // USE_HW_ACCEL
 	}
 
@@ -2322,20 +2834,45 @@ void FFmpegWriter::InitScalers(int source_width, int source_height) {
 		scale_mode = SWS_BICUBIC;
 	}
 
+	// Determine the output pixel format
+	AVPixelFormat dest_pix_fmt = (AVPixelFormat) AV_GET_CODEC_PIXEL_FORMAT(video_st, video_st->codec);
+#if USE_HW_ACCEL
+	if (hw_en_on && hw_en_supported)
+		dest_pix_fmt = hw_en_sw_pix_fmt;
+#endif // USE_HW_ACCEL
+
+#if USE_SWS_THREADS
+	// Each rescaler converts one frame at a time, and at most cache_size frames are converted
+	// at once. Split each image into slices, so the spare processors help convert it.
+	int frames_in_flight = std::max(1, std::min(num_of_rescalers, cache_size));
+	int slice_threads = std::max(1, OPEN_MP_NUM_PROCESSORS / frames_in_flight);
+#endif // USE_SWS_THREADS
+
 	// Init software rescalers vector (many of them, one for each thread)
 	for (int x = 0; x < num_of_rescalers; x++) {
 		// Init the software scaler from FFMpeg
-#if USE_HW_ACCEL
-		if (hw_en_on && hw_en_supported) {
-			img_convert_ctx = sws_getContext(source_width, source_height, PIX_FMT_RGBA,
-				info.width, info.height, AV_PIX_FMT_NV12, scale_mode, NULL, NULL, NULL);
-		} else
-#endif // USE_HW_ACCEL
-		{
-			img_convert_ctx = sws_getContext(source_width, source_height, PIX_FMT_RGBA,
-				info.width, info.height, AV_GET_CODEC_PIXEL_FORMAT(video_st, video_st->codec),
-				scale_mode, NULL, NULL, NULL);
+#if USE_SWS_THREADS
+		img_convert_ctx = sws_alloc_context();
+		if (img_convert_ctx) {
+			av_opt_set_int(img_convert_ctx, "srcw", source_width, 0);
+			av_opt_set_int(img_convert_ctx, "srch", source_height, 0);
+			av_opt_set_int(img_convert_ctx, "src_format", PIX_FMT_RGBA, 0);
+			av_opt_set_int(img_convert_ctx, "dstw", info.width, 0);
+			av_opt_set_int(img_convert_ctx, "dsth", info.height, 0);
+			av_opt_set_int(img_convert_ctx, "dst_format", dest_pix_fmt, 0);
+			av_opt_set_int(img_convert_ctx, "sws_flags", scale_mode, 0);
+			av_opt_set_int(img_convert_ctx, "threads", slice_threads, 0);
+			if (sws_init_context(img_convert_ctx, NULL, NULL) < 0) {
+				sws_freeContext(img_convert_ctx);
+				img_convert_ctx = NULL;
+			}
 		}
+#else
+		img_convert_ctx = sws_getContext(source_width, source_height, PIX_FMT_RGBA,
+			info.width, info.height, dest_pix_fmt, scale_mode, NULL, NULL, NULL);
+#endif // USE_SWS_THREADS
+		if (!img_convert_ctx)
+			throw OutOfMemory("Could not initialize the image rescaler", path);
 
 		// Add rescaler to vector
 		image_rescalers.push_back(img_convert_ctx);
@@ -2351,8 +2888,8 @@ void FFmpegWriter::ResampleAudio(int sample_rate, int channels) {
 // Remove & deallocate all software scalers
 void FFmpegWriter::RemoveScalers() {
 	// Close all rescalers
-	for (int x = 0; x < num_of_rescalers; x++)
-		sws_freeContext(image_rescalers[x]);
+	for (auto scaler : image_rescalers)
+		sws_freeContext(scaler);
 
 	// Clear vector
 	image_rescalers.clear();
@@ -16,6 +16,13 @@
 #ifndef OPENSHOT_FFMPEG_WRITER_H
 #define OPENSHOT_FFMPEG_WRITER_H
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
 #include "ReaderBase.h"
 #include "WriterBase.h"
 
@@ -112,6 +119,17 @@ namespace openshot {
 	 * w.Close();
 	 * r.Close();
 	 * @endcode
+	 *
+	 * @code LIVE STREAMING EXAMPLE
+	 * // Stream a timeline to an RTMP ingest server, in real time (see SetLive)
+	 * FFmpegWriter w("rtmp://live.example.com/app/stream-key");
+	 * w.SetAudioOptions(true, "aac", 44100, 2, openshot::ChannelLayout::LAYOUT_STEREO, 128000);
+	 * w.SetVideoOptions(true, "libx264", openshot::Fraction(30,1), 1280, 720, openshot::Fraction(1,1), false, false, 3000000);
+	 * w.SetLive(true, 500);
+	 * w.Open();
+	 * w.WriteFrame(&timeline, 1, timeline.info.video_length);
+	 * w.Close();
+	 * @endcode
 	 */
 	class FFmpegWriter : public WriterBase {
 	private:
@@ -131,21 +149,22 @@ namespace openshot {
 		AVCodecContext *video_codec_ctx;
 		AVCodecContext *audio_codec_ctx;
 		SwsContext *img_convert_ctx;
-		int16_t *samples;
-		uint8_t *audio_outbuf;
+		AVAudioFifo *audio_fifo; ///< The samples waiting to be encoded (in the encoder's sample format)
+		AVFrame *audio_fifo_frame; ///< The frame the encoder reads the samples from (re-used for every packet)
+		std::vector<uint8_t *> audio_planes; ///< The channels of the current audio frame (the resampler's input)
+		std::vector<float> interleaved_samples; ///< The interleaved samples of the current audio frame (re-used for every frame)
+		uint8_t **audio_converted; ///< The resampled samples of the current audio frame (re-used, and grown as needed)
+		int audio_converted_capacity;
 		uint8_t *audio_encoder_buffer;
 
 		int num_of_rescalers;
-		int rescaler_position;
 		std::vector<SwsContext *> image_rescalers;
+		int render_threads;
 
-		int audio_outbuf_size;
 		int audio_input_frame_size;
 		int initial_audio_input_frame_size;
-		int audio_input_position;
 		int audio_encoder_buffer_size;
 		SWRCONTEXT *avr;
-		SWRCONTEXT *avr_planar;
 
 		/* Resample options */
 		int original_sample_rate;
@@ -158,11 +177,53 @@ namespace openshot {
 		std::deque<std::shared_ptr<openshot::Frame> > queued_audio_frames;
 		std::deque<std::shared_ptr<openshot::Frame> > queued_video_frames;
 
-		std::deque<std::shared_ptr<openshot::Frame> > processed_frames;
 		std::deque<std::shared_ptr<openshot::Frame> > deallocate_frames;
 
 		std::map<std::shared_ptr<openshot::Frame>, AVFrame *> av_frames;
 
+		/* Live streaming (see SetLive) */
+		bool is_live;
+		int live_latency_ms;
+		int64_t live_frames; ///< The number of frames written (or dropped) since the stream started
+		std::chrono::steady_clock::time_point live_start;
+		std::atomic<int64_t> dropped_frames;
+		std::atomic<bool> live_wait_for_keyframe; ///< Video packets are dropped until the next keyframe
+
+		/* Variable frame rate (see SetVariableFrameRate) */
+		bool is_vfr;
+		std::shared_ptr<openshot::Frame> last_video_frame; ///< The last image frame written (or elided)
+		bool last_video_frame_elided; ///< The last image frame repeated the image before it (and was not encoded)
+		std::atomic<int64_t> elided_frames;
+
+		/* Muxing thread (see SetLive and SetAsyncMuxing) */
+		bool is_async;
+		int64_t mux_buffer_bytes; ///< The encoder waits while the queued packets are larger than this
+		std::thread mux_thread;
+		std::mutex muxMutex;
+		std::condition_variable mux_changed;
+		std::deque<std::pair<AVPacket *, int64_t>> mux_packets; ///< The packets waiting to be muxed (and their times, in microseconds)
+		int64_t mux_queued_bytes;
+		bool mux_stopping;
+		int mux_error; ///< The first error of the muxing thread (0 if none)
+
+		/* Buffered output file (see SetAsyncMuxing) */
+		bool use_direct_io;
+		int output_fd; ///< The output file, when the writer opens it itself (or -1)
+		int output_direct_fd; ///< The output file, opened again for direct I/O (or -1)
+		int64_t output_position;
+		unsigned char *output_buffer;
+
+#if USE_HW_ACCEL
+		/* Hardware encoding (see SetVideoOptions, and HardwareDevices) */
+		int hw_en_on = 1; ///< A hardware encoder was selected
+		int hw_en_supported = 0; ///< The hardware encoder is used (0 after falling back to a software encoder)
+		AVPixelFormat hw_en_av_pix_fmt = AV_PIX_FMT_NONE;
+		AVHWDeviceType hw_en_av_device_type = AV_HWDEVICE_TYPE_VAAPI;
+		AVPixelFormat hw_en_sw_pix_fmt = AV_PIX_FMT_NV12; ///< Format of the images uploaded to the GPU
+		AVBufferRef *hw_device_ctx = NULL;
+		int hw_device_index = -1; ///< The GPU of the hardware encoder (see HardwareDevices)
+#endif
+
 		/// Add an AVFrame to the cache
 		void add_avframe(std::shared_ptr<openshot::Frame> frame, AVFrame *av_frame);
 
@@ -178,15 +239,45 @@ namespace openshot {
 		/// Auto detect format (from path)
 		void auto_detect_format();
 
+		/// Resample the samples of a frame (or flush the resampler, without a frame) into the audio FIFO
+		void convert_audio(std::shared_ptr<openshot::Frame> frame, int frame_samples);
+
 		/// Close the audio codec
 		void close_audio(AVFormatContext *oc, AVStream *st);
 
 		/// Close the video codec
 		void close_video(AVFormatContext *oc, AVStream *st);
 
+		/// Add the samples of a frame to the audio FIFO (converting them, if the encoder needs another format)
+		void fill_audio_fifo(std::shared_ptr<openshot::Frame> frame);
+
 		/// Flush encoders
 		void flush_encoders();
 
+		/// Is the next frame of a live stream later than the allowed latency
+		bool live_frame_is_late();
+
+		/// Wait for the wall clock time of the next frame of a live stream (returns false if the frame is too late)
+		bool wait_for_live_frame();
+
+		/// Mux the queued packets (on the muxing thread), at their times when streaming live
+		void mux_queued_packets();
+
+		/// Stop the muxing thread (after muxing the queued packets)
+		void stop_mux_thread();
+
+		/// Open a local output file with a large buffer of our own (returns false for other outputs)
+		bool open_output_file();
+
+		/// Flush and close the output file opened by open_output_file()
+		void close_output_file();
+
+		/// Write the buffered output to the file (the AVIOContext callback)
+		static int write_output(void *opaque, uint8_t *buf, int buf_size);
+
+		/// Seek the output file (the AVIOContext callback)
+		static int64_t seek_output(void *opaque, int64_t offset, int whence);
+
 		/// initialize streams
 		void initialize_streams();
 
@@ -198,12 +289,18 @@ namespace openshot {
 		/// open audio codec
 		void open_audio(AVFormatContext *oc, AVStream *st);
 
+		/// Open a GPU for the hardware encoder (or switch to a software encoder of the codec, when no GPU is available)
+		void open_hw_device();
+
 		/// open video codec
 		void open_video(AVFormatContext *oc, AVStream *st);
 
 		/// process video frame
 		void process_video_packet(std::shared_ptr<openshot::Frame> frame);
 
+		/// Determine if a frame has the same image as the frame before it (the same buffer, or the same pixels)
+		bool same_image(std::shared_ptr<openshot::Frame> frame, std::shared_ptr<openshot::Frame> previous);
+
 		/// write all queued frames' audio to the video file
 		void write_audio_packets(bool is_final);
 
@@ -213,6 +310,9 @@ namespace openshot {
 		/// write all queued frames
 		void write_queued_frames();
 
+		/// Mux an encoded packet (or queue it for the muxing thread, when streaming live or muxing asynchronously)
+		int write_packet(AVPacket *pkt);
+
 	public:
 
 		/// @brief Constructor for FFmpegWriter.
@@ -227,6 +327,24 @@ namespace openshot {
 		/// Get the cache size (number of frames to queue before writing)
 		int GetCacheSize() { return cache_size; };
 
+		/// Get the number of frames a live stream dropped (since they were rendered, or sent, too late)
+		int64_t GetDroppedFrames() { return dropped_frames; };
+
+		/// Get the number of frames which were not encoded, since they repeated the image before them (see SetVariableFrameRate)
+		int64_t GetElidedFrames() { return elided_frames; };
+
+		/// Get the number of threads which render frames ahead of the encoder (see SetRenderThreads)
+		int GetRenderThreads() { return render_threads; };
+
+		/// Determine if the packets are muxed on a thread of their own (see SetAsyncMuxing)
+		bool IsAsyncMuxing() { return is_async; };
+
+		/// Determine if the writer streams in real time (see SetLive)
+		bool IsLive() { return is_live; };
+
+		/// Determine if repeated images are elided from the video (see SetVariableFrameRate)
+		bool IsVariableFrameRate() { return is_vfr; };
+
 		/// Determine if writer is open or closed
 		bool IsOpen() { return is_open; };
 
@@ -277,6 +395,59 @@ namespace openshot {
 		/// @param new_size The number of frames to queue before writing to the file
 		void SetCacheSize(int new_size) { cache_size = new_size; };
 
+		/// @brief Stream in real time (i.e. to an RTMP, SRT or HLS ingest), instead of writing as fast as possible.
+		/// This must be called before Open().
+		///
+		/// Frames are paced against the wall clock: WriteFrame() waits until a frame is due (at most
+		/// max_latency_ms early), and each frame is encoded right away, with low delay encoder settings
+		/// (no B-frames, and a keyframe every 2 seconds). The packets are sent by a separate thread.
+		///
+		/// When the renderer falls behind, the frames which are later than max_latency_ms are dropped (when
+		/// writing from a reader, they are not rendered, and their audio is silent). When the network falls
+		/// behind, the queued video packets are dropped, and the video resumes at the next keyframe. Frames
+		/// from a reader are rendered one at a time (the render threads are not used).
+		///
+		/// Streaming URLs choose their muxer by protocol (rtmp:// uses FLV, srt:// and udp:// use MPEG-TS).
+		/// MP4 files are fragmented, and HLS playlists (.m3u8) keep a sliding window of 2 second segments.
+		///
+		/// @param live Stream in real time
+		/// @param max_latency_ms The latency allowed before frames are dropped (in milliseconds)
+		void SetLive(bool live, int max_latency_ms = 1000);
+
+		/// @brief Mux the encoded packets on a thread of their own, so the encoder doesn't wait for slow
+		/// storage (i.e. network shares), unless the queued packets grow larger than the buffer. This must be
+		/// set before the writer is opened.
+		///
+		/// Local files are written through a large output buffer (instead of FFmpeg's small default buffer).
+		/// With direct I/O, the large sequential blocks of the buffer bypass the page cache (where the
+		/// platform supports it), and the other writes (i.e. of the header) are cached as usual. Muxing errors
+		/// are reported by the next WriteFrame() call.
+		///
+		/// @param async Mux on a separate thread
+		/// @param buffer_mb The max size of the queued packets (in megabytes)
+		/// @param direct_io Write the large blocks of a local file with direct I/O
+		void SetAsyncMuxing(bool async, int buffer_mb = 64, bool direct_io = false);
+
+		/// @brief Set the number of threads which render frames ahead of the encoder, when writing
+		/// a block of frames from a reader. Frames are still encoded in order, while the next frames
+		/// are rendered in parallel. The reader must support concurrent calls to GetFrame().
+		/// @param new_threads The number of render threads (1 = get each frame synchronously, the default)
+		void SetRenderThreads(int new_threads) { render_threads = (new_threads < 1) ? 1 : new_threads; };
+
+		/// @brief Write a variable frame rate video: a frame with the same image as the frame before it
+		/// (i.e. a title, a still image or a paused clip) is not encoded, and the frame before it lasts
+		/// longer instead (until the timestamp of the next changed frame). This must be set before the
+		/// writer is opened.
+		///
+		/// Repeated images are found by their buffer (the timeline shares it between frames of a still
+		/// image), or else by comparing their pixels, which is much faster than converting and encoding
+		/// them. The last frame is always encoded, so the video lasts as long as its audio. The frame rate
+		/// of the video stays the nominal rate (fps), and live streams always encode every frame. Formats
+		/// with a constant frame rate (i.e. AVI) may still store empty frames for the repeated images.
+		///
+		/// @param vfr Elide the repeated images
+		void SetVariableFrameRate(bool vfr);
+
 		/// @brief Set video export options
 		/// @param has_video Does this file need a video stream
 		/// @param codec The codec used to encode the images in this video
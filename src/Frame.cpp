@@ -10,14 +10,21 @@
 //
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
+#include <algorithm>	// for std::copy
 #include <thread>	// for std::this_thread::sleep_for
 #include <chrono>	// for std::chrono::milliseconds
 #include <sstream>
 #include <iomanip>
 
 #include "Frame.h"
+#include "AllocationStats.h"
+#include "AudioBufferPool.h"
 #include "AudioBufferSource.h"
 #include "AudioResampler.h"
+#include "ImageBufferPool.h"
+#include "PixelKernels.h"
+#include "TiledImage.h"
+#include "WaveformRenderer.h"
 #include "QtUtilities.h"
 
 #include <AppConfig.h>
@@ -43,7 +50,7 @@ using namespace openshot;
 
 // Constructor - image & audio
 Frame::Frame(int64_t number, int width, int height, std::string color, int samples, int channels)
-	: audio(std::make_shared<juce::AudioBuffer<float>>(channels, samples)),
+	: audio(AudioBufferPool::Instance()->Create(channels, samples)),
 	  number(number), width(width), height(height),
 	  pixel_ratio(1,1), color(color),
 	  channels(channels), channel_layout(LAYOUT_STEREO),
@@ -98,10 +105,14 @@ void Frame::DeepCopy(const Frame& other)
 	color = other.color;
 	max_audio_sample = other.max_audio_sample;
 
+	// Pixels and samples are shared (copy-on-write), until either frame changes them. A QImage copy
+	// detaches on its first write, and the audio buffer is copied by DetachAudio().
 	if (other.image)
 		image = std::make_shared<QImage>(*(other.image));
-	if (other.audio)
-		audio = std::make_shared<juce::AudioBuffer<float>>(*(other.audio));
+	if (other.tiled_image)
+		tiled_image = std::make_shared<TiledImage>(*(other.tiled_image));
+	solid_color = other.solid_color;
+	audio = other.audio;
 	if (other.wave_image)
 		wave_image = std::make_shared<QImage>(*(other.wave_image));
 }
@@ -161,74 +172,11 @@ std::shared_ptr<QImage> Frame::GetWaveform(int width, int height, int Red, int G
 	// Clear any existing waveform image
 	ClearWaveform();
 
-	// Init a list of lines
-	QVector<QPointF> lines;
-	QVector<QPointF> labels;
-
-	// Calculate width of an image based on the # of samples
-	int total_samples = GetAudioSamplesCount();
-	if (total_samples > 0)
+	// Rasterize the waveform at the final size (one span of sample values per column)
+	std::vector<int> spans = WaveformRenderer::GetSpans(*this, width, height);
+	if (!spans.empty())
 	{
-		// If samples are present...
-		int new_height = 200 * audio->getNumChannels();
-		int height_padding = 20 * (audio->getNumChannels() - 1);
-		int total_height = new_height + height_padding;
-		int total_width = 0;
-		float zero_height = 1.0; // Used to clamp near-zero vales to this value to prevent gaps
-
-		// Loop through each audio channel
-		float Y = 100.0;
-		for (int channel = 0; channel < audio->getNumChannels(); channel++)
-		{
-			float X = 0.0;
-
-			// Get audio for this channel
-			const float *samples = audio->getReadPointer(channel);
-
-			for (int sample = 0; sample < GetAudioSamplesCount(); sample++, X++)
-			{
-				// Sample value (scaled to -100 to 100)
-				float value = samples[sample] * 100.0;
-
-				// Set threshold near zero (so we don't allow near-zero values)
-				// This prevents empty gaps from appearing in the waveform
-				if (value > -zero_height && value < 0.0) {
-					value = -zero_height;
-				} else if (value > 0.0 && value < zero_height) {
-					value = zero_height;
-				}
-
-				// Append a line segment for each sample
-				lines.push_back(QPointF(X, Y));
-				lines.push_back(QPointF(X, Y - value));
-			}
-
-			// Add Channel Label Coordinate
-			labels.push_back(QPointF(5.0, Y - 5.0));
-
-			// Increment Y
-			Y += (200 + height_padding);
-			total_width = X;
-		}
-
-		// Create blank image
-		wave_image = std::make_shared<QImage>(
-			total_width, total_height, QImage::Format_RGBA8888_Premultiplied);
-		wave_image->fill(QColor(0,0,0,0));
-
-		// Load QPainter with wave_image device
-		QPainter painter(wave_image.get());
-
-		// Set pen color
-		QPen pen;
-		pen.setColor(QColor(Red, Green, Blue, Alpha));
-		pen.setWidthF(1.0);
-		pen.setStyle(Qt::SolidLine);
-		painter.setPen(pen);
-
-		// Draw the waveform
-		painter.drawLines(lines);
-		painter.end();
+		wave_image = WaveformRenderer::Rasterize(spans, width, height, QColor(Red, Green, Blue, Alpha));
 	}
 	else
 	{
@@ -237,12 +185,6 @@ std::shared_ptr<QImage> Frame::GetWaveform(int width, int height, int Red, int G
 		wave_image->fill(QColor(QString::fromStdString("#000000")));
 	}
 
-	// Resize Image (if needed)
-	if (wave_image->width() != width || wave_image->height() != height) {
-		QImage scaled_wave_image = wave_image->scaled(width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-		wave_image = std::make_shared<QImage>(scaled_wave_image);
-	}
-
 	// Return new image
 	return wave_image;
 }
@@ -320,32 +262,39 @@ float* Frame::GetAudioSamples(int channel) {
 	return buffer->getWritePointer(channel);
 }
 
+// Interleave the samples of several channels (c1 c2 c1 c2 c1 c2). Mono and stereo (by far the most
+// common layouts) have their own loops, which the compiler vectorizes into shuffles.
+static void interleave_samples(const float* const* channels, int num_of_channels, int num_of_samples, float* output)
+{
+	if (num_of_channels == 1) {
+		std::copy(channels[0], channels[0] + num_of_samples, output);
+	} else if (num_of_channels == 2) {
+		const float *left = channels[0];
+		const float *right = channels[1];
+		for (int sample = 0; sample < num_of_samples; sample++) {
+			output[sample * 2] = left[sample];
+			output[sample * 2 + 1] = right[sample];
+		}
+	} else {
+		// One channel at a time (reading each channel sequentially)
+		for (int channel = 0; channel < num_of_channels; channel++) {
+			const float *source = channels[channel];
+			float *destination = output + channel;
+			for (int sample = 0; sample < num_of_samples; sample++)
+				destination[sample * num_of_channels] = source[sample];
+		}
+	}
+}
+
 // Get an array of sample data (all channels interleaved together), using any sample rate
 float* Frame::GetInterleavedAudioSamples(int* sample_count)
 {
-	// Copy audio data
-	juce::AudioBuffer<float> *buffer(audio.get());
-
-	float *output = NULL;
 	int num_of_channels = audio->getNumChannels();
 	int num_of_samples = GetAudioSamplesCount();
 
 	// INTERLEAVE all samples together (channel 1 + channel 2 + channel 1 + channel 2, etc...)
-	output = new float[num_of_channels * num_of_samples];
-	int position = 0;
-
-	// Loop through samples in each channel (combining them)
-	for (int sample = 0; sample < num_of_samples; sample++)
-	{
-		for (int channel = 0; channel < num_of_channels; channel++)
-		{
-			// Add sample to output array
-			output[position] = buffer->getReadPointer(channel)[sample];
-
-			// increment position
-			position++;
-		}
-	}
+	float *output = new float[num_of_channels * num_of_samples];
+	interleave_samples(audio->getArrayOfReadPointers(), num_of_channels, num_of_samples, output);
 
 	// Update sample count (since it might have changed due to resampling)
 	*sample_count = num_of_samples;
@@ -354,6 +303,18 @@ float* Frame::GetInterleavedAudioSamples(int* sample_count)
 	return output;
 }
 
+// Get the sample data of all channels interleaved together (into a caller-provided buffer)
+int Frame::GetInterleavedAudioSamples(std::vector<float>& output)
+{
+	int num_of_channels = audio->getNumChannels();
+	int num_of_samples = GetAudioSamplesCount();
+
+	// Resizing only reallocates the buffer when it grows beyond its capacity
+	output.resize(size_t(num_of_channels) * num_of_samples);
+	interleave_samples(audio->getArrayOfReadPointers(), num_of_channels, num_of_samples, output.data());
+	return num_of_samples;
+}
+
 // Get number of audio channels
 int Frame::GetAudioChannelsCount()
 {
@@ -380,47 +341,64 @@ juce::AudioBuffer<float> *Frame::GetAudioSampleBuffer()
 int64_t Frame::GetBytes()
 {
 	int64_t total_bytes = 0;
-	if (image) {
-		total_bytes += static_cast<int64_t>(
-			width * height * sizeof(char) * 4);
-	}
-	if (audio) {
-		// approximate audio size (sample rate / 24 fps)
-		total_bytes += (sample_rate / 24.0) * sizeof(float);
-	}
+	for (const auto& buffer : GetBuffers())
+		total_bytes += buffer.second;
 
 	// return size of this frame
 	return total_bytes;
 }
 
+// Get the size in bytes of the pixel data of an image
+static int64_t ImageBytes(const QImage& image)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+	// byteCount() is deprecated from Qt 5.10
+	return image.sizeInBytes();
+#else
+	return image.byteCount();
+#endif
+}
+
+// Get the pixel & sample buffers of this frame (and the size of each one in bytes)
+std::vector<std::pair<const void*, int64_t>> Frame::GetBuffers()
+{
+	std::vector<std::pair<const void*, int64_t>> buffers;
+
+	// Images which share pixel data (i.e. copies of a QImage) return the same bits
+	if (image && !image->isNull())
+		buffers.emplace_back(image->constBits(), ImageBytes(*image));
+	if (wave_image && !wave_image->isNull())
+		buffers.emplace_back(wave_image->constBits(), ImageBytes(*wave_image));
+	if (tiled_image) {
+		for (const auto& tile : tiled_image->GetBuffers())
+			buffers.push_back(tile);
+	}
+
+	// Audio samples (all channels)
+	if (audio)
+		buffers.emplace_back(audio.get(), int64_t(audio->getNumChannels()) * audio->getNumSamples() * int64_t(sizeof(float)));
+
+	return buffers;
+}
+
 // Get pixel data (as packets)
 const unsigned char* Frame::GetPixels()
 {
-	// Check for blank image
-	if (!image)
-		// Fill with black
-		AddColor(width, height, color);
-
-	// Return array of pixel packets
-	return image->constBits();
+	// Return array of pixel packets (of a black image, if blank)
+	return GetImage()->constBits();
 }
 
 // Get pixel data (for only a single scan-line)
 const unsigned char* Frame::GetPixels(int row)
 {
-	// Check for blank image
-	if (!image)
-		// Fill with black
-		AddColor(width, height, color);
-
-	// Return array of pixel packets
-	return image->constScanLine(row);
+	// Return array of pixel packets (of a black image, if blank)
+	return GetImage()->constScanLine(row);
 }
 
 // Check a specific pixel color value (returns True/False)
 bool Frame::CheckPixel(int row, int col, int red, int green, int blue, int alpha, int threshold) {
 	int col_pos = col * 4; // Find column array position
-	if (!image || row < 0 || row >= (height - 1) ||
+	if ((!image && !tiled_image && !solid_color.isValid()) || row < 0 || row >= (height - 1) ||
 		col_pos < 0 || col_pos >= (width - 1) ) {
 		// invalid row / col
 		return false;
@@ -455,29 +433,50 @@ void Frame::SetFrameNumber(int64_t new_number)
 // Calculate the # of samples per video frame (for a specific frame number and frame rate)
 int Frame::GetSamplesPerFrame(int64_t number, Fraction fps, int sample_rate, int channels)
 {
-	// Directly return 0 if there are no channels
-	// so that we do not need to deal with NaNs later
-	if (channels == 0) return 0;
+	// Subtract the samples before this frame from the samples before the next frame.  Not all sample rates can
+	// be evenly divided into frames, so each frame can have have different # of samples.
+	int64_t samples_per_frame = GetSamplesBefore(number + 1, fps, sample_rate, channels) -
+		GetSamplesBefore(number, fps, sample_rate, channels);
+	if (samples_per_frame < 0)
+		samples_per_frame = 0;
+	return int(samples_per_frame);
+}
 
-	// Get the total # of samples for the previous frame, and the current frame (rounded)
-	double fps_rate = fps.Reciprocal().ToDouble();
+// Calculate the # of samples before a video frame
+int64_t Frame::GetSamplesBefore(int64_t number, Fraction fps, int sample_rate, int channels)
+{
+	// Directly return 0 if there are no channels (or no frame rate)
+	if (channels <= 0 || fps.num <= 0 || fps.den <= 0)
+		return 0;
 
-	// Determine previous samples total, and make sure it's evenly divisible by the # of channels
-	double previous_samples = (sample_rate * fps_rate) * (number - 1);
-	double previous_samples_remainder = fmod(previous_samples, (double)channels); // subtract the remainder to the total (to make it evenly divisible)
-	previous_samples -= previous_samples_remainder;
+	// The exact (rational) # of samples before this frame, made evenly divisible by the # of channels
+	// (in integer math, so there is no rounding error, even after millions of frames)
+	const int64_t samples_numerator = int64_t(sample_rate) * fps.den * (number - 1);
+	const int64_t samples_denominator = int64_t(fps.num) * channels;
+	return (samples_numerator / samples_denominator) * channels;
+}
 
-	// Determine the current samples total, and make sure it's evenly divisible by the # of channels
-	double total_samples = (sample_rate * fps_rate) * number;
-	double total_samples_remainder = fmod(total_samples, (double)channels); // subtract the remainder to the total (to make it evenly divisible)
-	total_samples -= total_samples_remainder;
+// Find the video frame of a sample
+int64_t Frame::GetFrameOfSample(int64_t position, Fraction fps, int sample_rate, int channels, int& sample)
+{
+	if (channels <= 0 || sample_rate <= 0 || fps.num <= 0 || fps.den <= 0) {
+		sample = 0;
+		return 1;
+	}
 
-	// Subtract the previous frame's total samples with this frame's total samples.  Not all sample rates can
-	// be evenly divided into frames, so each frame can have have different # of samples.
-	int samples_per_frame = round(total_samples - previous_samples);
-	if (samples_per_frame < 0)
-		samples_per_frame = 0;
-	return samples_per_frame;
+	// Estimate the frame (rounded down), and then correct it by the rounding to whole channels
+	const int64_t numerator = position * fps.num;
+	const int64_t denominator = int64_t(sample_rate) * fps.den;
+	int64_t number = numerator / denominator + 1;
+	if (numerator < 0 && numerator % denominator != 0)
+		number--;
+	while (GetSamplesBefore(number, fps, sample_rate, channels) > position)
+		number--;
+	while (GetSamplesBefore(number + 1, fps, sample_rate, channels) <= position)
+		number++;
+
+	sample = int(position - GetSamplesBefore(number, fps, sample_rate, channels));
+	return number;
 }
 
 // Calculate the # of samples per video frame (for the current frame number)
@@ -606,8 +605,7 @@ void Frame::Thumbnail(std::string path, int new_width, int new_height, std::stri
 		overlay->load(QString::fromStdString(overlay_path));
 
 		// Set pixel format
-		overlay = std::make_shared<QImage>(
-			overlay->convertToFormat(QImage::Format_RGBA8888_Premultiplied));
+		PixelKernels::ToPremultipliedRGBA(*overlay);
 
 		// Resize to fit
 		overlay = std::make_shared<QImage>(overlay->scaled(
@@ -626,8 +624,7 @@ void Frame::Thumbnail(std::string path, int new_width, int new_height, std::stri
 		mask->load(QString::fromStdString(mask_path));
 
 		// Set pixel format
-		mask = std::make_shared<QImage>(
-			mask->convertToFormat(QImage::Format_RGBA8888_Premultiplied));
+		PixelKernels::ToPremultipliedRGBA(*mask);
 
 		// Resize to fit
 		mask = std::make_shared<QImage>(mask->scaled(
@@ -689,13 +686,26 @@ void Frame::AddColor(const QColor& new_color)
 {
 	// Create new image object, and fill with pixel data
 	const std::lock_guard<std::recursive_mutex> lock(addingImageMutex);
-	image = std::make_shared<QImage>(width, height, QImage::Format_RGBA8888_Premultiplied);
+	image = ImageBufferPool::Instance()->CreateImage(width, height, QImage::Format_RGBA8888_Premultiplied);
+	tiled_image.reset();
+	solid_color = QColor();
 
 	// Fill with solid color
 	image->fill(new_color);
 	has_image_data = true;
 }
 
+// Add (or replace) a solid color image (without pixel data)
+void Frame::AddSolidColor(const QColor& new_color)
+{
+	// Only keep the color (the image is filled when its pixels are needed, see GetImage)
+	const std::lock_guard<std::recursive_mutex> lock(addingImageMutex);
+	image.reset();
+	tiled_image.reset();
+	solid_color = new_color.isValid() ? new_color : QColor(Qt::black);
+	has_image_data = true;
+}
+
 // Add (or replace) pixel data to the frame
 void Frame::AddImage(
 	int new_width, int new_height, int bytes_per_pixel,
@@ -728,10 +738,12 @@ void Frame::AddImage(std::shared_ptr<QImage> new_image)
 	// assign image data
 	const std::lock_guard<std::recursive_mutex> lock(addingImageMutex);
 	image = new_image;
+	tiled_image.reset();
+	solid_color = QColor();
 
-	// Always convert to Format_RGBA8888_Premultiplied (if different)
-	if (image->format() != QImage::Format_RGBA8888_Premultiplied)
-		*image = image->convertToFormat(QImage::Format_RGBA8888_Premultiplied);
+	// Always convert to Format_RGBA8888_Premultiplied (if different, and in place when possible)
+	PixelKernels::ToPremultipliedRGBA(*image);
+	AllocationStats::AddImage(ImageBytes(*image));
 
 	// Update height and width
 	width = image->width();
@@ -747,19 +759,22 @@ void Frame::AddImage(std::shared_ptr<QImage> new_image, bool only_odd_lines)
 		return;
 
 	// Check for blank source image
-	if (!image) {
+	if (!image && !tiled_image && !solid_color.isValid()) {
 		// Replace the blank source image
 		AddImage(new_image);
 
 	} else {
+		// Convert tiles (or a solid color) to a single image first
+		GetImage();
+
 		// Ignore image of different sizes or formats
 		bool ret=false;
 		if (image == new_image || image->size() != new_image->size()) {
 			ret = true;
 		}
 		else if (new_image->format() != QImage::Format_RGBA8888_Premultiplied) {
-			new_image = std::make_shared<QImage>(
-					new_image->convertToFormat(QImage::Format_RGBA8888_Premultiplied));
+			new_image = std::make_shared<QImage>(*new_image);
+			PixelKernels::ToPremultipliedRGBA(*new_image);
 		}
 		if (ret) {
 			return;
@@ -793,8 +808,9 @@ void Frame::ResizeAudio(int channels, int length, int rate, ChannelLayout layout
 {
 	const std::lock_guard<std::recursive_mutex> lock(addingAudioMutex);
 
-	// Resize JUCE audio buffer
-	audio->setSize(channels, length, true, true, false);
+	// Resize JUCE audio buffer (without reallocating it, if it gets smaller)
+	DetachAudio();
+	audio->setSize(channels, length, true, true, true);
 	channel_layout = layout;
 	sample_rate = rate;
 
@@ -807,6 +823,7 @@ void Frame::ResizeAudio(int channels, int length, int rate, ChannelLayout layout
 void Frame::ReverseAudio() {
 	if (audio && !audio_reversed) {
 		// Reverse audio buffer
+		DetachAudio();
 		audio->reverse(0, audio->getNumSamples());
 		audio_reversed = true;
 	}
@@ -820,6 +837,7 @@ void Frame::AddAudio(bool replaceSamples, int destChannel, int destStartSample,
 	int destStartSampleAdjusted = max(destStartSample, 0);
 
 	// Extend audio container to hold more (or less) samples and channels.. if needed
+	DetachAudio();
 	int new_length = destStartSampleAdjusted + numSamples;
 	int new_channel_length = audio->getNumChannels();
 	if (destChannel >= new_channel_length)
@@ -827,12 +845,47 @@ void Frame::AddAudio(bool replaceSamples, int destChannel, int destStartSample,
 	if (new_length > audio->getNumSamples() || new_channel_length > audio->getNumChannels())
 		audio->setSize(new_channel_length, new_length, true, true, false);
 
-	// Clear the range of samples first (if needed)
+	// Replace the samples (in a single copy pass), or add them to the frame's audio buffer
 	if (replaceSamples)
-		audio->clear(destChannel, destStartSampleAdjusted, numSamples);
+		audio->copyFrom(destChannel, destStartSampleAdjusted, source, numSamples, gainToApplyToSource);
+	else
+		audio->addFrom(destChannel, destStartSampleAdjusted, source, numSamples, gainToApplyToSource);
+	has_audio_data = true;
+
+	// Calculate max audio sample added
+	if (new_length > max_audio_sample)
+		max_audio_sample = new_length;
+
+	// Reset audio reverse flag
+	audio_reversed = false;
+}
 
-	// Add samples to frame's audio buffer
-	audio->addFrom(destChannel, destStartSampleAdjusted, source, numSamples, gainToApplyToSource);
+// Mix audio samples into a channel, with a linear gain ramp
+void Frame::AddAudioRamp(int destChannel, int destStartSample, const float* source, int numSamples, float initial_gain, float final_gain)
+{
+	if (numSamples <= 0)
+		return;
+	if (initial_gain == final_gain) {
+		// Constant gain (a single fused multiply-add pass)
+		AddAudio(false, destChannel, destStartSample, source, numSamples, initial_gain);
+		return;
+	}
+
+	const std::lock_guard<std::recursive_mutex> lock(addingAudioMutex);
+
+	// Extend audio container to hold more samples and channels (if needed)
+	DetachAudio();
+	int destStartSampleAdjusted = max(destStartSample, 0);
+	int new_length = destStartSampleAdjusted + numSamples;
+	int new_channel_length = std::max(audio->getNumChannels(), destChannel + 1);
+	if (new_length > audio->getNumSamples() || new_channel_length > audio->getNumChannels())
+		audio->setSize(new_channel_length, new_length, true, true, false);
+
+	// The gain of each sample only depends on its index (not on the previous sample), so this loop is vectorized
+	float *dest = audio->getWritePointer(destChannel, destStartSampleAdjusted);
+	const float step = (final_gain - initial_gain) / numSamples;
+	for (int sample = 0; sample < numSamples; sample++)
+		dest[sample] += source[sample] * (initial_gain + step * sample);
 	has_audio_data = true;
 
 	// Calculate max audio sample added
@@ -849,6 +902,7 @@ void Frame::ApplyGainRamp(int destChannel, int destStartSample, int numSamples,
 	const std::lock_guard<std::recursive_mutex> lock(addingAudioMutex);
 
 	// Apply gain ramp
+	DetachAudio();
 	audio->applyGainRamp(destChannel, destStartSample, numSamples, initial_gain, final_gain);
 }
 
@@ -856,33 +910,73 @@ void Frame::ApplyGainRamp(int destChannel, int destStartSample, int numSamples,
 std::shared_ptr<QImage> Frame::GetImage()
 {
 	// Check for blank image
-	if (!image)
-		// Fill with black
-		AddColor(width, height, color);
+	if (!image) {
+		const std::lock_guard<std::recursive_mutex> lock(addingImageMutex);
+		if (tiled_image) {
+			// Convert the tiles to a single image (once, since the caller can change the image)
+			image = tiled_image->ToImage();
+			tiled_image.reset();
+		} else if (!image) {
+			// Fill with the solid color (once, since the caller can change the image), or black if blank
+			if (solid_color.isValid())
+				AddColor(solid_color);
+			else
+				AddColor(width, height, color);
+		}
+	}
 
 	return image;
 }
 
+// Add (or replace) pixel data to the frame, as tiles
+void Frame::AddTiledImage(std::shared_ptr<TiledImage> new_image)
+{
+	// Ignore blank images
+	if (!new_image)
+		return;
+
+	const std::lock_guard<std::recursive_mutex> lock(addingImageMutex);
+	image.reset();
+	tiled_image = new_image;
+	solid_color = QColor();
+
+	// Update height and width
+	width = tiled_image->Width();
+	height = tiled_image->Height();
+	has_image_data = true;
+}
+
+// Get the tiles of the image
+std::shared_ptr<TiledImage> Frame::GetTiledImage()
+{
+	const std::lock_guard<std::recursive_mutex> lock(addingImageMutex);
+	return tiled_image;
+}
+
+// Get the color of a solid color image
+QColor Frame::GetSolidColor()
+{
+	const std::lock_guard<std::recursive_mutex> lock(addingImageMutex);
+	return solid_color;
+}
+
 #ifdef USE_OPENCV
 
 // Convert Qimage to Mat
 cv::Mat Frame::Qimage2mat( std::shared_ptr<QImage>& qimage) {
 
-	cv::Mat mat = cv::Mat(qimage->height(), qimage->width(), CV_8UC4, (uchar*)qimage->constBits(), qimage->bytesPerLine()).clone();
-	cv::Mat mat2 = cv::Mat(mat.rows, mat.cols, CV_8UC3 );
-	int from_to[] = { 0,0,  1,1,  2,2 };
-	cv::mixChannels( &mat, 1, &mat2, 1, from_to, 3 );
-	cv::cvtColor(mat2, mat2, cv::COLOR_RGB2BGR);
-	return mat2;
+	// Convert the RGBA pixels to BGR (in a single pass)
+	const cv::Mat rgba(qimage->height(), qimage->width(), CV_8UC4, (uchar*)qimage->constBits(), qimage->bytesPerLine());
+	cv::Mat mat;
+	cv::cvtColor(rgba, mat, cv::COLOR_RGBA2BGR);
+	return mat;
 }
 
 // Get pointer to OpenCV image object
 cv::Mat Frame::GetImageCV()
 {
-	// Check for blank image
-	if (!image)
-		// Fill with black
-		AddColor(width, height, color);
+	// Check for blank (or tiled) image
+	GetImage();
 
 	// if (imagecv.empty())
 	// Convert Qimage to Mat
@@ -891,15 +985,21 @@ cv::Mat Frame::GetImageCV()
 	return imagecv;
 }
 
-std::shared_ptr<QImage> Frame::Mat2Qimage(cv::Mat img){
-	cv::cvtColor(img, img, cv::COLOR_BGR2RGB);
-	QImage qimg((uchar*) img.data, img.cols, img.rows, img.step, QImage::Format_RGB888);
+// Get an OpenCV Mat which shares the pixels of the frame's image
+cv::Mat Frame::GetImageViewCV()
+{
+	// Check for blank (or tiled) image
+	GetImage();
 
-	std::shared_ptr<QImage> imgIn = std::make_shared<QImage>(qimg.copy());
+	// bits() detaches the image first (if its pixels are shared with another QImage)
+	return cv::Mat(image->height(), image->width(), CV_8UC4, image->bits(), image->bytesPerLine());
+}
 
-	// Always convert to RGBA8888 (if different)
-	if (imgIn->format() != QImage::Format_RGBA8888_Premultiplied)
-		*imgIn = imgIn->convertToFormat(QImage::Format_RGBA8888_Premultiplied);
+std::shared_ptr<QImage> Frame::Mat2Qimage(cv::Mat img){
+	// Convert the BGR pixels straight into a new RGBA image (in a single pass, without changing img)
+	std::shared_ptr<QImage> imgIn = ImageBufferPool::Instance()->CreateImage(img.cols, img.rows, QImage::Format_RGBA8888_Premultiplied);
+	cv::Mat rgba(imgIn->height(), imgIn->width(), CV_8UC4, imgIn->bits(), imgIn->bytesPerLine());
+	cv::cvtColor(img, rgba, img.channels() == 4 ? cv::COLOR_BGRA2RGBA : cv::COLOR_BGR2RGBA);
 
 	return imgIn;
 }
@@ -909,6 +1009,10 @@ void Frame::SetImageCV(cv::Mat _image)
 {
 	imagecv = _image;
 	image = Mat2Qimage(_image);
+	tiled_image.reset();
+	solid_color = QColor();
+	width = image->width();
+	height = image->height();
 }
 #endif
 
@@ -983,13 +1087,24 @@ void Frame::Play()
 
 }
 
+// Give this frame its own copy of the audio samples (if they are shared with another frame)
+void Frame::DetachAudio()
+{
+	const std::lock_guard<std::recursive_mutex> lock(addingAudioMutex);
+	if (audio && audio.use_count() > 1)
+		audio = AudioBufferPool::Instance()->Copy(*audio);
+}
+
 // Add audio silence
 void Frame::AddAudioSilence(int numSamples)
 {
 	const std::lock_guard<std::recursive_mutex> lock(addingAudioMutex);
 
-	// Resize audio container
-	audio->setSize(channels, numSamples, false, true, false);
+	// Resize audio container (a shared buffer is replaced, since none of its samples are kept)
+	if (audio.use_count() > 1)
+		audio = AudioBufferPool::Instance()->Create(channels, numSamples);
+	else
+		audio->setSize(channels, numSamples, false, false, true);
 	audio->clear();
 	has_audio_data = true;
 
@@ -25,6 +25,8 @@
 #include <mutex>
 #include <sstream>
 #include <queue>
+#include <utility>
+#include <vector>
 
 #include "ChannelLayouts.h"
 #include "Fraction.h"
@@ -42,6 +44,7 @@ namespace openshot
 {
 	class AudioBufferSource;
 	class AudioResampler;
+	class TiledImage;
 	/**
 	 * @brief This class represents a single frame of video (i.e. image & audio data)
 	 *
@@ -92,6 +95,8 @@ namespace openshot
 	private:
 		std::shared_ptr<QImage> image;
 		std::shared_ptr<QImage> wave_image;
+		std::shared_ptr<openshot::TiledImage> tiled_image; ///< The tiles of the image (until it is converted to a QImage)
+		QColor solid_color; ///< The color of a solid color image (until it is filled into a QImage, invalid otherwise)
 
 		std::shared_ptr<QApplication> previewApp;
 		std::recursive_mutex addingImageMutex;
@@ -147,6 +152,12 @@ namespace openshot
 		/// Add (or replace) pixel data (filled with new_color)
 		void AddColor(const QColor& new_color);
 
+		/// @brief Add (or replace) a solid color image, which has no pixel data until its pixels are needed
+		///
+		/// The image is only allocated and filled by GetImage() (or any other method which needs the pixels), so
+		/// solid color frames (i.e. backgrounds and blank clips) are composited as a fill, see GetSolidColor().
+		void AddSolidColor(const QColor& new_color);
+
 		/// Add (or replace) pixel data to the frame
 		void AddImage(int new_width, int new_height, int bytes_per_pixel, QImage::Format type, const unsigned char *pixels_);
 
@@ -156,12 +167,27 @@ namespace openshot
 		/// Add (or replace) pixel data to the frame (for only the odd or even lines)
 		void AddImage(std::shared_ptr<QImage> new_image, bool only_odd_lines);
 
+		/// @brief Add (or replace) pixel data to the frame, as tiles (see TiledImage)
+		///
+		/// The tiles are only converted to a QImage by GetImage() (or any other method which needs the pixels
+		/// as a single image), so a cached frame only holds the tiles which were allocated.
+		void AddTiledImage(std::shared_ptr<openshot::TiledImage> new_image);
+
 		/// Add audio samples to a specific channel
 		void AddAudio(bool replaceSamples, int destChannel, int destStartSample, const float* source, int numSamples, float gainToApplyToSource);
 
+		/// @brief Mix audio samples into a specific channel, with a gain which ramps linearly from initial_gain
+		/// to final_gain (i.e. volume automation). The gain is applied while mixing, so the source is not changed.
+		void AddAudioRamp(int destChannel, int destStartSample, const float* source, int numSamples, float initial_gain, float final_gain);
+
 		/// Add audio silence
 		void AddAudioSilence(int numSamples);
 
+		/// @brief Give this frame its own copy of the audio samples, if they are shared with another frame.
+		/// Copies of a frame share the samples (copy-on-write), so call this before changing the samples
+		/// of `audio` directly (the Add*Audio* and ApplyGainRamp methods call it).
+		void DetachAudio();
+
 		/// Apply gain ramp (i.e. fading volume)
 		void ApplyGainRamp(int destChannel, int destStartSample, int numSamples, float initial_gain, float final_gain);
 
@@ -193,6 +219,12 @@ namespace openshot
 		/// Get an array of sample data (all channels interleaved together), using any sample rate
 		float* GetInterleavedAudioSamples(int* sample_count);
 
+		/// @brief Get the sample data of all channels interleaved together, into a caller-provided buffer (which
+		/// is only reallocated when it is too small, so the same buffer can be re-used for every frame)
+		/// @returns The number of samples (of each channel)
+		/// @param output Set to the interleaved samples (resized to the number of samples times the number of channels)
+		int GetInterleavedAudioSamples(std::vector<float>& output);
+
 		/// Get number of audio channels
 		int GetAudioChannelsCount();
 
@@ -201,12 +233,24 @@ namespace openshot
 
 		juce::AudioBuffer<float> *GetAudioSampleBuffer();
 
-		/// Get the size in bytes of this frame (rough estimate)
+		/// Get the size in bytes of this frame (the allocated size of its image, waveform image and audio buffers)
 		int64_t GetBytes();
 
+		/// @brief Get the pixel & sample buffers of this frame, and the size of each one (in bytes)
+		///
+		/// Frames can share buffers (i.e. copies of the same QImage), which return the same buffer
+		/// address, so a cache holding many frames can count each shared buffer only once.
+		std::vector<std::pair<const void*, int64_t>> GetBuffers();
+
 		/// Get pointer to Qt QImage image object
 		std::shared_ptr<QImage> GetImage();
 
+		/// Get the tiles of the image (or nullptr, if the image is not tiled or it was converted to a QImage)
+		std::shared_ptr<openshot::TiledImage> GetTiledImage();
+
+		/// Get the color of a solid color image (or an invalid QColor, if the image has pixels or was converted to a QImage)
+		QColor GetSolidColor();
+
 		/// Set Pixel Aspect Ratio
 		openshot::Fraction GetPixelRatio() { return pixel_ratio; };
 
@@ -228,6 +272,19 @@ namespace openshot
 		/// Calculate the # of samples per video frame (for a specific frame number and frame rate)
 		static int GetSamplesPerFrame(int64_t frame_number, openshot::Fraction fps, int sample_rate, int channels);
 
+		/// @brief Calculate the # of samples before a video frame (i.e. the position of its first sample), for a specific
+		/// frame number and frame rate. This is exact integer math, so positions don't drift after many frames.
+		static int64_t GetSamplesBefore(int64_t frame_number, openshot::Fraction fps, int sample_rate, int channels);
+
+		/// @brief Find the video frame which holds a sample (the inverse of GetSamplesBefore)
+		/// @returns The frame number
+		/// @param position The position of the sample (the # of samples before it)
+		/// @param fps The frame rate
+		/// @param sample_rate The sample rate
+		/// @param channels The # of channels
+		/// @param sample Set to the position of the sample in its frame
+		static int64_t GetFrameOfSample(int64_t position, openshot::Fraction fps, int sample_rate, int channels, int& sample);
+
 		/// Get an audio waveform image
 		std::shared_ptr<QImage> GetWaveform(int width, int height, int Red, int Green, int Blue, int Alpha);
 
@@ -237,7 +294,7 @@ namespace openshot
 		/// Get height of image
 		int GetWidth();
 
-		/// Resize audio container to hold more (or less) samples and channels
+		/// Resize audio container to hold more (or less) samples and channels (shrinking keeps the allocated memory)
 		void ResizeAudio(int channels, int length, int sample_rate, openshot::ChannelLayout channel_layout);
 
 		/// Get the original sample rate of this frame's audio data
@@ -277,6 +334,13 @@ namespace openshot
 		/// Get pointer to OpenCV Mat image object
 		cv::Mat GetImageCV();
 
+		/// @brief Get an OpenCV Mat which shares the pixels of the frame's image (no copy or color conversion).
+		///
+		/// The Mat is a CV_8UC4 image in RGBA order (with premultiplied alpha), so any drawing on it
+		/// changes the frame's image directly (no SetImageCV() is needed). The Mat is only valid until
+		/// the frame's image is replaced.
+		cv::Mat GetImageViewCV();
+
 		/// Set pointer to OpenCV image object
 		void SetImageCV(cv::Mat _image);
 #endif
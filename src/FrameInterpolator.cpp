@@ -0,0 +1,174 @@
+/**
+ * @file
+ * @brief Source file for FrameInterpolator class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+#include <cmath>
+
+#include <QImage>
+
+#include "FrameInterpolator.h"
+#include "ImageBufferPool.h"
+
+#ifdef USE_OPENCV
+	#define int64 opencv_broken_int
+	#define uint64 opencv_broken_uint
+	#include <opencv2/imgproc.hpp>
+	#include <opencv2/video/tracking.hpp>
+	#undef uint64
+	#undef int64
+#endif
+
+using namespace openshot;
+
+// Default constructor
+FrameInterpolator::FrameInterpolator() : estimated_flows(0) { }
+
+// Blend 2 images
+std::shared_ptr<QImage> FrameInterpolator::Blend(const QImage& first, const QImage& second, float position)
+{
+	std::shared_ptr<QImage> image = ImageBufferPool::Instance()->CreateImage(first.width(), first.height(), first.format());
+	const int weight = std::clamp(int(std::lround(position * 256.0)), 0, 256);
+	const int row_bytes = first.width() * first.depth() / 8;
+	const int height = first.height();
+	const unsigned char *first_pixels = first.constBits();
+	const unsigned char *second_pixels = second.constBits();
+	unsigned char *pixels = image->bits();
+	const int first_stride = first.bytesPerLine();
+	const int second_stride = second.bytesPerLine();
+	const int stride = image->bytesPerLine();
+
+	// Premultiplied pixels are blended channel by channel
+	#pragma omp parallel for if (height > 64) schedule(static)
+	for (int y = 0; y < height; y++) {
+		const unsigned char *a = first_pixels + int64_t(y) * first_stride;
+		const unsigned char *b = second_pixels + int64_t(y) * second_stride;
+		unsigned char *output = pixels + int64_t(y) * stride;
+		#pragma omp simd
+		for (int x = 0; x < row_bytes; x++)
+			output[x] = (unsigned char) ((a[x] * (256 - weight) + b[x] * weight + 128) >> 8);
+	}
+
+	return image;
+}
+
+#ifdef USE_OPENCV
+// Get (or estimate) the flow field from one image to the next one
+cv::UMat FrameInterpolator::GetFlow(int64_t first_number, const QImage& first, int64_t second_number, const QImage& second)
+{
+	{
+		// Re-use a cached flow field (and move it to the front)
+		const std::lock_guard<std::mutex> lock(interpolatorMutex);
+		for (auto field = flow_fields.begin(); field != flow_fields.end(); field++) {
+			if (field->first == first_number && field->second == second_number &&
+				field->width == first.width() && field->height == first.height()) {
+				flow_fields.splice(flow_fields.begin(), flow_fields, field);
+				return flow_fields.front().flow;
+			}
+		}
+	}
+
+	// Estimate the flow on reduced size grayscale copies of the images
+	const double scale = std::min(1.0, double(FLOW_HEIGHT) / first.height());
+	const cv::Size size(std::max(1, int(std::lround(first.width() * scale))),
+						std::max(1, int(std::lround(first.height() * scale))));
+	auto reduce = [&size](const QImage& image) {
+		const cv::Mat view(image.height(), image.width(), CV_8UC4, (uchar *) image.constBits(), image.bytesPerLine());
+		cv::UMat reduced, gray;
+		cv::resize(view.getUMat(cv::ACCESS_READ), reduced, size, 0, 0, cv::INTER_AREA);
+		cv::cvtColor(reduced, gray, cv::COLOR_RGBA2GRAY);
+		return gray;
+	};
+	cv::UMat flow;
+	cv::calcOpticalFlowFarneback(reduce(first), reduce(second), flow, 0.5, 3, 15, 3, 5, 1.2, 0);
+
+	// Cache the flow field (and drop the least recently used one)
+	const std::lock_guard<std::mutex> lock(interpolatorMutex);
+	estimated_flows++;
+	flow_fields.push_front({first_number, second_number, first.width(), first.height(), flow});
+	if (flow_fields.size() > MAX_FLOW_FIELDS)
+		flow_fields.pop_back();
+	return flow;
+}
+#endif
+
+// Interpolate the image between 2 consecutive frames
+std::shared_ptr<QImage> FrameInterpolator::Interpolate(int64_t first_number, std::shared_ptr<QImage> first,
+													   int64_t second_number, std::shared_ptr<QImage> second, float position)
+{
+	if (!first || !second)
+		return std::make_shared<QImage>(first ? *first : *second);
+
+	// Images of different sizes can't be interpolated (use the nearest one)
+	if (first->size() != second->size())
+		return std::make_shared<QImage>(position < 0.5 ? *first : *second);
+
+	// Interpolate premultiplied RGBA pixels (which are not converted, if they already are)
+	const QImage first_image = first->convertToFormat(QImage::Format_RGBA8888_Premultiplied);
+	const QImage second_image = second->convertToFormat(QImage::Format_RGBA8888_Premultiplied);
+
+#ifdef USE_OPENCV
+	const int width = first_image.width();
+	const int height = first_image.height();
+	const cv::UMat flow = GetFlow(first_number, first_image, second_number, second_image);
+
+	// Scale the flow up to the size of the images
+	cv::UMat image_flow;
+	cv::resize(flow, image_flow, cv::Size(width, height), 0, 0, cv::INTER_LINEAR);
+	const double flow_scale = double(width) / flow.cols;
+
+	// Each pixel of the new frame samples the first image back along the flow, and the second image ahead
+	cv::Mat grid(height, width, CV_32FC2);
+	#pragma omp parallel for if (height > 64) schedule(static)
+	for (int y = 0; y < height; y++) {
+		float *row = grid.ptr<float>(y);
+		for (int x = 0; x < width; x++) {
+			row[x * 2] = x;
+			row[x * 2 + 1] = y;
+		}
+	}
+	const cv::UMat positions = grid.getUMat(cv::ACCESS_READ);
+	cv::UMat first_map, second_map;
+	cv::scaleAdd(image_flow, -position * flow_scale, positions, first_map);
+	cv::scaleAdd(image_flow, (1.0 - position) * flow_scale, positions, second_map);
+
+	// Warp both images to the position of the new frame, and blend them
+	const cv::Mat first_view(height, width, CV_8UC4, (uchar *) first_image.constBits(), first_image.bytesPerLine());
+	const cv::Mat second_view(height, width, CV_8UC4, (uchar *) second_image.constBits(), second_image.bytesPerLine());
+	cv::UMat first_warped, second_warped, blended;
+	cv::remap(first_view.getUMat(cv::ACCESS_READ), first_warped, first_map, cv::noArray(), cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+	cv::remap(second_view.getUMat(cv::ACCESS_READ), second_warped, second_map, cv::noArray(), cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+	cv::addWeighted(first_warped, 1.0 - position, second_warped, position, 0.0, blended);
+
+	std::shared_ptr<QImage> image = ImageBufferPool::Instance()->CreateImage(width, height, QImage::Format_RGBA8888_Premultiplied);
+	cv::Mat output(height, width, CV_8UC4, image->bits(), image->bytesPerLine());
+	blended.copyTo(output);
+	return image;
+#else
+	return Blend(first_image, second_image, position);
+#endif
+}
+
+// Get the number of flow fields which were estimated
+int64_t FrameInterpolator::EstimatedFlows()
+{
+	const std::lock_guard<std::mutex> lock(interpolatorMutex);
+	return estimated_flows;
+}
+
+// Free the cached flow fields
+void FrameInterpolator::Clear()
+{
+	const std::lock_guard<std::mutex> lock(interpolatorMutex);
+#ifdef USE_OPENCV
+	flow_fields.clear();
+#endif
+}
@@ -0,0 +1,105 @@
+/**
+ * @file
+ * @brief Header file for FrameInterpolator class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_FRAME_INTERPOLATOR_H
+#define OPENSHOT_FRAME_INTERPOLATOR_H
+
+#ifdef USE_OPENCV
+	#define int64 opencv_broken_int
+	#define uint64 opencv_broken_uint
+	#include <opencv2/core.hpp>
+	#undef uint64
+	#undef int64
+#endif
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+
+class QImage;
+
+namespace openshot {
+
+	/**
+	 * @brief This class interpolates the image between 2 consecutive frames (used by the PULLDOWN_INTERPOLATE
+	 * mode of openshot::FrameMapper)
+	 *
+	 * When libopenshot is built with OpenCV, the motion between the 2 frames is estimated with dense optical
+	 * flow (Farneback) on a reduced size grayscale copy of the images. Both images are warped along the flow
+	 * to the position of the new frame, and blended. The flow fields of the last few pairs of frames are
+	 * cached, since converting to a higher frame rate (i.e. 24 to 60 fps) interpolates several frames between
+	 * each pair. The flow and the warping use OpenCV's transparent API, so they run on the GPU (with OpenCL)
+	 * where available. Without OpenCV, the 2 images are blended.
+	 *
+	 * \code
+	 * FrameInterpolator interpolator;
+	 * std::shared_ptr<QImage> image = interpolator.Interpolate(1, first_image, 2, second_image, 0.4);
+	 * \endcode
+	 */
+	class FrameInterpolator {
+	private:
+		/// The max number of cached flow fields
+		static constexpr size_t MAX_FLOW_FIELDS = 8;
+
+		/// The max height of the images the flow is estimated on
+		static constexpr int FLOW_HEIGHT = 360;
+
+#ifdef USE_OPENCV
+		/// The flow field from one frame to the next one (at the reduced size)
+		struct FlowField {
+			int64_t first; ///< The frame number of the first image
+			int64_t second; ///< The frame number of the second image
+			int width; ///< The width of the images
+			int height; ///< The height of the images
+			cv::UMat flow; ///< The flow (in pixels of the reduced size)
+		};
+
+		std::list<FlowField> flow_fields; ///< The cached flow fields (most recently used first)
+
+		/// Get (or estimate) the flow field from one image to the next one
+		cv::UMat GetFlow(int64_t first_number, const QImage& first, int64_t second_number, const QImage& second);
+#endif
+
+		std::mutex interpolatorMutex;
+		int64_t estimated_flows; ///< The number of flow fields which were estimated
+
+	public:
+		/// Default constructor
+		FrameInterpolator();
+
+		/// @brief Blend 2 images (of the same size and format)
+		/// @param first The first image
+		/// @param second The second image
+		/// @param position The position between the first (0.0) and second (1.0) image
+		static std::shared_ptr<QImage> Blend(const QImage& first, const QImage& second, float position);
+
+		/// @brief Interpolate the image between 2 consecutive frames
+		/// @returns The interpolated image (in the format of the first image)
+		/// @param first_number The frame number of the first image
+		/// @param first The first image
+		/// @param second_number The frame number of the second image
+		/// @param second The second image
+		/// @param position The position between the first (0.0) and second (1.0) image
+		std::shared_ptr<QImage> Interpolate(int64_t first_number, std::shared_ptr<QImage> first,
+											int64_t second_number, std::shared_ptr<QImage> second, float position);
+
+		/// Get the number of flow fields which were estimated (and not re-used from the cache)
+		int64_t EstimatedFlows();
+
+		/// Free the cached flow fields
+		void Clear();
+	};
+
+}
+
+#endif
@@ -0,0 +1,104 @@
+/**
+ * @file
+ * @brief Source file for FrameIterator class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "FrameIterator.h"
+#include "Exceptions.h"
+#include "Frame.h"
+#include "FrameRequest.h"
+#include "ReaderBase.h"
+
+using namespace openshot;
+
+// Constructor
+FrameIterator::FrameIterator(ReaderBase* reader, int64_t start, int64_t end, int64_t step, int prefetch)
+	: reader(reader), end(end), step(step), prefetch(prefetch < 1 ? 1 : prefetch), next_frame(start),
+	  next_request(start), sequential(false)
+{
+	if (step == 0)
+		throw OutOfBoundsFrame("The step of a frame iterator can't be 0.", start, end);
+
+	// Frames in order are decoded ahead by the reader, from the first request
+	if (step == 1 && HasNext()) {
+		reader->SetSequentialHint(true);
+		sequential = true;
+	}
+	request_frames();
+}
+
+// Destructor
+FrameIterator::~FrameIterator()
+{
+	Close();
+}
+
+// Determine if a frame number is in the range
+bool FrameIterator::in_range(int64_t number) const
+{
+	return (step > 0) ? number <= end : number >= end;
+}
+
+// Request frames until the prefetch depth is reached
+void FrameIterator::request_frames()
+{
+	while ((int) requests.size() < prefetch && in_range(next_request) && next_request > 0) {
+		requests.push_back(reader->RequestFrame(next_request));
+		next_request += step;
+	}
+}
+
+// Determine if there are more frames
+bool FrameIterator::HasNext() const
+{
+	return in_range(next_frame) && next_frame > 0;
+}
+
+// Get the next frame
+std::shared_ptr<Frame> FrameIterator::Next()
+{
+	if (!HasNext() || requests.empty())
+		throw OutOfBoundsFrame("The frame iterator has no more frames.", next_frame, end);
+
+	std::shared_ptr<FrameRequest> request = requests.front();
+	requests.pop_front();
+	next_frame += step;
+
+	// Keep the next frames rendering while the caller uses this one
+	request_frames();
+	if (sequential && !HasNext()) {
+		reader->SetSequentialHint(false);
+		sequential = false;
+	}
+	return request->Get();
+}
+
+// Cancel the frames requested ahead
+void FrameIterator::Close()
+{
+	for (auto& request : requests)
+		request->Cancel();
+
+	// Running requests stop at the reader's next safe point (the reader must outlive them)
+	for (auto& request : requests) {
+		try {
+			request->Get();
+		} catch (...) {
+			// Cancelled (or failed) frames are not needed
+		}
+	}
+	requests.clear();
+	next_frame = next_request = end + step;
+
+	if (sequential) {
+		reader->SetSequentialHint(false);
+		sequential = false;
+	}
+}
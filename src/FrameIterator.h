@@ -0,0 +1,93 @@
+/**
+ * @file
+ * @brief Header file for FrameIterator class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_FRAME_ITERATOR_H
+#define OPENSHOT_FRAME_ITERATOR_H
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+
+namespace openshot
+{
+	class Frame;
+	class FrameRequest;
+	class ReaderBase;
+
+	/**
+	 * @brief An iterator over a range of frames of a reader, which requests the next frames ahead
+	 * (in the background), and returns them in order.
+	 *
+	 * A loop over GetFrame() renders one frame at a time. The iterator keeps a number of frames
+	 * requested ahead (see openshot::ReaderBase::RequestFrame), so they are rendered in parallel by
+	 * the shared pool of render threads while the caller works on the current frame. When the
+	 * frames are iterated in order (step 1), the reader is told to expect sequential requests (see
+	 * openshot::ReaderBase::SetSequentialHint), so an openshot::FFmpegReader decodes ahead right away.
+	 *
+	 * \code
+	 * std::shared_ptr<FrameIterator> frames = reader.Frames(1, 300);
+	 * while (frames->HasNext()) {
+	 *     std::shared_ptr<Frame> f = frames->Next();
+	 *     // ...
+	 * }
+	 * \endcode
+	 *
+	 * In Python, the iterator is a Python iterator (i.e. `for f in reader.Frames(1, 300):`), and waiting
+	 * for a frame releases the GIL. The reader must outlive the iterator. Destroying the iterator (or
+	 * calling Close()) cancels the frames requested ahead.
+	 */
+	class FrameIterator
+	{
+	private:
+		ReaderBase* reader;
+		int64_t end;
+		int64_t step;
+		int prefetch;
+		int64_t next_frame; ///< The frame number Next() returns
+		int64_t next_request; ///< The next frame number to request
+		std::deque<std::shared_ptr<openshot::FrameRequest>> requests; ///< The frames requested ahead (in order)
+		bool sequential; ///< The reader was told to expect sequential requests
+
+		/// Determine if a frame number is in the range
+		bool in_range(int64_t number) const;
+
+		/// Request frames until the prefetch depth is reached (or the range ends)
+		void request_frames();
+
+	public:
+		/// @brief Constructor (see openshot::ReaderBase::Frames)
+		/// @param reader The reader to get the frames from
+		/// @param start The first frame number
+		/// @param end The last frame number (included, unless the step skips it)
+		/// @param step The frames to advance by (negative to iterate backwards)
+		/// @param prefetch The number of frames requested ahead (at least 1)
+		FrameIterator(ReaderBase* reader, int64_t start, int64_t end, int64_t step = 1, int prefetch = 8);
+
+		/// Destructor (cancels the frames requested ahead)
+		virtual ~FrameIterator();
+
+		/// Determine if there are more frames
+		bool HasNext() const;
+
+		/// Get the number of the frame Next() returns
+		int64_t NextNumber() const { return next_frame; }
+
+		/// @brief Get the next frame (waiting for it, if it's still rendering)
+		/// Throws openshot::OutOfBoundsFrame after the last frame (or the reader's exception)
+		std::shared_ptr<openshot::Frame> Next();
+
+		/// Cancel the frames requested ahead (and end the iteration)
+		void Close();
+	};
+}
+
+#endif // OPENSHOT_FRAME_ITERATOR_H
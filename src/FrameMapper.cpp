@@ -10,20 +10,30 @@
 //
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <iomanip>
 
 #include "FrameMapper.h"
+#include "AllocationStats.h"
 #include "Exceptions.h"
+#include "FrameRequest.h"
 #include "Clip.h"
+#include "RenderStats.h"
+#include "RenderTrace.h"
+#include "Settings.h"
 #include "ZmqLogger.h"
 
 using namespace std;
 using namespace openshot;
 
 FrameMapper::FrameMapper(ReaderBase *reader, Fraction target, PulldownType target_pulldown, int target_sample_rate, int target_channels, ChannelLayout target_channel_layout) :
-		reader(reader), target(target), pulldown(target_pulldown), is_dirty(true), avr(NULL), parent_position(0.0), parent_start(0.0), previous_frame(0)
+		reader(reader), target(target), pulldown(target_pulldown), is_dirty(true), avr(NULL), avr_sample_rate(0), avr_channels(0),
+		avr_channel_layout(LAYOUT_MONO), resampled_audio(NULL), resampled_audio_linesize(0), resampled_audio_samples(0),
+		resampled_audio_channels(0), parent_position(0.0), parent_start(0.0), previous_frame(0), mapped_length(0),
+		pulldown_fields(false), difference(0.0), field_interval(0), frame_interval(0), value_increment(1.0),
+		bypass(false), uniform_samples(false)
 {
 	// Set the original frame rate from the reader
 	original = Fraction(reader->info.fps.num, reader->info.fps.den);
@@ -85,16 +95,90 @@ void FrameMapper::AddField(Field field)
 	field_toggle = (field_toggle ? false : true);
 }
 
-// Clear both the fields & frames lists
+// Clear the fields and the mapped frames
 void FrameMapper::Clear() {
 	// Prevent async calls to the following code
 	const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
 
-	// Clear the fields & frames lists
+	// Clear the fields & mapped frames
 	fields.clear();
 	fields.shrink_to_fit();
-	frames.clear();
-	frames.shrink_to_fit();
+	field_checkpoints.clear();
+	mapped_chunks.clear();
+	mapped_length = 0;
+	interpolator.Clear();
+}
+
+// Add the fields of the next original fields (with the pull-down technique), until there are enough fields
+void FrameMapper::AddFields(int64_t& field, int64_t& frame, std::vector<Field>::size_type needed_fields)
+{
+	// Calculate # of fields to map
+	int64_t number_of_fields = reader->info.video_length * 2;
+
+	// Loop through the original fields of the video file
+	for (; field <= number_of_fields && fields.size() < needed_fields; field++)
+	{
+
+		if (difference == 0) // Same frame rate, NO pull-down or special techniques required
+		{
+			// Add fields
+			AddField(frame);
+		}
+		else if (difference > 0) // Need to ADD fake fields & frames, because original video has too few frames
+		{
+			// Add current field
+			AddField(frame);
+
+			if (pulldown == PULLDOWN_CLASSIC && field % field_interval == 0)
+			{
+				// Add extra field for each 'field interval
+				AddField(frame);
+			}
+			else if (pulldown == PULLDOWN_ADVANCED && field % field_interval == 0 && field % frame_interval != 0)
+			{
+				// Add both extra fields in the middle 'together' (i.e. 2:3:3:2 technique)
+				AddField(frame); // add field for current frame
+
+				if (frame + 1 <= info.video_length)
+					// add field for next frame (if the next frame exists)
+					AddField(Field(frame + 1, field_toggle));
+			}
+			else if (pulldown == PULLDOWN_NONE && field % frame_interval == 0)
+			{
+				// No pull-down technique needed, just repeat this frame
+				AddField(frame);
+				AddField(frame);
+			}
+		}
+		else if (difference < 0) // Need to SKIP fake fields & frames, because we want to return to the original film frame rate
+		{
+
+			if (pulldown == PULLDOWN_CLASSIC && field % field_interval == 0)
+			{
+				// skip current field and toggle the odd/even flag
+				field_toggle = (field_toggle ? false : true);
+			}
+			else if (pulldown == PULLDOWN_ADVANCED && field % field_interval == 0 && field % frame_interval != 0)
+			{
+				// skip this field, plus the next field
+				field++;
+			}
+			else if (pulldown == PULLDOWN_NONE && frame % field_interval == 0)
+			{
+				// skip this field, plus the next one
+				field++;
+			}
+			else
+			{
+				// No skipping needed, so add the field
+				AddField(frame);
+			}
+		}
+
+		// increment frame number (if field is divisible by 2)
+		if (field % 2 == 0 && field > 0)
+			frame++;
+	}
 }
 
 // Use the original and target frame rates and a pull-down technique to create
@@ -103,7 +187,7 @@ void FrameMapper::Clear() {
 // whether the frame rate is increasing or decreasing.
 void FrameMapper::Init()
 {
-	ZmqLogger::Instance()->AppendDebugMethod("FrameMapper::Init (Calculate frame mappings)");
+	ZMQ_DEBUG("FrameMapper::Init (Calculate frame mappings)");
 
 	// Do not initialize anything if just a picture with no audio
 	if (info.has_video and !info.has_audio and info.has_single_image)
@@ -134,15 +218,17 @@ void FrameMapper::Init()
 
 	// Some framerates are handled special, and some use a generic Keyframe curve to
 	// map the framerates. These are the special framerates:
-	if ((fabs(original.ToFloat() - 24.0) < 1e-7 || fabs(original.ToFloat() - 25.0) < 1e-7 || fabs(original.ToFloat() - 30.0) < 1e-7) &&
-		(fabs(target.ToFloat() - 24.0) < 1e-7 || fabs(target.ToFloat() - 25.0) < 1e-7 || fabs(target.ToFloat() - 30.0) < 1e-7)) {
+	pulldown_fields = false;
+	if (pulldown != PULLDOWN_INTERPOLATE &&
+		(fabs(original.ToFloat() - 24.0) < 1e-7 || fabs(original.ToFloat() - 25.0) < 1e-7 || fabs(original.ToFloat() - 30.0) < 1e-7) &&
+		(fabs(target.ToFloat() - 24.0) < 1e-7 || fabs(target.ToFloat() - 25.0) < 1e-7 || fabs(target.ToFloat() - 30.0) < 1e-7))) {
 
 		// Get the difference (in frames) between the original and target frame rates
-		float difference = target.ToInt() - original.ToInt();
+		difference = target.ToInt() - original.ToInt();
 
 		// Find the number (i.e. interval) of fields that need to be skipped or repeated
-		int field_interval = 0;
-		int frame_interval = 0;
+		field_interval = 0;
+		frame_interval = 0;
 
 		if (difference != 0)
 		{
@@ -152,181 +238,53 @@ void FrameMapper::Init()
 			frame_interval = field_interval * 2.0f;
 		}
 
-
-		// Calculate # of fields to map
-		int64_t frame = 1;
-		int64_t number_of_fields = reader->info.video_length * 2;
-
-		// Loop through all fields in the original video file
-		for (int64_t field = 1; field <= number_of_fields; field++)
-		{
-
-			if (difference == 0) // Same frame rate, NO pull-down or special techniques required
-			{
-				// Add fields
-				AddField(frame);
-			}
-			else if (difference > 0) // Need to ADD fake fields & frames, because original video has too few frames
-			{
-				// Add current field
-				AddField(frame);
-
-				if (pulldown == PULLDOWN_CLASSIC && field % field_interval == 0)
-				{
-					// Add extra field for each 'field interval
-					AddField(frame);
-				}
-				else if (pulldown == PULLDOWN_ADVANCED && field % field_interval == 0 && field % frame_interval != 0)
-				{
-					// Add both extra fields in the middle 'together' (i.e. 2:3:3:2 technique)
-					AddField(frame); // add field for current frame
-
-					if (frame + 1 <= info.video_length)
-						// add field for next frame (if the next frame exists)
-						AddField(Field(frame + 1, field_toggle));
-				}
-				else if (pulldown == PULLDOWN_NONE && field % frame_interval == 0)
-				{
-					// No pull-down technique needed, just repeat this frame
-					AddField(frame);
-					AddField(frame);
+		if (difference == 0) {
+			// Same frame rate (each target frame maps to the same original frame)
+			mapped_length = reader->info.video_length;
+			value_increment = 1.0;
+		} else {
+			// Walk through all fields once, to count the target frames, and remember the state of the
+			// mapping at the start of each chunk (the fields themselves are only kept while mapping a chunk)
+			pulldown_fields = true;
+			int64_t field = 1;
+			int64_t frame = 1;
+			Field Odd(0, true);		// temp field used to track the ODD field
+			Field Even(0, true);	// temp field used to track the EVEN field
+			while (true) {
+				if (mapped_length % MAPPING_CHUNK_FRAMES == 0)
+					field_checkpoints.push_back({field, frame, field_toggle, fields, Odd, Even});
+
+				// Combine the next 2 fields into a target frame
+				AddFields(field, frame, 2);
+				if (fields.size() < 2)
+					break;
+				for (int index = 0; index < 2; index++) {
+					if (fields[index].isOdd)
+						Odd = fields[index];
+					else
+						Even = fields[index];
 				}
+				fields.erase(fields.begin(), fields.begin() + 2);
+				mapped_length++;
 			}
-			else if (difference < 0) // Need to SKIP fake fields & frames, because we want to return to the original film frame rate
-			{
-
-				if (pulldown == PULLDOWN_CLASSIC && field % field_interval == 0)
-				{
-					// skip current field and toggle the odd/even flag
-					field_toggle = (field_toggle ? false : true);
-				}
-				else if (pulldown == PULLDOWN_ADVANCED && field % field_interval == 0 && field % frame_interval != 0)
-				{
-					// skip this field, plus the next field
-					field++;
-				}
-				else if (pulldown == PULLDOWN_NONE && frame % field_interval == 0)
-				{
-					// skip this field, plus the next one
-					field++;
-				}
-				else
-				{
-					// No skipping needed, so add the field
-					AddField(frame);
-				}
-			}
-
-			// increment frame number (if field is divisible by 2)
-			if (field % 2 == 0 && field > 0)
-				frame++;
+			fields.clear();
 		}
 
 	} else {
 		// Map the remaining framerates using a linear algorithm
 		double rate_diff = target.ToDouble() / original.ToDouble();
-		int64_t new_length = reader->info.video_length * rate_diff;
+		mapped_length = reader->info.video_length * rate_diff;
 
 		// Calculate the value difference
-		double value_increment = reader->info.video_length / (double) (new_length);
-
-		// Loop through curve, and build list of frames
-		double original_frame_num = 1.0f;
-		for (int64_t frame_num = 1; frame_num <= new_length; frame_num++)
-		{
-			// Add 2 fields per frame
-			AddField(round(original_frame_num));
-			AddField(round(original_frame_num));
-
-			// Increment original frame number
-			original_frame_num += value_increment;
-		}
+		value_increment = reader->info.video_length / (double) (mapped_length);
 	}
 
-	// Loop through the target frames again (combining fields into frames)
-	Field Odd(0, true);		// temp field used to track the ODD field
-	Field Even(0, true);	// temp field used to track the EVEN field
-
-	// Variables used to remap audio samples
-	int64_t start_samples_frame = 1;
-	int start_samples_position = 0;
-
-	for (std::vector<Field>::size_type field = 1; field <= fields.size(); field++)
-	{
-		// Get the current field
-		Field f = fields[field - 1];
-
-		// Is field divisible by 2?
-		if (field % 2 == 0 && field > 0)
-		{
-			// New frame number
-			int64_t frame_number = field / 2;
-
-			// Set the bottom frame
-			if (f.isOdd)
-				Odd = f;
-			else
-				Even = f;
-
-			// Determine the range of samples (from the original rate). Resampling happens in real-time when
-			// calling the GetFrame() method. So this method only needs to redistribute the original samples with
-			// the original sample rate.
-			int64_t end_samples_frame = start_samples_frame;
-			int end_samples_position = start_samples_position;
-			int remaining_samples = Frame::GetSamplesPerFrame(AdjustFrameNumber(frame_number), target, reader->info.sample_rate, reader->info.channels);
-
-			while (remaining_samples > 0)
-			{
-				// Get original samples (with NO framerate adjustments)
-				// This is the original reader's frame numbers
-				int original_samples = Frame::GetSamplesPerFrame(end_samples_frame, original, reader->info.sample_rate, reader->info.channels) - end_samples_position;
-
-				// Enough samples
-				if (original_samples >= remaining_samples)
-				{
-					// Take all that we need, and break loop
-					end_samples_position += remaining_samples - 1;
-					remaining_samples = 0;
-				} else
-				{
-					// Not enough samples (take them all, and keep looping)
-					end_samples_frame += 1; // next frame
-					end_samples_position = 0; // next frame, starting on 1st sample
-					remaining_samples -= original_samples; // reduce the remaining amount
-				}
-			}
-
-
-
-			// Create the sample mapping struct
-			SampleRange Samples = {start_samples_frame, start_samples_position, end_samples_frame, end_samples_position, Frame::GetSamplesPerFrame(AdjustFrameNumber(frame_number), target, reader->info.sample_rate, reader->info.channels)};
-
-			// Reset the audio variables
-			start_samples_frame = end_samples_frame;
-			start_samples_position = end_samples_position + 1;
-			if (start_samples_position >= Frame::GetSamplesPerFrame(AdjustFrameNumber(start_samples_frame), original, reader->info.sample_rate, reader->info.channels))
-			{
-				start_samples_frame += 1; // increment the frame (since we need to wrap onto the next one)
-				start_samples_position = 0; // reset to 0, since we wrapped
-			}
-
-			// Create a frame and ADD it to the frames collection
-			MappedFrame frame = {Odd, Even, Samples};
-			frames.push_back(frame);
-		}
-		else
-		{
-			// Set the top field
-			if (f.isOdd)
-				Odd = f;
-			else
-				Even = f;
-		}
-	}
-
-	// Clear the internal fields list (no longer needed)
-	fields.clear();
-	fields.shrink_to_fit();
+	// Forward frames to the reader, if the target format matches the reader (the mapping is an identity)
+	uniform_samples = !info.has_audio ||
+		(int64_t(info.sample_rate) * info.fps.den) % (int64_t(info.fps.num) * info.channels) == 0;
+	bypass = original.num == target.num && original.den == target.den &&
+		reader->info.has_audio == info.has_audio && reader->info.sample_rate == info.sample_rate &&
+		reader->info.channels == info.channels && reader->info.channel_layout == info.channel_layout;
 
 	if (avr) {
 		// Delete resampler (if exists)
@@ -357,25 +315,129 @@ MappedFrame FrameMapper::GetMappedFrame(int64_t TargetFrameNumber)
 		return frame;
 	}
 
+	// Prevent async calls to the following code (chunks are mapped on demand)
+	const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+
 	// Check if frame number is valid
-	if(TargetFrameNumber < 1 || frames.size() == 0)
+	if(TargetFrameNumber < 1 || mapped_length == 0)
 		// frame too small, return error
-		throw OutOfBoundsFrame("An invalid frame was requested.", TargetFrameNumber, frames.size());
+		throw OutOfBoundsFrame("An invalid frame was requested.", TargetFrameNumber, mapped_length);
 
-	else if (TargetFrameNumber > (int64_t)frames.size())
+	else if (TargetFrameNumber > mapped_length)
 		// frame too large, set to end frame
-		TargetFrameNumber = frames.size();
+		TargetFrameNumber = mapped_length;
+
+	// Map the chunk of this frame (if needed)
+	const std::vector<MappedFrame>& chunk = MapChunk((TargetFrameNumber - 1) / MAPPING_CHUNK_FRAMES);
+	const MappedFrame& frame = chunk[(TargetFrameNumber - 1) % MAPPING_CHUNK_FRAMES];
 
 	// Debug output
-	ZmqLogger::Instance()->AppendDebugMethod(
+	ZMQ_DEBUG(
 		"FrameMapper::GetMappedFrame",
 		"TargetFrameNumber", TargetFrameNumber,
-		"frames.size()", frames.size(),
-		"frames[...].Odd", frames[TargetFrameNumber - 1].Odd.Frame,
-		"frames[...].Even", frames[TargetFrameNumber - 1].Even.Frame);
+		"mapped_length", mapped_length,
+		"frame.Odd", frame.Odd.Frame,
+		"frame.Even", frame.Even.Frame);
 
 	// Return frame
-	return frames[TargetFrameNumber - 1];
+	return frame;
+}
+
+// Calculate (or get) the mapped target frames of a chunk
+const std::vector<MappedFrame>& FrameMapper::MapChunk(int64_t chunk)
+{
+	auto existing = mapped_chunks.find(chunk);
+	if (existing != mapped_chunks.end())
+		return existing->second;
+
+	// Only keep the chunks nearest to this one
+	if (mapped_chunks.size() >= MAX_MAPPING_CHUNKS) {
+		auto farthest = (chunk - mapped_chunks.begin()->first > mapped_chunks.rbegin()->first - chunk) ?
+			mapped_chunks.begin() : std::prev(mapped_chunks.end());
+		mapped_chunks.erase(farthest);
+	}
+
+	std::vector<MappedFrame>& frames = mapped_chunks[chunk];
+	const int64_t first_frame = chunk * MAPPING_CHUNK_FRAMES + 1;
+	const int64_t end_frame = std::min(mapped_length + 1, first_frame + MAPPING_CHUNK_FRAMES);
+	frames.reserve(end_frame - first_frame);
+
+	if (pulldown_fields) {
+		// Resume the pull-down mapping at the start of this chunk
+		const FieldCheckpoint& checkpoint = field_checkpoints[chunk];
+		const bool previous_toggle = field_toggle;
+		int64_t field = checkpoint.field;
+		int64_t frame = checkpoint.frame;
+		field_toggle = checkpoint.field_toggle;
+		fields = checkpoint.fields;
+		Field Odd = checkpoint.odd;
+		Field Even = checkpoint.even;
+
+		for (int64_t frame_number = first_frame; frame_number < end_frame; frame_number++) {
+			// Combine the next 2 fields into a target frame (the top field, and then the bottom field)
+			AddFields(field, frame, 2);
+			if (fields.size() < 2)
+				break;
+			for (int index = 0; index < 2; index++) {
+				if (fields[index].isOdd)
+					Odd = fields[index];
+				else
+					Even = fields[index];
+			}
+			fields.erase(fields.begin(), fields.begin() + 2);
+
+			frames.push_back({Odd, Even, MapSamples(frame_number)});
+		}
+		fields.clear();
+		field_toggle = previous_toggle;
+	} else if (pulldown == PULLDOWN_INTERPOLATE) {
+		// Each target frame is interpolated between the 2 nearest original frames
+		for (int64_t frame_number = first_frame; frame_number < end_frame; frame_number++) {
+			const double position = (frame_number - 1) * value_increment;
+			int64_t original_frame = int64_t(floor(position)) + 1;
+			double blend = position - floor(position);
+			if (blend > 0.999) {
+				original_frame++;
+				blend = 0.0;
+			} else if (blend < 0.001 || original_frame >= reader->info.video_length) {
+				blend = 0.0;
+			}
+			const int64_t following_frame = blend > 0.0 ? original_frame + 1 : original_frame;
+			frames.push_back({Field(original_frame, true), Field(following_frame, false), MapSamples(frame_number), float(blend)});
+		}
+	} else {
+		// Each target frame maps to the nearest original frame (both fields)
+		for (int64_t frame_number = first_frame; frame_number < end_frame; frame_number++) {
+			const int64_t original_frame = round(1.0 + (frame_number - 1) * value_increment);
+			frames.push_back({Field(original_frame, true), Field(original_frame, false), MapSamples(frame_number)});
+		}
+	}
+
+	return frames;
+}
+
+// Calculate the range of original samples of a target frame
+SampleRange FrameMapper::MapSamples(int64_t frame_number)
+{
+	// Determine the range of samples (from the original rate). Resampling happens in real-time when
+	// calling the GetFrame() method. So this method only needs to redistribute the original samples with
+	// the original sample rate. The samples of each target frame follow the samples of the frame before it.
+	const int sample_rate = reader->info.sample_rate;
+	const int channels = reader->info.channels;
+	const int64_t adjusted_frame = AdjustFrameNumber(frame_number);
+	const int64_t position = Frame::GetSamplesBefore(adjusted_frame, target, sample_rate, channels) -
+		Frame::GetSamplesBefore(AdjustFrameNumber(1), target, sample_rate, channels);
+	const int total = Frame::GetSamplesPerFrame(adjusted_frame, target, sample_rate, channels);
+
+	// Find the first and last sample (in the original reader's frame numbers, with NO framerate adjustments)
+	SampleRange samples;
+	samples.frame_start = Frame::GetFrameOfSample(position, original, sample_rate, channels, samples.sample_start);
+	samples.frame_end = samples.frame_start;
+	samples.sample_end = samples.sample_start;
+	if (total > 0)
+		SampleRange::Move(samples.frame_end, samples.sample_end, total - 1, original, sample_rate, channels);
+	samples.total = total;
+	return samples;
 }
 
 // Get or generate a blank frame
@@ -388,12 +450,13 @@ std::shared_ptr<Frame> FrameMapper::GetOrCreateFrame(int64_t number)
 
 	try {
 		// Debug output
-		ZmqLogger::Instance()->AppendDebugMethod(
+		ZMQ_DEBUG(
 			"FrameMapper::GetOrCreateFrame (from reader)",
 			"number", number,
 			"samples_in_frame", samples_in_frame);
 
 		// Attempt to get a frame (but this could fail if a reader has just been closed)
+		AllocationScopeGuard allocations(ALLOCATION_SCOPE_READER);
 		new_frame = reader->GetFrame(number);
 
 		// Return real frame
@@ -406,7 +469,7 @@ std::shared_ptr<Frame> FrameMapper::GetOrCreateFrame(int64_t number)
 	}
 
 	// Debug output
-	ZmqLogger::Instance()->AppendDebugMethod(
+	ZMQ_DEBUG(
 		"FrameMapper::GetOrCreateFrame (create blank)",
 		"number", number,
 		"samples_in_frame", samples_in_frame);
@@ -419,15 +482,35 @@ std::shared_ptr<Frame> FrameMapper::GetOrCreateFrame(int64_t number)
 	return new_frame;
 }
 
+// Can a frame be forwarded to the reader (without mapping or caching it)
+bool FrameMapper::IsBypassed(int64_t frame_number)
+{
+	if (!bypass)
+		return false;
+
+	// Time mapped clips might reverse the audio of this frame
+	Clip *parent = static_cast<Clip *>(ParentClip());
+	if (parent && parent->time.GetLength() > 1)
+		return false;
+
+	// The # of samples of a frame depends on its position on the timeline (unless each frame has the same #)
+	return uniform_samples || AdjustFrameNumber(frame_number) == frame_number;
+}
+
 // Get an openshot::Frame object for a specific frame number of this reader.
 std::shared_ptr<Frame> FrameMapper::GetFrame(int64_t requested_frame)
 {
+	// Forward the frame to the reader (if the target format matches the reader)
+	if (IsBypassed(requested_frame))
+		return reader->GetFrame(requested_frame);
+	AllocationScopeGuard allocations(ALLOCATION_SCOPE_MAPPER);
+
 	// Check final cache, and just return the frame (if it's available)
 	std::shared_ptr<Frame> final_frame = final_cache.GetFrame(requested_frame);
 	if (final_frame) return final_frame;
 
 	// Create a scoped lock, allowing only a single thread to run the following code at one time
-	const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+	const auto lock = TraceLock(getFrameMutex, "wait FrameMapper::getFrameMutex");
 
 	// Find parent properties (if any)
 	Clip *parent = static_cast<Clip *>(ParentClip());
@@ -450,16 +533,23 @@ std::shared_ptr<Frame> FrameMapper::GetFrame(int64_t requested_frame)
 	if (is_dirty)
 		Init();
 
+	// Forward the frame to the reader (if the new mapping matches the reader)
+	if (IsBypassed(requested_frame))
+		return reader->GetFrame(requested_frame);
+
 	// Check final cache a 2nd time (due to potential lock already generating this frame)
 	final_frame = final_cache.GetFrame(requested_frame);
 	if (final_frame) return final_frame;
 
+	// Stop here, if this frame is no longer needed (i.e. the user scrubbed past it)
+	FrameRequest::ThrowIfCancelled(requested_frame);
+
 	// Minimum number of frames to process (for performance reasons)
 	// Dialing this down to 1 for now, as it seems to improve performance, and reduce export crashes
 	int minimum_frames = 1;
 
 	// Debug output
-	ZmqLogger::Instance()->AppendDebugMethod(
+	ZMQ_DEBUG(
 		"FrameMapper::GetFrame (Loop through frames)",
 		"requested_frame", requested_frame,
 		"minimum_frames", minimum_frames);
@@ -468,7 +558,7 @@ std::shared_ptr<Frame> FrameMapper::GetFrame(int64_t requested_frame)
 	for (int64_t frame_number = requested_frame; frame_number < requested_frame + minimum_frames; frame_number++)
 	{
 		// Debug output
-		ZmqLogger::Instance()->AppendDebugMethod(
+		ZMQ_DEBUG(
 			"FrameMapper::GetFrame (inside omp for loop)",
 			"frame_number", frame_number,
 			"minimum_frames", minimum_frames,
@@ -513,9 +603,17 @@ std::shared_ptr<Frame> FrameMapper::GetFrame(int64_t requested_frame)
 		// Copy the image from the odd field
 		std::shared_ptr<Frame> odd_frame = mapped_frame;
 
-		if (odd_frame && odd_frame->has_image_data)
+		if (mapped.Blend > 0.0) {
+			// Interpolate the image between the 2 nearest original frames
+			std::shared_ptr<Frame> next_frame = GetOrCreateFrame(mapped.Even.Frame);
+			if (odd_frame && odd_frame->has_image_data && next_frame && next_frame->has_image_data)
+				frame->AddImage(interpolator.Interpolate(
+					mapped.Odd.Frame, odd_frame->GetImage(), mapped.Even.Frame, next_frame->GetImage(), mapped.Blend));
+			else if (odd_frame && odd_frame->has_image_data)
+				frame->AddImage(std::make_shared<QImage>(*odd_frame->GetImage()));
+		} else if (odd_frame && odd_frame->has_image_data)
 			frame->AddImage(std::make_shared<QImage>(*odd_frame->GetImage()), true);
-		if (mapped.Odd.Frame != mapped.Even.Frame) {
+		if (mapped.Blend == 0.0 && mapped.Odd.Frame != mapped.Even.Frame) {
 			// Add even lines (if different than the previous image)
 			std::shared_ptr<Frame> even_frame;
 			even_frame = GetOrCreateFrame(mapped.Even.Frame);
@@ -648,9 +746,9 @@ void FrameMapper::PrintMapping(std::ostream* out)
 		Init();
 
 	// Loop through frame mappings
-	for (float map = 1; map <= frames.size(); map++)
+	for (int64_t map = 1; map <= mapped_length; map++)
 	{
-		MappedFrame frame = frames[map - 1];
+		MappedFrame frame = GetMappedFrame(map);
 		*out << "Target frame #: " << map
 			 << " mapped to original frame #:\t("
 			 << frame.Odd.Frame << " odd, "
@@ -678,13 +776,37 @@ void FrameMapper::Open()
 {
 	if (reader)
 	{
-		ZmqLogger::Instance()->AppendDebugMethod("FrameMapper::Open");
+		ZMQ_DEBUG("FrameMapper::Open");
 
 		// Open the reader
 		reader->Open();
 	}
 }
 
+// Get the counters of the cache of this reader, and of the mapped reader
+CacheStats FrameMapper::GetCacheStats()
+{
+	CacheStats stats = final_cache.GetStats();
+	if (reader)
+		stats += reader->GetCacheStats();
+	return stats;
+}
+
+// Reset the counters of the cache of this reader, and of the mapped reader
+void FrameMapper::ResetCacheStats()
+{
+	final_cache.ResetStats();
+	if (reader)
+		reader->ResetCacheStats();
+}
+
+// Pass the sequential hint to the mapped reader
+void FrameMapper::SetSequentialHint(bool sequential)
+{
+	if (reader)
+		reader->SetSequentialHint(sequential);
+}
+
 // Close the internal reader
 void FrameMapper::Close()
 {
@@ -693,7 +815,7 @@ void FrameMapper::Close()
 		// Create a scoped lock, allowing only a single thread to run the following code at one time
 		const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
 
-		ZmqLogger::Instance()->AppendDebugMethod("FrameMapper::Close");
+		ZMQ_DEBUG("FrameMapper::Close");
 
 		// Close internal reader
 		reader->Close();
@@ -704,6 +826,7 @@ void FrameMapper::Close()
 
 	// Mark as dirty
 	is_dirty = true;
+	bypass = false;
 
 	// Clear cache
 	final_cache.Clear();
@@ -714,6 +837,12 @@ void FrameMapper::Close()
 		SWR_FREE(&avr);
 		avr = NULL;
 	}
+	if (resampled_audio) {
+		av_freep(&resampled_audio[0]);
+		av_freep(&resampled_audio);
+		resampled_audio_samples = 0;
+		resampled_audio_channels = 0;
+	}
 }
 
 
@@ -778,7 +907,7 @@ void FrameMapper::SetJsonValue(const Json::Value root) {
 // Change frame rate or audio mapping details
 void FrameMapper::ChangeMapping(Fraction target_fps, PulldownType target_pulldown,  int target_sample_rate, int target_channels, ChannelLayout target_channel_layout)
 {
-	ZmqLogger::Instance()->AppendDebugMethod(
+	ZMQ_DEBUG(
 		"FrameMapper::ChangeMapping",
 		"target_fps.num", target_fps.num,
 		"target_fps.den", target_fps.den,
@@ -787,8 +916,15 @@ void FrameMapper::ChangeMapping(Fraction target_fps, PulldownType target_pulldow
 		"target_channels", target_channels,
 		"target_channel_layout", target_channel_layout);
 
-	// Mark as dirty
+	// Nothing to change (keep the current mapping, cached frames and resampler)
+	if (target.num == target_fps.num && target.den == target_fps.den && pulldown == target_pulldown &&
+		info.sample_rate == target_sample_rate && info.channels == target_channels &&
+		info.channel_layout == target_channel_layout)
+		return;
+
+	// Mark as dirty (and map frames again, until Init checks the new target)
 	is_dirty = true;
+	bypass = false;
 
 	// Update mapping details
 	target.num = target_fps.num;
@@ -823,19 +959,20 @@ void FrameMapper::ChangeMapping(Fraction target_fps, PulldownType target_pulldow
 // Resample audio and map channels (if needed)
 void FrameMapper::ResampleMappedAudio(std::shared_ptr<Frame> frame, int64_t original_frame_number)
 {
+	RenderStageTimer timer(RENDER_STAGE_RESAMPLE);
+
 	// Check if mappings are dirty (and need to be recalculated)
 	if (is_dirty)
 		// Recalculate mappings
 		Init();
 
 	// Init audio buffers / variables
-	int total_frame_samples = 0;
 	int channels_in_frame = frame->GetAudioChannelsCount();
 	int sample_rate_in_frame = frame->SampleRate();
 	int samples_in_frame = frame->GetAudioSamplesCount();
 	ChannelLayout channel_layout_in_frame = frame->ChannelsLayout();
 
-	ZmqLogger::Instance()->AppendDebugMethod(
+	ZMQ_DEBUG(
 		"FrameMapper::ResampleMappedAudio",
 		"frame->number", frame->number,
 		"original_frame_number", original_frame_number,
@@ -843,109 +980,90 @@ void FrameMapper::ResampleMappedAudio(std::shared_ptr<Frame> frame, int64_t orig
 		"samples_in_frame", samples_in_frame,
 		"sample_rate_in_frame", sample_rate_in_frame);
 
-	// Get audio sample array
-	float* frame_samples_float = NULL;
-	// Get samples interleaved together (c1 c2 c1 c2 c1 c2)
-	frame_samples_float = frame->GetInterleavedAudioSamples(&samples_in_frame);
-
-	// Calculate total samples
-	total_frame_samples = samples_in_frame * channels_in_frame;
-
-	// Create a new array (to hold all S16 audio samples for the current queued frames)
- 	int16_t* frame_samples = (int16_t*) av_malloc(sizeof(int16_t)*total_frame_samples);
-
-	// Translate audio sample values back to 16 bit integers with saturation
-	float valF;
-	int16_t conv;
-	const int16_t max16 = 32767;
-	const int16_t min16 = -32768;
-	for (int s = 0; s < total_frame_samples; s++) {
-		valF = frame_samples_float[s] * (1 << 15);
-		if (valF > max16)
-			conv = max16;
-		else if (valF < min16)
-			conv = min16;
-		else
-			conv = int(valF + 32768.5) - 32768; // +0.5 is for rounding
-
-		// Copy into buffer
-		frame_samples[s] = conv;
-	}
-
-	// Deallocate float array
-	delete[] frame_samples_float;
-	frame_samples_float = NULL;
-
-	// Create input frame (and allocate arrays)
-	AVFrame *audio_frame = AV_ALLOCATE_FRAME();
-	AV_RESET_FRAME(audio_frame);
-	audio_frame->nb_samples = total_frame_samples / channels_in_frame;
-
-	int buf_size = audio_frame->nb_samples * av_get_bytes_per_sample(AV_SAMPLE_FMT_S16) * channels_in_frame;
-	int error_code = avcodec_fill_audio_frame(
-		audio_frame, channels_in_frame, AV_SAMPLE_FMT_S16,
-		(uint8_t *) frame_samples, buf_size, 1);
+	// Number of samples needed by this frame (at the target sample rate)
+	int total_frame_samples = Frame::GetSamplesPerFrame(AdjustFrameNumber(frame->number), target, info.sample_rate, info.channels);
 
-	if (error_code < 0)
-	{
-		ZmqLogger::Instance()->AppendDebugMethod(
-			"FrameMapper::ResampleMappedAudio ERROR [" + av_err2string(error_code) + "]",
-			"error_code", error_code);
-		throw ErrorEncodingVideo("Error while resampling audio in frame mapper", frame->number);
+	// Delete resampler (if the input format has changed)
+	if (avr && (avr_sample_rate != sample_rate_in_frame || avr_channels != channels_in_frame ||
+				avr_channel_layout != channel_layout_in_frame)) {
+		SWR_CLOSE(avr);
+		SWR_FREE(&avr);
+		avr = NULL;
 	}
 
-	// Update total samples & input frame size (due to bigger or smaller data types)
-	total_frame_samples = Frame::GetSamplesPerFrame(AdjustFrameNumber(frame->number), target, info.sample_rate, info.channels);
-
-	// Create output frame (and allocate arrays)
-	AVFrame *audio_converted = AV_ALLOCATE_FRAME();
-	AV_RESET_FRAME(audio_converted);
-	audio_converted->nb_samples = total_frame_samples;
-	av_samples_alloc(audio_converted->data, audio_converted->linesize, info.channels, total_frame_samples, AV_SAMPLE_FMT_S16, 0);
-
-	int nb_samples = 0;
-
-	// setup resample context
+	// setup resample context (float planar in and out, which is the layout of the frame's audio buffer)
 	if (!avr) {
 		avr = SWR_ALLOC();
 		av_opt_set_int(avr, "in_channel_layout",  channel_layout_in_frame, 0);
 		av_opt_set_int(avr, "out_channel_layout", info.channel_layout,	 0);
-		av_opt_set_int(avr, "in_sample_fmt",	  AV_SAMPLE_FMT_S16,	   0);
-		av_opt_set_int(avr, "out_sample_fmt",	 AV_SAMPLE_FMT_S16,	   0);
+		av_opt_set_int(avr, "in_sample_fmt",	  AV_SAMPLE_FMT_FLTP,	  0);
+		av_opt_set_int(avr, "out_sample_fmt",	 AV_SAMPLE_FMT_FLTP,	  0);
 		av_opt_set_int(avr, "in_sample_rate",	 sample_rate_in_frame,	0);
 		av_opt_set_int(avr, "out_sample_rate",	info.sample_rate,		0);
 		av_opt_set_int(avr, "in_channels",		channels_in_frame,	   0);
 		av_opt_set_int(avr, "out_channels",	   info.channels,		   0);
+
+		// Length of the resampling filters (see Settings::AUDIO_RESAMPLE_QUALITY)
+		switch (Settings::Instance()->AUDIO_RESAMPLE_QUALITY) {
+			case RESAMPLE_QUALITY_DRAFT:
+				av_opt_set_int(avr, "filter_size", 8, 0);
+				av_opt_set_int(avr, "phase_shift", 6, 0);
+				break;
+			case RESAMPLE_QUALITY_HIGH:
+				av_opt_set_int(avr, "filter_size", 64, 0);
+				av_opt_set_int(avr, "phase_shift", 12, 0);
+				av_opt_set_double(avr, "cutoff", 0.97, 0);
+				break;
+			default:
+				// The defaults of FFmpeg
+				break;
+		}
 		SWR_INIT(avr);
+		avr_sample_rate = sample_rate_in_frame;
+		avr_channels = channels_in_frame;
+		avr_channel_layout = channel_layout_in_frame;
 	}
 
+	// Allocate output buffer (only when it's too small, or the # of channels has changed)
+	if (!resampled_audio || resampled_audio_samples < total_frame_samples || resampled_audio_channels != info.channels) {
+		if (resampled_audio) {
+			av_freep(&resampled_audio[0]);
+			av_freep(&resampled_audio);
+		}
+		int error_code = av_samples_alloc_array_and_samples(&resampled_audio, &resampled_audio_linesize, info.channels,
+															total_frame_samples, AV_SAMPLE_FMT_FLTP, 0);
+		if (error_code < 0) {
+			resampled_audio = NULL;
+			resampled_audio_samples = 0;
+			resampled_audio_channels = 0;
+			ZMQ_DEBUG(
+				"FrameMapper::ResampleMappedAudio ERROR [" + av_err2string(error_code) + "]",
+				"error_code", error_code);
+			throw ErrorEncodingVideo("Error while resampling audio in frame mapper", frame->number);
+		}
+		resampled_audio_samples = total_frame_samples;
+		resampled_audio_channels = info.channels;
+	}
+
+	// Input data pointers (the planes of the frame's audio buffer)
+	std::vector<const float*> frame_channels(channels_in_frame);
+	for (int channel = 0; channel < channels_in_frame; channel++)
+		frame_channels[channel] = frame->audio->getReadPointer(channel);
+
 	// Convert audio samples
-	nb_samples = SWR_CONVERT(avr,	  // audio resample context
-		audio_converted->data,		 // output data pointers
-		audio_converted->linesize[0],  // output plane size, in bytes. (0 if unknown)
-		audio_converted->nb_samples,   // maximum number of samples that the output buffer can hold
-		audio_frame->data,			 // input data pointers
-		audio_frame->linesize[0],	  // input plane size, in bytes (0 if unknown)
-		audio_frame->nb_samples);	  // number of input samples to convert
-
-	// Create a new array (to hold all resampled S16 audio samples)
-	int16_t* resampled_samples = new int16_t[(nb_samples * info.channels)];
-
-	// Copy audio samples over original samples
-	memcpy(resampled_samples, audio_converted->data[0], (nb_samples * av_get_bytes_per_sample(AV_SAMPLE_FMT_S16) * info.channels));
-
-	// Free frames
-	av_freep(&audio_frame->data[0]);
-	AV_FREE_FRAME(&audio_frame);
-	av_freep(&audio_converted->data[0]);
-	AV_FREE_FRAME(&audio_converted);
-	frame_samples = NULL;
+	int nb_samples = SWR_CONVERT(avr,	  // audio resample context
+		resampled_audio,			   // output data pointers
+		resampled_audio_linesize,	  // output plane size, in bytes. (0 if unknown)
+		total_frame_samples,		   // maximum number of samples that the output buffer can hold
+		frame_channels.data(),		 // input data pointers
+		samples_in_frame * (int) sizeof(float),	// input plane size, in bytes (0 if unknown)
+		samples_in_frame);			 // number of input samples to convert
+	nb_samples = std::max(nb_samples, 0);
 
 	// Resize the frame to hold the right # of channels and samples
-	int channel_buffer_size = nb_samples;
-	frame->ResizeAudio(info.channels, channel_buffer_size, info.sample_rate, info.channel_layout);
+	frame->ResizeAudio(info.channels, nb_samples, info.sample_rate, info.channel_layout);
 
-	ZmqLogger::Instance()->AppendDebugMethod(
+	ZMQ_DEBUG(
 		"FrameMapper::ResampleMappedAudio (Audio successfully resampled)",
 		"nb_samples", nb_samples,
 		"total_frame_samples", total_frame_samples,
@@ -954,57 +1072,14 @@ void FrameMapper::ResampleMappedAudio(std::shared_ptr<Frame> frame, int64_t orig
 		"info.channels", info.channels,
 		"info.channel_layout", info.channel_layout);
 
-	// Array of floats (to hold samples for each channel)
-	float *channel_buffer = new float[channel_buffer_size];
-
-	// Divide audio into channels. Loop through each channel
-	for (int channel_filter = 0; channel_filter < info.channels; channel_filter++)
-	{
-		// Init array
-		for (int z = 0; z < channel_buffer_size; z++)
-			channel_buffer[z] = 0.0f;
-
-		// Loop through all samples and add them to our Frame based on channel.
-		// Toggle through each channel number, since channel data is stored like (left right left right)
-		int channel = 0;
-		int position = 0;
-		for (int sample = 0; sample < (nb_samples * info.channels); sample++)
-		{
-			// Only add samples for current channel
-			if (channel_filter == channel)
-			{
-				// Add sample (convert from (-32768 to 32768)  to (-1.0 to 1.0))
-				channel_buffer[position] = resampled_samples[sample] * (1.0f / (1 << 15));
-
-				// Increment audio position
-				position++;
-			}
-
-			// increment channel (if needed)
-			if ((channel + 1) < info.channels)
-				// move to next channel
-				channel ++;
-			else
-				// reset channel
-				channel = 0;
-		}
-
-		// Add samples to frame for this channel
-		frame->AddAudio(true, channel_filter, 0, channel_buffer, position, 1.0f);
-	}
+	// Add samples to frame for each channel
+	for (int channel = 0; channel < info.channels; channel++)
+		frame->AddAudio(true, channel, 0, (const float*) resampled_audio[channel], nb_samples, 1.0f);
 
 	// Update frame's audio meta data
 	frame->SampleRate(info.sample_rate);
 	frame->ChannelsLayout(info.channel_layout);
 
-	// clear channel buffer
-	delete[] channel_buffer;
-	channel_buffer = NULL;
-
-	// Delete arrays
-	delete[] resampled_samples;
-	resampled_samples = NULL;
-
 	// Keep track of last resampled frame
 	previous_frame = frame->number;
 }
@@ -14,7 +14,9 @@
 #define OPENSHOT_FRAMEMAPPER_H
 
 #include <assert.h>
+#include <atomic>
 #include <iostream>
+#include <map>
 #include <vector>
 #include <memory>
 
@@ -22,6 +24,7 @@
 #include "CacheMemory.h"
 #include "ReaderBase.h"
 #include "Frame.h"
+#include "FrameInterpolator.h"
 #include "Fraction.h"
 #include "KeyFrame.h"
 
@@ -44,6 +47,7 @@ namespace openshot
 		PULLDOWN_CLASSIC,	///< Classic 2:3:2:3 pull-down
 		PULLDOWN_ADVANCED,	///< Advanced 2:3:3:2 pull-down (minimal dirty frames)
 		PULLDOWN_NONE,		///< Do not apply pull-down techniques, just repeat or skip entire frames
+		PULLDOWN_INTERPOLATE,	///< Interpolate new frames between the nearest original frames (see FrameInterpolator)
 	};
 
 	/**
@@ -80,31 +84,21 @@ namespace openshot
 		int64_t frame_end;
 		int sample_end;
 
+		/// Move a position (a frame and a sample in that frame) by a # of samples (to the left, if negative)
+		static void Move(int64_t& frame, int& sample, int64_t samples, openshot::Fraction fps, int sample_rate, int channels) {
+			const int64_t position = Frame::GetSamplesBefore(frame, fps, sample_rate, channels) + sample + samples;
+			frame = Frame::GetFrameOfSample(position, fps, sample_rate, channels, sample);
+		}
+
 		/// Extend SampleRange on either side
 		void Extend(int64_t samples, openshot::Fraction fps, int sample_rate, int channels, bool right_side) {
-			int remaining_samples = samples;
-			while (remaining_samples > 0) {
+			if (samples > 0) {
 				if (right_side) {
 					// Extend range to the right
-					int samples_per_frame = Frame::GetSamplesPerFrame(frame_end, fps, sample_rate, channels);
-					if (remaining_samples + sample_end < samples_per_frame) {
-						sample_end += remaining_samples;
-						remaining_samples = 0;
-					} else {
-						frame_end++;
-						remaining_samples -= (samples_per_frame - sample_end);
-						sample_end = 0;
-					}
+					Move(frame_end, sample_end, samples, fps, sample_rate, channels);
 				} else {
 					// Extend range to the left
-					if (sample_start - remaining_samples >= 0) {
-						sample_start -= remaining_samples;
-						remaining_samples = 0;
-					} else {
-						frame_start--;
-						remaining_samples -= (sample_start + 1);
-						sample_start = Frame::GetSamplesPerFrame(frame_start, fps, sample_rate, channels) - 1;
-					}
+					Move(frame_start, sample_start, -samples, fps, sample_rate, channels);
 				}
 			}
 
@@ -114,30 +108,13 @@ namespace openshot
 
 		/// Shrink SampleRange on either side
 		void Shrink(int64_t samples, openshot::Fraction fps, int sample_rate, int channels, bool right_side) {
-			int remaining_samples = samples;
-			while (remaining_samples > 0) {
+			if (samples > 0) {
 				if (right_side) {
 					// Shrink range on the right
-					if (sample_end - remaining_samples >= 0) {
-						sample_end -= remaining_samples;
-						remaining_samples = 0;
-					} else {
-						frame_end--;
-						int samples_per_frame = Frame::GetSamplesPerFrame(frame_end, fps, sample_rate, channels);
-						remaining_samples -= (sample_end + 1);
-						sample_end = samples_per_frame - 1;
-					}
+					Move(frame_end, sample_end, -samples, fps, sample_rate, channels);
 				} else {
 					// Shrink range on the left
-					int samples_per_frame = Frame::GetSamplesPerFrame(frame_start, fps, sample_rate, channels);
-					if (sample_start + remaining_samples < samples_per_frame) {
-						sample_start += remaining_samples;
-						remaining_samples = 0;
-					} else {
-						frame_start++;
-						remaining_samples -= (samples_per_frame - sample_start);
-						sample_start = 0;
-					}
+					Move(frame_start, sample_start, samples, fps, sample_rate, channels);
 				}
 			}
 
@@ -174,6 +151,7 @@ namespace openshot
 		Field Odd;
 		Field Even;
 		SampleRange Samples;
+		float Blend = 0.0;	///< The position between the Odd and Even frame (PULLDOWN_INTERPOLATE only, 0.0 = the Odd frame)
 	};
 
 
@@ -188,6 +166,14 @@ namespace openshot
 	 * of frames returned from the FrameMapper.
 	 * \image html FrameMapper.png
 	 *
+	 * When the frame rate, sample rate, channels and channel layout of the reader already match the target,
+	 * GetFrame() forwards each frame straight to the reader (without locking, mapping or caching it), until
+	 * ChangeMapping() sets a different target.
+	 *
+	 * PULLDOWN_INTERPOLATE interpolates each new frame between the 2 nearest original frames (with motion
+	 * compensation, when built with OpenCV), instead of repeating or skipping frames, i.e. for smooth 24 to 60 fps
+	 * conversions.
+	 *
 	 * Please see the following <b>Example Code</b>:
 	 * \code
 	 * // Create a frame mapper for a reader, and convert the frame rate (from 24 fps to 29.97 fps)
@@ -200,6 +186,22 @@ namespace openshot
 	 */
 	class FrameMapper : public ReaderBase {
 	private:
+		/// The number of target frames mapped at once (mappings are only calculated for the chunks which are requested)
+		static constexpr int64_t MAPPING_CHUNK_FRAMES = 1024;
+
+		/// The max number of mapped chunks to keep
+		static constexpr size_t MAX_MAPPING_CHUNKS = 64;
+
+		/// The state of the pull-down mapping of fields at the start of a chunk (to map a chunk without the chunks before it)
+		struct FieldCheckpoint {
+			int64_t field;				// The next original field
+			int64_t frame;				// The original frame of that field
+			bool field_toggle;			// The odd / even toggle
+			std::vector<Field> fields;	// The fields of the chunk which were already added
+			Field odd;					// The last ODD field (of the previous target frame)
+			Field even;					// The last EVEN field (of the previous target frame)
+		};
+
 		bool field_toggle;		// Internal odd / even toggle (used when building the mapping)
 		Fraction original;		// The original frame rate
 		Fraction target;		// The target frame rate
@@ -211,6 +213,26 @@ namespace openshot
 		float parent_start;		// Start of parent clip (which is used to generate the audio mapping)
 		int64_t previous_frame; // Used during resampling, to determine when a large gap is detected
 		SWRCONTEXT *avr;	// Audio resampling context object
+		int avr_sample_rate;	// Input sample rate of avr
+		int avr_channels;		// Input channels of avr
+		ChannelLayout avr_channel_layout;	// Input channel layout of avr
+		uint8_t **resampled_audio;		// Float planar output buffer of avr (re-used for each frame)
+		int resampled_audio_linesize;	// Plane size of resampled_audio (in bytes)
+		int resampled_audio_samples;	// Number of samples each plane of resampled_audio can hold
+		int resampled_audio_channels;	// Number of planes of resampled_audio
+		int64_t mapped_length;	// Number of target frames
+		bool pulldown_fields;	// Map the fields with a pull-down technique (otherwise each target frame maps to a single original frame)
+		float difference;		// Difference (in frames) between the original and target frame rates (pull-down only)
+		int field_interval;		// Interval of fields to skip or repeat (pull-down only)
+		int frame_interval;		// Interval of frames to skip or repeat (pull-down only)
+		double value_increment;	// Original frames per target frame
+		std::vector<FieldCheckpoint> field_checkpoints;	// State of the pull-down mapping at the start of each chunk
+		std::map<int64_t, std::vector<MappedFrame>> mapped_chunks;	// Mapped target frames (by chunk)
+		std::atomic<bool> bypass;			// The target format matches the reader (frames are forwarded to the reader)
+		std::atomic<bool> uniform_samples;	// Each frame has the same # of samples (so the clip position doesn't change them)
+
+		// Interpolates the images of PULLDOWN_INTERPOLATE frames
+		openshot::FrameInterpolator interpolator;
 
 		// Audio resampler (if resampling audio)
 		openshot::AudioResampler *resampler;
@@ -219,9 +241,21 @@ namespace openshot
 		void AddField(int64_t frame);
 		void AddField(Field field);
 
-		// Clear both the fields & frames lists
+		// Add the fields of the next original fields (with the pull-down technique), until there are enough fields
+		void AddFields(int64_t& field, int64_t& frame, std::vector<Field>::size_type needed_fields);
+
+		// Calculate (or get) the mapped target frames of a chunk
+		const std::vector<MappedFrame>& MapChunk(int64_t chunk);
+
+		// Calculate the range of original samples of a target frame
+		SampleRange MapSamples(int64_t frame_number);
+
+		// Clear the fields and the mapped frames
 		void Clear();
 
+		// Can a frame be forwarded to the reader (without mapping or caching it)
+		bool IsBypassed(int64_t frame_number);
+
 		// Get Frame or Generate Blank Frame
 		std::shared_ptr<Frame> GetOrCreateFrame(int64_t number);
 
@@ -231,13 +265,13 @@ namespace openshot
 		// Use the original and target frame rates and a pull-down technique to create
 		// a mapping between the original fields and frames or a video to a new frame rate.
 		// This might repeat or skip fields and frames of the original video, depending on
-		// whether the frame rate is increasing or decreasing.
+		// whether the frame rate is increasing or decreasing. The target frames are only
+		// mapped once they are requested (in chunks), see GetMappedFrame().
 		void Init();
 
 	public:
 		// Init some containers
-		std::vector<Field> fields;		// List of all fields
-		std::vector<MappedFrame> frames;	// List of all frames
+		std::vector<Field> fields;		// List of fields (of the chunk being mapped)
 
 		/// Default constructor for openshot::FrameMapper class
 		FrameMapper(ReaderBase *reader, Fraction target_fps, PulldownType target_pulldown, int target_sample_rate, int target_channels, ChannelLayout target_channel_layout);
@@ -257,6 +291,15 @@ namespace openshot
 		/// Get the cache object used by this reader
 		CacheMemory* GetCache() override { return &final_cache; };
 
+		/// Get the counters of the cache of this reader, and of the mapped reader
+		openshot::CacheStats GetCacheStats() override;
+
+		/// Reset the counters of the cache of this reader, and of the mapped reader
+		void ResetCacheStats() override;
+
+		/// Pass the sequential hint to the mapped reader (see ReaderBase::SetSequentialHint)
+		void SetSequentialHint(bool sequential) override;
+
 		/// @brief This method is required for all derived classes of ReaderBase, and return the
 		/// openshot::Frame object, which contains the image and audio information for that
 		/// frame of video.
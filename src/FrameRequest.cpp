@@ -0,0 +1,211 @@
+/**
+ * @file
+ * @brief Source file for FrameRequest class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+#include "FrameRequest.h"
+#include "Exceptions.h"
+#include "Frame.h"
+#include "OpenMPUtilities.h"
+#include "ReaderBase.h"
+
+using namespace openshot;
+
+namespace openshot
+{
+	// The pool of threads which render requested frames (shared by all readers)
+	class FrameRequestQueue
+	{
+	private:
+		std::vector<std::thread> workers;
+		std::mutex queue_mutex;
+		std::condition_variable queue_condition;
+		std::vector<std::shared_ptr<FrameRequest>> queue; ///< A heap (highest priority, then oldest, first)
+		uint64_t next_sequence;
+		bool stop;
+
+		// Order requests by priority (and then by age)
+		static bool compare(const std::shared_ptr<FrameRequest>& a, const std::shared_ptr<FrameRequest>& b) {
+			if (a->priority != b->priority)
+				return a->priority < b->priority;
+			return a->sequence > b->sequence;
+		}
+
+		// Render queued requests (until stopped)
+		void worker() {
+			while (true) {
+				std::shared_ptr<FrameRequest> request;
+				{
+					std::unique_lock<std::mutex> lock(queue_mutex);
+					queue_condition.wait(lock, [this] { return stop || !queue.empty(); });
+					if (stop)
+						return;
+					std::pop_heap(queue.begin(), queue.end(), compare);
+					request = queue.back();
+					queue.pop_back();
+				}
+
+				// Cancelled requests are already finished (and are skipped by Run)
+				request->Run();
+			}
+		}
+
+	public:
+		FrameRequestQueue() : next_sequence(0), stop(false) {
+			for (int index = 0; index < OPEN_MP_NUM_PROCESSORS; index++)
+				workers.emplace_back(&FrameRequestQueue::worker, this);
+		}
+
+		~FrameRequestQueue() {
+			std::vector<std::shared_ptr<FrameRequest>> pending;
+			{
+				const std::lock_guard<std::mutex> lock(queue_mutex);
+				stop = true;
+				pending.swap(queue);
+			}
+			queue_condition.notify_all();
+
+			// Nobody can wait forever on a request which will never run
+			for (auto& request : pending)
+				request->Cancel();
+			for (auto& worker : workers)
+				worker.join();
+		}
+
+		// Get the shared queue (the threads are started on first use)
+		static FrameRequestQueue& Instance() {
+			static FrameRequestQueue instance;
+			return instance;
+		}
+
+		// Add a request to the queue
+		void Push(std::shared_ptr<FrameRequest> request) {
+			{
+				const std::lock_guard<std::mutex> lock(queue_mutex);
+				request->sequence = next_sequence++;
+				queue.push_back(request);
+				std::push_heap(queue.begin(), queue.end(), compare);
+			}
+			queue_condition.notify_one();
+		}
+	};
+}
+
+// The request running on the current thread (if any)
+static thread_local FrameRequest* current_request = nullptr;
+
+// Constructor
+FrameRequest::FrameRequest(ReaderBase* reader, int64_t frame_number, int priority)
+	: reader(reader), frame_number(frame_number), priority(priority), sequence(0), started(false),
+	  finished(false), cancelled(false), result(promise.get_future().share())
+{
+}
+
+// Cancel this request
+void FrameRequest::Cancel()
+{
+	const std::lock_guard<std::mutex> lock(state_mutex);
+	cancelled = true;
+
+	// A queued request is finished right away (a running request stops at the next safe point)
+	if (!started && !finished) {
+		finished = true;
+		promise.set_exception(std::make_exception_ptr(
+			FrameRequestCancelled("The frame request was cancelled.", frame_number)));
+	}
+}
+
+// Determine if this request is finished
+bool FrameRequest::IsFinished()
+{
+	const std::lock_guard<std::mutex> lock(state_mutex);
+	return finished;
+}
+
+// Wait for the frame
+std::shared_ptr<Frame> FrameRequest::Get()
+{
+	return result.get();
+}
+
+// Wait for the frame (for a limited time)
+bool FrameRequest::Wait(int milliseconds)
+{
+	return result.wait_for(std::chrono::milliseconds(milliseconds)) == std::future_status::ready;
+}
+
+// Queue a request on the pool of render threads
+void FrameRequest::Submit(std::shared_ptr<FrameRequest> request)
+{
+	FrameRequestQueue::Instance().Push(request);
+}
+
+// Render the frame on the calling thread
+void FrameRequest::Run()
+{
+	{
+		const std::lock_guard<std::mutex> lock(state_mutex);
+		if (started || finished)
+			return;
+		started = true;
+	}
+
+	// Render the frame (the reader calls ThrowIfCancelled at its safe points)
+	FrameRequest* previous_request = current_request;
+	current_request = this;
+	std::shared_ptr<Frame> frame;
+	std::exception_ptr error;
+	try {
+		frame = reader->GetFrame(frame_number);
+	} catch (...) {
+		error = std::current_exception();
+	}
+	current_request = previous_request;
+
+	const std::lock_guard<std::mutex> lock(state_mutex);
+	finished = true;
+	if (error)
+		promise.set_exception(error);
+	else
+		promise.set_value(frame);
+}
+
+// Stop rendering, if the request running on this thread is cancelled
+void FrameRequest::ThrowIfCancelled(int64_t frame_number)
+{
+	if (current_request && current_request->cancelled.load())
+		throw FrameRequestCancelled("The frame request was cancelled.", frame_number);
+}
+
+// Get the request running on the current thread
+FrameRequest* FrameRequest::Current()
+{
+	return current_request;
+}
+
+// Run part of a request on the calling thread
+void FrameRequest::RunAs(FrameRequest* request, const std::function<void()>& function)
+{
+	FrameRequest* previous_request = current_request;
+	current_request = request;
+	try {
+		function();
+	} catch (...) {
+		current_request = previous_request;
+		throw;
+	}
+	current_request = previous_request;
+}
@@ -0,0 +1,124 @@
+/**
+ * @file
+ * @brief Header file for FrameRequest class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_FRAME_REQUEST_H
+#define OPENSHOT_FRAME_REQUEST_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+
+namespace openshot
+{
+	class Frame;
+	class ReaderBase;
+
+	/**
+	 * @brief A cancellable request for a frame, which is rendered in the background.
+	 *
+	 * Requests are returned by openshot::ReaderBase::RequestFrame(), and are rendered (highest priority first)
+	 * by a small pool of threads shared by all readers. A request which is no longer needed (i.e. a frame the
+	 * user has already scrubbed past) can be cancelled. Queued requests are simply dropped, and running requests
+	 * stop at the next safe point of the reader (openshot::Timeline, openshot::Clip, openshot::FrameMapper
+	 * and openshot::FFmpegReader check for cancellation before their expensive work). Frames are only ever
+	 * cached once they are complete, so a cancelled request never leaves a partial frame behind.
+	 *
+	 * \code
+	 * std::shared_ptr<FrameRequest> request = timeline.RequestFrame(100, 1);
+	 *
+	 * // The user scrubbed to another frame
+	 * request->Cancel();
+	 *
+	 * // Or wait for the frame (this throws FrameRequestCancelled, if the request was cancelled)
+	 * std::shared_ptr<Frame> f = request->Get();
+	 * \endcode
+	 *
+	 * The reader must outlive its requests (cancel them, and wait for them, before deleting the reader).
+	 */
+	class FrameRequest
+	{
+	private:
+		ReaderBase* reader;
+		int64_t frame_number;
+		int priority;
+		uint64_t sequence; ///< Orders requests of the same priority (oldest first)
+		std::mutex state_mutex; ///< Guards started and finished (and setting the result)
+		bool started;
+		bool finished;
+		std::atomic<bool> cancelled;
+		std::promise<std::shared_ptr<openshot::Frame>> promise;
+		std::shared_future<std::shared_ptr<openshot::Frame>> result;
+
+		friend class FrameRequestQueue;
+
+	public:
+		/// @brief Constructor (use openshot::ReaderBase::RequestFrame() to render it in the background)
+		/// @param reader The reader to get the frame from
+		/// @param frame_number The frame number to request
+		/// @param priority Requests with a higher priority are rendered first
+		FrameRequest(ReaderBase* reader, int64_t frame_number, int priority = 0);
+
+		/// Get the requested frame number
+		int64_t Number() const { return frame_number; }
+
+		/// Get the priority of this request
+		int Priority() const { return priority; }
+
+		/// @brief Cancel this request. A queued request is dropped immediately, and a running
+		/// request stops at the next safe point of the reader.
+		void Cancel();
+
+		/// Determine if this request was cancelled
+		bool IsCancelled() const { return cancelled.load(); }
+
+		/// Determine if this request is finished (i.e. Get() will not block)
+		bool IsFinished();
+
+		/// @brief Wait for the frame
+		/// @returns The requested frame
+		/// Throws openshot::FrameRequestCancelled if the request was cancelled (or the reader's exception)
+		std::shared_ptr<openshot::Frame> Get();
+
+		/// @brief Wait for the frame (for a limited time)
+		/// @returns True if the request is finished
+		/// @param milliseconds The maximum time to wait
+		bool Wait(int milliseconds);
+
+		/// @brief Queue a request on the pool of render threads (shared by all readers)
+		/// @param request The request to render
+		static void Submit(std::shared_ptr<FrameRequest> request);
+
+		/// @brief Render the frame on the calling thread (unless the request is already started or cancelled).
+		/// The result (or exception) is stored in the request.
+		void Run();
+
+		/// @brief Stop rendering, if the request running on this thread is cancelled. Readers call this
+		/// at safe points (before any expensive work, and never inside a parallel region).
+		/// Throws openshot::FrameRequestCancelled when the request is cancelled.
+		/// @param frame_number The frame being rendered (for the exception message)
+		static void ThrowIfCancelled(int64_t frame_number);
+
+		/// Get the request running on the current thread (if any)
+		static FrameRequest* Current();
+
+		/// @brief Run part of a request on the calling thread (i.e. a task on another thread), so that
+		/// ThrowIfCancelled stops it when the request is cancelled
+		/// @param request The request (from Current(), or nullptr)
+		/// @param function The part of the request to run
+		static void RunAs(FrameRequest* request, const std::function<void()>& function);
+	};
+}
+
+#endif // OPENSHOT_FRAME_REQUEST_H
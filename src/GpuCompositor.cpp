@@ -0,0 +1,403 @@
+/**
+ * @file
+ * @brief Source file for GpuCompositor class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+#include <thread>
+
+#include <QCoreApplication>
+#include <QGenericMatrix>
+#include <QGuiApplication>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#include <QPainter>
+#include <QThread>
+#include <QVector2D>
+#include <QVector4D>
+
+#include "GpuCompositor.h"
+#include "ZmqLogger.h"
+
+using namespace openshot;
+
+namespace {
+	// Transform the unit quad into the layer's pixels, and then into the canvas' pixels. The canvas' first row is
+	// the framebuffer's first row (so it is read back in order). The position is kept homogeneous, so perspective
+	// transforms are interpolated correctly.
+	const char *VERTEX_SHADER = R"(
+		attribute vec2 position;
+		uniform mat3 transform;
+		uniform vec2 layer_size;
+		uniform vec2 canvas_size;
+		varying vec2 texcoord;
+
+		void main() {
+			vec3 canvas = transform * vec3(position * layer_size, 1.0);
+			texcoord = position;
+			gl_Position = vec4(2.0 * canvas.x / canvas_size.x - canvas.z, 2.0 * canvas.y / canvas_size.y - canvas.z, 0.0, canvas.z);
+		}
+	)";
+
+	// Sample the premultiplied layer (or its solid color), and apply its point-wise effects to the un-premultiplied
+	// colors (the same formulas as PixelKernels, with colors from 0 to 1)
+	const char *FRAGMENT_SHADER = R"(
+		#ifdef GL_ES
+		precision highp float;
+		#endif
+
+		uniform sampler2D layer;
+		uniform bool solid;
+		uniform vec4 color;
+		uniform int operation_count;
+		uniform int operation_types[8];
+		uniform vec4 operation_values[8];
+		varying vec2 texcoord;
+
+		const vec3 SATURATION_P = vec3(0.299, 0.587, 0.114);
+		const vec3 SATURATION_SQRT_P = vec3(0.5468089, 0.7661593, 0.3376389);
+
+		void main() {
+			vec4 pixel = solid ? color : texture2D(layer, texcoord);
+			if (operation_count > 0 && pixel.a > 0.0) {
+				vec3 rgb = min(pixel.rgb / pixel.a, 1.0);
+				for (int index = 0; index < 8; index++) {
+					if (index >= operation_count)
+						break;
+					vec4 values = operation_values[index];
+					int type = operation_types[index];
+					if (type == 0) {
+						// Brightness & contrast (values: brightness, contrast factor)
+						rgb = clamp(clamp(values.y * (rgb - 0.50196) + 0.50196, 0.0, 1.0) + values.x, 0.0, 1.0);
+					} else if (type == 1) {
+						// Saturation (values: saturation, red, green and blue saturation)
+						float grey = sqrt(dot(rgb * rgb, SATURATION_P));
+						rgb = clamp(grey + (rgb - grey) * values.x, 0.0, 1.0);
+						vec3 p = rgb * SATURATION_SQRT_P;
+						vec3 white = p * (1.0 - values.yzw);
+						rgb = clamp(vec3(p.r + (rgb.r - p.r) * values.y + white.g + white.b,
+										 white.r + p.g + (rgb.g - p.g) * values.z + white.b,
+										 white.r + white.g + p.b + (rgb.b - p.b) * values.w), 0.0, 1.0);
+					} else if (type == 2) {
+						// Hue rotation (values: the coefficients of the circulant rotation matrix)
+						rgb = clamp(vec3(dot(rgb, values.xyz), dot(rgb, values.zxy), dot(rgb, values.yzx)), 0.0, 1.0);
+					} else if (type == 3) {
+						// Negate
+						rgb = 1.0 - rgb;
+					}
+				}
+				pixel = vec4(rgb * pixel.a, pixel.a);
+			}
+			gl_FragColor = pixel;
+		}
+	)";
+
+	// The unit quad (drawn as a triangle strip)
+	const GLfloat QUAD[] = { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+
+	// Compute contrast adjustment factor (see PixelKernels::BrightnessContrast)
+	float contrast_factor(float contrast) {
+		return (259.0f * (contrast + 255.0f)) / (255.0f * (259.0f - contrast));
+	}
+}
+
+// Global reference to the compositor
+GpuCompositor *GpuCompositor::m_pInstance = nullptr;
+
+// Create or Get an instance of the compositor singleton
+GpuCompositor *GpuCompositor::Instance()
+{
+	// Create the actual instance of the compositor only once (frames are rendered on many threads)
+	static std::once_flag created;
+	std::call_once(created, []() { m_pInstance = new GpuCompositor; });
+
+	return m_pInstance;
+}
+
+// Default constructor
+GpuCompositor::GpuCompositor() : available(false), initialized(false), surface(nullptr), context(nullptr), program(nullptr),
+								 multisample_fbo(nullptr), resolve_fbo(nullptr)
+{
+}
+
+// Create the OpenGL context and compile the shaders
+bool GpuCompositor::Initialize()
+{
+	if (initialized)
+		return available;
+
+	// Offscreen surfaces can only be created on the GUI thread
+	QGuiApplication *app = qobject_cast<QGuiApplication *>(QCoreApplication::instance());
+	if (!app || QThread::currentThread() != app->thread()) {
+		ZMQ_DEBUG("GpuCompositor::Initialize (not on the GUI thread of a QGuiApplication)");
+		return false;
+	}
+	initialized = true;
+
+	surface = new QOffscreenSurface();
+	surface->setFormat(QSurfaceFormat::defaultFormat());
+	surface->create();
+	context = new QOpenGLContext();
+	context->setFormat(surface->requestedFormat());
+	if (!surface->isValid() || !context->create()) {
+		ZMQ_DEBUG("GpuCompositor::Initialize (no OpenGL context)");
+		return false;
+	}
+
+	// Start the OpenGL thread, and move the context to it (the context is only used on that thread)
+	QThread *gl_qthread = nullptr;
+	std::promise<void> started;
+	std::future<void> thread_started = started.get_future();
+	std::thread(&GpuCompositor::run_thread, this, &gl_qthread, &started).detach();
+	thread_started.wait();
+	context->moveToThread(gl_qthread);
+
+	bool created = false;
+	run_job([this, &created]() { created = context->makeCurrent(surface) && create_program(); });
+	available = created;
+
+	ZMQ_DEBUG("GpuCompositor::Initialize", "available", available);
+	return available;
+}
+
+// Run the jobs of the OpenGL thread
+void GpuCompositor::run_thread(QThread **gl_qthread, std::promise<void> *started)
+{
+	*gl_qthread = QThread::currentThread();
+	started->set_value();
+
+	while (true) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(jobMutex);
+			jobs_changed.wait(lock, [this]() { return !jobs.empty(); });
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+		job();
+	}
+}
+
+// Run a job on the OpenGL thread, and wait for it
+void GpuCompositor::run_job(std::function<void()> job)
+{
+	std::promise<void> done;
+	std::future<void> job_done = done.get_future();
+	{
+		const std::lock_guard<std::mutex> lock(jobMutex);
+		jobs.push_back([&job, &done]() {
+			job();
+			done.set_value();
+		});
+	}
+	jobs_changed.notify_one();
+	job_done.wait();
+}
+
+// Compile the shaders
+bool GpuCompositor::create_program()
+{
+	program = new QOpenGLShaderProgram();
+	program->addShaderFromSourceCode(QOpenGLShader::Vertex, VERTEX_SHADER);
+	program->addShaderFromSourceCode(QOpenGLShader::Fragment, FRAGMENT_SHADER);
+	program->bindAttributeLocation("position", 0);
+	if (!program->link()) {
+		ZMQ_DEBUG("GpuCompositor::create_program (shaders failed to link)");
+		return false;
+	}
+	return true;
+}
+
+// Upload the pixels of a layer to its texture
+void GpuCompositor::upload_layer(size_t index, const PixelLayer& layer)
+{
+	QOpenGLFunctions *gl = context->functions();
+	if (index >= textures.size()) {
+		GLuint texture = 0;
+		gl->glGenTextures(1, &texture);
+		gl->glBindTexture(GL_TEXTURE_2D, texture);
+		gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		textures.push_back(texture);
+		texture_sizes.push_back(QSize());
+	}
+	gl->glBindTexture(GL_TEXTURE_2D, textures[index]);
+
+	// Upload the rows in place (the layer's rows can be padded)
+	gl->glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	gl->glPixelStorei(GL_UNPACK_ROW_LENGTH, layer.bytes_per_line / 4);
+	const QSize size(layer.width, layer.height);
+	if (texture_sizes[index] != size) {
+		gl->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, layer.width, layer.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, layer.pixels);
+		texture_sizes[index] = size;
+	} else {
+		gl->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, layer.width, layer.height, GL_RGBA, GL_UNSIGNED_BYTE, layer.pixels);
+	}
+	gl->glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
+
+// Composite layers onto a canvas on the GPU
+bool GpuCompositor::Composite(QImage& canvas, const QColor& background, const std::vector<GpuLayer>& layers)
+{
+	if (!available)
+		return false;
+
+	// The layers of all frames are composited on the OpenGL thread (one frame at a time)
+	bool composited = false;
+	run_job([this, &canvas, &background, &layers, &composited]() { composited = composite(canvas, background, layers); });
+	return composited;
+}
+
+// Composite the layers onto the canvas (on the OpenGL thread)
+bool GpuCompositor::composite(QImage& canvas, const QColor& background, const std::vector<GpuLayer>& layers)
+{
+	QOpenGLFunctions *gl = context->functions();
+	const int width = canvas.width();
+	const int height = canvas.height();
+
+	// Create the framebuffers (multisampled, so transformed edges are antialiased)
+	if (!resolve_fbo || resolve_fbo->size() != canvas.size()) {
+		delete multisample_fbo;
+		delete resolve_fbo;
+		multisample_fbo = nullptr;
+		QOpenGLFramebufferObjectFormat format;
+		format.setInternalTextureFormat(GL_RGBA8);
+		resolve_fbo = new QOpenGLFramebufferObject(canvas.size(), format);
+		if (QOpenGLFramebufferObject::hasOpenGLFramebufferBlit()) {
+			format.setSamples(4);
+			multisample_fbo = new QOpenGLFramebufferObject(canvas.size(), format);
+		}
+	}
+	QOpenGLFramebufferObject *target = multisample_fbo ? multisample_fbo : resolve_fbo;
+	if (!target->isValid() || !target->bind())
+		return false;
+
+	// The canvas' own pixels are the bottom layer (unless it is a solid color)
+	std::vector<GpuLayer> draw_layers;
+	if (background.isValid()) {
+		gl->glClearColor(background.redF() * background.alphaF(), background.greenF() * background.alphaF(),
+						 background.blueF() * background.alphaF(), background.alphaF());
+	} else {
+		gl->glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+		GpuLayer canvas_layer;
+		canvas_layer.layer.pixels = canvas.constBits();
+		canvas_layer.layer.bytes_per_line = canvas.bytesPerLine();
+		canvas_layer.layer.x = 0;
+		canvas_layer.layer.y = 0;
+		canvas_layer.layer.width = width;
+		canvas_layer.layer.height = height;
+		draw_layers.push_back(canvas_layer);
+	}
+	draw_layers.insert(draw_layers.end(), layers.begin(), layers.end());
+
+	gl->glViewport(0, 0, width, height);
+	gl->glClear(GL_COLOR_BUFFER_BIT);
+	gl->glEnable(GL_BLEND);
+	gl->glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+	program->bind();
+	program->setUniformValue("canvas_size", QVector2D(width, height));
+	program->setUniformValue("layer", 0);
+	program->enableAttributeArray(0);
+	program->setAttributeArray(0, GL_FLOAT, QUAD, 2);
+	gl->glActiveTexture(GL_TEXTURE0);
+
+	for (size_t index = 0; index < draw_layers.size(); index++) {
+		const GpuLayer& layer = draw_layers[index];
+		const QTransform& t = layer.transform;
+		const float transform[9] = { float(t.m11()), float(t.m21()), float(t.dx()),
+									 float(t.m12()), float(t.m22()), float(t.dy()),
+									 float(t.m13()), float(t.m23()), float(t.m33()) };
+		program->setUniformValue("transform", QMatrix3x3(transform));
+		program->setUniformValue("layer_size", QVector2D(layer.layer.width, layer.layer.height));
+
+		if (layer.layer.solid) {
+			program->setUniformValue("solid", GLint(1));
+			program->setUniformValue("color", QVector4D(layer.layer.color[0], layer.layer.color[1],
+														layer.layer.color[2], layer.layer.color[3]) / 255.0f);
+		} else {
+			program->setUniformValue("solid", GLint(0));
+			upload_layer(index, layer.layer);
+			const GLint filter = (layer.transformed && layer.smooth) ? GL_LINEAR : GL_NEAREST;
+			gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+			gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+		}
+
+		// The point-wise effects (the clip only defers its last effects, see MAX_OPERATIONS)
+		const int operation_count = std::min<int>(layer.operations.size(), MAX_OPERATIONS);
+		GLint types[MAX_OPERATIONS];
+		QVector4D values[MAX_OPERATIONS];
+		for (int operation = 0; operation < operation_count; operation++) {
+			const PixelOperation& pixel_operation = layer.operations[operation];
+			types[operation] = GLint(pixel_operation.type);
+			values[operation] = QVector4D(pixel_operation.values[0], pixel_operation.values[1],
+										  pixel_operation.values[2], pixel_operation.values[3]);
+			if (pixel_operation.type == PixelOperation::BRIGHTNESS_CONTRAST)
+				values[operation].setY(contrast_factor(pixel_operation.values[1]));
+		}
+		program->setUniformValue("operation_count", GLint(operation_count));
+		if (operation_count > 0) {
+			program->setUniformValueArray("operation_types", types, operation_count);
+			program->setUniformValueArray("operation_values", values, operation_count);
+		}
+
+		gl->glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	}
+	program->disableAttributeArray(0);
+	program->release();
+	gl->glDisable(GL_BLEND);
+
+	// Resolve the samples, and read the canvas back (once per frame)
+	if (multisample_fbo)
+		QOpenGLFramebufferObject::blitFramebuffer(resolve_fbo, multisample_fbo);
+	resolve_fbo->bind();
+	gl->glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	gl->glPixelStorei(GL_PACK_ROW_LENGTH, canvas.bytesPerLine() / 4);
+	gl->glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, canvas.bits());
+	gl->glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+	resolve_fbo->release();
+
+	return gl->glGetError() == GL_NO_ERROR;
+}
+
+// Composite layers onto a canvas on the CPU
+void GpuCompositor::CompositeOnCpu(QImage& canvas, const QColor& background, const std::vector<GpuLayer>& layers)
+{
+	if (background.isValid())
+		canvas.fill(background);
+
+	QPainter painter(&canvas);
+	painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+	for (const auto& layer : layers) {
+		painter.setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform, layer.transformed && layer.smooth);
+		painter.setTransform(layer.transform);
+
+		if (layer.layer.solid) {
+			// Apply the effects to the color (as a single pixel)
+			QImage color(1, 1, QImage::Format_RGBA8888_Premultiplied);
+			std::copy(layer.layer.color, layer.layer.color + 4, color.bits());
+			if (!layer.operations.empty())
+				PixelKernels::Apply(color.bits(), 1, layer.operations);
+			painter.fillRect(QRect(0, 0, layer.layer.width, layer.layer.height), color.pixelColor(0, 0));
+		} else {
+			QImage image(layer.layer.pixels, layer.layer.width, layer.layer.height, layer.layer.bytes_per_line,
+						 QImage::Format_RGBA8888_Premultiplied);
+			if (!layer.operations.empty()) {
+				image = image.copy();
+				PixelKernels::Apply(image.bits(), int64_t(image.width()) * image.height(), layer.operations);
+			}
+			painter.drawImage(0, 0, image);
+		}
+	}
+	painter.end();
+}
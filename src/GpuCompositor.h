@@ -0,0 +1,143 @@
+/**
+ * @file
+ * @brief Header file for GpuCompositor class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_GPU_COMPOSITOR_H
+#define OPENSHOT_GPU_COMPOSITOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <vector>
+
+#include <QColor>
+#include <QImage>
+#include <QTransform>
+
+#include "PixelKernels.h"
+
+class QOffscreenSurface;
+class QOpenGLContext;
+class QOpenGLFramebufferObject;
+class QOpenGLShaderProgram;
+class QThread;
+
+namespace openshot {
+
+	/**
+	 * @brief This struct describes a layer of a timeline frame, which is transformed and composited on the GPU
+	 *
+	 * A clip whose image is composited by the GPU skips its transform (see Clip::GetLayerFrame), and its last
+	 * point-wise effects, which are applied by the compositor's shaders instead.
+	 */
+	struct GpuLayer
+	{
+		openshot::PixelLayer layer; ///< The pixels (or solid color) of the untransformed image
+		QTransform transform; ///< Maps the pixels of the image to the pixels of the canvas
+		bool transformed = false; ///< The transform of the clip is applied by the compositor (instead of its layer position)
+		bool smooth = true; ///< Filter the image when it is transformed (false for draft quality previews)
+		std::vector<openshot::PixelOperation> operations; ///< The point-wise effects applied to the image (in order)
+	};
+
+	/**
+	 * @brief This singleton class composites the layers of timeline frames with OpenGL
+	 *
+	 * Each layer is uploaded as a texture, and drawn onto a (multisampled) framebuffer the size of the frame:
+	 * the vertex shader applies the layer's transform, and the fragment shader applies the layer's point-wise
+	 * effects (Brightness, Saturation, Hue and Negate), and blends the premultiplied pixels. The composited
+	 * frame is read back once.
+	 *
+	 * The compositor renders on a thread of its own, with an offscreen OpenGL context. Qt only creates
+	 * offscreen surfaces on the GUI thread, so Initialize() must be called on the GUI thread of a
+	 * QGuiApplication (Timeline::Open() does, when Settings::GPU_COMPOSITING is enabled). Without a
+	 * QGuiApplication (or OpenGL), the compositor is not available, and the timeline composites on the CPU.
+	 *
+	 * \code
+	 * // On the GUI thread, before opening the timeline
+	 * Settings::Instance()->GPU_COMPOSITING = true;
+	 * timeline.Open();
+	 * \endcode
+	 */
+	class GpuCompositor {
+	private:
+		std::mutex jobMutex;
+		std::condition_variable jobs_changed;
+		std::deque<std::function<void()>> jobs;
+		std::atomic<bool> available;
+		bool initialized;
+
+		QOffscreenSurface *surface;
+		QOpenGLContext *context;
+		QOpenGLShaderProgram *program;
+		QOpenGLFramebufferObject *multisample_fbo;
+		QOpenGLFramebufferObject *resolve_fbo;
+		std::vector<unsigned int> textures; ///< A texture per layer (re-used for each frame)
+		std::vector<QSize> texture_sizes;
+
+		/// Private variable to keep track of singleton instance
+		static GpuCompositor *m_pInstance;
+
+		/// Default constructor
+		GpuCompositor();
+
+		/// Don't allow the user to copy or assign this instance
+		GpuCompositor(GpuCompositor const&) = delete;
+		GpuCompositor & operator=(GpuCompositor const&) = delete;
+
+		/// Run the jobs of the OpenGL thread (the context is current on this thread only)
+		void run_thread(QThread **gl_qthread, std::promise<void> *started);
+
+		/// Run a job on the OpenGL thread, and wait for it
+		void run_job(std::function<void()> job);
+
+		/// Compile the shaders (on the OpenGL thread)
+		bool create_program();
+
+		/// Upload the pixels of a layer to its texture (on the OpenGL thread)
+		void upload_layer(size_t index, const openshot::PixelLayer& layer);
+
+		/// Composite the layers onto the canvas (on the OpenGL thread)
+		bool composite(QImage& canvas, const QColor& background, const std::vector<openshot::GpuLayer>& layers);
+
+	public:
+		/// The number of point-wise effects the shaders apply to a layer (the effects before them are applied by the clip)
+		static const int MAX_OPERATIONS = 8;
+
+		/// Create or get an instance of this compositor singleton (invoke the class with this method)
+		static GpuCompositor *Instance();
+
+		/// @brief Create the OpenGL context and compile the shaders (only on the GUI thread of a QGuiApplication)
+		/// @returns true if the compositor is available
+		bool Initialize();
+
+		/// Is the compositor initialized (and working)
+		bool IsAvailable() const { return available; };
+
+		/// @brief Composite layers onto a canvas on the GPU
+		/// @returns false if the layers could not be composited (the canvas is unchanged)
+		/// @param canvas The premultiplied RGBA8888 canvas (i.e. the image of a timeline frame)
+		/// @param background The color of the canvas (or an invalid color to composite onto the canvas' pixels)
+		/// @param layers The layers (in order, the first layer is the bottom layer)
+		bool Composite(QImage& canvas, const QColor& background, const std::vector<openshot::GpuLayer>& layers);
+
+		/// @brief Composite layers onto a canvas on the CPU, with QPainter (when the GPU is not available)
+		/// @param canvas The premultiplied RGBA8888 canvas (i.e. the image of a timeline frame)
+		/// @param background The color of the canvas (or an invalid color to composite onto the canvas' pixels)
+		/// @param layers The layers (in order, the first layer is the bottom layer)
+		static void CompositeOnCpu(QImage& canvas, const QColor& background, const std::vector<openshot::GpuLayer>& layers);
+	};
+
+}
+
+#endif
@@ -0,0 +1,205 @@
+/**
+ * @file
+ * @brief Source file for HardwareDevices class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+#include "HardwareDevices.h"
+#include "Settings.h"
+
+using namespace openshot;
+
+// Global reference to the devices
+HardwareDevices *HardwareDevices::m_pInstance = nullptr;
+
+// Create or Get an instance of the devices singleton
+HardwareDevices *HardwareDevices::Instance()
+{
+	// Create the actual instance only once (readers are opened on many threads)
+	static std::once_flag created;
+	std::call_once(created, []() { m_pInstance = new HardwareDevices; });
+
+	return m_pInstance;
+}
+
+// Count the GPUs of the machine
+int HardwareDevices::detect_devices()
+{
+	int count = 0;
+#if defined(__linux__)
+	// Each GPU has a render node (/dev/dri/renderD128 is the first)
+	char node[64];
+	for (; count < 64; count++) {
+		snprintf(node, sizeof(node), "/dev/dri/renderD%d", count + 128);
+		if (access(node, F_OK) != 0)
+			break;
+	}
+#endif
+	return std::max(count, 1);
+}
+
+// Get the number of GPUs the sessions are spread over
+int HardwareDevices::DeviceCount()
+{
+	const int count = Settings::Instance()->HW_DEVICE_COUNT;
+	if (count > 0)
+		return count;
+
+	const std::lock_guard<std::mutex> lock(devicesMutex);
+	if (detected_devices < 0)
+		detected_devices = detect_devices();
+	return detected_devices;
+}
+
+// Acquire a session on a GPU
+int HardwareDevices::Acquire(HardwareSessionType type)
+{
+	Settings *settings = Settings::Instance();
+	const bool decode = (type == HARDWARE_DECODE_SESSION);
+	const int max_sessions = decode ? settings->HW_DE_MAX_SESSIONS : settings->HW_EN_MAX_SESSIONS;
+	const int count = DeviceCount();
+
+	const std::lock_guard<std::mutex> lock(devicesMutex);
+	std::vector<int>& sessions = decode ? decode_sessions : encode_sessions;
+	int& next_device = decode ? next_decode_device : next_encode_device;
+	if ((int) sessions.size() < count)
+		sessions.resize(count, 0);
+	auto has_room = [&](int device) { return max_sessions <= 0 || sessions[device] < max_sessions; };
+
+	int device = -1;
+	switch (settings->HW_DEVICE_POLICY) {
+		case 1:
+			// The next GPU in turn (skipping full GPUs)
+			for (int i = 0; i < count && device < 0; i++) {
+				if (has_room((next_device + i) % count))
+					device = (next_device + i) % count;
+			}
+			if (device >= 0)
+				next_device = (device + 1) % count;
+			break;
+		case 2:
+			// The GPU with the fewest sessions (the first one, if several have as few)
+			for (int candidate = 0; candidate < count; candidate++) {
+				if (has_room(candidate) && (device < 0 || sessions[candidate] < sessions[device]))
+					device = candidate;
+			}
+			break;
+		default:
+			// Always the same GPU
+			device = std::max(decode ? settings->HW_DE_DEVICE_SET : settings->HW_EN_DEVICE_SET, 0);
+			if ((int) sessions.size() <= device)
+				sessions.resize(device + 1, 0);
+			if (!has_room(device))
+				device = -1;
+			break;
+	}
+
+	if (device >= 0)
+		sessions[device]++;
+	return device;
+}
+
+// Release a session
+void HardwareDevices::Release(HardwareSessionType type, int device)
+{
+	if (device < 0)
+		return;
+
+	const std::lock_guard<std::mutex> lock(devicesMutex);
+	std::vector<int>& sessions = (type == HARDWARE_DECODE_SESSION) ? decode_sessions : encode_sessions;
+	if (device < (int) sessions.size() && sessions[device] > 0)
+		sessions[device]--;
+}
+
+// Get the number of sessions of a GPU
+int HardwareDevices::Sessions(HardwareSessionType type, int device)
+{
+	const std::lock_guard<std::mutex> lock(devicesMutex);
+	const std::vector<int>& sessions = (type == HARDWARE_DECODE_SESSION) ? decode_sessions : encode_sessions;
+	if (device < 0 || device >= (int) sessions.size())
+		return 0;
+	return sessions[device];
+}
+
+// Could a GPU decode a kind of stream (the last time it was tried)?
+int HardwareDevices::DecodeSupport(int device_type, int device, int codec_id, int profile, int width, int height)
+{
+	const std::lock_guard<std::mutex> lock(devicesMutex);
+	auto support = decode_support.find(DecodeCapability(device_type, device, codec_id, profile, width, height));
+	if (support == decode_support.end())
+		return -1;
+	return support->second ? 1 : 0;
+}
+
+// Remember whether a GPU could decode a kind of stream
+void HardwareDevices::SetDecodeSupport(int device_type, int device, int codec_id, int profile, int width, int height, bool supported)
+{
+	const std::lock_guard<std::mutex> lock(devicesMutex);
+	decode_support[DecodeCapability(device_type, device, codec_id, profile, width, height)] = supported;
+}
+
+// Forget which kinds of streams the GPUs could decode
+void HardwareDevices::ClearDecodeSupport()
+{
+	const std::lock_guard<std::mutex> lock(devicesMutex);
+	decode_support.clear();
+}
+
+#if USE_HW_ACCEL
+// Get a reference to the shared device context of a GPU
+AVBufferRef *HardwareDevices::DeviceContext(AVHWDeviceType type, int device)
+{
+	const std::lock_guard<std::mutex> lock(devicesMutex);
+
+	// Create the device context the first time (a failure is remembered too, so it's not tried by every reader)
+	auto context = device_contexts.find(std::make_pair(int(type), device));
+	if (context == device_contexts.end()) {
+		const std::string adapter = DeviceName(type, device);
+		AVBufferRef *created = NULL;
+		if (av_hwdevice_ctx_create(&created, type, adapter.empty() ? NULL : adapter.c_str(), NULL, 0) < 0)
+			created = NULL;
+		context = device_contexts.emplace(std::make_pair(int(type), device), created).first;
+	}
+
+	return context->second ? av_buffer_ref(context->second) : NULL;
+}
+
+// Get the name of a GPU, as av_hwdevice_ctx_create() expects it
+std::string HardwareDevices::DeviceName(AVHWDeviceType type, int device)
+{
+	switch (type) {
+		case AV_HWDEVICE_TYPE_CUDA:
+			// CUDA devices are numbered (a render node would always open the first GPU)
+			return std::to_string(device);
+#if defined(_WIN32)
+		case AV_HWDEVICE_TYPE_DXVA2:
+		case AV_HWDEVICE_TYPE_D3D11VA:
+			// Adapters are numbered
+			return std::to_string(device);
+#endif
+		default:
+			break;
+	}
+
+#if defined(__linux__)
+	// The render node of the GPU (if it's there, and writable)
+	char node[64];
+	snprintf(node, sizeof(node), "/dev/dri/renderD%d", device + 128);
+	if (access(node, W_OK) == 0)
+		return node;
+#endif
+	return "";
+}
+#endif // USE_HW_ACCEL
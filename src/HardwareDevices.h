@@ -0,0 +1,137 @@
+/**
+ * @file
+ * @brief Header file for HardwareDevices class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_HARDWARE_DEVICES_H
+#define OPENSHOT_HARDWARE_DEVICES_H
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "FFmpegUtilities.h"
+
+namespace openshot {
+
+	/// The kind of a hardware session (GPUs decode and encode on separate engines, with separate limits)
+	enum HardwareSessionType {
+		HARDWARE_DECODE_SESSION, ///< A hardware video decoder (of an FFmpegReader)
+		HARDWARE_ENCODE_SESSION ///< A hardware video encoder (of an FFmpegWriter)
+	};
+
+	/**
+	 * @brief This singleton class assigns the hardware decoders and encoders to the GPUs of the machine
+	 *
+	 * Each FFmpegReader (and FFmpegWriter) which opens a hardware decoder (or encoder) acquires a session on
+	 * one of the GPUs, and releases it when its decoder (or encoder) is freed. The GPU is chosen by
+	 * Settings::HW_DEVICE_POLICY: always the GPU of Settings::HW_DE_DEVICE_SET (or HW_EN_DEVICE_SET), the
+	 * next GPU in turn, or the GPU with the fewest sessions. A GPU has at most Settings::HW_DE_MAX_SESSIONS
+	 * decode (or HW_EN_MAX_SESSIONS encode) sessions. When every GPU is full, no session is acquired, and
+	 * the reader (or writer) decodes (or encodes) in software instead.
+	 *
+	 * Opening hardware decoders for many clips is made cheaper by sharing one device context per GPU (see
+	 * DeviceContext()), and by remembering whether the GPU could decode a kind of stream (its codec, profile
+	 * and size, see DecodeSupport()), so the next readers of such streams skip the frame constraint checks,
+	 * or go straight to software decoding, instead of opening (and closing) a hardware decoder again.
+	 *
+	 * \code
+	 * // Spread the decoders of all readers over the GPUs, with up to 8 decoders per GPU
+	 * Settings::Instance()->HARDWARE_DECODER = 2;
+	 * Settings::Instance()->HW_DEVICE_POLICY = 2;
+	 * Settings::Instance()->HW_DE_MAX_SESSIONS = 8;
+	 * \endcode
+	 */
+	class HardwareDevices {
+	private:
+		/// A kind of stream on a GPU (device type, GPU, codec, profile, width, height)
+		typedef std::tuple<int, int, int, int, int, int> DecodeCapability;
+
+		std::mutex devicesMutex;
+		std::map<DecodeCapability, bool> decode_support; ///< Which kinds of streams each GPU could decode
+#if USE_HW_ACCEL
+		std::map<std::pair<int, int>, AVBufferRef *> device_contexts; ///< The shared device context of each GPU (by device type)
+#endif
+		std::vector<int> decode_sessions; ///< The number of decode sessions of each GPU
+		std::vector<int> encode_sessions; ///< The number of encode sessions of each GPU
+		int next_decode_device; ///< The next GPU in turn for a decode session (round-robin policy)
+		int next_encode_device; ///< The next GPU in turn for an encode session (round-robin policy)
+		int detected_devices; ///< The number of GPUs found (or -1 before they are counted)
+
+		/// Private variable to keep track of singleton instance
+		static HardwareDevices *m_pInstance;
+
+		/// Default constructor
+		HardwareDevices() : next_decode_device(0), next_encode_device(0), detected_devices(-1) {};
+
+		/// Don't allow the user to copy or assign this instance
+		HardwareDevices(HardwareDevices const&) = delete;
+		HardwareDevices & operator=(HardwareDevices const&) = delete;
+
+		/// Count the GPUs of the machine (the render nodes on Linux, otherwise 1)
+		static int detect_devices();
+
+	public:
+		/// Create or get an instance of this singleton (invoke the class with this method)
+		static HardwareDevices *Instance();
+
+		/// @brief Acquire a session on a GPU (see Settings::HW_DEVICE_POLICY)
+		/// @returns The number of the GPU (0 is the first), or -1 if every GPU has reached its session limit
+		/// @param type The kind of session
+		int Acquire(HardwareSessionType type);
+
+		/// @brief Release a session acquired with Acquire()
+		/// @param type The kind of session
+		/// @param device The number of the GPU (or -1, which is ignored)
+		void Release(HardwareSessionType type, int device);
+
+		/// Get the number of GPUs the sessions are spread over (Settings::HW_DEVICE_COUNT, or the GPUs found)
+		int DeviceCount();
+
+		/// Get the number of sessions of a GPU
+		int Sessions(HardwareSessionType type, int device);
+
+		/// @brief Could a GPU decode a kind of stream, the last time it was tried?
+		/// @returns 1 if it could, 0 if it couldn't (i.e. too large), or -1 if it was not tried yet
+		/// @param device_type The type of the hardware device (AVHWDeviceType)
+		/// @param device The number of the GPU (0 is the first)
+		/// @param codec_id The codec of the stream (AVCodecID)
+		/// @param profile The profile of the codec
+		/// @param width The width of the stream
+		/// @param height The height of the stream
+		int DecodeSupport(int device_type, int device, int codec_id, int profile, int width, int height);
+
+		/// Remember whether a GPU could decode a kind of stream (see DecodeSupport())
+		void SetDecodeSupport(int device_type, int device, int codec_id, int profile, int width, int height, bool supported);
+
+		/// Forget which kinds of streams the GPUs could decode (i.e. after changing Settings::DE_LIMIT_WIDTH_MAX)
+		void ClearDecodeSupport();
+
+#if USE_HW_ACCEL
+		/// @brief Get a reference to the device context of a GPU, which is shared by all hardware decoders
+		/// (it is created by the first one). Free the reference with av_buffer_unref().
+		/// @returns A new reference, or NULL if the device could not be created
+		/// @param type The type of the hardware device
+		/// @param device The number of the GPU (0 is the first)
+		AVBufferRef *DeviceContext(AVHWDeviceType type, int device);
+
+		/// @brief Get the name of a GPU, as av_hwdevice_ctx_create() expects it for a type of device
+		/// @returns The name, or an empty string to open the default device
+		/// @param type The type of the hardware device
+		/// @param device The number of the GPU (0 is the first)
+		static std::string DeviceName(AVHWDeviceType type, int device);
+#endif
+	};
+
+}
+
+#endif
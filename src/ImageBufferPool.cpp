@@ -0,0 +1,170 @@
+/**
+ * @file
+ * @brief Source file for ImageBufferPool class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <iterator>
+
+#include "ImageBufferPool.h"
+#include "Settings.h"
+#include "ThreadAffinity.h"
+
+using namespace openshot;
+
+// Each buffer starts with a small header (which holds its size, and the NUMA node it was allocated on).
+// The header is 64 bytes, to keep the pixel data as aligned as the allocation itself.
+static const int64_t BUFFER_HEADER_SIZE = 64;
+
+// Global reference to the pool
+ImageBufferPool *ImageBufferPool::m_pInstance = nullptr;
+
+// Default constructor (default to 256 MB of idle buffers)
+ImageBufferPool::ImageBufferPool() : idle_bytes(0), max_bytes(256 * 1024 * 1024) { }
+
+// Create or Get an instance of the pool singleton
+ImageBufferPool *ImageBufferPool::Instance()
+{
+	// Create the actual instance of the pool only once (frames are rendered on many threads)
+	static std::once_flag created;
+	std::call_once(created, []() { m_pInstance = new ImageBufferPool; });
+
+	return m_pInstance;
+}
+
+// Allocate a new buffer (which remembers its own size, and node)
+uint8_t *ImageBufferPool::AllocateBuffer(int64_t bytes, int node) {
+	uint8_t *raw_buffer = new uint8_t[BUFFER_HEADER_SIZE + bytes];
+	*reinterpret_cast<int64_t *>(raw_buffer) = bytes;
+	*reinterpret_cast<int32_t *>(raw_buffer + sizeof(int64_t)) = node;
+	return raw_buffer + BUFFER_HEADER_SIZE;
+}
+
+// Free a buffer (allocated with AllocateBuffer)
+void ImageBufferPool::FreeBuffer(uint8_t *buffer) {
+	delete[] (buffer - BUFFER_HEADER_SIZE);
+}
+
+// Get the size of a buffer (allocated with AllocateBuffer)
+int64_t ImageBufferPool::BufferSize(uint8_t *buffer) {
+	return *reinterpret_cast<int64_t *>(buffer - BUFFER_HEADER_SIZE);
+}
+
+// Get the NUMA node of a buffer (allocated with AllocateBuffer)
+int ImageBufferPool::BufferNode(uint8_t *buffer) {
+	return *reinterpret_cast<int32_t *>(buffer - BUFFER_HEADER_SIZE + sizeof(int64_t));
+}
+
+// Get a buffer with room for a specific number of bytes
+uint8_t *ImageBufferPool::Acquire(int64_t bytes) {
+	// The NUMA node of the caller (if buffers are kept apart by node, see Settings::NUMA_LOCAL_BUFFERS)
+	const bool node_local = Settings::Instance()->NUMA_LOCAL_BUFFERS;
+	const int node = node_local ? ThreadAffinity::CurrentNode() : 0;
+	{
+		const std::lock_guard<std::recursive_mutex> lock(poolMutex);
+
+		// Re-use an idle buffer of the same size (if any), allocated on the same node
+		auto idle = idle_buffers.find(bytes);
+		if (idle != idle_buffers.end()) {
+			std::vector<uint8_t *>& buffers = idle->second;
+			for (auto it = buffers.rbegin(); it != buffers.rend(); ++it) {
+				if (node_local && BufferNode(*it) != node)
+					continue;
+				uint8_t *buffer = *it;
+				*it = buffers.back();
+				buffers.pop_back();
+				idle_bytes -= bytes;
+				return buffer;
+			}
+		}
+	}
+
+	// Allocate a new buffer (outside the lock)
+	return AllocateBuffer(bytes, node);
+}
+
+// Return a buffer (from Acquire) to the pool
+void ImageBufferPool::Release(uint8_t *buffer) {
+	if (!buffer)
+		return;
+
+	int64_t bytes = BufferSize(buffer);
+	{
+		const std::lock_guard<std::recursive_mutex> lock(poolMutex);
+
+		// Keep this buffer (if the pool has room for it)
+		if (idle_bytes + bytes <= max_bytes) {
+			idle_buffers[bytes].push_back(buffer);
+			idle_bytes += bytes;
+			return;
+		}
+	}
+
+	// Pool is full, free buffer
+	FreeBuffer(buffer);
+}
+
+// QImageCleanupFunction which returns a buffer to the pool
+void ImageBufferPool::ReleaseImageBuffer(void *info) {
+	Instance()->Release(reinterpret_cast<uint8_t *>(info));
+}
+
+// Create a QImage which uses a pooled buffer
+std::shared_ptr<QImage> ImageBufferPool::CreateImage(int width, int height, QImage::Format format) {
+	// Each scanline must be 32-bit aligned
+	int bits_per_pixel = QImage::toPixelFormat(format).bitsPerPixel();
+	int bytes_per_line = ((width * bits_per_pixel + 31) / 32) * 4;
+
+	// The buffer returns to the pool when the last copy of this QImage is deleted
+	uint8_t *buffer = Acquire(int64_t(bytes_per_line) * height);
+	return std::make_shared<QImage>(buffer, width, height, bytes_per_line, format,
+									(QImageCleanupFunction) &ImageBufferPool::ReleaseImageBuffer, (void *) buffer);
+}
+
+// Free all idle buffers
+void ImageBufferPool::Clear() {
+	const std::lock_guard<std::recursive_mutex> lock(poolMutex);
+
+	for (auto& idle : idle_buffers) {
+		for (uint8_t *buffer : idle.second)
+			FreeBuffer(buffer);
+	}
+	idle_buffers.clear();
+	idle_bytes = 0;
+}
+
+// Get the total size of all idle buffers
+int64_t ImageBufferPool::GetIdleBytes() {
+	const std::lock_guard<std::recursive_mutex> lock(poolMutex);
+	return idle_bytes;
+}
+
+// Get the max size of all idle buffers
+int64_t ImageBufferPool::GetMaxBytes() {
+	const std::lock_guard<std::recursive_mutex> lock(poolMutex);
+	return max_bytes;
+}
+
+// Set the max size of all idle buffers (0 disables pooling)
+void ImageBufferPool::SetMaxBytes(int64_t number_of_bytes) {
+	const std::lock_guard<std::recursive_mutex> lock(poolMutex);
+	max_bytes = number_of_bytes;
+
+	// Free idle buffers until they fit (largest sizes first)
+	while (idle_bytes > max_bytes && !idle_buffers.empty()) {
+		auto largest = std::prev(idle_buffers.end());
+		if (largest->second.empty()) {
+			idle_buffers.erase(largest);
+			continue;
+		}
+		FreeBuffer(largest->second.back());
+		largest->second.pop_back();
+		idle_bytes -= largest->first;
+	}
+}
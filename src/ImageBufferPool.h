@@ -0,0 +1,108 @@
+/**
+ * @file
+ * @brief Header file for ImageBufferPool class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_IMAGE_BUFFER_POOL_H
+#define OPENSHOT_IMAGE_BUFFER_POOL_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <QImage>
+
+namespace openshot {
+
+	/**
+	 * @brief This singleton class re-uses the pixel buffers of QImage objects
+	 *
+	 * Rendering a frame allocates many full-size images (blank timeline frames, clip canvases,
+	 * decoded video frames, etc...). Instead of freeing each buffer when its QImage is deleted,
+	 * the buffer is returned to this pool (grouped by size), and handed out again for the next
+	 * image of the same size. Only up to GetMaxBytes() of idle buffers are kept around. With
+	 * Settings::NUMA_LOCAL_BUFFERS, a buffer is only handed out again on the NUMA node it was
+	 * allocated on.
+	 *
+	 * \code
+	 * // Create a pooled image (the buffer returns to the pool when the last copy of the QImage is deleted)
+	 * std::shared_ptr<QImage> image = ImageBufferPool::Instance()->CreateImage(1920, 1080, QImage::Format_RGBA8888_Premultiplied);
+	 * \endcode
+	 */
+	class ImageBufferPool {
+	private:
+		std::recursive_mutex poolMutex;
+		std::map<int64_t, std::vector<uint8_t *>> idle_buffers; ///< Idle buffers (grouped by size in bytes)
+		int64_t idle_bytes; ///< Total size of all idle buffers
+		int64_t max_bytes; ///< Max size of all idle buffers (larger buffers are freed instead)
+
+		/// Private variable to keep track of singleton instance
+		static ImageBufferPool *m_pInstance;
+
+		/// Default constructor
+		ImageBufferPool();
+
+		/// Don't allow the user to copy or assign this instance
+		ImageBufferPool(ImageBufferPool const&) = delete;
+		ImageBufferPool & operator=(ImageBufferPool const&) = delete;
+
+		/// Allocate a new buffer (which remembers its own size, and the NUMA node of the caller)
+		static uint8_t *AllocateBuffer(int64_t bytes, int node);
+
+		/// Free a buffer (allocated with AllocateBuffer)
+		static void FreeBuffer(uint8_t *buffer);
+
+		/// Get the size of a buffer (allocated with AllocateBuffer)
+		static int64_t BufferSize(uint8_t *buffer);
+
+		/// Get the NUMA node of a buffer (allocated with AllocateBuffer)
+		static int BufferNode(uint8_t *buffer);
+
+	public:
+		/// Create or get an instance of this pool singleton (invoke the class with this method)
+		static ImageBufferPool *Instance();
+
+		/// @brief Get a buffer with room for a specific number of bytes (the content is not initialized)
+		/// @param bytes The number of bytes needed
+		uint8_t *Acquire(int64_t bytes);
+
+		/// @brief Return a buffer (from Acquire) to the pool
+		/// @param buffer The buffer to re-use (or free, if the pool is full)
+		void Release(uint8_t *buffer);
+
+		/// @brief QImageCleanupFunction which returns a buffer (from Acquire) to the pool
+		/// @param info The buffer (passed as the cleanupInfo of the QImage)
+		static void ReleaseImageBuffer(void *info);
+
+		/// @brief Create a QImage which uses a pooled buffer (the content is not initialized)
+		/// @param width The width of the image
+		/// @param height The height of the image
+		/// @param format The format of the image (i.e. QImage::Format_RGBA8888_Premultiplied)
+		std::shared_ptr<QImage> CreateImage(int width, int height, QImage::Format format);
+
+		/// Free all idle buffers
+		void Clear();
+
+		/// Get the total size of all idle buffers (in bytes)
+		int64_t GetIdleBytes();
+
+		/// Get the max size of all idle buffers (in bytes)
+		int64_t GetMaxBytes();
+
+		/// @brief Set the max size of all idle buffers (in bytes). Set to 0 to disable pooling.
+		/// @param number_of_bytes The max number of bytes of idle buffers to keep
+		void SetMaxBytes(int64_t number_of_bytes);
+	};
+
+}
+
+#endif
@@ -75,6 +75,9 @@ void ImageReader::Open()
 		dar.Reduce();
 		info.display_ratio = dar;
 
+		// Convert the image once (every frame shares the converted pixels)
+		cached_image = openshot::Magick2QImage(image);
+
 		// Mark as "open"
 		is_open = true;
 	}
@@ -87,6 +90,7 @@ void ImageReader::Close()
 		is_open = false;
 		// Delete the image
 		image.reset();
+		cached_image.reset();
 	}
 }
 
@@ -102,12 +106,11 @@ std::shared_ptr<Frame> ImageReader::GetFrame(int64_t requested_frame)
 	// Create or get frame object
 	auto image_frame = std::make_shared<Frame>(
 		requested_frame,
-		image->size().width(), image->size().height(),
+		cached_image->width(), cached_image->height(),
 		"#000000", 0, 2);
 
-	// Add Image data to frame
-	auto qimage = openshot::Magick2QImage(image);
-	image_frame->AddImage(qimage);
+	// Add Image data to frame (shared with the other frames, without copying it)
+	image_frame->AddImage(cached_image);
 	return image_frame;
 }
 
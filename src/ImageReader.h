@@ -23,6 +23,7 @@
 #include "Json.h"
 
 // Forward decls
+class QImage;
 namespace Magick {
     class Image;
 }
@@ -57,6 +58,7 @@ namespace openshot
 	private:
 		std::string path;
 		std::shared_ptr<Magick::Image> image;
+		std::shared_ptr<QImage> cached_image; ///< The image converted for frames (once, when opened)
 		bool is_open;
 
 	public:
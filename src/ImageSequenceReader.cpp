@@ -0,0 +1,405 @@
+/**
+ * @file
+ * @brief Source file for ImageSequenceReader class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "ImageSequenceReader.h"
+
+#include "Clip.h"
+#include "Exceptions.h"
+#include "Frame.h"
+#include "PixelKernels.h"
+#include "RenderTrace.h"
+#include "Settings.h"
+#include "Timeline.h"
+
+#include <algorithm>
+#include <map>
+
+#include <QBuffer>
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageReader>
+
+using namespace openshot;
+
+ImageSequenceReader::ImageSequenceReader(std::string path, Fraction fps, bool inspect_reader)
+	: path(path), is_open(false), prefetch_frames(8), stopping(false), last_requested_frame(0)
+{
+	info.fps = fps;
+
+	// Open and Close the reader, to populate its attributes (such as height, width, etc...)
+	if (inspect_reader) {
+		Open();
+		Close();
+	}
+}
+
+ImageSequenceReader::~ImageSequenceReader()
+{
+	Close();
+}
+
+// Find the files which match the pattern (sorted by their number)
+std::vector<std::string> ImageSequenceReader::find_files() const
+{
+	QFileInfo pattern_info(QString::fromStdString(path));
+	const QString pattern = pattern_info.fileName();
+
+	// Split the pattern around its number (i.e. "shot.%04d.png" is "shot." + number + ".png")
+	const int percent = pattern.indexOf('%');
+	const int conversion = pattern.indexOf('d', percent);
+	if (percent < 0 || conversion < 0)
+		return {};
+	const QString prefix = pattern.left(percent);
+	const QString suffix = pattern.mid(conversion + 1);
+
+	// Find the files (ordered by their number)
+	std::map<int64_t, std::string> numbered_files;
+	QDir folder = pattern_info.dir();
+	for (const QString& name : folder.entryList(QStringList(prefix + "*" + suffix), QDir::Files)) {
+		const QString digits = name.mid(prefix.length(), name.length() - prefix.length() - suffix.length());
+		bool is_number = !digits.isEmpty();
+		for (const QChar& digit : digits)
+			is_number = is_number && digit.isDigit();
+		if (is_number)
+			numbered_files[digits.toLongLong()] = folder.filePath(name).toStdString();
+	}
+
+	std::vector<std::string> sequence_files;
+	sequence_files.reserve(numbered_files.size());
+	for (const auto& file : numbered_files)
+		sequence_files.push_back(file.second);
+	return sequence_files;
+}
+
+// Open the sequence
+void ImageSequenceReader::Open()
+{
+	// Open reader if not already open
+	if (!is_open)
+	{
+		files = find_files();
+		if (files.empty())
+			throw InvalidFile("No files match the image sequence.", path);
+
+		// Inspect the first file (without decoding it, if the format has a header)
+		QImageReader first_reader(QString::fromStdString(files.front()));
+		first_reader.setAutoTransform(true);
+		QSize size = first_reader.size();
+		if (!size.isValid()) {
+			QImage image;
+			if (!first_reader.read(&image))
+				throw InvalidFile("File could not be opened.", files.front());
+			size = image.size();
+		}
+
+		// Update image properties
+		info.has_audio = false;
+		info.has_video = true;
+		info.has_single_image = false;
+		info.file_size = QFileInfo(QString::fromStdString(files.front())).size() * int64_t(files.size());
+		info.vcodec = first_reader.format().toStdString();
+		info.width = size.width();
+		info.height = size.height();
+		info.pixel_ratio.num = 1;
+		info.pixel_ratio.den = 1;
+		if (info.fps.num <= 0 || info.fps.den <= 0)
+			info.fps = Fraction(25, 1);
+		info.video_timebase = info.fps.Reciprocal();
+		info.video_length = files.size();
+		info.duration = info.video_length / info.fps.ToDouble();
+
+		// Calculate the DAR (display aspect ratio)
+		Fraction display_size(info.width * info.pixel_ratio.num, info.height * info.pixel_ratio.den);
+
+		// Reduce size fraction
+		display_size.Reduce();
+
+		// Set the ratio based on the reduced fraction
+		info.display_ratio.num = display_size.num;
+		info.display_ratio.den = display_size.den;
+
+		// Cache the frames decoded ahead (and some recently requested frames)
+		final_cache.SetMaxBytesFromInfo(prefetch_frames * 2 + 8, info.width, info.height, info.sample_rate, info.channels);
+		max_size = QSize();
+		last_requested_frame = 0;
+
+		// Start the decoding threads
+		stopping = false;
+		const int threads = std::max(1, std::min(Settings::Instance()->OMP_THREADS, int(std::thread::hardware_concurrency())));
+		for (int thread = 0; thread < threads; thread++)
+			workers.emplace_back(&ImageSequenceReader::decode_worker, this);
+
+		// Mark as "open"
+		is_open = true;
+	}
+}
+
+// Close the sequence
+void ImageSequenceReader::Close()
+{
+	// Close all objects, if reader is 'open'
+	if (is_open)
+	{
+		// Stop the decoding threads
+		{
+			const std::lock_guard<std::mutex> lock(decodeMutex);
+			stopping = true;
+			decode_queue.clear();
+		}
+		decodeChanged.notify_all();
+		for (auto& worker : workers)
+			worker.join();
+		workers.clear();
+		decoding.clear();
+
+		// Forget the decoded frames
+		final_cache.Clear();
+
+		// Mark as "closed"
+		is_open = false;
+	}
+}
+
+// Decode the file of a frame, and scale it (to fit the size)
+std::shared_ptr<Frame> ImageSequenceReader::decode_frame(int64_t number, QSize size)
+{
+	const std::string& file_path = files[number - 1];
+	QFile file(QString::fromStdString(file_path));
+	if (!file.open(QIODevice::ReadOnly))
+		throw InvalidFile("File could not be opened.", file_path);
+
+	// Memory-map the file (so it is decoded without copying it), or read it (if it can't be mapped)
+	uchar *mapped = file.map(0, file.size());
+	QByteArray bytes = mapped ? QByteArray::fromRawData((const char *) mapped, file.size()) : file.readAll();
+	QBuffer buffer(&bytes);
+	buffer.open(QIODevice::ReadOnly);
+
+	// Decode the image (formats which can be decoded smaller, i.e. JPEG, are, and others are scaled after decoding)
+	QImageReader image_reader(&buffer);
+	image_reader.setAutoTransform(true);
+	const QSize image_size = image_reader.size();
+	if (image_size.isValid() && size.isValid() && (image_size.width() > size.width() || image_size.height() > size.height()))
+		image_reader.setScaledSize(image_size.scaled(size, Qt::KeepAspectRatio));
+	QImage image;
+	if (!image_reader.read(&image))
+		throw InvalidFile("File could not be decoded.", file_path);
+	PixelKernels::ToPremultipliedRGBA(image);
+	auto frame_image = std::make_shared<QImage>(image);
+
+	// Create frame object
+	auto sample_count = Frame::GetSamplesPerFrame(number, info.fps, info.sample_rate, info.channels);
+	auto image_frame = std::make_shared<Frame>(
+			number, frame_image->width(), frame_image->height(), "#000000",
+			sample_count, info.channels);
+	image_frame->AddImage(frame_image);
+	return image_frame;
+}
+
+// Decode the queued frames
+void ImageSequenceReader::decode_worker()
+{
+	RenderTrace::Instance()->SetThreadName("ImageSequenceReader decoder");
+	while (true) {
+		int64_t number;
+		QSize size;
+		{
+			std::unique_lock<std::mutex> lock(decodeMutex);
+			decodeChanged.wait(lock, [this]() { return stopping || !decode_queue.empty(); });
+			if (stopping)
+				return;
+			number = decode_queue.front();
+			decode_queue.pop_front();
+			size = max_size;
+			decoding.insert(number);
+		}
+
+		// Decode the frame (errors are thrown when the frame is requested, and decoded again)
+		std::shared_ptr<Frame> frame;
+		try {
+			RenderTraceSpan span("ImageSequenceReader::decode_frame", "decode");
+			frame = decode_frame(number, size);
+		} catch (const ExceptionBase&) { }
+
+		{
+			// Keep the frame (unless the needed size changed meanwhile)
+			const std::lock_guard<std::mutex> lock(decodeMutex);
+			if (frame && size == max_size)
+				final_cache.Add(frame);
+			decoding.erase(number);
+		}
+		decodeChanged.notify_all();
+	}
+}
+
+// Queue the frames after (or before) the requested frame, which are not cached yet
+void ImageSequenceReader::queue_prefetch(int64_t requested_frame)
+{
+	// Read backwards (i.e. reverse playback) decodes the previous frames
+	const int direction = (requested_frame < last_requested_frame) ? -1 : 1;
+	last_requested_frame = requested_frame;
+
+	// The new window replaces the frames queued for the previous request
+	decode_queue.clear();
+	for (int64_t offset = 1; offset <= prefetch_frames; offset++) {
+		const int64_t number = requested_frame + offset * direction;
+		if (number < 1 || number > int64_t(files.size()))
+			break;
+		if (!decoding.count(number) && !final_cache.Contains(number))
+			decode_queue.push_back(number);
+	}
+}
+
+// Get an openshot::Frame object for a specific frame number of this reader.
+std::shared_ptr<Frame> ImageSequenceReader::GetFrame(int64_t requested_frame)
+{
+	// Check for open reader (or throw exception)
+	if (!is_open)
+		throw ReaderClosed("The image sequence is closed.  Call Open() before calling this method.", path);
+
+	// Adjust out of bounds frame number
+	requested_frame = std::min(std::max(requested_frame, int64_t(1)), int64_t(files.size()));
+
+	// Calculate max image size
+	const QSize size = calculate_max_size();
+
+	std::shared_ptr<Frame> frame;
+	{
+		std::unique_lock<std::mutex> lock(decodeMutex);
+		if (size != max_size) {
+			// The cached frames have the wrong size
+			final_cache.Clear();
+			decode_queue.clear();
+			max_size = size;
+		}
+
+		// Wait for a worker which is decoding this frame
+		decodeChanged.wait(lock, [this, requested_frame]() { return !decoding.count(requested_frame); });
+		frame = final_cache.GetFrame(requested_frame);
+
+		// Decode the next frames
+		queue_prefetch(requested_frame);
+	}
+	decodeChanged.notify_all();
+
+	if (!frame) {
+		// Decode the frame on this thread (which is faster than waiting for the queued frames)
+		frame = decode_frame(requested_frame, size);
+		const std::lock_guard<std::mutex> lock(decodeMutex);
+		if (size == max_size)
+			final_cache.Add(frame);
+	}
+
+	// return frame object
+	return frame;
+}
+
+// Calculate the max size of the images, based on parent timeline and parent clip settings
+QSize ImageSequenceReader::calculate_max_size() {
+	// Get max project size
+	int max_width = info.width;
+	int max_height = info.height;
+
+	Clip* parent = (Clip*) ParentClip();
+	if (parent) {
+		if (parent->ParentTimeline()) {
+			// Set max width/height based on parent clip's timeline (if attached to a timeline)
+			max_width = parent->ParentTimeline()->preview_width;
+			max_height = parent->ParentTimeline()->preview_height;
+		}
+		if (parent->scale == SCALE_FIT || parent->scale == SCALE_STRETCH || parent->scale == SCALE_CROP) {
+			// Scale to the max timeline size * scaling keyframes (cropped images fill the whole size)
+			float max_scale_x = parent->scale_x.GetMaxPoint().co.Y;
+			float max_scale_y = parent->scale_y.GetMaxPoint().co.Y;
+			max_width = std::max(float(max_width), max_width * max_scale_x);
+			max_height = std::max(float(max_height), max_height * max_scale_y);
+			if (parent->scale == SCALE_CROP) {
+				QSize crop_size = QSize(info.width, info.height).scaled(max_width, max_height, Qt::KeepAspectRatioByExpanding);
+				max_width = crop_size.width();
+				max_height = crop_size.height();
+			}
+		} else if (parent->scale == SCALE_NONE) {
+			// Scale images to equivalent unscaled size
+			float preview_ratio = 1.0;
+			if (parent->ParentTimeline()) {
+				Timeline *t = (Timeline *) parent->ParentTimeline();
+				preview_ratio = t->preview_width / float(t->info.width);
+			}
+			float max_scale_x = parent->scale_x.GetMaxPoint().co.Y;
+			float max_scale_y = parent->scale_y.GetMaxPoint().co.Y;
+			max_width = info.width * max_scale_x * preview_ratio;
+			max_height = info.height * max_scale_y * preview_ratio;
+		}
+	}
+
+	// Never scale images up
+	return QSize(std::min(max_width, info.width), std::min(max_height, info.height));
+}
+
+// Generate JSON string of this object
+std::string ImageSequenceReader::Json() const {
+
+	// Return formatted string
+	return JsonValue().toStyledString();
+}
+
+// Generate Json::Value for this object
+Json::Value ImageSequenceReader::JsonValue() const {
+
+	// Create root json object
+	Json::Value root = ReaderBase::JsonValue(); // get parent properties
+	root["type"] = "ImageSequenceReader";
+	root["path"] = path;
+	root["prefetch_frames"] = prefetch_frames;
+
+	// return JsonValue
+	return root;
+}
+
+// Load JSON string into this object
+void ImageSequenceReader::SetJson(const std::string value) {
+
+	// Parse JSON string into JSON objects
+	try
+	{
+		const Json::Value root = openshot::stringToJson(value);
+		// Set all values that match
+		SetJsonValue(root);
+	}
+	catch (const std::exception& e)
+	{
+		// Error parsing JSON (or missing keys)
+		throw InvalidJSON("JSON is invalid (missing keys or invalid data types)");
+	}
+}
+
+// Load Json::Value into this object
+void ImageSequenceReader::SetJsonValue(const Json::Value root) {
+
+	// Set parent data
+	ReaderBase::SetJsonValue(root);
+
+	// Set data from Json (if key is found)
+	if (!root["path"].isNull())
+		path = root["path"].asString();
+	if (!root["prefetch_frames"].isNull())
+		SetPrefetchFrames(root["prefetch_frames"].asInt());
+
+	// Re-Open path, and re-init everything (if needed)
+	if (is_open)
+	{
+		Close();
+		Open();
+	}
+}
@@ -0,0 +1,143 @@
+/**
+ * @file
+ * @brief Header file for ImageSequenceReader class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_IMAGE_SEQUENCE_READER_H
+#define OPENSHOT_IMAGE_SEQUENCE_READER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <QSize>
+
+#include "CacheMemory.h"
+#include "Fraction.h"
+#include "ReaderBase.h"
+#include "Json.h"
+
+namespace openshot
+{
+	// Forward decl
+	class CacheBase;
+	class Frame;
+
+	/**
+	 * @brief This class reads a sequence of image files (i.e. the frames of a VFX plate), and decodes the
+	 * frames ahead of the requested frame in parallel.
+	 *
+	 * The path is a printf-style pattern of the file names (i.e. "/plates/shot010.%04d.png"). Every file
+	 * in the folder which matches the pattern is a frame, in the order of their numbers (the first file is
+	 * frame 1, and gaps in the numbering are skipped). Each file is memory-mapped and decoded by Qt (so any
+	 * format with a Qt image plugin is supported, i.e. PNG, JPEG, TIFF, or EXR with KImageFormats), and
+	 * scaled to the size needed by the parent clip and timeline.
+	 *
+	 * Since each file is independent, the frames after (or before, when reading backwards) the requested
+	 * frame are decoded by several threads at once, and cached (at the scaled size).
+	 *
+	 * @code
+	 * // Create a reader for an image sequence (at 24 fps)
+	 * ImageSequenceReader r("/plates/shot010.%04d.png", Fraction(24, 1));
+	 * r.Open(); // Open the reader
+	 *
+	 * // Get frame number 1 (the first file of the sequence)
+	 * std::shared_ptr<Frame> f = r.GetFrame(1);
+	 *
+	 * // Close the reader
+	 * r.Close();
+	 * @endcode
+	 */
+	class ImageSequenceReader : public ReaderBase
+	{
+	private:
+		std::string path; ///< The pattern of the file names
+		std::vector<std::string> files; ///< The file of each frame (frame 1 is the first file)
+		bool is_open;
+		int prefetch_frames;
+		CacheMemory final_cache; ///< The decoded (and scaled) frames
+		QSize max_size; ///< The size of the cached frames
+
+		// Decode ahead (workers decode the queued frames in parallel)
+		std::vector<std::thread> workers;
+		std::mutex decodeMutex;
+		std::condition_variable decodeChanged;
+		std::deque<int64_t> decode_queue; ///< Frames waiting to be decoded ahead
+		std::set<int64_t> decoding; ///< Frames being decoded by a worker
+		bool stopping;
+		int64_t last_requested_frame;
+
+		/// Find the files which match the pattern (sorted by their number)
+		std::vector<std::string> find_files() const;
+
+		/// Decode the file of a frame, and scale it (to fit the size)
+		std::shared_ptr<openshot::Frame> decode_frame(int64_t number, QSize size);
+
+		/// Decode the queued frames (the body of each worker thread)
+		void decode_worker();
+
+		/// Queue the frames after (or before) the requested frame, which are not cached yet
+		void queue_prefetch(int64_t requested_frame);
+
+		/// Calculate the max size of the images, based on parent timeline and parent clip settings
+		QSize calculate_max_size();
+
+	public:
+		/// @brief Constructor for ImageSequenceReader.
+		/// @param path The printf-style pattern of the file names (i.e. "/plates/shot010.%04d.png")
+		/// @param fps The frame rate of the sequence (stored in info.fps)
+		/// @param inspect_reader Open the first file, to inspect the sequence (see QtImageReader)
+		ImageSequenceReader(std::string path, openshot::Fraction fps=openshot::Fraction(25, 1), bool inspect_reader=true);
+
+		virtual ~ImageSequenceReader();
+
+		/// Close the sequence (and stop decoding ahead)
+		void Close() override;
+
+		/// Get the cache object used by this reader
+		openshot::CacheBase* GetCache() override { return &final_cache; };
+
+		/// @brief Get an openshot::Frame object for a specific frame number of this reader.
+		/// @returns The requested frame (containing the image)
+		/// @param requested_frame The frame number that is requested (1 is the first file)
+		std::shared_ptr<openshot::Frame> GetFrame(int64_t requested_frame) override;
+
+		/// Get the number of frames decoded ahead of the requested frame
+		int GetPrefetchFrames() { return prefetch_frames; };
+
+		/// @brief Set the number of frames decoded ahead of the requested frame (0 = only decode requested frames)
+		/// @param frames The number of frames
+		void SetPrefetchFrames(int frames) { prefetch_frames = (frames < 0) ? 0 : frames; };
+
+		/// Determine if reader is open or closed
+		bool IsOpen() override { return is_open; };
+
+		/// Return the type name of the class
+		std::string Name() override { return "ImageSequenceReader"; };
+
+		// Get and Set JSON methods
+		std::string Json() const override; ///< Generate JSON string of this object
+		void SetJson(const std::string value) override; ///< Load JSON string into this object
+		Json::Value JsonValue() const override; ///< Generate Json::Value for this object
+		void SetJsonValue(const Json::Value root) override; ///< Load Json::Value into this object
+
+		/// Open the sequence (and start the decoding threads)
+		void Open() override;
+	};
+
+}
+
+#endif
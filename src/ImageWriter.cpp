@@ -13,6 +13,10 @@
 //Require ImageMagick support
 #ifdef USE_IMAGEMAGICK
 
+#include <cstdio>
+
+#include <QImageWriter>
+
 #include "MagickUtilities.h"
 #include "QtUtilities.h"
 
@@ -20,6 +24,7 @@
 #include "Exceptions.h"
 #include "Frame.h"
 #include "ReaderBase.h"
+#include "TaskExecutor.h"
 #include "ZmqLogger.h"
 
 using namespace openshot;
@@ -65,7 +70,7 @@ void ImageWriter::SetVideoOptions(
     // Set the ratio based on the reduced fraction
     info.display_ratio = size;
 
-    ZmqLogger::Instance()->AppendDebugMethod(
+    ZMQ_DEBUG(
         "ImageWriter::SetVideoOptions (" + format + ")",
         "width", width,
         "height", height,
@@ -91,6 +96,52 @@ void ImageWriter::WriteFrame(std::shared_ptr<Frame> frame)
 			"Call Open() before calling this method.", path);
 	}
 
+	// Calculate correct DAR (display aspect ratio)
+	int new_height = info.height * frame->GetPixelRatio().Reciprocal().ToDouble();
+
+	if (!combine_frames) {
+		// Image sequence: encode the frame to its own file on the TaskExecutor (waiting while too many
+		// frames are being encoded, to bound the memory used)
+		wait_for_writes(std::max(cache_size, 1) - 1);
+
+		const std::string file_path = frame_path(write_video_count);
+		const QByteArray format = QString::fromStdString(info.vcodec).toLower().toUtf8();
+		const bool qt_format = QImageWriter::supportedImageFormats().contains(format);
+		const int width = info.width;
+		const int quality = image_quality;
+		const float delay = info.video_timebase.ToFloat() * 100;
+		const int loops = number_of_loops;
+		const std::string magick_format = info.vcodec;
+		std::shared_ptr<QImage> qimage = frame->GetImage();
+		pending_writes.push_back(TaskExecutor::Instance()->Async([=]() {
+			if (qt_format) {
+				// Resize image, and encode it with Qt
+				QImage scaled_image = qimage->scaled(width, new_height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+				if (!scaled_image.save(QString::fromStdString(file_path), format.constData(), quality))
+					throw InvalidFile("The image could not be written.", file_path);
+				return;
+			}
+
+			// Resize image, and encode it with ImageMagick
+			auto frame_image = openshot::QImage2Magick(qimage);
+			frame_image->magick(magick_format);
+			frame_image->backgroundColor(Magick::Color("none"));
+			MAGICK_IMAGE_ALPHA(frame_image, true);
+			frame_image->quality(quality);
+			frame_image->animationDelay(delay);
+			frame_image->animationIterations(loops);
+			Magick::Geometry new_size(width, new_height);
+			new_size.aspect(true);
+			frame_image->resize(new_size);
+			frame_image->write(file_path);
+		}));
+
+		// Keep track of the last frame added
+		write_video_count++;
+		last_frame = frame;
+		return;
+	}
+
 	// Copy and resize image
 	auto qimage = frame->GetImage();
 	auto frame_image = openshot::QImage2Magick(qimage);
@@ -101,9 +152,6 @@ void ImageWriter::WriteFrame(std::shared_ptr<Frame> frame)
 	frame_image->animationDelay(info.video_timebase.ToFloat() * 100);
 	frame_image->animationIterations(number_of_loops);
 
-	// Calculate correct DAR (display aspect ratio)
-	int new_height = info.height * frame->GetPixelRatio().Reciprocal().ToDouble();
-
 	// Resize image
 	Magick::Geometry new_size(info.width, new_height);
 	new_size.aspect(true);
@@ -117,10 +165,48 @@ void ImageWriter::WriteFrame(std::shared_ptr<Frame> frame)
 	last_frame = frame;
 }
 
+// Get the path of a frame of an image sequence
+std::string ImageWriter::frame_path(int64_t index) const
+{
+	// A printf-style pattern (i.e. "frame-%04d.png") is replaced by the index
+	const size_t pattern = path.find('%');
+	if (pattern != std::string::npos && path.find('d', pattern) != std::string::npos) {
+		std::vector<char> formatted(path.size() + 32);
+		snprintf(formatted.data(), formatted.size(), path.c_str(), int(index));
+		return formatted.data();
+	}
+
+	// Otherwise the index is added before the extension (i.e. "frame-0.png")
+	const size_t separator = path.find_last_of("/\\");
+	const size_t extension = path.find_last_of('.');
+	if (extension == std::string::npos || (separator != std::string::npos && extension < separator))
+		return path + "-" + std::to_string(index);
+	return path.substr(0, extension) + "-" + std::to_string(index) + path.substr(extension);
+}
+
+// Wait until at most max_pending frames of an image sequence are being encoded
+void ImageWriter::wait_for_writes(size_t max_pending)
+{
+	while (pending_writes.size() > max_pending) {
+		std::future<void> write = std::move(pending_writes.front());
+		pending_writes.pop_front();
+
+		// Throw the error of the frame (if any), after waiting for the other frames
+		try {
+			write.get();
+		} catch (...) {
+			for (auto& other : pending_writes)
+				other.wait();
+			pending_writes.clear();
+			throw;
+		}
+	}
+}
+
 // Write a block of frames from a reader
 void ImageWriter::WriteFrame(ReaderBase* reader, int64_t start, int64_t length)
 {
-	ZmqLogger::Instance()->AppendDebugMethod(
+	ZMQ_DEBUG(
 		"ImageWriter::WriteFrame (from Reader)",
 		"start", start,
 		"length", length);
@@ -139,15 +225,24 @@ void ImageWriter::WriteFrame(ReaderBase* reader, int64_t start, int64_t length)
 // Close the writer and encode/output final image to the disk.
 void ImageWriter::Close()
 {
-	// Write frame images to file
-	Magick::writeImages(frames.begin(), frames.end(), path, combine_frames);
+	// Write frame images to file (image sequences are already being written)
+	try {
+		wait_for_writes(0);
+		if (!frames.empty())
+			Magick::writeImages(frames.begin(), frames.end(), path, combine_frames);
+	} catch (...) {
+		frames.clear();
+		write_video_count = 0;
+		is_open = false;
+		throw;
+	}
 
 	// Clear frames vector & counters, close writer
 	frames.clear();
 	write_video_count = 0;
 	is_open = false;
 
-	ZmqLogger::Instance()->AppendDebugMethod("ImageWriter::Close");
+	ZMQ_DEBUG("ImageWriter::Close");
 }
 
 #endif //USE_IMAGEMAGICK
@@ -15,6 +15,8 @@
 
 #ifdef USE_IMAGEMAGICK
 
+#include <deque>
+#include <future>
 #include <string>
 #include <vector>
 
@@ -55,6 +57,13 @@ namespace openshot
 	 * w.Close();
 	 * r.Close();
 	 * @endcode
+	 *
+	 * Image sequences (combine = false) are written while frames are added: each frame is encoded to its
+	 * own file on a worker thread, with up to GetCacheSize() frames encoded at a time. Formats which Qt can
+	 * write (i.e. PNG, JPEG or TIFF) are encoded by Qt, and other formats by ImageMagick. The file of each
+	 * frame is named like ImageMagick names them: a printf-style pattern in the path (i.e. "frame-%04d.png")
+	 * is replaced by the index of the frame (starting at 0), or else the index is added before the extension
+	 * (i.e. "frame-0.png").
 	 */
 	class ImageWriter : public WriterBase
 	{
@@ -69,6 +78,13 @@ namespace openshot
 		bool combine_frames;
 
 		std::shared_ptr<Frame> last_frame;
+		std::deque<std::future<void>> pending_writes; ///< The frames of an image sequence being encoded
+
+		/// Get the path of a frame of an image sequence
+		std::string frame_path(int64_t index) const;
+
+		/// Wait until at most max_pending frames of an image sequence are being encoded (and throw the first error)
+		void wait_for_writes(size_t max_pending);
 
 	public:
 
@@ -89,7 +105,7 @@ namespace openshot
 		/// Open writer
 		void Open();
 
-		/// @brief Set the cache size (number of frames to queue before writing)
+		/// @brief Set the cache size (number of frames to queue before writing, or encoded at a time for image sequences)
 		/// @param new_size Number of frames to queue before writing
 		void SetCacheSize(int new_size) { cache_size = new_size; };
 
@@ -10,20 +10,26 @@
 //
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
 #include "Json.h"
 #include "Exceptions.h"
 
-const Json::Value openshot::stringToJson(const std::string value) {
+const Json::Value openshot::stringToJson(const std::string& value) {
+
+	// Re-use the reader of this thread (creating a reader is slower than parsing small diffs)
+	thread_local std::unique_ptr<Json::CharReader> reader(Json::CharReaderBuilder().newCharReader());
 
 	// Parse JSON string into JSON objects
 	Json::Value root;
-	Json::CharReaderBuilder rbuilder;
-	Json::CharReader* reader(rbuilder.newCharReader());
-
 	std::string errors;
 	bool success = reader->parse( value.c_str(), value.c_str() + value.size(),
 	                              &root, &errors );
-	delete reader;
 
 	if (!success)
 		// Raise exception
@@ -31,3 +37,359 @@ const Json::Value openshot::stringToJson(const std::string value) {
 
 	return root;
 }
+
+std::string openshot::jsonToString(const Json::Value& root) {
+
+	// Re-use the compact writer (and stream) of this thread
+	thread_local std::unique_ptr<Json::StreamWriter> writer([]() {
+		Json::StreamWriterBuilder builder;
+		builder["indentation"] = "";
+		return builder.newStreamWriter();
+	}());
+	thread_local std::ostringstream output;
+
+	output.str(std::string());
+	output.clear();
+	writer->write(root, &output);
+	return output.str();
+}
+
+namespace {
+	// Binary JSON (magic, then the format version)
+	const char BINARY_MAGIC[] = { 'O', 'S', 'P', 'B' };
+	const uint8_t BINARY_VERSION = 1;
+	const int BINARY_MAX_DEPTH = 256;
+
+	// Value tags
+	enum BinaryTag : uint8_t {
+		TAG_NULL = 0,
+		TAG_FALSE,
+		TAG_TRUE,
+		TAG_INT,	///< zigzag varint
+		TAG_UINT,	///< varint
+		TAG_REAL,	///< 8 bytes (little endian)
+		TAG_STRING,	///< varint index in the string table
+		TAG_ARRAY,	///< varint size, then the values
+		TAG_OBJECT,	///< varint size, then (varint key index, value) pairs
+		TAG_POINTS	///< varint size, then packed keyframe Points
+	};
+
+	// Flags of a packed Point (the co coordinate is always present)
+	enum PointFlags : uint8_t {
+		POINT_HANDLE_LEFT = 1,
+		POINT_HANDLE_RIGHT = 2,
+		POINT_HANDLE_TYPE = 4,
+		POINT_INTERPOLATION = 8
+	};
+
+	// Append a varint
+	void append_varint(std::string& output, uint64_t value) {
+		while (value >= 0x80) {
+			output.push_back((char) ((value & 0x7F) | 0x80));
+			value >>= 7;
+		}
+		output.push_back((char) value);
+	}
+
+	class BinaryWriter {
+	public:
+		std::string values;
+		std::vector<const std::string*> strings;
+		std::unordered_map<std::string, uint64_t> string_indexes;
+
+		void write_varint(uint64_t value) {
+			append_varint(values, value);
+		}
+
+		void write_double(double value) {
+			uint64_t bits;
+			std::memcpy(&bits, &value, sizeof(bits));
+			for (int byte = 0; byte < 8; byte++)
+				values.push_back((char) ((bits >> (8 * byte)) & 0xFF));
+		}
+
+		void write_string(const std::string& value) {
+			auto inserted = string_indexes.emplace(value, strings.size());
+			if (inserted.second)
+				strings.push_back(&inserted.first->first);
+			write_varint(inserted.first->second);
+		}
+
+		// A Coordinate ({"X": number, "Y": number})
+		static bool is_coordinate(const Json::Value& value) {
+			return value.isObject() && value.size() == 2 && value["X"].isNumeric() && value["Y"].isNumeric();
+		}
+
+		// A small non-negative int (i.e. an enum)
+		static bool is_enum(const Json::Value& value) {
+			return value.isIntegral() && value.asLargestInt() >= 0 && value.asLargestInt() <= INT32_MAX;
+		}
+
+		// Determine if a value is a keyframe Point (which can be packed)
+		static bool is_point(const Json::Value& point) {
+			if (!point.isObject() || !is_coordinate(point["co"]))
+				return false;
+			for (const auto& key : point.getMemberNames()) {
+				const Json::Value& member = point[key];
+				if (key == "co")
+					continue;
+				if ((key == "handle_left" || key == "handle_right") && is_coordinate(member))
+					continue;
+				if ((key == "handle_type" || key == "interpolation") && is_enum(member))
+					continue;
+				return false;
+			}
+			return true;
+		}
+
+		void write_points(const Json::Value& points) {
+			values.push_back((char) TAG_POINTS);
+			write_varint(points.size());
+			for (const auto& point : points) {
+				uint8_t flags = 0;
+				if (point.isMember("handle_left")) flags |= POINT_HANDLE_LEFT;
+				if (point.isMember("handle_right")) flags |= POINT_HANDLE_RIGHT;
+				if (point.isMember("handle_type")) flags |= POINT_HANDLE_TYPE;
+				if (point.isMember("interpolation")) flags |= POINT_INTERPOLATION;
+				values.push_back((char) flags);
+
+				write_double(point["co"]["X"].asDouble());
+				write_double(point["co"]["Y"].asDouble());
+				if (flags & POINT_HANDLE_LEFT) {
+					write_double(point["handle_left"]["X"].asDouble());
+					write_double(point["handle_left"]["Y"].asDouble());
+				}
+				if (flags & POINT_HANDLE_RIGHT) {
+					write_double(point["handle_right"]["X"].asDouble());
+					write_double(point["handle_right"]["Y"].asDouble());
+				}
+				if (flags & POINT_HANDLE_TYPE)
+					write_varint(point["handle_type"].asLargestUInt());
+				if (flags & POINT_INTERPOLATION)
+					write_varint(point["interpolation"].asLargestUInt());
+			}
+		}
+
+		void write_value(const Json::Value& value) {
+			switch (value.type()) {
+				case Json::nullValue:
+					values.push_back((char) TAG_NULL);
+					break;
+				case Json::booleanValue:
+					values.push_back((char) (value.asBool() ? TAG_TRUE : TAG_FALSE));
+					break;
+				case Json::intValue: {
+					const int64_t number = value.asLargestInt();
+					values.push_back((char) TAG_INT);
+					write_varint(((uint64_t) number << 1) ^ (uint64_t) (number >> 63));
+					break;
+				}
+				case Json::uintValue:
+					values.push_back((char) TAG_UINT);
+					write_varint(value.asLargestUInt());
+					break;
+				case Json::realValue:
+					values.push_back((char) TAG_REAL);
+					write_double(value.asDouble());
+					break;
+				case Json::stringValue:
+					values.push_back((char) TAG_STRING);
+					write_string(value.asString());
+					break;
+				case Json::arrayValue: {
+					bool points = value.size() > 0;
+					for (const auto& item : value)
+						if (!(points = is_point(item)))
+							break;
+					if (points) {
+						write_points(value);
+						break;
+					}
+					values.push_back((char) TAG_ARRAY);
+					write_varint(value.size());
+					for (const auto& item : value)
+						write_value(item);
+					break;
+				}
+				case Json::objectValue:
+					values.push_back((char) TAG_OBJECT);
+					write_varint(value.size());
+					for (auto it = value.begin(); it != value.end(); it++) {
+						write_string(it.name());
+						write_value(*it);
+					}
+					break;
+			}
+		}
+	};
+
+	class BinaryReader {
+	public:
+		const std::string& data;
+		size_t position;
+		std::vector<Json::Value> strings;
+
+		BinaryReader(const std::string& data, size_t position) : data(data), position(position) { }
+
+		[[noreturn]] static void invalid() {
+			throw openshot::InvalidJSON("Binary JSON could not be parsed (or is invalid)");
+		}
+
+		uint8_t read_byte() {
+			if (position >= data.size())
+				invalid();
+			return (uint8_t) data[position++];
+		}
+
+		uint64_t read_varint() {
+			uint64_t value = 0;
+			for (int shift = 0; shift < 64; shift += 7) {
+				const uint8_t byte = read_byte();
+				value |= (uint64_t) (byte & 0x7F) << shift;
+				if (!(byte & 0x80))
+					return value;
+			}
+			invalid();
+		}
+
+		// Read a size (which can't be larger than the remaining data)
+		size_t read_size() {
+			const uint64_t size = read_varint();
+			if (size > data.size() - position)
+				invalid();
+			return (size_t) size;
+		}
+
+		double read_double() {
+			if (data.size() - position < 8)
+				invalid();
+			uint64_t bits = 0;
+			for (int byte = 0; byte < 8; byte++)
+				bits |= (uint64_t) (uint8_t) data[position++] << (8 * byte);
+			double value;
+			std::memcpy(&value, &bits, sizeof(value));
+			return value;
+		}
+
+		const Json::Value& read_string() {
+			const uint64_t index = read_varint();
+			if (index >= strings.size())
+				invalid();
+			return strings[index];
+		}
+
+		void read_strings() {
+			const size_t count = read_size();
+			strings.reserve(count);
+			for (size_t index = 0; index < count; index++) {
+				const size_t length = read_size();
+				strings.emplace_back(data.substr(position, length));
+				position += length;
+			}
+		}
+
+		Json::Value read_coordinate() {
+			Json::Value coordinate(Json::objectValue);
+			coordinate["X"] = read_double();
+			coordinate["Y"] = read_double();
+			return coordinate;
+		}
+
+		Json::Value read_value(int depth) {
+			if (depth > BINARY_MAX_DEPTH)
+				invalid();
+
+			switch (read_byte()) {
+				case TAG_NULL:
+					return Json::Value();
+				case TAG_FALSE:
+					return Json::Value(false);
+				case TAG_TRUE:
+					return Json::Value(true);
+				case TAG_INT: {
+					const uint64_t zigzag = read_varint();
+					return Json::Value((Json::LargestInt) ((zigzag >> 1) ^ (~(zigzag & 1) + 1)));
+				}
+				case TAG_UINT:
+					return Json::Value((Json::LargestUInt) read_varint());
+				case TAG_REAL:
+					return Json::Value(read_double());
+				case TAG_STRING:
+					return read_string();
+				case TAG_ARRAY: {
+					const size_t size = read_size();
+					Json::Value array(Json::arrayValue);
+					for (size_t index = 0; index < size; index++)
+						array.append(read_value(depth + 1));
+					return array;
+				}
+				case TAG_OBJECT: {
+					const size_t size = read_size();
+					Json::Value object(Json::objectValue);
+					for (size_t index = 0; index < size; index++) {
+						const std::string& key = read_string().asString();
+						object[key] = read_value(depth + 1);
+					}
+					return object;
+				}
+				case TAG_POINTS: {
+					const size_t size = read_size();
+					Json::Value points(Json::arrayValue);
+					for (size_t index = 0; index < size; index++) {
+						const uint8_t flags = read_byte();
+						Json::Value& point = points.append(Json::Value(Json::objectValue));
+						point["co"] = read_coordinate();
+						if (flags & POINT_HANDLE_LEFT)
+							point["handle_left"] = read_coordinate();
+						if (flags & POINT_HANDLE_RIGHT)
+							point["handle_right"] = read_coordinate();
+						if (flags & POINT_HANDLE_TYPE)
+							point["handle_type"] = (Json::LargestInt) read_varint();
+						if (flags & POINT_INTERPOLATION)
+							point["interpolation"] = (Json::LargestInt) read_varint();
+					}
+					return points;
+				}
+				default:
+					invalid();
+			}
+		}
+	};
+}
+
+// Serialize a Json::Value into the binary format
+std::string openshot::jsonToBinary(const Json::Value& root) {
+	BinaryWriter writer;
+	writer.write_value(root);
+
+	// Header, string table, then the values
+	std::string result(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+	result.push_back((char) BINARY_VERSION);
+	append_varint(result, writer.strings.size());
+	for (const std::string* value : writer.strings) {
+		append_varint(result, value->size());
+		result.append(*value);
+	}
+	result.append(writer.values);
+	return result;
+}
+
+// Parse the binary format into a Json::Value
+const Json::Value openshot::binaryToJson(const std::string& value) {
+	if (!isBinaryJson(value))
+		throw openshot::InvalidJSON("Binary JSON could not be parsed (or is invalid)");
+	if ((uint8_t) value[sizeof(BINARY_MAGIC)] != BINARY_VERSION)
+		throw openshot::InvalidJSON("Binary JSON version is not supported");
+
+	BinaryReader reader(value, sizeof(BINARY_MAGIC) + 1);
+	reader.read_strings();
+	Json::Value root = reader.read_value(0);
+	if (reader.position != value.size())
+		BinaryReader::invalid();
+	return root;
+}
+
+// Determine if a string holds binary JSON
+bool openshot::isBinaryJson(const std::string& value) {
+	return value.size() > sizeof(BINARY_MAGIC) && value.compare(0, sizeof(BINARY_MAGIC), BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0;
+}
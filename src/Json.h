@@ -18,7 +18,29 @@
 
 
 namespace openshot {
-    const Json::Value stringToJson(const std::string value);
+    /// @brief Parse JSON text into a Json::Value (with a reader which is re-used by each thread)
+    /// @throws InvalidJSON if the text is not valid JSON
+    const Json::Value stringToJson(const std::string& value);
+
+    /// Serialize a Json::Value into compact JSON text (without indentation, for machine consumers such as the UI)
+    std::string jsonToString(const Json::Value& root);
+
+    /**
+     * @brief Serialize a Json::Value into a compact binary format (an alternative to JSON text for large projects)
+     *
+     * All the keys and string values are stored once, in a string table, and the values are tagged and
+     * varint encoded (doubles are stored as 8 bytes, so they are exact). Arrays of keyframe Points are
+     * packed as flat records of numbers, so loading them doesn't create any temporary strings.
+     * The result converts back to the same Json::Value with binaryToJson().
+     */
+    std::string jsonToBinary(const Json::Value& root);
+
+    /// @brief Parse the binary format of jsonToBinary() into a Json::Value
+    /// @throws InvalidJSON if the data is not valid
+    const Json::Value binaryToJson(const std::string& value);
+
+    /// Determine if a string holds binary JSON (from jsonToBinary()), instead of JSON text
+    bool isBinaryJson(const std::string& value);
 }
 
 #endif
@@ -13,14 +13,14 @@
 #include "KeyFrame.h"
 #include "Exceptions.h"
 
-#include <algorithm>   // For std::lower_bound, std::move_backward
+#include <algorithm>   // For std::min, std::max, std::fill
 #include <functional>  // For std::less, std::less_equal, etc…
-#include <utility>	 // For std::swap
 #include <numeric>	 // For std::accumulate
 #include <cassert>	 // For assert()
 #include <cmath>	   // For fabs, round
 #include <iostream>	// For std::cout
 #include <iomanip>	 // For std::setprecision
+#include <memory>	  // For std::atomic_load, std::atomic_store
 
 using namespace std;
 using namespace openshot;
@@ -118,37 +118,42 @@ Keyframe::Keyframe(double value) {
 }
 
 // Constructor which takes a vector of Points
-Keyframe::Keyframe(const std::vector<openshot::Point>& points) : Points(points) {};
+Keyframe::Keyframe(const std::vector<openshot::Point>& points) {
+	Points.reserve(points.size());
+	for (const auto& p : points) {
+		AddPoint(p);
+	}
+}
+
+// Constructor which takes separate X and Y values
+Keyframe::Keyframe(const std::vector<double>& x, const std::vector<double>& y, InterpolationType interpolation) {
+	AddPoints(x, y, interpolation);
+}
 
 // Destructor
 Keyframe::~Keyframe() {
 	Points.clear();
-	Points.shrink_to_fit();
 }
 
 // Add a new point on the key-frame.  Each point has a primary coordinate,
 // a left handle, and a right handle.
 void Keyframe::AddPoint(Point p) {
+	ClearBakedValues();
+
 	// candidate is not less (greater or equal) than the new point in
 	// the X coordinate.
-	std::vector<Point>::iterator candidate =
-		std::lower_bound(begin(Points), end(Points), p.co.X, IsPointBeforeX);
-	if (candidate == end(Points)) {
+	int64_t const candidate = Points.LowerBound(p.co.X);
+	if (candidate == Points.size()) {
 		// New point X is greater than all other points' X, add to
 		// back.
-		Points.push_back(p);
-	} else if ((*candidate).co.X == p.co.X) {
+		Points.PushBack(p);
+	} else if (Points.X(candidate) == p.co.X) {
 		// New point is at same X coordinate as some point, overwrite
 		// point.
-		*candidate = p;
+		Points.Set(candidate, p);
 	} else {
-		// New point needs to be inserted before candidate; thus move
-		// candidate and all following one to the right and insert new
-		// point then where candidate was.
-		size_t const candidate_index = candidate - begin(Points);
-		Points.push_back(p); // Make space; could also be a dummy point. INVALIDATES candidate!
-		std::move_backward(begin(Points) + candidate_index, end(Points) - 1, end(Points));
-		Points[candidate_index] = p;
+		// New point needs to be inserted before candidate
+		Points.Insert(candidate, p);
 	}
 }
 
@@ -162,18 +167,33 @@ void Keyframe::AddPoint(double x, double y, InterpolationType interpolate)
 	AddPoint(new_point);
 }
 
+// Add many points at once, from separate X and Y values
+void Keyframe::AddPoints(const std::vector<double>& x, const std::vector<double>& y, InterpolationType interpolation) {
+	if (x.size() != y.size())
+		throw OutOfBoundsPoint("The X and Y values of the points have different lengths", y.size(), x.size());
+	ClearBakedValues();
+
+	// Increasing X values (after the last point) are appended at once
+	bool in_order = x.empty() || Points.empty() || x.front() > Points.X(Points.size() - 1);
+	for (std::vector<double>::size_type index = 1; in_order && index < x.size(); index++) {
+		in_order = x[index] > x[index - 1];
+	}
+	if (in_order) {
+		Points.Append(x, y, interpolation);
+		return;
+	}
+
+	for (std::vector<double>::size_type index = 0; index < x.size(); index++) {
+		AddPoint(Point(Coordinate(x[index], y[index]), interpolation));
+	}
+}
+
 // Get the index of a point by matching a coordinate
 int64_t Keyframe::FindIndex(Point p) const {
-	// loop through points, and find a matching coordinate
-	for (std::vector<Point>::size_type x = 0; x < Points.size(); x++) {
-		// Get each point
-		Point existing_point = Points[x];
-
-		// find a match
-		if (p.co.X == existing_point.co.X && p.co.Y == existing_point.co.Y) {
-			// Remove the matching point, and break out of loop
-			return x;
-		}
+	// Points are sorted by X (and each X is only used once)
+	int64_t const index = Points.LowerBound(p.co.X);
+	if (index < Points.size() && Points.X(index) == p.co.X && Points.Y(index) == p.co.Y) {
+		return index;
 	}
 
 	// no matching point found
@@ -182,9 +202,8 @@ int64_t Keyframe::FindIndex(Point p) const {
 
 // Determine if point already exists
 bool Keyframe::Contains(Point p) const {
-	std::vector<Point>::const_iterator i =
-		std::lower_bound(begin(Points), end(Points), p.co.X, IsPointBeforeX);
-	return i != end(Points) && i->co.X == p.co.X;
+	int64_t const index = Points.LowerBound(p.co.X);
+	return index < Points.size() && Points.X(index) == p.co.X;
 }
 
 // Get current point (or closest point) from the X coordinate (i.e. the frame number)
@@ -195,25 +214,24 @@ Point Keyframe::GetClosestPoint(Point p, bool useLeft) const {
 
 	// Finds a point with an X coordinate which is "not less" (greater
 	// or equal) than the queried X coordinate.
-	std::vector<Point>::const_iterator candidate =
-		std::lower_bound(begin(Points), end(Points), p.co.X, IsPointBeforeX);
+	int64_t const candidate = Points.LowerBound(p.co.X);
 
-	if (candidate == end(Points)) {
+	if (candidate == Points.size()) {
 		// All points are before the queried point.
 		//
 		// Note: Behavior the same regardless of useLeft!
-		return Points.back();
+		return Points.Get(Points.size() - 1);
 	}
-	if (candidate == begin(Points)) {
+	if (candidate == 0) {
 		// First point is greater or equal to the queried point.
 		//
 		// Note: Behavior the same regardless of useLeft!
-		return Points.front();
+		return Points.Get(0);
 	}
 	if (useLeft) {
-		return *(candidate - 1);
+		return Points.Get(candidate - 1);
 	} else {
-		return *candidate;
+		return Points.Get(candidate);
 	}
 }
 
@@ -231,9 +249,9 @@ Point Keyframe::GetPreviousPoint(Point p) const {
 
 		// If not the 1st point
 		if (index > 0)
-			return Points[index - 1];
+			return Points.Get(index - 1);
 		else
-			return Points[0];
+			return Points.Get(0);
 
 	} catch (const OutOfBoundsPoint& e) {
 		// No previous point
@@ -243,15 +261,20 @@ Point Keyframe::GetPreviousPoint(Point p) const {
 
 // Get max point (by Y coordinate)
 Point Keyframe::GetMaxPoint() const {
-	Point maxPoint(-1, -1);
+	int64_t max_index = -1;
+	double max_y = -1;
 
-	for (Point const & existing_point: Points) {
-		if (existing_point.co.Y >= maxPoint.co.Y) {
-			maxPoint = existing_point;
+	for (int64_t index = 0; index < Points.size(); index++) {
+		if (Points.Y(index) >= max_y) {
+			max_index = index;
+			max_y = Points.Y(index);
 		}
 	}
 
-	return maxPoint;
+	if (max_index < 0) {
+		return Point(-1, -1);
+	}
+	return Points.Get(max_index);
 }
 
 // Get the value at a specific index
@@ -259,23 +282,191 @@ double Keyframe::GetValue(int64_t index) const {
 	if (Points.empty()) {
 		return 0;
 	}
-	std::vector<Point>::const_iterator candidate =
-		std::lower_bound(begin(Points), end(Points), static_cast<double>(index), IsPointBeforeX);
 
-	if (candidate == end(Points)) {
+	// Constant curves have the same value everywhere
+	std::shared_ptr<const BakedValues> baked = GetBakedValues();
+	if (baked->constant) {
+		return Points.Y(0);
+	}
+
+	// Look up the baked value (if this index is between the first and last point)
+	int64_t const first_index = ceil(Points.X(0));
+	if (index >= first_index && index - first_index < (int64_t)baked->values.size()) {
+		return baked->values[index - first_index];
+	}
+	return InterpolateValue(index);
+}
+
+// Get the values of consecutive indexes (in a single pass)
+void Keyframe::GetValues(int64_t start, int64_t count, double* values) const {
+	if (count <= 0) {
+		return;
+	}
+	if (Points.empty()) {
+		std::fill(values, values + count, 0.0);
+		return;
+	}
+	std::shared_ptr<const BakedValues> baked = GetBakedValues();
+	if (baked->constant) {
+		std::fill(values, values + count, Points.Y(0));
+		return;
+	}
+
+	int64_t const stop = start + count;
+	int64_t const last = Points.size() - 1;
+	int64_t index = start;
+
+	// Indexes at or before the first point
+	while (index < stop && index <= Points.X(0)) {
+		values[index - start] = Points.Y(0);
+		++index;
+	}
+
+	// Walk the segments between points (each one is only found once), and evaluate all of the
+	// indexes inside each segment with its interpolation
+	int64_t const first_baked_index = ceil(Points.X(0));
+	int64_t const baked_count = baked->values.size();
+	int64_t right = Points.LowerBound(static_cast<double>(index));
+	for (; index < stop && right <= last; ++right) {
+		int64_t const left = right - 1;
+		double const left_x = Points.X(left);
+		double const left_y = Points.Y(left);
+		double const right_x = Points.X(right);
+		double const right_y = Points.Y(right);
+		int64_t const run_stop = std::min<int64_t>(stop, ceil(right_x));
+		double* run_values = values + (index - start);
+		switch (Points.Interpolation(right)) {
+		case CONSTANT:
+			for (int64_t run_index = index; run_index < run_stop; ++run_index) {
+				run_values[run_index - index] = left_y;
+			}
+			break;
+		case BEZIER:
+			for (int64_t run_index = index; run_index < run_stop; ++run_index) {
+				int64_t const baked_index = run_index - first_baked_index;
+				run_values[run_index - index] = baked_index < baked_count ? baked->values[baked_index] :
+					InterpolateSegment(right, run_index);
+			}
+			break;
+		default: {
+			// The same formula as InterpolateLinearCurve (so the values match GetValue exactly)
+			double const slope = (right_y - left_y) / (right_x - left_x);
+			for (int64_t run_index = index; run_index < run_stop; ++run_index) {
+				run_values[run_index - index] = left_y + slope * (static_cast<double>(run_index) - left_x);
+			}
+			break;
+		}
+		}
+		index = std::max(index, run_stop);
+
+		// Index directly on the right point
+		if (index < stop && index == right_x) {
+			values[index - start] = right_y;
+			++index;
+		}
+	}
+
+	// Indexes after the last point
+	while (index < stop) {
+		values[index - start] = Points.Y(last);
+		++index;
+	}
+}
+
+// Interpolate the value at a specific index (without using the baked values)
+double Keyframe::InterpolateValue(int64_t index) const {
+	if (Points.empty()) {
+		return 0;
+	}
+	int64_t const candidate = Points.LowerBound(static_cast<double>(index));
+
+	if (candidate == Points.size()) {
 		// index is behind last point
-		return Points.back().co.Y;
+		return Points.Y(Points.size() - 1);
 	}
-	if (candidate == begin(Points)) {
+	if (candidate == 0) {
 		// index is at or before first point
-		return Points.front().co.Y;
+		return Points.Y(0);
 	}
-	if (candidate->co.X == index) {
+	if (Points.X(candidate) == index) {
 		// index is directly on a point
-		return candidate->co.Y;
+		return Points.Y(candidate);
 	}
-	std::vector<Point>::const_iterator predecessor = candidate - 1;
-	return InterpolateBetween(*predecessor, *candidate, index, 0.01);
+	return InterpolateSegment(candidate, index);
+}
+
+// Interpolate inside the segment between a point and the point before it
+double Keyframe::InterpolateSegment(int64_t right, double target) const {
+	int64_t const left = right - 1;
+	switch (Points.Interpolation(right)) {
+	case CONSTANT: return Points.Y(left);
+	case BEZIER: return InterpolateBezierCurve(Points.Get(left), Points.Get(right), target, 0.01);
+	default: {
+		// The same formula as InterpolateLinearCurve (without building the points)
+		double const slope = (Points.Y(right) - Points.Y(left)) / (Points.X(right) - Points.X(left));
+		return Points.Y(left) + slope * (target - Points.X(left));
+	}
+	}
+}
+
+// Get the baked values (baking them first, if needed)
+std::shared_ptr<const Keyframe::BakedValues> Keyframe::GetBakedValues() const {
+	std::shared_ptr<const BakedValues> baked = std::atomic_load(&baked_values);
+	if (!baked) {
+		baked = BakeValues();
+	}
+	return baked;
+}
+
+// Bake the values of every integer X between the first and last point
+std::shared_ptr<const Keyframe::BakedValues> Keyframe::BakeValues() const {
+	auto baked = std::make_shared<BakedValues>();
+
+	// A curve is constant if all of its points have the same Y value (even Bezier
+	// handles can not leave a flat segment)
+	baked->constant = true;
+	for (int64_t index = 1; index < Points.size(); index++) {
+		if (Points.Y(index) != Points.Y(0)) {
+			baked->constant = false;
+			break;
+		}
+	}
+
+	// Only curves with more than 1 value need interpolation, and very long
+	// curves are not baked (to keep memory usage reasonable)
+	int64_t const max_baked_values = 1 << 16;
+	if (!baked->constant) {
+		std::vector<double>& values = baked->values;
+		int64_t const first_index = ceil(Points.X(0));
+		int64_t const last_index = floor(Points.X(Points.size() - 1));
+		if (last_index >= first_index && last_index - first_index < max_baked_values) {
+			values.reserve(last_index - first_index + 1);
+
+			// Interpolate each segment in order (without searching for it)
+			int64_t candidate = 0;
+			for (int64_t index = first_index; index <= last_index; ++index) {
+				while (candidate < Points.size() && Points.X(candidate) < index) {
+					++candidate;
+				}
+				if (candidate == 0 || Points.X(candidate) == index) {
+					// index is directly on a point
+					values.push_back(Points.Y(candidate));
+				} else {
+					values.push_back(InterpolateSegment(candidate, index));
+				}
+			}
+		}
+	}
+
+	// Share the baked values (if another thread baked them first, both are identical)
+	std::shared_ptr<const BakedValues> shared = baked;
+	std::atomic_store(&baked_values, shared);
+	return shared;
+}
+
+// Reset the baked values (must be called whenever the points change)
+void Keyframe::ClearBakedValues() {
+	std::atomic_store(&baked_values, std::shared_ptr<const BakedValues>());
 }
 
 // Get the rounded INT value at a specific index
@@ -291,6 +482,11 @@ int64_t Keyframe::GetLong(int64_t index) const {
 // Get the direction of the curve at a specific index (increasing or decreasing)
 bool Keyframe::IsIncreasing(int index) const
 {
+	// Constant curves never change (assume increasing values)
+	if (IsConstant()) {
+		return true;
+	}
+
 	if (index <= 1) {
 		// Determine direction of frame 1 (and assume previous frames have same direction)
 		index = 1;
@@ -328,6 +524,48 @@ bool Keyframe::IsIncreasing(int index) const
 	return true;
 }
 
+// Determine if every index has the same value
+bool Keyframe::IsConstant() const
+{
+	return GetBakedValues()->constant;
+}
+
+// Determine if every index from start_index to end_index (inclusive) has the same value
+bool Keyframe::ConstantOver(int64_t start_index, int64_t end_index) const
+{
+	if (end_index <= start_index || IsConstant()) {
+		return true;
+	}
+
+	// Every point in the range must have the value of the first index, and every segment between points
+	// must be flat where it covers an index of the range (segments only touching the range at a point
+	// are checked by their points). Indexes before the first point (or after the last) have its value.
+	double const value = GetValue(start_index);
+	int64_t candidate = Points.LowerBound(static_cast<double>(start_index));
+	if (candidate > 0) {
+		--candidate;
+	}
+	for (; candidate < Points.size() && Points.X(candidate) <= end_index; ++candidate) {
+		double const candidate_y = Points.Y(candidate);
+		if (Points.X(candidate) >= start_index && candidate_y != value) {
+			return false;
+		}
+		int64_t const next = candidate + 1;
+		if (next == Points.size()) {
+			break;
+		}
+		int64_t const first_inside = std::max<int64_t>(start_index, floor(Points.X(candidate)) + 1);
+		int64_t const last_inside = std::min<int64_t>(end_index, ceil(Points.X(next)) - 1);
+		if (first_inside <= last_inside) {
+			bool const flat = Points.Interpolation(next) == CONSTANT || Points.Y(next) == candidate_y;
+			if (!flat || candidate_y != value) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
 // Generate JSON string of this object
 std::string Keyframe::Json() const {
 
@@ -340,11 +578,11 @@ Json::Value Keyframe::JsonValue() const {
 
 	// Create root json object
 	Json::Value root;
-	root["Points"] = Json::Value(Json::arrayValue);
+	Json::Value& points = root["Points"] = Json::Value(Json::arrayValue);
 
 	// loop through points
-	for (const auto existing_point : Points) {
-		root["Points"].append(existing_point.JsonValue());
+	for (int64_t index = 0; index < Points.size(); index++) {
+		points.append(Points.Get(index).JsonValue());
 	}
 
 	// return JsonValue
@@ -372,35 +610,38 @@ void Keyframe::SetJson(const std::string value) {
 void Keyframe::SetJsonValue(const Json::Value root) {
 	// Clear existing points
 	Points.clear();
-	Points.shrink_to_fit();
+	ClearBakedValues();
+
+	if (!root["Points"].isNull()) {
+		Points.reserve(root["Points"].size());
 
-	if (!root["Points"].isNull())
 		// loop through points
-		for (const auto existing_point : root["Points"]) {
+		for (const auto& existing_point : root["Points"]) {
 			// Create Point
 			Point p;
 
 			// Load Json into Point
 			p.SetJsonValue(existing_point);
 
-			// Add Point to Keyframe
+			// Add Point to Keyframe (points in order are added to the back)
 			AddPoint(p);
 		}
+	}
 }
 
 // Get the change in Y value (from the previous Y value)
 double Keyframe::GetDelta(int64_t index) const {
 	if (index < 1) return 0.0;
-	if (index == 1 && !Points.empty()) return Points[0].co.Y;
+	if (index == 1 && !Points.empty()) return Points.Y(0);
 	if (index >= GetLength()) return 0.0;
 	return GetValue(index) - GetValue(index - 1);
 }
 
 // Get a point at a specific index
-Point const & Keyframe::GetPoint(int64_t index) const {
+Point Keyframe::GetPoint(int64_t index) const {
 	// Is index a valid point?
-	if (index >= 0 && index < (int64_t)Points.size())
-		return Points[index];
+	if (index >= 0 && index < Points.size())
+		return Points.Get(index);
 	else
 		// Invalid index
 		throw OutOfBoundsPoint("Invalid point requested", index, Points.size());
@@ -410,7 +651,7 @@ Point const & Keyframe::GetPoint(int64_t index) const {
 int64_t Keyframe::GetLength() const {
 	if (Points.empty()) return 0;
 	if (Points.size() == 1) return 1;
-	return round(Points.back().co.X);
+	return round(Points.X(Points.size() - 1));
 }
 
 // Get the number of points (i.e. # of points)
@@ -419,32 +660,26 @@ int64_t Keyframe::GetCount() const {
 	return Points.size();
 }
 
+// Get the memory used by the points (in bytes)
+int64_t Keyframe::GetBytes() const {
+	return Points.MemoryUsage();
+}
+
 // Remove a point by matching a coordinate
 void Keyframe::RemovePoint(Point p) {
-	// loop through points, and find a matching coordinate
-	for (std::vector<Point>::size_type x = 0; x < Points.size(); x++) {
-		// Get each point
-		Point existing_point = Points[x];
-
-		// find a match
-		if (p.co.X == existing_point.co.X && p.co.Y == existing_point.co.Y) {
-			// Remove the matching point, and break out of loop
-			Points.erase(Points.begin() + x);
-			return;
-		}
-	}
-
-	// no matching point found
-	throw OutOfBoundsPoint("Invalid point requested", -1, Points.size());
+	// Find the matching point (throws an OutOfBoundsPoint if there is none)
+	Points.Erase(FindIndex(p));
+	ClearBakedValues();
 }
 
 // Remove a point by index
 void Keyframe::RemovePoint(int64_t index) {
 	// Is index a valid point?
-	if (index >= 0 && index < (int64_t)Points.size())
+	if (index >= 0 && index < Points.size())
 	{
 		// Remove a specific point by index
-		Points.erase(Points.begin() + index);
+		Points.Erase(index);
+		ClearBakedValues();
 	}
 	else
 		// Invalid index
@@ -462,10 +697,10 @@ void Keyframe::UpdatePoint(int64_t index, Point p) {
 
 void Keyframe::PrintPoints(std::ostream* out) const {
 	*out << std::right << std::setprecision(4) << std::setfill(' ');
-	for (const auto& p : Points) {
+	for (int64_t index = 0; index < Points.size(); index++) {
 		*out << std::defaultfloat
-			 << std::setw(6) << p.co.X
-			 << std::setw(14) << std::fixed << p.co.Y
+			 << std::setw(6) << Points.X(index)
+			 << std::setw(14) << std::fixed << Points.Y(index)
 			 << '\n';
 	}
 	*out << std::flush;
@@ -489,11 +724,13 @@ void Keyframe::PrintValues(std::ostream* out) const {
 		 << "┼─────────"
 		 << "┼────────────┤\n";
 
+	std::vector<double> values(std::max<int64_t>(GetLength(), 0));
+	GetValues(1, values.size(), values.data());
 	for (int64_t i = 1; i <= GetLength(); ++i) {
 		*out << "│"
 			 << std::setw(w[0]-2) << std::defaultfloat << i
 			 << (Contains(Point(i, 1)) ? " *" : "  ") << " │"
-			 << std::setw(w[1]) << std::fixed << GetValue(i) << " │"
+			 << std::setw(w[1]) << std::fixed << values[i - 1] << " │"
 			 << std::setw(w[2]) << std::defaultfloat << std::showpos
 								<< GetDelta(i) << " │ " << std::noshowpos
 			 << std::setw(w[3])
@@ -513,19 +750,22 @@ void Keyframe::ScalePoints(double scale)
 	// TODO: What if scale < 0?
 
 	// Loop through each point (skipping the 1st point)
-	for (std::vector<Point>::size_type point_index = 1; point_index < Points.size(); point_index++) {
+	for (int64_t point_index = 1; point_index < Points.size(); point_index++) {
 		// Scale X value
-		Points[point_index].co.X = round(Points[point_index].co.X * scale);
+		Points.SetX(point_index, round(Points.X(point_index) * scale));
 	}
+	ClearBakedValues();
 }
 
 // Flip all the points in this openshot::Keyframe (useful for reversing an effect or transition, etc...)
 void Keyframe::FlipPoints() {
-	for (std::vector<Point>::size_type point_index = 0, reverse_index = Points.size() - 1; point_index < reverse_index; point_index++, reverse_index--) {
+	for (int64_t point_index = 0, reverse_index = Points.size() - 1; point_index < reverse_index; point_index++, reverse_index--) {
 		// Flip the points
-		using std::swap;
-		swap(Points[point_index].co.Y, Points[reverse_index].co.Y);
+		double const y = Points.Y(point_index);
+		Points.SetY(point_index, Points.Y(reverse_index));
+		Points.SetY(reverse_index, y);
 		// TODO: check that this has the desired effect even with
 		// regards to handles!
 	}
+	ClearBakedValues();
 }
@@ -14,8 +14,10 @@
 #define OPENSHOT_KEYFRAME_H
 
 #include <iostream>
+#include <memory>
 #include <vector>
 
+#include "CompactPoints.h"
 #include "Point.h"
 #include "Json.h"
 
@@ -54,7 +56,31 @@ namespace openshot {
 	
 
 	private:
-		std::vector<Point> Points;	///< Vector of all Points
+		CompactPoints Points;	///< All Points (sorted by X)
+
+		/// Values derived from the points (built on demand, and reset whenever the points change)
+		struct BakedValues {
+			std::vector<double> values; ///< The value at every integer X between the first and last point
+			bool constant; ///< All points have the same Y value (so every index has the same value)
+		};
+
+		/// The baked values. Copies of a Keyframe share the same values.
+		mutable std::shared_ptr<const BakedValues> baked_values;
+
+		/// Interpolate the value at a specific index (without using the baked values)
+		double InterpolateValue(int64_t index) const;
+
+		/// Interpolate inside the segment between a point and the point before it
+		double InterpolateSegment(int64_t right, double target) const;
+
+		/// Get the baked values (baking them first, if needed)
+		std::shared_ptr<const BakedValues> GetBakedValues() const;
+
+		/// Bake the values of every integer X between the first and last point
+		std::shared_ptr<const BakedValues> BakeValues() const;
+
+		/// Reset the baked values (must be called whenever the points change)
+		void ClearBakedValues();
 
 	public:
 		/// Default constructor for the Keyframe class
@@ -66,6 +92,9 @@ namespace openshot {
 		/// Constructor which adds a supplied vector of Points
 		Keyframe(const std::vector<openshot::Point>& points);
 
+		/// Constructor which adds points from separate X and Y values (see AddPoints)
+		Keyframe(const std::vector<double>& x, const std::vector<double>& y, InterpolationType interpolation=LINEAR);
+
 		/// Destructor
 		~Keyframe();
 
@@ -75,6 +104,18 @@ namespace openshot {
 		/// Add a new point on the key-frame, with optional interpolation type
 		void AddPoint(double x, double y, InterpolationType interpolate=BEZIER);
 
+		/// @brief Add many points at once, from separate X and Y values (i.e. curves generated from tracking or audio data)
+		///
+		/// Points with increasing X values (after the last point) are appended without searching for
+		/// their positions, and without building a Point for each. The values are stored exactly (as floats
+		/// while every Y is exactly a float, and as doubles otherwise), like AddPoint(Point), and the points
+		/// have the default handles.
+		///
+		/// @param x The X value of each point
+		/// @param y The Y value of each point (must be as many as the X values)
+		/// @param interpolation The interpolation of every point
+		void AddPoints(const std::vector<double>& x, const std::vector<double>& y, InterpolationType interpolation=LINEAR);
+
 		/// Does this keyframe contain a specific point
 		bool Contains(Point p) const;
 
@@ -87,6 +128,17 @@ namespace openshot {
 		/// Get the value at a specific index
 		double GetValue(int64_t index) const;
 
+		/// @brief Get the values of consecutive indexes (in a single pass)
+		///
+		/// The segments between points are walked once (instead of searching for the segment of each
+		/// index), and the indexes of linear and constant segments are evaluated in simple loops which
+		/// the compiler can vectorize. The values are the same as GetValue.
+		///
+		/// @param start The first index
+		/// @param count The number of values
+		/// @param values Set to the value of each index (must have room for count values)
+		void GetValues(int64_t start, int64_t count, double* values) const;
+
 		/// Get the rounded INT value at a specific index
 		int GetInt(int64_t index) const;
 
@@ -97,7 +149,7 @@ namespace openshot {
 		double GetDelta(int64_t index) const;
 
 		/// Get a point at a specific index
-		Point const & GetPoint(int64_t index) const;
+		Point GetPoint(int64_t index) const;
 
 		/// Get current point (or closest point to the right) from the X coordinate (i.e. the frame number)
 		Point GetClosestPoint(Point p) const;
@@ -118,9 +170,18 @@ namespace openshot {
 		/// Get the number of points (i.e. # of points)
 		int64_t GetCount() const;
 
+		/// Get the memory used by the points (in bytes)
+		int64_t GetBytes() const;
+
 		/// Get the direction of the curve at a specific index (increasing or decreasing)
 		bool IsIncreasing(int index) const;
 
+		/// Determine if every index has the same value (i.e. a single point, or points with the same Y value)
+		bool IsConstant() const;
+
+		/// Determine if every index from start_index to end_index (inclusive) has the same value
+		bool ConstantOver(int64_t start_index, int64_t end_index) const;
+
 		// Get and Set JSON methods
 		std::string Json() const; ///< Generate JSON string of this object
 		Json::Value JsonValue() const; ///< Generate Json::Value for this object
@@ -0,0 +1,567 @@
+/**
+ * @file
+ * @brief Source file for LiveReader class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+#include <cmath>
+
+#include "LiveReader.h"
+#include "Exceptions.h"
+#include "Frame.h"
+#include "OpenMPUtilities.h"
+#include "ThreadAffinity.h"
+#include "ZmqLogger.h"
+
+#include <QImage>
+
+#if HAVE_AVDEVICE
+extern "C" {
+	#include <libavdevice/avdevice.h>
+}
+#endif
+
+using namespace openshot;
+
+// A live source has no length, so clips of it are this long
+static const double LIVE_DURATION_SECONDS = 24.0 * 60.0 * 60.0;
+
+// Constructor
+LiveReader::LiveReader(const std::string& url, const std::string& format, int ring_size)
+	: url(url), format(format), ring_size(std::max(ring_size, 1)), timeout_ms(1000), is_open(false),
+	  pFormatCtx(NULL), pCodecCtx(NULL), aCodecCtx(NULL), pFrame(NULL), img_convert_ctx(NULL), avr(NULL),
+	  videoStream(-1), audioStream(-1), first_pts(AV_NOPTS_VALUE), stopping(false),
+	  newest_number(0), requested_number(0), dropped_frames(0), source_ended(false)
+{
+	// Initialize FFMpeg, and register all formats and codecs
+	AV_REGISTER_ALL
+	AVCODEC_REGISTER_ALL
+}
+
+// Destructor
+LiveReader::~LiveReader()
+{
+	Close();
+}
+
+// Interrupt the blocking calls of FFmpeg (when the reader is closed)
+int LiveReader::interrupt(void *opaque)
+{
+	return static_cast<LiveReader *>(opaque)->stopping ? 1 : 0;
+}
+
+// Open the decoder of a stream
+AVCodecContext *LiveReader::open_codec(int stream_index)
+{
+	AVStream *stream = pFormatCtx->streams[stream_index];
+	const AVCodec *codec = avcodec_find_decoder(AV_FIND_DECODER_CODEC_ID(stream));
+	if (codec == NULL)
+		return NULL;
+
+	// Return each frame as soon as its packet is decoded (frame threads each hold back a frame)
+	AVCodecContext *context = AV_GET_CODEC_CONTEXT(stream, codec);
+	context->flags |= AV_CODEC_FLAG_LOW_DELAY;
+	context->thread_type = FF_THREAD_SLICE;
+	context->thread_count = std::min(FF_NUM_PROCESSORS, 16);
+	if (avcodec_open2(context, codec, NULL) < 0) {
+		AV_FREE_CONTEXT(context);
+		return NULL;
+	}
+	return context;
+}
+
+// Open the source, and start capturing frames
+void LiveReader::Open()
+{
+	// Open reader if not already open
+	if (is_open)
+		return;
+
+	// Start the decoder threads on the NUMA node of the render (if any, see Settings::NUMA_NODE)
+	ScopedNodeAffinity affinity;
+
+	// Register the capture devices (v4l2, decklink, ...) and the network protocols
+#if HAVE_AVDEVICE
+	static std::once_flag devices_registered;
+	std::call_once(devices_registered, []() { avdevice_register_all(); });
+#endif
+	avformat_network_init();
+
+	auto input_format = format.empty() ? nullptr : av_find_input_format(format.c_str());
+	if (!format.empty() && input_format == NULL)
+		throw InvalidFormat("The input format (or device) is not supported by FFmpeg.", format);
+
+	AVDictionary *opts = NULL;
+	for (const auto& option : options)
+		av_dict_set(&opts, option.first.c_str(), option.second.c_str(), 0);
+
+	// Don't buffer packets while probing the streams (a blocked read is interrupted by Close())
+	stopping = false;
+	pFormatCtx = avformat_alloc_context();
+	if (pFormatCtx == NULL) {
+		av_dict_free(&opts);
+		throw OutOfMemory("Could not allocate memory for AVFormatContext.", url);
+	}
+	pFormatCtx->flags |= AVFMT_FLAG_NOBUFFER;
+	pFormatCtx->interrupt_callback.callback = interrupt;
+	pFormatCtx->interrupt_callback.opaque = this;
+	const int open_error = avformat_open_input(&pFormatCtx, url.c_str(), input_format, &opts);
+	av_dict_free(&opts);
+	if (open_error != 0)
+		throw InvalidFile("The live source could not be opened.", url);
+	if (avformat_find_stream_info(pFormatCtx, NULL) < 0) {
+		free_contexts();
+		throw NoStreamsFound("No streams found in the live source.", url);
+	}
+
+	videoStream = av_find_best_stream(pFormatCtx, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+	audioStream = av_find_best_stream(pFormatCtx, AVMEDIA_TYPE_AUDIO, -1, -1, NULL, 0);
+	if (videoStream < 0 && audioStream < 0) {
+		free_contexts();
+		throw NoStreamsFound("No video or audio stream found in the live source.", url);
+	}
+	if (videoStream >= 0 && (pCodecCtx = open_codec(videoStream)) == NULL) {
+		free_contexts();
+		throw InvalidCodec("A video codec was found, but could not be opened.", url);
+	}
+	if (audioStream >= 0 && (aCodecCtx = open_codec(audioStream)) == NULL) {
+		free_contexts();
+		throw InvalidCodec("An audio codec was found, but could not be opened.", url);
+	}
+
+	// Only the video and audio packets are needed
+	for (unsigned int i = 0; i < pFormatCtx->nb_streams; i++) {
+		if ((int)i != videoStream && (int)i != audioStream)
+			pFormatCtx->streams[i]->discard = AVDISCARD_ALL;
+	}
+
+	pFrame = AV_ALLOCATE_FRAME();
+	if (pFrame == NULL) {
+		free_contexts();
+		throw OutOfMemory("Failed to allocate frame buffer", url);
+	}
+
+	// Update the info struct (a live source has no length, and can't seek)
+	info.has_video = videoStream >= 0;
+	info.has_audio = audioStream >= 0;
+	info.has_single_image = false;
+	info.fps = Fraction(30, 1);
+	if (info.has_video) {
+		AVStream *pStream = pFormatCtx->streams[videoStream];
+		info.width = pCodecCtx->width;
+		info.height = pCodecCtx->height;
+		info.vcodec = pCodecCtx->codec->name;
+		info.video_stream_index = videoStream;
+		info.video_timebase = Fraction(pStream->time_base.num, pStream->time_base.den);
+
+		const AVRational frame_rate = av_guess_frame_rate(pFormatCtx, pStream, NULL);
+		if (frame_rate.num > 0 && frame_rate.den > 0)
+			info.fps = Fraction(frame_rate.num, frame_rate.den);
+		const AVRational sar = av_guess_sample_aspect_ratio(pFormatCtx, pStream, NULL);
+		info.pixel_ratio = (sar.num > 0 && sar.den > 0) ? Fraction(sar.num, sar.den) : Fraction(1, 1);
+		Fraction size(info.width * info.pixel_ratio.num, info.height * info.pixel_ratio.den);
+		size.Reduce();
+		info.display_ratio = size;
+	} else {
+		info.video_timebase = info.fps.Reciprocal();
+	}
+	if (info.has_audio) {
+		AVStream *aStream = pFormatCtx->streams[audioStream];
+		if (aCodecCtx->channel_layout == 0)
+			aCodecCtx->channel_layout = av_get_default_channel_layout(aCodecCtx->channels);
+		info.sample_rate = aCodecCtx->sample_rate;
+		info.channels = aCodecCtx->channels;
+		info.channel_layout = (ChannelLayout) aCodecCtx->channel_layout;
+		info.acodec = aCodecCtx->codec->name;
+		info.audio_stream_index = audioStream;
+		info.audio_timebase = Fraction(aStream->time_base.num, aStream->time_base.den);
+
+		// Convert the samples to float planes (one per channel)
+		avr = SWR_ALLOC();
+		av_opt_set_int(avr, "in_channel_layout", aCodecCtx->channel_layout, 0);
+		av_opt_set_int(avr, "out_channel_layout", aCodecCtx->channel_layout, 0);
+		av_opt_set_int(avr, "in_sample_fmt", aCodecCtx->sample_fmt, 0);
+		av_opt_set_int(avr, "out_sample_fmt", AV_SAMPLE_FMT_FLTP, 0);
+		av_opt_set_int(avr, "in_sample_rate", info.sample_rate, 0);
+		av_opt_set_int(avr, "out_sample_rate", info.sample_rate, 0);
+		av_opt_set_int(avr, "in_channels", info.channels, 0);
+		av_opt_set_int(avr, "out_channels", info.channels, 0);
+		SWR_INIT(avr);
+		pending_audio.assign(info.channels, std::vector<float>());
+	}
+	info.duration = LIVE_DURATION_SECONDS;
+	info.video_length = llround(info.duration * info.fps.ToDouble());
+
+	// Start with an empty ring
+	{
+		const std::lock_guard<std::mutex> lock(ringMutex);
+		ring.clear();
+		newest_number = 0;
+		requested_number = 0;
+		dropped_frames = 0;
+		source_ended = false;
+	}
+	first_pts = AV_NOPTS_VALUE;
+	is_open = true;
+	decode_thread = std::thread(&LiveReader::decode_loop, this);
+
+	ZMQ_DEBUG(
+		"LiveReader::Open",
+		"width", info.width,
+		"height", info.height,
+		"fps", info.fps.ToDouble(),
+		"sample_rate", info.sample_rate,
+		"ring_size", ring_size);
+}
+
+// Free the FFmpeg contexts
+void LiveReader::free_contexts()
+{
+	if (pFrame)
+		AV_FREE_FRAME(&pFrame);
+	if (img_convert_ctx) {
+		sws_freeContext(img_convert_ctx);
+		img_convert_ctx = NULL;
+	}
+	if (avr) {
+		SWR_CLOSE(avr);
+		SWR_FREE(&avr);
+		avr = NULL;
+	}
+	if (pCodecCtx)
+		AV_FREE_CONTEXT(pCodecCtx);
+	if (aCodecCtx)
+		AV_FREE_CONTEXT(aCodecCtx);
+	if (pFormatCtx)
+		avformat_close_input(&pFormatCtx);
+	videoStream = -1;
+	audioStream = -1;
+}
+
+// Stop capturing, and close the source
+void LiveReader::Close()
+{
+	if (!is_open)
+		return;
+
+	// Interrupt the decode thread (even when it waits for the source)
+	stopping = true;
+	if (decode_thread.joinable())
+		decode_thread.join();
+	free_contexts();
+	pending_audio.clear();
+
+	{
+		const std::lock_guard<std::mutex> lock(ringMutex);
+		ring.clear();
+	}
+	is_open = false;
+}
+
+// Decode the packets of the source (on the decode thread)
+void LiveReader::decode_loop()
+{
+	AVPacket *packet = new AVPacket();
+	while (!stopping) {
+		const int read_error = av_read_frame(pFormatCtx, packet);
+		if (read_error == AVERROR(EAGAIN)) {
+			// A device without a new frame yet
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			continue;
+		}
+		if (read_error < 0) {
+			// The stream ended (or the connection was lost)
+			ZMQ_DEBUG("LiveReader::decode_loop (source ended)", "error", read_error);
+			break;
+		}
+
+		if (packet->stream_index == videoStream)
+			decode_video(packet);
+		else if (packet->stream_index == audioStream)
+			decode_audio(packet);
+		AV_FREE_PACKET(packet);
+	}
+	delete packet;
+
+	// Wake the requests which wait for a frame (the ring keeps the last frames)
+	{
+		const std::lock_guard<std::mutex> lock(ringMutex);
+		source_ended = true;
+	}
+	frame_decoded.notify_all();
+}
+
+// Decode a video packet (and add its frames to the ring)
+void LiveReader::decode_video(AVPacket *packet)
+{
+	if (avcodec_send_packet(pCodecCtx, packet) < 0)
+		return;
+
+	while (avcodec_receive_frame(pCodecCtx, pFrame) == 0) {
+		const int64_t pts = (pFrame->best_effort_timestamp != AV_NOPTS_VALUE) ? pFrame->best_effort_timestamp : pFrame->pts;
+
+		// Number the frames by their time (frames which the source skipped leave a gap)
+		int64_t number = newest_number + 1;
+		if (pts != AV_NOPTS_VALUE) {
+			if (first_pts == AV_NOPTS_VALUE)
+				first_pts = pts;
+			const double seconds = (pts - first_pts) * av_q2d(pFormatCtx->streams[videoStream]->time_base);
+			number = std::max(number, int64_t(llround(seconds * info.fps.ToDouble())) + 1);
+		}
+
+		std::shared_ptr<Frame> frame = convert_image(number);
+		av_frame_unref(pFrame);
+		if (!frame)
+			continue;
+
+		// The frame plays the audio which was decoded since the previous frame
+		take_audio(frame, -1);
+		push_frame(frame);
+	}
+}
+
+// Decode an audio packet (and add its samples to the next frame)
+void LiveReader::decode_audio(AVPacket *packet)
+{
+	if (avcodec_send_packet(aCodecCtx, packet) < 0)
+		return;
+
+	while (avcodec_receive_frame(aCodecCtx, pFrame) == 0) {
+		uint8_t **converted = NULL;
+		int converted_linesize = 0;
+		const int capacity = pFrame->nb_samples;
+		if (capacity > 0 && av_samples_alloc_array_and_samples(&converted, &converted_linesize, info.channels,
+															   capacity, AV_SAMPLE_FMT_FLTP, 0) >= 0) {
+			const int count = SWR_CONVERT(avr, converted, converted_linesize, capacity,
+										  pFrame->data, pFrame->linesize[0], pFrame->nb_samples);
+			for (int channel = 0; count > 0 && channel < info.channels; channel++) {
+				const float *samples = reinterpret_cast<const float *>(converted[channel]);
+				std::vector<float>& pending = pending_audio[channel];
+				pending.insert(pending.end(), samples, samples + count);
+
+				// Keep at most a second of audio (while the video stalls)
+				if ((int) pending.size() > info.sample_rate)
+					pending.erase(pending.begin(), pending.end() - info.sample_rate);
+			}
+			av_freep(&converted[0]);
+			av_freep(&converted);
+		}
+		av_frame_unref(pFrame);
+	}
+
+	// Without a video stream, the audio is cut into frames (at the frame rate of the reader)
+	while (videoStream < 0 && !pending_audio.empty()) {
+		const int64_t number = newest_number + 1;
+		const int samples = Frame::GetSamplesPerFrame(number, info.fps, info.sample_rate, info.channels);
+		if ((int) pending_audio[0].size() < samples)
+			break;
+
+		auto frame = std::make_shared<Frame>(number, samples, info.channels);
+		take_audio(frame, samples);
+		push_frame(frame);
+	}
+}
+
+// Convert the decoded picture to a frame
+std::shared_ptr<Frame> LiveReader::convert_image(int64_t number)
+{
+	if (info.width <= 0 || info.height <= 0 || pFrame->width <= 0 || pFrame->height <= 0)
+		return nullptr;
+
+	// Scale straight from the decoded format (the frames keep the size the source was opened with)
+	img_convert_ctx = sws_getCachedContext(img_convert_ctx, pFrame->width, pFrame->height, (AVPixelFormat) pFrame->format,
+										   info.width, info.height, PIX_FMT_RGBA, SWS_FAST_BILINEAR, NULL, NULL, NULL);
+	if (img_convert_ctx == NULL)
+		return nullptr;
+
+	std::shared_ptr<QImage> image = std::make_shared<QImage>(info.width, info.height, QImage::Format_RGBA8888);
+	uint8_t *dst_data[4] = {image->bits(), NULL, NULL, NULL};
+	int dst_linesize[4] = {(int) image->bytesPerLine(), 0, 0, 0};
+	sws_scale(img_convert_ctx, pFrame->data, pFrame->linesize, 0, pFrame->height, dst_data, dst_linesize);
+
+	auto frame = std::make_shared<Frame>(number, info.width, info.height, "#000000", 0, info.channels);
+	frame->SetPixelRatio(info.pixel_ratio.num, info.pixel_ratio.den);
+	frame->AddImage(image);
+	return frame;
+}
+
+// Move the pending audio samples (up to a number of samples) to a frame
+void LiveReader::take_audio(std::shared_ptr<Frame> frame, int samples)
+{
+	frame->SampleRate(info.sample_rate);
+	frame->ChannelsLayout(info.channel_layout);
+	if (pending_audio.empty() || pending_audio[0].empty())
+		return;
+
+	const int count = (samples < 0) ? (int) pending_audio[0].size() : std::min(samples, (int) pending_audio[0].size());
+	frame->ResizeAudio(info.channels, count, info.sample_rate, info.channel_layout);
+	for (int channel = 0; channel < info.channels; channel++) {
+		std::vector<float>& pending = pending_audio[channel];
+		frame->AddAudio(true, channel, 0, pending.data(), count, 1.0f);
+		pending.erase(pending.begin(), pending.begin() + count);
+	}
+}
+
+// Add a frame to the ring (dropping the oldest frame of a full ring)
+void LiveReader::push_frame(std::shared_ptr<Frame> frame)
+{
+	{
+		const std::lock_guard<std::mutex> lock(ringMutex);
+		if (newest_number == 0)
+			start_time = std::chrono::steady_clock::now();
+		ring.push_back(frame);
+		newest_number = frame->number;
+
+		while ((int) ring.size() > ring_size) {
+			if (ring.front()->number > requested_number)
+				dropped_frames++;
+			ring.pop_front();
+		}
+	}
+	frame_decoded.notify_all();
+}
+
+// Get an openshot::Frame object for a specific frame number of this reader
+std::shared_ptr<Frame> LiveReader::GetFrame(int64_t requested_frame)
+{
+	// Check for open reader (or throw exception)
+	if (!is_open)
+		throw ReaderClosed("The LiveReader is closed.  Call Open() before calling this method.", url);
+
+	std::unique_lock<std::mutex> lock(ringMutex);
+
+	// Wait for a frame which is not decoded yet (and repeat the newest frame after the timeout)
+	frame_decoded.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this, requested_frame]() {
+		return newest_number >= requested_frame || source_ended;
+	});
+	if (ring.empty())
+		throw OutOfBoundsFrame("No frames were captured from the live source.", requested_frame, newest_number);
+	requested_number = std::max(requested_number, requested_frame);
+
+	// The newest frame at (or before) the requested frame (or the oldest frame, once the requested frame was dropped)
+	std::shared_ptr<Frame> frame = ring.front();
+	for (const auto& ring_frame : ring) {
+		if (ring_frame->number > requested_frame)
+			break;
+		frame = ring_frame;
+	}
+	lock.unlock();
+	if (frame->number == requested_frame)
+		return frame;
+
+	// Repeat the image (shared until it is modified) with silent audio, under the requested number
+	const int samples = info.has_audio ? Frame::GetSamplesPerFrame(requested_frame, info.fps, info.sample_rate, info.channels) : 0;
+	auto repeated = std::make_shared<Frame>(requested_frame, info.width, info.height, "#000000", samples, info.channels);
+	repeated->SetPixelRatio(info.pixel_ratio.num, info.pixel_ratio.den);
+	repeated->SampleRate(info.sample_rate);
+	repeated->ChannelsLayout(info.channel_layout);
+	if (frame->has_image_data)
+		repeated->AddImage(std::make_shared<QImage>(*frame->GetImage()));
+	return repeated;
+}
+
+// Get the number of the newest decoded frame
+int64_t LiveReader::LatestFrameNumber()
+{
+	const std::lock_guard<std::mutex> lock(ringMutex);
+	return newest_number;
+}
+
+// Get the frame number of the current wall clock time
+int64_t LiveReader::CurrentFrameNumber()
+{
+	const std::lock_guard<std::mutex> lock(ringMutex);
+	if (newest_number == 0)
+		return 0;
+
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+	return int64_t(elapsed.count() * info.fps.ToDouble()) + 1;
+}
+
+// Get the number of frames which were dropped from the ring before they were requested
+int64_t LiveReader::DroppedFrames()
+{
+	const std::lock_guard<std::mutex> lock(ringMutex);
+	return dropped_frames;
+}
+
+// Set the number of recent frames to keep
+void LiveReader::SetRingSize(int frames)
+{
+	const std::lock_guard<std::mutex> lock(ringMutex);
+	ring_size = std::max(frames, 1);
+}
+
+// Generate JSON string of this object
+std::string LiveReader::Json() const {
+
+	// Return formatted string
+	return JsonValue().toStyledString();
+}
+
+// Generate Json::Value for this object
+Json::Value LiveReader::JsonValue() const {
+
+	// Create root json object
+	Json::Value root = ReaderBase::JsonValue(); // get parent properties
+	root["type"] = "LiveReader";
+	root["url"] = url;
+	root["format"] = format;
+	root["ring_size"] = ring_size;
+	root["options"] = Json::Value(Json::objectValue);
+	for (const auto& option : options)
+		root["options"][option.first] = option.second;
+
+	// return JsonValue
+	return root;
+}
+
+// Load JSON string into this object
+void LiveReader::SetJson(const std::string value) {
+
+	try
+	{
+		const Json::Value root = openshot::stringToJson(value);
+		// Set all values that match
+		SetJsonValue(root);
+	}
+	catch (const std::exception& e)
+	{
+		// Error parsing JSON (or missing keys)
+		throw InvalidJSON("JSON is invalid (missing keys or invalid data types)");
+	}
+}
+
+// Load Json::Value into this object
+void LiveReader::SetJsonValue(const Json::Value root) {
+
+	// Set parent data
+	ReaderBase::SetJsonValue(root);
+
+	// Set data from Json (if key is found)
+	if (!root["url"].isNull())
+		url = root["url"].asString();
+	if (!root["format"].isNull())
+		format = root["format"].asString();
+	if (!root["ring_size"].isNull())
+		SetRingSize(root["ring_size"].asInt());
+	if (!root["options"].isNull()) {
+		options.clear();
+		for (const auto& name : root["options"].getMemberNames())
+			options[name] = root["options"][name].asString();
+	}
+
+	// Re-open the source (if needed)
+	if (is_open)
+	{
+		Close();
+		Open();
+	}
+}
@@ -0,0 +1,184 @@
+/**
+ * @file
+ * @brief Header file for LiveReader class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_LIVE_READER_H
+#define OPENSHOT_LIVE_READER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ReaderBase.h"
+#include "FFmpegUtilities.h"
+
+namespace openshot
+{
+	class CacheMemory;
+
+	/**
+	 * @brief This class captures a live source (a capture device, or a network stream) with FFmpeg, and
+	 * keeps a small ring of the most recently decoded frames.
+	 *
+	 * Live sources can't seek, and have no length: a thread decodes the source as its frames arrive, and
+	 * the oldest frame is dropped from the ring (of SetRingSize() frames) when a new frame is decoded, so
+	 * the latency of the reader is bounded by the size of the ring. Frames are numbered by their time
+	 * (since the first frame), at the frame rate of the source.
+	 *
+	 * GetFrame() returns the newest frame at (or before) the requested frame number, and waits for a frame
+	 * which is not decoded yet (up to SetTimeout() milliseconds, before repeating the newest frame). A frame
+	 * which was already dropped is replaced by the oldest frame of the ring. The frames to request by wall
+	 * clock time are returned by CurrentFrameNumber().
+	 *
+	 * The format names the input device or protocol (i.e. "v4l2", "decklink", "flv", "mpegts"), which
+	 * FFmpeg otherwise guesses from the URL. Options of the demuxer or device (i.e. "video_size",
+	 * "framerate", "listen", or a small "probesize") are set with SetOption(). Capture devices need
+	 * FFmpeg's avdevice library (see HAVE_AVDEVICE).
+	 *
+	 * @code
+	 * // Receive a stream pushed to this machine (i.e. by OBS), and composite it live
+	 * LiveReader r("rtmp://0.0.0.0:1935/live/camera", "flv");
+	 * r.SetOption("listen", "1");
+	 * r.Open();
+	 * std::shared_ptr<Frame> f = r.GetFrame(r.CurrentFrameNumber());
+	 * r.Close();
+	 * @endcode
+	 */
+	class LiveReader : public ReaderBase
+	{
+	private:
+		std::string url;
+		std::string format;
+		std::map<std::string, std::string> options;
+		int ring_size;
+		int timeout_ms;
+		bool is_open;
+
+		AVFormatContext *pFormatCtx;
+		AVCodecContext *pCodecCtx;
+		AVCodecContext *aCodecCtx;
+		AVFrame *pFrame;
+		SwsContext *img_convert_ctx;
+		SWRCONTEXT *avr;
+		int videoStream;
+		int audioStream;
+		int64_t first_pts; ///< The PTS of the first video frame (in the time base of the video stream)
+		std::vector<std::vector<float>> pending_audio; ///< The decoded samples (per channel) of the next frame
+
+		std::thread decode_thread;
+		std::atomic<bool> stopping;
+
+		std::mutex ringMutex;
+		std::condition_variable frame_decoded;
+		std::deque<std::shared_ptr<openshot::Frame>> ring; ///< The most recent frames (the oldest first)
+		int64_t newest_number;
+		int64_t requested_number; ///< The newest returned frame (the frames after it are not read yet)
+		int64_t dropped_frames;
+		bool source_ended;
+		std::chrono::steady_clock::time_point start_time; ///< When the first frame was decoded
+
+		/// Interrupt the blocking calls of FFmpeg (when the reader is closed)
+		static int interrupt(void *opaque);
+
+		/// Open the decoder of a stream
+		AVCodecContext *open_codec(int stream_index);
+
+		/// Decode the packets of the source (on the decode thread)
+		void decode_loop();
+
+		/// Decode a video packet (and add its frames to the ring)
+		void decode_video(AVPacket *packet);
+
+		/// Decode an audio packet (and add its samples to the next frame)
+		void decode_audio(AVPacket *packet);
+
+		/// Convert the decoded picture to a frame
+		std::shared_ptr<openshot::Frame> convert_image(int64_t number);
+
+		/// Move the pending audio samples (up to a number of samples) to a frame
+		void take_audio(std::shared_ptr<openshot::Frame> frame, int samples);
+
+		/// Add a frame to the ring (dropping the oldest frame of a full ring)
+		void push_frame(std::shared_ptr<openshot::Frame> frame);
+
+		/// Free the FFmpeg contexts
+		void free_contexts();
+
+	public:
+		/// @brief Constructor for LiveReader
+		/// @param url The URL of the source (i.e. "/dev/video0", "rtmp://0.0.0.0/live/key", "srt://:9000?mode=listener")
+		/// @param format The name of the input format or device (or "" to guess it from the URL)
+		/// @param ring_size The number of recent frames to keep
+		LiveReader(const std::string& url, const std::string& format = "", int ring_size = 8);
+
+		/// Destructor
+		virtual ~LiveReader();
+
+		/// Stop capturing, and close the source
+		void Close() override;
+
+		/// Get the number of frames which were dropped from the ring before they were read (the reader fell behind)
+		int64_t DroppedFrames();
+
+		/// Get the frame number of the current wall clock time (the number of frames since the first frame was decoded)
+		int64_t CurrentFrameNumber();
+
+		/// Get the cache object used by this reader (always returns NULL for this reader)
+		CacheMemory* GetCache() override { return NULL; };
+
+		/// @brief Get an openshot::Frame object for a specific frame number of this reader (without seeking)
+		///
+		/// @returns The requested frame (or the nearest frame which is still in the ring, renumbered with silent audio)
+		/// @param requested_frame The frame number that is requested
+		std::shared_ptr<openshot::Frame> GetFrame(int64_t requested_frame) override;
+
+		/// Determine if reader is open or closed
+		bool IsOpen() override { return is_open; };
+
+		/// Get the number of the newest decoded frame (0 before the first frame)
+		int64_t LatestFrameNumber();
+
+		/// Return the type name of the class
+		std::string Name() override { return "LiveReader"; };
+
+		/// @brief Set an option of the demuxer, device or protocol (before opening the reader)
+		/// @param name The name of the option (i.e. "video_size", "framerate", "listen", "probesize")
+		/// @param value The value of the option
+		void SetOption(const std::string& name, const std::string& value) { options[name] = value; };
+
+		/// @brief Set the number of recent frames to keep (before opening the reader)
+		/// @param frames The size of the ring (at least 1)
+		void SetRingSize(int frames);
+
+		/// @brief Set the max milliseconds to wait for a frame which is not decoded yet
+		/// @param milliseconds The timeout (in milliseconds)
+		void SetTimeout(int milliseconds) { timeout_ms = milliseconds; };
+
+		// Get and Set JSON methods
+		std::string Json() const override; ///< Generate JSON string of this object
+		void SetJson(const std::string value) override; ///< Load JSON string into this object
+		Json::Value JsonValue() const override; ///< Generate Json::Value for this object
+		void SetJsonValue(const Json::Value root) override; ///< Load Json::Value into this object
+
+		/// Open the source, and start capturing frames
+		void Open() override;
+	};
+
+}
+
+#endif
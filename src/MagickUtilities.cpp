@@ -48,10 +48,10 @@ openshot::Magick2QImage(std::shared_ptr<Magick::Image> image)
     if (!image)
         return nullptr;
 
-    const int BPP = 4;
-    const std::size_t size = image->columns() * image->rows() * BPP;
-
-    auto* qbuffer = new unsigned char[size]();
+    // Export the pixels directly into the QImage buffer (RGBA rows are never padded)
+    auto qimage = std::make_shared<QImage>(
+        image->columns(), image->rows(),
+        QImage::Format_RGBA8888_Premultiplied);
 
     MagickCore::ExceptionInfo exception;
     // TODO: Actually do something, if we get an exception here
@@ -59,14 +59,8 @@ openshot::Magick2QImage(std::shared_ptr<Magick::Image> image)
         image->constImage(), 0, 0,
         image->columns(), image->rows(),
         "RGBA", Magick::CharPixel,
-        qbuffer, &exception);
+        qimage->bits(), &exception);
 
-    auto qimage = std::make_shared<QImage>(
-        qbuffer, image->columns(), image->rows(),
-        image->columns() * BPP,
-        QImage::Format_RGBA8888_Premultiplied,
-        (QImageCleanupFunction) &openshot::cleanUpBuffer,
-        (void*) qbuffer);
     return qimage;
 }
 
@@ -0,0 +1,149 @@
+/**
+ * @file
+ * @brief Source file for MaskCache class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <QImage>
+
+#include "MaskCache.h"
+#include "PixelKernels.h"
+
+using namespace openshot;
+
+// Global reference to the cache
+MaskCache *MaskCache::m_pInstance = nullptr;
+
+// Default constructor (default to 128 MB of planes, which is 16 planes at 1920x1080)
+MaskCache::MaskCache() : total_bytes(0), max_bytes(128 * 1024 * 1024) { }
+
+// Create or Get an instance of the cache singleton
+MaskCache *MaskCache::Instance()
+{
+	// Create the actual instance of the cache only once (frames are rendered on many threads)
+	static std::once_flag created;
+	std::call_once(created, []() { m_pInstance = new MaskCache; });
+
+	return m_pInstance;
+}
+
+// Scale a mask image, and convert it to a grayscale plane
+std::shared_ptr<const MaskPlane> MaskCache::CreatePlane(const QImage& mask_image, int width, int height)
+{
+	// Resize mask image to match frame size
+	QImage scaled_mask = mask_image.scaled(width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+	PixelKernels::ToPremultipliedRGBA(scaled_mask);
+
+	auto plane = std::make_shared<MaskPlane>();
+	plane->width = scaled_mask.width();
+	plane->height = scaled_mask.height();
+	const int64_t pixel_count = int64_t(plane->width) * plane->height;
+	plane->gray.resize(pixel_count);
+	plane->alpha.resize(pixel_count);
+
+	// Get the gray value (and alpha) of each pixel
+	#pragma omp parallel for
+	for (int row = 0; row < plane->height; ++row) {
+		const unsigned char *pixels = scaled_mask.constScanLine(row);
+		const int64_t start = int64_t(row) * plane->width;
+		for (int col = 0; col < plane->width; ++col) {
+			plane->gray[start + col] = qGray(pixels[col * 4], pixels[col * 4 + 1], pixels[col * 4 + 2]);
+			plane->alpha[start + col] = pixels[col * 4 + 3];
+		}
+	}
+
+	return plane;
+}
+
+// Get a cached plane
+std::shared_ptr<const MaskPlane> MaskCache::GetPlane(const std::string& mask, int64_t frame_number, int width, int height)
+{
+	const std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+
+	auto found = index.find(PlaneKey(mask, frame_number, width, height));
+	if (found == index.end())
+		return std::shared_ptr<const MaskPlane>();
+
+	// Move plane to the front (most recently used)
+	planes.splice(planes.begin(), planes, found->second);
+	return found->second->second;
+}
+
+// Add a plane to the cache
+void MaskCache::Add(const std::string& mask, int64_t frame_number, std::shared_ptr<const MaskPlane> plane)
+{
+	if (!plane)
+		return;
+
+	const std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+	const PlaneKey key(mask, frame_number, plane->width, plane->height);
+
+	// Replace previous version (if any)
+	auto found = index.find(key);
+	if (found != index.end()) {
+		total_bytes -= found->second->second->GetBytes();
+		planes.erase(found->second);
+		index.erase(found);
+	}
+
+	// Add to the front (most recently used)
+	planes.emplace_front(key, plane);
+	index[key] = planes.begin();
+	total_bytes += plane->GetBytes();
+
+	Evict();
+}
+
+// Remove the least recently used planes (until the cache fits)
+void MaskCache::Evict()
+{
+	while (total_bytes > max_bytes && !planes.empty()) {
+		total_bytes -= planes.back().second->GetBytes();
+		index.erase(planes.back().first);
+		planes.pop_back();
+	}
+}
+
+// Remove all cached planes
+void MaskCache::Clear()
+{
+	const std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+	planes.clear();
+	index.clear();
+	total_bytes = 0;
+}
+
+// Count the cached planes
+int64_t MaskCache::Count()
+{
+	const std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+	return planes.size();
+}
+
+// Get the total size of all cached planes
+int64_t MaskCache::GetBytes()
+{
+	const std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+	return total_bytes;
+}
+
+// Get the max size of all cached planes
+int64_t MaskCache::GetMaxBytes()
+{
+	const std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+	return max_bytes;
+}
+
+// Set the max size of all cached planes (0 disables caching)
+void MaskCache::SetMaxBytes(int64_t number_of_bytes)
+{
+	const std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+	max_bytes = number_of_bytes;
+	Evict();
+}
@@ -0,0 +1,125 @@
+/**
+ * @file
+ * @brief Header file for MaskCache class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_MASK_CACHE_H
+#define OPENSHOT_MASK_CACHE_H
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+class QImage;
+
+namespace openshot {
+
+	/**
+	 * @brief The grayscale version of a mask image, scaled to the size of a frame (see openshot::Mask)
+	 */
+	struct MaskPlane
+	{
+		int width; ///< The width of the plane
+		int height; ///< The height of the plane
+		std::vector<unsigned char> gray; ///< The gray value (qGray) of each pixel
+		std::vector<unsigned char> alpha; ///< The alpha value of each pixel
+
+		/// Get the size of the plane (in bytes)
+		int64_t GetBytes() const { return int64_t(gray.size()) + int64_t(alpha.size()); }
+	};
+
+	/**
+	 * @brief This singleton class caches scaled mask planes, which are shared by all openshot::Mask effects
+	 *
+	 * Scaling a mask image (with smooth transformation) to the frame size, and converting it to grayscale,
+	 * is the most expensive part of a mask or wipe transition. The same wipe is usually used on many clips
+	 * (and with the same frame size), so the planes are cached by mask (i.e. the reader JSON), frame number
+	 * and size. The least recently used planes are removed once the cache exceeds GetMaxBytes().
+	 *
+	 * \code
+	 * std::shared_ptr<const MaskPlane> plane = MaskCache::Instance()->GetPlane(key, 1, 1920, 1080);
+	 * if (!plane) {
+	 *     plane = MaskCache::CreatePlane(*mask_image, 1920, 1080);
+	 *     MaskCache::Instance()->Add(key, 1, plane);
+	 * }
+	 * \endcode
+	 */
+	class MaskCache {
+	private:
+		/// The mask, frame number, width and height of a plane
+		typedef std::tuple<std::string, int64_t, int, int> PlaneKey;
+
+		std::recursive_mutex cacheMutex;
+		std::list<std::pair<PlaneKey, std::shared_ptr<const MaskPlane>>> planes; ///< Cached planes (most recently used first)
+		std::map<PlaneKey, decltype(planes)::iterator> index; ///< Position of each plane in the list
+		int64_t total_bytes; ///< Total size of all cached planes
+		int64_t max_bytes; ///< Max size of all cached planes
+
+		/// Private variable to keep track of singleton instance
+		static MaskCache *m_pInstance;
+
+		/// Default constructor
+		MaskCache();
+
+		/// Don't allow the user to copy or assign this instance
+		MaskCache(MaskCache const&) = delete;
+		MaskCache & operator=(MaskCache const&) = delete;
+
+		/// Remove the least recently used planes (until the cache fits)
+		void Evict();
+
+	public:
+		/// Create or get an instance of this cache singleton (invoke the class with this method)
+		static MaskCache *Instance();
+
+		/// @brief Scale a mask image, and convert it to a grayscale plane
+		/// @param mask_image The mask image
+		/// @param width The width of the plane (i.e. the frame width)
+		/// @param height The height of the plane (i.e. the frame height)
+		static std::shared_ptr<const MaskPlane> CreatePlane(const QImage& mask_image, int width, int height);
+
+		/// @brief Get a cached plane (or NULL shared_ptr if the plane is not cached)
+		/// @param mask The identity of the mask (i.e. the JSON of its reader)
+		/// @param frame_number The frame number of the mask
+		/// @param width The width of the plane
+		/// @param height The height of the plane
+		std::shared_ptr<const MaskPlane> GetPlane(const std::string& mask, int64_t frame_number, int width, int height);
+
+		/// @brief Add a plane to the cache (replacing the previous plane with the same key, if any)
+		/// @param mask The identity of the mask (i.e. the JSON of its reader)
+		/// @param frame_number The frame number of the mask
+		/// @param plane The plane (which must not be modified anymore)
+		void Add(const std::string& mask, int64_t frame_number, std::shared_ptr<const MaskPlane> plane);
+
+		/// Remove all cached planes
+		void Clear();
+
+		/// Count the cached planes
+		int64_t Count();
+
+		/// Get the total size of all cached planes (in bytes)
+		int64_t GetBytes();
+
+		/// Get the max size of all cached planes (in bytes)
+		int64_t GetMaxBytes();
+
+		/// @brief Set the max size of all cached planes (in bytes). Set to 0 to disable caching.
+		/// @param number_of_bytes The max number of bytes of planes to keep
+		void SetMaxBytes(int64_t number_of_bytes);
+	};
+
+}
+
+#endif
@@ -0,0 +1,192 @@
+/**
+ * @file
+ * @brief Source file for MultiWriter class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "MultiWriter.h"
+#include "Exceptions.h"
+#include "FFmpegWriter.h"
+#include "Frame.h"
+#include "ReaderBase.h"
+#include "RenderTrace.h"
+#include "ZmqLogger.h"
+
+using namespace openshot;
+
+// Default constructor
+MultiWriter::MultiWriter() : queue_size(8), is_open(false), is_stopping(false), output_error(nullptr) {
+	info.has_audio = false;
+	info.has_video = false;
+}
+
+// Close the outputs (if still open)
+MultiWriter::~MultiWriter() {
+	try {
+		if (is_open)
+			Close();
+	} catch (...) {
+		// The errors of the outputs can't be raised here
+	}
+}
+
+// Add an output
+void MultiWriter::AddWriter(FFmpegWriter* writer) {
+	if (is_open)
+		throw InvalidOptions("Outputs must be added before the writer is opened.");
+
+	auto output = std::make_unique<Output>();
+	output->writer = writer;
+	outputs.push_back(std::move(output));
+}
+
+// Get the outputs
+std::vector<FFmpegWriter*> MultiWriter::Writers() const {
+	std::vector<FFmpegWriter*> writers;
+	for (const auto& output : outputs)
+		writers.push_back(output->writer);
+	return writers;
+}
+
+// Open the outputs (and start their threads)
+void MultiWriter::Open() {
+	if (is_open)
+		return;
+	if (outputs.empty())
+		throw InvalidOptions("The MultiWriter has no outputs.  Call AddWriter() before opening it.");
+
+	for (auto& output : outputs) {
+		if (!output->writer->IsOpen())
+			output->writer->Open();
+	}
+
+	// Describe the first output (i.e. the largest rendition)
+	info = outputs.front()->writer->info;
+
+	output_error = nullptr;
+	is_stopping = false;
+	for (auto& output : outputs)
+		output->thread = std::thread(&MultiWriter::encode_frames, this, output.get());
+	is_open = true;
+
+	ZMQ_DEBUG("MultiWriter::Open", "outputs", outputs.size(), "queue_size", queue_size);
+}
+
+// Encode the queued frames of an output (on its thread)
+void MultiWriter::encode_frames(Output* output) {
+	RenderTrace::Instance()->SetThreadName("MultiWriter output");
+	while (true) {
+		std::shared_ptr<Frame> frame;
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			queue_changed.wait(lock, [&]() { return is_stopping || !output->frames.empty(); });
+			if (output->frames.empty())
+				return;
+			frame = output->frames.front();
+		}
+
+		try {
+			output->writer->WriteFrame(frame);
+		} catch (...) {
+			const std::lock_guard<std::mutex> lock(queueMutex);
+			if (!output_error)
+				output_error = std::current_exception();
+		}
+
+		// The frame stays in the queue while it's encoded (so it counts against the queue size)
+		{
+			const std::lock_guard<std::mutex> lock(queueMutex);
+			output->frames.pop_front();
+		}
+		queue_changed.notify_all();
+	}
+}
+
+// Raise the first error of an output (if any)
+void MultiWriter::check_error() {
+	std::exception_ptr error;
+	{
+		const std::lock_guard<std::mutex> lock(queueMutex);
+		error = output_error;
+		output_error = nullptr;
+	}
+	if (error)
+		std::rethrow_exception(error);
+}
+
+// Stop the threads of the outputs (after encoding the queued frames)
+void MultiWriter::stop_threads() {
+	{
+		const std::lock_guard<std::mutex> lock(queueMutex);
+		is_stopping = true;
+	}
+	queue_changed.notify_all();
+	for (auto& output : outputs) {
+		if (output->thread.joinable())
+			output->thread.join();
+	}
+}
+
+// Encode the queued frames, and close the outputs
+void MultiWriter::Close() {
+	if (!is_open)
+		return;
+
+	stop_threads();
+	is_open = false;
+
+	// Close every output (even if one of them fails)
+	for (auto& output : outputs) {
+		try {
+			output->writer->Close();
+		} catch (...) {
+			const std::lock_guard<std::mutex> lock(queueMutex);
+			if (!output_error)
+				output_error = std::current_exception();
+		}
+	}
+
+	ZMQ_DEBUG("MultiWriter::Close");
+	check_error();
+}
+
+// Queue a frame for every output
+void MultiWriter::WriteFrame(std::shared_ptr<Frame> frame) {
+	if (!is_open)
+		throw WriterClosed("The MultiWriter is closed.  Call Open() before calling this method.");
+	check_error();
+
+	{
+		// Wait for room in every queue (i.e. for the slowest encoder)
+		std::unique_lock<std::mutex> lock(queueMutex);
+		queue_changed.wait(lock, [&]() {
+			for (const auto& output : outputs) {
+				if ((int) output->frames.size() >= queue_size)
+					return false;
+			}
+			return true;
+		});
+
+		// Every output shares the frame (and only reads it)
+		for (auto& output : outputs)
+			output->frames.push_back(frame);
+	}
+	queue_changed.notify_all();
+}
+
+// Render a block of frames of a reader (once), and queue them for every output
+void MultiWriter::WriteFrame(ReaderBase* reader, int64_t start, int64_t length) {
+	ZMQ_DEBUG(
+		"MultiWriter::WriteFrame (from Reader)",
+		"start", start,
+		"length", length);
+
+	for (int64_t number = start; number <= length; number++)
+		WriteFrame(reader->GetFrame(number));
+}
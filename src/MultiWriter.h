@@ -0,0 +1,132 @@
+/**
+ * @file
+ * @brief Header file for MultiWriter class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_MULTI_WRITER_H
+#define OPENSHOT_MULTI_WRITER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "WriterBase.h"
+
+namespace openshot {
+
+	// Forward declarations
+	class FFmpegWriter;
+	class Frame;
+	class ReaderBase;
+
+	/**
+	 * @brief This class writes each frame to several FFmpegWriter outputs (i.e. the renditions of an
+	 * adaptive bit rate ladder), so the timeline renders each frame only once.
+	 *
+	 * Each output is encoded on a thread of its own, and converts (and scales) the frames to its own size
+	 * and codec, so the timeline should render at the size of the largest output. Each output has a queue
+	 * of frames waiting to be encoded: WriteFrame() waits while any queue is full, so the renderer runs at
+	 * most SetQueueSize() frames ahead of the slowest encoder. The outputs are not owned by this writer,
+	 * and they must be configured (and prepared) before Open(), which opens them.
+	 *
+	 * \code
+	 * FFmpegWriter w2160("ladder-2160.mp4");
+	 * w2160.SetVideoOptions(true, "libx264", Fraction(30,1), 3840, 2160, Fraction(1,1), false, false, 20000000);
+	 * FFmpegWriter w720("ladder-720.mp4");
+	 * w720.SetVideoOptions(true, "libx264", Fraction(30,1), 1280, 720, Fraction(1,1), false, false, 3000000);
+	 *
+	 * // Render the timeline once (at 2160p), and encode both renditions
+	 * MultiWriter w;
+	 * w.AddWriter(&w2160);
+	 * w.AddWriter(&w720);
+	 * w.Open();
+	 * w.WriteFrame(&timeline, 1, 9000);
+	 * w.Close();
+	 * \endcode
+	 *
+	 * An error of any output is raised by the next call to WriteFrame() or Close() (and the other outputs
+	 * keep encoding until Close()).
+	 */
+	class MultiWriter : public WriterBase {
+	private:
+		/// An output, and the frames waiting to be encoded by it
+		struct Output {
+			openshot::FFmpegWriter* writer;
+			std::deque<std::shared_ptr<openshot::Frame>> frames;
+			std::thread thread;
+		};
+
+		std::vector<std::unique_ptr<Output>> outputs;
+		int queue_size;
+		bool is_open;
+
+		std::mutex queueMutex;
+		std::condition_variable queue_changed;
+		bool is_stopping;
+		std::exception_ptr output_error; ///< The first error of an output
+
+		/// Encode the queued frames of an output (on its thread)
+		void encode_frames(Output* output);
+
+		/// Raise the first error of an output (if any)
+		void check_error();
+
+		/// Stop the threads of the outputs (after encoding the queued frames)
+		void stop_threads();
+
+	public:
+		/// Default constructor
+		MultiWriter();
+
+		/// Close the outputs (if still open)
+		virtual ~MultiWriter();
+
+		/// @brief Add an output (which must stay alive while this writer is used)
+		/// @param writer The FFmpegWriter of the output, with its options set
+		void AddWriter(openshot::FFmpegWriter* writer);
+
+		/// Get the outputs
+		std::vector<openshot::FFmpegWriter*> Writers() const;
+
+		/// Get the number of frames each output can queue (see SetQueueSize)
+		int GetQueueSize() const { return queue_size; };
+
+		/// @brief Set the number of frames each output can queue, before WriteFrame() waits for it
+		/// @param new_size The number of frames (at least 1)
+		void SetQueueSize(int new_size) { queue_size = (new_size < 1) ? 1 : new_size; };
+
+		/// Determine if writer is open or closed
+		bool IsOpen() override { return is_open; };
+
+		/// Open the outputs (and start their threads)
+		void Open() override;
+
+		/// Encode the queued frames, and close the outputs (writing their trailers)
+		void Close();
+
+		/// @brief Queue a frame for every output
+		/// @param frame The frame to encode
+		void WriteFrame(std::shared_ptr<openshot::Frame> frame) override;
+
+		/// @brief Render a block of frames of a reader (once), and queue them for every output
+		/// @param reader The reader (i.e. a timeline) which renders the frames
+		/// @param start The first frame number
+		/// @param length The last frame number
+		void WriteFrame(openshot::ReaderBase* reader, int64_t start, int64_t length) override;
+	};
+
+}
+
+#endif
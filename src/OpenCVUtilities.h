@@ -26,7 +26,61 @@
     #define OPENCV_TRACKER_TYPE cv::Tracker
     #define OPENCV_TRACKER_NS cv
 #endif
+#include <opencv2/core.hpp>
+#include <opencv2/core/ocl.hpp>
+#include <opencv2/imgproc.hpp>
 #undef int64
 #undef uint64
 
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+#include <QImage>
+
+#include "Frame.h"
+#include "Settings.h"
+
+namespace openshot
+{
+    /// @brief Get the size images are analysed at by the CV jobs (a smaller analysis size is much faster,
+    /// and almost as accurate, since all results are normalized to the image size)
+    /// @param size The full size of the images
+    /// @param max_height The max height of the analysed images (0 = full size)
+    inline cv::Size AnalysisSize(cv::Size size, int max_height) {
+        if (max_height <= 0 || size.height <= max_height || size.height <= 0)
+            return size;
+        return cv::Size(std::max(1, (int) std::round(size.width * max_height / (double) size.height)), max_height);
+    }
+
+    /// @brief Determine if OpenCV runs on an OpenCL device (with cv::UMat images), see Settings::OPENCV_USE_OPENCL.
+    /// This also turns OpenCL on (or off) for OpenCV calls of the current thread.
+    inline bool UseOpenCL() {
+        const bool enabled = openshot::Settings::Instance()->OPENCV_USE_OPENCL && cv::ocl::haveOpenCL();
+        cv::ocl::setUseOpenCL(enabled);
+        return enabled && cv::ocl::useOpenCL();
+    }
+
+    /// @brief Get the image of a frame as an OpenCV Mat (BGR by default), scaled to the analysis size. The
+    /// frame's RGBA pixels are wrapped (not copied), scaled, and converted in a single pass.
+    /// @param frame The frame
+    /// @param size The size of the returned image
+    /// @param code The color conversion from RGBA (i.e. cv::COLOR_RGBA2GRAY)
+    inline cv::Mat GetAnalysisImageCV(std::shared_ptr<openshot::Frame> frame, cv::Size size, int code = cv::COLOR_RGBA2BGR) {
+        std::shared_ptr<QImage> image = frame->GetImage();
+        if (!image)
+            return frame->GetImageCV();
+
+        // Wrap the RGBA pixels (without copying them), and scale them down
+        const cv::Mat rgba(image->height(), image->width(), CV_8UC4, (uchar*) image->constBits(), image->bytesPerLine());
+        cv::Mat scaled = rgba;
+        if (rgba.size() != size)
+            cv::resize(rgba, scaled, size, 0, 0, cv::INTER_AREA);
+
+        cv::Mat converted;
+        cv::cvtColor(scaled, converted, code);
+        return converted;
+    }
+}
+
 #endif  // OPENSHOT_OPENCV_UTILITIES_H
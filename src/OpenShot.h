@@ -109,6 +109,9 @@
 #include "AudioResampler.h"
 #include "CacheDisk.h"
 #include "CacheMemory.h"
+#include "CacheMemorySharded.h"
+#include "CacheTiered.h"
+#include "Calibration.h"
 #include "ChunkReader.h"
 #include "ChunkWriter.h"
 #include "Clip.h"
@@ -126,19 +129,30 @@
 #include "FFmpegWriter.h"
 #include "Fraction.h"
 #include "Frame.h"
+#include "FrameIterator.h"
+#include "FrameRequest.h"
 #include "FrameMapper.h"
+#include "ImageSequenceReader.h"
 #ifdef USE_IMAGEMAGICK
 	#include "ImageReader.h"
 	#include "ImageWriter.h"
 	#include "TextReader.h"
 #endif
 #include "KeyFrame.h"
+#include "LiveReader.h"
+#include "MultiWriter.h"
 #include "PlayerBase.h"
 #include "Point.h"
 #include "Profiles.h"
+#include "ProxyGenerator.h"
 #include "QtHtmlReader.h"
 #include "QtImageReader.h"
 #include "QtTextReader.h"
+#include "RenderFarm.h"
+#include "SegmentedWriter.h"
+#include "SharedMemoryReader.h"
+#include "SharedMemoryWriter.h"
+#include "ThumbnailExtractor.h"
 #include "TimelineBase.h"
 #include "Timeline.h"
 #include "Settings.h"
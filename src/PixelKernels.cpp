@@ -0,0 +1,1170 @@
+/**
+ * @file
+ * @brief Source file for PixelKernels class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <QImage>
+
+#include "PixelKernels.h"
+#include "TaskExecutor.h"
+
+using namespace openshot;
+
+// Compile each block kernel for several instruction sets, and let the loader pick the best one
+// for this CPU (this requires ifunc support, so other platforms use the compiler's baseline)
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__linux__) && defined(__has_attribute)
+	#if __has_attribute(target_clones)
+		#define PIXEL_KERNEL_CLONES 1
+		#define PIXEL_KERNEL __attribute__((target_clones("avx2", "sse4.1", "default")))
+	#endif
+#endif
+#ifndef PIXEL_KERNEL
+	#define PIXEL_KERNEL_CLONES 0
+	#define PIXEL_KERNEL
+#endif
+
+// The color helpers must be inlined into the kernel loops (function calls can't be vectorized)
+#if defined(__GNUC__)
+	#define PIXEL_INLINE inline __attribute__((always_inline))
+#else
+	#define PIXEL_INLINE inline
+#endif
+
+// Number of pixels processed at once by each thread
+static const int64_t BLOCK_PIXELS = 16384;
+
+// Number of columns blurred together by each thread, in the vertical blur pass
+static const int BLUR_STRIP_PIXELS = 256;
+
+// Size of the canvas tiles blended by each thread, when compositing layers
+static const int COMPOSITE_TILE_PIXELS = 512;
+static const int COMPOSITE_TILE_ROWS = 32;
+
+// Number of pixels of a block kept in (floating point) registers / L1 cache by the fused kernel
+static const int TILE_PIXELS = 256;
+
+// Ordered dither thresholds (a 4x4 Bayer matrix, in 1/16ths of an 8-bit step)
+static const float DITHER_4X4[4][4] = {
+	{ 0.5f / 16.0f, 8.5f / 16.0f, 2.5f / 16.0f, 10.5f / 16.0f },
+	{ 12.5f / 16.0f, 4.5f / 16.0f, 14.5f / 16.0f, 6.5f / 16.0f },
+	{ 3.5f / 16.0f, 11.5f / 16.0f, 1.5f / 16.0f, 9.5f / 16.0f },
+	{ 15.5f / 16.0f, 7.5f / 16.0f, 13.5f / 16.0f, 5.5f / 16.0f },
+};
+
+// Constants used for color saturation formula
+static const float SATURATION_PR = .299f;
+static const float SATURATION_PG = .587f;
+static const float SATURATION_PB = .114f;
+static const float SATURATION_SQRT_PR = 0.5468089f;
+static const float SATURATION_SQRT_PG = 0.7661593f;
+static const float SATURATION_SQRT_PB = 0.3376389f;
+
+// Clamp a color value to the 0 - 255 range
+static PIXEL_INLINE float clamp_color(float value) {
+	return std::min(std::max(value, 0.0f), 255.0f);
+}
+
+// Remove pre-multiplied alpha from a color value (fully transparent pixels stay transparent, since they are multiplied by 0 again)
+static PIXEL_INLINE float unpremultiply(float value, float alpha) {
+	return std::min(value * (255.0f / std::max(alpha, 1.0f)), 255.0f);
+}
+
+// Multiply a color value by alpha (and round to the nearest byte)
+static PIXEL_INLINE unsigned char premultiply(float value, float alpha) {
+	return (unsigned char) (value * alpha * (1.0f / 255.0f) + 0.5f);
+}
+
+// Apply constrained contrast adjustment, and then brightness (to un-premultiplied colors)
+static PIXEL_INLINE void brightness_contrast(float &R, float &G, float &B, float offset, float factor) {
+	R = clamp_color(clamp_color(factor * (R - 128.0f) + 128.0f) + offset);
+	G = clamp_color(clamp_color(factor * (G - 128.0f) + 128.0f) + offset);
+	B = clamp_color(clamp_color(factor * (B - 128.0f) + 128.0f) + offset);
+}
+
+// Adjust the saturation of un-premultiplied colors
+static PIXEL_INLINE void saturation(float &R, float &G, float &B, float saturation, float saturation_r, float saturation_g, float saturation_b) {
+	// Common saturation adjustment
+	const float common = std::sqrt((R * R * SATURATION_PR) + (G * G * SATURATION_PG) + (B * B * SATURATION_PB));
+	R = clamp_color(common + (R - common) * saturation);
+	G = clamp_color(common + (G - common) * saturation);
+	B = clamp_color(common + (B - common) * saturation);
+
+	// Color-separated saturation adjustment: each subpixel is split into three sub-subpixels, which
+	// reproduce the original subpixel's color OR white light of the same brightness (depending on
+	// the channel's saturation), and the sub-subpixels are recombined into subpixels again
+	const float p_r = R * SATURATION_SQRT_PR;
+	const float p_g = G * SATURATION_SQRT_PG;
+	const float p_b = B * SATURATION_SQRT_PB;
+	const float r_white = p_r * (1.0f - saturation_r);
+	const float g_white = p_g * (1.0f - saturation_g);
+	const float b_white = p_b * (1.0f - saturation_b);
+	const float new_R = p_r + (R - p_r) * saturation_r + g_white + b_white;
+	const float new_G = r_white + p_g + (G - p_g) * saturation_g + b_white;
+	const float new_B = r_white + g_white + p_b + (B - p_b) * saturation_b;
+	R = clamp_color(new_R);
+	G = clamp_color(new_G);
+	B = clamp_color(new_B);
+}
+
+// Multiply un-premultiplied colors by the hue rotation matrix
+static PIXEL_INLINE void hue_rotate(float &R, float &G, float &B, float m0, float m1, float m2) {
+	const float old_R = R;
+	const float old_G = G;
+	const float old_B = B;
+	R = clamp_color(old_R * m0 + old_G * m1 + old_B * m2);
+	G = clamp_color(old_R * m2 + old_G * m0 + old_B * m1);
+	B = clamp_color(old_R * m1 + old_G * m2 + old_B * m0);
+}
+
+// Interpolate one channel of a lookup table between the 8 corners of a cell (and scale it to 0 - 255)
+static PIXEL_INLINE float trilinear(const float *table, int index, int red_stride, int green_stride, int blue_stride, float dr, float dg, float db) {
+	const float c000 = table[index];
+	const float c100 = table[index + red_stride];
+	const float c010 = table[index + green_stride];
+	const float c110 = table[index + green_stride + red_stride];
+	const float c001 = table[index + blue_stride];
+	const float c101 = table[index + blue_stride + red_stride];
+	const float c011 = table[index + blue_stride + green_stride];
+	const float c111 = table[index + blue_stride + green_stride + red_stride];
+	const float c00 = c000 + (c100 - c000) * dr;
+	const float c10 = c010 + (c110 - c010) * dr;
+	const float c01 = c001 + (c101 - c001) * dr;
+	const float c11 = c011 + (c111 - c011) * dr;
+	const float c0 = c00 + (c10 - c00) * dg;
+	const float c1 = c01 + (c11 - c01) * dg;
+	return clamp_color((c0 + (c1 - c0) * db) * 255.0f);
+}
+
+// Divide the product of two bytes by 255 (with rounding, like Qt does when premultiplying)
+static PIXEL_INLINE int div_255(int value) {
+	value += 128;
+	return (value + (value >> 8)) >> 8;
+}
+
+// Compute contrast adjustment factor
+static PIXEL_INLINE float contrast_factor(float contrast) {
+	return (259.0f * (contrast + 255.0f)) / (255.0f * (259.0f - contrast));
+}
+
+// Adjust the brightness and contrast of a block of pixels
+PIXEL_KERNEL
+static void brightness_contrast_block(unsigned char * __restrict pixels, int64_t pixel_count, float brightness, float factor)
+{
+	const float offset = 255.0f * brightness;
+
+	#pragma omp simd
+	for (int64_t pixel = 0; pixel < pixel_count; ++pixel)
+	{
+		unsigned char *p = pixels + pixel * 4;
+		const float A = p[3];
+		float R = unpremultiply(p[0], A);
+		float G = unpremultiply(p[1], A);
+		float B = unpremultiply(p[2], A);
+
+		brightness_contrast(R, G, B, offset, factor);
+
+		p[0] = premultiply(R, A);
+		p[1] = premultiply(G, A);
+		p[2] = premultiply(B, A);
+	}
+}
+
+// Adjust the saturation of a block of pixels
+PIXEL_KERNEL
+static void saturation_block(unsigned char * __restrict pixels, int64_t pixel_count, float saturation_all, float saturation_r, float saturation_g, float saturation_b)
+{
+	#pragma omp simd
+	for (int64_t pixel = 0; pixel < pixel_count; ++pixel)
+	{
+		unsigned char *p = pixels + pixel * 4;
+		const float A = p[3];
+		float R = unpremultiply(p[0], A);
+		float G = unpremultiply(p[1], A);
+		float B = unpremultiply(p[2], A);
+
+		saturation(R, G, B, saturation_all, saturation_r, saturation_g, saturation_b);
+
+		p[0] = premultiply(R, A);
+		p[1] = premultiply(G, A);
+		p[2] = premultiply(B, A);
+	}
+}
+
+// Rotate the hue of a block of pixels
+PIXEL_KERNEL
+static void hue_rotate_block(unsigned char * __restrict pixels, int64_t pixel_count, float m0, float m1, float m2)
+{
+	#pragma omp simd
+	for (int64_t pixel = 0; pixel < pixel_count; ++pixel)
+	{
+		unsigned char *p = pixels + pixel * 4;
+		const float A = p[3];
+		float R = unpremultiply(p[0], A);
+		float G = unpremultiply(p[1], A);
+		float B = unpremultiply(p[2], A);
+
+		hue_rotate(R, G, B, m0, m1, m2);
+
+		p[0] = premultiply(R, A);
+		p[1] = premultiply(G, A);
+		p[2] = premultiply(B, A);
+	}
+}
+
+// Invert the colors of a block of pixels
+PIXEL_KERNEL
+static void negate_block(unsigned char * __restrict pixels, int64_t pixel_count)
+{
+	#pragma omp simd
+	for (int64_t pixel = 0; pixel < pixel_count; ++pixel)
+	{
+		unsigned char *p = pixels + pixel * 4;
+
+		// Inverting an un-premultiplied color (255 - C / A) and premultiplying it again is simply A - C.
+		// Colors larger than alpha (which are invalid) are clamped to 0.
+		const unsigned char A = p[3];
+		p[0] = A > p[0] ? A - p[0] : 0;
+		p[1] = A > p[1] ? A - p[1] : 0;
+		p[2] = A > p[2] ? A - p[2] : 0;
+	}
+}
+
+// Map a block of pixels through a 3D lookup table (with trilinear interpolation)
+PIXEL_KERNEL
+static void lut3d_block(unsigned char * __restrict pixels, int64_t pixel_count, const float * __restrict table, int size,
+						const float *domain_min, const float *domain_scale, float intensity)
+{
+	const float min_r = domain_min[0];
+	const float min_g = domain_min[1];
+	const float min_b = domain_min[2];
+	const float scale_r = domain_scale[0];
+	const float scale_g = domain_scale[1];
+	const float scale_b = domain_scale[2];
+	// Strides of the table (red changes fastest, each entry is an RGB triplet)
+	const int red_stride = 3;
+	const int green_stride = size * 3;
+	const int blue_stride = size * size * 3;
+	const float max_index = size - 1;
+	const float max_cell = size - 2;
+
+	#pragma omp simd
+	for (int64_t pixel = 0; pixel < pixel_count; ++pixel)
+	{
+		unsigned char *p = pixels + pixel * 4;
+		const float A = p[3];
+		const float R = unpremultiply(p[0], A);
+		const float G = unpremultiply(p[1], A);
+		const float B = unpremultiply(p[2], A);
+
+		// Find the position of the color in the lattice (and the cell which contains it)
+		const float r = std::min(std::max((R * (1.0f / 255.0f) - min_r) * scale_r, 0.0f), 1.0f) * max_index;
+		const float g = std::min(std::max((G * (1.0f / 255.0f) - min_g) * scale_g, 0.0f), 1.0f) * max_index;
+		const float b = std::min(std::max((B * (1.0f / 255.0f) - min_b) * scale_b, 0.0f), 1.0f) * max_index;
+		const float r_cell = std::min((float) (int) r, max_cell);
+		const float g_cell = std::min((float) (int) g, max_cell);
+		const float b_cell = std::min((float) (int) b, max_cell);
+		const float dr = r - r_cell;
+		const float dg = g - g_cell;
+		const float db = b - b_cell;
+		const int base = (int) r_cell * red_stride + (int) g_cell * green_stride + (int) b_cell * blue_stride;
+
+		// Interpolate each channel between the 8 corners of the cell
+		const float out_R = trilinear(table, base, red_stride, green_stride, blue_stride, dr, dg, db);
+		const float out_G = trilinear(table, base + 1, red_stride, green_stride, blue_stride, dr, dg, db);
+		const float out_B = trilinear(table, base + 2, red_stride, green_stride, blue_stride, dr, dg, db);
+
+		// Mix the original and the mapped colors, and pre-multiply the alpha back into them
+		p[0] = premultiply(R + (out_R - R) * intensity, A);
+		p[1] = premultiply(G + (out_G - G) * intensity, A);
+		p[2] = premultiply(B + (out_B - B) * intensity, A);
+	}
+}
+
+// Box blur one row of pixels (all four channels together), with a sliding window which costs the same for any radius.
+// Pixels past the edges repeat the edge pixel.
+PIXEL_KERNEL
+static void box_blur_row(const unsigned char * __restrict source, unsigned char * __restrict target, int width, int radius)
+{
+	const float scale = 1.0f / (radius + radius + 1);
+	const int last = width - 1;
+
+	// Sum the window of the first pixel
+	int sum[4] = { 0, 0, 0, 0 };
+	for (int offset = -radius; offset <= radius; ++offset) {
+		const unsigned char *p = source + std::min(std::max(offset, 0), last) * 4;
+		for (int channel = 0; channel < 4; ++channel)
+			sum[channel] += p[channel];
+	}
+
+	// Slide the window along the row
+	for (int x = 0; x < width; ++x) {
+		const unsigned char *added = source + std::min(x + radius + 1, last) * 4;
+		const unsigned char *removed = source + std::max(x - radius, 0) * 4;
+		for (int channel = 0; channel < 4; ++channel) {
+			target[x * 4 + channel] = (unsigned char) (sum[channel] * scale + 0.5f);
+			sum[channel] += added[channel] - removed[channel];
+		}
+	}
+}
+
+// Box blur a strip of columns, by sliding a window of rows down the image. Every step reads and writes whole
+// (contiguous) rows of the strip, which keeps the vertical pass cache-friendly and vectorizable.
+PIXEL_KERNEL
+static void box_blur_columns(const unsigned char * __restrict source, unsigned char * __restrict target, int width, int height,
+							 int strip_start, int strip_width, int radius)
+{
+	const float scale = 1.0f / (radius + radius + 1);
+	const int last = height - 1;
+	const int row_bytes = width * 4;
+	const int strip_bytes = strip_width * 4;
+	source += strip_start * 4;
+	target += strip_start * 4;
+
+	// Sum the window of the first row
+	std::vector<int> sum(strip_bytes, 0);
+	int *sums = sum.data();
+	for (int offset = -radius; offset <= radius; ++offset) {
+		const unsigned char *row = source + int64_t(std::min(std::max(offset, 0), last)) * row_bytes;
+		#pragma omp simd
+		for (int index = 0; index < strip_bytes; ++index)
+			sums[index] += row[index];
+	}
+
+	// Slide the window down the columns
+	for (int y = 0; y < height; ++y) {
+		const unsigned char *added = source + int64_t(std::min(y + radius + 1, last)) * row_bytes;
+		const unsigned char *removed = source + int64_t(std::max(y - radius, 0)) * row_bytes;
+		unsigned char *row = target + int64_t(y) * row_bytes;
+		#pragma omp simd
+		for (int index = 0; index < strip_bytes; ++index) {
+			row[index] = (unsigned char) (sums[index] * scale + 0.5f);
+			sums[index] += added[index] - removed[index];
+		}
+	}
+}
+
+// Apply the alpha of a block of mask planes to a block of pixels
+PIXEL_KERNEL
+static void mask_block(unsigned char * __restrict pixels, const unsigned char * __restrict mask_gray,
+					   const unsigned char * __restrict mask_alpha, int64_t pixel_count,
+					   const int * __restrict gray_table, bool replace_image)
+{
+	if (replace_image) {
+		#pragma omp simd
+		for (int64_t pixel = 0; pixel < pixel_count; ++pixel)
+		{
+			const int alpha = std::min(std::max(mask_alpha[pixel] - gray_table[mask_gray[pixel]], 0), 255);
+
+			// Replace pixels with the mask's alpha (including the alpha channel)
+			unsigned char *p = pixels + pixel * 4;
+			p[0] = alpha;
+			p[1] = alpha;
+			p[2] = alpha;
+			p[3] = alpha;
+		}
+	} else {
+		#pragma omp simd
+		for (int64_t pixel = 0; pixel < pixel_count; ++pixel)
+		{
+			const float alpha_percent = std::min(std::max(mask_alpha[pixel] - gray_table[mask_gray[pixel]], 0), 255) * (1.0f / 255.0f);
+
+			// Multiply all channels by the new alpha (since the pixels are premultiplied)
+			unsigned char *p = pixels + pixel * 4;
+			p[0] = (unsigned char) (p[0] * alpha_percent);
+			p[1] = (unsigned char) (p[1] * alpha_percent);
+			p[2] = (unsigned char) (p[2] * alpha_percent);
+			p[3] = (unsigned char) (p[3] * alpha_percent);
+		}
+	}
+}
+
+// Blend a row of premultiplied pixels over another row ("source over")
+PIXEL_KERNEL
+static void composite_row(unsigned char * __restrict target, const unsigned char * __restrict source, int pixel_count)
+{
+	#pragma omp simd
+	for (int pixel = 0; pixel < pixel_count; ++pixel)
+	{
+		const unsigned char *s = source + pixel * 4;
+		unsigned char *t = target + pixel * 4;
+		const int inverse_alpha = 255 - s[3];
+
+		// target = source + target * (1 - source alpha), dividing by 255 with rounding
+		for (int channel = 0; channel < 4; ++channel) {
+			const int value = t[channel] * inverse_alpha + 128;
+			t[channel] = (unsigned char) std::min(s[channel] + ((value + (value >> 8)) >> 8), 255);
+		}
+	}
+}
+
+// Blend a solid premultiplied color over a row of pixels (an opaque color is a plain fill)
+PIXEL_KERNEL
+static void composite_color_row(unsigned char * __restrict target, const unsigned char color[4], int pixel_count)
+{
+	if (color[3] == 255) {
+		uint32_t value;
+		std::memcpy(&value, color, 4);
+		std::fill_n(reinterpret_cast<uint32_t *>(target), pixel_count, value);
+		return;
+	}
+
+	const int inverse_alpha = 255 - color[3];
+	#pragma omp simd
+	for (int pixel = 0; pixel < pixel_count; ++pixel)
+	{
+		unsigned char *t = target + pixel * 4;
+
+		// target = color + target * (1 - color alpha), dividing by 255 with rounding
+		for (int channel = 0; channel < 4; ++channel) {
+			const int value = t[channel] * inverse_alpha + 128;
+			t[channel] = (unsigned char) std::min(color[channel] + ((value + (value >> 8)) >> 8), 255);
+		}
+	}
+}
+
+// Remove the pixels of a block which match the key color (see ChromaKey, CHROMAKEY_BASIC)
+PIXEL_KERNEL
+static void chroma_key_block(unsigned char * __restrict pixels, int64_t pixel_count, int key_R, int key_G, int key_B, int max_distance_squared)
+{
+	#pragma omp simd
+	for (int64_t pixel = 0; pixel < pixel_count; ++pixel)
+	{
+		unsigned char *p = pixels + pixel * 4;
+
+		// Un-premultiply the color (truncated, like Color::GetDistance expects)
+		const float A = p[3];
+		const int R = A > 0.0f ? (int) ((double) (p[0] / A) * 255.0) : 0;
+		const int G = A > 0.0f ? (int) ((double) (p[1] / A) * 255.0) : 0;
+		const int B = A > 0.0f ? (int) ((double) (p[2] / A) * 255.0) : 0;
+
+		// Squared distance (see Color::GetDistance), which avoids the square root
+		const int rmean = (R + key_R) / 2;
+		const int r = R - key_R;
+		const int g = G - key_G;
+		const int b = B - key_B;
+		const int distance_squared = (((512 + rmean) * r * r) >> 8) + 4 * g * g + (((767 - rmean) * b * b) >> 8);
+
+		// Matched pixels are transparent (including the color channels, since they are premultiplied)
+		const unsigned char keep = distance_squared < max_distance_squared ? 0 : 255;
+		p[0] &= keep;
+		p[1] &= keep;
+		p[2] &= keep;
+		p[3] &= keep;
+	}
+}
+
+// Apply the key distances of a block of pixels to their alpha
+PIXEL_KERNEL
+static void chroma_key_alpha_block(unsigned char * __restrict pixels, const float * __restrict distances, int64_t pixel_count,
+								   float threshold, float halo)
+{
+	#pragma omp simd
+	for (int64_t pixel = 0; pixel < pixel_count; ++pixel)
+	{
+		// Transparent inside the threshold, partially transparent inside the halo, and unchanged outside of it
+		const float distance = distances[pixel];
+		float alpha_percent = 1.0f;
+		if (distance <= threshold)
+			alpha_percent = 0.0f;
+		else if (distance <= threshold + halo)
+			alpha_percent = (distance - threshold) / halo;
+
+		unsigned char *p = pixels + pixel * 4;
+		p[0] = (unsigned char) (p[0] * alpha_percent);
+		p[1] = (unsigned char) (p[1] * alpha_percent);
+		p[2] = (unsigned char) (p[2] * alpha_percent);
+		p[3] = (unsigned char) (p[3] * alpha_percent);
+	}
+}
+
+// Premultiply a block of straight RGBA8888 pixels (the source and target can be the same pixels)
+PIXEL_KERNEL
+static void premultiply_block(const unsigned char *source, unsigned char *target, int64_t pixel_count)
+{
+	#pragma omp simd
+	for (int64_t pixel = 0; pixel < pixel_count; ++pixel)
+	{
+		const unsigned char *s = source + pixel * 4;
+		unsigned char *t = target + pixel * 4;
+		const int A = s[3];
+		const int R = div_255(s[0] * A);
+		const int G = div_255(s[1] * A);
+		const int B = div_255(s[2] * A);
+		t[0] = R;
+		t[1] = G;
+		t[2] = B;
+		t[3] = A;
+	}
+}
+
+// Premultiply a block of straight BGRA8888 pixels into RGBA8888 pixels (the source and target can be the same pixels)
+PIXEL_KERNEL
+static void premultiply_swap_block(const unsigned char *source, unsigned char *target, int64_t pixel_count)
+{
+	#pragma omp simd
+	for (int64_t pixel = 0; pixel < pixel_count; ++pixel)
+	{
+		const unsigned char *s = source + pixel * 4;
+		unsigned char *t = target + pixel * 4;
+		const int A = s[3];
+		const int R = div_255(s[2] * A);
+		const int G = div_255(s[1] * A);
+		const int B = div_255(s[0] * A);
+		t[0] = R;
+		t[1] = G;
+		t[2] = B;
+		t[3] = A;
+	}
+}
+
+// Remove pre-multiplied alpha from a block of RGBA8888 pixels (the source and target can be the same pixels)
+PIXEL_KERNEL
+static void unpremultiply_block(const unsigned char *source, unsigned char *target, int64_t pixel_count)
+{
+	#pragma omp simd
+	for (int64_t pixel = 0; pixel < pixel_count; ++pixel)
+	{
+		const unsigned char *s = source + pixel * 4;
+		unsigned char *t = target + pixel * 4;
+		const float A = s[3];
+		const float R = unpremultiply(s[0], A);
+		const float G = unpremultiply(s[1], A);
+		const float B = unpremultiply(s[2], A);
+		t[0] = (unsigned char) (R + 0.5f);
+		t[1] = (unsigned char) (G + 0.5f);
+		t[2] = (unsigned char) (B + 0.5f);
+		t[3] = s[3];
+	}
+}
+
+// Swap the red and blue channels of a block of pixels, i.e. RGBA8888 <-> BGRA8888 (the source and target can be the same pixels)
+PIXEL_KERNEL
+static void swap_red_blue_block(const unsigned char *source, unsigned char *target, int64_t pixel_count)
+{
+	#pragma omp simd
+	for (int64_t pixel = 0; pixel < pixel_count; ++pixel)
+	{
+		const unsigned char *s = source + pixel * 4;
+		unsigned char *t = target + pixel * 4;
+		const unsigned char R = s[2];
+		const unsigned char G = s[1];
+		const unsigned char B = s[0];
+		const unsigned char A = s[3];
+		t[0] = R;
+		t[1] = G;
+		t[2] = B;
+		t[3] = A;
+	}
+}
+
+// Expand a block of RGB888 pixels into opaque RGBA8888 pixels
+PIXEL_KERNEL
+static void rgb24_to_rgba_block(const unsigned char * __restrict source, unsigned char * __restrict target, int64_t pixel_count)
+{
+	#pragma omp simd
+	for (int64_t pixel = 0; pixel < pixel_count; ++pixel)
+	{
+		const unsigned char *s = source + pixel * 3;
+		unsigned char *t = target + pixel * 4;
+		t[0] = s[0];
+		t[1] = s[1];
+		t[2] = s[2];
+		t[3] = 255;
+	}
+}
+
+// Dither a row of straight RGBA64 pixels down to premultiplied RGBA8888 pixels. Colors are premultiplied (if needed)
+// and scaled to 8 bits in floating point, and the fraction which would be truncated is dithered with an ordered
+// threshold (so smooth 10-bit gradients don't band). The alpha channel is rounded.
+PIXEL_KERNEL
+static void dither_rgba64_row(const uint16_t * __restrict source, unsigned char * __restrict target, int width,
+							  const float * __restrict thresholds, bool premultiply)
+{
+	const float scale = 255.0f / 65535.0f;
+
+	#pragma omp simd
+	for (int pixel = 0; pixel < width; ++pixel)
+	{
+		const uint16_t *s = source + pixel * 4;
+		unsigned char *t = target + pixel * 4;
+		const float threshold = thresholds[pixel & 3];
+		const float A = s[3] * scale;
+		const float factor = premultiply ? s[3] * (scale / 65535.0f) : scale;
+		const float alpha = premultiply ? (int) (A + 0.5f) : 255.0f;
+
+		// Premultiplied colors can't be larger than alpha
+		t[0] = (unsigned char) std::min((float) (int) (s[0] * factor + threshold), alpha);
+		t[1] = (unsigned char) std::min((float) (int) (s[1] * factor + threshold), alpha);
+		t[2] = (unsigned char) std::min((float) (int) (s[2] * factor + threshold), alpha);
+		t[3] = (unsigned char) alpha;
+	}
+}
+
+// Apply a chain of operations to a block of pixels. The pixels are processed in small tiles: each tile is
+// un-premultiplied once, every operation is applied to the tile (while it stays in L1 cache), and the tile
+// is premultiplied and written back once.
+PIXEL_KERNEL
+static void fused_block(unsigned char * __restrict pixels, int64_t pixel_count, const PixelOperation *operations, int operation_count)
+{
+	float R[TILE_PIXELS];
+	float G[TILE_PIXELS];
+	float B[TILE_PIXELS];
+	float A[TILE_PIXELS];
+
+	for (int64_t tile_start = 0; tile_start < pixel_count; tile_start += TILE_PIXELS)
+	{
+		unsigned char *tile = pixels + tile_start * 4;
+		const int tile_count = (int) std::min<int64_t>(TILE_PIXELS, pixel_count - tile_start);
+
+		// Remove pre-multiplied alpha
+		#pragma omp simd
+		for (int pixel = 0; pixel < tile_count; ++pixel)
+		{
+			A[pixel] = tile[pixel * 4 + 3];
+			R[pixel] = unpremultiply(tile[pixel * 4], A[pixel]);
+			G[pixel] = unpremultiply(tile[pixel * 4 + 1], A[pixel]);
+			B[pixel] = unpremultiply(tile[pixel * 4 + 2], A[pixel]);
+		}
+
+		// Apply each operation to the whole tile
+		for (int index = 0; index < operation_count; ++index)
+		{
+			const PixelOperation &operation = operations[index];
+			switch (operation.type)
+			{
+				case PixelOperation::BRIGHTNESS_CONTRAST:
+				{
+					const float offset = 255.0f * operation.values[0];
+					const float factor = contrast_factor(operation.values[1]);
+					#pragma omp simd
+					for (int pixel = 0; pixel < tile_count; ++pixel)
+						brightness_contrast(R[pixel], G[pixel], B[pixel], offset, factor);
+					break;
+				}
+				case PixelOperation::SATURATION:
+				{
+					const float s = operation.values[0];
+					const float sr = operation.values[1];
+					const float sg = operation.values[2];
+					const float sb = operation.values[3];
+					#pragma omp simd
+					for (int pixel = 0; pixel < tile_count; ++pixel)
+						saturation(R[pixel], G[pixel], B[pixel], s, sr, sg, sb);
+					break;
+				}
+				case PixelOperation::HUE_ROTATE:
+				{
+					const float m0 = operation.values[0];
+					const float m1 = operation.values[1];
+					const float m2 = operation.values[2];
+					#pragma omp simd
+					for (int pixel = 0; pixel < tile_count; ++pixel)
+						hue_rotate(R[pixel], G[pixel], B[pixel], m0, m1, m2);
+					break;
+				}
+				case PixelOperation::NEGATE:
+				{
+					#pragma omp simd
+					for (int pixel = 0; pixel < tile_count; ++pixel)
+					{
+						R[pixel] = 255.0f - R[pixel];
+						G[pixel] = 255.0f - G[pixel];
+						B[pixel] = 255.0f - B[pixel];
+					}
+					break;
+				}
+			}
+		}
+
+		// Pre-multiply the alpha back into the color channels
+		#pragma omp simd
+		for (int pixel = 0; pixel < tile_count; ++pixel)
+		{
+			tile[pixel * 4] = premultiply(R[pixel], A[pixel]);
+			tile[pixel * 4 + 1] = premultiply(G[pixel], A[pixel]);
+			tile[pixel * 4 + 2] = premultiply(B[pixel], A[pixel]);
+		}
+	}
+}
+
+// Run a kernel on each index (the indexes are split between the threads of the TaskExecutor)
+template <typename Kernel>
+static void parallel_for(int64_t count, Kernel kernel)
+{
+	TaskExecutor::Instance()->ParallelFor(count, [&kernel](int64_t begin, int64_t end) {
+		for (int64_t index = begin; index < end; ++index)
+			kernel(index);
+	});
+}
+
+// Run a kernel on each row of an image (the rows are split between threads)
+template <typename RowKernel>
+static void for_each_row(int height, RowKernel kernel)
+{
+	parallel_for(height, [&kernel](int64_t y) { kernel(int(y)); });
+}
+
+// Fill pixels with a single RGBA8888 color
+static PIXEL_INLINE void fill_pixels(unsigned char * __restrict target, const unsigned char * __restrict color, int64_t count)
+{
+	uint32_t value;
+	std::memcpy(&value, color, 4);
+	for (int64_t pixel = 0; pixel < count; ++pixel)
+		std::memcpy(target + pixel * 4, &value, 4);
+}
+
+// Adjust the brightness and contrast of pixels
+void PixelKernels::BrightnessContrast(unsigned char *pixels, int64_t pixel_count, float brightness, float contrast)
+{
+	const float factor = contrast_factor(contrast);
+	const int64_t block_count = (pixel_count + BLOCK_PIXELS - 1) / BLOCK_PIXELS;
+
+	parallel_for(block_count, [&](int64_t block)
+	{
+		const int64_t start = block * BLOCK_PIXELS;
+		brightness_contrast_block(pixels + start * 4, std::min(BLOCK_PIXELS, pixel_count - start), brightness, factor);
+	});
+}
+
+// Adjust the saturation of pixels
+void PixelKernels::Saturation(unsigned char *pixels, int64_t pixel_count, float saturation, float saturation_r, float saturation_g, float saturation_b)
+{
+	const int64_t block_count = (pixel_count + BLOCK_PIXELS - 1) / BLOCK_PIXELS;
+
+	parallel_for(block_count, [&](int64_t block)
+	{
+		const int64_t start = block * BLOCK_PIXELS;
+		saturation_block(pixels + start * 4, std::min(BLOCK_PIXELS, pixel_count - start), saturation, saturation_r, saturation_g, saturation_b);
+	});
+}
+
+// Rotate the hue of pixels
+void PixelKernels::HueRotate(unsigned char *pixels, int64_t pixel_count, const float matrix[3])
+{
+	const int64_t block_count = (pixel_count + BLOCK_PIXELS - 1) / BLOCK_PIXELS;
+
+	parallel_for(block_count, [&](int64_t block)
+	{
+		const int64_t start = block * BLOCK_PIXELS;
+		hue_rotate_block(pixels + start * 4, std::min(BLOCK_PIXELS, pixel_count - start), matrix[0], matrix[1], matrix[2]);
+	});
+}
+
+// Invert the color channels of pixels
+void PixelKernels::Negate(unsigned char *pixels, int64_t pixel_count)
+{
+	const int64_t block_count = (pixel_count + BLOCK_PIXELS - 1) / BLOCK_PIXELS;
+
+	parallel_for(block_count, [&](int64_t block)
+	{
+		const int64_t start = block * BLOCK_PIXELS;
+		negate_block(pixels + start * 4, std::min(BLOCK_PIXELS, pixel_count - start));
+	});
+}
+
+// Map pixels through a 3D lookup table
+void PixelKernels::LUT3D(unsigned char *pixels, int64_t pixel_count, const float *table, int size,
+						 const float domain_min[3], const float domain_max[3], float intensity)
+{
+	if (!table || size < 2)
+		return;
+
+	// Scale of each input channel (to the 0.0 - 1.0 range of the table)
+	float domain_scale[3];
+	for (int channel = 0; channel < 3; ++channel) {
+		const float range = domain_max[channel] - domain_min[channel];
+		domain_scale[channel] = range > 0.0f ? 1.0f / range : 0.0f;
+	}
+
+	const int64_t block_count = (pixel_count + BLOCK_PIXELS - 1) / BLOCK_PIXELS;
+
+	parallel_for(block_count, [&](int64_t block)
+	{
+		const int64_t start = block * BLOCK_PIXELS;
+		lut3d_block(pixels + start * 4, std::min(BLOCK_PIXELS, pixel_count - start), table, size, domain_min, domain_scale, intensity);
+	});
+}
+
+// Box blur pixels
+void PixelKernels::BoxBlur(unsigned char *pixels, int width, int height, int horizontal_radius, int vertical_radius, int iterations)
+{
+	if (width <= 0 || height <= 0 || (horizontal_radius <= 0 && vertical_radius <= 0))
+		return;
+
+	// Each pass writes into the other buffer
+	const int64_t bytes = int64_t(width) * height * 4;
+	std::vector<unsigned char> buffer(bytes);
+	unsigned char *source = pixels;
+	unsigned char *target = buffer.data();
+	const int strip_count = (width + BLUR_STRIP_PIXELS - 1) / BLUR_STRIP_PIXELS;
+
+	for (int iteration = 0; iteration < iterations; ++iteration)
+	{
+		// Horizontal blur (each row on its own)
+		if (horizontal_radius > 0) {
+			parallel_for(height, [&](int64_t y) {
+				box_blur_row(source + y * width * 4, target + y * width * 4, width, horizontal_radius);
+			});
+			std::swap(source, target);
+		}
+
+		// Vertical blur (each strip of columns on its own)
+		if (vertical_radius > 0) {
+			parallel_for(strip_count, [&](int64_t strip) {
+				const int strip_start = int(strip) * BLUR_STRIP_PIXELS;
+				box_blur_columns(source, target, width, height, strip_start, std::min(BLUR_STRIP_PIXELS, width - strip_start), vertical_radius);
+			});
+			std::swap(source, target);
+		}
+	}
+
+	// The last pass might have written into the temporary buffer
+	if (source != pixels)
+		std::memcpy(pixels, source, bytes);
+}
+
+// Shift each row of pixels horizontally, by an offset per row
+void PixelKernels::WaveRows(unsigned char *pixels, int width, int height, const int64_t *row_offsets)
+{
+	if (width <= 0 || height <= 0)
+		return;
+
+	// Rows read pixels from their neighbors, so read from a copy
+	const int64_t pixel_count = int64_t(width) * height;
+	const std::vector<unsigned char> source(pixels, pixels + pixel_count * 4);
+	const unsigned char *first = source.data();
+	const unsigned char *last = source.data() + (pixel_count - 1) * 4;
+
+	for_each_row(height, [&](int y) {
+		unsigned char *target = pixels + int64_t(y) * width * 4;
+		const int64_t start = int64_t(y) * width + row_offsets[y];
+
+		// Pixels before the first pixel, inside the image, and after the last pixel
+		const int64_t before = std::min<int64_t>(std::max<int64_t>(-start, 0), width);
+		const int64_t after = std::min<int64_t>(std::max<int64_t>(start + width - pixel_count, 0), width - before);
+		const int64_t inside = width - before - after;
+
+		fill_pixels(target, first, before);
+		if (inside > 0)
+			std::memcpy(target + before * 4, source.data() + (start + before) * 4, inside * 4);
+		fill_pixels(target + (before + inside) * 4, last, after);
+	});
+}
+
+// Move pixels right and down, wrapping around the edges
+void PixelKernels::Shift(unsigned char *pixels, int width, int height, int x_offset, int y_offset)
+{
+	if (width <= 0 || height <= 0)
+		return;
+
+	// Wrap the offsets into the image
+	x_offset = ((x_offset % width) + width) % width;
+	y_offset = ((y_offset % height) + height) % height;
+	if (x_offset == 0 && y_offset == 0)
+		return;
+
+	// Both offsets are applied in a single pass (each row is copied from its source row, in two parts)
+	const int64_t row_bytes = int64_t(width) * 4;
+	const std::vector<unsigned char> source(pixels, pixels + row_bytes * height);
+	for_each_row(height, [&](int y) {
+		unsigned char *target = pixels + y * row_bytes;
+		const unsigned char *source_row = source.data() + ((y - y_offset + height) % height) * row_bytes;
+		std::memcpy(target + int64_t(x_offset) * 4, source_row, (width - x_offset) * 4);
+		std::memcpy(target, source_row + int64_t(width - x_offset) * 4, int64_t(x_offset) * 4);
+	});
+}
+
+// Fill bars along the edges of pixels with a color
+void PixelKernels::Bars(unsigned char *pixels, int width, int height, const unsigned char color[4],
+						int top_rows, int bottom_rows, int left_columns, int right_columns)
+{
+	left_columns = std::min(std::max(left_columns, 0), width);
+	right_columns = std::min(std::max(right_columns, 0), width);
+
+	for_each_row(height, [&](int y) {
+		unsigned char *row = pixels + int64_t(y) * width * 4;
+		if (y < top_rows || y >= height - bottom_rows) {
+			// Top and bottom bars (the whole row)
+			fill_pixels(row, color, width);
+		} else {
+			// Left and right bars
+			fill_pixels(row, color, left_columns);
+			fill_pixels(row + int64_t(width - right_columns) * 4, color, right_columns);
+		}
+	});
+}
+
+// Apply the alpha of mask planes to pixels
+void PixelKernels::Mask(unsigned char *pixels, const unsigned char *mask_gray, const unsigned char *mask_alpha,
+						int64_t pixel_count, const int gray_table[256], bool replace_image)
+{
+	const int64_t block_count = (pixel_count + BLOCK_PIXELS - 1) / BLOCK_PIXELS;
+
+	parallel_for(block_count, [&](int64_t block)
+	{
+		const int64_t start = block * BLOCK_PIXELS;
+		mask_block(pixels + start * 4, mask_gray + start, mask_alpha + start, std::min(BLOCK_PIXELS, pixel_count - start), gray_table, replace_image);
+	});
+}
+
+// Remove the pixels which match the key color
+void PixelKernels::ChromaKey(unsigned char *pixels, int64_t pixel_count, int key_R, int key_G, int key_B, int threshold)
+{
+	// Distances are never negative
+	if (threshold < 0)
+		return;
+
+	// The truncated square root of a distance is <= threshold, when the squared distance is < (threshold + 1)^2
+	const int max_distance_squared = (threshold + 1) * (threshold + 1);
+	const int64_t block_count = (pixel_count + BLOCK_PIXELS - 1) / BLOCK_PIXELS;
+
+	parallel_for(block_count, [&](int64_t block)
+	{
+		const int64_t start = block * BLOCK_PIXELS;
+		chroma_key_block(pixels + start * 4, std::min(BLOCK_PIXELS, pixel_count - start), key_R, key_G, key_B, max_distance_squared);
+	});
+}
+
+// Apply the key distance of each pixel to its alpha
+void PixelKernels::ChromaKeyAlpha(unsigned char *pixels, const float *distances, int64_t pixel_count, float threshold, float halo)
+{
+	const int64_t block_count = (pixel_count + BLOCK_PIXELS - 1) / BLOCK_PIXELS;
+
+	parallel_for(block_count, [&](int64_t block)
+	{
+		const int64_t start = block * BLOCK_PIXELS;
+		chroma_key_alpha_block(pixels + start * 4, distances + start, std::min(BLOCK_PIXELS, pixel_count - start), threshold, halo);
+	});
+}
+
+// Composite layers onto a canvas
+void PixelKernels::Composite(unsigned char *canvas, int width, int height, int bytes_per_line, const std::vector<PixelLayer>& layers)
+{
+	if (width <= 0 || height <= 0 || layers.empty())
+		return;
+
+	const int tiles_x = (width + COMPOSITE_TILE_PIXELS - 1) / COMPOSITE_TILE_PIXELS;
+	const int tiles_y = (height + COMPOSITE_TILE_ROWS - 1) / COMPOSITE_TILE_ROWS;
+
+	parallel_for(tiles_x * tiles_y, [&](int64_t tile_index)
+	{
+		const int tile = int(tile_index);
+		const int tile_left = (tile % tiles_x) * COMPOSITE_TILE_PIXELS;
+		const int tile_top = (tile / tiles_x) * COMPOSITE_TILE_ROWS;
+		const int tile_right = std::min(tile_left + COMPOSITE_TILE_PIXELS, width);
+		const int tile_bottom = std::min(tile_top + COMPOSITE_TILE_ROWS, height);
+
+		// Blend every layer which covers this tile (in order)
+		for (const PixelLayer &layer : layers) {
+			const int left = std::max(tile_left, layer.x);
+			const int right = std::min(tile_right, layer.x + layer.width);
+			const int top = std::max(tile_top, layer.y);
+			const int bottom = std::min(tile_bottom, layer.y + layer.height);
+			if ((!layer.pixels && !layer.solid) || left >= right || top >= bottom)
+				continue;
+
+			for (int y = top; y < bottom; ++y) {
+				if (layer.solid) {
+					composite_color_row(canvas + int64_t(y) * bytes_per_line + int64_t(left) * 4, layer.color, right - left);
+					continue;
+				}
+				composite_row(canvas + int64_t(y) * bytes_per_line + int64_t(left) * 4,
+							  layer.pixels + int64_t(y - layer.y) * layer.bytes_per_line + int64_t(left - layer.x) * 4,
+							  right - left);
+			}
+		}
+	});
+}
+
+// Premultiply straight RGBA8888 pixels
+void PixelKernels::Premultiply(const unsigned char *source, unsigned char *target, int64_t pixel_count)
+{
+	const int64_t block_count = (pixel_count + BLOCK_PIXELS - 1) / BLOCK_PIXELS;
+
+	parallel_for(block_count, [&](int64_t block)
+	{
+		const int64_t start = block * BLOCK_PIXELS;
+		premultiply_block(source + start * 4, target + start * 4, std::min(BLOCK_PIXELS, pixel_count - start));
+	});
+}
+
+// Remove pre-multiplied alpha from RGBA8888 pixels
+void PixelKernels::Unpremultiply(const unsigned char *source, unsigned char *target, int64_t pixel_count)
+{
+	const int64_t block_count = (pixel_count + BLOCK_PIXELS - 1) / BLOCK_PIXELS;
+
+	parallel_for(block_count, [&](int64_t block)
+	{
+		const int64_t start = block * BLOCK_PIXELS;
+		unpremultiply_block(source + start * 4, target + start * 4, std::min(BLOCK_PIXELS, pixel_count - start));
+	});
+}
+
+// Swap the red and blue channels of pixels
+void PixelKernels::SwapRedBlue(const unsigned char *source, unsigned char *target, int64_t pixel_count)
+{
+	const int64_t block_count = (pixel_count + BLOCK_PIXELS - 1) / BLOCK_PIXELS;
+
+	parallel_for(block_count, [&](int64_t block)
+	{
+		const int64_t start = block * BLOCK_PIXELS;
+		swap_red_blue_block(source + start * 4, target + start * 4, std::min(BLOCK_PIXELS, pixel_count - start));
+	});
+}
+
+// Expand RGB888 pixels into opaque RGBA8888 pixels
+void PixelKernels::RGB24ToRGBA(const unsigned char *source, unsigned char *target, int64_t pixel_count)
+{
+	const int64_t block_count = (pixel_count + BLOCK_PIXELS - 1) / BLOCK_PIXELS;
+
+	parallel_for(block_count, [&](int64_t block)
+	{
+		const int64_t start = block * BLOCK_PIXELS;
+		rgb24_to_rgba_block(source + start * 3, target + start * 4, std::min(BLOCK_PIXELS, pixel_count - start));
+	});
+}
+
+// Dither RGBA64 pixels down to premultiplied RGBA8888 pixels
+void PixelKernels::DitherRGBA64(const uint16_t *source, int source_bytes_per_line, unsigned char *target, int target_bytes_per_line,
+								int width, int height, bool premultiply)
+{
+	const unsigned char *source_bytes = reinterpret_cast<const unsigned char *>(source);
+
+	for_each_row(height, [&](int y) {
+		dither_rgba64_row(reinterpret_cast<const uint16_t *>(source_bytes + int64_t(y) * source_bytes_per_line),
+						  target + int64_t(y) * target_bytes_per_line, width, DITHER_4X4[y & 3], premultiply);
+	});
+}
+
+// Convert an image to premultiplied RGBA8888 (the format of openshot::Frame images)
+void PixelKernels::ToPremultipliedRGBA(QImage& image)
+{
+	const QImage::Format format = image.format();
+	if (image.isNull() || format == QImage::Format_RGBA8888_Premultiplied)
+		return;
+
+	// The kernel which converts a row of pixels (ARGB32 and RGB32 images are BGRA8888 in memory, on little-endian CPUs)
+	void (*convert_row)(const unsigned char *, unsigned char *, int64_t) = nullptr;
+	switch (format) {
+		case QImage::Format_RGBA8888:
+			convert_row = premultiply_block;
+			break;
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+		case QImage::Format_ARGB32:
+			convert_row = premultiply_swap_block;
+			break;
+		case QImage::Format_ARGB32_Premultiplied:
+		case QImage::Format_RGB32:
+			convert_row = swap_red_blue_block;
+			break;
+#endif
+		case QImage::Format_RGB888:
+			convert_row = rgb24_to_rgba_block;
+			break;
+		default:
+			break;
+	}
+
+	// Other formats are converted by Qt
+	if (!convert_row) {
+		image = image.convertToFormat(QImage::Format_RGBA8888_Premultiplied);
+		return;
+	}
+
+	const int width = image.width();
+	const int height = image.height();
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 9, 0)
+	// Convert 32-bit pixels in place, unless they are shared with another image (so no new image is allocated)
+	if (image.depth() == 32 && image.isDetached()) {
+		unsigned char *pixels = image.bits();
+		const int bytes_per_line = image.bytesPerLine();
+		for_each_row(height, [&](int y) {
+			unsigned char *row = pixels + int64_t(y) * bytes_per_line;
+			convert_row(row, row, width);
+		});
+		image.reinterpretAsFormat(QImage::Format_RGBA8888_Premultiplied);
+		return;
+	}
+#endif
+
+	// Convert the pixels into a new image
+	QImage converted(width, height, QImage::Format_RGBA8888_Premultiplied);
+	if (!converted.isNull()) {
+		const unsigned char *source = image.constBits();
+		unsigned char *target = converted.bits();
+		const int source_bytes_per_line = image.bytesPerLine();
+		const int target_bytes_per_line = converted.bytesPerLine();
+		for_each_row(height, [&](int y) {
+			convert_row(source + int64_t(y) * source_bytes_per_line, target + int64_t(y) * target_bytes_per_line, width);
+		});
+		converted.setDotsPerMeterX(image.dotsPerMeterX());
+		converted.setDotsPerMeterY(image.dotsPerMeterY());
+	}
+	image = converted;
+}
+
+// Apply a chain of point-wise operations to pixels (in a single pass)
+void PixelKernels::Apply(unsigned char *pixels, int64_t pixel_count, const std::vector<PixelOperation>& operations)
+{
+	if (operations.empty())
+		return;
+
+	// A single operation uses its own kernel
+	if (operations.size() == 1) {
+		const PixelOperation &operation = operations.front();
+		switch (operation.type) {
+			case PixelOperation::BRIGHTNESS_CONTRAST:
+				BrightnessContrast(pixels, pixel_count, operation.values[0], operation.values[1]);
+				break;
+			case PixelOperation::SATURATION:
+				Saturation(pixels, pixel_count, operation.values[0], operation.values[1], operation.values[2], operation.values[3]);
+				break;
+			case PixelOperation::HUE_ROTATE:
+				HueRotate(pixels, pixel_count, operation.values);
+				break;
+			case PixelOperation::NEGATE:
+				Negate(pixels, pixel_count);
+				break;
+		}
+		return;
+	}
+
+	const int64_t block_count = (pixel_count + BLOCK_PIXELS - 1) / BLOCK_PIXELS;
+
+	parallel_for(block_count, [&](int64_t block)
+	{
+		const int64_t start = block * BLOCK_PIXELS;
+		fused_block(pixels + start * 4, std::min(BLOCK_PIXELS, pixel_count - start), operations.data(), (int) operations.size());
+	});
+}
+
+// Get the name of the instruction set selected at runtime
+std::string PixelKernels::InstructionSet()
+{
+#if PIXEL_KERNEL_CLONES
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return "avx2";
+	if (__builtin_cpu_supports("sse4.1"))
+		return "sse4.1";
+	return "default";
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	return "neon";
+#else
+	return "default";
+#endif
+}
@@ -0,0 +1,266 @@
+/**
+ * @file
+ * @brief Header file for PixelKernels class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_PIXEL_KERNELS_H
+#define OPENSHOT_PIXEL_KERNELS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class QImage;
+
+namespace openshot {
+
+	/**
+	 * @brief This struct describes a point-wise color adjustment (i.e. the pixel operation of an effect)
+	 *
+	 * Consecutive operations can be applied to an image in a single pass with PixelKernels::Apply().
+	 */
+	struct PixelOperation
+	{
+		/// The types of point-wise color adjustments
+		enum Type
+		{
+			BRIGHTNESS_CONTRAST, ///< values: brightness, contrast
+			SATURATION, ///< values: saturation, red saturation, green saturation, blue saturation
+			HUE_ROTATE, ///< values: the 3 coefficients of the (circulant) RGB rotation matrix
+			NEGATE ///< no values
+		};
+
+		Type type; ///< The type of adjustment
+		float values[4]; ///< The parameters of the adjustment (depending on the type)
+	};
+
+	/**
+	 * @brief This struct describes a layer of pixels, which is composited onto a canvas with PixelKernels::Composite()
+	 */
+	struct PixelLayer
+	{
+		const unsigned char *pixels; ///< The premultiplied RGBA8888 pixels of the layer
+		int bytes_per_line; ///< The number of bytes of each row of the layer
+		int x; ///< The position of the left edge of the layer on the canvas
+		int y; ///< The position of the top edge of the layer on the canvas
+		int width; ///< The width of the layer
+		int height; ///< The height of the layer
+		bool solid = false; ///< The layer is a solid color (see color), which is filled instead of blending its pixels
+		unsigned char color[4] = {0, 0, 0, 0}; ///< The premultiplied RGBA8888 color of a solid layer
+	};
+
+	/**
+	 * @brief This class holds the vectorized per-pixel kernels of the color effects
+	 *
+	 * Every kernel works in place on premultiplied RGBA8888 pixels (the format of openshot::Frame images).
+	 * The color channels are un-premultiplied before they are adjusted, and premultiplied again afterwards
+	 * (fully transparent pixels stay transparent). The conversion kernels convert other pixel formats to (and
+	 * from) this format. Pixels are split into blocks which are processed on multiple threads, and each block
+	 * runs a version of the kernel which is compiled for the best instruction set of the CPU, selected at
+	 * runtime (AVX2 or SSE4.1 on x86, NEON on ARM).
+	 *
+	 * \code
+	 * // Increase the brightness of an image by 10%
+	 * PixelKernels::BrightnessContrast(image->bits(), image->width() * image->height(), 0.1, 0.0);
+	 * \endcode
+	 */
+	class PixelKernels {
+	public:
+		/// @brief Adjust the brightness and contrast of pixels
+		/// @param pixels The premultiplied RGBA8888 pixels
+		/// @param pixel_count The number of pixels
+		/// @param brightness The brightness (-1 to +1, 0 = no change)
+		/// @param contrast The contrast (-128 to +128, 0 = no change)
+		static void BrightnessContrast(unsigned char *pixels, int64_t pixel_count, float brightness, float contrast);
+
+		/// @brief Adjust the saturation of pixels (both the common, and the color-separated saturation)
+		/// @param pixels The premultiplied RGBA8888 pixels
+		/// @param pixel_count The number of pixels
+		/// @param saturation The common saturation (0 = greyscale, 1 = no change)
+		/// @param saturation_r The saturation of the red channel (1 = no change)
+		/// @param saturation_g The saturation of the green channel (1 = no change)
+		/// @param saturation_b The saturation of the blue channel (1 = no change)
+		static void Saturation(unsigned char *pixels, int64_t pixel_count, float saturation, float saturation_r, float saturation_g, float saturation_b);
+
+		/// @brief Rotate the hue of pixels
+		/// @param pixels The premultiplied RGBA8888 pixels
+		/// @param pixel_count The number of pixels
+		/// @param matrix The 3 coefficients of the (circulant) RGB rotation matrix
+		static void HueRotate(unsigned char *pixels, int64_t pixel_count, const float matrix[3]);
+
+		/// @brief Invert the color channels of pixels (the alpha channel is not changed)
+		/// @param pixels The premultiplied RGBA8888 pixels
+		/// @param pixel_count The number of pixels
+		static void Negate(unsigned char *pixels, int64_t pixel_count);
+
+		/// @brief Map pixels through a 3D lookup table (with trilinear interpolation)
+		/// @param pixels The premultiplied RGBA8888 pixels
+		/// @param pixel_count The number of pixels
+		/// @param table The size * size * size RGB entries of the table (0.0 to 1.0, with red changing fastest, as in .cube files)
+		/// @param size The number of entries along each axis of the table (at least 2)
+		/// @param domain_min The input color mapped to the first entry of each axis (0.0 to 1.0)
+		/// @param domain_max The input color mapped to the last entry of each axis (0.0 to 1.0)
+		/// @param intensity The mix between the original (0.0) and the mapped (1.0) colors
+		static void LUT3D(unsigned char *pixels, int64_t pixel_count, const float *table, int size,
+						  const float domain_min[3], const float domain_max[3], float intensity);
+
+		/// @brief Box blur pixels (premultiplied alpha needs no special handling, since every channel is averaged)
+		///
+		/// Each pass uses a sliding window, so the cost doesn't depend on the radius. The horizontal pass processes each
+		/// row, and the vertical pass processes strips of columns (reading whole rows of each strip at a time), on
+		/// multiple threads. Pixels past the edges repeat the edge pixels. 3 iterations approximate a Gaussian blur.
+		/// @param pixels The RGBA8888 pixels (without padding between rows)
+		/// @param width The width of the image
+		/// @param height The height of the image
+		/// @param horizontal_radius The horizontal blur radius in pixels (0 = no horizontal blur)
+		/// @param vertical_radius The vertical blur radius in pixels (0 = no vertical blur)
+		/// @param iterations The number of times to blur the image
+		static void BoxBlur(unsigned char *pixels, int width, int height, int horizontal_radius, int vertical_radius, int iterations);
+
+		/// @brief Shift each row of pixels horizontally, by an offset per row (see openshot::Wave)
+		///
+		/// The rows are read as one continuous line of pixels (so pixels shifted past the end of a row come from the
+		/// next or previous row), and pixels past the start or the end of the image repeat the first or last pixel.
+		/// @param pixels The RGBA8888 pixels (without padding between rows)
+		/// @param width The width of the image
+		/// @param height The height of the image
+		/// @param row_offsets The offset of each row (a positive offset reads pixels to the right)
+		static void WaveRows(unsigned char *pixels, int width, int height, const int64_t *row_offsets);
+
+		/// @brief Move pixels right and down, wrapping around the edges (see openshot::Shift)
+		/// @param pixels The RGBA8888 pixels (without padding between rows)
+		/// @param width The width of the image
+		/// @param height The height of the image
+		/// @param x_offset The number of columns to move right (negative values move left)
+		/// @param y_offset The number of rows to move down (negative values move up)
+		static void Shift(unsigned char *pixels, int width, int height, int x_offset, int y_offset);
+
+		/// @brief Fill bars along the edges of pixels with a color (see openshot::Bars)
+		/// @param pixels The premultiplied RGBA8888 pixels (without padding between rows)
+		/// @param width The width of the image
+		/// @param height The height of the image
+		/// @param color The premultiplied RGBA8888 color of the bars
+		/// @param top_rows The height of the top bar
+		/// @param bottom_rows The height of the bottom bar
+		/// @param left_columns The width of the left bar
+		/// @param right_columns The width of the right bar
+		static void Bars(unsigned char *pixels, int width, int height, const unsigned char color[4],
+						 int top_rows, int bottom_rows, int left_columns, int right_columns);
+
+		/// @brief Apply the alpha of a mask plane to pixels (see openshot::Mask and openshot::MaskPlane)
+		///
+		/// The new alpha of each pixel is the mask's alpha, minus the adjusted gray value of the mask pixel
+		/// (which is looked up in a table, so the brightness and contrast are only computed once per frame).
+		/// @param pixels The premultiplied RGBA8888 pixels
+		/// @param mask_gray The gray value (qGray) of each mask pixel (the same size as the pixels)
+		/// @param mask_alpha The alpha of each mask pixel (the same size as the pixels)
+		/// @param pixel_count The number of pixels
+		/// @param gray_table The adjusted gray value of each gray value (qGray) of the mask
+		/// @param replace_image Replace the pixels with the new alpha (instead of multiplying them by it)
+		static void Mask(unsigned char *pixels, const unsigned char *mask_gray, const unsigned char *mask_alpha, int64_t pixel_count, const int gray_table[256], bool replace_image);
+
+		/// @brief Remove the pixels which match a key color (see openshot::ChromaKey and CHROMAKEY_BASIC)
+		///
+		/// Each pixel is un-premultiplied, and made transparent when its Color::GetDistance to the key color is
+		/// not larger than the threshold. The distance is compared squared, so no square root is needed.
+		/// @param pixels The premultiplied RGBA8888 pixels
+		/// @param pixel_count The number of pixels
+		/// @param key_R The red value of the key color
+		/// @param key_G The green value of the key color
+		/// @param key_B The blue value of the key color
+		/// @param threshold The largest distance which is removed
+		static void ChromaKey(unsigned char *pixels, int64_t pixel_count, int key_R, int key_G, int key_B, int threshold);
+
+		/// @brief Apply the key distance of each pixel to its alpha (see openshot::ChromaKey)
+		///
+		/// Pixels up to the threshold become transparent, and pixels up to threshold + halo become partially
+		/// transparent (increasing with the distance). Other pixels are not changed.
+		/// @param pixels The premultiplied RGBA8888 pixels
+		/// @param distances The distance of each pixel to the key color
+		/// @param pixel_count The number of pixels
+		/// @param threshold The largest distance which is removed
+		/// @param halo The additional distance which is partially removed
+		static void ChromaKeyAlpha(unsigned char *pixels, const float *distances, int64_t pixel_count, float threshold, float halo);
+
+		/// @brief Composite layers onto a canvas, in order (with premultiplied alpha "source over")
+		///
+		/// The canvas is split into tiles, which are blended on multiple threads. Each tile blends all of the
+		/// layers which cover it (so it stays in the CPU cache), instead of blending each layer over the whole
+		/// canvas in turn. Layers are clipped to the canvas.
+		/// @param canvas The premultiplied RGBA8888 pixels of the canvas
+		/// @param width The width of the canvas
+		/// @param height The height of the canvas
+		/// @param bytes_per_line The number of bytes of each row of the canvas
+		/// @param layers The layers (the first layer is blended first, i.e. it is at the bottom)
+		static void Composite(unsigned char *canvas, int width, int height, int bytes_per_line, const std::vector<PixelLayer>& layers);
+
+		/// @brief Apply a chain of point-wise color adjustments to pixels
+		///
+		/// The pixels are un-premultiplied, adjusted, and premultiplied again only once for the whole chain (instead
+		/// of once per adjustment), so all of the adjustments cost a single pass over the image memory.
+		/// @param pixels The premultiplied RGBA8888 pixels
+		/// @param pixel_count The number of pixels
+		/// @param operations The adjustments (applied in order)
+		static void Apply(unsigned char *pixels, int64_t pixel_count, const std::vector<PixelOperation>& operations);
+
+		/// @brief Premultiply straight (un-premultiplied) RGBA8888 pixels
+		/// @param source The straight RGBA8888 pixels
+		/// @param target The premultiplied RGBA8888 pixels (can be the same as the source)
+		/// @param pixel_count The number of pixels
+		static void Premultiply(const unsigned char *source, unsigned char *target, int64_t pixel_count);
+
+		/// @brief Remove pre-multiplied alpha from RGBA8888 pixels (fully transparent pixels become transparent black)
+		/// @param source The premultiplied RGBA8888 pixels
+		/// @param target The straight RGBA8888 pixels (can be the same as the source)
+		/// @param pixel_count The number of pixels
+		static void Unpremultiply(const unsigned char *source, unsigned char *target, int64_t pixel_count);
+
+		/// @brief Swap the red and blue channels of pixels (RGBA8888 to BGRA8888, or BGRA8888 to RGBA8888)
+		/// @param source The 32-bit pixels
+		/// @param target The swapped 32-bit pixels (can be the same as the source)
+		/// @param pixel_count The number of pixels
+		static void SwapRedBlue(const unsigned char *source, unsigned char *target, int64_t pixel_count);
+
+		/// @brief Expand RGB888 pixels into opaque RGBA8888 pixels
+		/// @param source The RGB888 pixels
+		/// @param target The RGBA8888 pixels (which can't overlap the source)
+		/// @param pixel_count The number of pixels
+		static void RGB24ToRGBA(const unsigned char *source, unsigned char *target, int64_t pixel_count);
+
+		/// @brief Dither 16-bit RGBA64 pixels (i.e. decoded 10-bit video) down to premultiplied RGBA8888 pixels
+		///
+		/// Truncating high bit depth colors to 8 bits turns smooth gradients into bands. The colors are scaled (and
+		/// premultiplied) in floating point instead, and the fraction of a step is dithered with a 4x4 ordered
+		/// pattern, so the average color of an area keeps the precision of the source.
+		/// @param source The straight RGBA64 pixels (16 bits per channel, in the CPU's byte order)
+		/// @param source_bytes_per_line The number of bytes of each row of the source
+		/// @param target The premultiplied RGBA8888 pixels
+		/// @param target_bytes_per_line The number of bytes of each row of the target
+		/// @param width The width of the image
+		/// @param height The height of the image
+		/// @param premultiply Premultiply the colors by alpha (false if the source is opaque, so alpha is set to 255)
+		static void DitherRGBA64(const uint16_t *source, int source_bytes_per_line, unsigned char *target, int target_bytes_per_line,
+								 int width, int height, bool premultiply);
+
+		/// @brief Convert an image to premultiplied RGBA8888 (the format of openshot::Frame images)
+		///
+		/// RGBA8888, ARGB32, ARGB32_Premultiplied, RGB32 and RGB888 images are converted by the kernels above (in a
+		/// single pass, on multiple threads), and 32-bit images whose pixels are not shared are converted in place
+		/// (without allocating a new image). Other formats are converted by QImage::convertToFormat().
+		/// @param image The image to convert (images which are already premultiplied RGBA8888 are not changed)
+		static void ToPremultipliedRGBA(QImage& image);
+
+		/// Get the name of the instruction set selected at runtime ("avx2", "sse4.1", "neon", or "default" for the compiler's baseline)
+		static std::string InstructionSet();
+	};
+
+}
+
+#endif
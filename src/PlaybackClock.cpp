@@ -0,0 +1,58 @@
+/**
+ * @file
+ * @brief Source file for PlaybackClock class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "PlaybackClock.h"
+
+using namespace openshot;
+
+// Default constructor
+PlaybackClock::PlaybackClock()
+	: anchor_frame(1), anchor_time(clock::now()), frames_per_second(0.0), audio_frame(1)
+{
+}
+
+// Start the clock at a frame
+void PlaybackClock::Reset(int64_t frame_number, double fps, int speed, clock::time_point now)
+{
+	anchor_frame = frame_number;
+	anchor_time = now;
+	frames_per_second = fps * speed;
+	audio_frame = frame_number;
+}
+
+// Slave the clock to the audio device
+void PlaybackClock::SyncToAudio(int64_t frame_number, clock::time_point now)
+{
+	if (frame_number == audio_frame || frames_per_second == 0.0)
+		return;
+
+	audio_frame = frame_number;
+	anchor_frame = frame_number;
+	anchor_time = now;
+}
+
+// Get the frame which should be displayed
+int64_t PlaybackClock::Frame(clock::time_point now) const
+{
+	const double elapsed = std::chrono::duration<double>(now - anchor_time).count();
+	return anchor_frame + (int64_t) (elapsed * frames_per_second);
+}
+
+// Get the time a frame should be displayed
+PlaybackClock::clock::time_point PlaybackClock::FrameTime(int64_t frame_number) const
+{
+	if (frames_per_second == 0.0)
+		return anchor_time;
+
+	const std::chrono::duration<double> offset((frame_number - anchor_frame) / frames_per_second);
+	return anchor_time + std::chrono::round<clock::duration>(offset);
+}
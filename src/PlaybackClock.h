@@ -0,0 +1,80 @@
+/**
+ * @file
+ * @brief Header file for PlaybackClock class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_PLAYBACK_CLOCK_H
+#define OPENSHOT_PLAYBACK_CLOCK_H
+
+#include <chrono>
+#include <cstdint>
+
+namespace openshot
+{
+	/**
+	 * @brief The clock which decides when each video frame is displayed (during playback).
+	 *
+	 * The clock runs on std::chrono::steady_clock (so it never jumps when the system time changes), starting at
+	 * an anchor (a frame number and a time). When audio is playing, the clock is slaved to the audio device:
+	 * each time the audio moves on to a new frame, the anchor moves to that frame, so the video can never drift
+	 * away from the audio (no matter how long the playback is).
+	 *
+	 * The player asks the clock which frame is due now. If rendering has fallen behind, the late frames are
+	 * skipped (instead of displaying every frame late).
+	 *
+	 * \code
+	 * clock.Reset(video_position, fps, speed);
+	 * while (playing) {
+	 *     clock.SyncToAudio(audio_ring->CurrentFrame());
+	 *     video_position = clock.Frame();
+	 *     // ... display the frame
+	 *     std::this_thread::sleep_until(clock.FrameTime(video_position + speed));
+	 * }
+	 * \endcode
+	 */
+	class PlaybackClock
+	{
+	public:
+		using clock = std::chrono::steady_clock;
+
+	private:
+		int64_t anchor_frame; ///< The frame displayed at anchor_time
+		clock::time_point anchor_time;
+		double frames_per_second; ///< The rate the clock advances (fps * speed, negative when playing backwards)
+		int64_t audio_frame; ///< The last frame reported by the audio device
+
+	public:
+		/// Default constructor
+		PlaybackClock();
+
+		/// @brief Start the clock at a frame (i.e. after seeking, pausing, or changing the speed)
+		/// @param frame_number The frame which is displayed now
+		/// @param fps The frame rate of the reader
+		/// @param speed The speed and direction of playback (1=normal, 2=fast, -1=rewind, 0=paused, etc...)
+		/// @param now The current time
+		void Reset(int64_t frame_number, double fps, int speed, clock::time_point now = clock::now());
+
+		/// @brief Slave the clock to the audio device. This only moves the clock when the audio moves on to a
+		/// new frame, so it does nothing while the audio is stalled (or not playing).
+		/// @param frame_number The frame the audio device is playing
+		/// @param now The current time
+		void SyncToAudio(int64_t frame_number, clock::time_point now = clock::now());
+
+		/// @brief Get the frame which should be displayed
+		/// @param now The current time
+		int64_t Frame(clock::time_point now = clock::now()) const;
+
+		/// @brief Get the time a frame should be displayed (the anchor time, when paused)
+		/// @param frame_number The frame number
+		clock::time_point FrameTime(int64_t frame_number) const;
+	};
+}
+
+#endif // OPENSHOT_PLAYBACK_CLOCK_H
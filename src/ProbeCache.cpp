@@ -0,0 +1,188 @@
+/**
+ * @file
+ * @brief Source file for ProbeCache class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#include <QDateTime>
+#include <QFileInfo>
+
+#include "ProbeCache.h"
+#include "DummyReader.h"
+#include "Exceptions.h"
+#include "Json.h"
+#include "Settings.h"
+
+using namespace openshot;
+
+namespace {
+	// Get a 64-bit integer (stored as a string, like the readers store the file size)
+	int64_t json_integer(const Json::Value& value) {
+		if (!value.isString())
+			return 0;
+		std::stringstream stream(value.asString());
+		int64_t number = 0;
+		stream >> number;
+		return number;
+	}
+}
+
+// Global reference to the cache
+ProbeCache *ProbeCache::m_pInstance = nullptr;
+
+// Create or Get an instance of the cache singleton
+ProbeCache *ProbeCache::Instance()
+{
+	// Create the actual instance of the cache only once (readers are created on many threads)
+	static std::once_flag created;
+	std::call_once(created, []() {
+		m_pInstance = new ProbeCache;
+
+		// Load the info of the previous sessions (if any)
+		const std::string cache_path = Settings::Instance()->PROBE_CACHE_PATH;
+		if (!cache_path.empty())
+			m_pInstance->Load(cache_path);
+	});
+
+	return m_pInstance;
+}
+
+// Get the modification time and size of a file
+bool ProbeCache::FileStamp(const std::string& path, int64_t& modified, int64_t& size)
+{
+	QFileInfo file(QString::fromStdString(path));
+	if (!file.exists() || !file.isFile())
+		return false;
+
+	modified = file.lastModified().toMSecsSinceEpoch();
+	size = file.size();
+	return true;
+}
+
+// Get the stored info of a file
+bool ProbeCache::Lookup(const std::string& reader_type, const std::string& path, ReaderInfo& info)
+{
+	if (!Settings::Instance()->ENABLE_PROBE_CACHE)
+		return false;
+
+	int64_t modified, size;
+	if (!FileStamp(path, modified, size))
+		return false;
+
+	const std::lock_guard<std::mutex> lock(cacheMutex);
+	auto entry = entries.find(reader_type + '\n' + path);
+	if (entry == entries.end() || entry->second.modified != modified || entry->second.size != size)
+		return false;
+
+	info = entry->second.info;
+	return true;
+}
+
+// Store the probed info of a file
+void ProbeCache::Insert(const std::string& reader_type, const std::string& path, const ReaderInfo& info)
+{
+	if (!Settings::Instance()->ENABLE_PROBE_CACHE)
+		return;
+
+	int64_t modified, size;
+	if (!FileStamp(path, modified, size))
+		return;
+
+	{
+		const std::lock_guard<std::mutex> lock(cacheMutex);
+		entries[reader_type + '\n' + path] = Entry{modified, size, info};
+	}
+
+	// Keep the info for the next sessions
+	const std::string cache_path = Settings::Instance()->PROBE_CACHE_PATH;
+	if (!cache_path.empty())
+		Save(cache_path);
+}
+
+// Forget the info of all files
+void ProbeCache::Clear()
+{
+	const std::lock_guard<std::mutex> lock(cacheMutex);
+	entries.clear();
+}
+
+// Get the number of stored files
+int64_t ProbeCache::Count()
+{
+	const std::lock_guard<std::mutex> lock(cacheMutex);
+	return entries.size();
+}
+
+// Save the stored info to a JSON file
+bool ProbeCache::Save(const std::string& path)
+{
+	Json::Value root;
+	root["entries"] = Json::Value(Json::arrayValue);
+	{
+		// The info is converted with the same JSON as the readers use
+		const std::lock_guard<std::mutex> lock(cacheMutex);
+		DummyReader reader;
+		for (const auto& entry : entries) {
+			Json::Value item;
+			item["key"] = entry.first;
+			item["modified"] = std::to_string(entry.second.modified);
+			item["size"] = std::to_string(entry.second.size);
+			reader.info = entry.second.info;
+			item["info"] = reader.ReaderBase::JsonValue();
+			root["entries"].append(item);
+		}
+	}
+
+	// Write to a temporary file first (so a partial file is never loaded)
+	const std::string temp_path = path + ".tmp";
+	std::ofstream output(temp_path, std::ios::out | std::ios::trunc);
+	output << root.toStyledString();
+	output.close();
+	if (!output.good()) {
+		std::remove(temp_path.c_str());
+		return false;
+	}
+	std::remove(path.c_str());
+	return std::rename(temp_path.c_str(), path.c_str()) == 0;
+}
+
+// Load the stored info from a JSON file
+bool ProbeCache::Load(const std::string& path)
+{
+	std::ifstream input(path);
+	if (!input.good())
+		return false;
+	const std::string contents((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+	Json::Value root;
+	try {
+		root = openshot::stringToJson(contents);
+	}
+	catch (const ExceptionBase& e) {
+		return false;
+	}
+	if (!root["entries"].isArray())
+		return false;
+
+	const std::lock_guard<std::mutex> lock(cacheMutex);
+	DummyReader reader;
+	for (const Json::Value& item : root["entries"]) {
+		if (!item["key"].isString() || !item["info"].isObject())
+			continue;
+		reader.info = ReaderInfo();
+		reader.ReaderBase::SetJsonValue(item["info"]);
+		entries[item["key"].asString()] = Entry{json_integer(item["modified"]), json_integer(item["size"]), reader.info};
+	}
+	return true;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file
+ * @brief Header file for ProbeCache class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_PROBE_CACHE_H
+#define OPENSHOT_PROBE_CACHE_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "ReaderBase.h"
+
+namespace openshot {
+
+	/**
+	 * @brief This singleton class remembers the ReaderInfo of inspected files (by path, modification time and size)
+	 *
+	 * Inspecting a file (i.e. constructing an FFmpegReader or QtImageReader for a path) opens it and probes
+	 * all of its streams, which is slow for large files, and very slow on network storage. The info of each
+	 * inspected file is stored here, and readers created later for the same (unchanged) file re-use it,
+	 * instead of probing the file again. A file which has been modified (or resized) is probed again.
+	 *
+	 * The cache can be disabled with Settings::ENABLE_PROBE_CACHE. When Settings::PROBE_CACHE_PATH is set, the
+	 * cache is loaded from that file (when first used), and saved to it after each insert, so files are only
+	 * probed once across sessions.
+	 *
+	 * \code
+	 * // Only the first reader probes the file
+	 * FFmpegReader r1("video.mp4");
+	 * FFmpegReader r2("video.mp4");
+	 * \endcode
+	 */
+	class ProbeCache {
+	private:
+		struct Entry {
+			int64_t modified; ///< The modification time of the file (in ms since the epoch)
+			int64_t size; ///< The size of the file (in bytes)
+			ReaderInfo info; ///< The probed info
+		};
+
+		std::mutex cacheMutex;
+		std::map<std::string, Entry> entries; ///< Keyed by reader type and path
+
+		/// Private variable to keep track of singleton instance
+		static ProbeCache *m_pInstance;
+
+		/// Default constructor
+		ProbeCache() = default;
+
+		/// Don't allow the user to copy or assign this instance
+		ProbeCache(ProbeCache const&) = delete;
+		ProbeCache & operator=(ProbeCache const&) = delete;
+
+	public:
+		/// @brief Get the modification time and size of a file (returns false if it doesn't exist). Stored info is
+		/// only used while these match (this is also the key of FFmpegReader's saved seek indexes).
+		/// @param path The path of the file
+		/// @param modified The modification time of the file (in ms since the epoch)
+		/// @param size The size of the file (in bytes)
+		static bool FileStamp(const std::string& path, int64_t& modified, int64_t& size);
+
+		/// Create or get an instance of this cache singleton (invoke the class with this method)
+		static ProbeCache *Instance();
+
+		/// @brief Get the stored info of a file (returns false if the file was not probed, or has changed since)
+		/// @param reader_type The type of reader (i.e. "FFmpegReader"), since readers probe different info
+		/// @param path The path of the file
+		/// @param info The info to fill in
+		bool Lookup(const std::string& reader_type, const std::string& path, ReaderInfo& info);
+
+		/// @brief Store the probed info of a file
+		/// @param reader_type The type of reader (i.e. "FFmpegReader")
+		/// @param path The path of the file
+		/// @param info The probed info
+		void Insert(const std::string& reader_type, const std::string& path, const ReaderInfo& info);
+
+		/// Forget the info of all files
+		void Clear();
+
+		/// @brief Save the stored info to a JSON file
+		/// @returns false if the file can't be written
+		/// @param path The path of the JSON file
+		bool Save(const std::string& path);
+
+		/// @brief Load the stored info from a JSON file (adding to the stored info)
+		/// @returns false if the file can't be read, or is not a probe cache
+		/// @param path The path of the JSON file
+		bool Load(const std::string& path);
+
+		/// Get the number of stored files
+		int64_t Count();
+	};
+
+}
+
+#endif
@@ -0,0 +1,184 @@
+/**
+ * @file
+ * @brief Source file for ProtobufFrameIndex class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+#include <google/protobuf/message_lite.h>
+
+#include "ProtobufFrameIndex.h"
+
+using namespace openshot;
+
+namespace {
+	// Protobuf wire types
+	enum WireType { WIRE_VARINT = 0, WIRE_FIXED64 = 1, WIRE_LENGTH_DELIMITED = 2, WIRE_FIXED32 = 5 };
+
+	// Read a varint (returns false at the end of the data, or if the varint is invalid)
+	bool read_varint(const std::string& data, size_t& position, size_t end, uint64_t& value) {
+		value = 0;
+		for (int shift = 0; shift < 64 && position < end; shift += 7) {
+			const uint8_t byte = (uint8_t) data[position++];
+			value |= (uint64_t) (byte & 0x7F) << shift;
+			if (!(byte & 0x80))
+				return true;
+		}
+		return false;
+	}
+
+	// Skip the value of a field (returns false if the value is invalid)
+	bool skip_value(const std::string& data, size_t& position, size_t end, int wire_type, uint64_t& length) {
+		switch (wire_type) {
+			case WIRE_VARINT:
+				return read_varint(data, position, end, length);
+			case WIRE_FIXED64:
+				length = 8;
+				break;
+			case WIRE_LENGTH_DELIMITED:
+				if (!read_varint(data, position, end, length))
+					return false;
+				break;
+			case WIRE_FIXED32:
+				length = 4;
+				break;
+			default:
+				// Groups are not used by the data files
+				return false;
+		}
+		if (length > end - position)
+			return false;
+		position += length;
+		return true;
+	}
+
+	// Find the id of a serialized Frame (the first varint field, number 1)
+	int64_t frame_id(const std::string& data, size_t position, size_t end) {
+		while (position < end) {
+			uint64_t tag, value;
+			if (!read_varint(data, position, end, tag))
+				break;
+			const int wire_type = tag & 0x7;
+			if ((tag >> 3) == 1 && wire_type == WIRE_VARINT) {
+				if (read_varint(data, position, end, value))
+					return (int32_t) value;
+				break;
+			}
+			if (!skip_value(data, position, end, wire_type, value))
+				break;
+		}
+
+		// Default value (proto3 does not serialize zero)
+		return 0;
+	}
+}
+
+// Read and index a data file
+bool ProtobufFrameIndex::Open(const std::string& path)
+{
+	Clear();
+
+	std::ifstream input(path, std::ios::in | std::ios::binary);
+	if (!input.good())
+		return false;
+	std::string serialized((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+	if (input.bad())
+		return false;
+
+	return Load(std::move(serialized));
+}
+
+// Index a serialized message (already in memory)
+bool ProtobufFrameIndex::Load(std::string serialized)
+{
+	Clear();
+	data = std::move(serialized);
+
+	// Walk the fields of the top level message (without parsing the frames)
+	size_t position = 0;
+	const size_t end = data.size();
+	while (position < end) {
+		const size_t field_start = position;
+		uint64_t tag, length;
+		if (!read_varint(data, position, end, tag)) {
+			Clear();
+			return false;
+		}
+		const int wire_type = tag & 0x7;
+		if (!skip_value(data, position, end, wire_type, length)) {
+			Clear();
+			return false;
+		}
+
+		if ((tag >> 3) == 1 && wire_type == WIRE_LENGTH_DELIMITED) {
+			// A frame (the value is the last 'length' bytes of the field)
+			const size_t offset = position - length;
+			entries.push_back({frame_id(data, offset, position), offset, (size_t) length});
+		} else {
+			// Keep the other fields (a valid serialization of the message, without the frames)
+			header.append(data, field_start, position - field_start);
+		}
+	}
+
+	// Sort by frame id (keeping the last frame, if an id is repeated)
+	by_id.resize(entries.size());
+	for (size_t index = 0; index < entries.size(); index++)
+		by_id[index] = index;
+	std::stable_sort(by_id.begin(), by_id.end(), [this](size_t a, size_t b) {
+		return entries[a].id < entries[b].id;
+	});
+
+	return true;
+}
+
+// Release the data (and the index)
+void ProtobufFrameIndex::Clear()
+{
+	data.clear();
+	data.shrink_to_fit();
+	header.clear();
+	entries.clear();
+	by_id.clear();
+}
+
+// Find the entry of a frame id
+const ProtobufFrameIndex::Entry* ProtobufFrameIndex::find(int64_t id) const
+{
+	auto it = std::upper_bound(by_id.begin(), by_id.end(), id, [this](int64_t value, size_t index) {
+		return value < entries[index].id;
+	});
+	if (it == by_id.begin() || entries[*(it - 1)].id != id)
+		return nullptr;
+	return &entries[*(it - 1)];
+}
+
+// Parse the frame with an id
+bool ProtobufFrameIndex::ParseFrame(int64_t id, google::protobuf::MessageLite& message) const
+{
+	const Entry* entry = find(id);
+	if (!entry)
+		return false;
+	return message.ParseFromArray(data.data() + entry->offset, (int) entry->length);
+}
+
+// Parse the frame at an index
+bool ProtobufFrameIndex::ParseFrameAt(size_t index, google::protobuf::MessageLite& message) const
+{
+	const Entry& entry = entries.at(index);
+	return message.ParseFromArray(data.data() + entry.offset, (int) entry.length);
+}
+
+// Parse all the fields of the message, except the frames
+bool ProtobufFrameIndex::ParseHeader(google::protobuf::MessageLite& message) const
+{
+	return message.ParseFromArray(header.data(), (int) header.size());
+}
@@ -0,0 +1,110 @@
+/**
+ * @file
+ * @brief Header file for ProtobufFrameIndex class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_PROTOBUF_FRAME_INDEX_H
+#define OPENSHOT_PROTOBUF_FRAME_INDEX_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace google {
+	namespace protobuf {
+		class MessageLite;
+	}
+}
+
+namespace openshot
+{
+	/**
+	 * @brief An index of the frames in a protobuf data file (of the CV effects), which decodes each frame on demand.
+	 *
+	 * The tracker, object detection and stabilization data files all store a message with a
+	 * <tt>repeated Frame frame = 1</tt> field, where each Frame starts with an <tt>int32 id = 1</tt> field.
+	 * Instead of parsing the whole message (and copying every frame into a std::map), the file is read
+	 * into one buffer, and the wire format is scanned once to find the offset of each Frame (by frame id).
+	 * A Frame is only parsed when it is needed, so opening a large data file is fast, and the memory used
+	 * is little more than the size of the file.
+	 *
+	 * All the other fields of the message (such as the class names and the time stamp) are kept together,
+	 * and can be parsed with ParseHeader().
+	 *
+	 * \code
+	 * ProtobufFrameIndex index;
+	 * if (index.Open("stabilizer.data")) {
+	 *     pb_stabilize::Frame frame;
+	 *     if (index.ParseFrame(frame_number, frame))
+	 *         // ... use frame.dx(), frame.dy(), frame.da()
+	 * }
+	 * \endcode
+	 */
+	class ProtobufFrameIndex
+	{
+	private:
+		struct Entry {
+			int64_t id; ///< The frame id
+			size_t offset; ///< The offset of the serialized Frame (in data)
+			size_t length; ///< The length of the serialized Frame
+		};
+
+		std::string data; ///< The contents of the file
+		std::string header; ///< The serialized fields of the message (other than the frames)
+		std::vector<Entry> entries; ///< In the order of the file
+		std::vector<size_t> by_id; ///< Indexes of entries, sorted by frame id
+
+		/// Find the entry of a frame id (or nullptr)
+		const Entry* find(int64_t id) const;
+
+	public:
+		/// Default constructor
+		ProtobufFrameIndex() = default;
+
+		/// @brief Read and index a data file
+		/// @returns false if the file can't be read, or is not a valid protobuf message
+		/// @param path The path of the data file
+		bool Open(const std::string& path);
+
+		/// @brief Index a serialized message (already in memory)
+		/// @returns false if the data is not a valid protobuf message
+		/// @param serialized The serialized message
+		bool Load(std::string serialized);
+
+		/// Release the data (and the index)
+		void Clear();
+
+		/// Get the number of frames
+		size_t Count() const { return entries.size(); }
+
+		/// Determine if there is a frame with this id
+		bool Contains(int64_t id) const { return find(id) != nullptr; }
+
+		/// Get the id of the frame at an index (in the order of the file)
+		int64_t FrameId(size_t index) const { return entries.at(index).id; }
+
+		/// @brief Parse the frame with an id
+		/// @returns false if there is no such frame (or the frame can't be parsed)
+		/// @param id The frame id
+		/// @param message The Frame message to parse into
+		bool ParseFrame(int64_t id, google::protobuf::MessageLite& message) const;
+
+		/// @brief Parse the frame at an index (in the order of the file)
+		/// @param index The index of the frame
+		/// @param message The Frame message to parse into
+		bool ParseFrameAt(size_t index, google::protobuf::MessageLite& message) const;
+
+		/// @brief Parse all the fields of the message, except the frames
+		/// @param message The top level message (i.e. pb_objdetect::ObjDetect) to parse into
+		bool ParseHeader(google::protobuf::MessageLite& message) const;
+	};
+}
+
+#endif // OPENSHOT_PROTOBUF_FRAME_INDEX_H
@@ -0,0 +1,134 @@
+/**
+ * @file
+ * @brief Source file for ProxyGenerator class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+#include <cstdio>
+
+#include <QSize>
+
+#include "ProxyGenerator.h"
+#include "Exceptions.h"
+#include "FFmpegReader.h"
+#include "FFmpegWriter.h"
+
+using namespace openshot;
+
+// Constructor
+ProxyGenerator::ProxyGenerator(const std::string& source_path, const std::string& proxy_path, int max_width, int max_height)
+	: source_path(source_path), proxy_path(proxy_path), max_width(max_width), max_height(max_height),
+	  is_running(false), is_finished(false), is_canceled(false), frames_written(0), total_frames(0) { }
+
+// Destructor
+ProxyGenerator::~ProxyGenerator() {
+	// Stop the background thread (if any)
+	Cancel();
+}
+
+// Start generating the proxy on a background thread
+void ProxyGenerator::Start() {
+	// Ignore if already running
+	if (is_running)
+		return;
+
+	// Join the previous thread (if any)
+	if (worker.joinable())
+		worker.join();
+
+	// Reset state
+	is_running = true;
+	is_finished = false;
+	is_canceled = false;
+	frames_written = 0;
+	total_frames = 0;
+	error = nullptr;
+
+	worker = std::thread(&ProxyGenerator::Generate, this);
+}
+
+// Stop generating the proxy
+void ProxyGenerator::Cancel() {
+	is_canceled = true;
+	if (worker.joinable())
+		worker.join();
+}
+
+// Wait for the background thread to finish
+void ProxyGenerator::Wait() {
+	if (worker.joinable())
+		worker.join();
+
+	// Rethrow the exception from the background thread (if any)
+	if (error)
+		std::rethrow_exception(error);
+}
+
+// Get the progress of the proxy (from 0.0 to 1.0)
+float ProxyGenerator::Progress() const {
+	if (is_finished)
+		return 1.0;
+	if (total_frames <= 0)
+		return 0.0;
+	return float(frames_written) / float(total_frames);
+}
+
+// Write all frames of the source file to the proxy file
+void ProxyGenerator::Generate() {
+	try {
+		// Open the source file
+		FFmpegReader reader(source_path);
+		if (!reader.info.has_video)
+			throw InvalidFile("The file has no video stream to generate a proxy for.", source_path);
+		reader.Open();
+		total_frames = reader.info.video_length;
+
+		// Fit the proxy into the max size (maintain aspect ratio, and never scale up)
+		QSize proxy_size(reader.info.width, reader.info.height);
+		if (proxy_size.width() > max_width || proxy_size.height() > max_height)
+			proxy_size.scale(max_width, max_height, Qt::KeepAspectRatio);
+
+		// Most encoders require an even width and height
+		int width = std::max(2, proxy_size.width() - proxy_size.width() % 2);
+		int height = std::max(2, proxy_size.height() - proxy_size.height() % 2);
+
+		// Intra-only video (every frame can be decoded on its own, for fast seeking), and the same audio
+		FFmpegWriter writer(proxy_path);
+		writer.SetVideoOptions(true, "mjpeg", reader.info.fps, width, height, reader.info.pixel_ratio, false, false, 8000000);
+		if (reader.info.has_audio)
+			writer.SetAudioOptions(true, "aac", reader.info.sample_rate, reader.info.channels, reader.info.channel_layout, 192000);
+		writer.PrepareStreams();
+		writer.SetOption(VIDEO_STREAM, "g", "1");
+		writer.Open();
+
+		// Write each frame (the writer scales each image to the proxy size)
+		for (int64_t number = 1; number <= total_frames && !is_canceled; number++) {
+			writer.WriteFrame(reader.GetFrame(number));
+			frames_written = number;
+		}
+
+		// Close writer & reader
+		writer.Close();
+		reader.Close();
+
+		// Remove the partial proxy (if canceled)
+		if (is_canceled)
+			std::remove(proxy_path.c_str());
+		else
+			is_finished = true;
+	}
+	catch (...) {
+		// Keep the exception (for Wait), and remove the partial proxy
+		error = std::current_exception();
+		std::remove(proxy_path.c_str());
+	}
+
+	is_running = false;
+}
@@ -0,0 +1,105 @@
+/**
+ * @file
+ * @brief Header file for ProxyGenerator class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_PROXY_GENERATOR_H
+#define OPENSHOT_PROXY_GENERATOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <string>
+#include <thread>
+
+namespace openshot {
+
+	/**
+	 * @brief This class generates a low resolution proxy of a media file, on a background thread.
+	 *
+	 * Heavy sources (i.e. 4K HEVC or ProRes) are slow to decode and seek. A proxy is a small,
+	 * intra-only (MJPEG) copy of the same file, with the same frame rate, length and audio. Once
+	 * the proxy is finished, pass it to FFmpegReader::SetProxy(), and the reader will use the proxy
+	 * whenever the timeline only needs a small preview (see Timeline::SetMaxSize), and the original
+	 * file for anything larger (i.e. final export).
+	 *
+	 * \code
+	 * // Generate a 640x360 proxy (in the background)
+	 * ProxyGenerator generator("MyVideo.mp4", "MyVideo.proxy.mov", 640, 360);
+	 * generator.Start();
+	 *
+	 * // Wait for the proxy (or check IsFinished() and Progress() periodically)
+	 * generator.Wait();
+	 *
+	 * // Read frames from the proxy (for small previews)
+	 * reader.SetProxy(generator.ProxyPath());
+	 * \endcode
+	 */
+	class ProxyGenerator {
+	private:
+		std::string source_path;
+		std::string proxy_path;
+		int max_width;
+		int max_height;
+
+		std::thread worker;
+		std::atomic<bool> is_running;
+		std::atomic<bool> is_finished;
+		std::atomic<bool> is_canceled;
+		std::atomic<int64_t> frames_written;
+		std::atomic<int64_t> total_frames;
+		std::exception_ptr error;
+
+		/// Write all frames of the source file to the proxy file (called on the background thread)
+		void Generate();
+
+		/// Don't allow the user to copy or assign this generator
+		ProxyGenerator(ProxyGenerator const&) = delete;
+		ProxyGenerator & operator=(ProxyGenerator const&) = delete;
+
+	public:
+		/// @brief Constructor for ProxyGenerator
+		/// @param source_path The media file to generate a proxy for
+		/// @param proxy_path The proxy file to write (i.e. with a ".mov" or ".avi" extension)
+		/// @param max_width The max width of the proxy (the aspect ratio of the source is kept)
+		/// @param max_height The max height of the proxy (the aspect ratio of the source is kept)
+		ProxyGenerator(const std::string& source_path, const std::string& proxy_path, int max_width=640, int max_height=360);
+
+		/// Destructor (cancels the proxy, if it's not finished)
+		virtual ~ProxyGenerator();
+
+		/// Start generating the proxy on a background thread
+		void Start();
+
+		/// Stop generating the proxy (the partial proxy file is removed)
+		void Cancel();
+
+		/// Wait for the background thread to finish (and rethrow any exception it encountered)
+		void Wait();
+
+		/// Determine if the proxy is being generated
+		bool IsRunning() const { return is_running; };
+
+		/// Determine if the proxy was successfully generated
+		bool IsFinished() const { return is_finished; };
+
+		/// Get the progress of the proxy (from 0.0 to 1.0)
+		float Progress() const;
+
+		/// Get the path of the proxy file
+		std::string ProxyPath() const { return proxy_path; };
+
+		/// Get the path of the source file
+		std::string SourcePath() const { return source_path; };
+	};
+
+}
+
+#endif
@@ -18,9 +18,11 @@
 #include "../RendererBase.h"
 #include "../AudioReaderSource.h"
 #include "../AudioDevices.h"
+#include "../RenderStats.h"
 #include "../Settings.h"
 #include "../ZmqLogger.h"
 
+#include <algorithm>
 #include <mutex>
 #include <thread>	// for std::this_thread::sleep_for
 #include <chrono>	// for std::chrono::milliseconds
@@ -47,6 +49,7 @@ namespace openshot
 
 		if (!m_pInstance) {
 			// Create the actual instance of device manager only once
+			RenderInitTimer timer(INIT_STAGE_AUDIO_DEVICE);
 			m_pInstance = new AudioDeviceManagerSingleton;
 			auto* mgr = &m_pInstance->audioDeviceManager;
 			AudioIODevice *foundAudioIODevice = NULL;
@@ -55,11 +58,18 @@ namespace openshot
 			m_pInstance->currentAudioDevice.type = "";
 			m_pInstance->defaultSampleRate = 0.0;
 
+			// Render-only processes don't scan or open audio devices
+			if (Settings::Instance()->HEADLESS) {
+				m_pInstance->initialise_error = "No audio device (headless)";
+				ZMQ_DEBUG("AudioDeviceManagerSingleton::Instance (headless, no audio device)");
+				return m_pInstance;
+			}
+
 			std::stringstream constructor_title;
 			constructor_title << "AudioDeviceManagerSingleton::Instance (default audio device type: " <<
 			Settings::Instance()->PLAYBACK_AUDIO_DEVICE_TYPE << ", default audio device name: " <<
 			Settings::Instance()->PLAYBACK_AUDIO_DEVICE_NAME << ")";
-			ZmqLogger::Instance()->AppendDebugMethod(constructor_title.str(), "channels", channels);
+			ZMQ_DEBUG(constructor_title.str(), "channels", channels);
 
 			// Get preferred audio device type and name (if any - these can be blank)
 			openshot::AudioDeviceInfo requested_device = {Settings::Instance()->PLAYBACK_AUDIO_DEVICE_TYPE,
@@ -104,6 +114,7 @@ namespace openshot
 				AudioDeviceManager::AudioDeviceSetup deviceSetup = AudioDeviceManager::AudioDeviceSetup();
 				deviceSetup.inputChannels = 0;
 				deviceSetup.outputChannels = channels;
+				deviceSetup.bufferSize = std::max(0, Settings::Instance()->PLAYBACK_AUDIO_BUFFER_SIZE);
 
 				// Loop through common sample rates, starting with the user's requested rate
 				// Not all sample rates are supported by audio devices, for example, many VMs
@@ -112,7 +123,7 @@ namespace openshot
 				for(int attempt_rate : possible_rates) {
 					std::stringstream title_rate;
 					title_rate << "AudioDeviceManagerSingleton::Instance (attempt audio device name: " <<  attempt_device.name << ")";
-					ZmqLogger::Instance()->AppendDebugMethod(title_rate.str(), "rate", attempt_rate, "channels", channels);
+					ZMQ_DEBUG(title_rate.str(), "rate", attempt_rate, "channels", channels);
 
 					// Update the audio device setup for the current sample rate
 					m_pInstance->defaultSampleRate = attempt_rate;
@@ -137,7 +148,7 @@ namespace openshot
 						std::stringstream title_error;
 						title_error << "AudioDeviceManagerSingleton::Instance (audio device error: " <<
 						m_pInstance->initialise_error << ")";
-						ZmqLogger::Instance()->AppendDebugMethod(title_error.str(), "rate", attempt_rate, "channels", channels);
+						ZMQ_DEBUG(title_error.str(), "rate", attempt_rate, "channels", channels);
 					}
 
 					// Determine if audio device was opened successfully, and matches the attempted sample rate
@@ -148,7 +159,7 @@ namespace openshot
 						std::stringstream title_found;
 						title_found << "AudioDeviceManagerSingleton::Instance (successful audio device found: " <<
 						foundAudioIODevice->getTypeName() << ", name: " << foundAudioIODevice->getName() << ")";
-						ZmqLogger::Instance()->AppendDebugMethod(title_found.str(), "rate", attempt_rate, "channels", channels);
+						ZMQ_DEBUG(title_found.str(), "rate", attempt_rate, "channels", channels);
 						break;
 					}
 				}
@@ -159,11 +170,17 @@ namespace openshot
 				}
 			}
 
-			ZmqLogger::Instance()->AppendDebugMethod("AudioDeviceManagerSingleton::Instance (audio device initialization completed)");
+			ZMQ_DEBUG("AudioDeviceManagerSingleton::Instance (audio device initialization completed)");
 		}
 		return m_pInstance;
 	}
 
+	// Has the device manager been created (and an audio device opened)?
+	bool AudioDeviceManagerSingleton::Created()
+	{
+		return m_pInstance != NULL;
+	}
+
 	// Close audio device
 	void AudioDeviceManagerSingleton::CloseAudioDevice()
 	{
@@ -180,13 +197,10 @@ namespace openshot
 	AudioPlaybackThread::AudioPlaybackThread(openshot::VideoCacheThread* cache)
 	: juce::Thread("audio-playback")
 	, player()
-	, transport()
-	, mixer()
 	, source(NULL)
 	, sampleRate(0.0)
 	, numChannels(0)
 	, is_playing(false)
-	, time_thread("audio-buffer")
 	, videoCache(cache)
 	{
 	}
@@ -210,7 +224,7 @@ namespace openshot
 		sampleRate = reader->info.sample_rate;
 		numChannels = reader->info.channels;
 
-        ZmqLogger::Instance()->AppendDebugMethod("AudioPlaybackThread::Reader", "rate", sampleRate, "channel", numChannels);
+        ZMQ_DEBUG("AudioPlaybackThread::Reader", "rate", sampleRate, "channel", numChannels);
 
 		// Set video cache thread
 		source->setVideoCache(videoCache);
@@ -251,53 +265,41 @@ namespace openshot
 	{
 		while (!threadShouldExit())
 		{
-			if (source && !transport.isPlaying() && is_playing) {
+			if (source && is_playing) {
 				// Start new audio device (or get existing one)
 				AudioDeviceManagerSingleton *audioInstance = 
 						AudioDeviceManagerSingleton::Instance(sampleRate, numChannels);
 
-				// Add callback
-				audioInstance->audioDeviceManager.addAudioCallback(&player);
-
-				// Create TimeSliceThread for audio buffering
-				time_thread.startThread();
+				// Queue the audio at the rate of the open device (which may not support the reader's rate)
+				double deviceRate = sampleRate;
+				AudioIODevice *device = audioInstance->audioDeviceManager.getCurrentAudioDevice();
+				if (device && device->getCurrentSampleRate() > 0)
+					deviceRate = device->getCurrentSampleRate();
+				if (videoCache)
+					videoCache->setAudioOutputRate(int(deviceRate));
 
-				// Connect source to transport
-				transport.setSource(
-					source,
-					0, // No read ahead buffer
-					&time_thread,
-					0, // Sample rate correction (none)
-					numChannels); // max channels
-				transport.setPosition(0);
-				transport.setGain(1.0);
+				ZMQ_DEBUG("AudioPlaybackThread::run (start audio device)",
+					"rate", sampleRate, "device rate", deviceRate,
+					"buffer size", device ? device->getCurrentBufferSizeSamples() : 0);
 
-				// Connect transport to mixer and player
-				mixer.addInputSource(&transport, false);
-				player.setSource(&mixer);
-
-				// Start the transport
-				transport.start();
+				// The device copies the queued audio straight into its buffers
+				player.setSource(source);
+				audioInstance->audioDeviceManager.addAudioCallback(&player);
 
-				while (!threadShouldExit() && transport.isPlaying() && is_playing)
+				while (!threadShouldExit() && is_playing)
 					std::this_thread::sleep_for(std::chrono::milliseconds(2));
 
-				// Stop audio and shutdown transport
+				// Stop audio
 				Stop();
-				transport.stop();
-
-				// Kill previous audio
-				transport.setSource(NULL);
-
-				player.setSource(NULL);
 				audioInstance->audioDeviceManager.removeAudioCallback(&player);
+				player.setSource(NULL);
 
 				// Remove source
 				delete source;
 				source = NULL;
-
-				// Stop time slice thread
-				time_thread.stopThread(-1);
+			} else {
+				// Wait for a reader (or for playback to start)
+				std::this_thread::sleep_for(std::chrono::milliseconds(2));
 			}
 		}
 
@@ -64,6 +64,10 @@ public:
 		/// sample rate and channels are only set on 1st call (when singleton is created)
 		static AudioDeviceManagerSingleton* Instance(int rate, int channels);
 
+		/// Has the device manager been created (i.e. by playback)? Instance() opens an audio device, so
+		/// check this first to avoid opening one just to close it.
+		static bool Created();
+
 		/// Public device manager property
 		juce::AudioDeviceManager audioDeviceManager;
 
@@ -73,18 +77,20 @@ public:
 
 	/**
 	 *  @brief The audio playback thread
+	 *
+	 *  The audio device plays the openshot::AudioReaderSource directly, which copies the rendered audio
+	 *  (queued by openshot::VideoCacheThread) into the device's buffers. When the device's sample rate
+	 *  differs from the reader's, the audio is resampled once as it is queued (see
+	 *  VideoCacheThread::setAudioOutputRate), so the audio device thread never resamples or mixes.
 	 */
 	class AudioPlaybackThread : juce::Thread
 	{
 		juce::AudioSourcePlayer player;
-		juce::AudioTransportSource transport;
-		juce::MixerAudioSource mixer;
 		AudioReaderSource *source;
 		double sampleRate;
 		int numChannels;
 		juce::WaitableEvent play;
 		bool is_playing;
-		juce::TimeSliceThread time_thread;
 		openshot::VideoCacheThread *videoCache; /// The cache thread (for pre-roll checking)
 
 		/// Constructor
@@ -13,10 +13,14 @@
 
 #include "PlayerPrivate.h"
 #include "Exceptions.h"
+#include "PlaybackClock.h"
+#include "Settings.h"
+#include "Timeline.h"
 
+#include <algorithm>
 #include <queue>
-#include <thread>    // for std::this_thread::sleep_for
-#include <chrono>    // for std::chrono microseconds, high_resolution_clock
+#include <thread>    // for std::this_thread::sleep_until
+#include <chrono>    // for std::chrono microseconds, steady_clock
 
 namespace openshot
 {
@@ -24,7 +28,9 @@ namespace openshot
     // Constructor
     PlayerPrivate::PlayerPrivate(openshot::RendererBase *rb)
     : renderer(rb), Thread("player"), video_position(1), audio_position(0),
-      speed(1), reader(NULL), last_video_position(1), max_sleep_ms(125000), playback_frames(0), is_dirty(true)
+      speed(1), reader(NULL), last_video_position(1), max_sleep_ms(125000), playback_frames(0), is_dirty(true),
+      fast_seek(false), last_seek_time(0), scrub_reader(NULL), scrub_width(0), scrub_height(0),
+      scrub_quality(openshot::RENDER_QUALITY_FINAL)
     {
         videoCache = new openshot::VideoCacheThread();
         audioPlayback = new openshot::AudioPlaybackThread(videoCache);
@@ -55,15 +61,13 @@ namespace openshot
             videoPlayback->startThread(4);
         }
 
-        using std::chrono::duration_cast;
-
         // Types for storing time durations in whole and fractional microseconds
         using micro_sec = std::chrono::microseconds;
         using double_micro_sec = std::chrono::duration<double, micro_sec::period>;
 
-        // Init start_time of playback
-        std::chrono::time_point<std::chrono::system_clock, std::chrono::microseconds> start_time;
-        start_time = std::chrono::time_point_cast<micro_sec>(std::chrono::system_clock::now()); ///< timestamp playback starts
+        // Init the playback clock (on steady_clock, and slaved to the audio device while audio is playing)
+        openshot::PlaybackClock clock;
+        clock.Reset(video_position, reader->info.fps.ToDouble(), speed);
 
         while (!threadShouldExit()) {
             // Calculate on-screen time for a single frame
@@ -71,6 +75,9 @@ namespace openshot
             const auto frame_duration = double_micro_sec(1000000.0 / (reader->info.fps.ToDouble() * frame_speed));
             const auto max_sleep = frame_duration * 4; ///< Don't sleep longer than X times a frame duration
 
+            // Switch to (or back from) the draft preview of fast scrubs
+            updateScrubPreview();
+
             // Pausing Code (which re-syncs audio/video times)
             // - If speed is zero or speed changes
             // - If pre-roll is not ready (This should allow scrubbing of the timeline without waiting on pre-roll)
@@ -81,8 +88,8 @@ namespace openshot
                 // Sleep for a fraction of frame duration
                 std::this_thread::sleep_for(frame_duration / 4);
 
-                // Reset current playback start time
-                start_time = std::chrono::time_point_cast<std::chrono::microseconds>(std::chrono::system_clock::now());
+                // Restart the playback clock at the current frame
+                clock.Reset(video_position, reader->info.fps.ToDouble(), speed);
                 playback_frames = 0;
                 last_speed = speed;
 
@@ -92,6 +99,26 @@ namespace openshot
                 continue;
             }
 
+            // Follow the audio device (the audio only plays at normal speed)
+            if (speed == 1 && reader->info.has_audio)
+                clock.SyncToAudio(videoCache->getAudioRing()->CurrentFrame());
+
+            // A seek is displayed right away (and restarts the clock)
+            const bool seeking = is_dirty;
+            if (speed != 0 && !seeking) {
+                // Sleep until the next frame is due (protect against invalid or too-long sleep times)
+                const auto now = openshot::PlaybackClock::clock::now();
+                const auto next_time = clock.FrameTime(video_position + speed);
+                const auto latest_time = now + std::chrono::duration_cast<openshot::PlaybackClock::clock::duration>(max_sleep);
+                if (next_time > now)
+                    std::this_thread::sleep_until(std::min(next_time, latest_time));
+
+                // Skip the late frames (if rendering fell behind the clock), instead of displaying every frame late
+                const int64_t due_frame = clock.Frame();
+                if ((due_frame - video_position) / speed > 1)
+                    video_position = due_frame - speed;
+            }
+
             // Get the current video frame
             frame = getFrame();
 
@@ -103,20 +130,8 @@ namespace openshot
             last_video_position = video_position;
             last_speed = speed;
 
-            // Calculate the diff between 'now' and the predicted frame end time
-            const auto current_time = std::chrono::system_clock::now();
-            const auto remaining_time = double_micro_sec(start_time +
-                    (frame_duration * playback_frames) - current_time);
-
-            // Sleep to display video image on screen
-            if (remaining_time > remaining_time.zero() ) {
-                if (remaining_time < max_sleep) {
-                    std::this_thread::sleep_for(remaining_time);
-                } else {
-                    // Protect against invalid or too-long sleep times
-                    std::this_thread::sleep_for(max_sleep);
-                }
-            }
+            if (seeking)
+                clock.Reset(video_position, reader->info.fps.ToDouble(), speed);
         }
     }
 
@@ -165,14 +180,63 @@ namespace openshot
     return std::shared_ptr<openshot::Frame>();
     }
 
+    // Get the steady_clock time (in microseconds)
+    static int64_t steady_time_us()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
     // Seek to a new position
     void PlayerPrivate::Seek(int64_t new_position)
     {
+        // Detect fast scrubs (paused seeks in quick succession, which move the playhead faster than SCRUB_DRAFT_FPS)
+        const Settings *s = Settings::Instance();
+        const int64_t now = steady_time_us();
+        const int64_t elapsed = std::max(now - last_seek_time, int64_t(1));
+        fast_seek = s->SCRUB_DRAFT_FPS > 0 && speed == 0 && elapsed < int64_t(s->SCRUB_SETTLE_MS) * 1000 &&
+            std::abs(new_position - video_position) * 1000000.0 / elapsed > s->SCRUB_DRAFT_FPS;
+        last_seek_time = now;
+
         video_position = new_position;
         last_video_position = 0;
         is_dirty = true;
     }
 
+    // Render fast scrubs of a timeline at a small draft preview, and restore the preview once the playhead settles
+    void PlayerPrivate::updateScrubPreview()
+    {
+        const Settings *s = Settings::Instance();
+        Timeline *timeline = dynamic_cast<Timeline *>(reader);
+
+        // The scrubbed timeline was replaced (by another reader)
+        if (scrub_reader && scrub_reader != reader)
+            scrub_reader = NULL;
+
+        // A fast scrub settles once the playhead has not moved for a while
+        if (fast_seek && steady_time_us() - last_seek_time >= int64_t(s->SCRUB_SETTLE_MS) * 1000)
+            fast_seek = false;
+
+        if (!scrub_reader && timeline && fast_seek && speed == 0) {
+            // Render the frames of the scrub at a small size and draft quality (the cached frames of the
+            // full preview are kept by the timeline)
+            scrub_width = timeline->preview_width;
+            scrub_height = timeline->preview_height;
+            scrub_quality = timeline->GetRenderQuality();
+            timeline->SetMaxSize(std::min(s->SCRUB_PREVIEW_WIDTH, scrub_width), std::min(s->SCRUB_PREVIEW_HEIGHT, scrub_height));
+            timeline->SetRenderQuality(openshot::RENDER_QUALITY_DRAFT);
+            scrub_reader = timeline;
+
+        } else if (scrub_reader && (!fast_seek || speed != 0)) {
+            // Restore the full preview, and render the frame at the playhead again
+            timeline->SetMaxSize(scrub_width, scrub_height);
+            timeline->SetRenderQuality(scrub_quality);
+            scrub_reader = NULL;
+            last_video_position = 0;
+            is_dirty = true;
+        }
+    }
+
     // Start video/audio playback
     bool PlayerPrivate::startPlayback()
     {
@@ -21,6 +21,8 @@
 #include "../Qt/VideoPlaybackThread.h"
 #include "../Qt/VideoCacheThread.h"
 
+#include <atomic>
+
 namespace openshot
 {
     /**
@@ -43,6 +45,12 @@ namespace openshot
 	int64_t last_video_position; /// The last frame actually displayed
 	int max_sleep_ms; /// The max milliseconds to sleep (when syncing audio and video)
 	bool is_dirty; /// Detect if a frame needs to be refreshed (calls to Seek() set this to true)
+	std::atomic<bool> fast_seek; /// Is the playhead scrubbed faster than Settings::SCRUB_DRAFT_FPS?
+	std::atomic<int64_t> last_seek_time; /// The time of the last Seek() (in steady_clock microseconds)
+	openshot::ReaderBase *scrub_reader; /// The timeline rendering a fast scrub at draft quality (if any)
+	int scrub_width; /// The preview width restored once the scrub settles
+	int scrub_height; /// The preview height restored once the scrub settles
+	openshot::RenderQuality scrub_quality; /// The render quality restored once the scrub settles
 
 	/// Constructor
 	PlayerPrivate(openshot::RendererBase *rb);
@@ -64,6 +72,9 @@ namespace openshot
 	/// Get the next frame (based on speed and direction)
 	std::shared_ptr<openshot::Frame> getFrame();
 
+	/// Render fast scrubs of a timeline at a small draft preview, and restore the preview once the playhead settles
+	void updateScrubPreview();
+
 	/// The parent class of PlayerPrivate
 	friend class QtPlayer;
     };
@@ -13,13 +13,16 @@
 #include "VideoCacheThread.h"
 
 #include "CacheBase.h"
+#include "CacheBudget.h"
 #include "Exceptions.h"
 #include "Frame.h"
 #include "OpenMPUtilities.h"
+#include "RenderTrace.h"
 #include "Settings.h"
 #include "Timeline.h"
 
 #include <algorithm>
+#include <cmath>
 #include <thread>    // for std::this_thread::sleep_for
 #include <chrono>    // for std::chrono::microseconds
 
@@ -30,13 +33,15 @@ namespace openshot
 	: Thread("video-cache"), speed(0), last_speed(1), is_playing(false),
 	reader(NULL), current_display_frame(1), cached_frame_count(0),
 	min_frames_ahead(4), max_frames_ahead(8), should_pause_cache(false),
-	timeline_max_frame(0), should_break(false)
+	timeline_max_frame(0), render_seconds(0.0), stop_workers(false), audio_output_rate(0),
+	audio_ring_rate(0), last_audio_frame(0)
     {
     }
 
     // Destructor
 	VideoCacheThread::~VideoCacheThread()
     {
+        stopWorkers();
     }
 
 	// Seek the reader to a particular frame number
@@ -74,8 +79,8 @@ namespace openshot
             // Clear cache
             t->ClearAllCache();
 
-            // Break out of any existing cache loop
-            should_break = true;
+            // Drop the queued (and rendering) frames of the previous position
+            cancelQueuedFrames(true);
 
             // Force cache direction back to forward
             last_speed = 1;
@@ -83,8 +88,8 @@ namespace openshot
 
         // Reset pre-roll when requested frame is not currently cached
         if (start_preroll && reader && reader->GetCache() && !reader->GetCache()->Contains(new_position)) {
-            // Break out of any existing cache loop
-            should_break = true;
+            // Drop the queued (and rendering) frames of the previous position
+            cancelQueuedFrames(true);
 
             // Reset stats and allow cache to rebuild (if paused)
             cached_frame_count = 0;
@@ -99,6 +104,10 @@ namespace openshot
 
     // Set Speed (The speed and direction to playback a reader (1=normal, 2=fast, 3=faster, -1=rewind, etc...)
     void VideoCacheThread::setSpeed(int new_speed) {
+        // The queued frames are in the wrong direction (or step)
+        if (new_speed != speed)
+            cancelQueuedFrames();
+
         if (new_speed != 0) {
             // Track last non-zero speed
             last_speed = new_speed;
@@ -119,6 +128,134 @@ namespace openshot
         return total_bytes;
     }
 
+    // Start the worker threads
+    void VideoCacheThread::startWorkers(int count)
+    {
+        stopWorkers();
+        stop_workers = false;
+        for (int index = 0; index < std::max(1, count); index++)
+            workers.emplace_back(&VideoCacheThread::renderWorker, this);
+    }
+
+    // Stop (and join) the worker threads
+    void VideoCacheThread::stopWorkers()
+    {
+        {
+            const std::lock_guard<std::mutex> lock(work_mutex);
+            stop_workers = true;
+            work_queue.clear();
+        }
+        work_condition.notify_all();
+        for (auto& worker : workers)
+            worker.join();
+        workers.clear();
+    }
+
+    // Render queued frames (until stopped)
+    void VideoCacheThread::renderWorker()
+    {
+        RenderTrace::Instance()->SetThreadName("VideoCacheThread worker");
+        while (true) {
+            // Wait for the next frame
+            int64_t frame_number = 0;
+            std::shared_ptr<FrameRequest> request;
+            {
+                std::unique_lock<std::mutex> lock(work_mutex);
+                work_condition.wait(lock, [this] { return stop_workers || !work_queue.empty(); });
+                if (stop_workers)
+                    return;
+                frame_number = work_queue.front();
+                work_queue.pop_front();
+                request = std::make_shared<FrameRequest>(reader, frame_number);
+                work_in_flight[frame_number] = request;
+            }
+
+            // Render the frame on this thread (which adds it to the timeline cache).
+            // Seeking cancels the request, which stops the render at the next safe point.
+            std::shared_ptr<Frame> frame;
+            double seconds = -1.0;
+            try {
+                if (reader && reader->GetCache() && !reader->GetCache()->Contains(frame_number)) {
+                    const auto render_start = std::chrono::steady_clock::now();
+                    RenderTraceSpan span("VideoCacheThread prefetch", "prefetch");
+                    request->Run();
+                    frame = request->Get();
+                    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - render_start).count();
+                }
+            }
+            catch (const FrameRequestCancelled & e) { }
+            catch (const OutOfBoundsFrame & e) { }
+            catch (const ReaderClosed & e) { }
+
+            const std::lock_guard<std::mutex> lock(work_mutex);
+            work_in_flight.erase(frame_number);
+            if (frame)
+                last_cached_frame = frame;
+
+            // Track the render cost (moving average of uncached frames)
+            if (seconds >= 0.0)
+                render_seconds = (render_seconds > 0.0) ? (render_seconds * 0.8 + seconds * 0.2) : seconds;
+        }
+    }
+
+    // Replace the queued frames
+    void VideoCacheThread::queueFrames(const std::vector<int64_t>& frame_numbers)
+    {
+        {
+            const std::lock_guard<std::mutex> lock(work_mutex);
+            work_queue.clear();
+            for (auto frame_number : frame_numbers) {
+                // Skip frames which are already rendering
+                if (!work_in_flight.count(frame_number))
+                    work_queue.push_back(frame_number);
+            }
+        }
+        work_condition.notify_all();
+    }
+
+    // Drop all queued frames
+    void VideoCacheThread::cancelQueuedFrames(bool cancel_rendering)
+    {
+        const std::lock_guard<std::mutex> lock(work_mutex);
+        work_queue.clear();
+        if (cancel_rendering) {
+            for (auto& rendering : work_in_flight)
+                rendering.second->Cancel();
+        }
+    }
+
+    // Get the max # of frames to cache ahead (the VIDEO_CACHE_PERCENT_AHEAD part of the cache)
+    int64_t VideoCacheThread::getCacheFrameLimit()
+    {
+        Settings *s = Settings::Instance();
+        int64_t frame_limit = s->VIDEO_CACHE_MAX_PREROLL_FRAMES;
+
+        // Calculate bytes per frame
+        int64_t bytes_per_frame = getBytes(reader->info.width, reader->info.height,
+                                           reader->info.sample_rate, reader->info.channels,
+                                           reader->info.fps.ToFloat());
+        Timeline *t = (Timeline *) reader;
+        if (t->preview_width != reader->info.width || t->preview_height != reader->info.height) {
+            // If we have a different timeline preview size, use that instead (the preview
+            // window can be smaller, can thus reduce the bytes per frame)
+            bytes_per_frame = getBytes(t->preview_width, t->preview_height,
+                                           reader->info.sample_rate, reader->info.channels,
+                                           reader->info.fps.ToFloat());
+        }
+
+        // Calculate # of frames on Timeline cache
+        if (reader->GetCache() && reader->GetCache()->GetMaxBytes() > 0 && bytes_per_frame > 0) {
+            // Limit the cached frames to the following % of total cache size.
+            // This allows for us to leave some cache behind the plahead, and some in front of the playhead.
+            frame_limit = (reader->GetCache()->GetMaxBytes() / bytes_per_frame) * s->VIDEO_CACHE_PERCENT_AHEAD;
+            if (frame_limit > s->VIDEO_CACHE_MAX_FRAMES) {
+                // Ignore values that are too large, and default to a safer value
+                frame_limit = s->VIDEO_CACHE_MAX_FRAMES;
+            }
+        }
+        return frame_limit;
+    }
+
 	// Play the video
 	void VideoCacheThread::Play() {
 		// Start playing
@@ -136,6 +273,59 @@ namespace openshot
 	    return (cached_frame_count > min_frames_ahead);
 	}
 
+    // Queue the audio of the next frames (until the audio ring is full)
+    void VideoCacheThread::fillAudioRing()
+    {
+        if (!reader)
+            return;
+
+        // Resample once (here, and not on the audio device thread) when the device has another rate
+        const int reader_rate = reader->info.sample_rate;
+        const int output_rate = audio_output_rate;
+        const bool resample = output_rate > 0 && reader_rate > 0 && output_rate != reader_rate;
+        const int ring_rate = resample ? output_rate : reader_rate;
+        if (ring_rate != audio_ring_rate) {
+            // The queued audio has the wrong rate (i.e. it was queued before the audio device was opened)
+            if (audio_ring_rate > 0)
+                audio_ring.Reset(audio_ring.CurrentFrame(), true);
+            audio_ring_rate = ring_rate;
+        }
+
+        int64_t frame_number = 0;
+        while (audio_ring.NextFrame(frame_number)) {
+            // Don't queue past the end of the timeline
+            if (frame_number < 1 || (timeline_max_frame > 0 && frame_number > timeline_max_frame))
+                break;
+
+            // Most frames are already cached (i.e. by the cache loop)
+            std::shared_ptr<Frame> frame;
+            if (reader->GetCache())
+                frame = reader->GetCache()->GetFrame(frame_number);
+            try {
+                if (!frame)
+                    frame = reader->GetFrame(frame_number);
+            }
+            catch (const OutOfBoundsFrame & e) { }
+            if (!frame || !frame->GetAudioSampleBuffer())
+                break;
+
+            juce::AudioBuffer<float> *samples = frame->GetAudioSampleBuffer();
+            const int sample_count = std::max(0, std::min(frame->GetAudioSamplesCount(), samples->getNumSamples()));
+            if (resample) {
+                // The resampler continues from the previous frame (and forgets it after a seek)
+                if (frame_number != last_audio_frame + 1)
+                    audio_resampler.Reset();
+                juce::AudioBuffer<float> input(samples->getArrayOfWritePointers(), samples->getNumChannels(), sample_count);
+                audio_resampler.SetBuffer(&input, reader_rate, output_rate);
+                juce::AudioBuffer<float> *resampled = audio_resampler.GetResampledBuffer();
+                audio_ring.Push(frame_number, *resampled, resampled->getNumSamples());
+            } else {
+                audio_ring.Push(frame_number, *samples, sample_count);
+            }
+            last_audio_frame = frame_number;
+        }
+    }
+
     // Start the thread
     void VideoCacheThread::run()
     {
@@ -143,6 +333,9 @@ namespace openshot
         using micro_sec = std::chrono::microseconds;
         using double_micro_sec = std::chrono::duration<double, micro_sec::period>;
 
+        // Start the threads which render the frames
+        startWorkers(Settings::Instance()->VIDEO_CACHE_THREADS);
+
         while (!threadShouldExit() && is_playing) {
             // Get settings
             Settings *s = Settings::Instance();
@@ -165,8 +358,9 @@ namespace openshot
                 cached_frame_count = 0;
             }
 
-            // Update current display frame
+            // Update current display frame (and tell the cache where the playhead is, so it keeps the nearest frames)
             current_display_frame = requested_display_frame;
+            reader->GetCache()->SetPlayhead(current_display_frame, (current_speed != 0 ? current_speed : last_speed) < 0 ? -1 : 1);
 
             if (current_speed == 0 && should_pause_cache || !s->ENABLE_PLAYBACK_CACHING) {
                 // Sleep during pause (after caching additional frames when paused)
@@ -179,29 +373,8 @@ namespace openshot
                 // To allow the cache to fill-up only on the initial pause.
                 should_pause_cache = true;
 
-                // Calculate bytes per frame
-                int64_t bytes_per_frame = getBytes(reader->info.width, reader->info.height,
-                                                   reader->info.sample_rate, reader->info.channels,
-                                                   reader->info.fps.ToFloat());
-                Timeline *t = (Timeline *) reader;
-                if (t->preview_width != reader->info.width || t->preview_height != reader->info.height) {
-                    // If we have a different timeline preview size, use that instead (the preview
-                    // window can be smaller, can thus reduce the bytes per frame)
-                    bytes_per_frame = getBytes(t->preview_width, t->preview_height,
-                                                   reader->info.sample_rate, reader->info.channels,
-                                                   reader->info.fps.ToFloat());
-                }
-
                 // Calculate # of frames on Timeline cache (when paused)
-                if (reader->GetCache() && reader->GetCache()->GetMaxBytes() > 0) {
-                    // When paused, limit the cached frames to the following % of total cache size.
-                    // This allows for us to leave some cache behind the plahead, and some in front of the playhead.
-                    max_frames_ahead = (reader->GetCache()->GetMaxBytes() / bytes_per_frame) * s->VIDEO_CACHE_PERCENT_AHEAD;
-                    if (max_frames_ahead > s->VIDEO_CACHE_MAX_FRAMES) {
-                        // Ignore values that are too large, and default to a safer value
-                        max_frames_ahead = s->VIDEO_CACHE_MAX_FRAMES;
-                    }
-                }
+                max_frames_ahead = getCacheFrameLimit();
 
                 // Overwrite the increment to our cache position
                 // to fully cache frames while paused (support forward and rewind caching)
@@ -213,58 +386,69 @@ namespace openshot
             } else {
                 // normal playback
                 should_pause_cache = false;
+
+                // Cache the frames which will be displayed (in the direction and step of playback)
+                increment = current_speed;
+
+                // Size the look-ahead to the render deficit: when frames take longer to render (by all workers) than to
+                // display, the frames buffered ahead are used up faster than they are replaced, so buffer
+                // proportionally more (limited by the cache size).
+                const double display_seconds = 1.0 / (reader->info.fps.ToDouble() * std::abs(current_speed));
+                double frame_seconds = 0.0;
+                {
+                    const std::lock_guard<std::mutex> lock(work_mutex);
+                    frame_seconds = render_seconds / std::max<size_t>(1, workers.size());
+                }
+                const double deficit = std::max(1.0, frame_seconds / display_seconds);
+                max_frames_ahead = std::max<int64_t>(max_frames_ahead, std::ceil(max_frames_ahead * deficit));
+                max_frames_ahead = std::min(max_frames_ahead, std::max<int64_t>(s->VIDEO_CACHE_MAX_PREROLL_FRAMES, getCacheFrameLimit()));
             }
 
+            // While all caches together exceed their budget, only cache the minimum frames ahead (see CacheBudget)
+            if (CacheBudget::Instance()->IsOverBudget())
+                max_frames_ahead = std::min(max_frames_ahead, min_frames_ahead);
+
             // Always cache frames from the current display position to our maximum (based on the cache size).
             // Frames which are already cached are basically free. Only uncached frames have a big CPU cost.
             // By always looping through the expected frame range, we can fill-in missing frames caused by a
-            // fragmented cache object (i.e. the user clicking all over the timeline). The -1 is to always
-            // cache 1 frame previous to our current frame (to avoid our Seek method from clearing the cache).
-            int64_t starting_frame = std::min(current_display_frame, timeline_max_frame) - 1;
-            int64_t ending_frame = std::min(starting_frame + max_frames_ahead, timeline_max_frame);
-
-            // Adjust ending frame for cache loop
-            if (increment < 0) {
-                // Reverse loop (if we are going backwards)
-                ending_frame = starting_frame - max_frames_ahead;
-            }
-            if (starting_frame < 1) {
-                // Don't allow negative frame number caching
-                starting_frame = 1;
+            // fragmented cache object (i.e. the user clicking all over the timeline). The first frame is always
+            // 1 step behind our current frame (to avoid our Seek method from clearing the cache).
+            const int64_t direction = (increment < 0) ? -1 : 1;
+            int64_t starting_frame = std::min(current_display_frame, timeline_max_frame) - increment;
+            int64_t ending_frame = starting_frame + increment * max_frames_ahead;
+
+            // Don't allow negative frame number caching (or caching past the end of the timeline)
+            starting_frame = std::max<int64_t>(1, std::min(starting_frame, timeline_max_frame));
+            ending_frame = std::max<int64_t>(1, std::min(ending_frame, timeline_max_frame));
+
+            // Queue the uncached frames of the range (nearest to the playhead first). The workers render them
+            // at the same time (into the timeline cache), while this thread keeps the audio ring full. Pre-roll is
+            // ready once the frames ahead of the playhead are cached (or the whole range is).
+            std::vector<int64_t> uncached_frames;
+            int64_t frames_ready = 0;
+            for (int64_t cache_frame = starting_frame;
+                 direction > 0 ? cache_frame <= ending_frame : cache_frame >= ending_frame;
+                 cache_frame += increment) {
+                if (reader && reader->GetCache() && !reader->GetCache()->Contains(cache_frame))
+                    uncached_frames.push_back(cache_frame);
+                else if (uncached_frames.empty())
+                    frames_ready++;
             }
-            if (ending_frame < 1) {
-                // Don't allow negative frame number caching
-                ending_frame = 1;
-            }
-
-            // Reset cache break-loop flag
-            should_break = false;
-
-            // Loop through range of frames (and cache them)
-            for (int64_t cache_frame = starting_frame; cache_frame != (ending_frame + increment); cache_frame += increment) {
-                cached_frame_count++;
-                if (reader && reader->GetCache() && !reader->GetCache()->Contains(cache_frame)) {
-                    try
-                    {
-                        // This frame is not already cached... so request it again (to force the creation & caching)
-                        // This will also re-order the missing frame to the front of the cache
-                        last_cached_frame = reader->GetFrame(cache_frame);
-                    }
-                    catch (const OutOfBoundsFrame & e) {  }
-                }
+            if (is_playing && s->ENABLE_PLAYBACK_CACHING)
+                queueFrames(uncached_frames);
+            cached_frame_count = uncached_frames.empty() ? std::max(frames_ready, min_frames_ahead + 1) : frames_ready;
 
-                // Check if thread has stopped OR should_break is triggered
-                if (!is_playing || should_break || !s->ENABLE_PLAYBACK_CACHING) {
-                    should_break = false;
-                    break;
-                }
-
-            }
+            // Queue the audio of the next frames
+            if (current_speed == 1)
+                fillAudioRing();
 
 			// Sleep for a fraction of frame duration
 			std::this_thread::sleep_for(frame_duration / 2);
 		}
 
+        // Finish the frames being rendered (and drop the rest)
+        stopWorkers();
+
 	return;
     }
 }
@@ -13,8 +13,20 @@
 #ifndef OPENSHOT_VIDEO_CACHE_THREAD_H
 #define OPENSHOT_VIDEO_CACHE_THREAD_H
 
+#include "AudioResampler.h"
+#include "AudioRingBuffer.h"
+#include "FrameRequest.h"
 #include "ReaderBase.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include <AppConfig.h>
 #include <juce_audio_basics/juce_audio_basics.h>
 
@@ -41,7 +53,19 @@ namespace openshot
 	int64_t max_frames_ahead;
 	int64_t timeline_max_frame;
 	bool should_pause_cache;
-	bool should_break;
+	double render_seconds; ///< Average time to render an uncached frame (used to size the look-ahead)
+
+	std::vector<std::thread> workers; ///< Threads which render the queued frames (at the same time)
+	std::mutex work_mutex; ///< Guards work_queue, work_in_flight, stop_workers, render_seconds and last_cached_frame
+	std::condition_variable work_condition; ///< Signaled when frames are queued (or the workers should stop)
+	std::deque<int64_t> work_queue; ///< Frames to render (nearest to the playhead first)
+	std::map<int64_t, std::shared_ptr<FrameRequest>> work_in_flight; ///< Frames being rendered (which can be cancelled)
+	bool stop_workers; ///< The workers should stop
+	AudioRingBuffer audio_ring; ///< The rendered audio (read by the audio device thread)
+	std::atomic<int> audio_output_rate; ///< The sample rate of the audio device (0 = not open yet)
+	int audio_ring_rate; ///< The sample rate of the queued audio
+	int64_t last_audio_frame; ///< The last frame queued in the audio ring
+	AudioResampler audio_resampler; ///< Converts the queued audio to the rate of the audio device (if it differs)
 
 	/// Constructor
 	VideoCacheThread();
@@ -51,6 +75,25 @@ namespace openshot
     /// Get the size in bytes of a frame (rough estimate)
     int64_t getBytes(int width, int height, int sample_rate, int channels, float fps);
 
+    /// Start the worker threads (which render the queued frames)
+    void startWorkers(int count);
+
+    /// Stop (and join) the worker threads, after they finish their current frames
+    void stopWorkers();
+
+    /// Render queued frames (until stopped)
+    void renderWorker();
+
+    /// Replace the queued frames (i.e. with the uncached frames of the current look-ahead)
+    void queueFrames(const std::vector<int64_t>& frame_numbers);
+
+    /// @brief Drop all queued frames
+    /// @param cancel_rendering Also cancel the frames which are rendering (instead of finishing and caching them)
+    void cancelQueuedFrames(bool cancel_rendering = false);
+
+    /// Get the max # of frames to cache ahead (based on the cache size and VIDEO_CACHE_PERCENT_AHEAD)
+    int64_t getCacheFrameLimit();
+
     /// Get Speed (The speed and direction to playback a reader (1=normal, 2=fast, 3=faster, -1=rewind, etc...)
     int getSpeed() const { return speed; }
 
@@ -72,6 +115,9 @@ namespace openshot
 	/// Start the thread
 	void run();
 
+	/// Queue the audio of the next frames (until the audio ring is full)
+	void fillAudioRing();
+
 	/// Set the current thread's reader
 	void Reader(ReaderBase *new_reader) { reader=new_reader; Play(); };
 
@@ -82,6 +128,14 @@ namespace openshot
     public:
         /// Is cache ready for video/audio playback
         bool isReady();
+
+        /// Get the queue of rendered audio (used by openshot::AudioReaderSource)
+        AudioRingBuffer* getAudioRing() { return &audio_ring; }
+
+        /// @brief Set the sample rate of the audio device (the queued audio is resampled to it, if the reader's
+        /// rate differs), so the audio device thread only copies samples
+        /// @param rate The sample rate of the open audio device
+        void setAudioOutputRate(int rate) { audio_output_rate = rate; }
     };
 }
 
@@ -51,7 +51,7 @@ namespace openshot
 		if (need_render && frame)
 		{
 			// Debug
-			ZmqLogger::Instance()->AppendDebugMethod(
+			ZMQ_DEBUG(
 				"VideoPlaybackThread::run (before render)",
 				"frame->number", frame->number,
 				"need_render", need_render);
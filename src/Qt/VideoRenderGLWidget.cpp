@@ -0,0 +1,204 @@
+/**
+ * @file
+ * @brief Source file for VideoRenderGLWidget class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+
+#include "VideoRenderGLWidget.h"
+#include <QOpenGLContext>
+#include <QSizePolicy>
+
+#include <cstring>
+
+// Number of pixel buffers to cycle through (so a new frame never waits on the upload of the previous one)
+static const int PIXEL_BUFFER_COUNT = 3;
+
+// Draw the texture on a quad (which covers the viewport)
+static const char *vertex_shader =
+    "attribute highp vec2 position;\n"
+    "attribute highp vec2 tex_coord;\n"
+    "varying highp vec2 coord;\n"
+    "void main() {\n"
+    "    coord = tex_coord;\n"
+    "    gl_Position = vec4(position, 0.0, 1.0);\n"
+    "}\n";
+
+static const char *fragment_shader =
+    "varying highp vec2 coord;\n"
+    "uniform sampler2D frame;\n"
+    "void main() {\n"
+    "    gl_FragColor = texture2D(frame, coord);\n"
+    "}\n";
+
+VideoRenderGLWidget::VideoRenderGLWidget(QWidget *parent)
+    : QOpenGLWidget(parent), renderer(new VideoRenderer(this)), image_dirty(false), texture(0), pixel_buffer_index(0)
+{
+    setSizePolicy(QSizePolicy::Preferred, QSizePolicy::Preferred);
+
+    // init aspect ratio settings (default values)
+    aspect_ratio.num = 16;
+    aspect_ratio.den = 9;
+    pixel_ratio.num = 1;
+    pixel_ratio.den = 1;
+
+    connect(renderer, SIGNAL(present(const QImage &)), this, SLOT(present(const QImage &)));
+}
+
+VideoRenderGLWidget::~VideoRenderGLWidget()
+{
+    // Release the GPU resources (which need the widget's context)
+    makeCurrent();
+    for (auto& pixel_buffer : pixel_buffers)
+        pixel_buffer.destroy();
+    pixel_buffers.clear();
+    if (texture)
+        glDeleteTextures(1, &texture);
+    program.removeAllShaders();
+    doneCurrent();
+}
+
+VideoRenderer *VideoRenderGLWidget::GetRenderer() const
+{
+    return renderer;
+}
+
+void VideoRenderGLWidget::SetAspectRatio(openshot::Fraction new_aspect_ratio, openshot::Fraction new_pixel_ratio)
+{
+    aspect_ratio = new_aspect_ratio;
+    pixel_ratio = new_pixel_ratio;
+}
+
+QRect VideoRenderGLWidget::centeredViewport(int width, int height)
+{
+    // calculate aspect ratio
+    float aspectRatio = aspect_ratio.ToFloat() * pixel_ratio.ToFloat();
+    int heightFromWidth = (int) (width / aspectRatio);
+    int widthFromHeight = (int) (height * aspectRatio);
+
+    if (heightFromWidth <= height) {
+        return QRect(0, (height - heightFromWidth) / 2, width, heightFromWidth);
+    } else {
+        return QRect((width - widthFromHeight) / 2, 0, widthFromHeight, height);
+    }
+}
+
+void VideoRenderGLWidget::initializeGL()
+{
+    initializeOpenGLFunctions();
+
+    program.addShaderFromSourceCode(QOpenGLShader::Vertex, vertex_shader);
+    program.addShaderFromSourceCode(QOpenGLShader::Fragment, fragment_shader);
+    program.link();
+
+    // Create the texture (scaled by the GPU, with linear filtering)
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    texture_size = QSize();
+
+    // Pixel buffer objects need desktop OpenGL (or OpenGL ES 3)
+    QOpenGLContext *gl_context = context();
+    if (!gl_context->isOpenGLES() || gl_context->format().majorVersion() >= 3) {
+        pixel_buffers.reserve(PIXEL_BUFFER_COUNT);
+        for (int index = 0; index < PIXEL_BUFFER_COUNT; index++) {
+            pixel_buffers.push_back(QOpenGLBuffer(QOpenGLBuffer::PixelUnpackBuffer));
+            pixel_buffers.back().setUsagePattern(QOpenGLBuffer::StreamDraw);
+            if (!pixel_buffers.back().create()) {
+                pixel_buffers.clear();
+                break;
+            }
+        }
+    }
+
+    // Upload the current frame again (i.e. the widget was moved to another window)
+    image_dirty = !image.isNull();
+}
+
+void VideoRenderGLWidget::uploadImage()
+{
+    image_dirty = false;
+    const QImage frame = (image.format() == QImage::Format_RGBA8888_Premultiplied) ?
+        image : image.convertToFormat(QImage::Format_RGBA8888_Premultiplied);
+    const int bytes = frame.bytesPerLine() * frame.height();
+
+    // Resize the texture (only when the frame size changes)
+    glBindTexture(GL_TEXTURE_2D, texture);
+    if (texture_size != frame.size()) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, frame.width(), frame.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        texture_size = frame.size();
+    }
+
+    // Copy the frame into the next pixel buffer, and let the driver copy it to the texture (asynchronously)
+    if (!pixel_buffers.empty()) {
+        QOpenGLBuffer &pixel_buffer = pixel_buffers[pixel_buffer_index];
+        pixel_buffer_index = (pixel_buffer_index + 1) % pixel_buffers.size();
+
+        pixel_buffer.bind();
+
+        // Orphan the previous storage (the GPU may still be reading it)
+        pixel_buffer.allocate(bytes);
+        void *pixels = pixel_buffer.map(QOpenGLBuffer::WriteOnly);
+        if (pixels) {
+            memcpy(pixels, frame.constBits(), bytes);
+            pixel_buffer.unmap();
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, frame.width(), frame.height(), GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+            pixel_buffer.release();
+            return;
+        }
+        pixel_buffer.release();
+    }
+
+    // Upload directly from the image
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, frame.width(), frame.height(), GL_RGBA, GL_UNSIGNED_BYTE, frame.constBits());
+}
+
+void VideoRenderGLWidget::paintGL()
+{
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    if (image_dirty)
+        uploadImage();
+    if (texture_size.isEmpty())
+        return;
+
+    // maintain aspect ratio (in device pixels)
+    const qreal ratio = devicePixelRatioF();
+    const QRect viewport = centeredViewport(width() * ratio, height() * ratio);
+    glViewport(viewport.x(), viewport.y(), viewport.width(), viewport.height());
+
+    // Draw the frame (top row of the image at the top of the quad)
+    static const GLfloat positions[] = { -1.0f, 1.0f,  1.0f, 1.0f,  -1.0f, -1.0f,  1.0f, -1.0f };
+    static const GLfloat tex_coords[] = { 0.0f, 0.0f,  1.0f, 0.0f,  0.0f, 1.0f,  1.0f, 1.0f };
+
+    program.bind();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    program.setUniformValue("frame", 0);
+    program.enableAttributeArray("position");
+    program.enableAttributeArray("tex_coord");
+    program.setAttributeArray("position", positions, 2);
+    program.setAttributeArray("tex_coord", tex_coords, 2);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    program.disableAttributeArray("position");
+    program.disableAttributeArray("tex_coord");
+    program.release();
+}
+
+void VideoRenderGLWidget::present(const QImage &m)
+{
+    // Only keep a reference to the frame (it is uploaded when the widget is painted)
+    image = m;
+    image_dirty = true;
+    update();
+}
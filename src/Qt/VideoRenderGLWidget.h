@@ -0,0 +1,77 @@
+/**
+ * @file
+ * @brief Header file for VideoRenderGLWidget class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+
+#ifndef OPENSHOT_VIDEO_RENDERER_GL_WIDGET_H
+#define OPENSHOT_VIDEO_RENDERER_GL_WIDGET_H
+
+#include "../Fraction.h"
+#include "VideoRenderer.h"
+
+#include <QImage>
+#include <QOpenGLBuffer>
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLWidget>
+#include <QRect>
+#include <QSize>
+
+#include <vector>
+
+/**
+ * @brief A video preview widget which draws frames with OpenGL (a drop-in alternative to VideoRenderWidget).
+ *
+ * Each frame is uploaded as a texture (through a ring of pixel buffer objects, so the upload is asynchronous
+ * and never waits on the GPU reading the previous frame), and is scaled to the widget by the GPU. This avoids
+ * the full-frame scale and copy which QPainter does on the UI thread for every displayed frame.
+ *
+ * Without pixel buffer object support (i.e. OpenGL ES 2), the texture is uploaded directly from the image.
+ */
+class VideoRenderGLWidget : public QOpenGLWidget, protected QOpenGLFunctions
+{
+    Q_OBJECT
+
+private:
+    VideoRenderer *renderer;
+    QImage image; ///< The latest frame
+    bool image_dirty; ///< The latest frame is not uploaded yet
+    openshot::Fraction aspect_ratio;
+    openshot::Fraction pixel_ratio;
+
+    QOpenGLShaderProgram program;
+    GLuint texture;
+    QSize texture_size;
+    std::vector<QOpenGLBuffer> pixel_buffers; ///< Ring of pixel unpack buffers (empty if not supported)
+    size_t pixel_buffer_index;
+
+    /// Upload the latest frame to the texture
+    void uploadImage();
+
+public:
+    VideoRenderGLWidget(QWidget *parent = 0);
+    ~VideoRenderGLWidget();
+
+    VideoRenderer *GetRenderer() const;
+    void SetAspectRatio(openshot::Fraction new_aspect_ratio, openshot::Fraction new_pixel_ratio);
+
+protected:
+    void initializeGL() override;
+    void paintGL() override;
+
+    QRect centeredViewport(int width, int height);
+
+private slots:
+    void present(const QImage &image);
+
+};
+
+#endif // OPENSHOT_VIDEO_RENDERER_GL_WIDGET_H
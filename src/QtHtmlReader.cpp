@@ -15,6 +15,7 @@
 #include "QtHtmlReader.h"
 #include "Exceptions.h"
 #include "Frame.h"
+#include "TextSpriteCache.h"
 
 #include <QImage>
 #include <QPainter>
@@ -46,53 +47,74 @@ void QtHtmlReader::Open()
 	// Open reader if not already open
 	if (!is_open)
 	{
-		// create image
-		image = std::make_shared<QImage>(width, height, QImage::Format_RGBA8888_Premultiplied);
-		image->fill(QColor(background_color.c_str()));
-
-		//start painting
-		QPainter painter;
-		if (!painter.begin(image.get())) {
-			return;
+		// Re-use the rasterized document (if any reader already painted the same HTML at this size)
+		Json::Value sprite;
+		sprite["type"] = "QtHtmlReader";
+		sprite["width"] = width;
+		sprite["height"] = height;
+		sprite["x_offset"] = x_offset;
+		sprite["y_offset"] = y_offset;
+		sprite["html"] = html;
+		sprite["css"] = css;
+		sprite["background_color"] = background_color;
+		sprite["gravity"] = gravity;
+		const std::string sprite_key = sprite.toStyledString();
+		image = TextSpriteCache::Instance()->GetImage(sprite_key);
+
+		if (!image)
+		{
+			// create image
+			image = std::make_shared<QImage>(width, height, QImage::Format_RGBA8888_Premultiplied);
+			image->fill(QColor(background_color.c_str()));
+
+			//start painting
+			QPainter painter;
+			if (!painter.begin(image.get())) {
+				image.reset();
+				return;
+			}
+
+			//set background
+			painter.setBackground(QBrush(background_color.c_str()));
+
+			//draw text
+			QTextDocument text_document;
+
+			//disable redo/undo stack as not needed
+			text_document.setUndoRedoEnabled(false);
+
+			//create the HTML/CSS document
+			text_document.setTextWidth(width);
+			text_document.setDefaultStyleSheet(css.c_str());
+			text_document.setHtml(html.c_str());
+
+			int td_height = text_document.documentLayout()->documentSize().height();
+
+	 		if (gravity == GRAVITY_TOP_LEFT || gravity == GRAVITY_TOP || gravity == GRAVITY_TOP_RIGHT) {
+	 			painter.translate(x_offset, y_offset);
+	 		} else if (gravity == GRAVITY_LEFT || gravity == GRAVITY_CENTER || gravity == GRAVITY_RIGHT) {
+	 			painter.translate(x_offset, (height - td_height) / 2 + y_offset);
+	 		} else if (gravity == GRAVITY_BOTTOM_LEFT || gravity == GRAVITY_BOTTOM_RIGHT || gravity == GRAVITY_BOTTOM) {
+	 			painter.translate(x_offset, height - td_height + y_offset);
+	 		}
+
+	 		if (gravity == GRAVITY_TOP_LEFT || gravity == GRAVITY_LEFT || gravity == GRAVITY_BOTTOM_LEFT) {
+	 			text_document.setDefaultTextOption(QTextOption(Qt::AlignLeft));
+	 		} else if (gravity == GRAVITY_CENTER || gravity == GRAVITY_TOP || gravity == GRAVITY_BOTTOM) {
+	 			text_document.setDefaultTextOption(QTextOption(Qt::AlignHCenter));
+	 		} else if (gravity == GRAVITY_TOP_RIGHT || gravity == GRAVITY_RIGHT|| gravity == GRAVITY_BOTTOM_RIGHT) {
+	 			text_document.setDefaultTextOption(QTextOption(Qt::AlignRight));
+	 		}
+
+	 		// Draw image
+			text_document.drawContents(&painter);
+
+			painter.end();
+
+			// Share the image with other readers of the same document
+			TextSpriteCache::Instance()->Add(sprite_key, image);
 		}
 
-		//set background
-		painter.setBackground(QBrush(background_color.c_str()));
-
-		//draw text
-		QTextDocument text_document;
-
-		//disable redo/undo stack as not needed
-		text_document.setUndoRedoEnabled(false);
-
-		//create the HTML/CSS document
-		text_document.setTextWidth(width);
-		text_document.setDefaultStyleSheet(css.c_str());
-		text_document.setHtml(html.c_str());
-
-		int td_height = text_document.documentLayout()->documentSize().height();
-
- 		if (gravity == GRAVITY_TOP_LEFT || gravity == GRAVITY_TOP || gravity == GRAVITY_TOP_RIGHT) {
- 			painter.translate(x_offset, y_offset);
- 		} else if (gravity == GRAVITY_LEFT || gravity == GRAVITY_CENTER || gravity == GRAVITY_RIGHT) {
- 			painter.translate(x_offset, (height - td_height) / 2 + y_offset);
- 		} else if (gravity == GRAVITY_BOTTOM_LEFT || gravity == GRAVITY_BOTTOM_RIGHT || gravity == GRAVITY_BOTTOM) {
- 			painter.translate(x_offset, height - td_height + y_offset);
- 		}
-
- 		if (gravity == GRAVITY_TOP_LEFT || gravity == GRAVITY_LEFT || gravity == GRAVITY_BOTTOM_LEFT) {
- 			text_document.setDefaultTextOption(QTextOption(Qt::AlignLeft));
- 		} else if (gravity == GRAVITY_CENTER || gravity == GRAVITY_TOP || gravity == GRAVITY_BOTTOM) {
- 			text_document.setDefaultTextOption(QTextOption(Qt::AlignHCenter));
- 		} else if (gravity == GRAVITY_TOP_RIGHT || gravity == GRAVITY_RIGHT|| gravity == GRAVITY_BOTTOM_RIGHT) {
- 			text_document.setDefaultTextOption(QTextOption(Qt::AlignRight));
- 		}
-
- 		// Draw image
-		text_document.drawContents(&painter);
-
-		painter.end();
-
 		// Update image properties
 		info.has_audio = false;
 		info.has_video = true;
@@ -15,6 +15,10 @@
 #include "Clip.h"
 #include "CacheMemory.h"
 #include "Exceptions.h"
+#include "PixelKernels.h"
+#include "ProbeCache.h"
+#include "RenderStats.h"
+#include "StillImageCache.h"
 #include "Timeline.h"
 
 #include <QString>
@@ -23,14 +27,32 @@
 #include <QIcon>
 #include <QImageReader>
 
+#include <mutex>
+
 using namespace openshot;
 
+#if RESVG_VERSION_MIN(0, 11)
+// Get the Resvg options shared by all readers (the system fonts are only loaded once, by the first SVG file)
+static const ResvgOptions& shared_resvg_options()
+{
+    static ResvgOptions options;
+    static std::once_flag fonts_loaded;
+    std::call_once(fonts_loaded, []() {
+        RenderInitTimer timer(INIT_STAGE_SVG_FONTS);
+        options.loadSystemFonts();
+    });
+    return options;
+}
+#endif
+
 QtImageReader::QtImageReader(std::string path, bool inspect_reader) : path{QString::fromStdString(path)}, is_open(false)
 {
-    // Open and Close the reader, to populate its attributes (such as height, width, etc...)
-    if (inspect_reader) {
+    // Open and Close the reader, to populate its attributes (such as height, width, etc...),
+    // unless this file was already probed (and hasn't changed since)
+    if (inspect_reader && !ProbeCache::Instance()->Lookup("QtImageReader", path.toStdString(), info)) {
         Open();
         Close();
+        ProbeCache::Instance()->Insert("QtImageReader", path.toStdString(), info);
     }
 }
 
@@ -50,11 +72,6 @@ void QtImageReader::Open()
 
         // Check for SVG files and rasterizing them to QImages
         if (path.toLower().endsWith(".svg") || path.toLower().endsWith(".svgz")) {
-            #if RESVG_VERSION_MIN(0, 11)
-                // Initialize the Resvg options
-                resvg_options.loadSystemFonts();
-            #endif
-            
             // Parse SVG file
             default_svg_size = load_svg_path(path);
             if (!default_svg_size.isEmpty()) {
@@ -62,6 +79,12 @@ void QtImageReader::Open()
             }
         }
 
+        if (!loaded) {
+            // Share the decoded image of other readers of the same file (if any)
+            image = StillImageCache::Instance()->Lookup(path.toStdString(), QSize());
+            loaded = (image != nullptr);
+        }
+
         if (!loaded) {
             // Attempt to open file using Qt's build in image processing capabilities
             // AutoTransform enables exif data to be parsed and auto transform the image
@@ -71,6 +94,8 @@ void QtImageReader::Open()
             imgReader.setAutoTransform( true );
             imgReader.setDecideFormatFromContent( true );
             loaded = imgReader.read(image.get());
+            if (loaded)
+                StillImageCache::Instance()->Insert(path.toStdString(), QSize(), image);
         }
 
         if (!loaded) {
@@ -159,16 +184,23 @@ std::shared_ptr<Frame> QtImageReader::GetFrame(int64_t requested_frame)
 
     // Scale image smaller (or use a previous scaled image)
     if (!cached_image || max_size != current_max_size) {
-        // Check for SVG files and rasterize them to QImages
-        if (path.toLower().endsWith(".svg") || path.toLower().endsWith(".svgz")) {
-            load_svg_path(path);
-        }
+        // Share the scaled image of other readers of the same file (if any)
+        cached_image = StillImageCache::Instance()->Lookup(path.toStdString(), current_max_size);
+        if (!cached_image) {
+            // Check for SVG files and rasterize them to QImages
+            if (path.toLower().endsWith(".svg") || path.toLower().endsWith(".svgz")) {
+                load_svg_path(path);
+            }
 
-        // We need to resize the original image to a smaller image (for performance reasons)
-        // Only do this once, to prevent tons of unneeded scaling operations
-        cached_image = std::make_shared<QImage>(image->scaled(
-                       current_max_size,
-                       Qt::KeepAspectRatio, Qt::SmoothTransformation));
+            // We need to resize the original image to a smaller image (for performance reasons)
+            // Only do this once, to prevent tons of unneeded scaling operations
+            // (converted to the format of frames, since the shared image is never modified)
+            cached_image = std::make_shared<QImage>(image->scaled(
+                           current_max_size,
+                           Qt::KeepAspectRatio, Qt::SmoothTransformation));
+            PixelKernels::ToPremultipliedRGBA(*cached_image);
+            StillImageCache::Instance()->Insert(path.toStdString(), current_max_size, cached_image);
+        }
 
         // Set max size (to later determine if max_size is changed)
         max_size = current_max_size;
@@ -199,51 +231,10 @@ QSize QtImageReader::calculate_max_size() {
         max_height = 1080;
     }
 
+    // Based on the parent clip (and its timeline's preview size)
     Clip* parent = (Clip*) ParentClip();
-    if (parent) {
-        if (parent->ParentTimeline()) {
-            // Set max width/height based on parent clip's timeline (if attached to a timeline)
-            max_width = parent->ParentTimeline()->preview_width;
-            max_height = parent->ParentTimeline()->preview_height;
-        }
-        if (parent->scale == SCALE_FIT || parent->scale == SCALE_STRETCH) {
-            // Best fit or Stretch scaling (based on max timeline size * scaling keyframes)
-            float max_scale_x = parent->scale_x.GetMaxPoint().co.Y;
-            float max_scale_y = parent->scale_y.GetMaxPoint().co.Y;
-            max_width = std::max(float(max_width), max_width * max_scale_x);
-            max_height = std::max(float(max_height), max_height * max_scale_y);
-
-        } else if (parent->scale == SCALE_CROP) {
-            // Cropping scale mode (based on max timeline size * cropped size * scaling keyframes)
-            float max_scale_x = parent->scale_x.GetMaxPoint().co.Y;
-            float max_scale_y = parent->scale_y.GetMaxPoint().co.Y;
-            QSize width_size(max_width * max_scale_x,
-                             round(max_width / (float(info.width) / float(info.height))));
-            QSize height_size(round(max_height / (float(info.height) / float(info.width))),
-                              max_height * max_scale_y);
-            // respect aspect ratio
-            if (width_size.width() >= max_width && width_size.height() >= max_height) {
-                max_width = std::max(max_width, width_size.width());
-                max_height = std::max(max_height, width_size.height());
-            } else {
-                max_width = std::max(max_width, height_size.width());
-                max_height = std::max(max_height, height_size.height());
-            }
-        } else if (parent->scale == SCALE_NONE) {
-            // Scale images to equivalent unscaled size
-            // Since the preview window can change sizes, we want to always
-            // scale against the ratio of original image size to timeline size
-            float preview_ratio = 1.0;
-            if (parent->ParentTimeline()) {
-                Timeline *t = (Timeline *) parent->ParentTimeline();
-                preview_ratio = t->preview_width / float(t->info.width);
-            }
-            float max_scale_x = parent->scale_x.GetMaxPoint().co.Y;
-            float max_scale_y = parent->scale_y.GetMaxPoint().co.Y;
-            max_width = info.width * max_scale_x * preview_ratio;
-            max_height = info.height * max_scale_y * preview_ratio;
-        }
-    }
+    if (parent)
+        return parent->GetMaxSourceSize(info.width, info.height, max_width, max_height);
 
     // Return new QSize of the current max size
     return QSize(max_width, max_height);
@@ -259,14 +250,14 @@ QSize QtImageReader::load_svg_path(QString) {
 
 // Try to use libresvg for parsing/rasterizing SVG, if available
 #if RESVG_VERSION_MIN(0, 11)
-    ResvgRenderer renderer(path, resvg_options);
+    ResvgRenderer renderer(path, shared_resvg_options());
     if (renderer.isValid()) {
         default_size = renderer.defaultSize();
         // Scale SVG size to keep aspect ratio, and fill max_size as much as possible
         QSize svg_size = default_size.scaled(current_max_size, Qt::KeepAspectRatio);
         auto qimage = renderer.renderToImage(svg_size);
-        image = std::make_shared<QImage>(
-                qimage.convertToFormat(QImage::Format_RGBA8888_Premultiplied));
+        PixelKernels::ToPremultipliedRGBA(qimage);
+        image = std::make_shared<QImage>(qimage);
         loaded = true;
     }
 #elif RESVG_VERSION_MIN(0, 0)
@@ -80,10 +80,6 @@ namespace openshot
 		bool is_open;	///> Is Reader opened
 		QSize max_size;	///> Current max_size as calculated with Clip properties
 
-#if RESVG_VERSION_MIN(0, 11)
-        ResvgOptions resvg_options;
-#endif
-
 		/// Load an SVG file with Resvg or fallback with Qt
         ///
         /// @returns Success as a boolean
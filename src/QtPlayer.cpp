@@ -49,8 +49,9 @@ namespace openshot
 
     void QtPlayer::CloseAudioDevice()
     {
-    	// Close audio device (only do this once, when all audio playback is finished)
-    	openshot::AudioDeviceManagerSingleton::Instance()->CloseAudioDevice();
+    	// Close audio device (only do this once, when all audio playback is finished), if one was opened
+    	if (openshot::AudioDeviceManagerSingleton::Created())
+    		openshot::AudioDeviceManagerSingleton::Instance()->CloseAudioDevice();
     }
 
     // Return any error string during initialization
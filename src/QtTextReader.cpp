@@ -16,6 +16,7 @@
 #include "CacheBase.h"
 #include "Exceptions.h"
 #include "Frame.h"
+#include "TextSpriteCache.h"
 
 #include <QImage>
 #include <QPainter>
@@ -52,65 +53,88 @@ void QtTextReader::Open()
 	// Open reader if not already open
 	if (!is_open)
 	{
-		// create image
-		image = std::make_shared<QImage>(width, height, QImage::Format_RGBA8888_Premultiplied);
-		image->fill(QColor(background_color.c_str()));
-
-		QPainter painter;
-		if (!painter.begin(image.get())) {
-			return;
-		}
-
-		// set background
-		if (!text_background_color.empty()) {
-			painter.setBackgroundMode(Qt::OpaqueMode);
-			painter.setBackground(QBrush(text_background_color.c_str()));
-		}
-
-		// set font color
-		painter.setPen(QPen(text_color.c_str()));
-
-		// set font
-		painter.setFont(font);
-
-		// Set gravity (map between OpenShot and Qt)
-		int align_flag = 0;
-		switch (gravity)
+		// Re-use the rasterized text (if any reader already painted the same text at this size)
+		Json::Value sprite;
+		sprite["type"] = "QtTextReader";
+		sprite["width"] = width;
+		sprite["height"] = height;
+		sprite["x_offset"] = x_offset;
+		sprite["y_offset"] = y_offset;
+		sprite["text"] = text;
+		sprite["font"] = font.toString().toStdString();
+		sprite["text_color"] = text_color;
+		sprite["background_color"] = background_color;
+		sprite["text_background_color"] = text_background_color;
+		sprite["gravity"] = gravity;
+		const std::string sprite_key = sprite.toStyledString();
+		image = TextSpriteCache::Instance()->GetImage(sprite_key);
+
+		if (!image)
 		{
-		case GRAVITY_TOP_LEFT:
-			align_flag = Qt::AlignLeft | Qt::AlignTop;
-			break;
-		case GRAVITY_TOP:
-			align_flag = Qt::AlignHCenter | Qt::AlignTop;
-			break;
-		case GRAVITY_TOP_RIGHT:
-			align_flag = Qt::AlignRight | Qt::AlignTop;
-			break;
-		case GRAVITY_LEFT:
-			align_flag = Qt::AlignVCenter | Qt::AlignLeft;
-			break;
-		case GRAVITY_CENTER:
-			align_flag = Qt::AlignCenter;
-			break;
-		case GRAVITY_RIGHT:
-			align_flag = Qt::AlignVCenter | Qt::AlignRight;
-			break;
-		case GRAVITY_BOTTOM_LEFT:
-			align_flag = Qt::AlignLeft | Qt::AlignBottom;
-			break;
-		case GRAVITY_BOTTOM:
-			align_flag = Qt::AlignHCenter | Qt::AlignBottom;
-			break;
-		case GRAVITY_BOTTOM_RIGHT:
-			align_flag = Qt::AlignRight | Qt::AlignBottom;
-			break;
+			// create image
+			image = std::make_shared<QImage>(width, height, QImage::Format_RGBA8888_Premultiplied);
+			image->fill(QColor(background_color.c_str()));
+
+			QPainter painter;
+			if (!painter.begin(image.get())) {
+				image.reset();
+				return;
+			}
+
+			// set background
+			if (!text_background_color.empty()) {
+				painter.setBackgroundMode(Qt::OpaqueMode);
+				painter.setBackground(QBrush(text_background_color.c_str()));
+			}
+
+			// set font color
+			painter.setPen(QPen(text_color.c_str()));
+
+			// set font
+			painter.setFont(font);
+
+			// Set gravity (map between OpenShot and Qt)
+			int align_flag = 0;
+			switch (gravity)
+			{
+			case GRAVITY_TOP_LEFT:
+				align_flag = Qt::AlignLeft | Qt::AlignTop;
+				break;
+			case GRAVITY_TOP:
+				align_flag = Qt::AlignHCenter | Qt::AlignTop;
+				break;
+			case GRAVITY_TOP_RIGHT:
+				align_flag = Qt::AlignRight | Qt::AlignTop;
+				break;
+			case GRAVITY_LEFT:
+				align_flag = Qt::AlignVCenter | Qt::AlignLeft;
+				break;
+			case GRAVITY_CENTER:
+				align_flag = Qt::AlignCenter;
+				break;
+			case GRAVITY_RIGHT:
+				align_flag = Qt::AlignVCenter | Qt::AlignRight;
+				break;
+			case GRAVITY_BOTTOM_LEFT:
+				align_flag = Qt::AlignLeft | Qt::AlignBottom;
+				break;
+			case GRAVITY_BOTTOM:
+				align_flag = Qt::AlignHCenter | Qt::AlignBottom;
+				break;
+			case GRAVITY_BOTTOM_RIGHT:
+				align_flag = Qt::AlignRight | Qt::AlignBottom;
+				break;
+			}
+
+			// Draw image
+			painter.drawText(x_offset, y_offset, width, height, align_flag, text.c_str());
+
+			painter.end();
+
+			// Share the image with other readers of the same text
+			TextSpriteCache::Instance()->Add(sprite_key, image);
 		}
 
-		// Draw image
-		painter.drawText(x_offset, y_offset, width, height, align_flag, text.c_str());
-
-		painter.end();
-
 		// Update image properties
 		info.has_audio = false;
 		info.has_video = true;
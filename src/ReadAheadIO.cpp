@@ -0,0 +1,344 @@
+/**
+ * @file
+ * @brief Source file for ReadAheadIO class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+
+#include "ReadAheadIO.h"
+#include "FFmpegUtilities.h"
+
+using namespace openshot;
+
+// The size of the buffer libavformat reads into (from the blocks in memory)
+static const int CONTEXT_BUFFER_SIZE = 65536;
+
+// The most blocks read with a single request (while reading ahead)
+static const int MAX_COALESCED_BLOCKS = 4;
+
+// Constructor
+ReadAheadIO::ReadAheadIO(const std::string& path, int64_t block_size, int blocks_ahead, const std::string& cache_path)
+	: path(path), cache_path(cache_path), block_size(std::max<int64_t>(block_size, 4096)), blocks_ahead(std::max(blocks_ahead, 1)),
+	  file_size(0), position(0), use_count(0), current_block(0), stop(true), context(NULL)
+{
+}
+
+// Destructor
+ReadAheadIO::~ReadAheadIO()
+{
+	Close();
+}
+
+// Open the file (and start reading ahead)
+bool ReadAheadIO::Open()
+{
+	if (context)
+		return true;
+
+	QFileInfo info(QString::fromStdString(path));
+	if (!info.isFile())
+		return false;
+	file.setFileName(info.absoluteFilePath());
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+	file_size = file.size();
+	position = 0;
+	current_block = 0;
+
+	// Name the cached blocks after the file (a changed file gets new blocks)
+	cache_prefix.clear();
+	if (!cache_path.empty() && QDir().mkpath(QString::fromStdString(cache_path))) {
+		const std::string key = info.absoluteFilePath().toStdString() + '\n' + std::to_string(file_size) + '\n' +
+			std::to_string(info.lastModified().toMSecsSinceEpoch()) + '\n' + std::to_string(block_size);
+		cache_prefix = std::to_string(std::hash<std::string>()(key));
+	}
+
+	unsigned char *buffer = (unsigned char *) av_malloc(CONTEXT_BUFFER_SIZE);
+	if (buffer)
+		context = avio_alloc_context(buffer, CONTEXT_BUFFER_SIZE, 0, this, &ReadAheadIO::read_packet, NULL, &ReadAheadIO::seek_packet);
+	if (!context) {
+		av_freep(&buffer);
+		file.close();
+		return false;
+	}
+
+	// Start reading ahead
+	stop = false;
+	read_ahead_thread = std::thread(&ReadAheadIO::ReadAhead, this);
+	return true;
+}
+
+// Close the file (and stop reading ahead)
+void ReadAheadIO::Close()
+{
+	{
+		const std::lock_guard<std::mutex> lock(blocksMutex);
+		stop = true;
+	}
+	blocks_condition.notify_all();
+	if (read_ahead_thread.joinable())
+		read_ahead_thread.join();
+
+	if (context) {
+		av_freep(&context->buffer);
+#if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(57, 80, 100)
+		avio_context_free(&context);
+#else
+		av_freep(&context);
+#endif
+	}
+
+	{
+		const std::lock_guard<std::mutex> lock(fileMutex);
+		file.close();
+	}
+	const std::lock_guard<std::mutex> lock(blocksMutex);
+	blocks.clear();
+}
+
+// Get the path of a block in the block cache
+std::string ReadAheadIO::cache_file(int64_t index) const
+{
+	return cache_path + "/" + cache_prefix + "-" + std::to_string(index) + ".block";
+}
+
+// Read a run of consecutive blocks
+void ReadAheadIO::load(int64_t first, int64_t count)
+{
+	// Use the block cache (if the first block is cached)
+	if (!cache_prefix.empty()) {
+		QFile cached(QString::fromStdString(cache_file(first)));
+		if (cached.open(QIODevice::ReadOnly)) {
+			QByteArray bytes = cached.readAll();
+			const int64_t expected = std::min(block_size, file_size - first * block_size);
+			if (bytes.size() == expected) {
+				auto data = std::make_shared<std::vector<uint8_t>>(bytes.begin(), bytes.end());
+				const std::lock_guard<std::mutex> lock(blocksMutex);
+				insert(first, data);
+				return;
+			}
+		}
+
+		// Only read the blocks which are not cached yet
+		int64_t uncached = 1;
+		while (uncached < count && !QFileInfo::exists(QString::fromStdString(cache_file(first + uncached))))
+			uncached++;
+		count = uncached;
+	}
+
+	// Read all the blocks with a single request
+	const int64_t offset = first * block_size;
+	const int64_t length = std::max<int64_t>(0, std::min(count * block_size, file_size - offset));
+	std::vector<uint8_t> bytes(length);
+	int64_t bytes_read = 0;
+	{
+		const std::lock_guard<std::mutex> lock(fileMutex);
+		if (file.isOpen() && file.seek(offset))
+			bytes_read = std::max<int64_t>(0, file.read((char *) bytes.data(), length));
+	}
+
+	// Split the blocks (only complete blocks are kept, a short read is retried later)
+	for (int64_t index = 0; index < count; index++) {
+		const int64_t start = index * block_size;
+		const int64_t expected = std::min(block_size, length - start);
+		if (expected <= 0 || start + expected > bytes_read)
+			break;
+		auto data = std::make_shared<std::vector<uint8_t>>(bytes.begin() + start, bytes.begin() + start + expected);
+
+		if (!cache_prefix.empty()) {
+			// Write to a temporary name first (so a partial block is never read)
+			const QString name = QString::fromStdString(cache_file(first + index));
+			QFile cached(name + ".tmp");
+			if (cached.open(QIODevice::WriteOnly) && cached.write((const char *) data->data(), expected) == expected) {
+				cached.close();
+				QFile::remove(name);
+				cached.rename(name);
+			} else {
+				cached.remove();
+			}
+		}
+
+		const std::lock_guard<std::mutex> lock(blocksMutex);
+		insert(first + index, data);
+	}
+}
+
+// Add a block to memory, and remove the least recently used blocks
+void ReadAheadIO::insert(int64_t index, BlockData data)
+{
+	blocks[index] = {data, ++use_count};
+
+	// Keep the blocks ahead, and as many blocks behind (for small seeks back)
+	const size_t max_blocks = (size_t) blocks_ahead * 2;
+	while (blocks.size() > max_blocks) {
+		// Remove the least recently used block (outside of the read-ahead blocks, if possible)
+		auto oldest = blocks.end();
+		bool oldest_ahead = true;
+		for (auto block = blocks.begin(); block != blocks.end(); ++block) {
+			if (block->first == index)
+				continue;
+			const bool ahead = block->first >= current_block && block->first < current_block + blocks_ahead;
+			if (oldest == blocks.end() || (oldest_ahead && !ahead) ||
+				(ahead == oldest_ahead && block->second.last_used < oldest->second.last_used)) {
+				oldest = block;
+				oldest_ahead = ahead;
+			}
+		}
+		if (oldest == blocks.end())
+			break;
+		blocks.erase(oldest);
+	}
+}
+
+// Get a block
+ReadAheadIO::BlockData ReadAheadIO::get_block(int64_t index)
+{
+	std::unique_lock<std::mutex> lock(blocksMutex);
+	for (int attempt = 0; attempt < 2; attempt++) {
+		// Wait for the read-ahead thread (if it is reading this block)
+		blocks_condition.wait(lock, [this, index]() { return !loading.count(index); });
+
+		auto block = blocks.find(index);
+		if (block != blocks.end()) {
+			block->second.last_used = ++use_count;
+			return block->second.data;
+		}
+
+		// Read the block now
+		loading.insert(index);
+		lock.unlock();
+		load(index, 1);
+		lock.lock();
+		loading.erase(index);
+		blocks_condition.notify_all();
+	}
+
+	// The block can't be read
+	return nullptr;
+}
+
+// Keep the blocks after the current position in memory
+void ReadAheadIO::ReadAhead()
+{
+	const int64_t block_count = (file_size + block_size - 1) / block_size;
+	std::unique_lock<std::mutex> lock(blocksMutex);
+	while (!stop) {
+		// Find the first missing block ahead of the current position
+		const int64_t last = std::min(current_block + blocks_ahead, block_count);
+		int64_t first = -1;
+		for (int64_t index = current_block; index < last; index++) {
+			if (!blocks.count(index) && !loading.count(index)) {
+				first = index;
+				break;
+			}
+		}
+		if (first < 0) {
+			// Wait until the position moves
+			const int64_t waiting_block = current_block;
+			blocks_condition.wait(lock, [this, waiting_block]() { return stop || current_block != waiting_block; });
+			continue;
+		}
+
+		// Read the consecutive missing blocks together
+		int64_t count = 1;
+		while (count < MAX_COALESCED_BLOCKS && first + count < last && !blocks.count(first + count) && !loading.count(first + count))
+			count++;
+		for (int64_t index = first; index < first + count; index++)
+			loading.insert(index);
+
+		lock.unlock();
+		load(first, count);
+		lock.lock();
+
+		for (int64_t index = first; index < first + count; index++)
+			loading.erase(index);
+		blocks_condition.notify_all();
+
+		// Stop at the end of the file, or when a block can't be read (until the position moves)
+		if (!blocks.count(first)) {
+			const int64_t waiting_block = current_block;
+			blocks_condition.wait(lock, [this, waiting_block]() { return stop || current_block != waiting_block; });
+		}
+	}
+}
+
+// Read from the current position
+int ReadAheadIO::Read(uint8_t *buffer, int size)
+{
+	int total = 0;
+	while (total < size && position < file_size) {
+		const int64_t index = position / block_size;
+		{
+			// Read ahead of this block
+			const std::lock_guard<std::mutex> lock(blocksMutex);
+			if (current_block != index) {
+				current_block = index;
+				blocks_condition.notify_all();
+			}
+		}
+
+		BlockData data = get_block(index);
+		if (!data)
+			break;
+		const int64_t offset = position - (index * block_size);
+		if (offset >= (int64_t) data->size())
+			break;
+		const int length = (int) std::min<int64_t>(size - total, data->size() - offset);
+		memcpy(buffer + total, data->data() + offset, length);
+		total += length;
+		position += length;
+	}
+	return total;
+}
+
+// Change the current position
+int64_t ReadAheadIO::Seek(int64_t offset, int whence)
+{
+	int64_t new_position;
+	switch (whence) {
+		case SEEK_SET:
+			new_position = offset;
+			break;
+		case SEEK_CUR:
+			new_position = position + offset;
+			break;
+		case SEEK_END:
+			new_position = file_size + offset;
+			break;
+		default:
+			return -1;
+	}
+	if (new_position < 0)
+		return -1;
+	position = new_position;
+	return position;
+}
+
+// libavformat read callback
+int ReadAheadIO::read_packet(void *opaque, uint8_t *buffer, int size)
+{
+	int bytes_read = static_cast<ReadAheadIO *>(opaque)->Read(buffer, size);
+	return (bytes_read > 0) ? bytes_read : AVERROR_EOF;
+}
+
+// libavformat seek callback
+int64_t ReadAheadIO::seek_packet(void *opaque, int64_t offset, int whence)
+{
+	ReadAheadIO *io = static_cast<ReadAheadIO *>(opaque);
+	if (whence & AVSEEK_SIZE)
+		return io->Size();
+	return io->Seek(offset, whence & ~AVSEEK_FORCE);
+}
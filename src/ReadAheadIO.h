@@ -0,0 +1,149 @@
+/**
+ * @file
+ * @brief Header file for ReadAheadIO class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_READ_AHEAD_IO_H
+#define OPENSHOT_READ_AHEAD_IO_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <QFile>
+
+// Forward declaration
+struct AVIOContext;
+
+namespace openshot {
+
+	/**
+	 * @brief This class reads a media file for libavformat (as a custom AVIOContext), with a
+	 * background thread which reads ahead of the demuxer.
+	 *
+	 * On network shares (i.e. NFS, SMB or FUSE mounts), every small read (or seek) of the demuxer
+	 * waits on the network. Instead, the file is read in large aligned blocks, and a background
+	 * thread keeps the blocks after the current position in memory, so the demuxer reads from
+	 * memory. Consecutive missing blocks are read with a single request. After a seek, the block
+	 * at the new position is read right away (and the read-ahead starts again from there).
+	 *
+	 * Blocks can also be kept in a local block cache (i.e. on an SSD), so the next time the same
+	 * file is read (or the same position is seeked to), the blocks are read from the local disk.
+	 * The cached blocks are named after the path, size and modification time of the file.
+	 *
+	 * Enabled by Settings::ENABLE_READ_AHEAD_IO (see FFmpegReader).
+	 *
+	 * \code
+	 * ReadAheadIO io("/mnt/nas/video.mp4", 1024 * 1024, 16, "/tmp/openshot-blocks");
+	 * if (io.Open()) {
+	 *     AVFormatContext *format = avformat_alloc_context();
+	 *     format->pb = io.Context();
+	 *     avformat_open_input(&format, "/mnt/nas/video.mp4", NULL, NULL);
+	 *     // ...
+	 *     avformat_close_input(&format);
+	 *     io.Close();
+	 * }
+	 * \endcode
+	 */
+	class ReadAheadIO {
+	private:
+		typedef std::shared_ptr<const std::vector<uint8_t>> BlockData;
+
+		/// A block of the file (in memory)
+		struct Block {
+			BlockData data;
+			uint64_t last_used; ///< To remove the least recently used blocks
+		};
+
+		std::string path;
+		std::string cache_path; ///< The directory of the local block cache (or empty)
+		std::string cache_prefix; ///< The name of this file's blocks in the block cache
+		int64_t block_size;
+		int blocks_ahead;
+		int64_t file_size;
+		int64_t position;
+
+		QFile file; ///< Only used while holding fileMutex
+		std::mutex fileMutex;
+
+		std::mutex blocksMutex;
+		std::condition_variable blocks_condition;
+		std::map<int64_t, Block> blocks;
+		std::set<int64_t> loading; ///< Blocks being read (by either thread)
+		uint64_t use_count;
+		int64_t current_block; ///< The block at the current position (read ahead from here)
+		bool stop;
+		std::thread read_ahead_thread;
+
+		AVIOContext *context;
+
+		/// Get the path of a block in the block cache
+		std::string cache_file(int64_t index) const;
+
+		/// Read a run of consecutive blocks (from the block cache, or with one read of the file)
+		void load(int64_t first, int64_t count);
+
+		/// Add a block to memory, and remove the least recently used blocks (call with blocksMutex held)
+		void insert(int64_t index, BlockData data);
+
+		/// Get a block (reading it if needed, and waiting if it is being read ahead)
+		BlockData get_block(int64_t index);
+
+		/// Keep the blocks after the current position in memory (called on the read-ahead thread)
+		void ReadAhead();
+
+		/// libavformat callbacks
+		static int read_packet(void *opaque, uint8_t *buffer, int size);
+		static int64_t seek_packet(void *opaque, int64_t offset, int whence);
+
+	public:
+		/// @brief Constructor for ReadAheadIO
+		/// @param path The path of the file
+		/// @param block_size The size of each read (in bytes)
+		/// @param blocks_ahead The number of blocks to read ahead of the current position
+		/// @param cache_path The directory of the local block cache (or empty, for no block cache)
+		ReadAheadIO(const std::string& path, int64_t block_size = 1024 * 1024, int blocks_ahead = 16, const std::string& cache_path = "");
+
+		/// Destructor
+		virtual ~ReadAheadIO();
+
+		/// @brief Open the file (and start reading ahead)
+		/// @returns false if the file can't be opened (i.e. it is not a local or mounted file)
+		bool Open();
+
+		/// Close the file (and stop reading ahead)
+		void Close();
+
+		/// Get the AVIOContext for libavformat (only valid while open)
+		AVIOContext *Context() { return context; }
+
+		/// @brief Read from the current position
+		/// @returns The number of bytes read (0 at the end of the file)
+		/// @param buffer The buffer to read into
+		/// @param size The number of bytes to read
+		int Read(uint8_t *buffer, int size);
+
+		/// @brief Change the current position (like fseek)
+		/// @returns The new position, or -1 if the position is invalid
+		int64_t Seek(int64_t offset, int whence);
+
+		/// Get the size of the file (in bytes)
+		int64_t Size() const { return file_size; }
+	};
+
+}
+
+#endif
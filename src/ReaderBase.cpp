@@ -15,8 +15,11 @@
 #include <sstream>
 
 #include "ReaderBase.h"
+#include "CacheBase.h"
 #include "ClipBase.h"
 #include "Frame.h"
+#include "FrameIterator.h"
+#include "FrameRequest.h"
 
 #include "Json.h"
 
@@ -250,3 +253,35 @@ openshot::ClipBase* ReaderBase::ParentClip() {
 void ReaderBase::ParentClip(openshot::ClipBase* new_clip) {
 	clip = new_clip;
 }
+
+// Get the counters of the cache used by this reader
+CacheStats ReaderBase::GetCacheStats() {
+	CacheBase* cache = GetCache();
+	return cache ? cache->GetStats() : CacheStats();
+}
+
+// Reset the counters of the cache used by this reader
+void ReaderBase::ResetCacheStats() {
+	CacheBase* cache = GetCache();
+	if (cache)
+		cache->ResetStats();
+}
+
+// Request a frame, which is rendered in the background
+std::shared_ptr<openshot::FrameRequest> ReaderBase::RequestFrame(int64_t number, int priority) {
+	auto request = std::make_shared<FrameRequest>(this, number, priority);
+
+	// Cached frames are returned right away (without waiting behind other requests)
+	CacheBase* cache = IsOpen() ? GetCache() : NULL;
+	if (cache && cache->Contains(number))
+		request->Run();
+	else
+		FrameRequest::Submit(request);
+
+	return request;
+}
+
+// Get an iterator over a range of frames (requested ahead in the background)
+std::shared_ptr<openshot::FrameIterator> ReaderBase::Frames(int64_t start, int64_t end, int64_t step, int prefetch) {
+	return std::make_shared<FrameIterator>(this, start, end, step, prefetch);
+}
@@ -27,8 +27,11 @@
 namespace openshot
 {
 	class CacheBase;
+	struct CacheStats;
 	class ClipBase;
 	class Frame;
+	class FrameIterator;
+	class FrameRequest;
 	/**
 	 * @brief This struct contains info about a media file, such as height, width, frames per second, etc...
 	 *
@@ -102,6 +105,12 @@ namespace openshot
 		/// Get the cache object used by this reader (note: not all readers use cache)
 		virtual openshot::CacheBase* GetCache() = 0;
 
+		/// Get the hit, miss and eviction counters of the caches used by this reader (and the readers it wraps)
+		virtual openshot::CacheStats GetCacheStats();
+
+		/// Reset the counters of the caches used by this reader (and the readers it wraps)
+		virtual void ResetCacheStats();
+
 		/// This method is required for all derived classes of ReaderBase, and returns the
 		/// openshot::Frame object, which contains the image and audio information for that
 		/// frame of video.
@@ -110,6 +119,30 @@ namespace openshot
 		/// @param[in] number The frame number that is requested.
 		virtual std::shared_ptr<openshot::Frame> GetFrame(int64_t number) = 0;
 
+		/// @brief Request a frame, which is rendered in the background (by a pool of threads shared by
+		/// all readers). Requests which are no longer needed can be cancelled (see openshot::FrameRequest).
+		///
+		/// @returns The request (which is already finished, if the frame is cached)
+		/// @param[in] number The frame number that is requested.
+		/// @param[in] priority Requests with a higher priority are rendered first.
+		virtual std::shared_ptr<openshot::FrameRequest> RequestFrame(int64_t number, int priority = 0);
+
+		/// @brief Get an iterator over a range of frames, which are requested ahead in the background
+		/// (see openshot::FrameIterator)
+		///
+		/// @returns The iterator (which must not outlive this reader)
+		/// @param[in] start The first frame number
+		/// @param[in] end The last frame number (included, unless the step skips it)
+		/// @param[in] step The frames to advance by (negative to iterate backwards)
+		/// @param[in] prefetch The number of frames requested ahead
+		std::shared_ptr<openshot::FrameIterator> Frames(int64_t start, int64_t end, int64_t step = 1, int prefetch = 8);
+
+		/// @brief Hint that frames are requested in order (i.e. by a FrameIterator), even when the requests
+		/// arrive out of order. Readers which decode ahead (openshot::FFmpegReader) start right away, and the
+		/// readers which wrap other readers pass the hint on. Readers without decode-ahead ignore it.
+		/// @param sequential True while the frames are requested in order
+		virtual void SetSequentialHint(bool sequential) { };
+
 		/// Determine if reader is open or closed
 		virtual bool IsOpen() = 0;
 
@@ -0,0 +1,501 @@
+/**
+ * @file
+ * @brief Source file for RenderCache class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QSaveFile>
+
+#if USE_LZ4
+#include <lz4.h>
+#endif
+
+#include "RenderCache.h"
+#include "Frame.h"
+#include "ImageBufferPool.h"
+#include "KeyFrame.h"
+#include "PixelKernels.h"
+#include "Settings.h"
+
+using namespace openshot;
+
+namespace {
+	// The header of a stored frame (followed by the image, and the audio of each channel)
+	struct FrameHeader {
+		char magic[4]; ///< "OSRC"
+		uint32_t version;
+		uint64_t key; ///< The key of the frame (to detect a renamed file)
+		int32_t layer_x, layer_y, layer_width, layer_height; ///< The region of the timeline frame covered by the frame
+		int32_t width, height; ///< The size of the image (0 = no image)
+		int32_t pixel_ratio_num, pixel_ratio_den;
+		int32_t compressed; ///< The image is LZ4 compressed
+		int32_t sample_rate, channels, samples, channel_layout;
+		int32_t reserved;
+		int64_t image_bytes; ///< Stored (possibly compressed) image bytes
+	};
+
+	const uint32_t FRAME_VERSION = 1;
+
+	// Get the modification time and size of a file (or -1, if it doesn't exist)
+	void file_stamp(const std::string& path, int64_t& modified, int64_t& size)
+	{
+		QFileInfo file(QString::fromStdString(path));
+		if (!file.exists()) {
+			modified = -1;
+			size = -1;
+			return;
+		}
+		modified = file.lastModified().toMSecsSinceEpoch();
+		size = file.size();
+	}
+
+	// Is a JSON member a file path (i.e. "path", or "protobuf_data_path")
+	bool is_path_member(const std::string& name)
+	{
+		static const std::string suffix = "_path";
+		return name == "path" || (name.size() > suffix.size() &&
+			name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0);
+	}
+}
+
+// Default constructor (FNV-1a offset basis)
+RenderKey::RenderKey() : hash(14695981039346656037ull) { }
+
+// Add raw bytes to the hash (FNV-1a)
+void RenderKey::add_bytes(const void *data, size_t size)
+{
+	const unsigned char *bytes = static_cast<const unsigned char *>(data);
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+}
+
+// Add a string (with its length, so consecutive strings can't run together)
+void RenderKey::Add(const std::string& value)
+{
+	Add(int64_t(value.size()));
+	add_bytes(value.data(), value.size());
+}
+
+// Add an integer
+void RenderKey::Add(int64_t value)
+{
+	add_bytes(&value, sizeof(value));
+}
+
+// Add a number
+void RenderKey::Add(double value)
+{
+	// -0.0 and 0.0 are the same value
+	if (value == 0.0)
+		value = 0.0;
+	add_bytes(&value, sizeof(value));
+}
+
+// Add a JSON value
+void RenderKey::add_json(const Json::Value& value, int64_t frame_number, bool evaluate_keyframes)
+{
+	switch (value.type()) {
+		case Json::nullValue:
+			Add(std::string("null"));
+			break;
+		case Json::intValue:
+		case Json::uintValue:
+		case Json::realValue:
+			Add(std::string("number"));
+			Add(value.asDouble());
+			break;
+		case Json::stringValue:
+			Add(std::string("string"));
+			Add(value.asString());
+			break;
+		case Json::booleanValue:
+			Add(std::string("bool"));
+			Add(int64_t(value.asBool()));
+			break;
+		case Json::arrayValue:
+			Add(std::string("array"));
+			Add(int64_t(value.size()));
+			for (const Json::Value& item : value)
+				add_json(item, frame_number, evaluate_keyframes);
+			break;
+		case Json::objectValue:
+			if (evaluate_keyframes && value["Points"].isArray()) {
+				// Only the values of a keyframe at this frame (and the frame before, for ramps) matter
+				Keyframe keyframe;
+				keyframe.SetJsonValue(value);
+				Add(std::string("keyframe"));
+				Add(keyframe.GetValue(frame_number - 1));
+				Add(keyframe.GetValue(frame_number));
+				break;
+			}
+
+			// Members are sorted by name (so the same state always gives the same key)
+			Add(std::string("object"));
+			Add(int64_t(value.size()));
+			for (const std::string& name : value.getMemberNames()) {
+				const Json::Value& member = value[name];
+				Add(name);
+
+				// The keyframes of a reader (i.e. a nested timeline) are not in this object's frame numbers
+				add_json(member, frame_number, evaluate_keyframes && name != "reader");
+
+				// Files are identified by their path, modification time and size
+				if (member.isString() && is_path_member(name)) {
+					int64_t modified, size;
+					file_stamp(member.asString(), modified, size);
+					Add(modified);
+					Add(size);
+				}
+			}
+			break;
+	}
+}
+
+// Add the JSON state of an object at a frame
+void RenderKey::AddState(const Json::Value& state, int64_t frame_number)
+{
+	add_json(state, frame_number, true);
+}
+
+// Get the key
+uint64_t RenderKey::Value() const
+{
+	// Mix the bits of the hash (SplitMix64 finalizer), since the key is also used as a file name
+	uint64_t z = hash;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	z = z ^ (z >> 31);
+	return z ? z : 1;
+}
+
+// Global reference to the cache
+RenderCache *RenderCache::m_pInstance = nullptr;
+
+// Create or Get an instance of the cache singleton
+RenderCache *RenderCache::Instance()
+{
+	// Create the actual instance of the cache only once (frames are rendered on many threads)
+	static std::once_flag created;
+	std::call_once(created, []() {
+		m_pInstance = new RenderCache;
+	});
+
+	return m_pInstance;
+}
+
+// Determine if the cache is enabled
+bool RenderCache::Enabled()
+{
+	return !Settings::Instance()->RENDER_CACHE_PATH.empty();
+}
+
+// Index the files of the cache directory (when the cache is first used, or its directory changes)
+bool RenderCache::open_folder()
+{
+	const std::string cache_path = Settings::Instance()->RENDER_CACHE_PATH;
+	if (cache_path.empty())
+		return false;
+	if (cache_path == folder)
+		return true;
+
+	folder = cache_path;
+	entries.clear();
+	total_bytes = 0;
+
+	QDir directory(QString::fromStdString(folder));
+	if (!directory.exists())
+		directory.mkpath(".");
+
+	// The frames of previous sessions (the modification time of a file is when the frame was last used)
+	const QFileInfoList files = directory.entryInfoList(QStringList() << "*.frame", QDir::Files);
+	for (const QFileInfo& file : files) {
+		bool valid = false;
+		const uint64_t key = file.completeBaseName().toULongLong(&valid, 16);
+		if (!valid || key == 0)
+			continue;
+		entries[key] = Entry{file.size(), file.lastModified().toMSecsSinceEpoch()};
+		total_bytes += file.size();
+	}
+
+	clean_up();
+	return true;
+}
+
+// Get the path of a stored frame
+std::string RenderCache::file_path(uint64_t key) const
+{
+	return folder + "/" + QString("%1.frame").arg(qulonglong(key), 16, 16, QChar('0')).toStdString();
+}
+
+// Delete the least recently used frames, until the cache fits in Settings::RENDER_CACHE_MB
+void RenderCache::clean_up()
+{
+	const int64_t max_bytes = int64_t(Settings::Instance()->RENDER_CACHE_MB) * 1024 * 1024;
+	if (max_bytes <= 0 || total_bytes <= max_bytes)
+		return;
+
+	// Delete down to 90% of the limit (so the next frames don't each delete a file)
+	std::vector<std::pair<int64_t, uint64_t>> by_age;
+	by_age.reserve(entries.size());
+	for (const auto& entry : entries)
+		by_age.emplace_back(entry.second.last_used, entry.first);
+	std::sort(by_age.begin(), by_age.end());
+
+	for (const auto& oldest : by_age) {
+		if (total_bytes <= max_bytes * 9 / 10)
+			break;
+		auto entry = entries.find(oldest.second);
+		QFile::remove(QString::fromStdString(file_path(entry->first)));
+		total_bytes -= entry->second.bytes;
+		stats.evictions++;
+		stats.evicted_bytes += entry->second.bytes;
+		entries.erase(entry);
+	}
+}
+
+// Store a rendered frame (which covers the whole timeline frame)
+bool RenderCache::Add(uint64_t key, std::shared_ptr<Frame> frame)
+{
+	return Add(key, frame, QRect(0, 0, frame->GetWidth(), frame->GetHeight()));
+}
+
+// Store a rendered frame
+bool RenderCache::Add(uint64_t key, std::shared_ptr<Frame> frame, const QRect& layer_rect)
+{
+	std::string path;
+	{
+		const std::lock_guard<std::mutex> lock(cacheMutex);
+		if (key == 0 || !open_folder())
+			return false;
+		path = file_path(key);
+	}
+
+	FrameHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, "OSRC", 4);
+	header.version = FRAME_VERSION;
+	header.key = key;
+	header.layer_x = layer_rect.x();
+	header.layer_y = layer_rect.y();
+	header.layer_width = layer_rect.width();
+	header.layer_height = layer_rect.height();
+	header.pixel_ratio_num = frame->GetPixelRatio().num;
+	header.pixel_ratio_den = frame->GetPixelRatio().den;
+
+	// Get the image (frames which cover nothing don't need one)
+	QImage image;
+	if (frame->has_image_data && !layer_rect.isEmpty()) {
+		image = *frame->GetImage();
+		PixelKernels::ToPremultipliedRGBA(image);
+		header.width = image.width();
+		header.height = image.height();
+	}
+	const int64_t raw_image_bytes = int64_t(header.width) * header.height * 4;
+	header.image_bytes = raw_image_bytes;
+
+	// Compress the image (if it actually gets smaller)
+	std::vector<char> compressed_image;
+#if USE_LZ4
+	if (raw_image_bytes > 0 && raw_image_bytes <= LZ4_MAX_INPUT_SIZE) {
+		compressed_image.resize(LZ4_compressBound((int) raw_image_bytes));
+		int compressed_bytes = LZ4_compress_default((const char *) image.constBits(), compressed_image.data(),
+													(int) raw_image_bytes, (int) compressed_image.size());
+		if (compressed_bytes > 0 && compressed_bytes < raw_image_bytes) {
+			header.compressed = 1;
+			header.image_bytes = compressed_bytes;
+		}
+	}
+#endif
+
+	// Get audio properties
+	header.sample_rate = frame->SampleRate();
+	header.channels = frame->has_audio_data ? frame->GetAudioChannelsCount() : 0;
+	header.samples = frame->has_audio_data ? frame->GetAudioSamplesCount() : 0;
+	header.channel_layout = frame->ChannelsLayout();
+
+	// Write to a temporary file, which replaces the frame's file once it is complete (so a partial frame is never loaded)
+	QSaveFile file(QString::fromStdString(path));
+	if (!file.open(QIODevice::WriteOnly))
+		return false;
+	file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	if (header.compressed)
+		file.write(compressed_image.data(), header.image_bytes);
+	else if (raw_image_bytes > 0)
+		file.write(reinterpret_cast<const char *>(image.constBits()), raw_image_bytes);
+	for (int channel = 0; channel < header.channels; channel++)
+		file.write(reinterpret_cast<const char *>(frame->GetAudioSamples(channel)), int64_t(header.samples) * sizeof(float));
+	if (!file.commit())
+		return false;
+
+	// Add to index
+	const int64_t bytes = QFileInfo(QString::fromStdString(path)).size();
+	const std::lock_guard<std::mutex> lock(cacheMutex);
+	if (path != file_path(key))
+		return false; // The cache directory changed while writing
+	auto existing = entries.find(key);
+	if (existing != entries.end())
+		total_bytes -= existing->second.bytes;
+	else
+		stats.insertions++;
+	entries[key] = Entry{bytes, QDateTime::currentMSecsSinceEpoch()};
+	total_bytes += bytes;
+	clean_up();
+	return true;
+}
+
+// Load a stored frame (which covers the whole timeline frame)
+std::shared_ptr<Frame> RenderCache::GetFrame(uint64_t key)
+{
+	QRect layer_rect;
+	return GetFrame(key, layer_rect);
+}
+
+// Load a stored frame
+std::shared_ptr<Frame> RenderCache::GetFrame(uint64_t key, QRect& layer_rect)
+{
+	std::string path;
+	{
+		const std::lock_guard<std::mutex> lock(cacheMutex);
+		if (key == 0 || !open_folder())
+			return std::shared_ptr<Frame>();
+		if (!entries.count(key)) {
+			stats.misses++;
+			return std::shared_ptr<Frame>();
+		}
+		path = file_path(key);
+	}
+
+	// Read and check the whole file (a damaged or truncated file is a miss)
+	QFile file(QString::fromStdString(path));
+	QByteArray contents;
+	if (file.open(QIODevice::ReadOnly))
+		contents = file.readAll();
+	FrameHeader header;
+	bool valid = contents.size() >= int(sizeof(header));
+	if (valid) {
+		std::memcpy(&header, contents.constData(), sizeof(header));
+		const int64_t audio_bytes = int64_t(header.channels) * header.samples * sizeof(float);
+		valid = std::memcmp(header.magic, "OSRC", 4) == 0 && header.version == FRAME_VERSION && header.key == key &&
+			header.width >= 0 && header.height >= 0 && header.channels >= 0 && header.samples >= 0 &&
+			header.image_bytes >= 0 && contents.size() == int64_t(sizeof(header)) + header.image_bytes + audio_bytes;
+#if !USE_LZ4
+		valid = valid && !header.compressed;
+#endif
+	}
+	if (!valid) {
+		const std::lock_guard<std::mutex> lock(cacheMutex);
+		stats.misses++;
+		return std::shared_ptr<Frame>();
+	}
+	const char *source = contents.constData() + sizeof(header);
+
+	// Create frame object
+	auto frame = std::make_shared<Frame>();
+	frame->SetPixelRatio(header.pixel_ratio_num, header.pixel_ratio_den);
+	layer_rect = QRect(header.layer_x, header.layer_y, header.layer_width, header.layer_height);
+
+	// Copy image (no decoding or format conversion needed)
+	if (header.width > 0 && header.height > 0) {
+		std::shared_ptr<QImage> image = ImageBufferPool::Instance()->CreateImage(header.width, header.height, QImage::Format_RGBA8888_Premultiplied);
+		const int64_t raw_image_bytes = int64_t(header.width) * header.height * 4;
+#if USE_LZ4
+		if (header.compressed) {
+			LZ4_decompress_safe(source, (char *) image->bits(), (int) header.image_bytes, (int) raw_image_bytes);
+		} else
+#endif
+		std::memcpy(image->bits(), source, raw_image_bytes);
+		frame->AddImage(image);
+	}
+
+	// Copy audio
+	if (header.channels > 0) {
+		frame->ResizeAudio(header.channels, header.samples, header.sample_rate, (ChannelLayout) header.channel_layout);
+		const float *audio_source = reinterpret_cast<const float *>(source + header.image_bytes);
+		std::vector<float> channel_samples(header.samples);
+		for (int channel = 0; channel < header.channels; channel++) {
+			// The audio may not be aligned to a float in the file's contents
+			std::memcpy(channel_samples.data(), audio_source + int64_t(channel) * header.samples, header.samples * sizeof(float));
+			frame->AddAudio(true, channel, 0, channel_samples.data(), header.samples, 1.0);
+		}
+	}
+
+	// Keep recently used frames the longest (in this and the next sessions)
+	const QDateTime now = QDateTime::currentDateTime();
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+	file.setFileTime(now, QFileDevice::FileModificationTime);
+#endif
+	{
+		const std::lock_guard<std::mutex> lock(cacheMutex);
+		auto entry = entries.find(key);
+		if (entry != entries.end())
+			entry->second.last_used = now.toMSecsSinceEpoch();
+		stats.hits++;
+	}
+
+	// return the Frame object
+	return frame;
+}
+
+// Check if a frame is stored
+bool RenderCache::Contains(uint64_t key)
+{
+	const std::lock_guard<std::mutex> lock(cacheMutex);
+	return open_folder() && entries.count(key) > 0;
+}
+
+// Delete all stored frames
+void RenderCache::Clear()
+{
+	const std::lock_guard<std::mutex> lock(cacheMutex);
+	if (!open_folder())
+		return;
+	for (const auto& entry : entries)
+		QFile::remove(QString::fromStdString(file_path(entry.first)));
+	entries.clear();
+	total_bytes = 0;
+}
+
+// Get the number of stored frames
+int64_t RenderCache::Count()
+{
+	const std::lock_guard<std::mutex> lock(cacheMutex);
+	return open_folder() ? int64_t(entries.size()) : 0;
+}
+
+// Get the total bytes of all stored frames
+int64_t RenderCache::GetBytes()
+{
+	const std::lock_guard<std::mutex> lock(cacheMutex);
+	return open_folder() ? total_bytes : 0;
+}
+
+// Get the counters of this cache
+CacheStats RenderCache::GetStats()
+{
+	const std::lock_guard<std::mutex> lock(cacheMutex);
+	return stats;
+}
+
+// Reset the counters of this cache
+void RenderCache::ResetStats()
+{
+	const std::lock_guard<std::mutex> lock(cacheMutex);
+	stats.Reset();
+}
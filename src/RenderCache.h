@@ -0,0 +1,171 @@
+/**
+ * @file
+ * @brief Header file for RenderCache class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_RENDER_CACHE_H
+#define OPENSHOT_RENDER_CACHE_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <QRect>
+
+#include "CacheBase.h"
+#include "Json.h"
+
+namespace openshot {
+	class Frame;
+
+	/**
+	 * @brief The hash of everything a rendered frame depends on (the key of a frame in the RenderCache)
+	 *
+	 * Values are added in order, and the same values always give the same key (in any session). AddState()
+	 * adds the JSON state of a clip or effect, as it is at one frame: each keyframe is replaced by its values
+	 * at that frame (and the frame before it, for ramps), so changing a keyframe only changes the keys of the
+	 * frames it affects. Each file path in the state is added with the modification time and size of the file,
+	 * so replacing a file changes the keys of the frames which use it.
+	 */
+	class RenderKey {
+	private:
+		uint64_t hash;
+
+		/// Add raw bytes to the hash
+		void add_bytes(const void *data, size_t size);
+
+		/// Add a JSON value (evaluating the keyframes at a frame, unless it is the state of a reader)
+		void add_json(const Json::Value& value, int64_t frame_number, bool evaluate_keyframes);
+
+	public:
+		/// Default constructor (an empty key)
+		RenderKey();
+
+		/// Add a string
+		void Add(const std::string& value);
+
+		/// Add an integer
+		void Add(int64_t value);
+
+		/// Add a number
+		void Add(double value);
+
+		/// @brief Add the JSON state of an object (i.e. a clip, with its effects and reader) at a frame
+		/// @param state The JSON state of the object
+		/// @param frame_number The frame the keyframes are evaluated at
+		void AddState(const Json::Value& state, int64_t frame_number);
+
+		/// Get the key (never 0, so 0 can mean "not cacheable")
+		uint64_t Value() const;
+	};
+
+	/**
+	 * @brief This singleton class stores rendered frames on disk by a hash of their inputs (a RenderKey), across sessions
+	 *
+	 * The caches of the clips and the timeline are keyed by frame number, and only live as long as the process.
+	 * This cache is content-addressed instead: each rendered frame of a clip is stored by the hash of its source
+	 * file (path, modification time and size), the clip's state at that frame (with its effects), and the size of
+	 * the output. Reopening a project (or another project using the same clip the same way) re-uses the frames,
+	 * and changing a clip changes the keys of the frames it affects (so stale frames are never returned, and
+	 * are deleted once they are the least recently used).
+	 *
+	 * The cache is enabled with Settings::RENDER_CACHE_PATH. Each frame is one file in that directory (raw
+	 * premultiplied RGBA, LZ4 compressed if libopenshot was built with LZ4, followed by the float audio), and
+	 * the least recently used files are deleted once the cache exceeds Settings::RENDER_CACHE_MB.
+	 *
+	 * \code
+	 * Settings::Instance()->RENDER_CACHE_PATH = "/home/user/.openshot_qt/render-cache";
+	 * RenderKey key;
+	 * key.AddState(clip.JsonValue(), 10);
+	 * std::shared_ptr<Frame> frame = RenderCache::Instance()->GetFrame(key.Value());
+	 * \endcode
+	 */
+	class RenderCache {
+	private:
+		struct Entry {
+			int64_t bytes; ///< The size of the file
+			int64_t last_used; ///< When the frame was last stored or loaded (in ms since the epoch)
+		};
+
+		std::mutex cacheMutex;
+		std::string folder; ///< The directory of the indexed files
+		std::map<uint64_t, Entry> entries; ///< The stored frames, by key
+		int64_t total_bytes = 0;
+		CacheStats stats;
+
+		/// Private variable to keep track of singleton instance
+		static RenderCache *m_pInstance;
+
+		/// Default constructor
+		RenderCache() = default;
+
+		/// Don't allow the user to copy or assign this instance
+		RenderCache(RenderCache const&) = delete;
+		RenderCache & operator=(RenderCache const&) = delete;
+
+		/// Index the files of the cache directory (if Settings::RENDER_CACHE_PATH changed), returns false if disabled
+		bool open_folder();
+
+		/// Get the path of a stored frame
+		std::string file_path(uint64_t key) const;
+
+		/// Delete the least recently used frames, until the cache fits in Settings::RENDER_CACHE_MB
+		void clean_up();
+
+	public:
+		/// Create or get an instance of this cache singleton (invoke the class with this method)
+		static RenderCache *Instance();
+
+		/// Determine if the cache is enabled (see Settings::RENDER_CACHE_PATH)
+		bool Enabled();
+
+		/// @brief Store a rendered frame (replacing any previous version)
+		/// @returns false if the frame could not be stored (i.e. the disk is full)
+		/// @param key The key of the frame (see RenderKey)
+		/// @param frame The frame to store
+		/// @param layer_rect The region of the timeline frame covered by the frame (see Clip::GetLayerFrame)
+		bool Add(uint64_t key, std::shared_ptr<openshot::Frame> frame, const QRect& layer_rect);
+
+		/// @brief Store a rendered frame (which covers the whole timeline frame)
+		bool Add(uint64_t key, std::shared_ptr<openshot::Frame> frame);
+
+		/// @brief Load a stored frame (or a NULL shared_ptr if it's not stored)
+		/// @param key The key of the frame
+		/// @param layer_rect Set to the region of the timeline frame covered by the frame
+		std::shared_ptr<openshot::Frame> GetFrame(uint64_t key, QRect& layer_rect);
+
+		/// @brief Load a stored frame (or a NULL shared_ptr if it's not stored)
+		std::shared_ptr<openshot::Frame> GetFrame(uint64_t key);
+
+		/// @brief Check if a frame is stored
+		/// @param key The key of the frame
+		bool Contains(uint64_t key);
+
+		/// Delete all stored frames
+		void Clear();
+
+		/// Get the number of stored frames
+		int64_t Count();
+
+		/// Get the total bytes of all stored frames
+		int64_t GetBytes();
+
+		/// Get the counters of this cache (hits, misses, insertions and evictions)
+		CacheStats GetStats();
+
+		/// Reset the counters of this cache
+		void ResetStats();
+	};
+
+}
+
+#endif
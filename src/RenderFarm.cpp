@@ -0,0 +1,349 @@
+/**
+ * @file
+ * @brief Source file for RenderCoordinator and RenderWorker classes
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+#include <zmq.hpp>
+
+#include "RenderFarm.h"
+#include "Exceptions.h"
+#include "SegmentedWriter.h"
+#include "ThreadAffinity.h"
+#include "Timeline.h"
+#include "ZmqLogger.h"
+
+using namespace openshot;
+
+namespace {
+	// The current time (in milliseconds)
+	int64_t now_ms() {
+		return std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// Get the path of an attempt of a job (i.e. "video.part1.mp4" => "video.part1.try2.mp4")
+	std::string attempt_path(const std::string& part, int attempt) {
+		const std::string name = "try" + std::to_string(attempt);
+		const size_t separator = part.find_last_of("/\\");
+		const size_t extension = part.find_last_of('.');
+		if (extension == std::string::npos || (separator != std::string::npos && extension < separator))
+			return part + "." + name;
+		return part.substr(0, extension) + "." + name + part.substr(extension);
+	}
+
+	// Create a socket (which doesn't keep unsent messages when it is closed)
+	std::unique_ptr<zmq::socket_t> create_socket(zmq::context_t& context, int type) {
+		std::unique_ptr<zmq::socket_t> socket(new zmq::socket_t(context, type));
+		const int linger = 0;
+		zmq_setsockopt(static_cast<void*>(*socket), ZMQ_LINGER, &linger, sizeof(linger));
+		return socket;
+	}
+
+	// Send a JSON message
+	void send_json(zmq::socket_t& socket, const Json::Value& root) {
+		const std::string text = root.toStyledString();
+		zmq::message_t message(text.length());
+		std::memcpy(message.data(), text.c_str(), text.length());
+#if ZMQ_VERSION > ZMQ_MAKE_VERSION(4, 3, 1)
+		socket.send(message, zmq::send_flags::none);
+#else
+		socket.send(message);
+#endif
+	}
+
+	// Wait for a JSON message (returns false on timeout, and an empty object for an invalid message)
+	bool receive_json(zmq::socket_t& socket, int timeout_ms, Json::Value& root) {
+		zmq::pollitem_t items[] = {{static_cast<void*>(socket), 0, ZMQ_POLLIN, 0}};
+		if (zmq_poll(items, 1, timeout_ms) <= 0 || !(items[0].revents & ZMQ_POLLIN))
+			return false;
+
+		zmq::message_t message;
+#if ZMQ_VERSION > ZMQ_MAKE_VERSION(4, 3, 1)
+		if (!socket.recv(message, zmq::recv_flags::none))
+			return false;
+#else
+		if (!socket.recv(&message))
+			return false;
+#endif
+		try {
+			root = openshot::stringToJson(std::string(static_cast<const char*>(message.data()), message.size()));
+		} catch (const std::exception&) {
+			root = Json::Value(Json::objectValue);
+		}
+		return true;
+	}
+}
+
+// Constructor
+RenderCoordinator::RenderCoordinator(const std::string& endpoint, int retries, int timeout_ms)
+	: endpoint(endpoint), retries(retries), timeout_ms(timeout_ms) { }
+
+// Serve the jobs to the workers
+void RenderCoordinator::Run(const std::string& project, const ReaderInfo& info, const Json::Value& writer,
+							const std::vector<RenderJob>& jobs, std::atomic<int64_t>& frames_written,
+							const std::atomic<bool>& cancel) {
+	// The state of each job
+	struct JobState {
+		int attempts = 0; ///< The number of attempts so far (the current attempt, while assigned)
+		bool assigned = false;
+		bool done = false;
+		int64_t heartbeat = 0; ///< The last time the worker of the current attempt reported
+		int64_t frames = 0; ///< The frames rendered by the current attempt
+	};
+	std::vector<JobState> states(jobs.size());
+
+	zmq::context_t context(1);
+	std::unique_ptr<zmq::socket_t> socket = create_socket(context, ZMQ_REP);
+	try {
+		socket->bind(endpoint.c_str());
+	} catch (const zmq::error_t& e) {
+		throw InvalidOptions("Could not bind the render farm endpoint (" + std::string(e.what()) + ").", endpoint);
+	}
+
+	// The common part of each job (the worker creates its own timeline and writer)
+	Json::Value job_message;
+	job_message["type"] = "job";
+	job_message["project"] = project;
+	job_message["writer"] = writer;
+	job_message["info"]["width"] = info.width;
+	job_message["info"]["height"] = info.height;
+	job_message["info"]["fps"]["num"] = info.fps.num;
+	job_message["info"]["fps"]["den"] = info.fps.den;
+	job_message["info"]["sample_rate"] = info.sample_rate;
+	job_message["info"]["channels"] = info.channels;
+	job_message["info"]["channel_layout"] = info.channel_layout;
+
+	// Remove the files of the attempts which did not succeed
+	auto remove_attempts = [&]() {
+		for (size_t index = 0; index < jobs.size(); index++) {
+			for (int attempt = 1; attempt <= states[index].attempts; attempt++)
+				std::remove(attempt_path(jobs[index].part, attempt).c_str());
+		}
+	};
+
+	// Give up the current attempt of a job (and fail the export, once it has no retries left)
+	auto fail_attempt = [&](size_t index, const std::string& reason) {
+		JobState& state = states[index];
+		state.assigned = false;
+		frames_written -= state.frames;
+		state.frames = 0;
+		ZMQ_DEBUG("RenderCoordinator::Run (failed attempt)", "job", index, "attempt", state.attempts, "first", jobs[index].first);
+		if (state.attempts <= retries)
+			return;
+
+		remove_attempts();
+		const std::string message = "Frames " + std::to_string(jobs[index].first) + " to " + std::to_string(jobs[index].last) +
+			" could not be rendered by the render farm (" + reason + ").";
+		if (jobs[index].video)
+			throw ErrorEncodingVideo(message, jobs[index].first);
+		throw ErrorEncodingAudio(message, jobs[index].first);
+	};
+
+	size_t done = 0;
+	while (done < jobs.size() && !cancel) {
+		// Retry the jobs of workers which stopped reporting their progress
+		for (size_t index = 0; index < jobs.size(); index++) {
+			if (states[index].assigned && now_ms() - states[index].heartbeat > timeout_ms)
+				fail_attempt(index, "the worker stopped responding");
+		}
+
+		Json::Value request;
+		if (!receive_json(*socket, 100, request))
+			continue;
+
+		// Find the job (and attempt) of the request
+		const std::string type = request["type"].asString();
+		const int64_t index = request["job"].asInt64();
+		const int attempt = request["attempt"].asInt();
+		const bool valid = index >= 0 && index < (int64_t) jobs.size();
+		const bool current = valid && states[index].assigned && states[index].attempts == attempt;
+		std::string failure;
+
+		Json::Value reply;
+		reply["type"] = "ok";
+		if (type == "ready") {
+			// Hand out the next job which is neither done nor assigned
+			reply["type"] = "wait";
+			for (size_t next = 0; next < jobs.size(); next++) {
+				JobState& state = states[next];
+				if (state.done || state.assigned)
+					continue;
+				state.attempts++;
+				state.assigned = true;
+				state.heartbeat = now_ms();
+				reply = job_message;
+				reply["job"] = (Json::Int64) next;
+				reply["attempt"] = state.attempts;
+				reply["part"] = attempt_path(jobs[next].part, state.attempts);
+				reply["video"] = jobs[next].video;
+				reply["first"] = (Json::Int64) jobs[next].first;
+				reply["last"] = (Json::Int64) jobs[next].last;
+				ZMQ_DEBUG("RenderCoordinator::Run (assigned)", "job", next, "attempt", state.attempts, "first", jobs[next].first, "last", jobs[next].last);
+				break;
+			}
+
+		} else if (type == "progress" && current) {
+			JobState& state = states[index];
+			const int64_t frames = request["frames"].asInt64();
+			frames_written += frames - state.frames;
+			state.frames = frames;
+			state.heartbeat = now_ms();
+
+		} else if (type == "result" && current) {
+			// Keep the file of the successful attempt
+			JobState& state = states[index];
+			const RenderJob& job = jobs[index];
+			failure = request["error"].asString();
+			if (failure.empty()) {
+				std::remove(job.part.c_str());
+				if (std::rename(attempt_path(job.part, attempt).c_str(), job.part.c_str()) != 0)
+					failure = "the segment file could not be renamed";
+			}
+			if (failure.empty()) {
+				frames_written += (job.last - job.first + 1) - state.frames;
+				state.frames = job.last - job.first + 1;
+				state.assigned = false;
+				state.done = true;
+				done++;
+			}
+
+		} else if (type == "progress" || type == "result") {
+			// An attempt which was given up (the worker removes its file)
+			reply["type"] = "cancel";
+
+		} else {
+			reply["type"] = "error";
+		}
+		send_json(*socket, reply);
+
+		if (!failure.empty())
+			fail_attempt(index, failure);
+	}
+
+	// Remove the files of abandoned attempts (of workers which stopped responding)
+	remove_attempts();
+}
+
+// Constructor
+RenderWorker::RenderWorker(const std::string& endpoint, int timeout_ms)
+	: endpoint(endpoint), timeout_ms(timeout_ms), running(true), jobs_rendered(0) { }
+
+// Render the jobs of the coordinator
+void RenderWorker::Run() {
+	// Render the jobs on one NUMA node (if any, see Settings::NUMA_NODE), so the readers, effects and
+	// writers of a job, and the frame buffers they touch first, stay on that node
+	ScopedNodeAffinity affinity;
+
+	zmq::context_t context(1);
+	std::unique_ptr<zmq::socket_t> socket;
+	auto connect = [&]() {
+		socket = create_socket(context, ZMQ_REQ);
+		socket->connect(endpoint.c_str());
+	};
+
+	// Send a request, and wait for the reply (a REQ socket which got no reply can't send again,
+	// so it is replaced, i.e. when the coordinator is not running)
+	auto request = [&](const Json::Value& message) -> Json::Value {
+		send_json(*socket, message);
+		const int64_t deadline = now_ms() + timeout_ms;
+		Json::Value reply;
+		while (running && now_ms() < deadline) {
+			if (receive_json(*socket, 100, reply))
+				return reply;
+		}
+		connect();
+		return Json::Value();
+	};
+
+	connect();
+	while (running) {
+		Json::Value ready;
+		ready["type"] = "ready";
+		const Json::Value job = request(ready);
+		if (job["type"].asString() != "job") {
+			// No job yet (or no coordinator): ask again in a moment
+			std::this_thread::sleep_for(std::chrono::milliseconds(250));
+			continue;
+		}
+
+		const Json::Value& info = job["info"];
+		const std::string part = job["part"].asString();
+		const bool video = job["video"].asBool();
+		const int64_t first = job["first"].asInt64();
+		const int64_t last = job["last"].asInt64();
+		ZMQ_DEBUG("RenderWorker::Run (job)", "job", job["job"].asInt64(), "attempt", job["attempt"].asInt(), "first", first, "last", last);
+
+		// Render the job on another thread (while this thread reports the progress)
+		SegmentedWriter writer(part);
+		writer.SetJsonValue(job["writer"]);
+		std::atomic<bool> cancel(false);
+		std::atomic<bool> finished(false);
+		std::string error;
+		std::thread render([&]() {
+			try {
+				Timeline timeline(info["width"].asInt(), info["height"].asInt(),
+								  Fraction(info["fps"]["num"].asInt(), info["fps"]["den"].asInt()),
+								  info["sample_rate"].asInt(), info["channels"].asInt(),
+								  (ChannelLayout) info["channel_layout"].asInt());
+				timeline.SetJson(job["project"].asString());
+				if (!video)
+					timeline.AudioOnly(true);
+				timeline.Open();
+				writer.WriteSegment(&timeline, part, video, first, last, cancel);
+				timeline.Close();
+			} catch (const std::exception& e) {
+				error = e.what();
+				if (error.empty())
+					error = "unknown error";
+			}
+			finished = true;
+		});
+
+		// Report the progress (which also tells the coordinator that this worker is alive)
+		int64_t last_report = now_ms();
+		while (!finished) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+			if (!running)
+				cancel = true;
+			if (cancel || now_ms() - last_report < 1000)
+				continue;
+
+			Json::Value progress;
+			progress["type"] = "progress";
+			progress["job"] = job["job"];
+			progress["attempt"] = job["attempt"];
+			progress["frames"] = (Json::Int64) writer.FramesWritten();
+			if (request(progress)["type"].asString() != "ok")
+				cancel = true;
+			last_report = now_ms();
+		}
+		render.join();
+
+		// Report the result (the file of a failed or abandoned attempt is removed)
+		if (!cancel) {
+			Json::Value result;
+			result["type"] = "result";
+			result["job"] = job["job"];
+			result["attempt"] = job["attempt"];
+			result["error"] = error;
+			if (request(result)["type"].asString() == "ok" && error.empty()) {
+				jobs_rendered++;
+				continue;
+			}
+		}
+		std::remove(part.c_str());
+	}
+}
@@ -0,0 +1,110 @@
+/**
+ * @file
+ * @brief Header file for RenderCoordinator and RenderWorker classes
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_RENDER_FARM_H
+#define OPENSHOT_RENDER_FARM_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Json.h"
+#include "ReaderBase.h"
+
+namespace openshot {
+
+	/// A range of frames of an export, which a worker renders and encodes into one file
+	struct RenderJob {
+		std::string part; ///< The path of the encoded file
+		bool video; ///< True to encode the video stream, false to encode the audio stream
+		int64_t first; ///< The first frame number (of the timeline)
+		int64_t last; ///< The last frame number (of the timeline)
+	};
+
+	/**
+	 * @brief This class hands out the jobs of an export to RenderWorker processes, over ZeroMQ
+	 * (see SegmentedWriter::SetFarm)
+	 *
+	 * The coordinator binds a REP socket, and answers the requests of the workers: a worker asks
+	 * for a job, reports its progress while rendering it, and reports the result. Each attempt
+	 * of a job writes its own file, which replaces the job's file once it succeeds. A job which
+	 * fails, or whose worker stops reporting progress, is given to the next worker which asks,
+	 * until it failed more than the allowed retries.
+	 */
+	class RenderCoordinator {
+	private:
+		std::string endpoint;
+		int retries;
+		int timeout_ms;
+
+	public:
+		/// @brief Constructor for RenderCoordinator
+		/// @param endpoint The ZeroMQ endpoint to bind (i.e. "tcp://*:5570")
+		/// @param retries The number of times a failed job is retried
+		/// @param timeout_ms The milliseconds without progress after which a job is retried
+		RenderCoordinator(const std::string& endpoint, int retries, int timeout_ms);
+
+		/// @brief Serve the jobs to the workers, until every job is done (or cancelled)
+		///
+		/// Throws an ErrorEncodingVideo (or ErrorEncodingAudio) exception when a job failed too often.
+		///
+		/// @param project The project JSON of the timeline
+		/// @param info The info of the timeline (its size, frame rate and audio format)
+		/// @param writer The export settings (see SegmentedWriter::JsonValue)
+		/// @param jobs The jobs to render
+		/// @param frames_written The number of frames rendered (updated with the progress of the workers)
+		/// @param cancel Stops serving the jobs when set
+		void Run(const std::string& project, const openshot::ReaderInfo& info, const Json::Value& writer,
+				 const std::vector<openshot::RenderJob>& jobs, std::atomic<int64_t>& frames_written,
+				 const std::atomic<bool>& cancel);
+	};
+
+	/**
+	 * @brief This class renders the jobs of a RenderCoordinator (i.e. a SegmentedWriter with a
+	 * render farm), on a render node
+	 *
+	 * The worker connects to the coordinator's endpoint, and renders jobs until Stop() is called.
+	 * Between exports (or before the coordinator starts), it keeps waiting for the next job, so a
+	 * worker can serve any number of exports.
+	 *
+	 * \code
+	 * RenderWorker worker("tcp://coordinator-host:5570");
+	 * worker.Run(); // Blocks, until worker.Stop() is called (from another thread)
+	 * \endcode
+	 */
+	class RenderWorker {
+	private:
+		std::string endpoint;
+		int timeout_ms;
+		std::atomic<bool> running;
+		std::atomic<int64_t> jobs_rendered;
+
+	public:
+		/// @brief Constructor for RenderWorker
+		/// @param endpoint The ZeroMQ endpoint of the coordinator (i.e. "tcp://coordinator-host:5570")
+		/// @param timeout_ms The milliseconds to wait for a reply of the coordinator (before reconnecting)
+		RenderWorker(const std::string& endpoint, int timeout_ms=5000);
+
+		/// Render the jobs of the coordinator (until Stop() is called)
+		void Run();
+
+		/// Stop the worker (the job being rendered is abandoned, and retried by another worker)
+		void Stop() { running = false; };
+
+		/// Get the number of jobs rendered successfully
+		int64_t JobsRendered() const { return jobs_rendered; };
+	};
+
+}
+
+#endif
@@ -0,0 +1,161 @@
+/**
+ * @file
+ * @brief Source file for RenderGraph class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+
+#include "RenderGraph.h"
+#include "Exceptions.h"
+#include "Frame.h"
+#include "FrameRequest.h"
+#include "TaskExecutor.h"
+
+using namespace openshot;
+
+// Add a node to the graph
+int RenderGraph::AddNode(const std::string& name, NodeFunction function, const std::vector<int>& inputs)
+{
+	const int index = (int) nodes.size();
+	for (int input : inputs) {
+		if (input < 0 || input >= index)
+			throw InvalidOptions("The inputs of a render graph node must be added before it.", name);
+	}
+
+	nodes.push_back({name, function, inputs, {}, nullptr});
+	for (int input : inputs)
+		nodes[input].dependents.push_back(index);
+	return index;
+}
+
+// Run all of the nodes
+void RenderGraph::Run(int threads)
+{
+	if (nodes.empty())
+		return;
+	const int worker_count = std::max(1, std::min(threads, (int) nodes.size()));
+
+	// The state of the run is shared with the helper tasks (a helper which starts after the
+	// run is finished returns at once, and never touches the nodes)
+	struct Schedule {
+		std::vector<std::deque<int>> ready; ///< The ready nodes of each worker (a worker takes its newest node, and steals the oldest node of another worker)
+		std::vector<int> remaining;
+		std::mutex scheduleMutex;
+		std::condition_variable schedule_condition;
+		size_t running = 0;
+		size_t finished = 0;
+		int active_workers = 0;
+		bool closed = false;
+		std::exception_ptr error;
+	};
+	auto schedule = std::make_shared<Schedule>();
+	schedule->ready.resize(worker_count);
+	schedule->remaining.resize(nodes.size());
+
+	for (size_t index = 0, worker = 0; index < nodes.size(); index++) {
+		nodes[index].output = nullptr;
+		schedule->remaining[index] = (int) nodes[index].inputs.size();
+		if (schedule->remaining[index] == 0)
+			schedule->ready[worker++ % worker_count].push_back((int) index);
+	}
+
+	auto work = [this, schedule, worker_count](int worker) {
+		std::unique_lock<std::mutex> lock(schedule->scheduleMutex);
+		if (schedule->closed)
+			return;
+		schedule->active_workers++;
+		while (true) {
+			// Take a ready node (my newest, or the oldest of another worker)
+			int index = -1;
+			if (!schedule->error) {
+				std::deque<int> &own = schedule->ready[worker];
+				if (!own.empty()) {
+					index = own.back();
+					own.pop_back();
+				} else {
+					for (int other = 1; other < worker_count && index < 0; other++) {
+						std::deque<int> &victim = schedule->ready[(worker + other) % worker_count];
+						if (!victim.empty()) {
+							index = victim.front();
+							victim.pop_front();
+						}
+					}
+				}
+			}
+			if (index < 0) {
+				// Stop when every node is finished (or no more nodes will start after an error)
+				if (schedule->finished == nodes.size() || (schedule->error && schedule->running == 0))
+					break;
+				schedule->schedule_condition.wait(lock);
+				continue;
+			}
+			schedule->running++;
+			lock.unlock();
+
+			// Run the node
+			Node &node = nodes[index];
+			std::exception_ptr node_error;
+			try {
+				Inputs inputs;
+				inputs.reserve(node.inputs.size());
+				for (int input : node.inputs)
+					inputs.push_back(nodes[input].output);
+				node.output = node.function(inputs);
+			} catch (...) {
+				node_error = std::current_exception();
+			}
+
+			lock.lock();
+			schedule->running--;
+			schedule->finished++;
+			if (node_error) {
+				if (!schedule->error)
+					schedule->error = node_error;
+			} else {
+				// Queue the nodes which are now ready on this worker (they use this node's output)
+				for (int dependent : node.dependents) {
+					if (--schedule->remaining[dependent] == 0)
+						schedule->ready[worker].push_back(dependent);
+				}
+			}
+			schedule->schedule_condition.notify_all();
+		}
+		schedule->active_workers--;
+		schedule->schedule_condition.notify_all();
+	};
+
+	// Run the other workers on the shared TaskExecutor, as part of the same frame request (so they stop
+	// if it is cancelled). This thread runs any nodes which the helpers don't start, so a busy executor
+	// (i.e. a render graph inside another one) only makes the run slower.
+	FrameRequest *request = FrameRequest::Current();
+	for (int worker = 1; worker < worker_count; worker++)
+		TaskExecutor::Instance()->Submit([request, work, worker]() { FrameRequest::RunAs(request, [&]() { work(worker); }); });
+	work(0);
+
+	// Wait for the helpers which are still running (and stop the others from starting)
+	std::unique_lock<std::mutex> lock(schedule->scheduleMutex);
+	schedule->closed = true;
+	schedule->schedule_condition.wait(lock, [&schedule]() { return schedule->active_workers == 0; });
+
+	if (schedule->error)
+		std::rethrow_exception(schedule->error);
+}
+
+// Get the output of a node
+std::shared_ptr<Frame> RenderGraph::Output(int node) const
+{
+	if (node < 0 || node >= (int) nodes.size())
+		return nullptr;
+	return nodes[node].output;
+}
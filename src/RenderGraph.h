@@ -0,0 +1,86 @@
+/**
+ * @file
+ * @brief Header file for RenderGraph class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_RENDER_GRAPH_H
+#define OPENSHOT_RENDER_GRAPH_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace openshot {
+	class Frame;
+
+	/**
+	 * @brief This class runs the work of rendering a frame as a graph of nodes (i.e. decode, effects, composite)
+	 *
+	 * Each node runs a function, which gets the outputs of its input nodes (the nodes it depends on), and
+	 * returns its own output. Nodes can only depend on nodes added before them, so the graph never has a
+	 * cycle. The nodes are run by workers on the shared TaskExecutor: each worker runs the nodes that become ready after its
+	 * own nodes first (keeping their data in its cache), and steals the oldest ready node of another worker
+	 * when it has none. Independent nodes (i.e. the clips of different layers) run at the same time.
+	 *
+	 * \code
+	 * RenderGraph graph;
+	 * int decode = graph.AddNode("decode", [&](const RenderGraph::Inputs& inputs) { return reader.GetFrame(1); });
+	 * int effect = graph.AddNode("effect", [&](const RenderGraph::Inputs& inputs) { return blur.GetFrame(inputs[0], 1); }, { decode });
+	 * graph.Run(4);
+	 * std::shared_ptr<Frame> frame = graph.Output(effect);
+	 * \endcode
+	 */
+	class RenderGraph {
+	public:
+		/// The outputs of a node's inputs (in the order of the node's inputs)
+		typedef std::vector<std::shared_ptr<openshot::Frame>> Inputs;
+
+		/// The function of a node
+		typedef std::function<std::shared_ptr<openshot::Frame>(const Inputs& inputs)> NodeFunction;
+
+	private:
+		/// A node of the graph
+		struct Node {
+			std::string name;
+			NodeFunction function;
+			std::vector<int> inputs;
+			std::vector<int> dependents; ///< The nodes which use this node's output
+			std::shared_ptr<openshot::Frame> output;
+		};
+
+		std::vector<Node> nodes;
+
+	public:
+		/// @brief Add a node to the graph
+		/// @returns The index of the node (to use as an input of other nodes)
+		/// @param name The name of the node (for debugging)
+		/// @param function The work of the node
+		/// @param inputs The nodes this node depends on (which must be added before it)
+		int AddNode(const std::string& name, NodeFunction function, const std::vector<int>& inputs = {});
+
+		/// Get the number of nodes
+		int Count() const { return (int) nodes.size(); }
+
+		/// @brief Run all of the nodes (the calling thread is one of the workers)
+		///
+		/// The workers run as part of the calling thread's FrameRequest (if any). If any node throws an exception, no
+		/// more nodes are started, and the first exception is re-thrown after the running nodes are finished.
+		/// @param threads The number of workers
+		void Run(int threads);
+
+		/// Get the output of a node (after Run)
+		std::shared_ptr<openshot::Frame> Output(int node) const;
+	};
+
+}
+
+#endif
@@ -0,0 +1,133 @@
+/**
+ * @file
+ * @brief Source file for RenderStats class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "RenderStats.h"
+#include "AllocationStats.h"
+
+#include <mutex>
+
+using namespace openshot;
+
+// Copy the stats of another stage
+RenderStageStats& RenderStageStats::operator=(const RenderStageStats& other)
+{
+	count = other.count.load(std::memory_order_relaxed);
+	total_ns = other.total_ns.load(std::memory_order_relaxed);
+	max_ns = other.max_ns.load(std::memory_order_relaxed);
+	return *this;
+}
+
+// Add the time of one run of the stage
+void RenderStageStats::Add(int64_t nanoseconds)
+{
+	count.fetch_add(1, std::memory_order_relaxed);
+	total_ns.fetch_add(nanoseconds, std::memory_order_relaxed);
+
+	// Keep the longest time (retrying if another thread changed it)
+	int64_t longest = max_ns.load(std::memory_order_relaxed);
+	while (nanoseconds > longest && !max_ns.compare_exchange_weak(longest, nanoseconds, std::memory_order_relaxed)) {}
+}
+
+// Forget all runs
+void RenderStageStats::Reset()
+{
+	count = 0;
+	total_ns = 0;
+	max_ns = 0;
+}
+
+// Generate Json::Value for this object
+Json::Value RenderStageStats::JsonValue() const
+{
+	const int64_t runs = count.load(std::memory_order_relaxed);
+	const double total_ms = total_ns.load(std::memory_order_relaxed) / 1000000.0;
+
+	Json::Value root;
+	root["count"] = Json::Int64(runs);
+	root["total_ms"] = total_ms;
+	root["average_ms"] = runs > 0 ? total_ms / runs : 0.0;
+	root["max_ms"] = max_ns.load(std::memory_order_relaxed) / 1000000.0;
+	return root;
+}
+
+// Global reference to the render stats
+RenderStats *RenderStats::m_pInstance = nullptr;
+
+// Create or Get an instance of the render stats singleton
+RenderStats *RenderStats::Instance()
+{
+	// Create the actual instance only once (stages are timed on many threads)
+	static std::once_flag created;
+	std::call_once(created, []() { m_pInstance = new RenderStats; });
+
+	return m_pInstance;
+}
+
+// Get the name of a stage
+std::string RenderStats::StageName(RenderStage stage)
+{
+	switch (stage) {
+		case RENDER_STAGE_FRAME: return "frame";
+		case RENDER_STAGE_DECODE: return "decode";
+		case RENDER_STAGE_SCALE: return "scale";
+		case RENDER_STAGE_RESAMPLE: return "resample";
+		case RENDER_STAGE_EFFECT: return "effect";
+		case RENDER_STAGE_TRANSFORM: return "transform";
+		case RENDER_STAGE_COMPOSITE: return "composite";
+		case RENDER_STAGE_CACHE: return "cache";
+		case RENDER_STAGE_ENCODE: return "encode";
+		default: return "";
+	}
+}
+
+// Get the name of an initialized subsystem
+std::string RenderStats::InitStageName(InitStage stage)
+{
+	switch (stage) {
+		case INIT_STAGE_LOGGER: return "logger";
+		case INIT_STAGE_SVG_FONTS: return "svg_fonts";
+		case INIT_STAGE_AUDIO_DEVICE: return "audio_device";
+		default: return "";
+	}
+}
+
+// Forget the stats of all stages
+void RenderStats::Reset()
+{
+	for (auto& stage : stages)
+		stage.Reset();
+	AllocationStats::Reset();
+}
+
+// Generate JSON string of this object
+std::string RenderStats::Json() const
+{
+	// Return formatted string
+	return JsonValue().toStyledString();
+}
+
+// Generate Json::Value for this object
+Json::Value RenderStats::JsonValue() const
+{
+	Json::Value root;
+	for (int stage = 0; stage < RENDER_STAGE_COUNT; stage++)
+		root[StageName(RenderStage(stage))] = stages[stage].JsonValue();
+
+	// Add the initialization of the subsystems (a count of 0 means it was never needed)
+	root["init"] = Json::objectValue;
+	for (int stage = 0; stage < INIT_STAGE_COUNT; stage++)
+		root["init"][InitStageName(InitStage(stage))] = init_stages[stage].JsonValue();
+
+	// Add the heap allocations of each subsystem (per rendered timeline frame), if they are counted
+	root["allocations"] = AllocationStats::JsonValue(stages[RENDER_STAGE_FRAME].count.load(std::memory_order_relaxed));
+	return root;
+}
@@ -0,0 +1,203 @@
+/**
+ * @file
+ * @brief Header file for RenderStats class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_RENDER_STATS_H
+#define OPENSHOT_RENDER_STATS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "Json.h"
+#include "Settings.h"
+
+namespace openshot {
+
+	/// The stages of rendering a frame, which are timed by RenderStats
+	enum RenderStage
+	{
+		RENDER_STAGE_FRAME,     ///< Render a whole timeline frame (which is not cached)
+		RENDER_STAGE_DECODE,    ///< Decode video and audio packets (FFmpegReader)
+		RENDER_STAGE_SCALE,     ///< Convert and scale decoded images (FFmpegReader, swscale)
+		RENDER_STAGE_RESAMPLE,  ///< Resample the audio of mapped frames (FrameMapper)
+		RENDER_STAGE_EFFECT,    ///< Apply the effects of a clip
+		RENDER_STAGE_TRANSFORM, ///< Apply the keyframes of a clip (scale, location, rotation, ...)
+		RENDER_STAGE_COMPOSITE, ///< Composite the layers of a timeline frame
+		RENDER_STAGE_CACHE,     ///< Look up frames in memory caches
+		RENDER_STAGE_ENCODE,    ///< Encode video and audio packets (FFmpegWriter)
+		RENDER_STAGE_COUNT
+	};
+
+	/// The subsystems which are initialized lazily (on first use), and timed by RenderStats
+	enum InitStage
+	{
+		INIT_STAGE_LOGGER,       ///< Bind the ZmqLogger socket (when the logger is enabled)
+		INIT_STAGE_SVG_FONTS,    ///< Load the system fonts for SVG text (first SVG file, with resvg)
+		INIT_STAGE_AUDIO_DEVICE, ///< Open the audio playback device (first playback)
+		INIT_STAGE_COUNT
+	};
+
+	/**
+	 * @brief The number, total time and longest time of one stage (lock-free, so it can be updated by any thread)
+	 */
+	struct RenderStageStats {
+		std::atomic<int64_t> count{0};       ///< The number of times the stage ran
+		std::atomic<int64_t> total_ns{0};    ///< The total time (in nanoseconds)
+		std::atomic<int64_t> max_ns{0};      ///< The longest time (in nanoseconds)
+
+		RenderStageStats() = default;
+		RenderStageStats(const RenderStageStats& other) { *this = other; }
+		RenderStageStats& operator=(const RenderStageStats& other);
+
+		/// Add the time of one run of the stage
+		void Add(int64_t nanoseconds);
+
+		/// Forget all runs
+		void Reset();
+
+		/// Generate Json::Value (count, total_ms, average_ms and max_ms)
+		Json::Value JsonValue() const;
+	};
+
+	/**
+	 * @brief This singleton class collects the time spent in each stage of rendering frames
+	 *
+	 * Stages are timed with a RenderStageTimer (on any thread), and the totals are returned by
+	 * Timeline::GetRenderStats() as JSON. The timers only read the clock when Settings::ENABLE_RENDER_STATS
+	 * is enabled; otherwise a timer costs a single check of that setting. While enabled, the stats are also
+	 * sent over the ZmqLogger (if it is enabled), every Settings::RENDER_STATS_LOG_FRAMES timeline frames.
+	 * Builds with allocation tracking also add the heap allocations of each subsystem (see AllocationStats).
+	 *
+	 * The one-time initialization of heavy subsystems (which only happens on their first use) is always
+	 * timed (see RenderInitTimer), since it only happens once, and is returned under "init".
+	 */
+	class RenderStats {
+	private:
+		RenderStageStats stages[RENDER_STAGE_COUNT];
+		RenderStageStats init_stages[INIT_STAGE_COUNT];
+
+		/// Private variable to keep track of singleton instance
+		static RenderStats *m_pInstance;
+
+		/// Default constructor
+		RenderStats() = default;
+
+		/// Don't allow the user to copy or assign this instance
+		RenderStats(RenderStats const&) = delete;
+		RenderStats & operator=(RenderStats const&) = delete;
+
+	public:
+		/// Create or get an instance of this singleton (invoke the class with this method)
+		static RenderStats *Instance();
+
+		/// Are the render stats collected (see Settings::ENABLE_RENDER_STATS)?
+		static bool Enabled() { return openshot::Settings::Instance()->ENABLE_RENDER_STATS; }
+
+		/// Get the name of a stage (as used in the JSON)
+		static std::string StageName(openshot::RenderStage stage);
+
+		/// Add the time of one run of a stage
+		void Add(openshot::RenderStage stage, int64_t nanoseconds) { stages[stage].Add(nanoseconds); }
+
+		/// Get the stats of a stage
+		const RenderStageStats& Stage(openshot::RenderStage stage) const { return stages[stage]; }
+
+		/// Get the name of an initialized subsystem (as used in the JSON)
+		static std::string InitStageName(openshot::InitStage stage);
+
+		/// Add the time of initializing a subsystem
+		void AddInit(openshot::InitStage stage, int64_t nanoseconds) { init_stages[stage].Add(nanoseconds); }
+
+		/// Get the initialization stats of a subsystem
+		const RenderStageStats& Init(openshot::InitStage stage) const { return init_stages[stage]; }
+
+		/// Forget the stats of all stages (and the counted allocations, see AllocationStats). The
+		/// initialization of subsystems only happens once, so it is kept.
+		void Reset();
+
+		/// Get and Set JSON methods
+		std::string Json() const; ///< Generate JSON string of this object
+		Json::Value JsonValue() const; ///< Generate Json::Value for this object
+	};
+
+	/**
+	 * @brief Time a stage, from construction until destruction (if the render stats are enabled)
+	 *
+	 * \code
+	 * {
+	 *     RenderStageTimer timer(RENDER_STAGE_DECODE);
+	 *     avcodec_send_packet(...);
+	 * }
+	 * \endcode
+	 */
+	class RenderStageTimer {
+	private:
+		openshot::RenderStage stage;
+		openshot::RenderStageStats* extra; ///< Additional stats to update (i.e. of one effect)
+		bool enabled;
+		std::chrono::steady_clock::time_point start;
+
+	public:
+		/// @brief Start timing a stage
+		/// @param stage The stage
+		/// @param extra Additional stats to update with the same time (optional)
+		explicit RenderStageTimer(openshot::RenderStage stage, openshot::RenderStageStats* extra = nullptr)
+			: stage(stage), extra(extra), enabled(RenderStats::Enabled()) {
+			if (enabled)
+				start = std::chrono::steady_clock::now();
+		}
+
+		/// Add the time of the stage
+		~RenderStageTimer() {
+			if (!enabled)
+				return;
+			const int64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - start).count();
+			RenderStats::Instance()->Add(stage, nanoseconds);
+			if (extra)
+				extra->Add(nanoseconds);
+		}
+	};
+
+
+	/**
+	 * @brief Time the initialization of a subsystem, from construction until destruction (always enabled)
+	 *
+	 * \code
+	 * static std::once_flag loaded;
+	 * std::call_once(loaded, []() {
+	 *     RenderInitTimer timer(INIT_STAGE_SVG_FONTS);
+	 *     options.loadSystemFonts();
+	 * });
+	 * \endcode
+	 */
+	class RenderInitTimer {
+	private:
+		openshot::InitStage stage;
+		std::chrono::steady_clock::time_point start;
+
+	public:
+		/// Start timing the initialization of a subsystem
+		explicit RenderInitTimer(openshot::InitStage stage)
+			: stage(stage), start(std::chrono::steady_clock::now()) { }
+
+		/// Add the time of the initialization
+		~RenderInitTimer() {
+			RenderStats::Instance()->AddInit(stage, std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - start).count());
+		}
+	};
+
+}
+
+#endif
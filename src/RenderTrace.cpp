@@ -0,0 +1,166 @@
+/**
+ * @file
+ * @brief Source file for RenderTrace class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "RenderTrace.h"
+
+#include <fstream>
+
+using namespace openshot;
+
+// Is a trace recording (checked by every span)
+std::atomic<bool> RenderTrace::recording{false};
+
+// Global reference to the render trace
+RenderTrace *RenderTrace::m_pInstance = nullptr;
+
+// Create or Get an instance of the render trace singleton
+RenderTrace *RenderTrace::Instance()
+{
+	// Create the actual instance only once (spans are recorded on many threads)
+	static std::once_flag created;
+	std::call_once(created, []() { m_pInstance = new RenderTrace; });
+
+	return m_pInstance;
+}
+
+// Get the spans of the calling thread (registering the thread the first time)
+RenderTrace::ThreadSpans* RenderTrace::thread_spans()
+{
+	thread_local std::shared_ptr<ThreadSpans> spans;
+	if (!spans) {
+		spans = std::make_shared<ThreadSpans>();
+		const std::lock_guard<std::mutex> lock(threadsMutex);
+		spans->thread_id = next_thread_id++;
+		spans->thread_name = "Thread " + std::to_string(spans->thread_id);
+		threads.push_back(spans);
+	}
+	return spans.get();
+}
+
+// Forget all spans, and start recording
+void RenderTrace::Start(std::string trace_path)
+{
+	recording = false;
+	{
+		const std::lock_guard<std::mutex> lock(threadsMutex);
+		path = trace_path;
+		origin = std::chrono::steady_clock::now();
+
+		// Forget the spans (and the threads which have exited since the last trace)
+		for (auto it = threads.begin(); it != threads.end();) {
+			if (it->use_count() == 1) {
+				it = threads.erase(it);
+				continue;
+			}
+			const std::lock_guard<std::mutex> spans_lock((*it)->spansMutex);
+			(*it)->spans.clear();
+			++it;
+		}
+	}
+	recording = true;
+}
+
+// Stop recording, and write the trace file
+bool RenderTrace::Stop()
+{
+	recording = false;
+
+	std::string trace_path;
+	{
+		const std::lock_guard<std::mutex> lock(threadsMutex);
+		trace_path = path;
+	}
+	if (trace_path.empty())
+		return true;
+
+	std::ofstream file(trace_path);
+	if (!file.is_open())
+		return false;
+
+	// Write compact JSON (a trace has many thousands of spans)
+	Json::StreamWriterBuilder builder;
+	builder["indentation"] = "";
+	std::unique_ptr<Json::StreamWriter> writer(builder.newStreamWriter());
+	writer->write(JsonValue(), &file);
+	return file.good();
+}
+
+// Set the name of the calling thread
+void RenderTrace::SetThreadName(std::string name)
+{
+	ThreadSpans *spans = thread_spans();
+	const std::lock_guard<std::mutex> lock(spans->spansMutex);
+	spans->thread_name = name;
+}
+
+// Add a span of the calling thread
+void RenderTrace::AddSpan(std::string name, const char* category,
+	std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+	if (!Enabled())
+		return;
+
+	// Spans which started before the trace are clipped to its start
+	if (start < origin)
+		start = origin;
+	const int64_t start_us = std::chrono::duration_cast<std::chrono::microseconds>(start - origin).count();
+	const int64_t duration_us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+	ThreadSpans *spans = thread_spans();
+	const std::lock_guard<std::mutex> lock(spans->spansMutex);
+	spans->spans.push_back({std::move(name), category, start_us, duration_us});
+}
+
+// Generate JSON string of this object
+std::string RenderTrace::Json()
+{
+	// Return formatted string
+	return JsonValue().toStyledString();
+}
+
+// Generate Json::Value for this object (in the Chrome trace event format)
+Json::Value RenderTrace::JsonValue()
+{
+	Json::Value events = Json::Value(Json::arrayValue);
+
+	const std::lock_guard<std::mutex> lock(threadsMutex);
+	for (const auto& thread : threads) {
+		const std::lock_guard<std::mutex> spans_lock(thread->spansMutex);
+
+		// The name of the thread (a metadata event)
+		Json::Value name_event;
+		name_event["name"] = "thread_name";
+		name_event["ph"] = "M";
+		name_event["pid"] = 1;
+		name_event["tid"] = thread->thread_id;
+		name_event["args"]["name"] = thread->thread_name;
+		events.append(name_event);
+
+		// The spans of the thread (complete events)
+		for (const auto& span : thread->spans) {
+			Json::Value event;
+			event["name"] = span.name;
+			event["cat"] = span.category;
+			event["ph"] = "X";
+			event["pid"] = 1;
+			event["tid"] = thread->thread_id;
+			event["ts"] = Json::Int64(span.start_us);
+			event["dur"] = Json::Int64(span.duration_us);
+			events.append(event);
+		}
+	}
+
+	Json::Value root;
+	root["traceEvents"] = events;
+	root["displayTimeUnit"] = "ms";
+	return root;
+}
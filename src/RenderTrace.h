@@ -0,0 +1,174 @@
+/**
+ * @file
+ * @brief Header file for RenderTrace class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_RENDER_TRACE_H
+#define OPENSHOT_RENDER_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Json.h"
+
+namespace openshot {
+
+	/**
+	 * @brief This singleton class records spans of rendering work (by thread), and writes them as a Chrome trace
+	 *
+	 * While recording, each RenderTraceSpan adds a span (its name, thread and start and end time) to a buffer
+	 * of its own thread. Stop() writes all spans to a JSON file in the Chrome trace event format, which can be
+	 * opened by chrome://tracing or https://ui.perfetto.dev. The spans show where each thread spent its time
+	 * (decoding, clips, effects, layers, encoding, ...), the waits for contended locks (see TraceLock) and the
+	 * idle time of each thread (the gaps between spans).
+	 *
+	 * When not recording, a span costs a single check of an atomic flag.
+	 *
+	 * \code
+	 * RenderTrace::Instance()->Start("/tmp/render-trace.json");
+	 * // Render some frames (i.e. export or play a timeline)
+	 * RenderTrace::Instance()->Stop();
+	 * \endcode
+	 */
+	class RenderTrace {
+	private:
+		/// One span of work (in microseconds since Start())
+		struct TraceSpan {
+			std::string name;
+			const char* category;
+			int64_t start_us;
+			int64_t duration_us;
+		};
+
+		/// The spans of one thread
+		struct ThreadSpans {
+			int thread_id;
+			std::string thread_name;
+			std::vector<TraceSpan> spans;
+			std::mutex spansMutex; ///< Only contended while the spans are collected
+		};
+
+		static std::atomic<bool> recording;
+		std::string path;
+		std::chrono::steady_clock::time_point origin;
+		std::mutex threadsMutex;
+		std::vector<std::shared_ptr<ThreadSpans>> threads;
+		int next_thread_id = 1;
+
+		/// Get the spans of the calling thread (registering the thread the first time)
+		ThreadSpans* thread_spans();
+
+		/// Private variable to keep track of singleton instance
+		static RenderTrace *m_pInstance;
+
+		/// Default constructor
+		RenderTrace() = default;
+
+		/// Don't allow the user to copy or assign this instance
+		RenderTrace(RenderTrace const&) = delete;
+		RenderTrace & operator=(RenderTrace const&) = delete;
+
+	public:
+		/// Create or get an instance of this singleton (invoke the class with this method)
+		static RenderTrace *Instance();
+
+		/// Are spans being recorded?
+		static bool Enabled() { return recording.load(std::memory_order_relaxed); }
+
+		/// @brief Forget all spans, and start recording
+		/// @param trace_path The file to write the trace to, when recording is stopped (empty = don't write a file)
+		void Start(std::string trace_path);
+
+		/// Stop recording, and write the trace to the file passed to Start() (returns false if it can't be written)
+		bool Stop();
+
+		/// Set the name of the calling thread (as shown in the trace)
+		void SetThreadName(std::string name);
+
+		/// @brief Add a span of the calling thread (only while recording)
+		/// @param name The name of the span (i.e. "Clip::GetFrame")
+		/// @param category The category of the span (i.e. "decode", "effect" or "lock")
+		/// @param start When the span started
+		/// @param end When the span ended
+		void AddSpan(std::string name, const char* category,
+			std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+
+		/// Get and Set JSON methods
+		std::string Json(); ///< Generate JSON string of this object (the Chrome trace)
+		Json::Value JsonValue(); ///< Generate Json::Value for this object (the Chrome trace)
+	};
+
+	/**
+	 * @brief Record a span of the calling thread, from construction until destruction (if a trace is recording)
+	 *
+	 * \code
+	 * {
+	 *     RenderTraceSpan span("FFmpegReader::ReadStream", "decode");
+	 *     ...
+	 * }
+	 * \endcode
+	 */
+	class RenderTraceSpan {
+	private:
+		std::string name;
+		const char* category;
+		bool enabled;
+		std::chrono::steady_clock::time_point start;
+
+	public:
+		/// @brief Start a span
+		/// @param name The name of the span (only copied while recording)
+		/// @param category The category of the span
+		RenderTraceSpan(const char* name, const char* category)
+			: category(category), enabled(RenderTrace::Enabled()) {
+			if (enabled) {
+				this->name = name;
+				start = std::chrono::steady_clock::now();
+			}
+		}
+
+		/// @brief Start a span (with a name which is only known at runtime, i.e. of an effect)
+		/// @param name The name of the span
+		/// @param category The category of the span
+		RenderTraceSpan(const std::string& name, const char* category)
+			: RenderTraceSpan(name.c_str(), category) {}
+
+		/// Add the span to the trace
+		~RenderTraceSpan() {
+			if (enabled)
+				RenderTrace::Instance()->AddSpan(std::move(name), category, start, std::chrono::steady_clock::now());
+		}
+	};
+
+	/// @brief Lock a mutex, and record the wait as a "lock" span (only if the mutex was held by another thread)
+	/// @param mutex The mutex to lock
+	/// @param name The name of the span (i.e. "wait Timeline::getFrameMutex")
+	template <typename Mutex>
+	std::unique_lock<Mutex> TraceLock(Mutex& mutex, const char* name)
+	{
+		if (!RenderTrace::Enabled())
+			return std::unique_lock<Mutex>(mutex);
+
+		std::unique_lock<Mutex> lock(mutex, std::try_to_lock);
+		if (!lock.owns_lock()) {
+			RenderTraceSpan span(name, "lock");
+			lock.lock();
+		}
+		return lock;
+	}
+
+}
+
+#endif
@@ -0,0 +1,747 @@
+/**
+ * @file
+ * @brief Source file for SegmentedWriter class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "SegmentedWriter.h"
+#include "Clip.h"
+#include "EffectBase.h"
+#include "Exceptions.h"
+#include "FFmpegUtilities.h"
+#include "FrameMapper.h"
+#include "KeyFrame.h"
+#include "RenderFarm.h"
+#include "Timeline.h"
+
+using namespace openshot;
+
+namespace {
+	// An input file (each temporary file has a single stream, and only the video stream of a source file is used)
+	struct ConcatInput {
+		AVFormatContext *context = NULL;
+		AVStream *stream = NULL;
+	};
+
+	// Close an input file
+	void close_input(ConcatInput& input) {
+		if (input.context)
+			avformat_close_input(&input.context);
+		input.stream = NULL;
+	}
+
+	// Open an input file (and find its stream, or its video stream)
+	void open_input(const std::string& path, ConcatInput& input, bool video=false) {
+		if (avformat_open_input(&input.context, path.c_str(), NULL, NULL) != 0)
+			throw InvalidFile("Could not open the file.", path);
+		const int index = (avformat_find_stream_info(input.context, NULL) < 0) ? -1 :
+			(video ? av_find_best_stream(input.context, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0) : 0);
+		if (index < 0 || index >= (int) input.context->nb_streams) {
+			close_input(input);
+			throw InvalidFile("Could not find a stream in the file.", path);
+		}
+		input.stream = input.context->streams[index];
+	}
+
+	// Add a stream to the output file (with the codec parameters of an input stream)
+	AVStream *add_output_stream(AVFormatContext *output, const AVStream *input_stream) {
+		AVStream *stream = avformat_new_stream(output, NULL);
+		if (!stream || avcodec_parameters_copy(stream->codecpar, input_stream->codecpar) < 0)
+			return NULL;
+		stream->codecpar->codec_tag = 0;
+		stream->time_base = input_stream->time_base;
+		stream->avg_frame_rate = input_stream->avg_frame_rate;
+		stream->r_frame_rate = input_stream->r_frame_rate;
+		return stream;
+	}
+
+	// The time of a packet (used to interleave the streams)
+	int64_t packet_time(const AVPacket *packet) {
+		return (packet->dts != AV_NOPTS_VALUE) ? packet->dts : packet->pts;
+	}
+
+	// The frame number of a packet (of a source file without B-frames)
+	int64_t packet_frame(const AVPacket *packet, const AVStream *stream, AVRational frame_duration) {
+		const int64_t start_time = (stream->start_time != AV_NOPTS_VALUE) ? stream->start_time : 0;
+		return av_rescale_q(packet_time(packet) - start_time, stream->time_base, frame_duration) + 1;
+	}
+
+	// Seek a source file to the key frame before a frame number
+	void seek_source(ConcatInput& input, int64_t number, AVRational frame_duration) {
+		const int64_t start_time = (input.stream->start_time != AV_NOPTS_VALUE) ? input.stream->start_time : 0;
+		const int64_t timestamp = av_rescale_q(number - 1, frame_duration, input.stream->time_base) + start_time;
+		av_seek_frame(input.context, input.stream->index, timestamp, AVSEEK_FLAG_BACKWARD);
+	}
+
+	// Find the first key frame of a source file in a range of frames (or -1), if the source
+	// can be copied into the output (same codec, size and frame rate, and no B-frames)
+	int64_t find_key_frame(const std::string& source, int64_t first, int64_t last, AVCodecID codec_id, Fraction fps, int width, int height) {
+		ConcatInput input;
+		try {
+			open_input(source, input, true);
+		} catch (const InvalidFile&) {
+			return -1;
+		}
+
+		const AVCodecParameters *parameters = input.stream->codecpar;
+		const AVRational frame_duration = av_make_q(fps.den, fps.num);
+		int64_t key_frame = -1;
+		if (parameters->codec_id == codec_id && parameters->width == width && parameters->height == height &&
+			parameters->video_delay == 0 && av_cmp_q(input.stream->avg_frame_rate, av_make_q(fps.num, fps.den)) == 0) {
+			seek_source(input, first, frame_duration);
+			AVPacket *packet = av_packet_alloc();
+			while (packet && av_read_frame(input.context, packet) >= 0) {
+				const bool video_packet = (packet->stream_index == input.stream->index && packet_time(packet) != AV_NOPTS_VALUE);
+				const int64_t number = video_packet ? packet_frame(packet, input.stream, frame_duration) : 0;
+				const bool key = (packet->flags & AV_PKT_FLAG_KEY);
+				av_packet_unref(packet);
+				if (!video_packet)
+					continue;
+				if (number > last)
+					break;
+				if (key && number >= first) {
+					key_frame = number;
+					break;
+				}
+			}
+			av_packet_free(&packet);
+		}
+		close_input(input);
+		return key_frame;
+	}
+
+	// Determine if two streams have the same codec parameters (so they can be joined)
+	bool same_parameters(const AVCodecParameters *a, const AVCodecParameters *b) {
+		return a->codec_id == b->codec_id && a->width == b->width && a->height == b->height &&
+			a->format == b->format && a->extradata_size == b->extradata_size &&
+			(a->extradata_size == 0 || memcmp(a->extradata, b->extradata, a->extradata_size) == 0);
+	}
+
+	// Determine if every point of a keyframe has a value
+	bool is_constant(const Keyframe& keyframe, double value) {
+		if (keyframe.GetCount() == 0)
+			return std::fabs(value) < 0.000001;
+		for (int64_t index = 0; index < keyframe.GetCount(); index++) {
+			if (std::fabs(keyframe.GetPoint(index).co.Y - value) > 0.000001)
+				return false;
+		}
+		return true;
+	}
+
+	// Determine if a clip shows its source images unchanged (no effects, transforms or time curve)
+	bool passthrough_clip(Clip* clip) {
+		return clip->Effects().empty() && clip->display == FRAME_DISPLAY_NONE && !clip->Waveform() &&
+			clip->GetAttachedId().empty() && clip->time.GetCount() <= 1 &&
+			is_constant(clip->time, 1.0) && is_constant(clip->alpha, 1.0) &&
+			is_constant(clip->scale_x, 1.0) && is_constant(clip->scale_y, 1.0) &&
+			is_constant(clip->location_x, 0.0) && is_constant(clip->location_y, 0.0) &&
+			is_constant(clip->rotation, 0.0) && is_constant(clip->shear_x, 0.0) && is_constant(clip->shear_y, 0.0) &&
+			is_constant(clip->perspective_c1_x, -1.0) && is_constant(clip->perspective_c1_y, -1.0) &&
+			is_constant(clip->perspective_c2_x, -1.0) && is_constant(clip->perspective_c2_y, -1.0) &&
+			is_constant(clip->perspective_c3_x, -1.0) && is_constant(clip->perspective_c3_y, -1.0) &&
+			is_constant(clip->perspective_c4_x, -1.0) && is_constant(clip->perspective_c4_y, -1.0);
+	}
+}
+
+// Constructor
+SegmentedWriter::SegmentedWriter(const std::string& path, int segments)
+	: path(path), segments(std::max(1, segments)), passthrough(false), has_video(false), fps(30, 1), width(0), height(0),
+	  pixel_ratio(1, 1), interlaced(false), top_field_first(true), video_bit_rate(0), has_audio(false),
+	  sample_rate(0), channels(0), channel_layout(LAYOUT_STEREO), audio_bit_rate(0),
+	  farm_retries(2), farm_timeout_ms(60000), frames_written(0), total_frames(0) { }
+
+// Render the segments on RenderWorker processes
+void SegmentedWriter::SetFarm(const std::string& endpoint, int retries, int timeout_ms) {
+	farm_endpoint = endpoint;
+	farm_retries = std::max(0, retries);
+	farm_timeout_ms = std::max(1000, timeout_ms);
+}
+
+// Set video export options
+void SegmentedWriter::SetVideoOptions(bool has_video, std::string codec, Fraction fps, int width, int height, Fraction pixel_ratio, bool interlaced, bool top_field_first, int bit_rate) {
+	this->has_video = has_video;
+	video_codec = codec;
+	this->fps = fps;
+	this->width = width;
+	this->height = height;
+	this->pixel_ratio = pixel_ratio;
+	this->interlaced = interlaced;
+	this->top_field_first = top_field_first;
+	video_bit_rate = bit_rate;
+}
+
+// Set audio export options
+void SegmentedWriter::SetAudioOptions(bool has_audio, std::string codec, int sample_rate, int channels, ChannelLayout channel_layout, int bit_rate) {
+	this->has_audio = has_audio;
+	audio_codec = codec;
+	this->sample_rate = sample_rate;
+	this->channels = channels;
+	this->channel_layout = channel_layout;
+	audio_bit_rate = bit_rate;
+}
+
+// Set a custom encoder option (for every segment)
+void SegmentedWriter::SetOption(StreamType stream, std::string name, std::string value) {
+	options.push_back({stream, name, value});
+}
+
+// Get the progress of the export (from 0.0 to 1.0)
+float SegmentedWriter::Progress() const {
+	if (total_frames <= 0)
+		return 0.0;
+	return float(frames_written) / float(total_frames);
+}
+
+// Generate Json::Value for the export settings
+Json::Value SegmentedWriter::JsonValue() const {
+	Json::Value root;
+	root["path"] = path;
+	root["has_video"] = has_video;
+	root["video_codec"] = video_codec;
+	root["fps"]["num"] = fps.num;
+	root["fps"]["den"] = fps.den;
+	root["width"] = width;
+	root["height"] = height;
+	root["pixel_ratio"]["num"] = pixel_ratio.num;
+	root["pixel_ratio"]["den"] = pixel_ratio.den;
+	root["interlaced"] = interlaced;
+	root["top_field_first"] = top_field_first;
+	root["video_bit_rate"] = video_bit_rate;
+	root["has_audio"] = has_audio;
+	root["audio_codec"] = audio_codec;
+	root["sample_rate"] = sample_rate;
+	root["channels"] = channels;
+	root["channel_layout"] = channel_layout;
+	root["audio_bit_rate"] = audio_bit_rate;
+	root["options"] = Json::Value(Json::arrayValue);
+	for (const auto& option : options) {
+		Json::Value option_root;
+		option_root["stream"] = option.stream;
+		option_root["name"] = option.name;
+		option_root["value"] = option.value;
+		root["options"].append(option_root);
+	}
+	return root;
+}
+
+// Load Json::Value into the export settings
+void SegmentedWriter::SetJsonValue(const Json::Value root) {
+	// Set data from Json (if key is found)
+	if (!root["path"].isNull())
+		path = root["path"].asString();
+	if (!root["has_video"].isNull())
+		SetVideoOptions(root["has_video"].asBool(), root["video_codec"].asString(),
+						Fraction(root["fps"]["num"].asInt(), root["fps"]["den"].asInt()),
+						root["width"].asInt(), root["height"].asInt(),
+						Fraction(root["pixel_ratio"]["num"].asInt(), root["pixel_ratio"]["den"].asInt()),
+						root["interlaced"].asBool(), root["top_field_first"].asBool(), root["video_bit_rate"].asInt());
+	if (!root["has_audio"].isNull())
+		SetAudioOptions(root["has_audio"].asBool(), root["audio_codec"].asString(), root["sample_rate"].asInt(),
+						root["channels"].asInt(), (ChannelLayout) root["channel_layout"].asInt(), root["audio_bit_rate"].asInt());
+	if (root["options"].isArray()) {
+		options.clear();
+		for (const auto& option : root["options"])
+			SetOption((StreamType) option["stream"].asInt(), option["name"].asString(), option["value"].asString());
+	}
+}
+
+// Get the path of a temporary file
+std::string SegmentedWriter::part_path(const std::string& name) const {
+	// Insert the name before the extension (i.e. "video.mp4" => "video.part1.mp4")
+	const size_t separator = path.find_last_of("/\\");
+	const size_t extension = path.find_last_of('.');
+	if (extension == std::string::npos || (separator != std::string::npos && extension < separator))
+		return path + "." + name;
+	return path.substr(0, extension) + "." + name + path.substr(extension);
+}
+
+// Get the GOP size of the video encoder
+int64_t SegmentedWriter::gop_size() const {
+	for (auto option = options.rbegin(); option != options.rend(); ++option) {
+		if (option->stream == VIDEO_STREAM && option->name == "g") {
+			try {
+				return std::max<int64_t>(1, std::stoll(option->value));
+			} catch (const std::exception&) {
+				break;
+			}
+		}
+	}
+	return 12;
+}
+
+// Set the options of a segment writer
+void SegmentedWriter::configure_writer(FFmpegWriter& writer, bool video) const {
+	if (video)
+		writer.SetVideoOptions(true, video_codec, fps, width, height, pixel_ratio, interlaced, top_field_first, video_bit_rate);
+	else
+		writer.SetAudioOptions(true, audio_codec, sample_rate, channels, channel_layout, audio_bit_rate);
+
+	// Custom options need the streams
+	writer.PrepareStreams();
+	for (const auto& option : options) {
+		if ((option.stream == VIDEO_STREAM) == video)
+			writer.SetOption(option.stream, option.name, option.value);
+	}
+}
+
+// Find the ranges of the timeline which can be copied from their source files
+std::vector<SegmentedWriter::Piece> SegmentedWriter::find_passthrough(Timeline* timeline, int64_t start, int64_t end) const {
+	std::vector<Piece> pieces;
+	const AVCodec *encoder = avcodec_find_encoder_by_name(video_codec.c_str());
+	const Fraction timeline_fps = timeline->info.fps;
+	if (!encoder || timeline_fps.num * fps.den != fps.num * timeline_fps.den ||
+		timeline->info.width != width || timeline->info.height != height)
+		return pieces;
+	const double frames_per_second = fps.ToDouble();
+
+	// The frames covered by each clip with an image (and by each timeline effect)
+	struct Interval {
+		int64_t first;
+		int64_t last;
+		Clip* clip;
+	};
+	std::vector<Interval> covered;
+	for (auto clip : timeline->Clips()) {
+		if (!clip->Reader() || !clip->Reader()->info.has_video || is_constant(clip->has_video, 0.0))
+			continue;
+		const int64_t first = std::llround(clip->Position() * frames_per_second) + 1;
+		covered.push_back({first, first + std::llround(clip->Duration() * frames_per_second) - 1, clip});
+	}
+	for (auto effect : timeline->Effects()) {
+		const int64_t first = std::llround(effect->Position() * frames_per_second) + 1;
+		covered.push_back({first, first + std::llround(effect->Duration() * frames_per_second) - 1, NULL});
+	}
+
+	for (const auto& candidate : covered) {
+		if (!candidate.clip || !passthrough_clip(candidate.clip))
+			continue;
+
+		// The source file (behind the frame mapper, if any)
+		ReaderBase *reader = candidate.clip->Reader();
+		if (reader->Name() == "FrameMapper")
+			reader = static_cast<FrameMapper*>(reader)->Reader();
+		if (!reader || reader->Name() != "FFmpegReader" || reader->info.width != width || reader->info.height != height)
+			continue;
+		const std::string source = reader->JsonValue()["path"].asString();
+		const int64_t source_offset = std::llround(candidate.clip->Start() * frames_per_second) + 1 - candidate.first;
+
+		// Remove the frames covered by anything else
+		std::vector<std::pair<int64_t, int64_t>> ranges = {{std::max(candidate.first, start), std::min(candidate.last, end)}};
+		for (const auto& other : covered) {
+			if (&other == &candidate)
+				continue;
+			std::vector<std::pair<int64_t, int64_t>> remaining;
+			for (const auto& range : ranges) {
+				if (other.last < range.first || other.first > range.second) {
+					remaining.push_back(range);
+					continue;
+				}
+				if (other.first > range.first)
+					remaining.push_back({range.first, other.first - 1});
+				if (other.last < range.second)
+					remaining.push_back({other.last + 1, range.second});
+			}
+			ranges.swap(remaining);
+		}
+
+		// Start each range at a key frame of the source (the frames before it are encoded)
+		for (const auto& range : ranges) {
+			if (range.first > range.second)
+				continue;
+			const int64_t source_first = range.first + source_offset;
+			const int64_t key_frame = find_key_frame(source, source_first, range.second + source_offset, encoder->id, fps, width, height);
+			if (key_frame < source_first)
+				continue;
+			pieces.push_back({range.first + (key_frame - source_first), range.second, source, key_frame, ""});
+		}
+	}
+
+	std::sort(pieces.begin(), pieces.end(), [](const Piece& a, const Piece& b) { return a.first < b.first; });
+	return pieces;
+}
+
+// Copy the packets of a range of frames from the source file into a temporary file
+void SegmentedWriter::copy_piece(const Piece& piece) {
+	ConcatInput input;
+	open_input(piece.source, input, true);
+	const AVRational frame_duration = av_make_q(fps.den, fps.num);
+	const int64_t source_last = piece.source_first + (piece.last - piece.first);
+
+	AVFormatContext *output = NULL;
+	avformat_alloc_output_context2(&output, NULL, NULL, piece.part.c_str());
+	AVPacket *packet = av_packet_alloc();
+	auto cleanup = [&]() {
+		close_input(input);
+		av_packet_free(&packet);
+		if (output) {
+			if (!(output->oformat->flags & AVFMT_NOFILE))
+				avio_closep(&output->pb);
+			avformat_free_context(output);
+		}
+	};
+
+	try {
+		AVStream *stream = output ? add_output_stream(output, input.stream) : NULL;
+		if (!stream || !packet)
+			throw InvalidFormat("Could not create the segment file.", piece.part);
+		if (!(output->oformat->flags & AVFMT_NOFILE) && avio_open(&output->pb, piece.part.c_str(), AVIO_FLAG_WRITE) < 0)
+			throw InvalidFile("Could not open the segment file.", piece.part);
+		if (avformat_write_header(output, NULL) < 0)
+			throw InvalidFile("Could not write the header of the segment file.", piece.part);
+
+		// Copy the frames (in order, since the source has no B-frames), starting at 0
+		seek_source(input, piece.source_first, frame_duration);
+		while (av_read_frame(input.context, packet) >= 0) {
+			if (packet->stream_index != input.stream->index || packet_time(packet) == AV_NOPTS_VALUE) {
+				av_packet_unref(packet);
+				continue;
+			}
+			const int64_t number = packet_frame(packet, input.stream, frame_duration);
+			if (number > source_last) {
+				av_packet_unref(packet);
+				break;
+			}
+			if (number < piece.source_first) {
+				av_packet_unref(packet);
+				continue;
+			}
+
+			packet->pts = packet->dts = av_rescale_q(number - piece.source_first, frame_duration, stream->time_base);
+			packet->duration = av_rescale_q(1, frame_duration, stream->time_base);
+			packet->stream_index = stream->index;
+			packet->pos = -1;
+			if (av_interleaved_write_frame(output, packet) < 0)
+				throw InvalidFile("Could not write a packet to the segment file.", piece.part);
+			frames_written++;
+		}
+
+		if (av_write_trailer(output) < 0)
+			throw InvalidFile("Could not write the trailer of the segment file.", piece.part);
+	} catch (...) {
+		cleanup();
+		throw;
+	}
+	cleanup();
+}
+
+// Export a range of frames of a timeline
+void SegmentedWriter::WriteTimeline(Timeline* timeline, int64_t start, int64_t end) {
+	if (!timeline || end < start || (!has_video && !has_audio))
+		return;
+
+	// Each segment (and the audio) renders with its own copy of the timeline
+	const std::string project = timeline->Json();
+	const ReaderInfo timeline_info = timeline->info;
+	const int64_t frame_count = end - start + 1;
+
+	// Find the ranges to copy, and split the frames in between into segments (of up to
+	// 1/segments of the frames, so the encoders share the processors)
+	std::vector<Piece> pieces;
+	if (has_video) {
+		std::vector<Piece> copied;
+		if (passthrough)
+			copied = find_passthrough(timeline, start, end);
+
+		// Each encoder starts with a key frame, so the segments start at multiples of the GOP size
+		const int64_t gop = gop_size();
+		const int64_t segment_length = ((frame_count + segments - 1) / segments + gop - 1) / gop * gop;
+		auto add_encoded = [&](int64_t first, int64_t last) {
+			for (int64_t piece_first = first; piece_first <= last; piece_first += segment_length)
+				pieces.push_back({piece_first, std::min(last, piece_first + segment_length - 1), "", 0, ""});
+		};
+		int64_t next_frame = start;
+		for (const auto& piece : copied) {
+			if (piece.first > next_frame)
+				add_encoded(next_frame, piece.first - 1);
+			pieces.push_back(piece);
+			next_frame = piece.last + 1;
+		}
+		if (next_frame <= end)
+			add_encoded(next_frame, end);
+
+		for (size_t index = 0; index < pieces.size(); index++)
+			pieces[index].part = part_path("part" + std::to_string(index + 1));
+	}
+	const std::string audio_part = has_audio ? part_path("audio") : "";
+
+	frames_written = 0;
+	total_frames = frame_count * ((has_video ? 1 : 0) + (has_audio ? 1 : 0));
+
+	// Run a list of jobs on a pool of threads (the first exception stops the other jobs)
+	std::mutex error_mutex;
+	std::exception_ptr error = nullptr;
+	std::atomic<bool> failed(false);
+	auto run_jobs = [&](const std::vector<std::function<void()>>& jobs) {
+		std::atomic<size_t> next_job(0);
+		std::vector<std::thread> workers;
+		const size_t count = std::min<size_t>(jobs.size(), segments + (has_audio ? 1 : 0));
+		for (size_t x = 0; x < count; x++) {
+			workers.emplace_back([&]() {
+				size_t job;
+				while (!failed && (job = next_job++) < jobs.size()) {
+					try {
+						jobs[job]();
+					} catch (...) {
+						const std::lock_guard<std::mutex> lock(error_mutex);
+						if (!error)
+							error = std::current_exception();
+						failed = true;
+					}
+				}
+			});
+		}
+		for (auto& worker : workers)
+			worker.join();
+	};
+
+	// Write a range of frames (with one copy of the timeline)
+	auto write_range = [&](const std::string& part, bool video, int64_t first, int64_t last) {
+		Timeline copy(timeline_info);
+		copy.SetJson(project);
+		if (!video)
+			copy.AudioOnly(true);
+		copy.Open();
+		WriteSegment(&copy, part, video, first, last, failed);
+		copy.Close();
+	};
+	auto piece_job = [&](const Piece& piece) -> std::function<void()> {
+		const Piece *target = &piece;
+		if (!piece.source.empty())
+			return [this, target]() { copy_piece(*target); };
+		return [&write_range, target]() { write_range(target->part, true, target->first, target->last); };
+	};
+
+	// Encode the audio for the whole range (first, since it takes the longest), and the video pieces
+	// (on the render farm, if any, while the copied pieces are copied locally)
+	std::vector<std::function<void()>> jobs;
+	std::vector<RenderJob> farm_jobs;
+	const bool farm = !farm_endpoint.empty();
+	if (has_audio && farm)
+		farm_jobs.push_back({audio_part, false, start, end});
+	else if (has_audio)
+		jobs.push_back([&]() { write_range(audio_part, false, start, end); });
+	for (const auto& piece : pieces) {
+		if (farm && piece.source.empty())
+			farm_jobs.push_back({piece.part, true, piece.first, piece.last});
+		else
+			jobs.push_back(piece_job(piece));
+	}
+	std::thread local_jobs([&]() { run_jobs(jobs); });
+	if (!farm_jobs.empty()) {
+		try {
+			RenderCoordinator coordinator(farm_endpoint, farm_retries, farm_timeout_ms);
+			coordinator.Run(project, timeline_info, JsonValue(), farm_jobs, frames_written, failed);
+		} catch (...) {
+			const std::lock_guard<std::mutex> lock(error_mutex);
+			if (!error)
+				error = std::current_exception();
+			failed = true;
+		}
+	}
+	local_jobs.join();
+
+	// Encode the copied pieces which don't match the encoded pieces (the output
+	// file has one set of codec parameters)
+	if (!error && passthrough && !pieces.empty()) {
+		try {
+			auto reference = std::find_if(pieces.begin(), pieces.end(), [](const Piece& piece) { return piece.source.empty(); });
+			if (reference == pieces.end())
+				reference = pieces.begin();
+			ConcatInput reference_input;
+			open_input(reference->part, reference_input);
+
+			jobs.clear();
+			for (auto& piece : pieces) {
+				if (piece.source.empty() || &piece == &(*reference))
+					continue;
+				ConcatInput input;
+				open_input(piece.part, input);
+				const bool matches = same_parameters(input.stream->codecpar, reference_input.stream->codecpar);
+				close_input(input);
+				if (!matches) {
+					piece.source.clear();
+					frames_written -= piece.last - piece.first + 1;
+					jobs.push_back(piece_job(piece));
+				}
+			}
+			close_input(reference_input);
+		} catch (...) {
+			error = std::current_exception();
+		}
+		if (!error)
+			run_jobs(jobs);
+	}
+
+	// Join the segments into the output file
+	if (!error) {
+		try {
+			std::vector<std::string> video_parts;
+			std::vector<int64_t> part_offsets;
+			for (const auto& piece : pieces) {
+				video_parts.push_back(piece.part);
+				part_offsets.push_back(piece.first - start);
+			}
+			concatenate(video_parts, part_offsets, audio_part);
+		} catch (...) {
+			error = std::current_exception();
+		}
+	}
+
+	// Remove the temporary files
+	for (const auto& piece : pieces)
+		std::remove(piece.part.c_str());
+	if (has_audio)
+		std::remove(audio_part.c_str());
+
+	if (error)
+		std::rethrow_exception(error);
+}
+
+// Render and encode a range of frames of a timeline into a single segment file
+void SegmentedWriter::WriteSegment(Timeline* timeline, const std::string& part, bool video, int64_t first, int64_t last, const std::atomic<bool>& cancel) {
+	FFmpegWriter writer(part);
+	configure_writer(writer, video);
+	writer.Open();
+	for (int64_t number = first; number <= last && !cancel; number++) {
+		writer.WriteFrame(timeline->GetFrame(number));
+		frames_written++;
+	}
+	writer.Close();
+}
+
+// Copy the packets of the video segments and the audio into the output file
+void SegmentedWriter::concatenate(const std::vector<std::string>& video_parts, const std::vector<int64_t>& part_offsets, const std::string& audio_part) {
+	AVFormatContext *output = NULL;
+	avformat_alloc_output_context2(&output, NULL, NULL, path.c_str());
+	if (!output)
+		throw InvalidFormat("Could not deduce the output format from the file extension.", path);
+
+	ConcatInput video;
+	ConcatInput audio;
+	AVStream *video_out = NULL;
+	AVStream *audio_out = NULL;
+	AVPacket *video_packet = av_packet_alloc();
+	AVPacket *audio_packet = av_packet_alloc();
+	size_t part = 0;
+
+	// Release everything (on success, or before rethrowing an exception)
+	auto cleanup = [&]() {
+		close_input(video);
+		close_input(audio);
+		av_packet_free(&video_packet);
+		av_packet_free(&audio_packet);
+		if (!(output->oformat->flags & AVFMT_NOFILE))
+			avio_closep(&output->pb);
+		avformat_free_context(output);
+	};
+
+	// Read the next video packet (from the current segment, or the next one)
+	auto read_video = [&]() -> bool {
+		while (video.context) {
+			if (av_read_frame(video.context, video_packet) >= 0) {
+				if (video_packet->stream_index != video.stream->index) {
+					av_packet_unref(video_packet);
+					continue;
+				}
+
+				// Shift the segment to its start time (in the output file)
+				av_packet_rescale_ts(video_packet, video.stream->time_base, video_out->time_base);
+				const int64_t offset = av_rescale_q(part_offsets[part], av_make_q(fps.den, fps.num), video_out->time_base);
+				if (video_packet->pts != AV_NOPTS_VALUE)
+					video_packet->pts += offset;
+				if (video_packet->dts != AV_NOPTS_VALUE)
+					video_packet->dts += offset;
+				video_packet->stream_index = video_out->index;
+				video_packet->pos = -1;
+				return true;
+			}
+
+			// Continue with the next segment
+			close_input(video);
+			if (++part < video_parts.size())
+				open_input(video_parts[part], video);
+		}
+		return false;
+	};
+
+	// Read the next audio packet
+	auto read_audio = [&]() -> bool {
+		while (audio.context && av_read_frame(audio.context, audio_packet) >= 0) {
+			if (audio_packet->stream_index != audio.stream->index) {
+				av_packet_unref(audio_packet);
+				continue;
+			}
+			av_packet_rescale_ts(audio_packet, audio.stream->time_base, audio_out->time_base);
+			audio_packet->stream_index = audio_out->index;
+			audio_packet->pos = -1;
+			return true;
+		}
+		close_input(audio);
+		return false;
+	};
+
+	try {
+		if (!video_packet || !audio_packet)
+			throw OutOfMemory("Could not allocate AVPacket.", path);
+
+		// Create the output streams (from the first segment, and the audio)
+		if (!video_parts.empty()) {
+			open_input(video_parts.front(), video);
+			if (!(video_out = add_output_stream(output, video.stream)))
+				throw InvalidCodec("Could not copy the video stream.", path);
+		}
+		if (!audio_part.empty()) {
+			open_input(audio_part, audio);
+			if (!(audio_out = add_output_stream(output, audio.stream)))
+				throw InvalidCodec("Could not copy the audio stream.", path);
+		}
+
+		// Write the header
+		if (!(output->oformat->flags & AVFMT_NOFILE) && avio_open(&output->pb, path.c_str(), AVIO_FLAG_WRITE) < 0)
+			throw InvalidFile("Could not open the output file.", path);
+		if (avformat_write_header(output, NULL) < 0)
+			throw InvalidFile("Could not write the header of the output file.", path);
+
+		// Interleave the video and audio packets (by time)
+		bool has_video_packet = video_out && read_video();
+		bool has_audio_packet = audio_out && read_audio();
+		while (has_video_packet || has_audio_packet) {
+			const bool write_video = has_video_packet && (!has_audio_packet ||
+				av_compare_ts(packet_time(video_packet), video_out->time_base,
+							  packet_time(audio_packet), audio_out->time_base) <= 0);
+
+			int result = 0;
+			if (write_video) {
+				result = av_interleaved_write_frame(output, video_packet);
+				has_video_packet = read_video();
+			} else {
+				result = av_interleaved_write_frame(output, audio_packet);
+				has_audio_packet = read_audio();
+			}
+			if (result < 0)
+				throw InvalidFile("Could not write a packet to the output file (" + av_err2string(result) + ").", path);
+		}
+
+		if (av_write_trailer(output) < 0)
+			throw InvalidFile("Could not write the trailer of the output file.", path);
+	} catch (...) {
+		cleanup();
+		throw;
+	}
+	cleanup();
+}
@@ -0,0 +1,224 @@
+/**
+ * @file
+ * @brief Header file for SegmentedWriter class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_SEGMENTED_WRITER_H
+#define OPENSHOT_SEGMENTED_WRITER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ChannelLayouts.h"
+#include "FFmpegWriter.h"
+#include "Fraction.h"
+#include "Json.h"
+
+namespace openshot {
+
+	// Forward declaration
+	class Timeline;
+
+	/**
+	 * @brief This class exports a timeline with several independent encoders (one for each segment
+	 * of the timeline), and joins the segments into one file without re-encoding them.
+	 *
+	 * A single encoder can only use so many processors. For a long export, the timeline is split
+	 * into segments, and each segment is rendered (by its own copy of the timeline) and encoded
+	 * (by its own FFmpegWriter) on a separate thread. Each segment starts a new encoder, so it
+	 * always starts with a key frame. The audio is mixed and encoded once, for the whole range
+	 * (with an audio-only copy of the timeline), so there are no gaps at the joins. Finally, the
+	 * video segments and the audio are copied (without decoding) into the output file, and the
+	 * temporary files are removed.
+	 *
+	 * \code
+	 * SegmentedWriter w("NewVideo.mp4", 8);
+	 * w.SetVideoOptions(true, "libx264", Fraction(30,1), 1920, 1080, Fraction(1,1), false, false, 8000000);
+	 * w.SetAudioOptions(true, "aac", 48000, 2, LAYOUT_STEREO, 192000);
+	 * w.SetOption(VIDEO_STREAM, "crf", "20");
+	 *
+	 * // Export frames 1 to 9000 of the timeline
+	 * w.WriteTimeline(&timeline, 1, 9000);
+	 * \endcode
+	 *
+	 * With SetPassthrough(true), ranges of the timeline which only show one untransformed clip
+	 * (without effects) are copied from the source file, without decoding or encoding them, when
+	 * the source already matches the output (codec, size, frame rate and codec parameters). Only
+	 * the frames before the first key frame of each range are encoded. Sources with B-frames are
+	 * always encoded, and so is any copied range which turns out not to match the encoded ranges.
+	 * This mostly helps intra-only sources (i.e. ProRes, DNxHD or MJPEG), or sources which were
+	 * previously exported with the same settings.
+	 *
+	 * With SetFarm(), the encoded segments (and the audio) are rendered by RenderWorker processes
+	 * (on any machine which can reach the endpoint), instead of local threads. Each worker loads
+	 * the project JSON, renders and encodes the segments it is given, and the writer retries the
+	 * segments which fail (or whose worker stops responding) on other workers, before joining
+	 * them. The output folder and the project's media must be on storage shared by the workers.
+	 *
+	 * \code
+	 * // On each render node
+	 * RenderWorker worker("tcp://coordinator-host:5570");
+	 * worker.Run();
+	 *
+	 * // On the coordinator
+	 * w.SetFarm("tcp://*:5570");
+	 * w.WriteTimeline(&timeline, 1, 9000);
+	 * \endcode
+	 *
+	 * Segments start at multiples of the GOP size (the "g" video option), so the key frames of the
+	 * joined file keep the same cadence as a single encode.
+	 *
+	 * \note The same encoder settings are used for every segment, so the segments share the same
+	 * codec parameters. Rate control (i.e. bit rate targets) is per segment.
+	 */
+	class SegmentedWriter {
+	private:
+		/// A custom encoder option (see SetOption)
+		struct Option {
+			openshot::StreamType stream;
+			std::string name;
+			std::string value;
+		};
+
+		/// A range of frames of the output, which is encoded (or copied from a source file)
+		struct Piece {
+			int64_t first; ///< The first frame number (of the timeline)
+			int64_t last; ///< The last frame number (of the timeline)
+			std::string source; ///< The source file to copy from (or empty, to encode the frames)
+			int64_t source_first; ///< The first frame number of the source file (when copying)
+			std::string part; ///< The temporary file
+		};
+
+		std::string path;
+		int segments;
+		bool passthrough;
+
+		bool has_video;
+		std::string video_codec;
+		openshot::Fraction fps;
+		int width;
+		int height;
+		openshot::Fraction pixel_ratio;
+		bool interlaced;
+		bool top_field_first;
+		int video_bit_rate;
+
+		bool has_audio;
+		std::string audio_codec;
+		int sample_rate;
+		int channels;
+		openshot::ChannelLayout channel_layout;
+		int audio_bit_rate;
+
+		std::vector<Option> options;
+
+		std::string farm_endpoint;
+		int farm_retries;
+		int farm_timeout_ms;
+
+		std::atomic<int64_t> frames_written;
+		std::atomic<int64_t> total_frames;
+
+		/// Get the path of a temporary file (next to the output file, with the same extension)
+		std::string part_path(const std::string& name) const;
+
+		/// Get the GOP size of the video encoder (the "g" option, or the FFmpegWriter default)
+		int64_t gop_size() const;
+
+		/// Set the options of a segment writer (with only the video, or only the audio stream)
+		void configure_writer(openshot::FFmpegWriter& writer, bool video) const;
+
+		/// Find the ranges of the timeline which can be copied from their source files
+		std::vector<Piece> find_passthrough(openshot::Timeline* timeline, int64_t start, int64_t end) const;
+
+		/// Copy the packets of a range of frames from the source file into a temporary file
+		void copy_piece(const Piece& piece);
+
+		/// Copy the packets of the video segments and the audio into the output file
+		void concatenate(const std::vector<std::string>& video_parts, const std::vector<int64_t>& part_offsets, const std::string& audio_part);
+
+	public:
+		/// @brief Constructor for SegmentedWriter
+		/// @param path The path of the output file
+		/// @param segments The number of segments (i.e. the number of processors)
+		SegmentedWriter(const std::string& path, int segments=4);
+
+		/// Get the number of segments
+		int GetSegments() const { return segments; };
+
+		/// @brief Set the number of segments (encoded in parallel)
+		/// @param new_segments The number of segments (at least 1)
+		void SetSegments(int new_segments) { segments = (new_segments < 1) ? 1 : new_segments; };
+
+		/// Determine if unmodified ranges are copied from their source files
+		bool GetPassthrough() const { return passthrough; };
+
+		/// @brief Copy unmodified ranges from their source files, instead of encoding them
+		/// @param enabled True to copy the ranges which match the output
+		void SetPassthrough(bool enabled) { passthrough = enabled; };
+
+		/// Get the endpoint of the render farm (or empty, when segments are rendered locally)
+		std::string GetFarm() const { return farm_endpoint; };
+
+		/// @brief Render the segments on RenderWorker processes, instead of local threads
+		/// @param endpoint The ZeroMQ endpoint the workers connect to (i.e. "tcp://*:5570"), or empty to render locally
+		/// @param retries The number of times a failed segment is retried (on any worker)
+		/// @param timeout_ms The milliseconds without progress after which a worker's segment is retried
+		void SetFarm(const std::string& endpoint, int retries=2, int timeout_ms=60000);
+
+		/// @brief Set video export options (see FFmpegWriter::SetVideoOptions)
+		void SetVideoOptions(bool has_video, std::string codec, openshot::Fraction fps, int width, int height, openshot::Fraction pixel_ratio, bool interlaced, bool top_field_first, int bit_rate);
+
+		/// @brief Set audio export options (see FFmpegWriter::SetAudioOptions)
+		void SetAudioOptions(bool has_audio, std::string codec, int sample_rate, int channels, openshot::ChannelLayout channel_layout, int bit_rate);
+
+		/// @brief Set a custom encoder option, for every segment (see FFmpegWriter::SetOption)
+		/// @param stream The stream (openshot::StreamType) this option should apply to
+		/// @param name The name of the option you want to set (i.e. qmin, qmax, etc...)
+		/// @param value The new value of this option
+		void SetOption(openshot::StreamType stream, std::string name, std::string value);
+
+		/// @brief Export a range of frames of a timeline (and wait for the export to finish)
+		///
+		/// The timeline itself is not used while exporting (each segment renders with a copy of it).
+		///
+		/// @param timeline The timeline to export
+		/// @param start The first frame number to export
+		/// @param end The last frame number to export
+		void WriteTimeline(openshot::Timeline* timeline, int64_t start, int64_t end);
+
+		/// @brief Render and encode a range of frames of a timeline into a single segment file
+		///
+		/// This is used for each encoded segment (and for the audio), on local threads or on a RenderWorker.
+		///
+		/// @param timeline The timeline to render (which must be open)
+		/// @param part The path of the segment file
+		/// @param video True to encode the video stream, false to encode the audio stream
+		/// @param first The first frame number to encode
+		/// @param last The last frame number to encode
+		/// @param cancel Stops encoding when set (leaving an incomplete segment file)
+		void WriteSegment(openshot::Timeline* timeline, const std::string& part, bool video, int64_t first, int64_t last, const std::atomic<bool>& cancel);
+
+		/// Get the progress of the export (from 0.0 to 1.0)
+		float Progress() const;
+
+		/// Get the number of frames which were encoded (or copied) so far
+		int64_t FramesWritten() const { return frames_written; };
+
+		// Get and Set JSON methods (of the export settings)
+		Json::Value JsonValue() const; ///< Generate Json::Value for this object
+		void SetJsonValue(const Json::Value root); ///< Load Json::Value into this object
+	};
+
+}
+
+#endif
@@ -33,17 +33,35 @@ Settings *Settings::Instance()
 		m_pInstance->DE_LIMIT_WIDTH_MAX = 1950;
 		m_pInstance->HW_DE_DEVICE_SET = 0;
 		m_pInstance->HW_EN_DEVICE_SET = 0;
+		m_pInstance->HW_DEVICE_POLICY = 0;
+		m_pInstance->HW_DEVICE_COUNT = 0;
+		m_pInstance->HW_DE_MAX_SESSIONS = 0;
+		m_pInstance->HW_EN_MAX_SESSIONS = 0;
+		m_pInstance->NUMA_NODE = -1;
+		m_pInstance->NUMA_LOCAL_BUFFERS = false;
+		m_pInstance->OPENCV_USE_OPENCL = false;
+		m_pInstance->GPU_COMPOSITING = false;
 		m_pInstance->VIDEO_CACHE_PERCENT_AHEAD = 0.7;
 		m_pInstance->VIDEO_CACHE_MIN_PREROLL_FRAMES = 24;
 		m_pInstance->VIDEO_CACHE_MAX_PREROLL_FRAMES = 48;
 		m_pInstance->VIDEO_CACHE_MAX_FRAMES = 30 * 10;
+		m_pInstance->VIDEO_CACHE_THREADS = 4;
 		m_pInstance->ENABLE_PLAYBACK_CACHING = true;
+		m_pInstance->CACHE_DISK_WRITE_BEHIND_FRAMES = 8;
+		m_pInstance->RENDER_CACHE_PATH = "";
+		m_pInstance->CALIBRATION_PATH = "";
+		m_pInstance->ENABLE_AUTO_TUNING = false;
+		m_pInstance->RENDER_CACHE_MB = 4096;
+		m_pInstance->RENDER_CACHE_TIMELINE_FRAMES = false;
 		m_pInstance->PLAYBACK_AUDIO_DEVICE_NAME = "";
 		m_pInstance->PLAYBACK_AUDIO_DEVICE_TYPE = "";
+		m_pInstance->PLAYBACK_AUDIO_BUFFER_SIZE = 0;
+		m_pInstance->AUDIO_RESAMPLE_QUALITY = 1;
 		m_pInstance->DEBUG_TO_STDERR = false;
 		auto env_debug = std::getenv("LIBOPENSHOT_DEBUG");
 		if (env_debug != nullptr)
 			m_pInstance->DEBUG_TO_STDERR = true;
+		m_pInstance->HEADLESS = (std::getenv("LIBOPENSHOT_HEADLESS") != nullptr);
 	}
 
 	return m_pInstance;
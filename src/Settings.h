@@ -13,6 +13,7 @@
 #ifndef OPENSHOT_SETTINGS_H
 #define OPENSHOT_SETTINGS_H
 
+#include <cstdint>
 #include <string>
 
 namespace openshot {
@@ -82,6 +83,36 @@ namespace openshot {
 		/// Which GPU to use to encode (0 is the first)
 		int HW_EN_DEVICE_SET = 0;
 
+		/**
+		 * @brief How the hardware decoders and encoders are assigned to the GPUs (see HardwareDevices)
+		 *
+		 * 0 - The GPU of HW_DE_DEVICE_SET (and HW_EN_DEVICE_SET),
+		 * 1 - Round-robin (each reader or writer uses the next GPU in turn),
+		 * 2 - Least-loaded (each reader or writer uses the GPU with the fewest sessions)
+		 */
+		int HW_DEVICE_POLICY = 0;
+
+		/// Number of GPUs to spread the hardware decoders and encoders over (0 = all GPUs found)
+		int HW_DEVICE_COUNT = 0;
+
+		/// Max hardware decoders per GPU, after which readers decode in software (0 = unlimited)
+		int HW_DE_MAX_SESSIONS = 0;
+
+		/// Max hardware encoders per GPU, after which writers encode in software (0 = unlimited)
+		int HW_EN_MAX_SESSIONS = 0;
+
+		/// NUMA node to pin the render threads to (-1 = any core). The TaskExecutor workers, and the decoder,
+		/// encoder and muxing threads of the readers and writers, run on the cores of this node (see ThreadAffinity)
+		int NUMA_NODE = -1;
+
+		/// Keep the idle image buffers of each NUMA node apart, and hand out the buffers of the caller's node
+		/// (see ImageBufferPool)
+		bool NUMA_LOCAL_BUFFERS = false;
+
+		/// Run the OpenCV effects and analysis (stabilization warps, optical flow, feature detection and object
+		/// detection) on the GPU with OpenCL, through OpenCV's transparent API (when OpenCV has an OpenCL device)
+		bool OPENCV_USE_OPENCL = false;
+
 		/// Percentage of cache in front of the playhead (0.0 to 1.0)
 		float VIDEO_CACHE_PERCENT_AHEAD = 0.7;
 
@@ -94,15 +125,162 @@ namespace openshot {
 		/// Max number of frames (when paused) to cache for playback
 		int VIDEO_CACHE_MAX_FRAMES = 30 * 10;
 
+		/// Number of threads which render frames ahead of the playhead (at the same time)
+		int VIDEO_CACHE_THREADS = 4;
+
+		/// Apply consecutive point-wise effects of a clip (Brightness, Saturation, Hue, Negate) in a single pass over the image
+		bool ENABLE_EFFECT_FUSION = true;
+
+		/// Render the clips of each timeline frame in parallel (one task per layer), and then composite them in layer order
+		bool ENABLE_PARALLEL_LAYERS = true;
+
+		/// Transform and composite the clips of each timeline frame on the GPU with OpenGL, including their last
+		/// point-wise effects (only when the GpuCompositor is available, see GpuCompositor::Initialize)
+		bool GPU_COMPOSITING = false;
+
+		/// Re-use the image of the previous timeline frame when none of its clips changed (i.e. a slideshow of still images)
+		bool ENABLE_STATIC_FRAME_REUSE = true;
+
+		/// Number of frames each FFmpegReader decodes ahead of sequential requests, on a background thread (0 = disabled)
+		int DECODE_AHEAD_FRAMES = 0;
+
+		/// Number of frames each FFmpegReader decodes at once when frames are requested backwards (i.e. reverse clips),
+		/// instead of seeking back for every frame. Chunks start after a key frame (if the seek index is loaded), and
+		/// the previous chunk is decoded on a background thread. (0 = disabled)
+		int REVERSE_DECODE_FRAMES = 30;
+
+		/// Number of frames each Timeline looks ahead for clips which start soon. These clips are opened, and their
+		/// first frames decoded, on a background thread, so playback doesn't stutter at clip boundaries (0 = disabled)
+		int CLIP_LOOK_AHEAD_FRAMES = 0;
+
+		/**
+		 * @brief How FFmpegReader threads its software video decoders
+		 *
+		 * Frame threading decodes the most frames per second, but delays each frame by one frame per thread
+		 * (which is slow when scrubbing, since every seek refills the threads). Slice threading has no delay.
+		 *
+		 * 0 - Automatic (slice threads while seeking, frame threads once frames are decoded in order),
+		 * 1 - Frame and slice threads (FFmpeg's default),
+		 * 2 - Slice threads only
+		 */
+		int DECODER_THREAD_TYPE = 0;
+
+		/// Number of closed media files to keep open (with their decoders), so readers re-open them quickly, i.e.
+		/// when the timeline's playhead reaches a clip again (0 = disabled, see DecoderPool)
+		int DECODER_POOL_SIZE = 4;
+
+		/// Share the decoded frames between all the FFmpegReaders of the same file (i.e. clips which use the same file)
+		bool ENABLE_SOURCE_FRAME_CACHE = true;
+
+		/// Read media files with a background read-ahead thread (for files on network shares, i.e. NFS or SMB)
+		bool ENABLE_READ_AHEAD_IO = false;
+
+		/// Megabytes to read ahead of the demuxer, when ENABLE_READ_AHEAD_IO is enabled
+		int READ_AHEAD_MB = 16;
+
+		/// Directory of a local block cache for read-ahead files, i.e. on an SSD (empty = no block cache)
+		std::string READ_AHEAD_CACHE_PATH = "";
+
+		/// Re-use the probed info of unchanged files (by path, modification time and size), instead of probing them again
+		bool ENABLE_PROBE_CACHE = true;
+
+		/// File to keep the probe cache in between sessions, i.e. ~/.openshot_qt/probe-cache.json (empty = memory only)
+		std::string PROBE_CACHE_PATH = "";
+
+		/// Open files with a short stream analysis, and count the frames of files without a valid frame rate
+		/// or length on a background thread (instead of scanning the whole file while opening it)
+		bool ENABLE_FAST_PROBE = false;
+
+		/// Directory of the peak files of audio waveforms, i.e. ~/.openshot_qt/peaks (empty = decode the audio for
+		/// every waveform). Each audio source is decoded once, see AudioPeakFile and AudioWaveformer
+		std::string AUDIO_PEAK_PATH = "";
+
+		/// Quality of resampled audio (0 = draft, 1 = normal, 2 = high, see ResampleQuality): used for the speed
+		/// changes of time mapped clips (AudioResampler), and the sample rate conversion of FrameMapper
+		int AUDIO_RESAMPLE_QUALITY = 1;
+
+		/// Time each stage of rendering frames (see RenderStats and Timeline::GetRenderStats)
+		bool ENABLE_RENDER_STATS = false;
+
+		/// Send the render stats over the ZmqLogger every this many timeline frames (if both are enabled, 0 = never)
+		int RENDER_STATS_LOG_FRAMES = 100;
+
+		/// File to keep the calibrated thread counts and cache sizes of each machine, i.e. ~/.openshot_qt/calibration.json
+		/// (empty = not kept, see Calibration)
+		std::string CALIBRATION_PATH = "";
+
+		/// Adjust OMP_THREADS and FF_THREADS while rendering, from the measured stage times (needs ENABLE_RENDER_STATS,
+		/// see Calibration::Adjust)
+		bool ENABLE_AUTO_TUNING = false;
+
+		/// Keep this many recently used timeline frames uncompressed, and compress the images of older cached
+		/// timeline frames with LZ4, so more frames fit in the cache (0 = no compression)
+		int CACHE_COMPRESSED_HOT_FRAMES = 0;
+
+		/// Megabytes of frames held by all the memory caches together (0 = no limit, only the max bytes of each
+		/// cache). Buffers held by several caches are counted once, and the least recently used frames of all
+		/// caches are evicted once the limit is exceeded, see CacheBudget
+		int CACHE_BUDGET_MB = 0;
+
+		/// Reduce the memory caches while the process' cgroup uses more than 90% of its memory limit (Linux only)
+		bool CACHE_BUDGET_MEMORY_PRESSURE = false;
+
+		/// Decode sources with more than 8 bits per channel (i.e. 10-bit HEVC or ProRes) at 16 bits per channel, and
+		/// dither them down to the 8-bit frames (instead of truncating them), so smooth gradients don't band
+		bool HIGH_BIT_DEPTH = false;
+
+		/// Interpolate the frames of clips with a different frame rate than the timeline (i.e. 24 fps clips on a 60
+		/// fps timeline), instead of repeating or skipping frames, see PULLDOWN_INTERPOLATE
+		bool INTERPOLATE_FRAME_RATES = false;
+
+		/// Composite timeline frames of at least this many pixels into tiles (i.e. 7680 * 4320 for 8K and up, 0 =
+		/// disabled). Only the tiles covered by a clip are allocated, and the frame's image is only created from the
+		/// tiles when it is needed, see TiledImage
+		int64_t TILED_FRAME_MIN_PIXELS = 0;
+
+		/// Megabytes of decoded still images shared between the QtImageReaders of the same file (0 = no sharing)
+		int STILL_IMAGE_CACHE_MB = 256;
+
+		/// Frames which CacheDisk keeps in memory while a background thread encodes and writes them to disk (for the
+		/// PPM, JPG and PNG formats), so CacheDisk::Add doesn't wait for the disk (0 = write them while adding them)
+		int CACHE_DISK_WRITE_BEHIND_FRAMES = 8;
+
+		/// Directory of a persistent render cache, i.e. ~/.openshot_qt/render-cache (empty = disabled). The rendered
+		/// frames of clips are stored by a hash of everything they depend on, and re-used in later sessions (and by
+		/// other projects using the same clips), see RenderCache
+		std::string RENDER_CACHE_PATH = "";
+
+		/// Megabytes of frames kept in the render cache (the least recently used frames are deleted first, 0 = no limit)
+		int RENDER_CACHE_MB = 4096;
+
+		/// Also store the composited timeline frames in the render cache (not only the frames of each clip)
+		bool RENDER_CACHE_TIMELINE_FRAMES = false;
+
 		/// Enable/Disable the cache thread to pre-fetch and cache video frames before we need them
 		bool ENABLE_PLAYBACK_CACHING = true;
 
+		/// Render the frames of a Timeline at draft quality and at the scrub preview size (see SCRUB_PREVIEW_WIDTH)
+		/// while the QtPlayer's playhead is scrubbed faster than this many frames per second, and render the frame
+		/// at full quality once the playhead settles (0 = disabled)
+		int SCRUB_DRAFT_FPS = 0;
+
+		/// The max width and height of the frames rendered during fast scrubs (see SCRUB_DRAFT_FPS)
+		int SCRUB_PREVIEW_WIDTH = 320;
+		int SCRUB_PREVIEW_HEIGHT = 180;
+
+		/// Milliseconds without a seek after which a fast scrub has settled (and the frame is rendered at full quality)
+		int SCRUB_SETTLE_MS = 150;
+
 		/// The audio device name to use during playback
 		std::string PLAYBACK_AUDIO_DEVICE_NAME = "";
 
 		/// The device type for the playback audio devices
 		std::string PLAYBACK_AUDIO_DEVICE_TYPE = "";
 
+		/// The buffer size of the playback audio device, in samples (0 = the device's default). Smaller buffers
+		/// lower the latency of monitoring, but leave the audio thread less time before a dropout.
+		int PLAYBACK_AUDIO_BUFFER_SIZE = 0;
+
 		/// The current install path of OpenShot (needs to be set when using Timeline(path), since certain
 		/// paths depend on the location of OpenShot transitions and files)
 		std::string PATH_OPENSHOT_INSTALL = "";
@@ -110,6 +288,12 @@ namespace openshot {
  		/// Whether to dump ZeroMQ debug messages to stderr
 		bool DEBUG_TO_STDERR = false;
 
+		/// Render-only process (i.e. export or thumbnail workers, or set the LIBOPENSHOT_HEADLESS environment
+		/// variable): the ZmqLogger never binds its socket (it only logs to stderr and its file), and no audio
+		/// device is opened for playback. Other heavy subsystems are always initialized on first use, see the
+		/// "init" times of RenderStats
+		bool HEADLESS = false;
+
 		/// Create or get an instance of this logger singleton (invoke the class with this method)
 		static Settings * Instance();
 	};
@@ -0,0 +1,198 @@
+/**
+ * @file
+ * @brief Source file for SharedMemoryReader class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "SharedMemoryReader.h"
+#include "Exceptions.h"
+#include "Frame.h"
+#include "SharedMemoryRing.h"
+#include "ZmqLogger.h"
+
+#include <QImage>
+
+using namespace openshot;
+
+namespace {
+	// The slot an image points into (released when the image is destroyed, or detached by a write)
+	struct SlotReference {
+		std::shared_ptr<SharedMemoryRing> ring;
+		int slot;
+	};
+
+	void release_slot(void *info)
+	{
+		SlotReference *reference = static_cast<SlotReference *>(info);
+		reference->ring->RemoveReference(reference->slot);
+		delete reference;
+	}
+}
+
+SharedMemoryReader::SharedMemoryReader(const std::string& key) : key(key), timeout_ms(30000) { }
+
+// Destructor
+SharedMemoryReader::~SharedMemoryReader()
+{
+	Close();
+}
+
+// Attach to the shared memory ring
+void SharedMemoryReader::Open()
+{
+	// Open reader if not already open
+	if (ring)
+		return;
+
+	ring = SharedMemoryRing::Attach(key);
+
+	// Update the info struct (from the writer's reader)
+	const SharedMemoryRingInfo& ring_info = ring->Info();
+	info.has_video = ring_info.has_video;
+	info.has_audio = ring_info.has_audio;
+	info.has_single_image = false;
+	info.width = ring_info.width;
+	info.height = ring_info.height;
+	info.fps = Fraction(ring_info.fps_num, ring_info.fps_den);
+	info.video_timebase = info.fps.Reciprocal();
+	info.pixel_ratio = Fraction(ring_info.pixel_ratio_num, ring_info.pixel_ratio_den);
+	Fraction size(info.width * info.pixel_ratio.num, info.height * info.pixel_ratio.den);
+	size.Reduce();
+	info.display_ratio = size;
+	info.sample_rate = ring_info.sample_rate;
+	info.channels = ring_info.channels;
+	info.channel_layout = (ChannelLayout) ring_info.channel_layout;
+	info.video_length = ring_info.video_length;
+	info.duration = float(info.video_length / info.fps.ToDouble());
+	info.vcodec = "raw";
+	info.acodec = "raw";
+
+	ZMQ_DEBUG(
+		"SharedMemoryReader::Open",
+		"slots", ring->SlotCount(),
+		"width", info.width,
+		"height", info.height);
+}
+
+// Close the reader
+void SharedMemoryReader::Close()
+{
+	// The returned frames hold the ring (until they are destroyed)
+	last_frame.reset();
+	ring.reset();
+}
+
+// Create a frame which points into a slot of the ring
+std::shared_ptr<Frame> SharedMemoryReader::frame_from_slot(int slot)
+{
+	SharedMemoryRing::SlotHeader *header = ring->Slot(slot);
+	const unsigned char *data = ring->SlotData(slot);
+	const int64_t image_bytes = header->has_image ? int64_t(header->bytes_per_line) * header->height : 0;
+
+	auto frame = std::make_shared<Frame>(header->number, info.width, info.height, "#000000", 0, info.channels);
+	frame->SetPixelRatio(header->pixel_ratio_num, header->pixel_ratio_den);
+	frame->SampleRate(header->sample_rate);
+	frame->ChannelsLayout((ChannelLayout) header->channel_layout);
+
+	// The (small) audio samples are copied
+	if (header->has_audio) {
+		const float *audio = reinterpret_cast<const float *>(data + image_bytes);
+		frame->ResizeAudio(header->channels, header->samples, header->sample_rate, (ChannelLayout) header->channel_layout);
+		for (int channel = 0; channel < header->channels; channel++)
+			frame->AddAudio(true, channel, 0, audio + int64_t(channel) * header->samples, header->samples, 1.0f);
+	}
+
+	// The image points into the slot (a read-only QImage copies its pixels before they are modified)
+	if (header->has_image) {
+		SlotReference *reference = new SlotReference{ring, slot};
+		ring->AddReference(slot);
+		frame->AddImage(std::make_shared<QImage>(
+			data, header->width, header->height, header->bytes_per_line,
+			QImage::Format_RGBA8888_Premultiplied, release_slot, reference));
+	}
+
+	// Release the reference of FindSlot (the image holds its own reference)
+	ring->RemoveReference(slot);
+	return frame;
+}
+
+// Get an openshot::Frame object for a specific frame number of this reader
+std::shared_ptr<Frame> SharedMemoryReader::GetFrame(int64_t requested_frame)
+{
+	// Check for open reader (or throw exception)
+	if (!ring)
+		throw ReaderClosed("The SharedMemoryReader is closed.  Call Open() before calling this method.", key);
+
+	// Only one frame is read at a time (the ring is read in order)
+	const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+
+	// The same frame can be requested more than once (i.e. by the clip and the timeline)
+	if (last_frame && last_frame->number == requested_frame)
+		return last_frame;
+
+	const int slot = ring->FindSlot(requested_frame, timeout_ms);
+	if (slot < 0)
+		throw OutOfBoundsFrame("The requested frame was not written to the shared memory ring.", requested_frame, info.video_length);
+
+	last_frame = frame_from_slot(slot);
+	return last_frame;
+}
+
+// Generate JSON string of this object
+std::string SharedMemoryReader::Json() const {
+
+	// Return formatted string
+	return JsonValue().toStyledString();
+}
+
+// Generate Json::Value for this object
+Json::Value SharedMemoryReader::JsonValue() const {
+
+	// Create root json object
+	Json::Value root = ReaderBase::JsonValue(); // get parent properties
+	root["type"] = "SharedMemoryReader";
+	root["key"] = key;
+
+	// return JsonValue
+	return root;
+}
+
+// Load JSON string into this object
+void SharedMemoryReader::SetJson(const std::string value) {
+
+	try
+	{
+		const Json::Value root = openshot::stringToJson(value);
+		// Set all values that match
+		SetJsonValue(root);
+	}
+	catch (const std::exception& e)
+	{
+		// Error parsing JSON (or missing keys)
+		throw InvalidJSON("JSON is invalid (missing keys or invalid data types)");
+	}
+}
+
+// Load Json::Value into this object
+void SharedMemoryReader::SetJsonValue(const Json::Value root) {
+
+	// Set parent data
+	ReaderBase::SetJsonValue(root);
+
+	// Set data from Json (if key is found)
+	if (!root["key"].isNull())
+		key = root["key"].asString();
+
+	// Re-attach to the ring (if needed)
+	if (ring)
+	{
+		Close();
+		Open();
+	}
+}
@@ -0,0 +1,97 @@
+/**
+ * @file
+ * @brief Header file for SharedMemoryReader class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_SHARED_MEMORY_READER_H
+#define OPENSHOT_SHARED_MEMORY_READER_H
+
+#include <memory>
+#include <string>
+
+#include "ReaderBase.h"
+
+namespace openshot
+{
+	class CacheMemory;
+	class SharedMemoryRing;
+
+	/**
+	 * @brief This class reads the frames which a SharedMemoryWriter (in another process) writes into a
+	 * ring of shared memory slots.
+	 *
+	 * The images of the frames point into the slots of the ring (the pixels are not copied, unless the
+	 * image is modified), and a slot is re-used by the writer once its frames are released. Frames are
+	 * read in order; requesting a frame which is not written yet waits for the writer (see SetTimeout()),
+	 * and the unread frames before a requested frame are skipped.
+	 *
+	 * @code
+	 * // Compositor process (the worker process writes frames with a SharedMemoryWriter)
+	 * SharedMemoryReader r("openshot-worker-1");
+	 * r.Open(); // Attach to the ring (which the writer must have created)
+	 * std::shared_ptr<Frame> f = r.GetFrame(1);
+	 * r.Close();
+	 * @endcode
+	 */
+	class SharedMemoryReader : public ReaderBase
+	{
+	private:
+		std::string key;
+		int timeout_ms;
+		std::shared_ptr<openshot::SharedMemoryRing> ring;
+		std::shared_ptr<openshot::Frame> last_frame;
+
+		/// Create a frame which points into a slot of the ring (holding a reference to the slot)
+		std::shared_ptr<openshot::Frame> frame_from_slot(int slot);
+
+	public:
+		/// @brief Constructor for SharedMemoryReader
+		/// @param key The key of the shared memory ring (see SharedMemoryWriter)
+		SharedMemoryReader(const std::string& key);
+
+		/// Destructor
+		virtual ~SharedMemoryReader();
+
+		/// Close the reader (frames which were already returned stay valid)
+		void Close() override;
+
+		/// Get the cache object used by this reader (always returns NULL for this reader)
+		CacheMemory* GetCache() override { return NULL; };
+
+		/// @brief Get an openshot::Frame object for a specific frame number of this reader (waiting for the
+		/// writer to write it)
+		///
+		/// @returns The requested frame (whose image points into the shared memory)
+		/// @param requested_frame The frame number that is requested
+		std::shared_ptr<openshot::Frame> GetFrame(int64_t requested_frame) override;
+
+		/// Determine if reader is open or closed
+		bool IsOpen() override { return ring != nullptr; };
+
+		/// Return the type name of the class
+		std::string Name() override { return "SharedMemoryReader"; };
+
+		/// @brief Set the max milliseconds to wait for a frame to be written (before throwing an exception)
+		/// @param milliseconds The timeout (in milliseconds)
+		void SetTimeout(int milliseconds) { timeout_ms = milliseconds; };
+
+		// Get and Set JSON methods
+		std::string Json() const override; ///< Generate JSON string of this object
+		void SetJson(const std::string value) override; ///< Load JSON string into this object
+		Json::Value JsonValue() const override; ///< Generate Json::Value for this object
+		void SetJsonValue(const Json::Value root) override; ///< Load Json::Value into this object
+
+		/// Attach to the shared memory ring
+		void Open() override;
+	};
+
+}
+
+#endif
@@ -0,0 +1,224 @@
+/**
+ * @file
+ * @brief Source file for SharedMemoryRing class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "SharedMemoryRing.h"
+#include "Exceptions.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <thread>
+
+using namespace openshot;
+
+// The atomics are shared between processes (which only works if they don't need a lock)
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "shared memory atomics must be lock free");
+static_assert(std::atomic<int32_t>::is_always_lock_free, "shared memory atomics must be lock free");
+
+static const uint32_t RING_MAGIC = 0x4f53524e; // "OSRN"
+static const uint32_t RING_VERSION = 1;
+static const int64_t CACHE_LINE_BYTES = 64;
+static const int64_t HEADER_BYTES = 4096; ///< The bytes before the first slot (the ring header, padded)
+static const int64_t SLOT_HEADER_BYTES = 128; ///< The bytes before the frame data of each slot (its header, padded)
+static_assert(sizeof(SharedMemoryRing::SlotHeader) <= SLOT_HEADER_BYTES, "slot header too large");
+
+// Get the state and the references of a slot's atomic value
+static uint32_t get_state(uint32_t value) { return value & 3; }
+static uint32_t get_references(uint32_t value) { return value >> 2; }
+static uint32_t make_state(uint32_t state, uint32_t references) { return (references << 2) | state; }
+
+// Wait a little (while polling the shared memory)
+static void wait_briefly()
+{
+	std::this_thread::sleep_for(std::chrono::microseconds(500));
+}
+
+// Open (or create) the shared memory segment
+SharedMemoryRing::SharedMemoryRing(const std::string& key) : segment(QString::fromStdString(key)), header(nullptr), write_position(0) { }
+
+// Create a new ring
+std::shared_ptr<SharedMemoryRing> SharedMemoryRing::Create(const std::string& key, const SharedMemoryRingInfo& info,
+														   int slot_count, int64_t slot_bytes)
+{
+	std::shared_ptr<SharedMemoryRing> ring(new SharedMemoryRing(key));
+	slot_count = std::max(slot_count, 2);
+	const int64_t data_bytes = (slot_bytes + CACHE_LINE_BYTES - 1) / CACHE_LINE_BYTES * CACHE_LINE_BYTES;
+	const int64_t total_bytes = HEADER_BYTES + slot_count * (SLOT_HEADER_BYTES + data_bytes);
+	if (total_bytes > INT32_MAX)
+		throw InvalidOptions("The shared memory ring is too large (use fewer slots, or smaller frames).", key);
+
+	// A segment of a writer which crashed is removed, when the last process detaches from it
+	if (!ring->segment.create((int) total_bytes)) {
+		if (ring->segment.error() == QSharedMemory::AlreadyExists && ring->segment.attach())
+			ring->segment.detach();
+		if (!ring->segment.create((int) total_bytes))
+			throw InvalidFile("Could not create the shared memory ring: " + ring->segment.errorString().toStdString(), key);
+	}
+
+	// Initialize the header and the slots (all free)
+	std::memset(ring->segment.data(), 0, HEADER_BYTES);
+	ring->header = new (ring->segment.data()) RingHeader;
+	ring->header->magic = RING_MAGIC;
+	ring->header->version = RING_VERSION;
+	ring->header->slot_count = slot_count;
+	ring->header->slot_bytes = data_bytes;
+	ring->header->info = info;
+	ring->header->closed.store(0);
+	for (int slot = 0; slot < slot_count; slot++) {
+		SlotHeader *slot_header = new (ring->Slot(slot)) SlotHeader;
+		slot_header->state.store(make_state(SLOT_FREE, 0));
+	}
+	return ring;
+}
+
+// Attach to an existing ring
+std::shared_ptr<SharedMemoryRing> SharedMemoryRing::Attach(const std::string& key)
+{
+	std::shared_ptr<SharedMemoryRing> ring(new SharedMemoryRing(key));
+	if (!ring->segment.attach(QSharedMemory::ReadWrite))
+		throw InvalidFile("Could not attach to the shared memory ring: " + ring->segment.errorString().toStdString(), key);
+
+	ring->header = static_cast<RingHeader *>(ring->segment.data());
+	if (ring->segment.size() < HEADER_BYTES || ring->header->magic != RING_MAGIC || ring->header->version != RING_VERSION)
+		throw InvalidFile("The shared memory segment is not a frame ring (or of another version).", key);
+	return ring;
+}
+
+// Detach from the shared memory segment
+SharedMemoryRing::~SharedMemoryRing()
+{
+	if (segment.isAttached())
+		segment.detach();
+}
+
+// Get the bytes of each slot
+int64_t SharedMemoryRing::slot_stride() const
+{
+	return SLOT_HEADER_BYTES + header->slot_bytes;
+}
+
+// Get the state of a slot
+std::atomic<uint32_t>& SharedMemoryRing::slot_state(int slot)
+{
+	return Slot(slot)->state;
+}
+
+// Get the header of a slot
+SharedMemoryRing::SlotHeader* SharedMemoryRing::Slot(int slot)
+{
+	unsigned char *base = static_cast<unsigned char *>(segment.data());
+	return reinterpret_cast<SlotHeader *>(base + HEADER_BYTES + slot * slot_stride());
+}
+
+// Get the pixels and audio samples of a slot
+unsigned char* SharedMemoryRing::SlotData(int slot)
+{
+	return reinterpret_cast<unsigned char *>(Slot(slot)) + SLOT_HEADER_BYTES;
+}
+
+// Wait for the next slot to be free, and start writing it
+int SharedMemoryRing::BeginWrite(int timeout_ms)
+{
+	const int slot = int(write_position % header->slot_count);
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+	uint32_t expected = make_state(SLOT_FREE, 0);
+	while (!slot_state(slot).compare_exchange_weak(expected, make_state(SLOT_WRITING, 0), std::memory_order_acquire)) {
+		expected = make_state(SLOT_FREE, 0);
+		if (std::chrono::steady_clock::now() >= deadline)
+			return -1;
+		wait_briefly();
+	}
+	write_position++;
+	return slot;
+}
+
+// Let the reader read a written slot
+void SharedMemoryRing::EndWrite(int slot)
+{
+	slot_state(slot).store(make_state(SLOT_READY, 0), std::memory_order_release);
+}
+
+// Find the slot of a frame, and add a reference to it
+int SharedMemoryRing::FindSlot(int64_t number, int timeout_ms)
+{
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+	while (true) {
+		// Check the closed flag first, so a frame written right before the ring was closed is still found
+		const bool closed = IsClosed();
+		bool full = true;
+		for (int slot = 0; slot < header->slot_count; slot++) {
+			std::atomic<uint32_t>& state = slot_state(slot);
+			uint32_t value = state.load(std::memory_order_acquire);
+			const uint32_t slot_state_value = get_state(value);
+			if (slot_state_value == SLOT_FREE || slot_state_value == SLOT_WRITING)
+				full = false;
+			if ((slot_state_value != SLOT_READY && slot_state_value != SLOT_READ) || Slot(slot)->number != number)
+				continue;
+
+			// Add a reference (unless the slot changed in the meantime)
+			if (!state.compare_exchange_strong(value, make_state(SLOT_READ, get_references(value) + 1), std::memory_order_acquire))
+				continue;
+
+			// The slot could have been re-used (with the same state) before the reference was added
+			if (Slot(slot)->number != number) {
+				RemoveReference(slot);
+				continue;
+			}
+			return slot;
+		}
+
+		if (closed || std::chrono::steady_clock::now() >= deadline)
+			return -1;
+
+		// Drop the unread frames before this frame (which were skipped), if they block the writer
+		if (full) {
+			for (int slot = 0; slot < header->slot_count; slot++) {
+				uint32_t ready = make_state(SLOT_READY, 0);
+				if (Slot(slot)->number < number)
+					slot_state(slot).compare_exchange_strong(ready, make_state(SLOT_FREE, 0), std::memory_order_acq_rel);
+			}
+		}
+		wait_briefly();
+	}
+}
+
+// Add a reference to a slot which was found
+void SharedMemoryRing::AddReference(int slot)
+{
+	slot_state(slot).fetch_add(make_state(0, 1), std::memory_order_acq_rel);
+}
+
+// Remove a reference to a slot
+void SharedMemoryRing::RemoveReference(int slot)
+{
+	std::atomic<uint32_t>& state = slot_state(slot);
+	uint32_t value = state.load(std::memory_order_acquire);
+	while (true) {
+		const uint32_t references = get_references(value) - 1;
+		const uint32_t new_value = references == 0 ? make_state(SLOT_FREE, 0) : make_state(SLOT_READ, references);
+		if (state.compare_exchange_weak(value, new_value, std::memory_order_acq_rel))
+			return;
+	}
+}
+
+// Mark the ring as closed
+void SharedMemoryRing::Close()
+{
+	header->closed.store(1, std::memory_order_release);
+}
+
+// Determine if the writer closed the ring
+bool SharedMemoryRing::IsClosed() const
+{
+	return header->closed.load(std::memory_order_acquire) != 0;
+}
@@ -0,0 +1,170 @@
+/**
+ * @file
+ * @brief Header file for SharedMemoryRing class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_SHARED_MEMORY_RING_H
+#define OPENSHOT_SHARED_MEMORY_RING_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <QSharedMemory>
+
+namespace openshot
+{
+	/**
+	 * @brief The stream info of the frames in a SharedMemoryRing (see SharedMemoryWriter)
+	 */
+	struct SharedMemoryRingInfo
+	{
+		int32_t has_video;
+		int32_t has_audio;
+		int32_t width;
+		int32_t height;
+		int32_t fps_num;
+		int32_t fps_den;
+		int32_t pixel_ratio_num;
+		int32_t pixel_ratio_den;
+		int32_t sample_rate;
+		int32_t channels;
+		int32_t channel_layout;
+		int64_t video_length;
+	};
+
+	/**
+	 * @brief This class is a ring of frame slots in a shared memory segment, which moves frames between
+	 * processes (i.e. from decode workers to a compositor process)
+	 *
+	 * A SharedMemoryWriter creates the ring, and copies each frame into a free slot. A SharedMemoryReader
+	 * attaches to the ring (by its key), and creates frames whose images point into the slots (without
+	 * copying the pixels). A slot is free again once the reader no longer holds any frame of it.
+	 *
+	 * The state and the reference count of each slot are a single atomic value in the shared memory, so
+	 * the processes only wait (poll) when the ring is full, or the frame they want is not written yet.
+	 * Only a single writer can write to a ring.
+	 */
+	class SharedMemoryRing
+	{
+	public:
+		/// The state of a slot (the lowest bits of its atomic state)
+		enum SlotState : uint32_t {
+			SLOT_FREE = 0,		///< The slot can be written
+			SLOT_WRITING = 1,	///< The writer is copying a frame into the slot
+			SLOT_READY = 2,		///< The slot holds a frame, which was not read yet
+			SLOT_READ = 3		///< The slot holds a frame, and the reader holds references to it
+		};
+
+		/// The description of the frame in a slot (followed by its pixels and audio samples)
+		struct SlotHeader {
+			std::atomic<uint32_t> state; ///< The SlotState (bits 0-1) and the number of references (the other bits)
+			int32_t width;
+			int32_t height;
+			int32_t bytes_per_line;
+			int32_t pixel_ratio_num;
+			int32_t pixel_ratio_den;
+			int32_t sample_rate;
+			int32_t channels;
+			int32_t channel_layout;
+			int32_t samples;
+			int32_t has_image;
+			int32_t has_audio;
+			int64_t number;
+		};
+
+	private:
+		/// The header of the shared memory segment
+		struct RingHeader {
+			uint32_t magic;
+			uint32_t version;
+			int32_t slot_count;
+			std::atomic<int32_t> closed; ///< The writer closed the ring (no more frames are written)
+			int64_t slot_bytes;
+			SharedMemoryRingInfo info;
+		};
+
+		QSharedMemory segment;
+		RingHeader *header;
+		int64_t write_position; ///< The next slot the writer uses (in order, so frames are kept in order)
+
+		/// Open (or create) the shared memory segment
+		SharedMemoryRing(const std::string& key);
+
+		/// Get the bytes of each slot (the header, and the frame data rounded up to a cache line)
+		int64_t slot_stride() const;
+
+		/// Get the state of a slot
+		std::atomic<uint32_t>& slot_state(int slot);
+
+	public:
+		/// @brief Create a new ring (replacing a stale segment with the same key, i.e. of a crashed writer)
+		/// @param key The key of the shared memory segment
+		/// @param info The stream info of the frames
+		/// @param slot_count The number of frame slots (at least 2)
+		/// @param slot_bytes The max bytes of the pixels and audio samples of a frame
+		static std::shared_ptr<SharedMemoryRing> Create(const std::string& key, const SharedMemoryRingInfo& info,
+													   int slot_count, int64_t slot_bytes);
+
+		/// @brief Attach to an existing ring
+		/// @param key The key of the shared memory segment
+		static std::shared_ptr<SharedMemoryRing> Attach(const std::string& key);
+
+		/// Detach from the shared memory segment (which is removed when the last process detaches)
+		~SharedMemoryRing();
+
+		/// Get the stream info of the frames
+		const SharedMemoryRingInfo& Info() const { return header->info; }
+
+		/// Get the number of slots
+		int SlotCount() const { return header->slot_count; }
+
+		/// Get the max bytes of the pixels and audio samples of a frame
+		int64_t SlotBytes() const { return header->slot_bytes; }
+
+		/// Get the header of a slot
+		SlotHeader* Slot(int slot);
+
+		/// Get the pixels and audio samples of a slot
+		unsigned char* SlotData(int slot);
+
+		/// @brief Wait for the next slot to be free, and start writing it (returns -1 on timeout)
+		/// @param timeout_ms The max milliseconds to wait
+		int BeginWrite(int timeout_ms);
+
+		/// Let the reader read a written slot
+		void EndWrite(int slot);
+
+		/// @brief Find the slot of a frame, and add a reference to it (returns -1 on timeout, or if the ring is
+		/// closed and the frame was never written)
+		///
+		/// Unread frames before the requested frame are dropped if the ring is full, so the writer is never
+		/// blocked by frames which the reader skipped.
+		/// @param number The frame number
+		/// @param timeout_ms The max milliseconds to wait for the frame to be written
+		int FindSlot(int64_t number, int timeout_ms);
+
+		/// Add a reference to a slot which was found (see FindSlot)
+		void AddReference(int slot);
+
+		/// Remove a reference to a slot (which is free again, once the last reference is removed)
+		void RemoveReference(int slot);
+
+		/// Mark the ring as closed (no more frames are written)
+		void Close();
+
+		/// Determine if the writer closed the ring
+		bool IsClosed() const;
+	};
+
+}
+
+#endif
@@ -0,0 +1,140 @@
+/**
+ * @file
+ * @brief Source file for SharedMemoryWriter class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "SharedMemoryWriter.h"
+#include "Exceptions.h"
+#include "Frame.h"
+#include "PixelKernels.h"
+#include "ReaderBase.h"
+#include "SharedMemoryRing.h"
+#include "ZmqLogger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace openshot;
+
+SharedMemoryWriter::SharedMemoryWriter(const std::string& key, ReaderBase* reader, int slot_count) :
+		key(key), slot_count(slot_count), timeout_ms(30000)
+{
+	// Copy info struct from the source reader
+	CopyReaderInfo(reader);
+}
+
+// Destructor
+SharedMemoryWriter::~SharedMemoryWriter()
+{
+	Close();
+}
+
+// Create the shared memory ring
+void SharedMemoryWriter::Open()
+{
+	if (ring)
+		return;
+
+	SharedMemoryRingInfo ring_info;
+	ring_info.has_video = info.has_video;
+	ring_info.has_audio = info.has_audio;
+	ring_info.width = info.width;
+	ring_info.height = info.height;
+	ring_info.fps_num = info.fps.num;
+	ring_info.fps_den = info.fps.den;
+	ring_info.pixel_ratio_num = info.pixel_ratio.num;
+	ring_info.pixel_ratio_den = info.pixel_ratio.den;
+	ring_info.sample_rate = info.sample_rate;
+	ring_info.channels = info.channels;
+	ring_info.channel_layout = info.channel_layout;
+	ring_info.video_length = info.video_length;
+
+	// Each slot holds the pixels of a full size frame, and the most audio samples of a frame (plus some slack)
+	const int64_t image_bytes = int64_t(std::max(info.width, 1)) * std::max(info.height, 1) * 4;
+	const int max_samples = int(std::ceil(info.sample_rate / std::max(info.fps.ToDouble(), 1.0))) + 16;
+	const int64_t audio_bytes = int64_t(max_samples) * std::max(info.channels, 0) * sizeof(float);
+	ring = SharedMemoryRing::Create(key, ring_info, slot_count, image_bytes + audio_bytes);
+
+	ZMQ_DEBUG(
+		"SharedMemoryWriter::Open",
+		"slots", ring->SlotCount(),
+		"slot_bytes", ring->SlotBytes());
+}
+
+// Close the ring
+void SharedMemoryWriter::Close()
+{
+	if (!ring)
+		return;
+
+	// The reader can still read the written frames (the segment is removed once it detaches)
+	ring->Close();
+	ring.reset();
+}
+
+// Copy a frame into the next free slot of the ring
+void SharedMemoryWriter::WriteFrame(std::shared_ptr<Frame> frame)
+{
+	// Check for open writer (or throw exception)
+	if (!ring)
+		throw WriterClosed("The SharedMemoryWriter is closed.  Call Open() before calling this method.", key);
+
+	// The pixels and samples of the frame (frame images are premultiplied RGBA8888, see Frame::AddImage)
+	std::shared_ptr<QImage> image;
+	if (frame->has_image_data) {
+		image = frame->GetImage();
+		if (image->format() != QImage::Format_RGBA8888_Premultiplied) {
+			image = std::make_shared<QImage>(*image);
+			PixelKernels::ToPremultipliedRGBA(*image);
+		}
+	}
+	const int channels = frame->has_audio_data ? frame->GetAudioChannelsCount() : 0;
+	const int samples = frame->has_audio_data ? frame->GetAudioSamplesCount() : 0;
+	const int64_t image_bytes = image ? int64_t(image->bytesPerLine()) * image->height() : 0;
+	const int64_t audio_bytes = int64_t(channels) * samples * sizeof(float);
+	if (image_bytes + audio_bytes > ring->SlotBytes())
+		throw InvalidOptions("The frame is larger than the slots of the shared memory ring.", key);
+
+	const int slot = ring->BeginWrite(timeout_ms);
+	if (slot < 0)
+		throw WriterClosed("Timed out waiting for a free slot of the shared memory ring (is the reader running?).", key);
+
+	// Describe the frame, and copy its pixels and samples
+	SharedMemoryRing::SlotHeader *header = ring->Slot(slot);
+	unsigned char *data = ring->SlotData(slot);
+	header->number = frame->number;
+	header->has_image = image != nullptr;
+	header->width = image ? image->width() : 0;
+	header->height = image ? image->height() : 0;
+	header->bytes_per_line = image ? image->bytesPerLine() : 0;
+	header->pixel_ratio_num = frame->GetPixelRatio().num;
+	header->pixel_ratio_den = frame->GetPixelRatio().den;
+	header->has_audio = frame->has_audio_data;
+	header->sample_rate = frame->SampleRate();
+	header->channels = channels;
+	header->channel_layout = frame->ChannelsLayout();
+	header->samples = samples;
+	if (image)
+		std::memcpy(data, image->constBits(), image_bytes);
+	float *audio = reinterpret_cast<float *>(data + image_bytes);
+	for (int channel = 0; channel < channels; channel++)
+		std::memcpy(audio + int64_t(channel) * samples, frame->GetAudioSamples(channel), samples * sizeof(float));
+
+	ring->EndWrite(slot);
+}
+
+// Write a block of frames from a reader
+void SharedMemoryWriter::WriteFrame(ReaderBase* reader, int64_t start, int64_t length)
+{
+	// Loop through each frame (and write it)
+	for (int64_t number = start; number <= length; number++)
+		WriteFrame(reader->GetFrame(number));
+}
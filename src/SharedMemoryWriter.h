@@ -0,0 +1,92 @@
+/**
+ * @file
+ * @brief Header file for SharedMemoryWriter class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_SHARED_MEMORY_WRITER_H
+#define OPENSHOT_SHARED_MEMORY_WRITER_H
+
+#include <memory>
+#include <string>
+
+#include "WriterBase.h"
+
+namespace openshot
+{
+	class SharedMemoryRing;
+
+	/**
+	 * @brief This class writes frames into a ring of shared memory slots, which a SharedMemoryReader (in
+	 * another process) reads them from, without encoding them or writing them to disk.
+	 *
+	 * This is used to split rendering into several processes, i.e. decode workers which feed a compositor
+	 * process. Each frame is copied into a free slot of the ring (waiting while the ring is full), and the
+	 * reader's frames point into the slots. The ring is created by Open(), with the size (and audio format)
+	 * of the reader passed to the constructor, and the reader can attach to it once it exists.
+	 *
+	 * @code
+	 * // Decode worker process
+	 * FFmpegReader r("MyAwesomeVideo.webm");
+	 * r.Open();
+	 * SharedMemoryWriter w("openshot-worker-1", &r);
+	 * w.Open();
+	 * w.WriteFrame(&r, 1, r.info.video_length);
+	 * w.Close();
+	 *
+	 * // Compositor process
+	 * SharedMemoryReader shared("openshot-worker-1");
+	 * Clip clip(&shared);
+	 * @endcode
+	 */
+	class SharedMemoryWriter : public WriterBase
+	{
+	private:
+		std::string key;
+		int slot_count;
+		int timeout_ms;
+		std::shared_ptr<openshot::SharedMemoryRing> ring;
+
+	public:
+		/// @brief Constructor for SharedMemoryWriter
+		/// @param key The key of the shared memory ring (which the SharedMemoryReader attaches to)
+		/// @param reader The reader to base the ring's frame size and audio format on
+		/// @param slot_count The number of frames the ring holds (at least 2)
+		SharedMemoryWriter(const std::string& key, openshot::ReaderBase* reader, int slot_count=8);
+
+		/// Destructor (closes the ring)
+		virtual ~SharedMemoryWriter();
+
+		/// Close the ring (the reader reads the frames left in the ring, then the ring is removed)
+		void Close();
+
+		/// Determine if writer is open or closed
+		bool IsOpen() { return ring != nullptr; };
+
+		/// Create the shared memory ring
+		void Open();
+
+		/// @brief Set the max milliseconds to wait for a free slot, when the ring is full (before throwing an exception)
+		/// @param milliseconds The timeout (in milliseconds)
+		void SetTimeout(int milliseconds) { timeout_ms = milliseconds; };
+
+		/// @brief Copy a frame into the next free slot of the ring
+		/// @param frame The openshot::Frame object to write (which must not be larger than the reader's frames)
+		void WriteFrame(std::shared_ptr<openshot::Frame> frame);
+
+		/// @brief Write a block of frames from a reader
+		/// @param reader The reader containing the frames you need
+		/// @param start The starting frame number to write
+		/// @param length The number of frames to write
+		void WriteFrame(openshot::ReaderBase* reader, int64_t start, int64_t length);
+	};
+
+}
+
+#endif
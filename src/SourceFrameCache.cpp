@@ -0,0 +1,67 @@
+/**
+ * @file
+ * @brief Source file for SourceFrameCache class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "SourceFrameCache.h"
+#include "Settings.h"
+
+using namespace openshot;
+
+// Global reference to the cache
+SourceFrameCache *SourceFrameCache::m_pInstance = nullptr;
+
+// Create or Get an instance of the cache singleton
+SourceFrameCache *SourceFrameCache::Instance()
+{
+	// Create the actual instance of the cache only once (readers are opened on many threads)
+	static std::once_flag created;
+	std::call_once(created, []() { m_pInstance = new SourceFrameCache; });
+
+	return m_pInstance;
+}
+
+// Get the shared cache of a file
+std::shared_ptr<CacheMemory> SourceFrameCache::Acquire(const std::string& path, int width, int height, int64_t max_frames, int sample_rate, int channels)
+{
+	if (!Settings::Instance()->ENABLE_SOURCE_FRAME_CACHE)
+		return nullptr;
+
+	const std::string key = path + '\n' + std::to_string(width) + 'x' + std::to_string(height);
+	const std::lock_guard<std::mutex> lock(cacheMutex);
+
+	// Forget the caches which are no longer held by any reader
+	for (auto entry = caches.begin(); entry != caches.end();) {
+		if (entry->second.expired())
+			entry = caches.erase(entry);
+		else
+			++entry;
+	}
+
+	std::shared_ptr<CacheMemory> cache = caches[key].lock();
+	if (!cache) {
+		cache = std::make_shared<CacheMemory>();
+		cache->SetMaxBytesFromInfo(max_frames, width, height, sample_rate, channels);
+		caches[key] = cache;
+	}
+	return cache;
+}
+
+// Get the number of shared caches
+int64_t SourceFrameCache::Count()
+{
+	const std::lock_guard<std::mutex> lock(cacheMutex);
+	int64_t count = 0;
+	for (const auto& entry : caches) {
+		if (!entry.second.expired())
+			count++;
+	}
+	return count;
+}
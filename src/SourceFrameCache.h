@@ -0,0 +1,73 @@
+/**
+ * @file
+ * @brief Header file for SourceFrameCache class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_SOURCE_FRAME_CACHE_H
+#define OPENSHOT_SOURCE_FRAME_CACHE_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "CacheMemory.h"
+
+namespace openshot {
+
+	/**
+	 * @brief This singleton class shares the decoded frames of a media file, between all the readers of that file
+	 *
+	 * Projects often use the same file on many clips, and each Clip has its own FFmpegReader (with its own
+	 * demuxer and decoder). Every reader adds the frames it decodes to a cache shared by all the open readers
+	 * of the same file (and image size), and checks that cache before decoding a frame itself. So a frame
+	 * which is shown by several clips at once (i.e. duplicated or overlapping clips, or transitions between
+	 * clips of the same file) is only decoded once. The shared cache is released when the last of its
+	 * readers is closed.
+	 *
+	 * Sharing can be disabled with Settings::ENABLE_SOURCE_FRAME_CACHE.
+	 */
+	class SourceFrameCache {
+	private:
+		std::mutex cacheMutex;
+		std::map<std::string, std::weak_ptr<CacheMemory>> caches; ///< Keyed by path and image size
+
+		/// Private variable to keep track of singleton instance
+		static SourceFrameCache *m_pInstance;
+
+		/// Default constructor
+		SourceFrameCache() = default;
+
+		/// Don't allow the user to copy or assign this instance
+		SourceFrameCache(SourceFrameCache const&) = delete;
+		SourceFrameCache & operator=(SourceFrameCache const&) = delete;
+
+	public:
+		/// Create or get an instance of this cache singleton (invoke the class with this method)
+		static SourceFrameCache *Instance();
+
+		/// @brief Get the shared cache of a file (created if needed, and kept while any reader holds it)
+		/// @returns nullptr if sharing is disabled
+		/// @param path The path of the file
+		/// @param width The width of the decoded images (0 for audio only frames)
+		/// @param height The height of the decoded images (0 for audio only frames)
+		/// @param max_frames The number of frames the cache holds
+		/// @param sample_rate The sample rate of the file (to size the cache)
+		/// @param channels The number of audio channels of the file (to size the cache)
+		std::shared_ptr<CacheMemory> Acquire(const std::string& path, int width, int height, int64_t max_frames, int sample_rate, int channels);
+
+		/// Get the number of shared caches (which are held by readers)
+		int64_t Count();
+	};
+
+}
+
+#endif
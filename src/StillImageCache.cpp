@@ -0,0 +1,127 @@
+/**
+ * @file
+ * @brief Source file for StillImageCache class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QImage>
+
+#include "StillImageCache.h"
+#include "Settings.h"
+
+using namespace openshot;
+
+// Global reference to the cache
+StillImageCache *StillImageCache::m_pInstance = nullptr;
+
+// Create or Get an instance of the cache singleton
+StillImageCache *StillImageCache::Instance()
+{
+	// Create the actual instance of the cache only once (readers are opened on many threads)
+	static std::once_flag created;
+	std::call_once(created, []() { m_pInstance = new StillImageCache; });
+
+	return m_pInstance;
+}
+
+// Get the key of an image
+std::string StillImageCache::image_key(const std::string& path, QSize size)
+{
+	QFileInfo file(QString::fromStdString(path));
+	if (!file.exists() || !file.isFile())
+		return "";
+
+	return path + '\n' + std::to_string(file.lastModified().toMSecsSinceEpoch()) + '\n' +
+		std::to_string(file.size()) + '\n' + std::to_string(size.width()) + 'x' + std::to_string(size.height());
+}
+
+// Release the least recently used images (which are not held by readers)
+void StillImageCache::release_images(int64_t max_bytes)
+{
+	while (total_bytes > max_bytes) {
+		auto oldest = entries.end();
+		for (auto entry = entries.begin(); entry != entries.end(); ++entry) {
+			if (entry->second.image.use_count() == 1 &&
+				(oldest == entries.end() || entry->second.last_used < oldest->second.last_used))
+				oldest = entry;
+		}
+
+		// All the remaining images are held by readers
+		if (oldest == entries.end())
+			break;
+
+		total_bytes -= oldest->second.bytes;
+		entries.erase(oldest);
+	}
+}
+
+// Get the stored image of a file
+std::shared_ptr<QImage> StillImageCache::Lookup(const std::string& path, QSize size)
+{
+	if (Settings::Instance()->STILL_IMAGE_CACHE_MB <= 0)
+		return nullptr;
+
+	const std::string key = image_key(path, size);
+	if (key.empty())
+		return nullptr;
+
+	const std::lock_guard<std::mutex> lock(cacheMutex);
+	auto entry = entries.find(key);
+	if (entry == entries.end())
+		return nullptr;
+
+	entry->second.last_used = ++use_count;
+	return entry->second.image;
+}
+
+// Store the decoded image of a file
+void StillImageCache::Insert(const std::string& path, QSize size, std::shared_ptr<QImage> image)
+{
+	const int64_t max_bytes = int64_t(Settings::Instance()->STILL_IMAGE_CACHE_MB) * 1024 * 1024;
+	if (max_bytes <= 0 || !image || image->isNull())
+		return;
+
+	const std::string key = image_key(path, size);
+	if (key.empty())
+		return;
+
+	const std::lock_guard<std::mutex> lock(cacheMutex);
+	Entry& entry = entries[key];
+	total_bytes -= entry.bytes;
+	entry.image = image;
+	entry.bytes = int64_t(image->bytesPerLine()) * image->height();
+	entry.last_used = ++use_count;
+	total_bytes += entry.bytes;
+
+	release_images(max_bytes);
+}
+
+// Release all stored images
+void StillImageCache::Clear()
+{
+	const std::lock_guard<std::mutex> lock(cacheMutex);
+	entries.clear();
+	total_bytes = 0;
+}
+
+// Get the number of stored images
+int64_t StillImageCache::Count()
+{
+	const std::lock_guard<std::mutex> lock(cacheMutex);
+	return entries.size();
+}
+
+// Get the size of the stored images
+int64_t StillImageCache::GetBytes()
+{
+	const std::lock_guard<std::mutex> lock(cacheMutex);
+	return total_bytes;
+}
@@ -0,0 +1,103 @@
+/**
+ * @file
+ * @brief Header file for StillImageCache class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_STILL_IMAGE_CACHE_H
+#define OPENSHOT_STILL_IMAGE_CACHE_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <QSize>
+
+class QImage;
+
+namespace openshot {
+
+	/**
+	 * @brief This singleton class shares the decoded (and scaled) images of still image files, between all
+	 * the readers of the same file
+	 *
+	 * Projects often use the same still image (i.e. a logo or a lower third) on many clips, and each Clip has
+	 * its own QtImageReader, which would decode (or rasterize, for SVG files) and scale the file by itself.
+	 * Each decoded image is stored here by path, modification time, file size and image size, and readers of
+	 * the same (unchanged) file at the same size share the stored image, instead of decoding their own copy.
+	 *
+	 * The stored images are limited to Settings::STILL_IMAGE_CACHE_MB. The least recently used images which
+	 * are not held by any reader are released first (images still held by readers are in memory either way).
+	 *
+	 * \code
+	 * // Only the first reader decodes the file
+	 * QtImageReader r1("logo.png");
+	 * QtImageReader r2("logo.png");
+	 * \endcode
+	 */
+	class StillImageCache {
+	private:
+		struct Entry {
+			std::shared_ptr<QImage> image; ///< The shared image
+			int64_t bytes = 0; ///< The size of the image (in bytes)
+			uint64_t last_used = 0; ///< When the image was last used (ordered by use, not time)
+		};
+
+		std::mutex cacheMutex;
+		std::map<std::string, Entry> entries; ///< Keyed by path, modification time, file size and image size
+		int64_t total_bytes = 0;
+		uint64_t use_count = 0;
+
+		/// Private variable to keep track of singleton instance
+		static StillImageCache *m_pInstance;
+
+		/// Default constructor
+		StillImageCache() = default;
+
+		/// Don't allow the user to copy or assign this instance
+		StillImageCache(StillImageCache const&) = delete;
+		StillImageCache & operator=(StillImageCache const&) = delete;
+
+		/// Get the key of an image (returns an empty key if the file doesn't exist)
+		static std::string image_key(const std::string& path, QSize size);
+
+		/// Release the least recently used images (which are not held by readers), until they fit the limit
+		void release_images(int64_t max_bytes);
+
+	public:
+		/// Create or get an instance of this cache singleton (invoke the class with this method)
+		static StillImageCache *Instance();
+
+		/// @brief Get the stored image of a file
+		/// @returns nullptr if the image was not stored (or the file has changed since)
+		/// @param path The path of the file
+		/// @param size The size of the image (or an invalid QSize for the original image)
+		std::shared_ptr<QImage> Lookup(const std::string& path, QSize size);
+
+		/// @brief Store the decoded image of a file (the image must not be modified afterwards)
+		/// @param path The path of the file
+		/// @param size The size of the image (or an invalid QSize for the original image)
+		/// @param image The decoded image
+		void Insert(const std::string& path, QSize size, std::shared_ptr<QImage> image);
+
+		/// Release all stored images (readers keep the images they hold)
+		void Clear();
+
+		/// Get the number of stored images
+		int64_t Count();
+
+		/// Get the size of the stored images (in bytes)
+		int64_t GetBytes();
+	};
+
+}
+
+#endif
@@ -0,0 +1,193 @@
+/**
+ * @file
+ * @brief Source file for TaskExecutor class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+#include "TaskExecutor.h"
+#include "FrameRequest.h"
+#include "OpenMPUtilities.h"
+#include "RenderTrace.h"
+#include "Settings.h"
+#include "ThreadAffinity.h"
+
+using namespace openshot;
+
+namespace {
+	// The worker running on this thread (or -1 for other threads)
+	thread_local int current_worker = -1;
+}
+
+// Global reference to the executor
+TaskExecutor *TaskExecutor::m_pInstance = nullptr;
+
+// Create or Get an instance of the executor singleton
+TaskExecutor *TaskExecutor::Instance()
+{
+	// Create the actual instance only once (work is submitted on many threads)
+	static std::once_flag created;
+	std::call_once(created, []() { m_pInstance = new TaskExecutor(OPEN_MP_NUM_PROCESSORS); });
+
+	return m_pInstance;
+}
+
+// Constructor
+TaskExecutor::TaskExecutor(int threads) : queues(std::max(threads, 1) + 1), stopping(false)
+{
+	for (int worker = 0; worker < std::max(threads, 1); worker++)
+		workers.emplace_back(&TaskExecutor::work, this, worker);
+}
+
+// Destructor
+TaskExecutor::~TaskExecutor()
+{
+	{
+		const std::lock_guard<std::mutex> lock(queueMutex);
+		stopping = true;
+	}
+	queueChanged.notify_all();
+	for (auto& worker : workers)
+		worker.join();
+}
+
+// Take the next task of a worker
+std::function<void()> TaskExecutor::take_task(int worker)
+{
+	std::function<void()> task;
+
+	// My newest task
+	std::deque<std::function<void()>>& own = queues[worker];
+	if (!own.empty()) {
+		task = std::move(own.back());
+		own.pop_back();
+		return task;
+	}
+
+	// The oldest task of another worker (or a shared task)
+	const int queue_count = (int) queues.size();
+	for (int other = 1; other < queue_count; other++) {
+		std::deque<std::function<void()>>& victim = queues[(worker + other) % queue_count];
+		if (!victim.empty()) {
+			task = std::move(victim.front());
+			victim.pop_front();
+			return task;
+		}
+	}
+	return task;
+}
+
+// Run the tasks
+void TaskExecutor::work(int worker)
+{
+	current_worker = worker;
+	RenderTrace::Instance()->SetThreadName("TaskExecutor " + std::to_string(worker));
+
+	// Run on the NUMA node of the render (if any, see Settings::NUMA_NODE)
+	const int node = Settings::Instance()->NUMA_NODE;
+	if (node >= 0)
+		ThreadAffinity::PinCurrentThreadToNode(node);
+
+	std::unique_lock<std::mutex> lock(queueMutex);
+	while (true) {
+		std::function<void()> task = take_task(worker);
+		if (!task) {
+			if (stopping)
+				return;
+			queueChanged.wait(lock);
+			continue;
+		}
+
+		lock.unlock();
+		task();
+		lock.lock();
+	}
+}
+
+// Queue a task
+void TaskExecutor::Submit(std::function<void()> task)
+{
+	{
+		const std::lock_guard<std::mutex> lock(queueMutex);
+		const int queue = (current_worker >= 0) ? current_worker : (int) workers.size();
+		queues[queue].push_back(std::move(task));
+	}
+	queueChanged.notify_one();
+}
+
+// Split a loop into ranges, and run them on the calling thread and the workers
+void TaskExecutor::ParallelFor(int64_t count, const std::function<void(int64_t begin, int64_t end)>& body)
+{
+	if (count <= 0)
+		return;
+
+	// A few ranges per thread (so threads which finish early take more of them)
+	const int64_t range_count = std::min<int64_t>(count, int64_t(Threads() + 1) * 4);
+	if (range_count == 1) {
+		body(0, count);
+		return;
+	}
+
+	// The state of the loop is shared with the helper tasks (a helper which starts after
+	// the loop is finished finds no ranges left, and never touches the body)
+	struct Loop {
+		std::atomic<int64_t> next_range{0};
+		std::mutex loopMutex;
+		std::condition_variable loopChanged;
+		int running = 0; ///< The threads running ranges
+		bool finished = false; ///< No more ranges will start
+		std::exception_ptr error;
+	};
+	auto loop = std::make_shared<Loop>();
+	FrameRequest *request = FrameRequest::Current();
+
+	// Run ranges until there are none left
+	auto run_ranges = [loop, &body, count, range_count]() {
+		{
+			const std::lock_guard<std::mutex> lock(loop->loopMutex);
+			if (loop->finished)
+				return;
+			loop->running++;
+		}
+		while (true) {
+			const int64_t range = loop->next_range++;
+			if (range >= range_count)
+				break;
+			try {
+				body(count * range / range_count, count * (range + 1) / range_count);
+			} catch (...) {
+				const std::lock_guard<std::mutex> lock(loop->loopMutex);
+				if (!loop->error)
+					loop->error = std::current_exception();
+				loop->next_range = range_count;
+			}
+		}
+		{
+			const std::lock_guard<std::mutex> lock(loop->loopMutex);
+			loop->running--;
+		}
+		loop->loopChanged.notify_all();
+	};
+
+	// Helpers run as part of the same frame request (so they stop if it is cancelled)
+	const int helpers = (int) std::min<int64_t>(Threads(), range_count - 1);
+	for (int helper = 0; helper < helpers; helper++)
+		Submit([request, run_ranges]() { FrameRequest::RunAs(request, run_ranges); });
+	run_ranges();
+
+	// Wait for the helpers which are still running a range (and stop the others from starting)
+	std::unique_lock<std::mutex> lock(loop->loopMutex);
+	loop->finished = true;
+	loop->loopChanged.wait(lock, [&loop]() { return loop->running == 0; });
+	if (loop->error)
+		std::rethrow_exception(loop->error);
+}
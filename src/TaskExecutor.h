@@ -0,0 +1,111 @@
+/**
+ * @file
+ * @brief Header file for TaskExecutor class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_TASK_EXECUTOR_H
+#define OPENSHOT_TASK_EXECUTOR_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace openshot {
+
+	/**
+	 * @brief This singleton class is a pool of threads shared by all the parallel work of libopenshot
+	 *
+	 * Parallel work which creates its own threads (i.e. each render graph, or each OpenMP loop of each layer)
+	 * oversubscribes the cores when several of them run at once. Work submitted here shares one pool, sized
+	 * from Settings::OMP_THREADS when it is first used. Each worker runs the tasks it submitted itself first
+	 * (newest first, while their data is in its cache), and steals the oldest task of another worker when it
+	 * has none. Tasks submitted by other threads are shared by all the workers.
+	 *
+	 * ParallelFor() and RenderGraph run part of their work on the calling thread, and never wait for a task
+	 * which has not started, so they can be nested (i.e. a pixel kernel inside a render graph node) without
+	 * waiting for each other.
+	 *
+	 * \code
+	 * // Split a loop between the workers (and the calling thread)
+	 * TaskExecutor::Instance()->ParallelFor(height, [&](int64_t begin, int64_t end) {
+	 *     for (int64_t y = begin; y < end; ++y)
+	 *         process_row(y);
+	 * });
+	 *
+	 * // Run a task in the background
+	 * std::future<bool> saved = TaskExecutor::Instance()->Async([&]() { return image.save(path); });
+	 * \endcode
+	 */
+	class TaskExecutor {
+	private:
+		std::mutex queueMutex;
+		std::condition_variable queueChanged;
+		std::vector<std::deque<std::function<void()>>> queues; ///< The tasks of each worker (and the shared tasks last)
+		std::vector<std::thread> workers;
+		bool stopping;
+
+		/// Private variable to keep track of singleton instance
+		static TaskExecutor *m_pInstance;
+
+		/// Constructor (with the number of worker threads)
+		TaskExecutor(int threads);
+
+		/// Don't allow the user to copy or assign this instance
+		TaskExecutor(TaskExecutor const&) = delete;
+		TaskExecutor & operator=(TaskExecutor const&) = delete;
+
+		/// Run the tasks (the body of each worker thread)
+		void work(int worker);
+
+		/// Take the next task of a worker (its newest, or the oldest of another worker), or an empty function
+		std::function<void()> take_task(int worker);
+
+	public:
+		/// Create or get an instance of this executor singleton (invoke the class with this method)
+		static TaskExecutor *Instance();
+
+		/// Get the number of worker threads
+		int Threads() const { return (int) workers.size(); }
+
+		/// @brief Queue a task (on the calling worker, or shared by all the workers)
+		/// @param task The task to run (which must not throw)
+		void Submit(std::function<void()> task);
+
+		/// @brief Run a function in the background
+		/// @returns The result of the function (or its exception)
+		/// @param function The function to run
+		template <typename Function>
+		auto Async(Function function) -> std::future<decltype(function())>
+		{
+			auto task = std::make_shared<std::packaged_task<decltype(function())()>>(std::move(function));
+			auto result = task->get_future();
+			Submit([task]() { (*task)(); });
+			return result;
+		}
+
+		/// @brief Split a loop into ranges, and run them on the calling thread and the workers (at once)
+		/// Throws the first exception of a range (after the other ranges are finished).
+		/// @param count The number of iterations (from 0 to count - 1)
+		/// @param body The work of a range of iterations (begin to end - 1)
+		void ParallelFor(int64_t count, const std::function<void(int64_t begin, int64_t end)>& body);
+
+		/// Destructor (stops the worker threads)
+		~TaskExecutor();
+	};
+
+}
+
+#endif
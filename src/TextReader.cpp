@@ -106,6 +106,9 @@ void TextReader::Open()
 		// Draw image
 		image->draw(lines);
 
+		// Convert the image once (every frame shares the converted pixels)
+		cached_image = openshot::Magick2QImage(image);
+
 		// Update image properties
 		info.has_audio = false;
 		info.has_video = true;
@@ -151,19 +154,16 @@ void TextReader::Close()
 // Get an openshot::Frame object for a specific frame number of this reader.
 std::shared_ptr<Frame> TextReader::GetFrame(int64_t requested_frame)
 {
-	if (image)
+	if (cached_image)
 	{
 		// Create or get frame object
 		auto image_frame = std::make_shared<Frame>(
 			requested_frame,
-			image->size().width(), image->size().height(),
+			cached_image->width(), cached_image->height(),
 			"#000000", 0, 2);
 
-		// Add Image data to frame
-		auto copy_image = std::make_shared<Magick::Image>(*image.get());
-		copy_image->modifyImage(); // actually copy the image data to this object
-		auto qimage = openshot::Magick2QImage(copy_image);
-		image_frame->AddImage(qimage);
+		// Add Image data to frame (shared with the other frames, without copying it)
+		image_frame->AddImage(cached_image);
 
 		// return frame object
 		return image_frame;
@@ -73,6 +73,7 @@ namespace openshot
 		std::string background_color;
 		std::string text_background_color;
 		std::shared_ptr<Magick::Image> image;
+		std::shared_ptr<QImage> cached_image; ///< The text image converted for frames (once, when opened)
 		MAGICK_DRAWABLE lines;
 		bool is_open;
 		openshot::GravityType gravity;
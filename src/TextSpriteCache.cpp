@@ -0,0 +1,125 @@
+/**
+ * @file
+ * @brief Source file for TextSpriteCache class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "TextSpriteCache.h"
+
+#include <QImage>
+
+using namespace openshot;
+
+// Global reference to the cache
+TextSpriteCache *TextSpriteCache::m_pInstance = nullptr;
+
+// Default constructor (default to 64 MB of images, which is 8 titles at 1920x1080)
+TextSpriteCache::TextSpriteCache() : total_bytes(0), max_bytes(64 * 1024 * 1024) { }
+
+// Create or Get an instance of the cache singleton
+TextSpriteCache *TextSpriteCache::Instance()
+{
+	// Create the actual instance of the cache only once (readers are opened on many threads)
+	static std::once_flag created;
+	std::call_once(created, []() { m_pInstance = new TextSpriteCache; });
+
+	return m_pInstance;
+}
+
+// Get the size of an image
+int64_t TextSpriteCache::GetBytes(const QImage& image)
+{
+	return int64_t(image.bytesPerLine()) * image.height();
+}
+
+// Get a cached image
+std::shared_ptr<QImage> TextSpriteCache::GetImage(const std::string& key)
+{
+	const std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+
+	auto found = index.find(key);
+	if (found == index.end())
+		return std::shared_ptr<QImage>();
+
+	// Move image to the front (most recently used)
+	images.splice(images.begin(), images, found->second);
+	return found->second->second;
+}
+
+// Add an image to the cache
+void TextSpriteCache::Add(const std::string& key, std::shared_ptr<QImage> image)
+{
+	if (!image)
+		return;
+
+	const std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+
+	// Replace previous version (if any)
+	auto found = index.find(key);
+	if (found != index.end()) {
+		total_bytes -= GetBytes(*found->second->second);
+		images.erase(found->second);
+		index.erase(found);
+	}
+
+	// Add to the front (most recently used)
+	images.emplace_front(key, image);
+	index[key] = images.begin();
+	total_bytes += GetBytes(*image);
+
+	Evict();
+}
+
+// Remove the least recently used images (until the cache fits)
+void TextSpriteCache::Evict()
+{
+	while (total_bytes > max_bytes && !images.empty()) {
+		total_bytes -= GetBytes(*images.back().second);
+		index.erase(images.back().first);
+		images.pop_back();
+	}
+}
+
+// Remove all cached images
+void TextSpriteCache::Clear()
+{
+	const std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+	images.clear();
+	index.clear();
+	total_bytes = 0;
+}
+
+// Count the cached images
+int64_t TextSpriteCache::Count()
+{
+	const std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+	return images.size();
+}
+
+// Get the total size of all cached images
+int64_t TextSpriteCache::GetBytes()
+{
+	const std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+	return total_bytes;
+}
+
+// Get the max size of all cached images
+int64_t TextSpriteCache::GetMaxBytes()
+{
+	const std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+	return max_bytes;
+}
+
+// Set the max size of all cached images (0 disables caching)
+void TextSpriteCache::SetMaxBytes(int64_t number_of_bytes)
+{
+	const std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+	max_bytes = number_of_bytes;
+	Evict();
+}
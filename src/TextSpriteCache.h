@@ -0,0 +1,103 @@
+/**
+ * @file
+ * @brief Header file for TextSpriteCache class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_TEXT_SPRITE_CACHE_H
+#define OPENSHOT_TEXT_SPRITE_CACHE_H
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+class QImage;
+
+namespace openshot {
+
+	/**
+	 * @brief This singleton class caches rasterized text and HTML images, which are shared by all
+	 * openshot::QtTextReader and openshot::QtHtmlReader instances
+	 *
+	 * Laying out and painting text (or an HTML document) is the expensive part of these readers. A title is
+	 * usually opened many times (every Clip opens its own reader, and readers are opened again when clips
+	 * come into view), so each rasterized image is cached by its content and size (i.e. every property which
+	 * changes the image). The images are premultiplied (Format_RGBA8888_Premultiplied), and must not be
+	 * modified once they are cached. The least recently used images are removed once the cache exceeds
+	 * GetMaxBytes().
+	 *
+	 * \code
+	 * std::shared_ptr<QImage> image = TextSpriteCache::Instance()->GetImage(key);
+	 * if (!image) {
+	 *     image = std::make_shared<QImage>(width, height, QImage::Format_RGBA8888_Premultiplied);
+	 *     // ... paint the text
+	 *     TextSpriteCache::Instance()->Add(key, image);
+	 * }
+	 * \endcode
+	 */
+	class TextSpriteCache {
+	private:
+		std::recursive_mutex cacheMutex;
+		std::list<std::pair<std::string, std::shared_ptr<QImage>>> images; ///< Cached images (most recently used first)
+		std::map<std::string, decltype(images)::iterator> index; ///< Position of each image in the list
+		int64_t total_bytes; ///< Total size of all cached images
+		int64_t max_bytes; ///< Max size of all cached images
+
+		/// Private variable to keep track of singleton instance
+		static TextSpriteCache *m_pInstance;
+
+		/// Default constructor
+		TextSpriteCache();
+
+		/// Don't allow the user to copy or assign this instance
+		TextSpriteCache(TextSpriteCache const&) = delete;
+		TextSpriteCache & operator=(TextSpriteCache const&) = delete;
+
+		/// Get the size of an image (in bytes)
+		static int64_t GetBytes(const QImage& image);
+
+		/// Remove the least recently used images (until the cache fits)
+		void Evict();
+
+	public:
+		/// Create or get an instance of this cache singleton (invoke the class with this method)
+		static TextSpriteCache *Instance();
+
+		/// @brief Get a cached image (or NULL shared_ptr if the image is not cached)
+		/// @param key The content and size of the image (i.e. the properties of the reader)
+		std::shared_ptr<QImage> GetImage(const std::string& key);
+
+		/// @brief Add an image to the cache (replacing the previous image with the same key, if any)
+		/// @param key The content and size of the image (i.e. the properties of the reader)
+		/// @param image The image (which must not be modified anymore)
+		void Add(const std::string& key, std::shared_ptr<QImage> image);
+
+		/// Remove all cached images
+		void Clear();
+
+		/// Count the cached images
+		int64_t Count();
+
+		/// Get the total size of all cached images (in bytes)
+		int64_t GetBytes();
+
+		/// Get the max size of all cached images (in bytes)
+		int64_t GetMaxBytes();
+
+		/// @brief Set the max size of all cached images (in bytes). Set to 0 to disable caching.
+		/// @param number_of_bytes The max number of bytes of images to keep
+		void SetMaxBytes(int64_t number_of_bytes);
+	};
+
+}
+
+#endif
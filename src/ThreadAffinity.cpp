@@ -0,0 +1,167 @@
+/**
+ * @file
+ * @brief Source file for ThreadAffinity and ScopedNodeAffinity classes
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "ThreadAffinity.h"
+#include "Settings.h"
+
+using namespace openshot;
+
+namespace {
+	// The NUMA nodes of the machine (read once)
+	struct NodeTopology {
+		std::vector<std::vector<int>> node_cpus; ///< The CPUs of each node
+		std::vector<int> cpu_nodes; ///< The node of each CPU
+
+		NodeTopology() {
+#if defined(__linux__)
+			for (int node = 0; ; node++) {
+				std::ifstream cpulist("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+				if (!cpulist)
+					break;
+				std::string line;
+				std::getline(cpulist, line);
+				node_cpus.push_back(parse_cpulist(line));
+			}
+#endif
+			for (size_t node = 0; node < node_cpus.size(); node++) {
+				for (int cpu : node_cpus[node]) {
+					if ((int) cpu_nodes.size() <= cpu)
+						cpu_nodes.resize(cpu + 1, 0);
+					cpu_nodes[cpu] = (int) node;
+				}
+			}
+		}
+
+		// Parse a list of CPUs (i.e. "0-15,32-47")
+		static std::vector<int> parse_cpulist(const std::string& list) {
+			std::vector<int> cpus;
+			std::stringstream ranges(list);
+			std::string range;
+			while (std::getline(ranges, range, ',')) {
+				if (range.empty())
+					continue;
+				const size_t dash = range.find('-');
+				try {
+					const int first = std::stoi(range.substr(0, dash));
+					const int last = (dash == std::string::npos) ? first : std::stoi(range.substr(dash + 1));
+					for (int cpu = first; cpu <= last; cpu++)
+						cpus.push_back(cpu);
+				} catch (const std::exception&) {
+					// Skip a malformed range
+				}
+			}
+			return cpus;
+		}
+	};
+
+	const NodeTopology& topology() {
+		static const NodeTopology nodes;
+		return nodes;
+	}
+}
+
+// Get the number of NUMA nodes
+int ThreadAffinity::NodeCount()
+{
+	return std::max((int) topology().node_cpus.size(), 1);
+}
+
+// Get the CPUs of a NUMA node
+std::vector<int> ThreadAffinity::NodeCpus(int node)
+{
+	const NodeTopology& nodes = topology();
+	if (node < 0 || node >= (int) nodes.node_cpus.size())
+		return std::vector<int>();
+	return nodes.node_cpus[node];
+}
+
+// Get the NUMA node of the CPU the calling thread runs on
+int ThreadAffinity::CurrentNode()
+{
+#if defined(__linux__)
+	const NodeTopology& nodes = topology();
+	const int cpu = sched_getcpu();
+	if (cpu >= 0 && cpu < (int) nodes.cpu_nodes.size())
+		return nodes.cpu_nodes[cpu];
+#endif
+	return 0;
+}
+
+// Get the CPUs the calling thread may run on
+std::vector<int> ThreadAffinity::CurrentThreadCpus()
+{
+	std::vector<int> cpus;
+#if defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0) {
+		for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+			if (CPU_ISSET(cpu, &set))
+				cpus.push_back(cpu);
+	}
+#endif
+	return cpus;
+}
+
+// Pin the calling thread to a list of CPUs
+bool ThreadAffinity::PinCurrentThread(const std::vector<int>& cpus)
+{
+#if defined(__linux__)
+	if (cpus.empty())
+		return false;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (int cpu : cpus)
+		if (cpu >= 0 && cpu < CPU_SETSIZE)
+			CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+	return false;
+#endif
+}
+
+// Pin the calling thread to the CPUs of a NUMA node
+bool ThreadAffinity::PinCurrentThreadToNode(int node)
+{
+	return PinCurrentThread(NodeCpus(node));
+}
+
+// Pin the calling thread to a NUMA node
+ScopedNodeAffinity::ScopedNodeAffinity(int node)
+{
+	if (node < 0)
+		node = Settings::Instance()->NUMA_NODE;
+	if (node < 0)
+		return;
+
+	std::vector<int> cpus = ThreadAffinity::CurrentThreadCpus();
+	if (ThreadAffinity::PinCurrentThreadToNode(node))
+		saved_cpus.swap(cpus);
+}
+
+// Restore the CPUs of the thread
+ScopedNodeAffinity::~ScopedNodeAffinity()
+{
+	if (!saved_cpus.empty())
+		ThreadAffinity::PinCurrentThread(saved_cpus);
+}
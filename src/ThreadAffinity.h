@@ -0,0 +1,90 @@
+/**
+ * @file
+ * @brief Header file for ThreadAffinity and ScopedNodeAffinity classes
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_THREAD_AFFINITY_H
+#define OPENSHOT_THREAD_AFFINITY_H
+
+#include <vector>
+
+namespace openshot {
+
+	/**
+	 * @brief This class finds the NUMA nodes of the machine, and pins threads to their cores
+	 *
+	 * On machines with several sockets, each socket (NUMA node) has its own memory, and a thread which
+	 * processes an image allocated on another node reads it across the sockets. Pinning the threads of a
+	 * render (see Settings::NUMA_NODE) keeps them, and the memory they first touch, on one node. Threads
+	 * inherit the cores of the thread which creates them, so pinning a thread before it opens a decoder
+	 * (or encoder) also pins the threads of the decoder.
+	 *
+	 * The nodes are read from /sys/devices/system/node on Linux. Elsewhere, the machine has one node,
+	 * and threads are never pinned.
+	 */
+	class ThreadAffinity {
+	public:
+		/// Get the number of NUMA nodes (1 if unknown)
+		static int NodeCount();
+
+		/// @brief Get the CPUs of a NUMA node
+		/// @returns The numbers of the CPUs (or an empty list, if the node is unknown)
+		/// @param node The number of the node (0 is the first)
+		static std::vector<int> NodeCpus(int node);
+
+		/// Get the NUMA node of the CPU the calling thread runs on (0 if unknown)
+		static int CurrentNode();
+
+		/// Get the CPUs the calling thread may run on (an empty list if unknown)
+		static std::vector<int> CurrentThreadCpus();
+
+		/// @brief Pin the calling thread to a list of CPUs
+		/// @returns False if the thread could not be pinned (or pinning is not supported)
+		/// @param cpus The numbers of the CPUs
+		static bool PinCurrentThread(const std::vector<int>& cpus);
+
+		/// @brief Pin the calling thread to the CPUs of a NUMA node
+		/// @returns False if the thread could not be pinned (or the node is unknown)
+		/// @param node The number of the node (0 is the first)
+		static bool PinCurrentThreadToNode(int node);
+	};
+
+	/**
+	 * @brief Pins the calling thread to a NUMA node while this object exists (and then restores its CPUs)
+	 *
+	 * The threads created meanwhile (i.e. by FFmpeg, when a codec is opened) keep running on the node.
+	 *
+	 * \code
+	 * {
+	 *     // Open the decoder threads on the node of the render (see Settings::NUMA_NODE)
+	 *     ScopedNodeAffinity affinity;
+	 *     avcodec_open2(context, codec, &options);
+	 * }
+	 * \endcode
+	 */
+	class ScopedNodeAffinity {
+	private:
+		std::vector<int> saved_cpus; ///< The CPUs of the thread before it was pinned (empty if it wasn't pinned)
+
+	public:
+		/// @brief Constructor, which pins the calling thread
+		/// @param node The number of the node (or -1 for Settings::NUMA_NODE, which doesn't pin when it's -1)
+		explicit ScopedNodeAffinity(int node = -1);
+
+		/// Destructor, which restores the CPUs of the thread
+		~ScopedNodeAffinity();
+
+		ScopedNodeAffinity(ScopedNodeAffinity const&) = delete;
+		ScopedNodeAffinity & operator=(ScopedNodeAffinity const&) = delete;
+	};
+
+}
+
+#endif
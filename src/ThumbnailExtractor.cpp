@@ -0,0 +1,254 @@
+/**
+ * @file
+ * @brief Source file for ThumbnailExtractor class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "ThumbnailExtractor.h"
+#include "Exceptions.h"
+#include "FFmpegUtilities.h"
+#include "OpenMPUtilities.h"
+
+using namespace openshot;
+
+// Walk forward (reading only the key frames) instead of seeking, to targets closer than this
+static const double SEEK_DISTANCE_SECONDS = 10.0;
+
+// Constructor
+ThumbnailExtractor::ThumbnailExtractor(const std::string& path, int width, int height)
+	: path(path), max_width(std::max(width, 1)), max_height(std::max(height, 1)), is_open(false),
+	  pFormatCtx(NULL), pCodecCtx(NULL), pStream(NULL), pFrame(NULL), img_convert_ctx(NULL), videoStream(-1),
+	  current_pts(AV_NOPTS_VALUE), has_next(false), next_pts(AV_NOPTS_VALUE)
+{
+	// Initialize FFMpeg, and register all formats and codecs
+	AV_REGISTER_ALL
+	AVCODEC_REGISTER_ALL
+}
+
+// Destructor
+ThumbnailExtractor::~ThumbnailExtractor()
+{
+	Close();
+}
+
+// Open the video file (and its decoder)
+void ThumbnailExtractor::Open()
+{
+	if (is_open)
+		return;
+
+	if (avformat_open_input(&pFormatCtx, path.c_str(), NULL, NULL) != 0)
+		throw InvalidFile("File could not be opened.", path);
+	if (avformat_find_stream_info(pFormatCtx, NULL) < 0) {
+		avformat_close_input(&pFormatCtx);
+		throw NoStreamsFound("No streams found in file.", path);
+	}
+	videoStream = av_find_best_stream(pFormatCtx, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+	if (videoStream < 0) {
+		avformat_close_input(&pFormatCtx);
+		throw NoStreamsFound("No video stream found in file.", path);
+	}
+	pStream = pFormatCtx->streams[videoStream];
+
+	// Only the video stream's packets are needed
+	for (unsigned int i = 0; i < pFormatCtx->nb_streams; i++) {
+		if ((int)i != videoStream)
+			pFormatCtx->streams[i]->discard = AVDISCARD_ALL;
+	}
+
+	// Open the decoder (which skips all frames except the key frames)
+	const AVCodec *pCodec = avcodec_find_decoder(AV_FIND_DECODER_CODEC_ID(pStream));
+	if (pCodec == NULL) {
+		avformat_close_input(&pFormatCtx);
+		throw InvalidCodec("A valid video codec could not be found for this file.", path);
+	}
+	pCodecCtx = AV_GET_CODEC_CONTEXT(pStream, pCodec);
+	pCodecCtx->thread_count = std::min(FF_NUM_PROCESSORS, 16);
+	pCodecCtx->skip_frame = AVDISCARD_NONKEY;
+	if (avcodec_open2(pCodecCtx, pCodec, NULL) < 0) {
+		AV_FREE_CONTEXT(pCodecCtx);
+		avformat_close_input(&pFormatCtx);
+		throw InvalidCodec("A video codec was found, but could not be opened.", path);
+	}
+
+	pFrame = AV_ALLOCATE_FRAME();
+	if (pFrame == NULL) {
+		Close();
+		throw OutOfMemory("Failed to allocate frame buffer", path);
+	}
+
+	current_pts = AV_NOPTS_VALUE;
+	current_image.reset();
+	has_next = false;
+	next_image.reset();
+	is_open = true;
+}
+
+// Close the video file
+void ThumbnailExtractor::Close()
+{
+	if (pFrame)
+		AV_FREE_FRAME(&pFrame);
+	if (img_convert_ctx) {
+		sws_freeContext(img_convert_ctx);
+		img_convert_ctx = NULL;
+	}
+	if (pCodecCtx)
+		AV_FREE_CONTEXT(pCodecCtx);
+	if (pFormatCtx)
+		avformat_close_input(&pFormatCtx);
+	pStream = NULL;
+	videoStream = -1;
+	current_image.reset();
+	next_image.reset();
+	has_next = false;
+	is_open = false;
+}
+
+// Get the width of the thumbnails
+int ThumbnailExtractor::GetWidth() const
+{
+	if (!pStream || pStream->codecpar->width <= 0 || pStream->codecpar->height <= 0)
+		return 0;
+
+	// Fit the display size of the video (with its pixel aspect ratio) in the maximum size
+	const AVRational sar = av_guess_sample_aspect_ratio(pFormatCtx, pStream, NULL);
+	const double display_width = pStream->codecpar->width * ((sar.num > 0 && sar.den > 0) ? av_q2d(sar) : 1.0);
+	const double scale = std::min(max_width / display_width, max_height / double(pStream->codecpar->height));
+	return std::max(1, int(round(display_width * scale)));
+}
+
+// Get the height of the thumbnails
+int ThumbnailExtractor::GetHeight() const
+{
+	if (!pStream || pStream->codecpar->width <= 0 || pStream->codecpar->height <= 0)
+		return 0;
+
+	const AVRational sar = av_guess_sample_aspect_ratio(pFormatCtx, pStream, NULL);
+	const double display_width = pStream->codecpar->width * ((sar.num > 0 && sar.den > 0) ? av_q2d(sar) : 1.0);
+	const double scale = std::min(max_width / display_width, max_height / double(pStream->codecpar->height));
+	return std::max(1, int(round(pStream->codecpar->height * scale)));
+}
+
+// Convert a time (in seconds) to a PTS of the video stream
+int64_t ThumbnailExtractor::seconds_to_pts(double seconds) const
+{
+	const int64_t start_time = (pStream->start_time != AV_NOPTS_VALUE) ? pStream->start_time : 0;
+	return start_time + llround(seconds / av_q2d(pStream->time_base));
+}
+
+// Decode the next key frame (and scale it)
+bool ThumbnailExtractor::decode_key_frame(int64_t& pts, std::shared_ptr<QImage>& image)
+{
+	AVPacket *packet = new AVPacket();
+	bool found = false;
+	while (!found) {
+		// Return the next decoded frame (if any)
+		int receive_err = avcodec_receive_frame(pCodecCtx, pFrame);
+		if (receive_err == 0) {
+			pts = (pFrame->best_effort_timestamp != AV_NOPTS_VALUE) ? pFrame->best_effort_timestamp : pFrame->pts;
+			image = scale_frame();
+			av_frame_unref(pFrame);
+			found = (image != nullptr);
+			continue;
+		}
+		if (receive_err != AVERROR(EAGAIN))
+			break;
+
+		// Send the next key frame's packet (the other packets are never decoded)
+		if (av_read_frame(pFormatCtx, packet) < 0) {
+			// Drain the decoder (at the end of the file)
+			avcodec_send_packet(pCodecCtx, NULL);
+			continue;
+		}
+		if (packet->stream_index == videoStream && (packet->flags & AV_PKT_FLAG_KEY))
+			avcodec_send_packet(pCodecCtx, packet);
+		AV_FREE_PACKET(packet);
+	}
+	delete packet;
+	return found;
+}
+
+// Scale the decoded frame to the thumbnail size
+std::shared_ptr<QImage> ThumbnailExtractor::scale_frame()
+{
+	const int width = GetWidth();
+	const int height = GetHeight();
+	if (width <= 0 || height <= 0 || pFrame->width <= 0 || pFrame->height <= 0)
+		return nullptr;
+
+	// Scale straight from the decoded format (and size) to the thumbnail
+	img_convert_ctx = sws_getCachedContext(img_convert_ctx, pFrame->width, pFrame->height, (AVPixelFormat) pFrame->format,
+										   width, height, PIX_FMT_RGBA, SWS_BILINEAR, NULL, NULL, NULL);
+	if (img_convert_ctx == NULL)
+		throw OutOfMemory("Failed to allocate image scaler", path);
+
+	std::shared_ptr<QImage> image = std::make_shared<QImage>(width, height, QImage::Format_RGBA8888);
+	uint8_t *dst_data[4] = {image->bits(), NULL, NULL, NULL};
+	int dst_linesize[4] = {(int) image->bytesPerLine(), 0, 0, 0};
+	sws_scale(img_convert_ctx, pFrame->data, pFrame->linesize, 0, pFrame->height, dst_data, dst_linesize);
+	return image;
+}
+
+// Get the thumbnail of a time
+std::shared_ptr<QImage> ThumbnailExtractor::GetThumbnail(double seconds)
+{
+	return GetThumbnails(std::vector<double>(1, seconds)).front();
+}
+
+// Get the thumbnails of many times (in one pass over the file)
+std::vector<std::shared_ptr<QImage>> ThumbnailExtractor::GetThumbnails(const std::vector<double>& seconds)
+{
+	if (!is_open)
+		throw ReaderClosed("The ThumbnailExtractor is closed.  Call Open() before calling this method.", path);
+
+	// Visit the times in order (so the file is read forward)
+	std::vector<size_t> order(seconds.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&seconds](size_t a, size_t b) { return seconds[a] < seconds[b]; });
+
+	const int64_t seek_distance = llround(SEEK_DISTANCE_SECONDS / av_q2d(pStream->time_base));
+	std::vector<std::shared_ptr<QImage>> thumbnails(seconds.size());
+	for (size_t index : order) {
+		const int64_t target = seconds_to_pts(seconds[index]);
+
+		// Seek to the key frame before the target (unless it's close ahead of the current key frame)
+		if (!current_image || target < current_pts || target - current_pts > seek_distance) {
+			av_seek_frame(pFormatCtx, videoStream, target, AVSEEK_FLAG_BACKWARD);
+			avcodec_flush_buffers(pCodecCtx);
+			has_next = false;
+			next_image.reset();
+			current_image.reset();
+			if (!decode_key_frame(current_pts, current_image))
+				continue;
+		}
+
+		// Walk forward to the last key frame at (or before) the target
+		while (true) {
+			if (!has_next) {
+				if (!decode_key_frame(next_pts, next_image))
+					break;
+				has_next = true;
+			}
+			if (next_pts > target)
+				break;
+			current_pts = next_pts;
+			current_image = next_image;
+			has_next = false;
+		}
+
+		thumbnails[index] = current_image;
+	}
+
+	return thumbnails;
+}
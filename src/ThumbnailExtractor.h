@@ -0,0 +1,125 @@
+/**
+ * @file
+ * @brief Header file for ThumbnailExtractor class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_THUMBNAIL_EXTRACTOR_H
+#define OPENSHOT_THUMBNAIL_EXTRACTOR_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <QImage>
+
+// Forward declarations
+struct AVCodecContext;
+struct AVFormatContext;
+struct AVFrame;
+struct AVStream;
+struct SwsContext;
+
+namespace openshot {
+
+	/**
+	 * @brief This class extracts thumbnails of a video file, by only decoding its key frames.
+	 *
+	 * Media browsers and timeline filmstrips need many small images of a file, but an FFmpegReader
+	 * decodes every frame up to each requested frame (at full size). Instead, each thumbnail is the
+	 * key frame at (or before) the requested time: the file is read once (from the first to the last
+	 * requested time), only the key frames are decoded (the decoder skips all other frames), and each
+	 * key frame is scaled straight to the thumbnail size (without converting it at full size). Times
+	 * which share the same key frame share the same image.
+	 *
+	 * \code
+	 * ThumbnailExtractor thumbnails("video.mp4", 160, 90);
+	 * thumbnails.Open();
+	 *
+	 * // One thumbnail every 10 seconds
+	 * std::vector<double> times;
+	 * for (double t = 0.0; t < 60.0; t += 10.0)
+	 *     times.push_back(t);
+	 * std::vector<std::shared_ptr<QImage>> images = thumbnails.GetThumbnails(times);
+	 * thumbnails.Close();
+	 * \endcode
+	 */
+	class ThumbnailExtractor {
+	private:
+		std::string path;
+		int max_width;
+		int max_height;
+		bool is_open;
+
+		AVFormatContext *pFormatCtx;
+		AVCodecContext *pCodecCtx;
+		AVStream *pStream;
+		AVFrame *pFrame;
+		SwsContext *img_convert_ctx;
+		int videoStream;
+
+		/// The key frame of the last thumbnail
+		int64_t current_pts;
+		std::shared_ptr<QImage> current_image;
+
+		/// The key frame decoded after it (if any, kept for the next thumbnail)
+		bool has_next;
+		int64_t next_pts;
+		std::shared_ptr<QImage> next_image;
+
+		/// Convert a time (in seconds) to a PTS of the video stream
+		int64_t seconds_to_pts(double seconds) const;
+
+		/// @brief Decode the next key frame (and scale it)
+		/// @returns false at the end of the file
+		bool decode_key_frame(int64_t& pts, std::shared_ptr<QImage>& image);
+
+		/// Scale the decoded frame to the thumbnail size
+		std::shared_ptr<QImage> scale_frame();
+
+	public:
+		/// @brief Constructor for ThumbnailExtractor
+		/// @param path The path of the video file
+		/// @param width The maximum width of the thumbnails
+		/// @param height The maximum height of the thumbnails (the aspect ratio is kept)
+		ThumbnailExtractor(const std::string& path, int width, int height);
+
+		/// Destructor
+		virtual ~ThumbnailExtractor();
+
+		/// Open the video file (and its decoder)
+		void Open();
+
+		/// Close the video file
+		void Close();
+
+		/// Determine if the file is open
+		bool IsOpen() { return is_open; }
+
+		/// Get the width of the thumbnails (the video scaled to fit the maximum size)
+		int GetWidth() const;
+
+		/// Get the height of the thumbnails (the video scaled to fit the maximum size)
+		int GetHeight() const;
+
+		/// @brief Get the thumbnail of a time (the image of the key frame at or before it)
+		/// @returns nullptr if there is no key frame
+		/// @param seconds The time (in seconds)
+		std::shared_ptr<QImage> GetThumbnail(double seconds);
+
+		/// @brief Get the thumbnails of many times (in one pass over the file)
+		/// @returns The thumbnails (in the same order as the times)
+		/// @param seconds The times (in seconds, in any order)
+		std::vector<std::shared_ptr<QImage>> GetThumbnails(const std::vector<double>& seconds);
+	};
+
+}
+
+#endif
@@ -0,0 +1,207 @@
+/**
+ * @file
+ * @brief Source file for TiledImage class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+#include <cstring>
+
+#include <QImage>
+
+#include "TiledImage.h"
+#include "ImageBufferPool.h"
+#include "PixelKernels.h"
+#include "TaskExecutor.h"
+
+using namespace openshot;
+
+// Fill pixels with a single RGBA8888 color
+static void fill_pixels(unsigned char *target, const unsigned char *color, int64_t count)
+{
+	uint32_t value;
+	std::memcpy(&value, color, 4);
+	for (int64_t pixel = 0; pixel < count; ++pixel)
+		std::memcpy(target + pixel * 4, &value, 4);
+}
+
+// Constructor
+TiledImage::TiledImage(int width, int height, const QColor& background) :
+	width(std::max(width, 0)), height(std::max(height, 0))
+{
+	tiles_x = (this->width + TILE_SIZE - 1) / TILE_SIZE;
+	tiles_y = (this->height + TILE_SIZE - 1) / TILE_SIZE;
+	tiles.resize(size_t(tiles_x) * tiles_y);
+
+	// Premultiply the background color (like QImage::fill does for premultiplied images)
+	const QRgb color = qPremultiply(background.rgba());
+	this->background[0] = qRed(color);
+	this->background[1] = qGreen(color);
+	this->background[2] = qBlue(color);
+	this->background[3] = qAlpha(color);
+}
+
+// Get the size of a tile
+void TiledImage::tile_size(int tile_x, int tile_y, int& tile_width, int& tile_height) const
+{
+	tile_width = std::min(TILE_SIZE, width - tile_x * TILE_SIZE);
+	tile_height = std::min(TILE_SIZE, height - tile_y * TILE_SIZE);
+}
+
+// Create a tiled image from a QImage
+std::shared_ptr<TiledImage> TiledImage::FromImage(const QImage& image)
+{
+	QImage pixels = image;
+	PixelKernels::ToPremultipliedRGBA(pixels);
+	auto tiled = std::make_shared<TiledImage>(pixels.width(), pixels.height());
+
+	const unsigned char *source = pixels.constBits();
+	const int bytes_per_line = pixels.bytesPerLine();
+	TaskExecutor::Instance()->ParallelFor(int64_t(tiled->tiles_x) * tiled->tiles_y, [&](int64_t begin, int64_t end) {
+		for (int64_t index = begin; index < end; ++index) {
+			const int tile_x = int(index % tiled->tiles_x);
+			const int tile_y = int(index / tiled->tiles_x);
+			int tile_width, tile_height;
+			tiled->tile_size(tile_x, tile_y, tile_width, tile_height);
+			const unsigned char *corner = source + int64_t(tile_y) * TILE_SIZE * bytes_per_line + int64_t(tile_x) * TILE_BYTES_PER_LINE;
+
+			// Fully transparent tiles stay unallocated (premultiplied pixels are transparent if their alpha is 0)
+			bool transparent = true;
+			for (int y = 0; y < tile_height && transparent; ++y) {
+				const unsigned char *row = corner + int64_t(y) * bytes_per_line;
+				for (int x = 0; x < tile_width; ++x)
+					transparent &= (row[x * 4 + 3] == 0);
+			}
+			if (transparent)
+				continue;
+
+			unsigned char *tile = tiled->Tile(tile_x, tile_y);
+			for (int y = 0; y < tile_height; ++y)
+				std::memcpy(tile + y * TILE_BYTES_PER_LINE, corner + int64_t(y) * bytes_per_line, size_t(tile_width) * 4);
+		}
+	});
+	return tiled;
+}
+
+// Convert to a (contiguous) premultiplied RGBA8888 QImage
+std::shared_ptr<QImage> TiledImage::ToImage() const
+{
+	std::shared_ptr<QImage> image = ImageBufferPool::Instance()->CreateImage(width, height, QImage::Format_RGBA8888_Premultiplied);
+	unsigned char *target = image->bits();
+	const int bytes_per_line = image->bytesPerLine();
+
+	// Copy each row of the image (from each of the tiles it crosses)
+	TaskExecutor::Instance()->ParallelFor(height, [&](int64_t begin, int64_t end) {
+		for (int64_t y = begin; y < end; ++y) {
+			unsigned char *row = target + y * bytes_per_line;
+			const int tile_y = int(y / TILE_SIZE);
+			const int tile_row = int(y % TILE_SIZE);
+			for (int tile_x = 0; tile_x < tiles_x; ++tile_x) {
+				const int tile_width = std::min(TILE_SIZE, width - tile_x * TILE_SIZE);
+				unsigned char *segment = row + int64_t(tile_x) * TILE_BYTES_PER_LINE;
+				const unsigned char *tile = ConstTile(tile_x, tile_y);
+				if (tile)
+					std::memcpy(segment, tile + tile_row * TILE_BYTES_PER_LINE, size_t(tile_width) * 4);
+				else
+					fill_pixels(segment, background, tile_width);
+			}
+		}
+	});
+	return image;
+}
+
+// Get the number of allocated tiles
+int64_t TiledImage::AllocatedTiles() const
+{
+	return std::count_if(tiles.begin(), tiles.end(), [](const std::shared_ptr<std::vector<unsigned char>>& tile) { return tile != nullptr; });
+}
+
+// Get the pixels of a tile for reading
+const unsigned char* TiledImage::ConstTile(int tile_x, int tile_y) const
+{
+	const auto& tile = tiles[size_t(tile_y) * tiles_x + tile_x];
+	return tile ? tile->data() : nullptr;
+}
+
+// Get the pixels of a tile for writing
+unsigned char* TiledImage::Tile(int tile_x, int tile_y)
+{
+	auto& tile = tiles[size_t(tile_y) * tiles_x + tile_x];
+	if (!tile) {
+		// Allocate the tile (with the background color)
+		tile = std::make_shared<std::vector<unsigned char>>(size_t(TILE_SIZE) * TILE_BYTES_PER_LINE);
+		fill_pixels(tile->data(), background, int64_t(TILE_SIZE) * TILE_SIZE);
+	} else if (tile.use_count() > 1) {
+		// Copy the tile (which is shared with a copy of this image)
+		tile = std::make_shared<std::vector<unsigned char>>(*tile);
+	}
+	return tile->data();
+}
+
+// Get the buffers of the allocated tiles
+std::vector<std::pair<const void*, int64_t>> TiledImage::GetBuffers() const
+{
+	std::vector<std::pair<const void*, int64_t>> buffers;
+	for (const auto& tile : tiles) {
+		if (tile)
+			buffers.emplace_back(tile->data(), int64_t(tile->size()));
+	}
+	return buffers;
+}
+
+// Run a kernel on every allocated tile
+void TiledImage::ForEachTile(const std::function<void(unsigned char *pixels, int x, int y, int width, int height)>& kernel)
+{
+	TaskExecutor::Instance()->ParallelFor(int64_t(tiles_x) * tiles_y, [&](int64_t begin, int64_t end) {
+		for (int64_t index = begin; index < end; ++index) {
+			if (!tiles[index])
+				continue;
+			const int tile_x = int(index % tiles_x);
+			const int tile_y = int(index / tiles_x);
+			int tile_width, tile_height;
+			tile_size(tile_x, tile_y, tile_width, tile_height);
+			kernel(Tile(tile_x, tile_y), tile_x * TILE_SIZE, tile_y * TILE_SIZE, tile_width, tile_height);
+		}
+	});
+}
+
+// Composite layers onto this image
+void TiledImage::Composite(const std::vector<PixelLayer>& layers)
+{
+	if (layers.empty())
+		return;
+
+	TaskExecutor::Instance()->ParallelFor(int64_t(tiles_x) * tiles_y, [&](int64_t begin, int64_t end) {
+		std::vector<PixelLayer> tile_layers;
+		for (int64_t index = begin; index < end; ++index) {
+			const int tile_x = int(index % tiles_x);
+			const int tile_y = int(index / tiles_x);
+			const int tile_left = tile_x * TILE_SIZE;
+			const int tile_top = tile_y * TILE_SIZE;
+			int tile_width, tile_height;
+			tile_size(tile_x, tile_y, tile_width, tile_height);
+
+			// The layers which cover this tile (relative to the tile)
+			tile_layers.clear();
+			for (const PixelLayer &layer : layers) {
+				if ((!layer.pixels && !layer.solid) || layer.x >= tile_left + tile_width || layer.x + layer.width <= tile_left ||
+					layer.y >= tile_top + tile_height || layer.y + layer.height <= tile_top)
+					continue;
+				PixelLayer tile_layer = layer;
+				tile_layer.x -= tile_left;
+				tile_layer.y -= tile_top;
+				tile_layers.push_back(tile_layer);
+			}
+			if (tile_layers.empty())
+				continue;
+
+			PixelKernels::Composite(Tile(tile_x, tile_y), tile_width, tile_height, TILE_BYTES_PER_LINE, tile_layers);
+		}
+	});
+}
@@ -0,0 +1,129 @@
+/**
+ * @file
+ * @brief Header file for TiledImage class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_TILED_IMAGE_H
+#define OPENSHOT_TILED_IMAGE_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <QColor>
+
+class QImage;
+
+namespace openshot {
+
+	// Forward decl
+	struct PixelLayer;
+
+	/**
+	 * @brief This class holds a premultiplied RGBA8888 image as square tiles (i.e. a very large timeline canvas)
+	 *
+	 * A single 8K image is a 130 MB buffer, and compositing each layer over the whole of it thrashes the CPU
+	 * caches. A tiled image is stored as TILE_SIZE x TILE_SIZE tiles instead, which are processed one tile at a
+	 * time (and in parallel). Tiles are only allocated once they are written, and tiles which were never
+	 * written are the background color, so sparse content (i.e. a transparent overlay, or a small clip on a
+	 * large canvas) only allocates the tiles it covers.
+	 *
+	 * Copies of a tiled image share their tiles, until either image writes them (copy-on-write). The image is
+	 * only converted to a QImage at API boundaries, see Frame::AddTiledImage() and Frame::GetImage().
+	 *
+	 * \code
+	 * // Composite layers onto a transparent 8K canvas (only the tiles covered by a layer are allocated)
+	 * auto canvas = std::make_shared<TiledImage>(7680, 4320);
+	 * canvas->Composite(layers);
+	 * frame->AddTiledImage(canvas);
+	 * \endcode
+	 */
+	class TiledImage {
+	public:
+		/// The width and height of each tile (in pixels)
+		static constexpr int TILE_SIZE = 256;
+
+		/// The number of bytes of each row of a tile
+		static constexpr int TILE_BYTES_PER_LINE = TILE_SIZE * 4;
+
+	private:
+		int width;
+		int height;
+		int tiles_x;
+		int tiles_y;
+		unsigned char background[4]; ///< The premultiplied RGBA8888 color of the tiles which are not allocated
+		std::vector<std::shared_ptr<std::vector<unsigned char>>> tiles; ///< The tiles, row by row (nullptr = background)
+
+		/// Get the size of a tile (the tiles of the right and bottom edges can be smaller)
+		void tile_size(int tile_x, int tile_y, int& tile_width, int& tile_height) const;
+
+	public:
+		/// @brief Constructor (all tiles are the background color, and none of them are allocated)
+		/// @param width The width of the image
+		/// @param height The height of the image
+		/// @param background The color of the tiles which are not written
+		TiledImage(int width, int height, const QColor& background = QColor(Qt::transparent));
+
+		/// @brief Create a tiled image from a QImage (fully transparent tiles are not allocated)
+		/// @param image The image (which is converted to premultiplied RGBA8888, if needed)
+		static std::shared_ptr<TiledImage> FromImage(const QImage& image);
+
+		/// Convert to a (contiguous) premultiplied RGBA8888 QImage
+		std::shared_ptr<QImage> ToImage() const;
+
+		/// Get the width of the image
+		int Width() const { return width; };
+
+		/// Get the height of the image
+		int Height() const { return height; };
+
+		/// Get the number of tile columns
+		int TilesX() const { return tiles_x; };
+
+		/// Get the number of tile rows
+		int TilesY() const { return tiles_y; };
+
+		/// Get the number of allocated tiles
+		int64_t AllocatedTiles() const;
+
+		/// @brief Get the pixels of a tile for reading (TILE_BYTES_PER_LINE bytes per row)
+		/// @returns The pixels, or nullptr if the tile is not allocated (i.e. it is the background color)
+		const unsigned char* ConstTile(int tile_x, int tile_y) const;
+
+		/// @brief Get the pixels of a tile for writing (TILE_BYTES_PER_LINE bytes per row)
+		///
+		/// The tile is allocated (and filled with the background color) if needed, and copied first if it is
+		/// shared with a copy of this image. Different tiles can be written by different threads at once.
+		unsigned char* Tile(int tile_x, int tile_y);
+
+		/// Get the buffers of the allocated tiles, and the size of each one in bytes (see Frame::GetBuffers)
+		std::vector<std::pair<const void*, int64_t>> GetBuffers() const;
+
+		/// @brief Run a kernel on every allocated tile (on multiple threads)
+		///
+		/// Point-wise kernels which keep transparent pixels transparent (i.e. the color effects of PixelKernels)
+		/// don't need to visit the other tiles, when the background is transparent.
+		/// @param kernel The kernel, which is called with the pixels (TILE_BYTES_PER_LINE bytes per row), the position
+		/// and the size of each tile
+		void ForEachTile(const std::function<void(unsigned char *pixels, int x, int y, int width, int height)>& kernel);
+
+		/// @brief Composite layers onto this image, in order (with premultiplied alpha "source over")
+		///
+		/// Each tile blends all of the layers which cover it at once (on multiple threads), and only the tiles
+		/// covered by a layer are allocated. See PixelKernels::Composite().
+		/// @param layers The layers (the first layer is blended first, i.e. it is at the bottom)
+		void Composite(const std::vector<openshot::PixelLayer>& layers);
+	};
+
+}
+
+#endif
@@ -12,26 +12,50 @@
 
 #include "Timeline.h"
 
+#include "AllocationStats.h"
 #include "CacheBase.h"
+#include "CacheBudget.h"
 #include "CacheDisk.h"
 #include "CacheMemory.h"
+#include "Calibration.h"
 #include "CrashHandler.h"
 #include "FrameMapper.h"
 #include "Exceptions.h"
+#include "FrameRequest.h"
+#include "GpuCompositor.h"
+#include "ImageBufferPool.h"
+#include "PixelKernels.h"
+#include "RenderCache.h"
+#include "RenderGraph.h"
+#include "RenderStats.h"
+#include "RenderTrace.h"
+#include "Settings.h"
+#include "TiledImage.h"
+#include "ZmqLogger.h"
 
 #include <QDir>
 #include <QFileInfo>
 
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+
 using namespace openshot;
 
 // Default Constructor for the timeline (which sets the canvas width and height)
 Timeline::Timeline(int width, int height, Fraction fps, int sample_rate, int channels, ChannelLayout channel_layout) :
-		is_open(false), auto_map_clips(true), managed_cache(true), path(""),
-		max_concurrent_frames(OPEN_MP_NUM_PROCESSORS), max_time(0.0)
+		is_open(false), auto_map_clips(true), audio_only(false), managed_cache(true), path(""),
+		max_concurrent_frames(OPEN_MP_NUM_PROCESSORS), max_time(0.0), rendering_frames(0),
+		clip_ranges_dirty(true), clip_ranges_fps(0.0), clip_effect_ids_dirty(true),
+		update_depth(0), clips_unsorted(false), effects_unsorted(false)
 {
 	// Create CrashHandler and Attach (incase of errors)
 	CrashHandler::Instance();
 
+	// Init final cache as NULL (it is created below)
+	final_cache = NULL;
+
 	// Init viewport size (curve based, because it can be animated)
 	viewport_scale = Keyframe(100.0);
 	viewport_x = Keyframe(0.0);
@@ -65,9 +89,10 @@ Timeline::Timeline(int width, int height, Fraction fps, int sample_rate, int cha
 	// Init max image size
 	SetMaxSize(info.width, info.height);
 
-	// Init cache
-	final_cache = new CacheMemory();
-	final_cache->SetMaxBytesFromInfo(max_concurrent_frames * 4, info.width, info.height, info.sample_rate, info.channels);
+	// Init cache (which keeps the frames nearest to the playhead, during playback)
+	final_cache = create_final_cache();
+	mixed_audio_cache = std::make_unique<CacheMemory>();
+	mixed_image_cache = std::make_unique<CacheMemory>();
 }
 
 // Delegating constructor that copies parameters from a provided ReaderInfo
@@ -77,8 +102,10 @@ Timeline::Timeline(const ReaderInfo info) : Timeline::Timeline(
 
 // Constructor for the timeline (which loads a JSON structure from a file path, and initializes a timeline)
 Timeline::Timeline(const std::string& projectPath, bool convert_absolute_paths) :
-		is_open(false), auto_map_clips(true), managed_cache(true), path(projectPath),
-		max_concurrent_frames(OPEN_MP_NUM_PROCESSORS), max_time(0.0) {
+		is_open(false), auto_map_clips(true), audio_only(false), managed_cache(true), path(projectPath),
+		max_concurrent_frames(OPEN_MP_NUM_PROCESSORS), max_time(0.0), rendering_frames(0),
+		clip_ranges_dirty(true), clip_ranges_fps(0.0), clip_effect_ids_dirty(true),
+		update_depth(0), clips_unsorted(false), effects_unsorted(false) {
 
 	// Create CrashHandler and Attach (incase of errors)
 	CrashHandler::Instance();
@@ -121,55 +148,109 @@ Timeline::Timeline(const std::string& projectPath, bool convert_absolute_paths)
 		asset_folder.mkpath(".");
 	}
 
-	// Load UTF-8 project file into QString
+	// Find the absolute path of a path or image reference (including special replacements of @assets and @transitions)
+	auto absolute_project_path = [&](QString relativePath) {
+		if (relativePath.startsWith("@assets")) {
+			return QFileInfo(asset_folder.absoluteFilePath(relativePath.replace("@assets", "."))).canonicalFilePath();
+		} else if (relativePath.startsWith("@transitions")) {
+			return QFileInfo(openshotTransPath.absoluteFilePath(relativePath.replace("@transitions", "."))).canonicalFilePath();
+		} else {
+			return QFileInfo(filePath.absoluteDir().absoluteFilePath(relativePath)).canonicalFilePath();
+		}
+	};
+
+	// Load project file
 	QFile projectFile(QString::fromStdString(path));
 	projectFile.open(QFile::ReadOnly);
-	QString projectContents = QString::fromUtf8(projectFile.readAll());
-
-	// Convert all relative paths into absolute paths (if requested)
-	if (convert_absolute_paths) {
-
-		// Find all "image" or "path" references in JSON (using regex). Must loop through match results
-		// due to our path matching needs, which are not possible with the QString::replace() function.
-		QRegularExpression allPathsRegex(QStringLiteral("\"(image|path)\":.*?\"(.*?)\""));
-		std::vector<QRegularExpressionMatch> matchedPositions;
-		QRegularExpressionMatchIterator i = allPathsRegex.globalMatch(projectContents);
-		while (i.hasNext()) {
-			QRegularExpressionMatch match = i.next();
-			if (match.hasMatch()) {
-				// Push all match objects into a vector (so we can reverse them later)
-				matchedPositions.push_back(match);
-			}
+	QByteArray projectBytes = projectFile.readAll();
+
+	if (openshot::isBinaryJson(projectBytes.left(8).toStdString())) {
+		// Binary project (see Binary())
+		Json::Value root;
+		try
+		{
+			root = openshot::binaryToJson(projectBytes.toStdString());
+		}
+		catch (const std::exception& e)
+		{
+			throw InvalidJSON("Binary project data is invalid", path);
+		}
+		projectBytes.clear();
+
+		// Convert all relative paths into absolute paths (if requested)
+		if (convert_absolute_paths) {
+			std::function<void(Json::Value&)> convert_paths = [&](Json::Value& value) {
+				if (value.isArray()) {
+					for (auto& item : value)
+						convert_paths(item);
+				} else if (value.isObject()) {
+					for (auto it = value.begin(); it != value.end(); it++) {
+						if ((it.name() == "image" || it.name() == "path") && it->isString()) {
+							QString absolutePath = absolute_project_path(QString::fromStdString(it->asString()));
+							if (!absolutePath.isEmpty())
+								*it = absolutePath.toStdString();
+						} else {
+							convert_paths(*it);
+						}
+					}
+				}
+			};
+			convert_paths(root);
 		}
 
-		// Reverse the matches (bottom of file to top, so our replacements don't break our match positions)
-		std::vector<QRegularExpressionMatch>::reverse_iterator itr;
-		for (itr = matchedPositions.rbegin(); itr != matchedPositions.rend(); itr++) {
-			QRegularExpressionMatch match = *itr;
-			QString relativeKey = match.captured(1); // image or path
-			QString relativePath = match.captured(2); // relative file path
-			QString absolutePath = "";
-
-			// Find absolute path of all path, image (including special replacements of @assets and @transitions)
-			if (relativePath.startsWith("@assets")) {
-				absolutePath = QFileInfo(asset_folder.absoluteFilePath(relativePath.replace("@assets", "."))).canonicalFilePath();
-			} else if (relativePath.startsWith("@transitions")) {
-				absolutePath = QFileInfo(openshotTransPath.absoluteFilePath(relativePath.replace("@transitions", "."))).canonicalFilePath();
-			} else {
-				absolutePath = QFileInfo(filePath.absoluteDir().absoluteFilePath(relativePath)).canonicalFilePath();
+		// Set JSON of project
+		try
+		{
+			SetJsonValue(root);
+		}
+		catch (const std::exception& e)
+		{
+			// Error parsing JSON (or missing keys)
+			throw InvalidJSON("JSON is invalid (missing keys or invalid data types)");
+		}
+	} else {
+		// Load UTF-8 project file into QString
+		QString projectContents = QString::fromUtf8(projectBytes);
+		projectBytes.clear();
+
+		// Convert all relative paths into absolute paths (if requested)
+		if (convert_absolute_paths) {
+
+			// Find all "image" or "path" references in JSON (using regex). Must loop through match results
+			// due to our path matching needs, which are not possible with the QString::replace() function.
+			QRegularExpression allPathsRegex(QStringLiteral("\"(image|path)\":.*?\"(.*?)\""));
+			std::vector<QRegularExpressionMatch> matchedPositions;
+			QRegularExpressionMatchIterator i = allPathsRegex.globalMatch(projectContents);
+			while (i.hasNext()) {
+				QRegularExpressionMatch match = i.next();
+				if (match.hasMatch()) {
+					// Push all match objects into a vector (so we can reverse them later)
+					matchedPositions.push_back(match);
+				}
 			}
 
-			// Replace path in JSON content, if an absolute path was successfully found
-			if (!absolutePath.isEmpty()) {
-				projectContents.replace(match.capturedStart(0), match.capturedLength(0), "\"" + relativeKey + "\": \"" + absolutePath + "\"");
+			// Reverse the matches (bottom of file to top, so our replacements don't break our match positions)
+			std::vector<QRegularExpressionMatch>::reverse_iterator itr;
+			for (itr = matchedPositions.rbegin(); itr != matchedPositions.rend(); itr++) {
+				QRegularExpressionMatch match = *itr;
+				QString relativeKey = match.captured(1); // image or path
+				QString relativePath = match.captured(2); // relative file path
+
+				// Find absolute path of all path, image (including special replacements of @assets and @transitions)
+				QString absolutePath = absolute_project_path(relativePath);
+
+				// Replace path in JSON content, if an absolute path was successfully found
+				if (!absolutePath.isEmpty()) {
+					projectContents.replace(match.capturedStart(0), match.capturedLength(0), "\"" + relativeKey + "\": \"" + absolutePath + "\"");
+				}
 			}
+			// Clear matches
+			matchedPositions.clear();
 		}
-		// Clear matches
-		matchedPositions.clear();
-	}
 
-	// Set JSON of project
-	SetJson(projectContents.toStdString());
+		// Set JSON of project
+		SetJson(projectContents.toStdString());
+	}
 
 	// Calculate valid duration and set has_audio and has_video
 	// based on content inside this Timeline's clips.
@@ -198,9 +279,10 @@ Timeline::Timeline(const std::string& projectPath, bool convert_absolute_paths)
 	// Init max image size
 	SetMaxSize(info.width, info.height);
 
-	// Init cache
-	final_cache = new CacheMemory();
-	final_cache->SetMaxBytesFromInfo(max_concurrent_frames * 4, info.width, info.height, info.sample_rate, info.channels);
+	// Init cache (which keeps the frames nearest to the playhead, during playback)
+	final_cache = create_final_cache();
+	mixed_audio_cache = std::make_unique<CacheMemory>();
+	mixed_image_cache = std::make_unique<CacheMemory>();
 }
 
 Timeline::~Timeline() {
@@ -217,6 +299,139 @@ Timeline::~Timeline() {
 		delete final_cache;
 		final_cache = NULL;
 	}
+	clear_preview_caches();
+}
+
+// Create the final cache (which keeps the frames nearest to the playhead, during playback)
+CacheBase* Timeline::create_final_cache()
+{
+	CacheMemory *memory_cache = new CacheMemory();
+	memory_cache->SetEvictionPolicy(CACHE_EVICT_PLAYHEAD);
+	memory_cache->SetBudgetPriority(1); // Evicted after the frames of the readers (see CacheBudget)
+	memory_cache->SetLockFreeLookup(true); // Cache hits during playback don't wait for frames being added
+	if (Settings::Instance()->CACHE_COMPRESSED_HOT_FRAMES > 0)
+		memory_cache->SetCompression(true, Settings::Instance()->CACHE_COMPRESSED_HOT_FRAMES);
+	memory_cache->SetMaxBytesFromInfo(max_concurrent_frames * 4, info.width, info.height, info.sample_rate, info.channels);
+	return memory_cache;
+}
+
+// Change the preview size and quality (and switch to the cached frames of those settings, if any)
+void Timeline::set_preview_settings(int width, int height, RenderQuality quality)
+{
+	if (width == preview_width && height == preview_height && quality == render_quality)
+		return;
+
+	// Get lock (prevent getting frames while this happens)
+	std::unique_lock<std::recursive_mutex> guard(getFrameMutex);
+	wait_for_rendering(guard);
+
+	if (managed_cache && final_cache) {
+		// Keep the cached frames of the old settings (most recently used first)
+		if (final_cache->Count() > 0)
+			preview_caches.push_front({preview_width, preview_height, render_quality, final_cache});
+		else
+			delete final_cache;
+		final_cache = nullptr;
+
+		// Re-use the cached frames of the new settings (if any)
+		for (auto preview_cache = preview_caches.begin(); preview_cache != preview_caches.end(); preview_cache++) {
+			if (preview_cache->width == width && preview_cache->height == height && preview_cache->quality == quality) {
+				final_cache = preview_cache->cache;
+				preview_caches.erase(preview_cache);
+				break;
+			}
+		}
+		if (!final_cache)
+			final_cache = create_final_cache();
+
+		// Drop the cached frames of the least recently used settings
+		while (preview_caches.size() > MAX_PREVIEW_CACHES) {
+			delete preview_caches.back().cache;
+			preview_caches.pop_back();
+		}
+	}
+
+	preview_width = width;
+	preview_height = height;
+	render_quality = quality;
+	{
+		const std::lock_guard<std::mutex> lock(staticFrameMutex);
+		static_frame = nullptr;
+	}
+	if (mixed_image_cache)
+		mixed_image_cache->Clear();
+}
+
+// Get a frame of the current preview size, by scaling down a cached frame of a larger size (if any)
+std::shared_ptr<Frame> Timeline::get_scaled_cached_frame(int64_t number)
+{
+	// The smallest cached frame which is at least as large as the preview
+	std::shared_ptr<Frame> source;
+	for (const auto& preview_cache : preview_caches) {
+		if (preview_cache.width < preview_width || preview_cache.height < preview_height)
+			continue;
+		if (preview_cache.quality == RENDER_QUALITY_DRAFT && render_quality != RENDER_QUALITY_DRAFT)
+			continue;
+		std::shared_ptr<Frame> cached = preview_cache.cache->GetFrame(number);
+		if (cached && cached->has_image_data && (!source || cached->GetWidth() < source->GetWidth()))
+			source = cached;
+	}
+	if (!source)
+		return nullptr;
+
+	// Scaling is much faster than rendering the frame again (the audio is shared)
+	auto frame = std::make_shared<Frame>(*source);
+	frame->AddImage(std::make_shared<QImage>(source->GetImage()->scaled(
+		preview_width, preview_height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation)));
+	final_cache->Add(frame);
+	return frame;
+}
+
+// Remove a range of frames from the final cache (and the cached frames of the other preview sizes)
+void Timeline::remove_cached_frames(int64_t start_frame, int64_t end_frame, bool video, bool audio)
+{
+	if (video != audio) {
+		// Keep the mixed audio (if only the images changed) or the image (if only the audio changed) of each
+		// cached frame. These are only kept as long as the final cache would have kept the frames.
+		mixed_audio_cache->SetMaxBytes(final_cache->GetMaxBytes());
+		mixed_image_cache->SetMaxBytes(final_cache->GetMaxBytes());
+		for (int64_t number = std::max(start_frame, int64_t(1)); number <= end_frame; number++) {
+			if (!final_cache->Contains(number))
+				continue;
+			std::shared_ptr<Frame> frame = final_cache->GetFrame(number);
+			if (!frame)
+				continue;
+
+			if (!video && frame->has_image_data) {
+				mixed_image_cache->Add(frame);
+			} else if (!audio) {
+				auto mixed_audio = std::make_shared<Frame>(number, frame->GetAudioSamplesCount(), frame->GetAudioChannelsCount());
+				mixed_audio->SampleRate(frame->SampleRate());
+				mixed_audio->ChannelsLayout(frame->ChannelsLayout());
+				for (int channel = 0; channel < frame->GetAudioChannelsCount(); channel++)
+					mixed_audio->AddAudio(true, channel, 0, frame->GetAudioSamples(channel), frame->GetAudioSamplesCount(), 1.0);
+				mixed_audio_cache->Add(mixed_audio);
+			}
+		}
+	}
+
+	final_cache->Remove(start_frame, end_frame);
+	for (const auto& preview_cache : preview_caches)
+		preview_cache.cache->Remove(start_frame, end_frame);
+	if (video)
+		mixed_image_cache->Remove(start_frame, end_frame);
+	if (audio)
+		mixed_audio_cache->Remove(start_frame, end_frame);
+}
+
+// Delete the cached frames of the other preview sizes
+void Timeline::clear_preview_caches()
+{
+	// Get lock (frames are scaled from these caches while it is held)
+	const std::lock_guard<std::recursive_mutex> guard(getFrameMutex);
+	for (const auto& preview_cache : preview_caches)
+		delete preview_cache.cache;
+	preview_caches.clear();
 }
 
 // Add to the tracked_objects map a pointer to a tracked object (TrackedObjectBBox)
@@ -328,15 +543,79 @@ std::string Timeline::GetTrackedObjectValues(std::string id, int64_t frame_numbe
 }
 #endif
 
+// Remove an object from a lookup by id
+template <class T>
+static void remove_id(std::unordered_multimap<std::string, T*>& ids, const std::string& id, const T* object)
+{
+	auto range = ids.equal_range(id);
+	for (auto entry = range.first; entry != range.second; entry++) {
+		if (entry->second == object) {
+			ids.erase(entry);
+			return;
+		}
+	}
+}
+
+// Re-key an object of a lookup by id (after its id changed)
+template <class T>
+static void rename_id(std::unordered_multimap<std::string, T*>& ids, const std::string& old_id, const ClipBase* object)
+{
+	auto range = ids.equal_range(old_id);
+	for (auto entry = range.first; entry != range.second; entry++) {
+		if (entry->second == object) {
+			T* value = entry->second;
+			ids.erase(entry);
+			ids.emplace(value->Id(), value);
+			return;
+		}
+	}
+}
+
 // Add an openshot::Clip to the timeline
 void Timeline::AddClip(Clip* clip)
 {
 	// Get lock (prevent getting frames while this happens)
-	const std::lock_guard<std::recursive_mutex> guard(getFrameMutex);
+	std::unique_lock<std::recursive_mutex> guard(getFrameMutex);
+	wait_for_rendering(guard);
 
 	// Assign timeline to clip
 	clip->ParentTimeline(this);
 
+	// Prepare the clip (or wait until the update is done)
+	if (update_depth > 0)
+		pending_clips.push_back(clip);
+	else
+		prepare_added_clip(clip);
+
+	// Add clip to list
+	clips.push_back(clip);
+	{
+		const std::lock_guard<std::mutex> lock(idsMutex);
+		clip_ids.emplace(clip->Id(), clip);
+		clip_effect_ids_dirty = true;
+	}
+
+	// Sort clips
+	sort_clips();
+}
+
+// Add many clips to the timeline (and sort them once)
+void Timeline::AddClips(const std::vector<openshot::Clip*>& new_clips)
+{
+	BeginUpdate();
+	try {
+		for (auto clip : new_clips)
+			AddClip(clip);
+	} catch (...) {
+		EndUpdate();
+		throw;
+	}
+	EndUpdate();
+}
+
+// Prepare a clip which was added to the timeline
+void Timeline::prepare_added_clip(Clip* clip)
+{
 	// Clear cache of clip and nested reader (if any)
 	if (clip->Reader() && clip->Reader()->GetCache())
 		clip->Reader()->GetCache()->Clear();
@@ -347,21 +626,58 @@ void Timeline::AddClip(Clip* clip)
 		apply_mapper_to_clip(clip);
 	}
 
-	// Add clip to list
-	clips.push_back(clip);
+	// Disable video decoding (if only rendering audio)
+	apply_audio_only_to_clip(clip, audio_only);
+}
 
-	// Sort clips
-	sort_clips();
+// Start a batch of changes
+void Timeline::BeginUpdate()
+{
+	// Get lock (prevent getting frames while this happens)
+	std::unique_lock<std::recursive_mutex> guard(getFrameMutex);
+	wait_for_rendering(guard);
+
+	update_depth++;
+}
+
+// Finish a batch of changes (and sort and prepare the changed clips and effects)
+void Timeline::EndUpdate()
+{
+	// Get lock (prevent getting frames while this happens)
+	std::unique_lock<std::recursive_mutex> guard(getFrameMutex);
+	wait_for_rendering(guard);
+
+	if (update_depth == 0 || --update_depth > 0)
+		return;
+
+	// Prepare the clips added during the update (which are still on the timeline)
+	std::vector<Clip*> added_clips;
+	added_clips.swap(pending_clips);
+	for (auto clip : added_clips)
+		prepare_added_clip(clip);
+
+	if (clips_unsorted)
+		sort_clips();
+	if (effects_unsorted)
+		sort_effects();
 }
 
 // Add an effect to the timeline
 void Timeline::AddEffect(EffectBase* effect)
 {
+	// Get lock (prevent getting frames while this happens)
+	std::unique_lock<std::recursive_mutex> guard(getFrameMutex);
+	wait_for_rendering(guard);
+
 	// Assign timeline to effect
 	effect->ParentTimeline(this);
 
 	// Add effect to list
 	effects.push_back(effect);
+	{
+		const std::lock_guard<std::mutex> lock(idsMutex);
+		effect_ids.emplace(effect->Id(), effect);
+	}
 
 	// Sort effects
 	sort_effects();
@@ -370,7 +686,15 @@ void Timeline::AddEffect(EffectBase* effect)
 // Remove an effect from the timeline
 void Timeline::RemoveEffect(EffectBase* effect)
 {
+	// Get lock (prevent getting frames while this happens)
+	std::unique_lock<std::recursive_mutex> guard(getFrameMutex);
+	wait_for_rendering(guard);
+
 	effects.remove(effect);
+	{
+		const std::lock_guard<std::mutex> lock(idsMutex);
+		remove_id(effect_ids, effect->Id(), effect);
+	}
 
 	// Delete effect object (if timeline allocated it)
 	bool allocated = allocated_effects.count(effect);
@@ -388,9 +712,24 @@ void Timeline::RemoveEffect(EffectBase* effect)
 void Timeline::RemoveClip(Clip* clip)
 {
 	// Get lock (prevent getting frames while this happens)
-	const std::lock_guard<std::recursive_mutex> guard(getFrameMutex);
+	std::unique_lock<std::recursive_mutex> guard(getFrameMutex);
+	wait_for_rendering(guard);
 
 	clips.remove(clip);
+	clip_ranges_dirty = true;
+	pending_clips.erase(std::remove(pending_clips.begin(), pending_clips.end(), clip), pending_clips.end());
+	{
+		const std::lock_guard<std::mutex> lock(idsMutex);
+		remove_id(clip_ids, clip->Id(), clip);
+		clip_effect_ids_dirty = true;
+	}
+
+	// Stop preparing the clip in the background (if it is)
+	if (finish_preparing_clip(clip))
+		clip->Close();
+
+	// Restore video decoding (of readers disabled by audio-only mode)
+	apply_audio_only_to_clip(clip, false);
 	
 	// Delete clip object (if timeline allocated it)
 	bool allocated = allocated_clips.count(clip);
@@ -408,36 +747,58 @@ void Timeline::RemoveClip(Clip* clip)
 openshot::Clip* Timeline::GetClip(const std::string& id)
 {
 	// Find the matching clip (if any)
-	for (const auto& clip : clips) {
-		if (clip->Id() == id) {
-			return clip;
-		}
-	}
-	return nullptr;
+	const std::lock_guard<std::mutex> lock(idsMutex);
+	auto entry = clip_ids.find(id);
+	return entry != clip_ids.end() ? entry->second : nullptr;
 }
 
 // Look up a timeline effect
 openshot::EffectBase* Timeline::GetEffect(const std::string& id)
 {
 	// Find the matching effect (if any)
-	for (const auto& effect : effects) {
-		if (effect->Id() == id) {
-			return effect;
-		}
-	}
-	return nullptr;
+	const std::lock_guard<std::mutex> lock(idsMutex);
+	auto entry = effect_ids.find(id);
+	return entry != effect_ids.end() ? entry->second : nullptr;
 }
 
 openshot::EffectBase* Timeline::GetClipEffect(const std::string& id)
 {
-	// Search all clips for matching effect ID
-	for (const auto& clip : clips) {
-		const auto e = clip->GetEffect(id);
-		if (e != nullptr) {
-			return e;
+	const std::lock_guard<std::mutex> lock(idsMutex);
+
+	// Search all clips for their effect IDs (the first clip with an effect ID wins)
+	auto rebuild = [this]() {
+		clip_effect_ids.clear();
+		for (const auto& clip : clips) {
+			for (const auto& effect : clip->Effects())
+				clip_effect_ids.emplace(effect->Id(), clip);
 		}
+		clip_effect_ids_dirty = false;
+	};
+	auto find = [this](const std::string& id) -> EffectBase* {
+		auto entry = clip_effect_ids.find(id);
+		return entry != clip_effect_ids.end() ? entry->second->GetEffect(id) : nullptr;
+	};
+
+	// Clips add and remove their effects without the timeline knowing, so a missing (or moved)
+	// effect rebuilds the lookup once
+	const bool rebuilt = clip_effect_ids_dirty;
+	if (rebuilt)
+		rebuild();
+	EffectBase* effect = find(id);
+	if (!effect && !rebuilt) {
+		rebuild();
+		effect = find(id);
 	}
-	return nullptr;
+	return effect;
+}
+
+// Update the lookups by id of a clip or effect whose id changed
+void Timeline::UpdateId(ClipBase* object, const std::string& old_id)
+{
+	const std::lock_guard<std::mutex> lock(idsMutex);
+	rename_id(clip_ids, old_id, object);
+	rename_id(effect_ids, old_id, object);
+	clip_effect_ids_dirty = true;
 }
 
 // Return the list of effects on all clips
@@ -459,6 +820,78 @@ std::list<openshot::EffectBase*> Timeline::ClipEffects() const {
 	return timelineEffectsList;
 }
 
+// Get the time spent in each stage of rendering frames, as JSON
+std::string Timeline::GetRenderStats() {
+	Json::Value root = RenderStats::Instance()->JsonValue();
+
+	// Add the stats of each effect
+	const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+	root["effects"] = Json::Value(Json::objectValue);
+	std::list<EffectBase*> all_effects = ClipEffects();
+	all_effects.insert(all_effects.end(), effects.begin(), effects.end());
+	for (const auto& effect : all_effects) {
+		Json::Value effect_stats = effect->render_stats.JsonValue();
+		effect_stats["class_name"] = effect->info.class_name;
+		root["effects"][effect->Id()] = effect_stats;
+	}
+
+	// Return formatted string
+	return root.toStyledString();
+}
+
+// Forget the render stats
+void Timeline::ResetRenderStats() {
+	RenderStats::Instance()->Reset();
+
+	const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+	for (const auto& effect : ClipEffects())
+		effect->render_stats.Reset();
+	for (const auto& effect : effects)
+		effect->render_stats.Reset();
+}
+
+// Get the hit, miss and eviction counters of the timeline cache and the clip caches, as JSON
+std::string Timeline::CacheStatsJson() {
+	Json::Value root;
+	if (final_cache)
+		root["final_cache"] = final_cache->GetStats().JsonValue();
+
+	// Add the counters of each clip (its cache, and the caches of its readers)
+	const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+	CacheStats clips_total;
+	root["clips"] = Json::Value(Json::objectValue);
+	for (const auto& clip : clips) {
+		const CacheStats clip_stats = clip->GetCacheStats();
+		root["clips"][clip->Id()] = clip_stats.JsonValue();
+		clips_total += clip_stats;
+	}
+	root["clips_total"] = clips_total.JsonValue();
+
+	// Add the bytes held by all caches together (see CacheBudget)
+	root["budget"]["bytes"] = Json::Int64(CacheBudget::Instance()->GetBytes());
+	root["budget"]["max_bytes"] = Json::Int64(CacheBudget::Instance()->GetMaxBytes());
+
+	// Return formatted string
+	return root.toStyledString();
+}
+
+// Reset the cache counters (of the timeline cache and the clip caches)
+void Timeline::ResetCacheStats() {
+	if (final_cache)
+		final_cache->ResetStats();
+
+	const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+	for (const auto& clip : clips)
+		clip->ResetCacheStats();
+}
+
+// Pass the sequential hint to the clips
+void Timeline::SetSequentialHint(bool sequential) {
+	const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+	for (const auto& clip : clips)
+		clip->SetSequentialHint(sequential);
+}
+
 // Compute the end time of the latest timeline element
 double Timeline::GetMaxTime() {
 	// Return cached max_time variable (threadsafe)
@@ -475,6 +908,9 @@ int64_t Timeline::GetMaxFrame() {
 // Apply a FrameMapper to a clip which matches the settings of this timeline
 void Timeline::apply_mapper_to_clip(Clip* clip)
 {
+	// Repeat or skip frames (or interpolate them, if enabled)
+	const PulldownType pulldown = Settings::Instance()->INTERPOLATE_FRAME_RATES ? PULLDOWN_INTERPOLATE : PULLDOWN_NONE;
+
 	// Determine type of reader
 	ReaderBase* clip_reader = NULL;
 	if (clip->Reader()->Name() == "FrameMapper")
@@ -484,12 +920,12 @@ void Timeline::apply_mapper_to_clip(Clip* clip)
 
 		// Update the mapping
 		FrameMapper* clip_mapped_reader = (FrameMapper*) clip_reader;
-		clip_mapped_reader->ChangeMapping(info.fps, PULLDOWN_NONE, info.sample_rate, info.channels, info.channel_layout);
+		clip_mapped_reader->ChangeMapping(info.fps, pulldown, info.sample_rate, info.channels, info.channel_layout);
 
 	} else {
 
 		// Create a new FrameMapper to wrap the current reader
-		FrameMapper* mapper = new FrameMapper(clip->Reader(), info.fps, PULLDOWN_NONE, info.sample_rate, info.channels, info.channel_layout);
+		FrameMapper* mapper = new FrameMapper(clip->Reader(), info.fps, pulldown, info.sample_rate, info.channels, info.channel_layout);
 		allocated_frame_mappers.insert(mapper);
 		clip_reader = (ReaderBase*) mapper;
 	}
@@ -512,6 +948,37 @@ void Timeline::ApplyMapperToClips()
 	}
 }
 
+// Disable (or restore) video decoding of a clip's reader
+void Timeline::apply_audio_only_to_clip(Clip* clip, bool disable_video)
+{
+	if (!clip->Reader())
+		return;
+
+	// Find the reader which actually decodes the file (i.e. the FFmpegReader of a FrameMapper)
+	ReaderBase* decoding_reader = clip->Reader();
+	try {
+		while (decoding_reader->Name() == "FrameMapper")
+			decoding_reader = static_cast<FrameMapper*>(decoding_reader)->Reader();
+	} catch (const ReaderClosed & e) {
+		return;
+	}
+
+	if (disable_video) {
+		// Disable video decoding (readers without audio are skipped anyway)
+		if (decoding_reader->info.has_audio && decoding_reader->info.has_video && !audio_only_readers.count(decoding_reader)) {
+			audio_only_readers[decoding_reader] = decoding_reader->info.has_video;
+			decoding_reader->info.has_video = false;
+		}
+	} else {
+		// Restore video decoding
+		auto found = audio_only_readers.find(decoding_reader);
+		if (found != audio_only_readers.end()) {
+			decoding_reader->info.has_video = found->second;
+			audio_only_readers.erase(found);
+		}
+	}
+}
+
 // Calculate time of a frame number, based on a framerate
 double Timeline::calculate_time(int64_t number, Fraction rate)
 {
@@ -526,7 +993,7 @@ double Timeline::calculate_time(int64_t number, Fraction rate)
 std::shared_ptr<Frame> Timeline::apply_effects(std::shared_ptr<Frame> frame, int64_t timeline_frame_number, int layer, TimelineInfoStruct* options)
 {
 	// Debug output
-	ZmqLogger::Instance()->AppendDebugMethod(
+	ZMQ_DEBUG(
 		"Timeline::apply_effects",
 		"frame->number", frame->number,
 		"timeline_frame_number", timeline_frame_number,
@@ -555,12 +1022,15 @@ std::shared_ptr<Frame> Timeline::apply_effects(std::shared_ptr<Frame> frame, int
 				continue; // skip effect, if this filter does not match
 
 			// Debug output
-			ZmqLogger::Instance()->AppendDebugMethod(
+			ZMQ_DEBUG(
 				"Timeline::apply_effects (Process Effect)",
 				"effect_frame_number", effect_frame_number,
 				"does_effect_intersect", does_effect_intersect);
 
 			// Apply the effect to this frame
+			RenderStageTimer timer(RENDER_STAGE_EFFECT, &effect->render_stats);
+			RenderTraceSpan span(effect->info.class_name, "effect");
+			AllocationScopeGuard allocations(ALLOCATION_SCOPE_EFFECT);
 			frame = effect->GetFrame(frame, effect_frame_number);
 		}
 
@@ -570,62 +1040,219 @@ std::shared_ptr<Frame> Timeline::apply_effects(std::shared_ptr<Frame> frame, int
 	return frame;
 }
 
-// Get or generate a blank frame
-std::shared_ptr<Frame> Timeline::GetOrCreateFrame(std::shared_ptr<Frame> background_frame, Clip* clip, int64_t number, openshot::TimelineInfoStruct* options)
+// Send the render stats over the ZmqLogger (every Settings::RENDER_STATS_LOG_FRAMES timeline frames)
+static void log_render_stats()
 {
-	std::shared_ptr<Frame> new_frame;
+	Settings *settings = Settings::Instance();
+	if (!settings->ENABLE_RENDER_STATS || settings->RENDER_STATS_LOG_FRAMES <= 0 || !ZmqLogger::Instance()->Enabled())
+		return;
+
+	RenderStats *stats = RenderStats::Instance();
+	const int64_t frames = stats->Stage(RENDER_STAGE_FRAME).count.load(std::memory_order_relaxed);
+	if (frames > 0 && frames % settings->RENDER_STATS_LOG_FRAMES == 0)
+		ZmqLogger::Instance()->Log("RenderStats: " + stats->Json());
+}
 
-	// Init some basic properties about this frame
-	int samples_in_frame = Frame::GetSamplesPerFrame(number, info.fps, info.sample_rate, info.channels);
+// Get a clip's frame (or nullptr, if its reader was just closed)
+void Timeline::render_layer(std::shared_ptr<Frame> new_frame, LayerRequest& layer, bool composite, bool audio_only)
+{
+	// Create timeline options (with details about this current frame request)
+	TimelineInfoStruct options;
+	options.is_top_clip = layer.is_top_clip;
+	options.is_before_clip_keyframes = true;
+	options.is_audio_only = this->audio_only || audio_only;
 
 	try {
 		// Debug output
-		ZmqLogger::Instance()->AppendDebugMethod(
-			"Timeline::GetOrCreateFrame (from reader)",
-			"number", number,
-			"samples_in_frame", samples_in_frame);
+		ZMQ_DEBUG(
+			"Timeline::render_layer (from reader)",
+			"clip_frame_number", layer.clip_frame_number,
+			"composite", composite);
+
+		// Re-use the clip's frame from the render cache (of this or a previous session)
+		const bool cache_layer = !composite && !options.is_audio_only && layer.render_key != 0;
+		if (cache_layer) {
+			layer.frame = RenderCache::Instance()->GetFrame(layer.render_key, layer.layer_rect);
+			if (layer.frame) {
+				layer.frame->number = layer.clip_frame_number;
+				if (layer.gpu_layer)
+					*layer.gpu_layer = GpuLayer(); // The cached image is already transformed (it is placed at its layer position)
+				return;
+			}
+		}
 
 		// Attempt to get a frame (but this could fail if a reader has just been closed)
-		new_frame = std::shared_ptr<Frame>(clip->GetFrame(background_frame, number, options));
+		if (composite)
+			layer.frame = layer.clip->GetFrame(new_frame, layer.clip_frame_number, &options);
+		else
+			layer.frame = layer.clip->GetLayerFrame(new_frame, layer.clip_frame_number, &options, layer.layer_rect, layer.gpu_layer.get());
 
-		// Return real frame
-		return new_frame;
+		// Store the clip's frame in the render cache (unless the GPU still has to transform it)
+		if (cache_layer && layer.frame &&
+			(!layer.gpu_layer || (!layer.gpu_layer->transformed && layer.gpu_layer->operations.empty())))
+			RenderCache::Instance()->Add(layer.render_key, layer.frame, layer.layer_rect);
 
 	} catch (const ReaderClosed & e) {
-		// ...
+		layer.frame = nullptr;
 	} catch (const OutOfBoundsFrame & e) {
-		// ...
+		layer.frame = nullptr;
 	}
+}
 
-	// Debug output
-	ZmqLogger::Instance()->AppendDebugMethod(
-		"Timeline::GetOrCreateFrame (create blank)",
-		"number", number,
-		"samples_in_frame", samples_in_frame);
+// Composite the rendered images of clips onto the timeline frame
+void Timeline::composite_layers(std::shared_ptr<Frame> new_frame, std::vector<LayerRequest>& layers, const QColor& tiled_background)
+{
+	std::vector<PixelLayer> pixel_layers;
+	std::vector<GpuLayer> gpu_layers;
+	for (auto& layer : layers) {
+		PixelLayer pixel_layer;
+		if (!layer.frame || !Clip::GetPixelLayer(layer.frame, layer.layer_rect, pixel_layer))
+			continue;
+		if (layer.gpu_layer) {
+			// The GPU transforms the clip's image (or places it at its layer position)
+			GpuLayer gpu_layer = *layer.gpu_layer;
+			gpu_layer.layer = pixel_layer;
+			if (!gpu_layer.transformed)
+				gpu_layer.transform = QTransform::fromTranslate(pixel_layer.x, pixel_layer.y);
+			gpu_layers.push_back(gpu_layer);
+		} else {
+			pixel_layers.push_back(pixel_layer);
+		}
+	}
+
+	RenderStageTimer timer(RENDER_STAGE_COMPOSITE);
+	if (tiled_background.isValid()) {
+		// Only the tiles covered by a clip are allocated (the frame's image is created from the tiles when needed)
+		auto canvas = std::make_shared<TiledImage>(new_frame->GetWidth(), new_frame->GetHeight(), tiled_background);
+		canvas->Composite(pixel_layers);
+		new_frame->AddTiledImage(canvas);
+	} else if (!gpu_layers.empty()) {
+		// Transform and composite the layers on the GPU. The whole canvas is read back, so it is not filled
+		// first (unless the background is not a solid color).
+		const QColor background = new_frame->GetSolidColor();
+		std::shared_ptr<QImage> canvas;
+		if (background.isValid())
+			canvas = ImageBufferPool::Instance()->CreateImage(new_frame->GetWidth(), new_frame->GetHeight(),
+															  QImage::Format_RGBA8888_Premultiplied);
+		else
+			canvas = std::make_shared<QImage>(*new_frame->GetImage());
+		if (!GpuCompositor::Instance()->Composite(*canvas, background, gpu_layers))
+			GpuCompositor::CompositeOnCpu(*canvas, background, gpu_layers);
+		new_frame->AddImage(canvas);
+	} else if (!pixel_layers.empty()) {
+		// The frame's image is only filled with the background color when a clip covers it
+		std::shared_ptr<QImage> canvas = new_frame->GetImage();
+		PixelKernels::Composite(canvas->bits(), canvas->width(), canvas->height(), canvas->bytesPerLine(), pixel_layers);
+	}
+}
+
+// Determine if the image of a timeline frame only depends on static clips
+bool Timeline::find_static_image(int64_t requested_frame, const std::vector<LayerRequest>& layers, StaticImage& static_image)
+{
+	// Effects (i.e. transitions) can change the image of every frame
+	for (auto effect : effects) {
+		long effect_start_position = round(effect->Position() * info.fps.ToDouble()) + 1;
+		long effect_end_position = round((effect->Position() + (effect->Duration())) * info.fps.ToDouble());
+		if (effect_start_position <= requested_frame && effect_end_position >= requested_frame)
+			return false;
+	}
 
-	// Create blank frame
-	return new_frame;
+	static_image.color = color.GetColorHex(requested_frame);
+	static_image.clip_images.clear();
+	static_image.top_clips.clear();
+	for (const auto& layer : layers) {
+		int64_t image_key = layer.clip->StaticImageKey(layer.clip_frame_number);
+		if (image_key == 0)
+			return false;
+		static_image.clip_images.emplace_back(layer.clip, image_key);
+		static_image.top_clips.push_back(layer.is_top_clip);
+	}
+	return true;
+}
+
+// Get the key of a clip's frame in the RenderCache
+uint64_t Timeline::layer_render_key(int64_t requested_frame, const LayerRequest& layer)
+{
+	// The size and format of the frames (and how they are decoded and rendered)
+	RenderKey key;
+	key.Add(std::string("Layer"));
+	key.Add(int64_t(preview_width));
+	key.Add(int64_t(preview_height));
+	key.Add(int64_t(info.fps.num));
+	key.Add(int64_t(info.fps.den));
+	key.Add(int64_t(info.sample_rate));
+	key.Add(int64_t(info.channels));
+	key.Add(int64_t(info.channel_layout));
+	key.Add(int64_t(render_quality));
+	key.Add(int64_t(Settings::Instance()->HIGH_BIT_DEPTH));
+	key.Add(int64_t(layer.is_top_clip));
+
+	// The clip's source and state
+	if (!layer.clip->AddRenderKey(key, layer.clip_frame_number))
+		return 0;
+
+	// The timeline effects applied to the clip (i.e. transitions on its layer, see apply_effects)
+	for (auto effect : effects) {
+		long effect_start_position = round(effect->Position() * info.fps.ToDouble()) + 1;
+		long effect_end_position = round((effect->Position() + (effect->Duration())) * info.fps.ToDouble());
+		if (effect_start_position > requested_frame || effect_end_position < requested_frame || effect->Layer() != layer.clip->Layer())
+			continue;
+
+		long effect_start_frame = (effect->Start() * info.fps.ToDouble()) + 1;
+		long effect_frame_number = requested_frame - effect_start_position + effect_start_frame;
+		Json::Value state = effect->JsonValue();
+		state.removeMember("id");
+		state.removeMember("layer");
+		state.removeMember("position");
+		key.Add(int64_t(effect_frame_number));
+		key.AddState(state, effect_frame_number);
+	}
+
+	return key.Value();
+}
+
+// Get the key of a composited timeline frame in the RenderCache
+uint64_t Timeline::frame_render_key(int64_t requested_frame, const std::vector<LayerRequest>& layers, float max_volume)
+{
+	RenderKey key;
+	key.Add(std::string("Timeline"));
+	key.Add(int64_t(preview_width));
+	key.Add(int64_t(preview_height));
+	key.Add(int64_t(info.fps.num));
+	key.Add(int64_t(info.fps.den));
+	key.Add(int64_t(info.sample_rate));
+	key.Add(int64_t(info.channels));
+	key.Add(int64_t(info.channel_layout));
+	key.Add(int64_t(render_quality));
+	key.Add(int64_t(Frame::GetSamplesPerFrame(requested_frame, info.fps, info.sample_rate, info.channels)));
+	key.Add(color.GetColorHex(requested_frame));
+	key.Add(double(max_volume));
+
+	// The clips, in layer order
+	key.Add(int64_t(layers.size()));
+	for (const auto& layer : layers) {
+		if (layer.render_key == 0)
+			return 0;
+		key.Add(int64_t(layer.render_key));
+	}
+	return key.Value();
 }
 
 // Process a new layer of video or audio
-void Timeline::add_layer(std::shared_ptr<Frame> new_frame, Clip* source_clip, int64_t clip_frame_number, bool is_top_clip, float max_volume)
+void Timeline::add_layer(std::shared_ptr<Frame> new_frame, LayerRequest& layer, float max_volume)
 {
-	// Create timeline options (with details about this current frame request)
-	TimelineInfoStruct* options = new TimelineInfoStruct();
-	options->is_top_clip = is_top_clip;
-	options->is_before_clip_keyframes = true;
+	RenderTraceSpan span("Timeline::add_layer", "composite");
 
-	// Get the clip's frame, composited on top of the current timeline frame
-	std::shared_ptr<Frame> source_frame;
-	source_frame = GetOrCreateFrame(new_frame, source_clip, clip_frame_number, options);
-	delete options;
+	Clip *source_clip = layer.clip;
+	int64_t clip_frame_number = layer.clip_frame_number;
+	std::shared_ptr<Frame> source_frame = layer.frame;
 
 	// No frame found... so bail
 	if (!source_frame)
 		return;
 
 	// Debug output
-	ZmqLogger::Instance()->AppendDebugMethod(
+	ZMQ_DEBUG(
 		"Timeline::add_layer",
 		"new_frame->number", new_frame->number,
 		"clip_frame_number", clip_frame_number);
@@ -633,7 +1260,7 @@ void Timeline::add_layer(std::shared_ptr<Frame> new_frame, Clip* source_clip, in
 	/* COPY AUDIO - with correct volume */
 	if (source_clip->Reader()->info.has_audio) {
 		// Debug output
-		ZmqLogger::Instance()->AppendDebugMethod(
+		ZMQ_DEBUG(
 			"Timeline::add_layer (Copy Audio)",
 			"source_clip->Reader()->info.has_audio", source_clip->Reader()->info.has_audio,
 			"source_frame->GetAudioChannelsCount()", source_frame->GetAudioChannelsCount(),
@@ -641,42 +1268,27 @@ void Timeline::add_layer(std::shared_ptr<Frame> new_frame, Clip* source_clip, in
 			"clip_frame_number", clip_frame_number);
 
 		if (source_frame->GetAudioChannelsCount() == info.channels && source_clip->has_audio.GetInt(clip_frame_number) != 0)
-			for (int channel = 0; channel < source_frame->GetAudioChannelsCount(); channel++)
-			{
-				// Get volume from previous frame and this frame
-				float previous_volume = source_clip->volume.GetValue(clip_frame_number - 1);
-				float volume = source_clip->volume.GetValue(clip_frame_number);
-				int channel_filter = source_clip->channel_filter.GetInt(clip_frame_number); // optional channel to filter (if not -1)
-				int channel_mapping = source_clip->channel_mapping.GetInt(clip_frame_number); // optional channel to map this channel to (if not -1)
-
-				// Apply volume mixing strategy
-				if (source_clip->mixing == VOLUME_MIX_AVERAGE && max_volume > 1.0) {
-					// Don't allow this clip to exceed 100% (divide volume equally between all overlapping clips with volume
-					previous_volume = previous_volume / max_volume;
-					volume = volume / max_volume;
-				}
-				else if (source_clip->mixing == VOLUME_MIX_REDUCE && max_volume > 1.0) {
-					// Reduce clip volume by a bit, hoping it will prevent exceeding 100% (but it is very possible it will)
-					previous_volume = previous_volume * 0.77;
-					volume = volume * 0.77;
-				}
-
-				// If channel filter enabled, check for correct channel (and skip non-matching channels)
-				if (channel_filter != -1 && channel_filter != channel)
-					continue; // skip to next channel
-
-				// If no volume on this frame or previous frame, do nothing
-				if (previous_volume == 0.0 && volume == 0.0)
-					continue; // skip to next channel
-
-				// If channel mapping disabled, just use the current channel
-				if (channel_mapping == -1)
-					channel_mapping = channel;
-
-				// Apply ramp to source frame (if needed)
-				if (!isEqual(previous_volume, 1.0) || !isEqual(volume, 1.0))
-					source_frame->ApplyGainRamp(channel_mapping, 0, source_frame->GetAudioSamplesCount(), previous_volume, volume);
+		{
+			// Get volume from previous frame and this frame (once, for all channels)
+			float previous_volume = source_clip->volume.GetValue(clip_frame_number - 1);
+			float volume = source_clip->volume.GetValue(clip_frame_number);
+			int channel_filter = source_clip->channel_filter.GetInt(clip_frame_number); // optional channel to filter (if not -1)
+			int channel_mapping = source_clip->channel_mapping.GetInt(clip_frame_number); // optional channel to map this channel to (if not -1)
+
+			// Apply volume mixing strategy
+			if (source_clip->mixing == VOLUME_MIX_AVERAGE && max_volume > 1.0) {
+				// Don't allow this clip to exceed 100% (divide volume equally between all overlapping clips with volume
+				previous_volume = previous_volume / max_volume;
+				volume = volume / max_volume;
+			}
+			else if (source_clip->mixing == VOLUME_MIX_REDUCE && max_volume > 1.0) {
+				// Reduce clip volume by a bit, hoping it will prevent exceeding 100% (but it is very possible it will)
+				previous_volume = previous_volume * 0.77;
+				volume = volume * 0.77;
+			}
 
+			// If no volume on this frame or previous frame, do nothing
+			if (previous_volume != 0.0 || volume != 0.0) {
 				// TODO: Improve FrameMapper (or Timeline) to always get the correct number of samples per frame.
 				// Currently, the ResampleContext sometimes leaves behind a few samples for the next call, and the
 				// number of samples returned is variable... and does not match the number expected.
@@ -685,13 +1297,24 @@ void Timeline::add_layer(std::shared_ptr<Frame> new_frame, Clip* source_clip, in
 					// Force timeline frame to match the source frame
 					new_frame->ResizeAudio(info.channels, source_frame->GetAudioSamplesCount(), info.sample_rate, info.channel_layout);
 				}
-				// Copy audio samples (and set initial volume).  Mix samples with existing audio samples.  The gains are added together, to
-				// be sure to set the gain's correctly, so the sum does not exceed 1.0 (of audio distortion will happen).
-				new_frame->AddAudio(false, channel_mapping, 0, source_frame->GetAudioSamples(channel), source_frame->GetAudioSamplesCount(), 1.0);
+
+				for (int channel = 0; channel < source_frame->GetAudioChannelsCount(); channel++)
+				{
+					// If channel filter enabled, check for correct channel (and skip non-matching channels)
+					if (channel_filter != -1 && channel_filter != channel)
+						continue; // skip to next channel
+
+					// Mix samples with existing audio samples, applying the volume ramp while mixing (the source frame
+					// is not changed). The gains are added together, to be sure to set the gain's correctly, so the sum
+					// does not exceed 1.0 (of audio distortion will happen).
+					new_frame->AddAudioRamp(channel_mapping == -1 ? channel : channel_mapping, 0, source_frame->GetAudioSamples(channel),
+											source_frame->GetAudioSamplesCount(), previous_volume, volume);
+				}
 			}
+		}
 		else
 			// Debug output
-			ZmqLogger::Instance()->AppendDebugMethod(
+			ZMQ_DEBUG(
 				"Timeline::add_layer (No Audio Copied - Wrong # of Channels)",
 				"source_clip->Reader()->info.has_audio",
 					source_clip->Reader()->info.has_audio,
@@ -702,7 +1325,7 @@ void Timeline::add_layer(std::shared_ptr<Frame> new_frame, Clip* source_clip, in
 	}
 
 	// Debug output
-	ZmqLogger::Instance()->AppendDebugMethod(
+	ZMQ_DEBUG(
 		"Timeline::add_layer (Transform: Composite Image Layer: Completed)",
 		"source_frame->number", source_frame->number,
 		"new_frame->GetImage()->width()", new_frame->GetWidth(),
@@ -715,12 +1338,15 @@ void Timeline::update_open_clips(Clip *clip, bool does_clip_intersect)
 	// Get lock (prevent getting frames while this happens)
 	const std::lock_guard<std::recursive_mutex> guard(getFrameMutex);
 
-	ZmqLogger::Instance()->AppendDebugMethod(
+	ZMQ_DEBUG(
 		"Timeline::update_open_clips (before)",
 		"does_clip_intersect", does_clip_intersect,
 		"closing_clips.size()", closing_clips.size(),
 		"open_clips.size()", open_clips.size());
 
+	// Wait for the clip, if it's being opened in the background (see prepare_upcoming_clips)
+	const bool clip_prepared = finish_preparing_clip(clip);
+
 	// is clip already in list?
 	bool clip_found = open_clips.count(clip);
 
@@ -729,25 +1355,41 @@ void Timeline::update_open_clips(Clip *clip, bool does_clip_intersect)
 		// Remove clip from 'opened' list, because it's closed now
 		open_clips.erase(clip);
 
-		// Close clip
-		clip->Close();
+		if (rendering_frames > 0)
+			// Other frames might still be compositing this clip, so
+			// defer closing it until they are finished
+			closing_clips.push_back(clip);
+		else
+			// Close clip
+			clip->Close();
 	}
 	else if (!clip_found && does_clip_intersect)
 	{
 		// Add clip to 'opened' list, because it's missing
 		open_clips[clip] = clip;
 
-		try {
-			// Open the clip
-			clip->Open();
+		// Is this clip still waiting to be closed? (if so, it was never closed)
+		auto closing_clip = std::find(closing_clips.begin(), closing_clips.end(), clip);
+		if (closing_clip != closing_clips.end()) {
+			closing_clips.erase(closing_clip);
+		} else {
+			try {
+				// Open the clip
+				clip->Open();
 
-		} catch (const InvalidFile & e) {
-			// ...
+			} catch (const InvalidFile & e) {
+				// ...
+			}
 		}
 	}
+	else if (clip_prepared && !does_clip_intersect)
+	{
+		// Close a prepared clip, which is no longer needed (i.e. after seeking)
+		clip->Close();
+	}
 
 	// Debug output
-	ZmqLogger::Instance()->AppendDebugMethod(
+	ZMQ_DEBUG(
 		"Timeline::update_open_clips (after)",
 		"does_clip_intersect", does_clip_intersect,
 		"clip_found", clip_found,
@@ -755,6 +1397,94 @@ void Timeline::update_open_clips(Clip *clip, bool does_clip_intersect)
 		"open_clips.size()", open_clips.size());
 }
 
+// Wait for a clip to be prepared in the background
+bool Timeline::finish_preparing_clip(Clip *clip)
+{
+	auto preparing_clip = preparing_clips.find(clip);
+	if (preparing_clip == preparing_clips.end())
+		return false;
+
+	preparing_clip->second.wait();
+	preparing_clips.erase(preparing_clip);
+	return true;
+}
+
+// Open (and pre-decode) the clips which start soon in the background
+void Timeline::prepare_upcoming_clips(int64_t max_requested_frame, const std::vector<Clip*>& intersecting_clips)
+{
+	// The clips which start within the look-ahead window (the clip ranges are sorted by start frame)
+	const int look_ahead = openshot::Settings::Instance()->CLIP_LOOK_AHEAD_FRAMES;
+	std::vector<ClipFrameRange> upcoming_clips;
+	if (look_ahead > 0 && !audio_only) {
+		auto range = std::upper_bound(clip_ranges.begin(), clip_ranges.end(), max_requested_frame,
+			[](int64_t frame, const ClipFrameRange& r) { return frame < r.start_frame; });
+		for (; range != clip_ranges.end() && range->start_frame <= max_requested_frame + look_ahead; ++range)
+			upcoming_clips.push_back(*range);
+	}
+	auto is_upcoming = [&upcoming_clips](Clip* clip) {
+		return std::find_if(upcoming_clips.begin(), upcoming_clips.end(),
+			[clip](const ClipFrameRange& r) { return r.clip == clip; }) != upcoming_clips.end();
+	};
+
+	// Close the prepared clips which no longer start soon (i.e. after seeking, or moving them)
+	std::vector<Clip*> dropped;
+	for (const auto& preparing_clip : preparing_clips) {
+		Clip *clip = preparing_clip.first;
+		if (!is_upcoming(clip) && std::find(intersecting_clips.begin(), intersecting_clips.end(), clip) == intersecting_clips.end())
+			dropped.push_back(clip);
+	}
+	for (auto clip : dropped)
+		update_open_clips(clip, false);
+
+	// Open each upcoming clip on a background thread, and decode its first frames (into the caches of its reader).
+	// These are not shared worker threads, since rendering waits for them while holding getFrameMutex.
+	for (const ClipFrameRange& upcoming : upcoming_clips) {
+		Clip *clip = upcoming.clip;
+		if (open_clips.count(clip) || preparing_clips.count(clip) ||
+			std::find(closing_clips.begin(), closing_clips.end(), clip) != closing_clips.end())
+			continue;
+
+		const int64_t first_frame = upcoming.clip_start_frame;
+		const int64_t frames = std::min(int64_t(max_concurrent_frames), upcoming.end_frame - upcoming.start_frame + 1);
+		preparing_clips[clip] = std::async(std::launch::async, [clip, first_frame, frames]() {
+			try {
+				clip->Open();
+				ReaderBase *reader = clip->Reader();
+				for (int64_t number = first_frame; number < first_frame + frames; number++)
+					reader->GetFrame(number);
+			} catch (...) {
+				// Any errors are raised once the clip is opened by update_open_clips
+			}
+		});
+	}
+}
+
+// Wait for all in-flight frames to finish compositing
+void Timeline::wait_for_rendering(std::unique_lock<std::recursive_mutex>& lock)
+{
+	// Nested calls (i.e. SetJsonValue -> AddClip) already hold getFrameMutex, and no
+	// new frames can start while it is held, so the predicate is already true for them.
+	renderingCondition.wait(lock, [this] { return rendering_frames == 0; });
+}
+
+// Mark an in-flight frame as finished
+void Timeline::end_rendering()
+{
+	// Get lock (prevent getting frames while this happens)
+	const std::lock_guard<std::recursive_mutex> guard(getFrameMutex);
+
+	rendering_frames--;
+	if (rendering_frames == 0) {
+		// Close clips which stopped intersecting while frames were in-flight
+		for (auto clip : closing_clips)
+			clip->Close();
+		closing_clips.clear();
+
+		// Wake up any structural edits waiting on us
+		renderingCondition.notify_all();
+	}
+}
+
 // Calculate the max duration (in seconds) of the timeline, based on all the clips, and cache the value
 void Timeline::calculate_max_duration() {
 	double last_clip = 0.0;
@@ -777,10 +1507,19 @@ void Timeline::calculate_max_duration() {
 void Timeline::sort_clips()
 {
 	// Get lock (prevent getting frames while this happens)
-	const std::lock_guard<std::recursive_mutex> guard(getFrameMutex);
+	std::unique_lock<std::recursive_mutex> guard(getFrameMutex);
+	wait_for_rendering(guard);
+
+	// Sort once, when the update is done
+	clip_ranges_dirty = true;
+	if (update_depth > 0) {
+		clips_unsorted = true;
+		return;
+	}
+	clips_unsorted = false;
 
 	// Debug output
-	ZmqLogger::Instance()->AppendDebugMethod(
+	ZMQ_DEBUG(
 		"Timeline::SortClips",
 		"clips.size()", clips.size());
 
@@ -795,7 +1534,15 @@ void Timeline::sort_clips()
 void Timeline::sort_effects()
 {
 	// Get lock (prevent getting frames while this happens)
-	const std::lock_guard<std::recursive_mutex> guard(getFrameMutex);
+	std::unique_lock<std::recursive_mutex> guard(getFrameMutex);
+	wait_for_rendering(guard);
+
+	// Sort once, when the update is done
+	if (update_depth > 0) {
+		effects_unsorted = true;
+		return;
+	}
+	effects_unsorted = false;
 
 	// sort clips
 	effects.sort(CompareEffects());
@@ -807,10 +1554,11 @@ void Timeline::sort_effects()
 // Clear all clips from timeline
 void Timeline::Clear()
 {
-	ZmqLogger::Instance()->AppendDebugMethod("Timeline::Clear");
+	ZMQ_DEBUG("Timeline::Clear");
 
 	// Get lock (prevent getting frames while this happens)
-	const std::lock_guard<std::recursive_mutex> guard(getFrameMutex);
+	std::unique_lock<std::recursive_mutex> guard(getFrameMutex);
+	wait_for_rendering(guard);
 
 	// Close all open clips
 	for (auto clip : clips)
@@ -826,6 +1574,8 @@ void Timeline::Clear()
 	// Clear all clips
 	clips.clear();
 	allocated_clips.clear();
+	pending_clips.clear();
+	clip_ranges_dirty = true;
 
 	// Close all effects
 	for (auto effect : effects)
@@ -839,6 +1589,12 @@ void Timeline::Clear()
 	// Clear all effects
 	effects.clear();
 	allocated_effects.clear();
+	{
+		const std::lock_guard<std::mutex> lock(idsMutex);
+		clip_ids.clear();
+		effect_ids.clear();
+		clip_effect_ids_dirty = true;
+	}
 
 	// Delete all FrameMappers
 	for (auto mapper : allocated_frame_mappers)
@@ -853,10 +1609,11 @@ void Timeline::Clear()
 // Close the reader (and any resources it was consuming)
 void Timeline::Close()
 {
-	ZmqLogger::Instance()->AppendDebugMethod("Timeline::Close");
+	ZMQ_DEBUG("Timeline::Close");
 
 	// Get lock (prevent getting frames while this happens)
-	const std::lock_guard<std::recursive_mutex> guard(getFrameMutex);
+	std::unique_lock<std::recursive_mutex> guard(getFrameMutex);
+	wait_for_rendering(guard);
 
 	// Close all open clips
 	for (auto clip : clips)
@@ -875,6 +1632,10 @@ void Timeline::Close()
 // Open the reader (and start consuming resources)
 void Timeline::Open()
 {
+	// Create the GPU compositor's context (this only works on the GUI thread)
+	if (Settings::Instance()->GPU_COMPOSITING)
+		GpuCompositor::Instance()->Initialize();
+
 	is_open = true;
 }
 
@@ -887,16 +1648,21 @@ bool Timeline::isEqual(double a, double b)
 // Get an openshot::Frame object for a specific frame number of this reader.
 std::shared_ptr<Frame> Timeline::GetFrame(int64_t requested_frame)
 {
+	AllocationScopeGuard allocations(ALLOCATION_SCOPE_TIMELINE);
+
 	// Adjust out of bounds frame number
 	if (requested_frame < 1)
 		requested_frame = 1;
 
+	// Render nested timelines at the size and quality they are shown at
+	apply_parent_settings();
+
 	// Check cache
 	std::shared_ptr<Frame> frame;
 	frame = final_cache->GetFrame(requested_frame);
 	if (frame) {
 		// Debug output
-		ZmqLogger::Instance()->AppendDebugMethod(
+		ZMQ_DEBUG(
 			"Timeline::GetFrame (Cached frame found)",
 			"requested_frame", requested_frame);
 
@@ -905,28 +1671,48 @@ std::shared_ptr<Frame> Timeline::GetFrame(int64_t requested_frame)
 	}
 	else
 	{
-		// Prevent async calls to the following code
-		const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+		// Time the whole frame (and send the stats of the previous frames, if it's time to)
+		log_render_stats();
+		if (Settings::Instance()->ENABLE_AUTO_TUNING)
+			Calibration::Adjust();
+		RenderStageTimer frame_timer(RENDER_STAGE_FRAME);
 
-		// Check cache 2nd time
-		std::shared_ptr<Frame> frame;
-		frame = final_cache->GetFrame(requested_frame);
-		if (frame) {
-			// Debug output
-			ZmqLogger::Instance()->AppendDebugMethod(
-					"Timeline::GetFrame (Cached frame found on 2nd check)",
-					"requested_frame", requested_frame);
+		std::vector<ClipFrameRange> nearby_clips;
+		{
+			// Prevent async calls to the following code. The lock is only held while
+			// selecting (and opening) clips, so other frames can be composited in parallel.
+			const auto lock = TraceLock(getFrameMutex, "wait Timeline::getFrameMutex");
+
+			// Check cache 2nd time (and the cached frames of larger preview sizes)
+			frame = final_cache->GetFrame(requested_frame);
+			if (!frame && !audio_only)
+				frame = get_scaled_cached_frame(requested_frame);
+			if (frame) {
+				// Debug output
+				ZMQ_DEBUG(
+						"Timeline::GetFrame (Cached frame found on 2nd check)",
+						"requested_frame", requested_frame);
+
+				// Return cached frame
+				return frame;
+			}
+
+			// Stop here, if this frame is no longer needed (i.e. the user scrubbed past it)
+			FrameRequest::ThrowIfCancelled(requested_frame);
 
-			// Return cached frame
-			return frame;
-		} else {
 			// Get a list of clips that intersect with the requested section of timeline
 			// This also opens the readers for intersecting clips, and marks non-intersecting clips as 'needs closing'
-			std::vector<Clip *> nearby_clips;
-			nearby_clips = find_intersecting_clips(requested_frame, 1, true);
+			for (auto clip : find_intersecting_clips(requested_frame, 1, true))
+				nearby_clips.push_back(clip_ranges[clip_range_index[clip]]);
+
+			// Mark this frame as in-flight (structural edits wait until it is finished)
+			rendering_frames++;
+		}
 
+		std::shared_ptr<Frame> new_frame;
+		try {
 			// Debug output
-			ZmqLogger::Instance()->AppendDebugMethod(
+			ZMQ_DEBUG(
 					"Timeline::GetFrame (processing frame)",
 					"requested_frame", requested_frame,
 					"omp_get_thread_num()", omp_get_thread_num());
@@ -934,40 +1720,79 @@ std::shared_ptr<Frame> Timeline::GetFrame(int64_t requested_frame)
 			// Init some basic properties about this frame
 			int samples_in_frame = Frame::GetSamplesPerFrame(requested_frame, info.fps, info.sample_rate, info.channels);
 
-			// Create blank frame (which will become the requested frame)
-			std::shared_ptr<Frame> new_frame(std::make_shared<Frame>(requested_frame, preview_width, preview_height, "#000000", samples_in_frame, info.channels));
+			// Create blank frame (which will become the requested frame). Audio-only frames have no image.
+			if (audio_only)
+				new_frame = std::make_shared<Frame>(requested_frame, samples_in_frame, info.channels);
+			else
+				new_frame = std::make_shared<Frame>(requested_frame, preview_width, preview_height, "#000000", samples_in_frame, info.channels);
 			new_frame->AddAudioSilence(samples_in_frame);
 			new_frame->SampleRate(info.sample_rate);
 			new_frame->ChannelsLayout(info.channel_layout);
 
 			// Debug output
-			ZmqLogger::Instance()->AppendDebugMethod(
+			ZMQ_DEBUG(
 					"Timeline::GetFrame (Adding solid color)",
 					"requested_frame", requested_frame,
 					"info.width", info.width,
 					"info.height", info.height);
 
-			// Add Background Color to 1st layer (if animated or not black)
-			if ((color.red.GetCount() > 1 || color.green.GetCount() > 1 || color.blue.GetCount() > 1) ||
-				(color.red.GetValue(requested_frame) != 0.0 || color.green.GetValue(requested_frame) != 0.0 ||
-				 color.blue.GetValue(requested_frame) != 0.0))
-				new_frame->AddColor(preview_width, preview_height, color.GetColorHex(requested_frame));
+			// Large canvases are composited into tiles (see TiledImage), so only the tiles covered by a clip are
+			// allocated, and the background color is the color of the other tiles
+			const int64_t tiled_min_pixels = Settings::Instance()->TILED_FRAME_MIN_PIXELS;
+			const bool tiled_canvas = !audio_only && tiled_min_pixels > 0 &&
+				int64_t(preview_width) * preview_height >= tiled_min_pixels;
+
+			// Add Background Color to 1st layer (a solid color, which is only filled into an image when a clip
+			// is composited onto it, or its pixels are needed)
+			if (!audio_only && !tiled_canvas)
+				new_frame->AddSolidColor(QColor(QString::fromStdString(color.GetColorHex(requested_frame))));
 
 			// Debug output
-			ZmqLogger::Instance()->AppendDebugMethod(
+			ZMQ_DEBUG(
 					"Timeline::GetFrame (Loop through clips)",
 					"requested_frame", requested_frame,
 					"clips.size()", clips.size(),
 					"nearby_clips.size()", nearby_clips.size());
 
+			// Find the top clip of each layer (the last clip to start, when clips overlap) and the max volume
+			// of all overlapping clips, in a single pass (instead of comparing every pair of nearby clips)
+			std::map<int, long> top_clip_positions;
+			float max_volume = 0.0;
+			for (const auto& nearby_range : nearby_clips) {
+				Clip *nearby_clip = nearby_range.clip;
+				long nearby_clip_start_position = nearby_range.start_frame;
+				long nearby_clip_end_position = nearby_range.end_frame;
+				long nearby_clip_start_frame = nearby_range.clip_start_frame;
+				long nearby_clip_frame_number = requested_frame - nearby_clip_start_position + nearby_clip_start_frame;
+				if (nearby_clip_start_position > requested_frame || nearby_clip_end_position < requested_frame)
+					continue;
+
+				// Determine top clip (of this layer)
+				auto top_clip_position = top_clip_positions.find(nearby_clip->Layer());
+				if (top_clip_position == top_clip_positions.end() || nearby_clip_start_position > top_clip_position->second)
+					top_clip_positions[nearby_clip->Layer()] = nearby_clip_start_position;
+
+				// Determine max volume of overlapping clips
+				if (nearby_clip->Reader() && nearby_clip->Reader()->info.has_audio &&
+					nearby_clip->has_audio.GetInt(nearby_clip_frame_number) != 0) {
+					max_volume += nearby_clip->volume.GetValue(nearby_clip_frame_number);
+				}
+			}
+
 			// Find Clips near this time
-			for (auto clip : nearby_clips) {
-				long clip_start_position = round(clip->Position() * info.fps.ToDouble()) + 1;
-				long clip_end_position = round((clip->Position() + clip->Duration()) * info.fps.ToDouble());
+			std::vector<LayerRequest> layers;
+			for (const auto& clip_range : nearby_clips) {
+				Clip *clip = clip_range.clip;
+				long clip_start_position = clip_range.start_frame;
+				long clip_end_position = clip_range.end_frame - 1;
 				bool does_clip_intersect = (clip_start_position <= requested_frame && clip_end_position >= requested_frame);
 
+				// Clips without audio add nothing to audio-only frames
+				if (audio_only && (!clip->Reader() || !clip->Reader()->info.has_audio))
+					does_clip_intersect = false;
+
 				// Debug output
-				ZmqLogger::Instance()->AppendDebugMethod(
+				ZMQ_DEBUG(
 						"Timeline::GetFrame (Does clip intersect)",
 						"requested_frame", requested_frame,
 						"clip->Position()", clip->Position(),
@@ -977,70 +1802,212 @@ std::shared_ptr<Frame> Timeline::GetFrame(int64_t requested_frame)
 				// Clip is visible
 				if (does_clip_intersect) {
 					// Determine if clip is "top" clip on this layer (only happens when multiple clips are overlapping)
-					bool is_top_clip = true;
-					float max_volume = 0.0;
-					for (auto nearby_clip : nearby_clips) {
-						long nearby_clip_start_position = round(nearby_clip->Position() * info.fps.ToDouble()) + 1;
-						long nearby_clip_end_position = round((nearby_clip->Position() + nearby_clip->Duration()) * info.fps.ToDouble()) + 1;
-						long nearby_clip_start_frame = (nearby_clip->Start() * info.fps.ToDouble()) + 1;
-						long nearby_clip_frame_number = requested_frame - nearby_clip_start_position + nearby_clip_start_frame;
-
-						// Determine if top clip
-						if (clip->Id() != nearby_clip->Id() && clip->Layer() == nearby_clip->Layer() &&
-							nearby_clip_start_position <= requested_frame && nearby_clip_end_position >= requested_frame &&
-							nearby_clip_start_position > clip_start_position && is_top_clip == true) {
-							is_top_clip = false;
-						}
-
-						// Determine max volume of overlapping clips
-						if (nearby_clip->Reader() && nearby_clip->Reader()->info.has_audio &&
-							nearby_clip->has_audio.GetInt(nearby_clip_frame_number) != 0 &&
-							nearby_clip_start_position <= requested_frame && nearby_clip_end_position >= requested_frame) {
-							max_volume += nearby_clip->volume.GetValue(nearby_clip_frame_number);
-						}
-					}
+					auto top_clip_position = top_clip_positions.find(clip->Layer());
+					bool is_top_clip = top_clip_position == top_clip_positions.end() || clip_start_position >= top_clip_position->second;
 
 					// Determine the frame needed for this clip (based on the position on the timeline)
-					long clip_start_frame = (clip->Start() * info.fps.ToDouble()) + 1;
+					long clip_start_frame = clip_range.clip_start_frame;
 					long clip_frame_number = requested_frame - clip_start_position + clip_start_frame;
 
 					// Debug output
-					ZmqLogger::Instance()->AppendDebugMethod(
+					ZMQ_DEBUG(
 							"Timeline::GetFrame (Calculate clip's frame #)",
 							"clip->Position()", clip->Position(),
 							"clip->Start()", clip->Start(),
 							"info.fps.ToFloat()", info.fps.ToFloat(),
 							"clip_frame_number", clip_frame_number);
 
-					// Add clip's frame as layer
-					add_layer(new_frame, clip, clip_frame_number, is_top_clip, max_volume);
-
-				} else {
-					// Debug output
-					ZmqLogger::Instance()->AppendDebugMethod(
-							"Timeline::GetFrame (clip does not intersect)",
-							"requested_frame", requested_frame,
-							"does_clip_intersect", does_clip_intersect);
+					layers.push_back({clip, clip_frame_number, is_top_clip, nullptr, QRect()});
 				}
 
 			} // end clip loop
 
+			// Find the keys of the clips' frames in the render cache (and re-use the whole composited frame, if it
+			// was stored by this or a previous session)
+			const bool render_cache = !audio_only && RenderCache::Instance()->Enabled();
+			uint64_t frame_key = 0;
+			std::shared_ptr<Frame> cached_frame;
+			if (render_cache) {
+				for (auto& layer : layers)
+					layer.render_key = layer_render_key(requested_frame, layer);
+				if (Settings::Instance()->RENDER_CACHE_TIMELINE_FRAMES) {
+					frame_key = frame_render_key(requested_frame, layers, max_volume);
+					cached_frame = RenderCache::Instance()->GetFrame(frame_key);
+				}
+			}
+			if (cached_frame) {
+				new_frame = cached_frame;
+				layers.clear();
+			}
+
+			// Re-use the part of the frame which the last edit didn't change (see remove_cached_frames): the mixed
+			// audio, if only the images changed (and clips which add no image, i.e. music, are not rendered at all),
+			// or the image, if only the audio changed (and only the audio of the clips is rendered and mixed)
+			std::shared_ptr<Frame> mixed_audio;
+			std::shared_ptr<Frame> mixed_image;
+			if (!cached_frame) {
+				mixed_audio = mixed_audio_cache->GetFrame(requested_frame);
+				if (mixed_audio && mixed_audio->GetAudioChannelsCount() != info.channels)
+					mixed_audio = nullptr;
+				mixed_image = audio_only ? nullptr : mixed_image_cache->GetFrame(requested_frame);
+				if (mixed_image && (mixed_image->GetWidth() != new_frame->GetWidth() || mixed_image->GetHeight() != new_frame->GetHeight()))
+					mixed_image = nullptr;
+			}
+			if (mixed_audio) {
+				layers.erase(std::remove_if(layers.begin(), layers.end(), [this](const LayerRequest& layer) {
+					if (audio_only)
+						return true;
+					if (layer.clip->Waveform() || layer.clip->Reader()->info.has_video)
+						return false;
+					for (auto effect : layer.clip->Effects()) {
+						if (effect->info.has_video)
+							return false;
+					}
+					for (auto effect : effects) {
+						if (effect->Layer() == layer.clip->Layer() && effect->info.has_video)
+							return false;
+					}
+					return true;
+				}), layers.end());
+			}
+
+			// Re-use the image of the last static frame, if this frame has the same background and clips, with the
+			// same source images (i.e. a slideshow of still images). The last static frame must still be cached,
+			// since every edit which could change its image removes it from the cache.
+			StaticImage static_image;
+			const bool is_static = Settings::Instance()->ENABLE_STATIC_FRAME_REUSE && !audio_only && !cached_frame &&
+				find_static_image(requested_frame, layers, static_image);
+			std::shared_ptr<Frame> reused_frame;
+			if (is_static) {
+				const std::lock_guard<std::mutex> lock(staticFrameMutex);
+				if (static_frame && static_frame_image == static_image &&
+					static_frame->GetWidth() == new_frame->GetWidth() && static_frame->GetHeight() == new_frame->GetHeight() &&
+					final_cache->GetFrame(static_frame->number) == static_frame)
+					reused_frame = static_frame;
+			}
+
+			if (!reused_frame)
+				reused_frame = mixed_image;
+
+			if (reused_frame) {
+				// Share the image (it is only copied if either frame changes it), and only mix the audio of the clips
+				new_frame->AddImage(std::make_shared<QImage>(*reused_frame->GetImage()));
+				for (auto& layer : layers) {
+					if (layer.clip->Reader()->info.has_audio && !mixed_audio) {
+						FrameRequest::ThrowIfCancelled(requested_frame);
+						render_layer(new_frame, layer, false, true);
+						add_layer(new_frame, layer, max_volume);
+					}
+				}
+				layers.clear();
+			}
+
+			// Render the frame as a graph: a node for each clip (which depends on the clip before it on the same
+			// layer, since they share the layer's transitions), and a node which composites all of the clips.
+			// Clips of different layers are rendered in parallel.
+			int layer_count = 0;
+			for (size_t index = 0; index < layers.size(); index++) {
+				if (index == 0 || layers[index].clip->Layer() != layers[index - 1].clip->Layer())
+					layer_count++;
+			}
+			const bool parallel_layers = Settings::Instance()->ENABLE_PARALLEL_LAYERS && layer_count > 1;
+			const QColor tiled_background = tiled_canvas ? QColor(QString::fromStdString(color.GetColorHex(requested_frame))) : QColor();
+
+			// The GPU transforms and composites the clips (instead of each clip transforming its own image)
+			const bool gpu_canvas = !tiled_canvas && !audio_only && Settings::Instance()->GPU_COMPOSITING &&
+				GpuCompositor::Instance()->IsAvailable();
+			if (gpu_canvas) {
+				for (auto& layer : layers)
+					layer.gpu_layer = std::make_shared<GpuLayer>();
+			}
+
+			if (parallel_layers) {
+				RenderGraph graph;
+				std::vector<int> clip_nodes;
+				for (size_t index = 0; index < layers.size(); index++) {
+					std::vector<int> inputs;
+					if (index > 0 && layers[index].clip->Layer() == layers[index - 1].clip->Layer())
+						inputs.push_back(clip_nodes.back());
+
+					LayerRequest *layer = &layers[index];
+					clip_nodes.push_back(graph.AddNode("clip", [this, new_frame, requested_frame, layer](const RenderGraph::Inputs&) {
+						// Stop between clips, if this frame is no longer needed (nothing is cached yet)
+						FrameRequest::ThrowIfCancelled(requested_frame);
+						render_layer(new_frame, *layer, false);
+						return layer->frame;
+					}, inputs));
+				}
+
+				// Composite the rendered images of all clips at once (in layer order)
+				graph.AddNode("composite", [this, new_frame, &layers, &tiled_background](const RenderGraph::Inputs&) {
+					if (!audio_only)
+						composite_layers(new_frame, layers, tiled_background);
+					return new_frame;
+				}, clip_nodes);
+
+				graph.Run(std::min(layer_count, OmpThreads()));
+			}
+
+			// Add each clip's frame as a layer (in layer order)
+			for (auto& layer : layers) {
+				if (!parallel_layers) {
+					// Stop between layers, if this frame is no longer needed (nothing is cached yet)
+					FrameRequest::ThrowIfCancelled(requested_frame);
+					render_layer(new_frame, layer, !tiled_canvas && !gpu_canvas && !render_cache);
+				}
+				if (!mixed_audio)
+					add_layer(new_frame, layer, max_volume);
+			}
+
+			// Composite all clips onto the tiles (or on the GPU, or the cached frames of the clips) at once (the render
+			// graph already did)
+			if ((tiled_canvas || gpu_canvas || render_cache) && !parallel_layers && !reused_frame && !cached_frame)
+				composite_layers(new_frame, layers, tiled_background);
+
 			// Debug output
-			ZmqLogger::Instance()->AppendDebugMethod(
+			ZMQ_DEBUG(
 					"Timeline::GetFrame (Add frame to cache)",
 					"requested_frame", requested_frame,
 					"info.width", info.width,
 					"info.height", info.height);
 
+			// Copy the mixed audio (instead of the audio of the clips)
+			if (mixed_audio) {
+				new_frame->ResizeAudio(info.channels, mixed_audio->GetAudioSamplesCount(), info.sample_rate, info.channel_layout);
+				for (int channel = 0; channel < info.channels; channel++)
+					new_frame->AddAudio(true, channel, 0, mixed_audio->GetAudioSamples(channel), mixed_audio->GetAudioSamplesCount(), 1.0);
+			}
+
 			// Set frame # on mapped frame
 			new_frame->SetFrameNumber(requested_frame);
 
-			// Add final frame to cache
+			// Keep the composited frame for the next sessions (if it was not loaded from the render cache)
+			if (frame_key && !cached_frame)
+				RenderCache::Instance()->Add(frame_key, new_frame);
+
+			// Add final frame to cache (which replaces the kept parts of the frame)
 			final_cache->Add(new_frame);
+			if (mixed_audio)
+				mixed_audio_cache->Remove(requested_frame);
+			if (mixed_image)
+				mixed_image_cache->Remove(requested_frame);
+
+			// Remember the last static frame (so the next frame can re-use its image)
+			if (is_static) {
+				const std::lock_guard<std::mutex> lock(staticFrameMutex);
+				static_frame = new_frame;
+				static_frame_image = static_image;
+			}
 
-			// Return frame (or blank frame)
-			return new_frame;
+		} catch (...) {
+			// Never leave structural edits waiting on a failed frame
+			end_rendering();
+			throw;
 		}
+		end_rendering();
+
+		// Return frame (or blank frame)
+		return new_frame;
 	}
 }
 
@@ -1050,53 +2017,129 @@ std::vector<Clip*> Timeline::find_intersecting_clips(int64_t requested_frame, in
 {
 	// Find matching clips
 	std::vector<Clip*> matching_clips;
+	std::vector<Clip*> intersecting_clips;
 
 	// Calculate time of frame
-	float min_requested_frame = requested_frame;
-	float max_requested_frame = requested_frame + (number_of_frames - 1);
-
-	// Find Clips at this time
-	for (auto clip : clips)
+	int64_t min_requested_frame = requested_frame;
+	int64_t max_requested_frame = requested_frame + (number_of_frames - 1);
+
+	// Rebuild the clip ranges (if clips were added, removed or moved)
+	update_clip_ranges();
+
+	// Only clips starting before the last requested frame can intersect. Search backwards from
+	// there, until none of the earlier clips end after the first requested frame.
+	std::vector<const ClipFrameRange*> intersecting_ranges;
+	auto range = std::upper_bound(clip_ranges.begin(), clip_ranges.end(), max_requested_frame,
+		[](int64_t frame, const ClipFrameRange& r) { return frame < r.start_frame; });
+	for (size_t index = range - clip_ranges.begin(); index > 0 && clip_ranges_max_end[index - 1] >= min_requested_frame; index--)
 	{
 		// Does clip intersect the current requested time
-		long clip_start_position = round(clip->Position() * info.fps.ToDouble()) + 1;
-		long clip_end_position = round((clip->Position() + clip->Duration()) * info.fps.ToDouble()) + 1;
+		const ClipFrameRange& clip_range = clip_ranges[index - 1];
+		if (clip_range.end_frame >= min_requested_frame)
+			intersecting_ranges.push_back(&clip_range);
+	}
 
-		bool does_clip_intersect =
-				(clip_start_position <= min_requested_frame || clip_start_position <= max_requested_frame) &&
-				(clip_end_position >= min_requested_frame || clip_end_position >= max_requested_frame);
+	// Keep the order of the clips list (which is the order layers are combined in)
+	std::sort(intersecting_ranges.begin(), intersecting_ranges.end(),
+		[](const ClipFrameRange* lhs, const ClipFrameRange* rhs) { return lhs->order < rhs->order; });
+	for (auto clip_range : intersecting_ranges)
+		intersecting_clips.push_back(clip_range->clip);
 
-		// Debug output
-		ZmqLogger::Instance()->AppendDebugMethod(
-			"Timeline::find_intersecting_clips (Is clip near or intersecting)",
-			"requested_frame", requested_frame,
-			"min_requested_frame", min_requested_frame,
-			"max_requested_frame", max_requested_frame,
-			"clip->Position()", clip->Position(),
-			"does_clip_intersect", does_clip_intersect);
+	// Debug output
+	ZMQ_DEBUG(
+		"Timeline::find_intersecting_clips (Is clip near or intersecting)",
+		"requested_frame", requested_frame,
+		"min_requested_frame", min_requested_frame,
+		"max_requested_frame", max_requested_frame,
+		"clips.size()", clips.size(),
+		"intersecting_clips.size()", intersecting_clips.size());
+
+	// Schedule open clips which no longer intersect for closing
+	std::vector<Clip*> closing;
+	for (const auto& open_clip : open_clips) {
+		if (clip_range_index.count(open_clip.first) &&
+			std::find(intersecting_clips.begin(), intersecting_clips.end(), open_clip.first) == intersecting_clips.end())
+			closing.push_back(open_clip.first);
+	}
+	for (auto clip : closing)
+		update_open_clips(clip, false);
 
-		// Open (or schedule for closing) this clip, based on if it's intersecting or not
-		update_open_clips(clip, does_clip_intersect);
+	// Open the intersecting clips which are not open yet in parallel (each one opens and probes
+	// its file, which is slow on network storage). Any errors are raised by update_open_clips.
+	// Clips prepared in the background are open already (once they are finished).
+	std::vector<Clip*> opening;
+	for (auto clip : intersecting_clips)
+		if (!open_clips.count(clip) && std::find(closing_clips.begin(), closing_clips.end(), clip) == closing_clips.end() &&
+			!finish_preparing_clip(clip))
+			opening.push_back(clip);
+	if (opening.size() > 1) {
+		#pragma omp parallel for schedule(dynamic, 1) num_threads(OmpThreads())
+		for (size_t index = 0; index < opening.size(); index++) {
+			try {
+				opening[index]->Open();
+			} catch (...) {
+				// ...
+			}
+		}
+	}
 
-		// Clip is visible
-		if (does_clip_intersect && include)
-			// Add the intersecting clip
-			matching_clips.push_back(clip);
+	// Open intersecting clips
+	for (auto clip : intersecting_clips)
+		update_open_clips(clip, true);
 
-		else if (!does_clip_intersect && !include)
-			// Add the non-intersecting clip
-			matching_clips.push_back(clip);
+	// Open the clips which start soon in the background
+	prepare_upcoming_clips(max_requested_frame, intersecting_clips);
 
-	} // end clip loop
+	if (include)
+		// Add the intersecting clips
+		matching_clips = intersecting_clips;
+	else {
+		// Add the non-intersecting clips
+		for (auto clip : clips)
+			if (std::find(intersecting_clips.begin(), intersecting_clips.end(), clip) == intersecting_clips.end())
+				matching_clips.push_back(clip);
+	}
 
 	// return list
 	return matching_clips;
 }
 
+// Rebuild the frame ranges of all clips (if needed)
+void Timeline::update_clip_ranges()
+{
+	// Frame ranges are only valid for the same clips (and frame rate)
+	if (!clip_ranges_dirty && clip_ranges_fps == info.fps.ToDouble())
+		return;
+
+	clip_ranges.clear();
+	size_t order = 0;
+	for (auto clip : clips)
+	{
+		int64_t clip_start_position, clip_end_position;
+		get_frame_range(clip, clip_start_position, clip_end_position);
+		const int64_t clip_start_frame = int64_t(clip->Start() * info.fps.ToDouble()) + 1;
+		clip_ranges.push_back(ClipFrameRange{clip_start_position, clip_end_position, clip_start_frame, order++, clip});
+	}
+
+	// Sort by start frame, and keep the max end frame of all clips up to each one
+	std::stable_sort(clip_ranges.begin(), clip_ranges.end(),
+		[](const ClipFrameRange& lhs, const ClipFrameRange& rhs) { return lhs.start_frame < rhs.start_frame; });
+	clip_ranges_max_end.resize(clip_ranges.size());
+	clip_range_index.clear();
+	for (size_t index = 0; index < clip_ranges.size(); index++) {
+		clip_ranges_max_end[index] = (index == 0) ? clip_ranges[index].end_frame : std::max(clip_ranges_max_end[index - 1], clip_ranges[index].end_frame);
+		clip_range_index[clip_ranges[index].clip] = index;
+	}
+
+	clip_ranges_dirty = false;
+	clip_ranges_fps = info.fps.ToDouble();
+}
+
 // Set the cache object used by this reader
 void Timeline::SetCache(CacheBase* new_cache) {
 	// Get lock (prevent getting frames while this happens)
-	const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+	std::unique_lock<std::recursive_mutex> lock(getFrameMutex);
+	wait_for_rendering(lock);
 
 	// Destroy previous cache (if managed by timeline)
 	if (managed_cache && final_cache) {
@@ -1104,6 +2147,9 @@ void Timeline::SetCache(CacheBase* new_cache) {
 		final_cache = NULL;
 		managed_cache = false;
 	}
+	clear_preview_caches();
+	mixed_audio_cache->Clear();
+	mixed_image_cache->Clear();
 
 	// Set new cache
 	final_cache = new_cache;
@@ -1154,7 +2200,8 @@ Json::Value Timeline::JsonValue() const {
 void Timeline::SetJson(const std::string value) {
 
 	// Get lock (prevent getting frames while this happens)
-	const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+	std::unique_lock<std::recursive_mutex> lock(getFrameMutex);
+	wait_for_rendering(lock);
 
 	// Parse JSON string into JSON objects
 	try
@@ -1170,11 +2217,59 @@ void Timeline::SetJson(const std::string value) {
 	}
 }
 
+// Generate the binary serialization of this object
+std::string Timeline::Binary() const {
+
+	return openshot::jsonToBinary(JsonValue());
+}
+
+// Load the binary serialization into this object
+void Timeline::SetBinary(const std::string& value) {
+
+	// Get lock (prevent getting frames while this happens)
+	std::unique_lock<std::recursive_mutex> lock(getFrameMutex);
+	wait_for_rendering(lock);
+
+	// Parse binary data into JSON objects
+	try
+	{
+		const Json::Value root = openshot::binaryToJson(value);
+		// Set all values that match
+		SetJsonValue(root);
+	}
+	catch (const std::exception& e)
+	{
+		// Error parsing binary data (or missing keys)
+		throw InvalidJSON("Binary data is invalid (missing keys or invalid data types)");
+	}
+}
+
+// Create an independent copy of this timeline (for exporting or rendering while it is edited)
+std::unique_ptr<Timeline> Timeline::Snapshot() {
+
+	Json::Value root;
+	ReaderInfo snapshot_info;
+	{
+		// Get lock (edits wait until the state is copied)
+		const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+		root = JsonValue();
+		snapshot_info = info;
+	}
+
+	// Load the state into a new timeline (with its own readers and caches)
+	auto snapshot = std::make_unique<Timeline>(snapshot_info);
+	snapshot->AutoMapClips(auto_map_clips);
+	snapshot->SetRenderQuality(render_quality);
+	snapshot->SetJsonValue(root);
+	return snapshot;
+}
+
 // Load Json::Value into this object
 void Timeline::SetJsonValue(const Json::Value root) {
 
 	// Get lock (prevent getting frames while this happens)
-	const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+	std::unique_lock<std::recursive_mutex> lock(getFrameMutex);
+	wait_for_rendering(lock);
 
 	// Close timeline before we do anything (this closes all clips)
 	bool was_open = is_open;
@@ -1187,58 +2282,77 @@ void Timeline::SetJsonValue(const Json::Value root) {
 	if (!root["path"].isNull())
 		path = root["path"].asString();
 
-	if (!root["clips"].isNull()) {
-		// Clear existing clips
-		clips.clear();
+	// Sort (and prepare) the new clips and effects once, after all of them are added
+	BeginUpdate();
+	try {
+		if (!root["clips"].isNull()) {
+			// Clear existing clips
+			clips.clear();
+			pending_clips.clear();
+			clip_ranges_dirty = true;
+			{
+				const std::lock_guard<std::mutex> lock(idsMutex);
+				clip_ids.clear();
+				clip_effect_ids_dirty = true;
+			}
 
-		// loop through clips
-		for (const Json::Value existing_clip : root["clips"]) {
-			// Create Clip
-			Clip *c = new Clip();
+			// loop through clips
+			for (const Json::Value existing_clip : root["clips"]) {
+				// Create Clip
+				Clip *c = new Clip();
 
-			// Keep track of allocated clip objects
-			allocated_clips.insert(c);
+				// Keep track of allocated clip objects
+				allocated_clips.insert(c);
 
-			// When a clip is attached to an object, it searches for the object
-			// on it's parent timeline. Setting the parent timeline of the clip here
-			// allows attaching it to an object when exporting the project (because)
-			// the exporter script initializes the clip and it's effects
-			// before setting its parent timeline.
-			c->ParentTimeline(this);
+				// When a clip is attached to an object, it searches for the object
+				// on it's parent timeline. Setting the parent timeline of the clip here
+				// allows attaching it to an object when exporting the project (because)
+				// the exporter script initializes the clip and it's effects
+				// before setting its parent timeline.
+				c->ParentTimeline(this);
 
-			// Load Json into Clip
-			c->SetJsonValue(existing_clip);
+				// Load Json into Clip
+				c->SetJsonValue(existing_clip);
 
-			// Add Clip to Timeline
-			AddClip(c);
+				// Add Clip to Timeline
+				AddClip(c);
+			}
 		}
-	}
 
-	if (!root["effects"].isNull()) {
-		// Clear existing effects
-		effects.clear();
+		if (!root["effects"].isNull()) {
+			// Clear existing effects
+			effects.clear();
+			{
+				const std::lock_guard<std::mutex> lock(idsMutex);
+				effect_ids.clear();
+			}
 
-		// loop through effects
-		for (const Json::Value existing_effect :root["effects"]) {
-			// Create Effect
-			EffectBase *e = NULL;
+			// loop through effects
+			for (const Json::Value existing_effect :root["effects"]) {
+				// Create Effect
+				EffectBase *e = NULL;
 
-			if (!existing_effect["type"].isNull()) {
-				// Create instance of effect
-				if ( (e = EffectInfo().CreateEffect(existing_effect["type"].asString())) ) {
+				if (!existing_effect["type"].isNull()) {
+					// Create instance of effect
+					if ( (e = EffectInfo().CreateEffect(existing_effect["type"].asString())) ) {
 
-					// Keep track of allocated effect objects
-					allocated_effects.insert(e);
+						// Keep track of allocated effect objects
+						allocated_effects.insert(e);
 
-					// Load Json into Effect
-					e->SetJsonValue(existing_effect);
+						// Load Json into Effect
+						e->SetJsonValue(existing_effect);
 
-					// Add Effect to Timeline
-					AddEffect(e);
+						// Add Effect to Timeline
+						AddEffect(e);
+					}
 				}
 			}
 		}
+	} catch (...) {
+		EndUpdate();
+		throw;
 	}
+	EndUpdate();
 
 	if (!root["duration"].isNull()) {
 		// Update duration of timeline
@@ -1259,14 +2373,18 @@ void Timeline::SetJsonValue(const Json::Value root) {
 void Timeline::ApplyJsonDiff(std::string value) {
 
 	// Get lock (prevent getting frames while this happens)
-	const std::lock_guard<std::recursive_mutex> lock(getFrameMutex);
+	std::unique_lock<std::recursive_mutex> lock(getFrameMutex);
+	wait_for_rendering(lock);
+
+	// Sort (and prepare) the changed clips and effects once, after all the changes
+	BeginUpdate();
 
 	// Parse JSON string into JSON objects
 	try
 	{
 		const Json::Value root = openshot::stringToJson(value);
-		// Process the JSON change array, loop through each item
-		for (const Json::Value change : root) {
+		// Process the JSON change array, loop through each item (without copying it)
+		for (const Json::Value& change : root) {
 			std::string change_key = change["key"][(uint)0].asString();
 
 			// Process each type of change
@@ -1287,12 +2405,14 @@ void Timeline::ApplyJsonDiff(std::string value) {
 	catch (const std::exception& e)
 	{
 		// Error parsing JSON (or missing keys)
+		EndUpdate();
 		throw InvalidJSON("JSON is invalid (missing keys or invalid data types)");
 	}
+	EndUpdate();
 }
 
 // Apply JSON diff to clips
-void Timeline::apply_json_to_clips(Json::Value change) {
+void Timeline::apply_json_to_clips(const Json::Value& change) {
 
 	// Get key and type of change
 	std::string change_type = change["type"].asString();
@@ -1300,7 +2420,7 @@ void Timeline::apply_json_to_clips(Json::Value change) {
 	Clip *existing_clip = NULL;
 
 	// Find id of clip (if any)
-	for (auto key_part : change["key"]) {
+	for (const auto& key_part : change["key"]) {
 		// Get each change
 		if (key_part.isObject()) {
 			// Check for id
@@ -1309,13 +2429,7 @@ void Timeline::apply_json_to_clips(Json::Value change) {
 				clip_id = key_part["id"].asString();
 
 				// Find matching clip in timeline (if any)
-				for (auto c : clips)
-				{
-					if (c->Id() == clip_id) {
-						existing_clip = c;
-						break; // clip found, exit loop
-					}
-				}
+				existing_clip = GetClip(clip_id);
 				break; // id found, exit loop
 			}
 		}
@@ -1326,7 +2440,7 @@ void Timeline::apply_json_to_clips(Json::Value change) {
 	if (existing_clip && change["key"].size() == 4 && change["key"][2] == "effects")
 	{
 		// This change is actually targetting a specific effect under a clip (and not the clip)
-		Json::Value key_part = change["key"][3];
+		const Json::Value& key_part = change["key"][3];
 
 		if (key_part.isObject()) {
 			// Check for id
@@ -1336,32 +2450,17 @@ void Timeline::apply_json_to_clips(Json::Value change) {
 				std::string effect_id = key_part["id"].asString();
 
 				// Find matching effect in timeline (if any)
-				std::list<EffectBase*> effect_list = existing_clip->Effects();
-				for (auto e : effect_list)
-				{
-					if (e->Id() == effect_id) {
-						// Apply the change to the effect directly
-						apply_json_to_effects(change, e);
+				EffectBase* e = existing_clip->GetEffect(effect_id);
+				if (e) {
+					// Apply the change to the effect directly (which removes the affected frames from the cache)
+					apply_json_to_effects(change, e, existing_clip);
 
-						// Calculate start and end frames that this impacts, and remove those frames from the cache
-						int64_t new_starting_frame = (existing_clip->Position() * info.fps.ToDouble()) + 1;
-						int64_t new_ending_frame = ((existing_clip->Position() + existing_clip->Duration()) * info.fps.ToDouble()) + 1;
-						final_cache->Remove(new_starting_frame - 8, new_ending_frame + 8);
-
-						return; // effect found, don't update clip
-					}
+					return; // effect found, don't update clip
 				}
 			}
 		}
 	}
 
-	// Calculate start and end frames that this impacts, and remove those frames from the cache
-	if (!change["value"].isArray() && !change["value"]["position"].isNull()) {
-		int64_t new_starting_frame = (change["value"]["position"].asDouble() * info.fps.ToDouble()) + 1;
-		int64_t new_ending_frame = ((change["value"]["position"].asDouble() + change["value"]["end"].asDouble() - change["value"]["start"].asDouble()) * info.fps.ToDouble()) + 1;
-		final_cache->Remove(new_starting_frame - 8, new_ending_frame + 8);
-	}
-
 	// Determine type of change operation
 	if (change_type == "insert") {
 
@@ -1377,19 +2476,23 @@ void Timeline::apply_json_to_clips(Json::Value change) {
 		// Add clip to timeline
 		AddClip(clip);
 
+		// Remove the frames covered by the new clip from the cache
+		int64_t new_starting_frame, new_ending_frame;
+		bool video, audio;
+		get_frame_range(clip, new_starting_frame, new_ending_frame);
+		find_changed_media(clip, Json::Value(), Json::Value(), video, audio);
+		remove_cached_frames(new_starting_frame, new_ending_frame, video, audio);
+
 	} else if (change_type == "update") {
 
 		// Update existing clip
 		if (existing_clip) {
 
-			// Calculate start and end frames that this impacts, and remove those frames from the cache
-			int64_t old_starting_frame = (existing_clip->Position() * info.fps.ToDouble()) + 1;
-			int64_t old_ending_frame = ((existing_clip->Position() + existing_clip->Duration()) * info.fps.ToDouble()) + 1;
-			final_cache->Remove(old_starting_frame - 8, old_ending_frame + 8);
-
-			// Remove cache on clip's Reader (if found)
-			if (existing_clip->Reader() && existing_clip->Reader()->GetCache())
-				existing_clip->Reader()->GetCache()->Remove(old_starting_frame - 8, old_ending_frame + 8);
+			// Remember the clip's properties, position and cached frames (before the update)
+			const Json::Value old_json = existing_clip->JsonValue();
+			int64_t old_starting_frame, old_ending_frame;
+			get_frame_range(existing_clip, old_starting_frame, old_ending_frame);
+			std::vector<std::shared_ptr<Frame>> cached_frames = existing_clip->GetCache()->GetFrames();
 
 			// Update clip properties from JSON
 			existing_clip->SetJsonValue(change["value"]);
@@ -1398,6 +2501,12 @@ void Timeline::apply_json_to_clips(Json::Value change) {
 			if (auto_map_clips) {
 				apply_mapper_to_clip(existing_clip);
 			}
+			apply_audio_only_to_clip(existing_clip, audio_only);
+
+			// Restore the clip's cached frames (SetJsonValue clears them), and remove only the affected frames
+			for (const auto& f : cached_frames)
+				existing_clip->GetCache()->Add(f);
+			remove_changed_frames(existing_clip, existing_clip, old_json, old_starting_frame, old_ending_frame);
 		}
 
 	} else if (change_type == "delete") {
@@ -1405,10 +2514,12 @@ void Timeline::apply_json_to_clips(Json::Value change) {
 		// Remove existing clip
 		if (existing_clip) {
 
-			// Calculate start and end frames that this impacts, and remove those frames from the cache
-			int64_t old_starting_frame = (existing_clip->Position() * info.fps.ToDouble()) + 1;
-			int64_t old_ending_frame = ((existing_clip->Position() + existing_clip->Duration()) * info.fps.ToDouble()) + 1;
-			final_cache->Remove(old_starting_frame - 8, old_ending_frame + 8);
+			// Remove the frames covered by the clip from the cache
+			int64_t old_starting_frame, old_ending_frame;
+			bool video, audio;
+			get_frame_range(existing_clip, old_starting_frame, old_ending_frame);
+			find_changed_media(existing_clip, Json::Value(), Json::Value(), video, audio);
+			remove_cached_frames(old_starting_frame, old_ending_frame, video, audio);
 
 			// Remove clip from timeline
 			RemoveClip(existing_clip);
@@ -1421,14 +2532,14 @@ void Timeline::apply_json_to_clips(Json::Value change) {
 }
 
 // Apply JSON diff to effects
-void Timeline::apply_json_to_effects(Json::Value change) {
+void Timeline::apply_json_to_effects(const Json::Value& change) {
 
 	// Get key and type of change
 	std::string change_type = change["type"].asString();
 	EffectBase *existing_effect = NULL;
 
 	// Find id of an effect (if any)
-	for (auto key_part : change["key"]) {
+	for (const auto& key_part : change["key"]) {
 
 		if (key_part.isObject()) {
 			// Check for id
@@ -1438,13 +2549,7 @@ void Timeline::apply_json_to_effects(Json::Value change) {
 				std::string effect_id = key_part["id"].asString();
 
 				// Find matching effect in timeline (if any)
-				for (auto e : effects)
-				{
-					if (e->Id() == effect_id) {
-						existing_effect = e;
-						break; // effect found, exit loop
-					}
-				}
+				existing_effect = GetEffect(effect_id);
 				break; // id found, exit loop
 			}
 		}
@@ -1458,18 +2563,11 @@ void Timeline::apply_json_to_effects(Json::Value change) {
 }
 
 // Apply JSON diff to effects (if you already know which effect needs to be updated)
-void Timeline::apply_json_to_effects(Json::Value change, EffectBase* existing_effect) {
+void Timeline::apply_json_to_effects(const Json::Value& change, EffectBase* existing_effect, Clip* parent_clip) {
 
 	// Get key and type of change
 	std::string change_type = change["type"].asString();
 
-	// Calculate start and end frames that this impacts, and remove those frames from the cache
-	if (!change["value"].isArray() && !change["value"]["position"].isNull()) {
-		int64_t new_starting_frame = (change["value"]["position"].asDouble() * info.fps.ToDouble()) + 1;
-		int64_t new_ending_frame = ((change["value"]["position"].asDouble() + change["value"]["end"].asDouble() - change["value"]["start"].asDouble()) * info.fps.ToDouble()) + 1;
-		final_cache->Remove(new_starting_frame - 8, new_ending_frame + 8);
-	}
-
 	// Determine type of change operation
 	if (change_type == "insert") {
 
@@ -1490,6 +2588,13 @@ void Timeline::apply_json_to_effects(Json::Value change, EffectBase* existing_ef
 
 			// Add Effect to Timeline
 			AddEffect(e);
+
+			// Remove the frames covered by the new effect from the cache
+			int64_t new_starting_frame, new_ending_frame;
+			bool video, audio;
+			get_frame_range(e, new_starting_frame, new_ending_frame);
+			find_changed_media(e, Json::Value(), Json::Value(), video, audio);
+			remove_effect_frames(new_starting_frame, new_ending_frame, e->Layer(), video, audio);
 		}
 
 	} else if (change_type == "update") {
@@ -1497,13 +2602,19 @@ void Timeline::apply_json_to_effects(Json::Value change, EffectBase* existing_ef
 		// Update existing effect
 		if (existing_effect) {
 
-			// Calculate start and end frames that this impacts, and remove those frames from the cache
-			int64_t old_starting_frame = (existing_effect->Position() * info.fps.ToDouble()) + 1;
-			int64_t old_ending_frame = ((existing_effect->Position() + existing_effect->Duration()) * info.fps.ToDouble()) + 1;
-			final_cache->Remove(old_starting_frame - 8, old_ending_frame + 8);
+			// Remember the effect's properties and position (a clip effect covers the frames of its clip)
+			const Json::Value old_json = existing_effect->JsonValue();
+			int64_t old_starting_frame, old_ending_frame;
+			if (parent_clip)
+				get_frame_range(parent_clip, old_starting_frame, old_ending_frame);
+			else
+				get_frame_range(existing_effect, old_starting_frame, old_ending_frame);
 
 			// Update effect properties from JSON
 			existing_effect->SetJsonValue(change["value"]);
+
+			// Remove only the affected frames from the cache
+			remove_changed_frames(existing_effect, parent_clip, old_json, old_starting_frame, old_ending_frame);
 		}
 
 	} else if (change_type == "delete") {
@@ -1511,13 +2622,24 @@ void Timeline::apply_json_to_effects(Json::Value change, EffectBase* existing_ef
 		// Remove existing effect
 		if (existing_effect) {
 
-			// Calculate start and end frames that this impacts, and remove those frames from the cache
-			int64_t old_starting_frame = (existing_effect->Position() * info.fps.ToDouble()) + 1;
-			int64_t old_ending_frame = ((existing_effect->Position() + existing_effect->Duration()) * info.fps.ToDouble()) + 1;
-			final_cache->Remove(old_starting_frame - 8, old_ending_frame + 8);
+			int64_t old_starting_frame, old_ending_frame;
+			bool video, audio;
+			find_changed_media(existing_effect, Json::Value(), Json::Value(), video, audio);
+			if (parent_clip) {
+				// Remove the frames covered by the clip from the cache
+				get_frame_range(parent_clip, old_starting_frame, old_ending_frame);
+				remove_cached_frames(old_starting_frame, old_ending_frame, video, audio);
+
+				// Remove effect from clip (which clears the clip's cache)
+				parent_clip->RemoveEffect(existing_effect);
+			} else {
+				// Remove the frames covered by the effect from the cache
+				get_frame_range(existing_effect, old_starting_frame, old_ending_frame);
+				remove_effect_frames(old_starting_frame, old_ending_frame, existing_effect->Layer(), video, audio);
 
-			// Remove effect from timeline
-			RemoveEffect(existing_effect);
+				// Remove effect from timeline
+				RemoveEffect(existing_effect);
+			}
 		}
 
 	}
@@ -1526,8 +2648,252 @@ void Timeline::apply_json_to_effects(Json::Value change, EffectBase* existing_ef
 	sort_effects();
 }
 
+// Find the frames affected by a changed keyframe (between its unchanged neighbouring points)
+static void find_changed_points(const Json::Value& old_points, const Json::Value& new_points, int64_t& first_frame, int64_t& last_frame)
+{
+	// Count the unchanged points at the start and end
+	const Json::ArrayIndex old_size = old_points.size();
+	const Json::ArrayIndex new_size = new_points.size();
+	Json::ArrayIndex same_start = 0;
+	while (same_start < old_size && same_start < new_size && old_points[same_start] == new_points[same_start])
+		same_start++;
+	Json::ArrayIndex same_end = 0;
+	while (same_end < old_size - same_start && same_end < new_size - same_start &&
+		   old_points[old_size - 1 - same_end] == new_points[new_size - 1 - same_end])
+		same_end++;
+
+	// The value before the first point (and after the last point) is constant, so a change to
+	// the first (or last) point reaches all the way to the start (or end)
+	first_frame = std::numeric_limits<int64_t>::min();
+	last_frame = std::numeric_limits<int64_t>::max();
+	if (same_start > 0)
+		first_frame = std::floor(old_points[same_start - 1]["co"]["X"].asDouble());
+	if (same_end > 0)
+		last_frame = std::ceil(old_points[old_size - same_end]["co"]["X"].asDouble());
+}
+
+// Find the frames affected by a changed property. Returns false if the
+// property is not a keyframe (or a group of keyframes, such as a Color).
+static bool find_changed_keyframe(const Json::Value& old_value, const Json::Value& new_value, int64_t& first_frame, int64_t& last_frame)
+{
+	if (!old_value.isObject() || !new_value.isObject())
+		return false;
+
+	// Keyframe
+	if (old_value["Points"].isArray() && new_value["Points"].isArray()) {
+		find_changed_points(old_value["Points"], new_value["Points"], first_frame, last_frame);
+		return true;
+	}
+
+	// Group of keyframes (all the changed members must be keyframes)
+	first_frame = std::numeric_limits<int64_t>::max();
+	last_frame = std::numeric_limits<int64_t>::min();
+	std::vector<std::string> keys = old_value.getMemberNames();
+	for (const auto& key : new_value.getMemberNames())
+		keys.push_back(key);
+	for (const auto& key : keys) {
+		if (old_value[key] == new_value[key])
+			continue;
+		int64_t key_first_frame, key_last_frame;
+		if (!find_changed_keyframe(old_value[key], new_value[key], key_first_frame, key_last_frame))
+			return false;
+		first_frame = std::min(first_frame, key_first_frame);
+		last_frame = std::max(last_frame, key_last_frame);
+	}
+	return true;
+}
+
+// Find the frames (of a clip or effect) affected by changes to its properties, besides
+// its position on the timeline. Returns false if nothing changed.
+static bool find_changed_frames(const Json::Value& old_json, const Json::Value& new_json, int64_t& first_frame, int64_t& last_frame)
+{
+	bool changed = false;
+	first_frame = std::numeric_limits<int64_t>::max();
+	last_frame = std::numeric_limits<int64_t>::min();
+
+	std::vector<std::string> keys = old_json.getMemberNames();
+	for (const auto& key : new_json.getMemberNames())
+		keys.push_back(key);
+	for (const auto& key : keys) {
+		// Moving and trimming are handled by the caller
+		if (key == "id" || key == "position" || key == "layer" || key == "start" || key == "end" || key == "duration")
+			continue;
+		if (old_json[key] == new_json[key])
+			continue;
+		changed = true;
+
+		// Any other property (i.e. the reader, or the list of effects) affects every frame
+		int64_t key_first_frame, key_last_frame;
+		if (!find_changed_keyframe(old_json[key], new_json[key], key_first_frame, key_last_frame)) {
+			first_frame = std::numeric_limits<int64_t>::min();
+			last_frame = std::numeric_limits<int64_t>::max();
+			return true;
+		}
+		first_frame = std::min(first_frame, key_first_frame);
+		last_frame = std::max(last_frame, key_last_frame);
+	}
+	return changed;
+}
+
+// Get the timeline frames covered by a clip or effect
+void Timeline::get_frame_range(ClipBase* object, int64_t& start_frame, int64_t& end_frame) {
+	// Use the same rounding as GetFrame (which also looks one frame past the end of overlapping clips)
+	start_frame = round(object->Position() * info.fps.ToDouble()) + 1;
+	end_frame = round((object->Position() + object->Duration()) * info.fps.ToDouble()) + 1;
+}
+
+// Remove a range of timeline frames from the final cache, and from the cache of each clip on a layer
+void Timeline::remove_effect_frames(int64_t start_frame, int64_t end_frame, int layer, bool video, bool audio) {
+	remove_cached_frames(start_frame, end_frame, video, audio);
+
+	for (auto clip : clips) {
+		if (clip->Layer() != layer)
+			continue;
+
+		// Overlapping frames (clips cache their frames by clip frame number)
+		int64_t clip_start_position, clip_end_position;
+		get_frame_range(clip, clip_start_position, clip_end_position);
+		int64_t clip_offset = int64_t(clip->Start() * info.fps.ToDouble()) + 1 - clip_start_position;
+		if (std::max(start_frame, clip_start_position) <= std::min(end_frame, clip_end_position))
+			clip->GetCache()->Remove(std::max(start_frame, clip_start_position) + clip_offset,
+									 std::min(end_frame, clip_end_position) + clip_offset);
+	}
+}
+
+// Remove only the cached frames affected by an update to a clip or effect
+void Timeline::remove_changed_frames(ClipBase* object, Clip* parent_clip, const Json::Value& old_json, int64_t old_start_frame, int64_t old_end_frame) {
+	const Json::Value new_json = object->JsonValue();
+
+	// The frame numbers of a clip (or clip effect) are relative to the clip, and the frame
+	// numbers of a timeline effect are relative to the effect
+	ClipBase* owner = parent_clip ? parent_clip : object;
+	int64_t new_start_frame, new_end_frame;
+	get_frame_range(owner, new_start_frame, new_end_frame);
+	int64_t timeline_offset = new_start_frame - (int64_t(owner->Start() * info.fps.ToDouble()) + 1);
+
+	// Find the changed frames (relative to the clip or effect)
+	int64_t first_frame, last_frame;
+	bool changed = find_changed_frames(old_json, new_json, first_frame, last_frame);
+	bool all_frames = first_frame == std::numeric_limits<int64_t>::min() && last_frame == std::numeric_limits<int64_t>::max();
+	if (changed && last_frame != std::numeric_limits<int64_t>::max()) {
+		// Audio fades also read the volume of the previous frame
+		last_frame++;
+	}
+
+	// Was it moved, trimmed or moved to another layer? (a clip effect always covers its clip)
+	bool moved = false;
+	if (object == owner) {
+		for (const std::string key : {"position", "start", "end", "layer"})
+			moved |= old_json[key] != new_json[key];
+	}
+
+	// Did the images and/or the audio of the frames change
+	bool video, audio;
+	find_changed_media(object, old_json, new_json, video, audio);
+
+	if (moved) {
+		// Every frame covered before (and after) the update is affected
+		if (parent_clip) {
+			remove_cached_frames(old_start_frame, old_end_frame, video, audio);
+			remove_cached_frames(new_start_frame, new_end_frame, video, audio);
+		} else {
+			remove_effect_frames(old_start_frame, old_end_frame, old_json["layer"].asInt(), video, audio);
+			remove_effect_frames(new_start_frame, new_end_frame, owner->Layer(), video, audio);
+		}
+	} else if (changed) {
+		// Only the changed frames (which are visible on the timeline) are affected
+		int64_t start_frame = new_start_frame;
+		int64_t end_frame = new_end_frame;
+		if (first_frame != std::numeric_limits<int64_t>::min())
+			start_frame = std::max(start_frame, first_frame + timeline_offset);
+		if (last_frame != std::numeric_limits<int64_t>::max())
+			end_frame = std::min(end_frame, last_frame + timeline_offset);
+		if (start_frame <= end_frame) {
+			if (parent_clip)
+				remove_cached_frames(start_frame, end_frame, video, audio);
+			else
+				remove_effect_frames(start_frame, end_frame, owner->Layer(), video, audio);
+		}
+	}
+
+	// Moving a clip doesn't change its frames, unless timeline effects (which clips cache
+	// their frames with) are found on its old or new layer
+	if (moved && parent_clip) {
+		for (auto effect : effects) {
+			if (effect->Layer() == old_json["layer"].asInt() || effect->Layer() == parent_clip->Layer()) {
+				changed = all_frames = true;
+				break;
+			}
+		}
+	}
+
+	// Remove the changed frames from the clip's cache
+	if (parent_clip && changed) {
+		if (all_frames)
+			parent_clip->GetCache()->Clear();
+		else
+			parent_clip->GetCache()->Remove(std::max(first_frame, int64_t(1)), last_frame);
+	}
+}
+
+// Determine if an update to a clip or effect changes the images and/or the audio of its frames
+void Timeline::find_changed_media(ClipBase* object, const Json::Value& old_json, const Json::Value& new_json, bool& video, bool& audio) {
+	// Effects change what they process (the images and/or the audio)
+	if (EffectBase* effect = dynamic_cast<EffectBase*>(object)) {
+		audio = effect->info.has_audio;
+		video = effect->info.has_video || !audio;
+		return;
+	}
+
+	if (old_json.isNull()) {
+		// Adding or removing a clip without audio (i.e. an image or a title) only changes the images
+		video = true;
+		audio = true;
+		Clip* clip = dynamic_cast<Clip*>(object);
+		try {
+			if (clip)
+				audio = clip->Reader()->info.has_audio;
+		} catch (const ReaderClosed & e) {
+			// ...
+		}
+		return;
+	}
+
+	// The properties of a clip which only change the images, or only the audio (any other change, i.e. of
+	// the reader, time mapping, position or effects, changes both)
+	static const std::set<std::string> video_properties = {
+		"alpha", "anchor", "display", "gravity", "has_video", "id", "layer", "location_x", "location_y",
+		"origin_x", "origin_y", "parentObjectId", "perspective_c1_x", "perspective_c1_y", "perspective_c2_x",
+		"perspective_c2_y", "perspective_c3_x", "perspective_c3_y", "perspective_c4_x", "perspective_c4_y",
+		"rotation", "scale", "scale_x", "scale_y", "shear_x", "shear_y", "wave_color", "waveform"};
+	static const std::set<std::string> audio_properties = {
+		"channel_filter", "channel_mapping", "has_audio", "mixing", "volume"};
+
+	video = false;
+	audio = false;
+	std::vector<std::string> keys = old_json.getMemberNames();
+	for (const auto& key : new_json.getMemberNames())
+		keys.push_back(key);
+	for (const auto& key : keys) {
+		if (old_json[key] == new_json[key])
+			continue;
+		if (video_properties.count(key))
+			video = true;
+		else if (audio_properties.count(key))
+			audio = true;
+		else
+			video = audio = true;
+	}
+
+	// The waveform is drawn from the audio
+	if (audio && new_json["waveform"].asBool())
+		video = true;
+	if (!video && !audio)
+		video = audio = true;
+}
+
 // Apply JSON diff to timeline properties
-void Timeline::apply_json_to_timeline(Json::Value change) {
+void Timeline::apply_json_to_timeline(const Json::Value& change) {
 	bool cache_dirty = true;
 
 	// Get key and type of change
@@ -1657,10 +3023,24 @@ void Timeline::apply_json_to_timeline(Json::Value change) {
 // Clear all caches
 void Timeline::ClearAllCache(bool deep) {
 
-	// Clear primary cache
+	// Clear primary cache (and the cached frames of the other preview sizes)
 	if (final_cache) {
 		final_cache->Clear();
 	}
+	clear_preview_caches();
+	{
+		const std::lock_guard<std::mutex> lock(staticFrameMutex);
+		static_frame = nullptr;
+	}
+	mixed_audio_cache->Clear();
+	mixed_image_cache->Clear();
+
+	// Clear the caches of all clips
+	clear_clip_caches(deep);
+}
+
+// Clear the cached frames of the clips (and of their nested readers, if deep)
+void Timeline::clear_clip_caches(bool deep) {
 
 	// Loop through all clips
 	try {
@@ -1683,6 +3063,26 @@ void Timeline::ClearAllCache(bool deep) {
 	}
 }
 
+// Only render the audio of this timeline
+void Timeline::AudioOnly(bool enabled) {
+	// Get lock (prevent getting frames while this happens)
+	std::unique_lock<std::recursive_mutex> guard(getFrameMutex);
+	wait_for_rendering(guard);
+
+	if (enabled == audio_only)
+		return;
+	audio_only = enabled;
+
+	// Disable (or restore) video decoding of all clips
+	for (auto clip : clips)
+		apply_audio_only_to_clip(clip, audio_only);
+	if (!audio_only)
+		audio_only_readers.clear();
+
+	// Cached frames (and the frames of the nested readers) were created for the other mode
+	ClearAllCache(true);
+}
+
 // Set Max Image Size (used for performance optimization). Convenience function for setting
 // Settings::Instance()->MAX_WIDTH and Settings::Instance()->MAX_HEIGHT.
 void Timeline::SetMaxSize(int width, int height) {
@@ -1693,7 +3093,48 @@ void Timeline::SetMaxSize(int width, int height) {
 	// Scale QSize up to proposed size
 	display_ratio_size.scale(proposed_size, Qt::KeepAspectRatio);
 
-	// Update preview settings
-	preview_width = display_ratio_size.width();
-	preview_height = display_ratio_size.height();
+	// Update preview settings (cached frames of other sizes are kept, for when the size changes back)
+	set_preview_settings(display_ratio_size.width(), display_ratio_size.height(), render_quality);
+}
+
+// Match the preview size and quality of a nested timeline (the reader of a clip) to its parent timeline
+void Timeline::apply_parent_settings() {
+	Clip *parent = static_cast<Clip *>(ParentClip());
+	if (!parent || !parent->ParentTimeline() || info.width <= 0 || info.height <= 0)
+		return;
+	TimelineBase *parent_timeline = parent->ParentTimeline();
+
+	// The max size this timeline's frames are shown at (in its parent's preview)
+	const QSize full_size(info.width, info.height);
+	const QSize max_size = parent->GetMaxSourceSize(info.width, info.height, info.width, info.height).boundedTo(full_size);
+	if (max_size.isEmpty())
+		return;
+	const QSize preview_size = full_size.scaled(max_size, Qt::KeepAspectRatio);
+	if (preview_size == QSize(preview_width, preview_height) && parent_timeline->render_quality == render_quality)
+		return;
+
+	// Get lock (prevent getting frames while this happens)
+	std::unique_lock<std::recursive_mutex> guard(getFrameMutex);
+	wait_for_rendering(guard);
+
+	set_preview_settings(preview_size.width(), preview_size.height(), render_quality);
+	SetRenderQuality(parent_timeline->render_quality);
+}
+
+// Set the quality of rendered frames
+void Timeline::SetRenderQuality(RenderQuality quality) {
+	if (quality == render_quality)
+		return;
+
+	// Get lock (prevent getting frames while this happens)
+	std::unique_lock<std::recursive_mutex> guard(getFrameMutex);
+	wait_for_rendering(guard);
+
+	// Keep the cached frames of the old quality (for when it changes back), or clear them
+	if (!managed_cache && final_cache)
+		final_cache->Clear();
+	set_preview_settings(preview_width, preview_height, quality);
+
+	// The cached frames of the clips and readers were rendered at the old quality
+	clear_clip_caches(true);
 }
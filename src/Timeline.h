@@ -13,10 +13,14 @@
 #ifndef OPENSHOT_TIMELINE_H
 #define OPENSHOT_TIMELINE_H
 
+#include <condition_variable>
+#include <future>
 #include <list>
 #include <memory>
 #include <mutex>
 #include <set>
+#include <unordered_map>
+#include <vector>
 #include <QtGui/QImage>
 #include <QtGui/QPainter>
 #include <QtCore/QRegularExpression>
@@ -149,32 +153,201 @@ namespace openshot {
 	private:
 		bool is_open; ///<Is Timeline Open?
 		bool auto_map_clips; ///< Auto map framerates and sample rates to all clips
+		bool audio_only; ///< Only mix audio (no images are created, composited or decoded)
+		std::map<openshot::ReaderBase*, bool> audio_only_readers; ///< Readers with video decoding disabled by audio-only mode (and their has_video value)
 		std::list<openshot::Clip*> clips; ///<List of clips on this timeline
 		std::list<openshot::Clip*> closing_clips; ///<List of clips that need to be closed
 		std::map<openshot::Clip*, openshot::Clip*> open_clips; ///<List of 'opened' clips on this timeline
+		std::map<openshot::Clip*, std::future<void>> preparing_clips; ///< Clips starting soon, which are opened (and pre-decoded) in the background
 		std::set<openshot::Clip*> allocated_clips; ///<List of clips that were allocated by this timeline
 		std::list<openshot::EffectBase*> effects; ///<List of clips on this timeline
 		std::set<openshot::EffectBase*> allocated_effects; ///<List of effects that were allocated by this timeline
 		openshot::CacheBase *final_cache; ///<Final cache of timeline frames
+		std::unique_ptr<openshot::CacheBase> mixed_audio_cache; ///< The mixed audio of cached frames whose images were changed by an edit
+		std::unique_ptr<openshot::CacheBase> mixed_image_cache; ///< Cached frames whose audio was changed by an edit (their images are re-used)
 		std::set<openshot::FrameMapper*> allocated_frame_mappers; ///< all the frame mappers we allocated and must free
 		bool managed_cache; ///< Does this timeline instance manage the cache object
 		std::string path; ///< Optional path of loaded UTF-8 OpenShot JSON project file
 		int max_concurrent_frames; ///< Max concurrent frames to process at one time
 		double max_time; ///> The max duration (in seconds) of the timeline, based on all the clips
+		int rendering_frames; ///< Number of frames currently being composited (outside of getFrameMutex)
+		std::condition_variable_any renderingCondition; ///< Signaled when rendering_frames drops to zero
+
+		/// The timeline frames covered by a clip (used to quickly find the clips at a frame). These are
+		/// calculated once (in the timeline's frame rate) whenever clips are added, removed or moved, so
+		/// every frame uses the same integer frame numbers (instead of rounding the clip's position again).
+		struct ClipFrameRange {
+			int64_t start_frame; ///< The first timeline frame of the clip
+			int64_t end_frame; ///< The timeline frame after the clip's last frame (overlapping clips look one frame past the end)
+			int64_t clip_start_frame; ///< The clip's frame number at start_frame (from its Start())
+			size_t order; ///< The index of the clip in the (sorted) clips list
+			openshot::Clip* clip;
+		};
+		std::vector<ClipFrameRange> clip_ranges; ///< Frame ranges of all clips (sorted by start frame)
+		std::vector<int64_t> clip_ranges_max_end; ///< Max end frame of all clip_ranges up to (and including) each index
+		std::unordered_map<openshot::Clip*, size_t> clip_range_index; ///< Index of each clip in clip_ranges
+		bool clip_ranges_dirty; ///< Clips were added, removed or moved since clip_ranges was built
+		double clip_ranges_fps; ///< The frame rate clip_ranges was built with
 
 		std::map<std::string, std::shared_ptr<openshot::TrackedObjectBase>> tracked_objects; ///< map of TrackedObjectBBoxes and their IDs
 
-		/// Process a new layer of video or audio
-		void add_layer(std::shared_ptr<openshot::Frame> new_frame, openshot::Clip* source_clip, int64_t clip_frame_number, bool is_top_clip, float max_volume);
+		/// @name Lookups by id (used by GetClip, GetEffect and GetClipEffect)
+		///@{
+		std::unordered_multimap<std::string, openshot::Clip*> clip_ids; ///< The clips on this timeline, by id
+		std::unordered_multimap<std::string, openshot::EffectBase*> effect_ids; ///< The timeline effects, by id
+		std::unordered_map<std::string, openshot::Clip*> clip_effect_ids; ///< The clip of each clip effect, by effect id
+		bool clip_effect_ids_dirty; ///< Clips (or ids) changed since clip_effect_ids was built
+		std::mutex idsMutex;
+		///@}
+
+		/// The cached frames of a previous preview size and quality (see SetMaxSize and SetRenderQuality)
+		struct PreviewCache {
+			int width;
+			int height;
+			openshot::RenderQuality quality;
+			openshot::CacheBase* cache;
+		};
+		std::list<PreviewCache> preview_caches; ///< The cached frames of previous preview settings (most recently used first)
+		static constexpr size_t MAX_PREVIEW_CACHES = 3; ///< The max number of previous preview settings with cached frames
+
+		int update_depth; ///< The number of nested BeginUpdate() calls
+		bool clips_unsorted; ///< Clips changed during the update (and need to be sorted)
+		bool effects_unsorted; ///< Effects changed during the update (and need to be sorted)
+		std::vector<openshot::Clip*> pending_clips; ///< Clips added during the update (and not prepared yet)
+
+		/// A clip's frame of a timeline frame
+		struct LayerRequest {
+			openshot::Clip* clip; ///< The clip
+			int64_t clip_frame_number; ///< The frame number of the clip
+			bool is_top_clip; ///< Is the clip on top of its layer (when clips overlap)
+			std::shared_ptr<openshot::Frame> frame; ///< The clip's frame (nullptr if it could not be read)
+			QRect layer_rect; ///< The region of the timeline frame covered by the frame (if not composited yet)
+			std::shared_ptr<openshot::GpuLayer> gpu_layer; ///< The clip's deferred transform and effects (if the GPU composites the frame)
+			uint64_t render_key = 0; ///< The key of the clip's frame in the RenderCache (0 = not cached)
+		};
+
+		/// @brief Get a clip's frame (or nullptr, if its reader was just closed)
+		/// @param new_frame The timeline frame
+		/// @param layer The clip's request (the frame is set)
+		/// @param composite Composite the clip's frame onto the timeline frame (instead of only rendering it)
+		/// @param audio_only Only render the clip's audio (i.e. when the image of the timeline frame is re-used)
+		void render_layer(std::shared_ptr<openshot::Frame> new_frame, LayerRequest& layer, bool composite, bool audio_only = false);
+
+		/// What the image of a static timeline frame depends on (its background and the source image of each clip)
+		struct StaticImage {
+			std::string color; ///< The background color
+			std::vector<std::pair<openshot::Clip*, int64_t>> clip_images; ///< Each clip (in layer order) and its Clip::StaticImageKey
+			std::vector<bool> top_clips; ///< Is each clip on top of its layer
+
+			bool operator==(const StaticImage& other) const {
+				return color == other.color && clip_images == other.clip_images && top_clips == other.top_clips;
+			}
+		};
+
+		/// @brief Determine if the image of a timeline frame only depends on static clips (see Clip::StaticImageKey)
+		/// @returns False if any clip (or effect) can change the image between frames
+		/// @param requested_frame The timeline frame
+		/// @param layers The clips of the frame
+		/// @param static_image Set to what the image of the frame depends on
+		bool find_static_image(int64_t requested_frame, const std::vector<LayerRequest>& layers, StaticImage& static_image);
+
+		/// @brief Get the key of a clip's frame in the RenderCache (see Clip::AddRenderKey), with the size of this
+		/// timeline's frames and the timeline effects applied to the clip
+		/// @returns The key (or 0, if the clip's frame can't be cached)
+		/// @param requested_frame The timeline frame
+		/// @param layer The clip of the frame
+		uint64_t layer_render_key(int64_t requested_frame, const LayerRequest& layer);
+
+		/// @brief Get the key of a composited timeline frame in the RenderCache (which combines the keys of its clips)
+		/// @returns The key (or 0, if any of the clips' frames can't be cached)
+		/// @param requested_frame The timeline frame
+		/// @param layers The clips of the frame (with their keys)
+		/// @param max_volume The sum of the volumes of the clips (see add_layer)
+		uint64_t frame_render_key(int64_t requested_frame, const std::vector<LayerRequest>& layers, float max_volume);
+
+		std::shared_ptr<openshot::Frame> static_frame; ///< The last static timeline frame (its image can be re-used by the next)
+		StaticImage static_frame_image; ///< What the image of static_frame depends on
+		std::mutex staticFrameMutex; ///< Protects static_frame
+
+		/// @brief Composite the rendered images of clips onto the timeline frame (in layer order)
+		/// @param new_frame The timeline frame
+		/// @param layers The clips' requests (whose frames were rendered without compositing them)
+		/// @param tiled_background The background color of a tiled canvas (see TiledImage), or an invalid color to
+		/// composite onto the frame's image
+		void composite_layers(std::shared_ptr<openshot::Frame> new_frame, std::vector<LayerRequest>& layers, const QColor& tiled_background);
+
+		/// Process a new layer of video or audio (mix the audio of a clip's frame into the timeline frame)
+		void add_layer(std::shared_ptr<openshot::Frame> new_frame, LayerRequest& layer, float max_volume);
 
 		/// Apply a FrameMapper to a clip which matches the settings of this timeline
 		void apply_mapper_to_clip(openshot::Clip* clip);
 
+		/// Disable (or restore) video decoding of a clip's reader (used by the audio-only mode)
+		void apply_audio_only_to_clip(openshot::Clip* clip, bool disable_video);
+
+		/// Prepare a clip which was added to the timeline (clear its reader's cache, and apply its FrameMapper)
+		void prepare_added_clip(openshot::Clip* clip);
+
+		/// Create the final cache (used when the timeline manages its cache)
+		openshot::CacheBase* create_final_cache();
+
+		/// Change the preview size and quality (and switch to the cached frames of those settings, if any)
+		void set_preview_settings(int width, int height, openshot::RenderQuality quality);
+
+		/// Clear the cached frames of the clips (and of their nested readers, if deep)
+		void clear_clip_caches(bool deep);
+
+		/// Get a frame of the current preview size, by scaling down a cached frame of a larger preview size (if any)
+		std::shared_ptr<openshot::Frame> get_scaled_cached_frame(int64_t number);
+
+		/// @brief Remove a range of frames from the final cache (and the cached frames of the other preview sizes)
+		///
+		/// If only the images (or only the audio) of the frames changed, the part which is still valid is kept
+		/// (in mixed_audio_cache or mixed_image_cache), so GetFrame doesn't render (or decode and mix) it again.
+		/// @param start_frame The first timeline frame to remove
+		/// @param end_frame The last timeline frame to remove
+		/// @param video Did the images of the frames change
+		/// @param audio Did the audio of the frames change
+		void remove_cached_frames(int64_t start_frame, int64_t end_frame, bool video = true, bool audio = true);
+
+		/// Delete the cached frames of the other preview sizes
+		void clear_preview_caches();
+
+		/// @brief Match the preview size and quality of a nested timeline to its parent timeline
+		///
+		/// A nested timeline (the reader of a clip) renders its frames at the size its parent clip shows them at
+		/// in the parent timeline's preview (see Clip::GetMaxSourceSize), and at the parent timeline's quality.
+		void apply_parent_settings();
+
 		// Apply JSON Diffs to various objects contained in this timeline
-		void apply_json_to_clips(Json::Value change); ///<Apply JSON diff to clips
-		void apply_json_to_effects(Json::Value change); ///< Apply JSON diff to effects
-		void apply_json_to_effects(Json::Value change, openshot::EffectBase* existing_effect); ///<Apply JSON diff to a specific effect
-		void apply_json_to_timeline(Json::Value change); ///<Apply JSON diff to timeline properties
+		void apply_json_to_clips(const Json::Value& change); ///<Apply JSON diff to clips
+		void apply_json_to_effects(const Json::Value& change); ///< Apply JSON diff to effects
+		void apply_json_to_effects(const Json::Value& change, openshot::EffectBase* existing_effect, openshot::Clip* parent_clip=NULL); ///<Apply JSON diff to a specific effect (of the timeline, or of a clip)
+		void apply_json_to_timeline(const Json::Value& change); ///<Apply JSON diff to timeline properties
+
+		/// Get the timeline frames covered by a clip or effect (the same range GetFrame checks)
+		void get_frame_range(openshot::ClipBase* object, int64_t& start_frame, int64_t& end_frame);
+
+		/// Remove a range of timeline frames from the final cache, and from the cache of each clip on a
+		/// layer (since clips cache their frames with the timeline effects of their layer applied)
+		void remove_effect_frames(int64_t start_frame, int64_t end_frame, int layer, bool video = true, bool audio = true);
+
+		/// @brief Remove only the cached frames affected by an update to a clip or effect
+		///
+		/// Compares the JSON of the object before and after the update. Changed keyframes only affect the frames
+		/// between their unchanged neighbouring points, while moving or trimming the object affects its old and
+		/// new range, and any other changed property affects every frame of the object.
+		/// @param object The updated clip or effect
+		/// @param parent_clip The clip of an updated clip effect (or the updated clip, or NULL for a timeline effect)
+		/// @param old_json The JSON of the object before the update
+		/// @param old_start_frame The first timeline frame covered by the object before the update
+		/// @param old_end_frame The last timeline frame covered by the object before the update
+		void remove_changed_frames(openshot::ClipBase* object, openshot::Clip* parent_clip, const Json::Value& old_json, int64_t old_start_frame, int64_t old_end_frame);
+
+		/// Determine if an update to a clip or effect changes the images and/or the audio of its frames (i.e. a
+		/// transform keyframe only changes the images, and the volume only changes the audio). With a null
+		/// old_json, the object is added or removed (i.e. an image clip or a video effect only changes the images).
+		void find_changed_media(openshot::ClipBase* object, const Json::Value& old_json, const Json::Value& new_json, bool& video, bool& audio);
 
 		/// Calculate the max duration (in seconds) of the timeline, based on all the clips, and cache the value
 		void calculate_max_duration();
@@ -190,8 +363,8 @@ namespace openshot {
 		/// @param include Include or Exclude intersecting clips
 		std::vector<openshot::Clip*> find_intersecting_clips(int64_t requested_frame, int number_of_frames, bool include);
 
-		/// Get a clip's frame or generate a blank frame
-		std::shared_ptr<openshot::Frame> GetOrCreateFrame(std::shared_ptr<Frame> background_frame, openshot::Clip* clip, int64_t number, openshot::TimelineInfoStruct* options);
+		/// Rebuild the frame ranges of all clips (only if clips were added, removed or moved, or the frame rate changed)
+		void update_clip_ranges();
 
 		/// Compare 2 floating point numbers for equality
 		bool isEqual(double a, double b);
@@ -205,6 +378,24 @@ namespace openshot {
 		/// Update the list of 'opened' clips
 		void update_open_clips(openshot::Clip *clip, bool does_clip_intersect);
 
+		/// @brief Open (and pre-decode) the clips which start soon in the background (see Settings::CLIP_LOOK_AHEAD_FRAMES),
+		/// and close the prepared clips which no longer start soon
+		/// @param max_requested_frame The last requested frame
+		/// @param intersecting_clips The clips at the requested frames (which are opened already)
+		void prepare_upcoming_clips(int64_t max_requested_frame, const std::vector<openshot::Clip*>& intersecting_clips);
+
+		/// @brief Wait for a clip to be prepared in the background (if it is)
+		/// @returns True if the clip was being prepared (so it is open now)
+		bool finish_preparing_clip(openshot::Clip *clip);
+
+		/// Wait for all in-flight frames to finish compositing (the lock must hold getFrameMutex).
+		/// Structural edits (adding/removing clips & effects, JSON changes, etc...) call this first,
+		/// since frames are composited in parallel without holding getFrameMutex.
+		void wait_for_rendering(std::unique_lock<std::recursive_mutex>& lock);
+
+		/// Mark an in-flight frame as finished, and close any clips which were deferred while rendering
+		void end_rendering();
+
 	public:
 
 		/// @brief Constructor for the timeline (which configures the default frame properties)
@@ -246,6 +437,27 @@ namespace openshot {
 		/// @param clip Add an openshot::Clip to the timeline. A clip can contain any type of Reader.
 		void AddClip(openshot::Clip* clip);
 
+		/// @brief Add many clips to the timeline (which are sorted once, instead of after each clip)
+		/// @param new_clips The clips to add
+		void AddClips(const std::vector<openshot::Clip*>& new_clips);
+
+		/// @brief Start a batch of changes to the timeline
+		///
+		/// Until the matching EndUpdate(), clips and effects are not sorted, and added clips are not
+		/// prepared (their FrameMappers and caches), so adding many clips doesn't re-sort the timeline
+		/// after each one. Calls can be nested. Don't request frames during an update.
+		///
+		/// \code
+		/// t.BeginUpdate();
+		/// for (auto clip : clips)
+		///     t.AddClip(clip);
+		/// t.EndUpdate();
+		/// \endcode
+		void BeginUpdate();
+
+		/// Finish a batch of changes (and sort and prepare the changed clips and effects)
+		void EndUpdate();
+
 		/// @brief Add an effect to the timeline
 		/// @param effect Add an effect to the timeline. An effect can modify the audio or video of an openshot::Frame.
 		void AddEffect(openshot::EffectBase* effect);
@@ -262,6 +474,17 @@ namespace openshot {
 		/// @brief Automatically map all clips to the timeline's framerate and samplerate
 		void AutoMapClips(bool auto_map) { auto_map_clips = auto_map; };
 
+		/// Determine if only audio is rendered (see AudioOnly(bool))
+		bool AudioOnly() const { return audio_only; };
+
+		/// @brief Only render the audio of this timeline (i.e. when exporting audio-only files)
+		///
+		/// Frames are created without images, clips without audio are skipped, and only the audio
+		/// (and the audio effects) of each clip is mixed. The video streams of the clips' readers are not
+		/// decoded at all (their info.has_video is restored when audio-only mode is disabled).
+		/// @param enabled Only render audio
+		void AudioOnly(bool enabled);
+
 		/// Clear all clips, effects, and frame mappers from timeline (and free memory)
 		void Clear();
 
@@ -295,6 +518,30 @@ namespace openshot {
 		/// Return the list of effects on all clips
 		std::list<openshot::EffectBase*> ClipEffects() const;
 
+		/// @brief Get the time spent in each stage of rendering frames, as JSON (see Settings::ENABLE_RENDER_STATS)
+		///
+		/// Each stage (i.e. "decode", "effect" or "composite") has a count, total_ms, average_ms and max_ms,
+		/// and "effects" has the stats of each effect on this timeline and its clips (by effect id).
+		/// "allocations" has the heap allocations of each subsystem (only counted by builds with
+		/// ENABLE_ALLOCATION_TRACKING, see AllocationStats).
+		std::string GetRenderStats();
+
+		/// Forget the render stats (of all stages, and of the effects on this timeline and its clips)
+		void ResetRenderStats();
+
+		/// @brief Get the hit, miss and eviction counters of the caches, as JSON (see CacheStats)
+		///
+		/// "final_cache" has the counters of the timeline cache, "clips" has the counters of each clip
+		/// (its cache and the caches of its readers, by clip id), and "clips_total" adds up all clips.
+		/// "budget" has the bytes held by all caches together (and their max bytes, see CacheBudget).
+		std::string CacheStatsJson();
+
+		/// Reset the counters of the timeline cache and the clip caches
+		void ResetCacheStats() override;
+
+		/// Pass the sequential hint to the clips (see ReaderBase::SetSequentialHint)
+		void SetSequentialHint(bool sequential) override;
+
 		/// Get the cache object used by this reader
 		openshot::CacheBase* GetCache() override { return final_cache; };
 
@@ -302,7 +549,9 @@ namespace openshot {
 		/// of this cache object though (Timeline will not delete it for you).
 		void SetCache(openshot::CacheBase* new_cache);
 
-		/// Get an openshot::Frame object for a specific frame number of this timeline.
+		/// Get an openshot::Frame object for a specific frame number of this timeline. This is
+		/// thread-safe, and different frame numbers are composited in parallel when requested from
+		/// multiple threads (structural changes, such as AddClip or ApplyJsonDiff, wait for them).
 		///
 		/// @returns The requested frame (containing the image)
 		/// @param requested_frame The frame number that is requested.
@@ -328,10 +577,42 @@ namespace openshot {
 		Json::Value JsonValue() const override; ///< Generate Json::Value for this object
 		void SetJsonValue(const Json::Value root) override; ///< Load Json::Value into this object
 
+		/// @brief Generate the compact binary serialization of this object (see openshot::jsonToBinary)
+		///
+		/// The binary format holds the same data as Json(), but is much smaller, and much faster to load
+		/// for large projects. JSON remains the interchange format. A project file can be saved in either
+		/// format, and the project file constructor detects which one it is.
+		std::string Binary() const;
+		void SetBinary(const std::string& value); ///< Load the binary serialization (from Binary()) into this object
+
+		/// @brief Create an independent copy of this timeline, for exporting or rendering while it is edited
+		///
+		/// The clips, effects and keyframes are copied in a consistent state (edits wait until they are copied,
+		/// which is quick), and the copy has its own readers and caches. An export (i.e. FFmpegWriter::WriteFrame)
+		/// or background render of the copy never waits for the editor, and edits of this timeline (i.e. with
+		/// ApplyJsonDiff) don't change it. Decoded still images and the RenderCache are still shared.
+		/// The copy is not open (call Open() before getting frames).
+		std::unique_ptr<openshot::Timeline> Snapshot();
+
 		/// Set Max Image Size (used for performance optimization). Convenience function for setting
 		/// Settings::Instance()->MAX_WIDTH and Settings::Instance()->MAX_HEIGHT.
+		///
+		/// The cached frames of the last few preview sizes are kept (when the timeline manages its cache), so
+		/// changing back to a previous size re-uses its frames, and frames missing at a smaller size are scaled
+		/// down from the cached frames of a larger size (instead of rendered again).
 		void SetMaxSize(int width, int height);
 
+		/// @brief Set the quality of rendered frames (and clear the caches of the clips, which hold frames of the old quality)
+		///
+		/// The cached timeline frames of the old quality are kept (when the timeline manages its cache), so changing
+		/// back (i.e. after scrubbing at draft quality) re-uses them. Draft quality trades quality for latency (i.e. while scrubbing): video is decoded without the deblocking
+		/// filter and scaled with the nearest pixels, transformed clips and captions are not antialiased, and
+		/// expensive effects (i.e. Blur and ChromaKey) use approximate kernels. Use final quality for exporting.
+		void SetRenderQuality(openshot::RenderQuality quality);
+
+		/// Get the quality of rendered frames
+		openshot::RenderQuality GetRenderQuality() const { return render_quality; }
+
 		/// @brief Apply a special formatted JSON object, which represents a change to the timeline (add, update, delete)
 		/// This is primarily designed to keep the timeline (and its child objects... such as clips and effects) in sync
 		/// with another application... such as OpenShot Video Editor (http://www.openshot.org).
@@ -352,6 +633,12 @@ namespace openshot {
 		/// @brief Sort all clips and effects on timeline - which affects the internal order of clips and effects arrays
 		/// This is called automatically when Clips or Effects modify the Layer(), Position(), Start(), or End().
 		void SortTimeline() { sort_clips(); sort_effects(); }
+
+		/// @brief Update the lookups by id of a clip or effect whose id changed
+		/// This is called automatically when Clips or Effects modify their Id().
+		/// @param object The clip or effect
+		/// @param old_id The previous id of the clip or effect
+		void UpdateId(openshot::ClipBase* object, const std::string& old_id);
 	};
 
 }
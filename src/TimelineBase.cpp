@@ -11,11 +11,49 @@
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
 #include "TimelineBase.h"
+#include "OpenMPUtilities.h"
 
 using namespace openshot;
 
 /// Constructor for the base timeline
 TimelineBase::TimelineBase()
     : preview_width(1920),
-      preview_height(1080) { }
+      preview_height(1080),
+      render_quality(RENDER_QUALITY_FINAL),
+      omp_threads(0),
+      ff_threads(0),
+      hardware_decoder(-1),
+      high_quality_scaling(-1) { }
+
+// Get the number of threads which render frames of this timeline
+int TimelineBase::OmpThreads() const
+{
+    if (omp_threads <= 0)
+        return OPEN_MP_NUM_PROCESSORS;
+    return std::min(omp_get_num_procs(), std::max(2, omp_threads));
+}
+
+// Get the number of threads of each FFmpeg decoder of this timeline
+int TimelineBase::FFThreads() const
+{
+    if (ff_threads <= 0)
+        return FF_NUM_PROCESSORS;
+    return std::min(omp_get_num_procs(), std::max(2, ff_threads));
+}
+
+// Get the hardware decoder of this timeline's readers
+int TimelineBase::HardwareDecoder() const
+{
+    if (hardware_decoder < 0)
+        return Settings::Instance()->HARDWARE_DECODER;
+    return hardware_decoder;
+}
+
+// Are decoded images scaled with high quality scaling?
+bool TimelineBase::HighQualityScaling() const
+{
+    if (high_quality_scaling < 0)
+        return Settings::Instance()->HIGH_QUALITY_SCALING;
+    return high_quality_scaling > 0;
+}
 
@@ -16,6 +16,8 @@
 #include <cstdint>
 #include <list>
 
+#include "Enums.h"
+
 
 namespace openshot {
 	// Forward decl
@@ -33,6 +35,7 @@ namespace openshot {
 	{
 		bool is_top_clip;				 ///< Is clip on top (if overlapping another clip)
 		bool is_before_clip_keyframes;	///< Is this before clip keyframes are applied
+		bool is_audio_only;				///< Only the audio is needed (skip all image processing)
 	};
 
 	/**
@@ -43,10 +46,36 @@ namespace openshot {
 	public:
 		int preview_width; ///< Optional preview width of timeline image. If your preview window is smaller than the timeline, it's recommended to set this.
 		int preview_height; ///< Optional preview width of timeline image. If your preview window is smaller than the timeline, it's recommended to set this.
+		openshot::RenderQuality render_quality; ///< The quality of rendered frames (see Timeline::SetRenderQuality)
+
+		/// @name Overrides of the global Settings, for this timeline (and its clips and readers)
+		/// Several timelines can render at once (i.e. a preview and an export), and partition the cores
+		/// between them. Each override defaults to the global Settings.
+		///@{
+		int omp_threads; ///< Threads which render frames of this timeline (0 = Settings::OMP_THREADS)
+		int ff_threads; ///< Threads of each FFmpeg decoder of this timeline (0 = Settings::FF_THREADS)
+		int hardware_decoder; ///< Hardware decoder of this timeline's readers (-1 = Settings::HARDWARE_DECODER)
+		int high_quality_scaling; ///< Scale decoded images with bicubic scaling (-1 = Settings::HIGH_QUALITY_SCALING)
+		///@}
 
 		/// Constructor for the base timeline
 		TimelineBase();
 
+		/// Are frames rendered as faster, lower quality previews? (readers and effects check this)
+		bool IsDraftQuality() const { return render_quality == openshot::RENDER_QUALITY_DRAFT; }
+
+		/// Get the number of threads which render frames of this timeline (like OPEN_MP_NUM_PROCESSORS)
+		int OmpThreads() const;
+
+		/// Get the number of threads of each FFmpeg decoder of this timeline (like FF_NUM_PROCESSORS)
+		int FFThreads() const;
+
+		/// Get the hardware decoder of this timeline's readers (see Settings::HARDWARE_DECODER)
+		int HardwareDecoder() const;
+
+		/// Are decoded images scaled with high quality scaling? (see Settings::HIGH_QUALITY_SCALING)
+		bool HighQualityScaling() const;
+
 		/// This function will be overloaded in the Timeline class passing no arguments
 		/// so we'll be able to access the Timeline::Clips() function from a pointer object of
 		/// the TimelineBase class
@@ -11,11 +11,14 @@
 //
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
+#include <algorithm>
+#include <cmath>
 #include <fstream>
 
 #include "TrackedObjectBBox.h"
 
 #include "Clip.h"
+#include "ProtobufFrameIndex.h"
 
 #include "trackerdata.pb.h"
 #include <google/protobuf/util/time_util.h>
@@ -24,6 +27,73 @@ using google::protobuf::util::TimeUtil;
 
 using namespace openshot;
 
+// Find the index of the first box at (or after) a time
+size_t BBoxVector::lower_bound_index(double time) const
+{
+	const size_t count = items.size();
+	if (count == 0 || time <= items.front().first)
+		return 0;
+	if (time > items.back().first)
+		return count;
+
+	// Guess the index from the average spacing of the boxes (exact for evenly spaced boxes)
+	const double spacing = (items.back().first - items.front().first) / (count - 1);
+	size_t guess = count - 1;
+	if (spacing > 0.0)
+		guess = std::min(count - 1, std::max<size_t>(1, (size_t) std::ceil((time - items.front().first) / spacing)));
+
+	// Check the guess (and its neighbours), since the frame times are not exactly evenly spaced
+	for (size_t index = std::max<size_t>(1, guess - 1); index <= std::min(count - 1, guess + 1); index++) {
+		if (items[index - 1].first < time && time <= items[index].first)
+			return index;
+	}
+
+	// Unevenly spaced boxes
+	auto it = std::lower_bound(items.begin(), items.end(), time, [](const value_type& item, double value) {
+		return item.first < value;
+	});
+	return it - items.begin();
+}
+
+// Get the box at a time
+BBoxVector::iterator BBoxVector::find(double time)
+{
+	auto it = lower_bound(time);
+	return (it != items.end() && it->first == time) ? it : items.end();
+}
+
+// Get the box at a time
+BBoxVector::const_iterator BBoxVector::find(double time) const
+{
+	auto it = lower_bound(time);
+	return (it != items.end() && it->first == time) ? it : items.end();
+}
+
+// Insert a box (unless there is already a box at its time)
+std::pair<BBoxVector::iterator, bool> BBoxVector::insert(const value_type& value)
+{
+	auto it = lower_bound(value.first);
+	if (it != items.end() && it->first == value.first)
+		return {it, false};
+	return {items.insert(it, value), true};
+}
+
+// Remove the box at a time
+size_t BBoxVector::erase(double time)
+{
+	auto it = find(time);
+	if (it == items.end())
+		return 0;
+	items.erase(it);
+	return 1;
+}
+
+// Get the box at a time (inserting an empty box, if there isn't one)
+BBox& BBoxVector::operator[](double time)
+{
+	return insert({time, BBox()}).first->second;
+}
+
 // Default Constructor, delegating
 TrackedObjectBBox::TrackedObjectBBox()
 	: TrackedObjectBBox::TrackedObjectBBox(0, 0, 255, 0) {}
@@ -235,16 +305,11 @@ void TrackedObjectBBox::ScalePoints(double time_scale){
 // Load the bounding-boxes information from the protobuf file
 bool TrackedObjectBBox::LoadBoxData(std::string inputFilePath)
 {
-	using std::ios;
-
-	// Variable to hold the loaded data
-	pb_tracker::Tracker bboxMessage;
-
-	// Read the existing tracker message.
-	std::fstream input(inputFilePath, ios::in | ios::binary);
+	// Index the frames of the existing tracker message (so they are decoded one at a time)
+	ProtobufFrameIndex index;
 
 	// Check if it was able to read the protobuf data
-	if (!bboxMessage.ParseFromIstream(&input))
+	if (!index.Open(inputFilePath))
 	{
 		std::cerr << "Failed to parse protobuf message." << std::endl;
 		return false;
@@ -253,10 +318,12 @@ bool TrackedObjectBBox::LoadBoxData(std::string inputFilePath)
 	this->clear();
 
 	// Iterate over all frames of the saved message
-	for (size_t i = 0; i < bboxMessage.frame_size(); i++)
+	pb_tracker::Frame pbFrameData;
+	for (size_t i = 0; i < index.Count(); i++)
 	{
 		// Get data of the i-th frame
-		const pb_tracker::Frame &pbFrameData = bboxMessage.frame(i);
+		if (!index.ParseFrameAt(i, pbFrameData))
+			continue;
 
 		// Get frame number
 		size_t frame_number = pbFrameData.id();
@@ -279,15 +346,13 @@ bool TrackedObjectBBox::LoadBoxData(std::string inputFilePath)
 	}
 
 	// Show the time stamp from the last update in tracker data file
-	if (bboxMessage.has_last_updated())
+	pb_tracker::Tracker bboxMessage;
+	if (index.ParseHeader(bboxMessage) && bboxMessage.has_last_updated())
 	{
 		std::cout << " Loaded Data. Saved Time Stamp: "
 				  << TimeUtil::ToString(bboxMessage.last_updated()) << std::endl;
 	}
 
-	// Delete all global objects allocated by libprotobuf.
-	google::protobuf::ShutdownProtobufLibrary();
-
 	return true;
 }
 
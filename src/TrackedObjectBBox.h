@@ -14,6 +14,9 @@
 #ifndef OPENSHOT_TRACKEDOBJECTBBOX_H
 #define OPENSHOT_TRACKEDOBJECTBBOX_H
 
+#include <utility>
+#include <vector>
+
 #include "TrackedObjectBase.h"
 
 #include "Color.h"
@@ -115,6 +118,54 @@ namespace openshot
 		}
 	};
 
+	/**
+	 * @brief A flat, time ordered list of bounding-boxes (used like a std::map<double, BBox>).
+	 *
+	 * The boxes are stored contiguously, in a sorted vector. Since tracked boxes are (nearly always)
+	 * evenly spaced in time, a lookup first guesses the position of a time from the spacing of the
+	 * boxes, and only falls back to a binary search if the guess is wrong. So looking up a box of a
+	 * dense track is O(1), and never walks a tree.
+	 */
+	class BBoxVector
+	{
+	public:
+		using value_type = std::pair<double, BBox>;
+		using iterator = std::vector<value_type>::iterator;
+		using const_iterator = std::vector<value_type>::const_iterator;
+
+	private:
+		std::vector<value_type> items; ///< Sorted by time
+
+		/// Find the index of the first box at (or after) a time
+		size_t lower_bound_index(double time) const;
+
+	public:
+		iterator begin() { return items.begin(); }
+		iterator end() { return items.end(); }
+		const_iterator begin() const { return items.begin(); }
+		const_iterator end() const { return items.end(); }
+		size_t size() const { return items.size(); }
+		bool empty() const { return items.empty(); }
+		void clear() { items.clear(); }
+
+		/// Get the first box at (or after) a time
+		iterator lower_bound(double time) { return items.begin() + lower_bound_index(time); }
+		const_iterator lower_bound(double time) const { return items.begin() + lower_bound_index(time); }
+
+		/// Get the box at a time (or end())
+		iterator find(double time);
+		const_iterator find(double time) const;
+
+		/// Insert a box (unless there is already a box at its time)
+		std::pair<iterator, bool> insert(const value_type& value);
+
+		/// Remove the box at a time (returns the number of boxes removed)
+		size_t erase(double time);
+
+		/// Get the box at a time (inserting an empty box, if there isn't one)
+		BBox& operator[](double time);
+	};
+
 	/**
 	 * @brief This class contains the properties of a tracked object
 	 * and functions to manipulate it.
@@ -134,7 +185,7 @@ namespace openshot
 		double TimeScale;
 
 	public:
-		std::map<double, BBox> BoxVec; ///< Index the bounding-box by time of each frame
+		BBoxVector BoxVec; ///< Index the bounding-box by time of each frame
 		Keyframe delta_x; ///< X-direction displacement Keyframe
 		Keyframe delta_y; ///< Y-direction displacement Keyframe
 		Keyframe scale_x; ///< X-direction scale Keyframe
@@ -0,0 +1,160 @@
+/**
+ * @file
+ * @brief Source file for WaveformRenderer class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <QImage>
+
+#include "WaveformRenderer.h"
+#include "Frame.h"
+#include "ImageBufferPool.h"
+
+#include <AppConfig.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+
+using namespace openshot;
+
+// Default constructor
+WaveformRenderer::WaveformRenderer() : width(0), height(0), color(0), reused(0) { }
+
+// Get the spans of the waveform of a frame's audio
+std::vector<int> WaveformRenderer::GetSpans(Frame& frame, int width, int height)
+{
+	std::vector<int> spans;
+	const int total_samples = frame.GetAudioSamplesCount();
+	const int channels = frame.GetAudioChannelsCount();
+	if (total_samples <= 0 || channels <= 0 || width <= 0 || height <= 0)
+		return spans;
+
+	// Each channel is 200 units high (-100 to 100), with 20 units of padding between channels
+	const float total_height = 200.0 * channels + 20.0 * (channels - 1);
+	const float scale = height / total_height;
+	const float zero_height = 1.0; // Used to clamp near-zero values to this value to prevent gaps
+
+	juce::AudioBuffer<float> *buffer = frame.GetAudioSampleBuffer();
+	spans.resize(size_t(channels) * width * 2);
+	int *span = spans.data();
+	for (int channel = 0; channel < channels; channel++)
+	{
+		const float *samples = buffer->getReadPointer(channel);
+		const float center = 100.0 + channel * 220.0;
+
+		for (int x = 0; x < width; x++, span += 2)
+		{
+			// The samples covered by this column (or the nearest sample, if there are more columns than samples)
+			const int begin = int(int64_t(x) * total_samples / width);
+			const int end = std::max(begin + 1, int(int64_t(x + 1) * total_samples / width));
+
+			float min_value = samples[begin];
+			float max_value = samples[begin];
+			for (int sample = begin + 1; sample < end; sample++) {
+				min_value = std::min(min_value, samples[sample]);
+				max_value = std::max(max_value, samples[sample]);
+			}
+
+			// Scale to -100 to 100 (and don't allow near-zero values)
+			min_value *= 100.0;
+			max_value *= 100.0;
+			if (max_value > 0.0 && max_value < zero_height)
+				max_value = zero_height;
+			if (min_value > -zero_height && min_value < 0.0)
+				min_value = -zero_height;
+
+			// Each column spans from the center to its min and max values (at least one row)
+			const int top = std::max(0, int(std::floor((center - std::max(max_value, 0.0f)) * scale)));
+			const int bottom = std::min(height, int(std::ceil((center - std::min(min_value, 0.0f)) * scale)));
+			span[0] = std::min(top, height - 1);
+			span[1] = std::max(span[0] + 1, bottom);
+		}
+	}
+
+	return spans;
+}
+
+// Rasterize spans into a new image
+std::shared_ptr<QImage> WaveformRenderer::Rasterize(const std::vector<int>& spans, int width, int height, const QColor& color)
+{
+	std::shared_ptr<QImage> image = ImageBufferPool::Instance()->CreateImage(
+		width, height, QImage::Format_RGBA8888_Premultiplied);
+	const int bytes_per_line = image->bytesPerLine();
+	unsigned char *pixels = image->bits();
+	std::memset(pixels, 0, size_t(bytes_per_line) * height);
+
+	// The premultiplied color of the waveform
+	const int alpha = color.alpha();
+	const unsigned char rgba[4] = {
+		(unsigned char) (color.red() * alpha / 255), (unsigned char) (color.green() * alpha / 255),
+		(unsigned char) (color.blue() * alpha / 255), (unsigned char) alpha };
+
+	// Fill the rows of each column's span
+	const int columns = width > 0 ? int(spans.size() / 2) : 0;
+	for (int column = 0; column < columns; column++)
+	{
+		unsigned char *pixel = pixels + (column % width) * 4;
+		for (int row = spans[column * 2]; row < spans[column * 2 + 1]; row++)
+			std::memcpy(pixel + size_t(row) * bytes_per_line, rgba, 4);
+	}
+
+	return image;
+}
+
+// Render the waveform image of a frame
+std::shared_ptr<QImage> WaveformRenderer::Render(std::shared_ptr<Frame> frame, int width, int height, const QColor& color)
+{
+	std::vector<int> new_spans;
+	if (frame)
+		new_spans = GetSpans(*frame, width, height);
+	if (new_spans.empty())
+	{
+		// No audio samples present
+		auto black_image = std::make_shared<QImage>(std::max(width, 1), std::max(height, 1), QImage::Format_RGBA8888_Premultiplied);
+		black_image->fill(QColor(QString::fromStdString("#000000")));
+		return black_image;
+	}
+
+	{
+		// Re-use the cached image (if it's the same waveform)
+		const std::lock_guard<std::mutex> lock(rendererMutex);
+		if (image && this->width == width && this->height == height && this->color == color.rgba() && spans == new_spans) {
+			reused++;
+			return std::make_shared<QImage>(*image);
+		}
+	}
+
+	// Rasterize the new waveform (outside of the lock, since frames are rendered on many threads)
+	std::shared_ptr<QImage> new_image = Rasterize(new_spans, width, height, color);
+
+	const std::lock_guard<std::mutex> lock(rendererMutex);
+	this->width = width;
+	this->height = height;
+	this->color = color.rgba();
+	spans = std::move(new_spans);
+	image = new_image;
+	return std::make_shared<QImage>(*new_image);
+}
+
+// Get the number of times the cached image was re-used
+int64_t WaveformRenderer::Reused()
+{
+	const std::lock_guard<std::mutex> lock(rendererMutex);
+	return reused;
+}
+
+// Free the cached image
+void WaveformRenderer::Clear()
+{
+	const std::lock_guard<std::mutex> lock(rendererMutex);
+	spans.clear();
+	image.reset();
+}
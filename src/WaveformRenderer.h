@@ -0,0 +1,95 @@
+/**
+ * @file
+ * @brief Header file for WaveformRenderer class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_WAVEFORM_RENDERER_H
+#define OPENSHOT_WAVEFORM_RENDERER_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <QColor>
+
+class QImage;
+
+namespace openshot {
+
+	// Forward decl
+	class Frame;
+
+	/**
+	 * @brief This class rasterizes the audio waveform of frames (and re-uses the last image, when the
+	 * waveform, size and color of the next frame are the same)
+	 *
+	 * Each channel is a row of the image (200 units high, with 20 units between rows), and each
+	 * column of the image spans the min and max sample value of the samples it covers. The spans are
+	 * computed straight from the frame's samples at the final size, and written into the image without
+	 * QPainter (and without scaling a full resolution image down to the final size).
+	 *
+	 * A Clip with Clip::Waveform() enabled renders each frame with its own renderer. Rendering the
+	 * same waveform again (i.e. silence, or frames which are rendered again after an edit) at the same
+	 * size and color re-uses the cached image.
+	 *
+	 * \code
+	 * WaveformRenderer renderer;
+	 * std::shared_ptr<QImage> image = renderer.Render(frame, 1920, 1080, QColor(0, 123, 255, 255));
+	 * \endcode
+	 */
+	class WaveformRenderer {
+	private:
+		std::mutex rendererMutex;
+		int width; ///< The width of the cached image
+		int height; ///< The height of the cached image
+		QRgb color; ///< The color of the cached image
+		std::vector<int> spans; ///< The spans of the cached image
+		std::shared_ptr<QImage> image; ///< The cached image
+		int64_t reused; ///< The number of times the cached image was re-used
+
+	public:
+		/// Default constructor
+		WaveformRenderer();
+
+		/// @brief Get the spans of the waveform of a frame's audio
+		/// @returns The first and last+1 row of each column of the image (column by column, channel by channel),
+		/// or an empty vector if the frame has no audio
+		/// @param frame The frame
+		/// @param width The width of the image
+		/// @param height The height of the image
+		static std::vector<int> GetSpans(openshot::Frame& frame, int width, int height);
+
+		/// @brief Rasterize spans into a new (premultiplied RGBA8888) image
+		/// @param spans The spans (see GetSpans)
+		/// @param width The width of the image
+		/// @param height The height of the image
+		/// @param color The color of the waveform (the rest of the image is transparent)
+		static std::shared_ptr<QImage> Rasterize(const std::vector<int>& spans, int width, int height, const QColor& color);
+
+		/// @brief Render the waveform image of a frame (frames without audio are black)
+		///
+		/// The returned image is a copy of the cached image, which shares its pixels until it is modified.
+		/// @param frame The frame
+		/// @param width The width of the image
+		/// @param height The height of the image
+		/// @param color The color of the waveform
+		std::shared_ptr<QImage> Render(std::shared_ptr<openshot::Frame> frame, int width, int height, const QColor& color);
+
+		/// Get the number of times the cached image was re-used
+		int64_t Reused();
+
+		/// Free the cached image
+		void Clear();
+	};
+
+}
+
+#endif
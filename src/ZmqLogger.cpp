@@ -12,6 +12,7 @@
 
 #include "ZmqLogger.h"
 #include "Exceptions.h"
+#include "RenderStats.h"
 #include "Settings.h"
 
 #if USE_RESVG == 1
@@ -23,6 +24,7 @@ using namespace openshot;
 #include <sstream>
 #include <iostream>
 #include <iomanip>
+#include <cstring>
 #include <ctime>
 #include <thread>    // for std::this_thread::sleep_for
 #include <chrono>    // for std::duration::microseconds
@@ -43,8 +45,18 @@ ZmqLogger *ZmqLogger::Instance()
 		m_pInstance->publisher = NULL;
 		m_pInstance->connection = "";
 
-		// Default connection
-		m_pInstance->Connection("tcp://*:5556");
+		// init the queue of debug messages (each record can be written at its own index first)
+		m_pInstance->queue.reset(new LogRecord[LOG_QUEUE_SIZE]);
+		for (uint64_t index = 0; index < LOG_QUEUE_SIZE; index++)
+			m_pInstance->queue[index].sequence = index;
+		m_pInstance->enqueue_position = 0;
+		m_pInstance->dequeue_position = 0;
+		m_pInstance->written_position = 0;
+		m_pInstance->dropped = 0;
+		m_pInstance->log_thread_running = false;
+
+		// Default connection (the socket is only bound once logging is enabled)
+		m_pInstance->connection = "tcp://*:5556";
 
 		// Init enabled to False (force user to call Enable())
 		m_pInstance->enabled = false;
@@ -66,12 +78,26 @@ void ZmqLogger::Connection(std::string new_connection)
 	const std::lock_guard<std::recursive_mutex> lock(loggerMutex);
 
 	// Does anything need to happen?
-	if (new_connection == connection)
+	if (new_connection == connection && publisher != NULL)
 		return;
 	else
 		// Set new connection
 		connection = new_connection;
 
+	// Bind now if the logger is (or was) in use, otherwise once it is enabled
+	if (enabled || publisher != NULL)
+		bind_publisher();
+}
+
+// Bind the publisher socket to the connection
+void ZmqLogger::bind_publisher()
+{
+	// Render-only processes don't publish their logs
+	if (openshot::Settings::Instance()->HEADLESS)
+		return;
+
+	RenderInitTimer timer(INIT_STAGE_LOGGER);
+
 	if (context == NULL) {
 		// Create ZMQ Context
 		context = new zmq::context_t(1);
@@ -100,6 +126,19 @@ void ZmqLogger::Connection(std::string new_connection)
 	std::this_thread::sleep_for(std::chrono::milliseconds(250));
 }
 
+// Enable/Disable logging
+void ZmqLogger::Enable(bool is_enabled)
+{
+	// Bind the socket the first time logging is enabled
+	if (is_enabled) {
+		const std::lock_guard<std::recursive_mutex> lock(loggerMutex);
+		if (publisher == NULL)
+			bind_publisher();
+	}
+
+	enabled = is_enabled;
+}
+
 void ZmqLogger::Log(std::string message)
 {
 	if (!enabled)
@@ -113,12 +152,14 @@ void ZmqLogger::Log(std::string message)
 	zmq::message_t reply (message.length());
 	std::memcpy (reply.data(), message.c_str(), message.length());
 
+	if (publisher != NULL) {
 #if ZMQ_VERSION > ZMQ_MAKE_VERSION(4, 3, 1)
-	// Set flags for immediate delivery (new API)
-	publisher->send(reply, zmq::send_flags::dontwait);
+		// Set flags for immediate delivery (new API)
+		publisher->send(reply, zmq::send_flags::dontwait);
 #else
-	publisher->send(reply);
+		publisher->send(reply);
 #endif
+	}
 
 	// Also log to file, if open
 	LogToFile(message);
@@ -154,6 +195,15 @@ void ZmqLogger::Path(std::string new_path)
 
 void ZmqLogger::Close()
 {
+	// Write the queued messages, and stop the logger thread
+	{
+		const std::lock_guard<std::mutex> lock(thread_mutex);
+		if (log_thread.joinable()) {
+			log_thread_running = false;
+			log_thread.join();
+		}
+	}
+
 	// Disable logger as it no longer needed
 	enabled = false;
 
@@ -168,63 +218,146 @@ void ZmqLogger::Close()
 		publisher = NULL;
 	}
 
-	// Terminate zmq threads
+	// Terminate zmq threads (a new context is created if logging is enabled again)
 	if (context != NULL) {
         context->close();
+        delete context;
+        context = NULL;
 	}
 }
 
 // Append debug information
-void ZmqLogger::AppendDebugMethod(std::string method_name,
-				  std::string arg1_name, float arg1_value,
-				  std::string arg2_name, float arg2_value,
-				  std::string arg3_name, float arg3_value,
-				  std::string arg4_name, float arg4_value,
-				  std::string arg5_name, float arg5_value,
-				  std::string arg6_name, float arg6_value)
+void ZmqLogger::AppendDebugMethod(const std::string& method_name,
+				  const std::string& arg1_name, float arg1_value,
+				  const std::string& arg2_name, float arg2_value,
+				  const std::string& arg3_name, float arg3_value,
+				  const std::string& arg4_name, float arg4_value,
+				  const std::string& arg5_name, float arg5_value,
+				  const std::string& arg6_name, float arg6_value)
 {
-	if (!enabled && !openshot::Settings::Instance()->DEBUG_TO_STDERR)
+	if (!Enabled())
 		// Don't do anything
 		return;
 
-	{
-		// Create a scoped lock, allowing only a single thread to run the following code at one time
-		const std::lock_guard<std::recursive_mutex> lock(loggerMutex);
-
-		std::stringstream message;
-		message << std::fixed << std::setprecision(4);
-
-		// Construct message
-		message << method_name << " (";
-
-		if (arg1_name.length() > 0)
-			message << arg1_name << "=" << arg1_value;
+	if (!log_thread_running)
+		start_thread();
+
+	// Claim the next free record (or drop the message, if the queue is full)
+	const uint64_t mask = LOG_QUEUE_SIZE - 1;
+	uint64_t position = enqueue_position.load(std::memory_order_relaxed);
+	LogRecord *record;
+	while (true) {
+		record = &queue[position & mask];
+		const uint64_t sequence = record->sequence.load(std::memory_order_acquire);
+		if (sequence == position) {
+			if (enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				break;
+		} else if (sequence < position) {
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		} else {
+			position = enqueue_position.load(std::memory_order_relaxed);
+		}
+	}
 
-		if (arg2_name.length() > 0)
-			message << ", " << arg2_name << "=" << arg2_value;
+	// Copy the arguments (the names are formatted by the logger thread)
+	const std::string* names[6] = {&arg1_name, &arg2_name, &arg3_name, &arg4_name, &arg5_name, &arg6_name};
+	const float values[6] = {arg1_value, arg2_value, arg3_value, arg4_value, arg5_value, arg6_value};
+	std::strncpy(record->method_name, method_name.c_str(), sizeof(record->method_name) - 1);
+	record->method_name[sizeof(record->method_name) - 1] = '\0';
+	for (int arg = 0; arg < 6; arg++) {
+		std::strncpy(record->arg_names[arg], names[arg]->c_str(), sizeof(record->arg_names[arg]) - 1);
+		record->arg_names[arg][sizeof(record->arg_names[arg]) - 1] = '\0';
+		record->arg_values[arg] = values[arg];
+	}
 
-		if (arg3_name.length() > 0)
-			message << ", " << arg3_name << "=" << arg3_value;
+	// Let the logger thread read the record
+	record->sequence.store(position + 1, std::memory_order_release);
+}
 
-		if (arg4_name.length() > 0)
-			message << ", " << arg4_name << "=" << arg4_value;
+// Start the logger thread
+void ZmqLogger::start_thread()
+{
+	const std::lock_guard<std::mutex> lock(thread_mutex);
+	if (log_thread_running)
+		return;
+	if (log_thread.joinable())
+		log_thread.join();
+	log_thread_running = true;
+	log_thread = std::thread(&ZmqLogger::run_thread, this);
+}
 
-		if (arg5_name.length() > 0)
-			message << ", " << arg5_name << "=" << arg5_value;
+// Write the queued records (until the logger is closed)
+void ZmqLogger::run_thread()
+{
+	const uint64_t mask = LOG_QUEUE_SIZE - 1;
+	LogRecord record;
+	while (true) {
+		// Copy the next record, and free its slot for the producers
+		const uint64_t position = dequeue_position.load(std::memory_order_relaxed);
+		LogRecord& queued = queue[position & mask];
+		if (queued.sequence.load(std::memory_order_acquire) != position + 1) {
+			// Nothing queued (stop once closed, or wait a little)
+			if (!log_thread_running)
+				break;
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			continue;
+		}
+		std::memcpy(record.method_name, queued.method_name, sizeof(record.method_name));
+		std::memcpy(record.arg_names, queued.arg_names, sizeof(record.arg_names));
+		std::memcpy(record.arg_values, queued.arg_values, sizeof(record.arg_values));
+		queued.sequence.store(position + LOG_QUEUE_SIZE, std::memory_order_release);
+		dequeue_position.store(position + 1, std::memory_order_relaxed);
+
+		// Report the messages which were dropped before this one
+		const uint64_t dropped_count = dropped.exchange(0, std::memory_order_relaxed);
+		if (dropped_count > 0) {
+			LogRecord notice;
+			std::memset(notice.method_name, 0, sizeof(notice.method_name));
+			std::memset(notice.arg_names, 0, sizeof(notice.arg_names));
+			std::strncpy(notice.method_name, "ZmqLogger (queue full)", sizeof(notice.method_name) - 1);
+			std::strncpy(notice.arg_names[0], "dropped", sizeof(notice.arg_names[0]) - 1);
+			notice.arg_values[0] = float(dropped_count);
+			write_record(notice);
+		}
 
-		if (arg6_name.length() > 0)
-			message << ", " << arg6_name << "=" << arg6_value;
+		write_record(record);
+		written_position.store(position + 1, std::memory_order_release);
+	}
+}
 
-		message << ")" << std::endl;
+// Format and write a record
+void ZmqLogger::write_record(const LogRecord& record)
+{
+	std::stringstream message;
+	message << std::fixed << std::setprecision(4);
+
+	// Construct message
+	message << record.method_name << " (";
+	for (int arg = 0; arg < 6; arg++) {
+		if (record.arg_names[arg][0] == '\0')
+			continue;
+		if (arg > 0)
+			message << ", ";
+		message << record.arg_names[arg] << "=" << record.arg_values[arg];
+	}
+	message << ")" << std::endl;
 
-		if (openshot::Settings::Instance()->DEBUG_TO_STDERR) {
-			// Print message to stderr
-			std::clog << message.str();
-		}
+	if (openshot::Settings::Instance()->DEBUG_TO_STDERR) {
+		// Print message to stderr
+		std::clog << message.str();
+	}
 
-		if (enabled) {
-			// Send message through ZMQ
-			Log(message.str());
-		}
+	if (enabled) {
+		// Send message through ZMQ
+		Log(message.str());
 	}
 }
+
+// Wait until the messages appended so far are written
+void ZmqLogger::Flush()
+{
+	const uint64_t position = enqueue_position.load(std::memory_order_acquire);
+	while (log_thread_running && written_position.load(std::memory_order_acquire) < position)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
@@ -14,13 +14,38 @@
 #define OPENSHOT_LOGGER_H
 
 
+#include <atomic>
+#include <cstdint>
 #include <fstream>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
 
 #include <zmq.hpp>
 
+#include "Settings.h"
+
+/// @brief Append debug information, only evaluating the arguments when debug output is enabled
+///
+/// Use this instead of calling ZmqLogger::AppendDebugMethod() directly, since the message
+/// names (and values) are not even constructed when logging is turned off, which makes the
+/// logging calls in frame loops effectively free. Define OPENSHOT_DISABLE_DEBUG_LOGGING to
+/// compile them out completely.
+/// @code
+/// ZMQ_DEBUG("Timeline::GetFrame", "requested_frame", requested_frame);
+/// @endcode
+#ifdef OPENSHOT_DISABLE_DEBUG_LOGGING
+	#define ZMQ_DEBUG(...) do { } while (0)
+#else
+	#define ZMQ_DEBUG(...) \
+		do { \
+			openshot::ZmqLogger* zmq_debug_logger = openshot::ZmqLogger::Instance(); \
+			if (zmq_debug_logger->Enabled()) \
+				zmq_debug_logger->AppendDebugMethod(__VA_ARGS__); \
+		} while (0)
+#endif
+
 namespace openshot {
 
 	/**
@@ -28,16 +53,35 @@ namespace openshot {
 	 *
 	 * OpenShot desktop editor listens to this port, to receive libopenshot debug output. It both logs to
 	 * a file and sends the stdout over a socket.
+	 *
+	 * AppendDebugMethod() only copies its arguments into a record of a lock-free queue, so logging
+	 * barely slows down the render threads. A background thread formats the records, and writes them
+	 * to stderr, the socket and the log file. When the queue is full, messages are dropped (and the
+	 * number of dropped messages is logged), instead of blocking the render threads.
+	 *
+	 * The socket is bound when logging is first enabled (not when the logger is created by the first
+	 * ZMQ_DEBUG), and never in Settings::HEADLESS processes.
 	 */
 	class ZmqLogger {
 	private:
+		/// A debug message, as appended by AppendDebugMethod (the names are truncated to fit)
+		struct LogRecord {
+			std::atomic<uint64_t> sequence; ///< The queue position this record can be written (or read) at
+			char method_name[64];
+			char arg_names[6][32];
+			float arg_values[6];
+		};
+
+		/// The number of records in the queue (a power of 2)
+		static const uint64_t LOG_QUEUE_SIZE = 4096;
+
 		std::recursive_mutex loggerMutex;
 		std::string connection;
 
 		// Logfile related vars
 		std::string file_path;
 		std::ofstream log_file;
-		bool enabled;
+		std::atomic<bool> enabled;
 
 		/// ZMQ Context
 		zmq::context_t *context;
@@ -45,6 +89,30 @@ namespace openshot {
 		/// ZMQ Socket
 		zmq::socket_t *publisher;
 
+		// Queue of debug messages (many producers, and the logger thread as the only consumer)
+		std::unique_ptr<LogRecord[]> queue;
+		std::atomic<uint64_t> enqueue_position;
+		std::atomic<uint64_t> dequeue_position;
+		std::atomic<uint64_t> written_position; ///< The records which were formatted and written
+		std::atomic<uint64_t> dropped; ///< The messages dropped since the last written record
+
+		// Logger thread
+		std::mutex thread_mutex;
+		std::thread log_thread;
+		std::atomic<bool> log_thread_running;
+
+		/// Start the logger thread (if not running yet)
+		void start_thread();
+
+		/// Write the queued records (until the logger is closed)
+		void run_thread();
+
+		/// Format and write a record
+		void write_record(const LogRecord& record);
+
+		/// Bind the publisher socket to the connection (unless Settings::HEADLESS)
+		void bind_publisher();
+
 		/// Default constructor
 		ZmqLogger(){};  // Don't allow user to create an instance of this singleton
 
@@ -69,25 +137,34 @@ namespace openshot {
 		/// Create or get an instance of this logger singleton (invoke the class with this method)
 		static ZmqLogger * Instance();
 
-		/// Append debug information
+		/// Append debug information (see the ZMQ_DEBUG macro, which skips building the arguments when disabled)
 		void AppendDebugMethod(
-			std::string method_name,
-			std::string arg1_name="", float arg1_value=-1.0,
-			std::string arg2_name="", float arg2_value=-1.0,
-			std::string arg3_name="", float arg3_value=-1.0,
-			std::string arg4_name="", float arg4_value=-1.0,
-			std::string arg5_name="", float arg5_value=-1.0,
-			std::string arg6_name="", float arg6_value=-1.0
+			const std::string& method_name,
+			const std::string& arg1_name="", float arg1_value=-1.0,
+			const std::string& arg2_name="", float arg2_value=-1.0,
+			const std::string& arg3_name="", float arg3_value=-1.0,
+			const std::string& arg4_name="", float arg4_value=-1.0,
+			const std::string& arg5_name="", float arg5_value=-1.0,
+			const std::string& arg6_name="", float arg6_value=-1.0
 		);
 
-		/// Close logger (sockets and/or files)
+		/// Is any debug output enabled (ZMQ/file logging, or Settings::DEBUG_TO_STDERR)?
+		bool Enabled() const {
+			return enabled.load(std::memory_order_relaxed) || openshot::Settings::Instance()->DEBUG_TO_STDERR;
+		}
+
+		/// Close logger (sockets and/or files), after writing the queued messages
 		void Close();
 
-		/// Set or change connection info for logger (i.e. tcp://*:5556)
+		/// Wait until the messages appended so far are written
+		void Flush();
+
+		/// Set or change connection info for logger (i.e. tcp://*:5556). The socket is only bound
+		/// once logging is enabled, so processes which never enable it don't pay for it.
 		void Connection(std::string new_connection);
 
-		/// Enable/Disable logging
-		void Enable(bool is_enabled) { enabled = is_enabled;};
+		/// Enable/Disable logging (binding the socket the first time it is enabled)
+		void Enable(bool is_enabled);
 
 		/// Set or change the file path (optional)
 		void Path(std::string new_path);
@@ -21,7 +21,8 @@ Compressor::Compressor() : Compressor::Compressor(-10, 1, 1, 1, 1, false) {}
 Compressor::Compressor(Keyframe threshold, Keyframe ratio, Keyframe attack,
 					   Keyframe release, Keyframe makeup_gain,
 					   Keyframe bypass):
-	threshold(threshold), ratio(ratio), attack(attack),
+	has_alphas(false), alphas_attack(0.0), alphas_release(0.0), alphas_sample_rate(0),
+	alpha_attack(0.0), alpha_release(0.0), threshold(threshold), ratio(ratio), attack(attack),
 	release(release), makeup_gain(makeup_gain), bypass(bypass),
 	input_level(0.0), yl_prev(0.0)
 {
@@ -47,34 +48,52 @@ void Compressor::init_effect_details()
 // modified openshot::Frame object
 std::shared_ptr<openshot::Frame> Compressor::GetFrame(std::shared_ptr<openshot::Frame> frame, int64_t frame_number)
 {
+	frame->DetachAudio();
 	// Adding Compressor
 	const int num_input_channels = frame->audio->getNumChannels();
 	const int num_output_channels = frame->audio->getNumChannels();
 	const int num_samples = frame->audio->getNumSamples();
 
-	mixed_down_input.setSize(1, num_samples);
 	inverse_sample_rate = 1.0f / frame->SampleRate();
 	inverseE = 1.0f / M_E;
 
 	if ((bool)bypass.GetValue(frame_number))
 		return frame;
 
+	// Keep the mix down buffer between frames (only growing it)
+	mixed_down_input.setSize(1, num_samples, false, false, true);
 	mixed_down_input.clear();
 
 	for (int channel = 0; channel < num_input_channels; ++channel)
 		mixed_down_input.addFrom(0, 0, *frame->audio, channel, 0, num_samples, 1.0f / num_input_channels);
 
+	// The keyframes are constant for the whole frame
+	const float T = threshold.GetValue(frame_number);
+	const float R = ratio.GetValue(frame_number);
+	const float attack_value = attack.GetValue(frame_number);
+	const float release_value = release.GetValue(frame_number);
+	if (!has_alphas || attack_value != alphas_attack || release_value != alphas_release || frame->SampleRate() != alphas_sample_rate) {
+		alpha_attack = calculateAttackOrRelease(attack_value);
+		alpha_release = calculateAttackOrRelease(release_value);
+		alphas_attack = attack_value;
+		alphas_release = release_value;
+		alphas_sample_rate = frame->SampleRate();
+		has_alphas = true;
+	}
+	const float alphaA = alpha_attack;
+	const float alphaR = alpha_release;
+	const float gain = makeup_gain.GetValue(frame_number);
+
+	// Follow the envelope of the mixed down input, and replace each input sample with its gain
+	float *gains = mixed_down_input.getWritePointer(0);
+	float level = input_level;
+	float previous = yl_prev;
 	for (int sample = 0; sample < num_samples; ++sample) {
-		float T = threshold.GetValue(frame_number);
-		float R = ratio.GetValue(frame_number);
-		float alphaA = calculateAttackOrRelease(attack.GetValue(frame_number));
-		float alphaR = calculateAttackOrRelease(release.GetValue(frame_number));
-		float gain = makeup_gain.GetValue(frame_number);
-		float input_squared = powf(mixed_down_input.getSample(0, sample), 2.0f);
+		const float input_squared = gains[sample] * gains[sample];
 
-		input_level = input_squared;
+		level = input_squared;
 
-		xg = (input_level <= 1e-6f) ? -60.0f : 10.0f * log10f(input_level);
+		xg = (level <= 1e-6f) ? -60.0f : 10.0f * log10f(level);
 
 		if (xg < T)
 			yg = xg;
@@ -83,19 +102,21 @@ std::shared_ptr<openshot::Frame> Compressor::GetFrame(std::shared_ptr<openshot::
 
 		xl = xg - yg;
 
-		if (xl > yl_prev)
-			yl = alphaA * yl_prev + (1.0f - alphaA) * xl;
+		if (xl > previous)
+			yl = alphaA * previous + (1.0f - alphaA) * xl;
 		else
-			yl = alphaR * yl_prev + (1.0f - alphaR) * xl;
+			yl = alphaR * previous + (1.0f - alphaR) * xl;
 
 		control = powf (10.0f, (gain - yl) * 0.05f);
-		yl_prev = yl;
-
-		for (int channel = 0; channel < num_input_channels; ++channel) {
-			float new_value = frame->audio->getSample(channel, sample)*control;
-			frame->audio->setSample(channel, sample, new_value);
-		}
+		previous = yl;
+		gains[sample] = control;
 	}
+	input_level = level;
+	yl_prev = previous;
+
+	// Apply the gains to all channels (vectorized)
+	for (int channel = 0; channel < num_input_channels; ++channel)
+		juce::FloatVectorOperations::multiply(frame->audio->getWritePointer(channel), gains, num_samples);
 
 	for (int channel = num_input_channels; channel < num_output_channels; ++channel)
 		frame->audio->clear(channel, 0, num_samples);
@@ -180,7 +201,7 @@ void Compressor::SetJsonValue(const Json::Value root) {
 }
 
 // Get all properties for a specific frame
-std::string Compressor::PropertiesJSON(int64_t requested_frame) const {
+Json::Value Compressor::PropertiesJsonValue(int64_t requested_frame) const {
 
 	// Generate JSON properties list
 	Json::Value root = BasePropertiesJSON(requested_frame);
@@ -194,5 +215,5 @@ std::string Compressor::PropertiesJSON(int64_t requested_frame) const {
 	root["bypass"] = add_property_json("Bypass", bypass.GetValue(requested_frame), "bool", "", &bypass, 0, 1, false, requested_frame);
 
 	// Return formatted string
-	return root.toStyledString();
+	return root;
 }
@@ -35,10 +35,17 @@ namespace openshot
 	class Compressor : public EffectBase
 	{
 	private:
+		// The attack and release coefficients (only calculated again when their keyframes or the sample rate change)
+		bool has_alphas;
+		float alphas_attack;
+		float alphas_release;
+		int alphas_sample_rate;
+		float alpha_attack;
+		float alpha_release;
+
 		/// Init effect settings
 		void init_effect_details();
 
-
 	public:
 		Keyframe threshold;
 		Keyframe ratio;
@@ -82,7 +89,7 @@ namespace openshot
 		Json::Value JsonValue() const override; ///< Generate Json::Value for this object
 		void SetJsonValue(const Json::Value root) override; ///< Load Json::Value into this object
 
-		std::string PropertiesJSON(int64_t requested_frame) const override;
+		Json::Value PropertiesJsonValue(int64_t requested_frame) const override;
 	};
 
 }
@@ -60,6 +60,7 @@ void Delay::setup(std::shared_ptr<openshot::Frame> frame)
 // modified openshot::Frame object
 std::shared_ptr<openshot::Frame> Delay::GetFrame(std::shared_ptr<openshot::Frame> frame, int64_t frame_number)
 {
+	frame->DetachAudio();
 	const float delay_time_value = (float)delay_time.GetValue(frame_number)*(float)frame->SampleRate();
 	int local_write_position;
 
@@ -149,7 +150,7 @@ void Delay::SetJsonValue(const Json::Value root) {
 }
 
 // Get all properties for a specific frame
-std::string Delay::PropertiesJSON(int64_t requested_frame) const {
+Json::Value Delay::PropertiesJsonValue(int64_t requested_frame) const {
 
 	// Generate JSON properties list
 	Json::Value root = BasePropertiesJSON(requested_frame);
@@ -158,5 +159,5 @@ std::string Delay::PropertiesJSON(int64_t requested_frame) const {
 	root["delay_time"] = add_property_json("Delay Time", delay_time.GetValue(requested_frame), "float", "", &delay_time, 0, 5, false, requested_frame);
 
 	// Return formatted string
-	return root.toStyledString();
+	return root;
 }
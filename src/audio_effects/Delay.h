@@ -68,7 +68,7 @@ namespace openshot
 		Json::Value JsonValue() const override; ///< Generate Json::Value for this object
 		void SetJsonValue(const Json::Value root) override; ///< Load Json::Value into this object
 
-		std::string PropertiesJSON(int64_t requested_frame) const override;
+		Json::Value PropertiesJsonValue(int64_t requested_frame) const override;
 	};
 
 }
@@ -13,13 +13,62 @@
 #include "Distortion.h"
 #include "Exceptions.h"
 
+#include <algorithm>
+
 using namespace openshot;
 
+// Distort one sample
+static inline float distort_sample(DistortionType distortion_type, const float in)
+{
+	switch (distortion_type) {
+
+		case HARD_CLIPPING: {
+			float threshold = 0.5f;
+			if (in > threshold)
+				return threshold;
+			else if (in < -threshold)
+				return -threshold;
+			return in;
+		}
+
+		case SOFT_CLIPPING: {
+			float threshold1 = 1.0f / 3.0f;
+			float threshold2 = 2.0f / 3.0f;
+			float out;
+			if (in > threshold2)
+				out = 1.0f;
+			else if (in > threshold1)
+				out = 1.0f - powf (2.0f - 3.0f * in, 2.0f) / 3.0f;
+			else if (in < -threshold2)
+				out = -1.0f;
+			else if (in < -threshold1)
+				out = -1.0f + powf (2.0f + 3.0f * in, 2.0f) / 3.0f;
+			else
+				out = 2.0f * in;
+			return out * 0.5f;
+		}
+
+		case EXPONENTIAL: {
+			if (in > 0.0f)
+				return 1.0f - expf (-in);
+			return -1.0f + expf (in);
+		}
+
+		case FULL_WAVE_RECTIFIER:
+			return fabsf (in);
+
+		case HALF_WAVE_RECTIFIER:
+			return (in > 0.0f) ? in : 0.0f;
+	}
+	return in;
+}
+
 Distortion::Distortion(): Distortion::Distortion(HARD_CLIPPING, 10, -10, 5) { }
 
 Distortion::Distortion(openshot::DistortionType distortion_type,
 					   Keyframe input_gain, Keyframe output_gain,
 					   Keyframe tone):
+	last_frame_number(-1), has_coefficients(false), current_tone(0.0),
 	distortion_type(distortion_type), input_gain(input_gain),
 	output_gain(output_gain), tone(tone)
 {
@@ -46,83 +95,57 @@ void Distortion::init_effect_details()
 // modified openshot::Frame object
 std::shared_ptr<openshot::Frame> Distortion::GetFrame(std::shared_ptr<openshot::Frame> frame, int64_t frame_number)
 {
-	filters.clear();
+	frame->DetachAudio();
+	const int num_channels = frame->audio->getNumChannels();
+	const int num_samples = frame->audio->getNumSamples();
 
-	for (int i = 0; i < frame->audio->getNumChannels(); ++i) {
-		Filter* filter;
-		filters.add (filter = new Filter());
-	}
+	// Create the filters only when the number of channels changes (so they keep their state)
+	if (filters.size() != num_channels) {
+		filters.clear();
 
-	updateFilters(frame_number);
+		for (int i = 0; i < num_channels; ++i) {
+			Filter* filter;
+			filters.add (filter = new Filter());
+		}
+		has_coefficients = false;
+	}
 
-	// Add distortion
-	for (int channel = 0; channel < frame->audio->getNumChannels(); channel++)
+	// The state of the filters belongs to the previous frame (so only keep it for the next frame)
+	const bool consecutive = has_coefficients && frame_number == last_frame_number + 1;
+	if (!consecutive) {
+		for (int i = 0; i < filters.size(); ++i)
+			filters[i]->reset();
+	}
+	last_frame_number = frame_number;
+
+	// The keyframes are constant for the whole frame (except the tone, which moves from the previous frame)
+	const int input_gain_value = (int)input_gain.GetValue(frame_number);
+	const int output_gain_value = (int)output_gain.GetValue(frame_number);
+	const float input_multiplier = powf(10.0f, input_gain_value * 0.05f);
+	const float output_multiplier = powf(10.0f, output_gain_value * 0.05f);
+	const double tone_value = tone.GetValue(frame_number);
+	const double start_tone = current_tone;
+	const bool ramp = consecutive && tone_value != current_tone;
+	if (!ramp && (!has_coefficients || tone_value != current_tone))
+		setFilterCoefficients(tone_value);
+
+	// Add distortion (one block at a time)
+	for (int start = 0; start < num_samples; start += PARAMETER_BLOCK_SAMPLES)
 	{
-		auto *channel_data = frame->audio->getWritePointer(channel);
-		float out;
+		const int block_samples = std::min(PARAMETER_BLOCK_SAMPLES, num_samples - start);
+		if (ramp)
+			setFilterCoefficients(start_tone + (tone_value - start_tone) * double(start + block_samples) / num_samples);
 
-		for (auto sample = 0; sample < frame->audio->getNumSamples(); ++sample)
+		for (int channel = 0; channel < num_channels; channel++)
 		{
+			auto *channel_data = frame->audio->getWritePointer(channel) + start;
+			Filter *filter = filters[channel];
 
-			const int input_gain_value = (int)input_gain.GetValue(frame_number);
-			const int output_gain_value = (int)output_gain.GetValue(frame_number);
-			const float in = channel_data[sample]*powf(10.0f, input_gain_value * 0.05f);
-
-			// Use the current distortion type
-			switch (distortion_type) {
-
-				case HARD_CLIPPING: {
-					float threshold = 0.5f;
-					if (in > threshold)
-						out = threshold;
-					else if (in < -threshold)
-						out = -threshold;
-					else
-						out = in;
-					break;
-				}
-
-				case SOFT_CLIPPING: {
-					float threshold1 = 1.0f / 3.0f;
-					float threshold2 = 2.0f / 3.0f;
-					if (in > threshold2)
-						out = 1.0f;
-					else if (in > threshold1)
-						out = 1.0f - powf (2.0f - 3.0f * in, 2.0f) / 3.0f;
-					else if (in < -threshold2)
-						out = -1.0f;
-					else if (in < -threshold1)
-						out = -1.0f + powf (2.0f + 3.0f * in, 2.0f) / 3.0f;
-					else
-						out = 2.0f * in;
-					out *= 0.5f;
-					break;
-				}
-
-				case EXPONENTIAL: {
-					if (in > 0.0f)
-						out = 1.0f - expf (-in);
-					else
-						out = -1.0f + expf (in);
-					break;
-				}
-
-				case FULL_WAVE_RECTIFIER: {
-					out = fabsf (in);
-					break;
-				}
-
-				case HALF_WAVE_RECTIFIER: {
-					if (in > 0.0f)
-						out = in;
-					else
-						out = 0.0f;
-					break;
-				}
+			for (int sample = 0; sample < block_samples; ++sample)
+			{
+				const float out = distort_sample(distortion_type, channel_data[sample] * input_multiplier);
+				channel_data[sample] = filter->processSingleSampleRaw(out) * output_multiplier;
 			}
-
-			float filtered = filters[channel]->processSingleSampleRaw(out);
-			channel_data[sample] = filtered*powf(10.0f, output_gain_value * 0.05f);
 		}
 	}
 
@@ -132,11 +155,29 @@ std::shared_ptr<openshot::Frame> Distortion::GetFrame(std::shared_ptr<openshot::
 
 void Distortion::updateFilters(int64_t frame_number)
 {
-	double discrete_frequency = M_PI * 0.01;
-	double gain = pow(10.0, (float)tone.GetValue(frame_number) * 0.05);
+	const double tone_value = tone.GetValue(frame_number);
+
+	// Skip the coefficients if the tone didn't change
+	if (has_coefficients && tone_value == current_tone)
+		return;
 
-	for (int i = 0; i < filters.size(); ++i)
-		filters[i]->updateCoefficients(discrete_frequency, gain);
+	setFilterCoefficients(tone_value);
+}
+
+void Distortion::setFilterCoefficients(double tone_value)
+{
+	current_tone = tone_value;
+	has_coefficients = !filters.isEmpty();
+	if (filters.isEmpty())
+		return;
+
+	// Calculate the coefficients for the first channel, and copy them to the others
+	double discrete_frequency = M_PI * 0.01;
+	double gain = pow(10.0, (float)tone_value * 0.05);
+	filters[0]->updateCoefficients(discrete_frequency, gain);
+	const juce::IIRCoefficients coefficients = filters[0]->getCoefficients();
+	for (int i = 1; i < filters.size(); ++i)
+		filters[i]->setCoefficients(coefficients);
 }
 
 // Generate JSON string of this object
@@ -213,7 +254,7 @@ void Distortion::SetJsonValue(const Json::Value root) {
 }
 
 // Get all properties for a specific frame
-std::string Distortion::PropertiesJSON(int64_t requested_frame) const {
+Json::Value Distortion::PropertiesJsonValue(int64_t requested_frame) const {
 
 	// Generate JSON properties list
 	Json::Value root = BasePropertiesJSON(requested_frame);
@@ -232,5 +273,5 @@ std::string Distortion::PropertiesJSON(int64_t requested_frame) const {
 	root["distortion_type"]["choices"].append(add_property_choice_json("Half Wave Rectifier", HALF_WAVE_RECTIFIER, distortion_type));
 
 	// Return formatted string
-	return root.toStyledString();
+	return root;
 }
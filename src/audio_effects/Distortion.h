@@ -33,14 +33,27 @@ namespace openshot
 	/**
 	 * @brief This class adds a distortion into the audio
 	 *
+	 * The tone filters of each channel keep their state from one frame to the next (it is only cleared
+	 * when frames are not requested consecutively), and their coefficients are only calculated again
+	 * when the tone changes (in blocks of PARAMETER_BLOCK_SAMPLES samples, from the previous tone).
 	 */
 	class Distortion : public EffectBase
 	{
 	private:
+		int64_t last_frame_number; ///< The previous frame (to detect seeks)
+		bool has_coefficients; ///< current_tone matches the coefficients of the filters
+		double current_tone; ///< The tone (dB) of the current coefficients
+
 		/// Init effect settings
 		void init_effect_details();
 
+		/// Calculate the coefficients once, and set them on the filters of all channels
+		void setFilterCoefficients(double tone_value);
+
 	public:
+		/// The number of samples between coefficient updates (while the tone moves)
+		static const int PARAMETER_BLOCK_SAMPLES = 64;
+
 		openshot::DistortionType distortion_type;
 		Keyframe input_gain;
 		Keyframe output_gain;
@@ -65,7 +78,7 @@ namespace openshot
 		Json::Value JsonValue() const override; ///< Generate Json::Value for this object
 		void SetJsonValue(const Json::Value root) override; ///< Load Json::Value into this object
 
-		std::string PropertiesJSON(int64_t requested_frame) const override;
+		Json::Value PropertiesJsonValue(int64_t requested_frame) const override;
 
 		class Filter : public juce::IIRFilter
 		{
@@ -75,6 +88,7 @@ namespace openshot
 
 		juce::OwnedArray<Filter> filters;
 
+		/// Update the coefficients of the filters to the tone of a frame (if it changed)
 		void updateFilters(int64_t frame_number);
 	};
 
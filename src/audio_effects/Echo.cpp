@@ -62,6 +62,7 @@ void Echo::setup(std::shared_ptr<openshot::Frame> frame)
 // modified openshot::Frame object
 std::shared_ptr<openshot::Frame> Echo::GetFrame(std::shared_ptr<openshot::Frame> frame, int64_t frame_number)
 {
+	frame->DetachAudio();
 	const float echo_time_value = (float)echo_time.GetValue(frame_number)*(float)frame->SampleRate();
 	const float feedback_value = feedback.GetValue(frame_number);
 	const float mix_value = mix.GetValue(frame_number);
@@ -158,7 +159,7 @@ void Echo::SetJsonValue(const Json::Value root) {
 }
 
 // Get all properties for a specific frame
-std::string Echo::PropertiesJSON(int64_t requested_frame) const {
+Json::Value Echo::PropertiesJsonValue(int64_t requested_frame) const {
 
 	// Generate JSON properties list
 	Json::Value root = BasePropertiesJSON(requested_frame);
@@ -169,5 +170,5 @@ std::string Echo::PropertiesJSON(int64_t requested_frame) const {
 	root["mix"] = add_property_json("Mix", mix.GetValue(requested_frame), "float", "", &mix, 0, 1, false, requested_frame);
 
 	// Return formatted string
-	return root.toStyledString();
+	return root;
 }
@@ -51,6 +51,7 @@ void Expander::init_effect_details()
 // modified openshot::Frame object
 std::shared_ptr<openshot::Frame> Expander::GetFrame(std::shared_ptr<openshot::Frame> frame, int64_t frame_number)
 {
+	frame->DetachAudio();
 	// Adding Expander
 	const int num_input_channels = frame->audio->getNumChannels();
 	const int num_output_channels = frame->audio->getNumChannels();
@@ -68,18 +69,24 @@ std::shared_ptr<openshot::Frame> Expander::GetFrame(std::shared_ptr<openshot::Fr
 	for (int channel = 0; channel < num_input_channels; ++channel)
 		mixed_down_input.addFrom(0, 0, *frame->audio, channel, 0, num_samples, 1.0f / num_input_channels);
 
+	// The keyframes are constant for the whole frame
+	const float T = threshold.GetValue(frame_number);
+	const float R = ratio.GetValue(frame_number);
+	const float alphaA = calculateAttackOrRelease(attack.GetValue(frame_number));
+	const float alphaR = calculateAttackOrRelease(release.GetValue(frame_number));
+	const float gain = makeup_gain.GetValue(frame_number);
+
+	// Follow the envelope of the mixed down input, and replace each input sample with its gain
+	float *gains = mixed_down_input.getWritePointer(0);
+	float level = input_level;
+	float previous = yl_prev;
 	for (int sample = 0; sample < num_samples; ++sample) {
-		float T = threshold.GetValue(frame_number);
-		float R = ratio.GetValue(frame_number);
-		float alphaA = calculateAttackOrRelease(attack.GetValue(frame_number));
-		float alphaR = calculateAttackOrRelease(release.GetValue(frame_number));
-		float gain = makeup_gain.GetValue(frame_number);
-		float input_squared = powf(mixed_down_input.getSample(0, sample), 2.0f);
+		const float input_squared = gains[sample] * gains[sample];
 
 		const float average_factor = 0.9999f;
-		input_level = average_factor * input_level + (1.0f - average_factor) * input_squared;
+		level = average_factor * level + (1.0f - average_factor) * input_squared;
 
-		xg = (input_level <= 1e-6f) ? -60.0f : 10.0f * log10f(input_level);
+		xg = (level <= 1e-6f) ? -60.0f : 10.0f * log10f(level);
 
 		if (xg > T)
 			yg = xg;
@@ -88,20 +95,21 @@ std::shared_ptr<openshot::Frame> Expander::GetFrame(std::shared_ptr<openshot::Fr
 
 		xl = xg - yg;
 
-		if (xl < yl_prev)
-			yl = alphaA * yl_prev + (1.0f - alphaA) * xl;
+		if (xl < previous)
+			yl = alphaA * previous + (1.0f - alphaA) * xl;
 		else
-			yl = alphaR * yl_prev + (1.0f - alphaR) * xl;
-
+			yl = alphaR * previous + (1.0f - alphaR) * xl;
 
 		control = powf (10.0f, (gain - yl) * 0.05f);
-		yl_prev = yl;
-
-		for (int channel = 0; channel < num_input_channels; ++channel) {
-			float new_value = frame->audio->getSample(channel, sample)*control;
-			frame->audio->setSample(channel, sample, new_value);
-		}
+		previous = yl;
+		gains[sample] = control;
 	}
+	input_level = level;
+	yl_prev = previous;
+
+	// Apply the gains to all channels (vectorized)
+	for (int channel = 0; channel < num_input_channels; ++channel)
+		juce::FloatVectorOperations::multiply(frame->audio->getWritePointer(channel), gains, num_samples);
 
 	for (int channel = num_input_channels; channel < num_output_channels; ++channel)
 		frame->audio->clear(channel, 0, num_samples);
@@ -186,7 +194,7 @@ void Expander::SetJsonValue(const Json::Value root) {
 }
 
 // Get all properties for a specific frame
-std::string Expander::PropertiesJSON(int64_t requested_frame) const {
+Json::Value Expander::PropertiesJsonValue(int64_t requested_frame) const {
 
 	// Generate JSON properties list
 	Json::Value root = BasePropertiesJSON(requested_frame);
@@ -200,5 +208,5 @@ std::string Expander::PropertiesJSON(int64_t requested_frame) const {
 	root["bypass"] = add_property_json("Bypass", bypass.GetValue(requested_frame), "bool", "", &bypass, 0, 1, false, requested_frame);
 
 	// Return formatted string
-	return root.toStyledString();
+	return root;
 }
@@ -13,6 +13,9 @@
 #include "Noise.h"
 #include "Exceptions.h"
 #include "Frame.h"
+#include "NoiseGenerator.h"
+
+#include <algorithm>
 
 #include <AppConfig.h>
 #include <juce_audio_basics/juce_audio_basics.h>
@@ -45,21 +48,34 @@ void Noise::init_effect_details()
 // modified openshot::Frame object
 std::shared_ptr<openshot::Frame> Noise::GetFrame(std::shared_ptr<openshot::Frame> frame, int64_t frame_number)
 {
-	// Adding Noise
-	srand ( time(NULL) );
+	frame->DetachAudio();
+	// Adding Noise (seeded by the frame number, so a frame always gets the same
+	// noise, even when it is requested again or out of order)
+	NoiseGenerator generator(NoiseGenerator::SeedFor(frame_number));
 	int noise = level.GetValue(frame_number);
+	const float input_factor = 1 - (1 + (float)noise) / 100;
+	const float noise_factor = 0.0001f * noise;
 
+	// Generate the noise one block at a time (a random percent between 1 and 100 for each sample)
+	const int block_size = 256;
+	float random[block_size];
+	const int num_samples = frame->audio->getNumSamples();
 	for (int channel = 0; channel < frame->audio->getNumChannels(); channel++)
 	{
 		auto *buffer = frame->audio->getWritePointer(channel);
 
-		for (auto sample = 0; sample < frame->audio->getNumSamples(); ++sample)
+		for (int start = 0; start < num_samples; start += block_size)
 		{
-			buffer[sample] = buffer[sample]*(1 - (1+(float)noise)/100) + buffer[sample]*0.0001*(rand()%100+1)*noise;
+			const int count = std::min(block_size, num_samples - start);
+			generator.FillUniform(random, count);
+
+			float *samples = buffer + start;
+			#pragma omp simd
+			for (int sample = 0; sample < count; ++sample)
+				samples[sample] *= input_factor + noise_factor * (1.0f + 99.0f * random[sample]);
 		}
 	}
 
-
 	// return the modified frame
 	return frame;
 }
@@ -112,7 +128,7 @@ void Noise::SetJsonValue(const Json::Value root) {
 }
 
 // Get all properties for a specific frame
-std::string Noise::PropertiesJSON(int64_t requested_frame) const {
+Json::Value Noise::PropertiesJsonValue(int64_t requested_frame) const {
 
 	// Generate JSON properties list
 	Json::Value root = BasePropertiesJSON(requested_frame);
@@ -121,5 +137,5 @@ std::string Noise::PropertiesJSON(int64_t requested_frame) const {
 	root["level"] = add_property_json("Level", level.GetValue(requested_frame), "int", "", &level, 0, 100, false, requested_frame);
 
 	// Return formatted string
-	return root.toStyledString();
+	return root;
 }
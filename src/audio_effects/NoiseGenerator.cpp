@@ -0,0 +1,75 @@
+/**
+ * @file
+ * @brief Source file for NoiseGenerator class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "NoiseGenerator.h"
+
+using namespace openshot;
+
+// Hash a position in the sequence (a 32-bit integer finalizer, which only uses operations SIMD has)
+static inline uint32_t hash_position(uint32_t seed, uint32_t position)
+{
+	uint32_t x = position * 0x9E3779B9u + seed;
+	x ^= x >> 16;
+	x *= 0x7FEB352Du;
+	x ^= x >> 15;
+	x *= 0x846CA68Bu;
+	x ^= x >> 16;
+	return x;
+}
+
+// Convert the top 24 bits of a hash to a float in [0, 1)
+static inline float to_uniform(uint32_t x)
+{
+	return float(x >> 8) * (1.0f / 16777216.0f);
+}
+
+// Constructor
+NoiseGenerator::NoiseGenerator(uint64_t seed)
+{
+	Seed(seed);
+}
+
+// Get a well mixed seed for a frame and a channel
+uint64_t NoiseGenerator::SeedFor(int64_t frame_number, int channel)
+{
+	// SplitMix64 finalizer
+	uint64_t z = uint64_t(frame_number) * 0x9E3779B97F4A7C15ull + uint64_t(channel) * 0xD1B54A32D192ED03ull;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+// Restart the sequence with a new seed
+void NoiseGenerator::Seed(uint64_t new_seed)
+{
+	seed = uint32_t(new_seed) ^ uint32_t(new_seed >> 32);
+	counter = 0;
+}
+
+// Get the next uniform random number
+float NoiseGenerator::NextUniform()
+{
+	return to_uniform(hash_position(seed, counter++));
+}
+
+// Fill a block with the next uniform random numbers
+void NoiseGenerator::FillUniform(float *output, int count)
+{
+	const uint32_t key = seed;
+	const uint32_t start = counter;
+
+	#pragma omp simd
+	for (int i = 0; i < count; i++)
+		output[i] = to_uniform(hash_position(key, start + uint32_t(i)));
+
+	counter += uint32_t(count);
+}
@@ -0,0 +1,64 @@
+/**
+ * @file
+ * @brief Header file for NoiseGenerator class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_NOISE_GENERATOR_H
+#define OPENSHOT_NOISE_GENERATOR_H
+
+#include <cstdint>
+
+namespace openshot
+{
+
+	/**
+	 * @brief A fast random number generator for the audio effects (one per effect, or per channel)
+	 *
+	 * Each number is a hash of the seed and its position in the sequence (instead of depending on
+	 * the previous number), so a whole block is generated without a loop-carried state, and is
+	 * vectorized. Unlike rand(), there is no global state (or lock) shared between threads, and
+	 * seeding it with the frame number (and channel) gives a frame the same noise every time it
+	 * is requested, without correlating the noise of consecutive frames.
+	 *
+	 * \code
+	 * NoiseGenerator generator(NoiseGenerator::SeedFor(frame_number, channel));
+	 * float noise[256];
+	 * generator.FillUniform(noise, 256);
+	 * \endcode
+	 */
+	class NoiseGenerator
+	{
+	private:
+		uint32_t seed; ///< The key of the hash
+		uint32_t counter; ///< The position of the next number in the sequence
+
+	public:
+		/// Constructor
+		/// @param seed The seed of the sequence (see SeedFor())
+		NoiseGenerator(uint64_t seed = 0);
+
+		/// Get a well mixed seed for a frame and a channel (so neighbouring frames are unrelated)
+		static uint64_t SeedFor(int64_t frame_number, int channel = 0);
+
+		/// Restart the sequence with a new seed
+		void Seed(uint64_t new_seed);
+
+		/// Get the next uniform random number, in [0, 1)
+		float NextUniform();
+
+		/// @brief Fill a block with the next uniform random numbers, in [0, 1)
+		/// @param output The numbers to fill
+		/// @param count The number of numbers
+		void FillUniform(float *output, int count);
+	};
+
+}
+
+#endif
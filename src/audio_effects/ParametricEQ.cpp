@@ -13,6 +13,8 @@
 #include "ParametricEQ.h"
 #include "Exceptions.h"
 
+#include <algorithm>
+
 using namespace openshot;
 using namespace juce;
 
@@ -20,6 +22,8 @@ ParametricEQ::ParametricEQ(): ParametricEQ::ParametricEQ(LOW_PASS, 500, 0, 0) {}
 
 ParametricEQ::ParametricEQ(openshot::FilterType filter_type,
 						   Keyframe frequency, Keyframe gain, Keyframe q_factor) :
+	last_frame_number(-1), has_coefficients(false), current_frequency(0.0), current_q_factor(0.0),
+	current_gain(0.0), current_filter_type(-1), current_sample_rate(0.0),
 	filter_type(filter_type),
 	frequency(frequency), gain(gain), q_factor(q_factor)
 {
@@ -46,32 +50,67 @@ void ParametricEQ::init_effect_details()
 // modified openshot::Frame object
 std::shared_ptr<openshot::Frame> ParametricEQ::GetFrame(std::shared_ptr<openshot::Frame> frame, int64_t frame_number)
 {
-	if (!initialized)
+	frame->DetachAudio();
+	const int num_channels = frame->audio->getNumChannels();
+	const int num_samples = frame->audio->getNumSamples();
+	const double sample_rate = (frame->SampleRate() > 0) ? frame->SampleRate() : 44100.0;
+
+	// Create the filters only when the number of channels changes (so they keep their state)
+	if (!initialized || filters.size() != num_channels)
 	{
 		filters.clear();
 
-		for (int i = 0; i < frame->audio->getNumChannels(); ++i) {
+		for (int i = 0; i < num_channels; ++i) {
 			Filter *filter;
 			filters.add(filter = new Filter());
 		}
 
 		initialized = true;
+		has_coefficients = false;
 	}
 
-	const int num_input_channels = frame->audio->getNumChannels();
-	const int num_output_channels = frame->audio->getNumChannels();
-	const int num_samples = frame->audio->getNumSamples();
-	updateFilters(frame_number, num_samples);
-
-	for (int channel = 0; channel < frame->audio->getNumChannels(); channel++)
+	// The state of the filters belongs to the previous frame (so only keep it for the next frame)
+	const bool consecutive = has_coefficients && frame_number == last_frame_number + 1;
+	if (!consecutive)
 	{
-		auto *channel_data = frame->audio->getWritePointer(channel);
-		filters[channel]->processSamples(channel_data, num_samples);
+		for (int i = 0; i < filters.size(); ++i)
+			filters[i]->reset();
 	}
+	last_frame_number = frame_number;
+
+	// The keyframes of this frame
+	const double frequency_value = frequency.GetValue(frame_number);
+	const double q_value = q_factor.GetValue(frame_number);
+	const double gain_value = gain.GetValue(frame_number);
+	const bool changed = !has_coefficients || frequency_value != current_frequency || q_value != current_q_factor ||
+		gain_value != current_gain || (int)filter_type != current_filter_type || sample_rate != current_sample_rate;
 
-	for (int channel = num_input_channels; channel < num_output_channels; ++channel)
+	if (changed && consecutive && (int)filter_type == current_filter_type && sample_rate == current_sample_rate)
 	{
-		frame->audio->clear(channel, 0, num_samples);
+		// Move the coefficients from the previous frame to this one, one block at a time
+		const double start_frequency = current_frequency;
+		const double start_q_factor = current_q_factor;
+		const double start_gain = current_gain;
+		for (int start = 0; start < num_samples; start += PARAMETER_BLOCK_SAMPLES)
+		{
+			const int block_samples = std::min(PARAMETER_BLOCK_SAMPLES, num_samples - start);
+			const double t = double(start + block_samples) / num_samples;
+			setFilterCoefficients(start_frequency + (frequency_value - start_frequency) * t,
+			                      start_q_factor + (q_value - start_q_factor) * t,
+			                      start_gain + (gain_value - start_gain) * t, sample_rate);
+
+			for (int channel = 0; channel < num_channels; channel++)
+				filters[channel]->processSamples(frame->audio->getWritePointer(channel) + start, block_samples);
+		}
+	}
+	else
+	{
+		// Same coefficients for the whole frame (only calculated when the keyframes changed)
+		if (changed)
+			setFilterCoefficients(frequency_value, q_value, gain_value, sample_rate);
+
+		for (int channel = 0; channel < num_channels; channel++)
+			filters[channel]->processSamples(frame->audio->getWritePointer(channel), num_samples);
 	}
 
 	// return the modified frame
@@ -161,13 +200,35 @@ void ParametricEQ::Filter::updateCoefficients (
 
 void ParametricEQ::updateFilters(int64_t frame_number, double sample_rate)
 {
-	double discrete_frequency = 2.0 * M_PI * (double)frequency.GetValue(frame_number) / sample_rate;
-	double q_value = (double)q_factor.GetValue(frame_number);
-	double gain_value = pow(10.0, (double)gain.GetValue(frame_number) * 0.05);
-	int filter_type_value = (int)filter_type;
+	const double frequency_value = frequency.GetValue(frame_number);
+	const double q_value = q_factor.GetValue(frame_number);
+	const double gain_value = gain.GetValue(frame_number);
 
-	for (int i = 0; i < filters.size(); ++i)
-		filters[i]->updateCoefficients(discrete_frequency, q_value, gain_value, filter_type_value);
+	// Skip the (expensive) coefficients if nothing changed
+	if (has_coefficients && frequency_value == current_frequency && q_value == current_q_factor &&
+		gain_value == current_gain && (int)filter_type == current_filter_type && sample_rate == current_sample_rate)
+		return;
+
+	setFilterCoefficients(frequency_value, q_value, gain_value, sample_rate);
+}
+
+void ParametricEQ::setFilterCoefficients(double frequency_value, double q_value, double gain_value, double sample_rate)
+{
+	current_frequency = frequency_value;
+	current_q_factor = q_value;
+	current_gain = gain_value;
+	current_filter_type = (int)filter_type;
+	current_sample_rate = sample_rate;
+	has_coefficients = !filters.isEmpty();
+	if (filters.isEmpty())
+		return;
+
+	// Calculate the coefficients for the first channel, and copy them to the others
+	const double discrete_frequency = 2.0 * M_PI * frequency_value / sample_rate;
+	filters[0]->updateCoefficients(discrete_frequency, q_value, pow(10.0, gain_value * 0.05), current_filter_type);
+	const IIRCoefficients coefficients = filters[0]->getCoefficients();
+	for (int i = 1; i < filters.size(); ++i)
+		filters[i]->setCoefficients(coefficients);
 }
 
 // Generate JSON string of this object
@@ -230,7 +291,7 @@ void ParametricEQ::SetJsonValue(const Json::Value root) {
 }
 
 // Get all properties for a specific frame
-std::string ParametricEQ::PropertiesJSON(int64_t requested_frame) const {
+Json::Value ParametricEQ::PropertiesJsonValue(int64_t requested_frame) const {
 
 	// Generate JSON properties list
 	Json::Value root = BasePropertiesJSON(requested_frame);
@@ -251,5 +312,5 @@ std::string ParametricEQ::PropertiesJSON(int64_t requested_frame) const {
 	root["filter_type"]["choices"].append(add_property_choice_json("Peaking Notch", PEAKING_NOTCH, filter_type));
 
 	// Return formatted string
-	return root.toStyledString();
+	return root;
 }
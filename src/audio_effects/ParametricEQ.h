@@ -33,14 +33,32 @@ namespace openshot
 	/**
 	 * @brief This class adds a equalization into the audio
 	 *
+	 * The filters of each channel keep their state from one frame to the next (it is only cleared when
+	 * frames are not requested consecutively). Their coefficients are only calculated again when the
+	 * keyframes change, and are then moved from the previous to the new values in blocks of
+	 * PARAMETER_BLOCK_SAMPLES samples, so animated keyframes don't click.
 	 */
 	class ParametricEQ : public EffectBase
 	{
 	private:
+		int64_t last_frame_number; ///< The previous frame (to detect seeks)
+		bool has_coefficients; ///< The current_* values match the coefficients of the filters
+		double current_frequency; ///< The frequency (Hz) of the current coefficients
+		double current_q_factor; ///< The Q factor of the current coefficients
+		double current_gain; ///< The gain (dB) of the current coefficients
+		int current_filter_type; ///< The filter type of the current coefficients
+		double current_sample_rate; ///< The sample rate of the current coefficients
+
 		/// Init effect settings
 		void init_effect_details();
 
+		/// Calculate the coefficients once, and set them on the filters of all channels
+		void setFilterCoefficients(double frequency_value, double q_value, double gain_value, double sample_rate);
+
 	public:
+		/// The number of samples between coefficient updates (while the keyframes move)
+		static const int PARAMETER_BLOCK_SAMPLES = 64;
+
 		openshot::FilterType filter_type;
 		Keyframe frequency;
 		Keyframe q_factor;
@@ -67,7 +85,7 @@ namespace openshot
 		Json::Value JsonValue() const override; ///< Generate Json::Value for this object
 		void SetJsonValue(const Json::Value root) override; ///< Load Json::Value into this object
 
-		std::string PropertiesJSON(int64_t requested_frame) const override;
+		Json::Value PropertiesJsonValue(int64_t requested_frame) const override;
 
 		class Filter : public juce::IIRFilter
 		{
@@ -80,6 +98,7 @@ namespace openshot
 
 		juce::OwnedArray<Filter> filters;
 
+		/// Update the coefficients of the filters to the keyframes of a frame (if they changed)
 		void updateFilters(int64_t frame_number, double sample_rate);
 	};
 
@@ -48,6 +48,7 @@ void Robotization::init_effect_details()
 // modified openshot::Frame object
 std::shared_ptr<openshot::Frame> Robotization::GetFrame(std::shared_ptr<openshot::Frame> frame, int64_t frame_number)
 {
+	frame->DetachAudio();
 	const std::lock_guard<std::recursive_mutex> lock(mutex);
 	ScopedNoDenormals noDenormals;
 
@@ -62,7 +63,7 @@ std::shared_ptr<openshot::Frame> Robotization::GetFrame(std::shared_ptr<openshot
 						  (int)hop_size_value,
 						  (int)window_type);
 
-	stft.process(*frame->audio);
+	stft.process(*frame->audio, frame_number);
 
 	// return the modified frame
 	return frame;
@@ -70,15 +71,18 @@ std::shared_ptr<openshot::Frame> Robotization::GetFrame(std::shared_ptr<openshot
 
 void Robotization::RobotizationEffect::modification(const int channel)
 {
-	fft->perform(time_domain_buffer, frequency_domain_buffer, false);
+	juce::dsp::Complex<float> *time_domain = timeDomain(channel);
+	juce::dsp::Complex<float> *frequency_domain = frequencyDomain(channel);
+
+	channelFFT(channel).perform(time_domain, frequency_domain, false);
 
 	for (int index = 0; index < fft_size; ++index) {
-		float magnitude = abs(frequency_domain_buffer[index]);
-		frequency_domain_buffer[index].real(magnitude);
-		frequency_domain_buffer[index].imag(0.0f);
+		float magnitude = abs(frequency_domain[index]);
+		frequency_domain[index].real(magnitude);
+		frequency_domain[index].imag(0.0f);
 	}
 
-	fft->perform(frequency_domain_buffer, time_domain_buffer, true);
+	channelFFT(channel).perform(frequency_domain, time_domain, true);
 }
 
 // Generate JSON string of this object
@@ -136,7 +140,7 @@ void Robotization::SetJsonValue(const Json::Value root) {
 }
 
 // Get all properties for a specific frame
-std::string Robotization::PropertiesJSON(int64_t requested_frame) const {
+Json::Value Robotization::PropertiesJsonValue(int64_t requested_frame) const {
 
 	// Generate JSON properties list
 	Json::Value root = BasePropertiesJSON(requested_frame);
@@ -165,5 +169,5 @@ std::string Robotization::PropertiesJSON(int64_t requested_frame) const {
 	root["window_type"]["choices"].append(add_property_choice_json("Hamming", HAMMING, window_type));
 
 	// Return formatted string
-	return root.toStyledString();
+	return root;
 }
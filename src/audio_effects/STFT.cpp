@@ -4,58 +4,140 @@
 
 #include "STFT.h"
 
+#include <algorithm>
+
 using namespace openshot;
 
+STFT::STFT() :
+    num_channels (1), num_samples (0), fft_size (0), input_buffer_length (0), output_buffer_length (0),
+    overlap (0), hop_size (0), window_type (-1), window_scale_factor (0.0f),
+    input_buffer_write_position (0), output_buffer_write_position (0), output_buffer_read_position (0),
+    samples_since_last_FFT (0), last_frame_number (-1)
+{
+}
+
 void STFT::setup(const int num_input_channels)
 {
-    num_channels = (num_input_channels > 0) ? num_input_channels : 1;
+    const int new_num_channels = (num_input_channels > 0) ? num_input_channels : 1;
+
+    // Only allocate again when the number of channels changes
+    if (new_num_channels != num_channels) {
+        num_channels = new_num_channels;
+        allocate();
+    }
 }
 
 void STFT::updateParameters(const int new_fft_size, const int new_overlap, const int new_window_type)
 {
+    const bool resized = (new_fft_size != fft_size || new_overlap != overlap);
+
     updateFftSize(new_fft_size);
     updateHopSize(new_overlap);
-    updateWindow(new_window_type);
+
+    // The window only depends on its type, size and overlap
+    if (resized || new_window_type != window_type)
+        updateWindow(new_window_type);
 }
 
-void STFT::process(juce::AudioBuffer<float> &block)
+void STFT::allocate()
 {
-    num_samples = block.getNumSamples();
+    if (fft_size <= 0)
+        return;
 
-    for (int channel = 0; channel < num_channels; ++channel) {
-        float *channel_data = block.getWritePointer(channel);
+    ffts.clear();
+    for (int channel = 0; channel < num_channels; ++channel)
+        ffts.push_back(std::make_unique<juce::dsp::FFT>(log2(fft_size)));
 
-        current_input_buffer_write_position = input_buffer_write_position;
-        current_output_buffer_write_position = output_buffer_write_position;
-        current_output_buffer_read_position = output_buffer_read_position;
-        current_samples_since_last_FFT = samples_since_last_FFT;
+    input_buffer_length = fft_size;
+    input_buffer.setSize(num_channels, input_buffer_length);
 
-        for (int sample = 0; sample < num_samples; ++sample) {
-            const float input_sample = channel_data[sample];
+    output_buffer_length = fft_size;
+    output_buffer.setSize(num_channels, output_buffer_length);
+
+    time_domain_buffer.realloc((size_t) num_channels * fft_size);
+    frequency_domain_buffer.realloc((size_t) num_channels * fft_size);
+
+    reset();
+}
+
+void STFT::reset()
+{
+    input_buffer.clear();
+    output_buffer.clear();
+    if (fft_size > 0) {
+        time_domain_buffer.clear((size_t) num_channels * fft_size);
+        frequency_domain_buffer.clear((size_t) num_channels * fft_size);
+    }
+
+    input_buffer_write_position = 0;
+    output_buffer_write_position = (hop_size > 0 && output_buffer_length > 0) ? hop_size % output_buffer_length : 0;
+    output_buffer_read_position = 0;
+    samples_since_last_FFT = 0;
+    last_frame_number = -1;
+}
 
-            input_buffer.setSample(channel, current_input_buffer_write_position, input_sample);
-            if (++current_input_buffer_write_position >= input_buffer_length)
-                current_input_buffer_write_position = 0;
-            // diff
-            channel_data[sample] = output_buffer.getSample(channel, current_output_buffer_read_position);
+void STFT::process(juce::AudioBuffer<float> &block, const int64_t frame_number)
+{
+    // The overlap of another frame would be mixed into this one
+    if (last_frame_number >= 0 && frame_number != last_frame_number + 1)
+        reset();
+
+    process(block);
+    last_frame_number = frame_number;
+}
 
-            output_buffer.setSample(channel, current_output_buffer_read_position, 0.0f);
-            if (++current_output_buffer_read_position >= output_buffer_length)
-                current_output_buffer_read_position = 0;
+void STFT::process(juce::AudioBuffer<float> &block)
+{
+    num_samples = block.getNumSamples();
+    const int channels = std::min(num_channels, block.getNumChannels());
+    if (fft_size <= 0 || hop_size <= 0 || (int) ffts.size() < channels)
+        return;
+
+    float *const *block_data = block.getArrayOfWritePointers();
+    float *const *input_channels = input_buffer.getArrayOfWritePointers();
+    float *const *output_channels = output_buffer.getArrayOfWritePointers();
+
+    // Each channel starts at the same positions (and only touches its own buffers)
+    #pragma omp parallel for if (channels > 1)
+    for (int channel = 0; channel < channels; ++channel) {
+        float *channel_data = block_data[channel];
+        float *input_data = input_channels[channel];
+        float *output_data = output_channels[channel];
+
+        int input_position = input_buffer_write_position;
+        int output_write_position = output_buffer_write_position;
+        int output_read_position = output_buffer_read_position;
+        int since_last_FFT = samples_since_last_FFT;
 
-            if (++current_samples_since_last_FFT >= hop_size) {
-                current_samples_since_last_FFT = 0;
-                analysis(channel);
+        for (int sample = 0; sample < num_samples; ++sample) {
+            input_data[input_position] = channel_data[sample];
+            if (++input_position >= input_buffer_length)
+                input_position = 0;
+
+            channel_data[sample] = output_data[output_read_position];
+            output_data[output_read_position] = 0.0f;
+            if (++output_read_position >= output_buffer_length)
+                output_read_position = 0;
+
+            if (++since_last_FFT >= hop_size) {
+                since_last_FFT = 0;
+                analysis(channel, input_position);
                 modification(channel);
-                synthesis(channel);
+                synthesis(channel, output_write_position);
+
+                output_write_position += hop_size;
+                if (output_write_position >= output_buffer_length)
+                    output_write_position = 0;
             }
         }
     }
 
-    input_buffer_write_position = current_input_buffer_write_position;
-    output_buffer_write_position = current_output_buffer_write_position;
-    output_buffer_read_position = current_output_buffer_read_position;
-    samples_since_last_FFT = current_samples_since_last_FFT;
+    // Advance the positions (the same for all channels)
+    const int transforms = (samples_since_last_FFT + num_samples) / hop_size;
+    input_buffer_write_position = (input_buffer_write_position + num_samples) % input_buffer_length;
+    output_buffer_read_position = (output_buffer_read_position + num_samples) % output_buffer_length;
+    output_buffer_write_position = (int) ((output_buffer_write_position + (int64_t) transforms * hop_size) % output_buffer_length);
+    samples_since_last_FFT = (samples_since_last_FFT + num_samples) % hop_size;
 }
 
 
@@ -64,29 +146,13 @@ void STFT::updateFftSize(const int new_fft_size)
     if (new_fft_size != fft_size)
     {
         fft_size = new_fft_size;
-        fft = std::make_unique<juce::dsp::FFT>(log2(fft_size));
-
-        input_buffer_length = fft_size;
-        input_buffer.clear();
-        input_buffer.setSize(num_channels, input_buffer_length);
-
-        output_buffer_length = fft_size;
-        output_buffer.clear();
-        output_buffer.setSize(num_channels, output_buffer_length);
-
         fft_window.realloc(fft_size);
         fft_window.clear(fft_size);
 
-        time_domain_buffer.realloc(fft_size);
-        time_domain_buffer.clear(fft_size);
-
-        frequency_domain_buffer.realloc(fft_size);
-        frequency_domain_buffer.clear(fft_size);
+        if (overlap != 0)
+            hop_size = fft_size / overlap;
 
-        input_buffer_write_position = 0;
-        output_buffer_write_position = 0;
-        output_buffer_read_position = 0;
-        samples_since_last_FFT = 0;
+        allocate();
     }
 }
 
@@ -96,10 +162,11 @@ void STFT::updateHopSize(const int new_overlap)
     {
         overlap = new_overlap;
 
-        if (overlap != 0) {
+        if (overlap != 0)
             hop_size = fft_size / overlap;
-            output_buffer_write_position = hop_size % output_buffer_length;
-        }
+
+        // The overlap of the previous hop size does not line up anymore
+        reset();
     }
 }
 
@@ -142,12 +209,15 @@ void STFT::updateWindow(const int new_window_type)
 
 
 
-void STFT::analysis(const int channel)
+void STFT::analysis(const int channel, const int input_buffer_position)
 {
-    int input_buffer_index = current_input_buffer_write_position;
+    const float *input_data = input_buffer.getReadPointer(channel);
+    juce::dsp::Complex<float> *time_domain = timeDomain(channel);
+
+    int input_buffer_index = input_buffer_position;
     for (int index = 0; index < fft_size; ++index) {
-        time_domain_buffer[index].real(fft_window[index] * input_buffer.getSample(channel, input_buffer_index));
-        time_domain_buffer[index].imag(0.0f);
+        time_domain[index].real(fft_window[index] * input_data[input_buffer_index]);
+        time_domain[index].imag(0.0f);
 
         if (++input_buffer_index >= input_buffer_length)
             input_buffer_index = 0;
@@ -156,37 +226,37 @@ void STFT::analysis(const int channel)
 
 void STFT::modification(const int channel)
 {
-    fft->perform(time_domain_buffer, frequency_domain_buffer, false);
+    juce::dsp::Complex<float> *time_domain = timeDomain(channel);
+    juce::dsp::Complex<float> *frequency_domain = frequencyDomain(channel);
+
+    channelFFT(channel).perform(time_domain, frequency_domain, false);
 
     for (int index = 0; index < fft_size / 2 + 1; ++index) {
-        float magnitude = abs(frequency_domain_buffer[index]);
-        float phase = arg(frequency_domain_buffer[index]);
+        float magnitude = abs(frequency_domain[index]);
+        float phase = arg(frequency_domain[index]);
 
-        frequency_domain_buffer[index].real(magnitude * cosf (phase));
-        frequency_domain_buffer[index].imag(magnitude * sinf (phase));
+        frequency_domain[index].real(magnitude * cosf (phase));
+        frequency_domain[index].imag(magnitude * sinf (phase));
 
         if (index > 0 && index < fft_size / 2) {
-            frequency_domain_buffer[fft_size - index].real(magnitude * cosf (phase));
-            frequency_domain_buffer[fft_size - index].imag(magnitude * sinf (-phase));
+            frequency_domain[fft_size - index].real(magnitude * cosf (phase));
+            frequency_domain[fft_size - index].imag(magnitude * sinf (-phase));
         }
     }
 
-    fft->perform(frequency_domain_buffer, time_domain_buffer, true);
+    channelFFT(channel).perform(frequency_domain, time_domain, true);
 }
 
-void STFT::synthesis(const int channel)
+void STFT::synthesis(const int channel, const int output_buffer_position)
 {
-    int output_buffer_index = current_output_buffer_write_position;
+    float *output_data = output_buffer.getArrayOfWritePointers()[channel];
+    const juce::dsp::Complex<float> *time_domain = timeDomain(channel);
+
+    int output_buffer_index = output_buffer_position;
     for (int index = 0; index < fft_size; ++index) {
-        float output_sample = output_buffer.getSample(channel, output_buffer_index);
-        output_sample += time_domain_buffer[index].real() * window_scale_factor;
-        output_buffer.setSample(channel, output_buffer_index, output_sample);
+        output_data[output_buffer_index] += time_domain[index].real() * window_scale_factor;
 
         if (++output_buffer_index >= output_buffer_length)
             output_buffer_index = 0;
     }
-
-    current_output_buffer_write_position += hop_size;
-    if (current_output_buffer_write_position >= output_buffer_length)
-        current_output_buffer_write_position = 0;
 }
@@ -15,13 +15,25 @@
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_dsp/juce_dsp.h>
 
+#include <memory>
+#include <vector>
+
 namespace openshot
 {
 
+    /**
+     * @brief A streaming short-time Fourier transform (overlap-add), used by the spectral audio effects
+     *
+     * The overlap of each channel is carried from one frame to the next, so consecutive frames are
+     * processed seamlessly. The buffers are only allocated again when the FFT size, overlap or number
+     * of channels change, and the channels are transformed in parallel. When frames are not requested
+     * consecutively (e.g. seeking, or a FrameMapper requesting a frame again), the overlap of the
+     * previous frame does not belong to the new one, so it is cleared instead of mixed in.
+     */
     class STFT
     {
     public:
-        STFT() : num_channels (1) { }
+        STFT();
 
         virtual ~STFT() { }
 
@@ -29,6 +41,12 @@ namespace openshot
 
         void process(juce::AudioBuffer<float> &block);
 
+        /// Process the audio of a frame, clearing the overlap if it does not follow the previous frame
+        void process(juce::AudioBuffer<float> &block, const int64_t frame_number);
+
+        /// Clear the overlap (and the input history) of all channels
+        void reset();
+
         void updateParameters(const int new_fft_size, const int new_overlap, const int new_window_type);
 
         virtual void updateFftSize(const int new_fft_size);
@@ -41,16 +59,28 @@ namespace openshot
 
         virtual void modification(const int channel);
 
-        virtual void analysis(const int channel);
+        virtual void analysis(const int channel, const int input_buffer_position);
+
+        virtual void synthesis(const int channel, const int output_buffer_position);
 
-        virtual void synthesis(const int channel);
+        /// Allocate the buffers of all channels (for the current FFT size)
+        void allocate();
 
     protected:
+        /// The time domain buffer of a channel (fft_size samples)
+        juce::dsp::Complex<float> *timeDomain(const int channel) { return time_domain_buffer + (size_t) channel * fft_size; }
+
+        /// The frequency domain buffer of a channel (fft_size bins)
+        juce::dsp::Complex<float> *frequencyDomain(const int channel) { return frequency_domain_buffer + (size_t) channel * fft_size; }
+
+        /// The FFT of a channel (each channel has its own, so they can be transformed in parallel)
+        juce::dsp::FFT &channelFFT(const int channel) { return *ffts[channel]; }
+
         int num_channels;
         int num_samples;
 
         int fft_size;
-        std::unique_ptr<juce::dsp::FFT> fft;
+        std::vector<std::unique_ptr<juce::dsp::FFT>> ffts; ///< One FFT per channel
 
         int input_buffer_length;
         juce::AudioBuffer<float> input_buffer;
@@ -59,8 +89,8 @@ namespace openshot
         juce::AudioBuffer<float> output_buffer;
 
         juce::HeapBlock<float> fft_window;
-        juce::HeapBlock<juce::dsp::Complex<float>> time_domain_buffer;
-        juce::HeapBlock<juce::dsp::Complex<float>> frequency_domain_buffer;
+        juce::HeapBlock<juce::dsp::Complex<float>> time_domain_buffer; ///< One fft_size block per channel
+        juce::HeapBlock<juce::dsp::Complex<float>> frequency_domain_buffer; ///< One fft_size block per channel
 
         int overlap;
         int hop_size;
@@ -72,10 +102,7 @@ namespace openshot
         int output_buffer_read_position;
         int samples_since_last_FFT;
 
-        int current_input_buffer_write_position;
-        int current_output_buffer_write_position;
-        int current_output_buffer_read_position;
-        int current_samples_since_last_FFT;
+        int64_t last_frame_number; ///< The last processed frame (or -1)
     };
 }
 
@@ -48,6 +48,7 @@ void Whisperization::init_effect_details()
 // modified openshot::Frame object
 std::shared_ptr<openshot::Frame> Whisperization::GetFrame(std::shared_ptr<openshot::Frame> frame, int64_t frame_number)
 {
+	frame->DetachAudio();
 	const std::lock_guard<std::recursive_mutex> lock(mutex);
 	ScopedNoDenormals noDenormals;
 
@@ -62,30 +63,49 @@ std::shared_ptr<openshot::Frame> Whisperization::GetFrame(std::shared_ptr<opensh
 						  (int)hop_size_value,
 						  (int)window_type);
 
-	stft.process(*frame->audio);
+	stft.seed(frame_number);
+	stft.process(*frame->audio, frame_number);
 
 	// return the modified frame
 	return frame;
 }
 
+void Whisperization::WhisperizationEffect::seed(int64_t frame_number)
+{
+	// Each channel has its own generator (the channels are transformed in parallel)
+	generators.resize(num_channels);
+	random_phases.resize(num_channels);
+	for (int channel = 0; channel < num_channels; ++channel)
+		generators[channel].Seed(NoiseGenerator::SeedFor(frame_number, channel));
+}
+
 void Whisperization::WhisperizationEffect::modification(const int channel)
 {
-	fft->perform(time_domain_buffer, frequency_domain_buffer, false);
+	juce::dsp::Complex<float> *time_domain = timeDomain(channel);
+	juce::dsp::Complex<float> *frequency_domain = frequencyDomain(channel);
 
-	for (int index = 0; index < fft_size / 2 + 1; ++index) {
-		float magnitude = abs(frequency_domain_buffer[index]);
-		float phase = 2.0f * M_PI * (float)rand() / (float)RAND_MAX;
+	channelFFT(channel).perform(time_domain, frequency_domain, false);
 
-		frequency_domain_buffer[index].real(magnitude * cosf(phase));
-		frequency_domain_buffer[index].imag(magnitude * sinf(phase));
+	// A random phase for each bin (generated as one block)
+	const int num_bins = fft_size / 2 + 1;
+	std::vector<float> &random = random_phases[channel];
+	random.resize(num_bins);
+	generators[channel].FillUniform(random.data(), num_bins);
+
+	for (int index = 0; index < num_bins; ++index) {
+		float magnitude = abs(frequency_domain[index]);
+		float phase = 2.0f * M_PI * random[index];
+
+		frequency_domain[index].real(magnitude * cosf(phase));
+		frequency_domain[index].imag(magnitude * sinf(phase));
 
 		if (index > 0 && index < fft_size / 2) {
-			frequency_domain_buffer[fft_size - index].real(magnitude * cosf (phase));
-			frequency_domain_buffer[fft_size - index].imag(magnitude * sinf (-phase));
+			frequency_domain[fft_size - index].real(magnitude * cosf (phase));
+			frequency_domain[fft_size - index].imag(magnitude * sinf (-phase));
 		}
 	}
 
-	fft->perform(frequency_domain_buffer, time_domain_buffer, true);
+	channelFFT(channel).perform(frequency_domain, time_domain, true);
 }
 
 
@@ -144,7 +164,7 @@ void Whisperization::SetJsonValue(const Json::Value root) {
 }
 
 // Get all properties for a specific frame
-std::string Whisperization::PropertiesJSON(int64_t requested_frame) const {
+Json::Value Whisperization::PropertiesJsonValue(int64_t requested_frame) const {
 
 	// Generate JSON properties list
 	Json::Value root = BasePropertiesJSON(requested_frame);
@@ -174,5 +194,5 @@ std::string Whisperization::PropertiesJSON(int64_t requested_frame) const {
 
 
 	// Return formatted string
-	return root.toStyledString();
+	return root;
 }
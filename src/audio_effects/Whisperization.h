@@ -24,6 +24,9 @@
 #include "../KeyFrame.h"
 #include "../Enums.h"
 #include "STFT.h"
+#include "NoiseGenerator.h"
+
+#include <vector>
 
 namespace juce {
     namespace dsp {
@@ -70,7 +73,7 @@ namespace openshot
 		Json::Value JsonValue() const override; ///< Generate Json::Value for this object
 		void SetJsonValue(const Json::Value root) override; ///< Load Json::Value into this object
 
-		std::string PropertiesJSON(int64_t requested_frame) const override;
+		Json::Value PropertiesJsonValue(int64_t requested_frame) const override;
 
 
 		class WhisperizationEffect : public STFT
@@ -78,10 +81,15 @@ namespace openshot
 		public:
 			WhisperizationEffect(Whisperization& p) : parent (p) { }
 
+			/// Seed the random phases of each channel with a frame number (after setup())
+			void seed(int64_t frame_number);
+
 		private:
 			void modification(const int channel) override;
 
 			Whisperization &parent;
+			std::vector<openshot::NoiseGenerator> generators; ///< The random phases of each channel
+			std::vector<std::vector<float>> random_phases; ///< The random phases of each bin (for each channel)
 		};
 
 		std::recursive_mutex mutex;
@@ -12,6 +12,7 @@
 
 #include "Bars.h"
 #include "Exceptions.h"
+#include "PixelKernels.h"
 
 using namespace openshot;
 
@@ -50,10 +51,9 @@ std::shared_ptr<openshot::Frame> Bars::GetFrame(std::shared_ptr<openshot::Frame>
 	// Get the frame's image
 	std::shared_ptr<QImage> frame_image = frame->GetImage();
 
-	// Get bar color (and create small color image)
-	auto tempColor = std::make_shared<QImage>(
-		frame_image->width(), 1, QImage::Format_RGBA8888_Premultiplied);
-	tempColor->fill(QColor(QString::fromStdString(color.GetColorHex(frame_number))));
+	// Get bar color (as a premultiplied pixel)
+	QImage tempColor(1, 1, QImage::Format_RGBA8888_Premultiplied);
+	tempColor.fill(QColor(QString::fromStdString(color.GetColorHex(frame_number))));
 
 	// Get current keyframe values
 	double left_value = left.GetValue(frame_number);
@@ -61,37 +61,15 @@ std::shared_ptr<openshot::Frame> Bars::GetFrame(std::shared_ptr<openshot::Frame>
 	double right_value = right.GetValue(frame_number);
 	double bottom_value = bottom.GetValue(frame_number);
 
-	// Get pixel array pointer
-	unsigned char *pixels = (unsigned char *) frame_image->bits();
-	unsigned char *color_pixels = (unsigned char *) tempColor->bits();
-
 	// Get pixels sizes of all bars
 	int top_bar_height = top_value * frame_image->height();
 	int bottom_bar_height = bottom_value * frame_image->height();
 	int left_bar_width = left_value * frame_image->width();
 	int right_bar_width = right_value * frame_image->width();
 
-	// Loop through rows
-	for (int row = 0; row < frame_image->height(); row++) {
-
-		// Top & Bottom Bar
-		if ((top_bar_height > 0.0 && row <= top_bar_height) || (bottom_bar_height > 0.0 && row >= frame_image->height() - bottom_bar_height)) {
-			memcpy(&pixels[row * frame_image->width() * 4], color_pixels, sizeof(char) * frame_image->width() * 4);
-		} else {
-			// Left Bar
-			if (left_bar_width > 0.0) {
-				memcpy(&pixels[row * frame_image->width() * 4], color_pixels, sizeof(char) * left_bar_width * 4);
-			}
-
-			// Right Bar
-			if (right_bar_width > 0.0) {
-				memcpy(&pixels[((row * frame_image->width()) + (frame_image->width() - right_bar_width)) * 4], color_pixels, sizeof(char) * right_bar_width * 4);
-			}
-		}
-	}
-
-	// Cleanup colors and arrays
-	tempColor.reset();
+	// Fill the bars (on multiple threads). A top bar also covers the row at its height.
+	PixelKernels::Bars((unsigned char *) frame_image->bits(), frame_image->width(), frame_image->height(), tempColor.constBits(),
+					   top_bar_height > 0 ? top_bar_height + 1 : 0, bottom_bar_height, left_bar_width, right_bar_width);
 
 	// return the modified frame
 	return frame;
@@ -157,7 +135,7 @@ void Bars::SetJsonValue(const Json::Value root) {
 }
 
 // Get all properties for a specific frame
-std::string Bars::PropertiesJSON(int64_t requested_frame) const {
+Json::Value Bars::PropertiesJsonValue(int64_t requested_frame) const {
 
 	// Generate JSON properties list
 	Json::Value root = BasePropertiesJSON(requested_frame);
@@ -173,5 +151,5 @@ std::string Bars::PropertiesJSON(int64_t requested_frame) const {
 	root["bottom"] = add_property_json("Bottom Size", bottom.GetValue(requested_frame), "float", "", &bottom, 0.0, 0.5, false, requested_frame);
 
 	// Return formatted string
-	return root.toStyledString();
+	return root;
 }
@@ -10,20 +10,31 @@
 //
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
 #include "Blur.h"
 #include "Exceptions.h"
+#include "PixelKernels.h"
 
 using namespace openshot;
 
+// Radius (in pixels) which is kept at least, when blurring a downsampled copy of the image
+static const int DOWNSAMPLE_RADIUS = 8;
+
+// Largest downsample factor
+static const int MAX_DOWNSAMPLE_FACTOR = 8;
+
 /// Blank constructor, useful when using Json to load the effect properties
-Blur::Blur() : horizontal_radius(6.0), vertical_radius(6.0), sigma(3.0), iterations(3.0) {
+Blur::Blur() : downsample(false), horizontal_radius(6.0), vertical_radius(6.0), sigma(3.0), iterations(3.0) {
 	// Init effect properties
 	init_effect_details();
 }
 
 // Default constructor
 Blur::Blur(Keyframe new_horizontal_radius, Keyframe new_vertical_radius, Keyframe new_sigma, Keyframe new_iterations) :
-		horizontal_radius(new_horizontal_radius), vertical_radius(new_vertical_radius),
+		downsample(false), horizontal_radius(new_horizontal_radius), vertical_radius(new_vertical_radius),
 		sigma(new_sigma), iterations(new_iterations)
 {
 	// Init effect properties
@@ -54,103 +65,43 @@ std::shared_ptr<openshot::Frame> Blur::GetFrame(std::shared_ptr<openshot::Frame>
 	// Get the current blur radius
 	int horizontal_radius_value = horizontal_radius.GetValue(frame_number);
 	int vertical_radius_value = vertical_radius.GetValue(frame_number);
-	float sigma_value = sigma.GetValue(frame_number);
 	int iteration_value = iterations.GetInt(frame_number);
 
+	// Draft quality previews blur once (approximately), and always downsample large radii
+	const bool draft = IsDraftQuality();
+	if (draft)
+		iteration_value = std::min(iteration_value, 1);
+
 	int w = frame_image->width();
 	int h = frame_image->height();
 
-	// Grab two copies of the image pixel data
-	QImage image_copy = frame_image->copy();
-	std::shared_ptr<QImage> frame_image_2 = std::make_shared<QImage>(image_copy);
-
-	// Loop through each iteration
-	for (int iteration = 0; iteration < iteration_value; ++iteration)
-	{
-		// HORIZONTAL BLUR (if any)
-		if (horizontal_radius_value > 0.0) {
-			// Apply horizontal blur to target RGBA channels
-			boxBlurH(frame_image->bits(), frame_image_2->bits(), w, h, horizontal_radius_value);
-
-			// Swap output image back to input
-			frame_image.swap(frame_image_2);
-		}
-
-		// VERTICAL BLUR (if any)
-		if (vertical_radius_value > 0.0) {
-			// Apply vertical blur to target RGBA channels
-			boxBlurT(frame_image->bits(), frame_image_2->bits(), w, h, vertical_radius_value);
-
-			// Swap output image back to input
-			frame_image.swap(frame_image_2);
-		}
+	// Downsample factor (for large radii, if enabled)
+	int factor = 1;
+	if (downsample || draft)
+		factor = std::min(std::max(horizontal_radius_value, vertical_radius_value) / DOWNSAMPLE_RADIUS, MAX_DOWNSAMPLE_FACTOR);
+
+	if (factor <= 1) {
+		// Blur the frame's image in place
+		PixelKernels::BoxBlur((unsigned char *) frame_image->bits(), w, h, horizontal_radius_value, vertical_radius_value, iteration_value);
+	} else {
+		// Blur a smaller copy of the image (with proportionally smaller radii)
+		QImage small_image = frame_image->scaled(std::max(w / factor, 1), std::max(h / factor, 1),
+			Qt::IgnoreAspectRatio, Qt::SmoothTransformation).convertToFormat(QImage::Format_RGBA8888_Premultiplied);
+		int small_horizontal_radius = horizontal_radius_value > 0 ? std::max(int(round(horizontal_radius_value / double(factor))), 1) : 0;
+		int small_vertical_radius = vertical_radius_value > 0 ? std::max(int(round(vertical_radius_value / double(factor))), 1) : 0;
+		PixelKernels::BoxBlur(small_image.bits(), small_image.width(), small_image.height(),
+							  small_horizontal_radius, small_vertical_radius, iteration_value);
+
+		// Scale it back up, and copy it into the frame's image
+		QImage blurred_image = small_image.scaled(w, h, Qt::IgnoreAspectRatio, Qt::SmoothTransformation).convertToFormat(frame_image->format());
+		for (int row = 0; row < h; ++row)
+			memcpy(frame_image->scanLine(row), blurred_image.constScanLine(row), w * 4);
 	}
 
 	// return the modified frame
 	return frame;
 }
 
-// Credit: http://blog.ivank.net/fastest-gaussian-blur.html (MIT License)
-// Modified to process all four channels in a pixel array
-void Blur::boxBlurH(unsigned char *scl, unsigned char *tcl, int w, int h, int r) {
-	float iarr = 1.0 / (r + r + 1);
-
-	#pragma omp parallel for shared (scl, tcl)
-	for (int i = 0; i < h; ++i) {
-		for (int ch = 0; ch < 4; ++ch) {
-			int ti = i * w, li = ti, ri = ti + r;
-			int fv = scl[ti * 4 + ch], lv = scl[(ti + w - 1) * 4 + ch], val = (r + 1) * fv;
-			for (int j = 0; j < r; ++j) {
-				val += scl[(ti + j) * 4 + ch];
-			}
-			for (int j = 0; j <= r; ++j) {
-				val += scl[ri++ * 4 + ch] - fv;
-				tcl[ti++ * 4 + ch] = round(val * iarr);
-			}
-			for (int j = r + 1; j < w - r; ++j) {
-				val += scl[ri++ * 4 + ch] - scl[li++ * 4 + ch];
-				tcl[ti++ * 4 + ch] = round(val * iarr);
-			}
-			for (int j = w - r; j < w; ++j) {
-				val += lv - scl[li++ * 4 + ch];
-				tcl[ti++ * 4 + ch] = round(val * iarr);
-			}
-		}
-	}
-}
-
-void Blur::boxBlurT(unsigned char *scl, unsigned char *tcl, int w, int h, int r) {
-	float iarr = 1.0 / (r + r + 1);
-
-	#pragma omp parallel for shared (scl, tcl)
-	for (int i = 0; i < w; i++) {
-		for (int ch = 0; ch < 4; ++ch) {
-			int ti = i, li = ti, ri = ti + r * w;
-			int fv = scl[ti * 4 + ch], lv = scl[(ti + w * (h - 1)) * 4 + ch], val = (r + 1) * fv;
-			for (int j = 0; j < r; j++) val += scl[(ti + j * w) * 4 + ch];
-			for (int j = 0; j <= r; j++) {
-				val += scl[ri * 4 + ch] - fv;
-				tcl[ti * 4 + ch] = round(val * iarr);
-				ri += w;
-				ti += w;
-			}
-			for (int j = r + 1; j < h - r; j++) {
-				val += scl[ri * 4 + ch] - scl[li * 4 + ch];
-				tcl[ti * 4 + ch] = round(val * iarr);
-				li += w;
-				ri += w;
-				ti += w;
-			}
-			for (int j = h - r; j < h; j++) {
-				val += lv - scl[li * 4 + ch];
-				tcl[ti * 4 + ch] = round(val * iarr);
-				li += w;
-				ti += w;
-			}
-		}
-	}
-}
-
 // Generate JSON string of this object
 std::string Blur::Json() const {
 
@@ -168,6 +119,7 @@ Json::Value Blur::JsonValue() const {
 	root["vertical_radius"] = vertical_radius.JsonValue();
 	root["sigma"] = sigma.JsonValue();
 	root["iterations"] = iterations.JsonValue();
+	root["downsample"] = downsample;
 
 	// return JsonValue
 	return root;
@@ -205,10 +157,12 @@ void Blur::SetJsonValue(const Json::Value root) {
 		sigma.SetJsonValue(root["sigma"]);
 	if (!root["iterations"].isNull())
 		iterations.SetJsonValue(root["iterations"]);
+	if (!root["downsample"].isNull())
+		downsample = root["downsample"].asBool();
 }
 
 // Get all properties for a specific frame
-std::string Blur::PropertiesJSON(int64_t requested_frame) const {
+Json::Value Blur::PropertiesJsonValue(int64_t requested_frame) const {
 
 	// Generate JSON properties list
 	Json::Value root = BasePropertiesJSON(requested_frame);
@@ -219,6 +173,11 @@ std::string Blur::PropertiesJSON(int64_t requested_frame) const {
 	root["sigma"] = add_property_json("Sigma", sigma.GetValue(requested_frame), "float", "", &sigma, 0, 100, false, requested_frame);
 	root["iterations"] = add_property_json("Iterations", iterations.GetValue(requested_frame), "float", "", &iterations, 0, 100, false, requested_frame);
 
+	// Add downsample choices (dropdown style)
+	root["downsample"] = add_property_json("Downsample Large Blur", downsample, "int", "", NULL, 0, 1, false, requested_frame);
+	root["downsample"]["choices"].append(add_property_choice_json("Yes", true, downsample));
+	root["downsample"]["choices"].append(add_property_choice_json("No", false, downsample));
+
 	// Return formatted string
-	return root.toStyledString();
+	return root;
 }
@@ -32,6 +32,9 @@ namespace openshot
 	 * Adjusting the blur of an image over time can create many different powerful effects. To achieve a
 	 * box blur effect, use identical horizontal and vertical blur values. To achieve a Gaussian blur,
 	 * use 3 iterations, a sigma of 3.0, and a radius between 3 and X (depending on how much blur you want).
+	 *
+	 * The cost of the blur doesn't depend on the radius. For very large radii, enable \ref downsample
+	 * to blur a smaller copy of the image, which is then scaled back up.
 	 */
 	class Blur : public EffectBase
 	{
@@ -39,12 +42,8 @@ namespace openshot
 		/// Init effect settings
 		void init_effect_details();
 
-		// Internal blur methods (inspired and credited to http://blog.ivank.net/fastest-gaussian-blur.html)
-		void boxBlurH(unsigned char *scl, unsigned char *tcl, int w, int h, int r);
-		void boxBlurT(unsigned char *scl, unsigned char *tcl, int w, int h, int r);
-
-
 	public:
+		bool downsample;			///< Blur large radii on a downsampled copy of the image (much faster, but slightly softer)
 		Keyframe horizontal_radius;	///< Horizontal blur radius keyframe. The size of the horizontal blur operation in pixels.
 		Keyframe vertical_radius;	///< Vertical blur radius keyframe. The size of the vertical blur operation in pixels.
 		Keyframe sigma;				///< Sigma keyframe. The amount of spread in the blur operation. Should be larger than radius.
@@ -89,7 +88,7 @@ namespace openshot
 
 		/// Get all properties for a specific frame (perfect for a UI to display the current state
 		/// of all properties at any time)
-		std::string PropertiesJSON(int64_t requested_frame) const override;
+		Json::Value PropertiesJsonValue(int64_t requested_frame) const override;
 	};
 
 }
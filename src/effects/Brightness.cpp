@@ -12,6 +12,7 @@
 
 #include "Brightness.h"
 #include "Exceptions.h"
+#include "PixelKernels.h"
 
 using namespace openshot;
 
@@ -50,48 +51,27 @@ std::shared_ptr<openshot::Frame> Brightness::GetFrame(std::shared_ptr<openshot::
 	std::shared_ptr<QImage> frame_image = frame->GetImage();
 
 	// Get keyframe values for this frame
-	float brightness_value = brightness.GetValue(frame_number);
-	float contrast_value = contrast.GetValue(frame_number);
+	PixelOperation operation;
+	GetPixelOperation(frame_number, operation);
 
-	// Loop through pixels
+	// Adjust all pixels (the kernel removes, and re-applies, the pre-multiplied alpha)
 	unsigned char *pixels = (unsigned char *) frame_image->bits();
-	int pixel_count = frame_image->width() * frame_image->height();
-
-	#pragma omp parallel for
-	for (int pixel = 0; pixel < pixel_count; ++pixel)
-	{
-		// Compute contrast adjustment factor
-		float factor = (259 * (contrast_value + 255)) / (255 * (259 - contrast_value));
-
-		// Calculate alpha % (to be used for removing pre-multiplied alpha value)
-		int A = pixels[pixel * 4 + 3];
-		float alpha_percent = A / 255.0;
-
-		// Get RGB values, and remove pre-multiplied alpha
-		unsigned char R = pixels[pixel * 4 + 0] / alpha_percent;
-		unsigned char G = pixels[pixel * 4 + 1] / alpha_percent;
-		unsigned char B = pixels[pixel * 4 + 2] / alpha_percent;
-
-		// Apply constrained contrast adjustment
-		R = constrain((factor * (R - 128)) + 128);
-		G = constrain((factor * (G - 128)) + 128);
-		B = constrain((factor * (B - 128)) + 128);
-
-		// Adjust brightness and write constrained values back to image
-		pixels[pixel * 4 + 0] = constrain(R + (255 * brightness_value));
-		pixels[pixel * 4 + 1] = constrain(G + (255 * brightness_value));
-		pixels[pixel * 4 + 2] = constrain(B + (255 * brightness_value));
-
-		// Pre-multiply the alpha back into the color channels
-		pixels[pixel * 4 + 0] *= alpha_percent;
-		pixels[pixel * 4 + 1] *= alpha_percent;
-		pixels[pixel * 4 + 2] *= alpha_percent;
-	}
+	int64_t pixel_count = int64_t(frame_image->width()) * frame_image->height();
+	PixelKernels::Apply(pixels, pixel_count, { operation });
 
 	// return the modified frame
 	return frame;
 }
 
+// Get the brightness & contrast adjustment of a frame
+bool Brightness::GetPixelOperation(int64_t frame_number, PixelOperation& operation)
+{
+	operation.type = PixelOperation::BRIGHTNESS_CONTRAST;
+	operation.values[0] = brightness.GetValue(frame_number);
+	operation.values[1] = contrast.GetValue(frame_number);
+	return true;
+}
+
 // Generate JSON string of this object
 std::string Brightness::Json() const {
 
@@ -143,7 +123,7 @@ void Brightness::SetJsonValue(const Json::Value root) {
 }
 
 // Get all properties for a specific frame
-std::string Brightness::PropertiesJSON(int64_t requested_frame) const {
+Json::Value Brightness::PropertiesJsonValue(int64_t requested_frame) const {
 
 	// Generate JSON properties list
 	Json::Value root = BasePropertiesJSON(requested_frame);
@@ -153,5 +133,5 @@ std::string Brightness::PropertiesJSON(int64_t requested_frame) const {
 	root["contrast"] = add_property_json("Contrast", contrast.GetValue(requested_frame), "float", "", &contrast, -128, 128.0, false, requested_frame);
 
 	// Return formatted string
-	return root.toStyledString();
+	return root;
 }
@@ -81,8 +81,8 @@ void Caption::process_regex() {
 	if (is_dirty) {
 		is_dirty = false;
 
-		// Clear existing matches
-		matchedCaptions.clear();
+		// Clear existing captions
+		cues.clear();
 
 		QString caption_prepared = QString(caption_text.c_str());
 		if (caption_prepared.endsWith("\n\n") == false) {
@@ -96,13 +96,111 @@ void Caption::process_regex() {
 		while (i.hasNext()) {
 			QRegularExpressionMatch match = i.next();
 			if (match.hasMatch()) {
-				// Push all match objects into a vector (so we can reverse them later)
-				matchedCaptions.push_back(match);
+				// Build timestamp (00:00:04.000 --> 00:00:06.500)
+				CaptionCue cue;
+				cue.start_time = (match.captured(1).toFloat() * 60.0 * 60.0 ) + (match.captured(2).toFloat() * 60.0 ) +
+								 match.captured(3).toFloat() + (match.captured(4).toFloat() / 1000.0);
+				cue.end_time = (match.captured(5).toFloat() * 60.0 * 60.0 ) + (match.captured(6).toFloat() * 60.0 ) +
+							   match.captured(7).toFloat() + (match.captured(8).toFloat() / 1000.0);
+
+				// Split multiple lines (and ignore lines that start with NOTE, or are <= 1 char long)
+				for (const QString& line : match.captured(9).split("\n")) {
+					if (!line.startsWith(QStringLiteral("NOTE")) && line.length() > 1)
+						cue.lines.append(line);
+				}
+
+				// Parse each caption once (instead of on every frame)
+				cues.push_back(cue);
 			}
 		}
 	}
 }
 
+// Get the layout of some lines of text (only shaped and wrapped again when the text, font or width changes)
+std::shared_ptr<const Caption::CaptionLayout> Caption::get_layout(const QStringList& text, double font_size_value, double area_width)
+{
+	const QString name = QString(font_name.c_str());
+	const int pixel_size = std::max(font_size_value, 1.0);
+
+	std::shared_ptr<const CaptionLayout> cached;
+	#pragma omp critical (caption_layout)
+	cached = layout;
+	if (cached && cached->font_pixel_size == pixel_size && cached->area_width == area_width &&
+		cached->font_name == name && cached->text == text)
+		return cached;
+
+	// Shape the text outside of the lock (other frames can use the previous layout meanwhile)
+	auto new_layout = std::make_shared<CaptionLayout>();
+	new_layout->text = text;
+	new_layout->font_name = name;
+	new_layout->font_pixel_size = pixel_size;
+	new_layout->area_width = area_width;
+
+	// Font options and metrics for caption text
+	QFont font(name, int(font_size_value));
+	font.setPixelSize(pixel_size);
+	QFontMetricsF metrics = QFontMetricsF(font);
+	new_layout->font = font;
+	new_layout->line_spacing = metrics.lineSpacing();
+	new_layout->max_text_width = 0.0;
+	QRectF caption_area = QRectF(0.0, 0.0, area_width, metrics.lineSpacing());
+
+	for (const QString& line : text) {
+		// Loop through words, and find word-wrap boundaries
+		QStringList words = line.split(" ");
+
+		// Wrap languages which do not use spaces
+		bool use_spaces = true;
+		if (line.length() > 20 && words.length() == 1) {
+			words = line.split("");
+			use_spaces = false;
+		}
+		int words_remaining = words.length();
+		while (words_remaining > 0) {
+			bool words_displayed = false;
+			for(int word_index = words.length(); word_index > 0; word_index--) {
+				// Current matched caption string (from the beginning to the current word index)
+				QString fitting_line = words.mid(0, word_index).join(" ");
+
+				// Calculate size of text
+				QRectF textRect = metrics.boundingRect(caption_area, Qt::TextSingleLine, fitting_line);
+				if (textRect.width() <= caption_area.width()) {
+					// Create path and add text to it (at the origin, it is moved into place for each frame)
+					QPainterPath path1;
+					if (use_spaces) {
+						fitting_line = words.mid(0, word_index).join(" ");
+					} else {
+						fitting_line = words.mid(0, word_index).join("");
+					}
+					path1.addText(QPointF(0.0, 0.0), font, fitting_line);
+					new_layout->paths.push_back(path1);
+					new_layout->bounds.push_back(path1.boundingRect());
+
+					// Update line (to remove words already drawn
+					words = words.mid(word_index, words.length());
+					words_remaining = words.length();
+					words_displayed = true;
+
+					// Detect max width (of widest text line)
+					if (path1.boundingRect().width() > new_layout->max_text_width) {
+						new_layout->max_text_width = path1.boundingRect().width();
+					}
+					break;
+				}
+			}
+
+			if (!words_displayed) {
+				// Exit loop if no words displayed
+				words_remaining = 0;
+			}
+		}
+	}
+
+	#pragma omp critical (caption_layout)
+	layout = new_layout;
+	return new_layout;
+}
+
 // This method is required for all derived classes of EffectBase, and returns a
 // modified openshot::Frame object
 std::shared_ptr<openshot::Frame> Caption::GetFrame(std::shared_ptr<openshot::Frame> frame, int64_t frame_number)
@@ -145,132 +243,75 @@ std::shared_ptr<openshot::Frame> Caption::GetFrame(std::shared_ptr<openshot::Fra
 
 	// Load timeline's new frame image into a QPainter
 	QPainter painter(frame_image.get());
-	painter.setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform | QPainter::TextAntialiasing, true);
+	painter.setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform | QPainter::TextAntialiasing, !IsDraftQuality());
 
 	// Composite a new layer onto the image
 	painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
 
-	// Font options and metrics for caption text
-	double font_size_value = font_size.GetValue(frame_number) * timeline_scale_factor;
-	QFont font(QString(font_name.c_str()), int(font_size_value));
-	font.setPixelSize(std::max(font_size_value, 1.0));
-	QFontMetricsF metrics = QFontMetricsF(font);
-
 	// Get current keyframe values
 	double left_value = left.GetValue(frame_number);
 	double top_value = top.GetValue(frame_number);
 	double fade_in_value = fade_in.GetValue(frame_number) * fps.ToDouble();
 	double fade_out_value = fade_out.GetValue(frame_number) * fps.ToDouble();
 	double right_value = right.GetValue(frame_number);
+	double font_size_value = font_size.GetValue(frame_number) * timeline_scale_factor;
 	double background_corner_value = background_corner.GetValue(frame_number) * timeline_scale_factor;
 	double padding_value = background_padding.GetValue(frame_number) * timeline_scale_factor;
 	double stroke_width_value = stroke_width.GetValue(frame_number) * timeline_scale_factor;
 	double line_spacing_value = line_spacing.GetValue(frame_number);
-	double metrics_line_spacing = metrics.lineSpacing();
 
-	// Calculate caption area (based on left, top, and right margin)
+	// Calculate caption area width (based on left and right margin)
 	double left_margin_x = frame_image->width() * left_value;
-	double starting_y = (frame_image->height() * top_value) + metrics_line_spacing;
-	double current_y = starting_y;
-	double bottom_y = starting_y;
-	double top_y = starting_y;
-	double max_text_width = 0.0;
 	double right_margin_x = frame_image->width() - (frame_image->width() * right_value);
 	double caption_area_width = right_margin_x - left_margin_x;
-	QRectF caption_area = QRectF(left_margin_x, starting_y, caption_area_width, frame_image->height());
 
-	// Keep track of all required text paths
-	std::vector<QPainterPath> text_paths;
+	// Loop through captions and find text to display (if any)
+	QStringList visible_text;
 	double fade_in_percentage = 0.0;
 	double fade_out_percentage = 0.0;
-	double line_height = metrics_line_spacing * line_spacing_value;
+	for (const auto& cue : cues) {
+		int64_t start_frame = cue.start_time * fps.ToFloat();
+		int64_t end_frame = cue.end_time * fps.ToFloat();
+		if (cue.lines.isEmpty() || frame_number < start_frame || frame_number > end_frame)
+			continue;
 
-	// Loop through matches and find text to display (if any)
-	for (auto match = matchedCaptions.begin(); match != matchedCaptions.end(); match++) {
-
-		// Build timestamp (00:00:04.000 --> 00:00:06.500)
-		int64_t start_frame = ((match->captured(1).toFloat() * 60.0 * 60.0 ) + (match->captured(2).toFloat() * 60.0 ) +
-							   match->captured(3).toFloat() + (match->captured(4).toFloat() / 1000.0)) * fps.ToFloat();
-		int64_t end_frame = ((match->captured(5).toFloat() * 60.0 * 60.0 ) + (match->captured(6).toFloat() * 60.0 ) +
-							 match->captured(7).toFloat() + (match->captured(8).toFloat() / 1000.0)) * fps.ToFloat();
-
-		// Split multiple lines into separate paths
-		QStringList lines = match->captured(9).split("\n");
-		for(int index = 0; index < lines.length(); index++) {
-			// Multi-line
-			QString line = lines[index];
-			// Ignore lines that start with NOTE, or are <= 1 char long
-			if (!line.startsWith(QStringLiteral("NOTE")) &&
-				!line.isEmpty() && frame_number >= start_frame && frame_number <= end_frame && line.length() > 1) {
-
-				// Calculate fade in/out ranges
-				fade_in_percentage = ((float) frame_number - (float) start_frame) / fade_in_value;
-				fade_out_percentage = 1.0 - (((float) frame_number - ((float) end_frame - fade_out_value)) / fade_out_value);
-
-				// Loop through words, and find word-wrap boundaries
-				QStringList words = line.split(" ");
-
-				// Wrap languages which do not use spaces
-				bool use_spaces = true;
-				if (line.length() > 20 && words.length() == 1) {
-					words = line.split("");
-					use_spaces = false;
-				}
-				int words_remaining = words.length();
-				while (words_remaining > 0) {
-					bool words_displayed = false;
-					for(int word_index = words.length(); word_index > 0; word_index--) {
-						// Current matched caption string (from the beginning to the current word index)
-						QString fitting_line = words.mid(0, word_index).join(" ");
-
-						// Calculate size of text
-						QRectF textRect = metrics.boundingRect(caption_area, Qt::TextSingleLine, fitting_line);
-						if (textRect.width() <= caption_area.width()) {
-							// Location for text
-							QPoint p(left_margin_x, current_y);
-
-							// Create path and add text to it (for correct border and fill)
-							QPainterPath path1;
-							QString fitting_line;
-							if (use_spaces) {
-								fitting_line = words.mid(0, word_index).join(" ");
-							} else {
-								fitting_line = words.mid(0, word_index).join("");
-							}
-							path1.addText(p, font, fitting_line);
-							text_paths.push_back(path1);
-
-							// Update line (to remove words already drawn
-							words = words.mid(word_index, words.length());
-							words_remaining = words.length();
-							words_displayed = true;
-
-							// Increment y-coordinate of text (for next line) + padding
-							current_y += line_height;
-
-							// Detect max width (of widest text line)
-							if (path1.boundingRect().width() > max_text_width) {
-								max_text_width = path1.boundingRect().width();
-							}
-							// Detect top most y coordinate of text
-							if (path1.boundingRect().top() < top_y) {
-								top_y = path1.boundingRect().top();
-							}
-							// Detect bottom most y coordinate of text
-							if (path1.boundingRect().bottom() > bottom_y) {
-								bottom_y = path1.boundingRect().bottom();
-							}
-							break;
-						}
-					}
+		// Calculate fade in/out ranges
+		fade_in_percentage = ((float) frame_number - (float) start_frame) / fade_in_value;
+		fade_out_percentage = 1.0 - (((float) frame_number - ((float) end_frame - fade_out_value)) / fade_out_value);
 
-					if (!words_displayed) {
-						// Exit loop if no words displayed
-						words_remaining = 0;
-					}
-				}
+		visible_text.append(cue.lines);
+	}
 
-			}
+	// Get the shaped and wrapped text (usually the same layout as the previous frame)
+	std::shared_ptr<const CaptionLayout> text_layout = get_layout(visible_text, font_size_value, caption_area_width);
+
+	// Calculate caption area (based on top margin)
+	double metrics_line_spacing = text_layout->line_spacing;
+	double starting_y = (frame_image->height() * top_value) + metrics_line_spacing;
+	double current_y = starting_y;
+	double bottom_y = starting_y;
+	double top_y = starting_y;
+	double max_text_width = text_layout->max_text_width;
+	double line_height = metrics_line_spacing * line_spacing_value;
+
+	// Move each wrapped line into place (only the position is animated per frame)
+	std::vector<QPainterPath> text_paths;
+	text_paths.reserve(text_layout->paths.size());
+	for (size_t index = 0; index < text_layout->paths.size(); index++) {
+		// Location for text
+		QPoint p(left_margin_x, current_y);
+		text_paths.push_back(text_layout->paths[index].translated(p));
+
+		// Increment y-coordinate of text (for next line) + padding
+		current_y += line_height;
+
+		// Detect top most and bottom most y coordinate of text
+		QRectF text_bounds = text_layout->bounds[index].translated(p);
+		if (text_bounds.top() < top_y) {
+			top_y = text_bounds.top();
+		}
+		if (text_bounds.bottom() > bottom_y) {
+			bottom_y = text_bounds.bottom();
 		}
 	}
 
@@ -451,7 +492,7 @@ void Caption::SetJsonValue(const Json::Value root) {
 }
 
 // Get all properties for a specific frame
-std::string Caption::PropertiesJSON(int64_t requested_frame) const {
+Json::Value Caption::PropertiesJsonValue(int64_t requested_frame) const {
 
 	// Generate JSON properties list
 	Json::Value root = BasePropertiesJSON(requested_frame);
@@ -485,5 +526,5 @@ std::string Caption::PropertiesJSON(int64_t requested_frame) const {
 	root["caption_font"] = add_property_json("Font", 0.0, "font", font_name, NULL, -1, -1, false, requested_frame);
 
 	// Return formatted string
-	return root.toStyledString();
+	return root;
 }
@@ -18,7 +18,10 @@
 #include <vector>
 #include <QFont>
 #include <QFontMetrics>
+#include <QPainterPath>
+#include <QRectF>
 #include <QRegularExpression>
+#include <QStringList>
 #include "../Color.h"
 #include "../EffectBase.h"
 #include "../Json.h"
@@ -38,7 +41,32 @@ namespace openshot
 class Caption : public EffectBase
 {
 private:
-	std::vector<QRegularExpressionMatch> matchedCaptions; ///< RegEx to capture cues and text
+	/// A parsed caption (the time it is displayed, and its text)
+	struct CaptionCue
+	{
+		double start_time; ///< Start time (in seconds)
+		double end_time; ///< End time (in seconds)
+		QStringList lines; ///< The lines of text which can be displayed
+	};
+
+	/// The text of the visible captions (shaped, and wrapped to the caption area)
+	struct CaptionLayout
+	{
+		// Key
+		QStringList text; ///< The visible lines of text (before wrapping)
+		QString font_name;
+		int font_pixel_size;
+		double area_width;
+
+		QFont font;
+		double line_spacing; ///< The font's line spacing (before the line_spacing keyframe)
+		std::vector<QPainterPath> paths; ///< The outline of each wrapped line (at the origin)
+		std::vector<QRectF> bounds; ///< The bounding rect of each path
+		double max_text_width; ///< The width of the widest wrapped line
+	};
+
+	std::vector<CaptionCue> cues; ///< Captions parsed from the caption text
+	std::shared_ptr<const CaptionLayout> layout; ///< The last layout (re-used until the text or style changes)
 	std::string caption_text;    ///< Text of caption
 	QFontMetrics* metrics;       ///< Font metrics object
 	QFont* font; 			     ///< QFont object
@@ -50,6 +78,9 @@ private:
 	/// Process regex capture
 	void process_regex();
 
+	/// Get the layout of some lines of text (only shaped and wrapped again when the text, font or width changes)
+	std::shared_ptr<const CaptionLayout> get_layout(const QStringList& text, double font_size_value, double area_width);
+
 
 public:
 	Color color;		 ///< Color of caption text
@@ -108,7 +139,7 @@ public:
 
 	/// Get all properties for a specific frame (perfect for a UI to display the current state
 	/// of all properties at any time)
-	std::string PropertiesJSON(int64_t requested_frame) const override;
+	Json::Value PropertiesJsonValue(int64_t requested_frame) const override;
 };
 
 }  // namespace openshot
@@ -13,16 +13,19 @@
 
 #include "ChromaKey.h"
 #include "Exceptions.h"
+#include "PixelKernels.h"
 #if USE_BABL
 #include <babl/babl.h>
 #endif
+#include <algorithm>
+#include <mutex>
 #include <vector>
 #include <cmath>
 
 using namespace openshot;
 
 /// Blank constructor, useful when using Json to load the effect properties
-ChromaKey::ChromaKey() : fuzz(5.0), halo(0), method(CHROMAKEY_BASIC) {
+ChromaKey::ChromaKey() : fuzz(5.0), halo(0), method(CHROMAKEY_BASIC), distance_table_method(CHROMAKEY_BASIC) {
 	// Init default color
 	color = Color();
 
@@ -33,7 +36,7 @@ ChromaKey::ChromaKey() : fuzz(5.0), halo(0), method(CHROMAKEY_BASIC) {
 // Standard constructor, which takes an openshot::Color object, a 'fuzz' factor,
 // an optional halo distance and an optional keying method.
 ChromaKey::ChromaKey(Color color, Keyframe fuzz, Keyframe halo, ChromaKeyMethod method) :
-	color(color), fuzz(fuzz), halo(halo), method(method)
+	color(color), fuzz(fuzz), halo(halo), method(method), distance_table_method(CHROMAKEY_BASIC)
 {
 	// Init effect properties
 	init_effect_details();
@@ -53,6 +56,144 @@ void ChromaKey::init_effect_details()
 	info.has_video = true;
 }
 
+#if USE_BABL
+// Build the table of distances to a CIE Lab key color (CIEDE2000). The lightness part of the
+// distance only depends on L, and the other parts only depend on a,b, so the table holds
+// 256 lightness terms followed by 256 x 256 a,b terms (which are added before the square root).
+static std::vector<float> cie_distance_table(const unsigned char key[3])
+{
+	std::vector<float> table(256 + 256 * 256);
+
+	float KL = 1.0;
+	float KC = 1.0;
+	float KH = 1.0;
+	float pi = 4 * std::atan(1);
+
+	float L1 = ((float) key[0]) / 2.55;
+	float a1 = key[1] - 127;
+	float b1 = key[2] - 127;
+	float C1 = std::sqrt(a1 * a1 + b1 * b1);
+
+	for (int L = 0; L < 256; ++L)
+	{
+		float L2 = ((float) L) / 2.55;
+		float delta_L_prime = L2 - L1;
+		float L_bar = (L1 + L2) / 2;
+		float SL = 1 + 0.015 * std::pow(L_bar - 50, 2) / std::sqrt(20 + std::pow(L_bar - 50, 2));
+		table[L] = std::pow(delta_L_prime / KL / SL, 2);
+	}
+
+	for (int a = 0; a < 256; ++a)
+	{
+		for (int b = 0; b < 256; ++b)
+		{
+			int   a2 = a - 127;
+			int   b2 = b - 127;
+			float C2 = std::sqrt(a2 * a2 + b2 * b2);
+
+			float C_bar = (C1 + C2) / 2;
+
+			float a_prime_multiplier = 1 + 0.5 * (1 - std::sqrt(C_bar / (C_bar + 25)));
+			float a1_prime = a1 * a_prime_multiplier;
+			float a2_prime = a2 * a_prime_multiplier;
+
+			float C1_prime = std::sqrt(a1_prime * a1_prime + b1 * b1);
+			float C2_prime = std::sqrt(a2_prime * a2_prime + b2 * b2);
+			float C_prime_bar = (C1_prime + C2_prime) / 2;
+			float delta_C_prime = C2_prime - C1_prime;
+
+			float h1_prime = std::atan2(b1, a1_prime) * 180 / pi;
+			float h2_prime = std::atan2(b2, a2_prime) * 180 / pi;
+
+			float delta_h_prime = h2_prime - h1_prime;
+			double H_prime_bar = (C1_prime != 0 && C2_prime != 0) ? (h1_prime + h2_prime) / 2 : (h1_prime + h2_prime);
+
+			if (delta_h_prime < -180)
+			{
+				delta_h_prime += 360;
+				if (H_prime_bar < 180)
+					H_prime_bar += 180;
+				else
+					H_prime_bar -= 180;
+			}
+			else if (delta_h_prime > 180)
+			{
+				delta_h_prime -= 360;
+				if (H_prime_bar < 180)
+					H_prime_bar += 180;
+				else
+					H_prime_bar -= 180;
+			}
+
+			float delta_H_prime = 2 * std::sqrt(C1_prime * C2_prime) * std::sin(delta_h_prime * pi / 360);
+
+			float T = 1
+				- 0.17 * std::cos((H_prime_bar - 30) * pi / 180)
+				+ 0.24 * std::cos(H_prime_bar * pi / 90)
+				+ 0.32 * std::cos((3 * H_prime_bar + 6) * pi / 180)
+				- 0.20 * std::cos((4 * H_prime_bar - 64) * pi / 180);
+
+			float SC = 1 + 0.045 * C_prime_bar;
+			float SH = 1 + 0.015 * C_prime_bar * T;
+			float RT = -2 * std::sqrt(C_prime_bar / (C_prime_bar + 25)) * std::sin(pi / 3 * std::exp(-std::pow((H_prime_bar - 275) / 25, 2)));
+			table[256 + a * 256 + b] = std::pow(delta_C_prime / KC / SC, 2)
+				+ std::pow(delta_h_prime / KH / SH, 2)
+				+ RT * delta_C_prime / KC / SC * delta_H_prime / KH / SH;
+		}
+	}
+
+	return table;
+}
+
+// Build the table of distances to a Y'CbCr key color (the length of the Cb,Cr vector)
+static std::vector<float> ycbcr_distance_table(const unsigned char key[3])
+{
+	std::vector<float> table(256 * 256);
+	for (int cb = 0; cb < 256; ++cb)
+	{
+		for (int cr = 0; cr < 256; ++cr)
+		{
+			int db = cb - key[1];
+			int dr = cr - key[2];
+			table[cb * 256 + cr] = sqrt(db * db + dr * dr);
+		}
+	}
+	return table;
+}
+#endif
+
+// Get the table of distances to the key color (only built again when the key color or method changes)
+std::shared_ptr<const std::vector<float>> ChromaKey::get_distance_table(ChromaKeyMethod table_method, const unsigned char key[3])
+{
+	std::shared_ptr<const std::vector<float>> table;
+	#pragma omp critical (chromakey_table)
+	{
+		if (distance_table && distance_table_method == table_method &&
+			std::equal(key, key + 3, distance_table_key))
+			table = distance_table;
+	}
+	if (table)
+		return table;
+
+#if USE_BABL
+	// Build the table outside of the lock (other frames can use the previous table meanwhile)
+	if (table_method == CHROMAKEY_CIE_DISTANCE)
+		table = std::make_shared<const std::vector<float>>(cie_distance_table(key));
+	else
+		table = std::make_shared<const std::vector<float>>(ycbcr_distance_table(key));
+#else
+	table = std::make_shared<const std::vector<float>>();
+#endif
+
+	#pragma omp critical (chromakey_table)
+	{
+		distance_table = table;
+		distance_table_method = table_method;
+		std::copy(key, key + 3, distance_table_key);
+	}
+	return table;
+}
+
 // This method is required for all derived classes of EffectBase, and returns a
 // modified openshot::Frame object
 //
@@ -111,24 +252,20 @@ std::shared_ptr<openshot::Frame> ChromaKey::GetFrame(std::shared_ptr<openshot::F
 	int width = image->width();
 	int height = image->height();
 
-	int pixelcount = width * height;
+	int64_t pixelcount = int64_t(width) * height;
+	unsigned char *pixels = image->bits();
 
 #if USE_BABL
-	if (method > CHROMAKEY_BASIC && method <= CHROMAKEY_LAST_METHOD)
+	// Draft quality previews use basic keying (no color space conversion)
+	if (method > CHROMAKEY_BASIC && method <= CHROMAKEY_LAST_METHOD && !IsDraftQuality())
 	{
-		static bool need_init = true;
-
-		if (need_init)
-		{
-			babl_init();
-			need_init = false;
-		}
+		static std::once_flag need_init;
+		std::call_once(need_init, []() { babl_init(); });
 
 		Babl const *rgb = babl_format("R'G'B'A u8");
 		Babl const *format = 0;
 		Babl const *fish = 0;
-		std::vector<unsigned char> pixelbuf;
-		int rowwidth = 0;
+		int pixelsize = 0;
 
 		switch(method)
 		{
@@ -136,45 +273,40 @@ std::shared_ptr<openshot::Frame> ChromaKey::GetFrame(std::shared_ptr<openshot::F
 		case CHROMAKEY_HSV_S:
 		case CHROMAKEY_HSV_V:
 			format = babl_format("HSV float");
-			rowwidth = width * sizeof(float) * 3;
+			pixelsize = sizeof(float) * 3;
 			break;
 
 		case CHROMAKEY_HSL_S:
 		case CHROMAKEY_HSL_L:
 			format = babl_format("HSL float");
-			rowwidth = width * sizeof(float) * 3;
+			pixelsize = sizeof(float) * 3;
 			break;
 
 		case CHROMAKEY_CIE_LCH_L:
 		case CHROMAKEY_CIE_LCH_C:
 		case CHROMAKEY_CIE_LCH_H:
 			format = babl_format("CIE LCH(ab) float");
-			rowwidth = width * sizeof(float) * 3;
+			pixelsize = sizeof(float) * 3;
 			break;
 
 		case CHROMAKEY_CIE_DISTANCE:
 			format = babl_format("CIE Lab u8");
-			rowwidth = width * 3;
+			pixelsize = 3;
 			break;
 
 		case CHROMAKEY_YCBCR:
 			format = babl_format("Y'CbCr u8");
-			rowwidth = width * 3;
+			pixelsize = 3;
 			break;
 
 		case CHROMAKEY_BASIC:
 			break;
 		}
 
-		pixelbuf.resize(rowwidth * height);
-
 		if (rgb && format && (fish = babl_fish(rgb, format)) != 0)
 		{
-			int		idx = 0;
 			unsigned char	mask_in[4];
 			union { float f[4]; unsigned char u[4]; } mask;
-			float const *pf = (float *) pixelbuf.data();
-			unsigned char const *pc = pixelbuf.data();
 
 			mask_in[0] = mask_R;
 			mask_in[1] = mask_G;
@@ -182,332 +314,122 @@ std::shared_ptr<openshot::Frame> ChromaKey::GetFrame(std::shared_ptr<openshot::F
 			mask_in[3] = 255;
 			babl_process(fish, mask_in, &mask, 1);
 
-			if (0) //image->bytesPerLine() == width * 4)
-			{
-				// Because babl_process is expensive to call, but efficient
-				// with long sequences of pixels, attempt to convert the
-				// entire buffer at once if we can
-				babl_process(fish, image->bits(), pixelbuf.data(), pixelcount);
-			}
-			else
-			{
-				unsigned char *rowdata = pixelbuf.data();
+			// The fixed-key methods look up the distance of each converted color
+			std::shared_ptr<const std::vector<float>> table;
+			if (method == CHROMAKEY_YCBCR || method == CHROMAKEY_CIE_DISTANCE)
+				table = get_distance_table(method, mask.u);
 
-				for (int y = 0; y < height; ++y, rowdata += rowwidth)
-					babl_process(fish, image->scanLine(y), rowdata, width);
-			}
+			// Distance of each pixel to the key color
+			std::vector<float> distances(pixelcount);
+			float halo_distance = halothreshold;
 
-			switch(method)
+			// Convert and measure the rows in parallel. Because babl_process is expensive
+			// to call, but efficient with long sequences of pixels, each row is converted
+			// at once (into a buffer owned by the thread).
+			#pragma omp parallel
 			{
-			case CHROMAKEY_HSVL_H:
-				for (int y = 0; y < height; ++y)
-				{
-					unsigned char *pixel = image->scanLine(y);
-
-					for (int x = 0; x < width; ++x, pixel += 4, pf += 3)
-					{
-						float tmp = fabs(pf[0] - mask.f[0]);
-
-						if (tmp > 0.5)
-							tmp = 1.0 - tmp;
-						tmp *= 500;
-						if (tmp <= threshold)
-						{
-							pixel[0] = pixel[1] = pixel[2] = pixel[3] = 0;
-						}
-						else if (tmp <= threshold + halothreshold)
-						{
-							float alphamult = (tmp - threshold) / halothreshold;
-
-							pixel[0] *= alphamult;
-							pixel[1] *= alphamult;
-							pixel[2] *= alphamult;
-							pixel[3] *= alphamult;
-						}
-					}
-				}
-				break;
-
-			case CHROMAKEY_HSV_S:
-			case CHROMAKEY_HSL_S:
-				for (int y = 0; y < height; ++y)
-				{
-					unsigned char *pixel = image->scanLine(y);
-
-					for (int x = 0; x < width; ++x, pixel += 4, pf += 3)
-					{
-						float tmp = fabs(pf[1] - mask.f[1]) * 255;
-
-						if (tmp <= threshold)
-						{
-							pixel[0] = pixel[1] = pixel[2] = pixel[3] = 0;
-						}
-						else if (tmp <= threshold + halothreshold)
-						{
-							float alphamult = (tmp - threshold) / halothreshold;
-
-							pixel[0] *= alphamult;
-							pixel[1] *= alphamult;
-							pixel[2] *= alphamult;
-							pixel[3] *= alphamult;
-						}
-					}
-				}
-				break;
+				std::vector<unsigned char> pixelbuf(width * pixelsize);
+				float const *pf = (float *) pixelbuf.data();
+				unsigned char const *pc = pixelbuf.data();
 
-			case CHROMAKEY_HSV_V:
-			case CHROMAKEY_HSL_L:
+				#pragma omp for
 				for (int y = 0; y < height; ++y)
 				{
-					unsigned char *pixel = image->scanLine(y);
+					babl_process(fish, pixels + int64_t(y) * width * 4, pixelbuf.data(), width);
+					float *distance = distances.data() + int64_t(y) * width;
 
-					for (int x = 0; x < width; ++x, pixel += 4, pf += 3)
+					switch(method)
 					{
-						float tmp = fabs(pf[2] - mask.f[2]) * 255;
-
-						if (tmp <= threshold)
-						{
-							pixel[0] = pixel[1] = pixel[2] = pixel[3] = 0;
-						}
-						else if (tmp <= threshold + halothreshold)
+					case CHROMAKEY_HSVL_H:
+						#pragma omp simd
+						for (int x = 0; x < width; ++x)
 						{
-							float alphamult = (tmp - threshold) / halothreshold;
-
-							pixel[0] *= alphamult;
-							pixel[1] *= alphamult;
-							pixel[2] *= alphamult;
-							pixel[3] *= alphamult;
-						}
-					}
-				}
-				break;
-
-			case CHROMAKEY_YCBCR:
-				for (int y = 0; y < height; ++y)
-				{
-					unsigned char *pixel = image->scanLine(y);
-
-					for (int x = 0; x < width; ++x, pixel += 4, pc += 3)
-					{
-						int db = (int) pc[1] - mask.u[1];
-						int dr = (int) pc[2] - mask.u[2];
-						float tmp = sqrt(db * db + dr * dr);
+							float tmp = fabs(pf[x * 3] - mask.f[0]);
 
-						if (tmp <= threshold)
-						{
-							pixel[0] = pixel[1] = pixel[2] = pixel[3] = 0;
+							if (tmp > 0.5)
+								tmp = 1.0 - tmp;
+							distance[x] = tmp * 500;
 						}
-						else if (tmp <= threshold + halothreshold)
+						break;
+
+					case CHROMAKEY_HSV_S:
+					case CHROMAKEY_HSL_S:
+						#pragma omp simd
+						for (int x = 0; x < width; ++x)
+							distance[x] = fabs(pf[x * 3 + 1] - mask.f[1]) * 255;
+						break;
+
+					case CHROMAKEY_HSV_V:
+					case CHROMAKEY_HSL_L:
+						#pragma omp simd
+						for (int x = 0; x < width; ++x)
+							distance[x] = fabs(pf[x * 3 + 2] - mask.f[2]) * 255;
+						break;
+
+					case CHROMAKEY_YCBCR:
+						// Distance of the Cb,Cr vector (looked up in the key's table)
+						for (int x = 0; x < width; ++x)
+							distance[x] = (*table)[pc[x * 3 + 1] * 256 + pc[x * 3 + 2]];
+						break;
+
+					case CHROMAKEY_CIE_LCH_L:
+						#pragma omp simd
+						for (int x = 0; x < width; ++x)
+							distance[x] = fabs(pf[x * 3] - mask.f[0]);
+						break;
+
+					case CHROMAKEY_CIE_LCH_C:
+						#pragma omp simd
+						for (int x = 0; x < width; ++x)
+							distance[x] = fabs(pf[x * 3 + 1] - mask.f[1]);
+						break;
+
+					case CHROMAKEY_CIE_LCH_H:
+						#pragma omp simd
+						for (int x = 0; x < width; ++x)
 						{
-							float alphamult = (tmp - threshold) / halothreshold;
-
-							pixel[0] *= alphamult;
-							pixel[1] *= alphamult;
-							pixel[2] *= alphamult;
-							pixel[3] *= alphamult;
+							// Hues in LCH(ab) are an angle on a color wheel.
+							// We are tring to find the angular distance
+							// between the two angles. It can never be more
+							// than 180 degrees - if it is, there is a closer
+							// angle that can be calculated by going in the
+							// other diretion, which  can be found by
+							// subtracting the angle we have from 360.
+							float tmp = fabs(pf[x * 3 + 2] - mask.f[2]);
+
+							if (tmp > 180.0)
+								tmp = 360.0 - tmp;
+							distance[x] = tmp;
 						}
-					}
-				}
-				break;
-
-			case CHROMAKEY_CIE_LCH_L:
-				for (int y = 0; y < height; ++y)
-				{
-					unsigned char *pixel = image->scanLine(y);
+						break;
 
-					for (int x = 0; x < width; ++x, pixel += 4, pf += 3)
-					{
-						float tmp = fabs(pf[0] - mask.f[0]);
+					case CHROMAKEY_CIE_DISTANCE:
+						// The lightness and the a,b parts of the distance are looked up separately
+						for (int x = 0; x < width; ++x)
+							distance[x] = std::sqrt((*table)[pc[x * 3]] + (*table)[256 + pc[x * 3 + 1] * 256 + pc[x * 3 + 2]]);
+						break;
 
-						if (tmp <= threshold)
-						{
-							pixel[0] = pixel[1] = pixel[2] = pixel[3] = 0;
-						}
-						else if (tmp <= threshold + halothreshold)
-						{
-							float alphamult = (tmp - threshold) / halothreshold;
-
-							pixel[0] *= alphamult;
-							pixel[1] *= alphamult;
-							pixel[2] *= alphamult;
-							pixel[3] *= alphamult;
-						}
+					case CHROMAKEY_BASIC:
+						break;
 					}
 				}
-				break;
-
-			case CHROMAKEY_CIE_LCH_C:
-				for (int y = 0; y < height; ++y)
-				{
-					unsigned char *pixel = image->scanLine(y);
-
-					for (int x = 0; x < width; ++x, pixel += 4, pf += 3)
-					{
-						float tmp = fabs(pf[1] - mask.f[1]);
-
-						if (tmp <= threshold)
-						{
-							pixel[0] = pixel[1] = pixel[2] = pixel[3] = 0;
-						}
-						else if (tmp <= threshold + halothreshold)
-						{
-							float alphamult = (tmp - threshold) / halothreshold;
-
-							pixel[0] *= alphamult;
-							pixel[1] *= alphamult;
-							pixel[2] *= alphamult;
-							pixel[3] *= alphamult;
-						}
-					}
-				}
-				break;
-
-			case CHROMAKEY_CIE_LCH_H:
-				for (int y = 0; y < height; ++y)
-				{
-					unsigned char *pixel = image->scanLine(y);
-
-					for (int x = 0; x < width; ++x, pixel += 4, pf += 3)
-					{
-						// Hues in LCH(ab) are an angle on a color wheel.
-						// We are tring to find the angular distance
-						// between the two angles. It can never be more
-						// than 180 degrees - if it is, there is a closer
-						// angle that can be calculated by going in the
-						// other diretion, which  can be found by
-						// subtracting the angle we have from 360.
-						float tmp = fabs(pf[2] - mask.f[2]);
-
-						if (tmp > 180.0)
-							tmp = 360.0 - tmp;
-						if (tmp <= threshold)
-							pixel[0] = pixel[1] = pixel[2] = pixel[3] = 0;
-					}
-				}
-				break;
+			}
 
-			case CHROMAKEY_CIE_DISTANCE:
-				{
-					float KL = 1.0;
-					float KC = 1.0;
-					float KH = 1.0;
-					float pi = 4 * std::atan(1);
+			// The hue method has no halo
+			if (method == CHROMAKEY_CIE_LCH_H)
+				halo_distance = 0;
 
-					float L1 = ((float) mask.u[0]) / 2.55;
-					float a1 = mask.u[1] - 127;
-					float b1 = mask.u[2] - 127;
-					float C1 = std::sqrt(a1 * a1 + b1 * b1);
-
-					for (int y = 0; y < height; ++y)
-					{
-						unsigned char *pixel = image->scanLine(y);
-
-						for (int x = 0; x < width; ++x, pixel += 4, pc += 3)
-						{
-							float L2 = ((float) pc[0]) / 2.55;
-							int   a2 = pc[1] - 127;
-							int   b2 = pc[2] - 127;
-							float C2 = std::sqrt(a2 * a2 + b2 * b2);
-
-							float delta_L_prime = L2 - L1;
-							float L_bar = (L1 + L2) / 2;
-							float C_bar = (C1 + C2) / 2;
-
-							float a_prime_multiplier = 1 + 0.5 * (1 - std::sqrt(C_bar / (C_bar + 25)));
-							float a1_prime = a1 * a_prime_multiplier;
-							float a2_prime = a2 * a_prime_multiplier;
-
-							float C1_prime = std::sqrt(a1_prime * a1_prime + b1 * b1);
-							float C2_prime = std::sqrt(a2_prime * a2_prime + b2 * b2);
-							float C_prime_bar = (C1_prime + C2_prime) / 2;
-							float delta_C_prime = C2_prime - C1_prime;
-
-							float h1_prime = std::atan2(b1, a1_prime) * 180 / pi;
-							float h2_prime = std::atan2(b2, a2_prime) * 180 / pi;
-
-							float delta_h_prime = h2_prime - h1_prime;
-							double H_prime_bar = (C1_prime != 0 && C2_prime != 0) ? (h1_prime + h2_prime) / 2 : (h1_prime + h2_prime);
-
-							if (delta_h_prime < -180)
-							{
-								delta_h_prime += 360;
-								if (H_prime_bar < 180)
-									H_prime_bar += 180;
-								else
-									H_prime_bar -= 180;
-							}
-							else if (delta_h_prime > 180)
-							{
-								delta_h_prime -= 360;
-								if (H_prime_bar < 180)
-									H_prime_bar += 180;
-								else
-									H_prime_bar -= 180;
-							}
-
-							float delta_H_prime = 2 * std::sqrt(C1_prime * C2_prime) * std::sin(delta_h_prime * pi / 360);
-
-							float T = 1
-								- 0.17 * std::cos((H_prime_bar - 30) * pi / 180)
-								+ 0.24 * std::cos(H_prime_bar * pi / 90)
-								+ 0.32 * std::cos((3 * H_prime_bar + 6) * pi / 180)
-								- 0.20 * std::cos((4 * H_prime_bar - 64) * pi / 180);
-
-							float SL = 1 + 0.015 * std::pow(L_bar - 50, 2) / std::sqrt(20 + std::pow(L_bar - 50, 2));
-							float SC = 1 + 0.045 * C_prime_bar;
-							float SH = 1 + 0.015 * C_prime_bar * T;
-							float RT = -2 * std::sqrt(C_prime_bar / (C_prime_bar + 25)) * std::sin(pi / 3 * std::exp(-std::pow((H_prime_bar - 275) / 25, 2)));
-							float delta_E = std::sqrt(std::pow(delta_L_prime / KL / SL, 2)
-										+ std::pow(delta_C_prime / KC / SC, 2)
-										+ std::pow(delta_h_prime / KH / SH, 2)
-										+ RT * delta_C_prime / KC / SC * delta_H_prime / KH / SH);
-							if (delta_E <= threshold)
-							{
-								pixel[0] = pixel[1] = pixel[2] = pixel[3] = 0;
-							}
-							else if (delta_E <= threshold + halothreshold)
-							{
-								float alphamult = (delta_E - threshold) / halothreshold;
-
-								pixel[0] *= alphamult;
-								pixel[1] *= alphamult;
-								pixel[2] *= alphamult;
-								pixel[3] *= alphamult;
-							}
-						}
-					}
-				}
-				break;
-			}
+			// Make the matching pixels transparent
+			PixelKernels::ChromaKeyAlpha(pixels, distances.data(), pixelcount, threshold, halo_distance);
 
 			return frame;
 		}
 	}
 #endif
 
-	// Loop through pixels
-	for (int y = 0; y < height; ++y)
-	{
-		unsigned char * pixel = image->scanLine(y);
-
-		for (int x = 0; x < width; ++x, pixel += 4)
-		{
-			float A = pixel[3];
-			unsigned char R = (pixel[0] / A) * 255.0;
-			unsigned char G = (pixel[1] / A) * 255.0;
-			unsigned char B = (pixel[2] / A) * 255.0;
-
-			// Get distance between mask color and pixel color
-			long distance = Color::GetDistance((long)R, (long)G, (long)B, mask_R, mask_G, mask_B);
-
-			if (distance <= threshold) {
-				// MATCHED - Make pixel transparent
-				// Due to premultiplied alpha, we must also zero out
-				// the individual color channels (or else artifacts are left behind)
-				pixel[0] = pixel[1] = pixel[2] = pixel[3] = 0;
-			}
-		}
-	}
+	// Make the pixels which match the key color transparent (the distance of each un-premultiplied
+	// color is measured with Color::GetDistance)
+	PixelKernels::ChromaKey(pixels, pixelcount, mask_R, mask_G, mask_B, threshold);
 
 	// return the modified frame
 	return frame;
@@ -570,7 +492,7 @@ void ChromaKey::SetJsonValue(const Json::Value root) {
 }
 
 // Get all properties for a specific frame
-std::string ChromaKey::PropertiesJSON(int64_t requested_frame) const {
+Json::Value ChromaKey::PropertiesJsonValue(int64_t requested_frame) const {
 
 	// Generate JSON properties list
 	Json::Value root = BasePropertiesJSON(requested_frame);
@@ -596,5 +518,5 @@ std::string ChromaKey::PropertiesJSON(int64_t requested_frame) const {
 	root["keymethod"]["choices"].append(add_property_choice_json("Cb,Cr vector", 10, method));
 
 	// Return formatted string
-	return root.toStyledString();
+	return root;
 }
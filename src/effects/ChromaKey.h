@@ -23,6 +23,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace openshot
 {
@@ -41,9 +42,16 @@ namespace openshot
 		Keyframe halo;
 		ChromaKeyMethod method;
 
+		std::shared_ptr<const std::vector<float>> distance_table; ///< The distance of each converted color to the key color
+		ChromaKeyMethod distance_table_method; ///< The keying method of the distance table
+		unsigned char distance_table_key[3]; ///< The converted key color of the distance table
+
 		/// Init effect settings
 		void init_effect_details();
 
+		/// Get the distance table of a fixed-key method (CHROMAKEY_YCBCR or CHROMAKEY_CIE_DISTANCE)
+		std::shared_ptr<const std::vector<float>> get_distance_table(ChromaKeyMethod table_method, const unsigned char key[3]);
+
 	public:
 
 		/// Blank constructor, useful when using Json to load the effect properties
@@ -104,7 +112,7 @@ namespace openshot
 		void SetJsonValue(const Json::Value root) override; ///< Load Json::Value into this object
 
 		// Get all properties for a specific frame
-		std::string PropertiesJSON(int64_t requested_frame) const override;
+		Json::Value PropertiesJsonValue(int64_t requested_frame) const override;
 	};
 
 }
@@ -10,6 +10,8 @@
 //
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
+#include <algorithm>
+
 #include "ColorShift.h"
 #include "Exceptions.h"
 
@@ -77,93 +79,56 @@ std::shared_ptr<openshot::Frame> ColorShift::GetFrame(std::shared_ptr<openshot::
 	float alpha_y_shift = alpha_y.GetValue(frame_number);
 	int alpha_y_shift_limit = round(frame_image_height * fmod(fabs(alpha_y_shift), 1.0));
 
-	// Make temp copy of pixels
-	unsigned char *temp_image = new unsigned char[frame_image_width * frame_image_height * 4]();
-	memcpy(temp_image, pixels, sizeof(char) * frame_image_width * frame_image_height * 4);
-
-	// Init position of current row and pixel
-	int starting_row_index = 0;
-	int byte_index = 0;
-
-	// Init RGBA values
-	unsigned char R = 0;
-	unsigned char G = 0;
-	unsigned char B = 0;
-	unsigned char A = 0;
-
-	int red_starting_row_index = 0;
-	int green_starting_row_index = 0;
-	int blue_starting_row_index = 0;
-	int alpha_starting_row_index = 0;
-
-	int red_pixel_offset = 0;
-	int green_pixel_offset = 0;
-	int blue_pixel_offset = 0;
-	int alpha_pixel_offset = 0;
+	// Shift of each channel (in pixels), pixels shifted past an edge wrap around to the other side
+	const int x_shifts[4] = {
+		red_x_shift > 0.0 ? red_x_shift_limit : (red_x_shift < 0.0 ? -red_x_shift_limit : 0),
+		green_x_shift > 0.0 ? green_x_shift_limit : (green_x_shift < 0.0 ? -green_x_shift_limit : 0),
+		blue_x_shift > 0.0 ? blue_x_shift_limit : (blue_x_shift < 0.0 ? -blue_x_shift_limit : 0),
+		alpha_x_shift > 0.0 ? alpha_x_shift_limit : (alpha_x_shift < 0.0 ? -alpha_x_shift_limit : 0)
+	};
+	const int y_shifts[4] = {
+		red_y_shift > 0.0 ? red_y_shift_limit : (red_y_shift < 0.0 ? -red_y_shift_limit : 0),
+		green_y_shift > 0.0 ? green_y_shift_limit : (green_y_shift < 0.0 ? -green_y_shift_limit : 0),
+		blue_y_shift > 0.0 ? blue_y_shift_limit : (blue_y_shift < 0.0 ? -blue_y_shift_limit : 0),
+		alpha_y_shift > 0.0 ? alpha_y_shift_limit : (alpha_y_shift < 0.0 ? -alpha_y_shift_limit : 0)
+	};
+
+	// Make temp copy of pixels (and remove pre-multiplied alpha, since colors and alpha can be shifted apart)
+	const int pixel_count = frame_image_width * frame_image_height;
+	unsigned char *temp_image = new unsigned char[pixel_count * 4]();
+	#pragma omp parallel for
+	for (int pixel = 0; pixel < pixel_count; ++pixel) {
+		const int A = pixels[pixel * 4 + 3];
+		for (int channel = 0; channel < 3; channel++)
+			temp_image[pixel * 4 + channel] = A ? std::min(255, (pixels[pixel * 4 + channel] * 255 + A / 2) / A) : 0;
+		temp_image[pixel * 4 + 3] = A;
+	}
 
-	// Loop through rows of pixels
+	// Loop through rows of pixels (in parallel). Each channel of a pixel is copied from the
+	// source pixel it was shifted from, so every row can be written independently.
+	#pragma omp parallel for
 	for (int row = 0; row < frame_image_height; row++) {
+		for (int channel = 0; channel < 4; channel++) {
+			// Get the source row, and the source pixel of the first column (for this channel)
+			int source_row = ((row - y_shifts[channel]) % frame_image_height + frame_image_height) % frame_image_height;
+			int source_col = ((0 - x_shifts[channel]) % frame_image_width + frame_image_width) % frame_image_width;
+			const unsigned char *source = temp_image + (source_row * frame_image_width * 4) + channel;
+			unsigned char *destination = pixels + (row * frame_image_width * 4) + channel;
+
+			// Copy new values to this row
+			for (int col = 0; col < frame_image_width; col++) {
+				destination[col * 4] = source[source_col * 4];
+				if (++source_col == frame_image_width)
+					source_col = 0;
+			}
+		}
+
+		// Pre-multiply the (shifted) alpha back into the color channels
+		unsigned char *row_pixels = pixels + (row * frame_image_width * 4);
 		for (int col = 0; col < frame_image_width; col++) {
-			// Get position of current row and pixel
-			starting_row_index = row * frame_image_width * 4;
-			byte_index = starting_row_index + (col * 4);
-			red_starting_row_index = starting_row_index;
-			green_starting_row_index = starting_row_index;
-			blue_starting_row_index = starting_row_index;
-			alpha_starting_row_index = starting_row_index;
-
-			red_pixel_offset = col;
-			green_pixel_offset = col;
-			blue_pixel_offset = col;
-			alpha_pixel_offset = col;
-
-			// Get the RGBA value from each pixel (depending on offset)
-			R = temp_image[byte_index];
-			G = temp_image[byte_index + 1];
-			B = temp_image[byte_index + 2];
-			A = temp_image[byte_index + 3];
-
-			// Shift X
-			if (red_x_shift > 0.0)
-				red_pixel_offset = (col + red_x_shift_limit) % frame_image_width;
-			if (red_x_shift < 0.0)
-				red_pixel_offset = (frame_image_width + col - red_x_shift_limit) % frame_image_width;
-			if (green_x_shift > 0.0)
-				green_pixel_offset = (col + green_x_shift_limit) % frame_image_width;
-			if (green_x_shift < 0.0)
-				green_pixel_offset = (frame_image_width + col - green_x_shift_limit) % frame_image_width;
-			if (blue_x_shift > 0.0)
-				blue_pixel_offset = (col + blue_x_shift_limit) % frame_image_width;
-			if (blue_x_shift < 0.0)
-				blue_pixel_offset = (frame_image_width + col - blue_x_shift_limit) % frame_image_width;
-			if (alpha_x_shift > 0.0)
-				alpha_pixel_offset = (col + alpha_x_shift_limit) % frame_image_width;
-			if (alpha_x_shift < 0.0)
-				alpha_pixel_offset = (frame_image_width + col - alpha_x_shift_limit) % frame_image_width;
-
-			// Shift Y
-			if (red_y_shift > 0.0)
-				red_starting_row_index = ((row + red_y_shift_limit) % frame_image_height) * frame_image_width * 4;
-			if (red_y_shift < 0.0)
-				red_starting_row_index = ((frame_image_height + row - red_y_shift_limit) % frame_image_height) * frame_image_width * 4;
-			if (green_y_shift > 0.0)
-				green_starting_row_index = ((row + green_y_shift_limit) % frame_image_height) * frame_image_width * 4;
-			if (green_y_shift < 0.0)
-				green_starting_row_index = ((frame_image_height + row - green_y_shift_limit) % frame_image_height) * frame_image_width * 4;
-			if (blue_y_shift > 0.0)
-				blue_starting_row_index = ((row + blue_y_shift_limit) % frame_image_height) * frame_image_width * 4;
-			if (blue_y_shift < 0.0)
-				blue_starting_row_index = ((frame_image_height + row - blue_y_shift_limit) % frame_image_height) * frame_image_width * 4;
-			if (alpha_y_shift > 0.0)
-				alpha_starting_row_index = ((row + alpha_y_shift_limit) % frame_image_height) * frame_image_width * 4;
-			if (alpha_y_shift < 0.0)
-				alpha_starting_row_index = ((frame_image_height + row - alpha_y_shift_limit) % frame_image_height) * frame_image_width * 4;
-
-			// Copy new values to this pixel
-			pixels[red_starting_row_index + 0 + (red_pixel_offset * 4)] = R;
-			pixels[green_starting_row_index + 1 + (green_pixel_offset * 4)] = G;
-			pixels[blue_starting_row_index + 2 + (blue_pixel_offset * 4)] = B;
-			pixels[alpha_starting_row_index + 3 + (alpha_pixel_offset * 4)] = A;
+			const int A = row_pixels[col * 4 + 3];
+			for (int channel = 0; channel < 3; channel++)
+				row_pixels[col * 4 + channel] = (row_pixels[col * 4 + channel] * A + 127) / 255;
 		}
 	}
 
@@ -243,7 +208,7 @@ void ColorShift::SetJsonValue(const Json::Value root) {
 }
 
 // Get all properties for a specific frame
-std::string ColorShift::PropertiesJSON(int64_t requested_frame) const {
+Json::Value ColorShift::PropertiesJsonValue(int64_t requested_frame) const {
 
 	// Generate JSON properties list
 	Json::Value root = BasePropertiesJSON(requested_frame);
@@ -259,5 +224,5 @@ std::string ColorShift::PropertiesJSON(int64_t requested_frame) const {
 	root["alpha_y"] = add_property_json("Alpha Y Shift", alpha_y.GetValue(requested_frame), "float", "", &alpha_y, -1, 1, false, requested_frame);
 
 	// Return formatted string
-	return root.toStyledString();
+	return root;
 }
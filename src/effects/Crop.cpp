@@ -14,14 +14,23 @@
 #include "Exceptions.h"
 #include "KeyFrame.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
 #include <QImage>
-#include <QPainter>
 #include <QRectF>
 #include <QRect>
 #include <QSize>
 
 using namespace openshot;
 
+// Release the image a cropped image is a view of
+static void release_parent_image(void *info)
+{
+	delete static_cast<std::shared_ptr<QImage> *>(info);
+}
+
 /// Default constructor, useful when using Json to load the effect properties
 Crop::Crop() : Crop::Crop(0.0, 0.0, 0.0, 0.0, 0.0, 0.0) {}
 
@@ -96,19 +105,63 @@ std::shared_ptr<openshot::Frame> Crop::GetFrame(std::shared_ptr<openshot::Frame>
 		copy_r.setBottom(sz.height());
 	}
 
-	QImage cropped(sz, QImage::Format_RGBA8888_Premultiplied);
-	cropped.fill(Qt::transparent);
+	// Round the rectangles to whole pixels (the source and target have the same size)
+	const int source_x = std::max(0, int(round(copy_r.left())));
+	const int source_y = std::max(0, int(round(copy_r.top())));
+	const int target_x = std::max(0, int(round(paint_r.left())));
+	const int target_y = std::max(0, int(round(paint_r.top())));
+	int width = std::min(int(round(copy_r.right())) - source_x, int(round(paint_r.right())) - target_x);
+	int height = std::min(int(round(copy_r.bottom())) - source_y, int(round(paint_r.bottom())) - target_y);
+	width = std::min({width, sz.width() - source_x, sz.width() - target_x});
+	height = std::min({height, sz.height() - source_y, sz.height() - target_y});
+	if (width <= 0 || height <= 0) {
+		width = 0;
+		height = 0;
+	}
 
-	QPainter p(&cropped);
-	p.drawImage(paint_r, *frame_image, copy_r);
-	p.end();
+	unsigned char *pixels = frame_image->bits();
+	const int stride = frame_image->bytesPerLine();
+	const int bytes_per_pixel = 4;
 
 	if (resize) {
-		// Resize image to match cropped QRect (reduce frame size)
-		frame->AddImage(std::make_shared<QImage>(cropped.copy(paint_r.toRect())));
-	} else {
-		// Copy cropped image into transparent frame image (maintain frame size)
-		frame->AddImage(std::make_shared<QImage>(cropped.copy()));
+		// Use the cropped rectangle of the image as is (a view of the same pixels, which keeps the
+		// original image alive), to reduce the frame size without copying the pixels
+		if (width == 0) {
+			frame->AddImage(std::make_shared<QImage>());
+		} else {
+			auto *parent = new std::shared_ptr<QImage>(frame_image);
+			frame->AddImage(std::make_shared<QImage>(pixels + (source_y * stride) + (source_x * bytes_per_pixel),
+				width, height, stride, QImage::Format_RGBA8888_Premultiplied,
+				(QImageCleanupFunction) &release_parent_image, (void *) parent));
+		}
+		return frame;
+	}
+
+	// Move the source rectangle to the target rectangle (in place, in the order which never
+	// overwrites rows which are not moved yet)
+	if (width > 0 && (source_x != target_x || source_y != target_y)) {
+		const int row_bytes = width * bytes_per_pixel;
+		if (source_y >= target_y) {
+			for (int row = 0; row < height; row++)
+				memmove(pixels + ((target_y + row) * stride) + (target_x * bytes_per_pixel),
+						pixels + ((source_y + row) * stride) + (source_x * bytes_per_pixel), row_bytes);
+		} else {
+			for (int row = height - 1; row >= 0; row--)
+				memmove(pixels + ((target_y + row) * stride) + (target_x * bytes_per_pixel),
+						pixels + ((source_y + row) * stride) + (source_x * bytes_per_pixel), row_bytes);
+		}
+	}
+
+	// Clear everything outside of the target rectangle (to transparent)
+	#pragma omp parallel for
+	for (int row = 0; row < sz.height(); row++) {
+		unsigned char *line = pixels + (row * stride);
+		if (row < target_y || row >= target_y + height) {
+			memset(line, 0, sz.width() * bytes_per_pixel);
+		} else {
+			memset(line, 0, target_x * bytes_per_pixel);
+			memset(line + ((target_x + width) * bytes_per_pixel), 0, (sz.width() - target_x - width) * bytes_per_pixel);
+		}
 	}
 
 	// return the modified frame
@@ -181,7 +234,7 @@ void Crop::SetJsonValue(const Json::Value root) {
 }
 
 // Get all properties for a specific frame
-std::string Crop::PropertiesJSON(int64_t requested_frame) const {
+Json::Value Crop::PropertiesJsonValue(int64_t requested_frame) const {
 
 	// Generate JSON properties list
 	Json::Value root = BasePropertiesJSON(requested_frame);
@@ -200,5 +253,5 @@ std::string Crop::PropertiesJSON(int64_t requested_frame) const {
 	root["resize"]["choices"].append(add_property_choice_json("No", false, resize));
 
 	// Return formatted string
-	return root.toStyledString();
+	return root;
 }
@@ -12,9 +12,15 @@
 
 #include "Deinterlace.h"
 #include "Exceptions.h"
+#include "../Clip.h"
+
+#include <cstdlib>
 
 using namespace openshot;
 
+// The most a pixel (and the pixel above it) may change since the previous frame, to be kept as is
+static const int MOTION_THRESHOLD = 30;
+
 /// Blank constructor, useful when using Json to load the effect properties
 Deinterlace::Deinterlace() : isOdd(true)
 {
@@ -43,39 +49,89 @@ void Deinterlace::init_effect_details()
 	info.has_video = true;
 }
 
+// Get the image of the previous frame of the parent clip's reader (if it has the same size)
+std::shared_ptr<QImage> Deinterlace::previous_image(int64_t frame_number, int width, int height)
+{
+	Clip* clip = (Clip*) ParentClip();
+	if (!clip || !clip->Reader() || frame_number <= 1)
+		return nullptr;
+
+	std::shared_ptr<QImage> image = clip->Reader()->GetFrame(frame_number - 1)->GetImage();
+	if (!image || image->width() != width || image->height() != height)
+		return nullptr;
+	return image;
+}
+
 // This method is required for all derived classes of EffectBase, and returns a
 // modified openshot::Frame object
 std::shared_ptr<openshot::Frame> Deinterlace::GetFrame(std::shared_ptr<openshot::Frame> frame, int64_t frame_number)
 {
-	// Get original size of frame's image
-	int original_width = frame->GetImage()->width();
-	int original_height = frame->GetImage()->height();
-
 	// Get the frame's image
 	std::shared_ptr<QImage> image = frame->GetImage();
-	const unsigned char* pixels = image->bits();
-
-	// Create a smaller, new image
-	QImage deinterlaced_image(image->width(), image->height() / 2, QImage::Format_RGBA8888_Premultiplied);
-	const unsigned char* deinterlaced_pixels = deinterlaced_image.bits();
-
-	// Loop through the scanlines of the image (even or odd)
-	int start = 0;
-	if (isOdd)
-		start = 1;
-	for (int row = start; row < image->height(); row += 2) {
-		memcpy((unsigned char*)deinterlaced_pixels, pixels + (row * image->bytesPerLine()), image->bytesPerLine());
-		deinterlaced_pixels += image->bytesPerLine();
+	const int width = image->width();
+	const int height = image->height();
+	if (width <= 0 || height < 2)
+		return frame;
+	unsigned char* pixels = image->bits();
+	const int stride = image->bytesPerLine();
+
+	// The previous frame of the clip (to keep the lines of the other field where nothing moved)
+	std::shared_ptr<QImage> previous = previous_image(frame_number, width, height);
+	const unsigned char* previous_pixels = previous ? previous->constBits() : NULL;
+	const int previous_stride = previous ? previous->bytesPerLine() : 0;
+
+	// Replace the lines of the other field (even lines when keeping the odd lines). The kept lines are
+	// never modified, so each replaced line only depends on the original image (and lines are independent).
+	const int start = isOdd ? 0 : 1;
+	#pragma omp parallel for schedule(static)
+	for (int row = start; row < height; row += 2) {
+		// The first and last lines only have a line on one side
+		const int above_row = (row > 0) ? row - 1 : row + 1;
+		const int below_row = (row + 1 < height) ? row + 1 : row - 1;
+		unsigned char* line = pixels + (row * stride);
+		const unsigned char* above = pixels + (above_row * stride);
+		const unsigned char* below = pixels + (below_row * stride);
+		const unsigned char* previous_line = previous_pixels ? previous_pixels + (row * previous_stride) : NULL;
+		const unsigned char* previous_above = previous_pixels ? previous_pixels + (above_row * previous_stride) : NULL;
+
+		for (int x = 0; x < width; x++) {
+			unsigned char* pixel = line + (x * 4);
+
+			// Motion adaptive: keep the original pixel (weave), where the lines around it did not change
+			if (previous_line) {
+				const unsigned char* p = previous_line + (x * 4);
+				const unsigned char* a = above + (x * 4);
+				const unsigned char* pa = previous_above + (x * 4);
+				const int motion = abs(pixel[0] - p[0]) + abs(pixel[1] - p[1]) + abs(pixel[2] - p[2]) +
+								   abs(a[0] - pa[0]) + abs(a[1] - pa[1]) + abs(a[2] - pa[2]);
+				if (motion < MOTION_THRESHOLD)
+					continue;
+			}
+
+			// Edge directed interpolation: average the pixels above and below along the direction
+			// (vertical, or either diagonal) where they are the most alike
+			int direction = 0;
+			int best_difference = -1;
+			for (int d : {0, -1, 1}) {
+				if (x + d < 0 || x + d >= width || x - d < 0 || x - d >= width)
+					continue;
+				const unsigned char* a = above + ((x + d) * 4);
+				const unsigned char* b = below + ((x - d) * 4);
+				const int difference = abs(a[0] - b[0]) + abs(a[1] - b[1]) + abs(a[2] - b[2]);
+				if (best_difference < 0 || difference < best_difference) {
+					best_difference = difference;
+					direction = d;
+				}
+			}
+			const unsigned char* a = above + ((x + direction) * 4);
+			const unsigned char* b = below + ((x - direction) * 4);
+			pixel[0] = (a[0] + b[0] + 1) >> 1;
+			pixel[1] = (a[1] + b[1] + 1) >> 1;
+			pixel[2] = (a[2] + b[2] + 1) >> 1;
+			pixel[3] = (a[3] + b[3] + 1) >> 1;
+		}
 	}
 
-	// Resize deinterlaced image back to original size, and update frame's image
-	image = std::make_shared<QImage>(deinterlaced_image.scaled(
-		original_width, original_height,
-		Qt::IgnoreAspectRatio, Qt::FastTransformation));
-
-	// Update image on frame
-	frame->AddImage(image);
-
 	// return the modified frame
 	return frame;
 }
@@ -128,7 +184,7 @@ void Deinterlace::SetJsonValue(const Json::Value root) {
 }
 
 // Get all properties for a specific frame
-std::string Deinterlace::PropertiesJSON(int64_t requested_frame) const {
+Json::Value Deinterlace::PropertiesJsonValue(int64_t requested_frame) const {
 
 	// Generate JSON properties list
 	Json::Value root = BasePropertiesJSON(requested_frame);
@@ -139,5 +195,5 @@ std::string Deinterlace::PropertiesJSON(int64_t requested_frame) const {
 	root["isOdd"]["choices"].append(add_property_choice_json("No", false, isOdd));
 
 	// Return formatted string
-	return root.toStyledString();
+	return root;
 }
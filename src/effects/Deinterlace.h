@@ -25,11 +25,17 @@ namespace openshot
 {
 
 	/**
-	 * @brief This class uses the ImageMagick++ libraries, to de-interlace the image, which
-	 * removes the EVEN or ODD horizontal lines (which represent different points of time).
+	 * @brief This class de-interlaces the image, by replacing the EVEN or ODD horizontal lines
+	 * (which represent different points of time) with lines interpolated from the other field.
 	 *
 	 * This is most useful when converting video made for traditional TVs to computers,
 	 * which are not interlaced.
+	 *
+	 * Each replaced pixel is interpolated along the edge (vertical or diagonal) through it, so
+	 * the full vertical resolution is kept, and slanted edges are not jagged. When the effect
+	 * is on a clip, it is also motion adaptive: pixels which did not change since the previous
+	 * frame of the clip's reader are kept as they are. The image is modified in place (one
+	 * line per thread).
 	 */
 	class Deinterlace : public EffectBase
 	{
@@ -39,6 +45,9 @@ namespace openshot
 		/// Init effect settings
 		void init_effect_details();
 
+		/// Get the image of the previous frame of the parent clip's reader (if it has the same size)
+		std::shared_ptr<QImage> previous_image(int64_t frame_number, int width, int height);
+
 	public:
 
 		/// Default constructor, useful when using Json to load the effect properties
@@ -73,7 +82,7 @@ namespace openshot
 		void SetJsonValue(const Json::Value root) override; ///< Load Json::Value into this object
 
 		// Get all properties for a specific frame
-		std::string PropertiesJSON(int64_t requested_frame) const override;
+		Json::Value PropertiesJsonValue(int64_t requested_frame) const override;
 	};
 
 }
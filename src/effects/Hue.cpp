@@ -12,6 +12,7 @@
 
 #include "Hue.h"
 #include "Exceptions.h"
+#include "PixelKernels.h"
 
 using namespace openshot;
 
@@ -49,48 +50,34 @@ std::shared_ptr<openshot::Frame> Hue::GetFrame(std::shared_ptr<openshot::Frame>
 	// Get the frame's image
 	std::shared_ptr<QImage> frame_image = frame->GetImage();
 
-	int pixel_count = frame_image->width() * frame_image->height();
+	int64_t pixel_count = int64_t(frame_image->width()) * frame_image->height();
 
+	// Get the rotation matrix for this frame
+	PixelOperation operation;
+	GetPixelOperation(frame_number, operation);
+
+	// Multiply each color by the hue rotation matrix (the kernel removes, and re-applies, the pre-multiplied alpha)
+	unsigned char *pixels = (unsigned char *) frame_image->bits();
+	PixelKernels::Apply(pixels, pixel_count, { operation });
+
+	// return the modified frame
+	return frame;
+}
+
+// Get the hue rotation of a frame
+bool Hue::GetPixelOperation(int64_t frame_number, PixelOperation& operation)
+{
 	// Get the current hue percentage shift amount, and convert to degrees
 	double degrees = 360.0 * hue.GetValue(frame_number);
 	float cosA = cos(degrees*3.14159265f/180);
 	float sinA = sin(degrees*3.14159265f/180);
 
 	// Calculate a rotation matrix for the RGB colorspace (based on the current hue shift keyframe value)
-	float matrix[3] = {
-		cosA + (1.0f - cosA) / 3.0f,
-		1.0f/3.0f * (1.0f - cosA) - sqrtf(1.0f/3.0f) * sinA,
-		1.0f/3.0f * (1.0f - cosA) + sqrtf(1.0f/3.0f) * sinA
-	};
-
-	// Loop through pixels
-	unsigned char *pixels = (unsigned char *) frame_image->bits();
-
-	#pragma omp parallel for shared (pixels)
-	for (int pixel = 0; pixel < pixel_count; ++pixel)
-	{
-		// Calculate alpha % (to be used for removing pre-multiplied alpha value)
-		int A = pixels[pixel * 4 + 3];
-		float alpha_percent = A / 255.0;
-
-		// Get RGB values, and remove pre-multiplied alpha
-		int R = pixels[pixel * 4 + 0] / alpha_percent;
-		int G = pixels[pixel * 4 + 1] / alpha_percent;
-		int B = pixels[pixel * 4 + 2] / alpha_percent;
-
-		// Multiply each color by the hue rotation matrix
-		pixels[pixel * 4] = constrain(R * matrix[0] + G * matrix[1] + B * matrix[2]);
-		pixels[pixel * 4 + 1] = constrain(R * matrix[2] + G * matrix[0] + B * matrix[1]);
-		pixels[pixel * 4 + 2] = constrain(R * matrix[1] + G * matrix[2] + B * matrix[0]);
-
-		// Pre-multiply the alpha back into the color channels
-		pixels[pixel * 4 + 0] *= alpha_percent;
-		pixels[pixel * 4 + 1] *= alpha_percent;
-		pixels[pixel * 4 + 2] *= alpha_percent;
-	}
-
-	// return the modified frame
-	return frame;
+	operation.type = PixelOperation::HUE_ROTATE;
+	operation.values[0] = cosA + (1.0f - cosA) / 3.0f;
+	operation.values[1] = 1.0f/3.0f * (1.0f - cosA) - sqrtf(1.0f/3.0f) * sinA;
+	operation.values[2] = 1.0f/3.0f * (1.0f - cosA) + sqrtf(1.0f/3.0f) * sinA;
+	return true;
 }
 
 // Generate JSON string of this object
@@ -141,7 +128,7 @@ void Hue::SetJsonValue(const Json::Value root) {
 }
 
 // Get all properties for a specific frame
-std::string Hue::PropertiesJSON(int64_t requested_frame) const {
+Json::Value Hue::PropertiesJsonValue(int64_t requested_frame) const {
 
 	// Generate JSON properties list
 	Json::Value root = BasePropertiesJSON(requested_frame);
@@ -150,5 +137,5 @@ std::string Hue::PropertiesJSON(int64_t requested_frame) const {
 	root["hue"] = add_property_json("Hue", hue.GetValue(requested_frame), "float", "", &hue, 0.0, 1.0, false, requested_frame);
 
 	// Return formatted string
-	return root.toStyledString();
+	return root;
 }
@@ -0,0 +1,250 @@
+/**
+ * @file
+ * @brief Source file for LUT3D effect class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <cctype>
+#include <fstream>
+#include <sstream>
+
+#include "LUT3D.h"
+#include "Exceptions.h"
+#include "PixelKernels.h"
+
+using namespace openshot;
+
+// Largest supported LUT_3D_SIZE (the .cube specification allows up to 256)
+static const int MAX_LUT_SIZE = 256;
+
+/// Blank constructor, useful when using Json to load the effect properties
+LUT3D::LUT3D() : LUT3D("", 1.0) { }
+
+// Default constructor
+LUT3D::LUT3D(std::string path, Keyframe new_intensity) :
+		lut_path(path), needs_refresh(true), intensity(new_intensity)
+{
+	// Init effect properties
+	init_effect_details();
+}
+
+// Init effect settings
+void LUT3D::init_effect_details()
+{
+	/// Initialize the values of the EffectInfo struct.
+	InitEffectInfo();
+
+	/// Set the effect info
+	info.class_name = "LUT3D";
+	info.name = "3D LUT";
+	info.description = "Apply a color grading look-up table (.cube file) to the frame's image.";
+	info.has_audio = false;
+	info.has_video = true;
+}
+
+// Parse a .cube file
+std::shared_ptr<const LUT3D::LUTData> LUT3D::load_cube_file(const std::string& path)
+{
+	std::ifstream file(path);
+	if (!file.is_open())
+		throw InvalidFile("The LUT file could not be opened.", path);
+
+	auto data = std::make_shared<LUTData>();
+	data->size = 0;
+	for (int channel = 0; channel < 3; channel++) {
+		data->domain_min[channel] = 0.0;
+		data->domain_max[channel] = 1.0;
+	}
+
+	std::string line;
+	while (std::getline(file, line)) {
+		// Remove comments
+		const size_t comment = line.find('#');
+		if (comment != std::string::npos)
+			line.erase(comment);
+
+		std::istringstream fields(line);
+		fields.imbue(std::locale::classic());
+		std::string keyword;
+		if (!(fields >> keyword))
+			continue; // empty line
+
+		if (std::isalpha((unsigned char) keyword[0])) {
+			// Keyword lines
+			if (keyword == "LUT_3D_SIZE") {
+				if (!(fields >> data->size) || data->size < 2 || data->size > MAX_LUT_SIZE)
+					throw InvalidFormat("The LUT_3D_SIZE of the LUT file is invalid.", path);
+				data->table.reserve(int64_t(data->size) * data->size * data->size * 3);
+			} else if (keyword == "LUT_1D_SIZE") {
+				throw InvalidFormat("1D LUT files are not supported (only 3D LUT files).", path);
+			} else if (keyword == "DOMAIN_MIN") {
+				if (!(fields >> data->domain_min[0] >> data->domain_min[1] >> data->domain_min[2]))
+					throw InvalidFormat("The DOMAIN_MIN of the LUT file is invalid.", path);
+			} else if (keyword == "DOMAIN_MAX") {
+				if (!(fields >> data->domain_max[0] >> data->domain_max[1] >> data->domain_max[2]))
+					throw InvalidFormat("The DOMAIN_MAX of the LUT file is invalid.", path);
+			} else if (keyword == "LUT_3D_INPUT_RANGE") {
+				float range_min = 0.0, range_max = 1.0;
+				if (!(fields >> range_min >> range_max))
+					throw InvalidFormat("The LUT_3D_INPUT_RANGE of the LUT file is invalid.", path);
+				for (int channel = 0; channel < 3; channel++) {
+					data->domain_min[channel] = range_min;
+					data->domain_max[channel] = range_max;
+				}
+			}
+			// Other keywords (such as TITLE) are ignored
+			continue;
+		}
+
+		// Table entries (red, green and blue)
+		std::istringstream values(line);
+		values.imbue(std::locale::classic());
+		float R, G, B;
+		if (data->size == 0 || !(values >> R >> G >> B))
+			throw InvalidFormat("The LUT file contains an invalid table entry.", path);
+		data->table.push_back(R);
+		data->table.push_back(G);
+		data->table.push_back(B);
+	}
+
+	// Verify the table is complete
+	if (data->size == 0)
+		throw InvalidFormat("The LUT file has no LUT_3D_SIZE.", path);
+	if (int64_t(data->table.size()) != int64_t(data->size) * data->size * data->size * 3)
+		throw InvalidFormat("The LUT file does not contain LUT_3D_SIZE^3 table entries.", path);
+
+	return data;
+}
+
+// Set the path of the .cube file
+void LUT3D::LUTPath(std::string new_path)
+{
+	#pragma omp critical (load_lut)
+	{
+		if (new_path != lut_path) {
+			lut_path = new_path;
+			needs_refresh = true;
+		}
+	}
+}
+
+// This method is required for all derived classes of EffectBase, and returns a
+// modified openshot::Frame object
+std::shared_ptr<openshot::Frame> LUT3D::GetFrame(std::shared_ptr<openshot::Frame> frame, int64_t frame_number)
+{
+	// Get the cached lookup table (or the path of a new one)
+	std::shared_ptr<const LUTData> current_lut;
+	std::string current_path;
+	bool load = false;
+	#pragma omp critical (load_lut)
+	{
+		if (needs_refresh) {
+			lut.reset();
+			load = !lut_path.empty();
+			needs_refresh = load;
+			current_path = lut_path;
+		}
+		current_lut = lut;
+	}
+
+	// Load the lookup table (only once, it is then cached for all frames)
+	if (load) {
+		current_lut = load_cube_file(current_path);
+		#pragma omp critical (load_lut)
+		{
+			// Keep the table (unless the path changed while it was loading)
+			if (current_path == lut_path) {
+				lut = current_lut;
+				needs_refresh = false;
+			}
+		}
+	}
+
+	// No lookup table (bail on applying the LUT)
+	if (!current_lut)
+		return frame;
+
+	// Get the frame's image
+	std::shared_ptr<QImage> frame_image = frame->GetImage();
+
+	// Map all pixels (the kernel removes, and re-applies, the pre-multiplied alpha)
+	unsigned char *pixels = (unsigned char *) frame_image->bits();
+	int64_t pixel_count = int64_t(frame_image->width()) * frame_image->height();
+	PixelKernels::LUT3D(pixels, pixel_count, current_lut->table.data(), current_lut->size,
+						current_lut->domain_min, current_lut->domain_max, intensity.GetValue(frame_number));
+
+	// return the modified frame
+	return frame;
+}
+
+// Generate JSON string of this object
+std::string LUT3D::Json() const {
+
+	// Return formatted string
+	return JsonValue().toStyledString();
+}
+
+// Generate Json::Value for this object
+Json::Value LUT3D::JsonValue() const {
+
+	// Create root json object
+	Json::Value root = EffectBase::JsonValue(); // get parent properties
+	root["type"] = info.class_name;
+	root["lut_path"] = lut_path;
+	root["intensity"] = intensity.JsonValue();
+
+	// return JsonValue
+	return root;
+}
+
+// Load JSON string into this object
+void LUT3D::SetJson(const std::string value) {
+
+	// Parse JSON string into JSON objects
+	try
+	{
+		const Json::Value root = openshot::stringToJson(value);
+		// Set all values that match
+		SetJsonValue(root);
+	}
+	catch (const std::exception& e)
+	{
+		// Error parsing JSON (or missing keys)
+		throw InvalidJSON("JSON is invalid (missing keys or invalid data types)");
+	}
+}
+
+// Load Json::Value into this object
+void LUT3D::SetJsonValue(const Json::Value root) {
+
+	// Set parent data
+	EffectBase::SetJsonValue(root);
+
+	// Set data from Json (if key is found)
+	if (!root["lut_path"].isNull())
+		LUTPath(root["lut_path"].asString());
+	if (!root["intensity"].isNull())
+		intensity.SetJsonValue(root["intensity"]);
+}
+
+// Get all properties for a specific frame
+Json::Value LUT3D::PropertiesJsonValue(int64_t requested_frame) const {
+
+	// Generate JSON properties list
+	Json::Value root = BasePropertiesJSON(requested_frame);
+
+	// LUT file
+	root["lut_path"] = add_property_json("LUT File", 0.0, "string", lut_path, NULL, -1, -1, false, requested_frame);
+
+	// Keyframes
+	root["intensity"] = add_property_json("Intensity", intensity.GetValue(requested_frame), "float", "", &intensity, 0.0, 1.0, false, requested_frame);
+
+	// Return formatted string
+	return root;
+}
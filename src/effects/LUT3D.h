@@ -0,0 +1,114 @@
+/**
+ * @file
+ * @brief Header file for LUT3D effect class
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#ifndef OPENSHOT_LUT3D_EFFECT_H
+#define OPENSHOT_LUT3D_EFFECT_H
+
+#include "../EffectBase.h"
+
+#include "../Frame.h"
+#include "../Json.h"
+#include "../KeyFrame.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace openshot
+{
+
+	/**
+	 * @brief This class applies a 3D color lookup table (loaded from a .cube file) to any frame.
+	 *
+	 * A 3D LUT maps every input color to an output color, which makes it a cheap way to apply a color
+	 * grade (or to convert between color spaces). The .cube file is parsed once, and then cached for all
+	 * frames (until the path changes). Colors between the entries of the table are interpolated with a
+	 * vectorized trilinear lookup.
+	 *
+	 * \code
+	 * // Apply a film look to a clip, at 75% intensity
+	 * LUT3D lut("/home/user/luts/film.cube", Keyframe(0.75));
+	 * clip.AddEffect(&lut);
+	 * \endcode
+	 */
+	class LUT3D : public EffectBase
+	{
+	private:
+		/// A parsed lookup table (shared with the threads which are using it, when the path changes)
+		struct LUTData {
+			std::vector<float> table; ///< The RGB entries (red changes fastest)
+			int size; ///< The number of entries along each axis
+			float domain_min[3]; ///< The input color mapped to the first entry of each axis
+			float domain_max[3]; ///< The input color mapped to the last entry of each axis
+		};
+
+		std::string lut_path; ///< The path of the .cube file
+		std::shared_ptr<const LUTData> lut; ///< The cached lookup table
+		bool needs_refresh; ///< The path has changed (and the table needs to be loaded again)
+
+		/// Init effect settings
+		void init_effect_details();
+
+		/// Parse a .cube file
+		static std::shared_ptr<const LUTData> load_cube_file(const std::string& path);
+
+	public:
+		Keyframe intensity;	///< The mix between the original (0.0) and the mapped (1.0) colors
+
+		/// Blank constructor, useful when using Json to load the effect properties
+		LUT3D();
+
+		/// Default constructor, which takes the path of a .cube file and an intensity curve
+		///
+		/// @param path The path of a .cube file (with a LUT_3D_SIZE)
+		/// @param new_intensity The curve to adjust the intensity of the color mapping (between 0 and 1)
+		LUT3D(std::string path, Keyframe new_intensity);
+
+		/// @brief This method is required for all derived classes of ClipBase, and returns a
+		/// new openshot::Frame object. All Clip keyframes and effects are resolved into
+		/// pixels.
+		///
+		/// @returns A new openshot::Frame object
+		/// @param frame_number The frame number (starting at 1) of the clip or effect on the timeline.
+		std::shared_ptr<openshot::Frame> GetFrame(int64_t frame_number) override { return GetFrame(std::make_shared<openshot::Frame>(), frame_number); }
+
+		/// @brief This method is required for all derived classes of ClipBase, and returns a
+		/// modified openshot::Frame object
+		///
+		/// The frame object is passed into this method and used as a starting point (pixels and audio).
+		/// All Clip keyframes and effects are resolved into pixels.
+		///
+		/// @returns The modified openshot::Frame object
+		/// @param frame The frame object that needs the clip or effect applied to it
+		/// @param frame_number The frame number (starting at 1) of the clip or effect on the timeline.
+		std::shared_ptr<openshot::Frame> GetFrame(std::shared_ptr<openshot::Frame> frame, int64_t frame_number) override;
+
+		/// Get the path of the .cube file
+		std::string LUTPath() const { return lut_path; };
+
+		/// Set the path of the .cube file (which is loaded the next time a frame is requested)
+		void LUTPath(std::string new_path);
+
+		// Get and Set JSON methods
+		std::string Json() const override; ///< Generate JSON string of this object
+		void SetJson(const std::string value) override; ///< Load JSON string into this object
+		Json::Value JsonValue() const override; ///< Generate Json::Value for this object
+		void SetJsonValue(const Json::Value root) override; ///< Load Json::Value into this object
+
+		/// Get all properties for a specific frame (perfect for a UI to display the current state
+		/// of all properties at any time)
+		Json::Value PropertiesJsonValue(int64_t requested_frame) const override;
+	};
+
+}
+
+#endif
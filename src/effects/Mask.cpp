@@ -10,13 +10,18 @@
 //
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
+#include <algorithm>
+
 #include "Mask.h"
 
 #include "Exceptions.h"
+#include "MaskCache.h"
+#include "PixelKernels.h"
 
 #include "ReaderBase.h"
 #include "ChunkReader.h"
 #include "FFmpegReader.h"
+#include "ImageSequenceReader.h"
 #include "QtImageReader.h"
 
 #ifdef USE_IMAGEMAGICK
@@ -26,14 +31,14 @@
 using namespace openshot;
 
 /// Blank constructor, useful when using Json to load the effect properties
-Mask::Mask() : reader(NULL), replace_image(false), needs_refresh(true) {
+Mask::Mask() : reader(NULL), mask_plane_frame(0), needs_refresh(true), replace_image(false) {
 	// Init effect properties
 	init_effect_details();
 }
 
 // Default constructor
 Mask::Mask(ReaderBase *mask_reader, Keyframe mask_brightness, Keyframe mask_contrast) :
-		reader(mask_reader), brightness(mask_brightness), contrast(mask_contrast), replace_image(false), needs_refresh(true)
+		reader(mask_reader), mask_plane_frame(0), needs_refresh(true), replace_image(false), brightness(mask_brightness), contrast(mask_contrast)
 {
 	// Init effect properties
 	init_effect_details();
@@ -70,74 +75,58 @@ std::shared_ptr<openshot::Frame> Mask::GetFrame(std::shared_ptr<openshot::Frame>
 	if (!reader)
 		return frame;
 
-	// Get mask image (if missing or different size than frame image)
+	// Get mask plane (if missing, different frame, or different size than frame image)
+	std::shared_ptr<const MaskPlane> plane;
 	#pragma omp critical (open_mask_reader)
 	{
-		if (!original_mask || !reader->info.has_single_image || needs_refresh ||
-			(original_mask && original_mask->size() != frame_image->size())) {
-
-			// Only get mask if needed
-			auto mask_without_sizing = std::make_shared<QImage>(
-				*reader->GetFrame(frame_number)->GetImage());
-
-			// Resize mask image to match frame size
-			original_mask = std::make_shared<QImage>(
-				mask_without_sizing->scaled(
-					frame_image->width(), frame_image->height(),
-					Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+		// A still image uses the same mask for every frame
+		const int64_t mask_frame_number = reader->info.has_single_image ? 1 : frame_number;
+
+		if (needs_refresh) {
+			// The reader has changed (so it has a new identity in the cache)
+			mask_key = reader->Json();
+			mask_plane.reset();
+			needs_refresh = false;
+		}
+
+		if (!mask_plane || mask_plane_frame != mask_frame_number ||
+			mask_plane->width != frame_image->width() || mask_plane->height != frame_image->height()) {
+
+			// Look for this mask in the shared cache (other Mask effects may have scaled it already)
+			mask_plane = MaskCache::Instance()->GetPlane(mask_key, mask_frame_number, frame_image->width(), frame_image->height());
+			if (!mask_plane) {
+				// Only get (and scale) mask if needed
+				mask_plane = MaskCache::CreatePlane(*reader->GetFrame(frame_number)->GetImage(),
+													frame_image->width(), frame_image->height());
+				MaskCache::Instance()->Add(mask_key, mask_frame_number, mask_plane);
+			}
+			mask_plane_frame = mask_frame_number;
 		}
-	}
 
-	// Refresh no longer needed
-	needs_refresh = false;
+		// Keep this mask (even if another thread replaces it)
+		plane = mask_plane;
+	}
 
 	// Get pixel arrays
 	unsigned char *pixels = (unsigned char *) frame_image->bits();
-	unsigned char *mask_pixels = (unsigned char *) original_mask->bits();
+	int64_t pixel_count = std::min(int64_t(plane->width) * plane->height,
+								   int64_t(frame_image->width()) * frame_image->height());
 
 	double contrast_value = (contrast.GetValue(frame_number));
 	double brightness_value = (brightness.GetValue(frame_number));
 
-	// Loop through mask pixels, and apply average gray value to frame alpha channel
-	for (int pixel = 0, byte_index=0; pixel < original_mask->width() * original_mask->height(); pixel++, byte_index+=4)
-	{
-		// Get the RGB values from the pixel
-		int R = mask_pixels[byte_index];
-		int G = mask_pixels[byte_index + 1];
-		int B = mask_pixels[byte_index + 2];
-		int A = mask_pixels[byte_index + 3];
-
-		// Get the average luminosity
-		int gray_value = qGray(R, G, B);
-
-		// Adjust the brightness
+	// Adjust the brightness and contrast of each possible gray value (only once per frame)
+	float factor = (20 / std::fmax(0.00001, 20.0 - contrast_value));
+	int gray_table[256];
+	for (int gray = 0; gray < 256; gray++) {
+		int gray_value = gray;
 		gray_value += (255 * brightness_value);
-
-		// Adjust the contrast
-		float factor = (20 / std::fmax(0.00001, 20.0 - contrast_value));
-		gray_value = (factor * (gray_value - 128) + 128);
-
-		// Calculate the % change in alpha
-		float alpha_percent = float(constrain(A - gray_value)) / 255.0;
-
-		// Set the alpha channel to the gray value
-		if (replace_image) {
-			// Replace frame pixels with gray value (including alpha channel)
-			pixels[byte_index + 0] = constrain(255 * alpha_percent);
-			pixels[byte_index + 1] = constrain(255 * alpha_percent);
-			pixels[byte_index + 2] = constrain(255 * alpha_percent);
-			pixels[byte_index + 3] = constrain(255 * alpha_percent);
-		} else {
-			// Multiply new alpha value with all the colors (since we are using a premultiplied
-			// alpha format)
-			pixels[byte_index + 0] *= alpha_percent;
-			pixels[byte_index + 1] *= alpha_percent;
-			pixels[byte_index + 2] *= alpha_percent;
-			pixels[byte_index + 3] *= alpha_percent;
-		}
-
+		gray_table[gray] = (factor * (gray_value - 128) + 128);
 	}
 
+	// Apply the mask's gray values to the frame's alpha channel (in parallel)
+	PixelKernels::Mask(pixels, plane->gray.data(), plane->alpha.data(), pixel_count, gray_table, replace_image);
+
 	// return the modified frame
 	return frame;
 }
@@ -237,6 +226,12 @@ void Mask::SetJsonValue(const Json::Value root) {
 					reader = new QtImageReader(root["reader"]["path"].asString());
 					reader->SetJsonValue(root["reader"]);
 
+				} else if (type == "ImageSequenceReader") {
+
+					// Create new reader
+					reader = new ImageSequenceReader(root["reader"]["path"].asString());
+					reader->SetJsonValue(root["reader"]);
+
 				} else if (type == "ChunkReader") {
 
 					// Create new reader
@@ -252,7 +247,7 @@ void Mask::SetJsonValue(const Json::Value root) {
 }
 
 // Get all properties for a specific frame
-std::string Mask::PropertiesJSON(int64_t requested_frame) const {
+Json::Value Mask::PropertiesJsonValue(int64_t requested_frame) const {
 
 	// Generate JSON properties list
 	Json::Value root = BasePropertiesJSON(requested_frame);
@@ -272,5 +267,5 @@ std::string Mask::PropertiesJSON(int64_t requested_frame) const {
 		root["reader"] = add_property_json("Source", 0.0, "reader", "{}", NULL, 0, 1, false, requested_frame);
 
 	// Return formatted string
-	return root.toStyledString();
+	return root;
 }
@@ -25,6 +25,7 @@ namespace openshot
 {
 	// Forward declaration
 	class ReaderBase;
+	struct MaskPlane;
 
 	/**
 	 * @brief This class uses the image libraries to apply alpha (or transparency) masks
@@ -37,7 +38,9 @@ namespace openshot
 	{
 	private:
 		ReaderBase *reader;
-		std::shared_ptr<QImage> original_mask;
+		std::shared_ptr<const MaskPlane> mask_plane; ///< The scaled mask of the last frame (see openshot::MaskCache)
+		int64_t mask_plane_frame; ///< The mask frame number of mask_plane
+		std::string mask_key; ///< The identity of the mask in the openshot::MaskCache (the reader JSON)
 		bool needs_refresh;
 
 		/// Init effect settings
@@ -87,13 +90,13 @@ namespace openshot
 
 		/// Get all properties for a specific frame (perfect for a UI to display the current state
 		/// of all properties at any time)
-		std::string PropertiesJSON(int64_t requested_frame) const override;
+		Json::Value PropertiesJsonValue(int64_t requested_frame) const override;
 
 		/// Get the reader object of the mask grayscale image
 		ReaderBase* Reader() { return reader; };
 
 		/// Set a new reader to be used by the mask effect (grayscale image)
-		void Reader(ReaderBase *new_reader) { reader = new_reader; };
+		void Reader(ReaderBase *new_reader) { reader = new_reader; needs_refresh = true; };
 	};
 
 }
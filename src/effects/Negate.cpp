@@ -12,6 +12,7 @@
 
 #include "Negate.h"
 #include "Exceptions.h"
+#include "PixelKernels.h"
 
 using namespace openshot;
 
@@ -33,13 +34,24 @@ Negate::Negate()
 // modified openshot::Frame object
 std::shared_ptr<openshot::Frame> Negate::GetFrame(std::shared_ptr<openshot::Frame> frame, int64_t frame_number)
 {
-	// Make a negative of the images pixels
-	frame->GetImage()->invertPixels();
+	// Get the frame's image
+	std::shared_ptr<QImage> frame_image = frame->GetImage();
+
+	// Make a negative of the images pixels (in parallel, without converting from pre-multiplied alpha)
+	unsigned char *pixels = (unsigned char *) frame_image->bits();
+	PixelKernels::Negate(pixels, int64_t(frame_image->width()) * frame_image->height());
 
 	// return the modified frame
 	return frame;
 }
 
+// Get the color inversion
+bool Negate::GetPixelOperation(int64_t frame_number, PixelOperation& operation)
+{
+	operation.type = PixelOperation::NEGATE;
+	return true;
+}
+
 // Generate JSON string of this object
 std::string Negate::Json() const {
 
@@ -84,11 +96,11 @@ void Negate::SetJsonValue(const Json::Value root) {
 }
 
 // Get all properties for a specific frame
-std::string Negate::PropertiesJSON(int64_t requested_frame) const {
+Json::Value Negate::PropertiesJsonValue(int64_t requested_frame) const {
 
 	// Generate JSON properties list
 	Json::Value root = BasePropertiesJSON(requested_frame);
 
 	// Return formatted string
-	return root.toStyledString();
+	return root;
 }
@@ -57,6 +57,9 @@ namespace openshot
 		/// @param frame_number The frame number (starting at 1) of the clip or effect on the timeline.
 		std::shared_ptr<openshot::Frame> GetFrame(std::shared_ptr<openshot::Frame> frame, int64_t frame_number) override;
 
+		/// Get the color inversion (so it can be fused with other effects)
+		bool GetPixelOperation(int64_t frame_number, openshot::PixelOperation& operation) override;
+
 		// Get and Set JSON methods
 		std::string Json() const override; ///< Generate JSON string of this object
 		void SetJson(const std::string value) override; ///< Load JSON string into this object
@@ -64,7 +67,7 @@ namespace openshot
 		void SetJsonValue(const Json::Value root) override; ///< Load Json::Value into this object
 
 		// Get all properties for a specific frame
-		std::string PropertiesJSON(int64_t requested_frame) const override;
+		Json::Value PropertiesJsonValue(int64_t requested_frame) const override;
 	};
 
 }
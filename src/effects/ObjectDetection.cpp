@@ -17,6 +17,7 @@
 #include "effects/ObjectDetection.h"
 #include "effects/Tracker.h"
 #include "Exceptions.h"
+#include "ProtobufFrameIndex.h"
 #include "Timeline.h"
 #include "objdetectdata.pb.h"
 
@@ -69,8 +70,8 @@ void ObjectDetection::init_effect_details()
 // modified openshot::Frame object
 std::shared_ptr<Frame> ObjectDetection::GetFrame(std::shared_ptr<Frame> frame, int64_t frame_number)
 {
-	// Get the frame's image
-	cv::Mat cv_image = frame->GetImageCV();
+	// Get the frame's image (the boxes are drawn straight onto the frame's RGBA pixels)
+	cv::Mat cv_image = frame->GetImageViewCV();
 
 	// Check if frame isn't NULL
 	if(cv_image.empty()){
@@ -83,11 +84,11 @@ std::shared_ptr<Frame> ObjectDetection::GetFrame(std::shared_ptr<Frame> frame, i
 	std::vector<std::shared_ptr<QImage>> childClipImages;
 
 	// Check if track data exists for the requested frame
-	if (detectionsData.find(frame_number) != detectionsData.end()) {
+	DetectionData detections;
+	if (GetDetectionData(frame_number, detections)) {
 		float fw = cv_image.size().width;
 		float fh = cv_image.size().height;
 
-		DetectionData detections = detectionsData[frame_number];
 		for(int i = 0; i<detections.boxes.size(); i++){
 
 			// Does not show boxes with confidence below the threshold
@@ -169,9 +170,6 @@ std::shared_ptr<Frame> ObjectDetection::GetFrame(std::shared_ptr<Frame> frame, i
 		}
 	}
 
-	// Update Qt image with new Opencv frame
-	frame->SetImageCV(cv_image);
-
 	// Set the bounding-box image with the Tracked Object's child clip image
 	if(boxRects.size() > 0){
 		// Get the frame image
@@ -195,102 +193,113 @@ void ObjectDetection::DrawRectangleRGBA(cv::Mat &frame_image, cv::RotatedRect bo
 	cv::Point2f vertices2f[4];
 	box.points(vertices2f);
 
-	// TODO: take a rectangle of frame_image by refencence and draw on top of that to improve speed
-	// select min enclosing rectangle to draw on a small portion of the image
-	// cv::Rect rect  = box.boundingRect();
-	// cv::Mat image = frame_image(rect)
+	// Only draw on (and blend) the part of the frame image the box covers
+	const int padding = std::max(thickness, 1) + 1;
+	cv::Rect rect = box.boundingRect();
+	rect = cv::Rect(rect.x - padding, rect.y - padding, rect.width + 2 * padding, rect.height + 2 * padding)
+		& cv::Rect(0, 0, frame_image.cols, frame_image.rows);
+	if (rect.empty())
+		return;
+	cv::Mat image = frame_image(rect);
+	for (int i = 0; i < 4; ++i)
+		vertices2f[i] -= cv::Point2f(rect.x, rect.y);
+
+	// The frame image is RGBA
+	const cv::Scalar rgba(color[0], color[1], color[2], 255);
+	cv::Mat overlayFrame = image.clone();
 
 	if(is_background){
-		cv::Mat overlayFrame;
-		frame_image.copyTo(overlayFrame);
-
 		// draw bounding box background
 		cv::Point vertices[4];
 		for(int i = 0; i < 4; ++i){
 			vertices[i] = vertices2f[i];}
 
-		cv::Rect rect  = box.boundingRect();
-		cv::fillConvexPoly(overlayFrame, vertices, 4, cv::Scalar(color[2],color[1],color[0]), cv::LINE_AA);
-		// add opacity
-		cv::addWeighted(overlayFrame, 1-alpha, frame_image, alpha, 0, frame_image);
+		cv::fillConvexPoly(overlayFrame, vertices, 4, rgba, cv::LINE_AA);
 	}
 	else{
-		cv::Mat overlayFrame;
-		frame_image.copyTo(overlayFrame);
-
 		// Draw bounding box
 		for (int i = 0; i < 4; i++)
 		{
-			cv::line(overlayFrame, vertices2f[i], vertices2f[(i+1)%4], cv::Scalar(color[2],color[1],color[0]),
-						thickness, cv::LINE_AA);
+			cv::line(overlayFrame, vertices2f[i], vertices2f[(i+1)%4], rgba, thickness, cv::LINE_AA);
 		}
-
-		// add opacity
-		cv::addWeighted(overlayFrame, 1-alpha, frame_image, alpha, 0, frame_image);
 	}
+
+	// add opacity
+	cv::addWeighted(overlayFrame, 1-alpha, image, alpha, 0, image);
 }
 
 void ObjectDetection::drawPred(int classId, float conf, cv::Rect2d box, cv::Mat& frame, int objectNumber, std::vector<int> color,
 								float alpha, int thickness, bool is_background, bool display_text)
 {
+	// The frame image is RGBA
+	const cv::Scalar rgba(color[0], color[1], color[2], 255);
+
+	//Get the label for the class name and its confidence
+	std::string label;
+	int baseLine = 0;
+	cv::Size labelSize;
+	cv::Rect labelRect;
+	if(!is_background && display_text){
+		label = cv::format("%.2f", conf);
+		if (!classNames.empty())
+		{
+			CV_Assert(classId < (int)classNames.size());
+			label = classNames[classId] + ":" + label;
+		}
 
-	if(is_background){
-		cv::Mat overlayFrame;
-		frame.copyTo(overlayFrame);
+		//Display the label at the top of the bounding box
+		labelSize = cv::getTextSize(label, cv::FONT_HERSHEY_SIMPLEX, 0.5, 1, &baseLine);
 
-		//Draw a rectangle displaying the bounding box
-		cv::rectangle(overlayFrame, box, cv::Scalar(color[2],color[1],color[0]), cv::FILLED);
+		double left = box.x;
+		double top = std::max((int)box.y, labelSize.height);
+		labelRect = cv::Rect(cv::Point(left, top - round(1.025*labelSize.height)), cv::Point(left + round(1.025*labelSize.width), top + baseLine));
+	}
+
+	// Only draw on (and blend) the part of the frame image the box (and label) covers
+	const int padding = std::max(thickness, 1) + 1;
+	cv::Rect rect = cv::Rect(box) | labelRect;
+	rect = cv::Rect(rect.x - padding, rect.y - padding, rect.width + 2 * padding, rect.height + 2 * padding)
+		& cv::Rect(0, 0, frame.cols, frame.rows);
+	if (rect.empty())
+		return;
+	cv::Mat image = frame(rect);
+	const cv::Point offset(rect.x, rect.y);
+	box.x -= offset.x;
+	box.y -= offset.y;
+	cv::Mat overlayFrame = image.clone();
 
-	   // add opacity
-		cv::addWeighted(overlayFrame, 1-alpha, frame, alpha, 0, frame);
+	if(is_background){
+		//Draw a rectangle displaying the bounding box
+		cv::rectangle(overlayFrame, box, rgba, cv::FILLED);
 	}
 	else{
-		cv::Mat overlayFrame;
-		frame.copyTo(overlayFrame);
-
 		//Draw a rectangle displaying the bounding box
-		cv::rectangle(overlayFrame, box, cv::Scalar(color[2],color[1],color[0]), thickness);
-
-		if(display_text){
-			//Get the label for the class name and its confidence
-			std::string label = cv::format("%.2f", conf);
-			if (!classNames.empty())
-			{
-				CV_Assert(classId < (int)classNames.size());
-				label = classNames[classId] + ":" + label;
-			}
+		cv::rectangle(overlayFrame, box, rgba, thickness);
 
-			//Display the label at the top of the bounding box
-			int baseLine;
-			cv::Size labelSize = cv::getTextSize(label, cv::FONT_HERSHEY_SIMPLEX, 0.5, 1, &baseLine);
-
-			double left = box.x;
-			double top = std::max((int)box.y, labelSize.height);
-
-			cv::rectangle(overlayFrame, cv::Point(left, top - round(1.025*labelSize.height)), cv::Point(left + round(1.025*labelSize.width), top + baseLine),
-							cv::Scalar(color[2],color[1],color[0]), cv::FILLED);
-			putText(overlayFrame, label, cv::Point(left+1, top), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0,0,0),1);
+		if(!label.empty()){
+			cv::rectangle(overlayFrame, labelRect - offset, rgba, cv::FILLED);
+			putText(overlayFrame, label, cv::Point(labelRect.x + 1, labelRect.y + round(1.025*labelSize.height)) - offset,
+					cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0,0,0,255),1);
 		}
-		// add opacity
-		cv::addWeighted(overlayFrame, 1-alpha, frame, alpha, 0, frame);
 	}
+
+	// add opacity
+	cv::addWeighted(overlayFrame, 1-alpha, image, alpha, 0, image);
 }
 
 // Load protobuf data file
 bool ObjectDetection::LoadObjDetectdData(std::string inputFilePath){
-	// Create tracker message
+	// Index the frames of the existing object detection message (they are decoded when needed)
+	auto index = std::make_shared<ProtobufFrameIndex>();
 	pb_objdetect::ObjDetect objMessage;
-
-	// Read the existing tracker message.
-	std::fstream input(inputFilePath, std::ios::in | std::ios::binary);
-	if (!objMessage.ParseFromIstream(&input)) {
+	if (!index->Open(inputFilePath) || !index->ParseHeader(objMessage)) {
 		std::cerr << "Failed to parse protobuf message." << std::endl;
 		return false;
 	}
 
 	// Make sure classNames, detectionsData and trackedObjects are empty
 	classNames.clear();
-	detectionsData.clear();
+	detectionsData.reset();
 	trackedObjects.clear();
 
 	// Seed to generate same random numbers
@@ -302,11 +311,13 @@ bool ObjectDetection::LoadObjDetectdData(std::string inputFilePath){
 		classesColor.push_back(cv::Scalar(std::rand()%205 + 50, std::rand()%205 + 50, std::rand()%205 + 50));
 	}
 
-	// Iterate over all frames of the saved message
-	for (size_t i = 0; i < objMessage.frame_size(); i++)
+	// Iterate over all frames of the saved message (one at a time), to create the tracked objects
+	pb_objdetect::Frame pbFrameData;
+	for (size_t i = 0; i < index->Count(); i++)
 	{
 		// Create protobuf message reader
-		const pb_objdetect::Frame& pbFrameData = objMessage.frame(i);
+		if (!index->ParseFrameAt(i, pbFrameData))
+			continue;
 
 		// Get frame Id
 		size_t id = pbFrameData.id();
@@ -314,12 +325,6 @@ bool ObjectDetection::LoadObjDetectdData(std::string inputFilePath){
 		// Load bounding box data
 		const google::protobuf::RepeatedPtrField<pb_objdetect::Frame_Box > &pBox = pbFrameData.bounding_box();
 
-		// Construct data vectors related to detections in the current frame
-		std::vector<int> classIds;
-		std::vector<float> confidences;
-		std::vector<cv::Rect_<float>> boxes;
-		std::vector<int> objectIds;
-
 		// Iterate through the detected objects
 		for(int i = 0; i < pbFrameData.bounding_box_size(); i++)
 		{
@@ -330,8 +335,6 @@ bool ObjectDetection::LoadObjDetectdData(std::string inputFilePath){
 			float h = pBox.Get(i).h();
 			// Get class Id (which will be assign to a class name)
 			int classId = pBox.Get(i).classid();
-			// Get prediction confidence
-			float confidence = pBox.Get(i).confidence();
 
 			// Get the object Id
 			int objectId = pBox.Get(i).objectid();
@@ -359,24 +362,35 @@ bool ObjectDetection::LoadObjDetectdData(std::string inputFilePath){
 				trackedObjPtr->Id(std::to_string(objectId));
 				trackedObjects.insert({objectId, trackedObjPtr});
 			}
+		}
+	}
 
-			// Create OpenCV rectangle with the bouding box info
-			cv::Rect_<float> box(x, y, w, h);
+	// The detections of each frame are decoded from the index (by GetFrame)
+	detectionsData = index;
 
-			// Push back data into vectors
-			boxes.push_back(box);
-			classIds.push_back(classId);
-			confidences.push_back(confidence);
-			objectIds.push_back(objectId);
-		}
+	return true;
+}
 
-		// Assign data to object detector map
-		detectionsData[id] = DetectionData(classIds, confidences, boxes, id, objectIds);
-	}
+// Get the detections of a frame
+bool ObjectDetection::GetDetectionData(int64_t frame_number, DetectionData& detections) const {
+	pb_objdetect::Frame pbFrameData;
+	if (!detectionsData || !detectionsData->ParseFrame(frame_number, pbFrameData))
+		return false;
 
-	// Delete all global objects allocated by libprotobuf.
-	google::protobuf::ShutdownProtobufLibrary();
+	// Construct data vectors related to detections in the frame
+	std::vector<int> classIds;
+	std::vector<float> confidences;
+	std::vector<cv::Rect_<float>> boxes;
+	std::vector<int> objectIds;
+	for (const auto &box : pbFrameData.bounding_box())
+	{
+		boxes.push_back(cv::Rect_<float>(box.x(), box.y(), box.w(), box.h()));
+		classIds.push_back(box.classid());
+		confidences.push_back(box.confidence());
+		objectIds.push_back(box.objectid());
+	}
 
+	detections = DetectionData(classIds, confidences, boxes, pbFrameData.id(), objectIds);
 	return true;
 }
 
@@ -389,10 +403,10 @@ std::string ObjectDetection::GetVisibleObjects(int64_t frame_number) const{
 	root["visible_objects_id"] = Json::Value(Json::arrayValue);
 
 	// Check if track data exists for the requested frame
-	if (detectionsData.find(frame_number) == detectionsData.end()){
+	DetectionData detections;
+	if (!GetDetectionData(frame_number, detections)){
 		return root.toStyledString();
 	}
-	DetectionData detections = detectionsData.at(frame_number);
 
 	// Iterate through the tracked objects
 	for(int i = 0; i<detections.boxes.size(); i++){
@@ -531,7 +545,7 @@ void ObjectDetection::SetJsonValue(const Json::Value root) {
 }
 
 // Get all properties for a specific frame
-std::string ObjectDetection::PropertiesJSON(int64_t requested_frame) const {
+Json::Value ObjectDetection::PropertiesJsonValue(int64_t requested_frame) const {
 
 	// Generate JSON properties list
 	Json::Value root = BasePropertiesJSON(requested_frame);
@@ -556,5 +570,5 @@ std::string ObjectDetection::PropertiesJSON(int64_t requested_frame) const {
 	root["display_box_text"]["choices"].append(add_property_choice_json("On", 0, display_box_text.GetValue(requested_frame)));
 
 	// Return formatted string
-	return root.toStyledString();
+	return root;
 }
@@ -50,6 +50,7 @@ namespace openshot
 {
     // Forward decls
     class Frame;
+    class ProtobufFrameIndex;
 
     /**
      * @brief This effect displays all the detected objects on a clip.
@@ -58,7 +59,7 @@ namespace openshot
     {
     private:
         std::string protobuf_data_path;
-        std::map<size_t, DetectionData> detectionsData;
+        std::shared_ptr<ProtobufFrameIndex> detectionsData; ///< The detections (each frame is decoded when it's needed)
         std::vector<std::string> classNames;
 
         std::vector<cv::Scalar> classesColor;
@@ -73,6 +74,8 @@ namespace openshot
 
         /// Init effect settings
         void init_effect_details();
+        /// Get the detections of a frame (returns false if the frame has no detection data)
+        bool GetDetectionData(int64_t frame_number, DetectionData& detections) const;
         /// Draw bounding box with class and score text
         void drawPred(int classId, float conf, cv::Rect2d box, cv::Mat& frame, int objectNumber, std::vector<int> color, float alpha,
                         int thickness, bool is_background, bool draw_text);
@@ -116,7 +119,7 @@ namespace openshot
 
         /// Get all properties for a specific frame (perfect for a UI to display the current state
         /// of all properties at any time)
-        std::string PropertiesJSON(int64_t requested_frame) const override;
+        Json::Value PropertiesJsonValue(int64_t requested_frame) const override;
     };
 
 }
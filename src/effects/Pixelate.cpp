@@ -14,8 +14,11 @@
 #include "Exceptions.h"
 #include "Json.h"
 
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
 #include <QImage>
-#include <QPainter>
 #include <QRect>
 #include <QPoint>
 
@@ -72,17 +75,65 @@ Pixelate::GetFrame(std::shared_ptr<openshot::Frame> frame, int64_t frame_number)
 		QRect area(QPoint(0,0), frame_image->size());
 		area = area.marginsRemoved({int(left_value * w), int(top_value * h), int(right_value * w), int(bottom_value * h)});
 
+		area &= frame_image->rect();
+
 		int scale_to = (int) (area.width() * pixelization_value);
 		if (scale_to < 1) {
 			scale_to = 1; // Not less than one pixel
 		}
-		// Copy and scale pixels in area to be pixelated
-		auto frame_scaled = frame_image->copy(area).scaledToWidth(scale_to, Qt::SmoothTransformation);
 
-		// Draw pixelated image back over original
-		QPainter painter(frame_image.get());
-		painter.drawImage(area, frame_scaled);
-		painter.end();
+		if (!area.isEmpty() && scale_to < area.width()) {
+			// Divide the area into blocks (scale_to blocks wide, with about square blocks), and
+			// replace each block by its average color (in place, one row of blocks per thread)
+			const int columns = scale_to;
+			const int rows = std::max(1, (int) round(area.height() * double(scale_to) / area.width()));
+			unsigned char *pixels = frame_image->bits();
+			const int stride = frame_image->bytesPerLine();
+
+			#pragma omp parallel for schedule(dynamic)
+			for (int row = 0; row < rows; row++) {
+				const int y0 = area.top() + int(int64_t(row) * area.height() / rows);
+				const int y1 = area.top() + int(int64_t(row + 1) * area.height() / rows);
+				std::vector<uint64_t> sums(columns * 4, 0);
+
+				// Sum the pixels of each block (line by line)
+				for (int y = y0; y < y1; y++) {
+					const unsigned char *line = pixels + (y * stride);
+					for (int column = 0; column < columns; column++) {
+						const int x0 = area.left() + int(int64_t(column) * area.width() / columns);
+						const int x1 = area.left() + int(int64_t(column + 1) * area.width() / columns);
+						uint64_t *sum = &sums[column * 4];
+						for (int x = x0; x < x1; x++) {
+							const unsigned char *pixel = line + (x * 4);
+							sum[0] += pixel[0];
+							sum[1] += pixel[1];
+							sum[2] += pixel[2];
+							sum[3] += pixel[3];
+						}
+					}
+				}
+
+				// Fill each block with its average
+				std::vector<unsigned char> averages(columns * 4, 0);
+				for (int column = 0; column < columns; column++) {
+					const int x0 = area.left() + int(int64_t(column) * area.width() / columns);
+					const int x1 = area.left() + int(int64_t(column + 1) * area.width() / columns);
+					const uint64_t count = uint64_t(x1 - x0) * (y1 - y0);
+					for (int c = 0; c < 4 && count > 0; c++)
+						averages[column * 4 + c] = (unsigned char) ((sums[column * 4 + c] + count / 2) / count);
+				}
+				for (int y = y0; y < y1; y++) {
+					unsigned char *line = pixels + (y * stride);
+					for (int column = 0; column < columns; column++) {
+						const int x0 = area.left() + int(int64_t(column) * area.width() / columns);
+						const int x1 = area.left() + int(int64_t(column + 1) * area.width() / columns);
+						const unsigned char *average = &averages[column * 4];
+						for (int x = x0; x < x1; x++)
+							memcpy(line + (x * 4), average, 4);
+					}
+				}
+			}
+		}
 	}
 
 	// return the modified frame
@@ -149,7 +200,7 @@ void Pixelate::SetJsonValue(const Json::Value root) {
 }
 
 // Get all properties for a specific frame
-std::string Pixelate::PropertiesJSON(int64_t requested_frame) const {
+Json::Value Pixelate::PropertiesJsonValue(int64_t requested_frame) const {
 
 	// Generate JSON properties list
 	Json::Value root = BasePropertiesJSON(requested_frame);
@@ -162,5 +213,5 @@ std::string Pixelate::PropertiesJSON(int64_t requested_frame) const {
 	root["bottom"] = add_property_json("Bottom Margin", bottom.GetValue(requested_frame), "float", "", &bottom, 0.0, 1.0, false, requested_frame);
 
 	// Return formatted string
-	return root.toStyledString();
+	return root;
 }
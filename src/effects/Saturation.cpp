@@ -12,6 +12,7 @@
 
 #include "Saturation.h"
 #include "Exceptions.h"
+#include "PixelKernels.h"
 
 using namespace openshot;
 
@@ -53,100 +54,31 @@ std::shared_ptr<openshot::Frame> Saturation::GetFrame(std::shared_ptr<openshot::
 	if (!frame_image)
 		return frame;
 
-	int pixel_count = frame_image->width() * frame_image->height();
+	int64_t pixel_count = int64_t(frame_image->width()) * frame_image->height();
 
 	// Get keyframe values for this frame
-	float saturation_value = saturation.GetValue(frame_number);
-	float saturation_value_R = saturation_R.GetValue(frame_number);
-	float saturation_value_G = saturation_G.GetValue(frame_number);
-	float saturation_value_B = saturation_B.GetValue(frame_number);
+	PixelOperation operation;
+	GetPixelOperation(frame_number, operation);
 
-	// Constants used for color saturation formula
-	const double pR = .299;
-	const double pG = .587;
-	const double pB = .114;
-
-	// Loop through pixels
+	// Adjust all pixels (the kernel removes, and re-applies, the pre-multiplied alpha)
 	unsigned char *pixels = (unsigned char *) frame_image->bits();
-
-	#pragma omp parallel for shared (pixels)
-	for (int pixel = 0; pixel < pixel_count; ++pixel)
-	{
-		// Calculate alpha % (to be used for removing pre-multiplied alpha value)
-		int A = pixels[pixel * 4 + 3];
-		float alpha_percent = A / 255.0;
-
-		// Get RGB values, and remove pre-multiplied alpha
-		int R = pixels[pixel * 4 + 0] / alpha_percent;
-		int G = pixels[pixel * 4 + 1] / alpha_percent;
-		int B = pixels[pixel * 4 + 2] / alpha_percent;
-
-		/*
-		 * Common saturation adjustment
-		 */
-
-		// Calculate the saturation multiplier
-		double p = sqrt( (R * R * pR) +
-						 (G * G * pG) +
-						 (B * B * pB) );
-
-		// Adjust the saturation
-		R = constrain(p + (R - p) * saturation_value);
-		G = constrain(p + (G - p) * saturation_value);
-		B = constrain(p + (B - p) * saturation_value);
-
-		/*
-		 * Color-separated saturation adjustment
-		 *
-		 * Splitting each of the three subpixels (R, G and B) into three distincs sub-subpixels (R, G and B in turn)
-		 * which in their optical sum reproduce the original subpixel's color OR produce white light in the brightness
-		 * of the original subpixel (dependening on the color channel's slider value).
-		 */
-
-		// Compute the brightness ("saturation multiplier") of the replaced subpixels
-		// Actually mathematical no-ops mostly, verbosity is kept just for clarification
-		const double p_r = sqrt(R * R * pR);
-		const double p_g = sqrt(G * G * pG);
-		const double p_b = sqrt(B * B * pB);
-
-		// Adjust the saturation
-		const int Rr = p_r + (R - p_r) * saturation_value_R;
-		const int Gr = p_r + (0 - p_r) * saturation_value_R;
-		const int Br = p_r + (0 - p_r) * saturation_value_R;
-
-		const int Rg = p_g + (0 - p_g) * saturation_value_G;
-		const int Gg = p_g + (G - p_g) * saturation_value_G;
-		const int Bg = p_g + (0 - p_g) * saturation_value_G;
-
-		const int Rb = p_b + (0 - p_b) * saturation_value_B;
-		const int Gb = p_b + (0 - p_b) * saturation_value_B;
-		const int Bb = p_b + (B - p_b) * saturation_value_B;
-
-		// Recombine brightness of sub-subpixels (Rx, Gx and Bx) into sub-pixels (R, G and B) again
-		R = Rr + Rg + Rb;
-		G = Gr + Gg + Gb;
-		B = Br + Bg + Bb;
-
-		// Constrain the value from 0 to 255
-		R = constrain(R);
-		G = constrain(G);
-		B = constrain(B);
-
-		// Set all pixels to new value
-		pixels[pixel * 4 + 0] = R;
-		pixels[pixel * 4 + 1] = G;
-		pixels[pixel * 4 + 2] = B;
-
-		// Pre-multiply the alpha back into the color channels
-		pixels[pixel * 4 + 0] *= alpha_percent;
-		pixels[pixel * 4 + 1] *= alpha_percent;
-		pixels[pixel * 4 + 2] *= alpha_percent;
-	}
+	PixelKernels::Apply(pixels, pixel_count, { operation });
 
 	// return the modified frame
 	return frame;
 }
 
+// Get the saturation adjustment of a frame
+bool Saturation::GetPixelOperation(int64_t frame_number, PixelOperation& operation)
+{
+	operation.type = PixelOperation::SATURATION;
+	operation.values[0] = saturation.GetValue(frame_number);
+	operation.values[1] = saturation_R.GetValue(frame_number);
+	operation.values[2] = saturation_G.GetValue(frame_number);
+	operation.values[3] = saturation_B.GetValue(frame_number);
+	return true;
+}
+
 // Generate JSON string of this object
 std::string Saturation::Json() const {
 
@@ -204,7 +136,7 @@ void Saturation::SetJsonValue(const Json::Value root) {
 }
 
 // Get all properties for a specific frame
-std::string Saturation::PropertiesJSON(int64_t requested_frame) const {
+Json::Value Saturation::PropertiesJsonValue(int64_t requested_frame) const {
 
 	// Generate JSON properties list
 	Json::Value root = BasePropertiesJSON(requested_frame);
@@ -216,5 +148,5 @@ std::string Saturation::PropertiesJSON(int64_t requested_frame) const {
 	root["saturation_B"] = add_property_json("Saturation (Blue)", saturation_B.GetValue(requested_frame), "float", "", &saturation_B, 0.0, 4.0, false, requested_frame);
 
 	// Return formatted string
-	return root.toStyledString();
+	return root;
 }
@@ -12,6 +12,7 @@
 
 #include "Shift.h"
 #include "Exceptions.h"
+#include "PixelKernels.h"
 
 using namespace openshot;
 
@@ -56,60 +57,16 @@ std::shared_ptr<openshot::Frame> Shift::GetFrame(std::shared_ptr<openshot::Frame
 	double y_shift = y.GetValue(frame_number);
 	double y_shift_limit = fmod(fabs(y_shift), 1.0);
 
-	// Declare temp arrays to hold pixels while we move things around
-	unsigned char *temp_row = new unsigned char[frame_image->width() * 4]();
-
-	// X-SHIFT
-	// Loop through rows
-	for (int row = 0; row < frame_image->height(); row++) {
-		// Copy current row's pixels
-		int starting_row_pixel = row * frame_image->width();
-		memcpy(temp_row, &pixels[starting_row_pixel * 4], sizeof(char) * frame_image->width() * 4);
-
-		// Replace current row with left part of the pixels
-		if (x_shift > 0.0) {
-			// Move left side to the right
-			int relative_pixel_start = (int)round(frame_image->width() * x_shift_limit);
-			memcpy(&pixels[(starting_row_pixel + relative_pixel_start) * 4], &temp_row[0], sizeof(char) * (frame_image->width() - relative_pixel_start) * 4);
-
-			// Move right side to the left
-			memcpy(&pixels[starting_row_pixel * 4], &temp_row[(frame_image->width() - relative_pixel_start) * 4], sizeof(char) * relative_pixel_start * 4);
-		} else if (x_shift < 0.0) {
-			// Move right side to the left
-			int relative_pixel_start = (int)round(frame_image->width() * x_shift_limit);
-			memcpy(&pixels[starting_row_pixel * 4], &temp_row[relative_pixel_start * 4], sizeof(char) * (frame_image->width() - relative_pixel_start) * 4);
-
-			// Move left side to the right
-			memcpy(&pixels[(starting_row_pixel + (frame_image->width() - relative_pixel_start)) * 4], &temp_row[0], sizeof(char) * relative_pixel_start * 4);
-		}
-	}
-
-	// Make temp copy of pixels for Y-SHIFT
-	unsigned char *temp_image = new unsigned char[frame_image->width() * frame_image->height() * 4]();
-	memcpy(temp_image, pixels, sizeof(char) * frame_image->width() * frame_image->height() * 4);
-
-	// Y-SHIFT
-	// Replace current row with left part of the pixels
-	if (y_shift > 0.0) {
-		// Move top side to bottom
-		int relative_pixel_start = frame_image->width() * (int)round(frame_image->height() * y_shift_limit);
-		memcpy(&pixels[relative_pixel_start * 4], temp_image, sizeof(char) * ((frame_image->width() * frame_image->height()) - relative_pixel_start) * 4);
-
-		// Move bottom side to top
-		memcpy(pixels, &temp_image[((frame_image->width() * frame_image->height()) - relative_pixel_start) * 4], sizeof(char) * relative_pixel_start * 4);
+	// Get the offsets in pixels (positive values move the left side to the right, and the top side to the bottom)
+	int x_offset = (int) round(frame_image->width() * x_shift_limit);
+	if (x_shift < 0.0)
+		x_offset = -x_offset;
+	int y_offset = (int) round(frame_image->height() * y_shift_limit);
+	if (y_shift < 0.0)
+		y_offset = -y_offset;
 
-	} else if (y_shift < 0.0) {
-		// Move bottom side to top
-		int relative_pixel_start = frame_image->width() * (int)round(frame_image->height() * y_shift_limit);
-		memcpy(pixels, &temp_image[relative_pixel_start * 4], sizeof(char) * ((frame_image->width() * frame_image->height()) - relative_pixel_start) * 4);
-
-		// Move left side to the right
-		memcpy(&pixels[((frame_image->width() * frame_image->height()) - relative_pixel_start) * 4], temp_image, sizeof(char) * relative_pixel_start * 4);
-	}
-
-	// Delete arrays
-	delete[] temp_row;
-	delete[] temp_image;
+	// Move both axes in a single pass (on multiple threads)
+	PixelKernels::Shift(pixels, frame_image->width(), frame_image->height(), x_offset, y_offset);
 
 	// return the modified frame
 	return frame;
@@ -166,7 +123,7 @@ void Shift::SetJsonValue(const Json::Value root) {
 }
 
 // Get all properties for a specific frame
-std::string Shift::PropertiesJSON(int64_t requested_frame) const {
+Json::Value Shift::PropertiesJsonValue(int64_t requested_frame) const {
 
 	// Generate JSON properties list
 	Json::Value root = BasePropertiesJSON(requested_frame);
@@ -176,5 +133,5 @@ std::string Shift::PropertiesJSON(int64_t requested_frame) const {
 	root["y"] = add_property_json("Y Shift", y.GetValue(requested_frame), "float", "", &y, -1, 1, false, requested_frame);
 
 	// Return formatted string
-	return root.toStyledString();
+	return root;
 }
@@ -17,13 +17,13 @@
 
 #include "effects/Stabilizer.h"
 #include "Exceptions.h"
+#include "ImageBufferPool.h"
+#include "OpenCVUtilities.h"
+#include "ProtobufFrameIndex.h"
 #include "stabilizedata.pb.h"
 
-#include <google/protobuf/util/time_util.h>
-
 using namespace std;
 using namespace openshot;
-using google::protobuf::util::TimeUtil;
 
 /// Blank constructor, useful when using Json to load the effect properties
 Stabilizer::Stabilizer(std::string clipStabilizedDataPath):protobuf_data_path(clipStabilizedDataPath)
@@ -63,91 +63,86 @@ void Stabilizer::init_effect_details()
 std::shared_ptr<Frame> Stabilizer::GetFrame(std::shared_ptr<Frame> frame, int64_t frame_number)
 {
 
-	// Grab OpenCV Mat image
-	cv::Mat frame_image = frame->GetImageCV();
-
-	// If frame is NULL, return itself
-	if(!frame_image.empty()){
-
-		// Check if track data exists for the requested frame
-		if(transformationData.find(frame_number) != transformationData.end()){
-
-			float zoom_value = zoom.GetValue(frame_number);
-
-			// Create empty rotation matrix
-			cv::Mat T(2,3,CV_64F);
-
-			// Set rotation matrix values
-			T.at<double>(0,0) = cos(transformationData[frame_number].da);
-			T.at<double>(0,1) = -sin(transformationData[frame_number].da);
-			T.at<double>(1,0) = sin(transformationData[frame_number].da);
-			T.at<double>(1,1) = cos(transformationData[frame_number].da);
-
-			T.at<double>(0,2) = transformationData[frame_number].dx * frame_image.size().width;
-			T.at<double>(1,2) = transformationData[frame_number].dy * frame_image.size().height;
-
-			// Apply rotation matrix to image
-			cv::Mat frame_stabilized;
-			cv::warpAffine(frame_image, frame_stabilized, T, frame_image.size());
-
-			// Scale up the image to remove black borders
-			cv::Mat T_scale = cv::getRotationMatrix2D(cv::Point2f(frame_stabilized.cols/2, frame_stabilized.rows/2), 0, zoom_value);
-			cv::warpAffine(frame_stabilized, frame_stabilized, T_scale, frame_stabilized.size());
-			frame_image = frame_stabilized;
+	// Check if track data exists for the requested frame
+	EffectTransformParam transform;
+	std::shared_ptr<QImage> frame_image = frame->GetImage();
+
+	// If frame is NULL, or doesn't have tracking data, it's returned as it came
+	if(frame_image && !frame_image->isNull() && GetTransformParam(frame_number, transform)){
+
+		float zoom_value = zoom.GetValue(frame_number);
+
+		// Wrap the frame's RGBA pixels (no copy or color conversion)
+		const cv::Mat source(frame_image->height(), frame_image->width(), CV_8UC4,
+							 (uchar*) frame_image->constBits(), frame_image->bytesPerLine());
+
+		// Create rotation matrix
+		cv::Matx33d T(cos(transform.da), -sin(transform.da), transform.dx * source.cols,
+					  sin(transform.da), cos(transform.da), transform.dy * source.rows,
+					  0, 0, 1);
+
+		// Scale up the image to remove black borders
+		cv::Mat T_scale_2x3 = cv::getRotationMatrix2D(cv::Point2f(source.cols/2, source.rows/2), 0, zoom_value);
+		cv::Matx33d T_scale = cv::Matx33d::eye();
+		for (int row = 0; row < 2; row++)
+			for (int col = 0; col < 3; col++)
+				T_scale(row, col) = T_scale_2x3.at<double>(row, col);
+
+		// Apply both transforms in one pass, straight into a new image (the borders are opaque black)
+		std::shared_ptr<QImage> stabilized_image = ImageBufferPool::Instance()->CreateImage(
+			source.cols, source.rows, QImage::Format_RGBA8888_Premultiplied);
+		cv::Mat frame_stabilized(stabilized_image->height(), stabilized_image->width(), CV_8UC4,
+								 stabilized_image->bits(), stabilized_image->bytesPerLine());
+		cv::Matx33d M = T_scale * T;
+		if (UseOpenCL()) {
+			// Warp on the GPU (the device buffers of each thread are re-used by the following frames)
+			thread_local cv::UMat source_gpu;
+			thread_local cv::UMat stabilized_gpu;
+			source.copyTo(source_gpu);
+			cv::warpAffine(source_gpu, stabilized_gpu, cv::Mat(M).rowRange(0, 2), source.size(),
+						   cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar(0, 0, 0, 255));
+			stabilized_gpu.copyTo(frame_stabilized);
+		} else {
+			cv::warpAffine(source, frame_stabilized, cv::Mat(M).rowRange(0, 2), source.size(),
+						   cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar(0, 0, 0, 255));
 		}
+
+		// Set stabilized image to frame
+		frame->AddImage(stabilized_image);
 	}
-	// Set stabilized image to frame
-	// If the input image is NULL or doesn't have tracking data, it's returned as it came
-	frame->SetImageCV(frame_image);
 	return frame;
 }
 
 // Load protobuf data file
 bool Stabilizer::LoadStabilizedData(std::string inputFilePath){
-	using std::ios;
-	// Create stabilization message
-	pb_stabilize::Stabilization stabilizationMessage;
-
-	// Read the existing tracker message.
-	std::fstream input(inputFilePath, ios::in | ios::binary);
-	if (!stabilizationMessage.ParseFromIstream(&input)) {
+	// Index the frames of the existing stabilization message (they are decoded when needed)
+	auto index = std::make_shared<ProtobufFrameIndex>();
+	if (!index->Open(inputFilePath)) {
 		std::cerr << "Failed to parse protobuf message." << std::endl;
 		return false;
 	}
 
-	// Make sure the data maps are empty
-	transformationData.clear();
-	trajectoryData.clear();
-
-	// Iterate over all frames of the saved message and assign to the data maps
-	for (size_t i = 0; i < stabilizationMessage.frame_size(); i++) {
-
-		// Create stabilization message
-		const pb_stabilize::Frame& pbFrameData = stabilizationMessage.frame(i);
-
-		// Load frame number
-		size_t id = pbFrameData.id();
-
-		// Load camera trajectory data
-		float x = pbFrameData.x();
-		float y = pbFrameData.y();
-		float a = pbFrameData.a();
-
-		// Assign data to trajectory map
-		trajectoryData[i] = EffectCamTrajectory(x,y,a);
+	stabilizedData = index;
+	return true;
+}
 
-		// Load transformation data
-		float dx = pbFrameData.dx();
-		float dy = pbFrameData.dy();
-		float da = pbFrameData.da();
+// Get the transformation of a frame
+bool Stabilizer::GetTransformParam(int64_t frame_number, EffectTransformParam& param) const {
+	pb_stabilize::Frame pbFrameData;
+	if (!stabilizedData || !stabilizedData->ParseFrame(frame_number, pbFrameData))
+		return false;
 
-		// Assing data to transformation map
-		transformationData[id] = EffectTransformParam(dx,dy,da);
-	}
+	param = EffectTransformParam(pbFrameData.dx(), pbFrameData.dy(), pbFrameData.da());
+	return true;
+}
 
-	// Delete all global objects allocated by libprotobuf.
-	google::protobuf::ShutdownProtobufLibrary();
+// Get the camera trajectory of a frame
+bool Stabilizer::GetCamTrajectory(int64_t frame_number, EffectCamTrajectory& trajectory) const {
+	pb_stabilize::Frame pbFrameData;
+	if (!stabilizedData || !stabilizedData->ParseFrame(frame_number, pbFrameData))
+		return false;
 
+	trajectory = EffectCamTrajectory(pbFrameData.x(), pbFrameData.y(), pbFrameData.a());
 	return true;
 }
 
@@ -210,7 +205,7 @@ void Stabilizer::SetJsonValue(const Json::Value root) {
 }
 
 // Get all properties for a specific frame
-std::string Stabilizer::PropertiesJSON(int64_t requested_frame) const {
+Json::Value Stabilizer::PropertiesJsonValue(int64_t requested_frame) const {
 
 	// Generate JSON properties list
 	Json::Value root = BasePropertiesJSON(requested_frame);
@@ -218,5 +213,5 @@ std::string Stabilizer::PropertiesJSON(int64_t requested_frame) const {
 	root["zoom"] = add_property_json("Zoom", zoom.GetValue(requested_frame), "float", "", &zoom, 0.0, 2.0, false, requested_frame);
 
 	// Return formatted string
-	return root.toStyledString();
+	return root;
 }
@@ -56,6 +56,7 @@ namespace openshot
 {
     // Forwward decls
     class Frame;
+    class ProtobufFrameIndex;
 
     /**
      * @brief This class stabilizes a video clip to remove undesired shaking and jitter.
@@ -71,10 +72,11 @@ namespace openshot
         std::string protobuf_data_path;
         Keyframe zoom;
 
+        /// The stabilization data (each frame is decoded when it's needed)
+        std::shared_ptr<ProtobufFrameIndex> stabilizedData;
+
     public:
         std::string teste;
-        std::map <size_t,EffectCamTrajectory> trajectoryData; // Save camera trajectory data
-        std::map <size_t,EffectTransformParam> transformationData; // Save transormation data
 
         Stabilizer();
 
@@ -98,6 +100,14 @@ namespace openshot
         /// Load protobuf data file
         bool LoadStabilizedData(std::string inputFilePath);
 
+        /// @brief Get the transformation of a frame
+        /// @returns false if there is no stabilization data for the frame
+        bool GetTransformParam(int64_t frame_number, EffectTransformParam& param) const;
+
+        /// @brief Get the camera trajectory of a frame
+        /// @returns false if there is no stabilization data for the frame
+        bool GetCamTrajectory(int64_t frame_number, EffectCamTrajectory& trajectory) const;
+
         // Get and Set JSON methods
         std::string Json() const override; ///< Generate JSON string of this object
         void SetJson(const std::string value) override; ///< Load JSON string into this object
@@ -106,7 +116,7 @@ namespace openshot
 
         /// Get all properties for a specific frame (perfect for a UI to display the current state
         /// of all properties at any time)
-        std::string PropertiesJSON(int64_t requested_frame) const override;
+        Json::Value PropertiesJsonValue(int64_t requested_frame) const override;
     };
 
 }
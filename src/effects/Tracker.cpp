@@ -85,8 +85,8 @@ void Tracker::init_effect_details()
 // modified openshot::Frame object
 std::shared_ptr<Frame> Tracker::GetFrame(std::shared_ptr<Frame> frame, int64_t frame_number)
 {
-	// Get the frame's image
-	cv::Mat frame_image = frame->GetImageCV();
+	// Get the frame's image (the boxes are drawn straight onto the frame's RGBA pixels)
+	cv::Mat frame_image = frame->GetImageViewCV();
 
 	// Initialize the Qt rectangle that will hold the positions of the bounding-box
 	QRectF boxRect;
@@ -146,10 +146,6 @@ std::shared_ptr<Frame> Tracker::GetFrame(std::shared_ptr<Frame> frame, int64_t f
 
 	}
 
-	// Set image with drawn box to frame
-	// If the input image is NULL or doesn't have tracking data, it's returned as it came
-	frame->SetImageCV(frame_image);
-
 	// Set the bounding-box image with the Tracked Object's child clip image
 	if (childClipImage){
 		// Get the frame image
@@ -173,39 +169,39 @@ void Tracker::DrawRectangleRGBA(cv::Mat &frame_image, cv::RotatedRect box, std::
 	cv::Point2f vertices2f[4];
 	box.points(vertices2f);
 
-	// TODO: take a rectangle of frame_image by refencence and draw on top of that to improve speed
-	// select min enclosing rectangle to draw on a small portion of the image
-	// cv::Rect rect  = box.boundingRect();
-	// cv::Mat image = frame_image(rect)
+	// Only draw on (and blend) the part of the frame image the box covers
+	const int padding = std::max(thickness, 1) + 1;
+	cv::Rect rect = box.boundingRect();
+	rect = cv::Rect(rect.x - padding, rect.y - padding, rect.width + 2 * padding, rect.height + 2 * padding)
+		& cv::Rect(0, 0, frame_image.cols, frame_image.rows);
+	if (rect.empty())
+		return;
+	cv::Mat image = frame_image(rect);
+	for (int i = 0; i < 4; ++i)
+		vertices2f[i] -= cv::Point2f(rect.x, rect.y);
+
+	// The frame image is RGBA
+	const cv::Scalar rgba(color[0], color[1], color[2], 255);
+	cv::Mat overlayFrame = image.clone();
 
 	if(is_background){
-		cv::Mat overlayFrame;
-		frame_image.copyTo(overlayFrame);
-
 		// draw bounding box background
 		cv::Point vertices[4];
 		for(int i = 0; i < 4; ++i){
 			vertices[i] = vertices2f[i];}
 
-		cv::Rect rect  = box.boundingRect();
-		cv::fillConvexPoly(overlayFrame, vertices, 4, cv::Scalar(color[2],color[1],color[0]), cv::LINE_AA);
-		// add opacity
-		cv::addWeighted(overlayFrame, 1-alpha, frame_image, alpha, 0, frame_image);
+		cv::fillConvexPoly(overlayFrame, vertices, 4, rgba, cv::LINE_AA);
 	}
 	else{
-		cv::Mat overlayFrame;
-		frame_image.copyTo(overlayFrame);
-
 		// Draw bounding box
 		for (int i = 0; i < 4; i++)
 		{
-			cv::line(overlayFrame, vertices2f[i], vertices2f[(i+1)%4], cv::Scalar(color[2],color[1],color[0]),
-						thickness, cv::LINE_AA);
+			cv::line(overlayFrame, vertices2f[i], vertices2f[(i+1)%4], rgba, thickness, cv::LINE_AA);
 		}
-
-		// add opacity
-		cv::addWeighted(overlayFrame, 1-alpha, frame_image, alpha, 0, frame_image);
 	}
+
+	// add opacity
+	cv::addWeighted(overlayFrame, 1-alpha, image, alpha, 0, image);
 }
 
 // Get the indexes and IDs of all visible objects in the given frame
@@ -335,7 +331,7 @@ void Tracker::SetJsonValue(const Json::Value root) {
 }
 
 // Get all properties for a specific frame
-std::string Tracker::PropertiesJSON(int64_t requested_frame) const {
+Json::Value Tracker::PropertiesJsonValue(int64_t requested_frame) const {
 
 	// Generate JSON properties list
 	Json::Value root = BasePropertiesJSON(requested_frame);
@@ -350,5 +346,5 @@ std::string Tracker::PropertiesJSON(int64_t requested_frame) const {
 	root["objects"] = objects;
 
 	// Return formatted string
-	return root.toStyledString();
+	return root;
 }
@@ -88,7 +88,7 @@ namespace openshot
         ///
         /// (perfect for a UI to display the current state
         /// of all properties at any time)
-        std::string PropertiesJSON(int64_t requested_frame) const override;
+        Json::Value PropertiesJsonValue(int64_t requested_frame) const override;
         };
 
 }
@@ -12,6 +12,10 @@
 
 #include "Wave.h"
 #include "Exceptions.h"
+#include "PixelKernels.h"
+
+#include <cmath>
+#include <vector>
 
 using namespace openshot;
 
@@ -51,10 +55,8 @@ std::shared_ptr<openshot::Frame> Wave::GetFrame(std::shared_ptr<openshot::Frame>
 	// Get the frame's image
 	std::shared_ptr<QImage> frame_image = frame->GetImage();
 
-	// Get original pixels for frame image, and also make a copy for editing
-	const unsigned char *original_pixels = (unsigned char *) frame_image->constBits();
 	unsigned char *pixels = (unsigned char *) frame_image->bits();
-	int pixel_count = frame_image->width() * frame_image->height();
+	int height = frame_image->height();
 
 	// Get current keyframe values
 	double time = frame_number;
@@ -64,29 +66,22 @@ std::shared_ptr<openshot::Frame> Wave::GetFrame(std::shared_ptr<openshot::Frame>
 	double shift_x_value = shift_x.GetValue(frame_number);
 	double speed_y_value = speed_y.GetValue(frame_number);
 
-	// Loop through pixels
-	#pragma omp parallel for
-	for (int pixel = 0; pixel < pixel_count; ++pixel)
+	// The wave only depends on the row, so calculate the pixel offset of each row once
+	std::vector<int64_t> row_offsets(height);
+	for (int Y = 0; Y < height; ++Y)
 	{
-		// Calculate pixel Y value
-		int Y = pixel / frame_image->width();
-
 		// Calculate wave pixel offsets
 		float noiseVal = (100 + Y * 0.001) * multiplier_value;  // Time and time multiplier (to make the wave move)
 		float noiseAmp = noiseVal * amplitude_value;  // Apply amplitude / height of the wave
 		float waveformVal = sin((Y * wavelength_value) + (time * speed_y_value));  // Waveform algorithm on y-axis
 		float waveVal = (waveformVal + shift_x_value) * noiseAmp;  // Shifts pixels on the x-axis
 
-		long unsigned int source_px = round(pixel + waveVal);
-		if (source_px < 0)
-			source_px = 0;
-		if (source_px >= pixel_count)
-			source_px = pixel_count - 1;
-
-		// Calculate source array location, and target array location, and copy the 4 color values
-		memcpy(&pixels[pixel * 4], &original_pixels[source_px * 4], sizeof(char) * 4);
+		row_offsets[Y] = (int64_t) floor(waveVal + 0.5);
 	}
 
+	// Shift the pixels of each row (on multiple threads)
+	PixelKernels::WaveRows(pixels, frame_image->width(), height, row_offsets.data());
+
 	// return the modified frame
 	return frame;
 }
@@ -151,7 +146,7 @@ void Wave::SetJsonValue(const Json::Value root) {
 }
 
 // Get all properties for a specific frame
-std::string Wave::PropertiesJSON(int64_t requested_frame) const {
+Json::Value Wave::PropertiesJsonValue(int64_t requested_frame) const {
 
 	// Generate JSON properties list
 	Json::Value root = BasePropertiesJSON(requested_frame);
@@ -164,5 +159,5 @@ std::string Wave::PropertiesJSON(int64_t requested_frame) const {
 	root["speed_y"] = add_property_json("Vertical speed", speed_y.GetValue(requested_frame), "float", "", &speed_y, 0.0, 300.0, false, requested_frame);
 
 	// Return formatted string
-	return root.toStyledString();
+	return root;
 }
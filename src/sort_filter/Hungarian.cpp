@@ -28,7 +28,28 @@ double HungarianAlgorithm::Solve(
 	vector<int> &Assignment)
 {
 	unsigned int nRows = DistMatrix.size();
-	unsigned int nCols = DistMatrix[0].size();
+	unsigned int nCols = nRows > 0 ? DistMatrix[0].size() : 0;
+
+	vector<double> flatMatrix(nRows * nCols);
+	for (unsigned int i = 0; i < nRows; i++)
+		for (unsigned int j = 0; j < nCols; j++)
+			flatMatrix[i * nCols + j] = DistMatrix[i][j];
+
+	return Solve(flatMatrix.data(), nRows, nCols, Assignment);
+}
+
+//********************************************************//
+// Solve a flat cost matrix (row-major, i.e. the cost of row i and column j is DistMatrix[i * nCols + j]).
+//********************************************************//
+double HungarianAlgorithm::Solve(
+	const double *DistMatrix,
+	int nRows,
+	int nCols,
+	vector<int> &Assignment)
+{
+	Assignment.assign(nRows, -1);
+	if (nRows == 0 || nCols == 0)
+		return 0.0;
 
 	double *distMatrixIn = new double[nRows * nCols];
 	int *assignment = new int[nRows];
@@ -38,16 +59,15 @@ double HungarianAlgorithm::Solve(
 	// Here the cost matrix of size MxN is defined as a double precision array of N*M elements.
 	// In the solving functions matrices are seen to be saved MATLAB-internally in row-order.
 	// (i.e. the matrix [1 2; 3 4] will be stored as a vector [1 3 2 4], NOT [1 2 3 4]).
-	for (unsigned int i = 0; i < nRows; i++)
-		for (unsigned int j = 0; j < nCols; j++)
-			distMatrixIn[i + nRows * j] = DistMatrix[i][j];
+	for (int i = 0; i < nRows; i++)
+		for (int j = 0; j < nCols; j++)
+			distMatrixIn[i + nRows * j] = DistMatrix[i * nCols + j];
 
 	// call solving function
 	assignmentoptimal(assignment, &cost, distMatrixIn, nRows, nCols);
 
-	Assignment.clear();
-	for (unsigned int r = 0; r < nRows; r++)
-		Assignment.push_back(assignment[r]);
+	for (int r = 0; r < nRows; r++)
+		Assignment[r] = assignment[r];
 
 	delete[] distMatrixIn;
 	delete[] assignment;
@@ -25,6 +25,8 @@ public:
 	HungarianAlgorithm();
 	~HungarianAlgorithm();
 	double Solve(std::vector<std::vector<double>> &DistMatrix, std::vector<int> &Assignment);
+	// Solve a flat (row-major, nRows x nCols) cost matrix
+	double Solve(const double *DistMatrix, int nRows, int nCols, std::vector<int> &Assignment);
 
 private:
 	void assignmentoptimal(int *assignment, double *cost, double *distMatrix, int nOfRows, int nOfColumns);
@@ -42,6 +42,145 @@ double SortTracker::GetCentroidsDistance(
 	return distance;
 }
 
+// Match the predicted boxes to the detections
+//
+// Only the pairs closer than max_centroid_dist_norm can be matched, so the candidate pairs are found
+// with a grid of the detections' centroids (with cells at least as large as the gate), instead of
+// computing the full trkNum x detNum matrix. The candidate pairs split the trackers and detections
+// into independent groups, and the assignment problem is solved for each group separately (most
+// groups have a single tracker and detection, which don't need the solver at all).
+void SortTracker::match(const vector<TrackingBox> &detections, double image_diagonal)
+{
+	assignment.assign(trkNum, -1);
+	if (trkNum == 0 || detNum == 0)
+		return;
+
+	// Centroids of the detections
+	vector<float> det_x(detNum), det_y(detNum);
+	float min_x = FLT_MAX, min_y = FLT_MAX, max_x = -FLT_MAX, max_y = -FLT_MAX;
+	for (unsigned int j = 0; j < detNum; j++)
+	{
+		det_x[j] = detections[j].box.x + detections[j].box.width / 2;
+		det_y[j] = detections[j].box.y + detections[j].box.height / 2;
+		min_x = min(min_x, det_x[j]);
+		min_y = min(min_y, det_y[j]);
+		max_x = max(max_x, det_x[j]);
+		max_y = max(max_y, det_y[j]);
+	}
+
+	// Build the grid (at most 64 x 64 cells, each one at least as large as the gate)
+	const float gate = (float)(max_centroid_dist_norm * image_diagonal);
+	const float cell_size = max({gate, (max_x - min_x) / 64, (max_y - min_y) / 64, 1.0f});
+	const int grid_width = (int)((max_x - min_x) / cell_size) + 1;
+	const int grid_height = (int)((max_y - min_y) / cell_size) + 1;
+
+	vector<int> cell_start(grid_width * grid_height + 1, 0);
+	vector<int> det_cell(detNum);
+	for (unsigned int j = 0; j < detNum; j++)
+	{
+		int cell_x = (int)((det_x[j] - min_x) / cell_size);
+		int cell_y = (int)((det_y[j] - min_y) / cell_size);
+		det_cell[j] = cell_y * grid_width + cell_x;
+		cell_start[det_cell[j] + 1]++;
+	}
+	for (size_t c = 1; c < cell_start.size(); c++)
+		cell_start[c] += cell_start[c - 1];
+	vector<int> cell_dets(detNum);
+	vector<int> cell_fill(cell_start.begin(), cell_start.end() - 1);
+	for (unsigned int j = 0; j < detNum; j++)
+		cell_dets[cell_fill[det_cell[j]]++] = j;
+
+	// Find the candidate pairs (in the neighbouring cells of each predicted box), and join
+	// the trackers (0 .. trkNum - 1) and detections (trkNum ..) of each pair into groups
+	struct Candidate { unsigned int trk, det; double distance; };
+	vector<Candidate> candidates;
+	vector<int> group(trkNum + detNum);
+	for (size_t n = 0; n < group.size(); n++)
+		group[n] = n;
+	auto find_group = [&group](int n) {
+		while (group[n] != n)
+			n = group[n] = group[group[n]];
+		return n;
+	};
+
+	for (unsigned int i = 0; i < trkNum; i++)
+	{
+		const float trk_x = predictedBoxes[i].x + predictedBoxes[i].width / 2;
+		const float trk_y = predictedBoxes[i].y + predictedBoxes[i].height / 2;
+		const float cell_fx = floor((trk_x - min_x) / cell_size);
+		const float cell_fy = floor((trk_y - min_y) / cell_size);
+		if (!(cell_fx >= -1 && cell_fx <= grid_width && cell_fy >= -1 && cell_fy <= grid_height))
+			continue; // too far from every detection
+		const int cell_x = (int)cell_fx;
+		const int cell_y = (int)cell_fy;
+		for (int y = max(cell_y - 1, 0); y <= min(cell_y + 1, grid_height - 1); y++)
+		{
+			for (int x = max(cell_x - 1, 0); x <= min(cell_x + 1, grid_width - 1); x++)
+			{
+				const int cell = y * grid_width + x;
+				for (int c = cell_start[cell]; c < cell_start[cell + 1]; c++)
+				{
+					const unsigned int j = cell_dets[c];
+					double distance = GetCentroidsDistance(predictedBoxes[i], detections[j].box) / image_diagonal;
+					if (distance > max_centroid_dist_norm)
+						continue;
+					candidates.push_back({i, j, distance});
+					group[find_group(i)] = find_group(trkNum + j);
+				}
+			}
+		}
+	}
+
+	// Collect the trackers and detections of each group
+	vector<vector<unsigned int>> group_trks(trkNum + detNum), group_dets(trkNum + detNum);
+	vector<int> local_index(trkNum + detNum, -1);
+	for (const Candidate &candidate : candidates)
+	{
+		if (local_index[candidate.trk] == -1)
+		{
+			vector<unsigned int> &trks = group_trks[find_group(candidate.trk)];
+			local_index[candidate.trk] = trks.size();
+			trks.push_back(candidate.trk);
+		}
+		if (local_index[trkNum + candidate.det] == -1)
+		{
+			vector<unsigned int> &dets = group_dets[find_group(trkNum + candidate.det)];
+			local_index[trkNum + candidate.det] = dets.size();
+			dets.push_back(candidate.det);
+		}
+	}
+
+	// Solve each group (the pairs which are not candidates cost more than any set of candidates)
+	HungarianAlgorithm HungAlgo;
+	vector<int> group_assignment;
+	for (size_t g = 0; g < group_trks.size(); g++)
+	{
+		const vector<unsigned int> &trks = group_trks[g];
+		const vector<unsigned int> &dets = group_dets[g];
+		if (trks.empty())
+			continue;
+		if (trks.size() == 1 && dets.size() == 1)
+		{
+			assignment[trks[0]] = dets[0];
+			continue;
+		}
+
+		const double gated_cost = max_centroid_dist_norm * (min(trks.size(), dets.size()) + 1) + 1.0;
+		centroid_dist_matrix.assign(trks.size() * dets.size(), gated_cost);
+		for (const Candidate &candidate : candidates)
+			if ((size_t)find_group(candidate.trk) == g)
+				centroid_dist_matrix[local_index[candidate.trk] * dets.size() + local_index[trkNum + candidate.det]] = candidate.distance;
+
+		HungAlgo.Solve(centroid_dist_matrix.data(), trks.size(), dets.size(), group_assignment);
+		for (size_t r = 0; r < trks.size(); r++)
+		{
+			const int col = group_assignment[r];
+			if (col >= 0 && centroid_dist_matrix[r * dets.size() + col] <= max_centroid_dist_norm)
+				assignment[trks[r]] = dets[col];
+		}
+	}
+}
+
 void SortTracker::update(vector<cv::Rect> detections_cv, int frame_count, double image_diagonal, std::vector<float> confidences, std::vector<int> classIds)
 {
 	vector<TrackingBox> detections;
@@ -101,63 +240,27 @@ void SortTracker::update(vector<cv::Rect> detections_cv, int frame_count, double
 	trkNum = predictedBoxes.size();
 	detNum = detections.size();
 
-	centroid_dist_matrix.clear();
-	centroid_dist_matrix.resize(trkNum, vector<double>(detNum, 0));
+	match(detections, image_diagonal);
 
-	for (unsigned int i = 0; i < trkNum; i++) // compute iou matrix as a distance matrix
-	{
-		for (unsigned int j = 0; j < detNum; j++)
-		{
-			// use 1-iou because the hungarian algorithm computes a minimum-cost assignment.
-			double distance = SortTracker::GetCentroidsDistance(predictedBoxes[i], detections[j].box) / image_diagonal;
-			centroid_dist_matrix[i][j] = distance;
-		}
-	}
-
-	HungarianAlgorithm HungAlgo;
-	assignment.clear();
-	HungAlgo.Solve(centroid_dist_matrix, assignment);
 	// find matches, unmatched_detections and unmatched_predictions
 	unmatchedTrajectories.clear();
 	unmatchedDetections.clear();
-	allItems.clear();
-	matchedItems.clear();
-
-	if (detNum > trkNum) //	there are unmatched detections
-	{
-		for (unsigned int n = 0; n < detNum; n++)
-			allItems.insert(n);
-
-		for (unsigned int i = 0; i < trkNum; ++i)
-			matchedItems.insert(assignment[i]);
-
-		set_difference(allItems.begin(), allItems.end(),
-					   matchedItems.begin(), matchedItems.end(),
-					   insert_iterator<set<int>>(unmatchedDetections, unmatchedDetections.begin()));
-	}
-	else if (detNum < trkNum) // there are unmatched trajectory/predictions
-	{
-		for (unsigned int i = 0; i < trkNum; ++i)
-			if (assignment[i] == -1) // unassigned label will be set as -1 in the assignment algorithm
-				unmatchedTrajectories.insert(i);
-	}
-	else
-		;
-
-	// filter out matched with low IOU
 	matchedPairs.clear();
+
+	vector<bool> matchedDetections(detNum, false);
 	for (unsigned int i = 0; i < trkNum; ++i)
 	{
-		if (assignment[i] == -1) // pass over invalid values
-			continue;
-		if (centroid_dist_matrix[i][assignment[i]] > max_centroid_dist_norm)
+		if (assignment[i] == -1) // unassigned label will be set as -1 in the assignment algorithm
 		{
 			unmatchedTrajectories.insert(i);
-			unmatchedDetections.insert(assignment[i]);
+			continue;
 		}
-		else
-			matchedPairs.push_back(cv::Point(i, assignment[i]));
+		matchedDetections[assignment[i]] = true;
+		matchedPairs.push_back(cv::Point(i, assignment[i]));
 	}
+	for (unsigned int j = 0; j < detNum; j++)
+		if (!matchedDetections[j])
+			unmatchedDetections.insert(j);
 
 	for (unsigned int i = 0; i < matchedPairs.size(); i++)
 	{
@@ -213,3 +316,25 @@ void SortTracker::update(vector<cv::Rect> detections_cv, int frame_count, double
 		i++;
 	}
 }
+
+// Move the tracked objects to a frame without detections (using their motion model)
+void SortTracker::propagate(int frame_count)
+{
+	// Advance every tracker (the hit and age counters only change with detections)
+	for (unsigned int i = 0; i < trackers.size(); i++)
+		trackers[i].predict2();
+
+	// Move the trackers' output
+	for (auto it = frameTrackingResult.begin(); it != frameTrackingResult.end(); it++)
+	{
+		for (unsigned int i = 0; i < trackers.size(); i++)
+		{
+			if (trackers[i].m_id == it->id)
+			{
+				it->box = trackers[i].get_state();
+				break;
+			}
+		}
+		it->frame = frame_count;
+	}
+}
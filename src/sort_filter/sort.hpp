@@ -5,6 +5,7 @@
 #include "KalmanTracker.h"
 #include "Hungarian.h"
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <iomanip> // to format image names using setw() and setfill()
@@ -38,19 +39,21 @@ public:
 
 	// Update position based on the new frame
 	void update(std::vector<cv::Rect> detection, int frame_count, double image_diagonal, std::vector<float> confidences, std::vector<int> classIds);
+	// Move the tracked objects to a frame without detections (using their motion model)
+	void propagate(int frame_count);
 	double GetIOU(cv::Rect_<float> bb_test, cv::Rect_<float> bb_gt);
 	double GetCentroidsDistance(cv::Rect_<float> bb_test, cv::Rect_<float> bb_gt);
+	// Match the predicted boxes to the detections (fills assignment)
+	void match(const std::vector<TrackingBox> &detections, double image_diagonal);
 	std::vector<KalmanTracker> trackers;
 
 	double max_centroid_dist_norm = 0.05;
 
 	std::vector<cv::Rect_<float>> predictedBoxes;
-	std::vector<std::vector<double>> centroid_dist_matrix;
+	std::vector<double> centroid_dist_matrix; // flat (row-major) cost matrix of one group of trackers and detections
 	std::vector<int> assignment;
 	std::set<int> unmatchedDetections;
 	std::set<int> unmatchedTrajectories;
-	std::set<int> allItems;
-	std::set<int> matchedItems;
 	std::vector<cv::Point> matchedPairs;
 
 	std::vector<TrackingBox> frameTrackingResult;
@@ -0,0 +1,98 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::AllocationStats
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <memory>
+
+#include "openshot_catch.h"
+
+#include "AllocationStats.h"
+#include "RenderStats.h"
+
+using namespace openshot;
+
+TEST_CASE( "Scopes", "[libopenshot][allocationstats]" )
+{
+	CHECK(AllocationStats::ScopeName(ALLOCATION_SCOPE_READER) == "reader");
+	CHECK(AllocationStats::ScopeName(ALLOCATION_SCOPE_WRITER) == "writer");
+
+	// Scopes are set per thread, and return the previous scope
+	CHECK(AllocationStats::CurrentScope() == ALLOCATION_SCOPE_OTHER);
+	CHECK(AllocationStats::SetCurrentScope(ALLOCATION_SCOPE_CLIP) == ALLOCATION_SCOPE_OTHER);
+	CHECK(AllocationStats::SetCurrentScope(ALLOCATION_SCOPE_OTHER) == ALLOCATION_SCOPE_CLIP);
+
+	AllocationStats::Reset();
+	AllocationStats::SetCurrentScope(ALLOCATION_SCOPE_MAPPER);
+	AllocationStats::AddAllocation(100);
+	AllocationStats::AddAllocation(28);
+	AllocationStats::SetCurrentScope(ALLOCATION_SCOPE_OTHER);
+	CHECK(AllocationStats::Scope(ALLOCATION_SCOPE_MAPPER).allocations == 2);
+	CHECK(AllocationStats::Scope(ALLOCATION_SCOPE_MAPPER).bytes == 128);
+
+	AllocationStats::Reset();
+	CHECK(AllocationStats::Scope(ALLOCATION_SCOPE_MAPPER).allocations == 0);
+}
+
+TEST_CASE( "Guards", "[libopenshot][allocationstats]" )
+{
+	AllocationStats::Reset();
+	{
+		AllocationScopeGuard clip(ALLOCATION_SCOPE_CLIP);
+		{
+			AllocationScopeGuard effect(ALLOCATION_SCOPE_EFFECT);
+			std::unique_ptr<char[]> buffer(new char[1000]);
+			AllocationStats::AddImage(4000);
+			CHECK(buffer);
+		}
+		AllocationStats::AddAudioBuffer(800);
+	}
+	CHECK(AllocationStats::CurrentScope() == ALLOCATION_SCOPE_OTHER);
+
+	const AllocationScopeStats& effect = AllocationStats::Scope(ALLOCATION_SCOPE_EFFECT);
+	const AllocationScopeStats& clip = AllocationStats::Scope(ALLOCATION_SCOPE_CLIP);
+	if (AllocationStats::Enabled()) {
+		CHECK(effect.allocations >= 1);
+		CHECK(effect.bytes >= 1000);
+		CHECK(effect.images == 1);
+		CHECK(effect.image_bytes == 4000);
+		CHECK(clip.audio_buffers == 1);
+		CHECK(clip.audio_bytes == 800);
+	} else {
+		// Nothing is counted
+		CHECK(effect.allocations == 0);
+		CHECK(effect.images == 0);
+		CHECK(clip.audio_buffers == 0);
+	}
+	AllocationStats::Reset();
+}
+
+TEST_CASE( "Render stats", "[libopenshot][allocationstats]" )
+{
+	RenderStats::Instance()->Reset();
+	RenderStats::Instance()->Add(RENDER_STAGE_FRAME, 1000);
+	RenderStats::Instance()->Add(RENDER_STAGE_FRAME, 1000);
+	AllocationStats::SetCurrentScope(ALLOCATION_SCOPE_TIMELINE);
+	AllocationStats::AddAllocation(64);
+	AllocationStats::SetCurrentScope(ALLOCATION_SCOPE_OTHER);
+
+	Json::Value root = RenderStats::Instance()->JsonValue();
+	CHECK(root["allocations"]["enabled"].asBool() == AllocationStats::Enabled());
+	if (AllocationStats::Enabled()) {
+		Json::Value timeline = root["allocations"]["scopes"]["timeline"];
+		CHECK(timeline["allocations"].asInt64() >= 1);
+		CHECK(timeline["per_frame"]["allocations"].asDouble() == Detail::Approx(timeline["allocations"].asDouble() / 2));
+		CHECK(root["allocations"]["frames"].asInt64() == 2);
+	}
+
+	// Reset with the render stats
+	RenderStats::Instance()->Reset();
+	CHECK(AllocationStats::Scope(ALLOCATION_SCOPE_TIMELINE).allocations == 0);
+}
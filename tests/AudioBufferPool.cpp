@@ -0,0 +1,122 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::AudioBufferPool
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <memory>
+
+#include "openshot_catch.h"
+
+#include <AppConfig.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+
+#include "AudioBufferPool.h"
+#include "Frame.h"
+
+using namespace openshot;
+
+TEST_CASE( "Create and release", "[libopenshot][audiobufferpool]" )
+{
+	AudioBufferPool *pool = AudioBufferPool::Instance();
+	pool->Clear();
+	CHECK(pool->GetIdleBytes() == 0);
+
+	std::shared_ptr<juce::AudioBuffer<float>> buffer = pool->Create(2, 1470);
+	CHECK(buffer->getNumChannels() == 2);
+	CHECK(buffer->getNumSamples() == 1470);
+	const juce::AudioBuffer<float> *first = buffer.get();
+
+	// Released buffers are kept (rounded up to the bucket size)
+	buffer.reset();
+	CHECK(pool->GetIdleBytes() == 2 * 1536 * int64_t(sizeof(float)));
+
+	// ...and re-used for a similar number of samples
+	buffer = pool->Create(2, 1471);
+	CHECK(buffer.get() == first);
+	CHECK(buffer->getNumSamples() == 1471);
+	CHECK(pool->GetIdleBytes() == 0);
+
+	// Other channel counts get a different buffer
+	std::shared_ptr<juce::AudioBuffer<float>> mono = pool->Create(1, 1470);
+	CHECK(mono.get() != first);
+
+	buffer.reset();
+	mono.reset();
+	pool->Clear();
+	CHECK(pool->GetIdleBytes() == 0);
+}
+
+TEST_CASE( "Copy", "[libopenshot][audiobufferpool]" )
+{
+	AudioBufferPool *pool = AudioBufferPool::Instance();
+	juce::AudioBuffer<float> source(2, 100);
+	for (int channel = 0; channel < 2; channel++)
+		for (int sample = 0; sample < 100; sample++)
+			source.setSample(channel, sample, channel + sample / 100.0f);
+
+	std::shared_ptr<juce::AudioBuffer<float>> copy = pool->Copy(source);
+	CHECK(copy->getNumChannels() == 2);
+	CHECK(copy->getNumSamples() == 100);
+	CHECK(copy->getSample(1, 50) == Detail::Approx(1.5f));
+
+	copy.reset();
+	pool->Clear();
+}
+
+TEST_CASE( "Grown buffers", "[libopenshot][audiobufferpool]" )
+{
+	AudioBufferPool *pool = AudioBufferPool::Instance();
+	pool->Clear();
+
+	// A buffer which grew past its bucket returns to the bucket of its new size
+	std::shared_ptr<juce::AudioBuffer<float>> buffer = pool->Create(2, 100);
+	buffer->setSize(2, 1200, true, true, false);
+	buffer.reset();
+	CHECK(pool->GetIdleBytes() == 2 * 1024 * int64_t(sizeof(float)));
+
+	pool->Clear();
+}
+
+TEST_CASE( "Max bytes", "[libopenshot][audiobufferpool]" )
+{
+	AudioBufferPool *pool = AudioBufferPool::Instance();
+	pool->Clear();
+	int64_t original_max_bytes = pool->GetMaxBytes();
+
+	// Buffers which don't fit in the pool are freed
+	pool->SetMaxBytes(2 * 512 * sizeof(float));
+	std::shared_ptr<juce::AudioBuffer<float>> buffer1 = pool->Create(2, 500);
+	std::shared_ptr<juce::AudioBuffer<float>> buffer2 = pool->Create(2, 500);
+	buffer1.reset();
+	buffer2.reset();
+	CHECK(pool->GetIdleBytes() == 2 * 512 * int64_t(sizeof(float)));
+
+	pool->SetMaxBytes(0);
+	CHECK(pool->GetIdleBytes() == 0);
+	pool->SetMaxBytes(original_max_bytes);
+}
+
+TEST_CASE( "Frame audio", "[libopenshot][audiobufferpool]" )
+{
+	AudioBufferPool *pool = AudioBufferPool::Instance();
+	pool->Clear();
+
+	// The audio of a deleted frame is re-used by the next frame (and cleared)
+	auto frame = std::make_shared<Frame>(1, 1470, 2);
+	frame->GetAudioSampleBuffer()->setSample(0, 0, 0.5f);
+	const juce::AudioBuffer<float> *first = frame->GetAudioSampleBuffer();
+	frame.reset();
+
+	frame = std::make_shared<Frame>(2, 1471, 2);
+	CHECK(frame->GetAudioSampleBuffer() == first);
+	CHECK(frame->GetAudioSamples(0)[0] == Detail::Approx(0.0f));
+	frame.reset();
+	pool->Clear();
+}
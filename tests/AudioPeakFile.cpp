@@ -0,0 +1,111 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::AudioPeakFile
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <sstream>
+
+#include <QDir>
+#include <QFile>
+
+#include "openshot_catch.h"
+
+#include "AudioPeakFile.h"
+#include "AudioWaveformer.h"
+#include "FFmpegReader.h"
+#include "Settings.h"
+
+using namespace openshot;
+
+TEST_CASE( "Write and read a peak file", "[libopenshot][audiopeakfile]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "piano.wav";
+	FFmpegReader r(path.str());
+	r.Open();
+
+	const std::string directory = (QDir::tempPath() + QString("/peaks/")).toStdString();
+	const std::string peak_path = AudioPeakFile::GetPath(directory, path.str());
+	REQUIRE_FALSE(peak_path.empty());
+	QFile::remove(QString::fromStdString(peak_path));
+	CHECK(AudioPeakFile::Open(peak_path) == nullptr);
+
+	REQUIRE(AudioPeakFile::Create(&r, peak_path));
+	std::shared_ptr<AudioPeakFile> peaks = AudioPeakFile::Open(peak_path);
+	REQUIRE(peaks != nullptr);
+	CHECK(peaks->Channels() == r.info.channels);
+	CHECK(peaks->SampleRate() == r.info.sample_rate);
+	CHECK(peaks->Samples() == std::llround(r.info.duration * r.info.sample_rate));
+
+	// The top level is a single bucket, which summarizes the whole channel
+	int64_t count = 0;
+	const AudioPeak *top = peaks->GetBuckets(peaks->Levels() - 1, 0, count);
+	CHECK(count == 1);
+	int64_t base_count = 0;
+	const AudioPeak *base = peaks->GetBuckets(0, 0, base_count);
+	CHECK(base_count == (peaks->Samples() + AudioPeakFile::BASE_BUCKET_SIZE - 1) / AudioPeakFile::BASE_BUCKET_SIZE);
+	float base_max = 0.0;
+	for (int64_t index = 0; index < base_count; index++)
+		base_max = std::max(base_max, base[index].max);
+	CHECK(top->max == Detail::Approx(base_max));
+	CHECK(top->min <= top->max);
+
+	// Ranges are summarized from any level
+	AudioPeak whole = peaks->Read(0, 0, peaks->Samples());
+	CHECK(whole.max == Detail::Approx(base_max));
+	CHECK(whole.rms >= whole.average);
+	CHECK(peaks->Read(0, peaks->Samples(), peaks->Samples() + 100).max == 0.0f);
+
+	// Invalid files are not mapped
+	QFile garbage(QString::fromStdString(peak_path));
+	REQUIRE(garbage.open(QIODevice::WriteOnly));
+	garbage.write("not a peak file");
+	garbage.close();
+	CHECK(AudioPeakFile::Open(peak_path) == nullptr);
+	QFile::remove(QString::fromStdString(peak_path));
+
+	r.Close();
+}
+
+TEST_CASE( "Extract waveform data from a peak file", "[libopenshot][audiopeakfile]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "piano.wav";
+	FFmpegReader r(path.str());
+	r.Open();
+
+	const std::string directory = (QDir::tempPath() + QString("/peaks/")).toStdString();
+	QFile::remove(QString::fromStdString(AudioPeakFile::GetPath(directory, path.str())));
+	Settings::Instance()->AUDIO_PEAK_PATH = directory;
+
+	// The first request writes the peak file, and later requests (at any resolution) read it
+	AudioWaveformer waveformer(&r);
+	for (int pass = 0; pass < 2; pass++) {
+		AudioWaveformData waveform = waveformer.ExtractSamples(0, 20, false);
+		CHECK(waveform.rms_samples.size() == 107);
+		CHECK(waveform.rms_samples[0] == Detail::Approx(0.04879f).margin(0.001));
+		CHECK(waveform.rms_samples[86] == Detail::Approx(0.13578f).margin(0.001));
+		CHECK(waveform.rms_samples[87] == Detail::Approx(0.0f).margin(0.00001));
+		CHECK(AudioPeakFile::Open(AudioPeakFile::GetPath(directory, path.str())) != nullptr);
+	}
+
+	AudioWaveformData normalized = waveformer.ExtractSamples(-1, 5, true);
+	float largest = 0.0;
+	for (float value : normalized.max_samples)
+		largest = std::max(largest, value);
+	CHECK(largest == Detail::Approx(1.0f));
+
+	Settings::Instance()->AUDIO_PEAK_PATH = "";
+	QFile::remove(QString::fromStdString(AudioPeakFile::GetPath(directory, path.str())));
+	r.Close();
+}
@@ -0,0 +1,93 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::AudioResampler
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <cmath>
+
+#include "openshot_catch.h"
+
+#include "AudioResampler.h"
+
+using namespace openshot;
+
+// Resample a sine wave (one frame at a time), and get the RMS error of the output (after the first frames)
+static double resample_sine_error(ResampleQuality quality, int source_samples, int target_samples)
+{
+	const double period = 100.0;
+	const int delay = (quality == RESAMPLE_QUALITY_DRAFT) ? 32 : (quality == RESAMPLE_QUALITY_NORMAL) ? 64 : 128;
+	const double ratio = double(source_samples) / target_samples;
+
+	AudioResampler resampler(2);
+	resampler.SetQuality(quality);
+	juce::AudioBuffer<float> input(2, source_samples);
+	int64_t input_position = 0;
+	int64_t output_position = 0;
+	double error = 0.0;
+	int64_t count = 0;
+	for (int frame = 0; frame < 30; frame++) {
+		for (int sample = 0; sample < source_samples; sample++) {
+			const float value = std::sin(2.0 * M_PI * (input_position + sample) / period);
+			input.setSample(0, sample, value);
+			input.setSample(1, sample, -value);
+		}
+		input_position += source_samples;
+
+		resampler.SetBuffer(&input, ratio);
+		juce::AudioBuffer<float> *output = resampler.GetResampledBuffer();
+		CHECK(output->getNumSamples() == target_samples);
+		for (int sample = 0; sample < output->getNumSamples(); sample++) {
+			// Both channels are filtered the same way
+			CHECK(output->getSample(1, sample) == Detail::Approx(-output->getSample(0, sample)).margin(0.00001));
+			if (frame < 5)
+				continue;
+			const double t = (output_position + sample) * ratio - delay - 1;
+			const double expected = std::sin(2.0 * M_PI * t / period);
+			error += (expected - output->getSample(0, sample)) * (expected - output->getSample(0, sample));
+			count++;
+		}
+		output_position += output->getNumSamples();
+	}
+	return std::sqrt(error / count);
+}
+
+TEST_CASE( "Resample sine (slower)", "[libopenshot][audioresampler]" )
+{
+	CHECK(resample_sine_error(RESAMPLE_QUALITY_DRAFT, 735, 1470) < 0.01);
+	CHECK(resample_sine_error(RESAMPLE_QUALITY_NORMAL, 735, 1470) < 0.001);
+	CHECK(resample_sine_error(RESAMPLE_QUALITY_HIGH, 735, 1470) < 0.0001);
+}
+
+TEST_CASE( "Resample sine (faster)", "[libopenshot][audioresampler]" )
+{
+	CHECK(resample_sine_error(RESAMPLE_QUALITY_DRAFT, 2205, 1470) < 0.01);
+	CHECK(resample_sine_error(RESAMPLE_QUALITY_NORMAL, 2205, 1470) < 0.001);
+	CHECK(resample_sine_error(RESAMPLE_QUALITY_HIGH, 2205, 1470) < 0.0001);
+}
+
+TEST_CASE( "Filter banks", "[libopenshot][audioresampler]" )
+{
+	// Banks are shared by similar ratios (and all ratios below 1.0)
+	auto bank = ResamplerFilterBank::Get(RESAMPLE_QUALITY_NORMAL, 0.5);
+	CHECK(bank == ResamplerFilterBank::Get(RESAMPLE_QUALITY_NORMAL, 0.9));
+	CHECK(bank != ResamplerFilterBank::Get(RESAMPLE_QUALITY_HIGH, 0.5));
+
+	// Lower cutoffs (when speeding up) need longer filters
+	auto fast_bank = ResamplerFilterBank::Get(RESAMPLE_QUALITY_NORMAL, 2.0);
+	CHECK(fast_bank->half_taps > bank->half_taps);
+
+	// Each phase has a gain of 1.0
+	for (int phase = 0; phase <= bank->phases; phase += 17) {
+		double sum = 0.0;
+		for (int tap = 0; tap < bank->taps; tap++)
+			sum += bank->coefficients[phase * bank->taps + tap];
+		CHECK(sum == Detail::Approx(1.0));
+	}
+}
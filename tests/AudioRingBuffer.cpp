@@ -0,0 +1,149 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::AudioRingBuffer
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <thread>
+
+#include "openshot_catch.h"
+
+#include "AudioRingBuffer.h"
+
+using namespace openshot;
+
+// Fill a buffer with the frame number (so the samples show which frame they came from)
+static juce::AudioBuffer<float> frame_samples(int64_t frame_number, int channels, int count)
+{
+	juce::AudioBuffer<float> samples(channels, count);
+	for (int channel = 0; channel < channels; channel++)
+		juce::FloatVectorOperations::fill(samples.getWritePointer(channel), float(frame_number), count);
+	return samples;
+}
+
+TEST_CASE( "Push and Read", "[libopenshot][audioringbuffer]" )
+{
+	AudioRingBuffer ring(4);
+	int64_t frame_number = 0;
+
+	// Frames are pushed in order (starting at frame 1), until the ring is full
+	for (int f = 1; f <= 4; f++) {
+		REQUIRE(ring.NextFrame(frame_number));
+		CHECK(frame_number == f);
+		ring.Push(frame_number, frame_samples(frame_number, 2, 100), 100);
+	}
+	CHECK_FALSE(ring.NextFrame(frame_number));
+	CHECK(ring.Count() == 4);
+
+	// Blocks can span frames
+	juce::AudioBuffer<float> block(2, 150);
+	block.clear();
+	CHECK(ring.Read(block, 0, 150) == 150);
+	CHECK(block.getSample(0, 99) == 1.0f);
+	CHECK(block.getSample(1, 100) == 2.0f);
+	CHECK(ring.CurrentFrame() == 2);
+	CHECK(ring.Count() == 3);
+
+	// The rest of the queue (and nothing more)
+	juce::AudioBuffer<float> rest(2, 400);
+	rest.clear();
+	CHECK(ring.Read(rest, 0, 400) == 250);
+	CHECK(rest.getSample(0, 0) == 2.0f);
+	CHECK(rest.getSample(0, 249) == 4.0f);
+	CHECK(rest.getSample(0, 250) == 0.0f);
+	CHECK(ring.Count() == 0);
+
+	// Producer continues at the next frame
+	REQUIRE(ring.NextFrame(frame_number));
+	CHECK(frame_number == 5);
+}
+
+TEST_CASE( "Reset skips queued frames", "[libopenshot][audioringbuffer]" )
+{
+	AudioRingBuffer ring(4);
+	int64_t frame_number = 0;
+	for (int f = 1; f <= 4; f++) {
+		REQUIRE(ring.NextFrame(frame_number));
+		ring.Push(frame_number, frame_samples(frame_number, 1, 10), 10);
+	}
+
+	// Seek (the producer restarts at the new frame)
+	ring.Reset(20);
+	CHECK(ring.CurrentFrame() == 20);
+	juce::AudioBuffer<float> block(1, 10);
+	block.clear();
+	CHECK(ring.Read(block, 0, 10) == 0);
+	REQUIRE(ring.NextFrame(frame_number));
+	CHECK(frame_number == 20);
+	ring.Push(frame_number, frame_samples(frame_number, 1, 10), 10);
+	CHECK(ring.Read(block, 0, 10) == 10);
+	CHECK(block.getSample(0, 0) == 20.0f);
+
+	// Resetting to the same frame (with nothing played) is ignored
+	ring.Reset(30);
+	REQUIRE(ring.NextFrame(frame_number));
+	ring.Push(frame_number, frame_samples(frame_number, 1, 10), 10);
+	ring.Reset(30);
+	CHECK(ring.Count() == 1);
+	block.clear();
+	CHECK(ring.Read(block, 0, 10) == 10);
+	CHECK(block.getSample(0, 9) == 30.0f);
+
+	// Unless it is forced (i.e. the queued samples have the wrong sample rate)
+	ring.Reset(40);
+	REQUIRE(ring.NextFrame(frame_number));
+	ring.Push(frame_number, frame_samples(frame_number, 1, 10), 10);
+	ring.Reset(40, true);
+	block.clear();
+	CHECK(ring.Read(block, 0, 10) == 0);
+	REQUIRE(ring.NextFrame(frame_number));
+	CHECK(frame_number == 40);
+}
+
+TEST_CASE( "Producer and consumer threads", "[libopenshot][audioringbuffer]" )
+{
+	AudioRingBuffer ring(8);
+	const int64_t last_frame = 500;
+	const int samples_per_frame = 64;
+
+	// Producer thread pushes every frame once
+	std::thread producer([&]() {
+		int64_t frame_number = 0;
+		auto samples = frame_samples(0, 2, samples_per_frame);
+		while (true) {
+			if (!ring.NextFrame(frame_number)) {
+				std::this_thread::yield();
+				continue;
+			}
+			if (frame_number > last_frame)
+				break;
+			for (int s = 0; s < samples_per_frame; s++)
+				samples.setSample(0, s, float(frame_number));
+			ring.Push(frame_number, samples, samples_per_frame);
+		}
+	});
+
+	// Consumer reads odd-sized blocks, and the frames arrive in order
+	int64_t total = 0;
+	bool in_order = true;
+	juce::AudioBuffer<float> block(2, 100);
+	while (total < last_frame * samples_per_frame) {
+		block.clear();
+		int copied = ring.Read(block, 0, 100);
+		for (int s = 0; s < copied; s++)
+			in_order &= (block.getSample(0, s) == float(1 + (total + s) / samples_per_frame));
+		total += copied;
+		if (copied == 0)
+			std::this_thread::yield();
+	}
+	producer.join();
+
+	CHECK(in_order);
+	CHECK(total == last_frame * samples_per_frame);
+}
@@ -0,0 +1,115 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::AudioTimeStretcher
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+#include <cmath>
+
+#include "openshot_catch.h"
+
+#include "AudioTimeStretcher.h"
+
+using namespace openshot;
+
+// Fill a buffer with a sine wave (continuing from a sample position)
+static juce::AudioBuffer<float> sine_samples(int64_t start, int channels, int count, double period)
+{
+	juce::AudioBuffer<float> samples(channels, count);
+	for (int channel = 0; channel < channels; channel++)
+		for (int s = 0; s < count; s++)
+			samples.setSample(channel, s, float(std::sin(2.0 * M_PI * (start + s) / period)));
+	return samples;
+}
+
+// Count the rising zero crossings of a channel
+static int rising_crossings(const std::vector<float>& samples)
+{
+	int crossings = 0;
+	for (size_t s = 1; s < samples.size(); s++)
+		if (samples[s - 1] < 0.0f && samples[s] >= 0.0f)
+			crossings++;
+	return crossings;
+}
+
+TEST_CASE( "Unity speed", "[libopenshot][audiotimestretcher]" )
+{
+	AudioTimeStretcher stretcher(2, 1024);
+	juce::AudioBuffer<float> output(2, 735);
+	std::vector<float> stretched;
+
+	int64_t position = 0;
+	for (int f = 0; f < 20; f++) {
+		juce::AudioBuffer<float> source = sine_samples(position, 2, 735, 100.0);
+		position += 735;
+		stretcher.Process(source, 735, output, 735);
+		stretched.insert(stretched.end(), output.getReadPointer(0), output.getReadPointer(0) + 735);
+	}
+
+	// The output is the input (delayed by 1.25 windows, after the first segment fades in)
+	for (int s = 1792; s < 14000; s++)
+		CHECK(stretched[s] == Detail::Approx(std::sin(2.0 * M_PI * (s - 1280) / 100.0)).margin(0.001));
+}
+
+TEST_CASE( "Double speed preserves the pitch", "[libopenshot][audiotimestretcher]" )
+{
+	AudioTimeStretcher stretcher(1, 1024);
+	juce::AudioBuffer<float> output(1, 735);
+	std::vector<float> stretched;
+
+	int64_t position = 0;
+	for (int f = 0; f < 40; f++) {
+		juce::AudioBuffer<float> source = sine_samples(position, 1, 1470, 100.0);
+		position += 1470;
+		stretcher.Process(source, 1470, output, 735);
+		stretched.insert(stretched.end(), output.getReadPointer(0), output.getReadPointer(0) + 735);
+	}
+
+	// Each call returns exactly the requested samples, and the period is still 100 samples
+	CHECK(stretched.size() == 40 * 735);
+	std::vector<float> steady(stretched.begin() + 2048, stretched.end());
+	CHECK(rising_crossings(steady) == Detail::Approx(steady.size() / 100.0).margin(3));
+}
+
+TEST_CASE( "Half speed preserves the pitch", "[libopenshot][audiotimestretcher]" )
+{
+	AudioTimeStretcher stretcher(1, 1024);
+	juce::AudioBuffer<float> output(1, 735);
+	std::vector<float> stretched;
+
+	int64_t position = 0;
+	for (int f = 0; f < 40; f++) {
+		juce::AudioBuffer<float> source = sine_samples(position, 1, 367, 100.0);
+		position += 367;
+		stretcher.Process(source, 367, output, 735);
+		stretched.insert(stretched.end(), output.getReadPointer(0), output.getReadPointer(0) + 735);
+	}
+
+	// The output never runs dry (each period still reaches its peak)
+	std::vector<float> steady(stretched.begin() + 2048, stretched.end());
+	CHECK(rising_crossings(steady) == Detail::Approx(steady.size() / 100.0).margin(3));
+	for (size_t s = 0; s + 100 <= steady.size(); s += 100)
+		CHECK(*std::max_element(steady.begin() + s, steady.begin() + s + 100) > 0.9f);
+}
+
+TEST_CASE( "Reset", "[libopenshot][audiotimestretcher]" )
+{
+	AudioTimeStretcher stretcher(2, 1024);
+	juce::AudioBuffer<float> source = sine_samples(0, 2, 2000, 50.0);
+	juce::AudioBuffer<float> output(2, 1000);
+	stretcher.Process(source, 2000, output, 1000);
+	stretcher.Process(source, 2000, output, 1000);
+
+	// After a reset, the output starts with silence
+	stretcher.Reset();
+	stretcher.Process(source, 1000, output, 1000);
+	for (int s = 0; s < 1000; s++)
+		CHECK(output.getSample(1, s) == 0.0f);
+}
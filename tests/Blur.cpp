@@ -0,0 +1,68 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::Blur effect
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <memory>
+
+#include "openshot_catch.h"
+
+#include "Frame.h"
+#include "effects/Blur.h"
+
+#include <QColor>
+#include <QImage>
+
+using namespace openshot;
+
+TEST_CASE( "horizontal blur", "[libopenshot][effect][blur]" )
+{
+	// Black frame, with a white vertical line
+	auto f = std::make_shared<Frame>(1, 64, 16, "#000000");
+	std::shared_ptr<QImage> image = f->GetImage();
+	for (int y = 0; y < 16; y++)
+		image->setPixelColor(32, y, QColor(255, 255, 255));
+
+	// Only blur horizontally (an odd number of passes)
+	Blur e(Keyframe(2.0), Keyframe(0.0), Keyframe(3.0), Keyframe(3.0));
+	auto f_out = e.GetFrame(f, 1);
+	std::shared_ptr<QImage> i = f_out->GetImage();
+
+	// The line is spread out symmetrically (and not vertically)
+	CHECK(i->pixelColor(32, 8).red() < 255);
+	CHECK(i->pixelColor(32, 8).red() > i->pixelColor(34, 8).red());
+	CHECK(i->pixelColor(30, 8) == i->pixelColor(34, 8));
+	CHECK(i->pixelColor(34, 0) == i->pixelColor(34, 15));
+	CHECK(i->pixelColor(10, 8).red() == 0);
+}
+
+TEST_CASE( "downsampled blur", "[libopenshot][effect][blur]" )
+{
+	// A solid frame stays solid
+	auto f = std::make_shared<Frame>(1, 320, 180, "#2080f0");
+	Blur e(Keyframe(40.0), Keyframe(40.0), Keyframe(3.0), Keyframe(3.0));
+	e.downsample = true;
+	auto f_out = e.GetFrame(f, 1);
+	std::shared_ptr<QImage> i = f_out->GetImage();
+
+	CHECK(i->width() == 320);
+	CHECK(i->height() == 180);
+	for (QColor color : { i->pixelColor(0, 0), i->pixelColor(160, 90), i->pixelColor(319, 179) }) {
+		CHECK(color.red() == Detail::Approx(0x20).margin(1));
+		CHECK(color.green() == Detail::Approx(0x80).margin(1));
+		CHECK(color.blue() == Detail::Approx(0xf0).margin(1));
+		CHECK(color.alpha() == 255);
+	}
+
+	// Downsample is saved in JSON
+	Blur e2;
+	e2.SetJson(e.Json());
+	CHECK(e2.downsample == true);
+}
@@ -19,6 +19,7 @@
 
 #include "Clip.h"
 #include "CVStabilization.h"  // for TransformParam, CamTrajectory, CVStabilization
+#include "effects/Stabilizer.h"
 #include "ProcessingController.h"
 
 using namespace openshot;
@@ -116,4 +117,18 @@ TEST_CASE( "SaveLoad_Protobuf", "[libopenshot][opencv][stabilizer]" )
     CHECK((int) (ct_1.x * 10000) == (int) (ct_2.x * 10000));
     CHECK((int) (ct_1.y * 10000) == (int) (ct_2.y * 10000));
     CHECK((int) (ct_1.a * 10000) == (int) (ct_2.a * 10000));
+
+    // Load the same data in the Stabilizer effect (which decodes each frame on demand)
+    Stabilizer stabilizer_effect("stabilizer.data");
+    EffectTransformParam tp_3;
+    EffectCamTrajectory ct_3;
+    REQUIRE(stabilizer_effect.GetTransformParam(20, tp_3));
+    REQUIRE(stabilizer_effect.GetCamTrajectory(20, ct_3));
+    CHECK((int) (tp_1.dx * 10000) == (int) (tp_3.dx * 10000));
+    CHECK((int) (tp_1.dy * 10000) == (int) (tp_3.dy * 10000));
+    CHECK((int) (tp_1.da * 10000) == (int) (tp_3.da * 10000));
+    CHECK((int) (ct_1.x * 10000) == (int) (ct_3.x * 10000));
+    CHECK((int) (ct_1.y * 10000) == (int) (ct_3.y * 10000));
+    CHECK((int) (ct_1.a * 10000) == (int) (ct_3.a * 10000));
+    CHECK_FALSE(stabilizer_effect.GetTransformParam(1000, tp_3));
 }
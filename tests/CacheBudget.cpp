@@ -0,0 +1,131 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::CacheBudget
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <memory>
+#include <vector>
+
+#include "openshot_catch.h"
+
+#include "CacheBudget.h"
+#include "CacheMemory.h"
+#include "Frame.h"
+#include "Settings.h"
+
+using namespace openshot;
+
+// Create frames with their own pixels (128 x 128, so 64 KB each)
+static std::vector<std::shared_ptr<Frame>> create_frames(int count)
+{
+	std::vector<std::shared_ptr<Frame>> frames;
+	for (int number = 1; number <= count; number++) {
+		auto f = std::make_shared<Frame>(number, 128, 128, "#000000");
+		f->AddColor(128, 128, "#000000");
+		frames.push_back(f);
+	}
+	return frames;
+}
+
+// Add frames with their own pixels to a cache (only held by the cache)
+static void add_frames(CacheMemory& cache, int count, int first_number = 1)
+{
+	for (int number = first_number; number < first_number + count; number++) {
+		auto f = std::make_shared<Frame>(number, 128, 128, "#000000");
+		f->AddColor(128, 128, "#000000");
+		cache.Add(f);
+	}
+}
+
+TEST_CASE( "Shared buffers are counted once", "[libopenshot][cachebudget]" )
+{
+	CacheBudget *budget = CacheBudget::Instance();
+	const int64_t initial_bytes = budget->GetBytes();
+	auto frames = create_frames(10);
+
+	// The same frames in two caches (i.e. a reader and a FrameMapper)
+	CacheMemory c1;
+	CacheMemory c2;
+	for (auto f : frames) {
+		c1.Add(f);
+		c2.Add(f);
+	}
+	CHECK(c1.GetBytes() == 10 * 128 * 128 * 4);
+	CHECK(c2.GetBytes() == 10 * 128 * 128 * 4);
+	CHECK(budget->GetBytes() - initial_bytes == 10 * 128 * 128 * 4);
+	CHECK(budget->IsShared(frames[0]->GetImage()->constBits()));
+
+	// Copies of frames share their pixels (until they are changed)
+	CacheMemory c3;
+	for (auto f : frames)
+		c3.Add(std::make_shared<Frame>(*f));
+	CHECK(budget->GetBytes() - initial_bytes == 10 * 128 * 128 * 4);
+
+	// The bytes are released with the last cache
+	c1.Clear();
+	c3.Clear();
+	CHECK(budget->GetBytes() - initial_bytes == 10 * 128 * 128 * 4);
+	CHECK_FALSE(budget->IsShared(frames[0]->GetImage()->constBits()));
+	c2.Clear();
+	CHECK(budget->GetBytes() == initial_bytes);
+}
+
+TEST_CASE( "Frames which free no memory are kept", "[libopenshot][cachebudget]" )
+{
+	auto frames = create_frames(30);
+	CacheMemory c1;
+	for (auto f : frames)
+		c1.Add(f);
+
+	// The budget is exceeded by the first cache (whose frames are still held outside of it)
+	Settings::Instance()->CACHE_BUDGET_MB = 1;
+	CHECK(CacheBudget::Instance()->IsOverBudget());
+
+	// Frames held by another cache are not evicted
+	CacheMemory c2;
+	for (auto f : frames)
+		c2.Add(f);
+	CHECK(c1.Count() == 30);
+	CHECK(c2.Count() == 30);
+
+	// A cache adding new frames is reduced (but keeps its minimum frames)
+	CacheMemory c3;
+	add_frames(c3, 30);
+	CHECK(c3.Count() == CacheBudget::MIN_FRAMES);
+
+	Settings::Instance()->CACHE_BUDGET_MB = 0;
+	CHECK_FALSE(CacheBudget::Instance()->IsOverBudget());
+}
+
+TEST_CASE( "Evict across caches", "[libopenshot][cachebudget]" )
+{
+	// 2.5 MB of frames (the frames of c1 are older)
+	CacheMemory c1;
+	CacheMemory c2;
+	add_frames(c1, 24);
+	add_frames(c2, 16);
+
+	// The least recently used frames are evicted first (from any cache)
+	Settings::Instance()->CACHE_BUDGET_MB = 2;
+	CacheBudget::Instance()->Enforce();
+	CHECK(CacheBudget::Instance()->GetBytes() <= 2 * 1024 * 1024);
+	CHECK(c1.Count() == 16);
+	CHECK(c2.Count() == 16);
+	CHECK_FALSE(c1.Contains(8));
+	CHECK(c1.Contains(9));
+
+	// Caches with a lower priority are reduced first
+	c2.SetBudgetPriority(-1);
+	add_frames(c1, 8, 25);
+	CHECK(c1.Count() == 24);
+	CHECK(c2.Count() == CacheBudget::MIN_FRAMES);
+
+	Settings::Instance()->CACHE_BUDGET_MB = 0;
+}
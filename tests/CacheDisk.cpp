@@ -11,13 +11,16 @@
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
 #include <memory>
+#include <QColor>
 #include <QDir>
+#include <QFile>
 
 #include "openshot_catch.h"
 
 #include "CacheDisk.h"
 #include "Frame.h"
 #include "Json.h"
+#include "Settings.h"
 
 using namespace openshot;
 
@@ -121,6 +124,39 @@ TEST_CASE( "SetMaxBytes", "[libopenshot][cachedisk]" )
 	temp_path.removeRecursively();
 }
 
+TEST_CASE( "hit, miss and eviction counters", "[libopenshot][cachedisk]" )
+{
+	QDir temp_path = QDir::tempPath() + QString("/cache_stats/");
+	CacheDisk c(temp_path.path().toStdString(), "LZ4", 1.0, 1.0);
+
+	for (int i = 1; i <= 30; i++) {
+		auto f = std::make_shared<Frame>(i, 32, 18, "Blue", 500, 2);
+		f->AddColor(32, 18, "Blue");
+		c.Add(f);
+	}
+	CHECK(c.GetStats().insertions == 30);
+	CHECK(c.GetStats().evictions == 0);
+
+	c.GetFrame(30);
+	c.GetFrame(31);
+	CHECK(c.GetStats().hits == 1);
+	CHECK(c.GetStats().misses == 1);
+
+	// Shrink the cache (to below 20 frames), so the next frame evicts the oldest 10 frames
+	c.SetMaxBytes(c.GetBytes() / 2);
+	auto f = std::make_shared<Frame>(31, 32, 18, "Blue", 500, 2);
+	f->AddColor(32, 18, "Blue");
+	c.Add(f);
+	CHECK(c.Count() < 31);
+	CHECK(c.GetStats().evictions == 31 - c.Count());
+	CHECK(c.GetStats().evicted_bytes > 0);
+
+	c.ResetStats();
+	CHECK(c.GetStats().insertions == 0);
+
+	temp_path.removeRecursively();
+}
+
 TEST_CASE( "freshen frames", "[libopensoht][cachedisk]" )
 {
 	QDir temp_path = QDir::tempPath() + QString("/freshen-frames/");
@@ -241,3 +277,139 @@ TEST_CASE( "JSON", "[libopenshot][cachedisk]" )
 	c.Clear();
 	temp_path.removeRecursively();
 }
+
+TEST_CASE( "write behind", "[libopenshot][cachedisk]" )
+{
+	QDir temp_path = QDir::tempPath() + QString("/cache_write_behind/");
+
+	// Create cache object (PNG images are encoded by the background thread)
+	CacheDisk c(temp_path.path().toStdString(), "PNG", 1.0, 0.5);
+
+	for (int i = 1; i <= 10; i++)
+	{
+		auto f = std::make_shared<Frame>(i, 640, 360, "#0000ff", 500, 2);
+		f->AddColor(640, 360, "#0000ff");
+		f->ResizeAudio(2, 500, 44100, LAYOUT_STEREO);
+		f->AddAudioSilence(500);
+		c.Add(f);
+	}
+	CHECK(c.Count() == 10);
+
+	// Frames are loaded the same, before and after they are written
+	for (int x = 0; x < 2; x++)
+	{
+		auto f = c.GetFrame(10);
+		REQUIRE(f != nullptr);
+		CHECK(f->number == 10);
+		CHECK(f->GetWidth() == 320);
+		CHECK(f->GetHeight() == 180);
+		CHECK(f->GetImage()->pixelColor(10, 10) == QColor(0, 0, 255));
+		CHECK(f->GetAudioChannelsCount() == 2);
+		CHECK(f->GetAudioSamplesCount() == 500);
+		c.WaitForWrites();
+	}
+
+	// An image and audio file per frame
+	temp_path.refresh();
+	CHECK(temp_path.entryList(QDir::Files).size() == 20);
+	CHECK(c.GetBytes() > 0);
+
+	// Removed frames are not written (or are deleted once written)
+	auto f = std::make_shared<Frame>(11, 640, 360, "#0000ff");
+	c.Add(f);
+	c.Remove(11);
+	c.WaitForWrites();
+	temp_path.refresh();
+	CHECK(temp_path.entryList(QDir::Files).size() == 20);
+	CHECK(c.GetFrame(11) == nullptr);
+
+	// Without write-behind, frames are written by Add
+	Settings::Instance()->CACHE_DISK_WRITE_BEHIND_FRAMES = 0;
+	c.Add(std::make_shared<Frame>(12, 640, 360, "#0000ff"));
+	CHECK(QFile::exists(temp_path.filePath("12.png")));
+	Settings::Instance()->CACHE_DISK_WRITE_BEHIND_FRAMES = 8;
+
+	c.Clear();
+	temp_path.removeRecursively();
+}
+
+TEST_CASE( "RAW segment files", "[libopenshot][cachedisk]" )
+{
+	QDir temp_path = QDir::tempPath() + QString("/cache_raw/");
+
+	// Create cache object (raw RGBA, stored in segment files)
+	CacheDisk c(temp_path.path().toStdString(), "RAW", 1.0, 0.25);
+
+	for (int i = 1; i <= 30; i++)
+	{
+		auto f = std::make_shared<Frame>(i, 1280, 720, "#0000ff", 500, 2);
+		f->AddColor(1280, 720, "#0000ff");
+		f->ResizeAudio(2, 500, 44100, LAYOUT_STEREO);
+		f->AddAudioSilence(500);
+		f->GetAudioSamples(1)[10] = 0.5f;
+		c.Add(f);
+	}
+	CHECK(c.Count() == 30);
+
+	// All frames share a single segment file (instead of 2 files per frame)
+	temp_path.refresh();
+	CHECK(temp_path.entryList(QDir::Files).size() == 1);
+
+	// Read frame from disk cache
+	auto f = c.GetFrame(5);
+	REQUIRE(f != nullptr);
+	CHECK(f->number == 5);
+	CHECK(f->GetWidth() == 320);
+	CHECK(f->GetHeight() == 180);
+	CHECK(f->GetImage()->pixelColor(10, 10) == QColor(0, 0, 255));
+	CHECK(f->GetAudioChannelsCount() == 2);
+	CHECK(f->GetAudioSamplesCount() == 500);
+	CHECK(f->ChannelsLayout() == LAYOUT_STEREO);
+	CHECK(f->SampleRate() == 44100);
+	CHECK(f->GetAudioSamples(1)[10] == Detail::Approx(0.5f).margin(0.00001));
+
+	// Exact size of each frame is known (image + audio)
+	CHECK(c.GetBytes() >= 30 * (320 * 180 * 4 + 2 * 500 * 4));
+
+	// Remove frames
+	c.Remove(1, 10);
+	CHECK(c.Count() == 20);
+	CHECK(c.GetFrame(5) == nullptr);
+	CHECK(c.GetFrame(15) != nullptr);
+
+	// Clean up old frames (based on max bytes)
+	c.SetMaxBytes(1);
+	c.Add(std::make_shared<Frame>(31, 1280, 720, "#0000ff", 500, 2));
+	CHECK(c.Count() == 20);
+	CHECK(c.GetFrame(11) == nullptr);
+
+	// Clear cache (all segment files are deleted)
+	c.Clear();
+	CHECK(c.Count() == 0);
+	CHECK(c.GetBytes() == 0);
+	temp_path.refresh();
+	CHECK(temp_path.entryList(QDir::Files).size() == 0);
+
+	temp_path.removeRecursively();
+}
+
+TEST_CASE( "LZ4 segment files", "[libopenshot][cachedisk]" )
+{
+	QDir temp_path = QDir::tempPath() + QString("/cache_lz4/");
+
+	// Create cache object (compressed with LZ4, if available)
+	CacheDisk c(temp_path.path().toStdString(), "LZ4", 1.0, 1.0);
+
+	auto f1 = std::make_shared<Frame>(1, 640, 360, "#ff0000", 500, 2);
+	f1->AddColor(640, 360, "#ff0000");
+	c.Add(f1);
+
+	auto f = c.GetFrame(1);
+	REQUIRE(f != nullptr);
+	CHECK(f->GetWidth() == 640);
+	CHECK(f->GetHeight() == 360);
+	CHECK(f->GetImage()->pixelColor(320, 180) == QColor(255, 0, 0));
+
+	c.Clear();
+	temp_path.removeRecursively();
+}
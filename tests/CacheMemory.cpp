@@ -10,7 +10,10 @@
 //
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
+#include <atomic>
 #include <memory>
+#include <thread>
+#include <vector>
 #include <QDir>
 
 #include "openshot_catch.h"
@@ -18,6 +21,7 @@
 #include "CacheMemory.h"
 #include "Frame.h"
 #include "Json.h"
+#include "Settings.h"
 
 using namespace openshot;
 
@@ -294,7 +298,256 @@ TEST_CASE( "multiple remove", "[libopenshot][cachememory]" )
 	CHECK(c.Count() == 0);
 }
 
+TEST_CASE( "GetBytes and LRU order", "[libopenshot][cachememory]" )
+{
+	// Create cache object
+	CacheMemory c;
+
+	auto f1 = std::make_shared<Frame>(1, 320, 240, "Blue", 500, 2);
+	auto f2 = std::make_shared<Frame>(2, 640, 480, "Blue", 500, 2);
+	auto f3 = std::make_shared<Frame>(3, 1280, 720, "Blue", 500, 2);
+	c.Add(f1);
+	c.Add(f2);
+	c.Add(f3);
 
+	// Byte count is maintained as frames are added and removed
+	CHECK(c.GetBytes() == f1->GetBytes() + f2->GetBytes() + f3->GetBytes());
+	c.Remove(2);
+	CHECK(c.GetBytes() == f1->GetBytes() + f3->GetBytes());
+	c.Clear();
+	CHECK(c.GetBytes() == 0);
+
+	// Limit the cache to the size of 20 frames
+	auto frame_bytes = std::make_shared<Frame>(1, 320, 240, "Blue", 500, 2)->GetBytes();
+	c.SetMaxBytes(20 * frame_bytes);
+	for (int i = 1; i <= 20; i++)
+		c.Add(std::make_shared<Frame>(i, 320, 240, "Blue", 500, 2));
+
+	// Touch frame #1, so frame #2 is now the oldest frame
+	c.MoveToFront(1);
+	c.Add(std::make_shared<Frame>(21, 320, 240, "Blue", 500, 2));
+
+	CHECK(c.Count() == 20);
+	CHECK(c.Contains(1));
+	CHECK_FALSE(c.Contains(2));
+	CHECK(c.GetBytes() == 20 * frame_bytes);
+}
+
+
+
+TEST_CASE( "hit, miss and eviction counters", "[libopenshot][cachememory]" )
+{
+	CacheMemory c;
+	auto frame_bytes = std::make_shared<Frame>(1, 320, 240, "Blue", 500, 2)->GetBytes();
+	c.SetMaxBytes(20 * frame_bytes);
+
+	// 25 new frames (5 are evicted), and a frame which is already cached
+	for (int i = 1; i <= 25; i++)
+		c.Add(std::make_shared<Frame>(i, 320, 240, "Blue", 500, 2));
+	c.Add(std::make_shared<Frame>(25, 320, 240, "Blue", 500, 2));
+	c.GetFrame(25);
+	c.GetFrame(24);
+	c.GetFrame(1);
+
+	CacheStats stats = c.GetStats();
+	CHECK(stats.insertions == 25);
+	CHECK(stats.evictions == 5);
+	CHECK(stats.evicted_bytes == 5 * frame_bytes);
+	CHECK(stats.hits == 2);
+	CHECK(stats.misses == 1);
+
+	Json::Value root = stats.JsonValue();
+	CHECK(root["hits"].asInt64() == 2);
+	CHECK(root["hit_rate"].asDouble() == Detail::Approx(2.0 / 3.0));
+
+	// The lock time is only measured with the render stats
+	CHECK(stats.lock_held_ns == 0);
+	Settings::Instance()->ENABLE_RENDER_STATS = true;
+	c.GetFrame(25);
+	Settings::Instance()->ENABLE_RENDER_STATS = false;
+	CHECK(c.GetStats().lock_held_ns > 0);
+
+	c.ResetStats();
+	CHECK(c.GetStats().hits == 0);
+	CHECK(c.GetStats().lock_held_ns == 0);
+}
+
+TEST_CASE( "eviction policies", "[libopenshot][cachememory]" )
+{
+	auto frame_bytes = std::make_shared<Frame>(1, 320, 240, "Blue", 500, 2)->GetBytes();
+
+	// LRU (the default) evicts the oldest frames, even if they were used
+	CacheMemory lru(25 * frame_bytes);
+	CHECK(lru.GetEvictionPolicy() == CACHE_EVICT_LRU);
+	for (int i = 1; i <= 10; i++)
+		lru.Add(std::make_shared<Frame>(i, 320, 240, "Blue", 500, 2));
+	for (int i = 1; i <= 10; i++)
+		lru.GetFrame(i);
+	for (int i = 11; i <= 60; i++)
+		lru.Add(std::make_shared<Frame>(i, 320, 240, "Blue", 500, 2));
+	CHECK(lru.Count() == 25);
+	CHECK_FALSE(lru.Contains(1));
+
+	// 2Q keeps the frames which were used again (while scanning through many frames)
+	CacheMemory two_queues(25 * frame_bytes);
+	two_queues.SetEvictionPolicy(CACHE_EVICT_2Q);
+	for (int i = 1; i <= 10; i++)
+		two_queues.Add(std::make_shared<Frame>(i, 320, 240, "Blue", 500, 2));
+	for (int i = 1; i <= 10; i++)
+		two_queues.GetFrame(i);
+	for (int i = 11; i <= 60; i++)
+		two_queues.Add(std::make_shared<Frame>(i, 320, 240, "Blue", 500, 2));
+	CHECK(two_queues.Count() == 25);
+	for (int i = 1; i <= 10; i++)
+		CHECK(two_queues.Contains(i));
+	CHECK_FALSE(two_queues.Contains(11));
+	CHECK(two_queues.Contains(60));
+
+	// Playhead evicts the farthest frames (frames behind the playhead count double)
+	CacheMemory playhead(25 * frame_bytes);
+	playhead.SetEvictionPolicy(CACHE_EVICT_PLAYHEAD);
+	for (int i = 1; i <= 25; i++)
+		playhead.Add(std::make_shared<Frame>(i, 320, 240, "Blue", 500, 2));
+	playhead.SetPlayhead(10, 1);
+	playhead.Add(std::make_shared<Frame>(26, 320, 240, "Blue", 500, 2));
+	CHECK(playhead.Count() == 25);
+	CHECK_FALSE(playhead.Contains(1));
+	CHECK(playhead.Contains(26));
+
+	// Playing backward, the frames ahead (lower numbers) are kept
+	playhead.SetPlayhead(14, -1);
+	playhead.Add(std::make_shared<Frame>(27, 320, 240, "Blue", 500, 2));
+	CHECK_FALSE(playhead.Contains(27));
+	CHECK(playhead.Contains(2));
+}
+
+TEST_CASE( "compressed frames", "[libopenshot][cachememory]" )
+{
+	CacheMemory c;
+	CHECK_FALSE(c.IsCompressionEnabled());
+	c.SetCompression(true, 2);
+	CHECK(c.IsCompressionEnabled());
+
+	// Add some frames (with some audio)
+	float samples[500];
+	for (int s = 0; s < 500; s++)
+		samples[s] = s / 500.0;
+	for (int i = 1; i <= 5; i++) {
+		auto f = std::make_shared<Frame>(i, 320, 240, "Blue", 500, 2);
+		f->AddAudio(true, 1, 0, samples, 500, 1.0);
+		c.Add(f);
+	}
+	CHECK(c.Count() == 5);
+
+	// Frames are decompressed when needed
+	auto f1 = c.GetFrame(1);
+	REQUIRE(f1 != nullptr);
+	CHECK(f1->number == 1);
+	CHECK(f1->GetWidth() == 320);
+	CHECK(f1->GetHeight() == 240);
+	CHECK(f1->GetAudioSamples(1)[100] == Detail::Approx(samples[100]));
+
+#if USE_LZ4
+	// Only the 2 most recently used frames are uncompressed (the solid color images compress well)
+	auto frame_bytes = std::make_shared<Frame>(1, 320, 240, "Blue", 500, 2)->GetBytes();
+	CHECK(c.GetBytes() < 3 * frame_bytes);
+	CHECK(f1->GetImage()->pixelColor(160, 120) == QColor("Blue"));
+#endif
+
+	// Disabling compression keeps the frames
+	c.SetCompression(false);
+	CHECK_FALSE(c.IsCompressionEnabled());
+	CHECK(c.Count() == 5);
+	CHECK(c.GetFrame(3) != nullptr);
+	CHECK(c.GetFrames().size() == 5);
+}
+
+TEST_CASE( "lock-free lookups", "[libopenshot][cachememory]" )
+{
+	CacheMemory c;
+	CHECK_FALSE(c.IsLockFreeLookupEnabled());
+	for (int i = 1; i <= 10; i++)
+		c.Add(std::make_shared<Frame>(i, 320, 240, "Blue", 500, 2));
+	c.SetLockFreeLookup(true);
+	CHECK(c.IsLockFreeLookupEnabled());
+
+	// Frames added before and after enabling are found (and counted as hits)
+	c.Add(std::make_shared<Frame>(11, 320, 240, "Blue", 500, 2));
+	CHECK(c.GetFrame(1)->number == 1);
+	CHECK(c.GetFrame(11)->number == 11);
+	CHECK(c.Contains(5));
+	CHECK(c.GetStats().hits == 2);
+
+	// Frames which map to the same slot are both found
+	c.Add(std::make_shared<Frame>(5 + 1024, 320, 240, "Blue", 500, 2));
+	CHECK(c.GetFrame(5)->number == 5);
+	CHECK(c.GetFrame(5 + 1024)->number == 5 + 1024);
+
+	// Removed frames are no longer found
+	c.Remove(5 + 1024);
+	CHECK_FALSE(c.Contains(5 + 1024));
+	CHECK(c.GetFrame(5 + 1024) == nullptr);
+	c.Clear();
+	CHECK_FALSE(c.Contains(1));
+
+	// Frames are found while other threads add and remove frames
+	std::atomic<bool> stop(false);
+	std::atomic<int> wrong_frames(0);
+	for (int i = 1; i <= 10; i++)
+		c.Add(std::make_shared<Frame>(i, 32, 24, "Blue", 0, 2));
+	std::vector<std::thread> readers;
+	for (int t = 0; t < 4; t++) {
+		readers.emplace_back([&c, &stop, &wrong_frames]() {
+			while (!stop) {
+				for (int i = 1; i <= 20; i++) {
+					std::shared_ptr<Frame> f = c.GetFrame(i);
+					if ((i <= 10 && !f) || (f && f->number != i))
+						wrong_frames++;
+				}
+			}
+		});
+	}
+	for (int round = 0; round < 200; round++) {
+		for (int i = 11; i <= 20; i++)
+			c.Add(std::make_shared<Frame>(i, 32, 24, "Blue", 0, 2));
+		c.Remove(11, 20);
+	}
+	stop = true;
+	for (auto& reader : readers)
+		reader.join();
+	CHECK(wrong_frames == 0);
+
+	// 2Q reorders frames on each hit, so its lookups lock the cache (but still find the frames)
+	c.SetEvictionPolicy(CACHE_EVICT_2Q);
+	CHECK(c.GetFrame(3)->number == 3);
+	c.SetEvictionPolicy(CACHE_EVICT_LRU);
+	CHECK(c.GetFrame(3)->number == 3);
+}
+
+TEST_CASE( "GetBytes with shared images", "[libopenshot][cachememory]" )
+{
+	// Create cache object
+	CacheMemory c;
+
+	// Two frames which share the same image (i.e. a held frame)
+	auto f1 = std::make_shared<Frame>(1, 320, 240, "Blue", 500, 2);
+	f1->AddColor(320, 240, "Blue");
+	auto f2 = std::make_shared<Frame>(2, 320, 240, "Blue", 500, 2);
+	f2->AddImage(f1->GetImage());
+
+	// The shared image is only counted once
+	const int64_t image_bytes = 320 * 240 * 4;
+	const int64_t audio_bytes = 500 * 2 * sizeof(float);
+	c.Add(f1);
+	c.Add(f2);
+	CHECK(c.GetBytes() == image_bytes + 2 * audio_bytes);
+
+	// Until the last frame using it is removed
+	c.Remove(1);
+	CHECK(c.GetBytes() == image_bytes + audio_bytes);
+	c.Remove(2);
+	CHECK(c.GetBytes() == 0);
+}
 
 TEST_CASE( "JSON", "[libopenshot][cachememory]" )
 {
@@ -331,4 +584,53 @@ TEST_CASE( "JSON", "[libopenshot][cachememory]" )
 	CHECK((int)c.JsonValue()["ranges"].size() == 1);
 	CHECK(c.JsonValue()["version"].asString() == "5");
 
+	// The JSON text is compact (and parses back to the same ranges)
+	const std::string json = c.Json();
+	CHECK(json.find('\n') == std::string::npos);
+	CHECK(openshot::stringToJson(json)["ranges"] == c.JsonValue()["ranges"]);
+	CHECK(openshot::jsonToString(openshot::stringToJson(json)) == json);
+}
+
+TEST_CASE( "GetRanges", "[libopenshot][cachememory]" )
+{
+	CacheMemory c;
+	CHECK(c.GetRanges().empty());
+
+	// Add frames 1-3 and 5 (out of order)
+	for (int64_t number : {3, 1, 5, 2})
+		c.Add(std::make_shared<Frame>(number, 320, 240, "#000000", 500, 2));
+	std::vector<CacheRange> ranges = c.GetRanges();
+	REQUIRE(ranges.size() == 2);
+	CHECK(ranges[0].start == 1);
+	CHECK(ranges[0].end == 3);
+	CHECK(ranges[1].start == 5);
+	CHECK(ranges[1].end == 5);
+
+	// The version only changes when the ranges change
+	const int64_t version = c.GetRangeVersion();
+	CHECK(c.GetRangeVersion() == version);
+	c.Add(std::make_shared<Frame>(3, 320, 240, "#000000", 500, 2));
+	CHECK(c.GetRangeVersion() == version);
+
+	// Removing a frame splits its range
+	c.Remove(2);
+	ranges = c.GetRanges();
+	REQUIRE(ranges.size() == 3);
+	CHECK(ranges[0].start == 1);
+	CHECK(ranges[0].end == 1);
+	CHECK(ranges[1].start == 3);
+	CHECK(ranges[1].end == 3);
+	CHECK(c.GetRangeVersion() == version + 1);
+
+	// Adding the missing frame joins the ranges again
+	c.Add(std::make_shared<Frame>(4, 320, 240, "#000000", 500, 2));
+	ranges = c.GetRanges();
+	REQUIRE(ranges.size() == 2);
+	CHECK(ranges[1].start == 3);
+	CHECK(ranges[1].end == 5);
+
+	// An empty cache has no ranges
+	c.Clear();
+	CHECK(c.GetRanges().empty());
+	CHECK(c.JsonValue()["ranges"].size() == 0);
 }
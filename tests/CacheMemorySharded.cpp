@@ -0,0 +1,126 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::CacheMemorySharded
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <memory>
+
+#include "openshot_catch.h"
+
+#include "CacheMemory.h"
+#include "CacheMemorySharded.h"
+#include "Frame.h"
+#include "Json.h"
+
+using namespace openshot;
+
+TEST_CASE( "default constructor", "[libopenshot][cachememorysharded]" )
+{
+	// Create cache object (with 4 shards)
+	CacheMemorySharded c(4);
+
+	// Loop 50 times
+	for (int i = 0; i < 50; i++)
+	{
+		// Add blank frame to the cache
+		auto f = std::make_shared<Frame>();
+		f->number = i;
+		c.Add(f);
+	}
+
+	CHECK(c.GetShardCount() == 4);
+	CHECK(c.Count() == 50); // Cache should have all frames, with no limit
+	CHECK(c.GetMaxBytes() == 0); // Max frames should default to 0
+}
+
+TEST_CASE( "GetFrame and Remove", "[libopenshot][cachememorysharded]" )
+{
+	CacheMemorySharded c(3);
+
+	// Add frames to cache
+	for (int i = 1; i <= 20; i++)
+		c.Add(std::make_shared<Frame>(i, 320, 240, "Blue", 500, 2));
+
+	CHECK(c.Contains(7));
+	CHECK(c.GetFrame(7)->number == 7);
+	CHECK(c.GetFrame(21) == nullptr);
+	CHECK(c.GetSmallestFrame()->number == 1);
+
+	// Frames are returned in order (across all shards)
+	auto frames = c.GetFrames();
+	REQUIRE(frames.size() == 20);
+	CHECK(frames.front()->number == 1);
+	CHECK(frames.back()->number == 20);
+
+	// Remove a single frame and a range
+	c.Remove(1);
+	c.Remove(5, 10);
+	CHECK(c.Count() == 13);
+	CHECK_FALSE(c.Contains(1));
+	CHECK_FALSE(c.Contains(8));
+	CHECK(c.GetSmallestFrame()->number == 2);
+
+	// Clear cache
+	c.Clear();
+	CHECK(c.Count() == 0);
+	CHECK(c.GetBytes() == 0);
+}
+
+TEST_CASE( "SetMaxBytes", "[libopenshot][cachememorysharded]" )
+{
+	CacheMemorySharded c(4, 8 * 1024);
+	CHECK(c.GetMaxBytes() == 8 * 1024);
+
+	c.SetMaxBytesFromInfo(100, 1280, 720, 44100, 2);
+	CHECK(c.GetMaxBytes() == 100 * (1280 * 720 * 4 + 44100 * 2 * 4));
+}
+
+TEST_CASE( "max bytes of many shards", "[libopenshot][cachememorysharded]" )
+{
+	// The bytes of a single frame
+	CacheMemory single;
+	single.Add(std::make_shared<Frame>(1, 320, 240, "Blue", 500, 2));
+	const int64_t frame_bytes = single.GetBytes();
+	REQUIRE(frame_bytes > 0);
+
+	// The frames every shard keeps add up to about 20 frames (not 20 frames per shard)
+	CacheMemorySharded c(16, 24 * frame_bytes);
+	for (int i = 1; i <= 200; i++)
+		c.Add(std::make_shared<Frame>(i, 320, 240, "Blue", 500, 2));
+	CHECK(c.Count() <= 32);
+	CHECK(c.GetBytes() <= 32 * frame_bytes);
+	CHECK(c.GetBytes() <= c.GetMaxBytes() + 16 * frame_bytes);
+
+	// With fewer shards, the max bytes are kept exactly
+	CacheMemorySharded few(2, 24 * frame_bytes);
+	for (int i = 1; i <= 200; i++)
+		few.Add(std::make_shared<Frame>(i, 320, 240, "Blue", 500, 2));
+	CHECK(few.GetBytes() <= few.GetMaxBytes());
+	CHECK(few.Count() >= 20);
+}
+
+TEST_CASE( "JSON", "[libopenshot][cachememorysharded]" )
+{
+	CacheMemorySharded c(2);
+
+	// Add some frames (out of order)
+	c.Add(std::make_shared<Frame>(3, 1280, 720, "Blue", 500, 2));
+	CHECK((int)c.JsonValue()["ranges"].size() == 1);
+	CHECK(c.JsonValue()["version"].asString() == "1");
+
+	c.Add(std::make_shared<Frame>(1, 1280, 720, "Blue", 500, 2));
+	CHECK((int)c.JsonValue()["ranges"].size() == 2);
+	CHECK(c.JsonValue()["version"].asString() == "2");
+
+	c.Add(std::make_shared<Frame>(2, 1280, 720, "Blue", 500, 2));
+	CHECK((int)c.JsonValue()["ranges"].size() == 1);
+	CHECK(c.JsonValue()["version"].asString() == "3");
+	CHECK(c.JsonValue()["shards"].asInt() == 2);
+}
@@ -0,0 +1,132 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::CacheTiered
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <memory>
+#include <QDir>
+
+#include "openshot_catch.h"
+
+#include "CacheTiered.h"
+#include "Frame.h"
+#include "Json.h"
+
+using namespace openshot;
+
+// Create a frame with image and audio data
+static std::shared_ptr<Frame> CreateTestFrame(int64_t number) {
+	auto f = std::make_shared<Frame>(number, 320, 240, "#0000ff", 500, 2);
+	f->AddColor(320, 240, "#0000ff");
+	f->ResizeAudio(2, 500, 44100, LAYOUT_STEREO);
+	f->AddAudioSilence(500);
+	return f;
+}
+
+TEST_CASE( "spill and promote", "[libopenshot][cachetiered]" )
+{
+	QDir temp_path = QDir::tempPath() + QString("/cache_tiered/");
+
+	// Memory tier holds ~25 frames
+	int64_t frame_bytes = CreateTestFrame(1)->GetBytes();
+	CacheTiered c(frame_bytes * 25, 0, temp_path.path().toStdString());
+	CHECK(c.GetMaxBytes() == frame_bytes * 25);
+
+	for (int i = 1; i <= 60; i++)
+		c.Add(CreateTestFrame(i));
+	c.WaitForSpill();
+
+	// Older frames moved to disk (instead of being dropped)
+	CHECK(c.Count() == 60);
+	CHECK(c.GetMemoryCache()->Count() < 60);
+	CHECK(c.GetDiskCache()->Count() >= 30);
+	CHECK_FALSE(c.GetMemoryCache()->Contains(1));
+	CHECK(c.Contains(1));
+
+	// Frames on disk are promoted back into memory
+	auto f = c.GetFrame(1);
+	REQUIRE(f != nullptr);
+	CHECK(f->number == 1);
+	CHECK(f->GetWidth() == 320);
+	CHECK(f->GetHeight() == 240);
+	CHECK(f->GetAudioSamplesCount() == 500);
+	CHECK(c.GetMemoryCache()->Contains(1));
+	CHECK(c.GetSmallestFrame()->number == 1);
+
+	// Remove frames from both tiers
+	c.Remove(1, 10);
+	c.WaitForSpill();
+	CHECK(c.Count() == 50);
+	CHECK_FALSE(c.Contains(1));
+	CHECK_FALSE(c.Contains(10));
+	CHECK(c.GetFrame(5) == nullptr);
+	CHECK(c.Contains(11));
+
+	// Clear both tiers
+	c.Clear();
+	CHECK(c.Count() == 0);
+	CHECK(c.GetFrame(30) == nullptr);
+
+	temp_path.removeRecursively();
+}
+
+TEST_CASE( "spill queue is bounded", "[libopenshot][cachetiered]" )
+{
+	QDir temp_path = QDir::tempPath() + QString("/cache_tiered_bounded/");
+
+	// The memory tier holds ~4 frames, so the queue of frames waiting for the disk holds ~2 frames
+	int64_t frame_bytes = CreateTestFrame(1)->GetBytes();
+	CacheTiered c(frame_bytes * 4, 0, temp_path.path().toStdString());
+
+	// Adding frames waits for the disk tier (instead of queueing every evicted frame)
+	for (int i = 1; i <= 60; i++) {
+		c.Add(CreateTestFrame(i));
+		CHECK(c.GetBytes() - c.GetMemoryCache()->GetBytes() - c.GetDiskCache()->GetBytes() <= frame_bytes * 3);
+	}
+	c.WaitForSpill();
+
+	// No frames are lost
+	CHECK(c.Count() == 60);
+	CHECK(c.Contains(1));
+
+	c.Clear();
+	temp_path.removeRecursively();
+}
+
+TEST_CASE( "JSON", "[libopenshot][cachetiered]" )
+{
+	QDir temp_path = QDir::tempPath() + QString("/cache_tiered_json/");
+
+	int64_t frame_bytes = CreateTestFrame(1)->GetBytes();
+	CacheTiered c(frame_bytes * 25, 0, temp_path.path().toStdString());
+
+	// Ranges include frames in both tiers
+	for (int i = 1; i <= 40; i++)
+		c.Add(CreateTestFrame(i));
+	for (int i = 51; i <= 60; i++)
+		c.Add(CreateTestFrame(i));
+	c.WaitForSpill();
+
+	Json::Value root = c.JsonValue();
+	CHECK(root["type"].asString() == "CacheTiered");
+	REQUIRE((int)root["ranges"].size() == 2);
+	CHECK(root["ranges"][0]["start"].asString() == "1");
+	CHECK(root["ranges"][0]["end"].asString() == "40");
+	CHECK(root["ranges"][1]["start"].asString() == "51");
+	CHECK(root["ranges"][1]["end"].asString() == "60");
+
+	// Set max bytes (of the memory tier) from JSON
+	c.SetJson("{\"max_bytes\": \"1000\"}");
+	CHECK(c.GetMaxBytes() == 1000);
+	CHECK(c.GetMemoryCache()->GetMaxBytes() == 1000);
+
+	c.Clear();
+	temp_path.removeRecursively();
+}
@@ -0,0 +1,100 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::Calibration
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+
+#include <QDir>
+#include <QFile>
+
+#include "openshot_catch.h"
+
+#include "Calibration.h"
+#include "OpenMPUtilities.h"
+#include "RenderStats.h"
+#include "Settings.h"
+
+using namespace openshot;
+
+TEST_CASE( "Run and keep the results", "[libopenshot][calibration]" )
+{
+	Settings *s = Settings::Instance();
+	const int omp_threads = s->OMP_THREADS;
+	const int ff_threads = s->FF_THREADS;
+	const int cache_threads = s->VIDEO_CACHE_THREADS;
+	const QString path = QDir::tempPath() + QString("/calibration-test.json");
+	QFile::remove(path);
+	s->CALIBRATION_PATH = path.toStdString();
+	CHECK_FALSE(Calibration::Load());
+
+	// Only the composite probe (test patterns, and no encoder)
+	Json::Value result = Calibration::Run(NULL, 4, "");
+	const int cores = std::max(2, omp_get_num_procs());
+	REQUIRE(result["OMP_THREADS"].isInt());
+	CHECK(result["OMP_THREADS"].asInt() >= 2);
+	CHECK(result["OMP_THREADS"].asInt() <= cores);
+	CHECK(result["FF_THREADS"].isNull());
+	CHECK(result["composite_ms"].asDouble() > 0.0);
+	CHECK(result["VIDEO_CACHE_THREADS"].asInt() >= 1);
+	CHECK(result["VIDEO_CACHE_MAX_PREROLL_FRAMES"].asInt() > result["VIDEO_CACHE_MIN_PREROLL_FRAMES"].asInt());
+	CHECK(s->OMP_THREADS == result["OMP_THREADS"].asInt());
+	CHECK(s->FF_THREADS == ff_threads);
+	CHECK(QFile::exists(path));
+
+	// The next session applies the results of this machine
+	s->OMP_THREADS = omp_threads;
+	s->VIDEO_CACHE_THREADS = cache_threads;
+	CHECK(Calibration::Load());
+	CHECK(s->OMP_THREADS == result["OMP_THREADS"].asInt());
+	CHECK(s->VIDEO_CACHE_THREADS == result["VIDEO_CACHE_THREADS"].asInt());
+
+	QFile::remove(path);
+	s->CALIBRATION_PATH = "";
+	s->OMP_THREADS = omp_threads;
+	s->VIDEO_CACHE_THREADS = cache_threads;
+	s->VIDEO_CACHE_MIN_PREROLL_FRAMES = 24;
+	s->VIDEO_CACHE_MAX_PREROLL_FRAMES = 48;
+}
+
+TEST_CASE( "Adjust while rendering", "[libopenshot][calibration]" )
+{
+	Settings *s = Settings::Instance();
+	const int ff_threads = s->FF_THREADS;
+	s->ENABLE_RENDER_STATS = true;
+	s->ENABLE_AUTO_TUNING = true;
+	s->FF_THREADS = 2;
+	RenderStats *stats = RenderStats::Instance();
+	stats->Reset();
+	Calibration::Adjust();
+	const int cores = std::max(2, omp_get_num_procs());
+
+	// 100 frames where decoding takes most of the time: the decoders get more threads
+	for (int frame = 0; frame < 100; frame++) {
+		stats->Add(RENDER_STAGE_FRAME, 10000000);
+		stats->Add(RENDER_STAGE_DECODE, 8000000);
+		stats->Add(RENDER_STAGE_COMPOSITE, 1000000);
+	}
+	Calibration::Adjust();
+	CHECK(s->FF_THREADS == std::min(4, cores));
+
+	// The next 100 frames are slower: the step is undone
+	for (int frame = 0; frame < 100; frame++) {
+		stats->Add(RENDER_STAGE_FRAME, 20000000);
+		stats->Add(RENDER_STAGE_DECODE, 16000000);
+	}
+	Calibration::Adjust();
+	CHECK(s->FF_THREADS == 2);
+
+	stats->Reset();
+	s->ENABLE_AUTO_TUNING = false;
+	s->ENABLE_RENDER_STATS = false;
+	s->FF_THREADS = ff_threads;
+}
@@ -227,6 +227,44 @@ TEST_CASE( "caption effect", "[libopenshot][caption]" )
         clip1.Close();
     }
 
+    SECTION("caption layout is re-used until the text changes") {
+        // Create an empty caption
+        openshot::Caption c1;
+
+        // Load clip with video
+        std::stringstream path;
+        path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+        openshot::Clip clip1(path.str());
+        clip1.Open();
+
+        // Add Caption effect
+        clip1.AddEffect(&c1);
+
+#ifdef _WIN32
+        // Windows pixel location
+        check_col = 625;
+        check_row = 600;
+#else
+        // Linux/Mac pixel location
+        check_col = 251;
+        check_row = 572;
+#endif
+
+        // Consecutive frames draw the same (cached) text
+        std::shared_ptr<openshot::Frame> f = clip1.GetFrame(10);
+        CHECK((int) f->GetPixels(check_row)[check_col * 4] == 255);
+        f = clip1.GetFrame(11);
+        CHECK((int) f->GetPixels(check_row)[check_col * 4] == 255);
+
+        // New text (which starts later) is shaped again
+        c1.CaptionText("00:00:10:000 --> 00:10:00:000\nEdit this caption with our caption editor");
+        f = clip1.GetFrame(12);
+        CHECK((int) f->GetPixels(check_row)[check_col * 4] != 255);
+
+        // Close objects
+        clip1.Close();
+    }
+
     // Close QApplication
     app.quit();
 }
@@ -69,3 +69,26 @@ TEST_CASE( "threshold", "[libopenshot][effect][chromakey]" )
     CHECK(pix_e == expected);
 }
 
+
+TEST_CASE( "premultiplied keying", "[libopenshot][effect][chromakey]" )
+{
+    // half transparent green frame, with an opaque red area
+    auto frame = std::make_shared<openshot::Frame>(1, 1280, 720, "#00ff00");
+    std::shared_ptr<QImage> image = frame->GetImage();
+    image->fill(QColor(0, 255, 0, 128));
+    for (int y = 0; y < 10; ++y)
+        for (int x = 0; x < 10; ++x)
+            image->setPixelColor(x, y, QColor(255, 0, 0, 255));
+
+    // The basic method keys the original (un-premultiplied) color
+    openshot::Color key(0, 255, 0, 255);
+    openshot::Keyframe fuzz(5);
+    openshot::ChromaKey e(key, fuzz);
+
+    auto frame_out = e.GetFrame(frame, 1);
+    std::shared_ptr<QImage> i = frame_out->GetImage();
+
+    QColor trans{Qt::transparent};
+    CHECK(i->pixelColor(100, 100) == trans);
+    CHECK(i->pixelColor(5, 5) == QColor(255, 0, 0, 255));
+}
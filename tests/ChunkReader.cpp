@@ -0,0 +1,66 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::ChunkReader
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <sstream>
+#include <memory>
+
+#include <QDir>
+
+#include "openshot_catch.h"
+
+#include "ChunkReader.h"
+#include "ChunkWriter.h"
+#include "FFmpegReader.h"
+#include "Frame.h"
+
+using namespace openshot;
+
+TEST_CASE( "Prefetch after a seek", "[libopenshot][chunkreader]" )
+{
+	QDir temp_path = QDir::tempPath() + QString("/chunk_reader_prefetch/");
+	temp_path.removeRecursively();
+
+	// Write 7 chunks of 10 frames
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	FFmpegReader source(path.str());
+	source.Open();
+	ChunkWriter w(temp_path.path().toStdString(), &source);
+	w.SetChunkSize(10);
+	w.Open();
+	w.WriteFrame(&source, 1, 70);
+	w.Close();
+
+	ChunkReader r(temp_path.path().toStdString(), PREVIEW);
+	r.Open();
+	r.SetChunkSize(10);
+
+	// Reading chunk 1 and then chunk 2 (in order) opens chunk 3 in the background
+	CHECK(r.GetFrame(5)->number == 5);
+	CHECK(r.GetPrefetchChunk() == 0);
+	CHECK(r.GetFrame(15)->number == 15);
+	CHECK(r.GetPrefetchChunk() == 3);
+
+	// Seeking to chunk 4 closes the chunk being opened (it is not the next chunk)
+	CHECK(r.GetFrame(35)->number == 35);
+	CHECK(r.GetPrefetchChunk() == 0);
+
+	// Reading in order again opens the next chunk in the background again
+	CHECK(r.GetFrame(45)->number == 45);
+	CHECK(r.GetPrefetchChunk() == 6);
+	CHECK(r.GetFrame(55)->number == 55);
+	CHECK(r.GetPrefetchChunk() == 7);
+
+	r.Close();
+	CHECK(r.GetPrefetchChunk() == 0);
+	temp_path.removeRecursively();
+}
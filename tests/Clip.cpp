@@ -10,6 +10,8 @@
 //
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
+#include <algorithm>
+#include <cstdlib>
 #include <sstream>
 #include <memory>
 
@@ -29,7 +31,11 @@
 #include "FrameMapper.h"
 #include "Timeline.h"
 #include "Json.h"
+#include "Settings.h"
+#include "audio_effects/Compressor.h"
+#include "effects/Brightness.h"
 #include "effects/Negate.h"
+#include "effects/Saturation.h"
 
 using namespace openshot;
 
@@ -172,6 +178,33 @@ TEST_CASE( "properties", "[libopenshot][clip]" )
 	delete reader;
 }
 
+TEST_CASE( "properties diff", "[libopenshot][clip]" )
+{
+	Clip c1;
+	c1.alpha.AddPoint(1, 1.0);
+	c1.alpha.AddPoint(500, 0.0);
+
+	// The first call returns all properties
+	const Json::Value all = openshot::stringToJson(c1.PropertiesJSON(2));
+	Json::Value changes = openshot::stringToJson(c1.PropertiesJSONDiff(2));
+	CHECK(changes == all);
+
+	// Only the changed properties are returned afterwards
+	changes = openshot::stringToJson(c1.PropertiesJSONDiff(3));
+	CHECK(changes.isMember("alpha"));
+	CHECK(changes["alpha"]["value"].asDouble() < all["alpha"]["value"].asDouble());
+	CHECK_FALSE(changes.isMember("location_x"));
+	CHECK_FALSE(changes.isMember("layer"));
+
+	// Nothing changed (as compact JSON, and as binary JSON)
+	CHECK(c1.PropertiesJSONDiff(3) == "{}");
+	CHECK(openshot::binaryToJson(c1.PropertiesJSONDiff(3, true)).empty());
+
+	// Reset the diff (to get all properties again)
+	c1.ResetPropertiesDiff();
+	CHECK(openshot::stringToJson(c1.PropertiesJSONDiff(3)).size() == all.size());
+}
+
 TEST_CASE( "effects", "[libopenshot][clip]" )
 {
 	// Load clip with video
@@ -221,6 +254,81 @@ TEST_CASE( "effects", "[libopenshot][clip]" )
 	CHECK((int)c10.Effects().size() == 2);
 }
 
+TEST_CASE( "fused effects", "[libopenshot][clip]" )
+{
+	// Load the same video into 2 clips (each with its own frame cache)
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	Clip c1(path.str());
+	Clip c2(path.str());
+	c1.Open();
+	c2.Open();
+
+	// Add the same chain of point-wise effects to both clips
+	Brightness b1(Keyframe(0.1), Keyframe(10.0));
+	Brightness b2(Keyframe(0.1), Keyframe(10.0));
+	Saturation s1(Keyframe(1.5), Keyframe(1.0), Keyframe(1.0), Keyframe(1.0));
+	Saturation s2(Keyframe(1.5), Keyframe(1.0), Keyframe(1.0), Keyframe(1.0));
+	Negate n1;
+	Negate n2;
+	c1.AddEffect(&b1);
+	c1.AddEffect(&s1);
+	c1.AddEffect(&n1);
+	c2.AddEffect(&b2);
+	c2.AddEffect(&s2);
+	c2.AddEffect(&n2);
+
+	// Render with and without fusing the effects
+	Settings::Instance()->ENABLE_EFFECT_FUSION = true;
+	std::shared_ptr<Frame> fused = c1.GetFrame(500);
+	Settings::Instance()->ENABLE_EFFECT_FUSION = false;
+	std::shared_ptr<Frame> separate = c2.GetFrame(500);
+	Settings::Instance()->ENABLE_EFFECT_FUSION = true;
+
+	// Only rounding differs
+	REQUIRE(fused->GetWidth() == separate->GetWidth());
+	REQUIRE(fused->GetHeight() == separate->GetHeight());
+	int max_difference = 0;
+	for (int row = 0; row < fused->GetHeight(); row++) {
+		const unsigned char* fused_pixels = fused->GetPixels(row);
+		const unsigned char* separate_pixels = separate->GetPixels(row);
+		for (int col = 0; col < fused->GetWidth() * 4; col++)
+			max_difference = std::max(max_difference, std::abs(int(fused_pixels[col]) - int(separate_pixels[col])));
+	}
+	CHECK(max_difference <= 4);
+}
+
+TEST_CASE( "audio and video effects", "[libopenshot][clip]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	Clip c1(path.str());
+	Clip c2(path.str());
+	c1.Open();
+	c2.Open();
+
+	// The audio effect runs next to the video effect on the first clip, and alone on the second one
+	Compressor compressor1(Keyframe(-10.0), Keyframe(4.0), Keyframe(1.0), Keyframe(1.0), Keyframe(0.0), Keyframe(0.0));
+	Compressor compressor2(Keyframe(-10.0), Keyframe(4.0), Keyframe(1.0), Keyframe(1.0), Keyframe(0.0), Keyframe(0.0));
+	Negate negate;
+	c1.AddEffect(&compressor1);
+	c1.AddEffect(&negate);
+	c2.AddEffect(&compressor2);
+
+	std::shared_ptr<Frame> f1 = c1.GetFrame(500);
+	std::shared_ptr<Frame> f2 = c2.GetFrame(500);
+
+	// Both effects were applied
+	REQUIRE(f1->GetAudioChannelsCount() == f2->GetAudioChannelsCount());
+	REQUIRE(f1->GetAudioSamplesCount() == f2->GetAudioSamplesCount());
+	for (int channel = 0; channel < f1->GetAudioChannelsCount(); channel++) {
+		const float *samples1 = f1->GetAudioSamples(channel);
+		const float *samples2 = f2->GetAudioSamples(channel);
+		CHECK(std::equal(samples1, samples1 + f1->GetAudioSamplesCount(), samples2));
+	}
+	CHECK(f1->GetPixels(100)[400] == 255 - f2->GetPixels(100)[400]);
+}
+
 TEST_CASE( "verify parent Timeline", "[libopenshot][clip]" )
 {
 	Timeline t1(640, 480, Fraction(30,1), 44100, 2, LAYOUT_STEREO);
@@ -490,3 +598,41 @@ TEST_CASE( "resample_audio_8000_to_48000_reverse", "[libopenshot][clip]" )
 	reader.Close();
 	clip.Close();
 }
+
+TEST_CASE( "clips of the same file", "[libopenshot][clip]" )
+{
+	// Both clips read the same file (so their readers share decoded frames, see SourceFrameCache)
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	Timeline t(1280, 720, Fraction(24, 1), 44100, 2, LAYOUT_STEREO);
+	Clip c1(path.str());
+	c1.Layer(1);
+	c1.End(5.0);
+	Clip c2(path.str());
+	c2.Layer(2);
+	c2.alpha = Keyframe(0.5);
+
+	// The second clip starts 29 frames into the file (so its frame 1 is the first clip's frame 30)
+	c2.time.AddPoint(1, 30, LINEAR);
+	c2.time.AddPoint(100, 129, LINEAR);
+	c2.End(100 / 24.0);
+	t.AddClip(&c1);
+	t.AddClip(&c2);
+	t.Open();
+
+	// Render both clips of the same source frame (on different layers)
+	t.GetFrame(1);
+	t.GetFrame(30);
+
+	// Each clip keeps its own frame numbers (which its effects and keyframes use)
+	CHECK(c1.GetFrame(30)->number == 30);
+	CHECK(c2.GetFrame(1)->number == 1);
+
+	// And the source frame keeps its number (for the other readers of the file)
+	FFmpegReader r(path.str());
+	r.Open();
+	CHECK(r.GetFrame(30)->number == 30);
+	r.Close();
+
+	t.Close();
+}
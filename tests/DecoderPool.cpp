@@ -0,0 +1,75 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::DecoderPool
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <memory>
+#include <sstream>
+
+#include "openshot_catch.h"
+
+#include "DecoderPool.h"
+#include "FFmpegReader.h"
+#include "Frame.h"
+#include "Settings.h"
+
+using namespace openshot;
+
+TEST_CASE( "Closed readers keep their decoders open", "[libopenshot][decoderpool]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	DecoderPool *pool = DecoderPool::Instance();
+	pool->Clear();
+
+	// The frames of a reader without pooling
+	Settings::Instance()->DECODER_POOL_SIZE = 0;
+	FFmpegReader r2(path.str());
+	r2.Open();
+	const int pixel_1 = r2.GetFrame(1)->GetPixels(300)[400 * 4];
+	const int pixel_300 = r2.GetFrame(300)->GetPixels(300)[400 * 4];
+	r2.Close();
+	CHECK(pool->Count() == 0);
+
+	// Closing a reader keeps its contexts, and opening it again re-uses them (rewound to the start)
+	Settings::Instance()->DECODER_POOL_SIZE = 4;
+	FFmpegReader r(path.str());
+	r.Open();
+	CHECK(r.GetFrame(300)->number == 300);
+	r.Close();
+	CHECK(pool->Count() == 1);
+	r.Open();
+	CHECK(pool->Count() == 0);
+	CHECK((int)r.GetFrame(1)->GetPixels(300)[400 * 4] == Detail::Approx(pixel_1).margin(5));
+	CHECK((int)r.GetFrame(300)->GetPixels(300)[400 * 4] == Detail::Approx(pixel_300).margin(5));
+	r.Close();
+
+	// Only the most recently closed files are kept
+	Settings::Instance()->DECODER_POOL_SIZE = 1;
+	std::stringstream path2;
+	path2 << TEST_MEDIA_PATH << "piano.wav";
+	FFmpegReader r3(path2.str());
+	r3.Open();
+	r3.Close();
+	CHECK(pool->Count() == 1);
+	r.Open();
+	r.Close();
+	CHECK(pool->Count() == 1);
+
+	// Opening the other file evicts the contexts of the first one
+	r3.Open();
+	CHECK(pool->Count() == 0);
+	r3.Close();
+	CHECK(pool->Count() == 1);
+
+	pool->Clear();
+	CHECK(pool->Count() == 0);
+	Settings::Instance()->DECODER_POOL_SIZE = 4;
+}
@@ -0,0 +1,64 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::Deinterlace effect
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <memory>
+
+#include "openshot_catch.h"
+
+#include "Frame.h"
+#include "effects/Deinterlace.h"
+
+#include <QColor>
+#include <QImage>
+#include <QPainter>
+
+TEST_CASE( "replace the other field", "[libopenshot][effect][deinterlace]" )
+{
+    // Odd lines are blue, even lines are red
+    auto f = std::make_shared<openshot::Frame>(1, 64, 32, "#0000ff");
+    std::shared_ptr<QImage> image = f->GetImage();
+    {
+        QPainter painter(image.get());
+        for (int row = 0; row < image->height(); row += 2)
+            painter.fillRect(0, row, image->width(), 1, Qt::red);
+    }
+
+    // Keep the odd lines (and interpolate the even lines from them)
+    openshot::Deinterlace e(true);
+    auto f_out = e.GetFrame(f, 1);
+    std::shared_ptr<QImage> i = f_out->GetImage();
+    CHECK(i->width() == 64);
+    CHECK(i->height() == 32);
+    CHECK(i->pixelColor(10, 0) == QColor(Qt::blue));
+    CHECK(i->pixelColor(10, 1) == QColor(Qt::blue));
+    CHECK(i->pixelColor(20, 16) == QColor(Qt::blue));
+    CHECK(i->pixelColor(63, 31) == QColor(Qt::blue));
+}
+
+TEST_CASE( "interpolate along edges", "[libopenshot][effect][deinterlace]" )
+{
+    // A vertical edge (white on the left half, black on the right half)
+    auto f = std::make_shared<openshot::Frame>(1, 64, 32, "#000000");
+    std::shared_ptr<QImage> image = f->GetImage();
+    {
+        QPainter painter(image.get());
+        painter.fillRect(0, 0, 32, 32, Qt::white);
+    }
+
+    // Keep the even lines: the edge stays sharp (and in the same place)
+    openshot::Deinterlace e(false);
+    auto f_out = e.GetFrame(f, 1);
+    std::shared_ptr<QImage> i = f_out->GetImage();
+    CHECK(i->pixelColor(31, 5) == QColor(Qt::white));
+    CHECK(i->pixelColor(32, 5) == QColor(Qt::black));
+    CHECK(i->pixelColor(0, 31) == QColor(Qt::white));
+}
@@ -10,8 +10,12 @@
 //
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
+#include <cmath>
 #include <memory>
 
+#include <QColor>
+#include <QImage>
+
 #include "openshot_catch.h"
 
 #include "DummyReader.h"
@@ -139,3 +143,46 @@ TEST_CASE( "SetJson", "[libopenshot][dummyreader]") {
 	CHECK(r1.info.fps.den == 1);
 	CHECK(r1.info.duration == 15.0);
 }
+
+TEST_CASE( "Procedural", "[libopenshot][dummyreader]") {
+	openshot::DummyReader r(openshot::Fraction(30, 1), 320, 160, 48000, 2, 10.0);
+	r.SetProcedural(true);
+	CHECK(r.IsProcedural());
+	CHECK(r.info.has_audio);
+	r.Open();
+
+	// Color bars, a moving box, and the bits of the frame number (5 = 101) along the bottom
+	std::shared_ptr<openshot::Frame> f1 = r.GetFrame(5);
+	std::shared_ptr<QImage> image = f1->GetImage();
+	CHECK(f1->number == 5);
+	CHECK(image->width() == 320);
+	CHECK(image->height() == 160);
+	CHECK(image->pixelColor(5, 5) == QColor(191, 191, 191));
+	CHECK(image->pixelColor(315, 5) == QColor(0, 0, 191));
+	CHECK(image->pixelColor(5, 155) == QColor(Qt::white));
+	CHECK(image->pixelColor(15, 155) == QColor(Qt::black));
+	CHECK(image->pixelColor(25, 155) == QColor(Qt::white));
+	CHECK(r.GetFrame(1)->GetImage()->pixelColor(5, 80) == QColor(Qt::white));
+	CHECK(r.GetFrame(61)->GetImage()->pixelColor(5, 80) == QColor(Qt::white));
+	CHECK(r.GetFrame(16)->GetImage()->pixelColor(5, 80) == QColor(191, 191, 191));
+
+	// Frames are deterministic
+	std::shared_ptr<openshot::Frame> f2 = r.GetFrame(5);
+	CHECK(f2 != f1);
+	CHECK(*f2->GetImage() == *image);
+
+	// A 440 Hz tone (and 880 Hz on the second channel), continuous across frames
+	CHECK(f1->GetAudioSamplesCount() == 1600);
+	CHECK(f1->GetAudioChannelsCount() == 2);
+	CHECK(r.GetFrame(1)->GetAudioSamples(0)[0] == Detail::Approx(0.0f).margin(0.0001));
+	const float expected = 0.5f * std::sin(2.0 * M_PI * 440.0 * 1610 / 48000.0);
+	CHECK(r.GetFrame(2)->GetAudioSamples(0)[10] == Detail::Approx(expected).margin(0.0001));
+	const float expected_2 = 0.5f * std::sin(2.0 * M_PI * 880.0 * 1610 / 48000.0);
+	CHECK(r.GetFrame(2)->GetAudioSamples(1)[10] == Detail::Approx(expected_2).margin(0.0001));
+
+	// The mode is saved in JSON
+	openshot::DummyReader r2;
+	r2.SetJson(r.Json());
+	CHECK(r2.IsProcedural());
+	r.Close();
+}
@@ -0,0 +1,58 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::EffectInfo
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <memory>
+#include <set>
+
+#include "openshot_catch.h"
+
+#include "EffectBase.h"
+#include "EffectInfo.h"
+
+using namespace openshot;
+
+TEST_CASE( "listing matches each effect", "[libopenshot][effectinfo]" )
+{
+	Json::Value effects = EffectInfo::JsonValue();
+	REQUIRE(effects.isArray());
+	CHECK(effects.size() >= 25);
+
+	// The registered info of each effect is the same as the info of an instance
+	std::set<std::string> class_names;
+	for (const Json::Value& listed : effects) {
+		const std::string class_name = listed["class_name"].asString();
+		INFO(class_name);
+		CHECK(class_names.insert(class_name).second);
+
+		std::unique_ptr<EffectBase> effect(EffectInfo().CreateEffect(class_name));
+		REQUIRE(effect != nullptr);
+		CHECK(effect->info.class_name == class_name);
+		CHECK(listed == effect->JsonInfo());
+	}
+}
+
+TEST_CASE( "create effects by type", "[libopenshot][effectinfo]" )
+{
+	std::unique_ptr<EffectBase> blur(EffectInfo().CreateEffect("Blur"));
+	REQUIRE(blur != nullptr);
+	CHECK(blur->info.class_name == "Blur");
+	CHECK(blur->info.has_video);
+
+	std::unique_ptr<EffectBase> echo(EffectInfo().CreateEffect("Echo"));
+	REQUIRE(echo != nullptr);
+	CHECK(echo->info.has_audio);
+
+	// Unknown types (and the display names) are not effects
+	CHECK(EffectInfo().CreateEffect("NotAnEffect") == nullptr);
+	CHECK(EffectInfo().CreateEffect("Brightness & Contrast") == nullptr);
+	CHECK(EffectInfo().CreateEffect("") == nullptr);
+}
@@ -10,8 +10,11 @@
 //
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
+#include <fstream>
+#include <iterator>
 #include <sstream>
 #include <memory>
+#include <vector>
 
 #include "openshot_catch.h"
 
@@ -20,6 +23,8 @@
 #include "Frame.h"
 #include "Timeline.h"
 #include "Json.h"
+#include "QtImageReader.h"
+#include "Settings.h"
 
 using namespace openshot;
 
@@ -173,6 +178,167 @@ TEST_CASE( "Seek", "[libopenshot][ffmpegreader]" )
 
 }
 
+TEST_CASE( "Seek_Index", "[libopenshot][ffmpegreader]" )
+{
+	// Create a reader
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	FFmpegReader r(path.str());
+	r.Open();
+	CHECK(r.GetSeekIndexCount() == 0);
+
+	// Scan the key frames
+	r.BuildSeekIndex();
+	int64_t keyframes = r.GetSeekIndexCount();
+	CHECK(keyframes > 1);
+
+	// Seek using the index (compare to the pixels of a reader without an index)
+	FFmpegReader r2(path.str());
+	r2.Open();
+	for (int64_t number : {300, 275, 500, 100, 700}) {
+		std::shared_ptr<Frame> f = r.GetFrame(number);
+		std::shared_ptr<Frame> f2 = r2.GetFrame(number);
+		CHECK(f->number == number);
+		CHECK((int)f->GetPixels(300)[400 * 4] == Detail::Approx((int)f2->GetPixels(300)[400 * 4]).margin(5));
+	}
+
+	// Save, clear and load the index
+	r.SaveSeekIndex("sintel_trailer-720p.seekindex");
+	r.ClearSeekIndex();
+	CHECK(r.GetSeekIndexCount() == 0);
+	r.LoadSeekIndex("sintel_trailer-720p.seekindex");
+	CHECK(r.GetSeekIndexCount() == keyframes);
+	CHECK(r.GetFrame(400)->number == 400);
+
+	// Missing index file
+	CHECK_THROWS_AS(r.LoadSeekIndex("missing.seekindex"), InvalidFile);
+
+	// Index of a file which has changed since (a different size)
+	std::ifstream saved_file("sintel_trailer-720p.seekindex");
+	std::string saved((std::istreambuf_iterator<char>(saved_file)), std::istreambuf_iterator<char>());
+	Json::Value changed = openshot::stringToJson(saved);
+	CHECK(changed["size"].asInt64() > 0);
+	changed["size"] = Json::Int64(changed["size"].asInt64() + 1);
+	std::ofstream("sintel_trailer-720p-changed.seekindex") << changed.toStyledString();
+	CHECK_THROWS_AS(r.LoadSeekIndex("sintel_trailer-720p-changed.seekindex"), InvalidJSON);
+	CHECK(r.GetSeekIndexCount() == keyframes);
+
+	// Index of a different file
+	std::stringstream other_path;
+	other_path << TEST_MEDIA_PATH << "test.mp4";
+	FFmpegReader other(other_path.str());
+	other.Open();
+	CHECK_THROWS_AS(other.LoadSeekIndex("sintel_trailer-720p.seekindex"), InvalidJSON);
+	CHECK(other.GetSeekIndexCount() == 0);
+	other.Close();
+
+	r.Close();
+	r2.Close();
+	CHECK_THROWS_AS(r.BuildSeekIndex(), ReaderClosed);
+}
+
+TEST_CASE( "Decode_Ahead", "[libopenshot][ffmpegreader]" )
+{
+	// Create a reader (which decodes ahead of sequential requests), and one which doesn't
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	FFmpegReader r2(path.str());
+	r2.Open();
+	Settings::Instance()->DECODE_AHEAD_FRAMES = 8;
+	FFmpegReader r(path.str());
+	r.Open();
+
+	// Sequential requests (the same frames and pixels as without decoding ahead)
+	for (int64_t number = 1; number <= 60; number++) {
+		std::shared_ptr<Frame> f = r.GetFrame(number);
+		std::shared_ptr<Frame> f2 = r2.GetFrame(number);
+		CHECK(f->number == number);
+		CHECK((int)f->GetPixels(300)[400 * 4] == Detail::Approx((int)f2->GetPixels(300)[400 * 4]).margin(5));
+	}
+
+	// Seek while decoding ahead, then continue in order
+	CHECK(r.GetFrame(500)->number == 500);
+	CHECK(r.GetFrame(200)->number == 200);
+	CHECK(r.GetFrame(201)->number == 201);
+	CHECK(r.GetFrame(202)->number == 202);
+	CHECK(r.GetFrame(203)->number == 203);
+
+	// Close (and re-open) while decoding ahead
+	r.Close();
+	r.Open();
+	CHECK(r.GetFrame(1)->number == 1);
+	CHECK(r.GetFrame(2)->number == 2);
+	CHECK(r.GetFrame(3)->number == 3);
+	r.Close();
+	r2.Close();
+	Settings::Instance()->DECODE_AHEAD_FRAMES = 0;
+}
+
+TEST_CASE( "Reverse_Decode", "[libopenshot][ffmpegreader]" )
+{
+	// Create a reader (which decodes chunks of reverse requests), and one which seeks for each frame
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	Settings::Instance()->REVERSE_DECODE_FRAMES = 0;
+	FFmpegReader r2(path.str());
+	r2.Open();
+	Settings::Instance()->REVERSE_DECODE_FRAMES = 30;
+	FFmpegReader r(path.str());
+	r.Open();
+
+	// Reverse requests (the same frames and pixels as seeking for each frame)
+	for (int64_t number = 300; number >= 200; number--) {
+		std::shared_ptr<Frame> f = r.GetFrame(number);
+		std::shared_ptr<Frame> f2 = r2.GetFrame(number);
+		CHECK(f->number == number);
+		CHECK((int)f->GetPixels(300)[400 * 4] == Detail::Approx((int)f2->GetPixels(300)[400 * 4]).margin(5));
+	}
+
+	// Backwards at double speed, then forwards again
+	for (int64_t number = 150; number >= 100; number -= 2)
+		CHECK(r.GetFrame(number)->number == number);
+	CHECK(r.GetFrame(101)->number == 101);
+	CHECK(r.GetFrame(102)->number == 102);
+	CHECK(r.GetFrame(103)->number == 103);
+
+	// Reverse requests near the start of the file (which re-open it, instead of seeking)
+	for (int64_t number = 40; number >= 1; number--)
+		CHECK(r.GetFrame(number)->number == number);
+	r.Close();
+	r2.Close();
+}
+
+TEST_CASE( "Decoder_Thread_Type", "[libopenshot][ffmpegreader]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+
+	// Scrub (which switches to slice threads), then play (which switches back to frame threads)
+	std::vector<int64_t> numbers = { 500, 300, 700, 400 };
+	for (int64_t number = 401; number <= 600; number++)
+		numbers.push_back(number);
+	numbers.push_back(100);
+
+	// The same frames and pixels as with FFmpeg's default threads
+	std::vector<int> pixels;
+	Settings::Instance()->DECODER_THREAD_TYPE = 1;
+	FFmpegReader r2(path.str());
+	r2.Open();
+	for (int64_t number : numbers)
+		pixels.push_back(r2.GetFrame(number)->GetPixels(300)[400 * 4]);
+	r2.Close();
+
+	Settings::Instance()->DECODER_THREAD_TYPE = 0;
+	FFmpegReader r(path.str());
+	r.Open();
+	for (size_t index = 0; index < numbers.size(); index++) {
+		std::shared_ptr<Frame> f = r.GetFrame(numbers[index]);
+		CHECK(f->number == numbers[index]);
+		CHECK((int)f->GetPixels(300)[400 * 4] == Detail::Approx(pixels[index]).margin(5));
+	}
+	r.Close();
+}
+
 TEST_CASE( "Frame_Rate", "[libopenshot][ffmpegreader]" )
 {
 	// Create a reader
@@ -258,6 +424,33 @@ TEST_CASE( "verify parent Timeline", "[libopenshot][ffmpegreader]" )
 	t1.Close();
 }
 
+TEST_CASE( "RGBA images are used without conversion", "[libopenshot][ffmpegreader]" )
+{
+	// A PNG with an alpha channel (decoded as RGBA)
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "front3.png";
+	FFmpegReader r(path.str());
+	r.Open();
+	QtImageReader q(path.str());
+	q.Open();
+
+	// The decoded image matches the image loaded by Qt (premultiplied)
+	std::shared_ptr<Frame> f = r.GetFrame(1);
+	std::shared_ptr<Frame> expected = q.GetFrame(1);
+	REQUIRE(f->GetWidth() == expected->GetWidth());
+	REQUIRE(f->GetHeight() == expected->GetHeight());
+	CHECK(f->GetImage()->format() == QImage::Format_RGBA8888_Premultiplied);
+	for (int row = 0; row < f->GetHeight(); row += 40) {
+		const unsigned char *pixels = f->GetPixels(row);
+		const unsigned char *expected_pixels = expected->GetPixels(row);
+		for (int byte = 0; byte < f->GetWidth() * 4; byte += 36)
+			CHECK((int) pixels[byte] == Detail::Approx((int) expected_pixels[byte]).margin(2));
+	}
+
+	r.Close();
+	q.Close();
+}
+
 TEST_CASE( "DisplayInfo", "[libopenshot][ffmpegreader]" )
 {
 	// Create a reader
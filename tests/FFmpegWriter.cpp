@@ -10,12 +10,15 @@
 //
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
+#include <chrono>
 #include <sstream>
 #include <memory>
+#include <thread>
 
 #include "openshot_catch.h"
 
 #include "FFmpegWriter.h"
+#include "DummyReader.h"
 #include "Exceptions.h"
 #include "FFmpegReader.h"
 #include "Fraction.h"
@@ -233,3 +236,215 @@ TEST_CASE( "Gif", "[libopenshot][ffmpegwriter]" )
     // Close reader
     r1.Close();
 }
+
+TEST_CASE( "Render_Threads", "[libopenshot][ffmpegwriter]" )
+{
+	// Reader
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	FFmpegReader r(path.str());
+	r.Open();
+
+	/* WRITER ---------------- */
+	FFmpegWriter w("output-render-threads.webm");
+	CHECK(w.GetRenderThreads() == 1);
+
+	// Render frames ahead of the encoder with 4 threads
+	w.SetRenderThreads(4);
+	CHECK(w.GetRenderThreads() == 4);
+	w.SetRenderThreads(0);
+	CHECK(w.GetRenderThreads() == 1);
+	w.SetRenderThreads(4);
+
+	// Set options
+	w.SetAudioOptions(true, "libvorbis", 44100, 2, LAYOUT_STEREO, 188000);
+	w.SetVideoOptions(true, "libvpx", Fraction(24,1), 1280, 720, Fraction(1,1), false, false, 30000000);
+
+	// Open writer
+	w.Open();
+
+	// Write some frames (in order, even though they are rendered in parallel)
+	w.WriteFrame(&r, 24, 50);
+
+	// Close writer & reader
+	w.Close();
+	r.Close();
+
+	FFmpegReader r1("output-render-threads.webm");
+	r1.Open();
+
+	// Verify various settings on new file
+	CHECK(r1.GetFrame(1)->GetAudioChannelsCount() == 2);
+	CHECK(r1.info.fps.num == 24);
+	CHECK(r1.info.fps.den == 1);
+
+	// Get a specific frame (same pixel as the synchronous Webm test)
+	std::shared_ptr<Frame> f = r1.GetFrame(8);
+	const unsigned char* pixels = f->GetPixels(500);
+	int pixel_index = 112 * 4; // pixel 112 (4 bytes per pixel)
+
+	CHECK((int)pixels[pixel_index] == Detail::Approx(23).margin(5));
+	CHECK((int)pixels[pixel_index + 1] == Detail::Approx(23).margin(5));
+	CHECK((int)pixels[pixel_index + 2] == Detail::Approx(23).margin(5));
+	CHECK((int)pixels[pixel_index + 3] == Detail::Approx(255).margin(5));
+
+	r1.Close();
+}
+
+TEST_CASE( "Async_Muxing", "[libopenshot][ffmpegwriter]" )
+{
+	// Reader
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	FFmpegReader r(path.str());
+	r.Open();
+
+	/* WRITER ---------------- */
+	FFmpegWriter w("output-async.mp4");
+	CHECK_FALSE(w.IsAsyncMuxing());
+
+	// Queue at most 1 MB of packets (so the encoder waits for the muxer some of the time)
+	w.SetAsyncMuxing(true, 1, true);
+	CHECK(w.IsAsyncMuxing());
+	w.SetAudioOptions(true, "aac", 44100, 2, LAYOUT_STEREO, 128000);
+	w.SetVideoOptions(true, "mpeg4", Fraction(24,1), 1280, 720, Fraction(1,1), false, false, 30000000);
+	w.Open();
+	CHECK_THROWS_AS(w.SetAsyncMuxing(false), InvalidOptions);
+
+	// The MP4 muxer seeks back to finish the header (through the writer's own output buffer)
+	w.WriteFrame(&r, 24, 50);
+	w.Close();
+	r.Close();
+
+	FFmpegReader r1("output-async.mp4");
+	r1.Open();
+	CHECK(r1.info.has_audio);
+	CHECK(r1.info.width == 1280);
+	CHECK(r1.info.video_length >= 26);
+
+	// Same pixel as the synchronous Webm test
+	std::shared_ptr<Frame> f = r1.GetFrame(8);
+	const unsigned char* pixels = f->GetPixels(500);
+	int pixel_index = 112 * 4; // pixel 112 (4 bytes per pixel)
+	CHECK((int)pixels[pixel_index] == Detail::Approx(23).margin(5));
+	CHECK((int)pixels[pixel_index + 3] == Detail::Approx(255).margin(5));
+
+	r1.Close();
+}
+
+TEST_CASE( "Audio_Fifo", "[libopenshot][ffmpegwriter]" )
+{
+	// 1 second of 48 kHz audio, resampled to 44.1 kHz 16 bit PCM (which has no fixed frame size)
+	DummyReader r(Fraction(30,1), 64, 48, 48000, 2, 1.0);
+	r.Open();
+
+	FFmpegWriter w("output-audio-fifo.wav");
+	w.SetAudioOptions(true, "pcm_s16le", 44100, 2, LAYOUT_STEREO, 0);
+	w.Open();
+	w.WriteFrame(&r, 1, 30);
+	w.Close();
+	r.Close();
+
+	// Every sample is written once (including the samples the resampler held back)
+	FFmpegReader r1("output-audio-fifo.wav");
+	r1.Open();
+	CHECK(r1.info.sample_rate == 44100);
+	CHECK(r1.info.channels == 2);
+	CHECK(r1.info.duration == Detail::Approx(1.0).margin(0.01));
+	r1.Close();
+}
+
+TEST_CASE( "Live_Stream", "[libopenshot][ffmpegwriter]" )
+{
+	DummyReader r(Fraction(24,1), 320, 240, 44100, 2, 2.0);
+	r.Open();
+
+	FFmpegWriter w("output-live.ts");
+	CHECK_FALSE(w.IsLive());
+	w.SetAudioOptions(true, "mp2", 44100, 2, LAYOUT_STEREO, 128000);
+	w.SetVideoOptions(true, "mpeg2video", Fraction(24,1), 320, 240, Fraction(1,1), false, false, 1000000);
+	w.SetLive(true, 100);
+	CHECK(w.IsLive());
+	w.Open();
+
+	// Frames are written in real time (at most 100 ms early)
+	const auto start = std::chrono::steady_clock::now();
+	w.WriteFrame(&r, 1, 24);
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	CHECK(seconds >= 0.8);
+
+	w.Close();
+	r.Close();
+
+	FFmpegReader r1("output-live.ts");
+	r1.Open();
+	CHECK(r1.info.has_video);
+	CHECK(r1.info.has_audio);
+	CHECK(r1.info.width == 320);
+	r1.Close();
+}
+
+// A reader which renders slower than real time
+class SlowReader : public DummyReader {
+public:
+	SlowReader() : DummyReader(Fraction(30,1), 64, 48, 44100, 2, 1.0) {}
+
+	std::shared_ptr<Frame> GetFrame(int64_t requested_frame) override {
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		return DummyReader::GetFrame(requested_frame);
+	}
+};
+
+TEST_CASE( "Live_Stream_Drops_Late_Frames", "[libopenshot][ffmpegwriter]" )
+{
+	SlowReader r;
+	r.Open();
+
+	FFmpegWriter w("output-live-drops.ts");
+	w.SetAudioOptions(true, "mp2", 44100, 2, LAYOUT_STEREO, 128000);
+	w.SetVideoOptions(true, "mpeg2video", Fraction(30,1), 64, 48, Fraction(1,1), false, false, 500000);
+	w.SetLive(true, 50);
+	w.Open();
+	CHECK_THROWS_AS(w.SetLive(false), InvalidOptions);
+
+	// The frames the renderer is too late for are skipped (instead of delaying the stream)
+	const auto start = std::chrono::steady_clock::now();
+	w.WriteFrame(&r, 1, 15);
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	w.Close();
+	r.Close();
+
+	CHECK(w.GetDroppedFrames() > 0);
+	CHECK(seconds < 1.0);
+}
+
+TEST_CASE( "Variable_Frame_Rate", "[libopenshot][ffmpegwriter]" )
+{
+	FFmpegWriter w("output-vfr.mp4");
+	CHECK_FALSE(w.IsVariableFrameRate());
+	w.SetVariableFrameRate(true);
+	CHECK(w.IsVariableFrameRate());
+	w.SetVideoOptions(true, "mpeg4", Fraction(30,1), 64, 48, Fraction(1,1), false, false, 500000);
+	w.SetCacheSize(4);
+	w.Open();
+	CHECK_THROWS_AS(w.SetVariableFrameRate(false), InvalidOptions);
+
+	// 10 red frames, and 20 blue frames (each with its own buffer, so the pixels are compared)
+	for (int64_t number = 1; number <= 30; number++)
+		w.WriteFrame(std::make_shared<Frame>(number, 64, 48, number <= 10 ? "#ff0000" : "#0000ff"));
+	w.Close();
+
+	// Only the first frame of each color, and the last frame, are encoded
+	CHECK(w.GetElidedFrames() == 27);
+
+	// The video still lasts 1 second
+	FFmpegReader r1("output-vfr.mp4");
+	r1.Open();
+	CHECK(r1.info.width == 64);
+	CHECK(r1.info.duration == Detail::Approx(1.0).margin(0.1));
+	std::shared_ptr<Frame> f = r1.GetFrame(1);
+	const unsigned char* pixels = f->GetPixels(24);
+	CHECK((int)pixels[32 * 4] == Detail::Approx(255).margin(10));
+	CHECK((int)pixels[32 * 4 + 2] == Detail::Approx(0).margin(10));
+	r1.Close();
+}
@@ -11,9 +11,12 @@
 //
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
+#include <algorithm>
 #include <sstream>
 #include <memory>
+#include <vector>
 
+#include <QColor>
 #include <QImage>
 
 #ifdef USE_OPENCV
@@ -100,6 +103,65 @@ TEST_CASE( "AddImage_QImage", "[libopenshot][frame]" )
 }
 
 
+TEST_CASE( "GetBytes", "[libopenshot][frame]" )
+{
+	// Audio only (8 channels)
+	Frame f1(1, 1470, 8);
+	CHECK(f1.GetBytes() == 8 * 1470 * int64_t(sizeof(float)));
+
+	// Add an image
+	f1.AddColor(320, 240, "#000000");
+	CHECK(f1.GetBytes() == 320 * 240 * 4 + 8 * 1470 * int64_t(sizeof(float)));
+	CHECK(f1.GetBuffers().size() == 2);
+}
+
+TEST_CASE( "AddAudioRamp", "[libopenshot][frame]" )
+{
+	// Mix a constant signal into silence, with a gain ramp (and with a constant gain)
+	Frame f1(1, 1000, 2);
+	f1.AddAudioSilence(1000);
+	std::vector<float> source(1000, 0.5f);
+	f1.AddAudioRamp(0, 0, source.data(), 1000, 0.0f, 1.0f);
+	f1.AddAudioRamp(1, 0, source.data(), 1000, 0.5f, 0.5f);
+
+	CHECK(f1.GetAudioSamples(0)[0] == Detail::Approx(0.0f).margin(0.0001));
+	CHECK(f1.GetAudioSamples(0)[500] == Detail::Approx(0.25f).margin(0.0001));
+	CHECK(f1.GetAudioSamples(0)[999] == Detail::Approx(0.4995f).margin(0.0001));
+	CHECK(f1.GetAudioSamples(1)[999] == Detail::Approx(0.25f).margin(0.0001));
+
+	// Mixing adds to the existing samples (and never changes the source)
+	f1.AddAudioRamp(1, 0, source.data(), 1000, 1.0f, 0.0f);
+	CHECK(f1.GetAudioSamples(1)[0] == Detail::Approx(0.75f).margin(0.0001));
+	CHECK(source[0] == 0.5f);
+}
+
+TEST_CASE( "GetInterleavedAudioSamples", "[libopenshot][frame]" )
+{
+	// Mono, stereo and 6 channels (each sample is channel * 1000 + sample)
+	for (int channels : {1, 2, 6}) {
+		Frame f1(1, 500, channels);
+		std::vector<float> source(500);
+		for (int channel = 0; channel < channels; channel++) {
+			for (int sample = 0; sample < 500; sample++)
+				source[sample] = channel * 1000 + sample;
+			f1.AddAudio(true, channel, 0, source.data(), 500, 1.0f);
+		}
+
+		// Into a caller-provided buffer (larger than needed, so it is only resized)
+		std::vector<float> interleaved(10000);
+		CHECK(f1.GetInterleavedAudioSamples(interleaved) == 500);
+		REQUIRE(interleaved.size() == size_t(500 * channels));
+		CHECK(interleaved[channels * 250 + channels - 1] == float((channels - 1) * 1000 + 250));
+
+		// Into a new array (the same samples)
+		int sample_count = 0;
+		float *samples = f1.GetInterleavedAudioSamples(&sample_count);
+		CHECK(sample_count == 500);
+		CHECK(std::equal(interleaved.begin(), interleaved.end(), samples));
+		delete[] samples;
+	}
+}
+
 TEST_CASE( "Copy_Constructor", "[libopenshot][frame]" )
 {
 	// Create a dummy Frame
@@ -138,6 +200,89 @@ TEST_CASE( "Copy_Constructor", "[libopenshot][frame]" )
 	CHECK(f1.GetAudioSamplesCount() == f2.GetAudioSamplesCount());
 }
 
+TEST_CASE( "Copy_On_Write", "[libopenshot][frame]" )
+{
+	openshot::Frame f1(1, 64, 36, "#ff0000", 100, 2);
+	std::vector<float> ones(100, 1.0f);
+	f1.AddAudio(true, 0, 0, ones.data(), 100, 1.0f);
+	f1.AddColor(64, 36, "#ff0000");
+
+	// A copy shares the pixels and samples
+	openshot::Frame f2 = f1;
+	CHECK(f2.audio == f1.audio);
+	CHECK(f2.GetImage()->constBits() == f1.GetImage()->constBits());
+
+	// Changing the copy gives it its own samples and pixels (the original is not changed)
+	f2.ApplyGainRamp(0, 0, 100, 0.5f, 0.5f);
+	f2.GetImage()->fill(Qt::blue);
+	CHECK(f2.audio != f1.audio);
+	CHECK(f1.GetAudioSamples(0)[50] == Detail::Approx(1.0f));
+	CHECK(f2.GetAudioSamples(0)[50] == Detail::Approx(0.5f));
+	CHECK(f1.GetImage()->pixelColor(0, 0) == QColor(Qt::red));
+	CHECK(f2.GetImage()->pixelColor(0, 0) == QColor(Qt::blue));
+
+	// Samples which are not shared are not copied
+	juce::AudioBuffer<float> *samples = f1.audio.get();
+	f1.DetachAudio();
+	CHECK(f1.audio.get() == samples);
+}
+
+TEST_CASE( "Solid_Color", "[libopenshot][frame]" )
+{
+	openshot::Frame f1(1, 64, 36, "#000000");
+	f1.AddSolidColor(QColor(255, 0, 0, 128));
+	CHECK(f1.has_image_data);
+	CHECK(f1.GetSolidColor() == QColor(255, 0, 0, 128));
+
+	// No pixels are allocated (and copies are solid colors too)
+	CHECK(f1.GetBytes() == 0);
+	openshot::Frame f2 = f1;
+	CHECK(f2.GetSolidColor() == QColor(255, 0, 0, 128));
+
+	// The image is filled when its pixels are needed
+	std::shared_ptr<QImage> image = f1.GetImage();
+	CHECK(image->width() == 64);
+	CHECK(image->height() == 36);
+	CHECK(image->pixelColor(10, 10) == QColor(255, 0, 0, 128));
+	CHECK_FALSE(f1.GetSolidColor().isValid());
+	CHECK(f1.GetImage() == image);
+
+	// Adding an image replaces the solid color
+	f2.AddImage(std::make_shared<QImage>(32, 18, QImage::Format_RGBA8888_Premultiplied));
+	CHECK_FALSE(f2.GetSolidColor().isValid());
+	CHECK(f2.GetWidth() == 32);
+}
+
+TEST_CASE( "Sample_Positions", "[libopenshot][frame]" )
+{
+	// 24 fps at 8000 Hz is exactly 333 1/3 samples per frame (so every 3rd frame starts on a whole sample)
+	Fraction fps(24, 1);
+	CHECK(Frame::GetSamplesBefore(1, fps, 8000, 1) == 0);
+	CHECK(Frame::GetSamplesBefore(4, fps, 8000, 1) == 1000);
+	CHECK(Frame::GetSamplesBefore(3000001, fps, 8000, 1) == 1000000000);
+	CHECK(Frame::GetSamplesPerFrame(3, fps, 8000, 1) == 334);
+
+	// The frames of a stereo 29.97 fps file add up to the samples before the next frame
+	Fraction ntsc(30000, 1001);
+	int64_t total = 0;
+	for (int64_t number = 1; number <= 1000; number++) {
+		const int samples_per_frame = Frame::GetSamplesPerFrame(number, ntsc, 44100, 2);
+		CHECK(samples_per_frame % 2 == 0);
+		total += samples_per_frame;
+	}
+	CHECK(Frame::GetSamplesBefore(1001, ntsc, 44100, 2) == total);
+
+	// Every sample is found in its frame
+	int sample = 0;
+	CHECK(Frame::GetFrameOfSample(0, ntsc, 44100, 2, sample) == 1);
+	CHECK(sample == 0);
+	const int64_t position = Frame::GetSamplesBefore(500, ntsc, 44100, 2);
+	CHECK(Frame::GetFrameOfSample(position, ntsc, 44100, 2, sample) == 500);
+	CHECK(sample == 0);
+	CHECK(Frame::GetFrameOfSample(position - 1, ntsc, 44100, 2, sample) == 499);
+	CHECK(sample == Frame::GetSamplesPerFrame(499, ntsc, 44100, 2) - 1);
+}
+
 #ifdef USE_OPENCV
 TEST_CASE( "Convert_Image", "[libopenshot][opencv][frame]" )
 {
@@ -160,4 +305,30 @@ TEST_CASE( "Convert_Image", "[libopenshot][opencv][frame]" )
 	CHECK(f1->GetHeight() == cvimage.rows);
 	CHECK(cvimage.channels() == 3);
 }
+
+TEST_CASE( "Image_View", "[libopenshot][opencv][frame]" )
+{
+	Frame f1(1, 64, 48, "#000000");
+
+	// The view shares the frame's RGBA pixels
+	cv::Mat view = f1.GetImageViewCV();
+	CHECK(view.cols == 64);
+	CHECK(view.rows == 48);
+	CHECK(view.channels() == 4);
+	CHECK(view.data == f1.GetImage()->constBits());
+
+	// Drawing on the view changes the frame's image
+	view.at<cv::Vec4b>(10, 20) = cv::Vec4b(255, 128, 0, 255);
+	QColor pixel = f1.GetImage()->pixelColor(20, 10);
+	CHECK(pixel.red() == 255);
+	CHECK(pixel.green() == 128);
+	CHECK(pixel.blue() == 0);
+
+	// The BGR copy (and back)
+	cv::Mat bgr = f1.GetImageCV();
+	CHECK(bgr.at<cv::Vec3b>(10, 20) == cv::Vec3b(0, 128, 255));
+	f1.SetImageCV(bgr);
+	CHECK(f1.GetImage()->pixelColor(20, 10) == pixel);
+	CHECK(bgr.at<cv::Vec3b>(10, 20) == cv::Vec3b(0, 128, 255));
+}
 #endif
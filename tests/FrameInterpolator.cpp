@@ -0,0 +1,65 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::FrameInterpolator
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <memory>
+
+#include <QColor>
+#include <QImage>
+
+#include "openshot_catch.h"
+
+#include "FrameInterpolator.h"
+
+using namespace openshot;
+
+TEST_CASE( "Blend images", "[libopenshot][frameinterpolator]" )
+{
+	QImage first(64, 48, QImage::Format_RGBA8888_Premultiplied);
+	first.fill(QColor(0, 0, 0, 255));
+	QImage second(64, 48, QImage::Format_RGBA8888_Premultiplied);
+	second.fill(QColor(200, 100, 40, 255));
+
+	std::shared_ptr<QImage> image = FrameInterpolator::Blend(first, second, 0.5);
+	CHECK(image->size() == first.size());
+	CHECK(image->pixelColor(10, 10) == QColor(100, 50, 20, 255));
+	CHECK(FrameInterpolator::Blend(first, second, 0.0)->pixelColor(63, 47) == QColor(0, 0, 0, 255));
+	CHECK(FrameInterpolator::Blend(first, second, 1.0)->pixelColor(63, 47) == QColor(200, 100, 40, 255));
+}
+
+TEST_CASE( "Interpolate frames", "[libopenshot][frameinterpolator]" )
+{
+	auto first = std::make_shared<QImage>(160, 90, QImage::Format_RGBA8888_Premultiplied);
+	first->fill(QColor(0, 0, 0, 255));
+	auto second = std::make_shared<QImage>(160, 90, QImage::Format_RGBA8888_Premultiplied);
+	second->fill(QColor(200, 100, 40, 255));
+
+	// Flat images don't move (so they are blended)
+	FrameInterpolator interpolator;
+	std::shared_ptr<QImage> image = interpolator.Interpolate(1, first, 2, second, 0.5);
+	CHECK(image->size() == first->size());
+	CHECK(image->pixelColor(80, 45).red() == Detail::Approx(100).margin(2));
+	CHECK(image->pixelColor(80, 45).green() == Detail::Approx(50).margin(2));
+
+	// Frames between the same 2 frames re-use the flow
+	interpolator.Interpolate(1, first, 2, second, 0.25);
+	interpolator.Interpolate(1, first, 2, second, 0.75);
+#ifdef USE_OPENCV
+	CHECK(interpolator.EstimatedFlows() == 1);
+#else
+	CHECK(interpolator.EstimatedFlows() == 0);
+#endif
+
+	// Images of different sizes use the nearest image
+	auto small = std::make_shared<QImage>(16, 9, QImage::Format_RGBA8888_Premultiplied);
+	CHECK(interpolator.Interpolate(2, second, 3, small, 0.25)->size() == second->size());
+	CHECK(interpolator.Interpolate(2, second, 3, small, 0.75)->size() == small->size());
+}
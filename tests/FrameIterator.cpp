@@ -0,0 +1,79 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::FrameIterator
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include "openshot_catch.h"
+
+#include "DummyReader.h"
+#include "Exceptions.h"
+#include "FFmpegReader.h"
+#include "Frame.h"
+#include "FrameIterator.h"
+
+using namespace openshot;
+
+TEST_CASE( "frames in order", "[libopenshot][frameiterator]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	FFmpegReader r(path.str());
+	r.Open();
+
+	// The frames are returned in order (while the next ones render in the background)
+	std::shared_ptr<FrameIterator> frames = r.Frames(1, 20, 1, 4);
+	int64_t expected = 1;
+	while (frames->HasNext()) {
+		CHECK(frames->NextNumber() == expected);
+		std::shared_ptr<Frame> f = frames->Next();
+		REQUIRE(f != nullptr);
+		CHECK(f->number == expected);
+		expected++;
+	}
+	CHECK(expected == 21);
+	CHECK_THROWS_AS(frames->Next(), OutOfBoundsFrame);
+
+	// The same frames as GetFrame
+	std::shared_ptr<Frame> f = r.Frames(10, 10)->Next();
+	CHECK(f->GetImage()->pixelColor(100, 100) == r.GetFrame(10)->GetImage()->pixelColor(100, 100));
+
+	r.Close();
+}
+
+TEST_CASE( "steps and early close", "[libopenshot][frameiterator]" )
+{
+	// Test patterns (each frame is generated on its own, so they can be requested in parallel)
+	DummyReader r(Fraction(30, 1), 64, 48, 44100, 2, 2.0);
+	r.SetProcedural(true);
+	r.Open();
+
+	// Backwards, skipping frames
+	std::vector<int64_t> numbers;
+	std::shared_ptr<FrameIterator> frames = r.Frames(30, 1, -3, 2);
+	while (frames->HasNext())
+		numbers.push_back(frames->Next()->number);
+	CHECK(numbers == std::vector<int64_t>({30, 27, 24, 21, 18, 15, 12, 9, 6, 3}));
+
+	// An empty range
+	CHECK_FALSE(r.Frames(10, 5)->HasNext());
+	CHECK_THROWS_AS(r.Frames(1, 10, 0), OutOfBoundsFrame);
+
+	// Closing cancels the frames requested ahead (and ends the iteration)
+	frames = r.Frames(1, 60, 1, 8);
+	CHECK(frames->Next()->number == 1);
+	frames->Close();
+	CHECK_FALSE(frames->HasNext());
+
+	r.Close();
+}
@@ -204,6 +204,34 @@ TEST_CASE( "resample_audio_48000_to_41000", "[libopenshot][framemapper]" )
 	map.Close();
 }
 
+TEST_CASE( "ChangeMapping with the same settings", "[libopenshot][framemapper]" )
+{
+	// Create a reader
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	FFmpegReader r(path.str());
+
+	FrameMapper map(&r, Fraction(30,1), PULLDOWN_NONE, 44100, 2, LAYOUT_STEREO);
+	map.Open();
+	std::shared_ptr<Frame> f1 = map.GetFrame(1);
+	std::shared_ptr<Frame> f2 = map.GetFrame(2);
+	CHECK(f2->GetAudioSamplesCount() == 1470);
+
+	// The same mapping keeps the cached (and resampled) frames
+	map.ChangeMapping(Fraction(30,1), PULLDOWN_NONE, 44100, 2, LAYOUT_STEREO);
+	CHECK(map.GetCache()->Count() == 2);
+	CHECK(map.GetFrame(2) == f2);
+	CHECK(map.GetFrame(3)->GetAudioSamplesCount() == 1470);
+
+	// A new mapping clears them
+	map.ChangeMapping(Fraction(30,1), PULLDOWN_NONE, 48000, 2, LAYOUT_STEREO);
+	CHECK(map.GetCache()->Count() == 0);
+	CHECK(map.GetFrame(2)->GetAudioSamplesCount() == 1600);
+
+	// Close mapper
+	map.Close();
+}
+
 TEST_CASE( "resample_audio_mapper", "[libopenshot][framemapper]" ) {
 	// This test verifies that audio data can be resampled on FrameMapper
 	// instances, even on frame rates that do not divide evenly, and that no audio data is misplaced
@@ -649,6 +677,95 @@ TEST_CASE( "Json", "[libopenshot][framemapper]" )
 	CHECK(map.info.fps.num == 30);
 }
 
+TEST_CASE( "Lazy_Mapping_Long_Reader", "[libopenshot][framemapper]" )
+{
+	// Create a 3 hour reader
+	DummyReader r(Fraction(24,1), 720, 480, 44100, 2, 10800.0);
+
+	// Create mapping 24 fps and 30 fps (only the requested chunks of frames are mapped)
+	FrameMapper mapping(&r, Fraction(30, 1), PULLDOWN_CLASSIC, 44100, 2, LAYOUT_STEREO);
+	MappedFrame last = mapping.GetMappedFrame(323997);
+	CHECK(last.Odd.Frame == 259198);
+	CHECK(last.Even.Frame == 259198);
+
+	// Frames past the end are clamped to the last frame
+	CHECK(mapping.GetMappedFrame(400000).Even.Frame == mapping.GetMappedFrame(324000).Even.Frame);
+
+	// The pull-down pattern repeats every 5 frames (also after resuming the mapping in a later chunk)
+	MappedFrame frame2 = mapping.GetMappedFrame(5002);
+	MappedFrame frame3 = mapping.GetMappedFrame(5003);
+	CHECK(frame2.Odd.Frame == 4002);
+	CHECK(frame2.Even.Frame == 4002);
+	CHECK(frame3.Odd.Frame == 4002);
+	CHECK(frame3.Even.Frame == 4003);
+
+	// The samples of each frame follow the samples of the frame before it (across chunks)
+	for (int64_t number = 1020; number < 1030; number++) {
+		MappedFrame previous = mapping.GetMappedFrame(number);
+		MappedFrame next = mapping.GetMappedFrame(number + 1);
+		SampleRange end = previous.Samples;
+		SampleRange::Move(end.frame_end, end.sample_end, 1, Fraction(24, 1), 44100, 2);
+		CHECK(end.frame_end == next.Samples.frame_start);
+		CHECK(end.sample_end == next.Samples.sample_start);
+		CHECK(next.Samples.total == Frame::GetSamplesPerFrame(number + 1, Fraction(30, 1), 44100, 2));
+	}
+
+	// Other frame rates map each frame to the nearest original frame
+	FrameMapper linear(&r, Fraction(60, 1), PULLDOWN_NONE, 44100, 2, LAYOUT_STEREO);
+	CHECK(linear.GetMappedFrame(400001).Odd.Frame == 160001);
+	CHECK(linear.GetMappedFrame(1).Even.Frame == 1);
+}
+
+TEST_CASE( "Identity_Bypass", "[libopenshot][framemapper]" )
+{
+	DummyReader r(Fraction(30,1), 720, 480, 48000, 2, 5.0);
+	r.Open();
+
+	// The same format forwards frames to the reader (without caching them)
+	FrameMapper mapping(&r, Fraction(30, 1), PULLDOWN_NONE, 48000, 2, LAYOUT_STEREO);
+	mapping.Open();
+	std::shared_ptr<Frame> f = mapping.GetFrame(3);
+	CHECK(f == r.GetFrame(3));
+	CHECK(mapping.GetCache()->Count() == 0);
+
+	// The same mapping keeps forwarding frames
+	mapping.ChangeMapping(Fraction(30, 1), PULLDOWN_NONE, 48000, 2, LAYOUT_STEREO);
+	mapping.GetFrame(4);
+	CHECK(mapping.GetCache()->Count() == 0);
+
+	// A different sample rate maps (and caches) frames again
+	mapping.ChangeMapping(Fraction(30, 1), PULLDOWN_NONE, 44100, 2, LAYOUT_STEREO);
+	mapping.GetFrame(5);
+	CHECK(mapping.GetCache()->Count() == 1);
+
+	mapping.Close();
+	r.Close();
+}
+
+TEST_CASE( "24_fps_to_60_fps_Interpolate", "[libopenshot][framemapper]" )
+{
+	// Create a reader
+	DummyReader r(Fraction(24,1), 720, 480, 22000, 2, 5.0);
+
+	// Create mapping 24 fps and 60 fps (each new frame is between 2 original frames)
+	FrameMapper mapping(&r, Fraction(60, 1), PULLDOWN_INTERPOLATE, 22000, 2, LAYOUT_STEREO);
+	MappedFrame frame2 = mapping.GetMappedFrame(2);
+	MappedFrame frame3 = mapping.GetMappedFrame(3);
+	MappedFrame frame6 = mapping.GetMappedFrame(6);
+
+	CHECK(frame2.Odd.Frame == 1);
+	CHECK(frame2.Even.Frame == 2);
+	CHECK(frame2.Blend == Detail::Approx(0.4).margin(0.0001));
+	CHECK(frame3.Odd.Frame == 1);
+	CHECK(frame3.Even.Frame == 2);
+	CHECK(frame3.Blend == Detail::Approx(0.8).margin(0.0001));
+
+	// Frames at the same time as an original frame are not interpolated
+	CHECK(frame6.Odd.Frame == 3);
+	CHECK(frame6.Even.Frame == 3);
+	CHECK(frame6.Blend == 0.0);
+}
+
 TEST_CASE( "SampleRange", "[libopenshot][framemapper]")
 {
 	openshot::Fraction fps(30, 1);
@@ -0,0 +1,108 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::GpuCompositor
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <vector>
+
+#include <QColor>
+#include <QImage>
+#include <QTransform>
+
+#include "openshot_catch.h"
+
+#include "GpuCompositor.h"
+#include "PixelKernels.h"
+
+using namespace openshot;
+
+// Describe an image as a layer (untransformed)
+static GpuLayer image_layer(const QImage& image)
+{
+	GpuLayer layer;
+	layer.layer.pixels = image.constBits();
+	layer.layer.bytes_per_line = image.bytesPerLine();
+	layer.layer.x = 0;
+	layer.layer.y = 0;
+	layer.layer.width = image.width();
+	layer.layer.height = image.height();
+	return layer;
+}
+
+TEST_CASE( "Not available without a GUI application", "[libopenshot][gpucompositor]" )
+{
+	// The tests have no QGuiApplication (so no offscreen surface)
+	GpuCompositor *compositor = GpuCompositor::Instance();
+	CHECK_FALSE(compositor->Initialize());
+	CHECK_FALSE(compositor->IsAvailable());
+
+	QImage canvas(8, 8, QImage::Format_RGBA8888_Premultiplied);
+	canvas.fill(QColor(Qt::blue));
+	QImage image(4, 4, QImage::Format_RGBA8888_Premultiplied);
+	image.fill(QColor(Qt::red));
+	CHECK_FALSE(compositor->Composite(canvas, QColor(Qt::black), { image_layer(image) }));
+	CHECK(canvas.pixelColor(0, 0) == QColor(Qt::blue));
+}
+
+TEST_CASE( "Transform layers", "[libopenshot][gpucompositor]" )
+{
+	QImage canvas(16, 16, QImage::Format_RGBA8888_Premultiplied);
+	QImage image(4, 4, QImage::Format_RGBA8888_Premultiplied);
+	image.fill(QColor(Qt::red));
+
+	// Scale the layer 2x, and move it to (4, 6)
+	GpuLayer layer = image_layer(image);
+	layer.transform = QTransform::fromTranslate(4, 6).scale(2, 2);
+	layer.transformed = true;
+	layer.smooth = false;
+	GpuCompositor::CompositeOnCpu(canvas, QColor(Qt::black), { layer });
+
+	CHECK(canvas.pixelColor(4, 6) == QColor(Qt::red));
+	CHECK(canvas.pixelColor(11, 13) == QColor(Qt::red));
+	CHECK(canvas.pixelColor(3, 6) == QColor(Qt::black));
+	CHECK(canvas.pixelColor(12, 13) == QColor(Qt::black));
+	CHECK(canvas.pixelColor(4, 14) == QColor(Qt::black));
+}
+
+TEST_CASE( "Deferred effects and solid layers", "[libopenshot][gpucompositor]" )
+{
+	QImage canvas(8, 8, QImage::Format_RGBA8888_Premultiplied);
+	canvas.fill(QColor(Qt::green));
+	QImage image(4, 8, QImage::Format_RGBA8888_Premultiplied);
+	image.fill(QColor(Qt::red));
+
+	// The negated image covers the left half, and a solid blue layer the bottom right quarter
+	GpuLayer negated = image_layer(image);
+	PixelOperation negate;
+	negate.type = PixelOperation::NEGATE;
+	negated.operations.push_back(negate);
+
+	GpuLayer solid;
+	solid.layer.pixels = nullptr;
+	solid.layer.bytes_per_line = 0;
+	solid.layer.solid = true;
+	solid.layer.color[2] = 255;
+	solid.layer.color[3] = 255;
+	solid.layer.x = 4;
+	solid.layer.y = 4;
+	solid.layer.width = 4;
+	solid.layer.height = 4;
+	solid.transform = QTransform::fromTranslate(4, 4);
+
+	// The canvas' pixels are kept (without a background color)
+	GpuCompositor::CompositeOnCpu(canvas, QColor(), { negated, solid });
+	CHECK(canvas.pixelColor(0, 0) == QColor(Qt::cyan));
+	CHECK(canvas.pixelColor(3, 7) == QColor(Qt::cyan));
+	CHECK(canvas.pixelColor(4, 0) == QColor(Qt::green));
+	CHECK(canvas.pixelColor(7, 7) == QColor(Qt::blue));
+
+	// The source image is not changed by its effects
+	CHECK(image.pixelColor(0, 0) == QColor(Qt::red));
+}
@@ -0,0 +1,153 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::HardwareDevices
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "openshot_catch.h"
+
+#include "HardwareDevices.h"
+#include "Settings.h"
+
+using namespace openshot;
+
+TEST_CASE( "Fixed device", "[libopenshot][hardwaredevices]" )
+{
+	HardwareDevices *devices = HardwareDevices::Instance();
+	Settings *s = Settings::Instance();
+	s->HW_DEVICE_POLICY = 0;
+	s->HW_DEVICE_COUNT = 3;
+	s->HW_DE_DEVICE_SET = 1;
+	s->HW_EN_DEVICE_SET = 2;
+	s->HW_DE_MAX_SESSIONS = 2;
+	s->HW_EN_MAX_SESSIONS = 0;
+
+	CHECK(devices->DeviceCount() == 3);
+	CHECK(devices->Acquire(HARDWARE_DECODE_SESSION) == 1);
+	CHECK(devices->Acquire(HARDWARE_DECODE_SESSION) == 1);
+	CHECK(devices->Sessions(HARDWARE_DECODE_SESSION, 1) == 2);
+
+	// The GPU is full, so the next reader decodes in software
+	CHECK(devices->Acquire(HARDWARE_DECODE_SESSION) == -1);
+
+	// Encoders have their own device and limit
+	CHECK(devices->Acquire(HARDWARE_ENCODE_SESSION) == 2);
+	CHECK(devices->Sessions(HARDWARE_ENCODE_SESSION, 2) == 1);
+	CHECK(devices->Sessions(HARDWARE_DECODE_SESSION, 2) == 0);
+
+	devices->Release(HARDWARE_DECODE_SESSION, 1);
+	CHECK(devices->Acquire(HARDWARE_DECODE_SESSION) == 1);
+	devices->Release(HARDWARE_DECODE_SESSION, 1);
+	devices->Release(HARDWARE_DECODE_SESSION, 1);
+	devices->Release(HARDWARE_ENCODE_SESSION, 2);
+	devices->Release(HARDWARE_ENCODE_SESSION, -1);
+	CHECK(devices->Sessions(HARDWARE_DECODE_SESSION, 1) == 0);
+	CHECK(devices->Sessions(HARDWARE_ENCODE_SESSION, 2) == 0);
+
+	s->HW_DE_DEVICE_SET = 0;
+	s->HW_EN_DEVICE_SET = 0;
+	s->HW_DE_MAX_SESSIONS = 0;
+	s->HW_DEVICE_COUNT = 0;
+}
+
+TEST_CASE( "Round-robin", "[libopenshot][hardwaredevices]" )
+{
+	HardwareDevices *devices = HardwareDevices::Instance();
+	Settings *s = Settings::Instance();
+	s->HW_DEVICE_POLICY = 1;
+	s->HW_DEVICE_COUNT = 3;
+	s->HW_DE_MAX_SESSIONS = 1;
+
+	const int first = devices->Acquire(HARDWARE_DECODE_SESSION);
+	const int second = devices->Acquire(HARDWARE_DECODE_SESSION);
+	const int third = devices->Acquire(HARDWARE_DECODE_SESSION);
+	CHECK(second == (first + 1) % 3);
+	CHECK(third == (first + 2) % 3);
+	CHECK(devices->Acquire(HARDWARE_DECODE_SESSION) == -1);
+
+	// Full GPUs are skipped
+	devices->Release(HARDWARE_DECODE_SESSION, second);
+	CHECK(devices->Acquire(HARDWARE_DECODE_SESSION) == second);
+
+	devices->Release(HARDWARE_DECODE_SESSION, first);
+	devices->Release(HARDWARE_DECODE_SESSION, second);
+	devices->Release(HARDWARE_DECODE_SESSION, third);
+
+	s->HW_DEVICE_POLICY = 0;
+	s->HW_DE_MAX_SESSIONS = 0;
+	s->HW_DEVICE_COUNT = 0;
+}
+
+TEST_CASE( "Least-loaded", "[libopenshot][hardwaredevices]" )
+{
+	HardwareDevices *devices = HardwareDevices::Instance();
+	Settings *s = Settings::Instance();
+	s->HW_DEVICE_POLICY = 2;
+	s->HW_DEVICE_COUNT = 2;
+	s->HW_EN_MAX_SESSIONS = 2;
+
+	CHECK(devices->Acquire(HARDWARE_ENCODE_SESSION) == 0);
+	CHECK(devices->Acquire(HARDWARE_ENCODE_SESSION) == 1);
+	CHECK(devices->Acquire(HARDWARE_ENCODE_SESSION) == 0);
+	devices->Release(HARDWARE_ENCODE_SESSION, 0);
+	devices->Release(HARDWARE_ENCODE_SESSION, 0);
+
+	// The GPU with the fewest sessions
+	CHECK(devices->Acquire(HARDWARE_ENCODE_SESSION) == 0);
+	CHECK(devices->Acquire(HARDWARE_ENCODE_SESSION) == 0);
+	CHECK(devices->Acquire(HARDWARE_ENCODE_SESSION) == 1);
+	CHECK(devices->Acquire(HARDWARE_ENCODE_SESSION) == -1);
+
+	devices->Release(HARDWARE_ENCODE_SESSION, 0);
+	devices->Release(HARDWARE_ENCODE_SESSION, 0);
+	devices->Release(HARDWARE_ENCODE_SESSION, 1);
+	devices->Release(HARDWARE_ENCODE_SESSION, 1);
+	CHECK(devices->Sessions(HARDWARE_ENCODE_SESSION, 0) == 0);
+	CHECK(devices->Sessions(HARDWARE_ENCODE_SESSION, 1) == 0);
+
+	s->HW_DEVICE_POLICY = 0;
+	s->HW_EN_MAX_SESSIONS = 0;
+	s->HW_DEVICE_COUNT = 0;
+}
+
+TEST_CASE( "Decode support is remembered per GPU and kind of stream", "[libopenshot][hardwaredevices]" )
+{
+	HardwareDevices *devices = HardwareDevices::Instance();
+	devices->ClearDecodeSupport();
+
+	// Unknown until a reader found out
+	CHECK(devices->DecodeSupport(2, 0, 27, 100, 1920, 1080) == -1);
+
+	devices->SetDecodeSupport(2, 0, 27, 100, 1920, 1080, true);
+	devices->SetDecodeSupport(2, 0, 27, 100, 7680, 4320, false);
+	CHECK(devices->DecodeSupport(2, 0, 27, 100, 1920, 1080) == 1);
+	CHECK(devices->DecodeSupport(2, 0, 27, 100, 7680, 4320) == 0);
+
+	// Another GPU, codec, profile or size is not known yet
+	CHECK(devices->DecodeSupport(2, 1, 27, 100, 1920, 1080) == -1);
+	CHECK(devices->DecodeSupport(2, 0, 173, 100, 1920, 1080) == -1);
+	CHECK(devices->DecodeSupport(2, 0, 27, 77, 1920, 1080) == -1);
+	CHECK(devices->DecodeSupport(2, 0, 27, 100, 1280, 720) == -1);
+
+	// The last answer wins, until cleared
+	devices->SetDecodeSupport(2, 0, 27, 100, 1920, 1080, false);
+	CHECK(devices->DecodeSupport(2, 0, 27, 100, 1920, 1080) == 0);
+	devices->ClearDecodeSupport();
+	CHECK(devices->DecodeSupport(2, 0, 27, 100, 1920, 1080) == -1);
+}
+
+#if USE_HW_ACCEL
+TEST_CASE( "Device names", "[libopenshot][hardwaredevices]" )
+{
+	// CUDA devices are opened by number
+	CHECK(HardwareDevices::DeviceName(AV_HWDEVICE_TYPE_CUDA, 1) == "1");
+	// Missing render nodes open the default device
+	CHECK(HardwareDevices::DeviceName(AV_HWDEVICE_TYPE_VAAPI, 63) == "");
+}
+#endif
@@ -0,0 +1,115 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::ImageBufferPool
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <memory>
+
+#include "openshot_catch.h"
+
+#include "ImageBufferPool.h"
+#include "Frame.h"
+#include "Settings.h"
+#include "ThreadAffinity.h"
+
+using namespace openshot;
+
+TEST_CASE( "Acquire and Release", "[libopenshot][imagebufferpool]" )
+{
+	ImageBufferPool *pool = ImageBufferPool::Instance();
+	pool->Clear();
+	CHECK(pool->GetIdleBytes() == 0);
+
+	// Released buffers are re-used for the same size
+	uint8_t *buffer = pool->Acquire(1000);
+	pool->Release(buffer);
+	CHECK(pool->GetIdleBytes() == 1000);
+	CHECK(pool->Acquire(1000) == buffer);
+	CHECK(pool->GetIdleBytes() == 0);
+
+	// Other sizes get a different buffer
+	uint8_t *other_buffer = pool->Acquire(2000);
+	CHECK(other_buffer != buffer);
+	pool->Release(buffer);
+	pool->Release(other_buffer);
+	CHECK(pool->GetIdleBytes() == 3000);
+
+	pool->Clear();
+	CHECK(pool->GetIdleBytes() == 0);
+}
+
+TEST_CASE( "Max bytes", "[libopenshot][imagebufferpool]" )
+{
+	ImageBufferPool *pool = ImageBufferPool::Instance();
+	pool->Clear();
+	int64_t original_max_bytes = pool->GetMaxBytes();
+
+	// Buffers which don't fit in the pool are freed
+	pool->SetMaxBytes(1500);
+	uint8_t *buffer1 = pool->Acquire(1000);
+	uint8_t *buffer2 = pool->Acquire(1000);
+	pool->Release(buffer1);
+	pool->Release(buffer2);
+	CHECK(pool->GetIdleBytes() == 1000);
+
+	// Shrinking the pool frees idle buffers
+	pool->SetMaxBytes(0);
+	CHECK(pool->GetIdleBytes() == 0);
+
+	pool->SetMaxBytes(original_max_bytes);
+	CHECK(pool->GetMaxBytes() == original_max_bytes);
+}
+
+TEST_CASE( "CreateImage", "[libopenshot][imagebufferpool]" )
+{
+	ImageBufferPool *pool = ImageBufferPool::Instance();
+	pool->Clear();
+
+	std::shared_ptr<QImage> image = pool->CreateImage(64, 32, QImage::Format_RGBA8888_Premultiplied);
+	CHECK(image->width() == 64);
+	CHECK(image->height() == 32);
+	CHECK(image->bytesPerLine() == 64 * 4);
+	CHECK(image->format() == QImage::Format_RGBA8888_Premultiplied);
+	const uchar *pixels = image->constBits();
+
+	// The buffer returns to the pool when the image is deleted
+	image.reset();
+	CHECK(pool->GetIdleBytes() == 64 * 32 * 4);
+
+	// Blank frames draw their image from the pool
+	Frame f(1, 64, 32, "#ff0000");
+	CHECK(f.GetImage()->constBits() == pixels);
+	CHECK(pool->GetIdleBytes() == 0);
+	CHECK(f.GetImage()->pixelColor(10, 10) == QColor(Qt::red));
+
+	pool->Clear();
+}
+
+TEST_CASE( "NUMA local buffers", "[libopenshot][imagebufferpool]" )
+{
+	ImageBufferPool *pool = ImageBufferPool::Instance();
+	pool->Clear();
+	Settings::Instance()->NUMA_LOCAL_BUFFERS = true;
+
+	// Stay on one node, so the buffer is re-used
+	const std::vector<int> cpus = ThreadAffinity::CurrentThreadCpus();
+	ThreadAffinity::PinCurrentThreadToNode(ThreadAffinity::CurrentNode());
+
+	uint8_t *buffer = pool->Acquire(4096);
+	pool->Release(buffer);
+	CHECK(pool->GetIdleBytes() == 4096);
+	CHECK(pool->Acquire(4096) == buffer);
+	CHECK(pool->GetIdleBytes() == 0);
+	pool->Release(buffer);
+
+	ThreadAffinity::PinCurrentThread(cpus);
+	Settings::Instance()->NUMA_LOCAL_BUFFERS = false;
+	pool->Clear();
+}
@@ -0,0 +1,90 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::ImageSequenceReader
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "openshot_catch.h"
+
+#include <QColor>
+#include <QDir>
+#include <QImage>
+
+#include "ImageSequenceReader.h"
+#include "Exceptions.h"
+#include "Frame.h"
+
+using namespace openshot;
+
+// Write a sequence of images (each filled with a different shade of red)
+static QDir write_sequence(QString name, int count)
+{
+	QDir temp_path = QDir::tempPath() + QString("/") + name + QString("/");
+	temp_path.removeRecursively();
+	temp_path.mkpath(".");
+	for (int number = 1; number <= count; number++) {
+		QImage image(64, 36, QImage::Format_RGBA8888);
+		image.fill(QColor(number * 10, 0, 0));
+		image.save(temp_path.filePath(QString::asprintf("frame.%04d.png", number)));
+	}
+	return temp_path;
+}
+
+TEST_CASE( "Missing sequence", "[libopenshot][imagesequencereader]" )
+{
+	QDir temp_path = write_sequence("image-sequence-missing", 0);
+	CHECK_THROWS_AS(ImageSequenceReader(temp_path.filePath("frame.%04d.png").toStdString()), InvalidFile);
+	temp_path.removeRecursively();
+}
+
+TEST_CASE( "Read sequence", "[libopenshot][imagesequencereader]" )
+{
+	QDir temp_path = write_sequence("image-sequence-read", 20);
+	ImageSequenceReader r(temp_path.filePath("frame.%04d.png").toStdString(), Fraction(24, 1));
+
+	// Check invalid frame request
+	CHECK_THROWS_AS(r.GetFrame(1), ReaderClosed);
+
+	CHECK(r.info.video_length == 20);
+	CHECK(r.info.width == 64);
+	CHECK(r.info.height == 36);
+	CHECK(r.info.fps.num == 24);
+	CHECK(r.info.duration == Detail::Approx(20 / 24.0).margin(0.0001));
+	CHECK(r.info.has_video);
+	CHECK_FALSE(r.info.has_audio);
+
+	// Forwards, and backwards (each frame decoded ahead is the right file)
+	r.Open();
+	for (int64_t number : {1, 2, 3, 4, 5, 12, 11, 10, 9, 20}) {
+		std::shared_ptr<Frame> f = r.GetFrame(number);
+		CHECK(f->number == number);
+		CHECK(f->GetWidth() == 64);
+		CHECK(f->GetHeight() == 36);
+		CHECK(f->GetPixels(0)[0] == number * 10);
+	}
+
+	// Out of bounds frames are the first and last file
+	CHECK(r.GetFrame(0)->GetPixels(0)[0] == 10);
+	CHECK(r.GetFrame(25)->GetPixels(0)[0] == 200);
+	r.Close();
+	temp_path.removeRecursively();
+}
+
+TEST_CASE( "Sequence JSON", "[libopenshot][imagesequencereader]" )
+{
+	QDir temp_path = write_sequence("image-sequence-json", 3);
+	ImageSequenceReader r(temp_path.filePath("frame.%04d.png").toStdString());
+	r.SetPrefetchFrames(2);
+
+	ImageSequenceReader r2(temp_path.filePath("frame.%04d.png").toStdString(), Fraction(25, 1), false);
+	r2.SetJson(r.Json());
+	CHECK(r2.GetPrefetchFrames() == 2);
+	CHECK(r2.Json() == r.Json());
+	temp_path.removeRecursively();
+}
@@ -15,6 +15,9 @@
 #include <sstream>
 #include <memory>
 
+#include <QFile>
+#include <QImage>
+
 #include "openshot_catch.h"
 
 #include "ImageWriter.h"
@@ -116,4 +119,36 @@ TEST_CASE( "Gif", "[libopenshot][imagewriter]" )
 	CHECK((int)pixels[pixel_index + 2] == Detail::Approx(11).margin(5));
 	CHECK((int)pixels[pixel_index + 3] == Detail::Approx(255).margin(5));
 }
+
+TEST_CASE( "Image sequence", "[libopenshot][imagewriter]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	FFmpegReader r(path.str());
+	r.Open();
+
+	// Write each frame to its own PNG file (encoded in parallel)
+	ImageWriter w("output-sequence.png");
+	w.SetVideoOptions("PNG", r.info.fps, 320, 180, 70, 1, false);
+	w.SetCacheSize(4);
+	w.Open();
+	w.WriteFrame(&r, 500, 509);
+	w.Close();
+
+	// Each file has the frame's image (at the new size)
+	for (int index = 0; index < 10; index++) {
+		QString file_path = QString("output-sequence-%1.png").arg(index);
+		QImage image(file_path);
+		CHECK(image.width() == 320);
+		CHECK(image.height() == 180);
+
+		QImage expected = r.GetFrame(500 + index)->GetImage()->scaled(320, 180, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+		QColor pixel = image.pixelColor(100, 100);
+		QColor expected_pixel = expected.pixelColor(100, 100);
+		CHECK(pixel.red() == Detail::Approx(expected_pixel.red()).margin(2));
+		CHECK(pixel.green() == Detail::Approx(expected_pixel.green()).margin(2));
+		QFile::remove(file_path);
+	}
+	r.Close();
+}
 #endif  // USE_IMAGEMAGICK
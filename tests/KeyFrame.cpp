@@ -12,8 +12,10 @@
 
 #include "openshot_catch.h"
 
+#include <cmath>
 #include <sstream>
 #include <memory>
+#include <vector>
 
 #include "KeyFrame.h"
 #include "Coordinate.h"
@@ -480,6 +482,108 @@ TEST_CASE( "handle large segment", "[libopenshot][keyframe]" )
 	CHECK(kf.IsIncreasing(10) == true);
 }
 
+TEST_CASE( "GetValue after changing Points", "[libopenshot][keyframe]" )
+{
+	Keyframe kf;
+	kf.AddPoint(1, 0, LINEAR);
+	kf.AddPoint(101, 100, LINEAR);
+
+	// Values are baked on first use
+	CHECK(kf.GetValue(51) == Detail::Approx(50.0).margin(0.0001));
+
+	// Adding, updating and removing points discards the baked values
+	kf.AddPoint(51, 0, LINEAR);
+	CHECK(kf.GetValue(51) == Detail::Approx(0.0).margin(0.0001));
+	CHECK(kf.GetValue(76) == Detail::Approx(50.0).margin(0.0001));
+
+	kf.UpdatePoint(1, Point(51, 10, LINEAR));
+	CHECK(kf.GetValue(51) == Detail::Approx(10.0).margin(0.0001));
+
+	kf.RemovePoint(1);
+	CHECK(kf.GetValue(51) == Detail::Approx(50.0).margin(0.0001));
+
+	kf.ScalePoints(2.0);
+	CHECK(kf.GetValue(202) == Detail::Approx(100.0).margin(0.0001));
+
+	kf.FlipPoints();
+	CHECK(kf.GetValue(1) == Detail::Approx(100.0).margin(0.0001));
+
+	// Copies keep their own values after the original changes
+	Keyframe copy = kf;
+	kf.SetJsonValue(Keyframe(5.0).JsonValue());
+	CHECK(kf.GetValue(101) == Detail::Approx(5.0).margin(0.0001));
+	CHECK(copy.GetValue(1) == Detail::Approx(100.0).margin(0.0001));
+	CHECK(copy.GetValue(202) == Detail::Approx(0.0).margin(0.0001));
+}
+
+TEST_CASE( "IsConstant and ConstantOver", "[libopenshot][keyframe]" )
+{
+	// No points, 1 point, and several points with the same value
+	CHECK(Keyframe().IsConstant());
+	CHECK(Keyframe(0.5).IsConstant());
+	Keyframe flat;
+	flat.AddPoint(1, 2.0);
+	flat.AddPoint(50, 2.0);
+	CHECK(flat.IsConstant());
+	CHECK(flat.GetValue(25) == Detail::Approx(2.0).margin(0.0001));
+	CHECK(flat.IsIncreasing(25));
+
+	// A hold (linear), a ramp, and a hold (constant interpolation)
+	Keyframe kf;
+	kf.AddPoint(1, 0.0, LINEAR);
+	kf.AddPoint(10, 0.0, LINEAR);
+	kf.AddPoint(20, 1.0, LINEAR);
+	kf.AddPoint(30, 1.0, LINEAR);
+	kf.AddPoint(40, 5.0, CONSTANT);
+	CHECK_FALSE(kf.IsConstant());
+	CHECK(kf.ConstantOver(1, 10));
+	CHECK(kf.ConstantOver(-5, 3));
+	CHECK_FALSE(kf.ConstantOver(5, 11));
+	CHECK_FALSE(kf.ConstantOver(10, 20));
+	CHECK(kf.ConstantOver(20, 30));
+	CHECK(kf.ConstantOver(30, 39));
+	CHECK_FALSE(kf.ConstantOver(30, 40));
+	CHECK(kf.ConstantOver(40, 100));
+	CHECK(kf.ConstantOver(15, 15));
+
+	// The points changed
+	kf.AddPoint(5, 3.0, LINEAR);
+	CHECK_FALSE(kf.ConstantOver(1, 10));
+}
+
+TEST_CASE( "GetValues", "[libopenshot][keyframe]" )
+{
+	Keyframe kf;
+	kf.AddPoint(10, 0.0, LINEAR);
+	kf.AddPoint(50, 100.0, BEZIER);
+	kf.AddPoint(60, 20.0, CONSTANT);
+
+	// Consecutive values match GetValue (including indexes before the first and after the last point)
+	std::vector<double> values(80);
+	kf.GetValues(-5, values.size(), values.data());
+	for (int64_t offset = 0; offset < (int64_t) values.size(); offset++)
+		CHECK(values[offset] == Detail::Approx(kf.GetValue(offset - 5)).margin(0.0001));
+
+	// Curves too long to bake, and points between indexes
+	Keyframe long_curve;
+	long_curve.AddPoint(1, 0.0, LINEAR);
+	long_curve.AddPoint(100000, 1000.0, BEZIER);
+	long_curve.AddPoint(100000.5, 3.0, LINEAR);
+	long_curve.AddPoint(200000, 5.0, CONSTANT);
+	std::vector<double> long_values(200010);
+	long_curve.GetValues(1, long_values.size(), long_values.data());
+	for (int64_t index = 1; index <= (int64_t) long_values.size(); index += 997)
+		CHECK(long_values[index - 1] == Detail::Approx(long_curve.GetValue(index)).margin(0.0001));
+	CHECK(long_values[99999] == Detail::Approx(1000.0).margin(0.0001));
+	CHECK(long_values[100000] == Detail::Approx(long_curve.GetValue(100001)).margin(0.0001));
+
+	// Constant curves
+	Keyframe constant(0.25);
+	constant.GetValues(1, 10, values.data());
+	CHECK(values[0] == Detail::Approx(0.25).margin(0.0001));
+	CHECK(values[9] == Detail::Approx(0.25).margin(0.0001));
+}
+
 TEST_CASE( "std::vector<Point> constructor", "[libopenshot][keyframe]" )
 {
 	std::vector<Point> points{Point(1, 10), Point(5, 20), Point(10, 30)};
@@ -569,6 +673,95 @@ R"(│Frame# (X) │     Y Value │ Delta Y │ Increasing?│
 	CHECK(output.str().substr(0, expected.size()) == expected);
 }
 
+TEST_CASE( "AddPoints (large curves)", "[libopenshot][keyframe]" )
+{
+	// A curve generated from data (i.e. tracking or audio)
+	std::vector<double> x;
+	std::vector<double> y;
+	std::vector<Point> points;
+	for (int index = 1; index <= 100000; index++) {
+		x.push_back(index);
+		y.push_back(std::sin(index * 0.01) * 100.0);
+		points.push_back(Point(Coordinate(x.back(), y.back()), LINEAR));
+	}
+	Keyframe compact(x, y);
+	Keyframe added(points);
+	REQUIRE(compact.GetCount() == 100000);
+	CHECK(added.GetCount() == 100000);
+	CHECK(compact.GetLength() == 100000);
+
+	// The same points and values (with their exact Y values)
+	CHECK(compact.GetPoint(499).co.Y == y[499]);
+	CHECK(compact.GetPoint(499).interpolation == LINEAR);
+	for (int64_t index = 1; index <= 100000; index += 997) {
+		CHECK(compact.GetValue(index) == added.GetValue(index));
+		CHECK(compact.GetValue(index + 0.5) == added.GetValue(index + 0.5));
+	}
+	CHECK(compact.Contains(Point(50000, 0)));
+	CHECK(compact.Json() == added.Json());
+
+	// Each point takes the size of its X, its Y and its interpolation (not 3 coordinates)
+	CHECK(compact.GetBytes() < 100000 * 20);
+	CHECK(compact.GetBytes() * 3 < int64_t(100000 * sizeof(Point)));
+
+	// Y values which are floats take less memory
+	std::vector<double> float_y(x.size(), 0.0);
+	for (size_t index = 0; index < x.size(); index++)
+		float_y[index] = float(y[index]);
+	CHECK(Keyframe(x, float_y).GetBytes() < compact.GetBytes());
+
+	// Points out of order (or before the last point) are sorted
+	Keyframe unordered(std::vector<double>{5, 1, 3}, std::vector<double>{50, 10, 30});
+	CHECK(unordered.GetPoint(0).co.X == 1);
+	CHECK(unordered.GetPoint(2).co.Y == 50);
+	unordered.AddPoints(std::vector<double>{2}, std::vector<double>{20});
+	CHECK(unordered.GetPoint(1).co.Y == 20);
+	CHECK(unordered.GetValue(4) == Detail::Approx(40.0).margin(0.0001));
+	CHECK_THROWS_AS(unordered.AddPoints(std::vector<double>{10, 11}, std::vector<double>{1}), OutOfBoundsPoint);
+}
+
+TEST_CASE( "Handles are kept with their points", "[libopenshot][keyframe]" )
+{
+	Keyframe kf;
+	kf.AddPoint(1, 0.0);
+	Point custom(100, 50.0, BEZIER);
+	custom.handle_type = MANUAL;
+	custom.Initialize_LeftHandle(0.25, 0.75);
+	custom.Initialize_RightHandle(0.6, 0.1);
+	kf.AddPoint(custom);
+	kf.AddPoint(200, 10.0);
+
+	// Points inserted (and removed) before the point move its handles with it
+	kf.AddPoint(50, 20.0);
+	Point found = kf.GetPoint(2);
+	CHECK(found.co.X == 100);
+	CHECK(found.handle_type == MANUAL);
+	CHECK(found.handle_left.X == Detail::Approx(0.25).margin(0.00001));
+	CHECK(found.handle_left.Y == Detail::Approx(0.75).margin(0.00001));
+	CHECK(found.handle_right.X == Detail::Approx(0.6).margin(0.00001));
+	kf.RemovePoint(1);
+	found = kf.GetPoint(1);
+	CHECK(found.co.X == 100);
+	CHECK(found.handle_right.Y == Detail::Approx(0.1).margin(0.00001));
+
+	// The other points have the default handles
+	CHECK(kf.GetPoint(0).handle_type == AUTO);
+	CHECK(kf.GetPoint(2).handle_left.X == Detail::Approx(0.5).margin(0.00001));
+	CHECK(kf.GetPoint(2).handle_left.Y == Detail::Approx(1.0).margin(0.00001));
+
+	// Replacing the point with default handles
+	kf.AddPoint(100, 50.0);
+	CHECK(kf.GetPoint(1).handle_type == AUTO);
+	CHECK(kf.GetPoint(1).handle_right.X == Detail::Approx(0.5).margin(0.00001));
+
+	// JSON keeps the handles
+	kf.UpdatePoint(1, custom);
+	Keyframe copy;
+	copy.SetJson(kf.Json());
+	CHECK(copy.GetPoint(1).handle_left.Y == Detail::Approx(0.75).margin(0.00001));
+	CHECK(copy.GetValue(150) == Detail::Approx(kf.GetValue(150)).margin(0.0001));
+}
+
 #ifdef USE_OPENCV
 TEST_CASE( "TrackedObjectBBox init", "[libopenshot][keyframe]" )
 {
@@ -663,6 +856,42 @@ TEST_CASE( "TrackedObjectBBox GetVal interpolation", "[libopenshot][keyframe]" )
 }
 
 
+TEST_CASE( "TrackedObjectBBox dense and sparse lookups", "[libopenshot][keyframe]" )
+{
+	TrackedObjectBBox kfb;
+	kfb.SetBaseFPS(Fraction(30000, 1001));
+
+	// A dense track (a box on every frame), with a gap
+	for (int64_t frame = 1; frame <= 300; frame++) {
+		if (frame < 100 || frame > 110)
+			kfb.AddBox(frame, frame / 1000.0, 0.5, 0.1, 0.1, 0.0);
+	}
+	CHECK(kfb.GetLength() == 289);
+
+	for (int64_t frame = 1; frame <= 300; frame++) {
+		CHECK(kfb.ExactlyContains(frame) == (frame < 100 || frame > 110));
+		CHECK(kfb.GetBox(frame).cx == Detail::Approx(frame / 1000.0).margin(0.0001));
+	}
+	CHECK(kfb.Contains(300));
+	CHECK_FALSE(kfb.Contains(301));
+
+	// Insert a box out of order, and replace another
+	kfb.AddBox(105, 0.9, 0.5, 0.1, 0.1, 0.0);
+	kfb.AddBox(200, 0.8, 0.5, 0.1, 0.1, 0.0);
+	CHECK(kfb.GetLength() == 290);
+	CHECK(kfb.ExactlyContains(105));
+	CHECK(kfb.GetBox(105).cx == Detail::Approx(0.9f));
+	CHECK(kfb.GetBox(200).cx == Detail::Approx(0.8f));
+	CHECK(kfb.GetBox(199).cx == Detail::Approx(0.199f));
+
+	// Boxes are kept in time order
+	double last_time = -1.0;
+	for (const auto& item : kfb.BoxVec) {
+		CHECK(item.first > last_time);
+		last_time = item.first;
+	}
+}
+
 TEST_CASE( "TrackedObjectBBox SetJson", "[libopenshot][keyframe]" )
 {
 	TrackedObjectBBox kfb;
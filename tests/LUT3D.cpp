@@ -0,0 +1,142 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::LUT3D effect
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include "openshot_catch.h"
+
+#include "EffectInfo.h"
+#include "Exceptions.h"
+#include "Frame.h"
+#include "effects/LUT3D.h"
+
+#include <QColor>
+#include <QDir>
+#include <QImage>
+
+using namespace openshot;
+
+// Write a 2x2x2 .cube file (identity, or inverted colors)
+static std::string write_cube_file(const std::string& name, bool invert)
+{
+	std::string path = (QDir::tempPath() + "/" + QString::fromStdString(name)).toStdString();
+	std::ofstream file(path);
+	file << "# Test LUT\n";
+	file << "TITLE \"" << name << "\"\n";
+	file << "LUT_3D_SIZE 2\n\n";
+	for (int b = 0; b < 2; b++)
+		for (int g = 0; g < 2; g++)
+			for (int r = 0; r < 2; r++) {
+				if (invert)
+					file << 1 - r << " " << 1 - g << " " << 1 - b << "\n";
+				else
+					file << r << " " << g << " " << b << "\n";
+			}
+	return path;
+}
+
+TEST_CASE( "identity LUT", "[libopenshot][effect][lut3d]" )
+{
+	auto f = std::make_shared<Frame>(1, 64, 32, "#ff8000");
+
+	LUT3D e(write_cube_file("lut3d-identity.cube", false), Keyframe(1.0));
+	auto f_out = e.GetFrame(f, 1);
+	QColor color = f_out->GetImage()->pixelColor(10, 10);
+
+	CHECK(color.red() == Detail::Approx(255).margin(1));
+	CHECK(color.green() == Detail::Approx(128).margin(1));
+	CHECK(color.blue() == Detail::Approx(0).margin(1));
+	CHECK(color.alpha() == 255);
+}
+
+TEST_CASE( "inverted LUT", "[libopenshot][effect][lut3d]" )
+{
+	const std::string path = write_cube_file("lut3d-invert.cube", true);
+
+	// Full intensity inverts the colors
+	auto f = std::make_shared<Frame>(1, 64, 32, "#ff8000");
+	LUT3D e(path, Keyframe(1.0));
+	QColor color = e.GetFrame(f, 1)->GetImage()->pixelColor(10, 10);
+	CHECK(color.red() == Detail::Approx(0).margin(1));
+	CHECK(color.green() == Detail::Approx(127).margin(1));
+	CHECK(color.blue() == Detail::Approx(255).margin(1));
+
+	// Zero intensity leaves the colors unchanged
+	f = std::make_shared<Frame>(1, 64, 32, "#ff8000");
+	e.intensity = Keyframe(0.0);
+	color = e.GetFrame(f, 1)->GetImage()->pixelColor(10, 10);
+	CHECK(color.red() == Detail::Approx(255).margin(1));
+	CHECK(color.green() == Detail::Approx(128).margin(1));
+	CHECK(color.blue() == Detail::Approx(0).margin(1));
+}
+
+TEST_CASE( "no LUT", "[libopenshot][effect][lut3d]" )
+{
+	auto f = std::make_shared<Frame>(1, 64, 32, "#ff8000");
+
+	// Without a LUT file, the frame is not changed
+	LUT3D e;
+	QColor color = e.GetFrame(f, 1)->GetImage()->pixelColor(10, 10);
+	CHECK(color == QColor("#ff8000"));
+}
+
+TEST_CASE( "invalid LUT files", "[libopenshot][effect][lut3d]" )
+{
+	auto f = std::make_shared<Frame>(1, 64, 32, "#ff8000");
+
+	// Missing file
+	LUT3D missing((QDir::tempPath() + "/lut3d-missing.cube").toStdString(), Keyframe(1.0));
+	CHECK_THROWS_AS(missing.GetFrame(f, 1), InvalidFile);
+
+	// Incomplete table
+	std::string path = (QDir::tempPath() + "/lut3d-incomplete.cube").toStdString();
+	{
+		std::ofstream file(path);
+		file << "LUT_3D_SIZE 2\n0 0 0\n1 0 0\n";
+	}
+	LUT3D incomplete(path, Keyframe(1.0));
+	CHECK_THROWS_AS(incomplete.GetFrame(f, 1), InvalidFormat);
+
+	// 1D LUT
+	path = (QDir::tempPath() + "/lut3d-1d.cube").toStdString();
+	{
+		std::ofstream file(path);
+		file << "LUT_1D_SIZE 2\n0 0 0\n1 1 1\n";
+	}
+	LUT3D lut_1d(path, Keyframe(1.0));
+	CHECK_THROWS_AS(lut_1d.GetFrame(f, 1), InvalidFormat);
+}
+
+TEST_CASE( "LUT3D JSON", "[libopenshot][effect][lut3d]" )
+{
+	const std::string path = write_cube_file("lut3d-json.cube", true);
+
+	// Create effect from JSON (like the timeline does)
+	EffectBase *e = EffectInfo().CreateEffect("LUT3D");
+	REQUIRE(e != NULL);
+	e->SetJson("{\"lut_path\": \"" + path + "\", \"intensity\": {\"Points\": [{\"co\": {\"X\": 1, \"Y\": 0.5}, \"interpolation\": 2}]}}");
+
+	Json::Value root = e->JsonValue();
+	CHECK(root["type"].asString() == "LUT3D");
+	CHECK(root["lut_path"].asString() == path);
+
+	// Half intensity (mid gray)
+	auto f = std::make_shared<Frame>(1, 64, 32, "#ffffff");
+	QColor color = e->GetFrame(f, 1)->GetImage()->pixelColor(10, 10);
+	CHECK(color.red() == Detail::Approx(128).margin(1));
+	CHECK(color.green() == Detail::Approx(128).margin(1));
+	CHECK(color.blue() == Detail::Approx(128).margin(1));
+
+	delete e;
+}
@@ -0,0 +1,86 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::LiveReader
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <memory>
+#include <sstream>
+
+#include "openshot_catch.h"
+
+#include "LiveReader.h"
+#include "Exceptions.h"
+#include "Frame.h"
+
+using namespace openshot;
+
+TEST_CASE( "Invalid source", "[libopenshot][livereader]" )
+{
+	LiveReader r("/invalid/live/source.ts");
+	CHECK_THROWS_AS(r.Open(), InvalidFile);
+	CHECK_FALSE(r.IsOpen());
+	CHECK_THROWS_AS(r.GetFrame(1), ReaderClosed);
+
+	LiveReader device("/dev/video99", "no-such-device");
+	CHECK_THROWS_AS(device.Open(), InvalidFormat);
+}
+
+TEST_CASE( "Ring of recent frames", "[libopenshot][livereader]" )
+{
+	// A file is decoded as fast as possible (so frames are dropped from the ring quickly)
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	LiveReader r(path.str(), "", 4);
+	r.SetTimeout(10000);
+	r.Open();
+
+	CHECK(r.info.width == 1280);
+	CHECK(r.info.height == 720);
+	CHECK(r.info.fps.ToInt() == 24);
+	CHECK(r.info.has_audio);
+	CHECK(r.info.video_length > 1000000);
+
+	// Waits for a frame which is not decoded yet
+	std::shared_ptr<Frame> f = r.GetFrame(60);
+	CHECK(f->number == 60);
+	CHECK(f->GetWidth() == 1280);
+	CHECK(r.LatestFrameNumber() >= 60);
+	CHECK(r.CurrentFrameNumber() >= 1);
+
+	// A dropped frame is replaced by the oldest frame of the ring (with silent audio)
+	std::shared_ptr<Frame> old = r.GetFrame(2);
+	CHECK(old->number == 2);
+	CHECK(old->GetWidth() == 1280);
+	CHECK(old->GetAudioSamplesCount() == Frame::GetSamplesPerFrame(2, r.info.fps, r.info.sample_rate, r.info.channels));
+	CHECK(old->GetAudioSample(0, 0, 1) == Detail::Approx(0.0f));
+
+	// Frames after the last requested frame are counted when they are dropped
+	r.GetFrame(300);
+	CHECK(r.DroppedFrames() > 0);
+
+	r.Close();
+	CHECK_FALSE(r.IsOpen());
+	CHECK_THROWS_AS(r.GetFrame(1), ReaderClosed);
+}
+
+TEST_CASE( "JSON", "[libopenshot][livereader]" )
+{
+	LiveReader r("rtmp://0.0.0.0:1935/live/camera", "flv", 6);
+	r.SetOption("listen", "1");
+
+	LiveReader copy("");
+	copy.SetJson(r.Json());
+	const Json::Value root = copy.JsonValue();
+	CHECK(root["type"].asString() == "LiveReader");
+	CHECK(root["url"].asString() == "rtmp://0.0.0.0:1935/live/camera");
+	CHECK(root["format"].asString() == "flv");
+	CHECK(root["ring_size"].asInt() == 6);
+	CHECK(root["options"]["listen"].asString() == "1");
+}
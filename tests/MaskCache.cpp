@@ -0,0 +1,136 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::MaskCache
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <memory>
+#include <sstream>
+
+#include "openshot_catch.h"
+
+#include "MaskCache.h"
+#include "Frame.h"
+#include "QtImageReader.h"
+#include "effects/Mask.h"
+
+#include <QColor>
+#include <QImage>
+
+using namespace openshot;
+
+TEST_CASE( "CreatePlane", "[libopenshot][maskcache]" )
+{
+	QImage image(4, 2, QImage::Format_RGBA8888_Premultiplied);
+	image.fill(QColor(128, 128, 128));
+
+	// Planes are scaled to the requested size
+	std::shared_ptr<const MaskPlane> plane = MaskCache::CreatePlane(image, 40, 20);
+	CHECK(plane->width == 40);
+	CHECK(plane->height == 20);
+	REQUIRE(plane->gray.size() == 800);
+	REQUIRE(plane->alpha.size() == 800);
+	CHECK(plane->GetBytes() == 1600);
+	CHECK(plane->gray[410] == 128);
+	CHECK(plane->alpha[410] == 255);
+}
+
+TEST_CASE( "Add and GetPlane", "[libopenshot][maskcache]" )
+{
+	MaskCache *cache = MaskCache::Instance();
+	cache->Clear();
+
+	QImage image(4, 4, QImage::Format_RGBA8888_Premultiplied);
+	image.fill(Qt::white);
+	std::shared_ptr<const MaskPlane> plane = MaskCache::CreatePlane(image, 10, 10);
+
+	// Planes are found by mask, frame number and size
+	cache->Add("mask", 1, plane);
+	CHECK(cache->Count() == 1);
+	CHECK(cache->GetBytes() == 200);
+	CHECK(cache->GetPlane("mask", 1, 10, 10) == plane);
+	CHECK_FALSE(cache->GetPlane("mask", 2, 10, 10));
+	CHECK_FALSE(cache->GetPlane("mask", 1, 20, 10));
+	CHECK_FALSE(cache->GetPlane("other", 1, 10, 10));
+
+	// Adding the same key replaces the plane
+	std::shared_ptr<const MaskPlane> new_plane = MaskCache::CreatePlane(image, 10, 10);
+	cache->Add("mask", 1, new_plane);
+	CHECK(cache->Count() == 1);
+	CHECK(cache->GetBytes() == 200);
+	CHECK(cache->GetPlane("mask", 1, 10, 10) == new_plane);
+
+	cache->Clear();
+	CHECK(cache->Count() == 0);
+	CHECK(cache->GetBytes() == 0);
+}
+
+TEST_CASE( "Least recently used planes are evicted", "[libopenshot][maskcache]" )
+{
+	MaskCache *cache = MaskCache::Instance();
+	cache->Clear();
+	int64_t original_max_bytes = cache->GetMaxBytes();
+
+	QImage image(4, 4, QImage::Format_RGBA8888_Premultiplied);
+	image.fill(Qt::white);
+
+	// Room for 2 planes (of 200 bytes)
+	cache->SetMaxBytes(400);
+	cache->Add("mask", 1, MaskCache::CreatePlane(image, 10, 10));
+	cache->Add("mask", 2, MaskCache::CreatePlane(image, 10, 10));
+
+	// Use frame 1, so frame 2 is the least recently used
+	CHECK(cache->GetPlane("mask", 1, 10, 10));
+	cache->Add("mask", 3, MaskCache::CreatePlane(image, 10, 10));
+	CHECK(cache->Count() == 2);
+	CHECK(cache->GetPlane("mask", 1, 10, 10));
+	CHECK_FALSE(cache->GetPlane("mask", 2, 10, 10));
+	CHECK(cache->GetPlane("mask", 3, 10, 10));
+
+	// Shrinking the cache evicts planes, and 0 disables it
+	cache->SetMaxBytes(200);
+	CHECK(cache->Count() == 1);
+	CHECK(cache->GetPlane("mask", 3, 10, 10));
+	cache->SetMaxBytes(0);
+	CHECK(cache->Count() == 0);
+	CHECK(cache->GetBytes() == 0);
+
+	cache->SetMaxBytes(original_max_bytes);
+}
+
+TEST_CASE( "Planes are shared by Mask effects", "[libopenshot][maskcache]" )
+{
+	MaskCache *cache = MaskCache::Instance();
+	cache->Clear();
+
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "mask.png";
+	QtImageReader r1(path.str());
+	QtImageReader r2(path.str());
+	Mask m1(&r1, Keyframe(0.0), Keyframe(3.0));
+	Mask m2(&r2, Keyframe(0.0), Keyframe(3.0));
+
+	// The second effect (with the same mask and size) re-uses the first plane
+	auto f1 = std::make_shared<Frame>(1, 320, 180, "#ff0000");
+	auto f2 = std::make_shared<Frame>(1, 320, 180, "#ff0000");
+	m1.GetFrame(f1, 1);
+	CHECK(cache->Count() == 1);
+	m2.GetFrame(f2, 10);
+	CHECK(cache->Count() == 1);
+
+	// Both frames are masked the same way
+	CHECK(*f1->GetImage() == *f2->GetImage());
+
+	// A different frame size needs another plane
+	auto f3 = std::make_shared<Frame>(1, 160, 90, "#ff0000");
+	m2.GetFrame(f3, 1);
+	CHECK(cache->Count() == 2);
+
+	cache->Clear();
+}
@@ -0,0 +1,88 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::MultiWriter
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <memory>
+
+#include "openshot_catch.h"
+
+#include "DummyReader.h"
+#include "Exceptions.h"
+#include "FFmpegReader.h"
+#include "FFmpegWriter.h"
+#include "Frame.h"
+#include "MultiWriter.h"
+
+using namespace openshot;
+
+// A reader which counts the frames it renders
+class CountingReader : public DummyReader {
+public:
+	int64_t rendered = 0;
+
+	CountingReader() : DummyReader(Fraction(30,1), 128, 96, 44100, 2, 1.0) {}
+
+	std::shared_ptr<Frame> GetFrame(int64_t requested_frame) override {
+		rendered++;
+		return DummyReader::GetFrame(requested_frame);
+	}
+};
+
+TEST_CASE( "Renditions", "[libopenshot][multiwriter]" )
+{
+	CountingReader r;
+	r.Open();
+
+	FFmpegWriter large("output-ladder-large.mp4");
+	large.SetAudioOptions(true, "aac", 44100, 2, LAYOUT_STEREO, 128000);
+	large.SetVideoOptions(true, "mpeg4", Fraction(30,1), 128, 96, Fraction(1,1), false, false, 1000000);
+	FFmpegWriter small("output-ladder-small.mp4");
+	small.SetAudioOptions(true, "aac", 44100, 2, LAYOUT_STEREO, 64000);
+	small.SetVideoOptions(true, "mpeg4", Fraction(30,1), 64, 48, Fraction(1,1), false, false, 250000);
+
+	MultiWriter w;
+	CHECK_THROWS_AS(w.Open(), InvalidOptions);
+	w.AddWriter(&large);
+	w.AddWriter(&small);
+	w.SetQueueSize(2);
+	CHECK(w.Writers().size() == 2);
+	CHECK_THROWS_AS(w.WriteFrame(r.GetFrame(1)), WriterClosed);
+
+	w.Open();
+	CHECK(w.IsOpen());
+	CHECK(large.IsOpen());
+	CHECK(w.info.width == 128);
+	CHECK_THROWS_AS(w.AddWriter(&large), InvalidOptions);
+
+	// Each frame is rendered once, for both outputs
+	r.rendered = 0;
+	w.WriteFrame(&r, 1, 30);
+	CHECK(r.rendered == 30);
+	w.Close();
+	CHECK_FALSE(w.IsOpen());
+	CHECK_FALSE(small.IsOpen());
+	r.Close();
+
+	// Each output has its own size
+	FFmpegReader r1("output-ladder-large.mp4");
+	r1.Open();
+	CHECK(r1.info.width == 128);
+	CHECK(r1.info.has_audio);
+	CHECK(r1.info.duration == Detail::Approx(1.0).margin(0.1));
+	r1.Close();
+
+	FFmpegReader r2("output-ladder-small.mp4");
+	r2.Open();
+	CHECK(r2.info.width == 64);
+	CHECK(r2.info.height == 48);
+	CHECK(r2.info.duration == Detail::Approx(1.0).margin(0.1));
+	r2.Close();
+}
@@ -0,0 +1,82 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::NoiseGenerator
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <vector>
+
+#include "openshot_catch.h"
+
+#include "audio_effects/NoiseGenerator.h"
+
+using namespace openshot;
+
+TEST_CASE( "uniform range and mean", "[libopenshot][noisegenerator]" )
+{
+	NoiseGenerator generator(NoiseGenerator::SeedFor(1));
+	std::vector<float> block(100000);
+	generator.FillUniform(block.data(), int(block.size()));
+
+	double sum = 0.0;
+	double sum_squares = 0.0;
+	int histogram[10] = {};
+	for (float value : block) {
+		REQUIRE(value >= 0.0f);
+		REQUIRE(value < 1.0f);
+		sum += value;
+		sum_squares += double(value) * value;
+		histogram[int(value * 10)]++;
+	}
+	const double mean = sum / block.size();
+	CHECK(mean == Approx(0.5).margin(0.01));
+	CHECK(sum_squares / block.size() - mean * mean == Approx(1.0 / 12.0).margin(0.002));
+	for (int bucket = 0; bucket < 10; bucket++)
+		CHECK(histogram[bucket] == Approx(10000).margin(500));
+}
+
+TEST_CASE( "blocks match single numbers", "[libopenshot][noisegenerator]" )
+{
+	NoiseGenerator blocks(NoiseGenerator::SeedFor(42, 1));
+	NoiseGenerator single(NoiseGenerator::SeedFor(42, 1));
+
+	// Blocks of any size continue the same sequence
+	std::vector<float> first(37);
+	std::vector<float> second(100);
+	blocks.FillUniform(first.data(), int(first.size()));
+	blocks.FillUniform(second.data(), int(second.size()));
+	for (float value : first)
+		CHECK(single.NextUniform() == value);
+	for (float value : second)
+		CHECK(single.NextUniform() == value);
+}
+
+TEST_CASE( "seeds", "[libopenshot][noisegenerator]" )
+{
+	// The same seed gives the same sequence (after seeding it again)
+	NoiseGenerator generator(NoiseGenerator::SeedFor(7));
+	const float first = generator.NextUniform();
+	generator.NextUniform();
+	generator.Seed(NoiseGenerator::SeedFor(7));
+	CHECK(generator.NextUniform() == first);
+
+	// Neighbouring frames and channels are unrelated
+	NoiseGenerator frame1(NoiseGenerator::SeedFor(1));
+	NoiseGenerator frame2(NoiseGenerator::SeedFor(2));
+	NoiseGenerator channel1(NoiseGenerator::SeedFor(1, 1));
+	int same_frame = 0;
+	int same_channel = 0;
+	for (int i = 0; i < 1000; i++) {
+		const float value = frame1.NextUniform();
+		same_frame += (value == frame2.NextUniform());
+		same_channel += (value == channel1.NextUniform());
+	}
+	CHECK(same_frame < 5);
+	CHECK(same_channel < 5);
+}
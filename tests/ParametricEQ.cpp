@@ -0,0 +1,105 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::ParametricEQ audio effect
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "openshot_catch.h"
+
+#include "Frame.h"
+#include "audio_effects/ParametricEQ.h"
+
+using namespace openshot;
+
+// Create a frame of a stereo sine wave (starting at an offset, in samples)
+static std::shared_ptr<Frame> sine_frame(int64_t number, int samples, int64_t offset, double frequency)
+{
+	auto frame = std::make_shared<Frame>(number, samples, 2);
+	frame->SampleRate(44100);
+	std::vector<float> wave(samples);
+	for (int sample = 0; sample < samples; sample++)
+		wave[sample] = float(0.5 * std::sin(2.0 * M_PI * frequency * (offset + sample) / 44100.0));
+	frame->AddAudio(true, 0, 0, wave.data(), samples, 1.0f);
+	frame->AddAudio(true, 1, 0, wave.data(), samples, 1.0f);
+	return frame;
+}
+
+// Get the RMS of the last half of a channel
+static double rms(std::shared_ptr<Frame> frame, int channel)
+{
+	const float *samples = frame->GetAudioSamples(channel);
+	const int count = frame->GetAudioSamplesCount();
+	double sum = 0.0;
+	for (int sample = count / 2; sample < count; sample++)
+		sum += samples[sample] * samples[sample];
+	return std::sqrt(sum / (count - count / 2));
+}
+
+TEST_CASE( "low pass uses the sample rate", "[libopenshot][effect][parametriceq]" )
+{
+	ParametricEQ low_pass(LOW_PASS, Keyframe(500.0), Keyframe(0.0), Keyframe(1.0));
+
+	// A tone well above the cutoff is attenuated, and one well below it is not
+	auto high = low_pass.GetFrame(sine_frame(1, 1470, 0, 10000.0), 1);
+	CHECK(rms(high, 0) < 0.05);
+
+	ParametricEQ low_pass2(LOW_PASS, Keyframe(5000.0), Keyframe(0.0), Keyframe(1.0));
+	auto low = low_pass2.GetFrame(sine_frame(1, 1470, 0, 120.0), 1);
+	CHECK(rms(low, 0) == Approx(0.5 / std::sqrt(2.0)).margin(0.01));
+	CHECK(rms(low, 1) == Approx(rms(low, 0)));
+}
+
+TEST_CASE( "filter state carries over consecutive frames", "[libopenshot][effect][parametriceq]" )
+{
+	// Two consecutive frames are filtered the same as one long frame
+	ParametricEQ frames(PEAKING_NOTCH, Keyframe(1000.0), Keyframe(12.0), Keyframe(2.0));
+	frames.GetFrame(sine_frame(1, 1470, 0, 440.0), 1);
+	auto second = frames.GetFrame(sine_frame(2, 1470, 1470, 440.0), 2);
+
+	ParametricEQ whole(PEAKING_NOTCH, Keyframe(1000.0), Keyframe(12.0), Keyframe(2.0));
+	auto both = whole.GetFrame(sine_frame(1, 2940, 0, 440.0), 1);
+
+	const float *expected = both->GetAudioSamples(0) + 1470;
+	const float *actual = second->GetAudioSamples(0);
+	for (int sample = 0; sample < 1470; sample += 49)
+		CHECK(actual[sample] == Approx(expected[sample]).margin(1e-5));
+
+	// A seek starts again from silence
+	ParametricEQ seek(PEAKING_NOTCH, Keyframe(1000.0), Keyframe(12.0), Keyframe(2.0));
+	auto first = seek.GetFrame(sine_frame(10, 1470, 0, 440.0), 10);
+	auto again = frames.GetFrame(sine_frame(10, 1470, 0, 440.0), 10);
+	CHECK(again->GetAudioSamples(0)[100] == Approx(first->GetAudioSamples(0)[100]).margin(1e-6));
+}
+
+TEST_CASE( "moving keyframes ramp the coefficients", "[libopenshot][effect][parametriceq]" )
+{
+	// The gain moves from 0 dB to 24 dB between frames 1 and 2
+	Keyframe gain;
+	gain.AddPoint(1, 0.0, LINEAR);
+	gain.AddPoint(2, 24.0, LINEAR);
+	ParametricEQ eq(PEAKING_NOTCH, Keyframe(1000.0), gain, Keyframe(1.0));
+	eq.GetFrame(sine_frame(1, 1470, 0, 1000.0), 1);
+	auto ramped = eq.GetFrame(sine_frame(2, 1470, 1470, 1000.0), 2);
+
+	// The start of the frame is still close to the previous gain, and the end reaches the new one
+	const float *samples = ramped->GetAudioSamples(0);
+	double start = 0.0;
+	double end = 0.0;
+	for (int sample = 0; sample < 64; sample++) {
+		start = std::max(start, double(std::fabs(samples[sample])));
+		end = std::max(end, double(std::fabs(samples[1470 - 64 + sample])));
+	}
+	CHECK(start < 1.0);
+	CHECK(end > 3.0);
+}
@@ -0,0 +1,569 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::PixelKernels
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include <QColor>
+#include <QImage>
+
+#include "openshot_catch.h"
+
+#include "PixelKernels.h"
+
+using namespace openshot;
+
+// Largest difference between two sets of pixels
+static int max_difference(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b)
+{
+	int difference = 0;
+	for (size_t i = 0; i < a.size(); i++)
+		difference = std::max(difference, std::abs(int(a[i]) - int(b[i])));
+	return difference;
+}
+
+TEST_CASE( "InstructionSet", "[libopenshot][pixelkernels]" )
+{
+	CHECK_FALSE(PixelKernels::InstructionSet().empty());
+}
+
+TEST_CASE( "No change", "[libopenshot][pixelkernels]" )
+{
+	// Premultiplied pixels (opaque, half transparent, and fully transparent)
+	const std::vector<unsigned char> original = {
+		200, 100, 50, 255,
+		64, 32, 16, 128,
+		0, 0, 0, 0 };
+	std::vector<unsigned char> pixels = original;
+
+	PixelKernels::BrightnessContrast(pixels.data(), 3, 0.0, 0.0);
+	CHECK(max_difference(pixels, original) <= 1);
+
+	pixels = original;
+	PixelKernels::Saturation(pixels.data(), 3, 1.0, 1.0, 1.0, 1.0);
+	CHECK(max_difference(pixels, original) <= 1);
+
+	pixels = original;
+	const float identity[3] = { 1.0, 0.0, 0.0 };
+	PixelKernels::HueRotate(pixels.data(), 3, identity);
+	CHECK(max_difference(pixels, original) <= 1);
+}
+
+TEST_CASE( "Premultiplied alpha", "[libopenshot][pixelkernels]" )
+{
+	std::vector<unsigned char> pixels = {
+		64, 32, 16, 128,
+		0, 0, 0, 0 };
+
+	// Full brightness is white (with the same alpha)
+	PixelKernels::BrightnessContrast(pixels.data(), 2, 1.0, 0.0);
+	CHECK((int) pixels[0] == 128);
+	CHECK((int) pixels[1] == 128);
+	CHECK((int) pixels[2] == 128);
+	CHECK((int) pixels[3] == 128);
+
+	// Fully transparent pixels stay transparent
+	CHECK((int) pixels[4] == 0);
+	CHECK((int) pixels[5] == 0);
+	CHECK((int) pixels[6] == 0);
+	CHECK((int) pixels[7] == 0);
+}
+
+TEST_CASE( "Negate", "[libopenshot][pixelkernels]" )
+{
+	std::vector<unsigned char> pixels = {
+		200, 100, 50, 255,
+		64, 32, 16, 128,
+		0, 0, 0, 0 };
+	PixelKernels::Negate(pixels.data(), 3);
+
+	CHECK(pixels == std::vector<unsigned char>({
+		55, 155, 205, 255,
+		64, 96, 112, 128,
+		0, 0, 0, 0 }));
+}
+
+TEST_CASE( "Multiple blocks", "[libopenshot][pixelkernels]" )
+{
+	// Enough pixels for several blocks (and a partial last block)
+	const int64_t pixel_count = 100000;
+	std::vector<unsigned char> pixels(pixel_count * 4);
+	for (int64_t pixel = 0; pixel < pixel_count; pixel++) {
+		pixels[pixel * 4] = pixel % 256;
+		pixels[pixel * 4 + 1] = (pixel / 256) % 256;
+		pixels[pixel * 4 + 2] = 0;
+		pixels[pixel * 4 + 3] = 255;
+	}
+
+	// Greyscale pixels have the same value in every channel
+	PixelKernels::Saturation(pixels.data(), pixel_count, 0.0, 1.0, 1.0, 1.0);
+	int differences = 0;
+	for (int64_t pixel = 0; pixel < pixel_count; pixel++)
+		if (pixels[pixel * 4] != pixels[pixel * 4 + 1] || pixels[pixel * 4] != pixels[pixel * 4 + 2])
+			differences++;
+	CHECK(differences == 0);
+
+	// Negating twice restores every pixel
+	std::vector<unsigned char> original = pixels;
+	PixelKernels::Negate(pixels.data(), pixel_count);
+	PixelKernels::Negate(pixels.data(), pixel_count);
+	CHECK(pixels == original);
+}
+
+TEST_CASE( "Apply fused operations", "[libopenshot][pixelkernels]" )
+{
+	// Enough pixels for several blocks, with varying alpha
+	const int64_t pixel_count = 40000;
+	std::vector<unsigned char> original(pixel_count * 4);
+	for (int64_t pixel = 0; pixel < pixel_count; pixel++) {
+		const int alpha = (pixel * 7) % 256;
+		original[pixel * 4] = ((pixel % 256) * alpha) / 255;
+		original[pixel * 4 + 1] = (((pixel / 256) % 256) * alpha) / 255;
+		original[pixel * 4 + 2] = (((pixel * 3) % 256) * alpha) / 255;
+		original[pixel * 4 + 3] = alpha;
+	}
+
+	std::vector<PixelOperation> operations(4);
+	operations[0].type = PixelOperation::BRIGHTNESS_CONTRAST;
+	operations[0].values[0] = 0.1;
+	operations[0].values[1] = 10.0;
+	operations[1].type = PixelOperation::SATURATION;
+	operations[1].values[0] = 1.5;
+	operations[1].values[1] = 1.0;
+	operations[1].values[2] = 0.5;
+	operations[1].values[3] = 1.0;
+	operations[2].type = PixelOperation::HUE_ROTATE;
+	operations[2].values[0] = 0.5;
+	operations[2].values[1] = -0.2;
+	operations[2].values[2] = 0.7;
+	operations[3].type = PixelOperation::NEGATE;
+
+	// Apply each operation on its own
+	std::vector<unsigned char> separate = original;
+	for (const auto& operation : operations)
+		PixelKernels::Apply(separate.data(), pixel_count, { operation });
+
+	// Apply all operations in a single pass
+	std::vector<unsigned char> fused = original;
+	PixelKernels::Apply(fused.data(), pixel_count, operations);
+
+	// Only rounding differs (the fused pass doesn't round between operations)
+	CHECK(max_difference(fused, separate) <= 4);
+	int alpha_changes = 0;
+	for (int64_t pixel = 0; pixel < pixel_count; pixel++)
+		if (fused[pixel * 4 + 3] != original[pixel * 4 + 3])
+			alpha_changes++;
+	CHECK(alpha_changes == 0);
+
+	// No operations leave the pixels unchanged
+	std::vector<unsigned char> unchanged = original;
+	PixelKernels::Apply(unchanged.data(), pixel_count, {});
+	CHECK(unchanged == original);
+}
+
+// Box blur one direction of an image (the slow way)
+static std::vector<unsigned char> reference_blur(const std::vector<unsigned char>& pixels, int width, int height, int radius, bool horizontal)
+{
+	std::vector<unsigned char> result(pixels.size());
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++)
+			for (int channel = 0; channel < 4; channel++) {
+				int sum = 0;
+				for (int offset = -radius; offset <= radius; offset++) {
+					int source_x = horizontal ? std::min(std::max(x + offset, 0), width - 1) : x;
+					int source_y = horizontal ? y : std::min(std::max(y + offset, 0), height - 1);
+					sum += pixels[(source_y * width + source_x) * 4 + channel];
+				}
+				result[(y * width + x) * 4 + channel] = (unsigned char) (sum / (2.0f * radius + 1) + 0.5f);
+			}
+	return result;
+}
+
+TEST_CASE( "BoxBlur", "[libopenshot][pixelkernels]" )
+{
+	// Odd sized image (wider than a strip of columns)
+	const int width = 301;
+	const int height = 37;
+	std::vector<unsigned char> original(width * height * 4);
+	for (size_t i = 0; i < original.size(); i++)
+		original[i] = (i * 7919) % 256;
+
+	// Small, large (and larger than the image) radii
+	for (int radius : { 1, 5, 40 }) {
+		std::vector<unsigned char> pixels = original;
+		PixelKernels::BoxBlur(pixels.data(), width, height, radius, radius, 2);
+
+		std::vector<unsigned char> expected = original;
+		for (int iteration = 0; iteration < 2; iteration++) {
+			expected = reference_blur(expected, width, height, radius, true);
+			expected = reference_blur(expected, width, height, radius, false);
+		}
+		CHECK(pixels == expected);
+	}
+
+	// A single direction (with an odd number of passes)
+	std::vector<unsigned char> pixels = original;
+	PixelKernels::BoxBlur(pixels.data(), width, height, 0, 3, 3);
+	std::vector<unsigned char> expected = original;
+	for (int iteration = 0; iteration < 3; iteration++)
+		expected = reference_blur(expected, width, height, 3, false);
+	CHECK(pixels == expected);
+}
+
+TEST_CASE( "Mask", "[libopenshot][pixelkernels]" )
+{
+	// Gray values are not adjusted
+	int gray_table[256];
+	for (int gray = 0; gray < 256; gray++)
+		gray_table[gray] = gray;
+
+	// Black (visible), mid gray (half transparent) and white (transparent) mask pixels
+	const std::vector<unsigned char> mask_gray = { 0, 128, 255 };
+	const std::vector<unsigned char> mask_alpha = { 255, 255, 255 };
+	const std::vector<unsigned char> original = {
+		200, 100, 50, 255,
+		200, 100, 50, 255,
+		200, 100, 50, 255 };
+
+	std::vector<unsigned char> pixels = original;
+	PixelKernels::Mask(pixels.data(), mask_gray.data(), mask_alpha.data(), 3, gray_table, false);
+	CHECK(pixels == std::vector<unsigned char>({
+		200, 100, 50, 255,
+		99, 49, 24, 127,
+		0, 0, 0, 0 }));
+
+	// Replace the image with the new alpha
+	pixels = original;
+	PixelKernels::Mask(pixels.data(), mask_gray.data(), mask_alpha.data(), 3, gray_table, true);
+	CHECK(pixels == std::vector<unsigned char>({
+		255, 255, 255, 255,
+		127, 127, 127, 127,
+		0, 0, 0, 0 }));
+}
+
+TEST_CASE( "ChromaKey", "[libopenshot][pixelkernels]" )
+{
+	// Random premultiplied pixels (over several blocks)
+	std::srand(7);
+	const int64_t pixel_count = 40000;
+	std::vector<unsigned char> pixels(pixel_count * 4);
+	for (int64_t pixel = 0; pixel < pixel_count; pixel++) {
+		const int A = (pixel % 8 == 0) ? std::rand() % 256 : 255;
+		for (int channel = 0; channel < 3; channel++)
+			pixels[pixel * 4 + channel] = (std::rand() % 256) * A / 255;
+		pixels[pixel * 4 + 3] = A;
+	}
+
+	// Reference implementation (un-premultiply, and Color::GetDistance)
+	const int threshold = 150;
+	std::vector<unsigned char> expected = pixels;
+	for (int64_t pixel = 0; pixel < pixel_count; pixel++) {
+		unsigned char *p = expected.data() + pixel * 4;
+		float A = p[3];
+		long R = A > 0 ? (unsigned char) ((p[0] / A) * 255.0) : 0;
+		long G = A > 0 ? (unsigned char) ((p[1] / A) * 255.0) : 0;
+		long B = A > 0 ? (unsigned char) ((p[2] / A) * 255.0) : 0;
+		long rmean = (R + 0) / 2;
+		long distance = sqrt((((512 + rmean) * R * R) >> 8) + 4 * (G - 255) * (G - 255) + (((767 - rmean) * B * B) >> 8));
+		if (distance <= threshold)
+			p[0] = p[1] = p[2] = p[3] = 0;
+	}
+
+	PixelKernels::ChromaKey(pixels.data(), pixel_count, 0, 255, 0, threshold);
+	CHECK(pixels == expected);
+}
+
+TEST_CASE( "ChromaKeyAlpha", "[libopenshot][pixelkernels]" )
+{
+	// Inside the threshold, inside the halo, and outside of both
+	const std::vector<float> distances = { 5.0, 15.0, 30.0 };
+	std::vector<unsigned char> pixels = {
+		200, 100, 50, 255,
+		200, 100, 50, 255,
+		200, 100, 50, 255 };
+
+	PixelKernels::ChromaKeyAlpha(pixels.data(), distances.data(), 3, 10.0, 10.0);
+	CHECK(pixels == std::vector<unsigned char>({
+		0, 0, 0, 0,
+		100, 50, 25, 127,
+		200, 100, 50, 255 }));
+}
+
+TEST_CASE( "WaveRows", "[libopenshot][pixelkernels]" )
+{
+	const int width = 13;
+	const int height = 5;
+	const int64_t pixel_count = width * height;
+	std::vector<unsigned char> original(pixel_count * 4);
+	for (size_t i = 0; i < original.size(); i++)
+		original[i] = (i * 7919) % 256;
+
+	// No offset, small offsets (into the neighbor rows), and offsets past both ends of the image
+	const std::vector<int64_t> row_offsets = { 0, 3, -4, -100, 100 };
+	std::vector<unsigned char> pixels = original;
+	PixelKernels::WaveRows(pixels.data(), width, height, row_offsets.data());
+
+	std::vector<unsigned char> expected(original.size());
+	for (int64_t pixel = 0; pixel < pixel_count; pixel++) {
+		const int64_t source = std::min(std::max<int64_t>(pixel + row_offsets[pixel / width], 0), pixel_count - 1);
+		for (int channel = 0; channel < 4; channel++)
+			expected[pixel * 4 + channel] = original[source * 4 + channel];
+	}
+	CHECK(pixels == expected);
+}
+
+TEST_CASE( "Shift", "[libopenshot][pixelkernels]" )
+{
+	const int width = 11;
+	const int height = 7;
+	std::vector<unsigned char> original(width * height * 4);
+	for (size_t i = 0; i < original.size(); i++)
+		original[i] = (i * 7919) % 256;
+
+	// Both directions, and offsets larger than the image
+	for (int x_offset : { 0, 3, -4, 25 }) {
+		for (int y_offset : { 0, 2, -5, -15 }) {
+			std::vector<unsigned char> pixels = original;
+			PixelKernels::Shift(pixels.data(), width, height, x_offset, y_offset);
+
+			std::vector<unsigned char> expected(original.size());
+			for (int y = 0; y < height; y++) {
+				for (int x = 0; x < width; x++) {
+					const int source_x = (((x - x_offset) % width) + width) % width;
+					const int source_y = (((y - y_offset) % height) + height) % height;
+					for (int channel = 0; channel < 4; channel++)
+						expected[(y * width + x) * 4 + channel] = original[(source_y * width + source_x) * 4 + channel];
+				}
+			}
+			CHECK(pixels == expected);
+		}
+	}
+}
+
+TEST_CASE( "Bars", "[libopenshot][pixelkernels]" )
+{
+	const int width = 10;
+	const int height = 8;
+	const unsigned char color[4] = { 10, 20, 30, 255 };
+	std::vector<unsigned char> pixels(width * height * 4, 0);
+	PixelKernels::Bars(pixels.data(), width, height, color, 2, 1, 3, 20);
+
+	// Rows 0, 1 and 7 are filled, and columns 0 - 2 (and all of the columns, since the right bar is too wide)
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			const unsigned char *pixel = &pixels[(y * width + x) * 4];
+			CHECK(pixel[0] == 10);
+			CHECK(pixel[3] == 255);
+		}
+	}
+
+	// Only the top bar and the left bar
+	std::fill(pixels.begin(), pixels.end(), 0);
+	PixelKernels::Bars(pixels.data(), width, height, color, 2, 0, 3, 0);
+	CHECK(pixels[(1 * width + 9) * 4 + 2] == 30);
+	CHECK(pixels[(2 * width + 2) * 4 + 2] == 30);
+	CHECK(pixels[(2 * width + 3) * 4 + 2] == 0);
+	CHECK(pixels[(7 * width + 9) * 4 + 3] == 0);
+}
+
+TEST_CASE( "Composite", "[libopenshot][pixelkernels]" )
+{
+	// Canvas larger than a tile (with a partly transparent background)
+	const int width = 700;
+	const int height = 45;
+	std::vector<unsigned char> canvas(width * height * 4);
+	for (size_t i = 0; i < canvas.size(); i += 4) {
+		canvas[i + 3] = (i * 13) % 256;
+		for (int channel = 0; channel < 3; channel++)
+			canvas[i + channel] = ((i * 7919 + channel * 31) % 256) * canvas[i + 3] / 255;
+	}
+
+	// Premultiplied layers (with padded rows), one partly off the canvas
+	auto make_layer = [](int layer_width, int layer_height, int stride, int seed) {
+		std::vector<unsigned char> layer(stride * layer_height, 0);
+		for (int y = 0; y < layer_height; y++) {
+			for (int x = 0; x < layer_width; x++) {
+				unsigned char *p = &layer[y * stride + x * 4];
+				p[3] = (x * seed + y * 3) % 256;
+				for (int channel = 0; channel < 3; channel++)
+					p[channel] = ((x + y * seed + channel * 17) % 256) * p[3] / 255;
+			}
+		}
+		return layer;
+	};
+	const std::vector<unsigned char> layer1 = make_layer(600, 30, 600 * 4 + 16, 5);
+	const std::vector<unsigned char> layer2 = make_layer(200, 40, 200 * 4, 11);
+	const std::vector<PixelLayer> layers = {
+		{ layer1.data(), 600 * 4 + 16, 50, 10, 600, 30 },
+		{ layer2.data(), 200 * 4, 600, -10, 200, 40 },
+	};
+
+	// Reference blend (of each layer in turn)
+	std::vector<unsigned char> expected = canvas;
+	for (const PixelLayer &layer : layers) {
+		for (int y = std::max(layer.y, 0); y < std::min(layer.y + layer.height, height); y++) {
+			for (int x = std::max(layer.x, 0); x < std::min(layer.x + layer.width, width); x++) {
+				const unsigned char *s = layer.pixels + (y - layer.y) * layer.bytes_per_line + (x - layer.x) * 4;
+				unsigned char *t = &expected[(y * width + x) * 4];
+				for (int channel = 0; channel < 4; channel++)
+					t[channel] = (unsigned char) std::lround(s[channel] + t[channel] * (255 - s[3]) / 255.0);
+			}
+		}
+	}
+
+	PixelKernels::Composite(canvas.data(), width, height, width * 4, layers);
+	CHECK(max_difference(canvas, expected) <= 1);
+}
+
+TEST_CASE( "Composite solid colors", "[libopenshot][pixelkernels]" )
+{
+	const int width = 300;
+	const int height = 20;
+	std::vector<unsigned char> canvas(width * height * 4, 0);
+	for (size_t i = 0; i < canvas.size(); i += 4) {
+		canvas[i + 0] = 100;
+		canvas[i + 3] = 200;
+	}
+
+	// An opaque fill of the left half, and a half transparent (premultiplied) color over the right half
+	PixelLayer opaque = { nullptr, 0, 0, 0, width / 2, height };
+	opaque.solid = true;
+	opaque.color[1] = 255;
+	opaque.color[3] = 255;
+	PixelLayer translucent = { nullptr, 0, width / 2, 0, width / 2, height };
+	translucent.solid = true;
+	translucent.color[2] = 64;
+	translucent.color[3] = 128;
+	PixelKernels::Composite(canvas.data(), width, height, width * 4, { opaque, translucent });
+
+	const unsigned char *left = &canvas[(5 * width + 10) * 4];
+	CHECK(left[0] == 0);
+	CHECK(left[1] == 255);
+	CHECK(left[2] == 0);
+	CHECK(left[3] == 255);
+	const unsigned char *right = &canvas[(5 * width + 200) * 4];
+	CHECK(right[0] == std::lround(100 * 127 / 255.0));
+	CHECK(right[1] == 0);
+	CHECK(right[2] == 64);
+	CHECK(right[3] == std::lround(128 + 200 * 127 / 255.0));
+}
+
+TEST_CASE( "Premultiply and Unpremultiply", "[libopenshot][pixelkernels]" )
+{
+	// Straight pixels (opaque, half transparent, and fully transparent)
+	const std::vector<unsigned char> straight = {
+		255, 128, 0, 255,
+		255, 128, 0, 128,
+		200, 100, 50, 0,
+	};
+	std::vector<unsigned char> pixels(straight.size());
+	PixelKernels::Premultiply(straight.data(), pixels.data(), 3);
+	const std::vector<unsigned char> premultiplied = {
+		255, 128, 0, 255,
+		128, 64, 0, 128,
+		0, 0, 0, 0,
+	};
+	CHECK(pixels == premultiplied);
+
+	// In place (fully transparent pixels become transparent black)
+	PixelKernels::Unpremultiply(pixels.data(), pixels.data(), 3);
+	const std::vector<unsigned char> unpremultiplied = {
+		255, 128, 0, 255,
+		255, 128, 0, 128,
+		0, 0, 0, 0,
+	};
+	CHECK(pixels == unpremultiplied);
+
+	// Swap red and blue, and expand RGB pixels
+	PixelKernels::SwapRedBlue(pixels.data(), pixels.data(), 3);
+	CHECK(pixels[0] == 0);
+	CHECK(pixels[2] == 255);
+	CHECK(pixels[7] == 128);
+	const std::vector<unsigned char> rgb = { 10, 20, 30, 40, 50, 60 };
+	std::vector<unsigned char> rgba(8);
+	PixelKernels::RGB24ToRGBA(rgb.data(), rgba.data(), 2);
+	const std::vector<unsigned char> expected_rgba = { 10, 20, 30, 255, 40, 50, 60, 255 };
+	CHECK(rgba == expected_rgba);
+}
+
+TEST_CASE( "DitherRGBA64", "[libopenshot][pixelkernels]" )
+{
+	// An opaque 16-bit color between two 8-bit steps (128.38)
+	const int width = 64;
+	const int height = 4;
+	const uint16_t value = 32996;
+	std::vector<uint16_t> source(width * height * 4, value);
+	std::vector<unsigned char> target(width * height * 4);
+	PixelKernels::DitherRGBA64(source.data(), width * 8, target.data(), width * 4, width, height, false);
+
+	// The average keeps the precision of the source (instead of truncating every pixel to 128)
+	double sum = 0.0;
+	for (int pixel = 0; pixel < width * height; pixel++) {
+		CHECK(target[pixel * 4] >= 128);
+		CHECK(target[pixel * 4] <= 129);
+		CHECK(target[pixel * 4 + 3] == 255);
+		sum += target[pixel * 4];
+	}
+	CHECK(sum / (width * height) == Detail::Approx(value * 255.0 / 65535.0).margin(0.05));
+
+	// Half transparent pixels are premultiplied (and colors are never larger than alpha)
+	const std::vector<uint16_t> transparent = { 65535, 32768, 0, 32768 };
+	std::vector<unsigned char> pixel(4);
+	PixelKernels::DitherRGBA64(transparent.data(), 8, pixel.data(), 4, 1, 1, true);
+	CHECK(pixel[3] == 128);
+	CHECK(pixel[0] >= 127);
+	CHECK(pixel[0] <= 128);
+	CHECK(pixel[1] >= 63);
+	CHECK(pixel[1] <= 64);
+	CHECK(pixel[2] == 0);
+}
+
+TEST_CASE( "ToPremultipliedRGBA", "[libopenshot][pixelkernels]" )
+{
+	// Partly transparent pixels (with an odd width, so RGB888 rows are padded)
+	QImage source(37, 5, QImage::Format_ARGB32);
+	for (int y = 0; y < source.height(); y++)
+		for (int x = 0; x < source.width(); x++)
+			source.setPixelColor(x, y, QColor((x * 7) % 256, (y * 50) % 256, (x * y) % 256, (x * 13 + y) % 256));
+
+	// The same pixels as Qt's conversion (for every format, including the formats converted by Qt)
+	for (QImage::Format format : { QImage::Format_RGBA8888, QImage::Format_ARGB32, QImage::Format_ARGB32_Premultiplied,
+								   QImage::Format_RGB32, QImage::Format_RGB888, QImage::Format_Grayscale8 }) {
+		const QImage image = source.convertToFormat(format);
+		const QImage expected = image.convertToFormat(QImage::Format_RGBA8888_Premultiplied);
+
+		QImage converted = image;
+		PixelKernels::ToPremultipliedRGBA(converted);
+		REQUIRE(converted.format() == QImage::Format_RGBA8888_Premultiplied);
+		REQUIRE(converted.size() == image.size());
+		int difference = 0;
+		for (int y = 0; y < image.height(); y++) {
+			const unsigned char *row = converted.constScanLine(y);
+			const unsigned char *expected_row = expected.constScanLine(y);
+			for (int x = 0; x < image.width() * 4; x++)
+				difference = std::max(difference, std::abs(int(row[x]) - int(expected_row[x])));
+		}
+		CHECK(difference <= 1);
+
+		// The shared pixels were not changed
+		CHECK(image.format() == format);
+	}
+
+	// Pixels which are not shared are converted in place
+	QImage image = source.convertToFormat(QImage::Format_RGBA8888);
+	const unsigned char *pixels = image.constBits();
+	PixelKernels::ToPremultipliedRGBA(image);
+	CHECK(image.format() == QImage::Format_RGBA8888_Premultiplied);
+	CHECK(image.constBits() == pixels);
+}
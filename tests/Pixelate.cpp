@@ -0,0 +1,86 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::Pixelate effect
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2021 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <memory>
+
+#include "openshot_catch.h"
+
+#include "Frame.h"
+#include "effects/Pixelate.h"
+
+#include <QColor>
+#include <QImage>
+#include <QPainter>
+
+TEST_CASE( "block average", "[libopenshot][effect][pixelate]" )
+{
+    // Left half red, right half blue
+    auto frame = std::make_shared<openshot::Frame>(1, 2000, 360, "#000000");
+    auto image = frame->GetImage();
+    {
+        QPainter painter(image.get());
+        painter.fillRect(0, 0, 1000, 360, Qt::red);
+        painter.fillRect(1000, 0, 1000, 360, Qt::blue);
+    }
+
+    // Two blocks across (0.1% of the width), each one a single color
+    openshot::Pixelate e(openshot::Keyframe(1.0),
+        openshot::Keyframe(0.0), openshot::Keyframe(0.0), openshot::Keyframe(0.0), openshot::Keyframe(0.0));
+    auto f_out = e.GetFrame(frame, 1);
+    auto i = f_out->GetImage();
+
+    CHECK(i->pixelColor(0, 0) == QColor(Qt::red));
+    CHECK(i->pixelColor(999, 359) == QColor(Qt::red));
+    CHECK(i->pixelColor(1000, 0) == QColor(Qt::blue));
+    CHECK(i->pixelColor(1999, 359) == QColor(Qt::blue));
+}
+
+TEST_CASE( "mixed block", "[libopenshot][effect][pixelate]" )
+{
+    // Left half white, right half black
+    auto frame = std::make_shared<openshot::Frame>(1, 100, 100, "#000000");
+    auto image = frame->GetImage();
+    {
+        QPainter painter(image.get());
+        painter.fillRect(0, 0, 50, 100, Qt::white);
+    }
+
+    // Pixelate the whole frame into a single block (the average gray)
+    openshot::Pixelate e(openshot::Keyframe(1.0),
+        openshot::Keyframe(0.0), openshot::Keyframe(0.0), openshot::Keyframe(0.0), openshot::Keyframe(0.0));
+    auto f_out = e.GetFrame(frame, 1);
+    auto i = f_out->GetImage();
+
+    QColor c = i->pixelColor(10, 10);
+    CHECK(c.red() == Detail::Approx(128).margin(1));
+    CHECK(c == i->pixelColor(90, 90));
+    CHECK(c.alpha() == 255);
+}
+
+TEST_CASE( "area outside is unchanged", "[libopenshot][effect][pixelate]" )
+{
+    auto frame = std::make_shared<openshot::Frame>(1, 200, 200, "#00ff00");
+    auto image = frame->GetImage();
+    {
+        QPainter painter(image.get());
+        painter.fillRect(0, 0, 100, 200, Qt::red);
+    }
+
+    // Only pixelate the right half (the left half is kept)
+    openshot::Pixelate e(openshot::Keyframe(1.0),
+        openshot::Keyframe(0.5), openshot::Keyframe(0.0), openshot::Keyframe(0.0), openshot::Keyframe(0.0));
+    auto f_out = e.GetFrame(frame, 1);
+    auto i = f_out->GetImage();
+
+    CHECK(i->pixelColor(99, 100) == QColor(Qt::red));
+    CHECK(i->pixelColor(150, 100) == QColor(Qt::green));
+}
@@ -0,0 +1,74 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::PlaybackClock
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <chrono>
+
+#include "openshot_catch.h"
+
+#include "PlaybackClock.h"
+
+using namespace openshot;
+using std::chrono::milliseconds;
+
+TEST_CASE( "Frame and FrameTime", "[libopenshot][playbackclock]" )
+{
+	const auto start = PlaybackClock::clock::now();
+	PlaybackClock clock;
+	clock.Reset(10, 25.0, 1, start);
+
+	// 25 fps = 40 ms per frame
+	CHECK(clock.Frame(start) == 10);
+	CHECK(clock.Frame(start + milliseconds(39)) == 10);
+	CHECK(clock.Frame(start + milliseconds(41)) == 11);
+	CHECK(clock.Frame(start + milliseconds(1000)) == 35);
+	CHECK(clock.FrameTime(12) - start == milliseconds(80));
+
+	// Fast forward
+	clock.Reset(10, 25.0, 2, start);
+	CHECK(clock.Frame(start + milliseconds(41)) == 12);
+	CHECK(clock.FrameTime(12) - start == milliseconds(40));
+
+	// Rewind
+	clock.Reset(10, 25.0, -1, start);
+	CHECK(clock.Frame(start + milliseconds(81)) == 8);
+	CHECK(clock.FrameTime(9) - start == milliseconds(40));
+
+	// Paused
+	clock.Reset(10, 25.0, 0, start);
+	CHECK(clock.Frame(start + milliseconds(1000)) == 10);
+	CHECK(clock.FrameTime(11) == start);
+}
+
+TEST_CASE( "SyncToAudio", "[libopenshot][playbackclock]" )
+{
+	const auto start = PlaybackClock::clock::now();
+	PlaybackClock clock;
+	clock.Reset(1, 25.0, 1, start);
+
+	// The audio is still on the first frame (nothing changes)
+	clock.SyncToAudio(1, start + milliseconds(100));
+	CHECK(clock.Frame(start + milliseconds(100)) == 3);
+
+	// The audio device is running behind (the clock follows it)
+	clock.SyncToAudio(2, start + milliseconds(100));
+	CHECK(clock.Frame(start + milliseconds(100)) == 2);
+	CHECK(clock.FrameTime(3) - start == milliseconds(140));
+
+	// The audio device is running ahead
+	clock.SyncToAudio(6, start + milliseconds(120));
+	CHECK(clock.Frame(start + milliseconds(120)) == 6);
+
+	// Ignored while paused
+	clock.Reset(6, 25.0, 0, start);
+	clock.SyncToAudio(8, start + milliseconds(100));
+	CHECK(clock.Frame(start + milliseconds(100)) == 6);
+}
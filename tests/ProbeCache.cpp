@@ -0,0 +1,156 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::ProbeCache
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <sstream>
+
+#include <QDir>
+#include <QFile>
+
+#include "openshot_catch.h"
+
+#include "FFmpegReader.h"
+#include "ProbeCache.h"
+#include "QtImageReader.h"
+#include "Settings.h"
+
+using namespace openshot;
+
+TEST_CASE( "Lookup and Insert", "[libopenshot][probecache]" )
+{
+	ProbeCache *cache = ProbeCache::Instance();
+	cache->Clear();
+
+	// A copy of a test file (which can be modified)
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "front3.png";
+	QString copy_path = QDir::tempPath() + QString("/probe-cache.png");
+	QFile::remove(copy_path);
+	REQUIRE(QFile::copy(QString::fromStdString(path.str()), copy_path));
+
+	ReaderInfo info;
+	info.width = 123;
+	CHECK_FALSE(cache->Lookup("QtImageReader", copy_path.toStdString(), info));
+	cache->Insert("QtImageReader", copy_path.toStdString(), info);
+	CHECK(cache->Count() == 1);
+
+	// The info is only found for the same reader type
+	ReaderInfo found;
+	CHECK(cache->Lookup("QtImageReader", copy_path.toStdString(), found));
+	CHECK(found.width == 123);
+	CHECK_FALSE(cache->Lookup("FFmpegReader", copy_path.toStdString(), found));
+
+	// A modified file is probed again
+	{
+		QFile file(copy_path);
+		REQUIRE(file.open(QFile::Append));
+		file.write("x");
+		file.close();
+	}
+	CHECK_FALSE(cache->Lookup("QtImageReader", copy_path.toStdString(), found));
+
+	// Missing files are never found
+	QFile::remove(copy_path);
+	cache->Insert("QtImageReader", copy_path.toStdString(), info);
+	CHECK_FALSE(cache->Lookup("QtImageReader", copy_path.toStdString(), found));
+
+	cache->Clear();
+	CHECK(cache->Count() == 0);
+}
+
+TEST_CASE( "Readers share probed info", "[libopenshot][probecache]" )
+{
+	ProbeCache *cache = ProbeCache::Instance();
+	cache->Clear();
+
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	FFmpegReader r1(path.str());
+	CHECK(cache->Count() == 1);
+
+	// The second reader has the same info (without probing the file)
+	FFmpegReader r2(path.str());
+	CHECK(cache->Count() == 1);
+	CHECK(r2.info.width == r1.info.width);
+	CHECK(r2.info.height == r1.info.height);
+	CHECK(r2.info.video_length == r1.info.video_length);
+	CHECK(r2.info.sample_rate == r1.info.sample_rate);
+	CHECK(r2.info.fps.num == r1.info.fps.num);
+
+	// It can still be opened (and read)
+	r2.Open();
+	CHECK(r2.GetFrame(1)->GetWidth() == r1.info.width);
+	r2.Close();
+
+	// Disabled
+	Settings::Instance()->ENABLE_PROBE_CACHE = false;
+	cache->Clear();
+	FFmpegReader r3(path.str());
+	CHECK(cache->Count() == 0);
+	CHECK(r3.info.width == r1.info.width);
+	Settings::Instance()->ENABLE_PROBE_CACHE = true;
+}
+
+TEST_CASE( "Save and Load", "[libopenshot][probecache]" )
+{
+	ProbeCache *cache = ProbeCache::Instance();
+	cache->Clear();
+
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	FFmpegReader r1(path.str());
+	REQUIRE(cache->Count() == 1);
+
+	// The info is kept in a file (for the next sessions)
+	QString cache_path = QDir::tempPath() + QString("/probe-cache.json");
+	QFile::remove(cache_path);
+	CHECK(cache->Save(cache_path.toStdString()));
+	cache->Clear();
+	CHECK_FALSE(cache->Load("missing-probe-cache.json"));
+	CHECK(cache->Load(cache_path.toStdString()));
+	CHECK(cache->Count() == 1);
+
+	ReaderInfo found;
+	REQUIRE(cache->Lookup("FFmpegReader", path.str(), found));
+	CHECK(found.width == r1.info.width);
+	CHECK(found.video_length == r1.info.video_length);
+	CHECK(found.fps.num == r1.info.fps.num);
+	CHECK(found.vcodec == r1.info.vcodec);
+	CHECK(found.channel_layout == r1.info.channel_layout);
+
+	QFile::remove(cache_path);
+	cache->Clear();
+}
+
+TEST_CASE( "Fast probe", "[libopenshot][probecache]" )
+{
+	ProbeCache *cache = ProbeCache::Instance();
+	cache->Clear();
+
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	FFmpegReader r1(path.str());
+	cache->Clear();
+
+	// A file with valid metadata has the same info
+	Settings::Instance()->ENABLE_FAST_PROBE = true;
+	FFmpegReader r2(path.str());
+	Settings::Instance()->ENABLE_FAST_PROBE = false;
+	CHECK(r2.info.width == r1.info.width);
+	CHECK(r2.info.video_length == r1.info.video_length);
+	CHECK(r2.info.fps.num == r1.info.fps.num);
+	CHECK(cache->Count() == 1);
+
+	r2.Open();
+	CHECK(r2.GetFrame(10)->number == 10);
+	r2.Close();
+	cache->Clear();
+}
@@ -0,0 +1,99 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::ProxyGenerator
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <sstream>
+#include <memory>
+
+#include "openshot_catch.h"
+
+#include "ProxyGenerator.h"
+#include "Clip.h"
+#include "Exceptions.h"
+#include "FFmpegReader.h"
+#include "Frame.h"
+#include "Timeline.h"
+
+using namespace openshot;
+
+TEST_CASE( "Generate and use a proxy", "[libopenshot][proxygenerator]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+
+	// Generate the proxy (in the background)
+	ProxyGenerator generator(path.str(), "proxy1.mov", 320, 180);
+	generator.Start();
+	generator.Wait();
+	CHECK(generator.IsFinished());
+	CHECK_FALSE(generator.IsRunning());
+	CHECK(generator.Progress() == Detail::Approx(1.0f));
+
+	// Verify the proxy matches the original file (at a smaller size)
+	FFmpegReader original(path.str());
+	FFmpegReader proxy(generator.ProxyPath());
+	CHECK(proxy.info.width == 320);
+	CHECK(proxy.info.height == 180);
+	CHECK(proxy.info.fps.num == original.info.fps.num);
+	CHECK(proxy.info.fps.den == original.info.fps.den);
+	CHECK(proxy.info.sample_rate == original.info.sample_rate);
+	CHECK(proxy.info.channels == original.info.channels);
+
+	// Attach the original file to a timeline
+	FFmpegReader r(path.str());
+	r.SetProxy(generator.ProxyPath());
+	CHECK(r.GetProxy() == generator.ProxyPath());
+	r.Open();
+	Clip c(&r);
+	Timeline t(1280, 720, Fraction(24, 1), 48000, 2, LAYOUT_STEREO);
+	c.ParentTimeline(&t);
+
+	// Small previews read from the proxy
+	t.SetMaxSize(320, 180);
+	CHECK(r.IsUsingProxy());
+	CHECK(r.GetFrame(100)->GetImage()->width() == 320);
+
+	// Large previews (and exports) read from the original file
+	t.SetMaxSize(1280, 720);
+	CHECK_FALSE(r.IsUsingProxy());
+	CHECK(r.GetFrame(200)->GetImage()->width() == 1280);
+
+	// The proxy is saved with the reader
+	FFmpegReader r2(path.str());
+	r2.SetJsonValue(r.JsonValue());
+	CHECK(r2.GetProxy() == generator.ProxyPath());
+
+	r.ClearProxy();
+	CHECK(r.GetProxy() == "");
+	CHECK_FALSE(r.IsUsingProxy());
+	r.Close();
+}
+
+TEST_CASE( "Mismatched proxy", "[libopenshot][proxygenerator]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	std::stringstream other_path;
+	other_path << TEST_MEDIA_PATH << "test.mp4";
+
+	// A proxy must have the same frame rate and length as the original file
+	FFmpegReader r(path.str());
+	CHECK_THROWS_AS(r.SetProxy(other_path.str()), InvalidFile);
+	CHECK(r.GetProxy() == "");
+}
+
+TEST_CASE( "Missing source file", "[libopenshot][proxygenerator]" )
+{
+	ProxyGenerator generator("invalid-file.mp4", "proxy2.mov");
+	generator.Start();
+	CHECK_THROWS_AS(generator.Wait(), InvalidFile);
+	CHECK_FALSE(generator.IsFinished());
+}
@@ -0,0 +1,100 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::ReadAheadIO
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+#include <QDir>
+#include <QFile>
+
+#include "openshot_catch.h"
+
+#include "FFmpegReader.h"
+#include "ReadAheadIO.h"
+#include "Settings.h"
+
+using namespace openshot;
+
+TEST_CASE( "Read and Seek", "[libopenshot][readaheadio]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "piano.wav";
+	QFile file(QString::fromStdString(path.str()));
+	REQUIRE(file.open(QIODevice::ReadOnly));
+	QByteArray expected = file.readAll();
+
+	// Small blocks (so reads cross blocks)
+	ReadAheadIO io(path.str(), 4096, 4);
+	CHECK_FALSE(ReadAheadIO("missing-file.wav").Open());
+	REQUIRE(io.Open());
+	CHECK(io.Size() == expected.size());
+
+	// Read across blocks
+	std::vector<uint8_t> buffer(10000);
+	CHECK(io.Read(buffer.data(), 10000) == 10000);
+	CHECK(memcmp(buffer.data(), expected.data(), 10000) == 0);
+
+	// Seek back, and to the end
+	CHECK(io.Seek(-5000, SEEK_CUR) == 5000);
+	CHECK(io.Read(buffer.data(), 100) == 100);
+	CHECK(memcmp(buffer.data(), expected.data() + 5000, 100) == 0);
+	CHECK(io.Seek(-10, SEEK_END) == expected.size() - 10);
+	CHECK(io.Read(buffer.data(), 100) == 10);
+	CHECK(io.Read(buffer.data(), 100) == 0);
+	CHECK(io.Seek(-1, SEEK_SET) == -1);
+	io.Close();
+}
+
+TEST_CASE( "Block cache", "[libopenshot][readaheadio]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "piano.wav";
+	QString cache_path = QDir::tempPath() + QString("/read-ahead-blocks");
+	QDir(cache_path).removeRecursively();
+
+	// Reading fills the block cache
+	std::vector<uint8_t> first(20000), second(20000);
+	{
+		ReadAheadIO io(path.str(), 4096, 2, cache_path.toStdString());
+		REQUIRE(io.Open());
+		io.Seek(30000, SEEK_SET);
+		CHECK(io.Read(first.data(), 20000) == 20000);
+	}
+	CHECK(QDir(cache_path).entryList(QStringList() << "*.block", QDir::Files).size() >= 5);
+
+	// And the cached blocks are read back
+	ReadAheadIO io(path.str(), 4096, 2, cache_path.toStdString());
+	REQUIRE(io.Open());
+	io.Seek(30000, SEEK_SET);
+	CHECK(io.Read(second.data(), 20000) == 20000);
+	CHECK(first == second);
+	io.Close();
+	QDir(cache_path).removeRecursively();
+}
+
+TEST_CASE( "FFmpegReader with read-ahead", "[libopenshot][readaheadio]" )
+{
+	Settings::Instance()->ENABLE_READ_AHEAD_IO = true;
+	Settings::Instance()->READ_AHEAD_MB = 2;
+
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	FFmpegReader r(path.str());
+	r.Open();
+	CHECK(r.info.width == 1280);
+	CHECK(r.GetFrame(1)->GetWidth() == 1280);
+	CHECK(r.GetFrame(300)->number == 300);
+	r.Close();
+
+	Settings::Instance()->ENABLE_READ_AHEAD_IO = false;
+}
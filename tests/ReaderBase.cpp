@@ -10,14 +10,19 @@
 //
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
+#include <atomic>
 #include <memory>
 #include <string>
+#include <thread>
 
 #include "openshot_catch.h"
 
 #include "ReaderBase.h"
 #include "CacheBase.h"
+#include "CacheMemory.h"
+#include "Exceptions.h"
 #include "Frame.h"
+#include "FrameRequest.h"
 #include "Json.h"
 
 using namespace openshot;
@@ -75,3 +80,100 @@ TEST_CASE( "derived class", "[libopenshot][readerbase]" )
 	CHECK(t1.info.fps.num == 1);
 	CHECK(t1.info.fps.den == 1);
 }
+
+// A reader which waits (at a cancellation point) until it is released
+class RequestReader : public ReaderBase
+{
+public:
+	CacheMemory cache;
+	std::atomic<bool> started{false};
+	std::atomic<bool> released{false};
+	std::atomic<int> frames_rendered{0};
+
+	RequestReader() : cache(10) { };
+	CacheBase* GetCache() { return &cache; };
+	std::shared_ptr<Frame> GetFrame(int64_t number) {
+		std::shared_ptr<Frame> f = cache.GetFrame(number);
+		if (f)
+			return f;
+		started = true;
+		while (!released)
+			std::this_thread::yield();
+		FrameRequest::ThrowIfCancelled(number);
+		frames_rendered++;
+		return std::make_shared<Frame>(number, 1, 1, "#000000", 0, 2);
+	}
+	void Close() { };
+	void Open() { };
+	std::string Json() const { return ""; };
+	void SetJson(std::string value) { };
+	Json::Value JsonValue() const { return Json::Value("{}"); };
+	void SetJsonValue(Json::Value root) { };
+	bool IsOpen() { return true; };
+	std::string Name() { return "RequestReader"; };
+};
+
+TEST_CASE( "RequestFrame", "[libopenshot][readerbase]" )
+{
+	RequestReader r;
+	r.released = true;
+
+	std::shared_ptr<FrameRequest> request = r.RequestFrame(5, 1);
+	CHECK(request->Number() == 5);
+	CHECK(request->Priority() == 1);
+
+	std::shared_ptr<Frame> f = request->Get();
+	REQUIRE(f != nullptr);
+	CHECK(f->number == 5);
+	CHECK(request->IsFinished());
+	CHECK_FALSE(request->IsCancelled());
+
+	// Cached frames are finished right away
+	r.cache.Add(std::make_shared<Frame>(7, 1, 1, "#000000", 0, 2));
+	request = r.RequestFrame(7);
+	CHECK(request->IsFinished());
+	CHECK(request->Get()->number == 7);
+	CHECK(r.frames_rendered == 1);
+}
+
+TEST_CASE( "Cancel queued frame request", "[libopenshot][readerbase]" )
+{
+	RequestReader r;
+	r.released = true;
+
+	// A request which never started is finished (and never rendered)
+	auto request = std::make_shared<FrameRequest>(&r, 3);
+	request->Cancel();
+	CHECK(request->IsCancelled());
+	CHECK(request->IsFinished());
+	CHECK(request->Wait(0));
+
+	request->Run();
+	CHECK(r.frames_rendered == 0);
+	CHECK_THROWS_AS(request->Get(), FrameRequestCancelled);
+}
+
+TEST_CASE( "Cancel running frame request", "[libopenshot][readerbase]" )
+{
+	RequestReader r;
+
+	// Start rendering (on another thread)
+	auto request = std::make_shared<FrameRequest>(&r, 3);
+	std::thread worker(&FrameRequest::Run, request.get());
+	while (!r.started)
+		std::this_thread::yield();
+	CHECK_FALSE(request->Wait(1));
+
+	// The reader stops at its next cancellation point
+	request->Cancel();
+	r.released = true;
+	worker.join();
+
+	CHECK(request->IsFinished());
+	CHECK(r.frames_rendered == 0);
+	CHECK_THROWS_AS(request->Get(), FrameRequestCancelled);
+
+	// Cancellation points do nothing outside of a request
+	CHECK_NOTHROW(FrameRequest::ThrowIfCancelled(3));
+	CHECK(r.GetFrame(3)->number == 3);
+}
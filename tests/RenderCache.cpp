@@ -0,0 +1,221 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::RenderCache
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <memory>
+#include <random>
+#include <sstream>
+
+#include <QDir>
+#include <QFile>
+
+#include "openshot_catch.h"
+
+#include "Clip.h"
+#include "Frame.h"
+#include "KeyFrame.h"
+#include "RenderCache.h"
+#include "Settings.h"
+#include "Timeline.h"
+
+using namespace openshot;
+
+// Get the key of a JSON state at a frame
+static uint64_t state_key(const Json::Value& state, int64_t frame_number)
+{
+	RenderKey key;
+	key.AddState(state, frame_number);
+	return key.Value();
+}
+
+TEST_CASE( "Keys", "[libopenshot][rendercache]" )
+{
+	Keyframe alpha;
+	alpha.AddPoint(1, 1.0, LINEAR);
+	alpha.AddPoint(10, 1.0, LINEAR);
+	alpha.AddPoint(20, 0.0, LINEAR);
+	Json::Value state;
+	state["alpha"] = alpha.JsonValue();
+	state["gravity"] = 4;
+
+	// The same state gives the same key
+	CHECK(state_key(state, 5) == state_key(state, 5));
+	CHECK(state_key(state, 5) != 0);
+
+	// Only the keyframe's values at the frame matter (not its other points)
+	Json::Value moved = state;
+	Keyframe fade = alpha;
+	fade.AddPoint(30, 0.5, LINEAR);
+	moved["alpha"] = fade.JsonValue();
+	CHECK(state_key(moved, 5) == state_key(state, 5));
+	CHECK(state_key(state, 5) == state_key(state, 6));
+	CHECK(state_key(state, 5) != state_key(state, 15));
+
+	// Any other change is a new key
+	moved = state;
+	moved["gravity"] = 5;
+	CHECK(state_key(moved, 5) != state_key(state, 5));
+
+	// Files are identified by their modification time and size too
+	QString copy_path = QDir::tempPath() + QString("/render-cache-key.txt");
+	QFile::remove(copy_path);
+	Json::Value reader;
+	reader["path"] = copy_path.toStdString();
+	const uint64_t missing = state_key(reader, 1);
+	{
+		QFile file(copy_path);
+		REQUIRE(file.open(QFile::WriteOnly));
+		file.write("x");
+	}
+	const uint64_t written = state_key(reader, 1);
+	CHECK(written != missing);
+	{
+		QFile file(copy_path);
+		REQUIRE(file.open(QFile::Append));
+		file.write("x");
+	}
+	CHECK(state_key(reader, 1) != written);
+	QFile::remove(copy_path);
+}
+
+TEST_CASE( "Store and load frames", "[libopenshot][rendercache]" )
+{
+	Settings *s = Settings::Instance();
+	QDir folder(QDir::tempPath() + QString("/render-cache-test"));
+	folder.removeRecursively();
+	s->RENDER_CACHE_PATH = folder.path().toStdString();
+	RenderCache *cache = RenderCache::Instance();
+	cache->Clear();
+	cache->ResetStats();
+	CHECK(cache->Enabled());
+
+	auto frame = std::make_shared<Frame>(1, 64, 32, "#ff000080", 100, 2);
+	frame->AddAudioSilence(100);
+	frame->GetAudioSamples(1)[10] = 0.5f;
+	REQUIRE(cache->Add(42, frame, QRect(10, 20, 64, 32)));
+	CHECK(cache->Count() == 1);
+	CHECK(cache->GetBytes() > 64 * 32 * 4 / 2);
+
+	QRect layer_rect;
+	std::shared_ptr<Frame> loaded = cache->GetFrame(42, layer_rect);
+	REQUIRE(loaded != nullptr);
+	CHECK(layer_rect == QRect(10, 20, 64, 32));
+	CHECK(loaded->GetWidth() == 64);
+	CHECK(loaded->GetHeight() == 32);
+	CHECK(loaded->GetImage()->pixelColor(5, 5) == frame->GetImage()->pixelColor(5, 5));
+	CHECK(loaded->GetAudioChannelsCount() == 2);
+	CHECK(loaded->GetAudioSamplesCount() == 100);
+	CHECK(loaded->GetAudioSamples(1)[10] == 0.5f);
+	CHECK(cache->GetFrame(43) == nullptr);
+	CHECK(cache->GetStats().hits == 1);
+	CHECK(cache->GetStats().misses == 1);
+
+	// The next session finds the stored frames (the directory is indexed again)
+	s->RENDER_CACHE_PATH = (QDir::tempPath() + QString("/render-cache-other")).toStdString();
+	CHECK_FALSE(cache->Contains(42));
+	s->RENDER_CACHE_PATH = folder.path().toStdString();
+	CHECK(cache->Contains(42));
+	CHECK(cache->GetFrame(42) != nullptr);
+
+	// A damaged file is a miss
+	{
+		QFile file(folder.filePath("000000000000002a.frame"));
+		REQUIRE(file.open(QFile::Append));
+		file.write("x");
+	}
+	CHECK(cache->GetFrame(42) == nullptr);
+
+	cache->Clear();
+	CHECK(cache->Count() == 0);
+	QDir(QDir::tempPath() + QString("/render-cache-other")).removeRecursively();
+	folder.removeRecursively();
+	s->RENDER_CACHE_PATH = "";
+	CHECK_FALSE(cache->Enabled());
+}
+
+TEST_CASE( "Least recently used frames are deleted", "[libopenshot][rendercache]" )
+{
+	Settings *s = Settings::Instance();
+	QDir folder(QDir::tempPath() + QString("/render-cache-limit"));
+	folder.removeRecursively();
+	s->RENDER_CACHE_PATH = folder.path().toStdString();
+	s->RENDER_CACHE_MB = 1;
+	RenderCache *cache = RenderCache::Instance();
+	cache->Clear();
+
+	// Noise doesn't compress, so each frame uses about 256 KB
+	auto frame = std::make_shared<Frame>(1, 256, 256, "#000000");
+	std::shared_ptr<QImage> image = frame->GetImage();
+	std::mt19937 random(1);
+	for (int y = 0; y < 256; y++)
+		for (int x = 0; x < 256; x++)
+			image->setPixel(x, y, qRgba(random() % 256, random() % 256, random() % 256, 255));
+	for (uint64_t key = 1; key <= 8; key++)
+		REQUIRE(cache->Add(key, frame));
+
+	CHECK(cache->GetBytes() <= 1024 * 1024);
+	CHECK_FALSE(cache->Contains(1));
+	CHECK(cache->Contains(8));
+
+	cache->Clear();
+	folder.removeRecursively();
+	s->RENDER_CACHE_MB = 4096;
+	s->RENDER_CACHE_PATH = "";
+}
+
+TEST_CASE( "Timelines re-use the frames of clips", "[libopenshot][rendercache]" )
+{
+	Settings *s = Settings::Instance();
+	QDir folder(QDir::tempPath() + QString("/render-cache-timeline"));
+	folder.removeRecursively();
+	s->RENDER_CACHE_PATH = folder.path().toStdString();
+	s->RENDER_CACHE_TIMELINE_FRAMES = true;
+	RenderCache *cache = RenderCache::Instance();
+	cache->Clear();
+
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "front3.png";
+	std::shared_ptr<Frame> first;
+	{
+		Timeline t(640, 360, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+		Clip clip(path.str());
+		t.AddClip(&clip);
+		t.Open();
+		first = t.GetFrame(1);
+		t.Close();
+	}
+	// The clip's frame and the timeline frame
+	CHECK(cache->Count() == 2);
+
+	// Another timeline (i.e. the next session) loads the frame instead of rendering it
+	cache->ResetStats();
+	{
+		Timeline t(640, 360, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+		Clip clip(path.str());
+		t.AddClip(&clip);
+		t.Open();
+		std::shared_ptr<Frame> again = t.GetFrame(1);
+		CHECK(cache->GetStats().hits == 1);
+		CHECK(again->GetImage()->pixelColor(320, 180) == first->GetImage()->pixelColor(320, 180));
+
+		// Changing the clip changes its key
+		clip.alpha = Keyframe(0.5);
+		t.ClearAllCache();
+		t.GetFrame(1);
+		CHECK(cache->Count() == 4);
+		t.Close();
+	}
+
+	cache->Clear();
+	folder.removeRecursively();
+	s->RENDER_CACHE_TIMELINE_FRAMES = false;
+	s->RENDER_CACHE_PATH = "";
+}
@@ -0,0 +1,79 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::RenderGraph
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "openshot_catch.h"
+
+#include "RenderGraph.h"
+#include "Exceptions.h"
+#include "Frame.h"
+
+using namespace openshot;
+
+TEST_CASE( "Inputs are run first", "[libopenshot][rendergraph]" )
+{
+	RenderGraph graph;
+	std::mutex orderMutex;
+	std::vector<int> order;
+	auto node = [&](int number) {
+		return [&, number](const RenderGraph::Inputs& inputs) {
+			const std::lock_guard<std::mutex> lock(orderMutex);
+			order.push_back(number);
+			return std::make_shared<Frame>(number, 8, 8, "#000000");
+		};
+	};
+
+	// Two independent chains, joined by a last node
+	int a1 = graph.AddNode("a1", node(1));
+	int a2 = graph.AddNode("a2", node(2), { a1 });
+	int b1 = graph.AddNode("b1", node(3));
+	int b2 = graph.AddNode("b2", node(4), { b1 });
+	int last = graph.AddNode("last", [&](const RenderGraph::Inputs& inputs) {
+		REQUIRE(inputs.size() == 2);
+		CHECK(inputs[0]->number == 2);
+		CHECK(inputs[1]->number == 4);
+		return std::make_shared<Frame>(inputs[0]->number + inputs[1]->number, 8, 8, "#000000");
+	}, { a2, b2 });
+
+	graph.Run(4);
+
+	REQUIRE(order.size() == 4);
+	auto position = [&](int number) { return std::find(order.begin(), order.end(), number) - order.begin(); };
+	CHECK(position(1) < position(2));
+	CHECK(position(3) < position(4));
+	CHECK(graph.Output(last)->number == 6);
+
+	// Inputs must be added before a node
+	CHECK_THROWS_AS(graph.AddNode("invalid", node(5), { 10 }), InvalidOptions);
+}
+
+TEST_CASE( "Exceptions", "[libopenshot][rendergraph]" )
+{
+	RenderGraph graph;
+	std::atomic<bool> dependent_ran(false);
+	int failing = graph.AddNode("failing", [](const RenderGraph::Inputs& inputs) -> std::shared_ptr<Frame> {
+		throw OutOfBoundsFrame("Invalid frame", 1, 1);
+	});
+	graph.AddNode("dependent", [&](const RenderGraph::Inputs& inputs) {
+		dependent_ran = true;
+		return inputs[0];
+	}, { failing });
+
+	// The exception is re-thrown by Run (and the nodes which depend on the node are never run)
+	CHECK_THROWS_AS(graph.Run(2), OutOfBoundsFrame);
+	CHECK_FALSE(dependent_ran);
+}
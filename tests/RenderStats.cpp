@@ -0,0 +1,127 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::RenderStats
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <sstream>
+
+#include "openshot_catch.h"
+
+#include "Clip.h"
+#include "Json.h"
+#include "RenderStats.h"
+#include "Settings.h"
+#include "Timeline.h"
+#include "effects/Negate.h"
+
+using namespace openshot;
+
+TEST_CASE( "Stage stats", "[libopenshot][renderstats]" )
+{
+	RenderStageStats stats;
+	stats.Add(2000000);
+	stats.Add(6000000);
+	stats.Add(1000000);
+
+	Json::Value root = stats.JsonValue();
+	CHECK(root["count"].asInt64() == 3);
+	CHECK(root["total_ms"].asDouble() == Detail::Approx(9.0));
+	CHECK(root["average_ms"].asDouble() == Detail::Approx(3.0));
+	CHECK(root["max_ms"].asDouble() == Detail::Approx(6.0));
+
+	stats.Reset();
+	CHECK(stats.JsonValue()["count"].asInt64() == 0);
+	CHECK(stats.JsonValue()["average_ms"].asDouble() == Detail::Approx(0.0));
+}
+
+TEST_CASE( "Timers only run when enabled", "[libopenshot][renderstats]" )
+{
+	RenderStats *stats = RenderStats::Instance();
+	stats->Reset();
+	RenderStageStats extra;
+
+	// Disabled (the default)
+	Settings::Instance()->ENABLE_RENDER_STATS = false;
+	{
+		RenderStageTimer timer(RENDER_STAGE_COMPOSITE, &extra);
+	}
+	CHECK(stats->Stage(RENDER_STAGE_COMPOSITE).count == 0);
+	CHECK(extra.count == 0);
+
+	// Enabled
+	Settings::Instance()->ENABLE_RENDER_STATS = true;
+	{
+		RenderStageTimer timer(RENDER_STAGE_COMPOSITE, &extra);
+	}
+	CHECK(stats->Stage(RENDER_STAGE_COMPOSITE).count == 1);
+	CHECK(extra.count == 1);
+	CHECK(stats->Stage(RENDER_STAGE_DECODE).count == 0);
+	Settings::Instance()->ENABLE_RENDER_STATS = false;
+
+	// Every stage is in the JSON
+	Json::Value root = stats->JsonValue();
+	for (int stage = 0; stage < RENDER_STAGE_COUNT; stage++)
+		CHECK(root.isMember(RenderStats::StageName(RenderStage(stage))));
+	CHECK(root["composite"]["count"].asInt64() == 1);
+}
+
+TEST_CASE( "Initialization of subsystems", "[libopenshot][renderstats]" )
+{
+	RenderStats* stats = RenderStats::Instance();
+
+	// Initialization is timed even when the render stats are disabled (it only happens once)
+	Settings::Instance()->ENABLE_RENDER_STATS = false;
+	const int64_t fonts = stats->Init(INIT_STAGE_SVG_FONTS).count;
+	{
+		RenderInitTimer timer(INIT_STAGE_SVG_FONTS);
+	}
+	CHECK(stats->Init(INIT_STAGE_SVG_FONTS).count == fonts + 1);
+
+	// Every subsystem is in the JSON, and Reset() keeps them
+	stats->Reset();
+	Json::Value root = stats->JsonValue();
+	for (int stage = 0; stage < INIT_STAGE_COUNT; stage++)
+		CHECK(root["init"].isMember(RenderStats::InitStageName(InitStage(stage))));
+	CHECK(root["init"]["svg_fonts"]["count"].asInt64() == fonts + 1);
+}
+
+TEST_CASE( "Timeline render stats", "[libopenshot][renderstats]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	Clip clip(path.str());
+	Negate negate;
+	negate.Id("NEGATE1");
+	clip.AddEffect(&negate);
+
+	Timeline t(640, 480, Fraction(24, 1), 44100, 2, LAYOUT_STEREO);
+	t.AddClip(&clip);
+	t.Open();
+
+	Settings::Instance()->ENABLE_RENDER_STATS = true;
+	t.ResetRenderStats();
+	for (int64_t number = 1; number <= 5; number++)
+		t.GetFrame(number);
+	Settings::Instance()->ENABLE_RENDER_STATS = false;
+
+	// Stats of each stage, and of each effect
+	Json::Value root = openshot::stringToJson(t.GetRenderStats());
+	CHECK(root["frame"]["count"].asInt64() == 5);
+	CHECK(root["decode"]["count"].asInt64() > 0);
+	CHECK(root["transform"]["count"].asInt64() >= 5);
+	CHECK(root["effects"]["NEGATE1"]["class_name"].asString() == "Negate");
+	CHECK(root["effects"]["NEGATE1"]["count"].asInt64() + root["effect"]["count"].asInt64() > 0);
+
+	t.ResetRenderStats();
+	root = openshot::stringToJson(t.GetRenderStats());
+	CHECK(root["frame"]["count"].asInt64() == 0);
+	CHECK(root["effects"]["NEGATE1"]["count"].asInt64() == 0);
+	t.Close();
+}
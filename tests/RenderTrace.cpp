@@ -0,0 +1,156 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::RenderTrace
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+
+#include "openshot_catch.h"
+
+#include "Json.h"
+#include "RenderTrace.h"
+
+using namespace openshot;
+
+// Count the complete events with a name
+static int count_spans(const Json::Value& trace, const std::string& name)
+{
+	int count = 0;
+	for (const auto& event : trace["traceEvents"])
+		if (event["ph"].asString() == "X" && event["name"].asString() == name)
+			count++;
+	return count;
+}
+
+TEST_CASE( "Spans are only recorded while tracing", "[libopenshot][rendertrace]" )
+{
+	RenderTrace *trace = RenderTrace::Instance();
+
+	// Not recording (the default)
+	{
+		RenderTraceSpan span("before", "test");
+	}
+
+	trace->Start("");
+	CHECK(RenderTrace::Enabled());
+	{
+		RenderTraceSpan span("during", "test");
+	}
+	trace->Stop();
+	CHECK_FALSE(RenderTrace::Enabled());
+	{
+		RenderTraceSpan span("after", "test");
+	}
+
+	Json::Value root = trace->JsonValue();
+	CHECK(count_spans(root, "before") == 0);
+	CHECK(count_spans(root, "during") == 1);
+	CHECK(count_spans(root, "after") == 0);
+
+	// Starting again forgets the old spans
+	trace->Start("");
+	trace->Stop();
+	CHECK(count_spans(trace->JsonValue(), "during") == 0);
+}
+
+TEST_CASE( "Spans of each thread", "[libopenshot][rendertrace]" )
+{
+	RenderTrace *trace = RenderTrace::Instance();
+	trace->Start("");
+	std::thread worker([trace]() {
+		trace->SetThreadName("test worker");
+		RenderTraceSpan span("worker span", "test");
+	});
+	worker.join();
+	{
+		RenderTraceSpan span("main span", "test");
+	}
+	trace->Stop();
+
+	Json::Value root = trace->JsonValue();
+	int worker_tid = -1;
+	int main_tid = -1;
+	bool worker_named = false;
+	for (const auto& event : root["traceEvents"]) {
+		if (event["name"].asString() == "worker span")
+			worker_tid = event["tid"].asInt();
+		if (event["name"].asString() == "main span") {
+			main_tid = event["tid"].asInt();
+			CHECK(event["cat"].asString() == "test");
+			CHECK(event["ts"].asInt64() >= 0);
+			CHECK(event["dur"].asInt64() >= 0);
+		}
+		if (event["ph"].asString() == "M" && event["args"]["name"].asString() == "test worker")
+			worker_named = true;
+	}
+	CHECK(worker_tid > 0);
+	CHECK(main_tid > 0);
+	CHECK(worker_tid != main_tid);
+	CHECK(worker_named);
+}
+
+TEST_CASE( "Only contended locks are traced", "[libopenshot][rendertrace]" )
+{
+	RenderTrace *trace = RenderTrace::Instance();
+	std::mutex mutex;
+	trace->Start("");
+
+	// Uncontended
+	{
+		auto lock = TraceLock(mutex, "wait mutex");
+		CHECK(lock.owns_lock());
+	}
+	CHECK(count_spans(trace->JsonValue(), "wait mutex") == 0);
+
+	// Held by another thread
+	std::unique_lock<std::mutex> held(mutex);
+	std::thread waiter([&mutex]() {
+		auto lock = TraceLock(mutex, "wait mutex");
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	held.unlock();
+	waiter.join();
+	trace->Stop();
+
+	Json::Value root = trace->JsonValue();
+	CHECK(count_spans(root, "wait mutex") == 1);
+	for (const auto& event : root["traceEvents"])
+		if (event["name"].asString() == "wait mutex") {
+			CHECK(event["cat"].asString() == "lock");
+			CHECK(event["dur"].asInt64() >= 10000);
+		}
+}
+
+TEST_CASE( "Write a trace file", "[libopenshot][rendertrace]" )
+{
+	std::stringstream path;
+	path << "render-trace-" << std::this_thread::get_id() << ".json";
+
+	RenderTrace *trace = RenderTrace::Instance();
+	trace->Start(path.str());
+	{
+		RenderTraceSpan span("file span", "test");
+	}
+	CHECK(trace->Stop());
+
+	std::ifstream file(path.str());
+	REQUIRE(file.is_open());
+	Json::Value root;
+	file >> root;
+	CHECK(root["traceEvents"].isArray());
+	CHECK(count_spans(root, "file span") == 1);
+	file.close();
+	std::remove(path.str().c_str());
+}
@@ -0,0 +1,170 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::SegmentedWriter
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <sstream>
+#include <memory>
+#include <thread>
+
+#include "openshot_catch.h"
+
+#include "SegmentedWriter.h"
+#include "Clip.h"
+#include "FFmpegReader.h"
+#include "FFmpegWriter.h"
+#include "Fraction.h"
+#include "Frame.h"
+#include "KeyFrame.h"
+#include "RenderFarm.h"
+#include "Timeline.h"
+
+using namespace openshot;
+
+TEST_CASE( "Segmented export", "[libopenshot][segmentedwriter]" )
+{
+	// Timeline with a single clip
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	Timeline t(640, 360, Fraction(24, 1), 44100, 2, LAYOUT_STEREO);
+	Clip clip_video(path.str());
+	t.AddClip(&clip_video);
+	t.Open();
+
+	// Export 60 frames, in 3 segments
+	SegmentedWriter w("output-segmented.mp4", 3);
+	w.SetVideoOptions(true, "mpeg4", Fraction(24, 1), 640, 360, Fraction(1, 1), false, false, 2000000);
+	w.SetAudioOptions(true, "aac", 44100, 2, LAYOUT_STEREO, 128000);
+	w.WriteTimeline(&t, 1, 60);
+	CHECK(w.Progress() == Detail::Approx(1.0));
+	t.Close();
+
+	// The segments are joined into one file
+	FFmpegReader r("output-segmented.mp4");
+	r.Open();
+	CHECK(r.info.has_video);
+	CHECK(r.info.has_audio);
+	CHECK(r.info.width == 640);
+	CHECK(r.info.height == 360);
+	CHECK(r.info.video_length == Detail::Approx(60).margin(2));
+
+	// Frames after each join can be decoded
+	CHECK(r.GetFrame(21)->GetWidth() == 640);
+	CHECK(r.GetFrame(41)->GetWidth() == 640);
+	CHECK(r.GetFrame(60)->GetAudioChannelsCount() == 2);
+	r.Close();
+
+	// The temporary files are removed
+	CHECK_THROWS(FFmpegReader("output-segmented.part1.mp4"));
+	CHECK_THROWS(FFmpegReader("output-segmented.audio.mp4"));
+}
+
+TEST_CASE( "Passthrough", "[libopenshot][segmentedwriter]" )
+{
+	// An intra-only source file (which can be copied)
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	FFmpegReader r(path.str());
+	r.Open();
+	FFmpegWriter source("output-passthrough-source.avi");
+	source.SetVideoOptions(true, "mjpeg", Fraction(24, 1), 640, 360, Fraction(1, 1), false, false, 4000000);
+	source.Open();
+	source.WriteFrame(&r, 1, 48);
+	source.Close();
+	r.Close();
+
+	// Timeline with the source file, and an overlapping clip (which must be encoded)
+	Timeline t(640, 360, Fraction(24, 1), 44100, 2, LAYOUT_STEREO);
+	Clip clip_source("output-passthrough-source.avi");
+	Clip clip_overlay(path.str());
+	clip_overlay.Position(1.5);
+	clip_overlay.End(0.5);
+	clip_overlay.scale_x = Keyframe(0.5);
+	t.AddClip(&clip_source);
+	t.AddClip(&clip_overlay);
+	t.Open();
+
+	SegmentedWriter w("output-passthrough.avi", 2);
+	w.SetPassthrough(true);
+	w.SetVideoOptions(true, "mjpeg", Fraction(24, 1), 640, 360, Fraction(1, 1), false, false, 4000000);
+	CHECK(w.GetPassthrough());
+	w.WriteTimeline(&t, 1, 48);
+	t.Close();
+
+	// Copied and encoded frames are joined into one file
+	FFmpegReader r1("output-passthrough.avi");
+	r1.Open();
+	CHECK(r1.info.width == 640);
+	CHECK(r1.info.video_length == Detail::Approx(48).margin(2));
+	CHECK(r1.GetFrame(10)->GetWidth() == 640);
+	CHECK(r1.GetFrame(40)->GetWidth() == 640);
+	r1.Close();
+}
+
+TEST_CASE( "Render farm", "[libopenshot][segmentedwriter]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	Timeline t(640, 360, Fraction(24, 1), 44100, 2, LAYOUT_STEREO);
+	Clip clip_video(path.str());
+	t.AddClip(&clip_video);
+	t.Open();
+
+	// Two workers (which would run on other machines), connected before the export starts
+	RenderWorker worker1("tcp://127.0.0.1:58570");
+	RenderWorker worker2("tcp://127.0.0.1:58570");
+	std::thread thread1([&]() { worker1.Run(); });
+	std::thread thread2([&]() { worker2.Run(); });
+
+	// Export 60 frames (the segments are rounded up to the GOP size, so there are 3 video segments)
+	SegmentedWriter w("output-farm.mp4", 4);
+	w.SetFarm("tcp://127.0.0.1:58570");
+	w.SetVideoOptions(true, "mpeg4", Fraction(24, 1), 640, 360, Fraction(1, 1), false, false, 2000000);
+	w.SetAudioOptions(true, "aac", 44100, 2, LAYOUT_STEREO, 128000);
+	w.SetOption(VIDEO_STREAM, "g", "24");
+	CHECK(w.GetFarm() == "tcp://127.0.0.1:58570");
+	w.WriteTimeline(&t, 1, 60);
+	CHECK(w.Progress() == Detail::Approx(1.0));
+	t.Close();
+
+	worker1.Stop();
+	worker2.Stop();
+	thread1.join();
+	thread2.join();
+
+	// The workers rendered the 3 video segments and the audio
+	CHECK(worker1.JobsRendered() + worker2.JobsRendered() == 4);
+
+	FFmpegReader r("output-farm.mp4");
+	r.Open();
+	CHECK(r.info.has_video);
+	CHECK(r.info.has_audio);
+	CHECK(r.info.video_length == Detail::Approx(60).margin(2));
+	CHECK(r.GetFrame(25)->GetWidth() == 640);
+	CHECK(r.GetFrame(49)->GetWidth() == 640);
+	r.Close();
+
+	// The temporary files are removed
+	CHECK_THROWS(FFmpegReader("output-farm.part1.mp4"));
+	CHECK_THROWS(FFmpegReader("output-farm.part1.try1.mp4"));
+}
+
+TEST_CASE( "Export settings JSON", "[libopenshot][segmentedwriter]" )
+{
+	SegmentedWriter w("output.mp4", 2);
+	w.SetVideoOptions(true, "libx264", Fraction(30, 1), 1280, 720, Fraction(1, 1), false, false, 4000000);
+	w.SetAudioOptions(true, "aac", 48000, 2, LAYOUT_STEREO, 192000);
+	w.SetOption(VIDEO_STREAM, "crf", "20");
+
+	SegmentedWriter copy("other.mp4", 2);
+	copy.SetJsonValue(w.JsonValue());
+	CHECK(copy.JsonValue() == w.JsonValue());
+	CHECK(copy.JsonValue()["options"][0]["value"].asString() == "20");
+}
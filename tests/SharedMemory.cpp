@@ -0,0 +1,104 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::SharedMemoryWriter and openshot::SharedMemoryReader
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <memory>
+#include <thread>
+
+#include <QColor>
+#include <QImage>
+
+#include "openshot_catch.h"
+
+#include "CacheMemory.h"
+#include "DummyReader.h"
+#include "Exceptions.h"
+#include "Fraction.h"
+#include "Frame.h"
+#include "SharedMemoryReader.h"
+#include "SharedMemoryWriter.h"
+
+using namespace openshot;
+
+TEST_CASE( "Write and read frames", "[libopenshot][sharedmemory]" )
+{
+	// Frames with a distinct color and audio sample
+	CacheMemory cache;
+	for (int64_t number = 1; number <= 20; number++) {
+		auto f = std::make_shared<Frame>(number, 64, 36, "#000000", 1470, 2);
+		f->AddColor(64, 36, QColor(int(number) * 10, 0, 0).name().toStdString());
+		float sample = float(number);
+		f->AddAudio(true, 0, 0, &sample, 1, 1.0f);
+		cache.Add(f);
+	}
+	DummyReader r(Fraction(30, 1), 64, 36, 44100, 2, 20 / 30.0f, &cache);
+	r.Open();
+
+	SharedMemoryWriter w("openshot-test-shared-memory", &r, 4);
+	w.Open();
+	CHECK(w.IsOpen());
+
+	SharedMemoryReader shared("openshot-test-shared-memory");
+	shared.Open();
+	CHECK(shared.info.width == 64);
+	CHECK(shared.info.height == 36);
+	CHECK(shared.info.fps.num == 30);
+	CHECK(shared.info.channels == 2);
+
+	// The writer waits for free slots (the ring only holds 4 frames)
+	std::thread writer([&]() { w.WriteFrame(&r, 1, 20); w.Close(); });
+	for (int64_t number = 1; number <= 20; number++) {
+		std::shared_ptr<Frame> f = shared.GetFrame(number);
+		CHECK(f->number == number);
+		CHECK(f->GetWidth() == 64);
+		CHECK(f->GetImage()->pixelColor(10, 10).red() == int(number) * 10);
+		CHECK(f->GetAudioSamplesCount() == 1470);
+		CHECK(f->GetAudioSamples(0)[0] == Approx(float(number)));
+
+		// The same frame can be requested again
+		CHECK(shared.GetFrame(number) == f);
+	}
+	writer.join();
+
+	// Frames which were never written
+	shared.SetTimeout(10);
+	CHECK_THROWS_AS(shared.GetFrame(21), OutOfBoundsFrame);
+	shared.Close();
+}
+
+TEST_CASE( "Modify a shared frame", "[libopenshot][sharedmemory]" )
+{
+	auto source = std::make_shared<Frame>(1, 32, 18, "#000000");
+	source->AddColor(32, 18, "#ff0000");
+	DummyReader r(Fraction(30, 1), 32, 18, 44100, 2, 1.0f);
+	SharedMemoryWriter w("openshot-test-shared-memory-2", &r, 2);
+	w.Open();
+	w.WriteFrame(source);
+
+	SharedMemoryReader shared("openshot-test-shared-memory-2");
+	shared.Open();
+	std::shared_ptr<Frame> f = shared.GetFrame(1);
+
+	// Writing to the image copies its pixels (instead of writing to the shared memory)
+	QImage shared_image = *f->GetImage();
+	f->GetImage()->fill(Qt::blue);
+	CHECK(f->GetImage()->pixelColor(0, 0) == QColor(Qt::blue));
+	CHECK(shared_image.pixelColor(0, 0) == QColor(Qt::red));
+	shared.Close();
+	w.Close();
+}
+
+TEST_CASE( "Attach to a missing ring", "[libopenshot][sharedmemory]" )
+{
+	SharedMemoryReader shared("openshot-test-shared-memory-missing");
+	CHECK_THROWS_AS(shared.Open(), InvalidFile);
+	CHECK_FALSE(shared.IsOpen());
+}
@@ -0,0 +1,74 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::SourceFrameCache
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <sstream>
+#include <memory>
+
+#include "openshot_catch.h"
+
+#include "FFmpegReader.h"
+#include "Frame.h"
+#include "Settings.h"
+#include "SourceFrameCache.h"
+
+using namespace openshot;
+
+TEST_CASE( "Acquire", "[libopenshot][sourceframecache]" )
+{
+	SourceFrameCache *cache = SourceFrameCache::Instance();
+	const int64_t count = cache->Count();
+
+	// The same file and size share one cache
+	std::shared_ptr<CacheMemory> c1 = cache->Acquire("source.mp4", 640, 360, 8, 44100, 2);
+	std::shared_ptr<CacheMemory> c2 = cache->Acquire("source.mp4", 640, 360, 8, 44100, 2);
+	std::shared_ptr<CacheMemory> c3 = cache->Acquire("source.mp4", 1280, 720, 8, 44100, 2);
+	REQUIRE(c1);
+	CHECK(c1 == c2);
+	CHECK(c1 != c3);
+	CHECK(cache->Count() == count + 2);
+
+	// A cache is released with its last reader
+	c1.reset();
+	CHECK(cache->Count() == count + 2);
+	c2.reset();
+	c3.reset();
+	CHECK(cache->Count() == count);
+
+	// Sharing can be disabled
+	Settings::Instance()->ENABLE_SOURCE_FRAME_CACHE = false;
+	CHECK_FALSE(cache->Acquire("source.mp4", 640, 360, 8, 44100, 2));
+	Settings::Instance()->ENABLE_SOURCE_FRAME_CACHE = true;
+}
+
+TEST_CASE( "Shared frames", "[libopenshot][sourceframecache]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	FFmpegReader r1(path.str());
+	FFmpegReader r2(path.str());
+	r1.Open();
+	r2.Open();
+
+	// The second reader gets the frame decoded by the first reader
+	std::shared_ptr<Frame> f1 = r1.GetFrame(30);
+	std::shared_ptr<Frame> f2 = r2.GetFrame(30);
+	CHECK(f1 == f2);
+	CHECK(f2->number == 30);
+
+	// And keeps decoding its own frames
+	std::shared_ptr<Frame> f3 = r2.GetFrame(31);
+	CHECK(f3->number == 31);
+	CHECK(f3->GetWidth() == f1->GetWidth());
+
+	r1.Close();
+	r2.Close();
+}
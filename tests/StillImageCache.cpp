@@ -0,0 +1,105 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::StillImageCache
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <memory>
+#include <sstream>
+
+#include "openshot_catch.h"
+
+#include <QDir>
+#include <QFile>
+#include <QImage>
+
+#include "Frame.h"
+#include "QtImageReader.h"
+#include "Settings.h"
+#include "StillImageCache.h"
+
+using namespace openshot;
+
+TEST_CASE( "Lookup and Insert", "[libopenshot][stillimagecache]" )
+{
+	QString path = QDir::tempPath() + QString("/still-image-cache.png");
+	QImage(32, 32, QImage::Format_RGBA8888_Premultiplied).save(path);
+
+	StillImageCache *cache = StillImageCache::Instance();
+	cache->Clear();
+
+	auto image = std::make_shared<QImage>(16, 16, QImage::Format_RGBA8888_Premultiplied);
+	cache->Insert(path.toStdString(), QSize(16, 16), image);
+	CHECK(cache->Count() == 1);
+	CHECK(cache->GetBytes() == 16 * 16 * 4);
+
+	// Only the same file and size share the image
+	CHECK(cache->Lookup(path.toStdString(), QSize(16, 16)) == image);
+	CHECK_FALSE(cache->Lookup(path.toStdString(), QSize(8, 8)));
+	CHECK_FALSE(cache->Lookup("missing.png", QSize(16, 16)));
+
+	// Changed files are decoded again
+	QImage(64, 64, QImage::Format_RGBA8888_Premultiplied).save(path);
+	CHECK_FALSE(cache->Lookup(path.toStdString(), QSize(16, 16)));
+
+	// Sharing can be disabled
+	Settings::Instance()->STILL_IMAGE_CACHE_MB = 0;
+	cache->Insert(path.toStdString(), QSize(16, 16), image);
+	CHECK_FALSE(cache->Lookup(path.toStdString(), QSize(16, 16)));
+	Settings::Instance()->STILL_IMAGE_CACHE_MB = 256;
+
+	cache->Clear();
+	CHECK(cache->Count() == 0);
+	QFile::remove(path);
+}
+
+TEST_CASE( "Release unused images", "[libopenshot][stillimagecache]" )
+{
+	QString path = QDir::tempPath() + QString("/still-image-cache-limit.png");
+	QImage(32, 32, QImage::Format_RGBA8888_Premultiplied).save(path);
+
+	StillImageCache *cache = StillImageCache::Instance();
+	cache->Clear();
+	Settings::Instance()->STILL_IMAGE_CACHE_MB = 1;
+
+	// Each image is half of the limit
+	auto held = std::make_shared<QImage>(512, 256, QImage::Format_RGBA8888_Premultiplied);
+	cache->Insert(path.toStdString(), QSize(1, 1), held);
+	cache->Insert(path.toStdString(), QSize(2, 2), std::make_shared<QImage>(512, 256, QImage::Format_RGBA8888_Premultiplied));
+	cache->Insert(path.toStdString(), QSize(3, 3), std::make_shared<QImage>(512, 256, QImage::Format_RGBA8888_Premultiplied));
+
+	// The oldest image which no reader holds is released (the held image is kept)
+	CHECK(cache->Count() == 2);
+	CHECK(cache->GetBytes() <= 1024 * 1024);
+	CHECK(cache->Lookup(path.toStdString(), QSize(1, 1)) == held);
+	CHECK_FALSE(cache->Lookup(path.toStdString(), QSize(2, 2)));
+	CHECK(cache->Lookup(path.toStdString(), QSize(3, 3)));
+
+	Settings::Instance()->STILL_IMAGE_CACHE_MB = 256;
+	cache->Clear();
+	QFile::remove(path);
+}
+
+TEST_CASE( "Readers share the image", "[libopenshot][stillimagecache]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "front.png";
+	StillImageCache::Instance()->Clear();
+
+	QtImageReader r1(path.str());
+	QtImageReader r2(path.str());
+	r1.Open();
+	r2.Open();
+	std::shared_ptr<Frame> f1 = r1.GetFrame(1);
+	std::shared_ptr<Frame> f2 = r2.GetFrame(1);
+	CHECK(f1->GetImage() == f2->GetImage());
+	r1.Close();
+	r2.Close();
+	StillImageCache::Instance()->Clear();
+}
@@ -0,0 +1,73 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::TaskExecutor
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <atomic>
+#include <future>
+#include <stdexcept>
+#include <vector>
+
+#include "openshot_catch.h"
+
+#include "TaskExecutor.h"
+
+using namespace openshot;
+
+TEST_CASE( "Parallel loops", "[libopenshot][taskexecutor]" )
+{
+	TaskExecutor *executor = TaskExecutor::Instance();
+	CHECK(executor->Threads() >= 1);
+
+	// Every index is run once
+	std::vector<std::atomic<int>> runs(1000);
+	for (auto& run : runs)
+		run = 0;
+	executor->ParallelFor(runs.size(), [&](int64_t begin, int64_t end) {
+		for (int64_t index = begin; index < end; ++index)
+			runs[index]++;
+	});
+	for (auto& run : runs)
+		CHECK(run == 1);
+
+	// Empty loops do nothing
+	executor->ParallelFor(0, [](int64_t, int64_t) { FAIL("Empty loops have no ranges"); });
+}
+
+TEST_CASE( "Nested parallel loops", "[libopenshot][taskexecutor]" )
+{
+	TaskExecutor *executor = TaskExecutor::Instance();
+
+	// Loops inside the ranges of another loop (i.e. a pixel kernel in a render graph node) finish
+	std::atomic<int64_t> total(0);
+	executor->ParallelFor(64, [&](int64_t begin, int64_t end) {
+		for (int64_t outer = begin; outer < end; ++outer) {
+			executor->ParallelFor(100, [&](int64_t inner_begin, int64_t inner_end) {
+				total += inner_end - inner_begin;
+			});
+		}
+	});
+	CHECK(total == 64 * 100);
+}
+
+TEST_CASE( "Exceptions of tasks", "[libopenshot][taskexecutor]" )
+{
+	TaskExecutor *executor = TaskExecutor::Instance();
+
+	CHECK_THROWS_AS(executor->ParallelFor(100, [](int64_t begin, int64_t end) {
+		if (begin <= 50 && 50 < end)
+			throw std::runtime_error("range failed");
+	}), std::runtime_error);
+
+	std::future<int> result = executor->Async([]() { return 42; });
+	CHECK(result.get() == 42);
+	std::future<void> failed = executor->Async([]() { throw std::runtime_error("task failed"); });
+	CHECK_THROWS_AS(failed.get(), std::runtime_error);
+}
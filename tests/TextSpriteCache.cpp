@@ -0,0 +1,78 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::TextSpriteCache
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <memory>
+
+#include "openshot_catch.h"
+
+#include "TextSpriteCache.h"
+
+#include <QImage>
+
+using namespace openshot;
+
+TEST_CASE( "Add and GetImage", "[libopenshot][textspritecache]" )
+{
+	TextSpriteCache *cache = TextSpriteCache::Instance();
+	cache->Clear();
+
+	auto image = std::make_shared<QImage>(10, 10, QImage::Format_RGBA8888_Premultiplied);
+	image->fill(Qt::white);
+
+	// Images are found by key
+	cache->Add("title", image);
+	CHECK(cache->Count() == 1);
+	CHECK(cache->GetBytes() == 400);
+	CHECK(cache->GetImage("title") == image);
+	CHECK_FALSE(cache->GetImage("other"));
+
+	// Adding the same key replaces the image
+	auto new_image = std::make_shared<QImage>(20, 10, QImage::Format_RGBA8888_Premultiplied);
+	cache->Add("title", new_image);
+	CHECK(cache->Count() == 1);
+	CHECK(cache->GetBytes() == 800);
+	CHECK(cache->GetImage("title") == new_image);
+
+	cache->Clear();
+	CHECK(cache->Count() == 0);
+	CHECK(cache->GetBytes() == 0);
+}
+
+TEST_CASE( "Least recently used images are evicted", "[libopenshot][textspritecache]" )
+{
+	TextSpriteCache *cache = TextSpriteCache::Instance();
+	cache->Clear();
+	int64_t original_max_bytes = cache->GetMaxBytes();
+
+	// Room for 2 images (of 400 bytes)
+	cache->SetMaxBytes(800);
+	cache->Add("title 1", std::make_shared<QImage>(10, 10, QImage::Format_RGBA8888_Premultiplied));
+	cache->Add("title 2", std::make_shared<QImage>(10, 10, QImage::Format_RGBA8888_Premultiplied));
+
+	// Use title 1, so title 2 is the least recently used
+	CHECK(cache->GetImage("title 1"));
+	cache->Add("title 3", std::make_shared<QImage>(10, 10, QImage::Format_RGBA8888_Premultiplied));
+	CHECK(cache->Count() == 2);
+	CHECK(cache->GetImage("title 1"));
+	CHECK_FALSE(cache->GetImage("title 2"));
+	CHECK(cache->GetImage("title 3"));
+
+	// Shrinking the cache evicts images, and 0 disables it
+	cache->SetMaxBytes(400);
+	CHECK(cache->Count() == 1);
+	CHECK(cache->GetImage("title 3"));
+	cache->SetMaxBytes(0);
+	CHECK(cache->Count() == 0);
+	CHECK(cache->GetBytes() == 0);
+
+	cache->SetMaxBytes(original_max_bytes);
+}
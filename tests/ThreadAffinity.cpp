@@ -0,0 +1,60 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::ThreadAffinity
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <algorithm>
+#include <vector>
+
+#include "openshot_catch.h"
+
+#include "ThreadAffinity.h"
+#include "Settings.h"
+
+using namespace openshot;
+
+TEST_CASE( "Nodes", "[libopenshot][threadaffinity]" )
+{
+	CHECK(ThreadAffinity::NodeCount() >= 1);
+	CHECK(ThreadAffinity::CurrentNode() >= 0);
+	CHECK(ThreadAffinity::CurrentNode() < ThreadAffinity::NodeCount());
+	CHECK(ThreadAffinity::NodeCpus(-1).empty());
+	CHECK(ThreadAffinity::NodeCpus(ThreadAffinity::NodeCount()).empty());
+	CHECK_FALSE(ThreadAffinity::PinCurrentThreadToNode(ThreadAffinity::NodeCount()));
+}
+
+TEST_CASE( "Pin to a node while in scope", "[libopenshot][threadaffinity]" )
+{
+	const std::vector<int> node_cpus = ThreadAffinity::NodeCpus(0);
+	const std::vector<int> cpus = ThreadAffinity::CurrentThreadCpus();
+	if (node_cpus.empty() || cpus.empty())
+		return; // No NUMA information (i.e. not Linux)
+
+	// The CPUs of the node the thread may run on
+	std::vector<int> allowed;
+	for (int cpu : node_cpus)
+		if (std::find(cpus.begin(), cpus.end(), cpu) != cpus.end())
+			allowed.push_back(cpu);
+	if (allowed.empty())
+		return; // The thread may not run on the node (i.e. in a container)
+
+	{
+		ScopedNodeAffinity affinity(0);
+		CHECK(ThreadAffinity::CurrentThreadCpus() == allowed);
+		CHECK(ThreadAffinity::CurrentNode() == 0);
+	}
+	CHECK(ThreadAffinity::CurrentThreadCpus() == cpus);
+
+	// Settings::NUMA_NODE is -1 by default (which doesn't pin)
+	{
+		ScopedNodeAffinity affinity;
+		CHECK(ThreadAffinity::CurrentThreadCpus() == cpus);
+	}
+}
@@ -0,0 +1,62 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::ThumbnailExtractor
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <sstream>
+#include <memory>
+#include <vector>
+
+#include "openshot_catch.h"
+
+#include "ThumbnailExtractor.h"
+#include "Exceptions.h"
+
+using namespace openshot;
+
+TEST_CASE( "Thumbnails", "[libopenshot][thumbnailextractor]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	ThumbnailExtractor t(path.str(), 160, 160);
+	CHECK_THROWS_AS(t.GetThumbnail(1.0), ReaderClosed);
+	t.Open();
+	CHECK(t.IsOpen());
+
+	// The aspect ratio is kept
+	CHECK(t.GetWidth() == 160);
+	CHECK(t.GetHeight() == 90);
+
+	// Times in any order (and times which share a key frame share its image)
+	std::vector<double> times = {40.0, 1.0, 1.01, 20.0, 5.0};
+	std::vector<std::shared_ptr<QImage>> thumbnails = t.GetThumbnails(times);
+	REQUIRE(thumbnails.size() == times.size());
+	for (const auto& thumbnail : thumbnails) {
+		REQUIRE(thumbnail);
+		CHECK(thumbnail->width() == 160);
+		CHECK(thumbnail->height() == 90);
+	}
+	CHECK(thumbnails[1] == thumbnails[2]);
+	CHECK(thumbnails[0] != thumbnails[1]);
+
+	// Seeking back
+	std::shared_ptr<QImage> first = t.GetThumbnail(0.0);
+	REQUIRE(first);
+	CHECK(first->width() == 160);
+
+	t.Close();
+	CHECK_FALSE(t.IsOpen());
+}
+
+TEST_CASE( "Invalid file", "[libopenshot][thumbnailextractor]" )
+{
+	ThumbnailExtractor t("missing-file.mp4", 160, 90);
+	CHECK_THROWS_AS(t.Open(), InvalidFile);
+}
@@ -0,0 +1,128 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::TiledImage
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <QColor>
+#include <QImage>
+
+#include "openshot_catch.h"
+
+#include "Frame.h"
+#include "PixelKernels.h"
+#include "TiledImage.h"
+
+using namespace openshot;
+
+TEST_CASE( "Tiles are allocated lazily", "[libopenshot][tiledimage]" )
+{
+	// 3 x 2 tiles (the last column and row are smaller)
+	TiledImage image(600, 300, QColor(Qt::black));
+	CHECK(image.TilesX() == 3);
+	CHECK(image.TilesY() == 2);
+	CHECK(image.AllocatedTiles() == 0);
+	CHECK(image.ConstTile(1, 1) == nullptr);
+
+	// Writing a tile allocates it (with the background color)
+	unsigned char *tile = image.Tile(2, 1);
+	CHECK(image.AllocatedTiles() == 1);
+	CHECK(tile[3] == 255);
+	tile[0] = 255;
+
+	// Other tiles are the background color
+	std::shared_ptr<QImage> qimage = image.ToImage();
+	CHECK(qimage->format() == QImage::Format_RGBA8888_Premultiplied);
+	CHECK(qimage->size() == QSize(600, 300));
+	CHECK(qimage->pixelColor(0, 0) == QColor(Qt::black));
+	CHECK(qimage->pixelColor(512, 256) == QColor(Qt::red));
+}
+
+TEST_CASE( "Copies share their tiles", "[libopenshot][tiledimage]" )
+{
+	TiledImage image(300, 300);
+	image.Tile(0, 0)[3] = 255;
+
+	TiledImage copy = image;
+	CHECK(copy.ConstTile(0, 0) == image.ConstTile(0, 0));
+
+	// Writing a shared tile copies it first
+	copy.Tile(0, 0)[3] = 128;
+	CHECK(copy.ConstTile(0, 0) != image.ConstTile(0, 0));
+	CHECK(image.ConstTile(0, 0)[3] == 255);
+}
+
+TEST_CASE( "Transparent tiles of an image are not allocated", "[libopenshot][tiledimage]" )
+{
+	// A transparent image with a small red square
+	QImage source(1000, 600, QImage::Format_ARGB32);
+	source.fill(Qt::transparent);
+	for (int y = 300; y < 310; y++)
+		for (int x = 700; x < 710; x++)
+			source.setPixelColor(x, y, QColor(Qt::red));
+
+	auto tiled = TiledImage::FromImage(source);
+	CHECK(tiled->AllocatedTiles() == 1);
+	CHECK(tiled->GetBuffers().size() == 1);
+
+	// The same pixels (converted to premultiplied RGBA8888)
+	QImage expected = source.convertToFormat(QImage::Format_RGBA8888_Premultiplied);
+	CHECK(*tiled->ToImage() == expected);
+}
+
+TEST_CASE( "Composite onto tiles", "[libopenshot][tiledimage]" )
+{
+	// A half transparent layer, partly off the canvas
+	QImage layer_image(300, 100, QImage::Format_RGBA8888_Premultiplied);
+	layer_image.fill(QColor(0, 0, 255, 128));
+	const std::vector<PixelLayer> layers = {
+		{ layer_image.constBits(), layer_image.bytesPerLine(), 700, -20, 300, 100 },
+	};
+
+	// The same result as compositing onto a single image
+	QImage expected(900, 600, QImage::Format_RGBA8888_Premultiplied);
+	expected.fill(QColor(Qt::black));
+	PixelKernels::Composite(expected.bits(), expected.width(), expected.height(), expected.bytesPerLine(), layers);
+
+	TiledImage canvas(900, 600, QColor(Qt::black));
+	canvas.Composite(layers);
+	CHECK(canvas.AllocatedTiles() == 2);
+	CHECK(*canvas.ToImage() == expected);
+
+	// Every allocated tile is visited (the last column is narrower)
+	std::atomic<int> tiles(0);
+	std::atomic<int> pixels(0);
+	canvas.ForEachTile([&](unsigned char *tile, int x, int y, int width, int height) {
+		tiles++;
+		pixels += width * height;
+	});
+	CHECK(tiles == 2);
+	CHECK(pixels == (256 + 132) * 256);
+}
+
+TEST_CASE( "Frames convert tiles on demand", "[libopenshot][tiledimage]" )
+{
+	auto canvas = std::make_shared<TiledImage>(640, 360, QColor(Qt::black));
+	canvas->Tile(0, 0)[0] = 255;
+
+	Frame f1(1, 640, 360, "#000000");
+	f1.AddTiledImage(canvas);
+	CHECK(f1.has_image_data);
+	CHECK(f1.GetTiledImage() == canvas);
+	CHECK(f1.GetBytes() == TiledImage::TILE_SIZE * TiledImage::TILE_BYTES_PER_LINE);
+
+	// The tiles are converted to an image once it is needed
+	CHECK(f1.GetImage()->pixelColor(0, 0) == QColor(Qt::red));
+	CHECK(f1.GetTiledImage() == nullptr);
+	CHECK(f1.GetBytes() == 640 * 360 * 4);
+}
@@ -14,14 +14,18 @@
 #include <sstream>
 #include <memory>
 #include <list>
+#include <vector>
 #include <omp.h>
 
 #include "openshot_catch.h"
 
+#include "Exceptions.h"
 #include "FrameMapper.h"
+#include "Json.h"
 #include "Timeline.h"
 #include "Clip.h"
 #include "Frame.h"
+#include "Settings.h"
 #include "Fraction.h"
 #include "effects/Blur.h"
 #include "effects/Negate.h"
@@ -483,6 +487,106 @@ TEST_CASE( "GetClip by id", "[libopenshot][timeline]" )
 	CHECK(matched2->Waveform() == true);
 }
 
+TEST_CASE( "GetClip and GetEffect after changes", "[libopenshot][timeline]" )
+{
+	Timeline t(640, 480, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "front.png";
+
+	Clip clip1(path.str());
+	clip1.Id("CLIP00001");
+	Clip clip2(path.str());
+	clip2.Id("CLIP00002");
+	t.AddClip(&clip1);
+	t.AddClip(&clip2);
+
+	// Renamed clips are found by their new id
+	clip1.Id("CLIP00003");
+	CHECK(t.GetClip("CLIP00001") == nullptr);
+	CHECK(t.GetClip("CLIP00003") == &clip1);
+	CHECK(t.GetClip("CLIP00002") == &clip2);
+
+	// Removed clips are not found
+	t.RemoveClip(&clip2);
+	CHECK(t.GetClip("CLIP00002") == nullptr);
+
+	// Effects added to a clip (after the clip was added) are found
+	Negate negate;
+	negate.Id("EFFECT00001");
+	clip1.AddEffect(&negate);
+	CHECK(t.GetClipEffect("EFFECT00001") == &negate);
+	clip1.RemoveEffect(&negate);
+	CHECK(t.GetClipEffect("EFFECT00001") == nullptr);
+
+	// Timeline effects
+	Negate effect;
+	effect.Id("EFFECT00002");
+	t.AddEffect(&effect);
+	CHECK(t.GetEffect("EFFECT00002") == &effect);
+	effect.Id("EFFECT00003");
+	CHECK(t.GetEffect("EFFECT00002") == nullptr);
+	CHECK(t.GetEffect("EFFECT00003") == &effect);
+	t.RemoveEffect(&effect);
+	CHECK(t.GetEffect("EFFECT00003") == nullptr);
+
+	// Clips inserted (and deleted) by a JSON diff
+	Clip clip4(path.str());
+	clip4.Id("CLIP00004");
+	Json::Value change;
+	change["type"] = "insert";
+	change["key"].append("clips");
+	change["value"] = clip4.JsonValue();
+	Json::Value changes;
+	changes.append(change);
+	t.ApplyJsonDiff(changes.toStyledString());
+	REQUIRE(t.GetClip("CLIP00004") != nullptr);
+	CHECK(t.GetClip("CLIP00004")->Id() == "CLIP00004");
+	changes[0]["type"] = "delete";
+	changes[0]["key"].append(Json::Value(Json::objectValue));
+	changes[0]["key"][1]["id"] = "CLIP00004";
+	t.ApplyJsonDiff(changes.toStyledString());
+	CHECK(t.GetClip("CLIP00004") == nullptr);
+}
+
+TEST_CASE( "AddClips and BeginUpdate", "[libopenshot][timeline]" )
+{
+	Timeline t(640, 480, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "front.png";
+
+	// Clips (out of order)
+	Clip clip1(path.str());
+	clip1.Position(10.0);
+	Clip clip2(path.str());
+	clip2.Position(0.0);
+	Clip clip3(path.str());
+	clip3.Position(5.0);
+	t.AddClips({&clip1, &clip2});
+
+	// The clips are sorted and mapped to the timeline's frame rate
+	std::list<Clip*> clips = t.Clips();
+	REQUIRE(clips.size() == 2);
+	CHECK(clips.front() == &clip2);
+	CHECK(clips.back() == &clip1);
+	CHECK(clip1.Reader()->Name() == "FrameMapper");
+
+	// Nothing is sorted (or mapped) until the update is done
+	t.BeginUpdate();
+	t.BeginUpdate();
+	t.AddClip(&clip3);
+	t.EndUpdate();
+	CHECK(t.Clips().back() == &clip3);
+	CHECK(clip3.Reader()->Name() != "FrameMapper");
+	t.EndUpdate();
+
+	clips = t.Clips();
+	REQUIRE(clips.size() == 3);
+	CHECK(*std::next(clips.begin()) == &clip3);
+	CHECK(clip3.Reader()->Name() == "FrameMapper");
+}
+
 TEST_CASE( "GetClipEffect by id", "[libopenshot][timeline]" )
 {
 	Timeline t(640, 480, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
@@ -871,3 +975,558 @@ TEST_CASE( "ApplyJSONDiff Update Reader Info", "[libopenshot][timeline]" )
 	CHECK(mapper->Reader()->info.duration == Detail::Approx(20.77867).margin(0.00001));
 
 }
+
+TEST_CASE( "ApplyJSONDiff only removes changed frames", "[libopenshot][timeline]" )
+{
+	// Create a timeline
+	Timeline t(640, 480, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+	t.Open();
+
+	// Add clip (with an alpha keyframe)
+	std::stringstream path1;
+	path1 << TEST_MEDIA_PATH << "interlaced.png";
+	Clip clip1(path1.str());
+	clip1.Id("C1");
+	clip1.Layer(1);
+	clip1.Position(0);
+	clip1.End(10);
+	clip1.alpha.AddPoint(1, 1.0);
+	clip1.alpha.AddPoint(10, 1.0);
+	clip1.alpha.AddPoint(20, 1.0);
+	clip1.alpha.AddPoint(30, 1.0);
+	t.AddClip(&clip1);
+
+	// Render the first 40 frames (and keep all of them)
+	t.GetCache()->SetMaxBytes(0);
+	for (int64_t frame = 1; frame <= 40; frame++)
+		t.GetFrame(frame);
+	CHECK(t.GetCache()->Count() == 40);
+	CHECK(clip1.GetCache()->Contains(25));
+
+	// Change the alpha of the 3rd point
+	Json::Value alpha = clip1.alpha.JsonValue();
+	alpha["Points"][2]["co"]["Y"] = 0.5;
+	std::stringstream json_change1;
+	json_change1 << "[{\"type\":\"update\",\"key\":[\"clips\",{\"id\":\"C1\"}],\"value\":{\"alpha\":" << alpha.toStyledString() << "},\"partial\":false}]";
+	t.ApplyJsonDiff(json_change1.str());
+
+	// Only the frames between the unchanged neighbouring points (and the next frame) are removed
+	CHECK(t.GetCache()->Contains(9));
+	CHECK_FALSE(t.GetCache()->Contains(10));
+	CHECK_FALSE(t.GetCache()->Contains(31));
+	CHECK(t.GetCache()->Contains(32));
+	CHECK_FALSE(clip1.GetCache()->Contains(25));
+	CHECK(clip1.GetCache()->Contains(35));
+
+	// Moving the clip removes its old and new frames
+	std::stringstream json_change2;
+	json_change2 << "[{\"type\":\"update\",\"key\":[\"clips\",{\"id\":\"C1\"}],\"value\":{\"position\":0.5},\"partial\":false}]";
+	t.ApplyJsonDiff(json_change2.str());
+	CHECK(t.GetCache()->Count() == 0);
+	CHECK(clip1.GetCache()->Contains(35));
+}
+
+TEST_CASE( "ApplyJSONDiff keeps the unchanged audio or images", "[libopenshot][timeline]" )
+{
+	Timeline t(640, 480, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+	t.Open();
+
+	// Music under an image
+	std::stringstream path1;
+	path1 << TEST_MEDIA_PATH << "piano.wav";
+	Clip music(path1.str());
+	music.Id("MUSIC");
+	music.Layer(1);
+	music.End(2);
+	t.AddClip(&music);
+	std::stringstream path2;
+	path2 << TEST_MEDIA_PATH << "interlaced.png";
+	Clip image(path2.str());
+	image.Id("IMAGE");
+	image.Layer(2);
+	image.End(2);
+	t.AddClip(&image);
+
+	t.GetCache()->SetMaxBytes(0);
+	for (int64_t frame = 1; frame <= 10; frame++)
+		t.GetFrame(frame);
+	std::shared_ptr<Frame> f = t.GetFrame(5);
+	const float sample = f->GetAudioSamples(0)[100];
+	REQUIRE(sample != 0.0f);
+
+	// Changing the image keeps the mixed audio (so the music is not rendered again)
+	t.ApplyJsonDiff("[{\"type\":\"update\",\"key\":[\"clips\",{\"id\":\"IMAGE\"}],\"value\":{\"alpha\":{\"Points\":[{\"co\":{\"X\":1,\"Y\":0.5},\"interpolation\":2}]}}}]");
+	CHECK_FALSE(t.GetCache()->Contains(5));
+	music.GetCache()->Clear();
+	f = t.GetFrame(5);
+	CHECK(f->GetAudioSamples(0)[100] == sample);
+	CHECK_FALSE(music.GetCache()->Contains(5));
+	const QColor faded_pixel = f->GetImage()->pixelColor(320, 240);
+
+	// Changing the volume keeps the image (so the image is not rendered again)
+	t.ApplyJsonDiff("[{\"type\":\"update\",\"key\":[\"clips\",{\"id\":\"MUSIC\"}],\"value\":{\"volume\":{\"Points\":[{\"co\":{\"X\":1,\"Y\":0.5},\"interpolation\":2}]}}}]");
+	CHECK_FALSE(t.GetCache()->Contains(5));
+	image.GetCache()->Clear();
+	f = t.GetFrame(5);
+	CHECK(f->GetAudioSamples(0)[100] == Detail::Approx(sample * 0.5f).margin(0.0001));
+	CHECK(f->GetImage()->pixelColor(320, 240) == faded_pixel);
+	CHECK_FALSE(image.GetCache()->Contains(5));
+
+	// Other changes render the whole frame again
+	t.ApplyJsonDiff("[{\"type\":\"update\",\"key\":[\"clips\",{\"id\":\"IMAGE\"}],\"value\":{\"position\":0.1}}]");
+	t.GetFrame(5);
+	CHECK(image.GetCache()->Count() > 0);
+
+	t.RemoveClip(&music);
+	t.RemoveClip(&image);
+	t.Close();
+}
+
+TEST_CASE( "Open only intersecting clips", "[libopenshot][timeline]" )
+{
+	// Create a timeline
+	Timeline t(640, 480, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+
+	// A long background clip, and many short (1 second) clips after each other
+	std::stringstream path1;
+	path1 << TEST_MEDIA_PATH << "interlaced.png";
+	Clip background(path1.str());
+	background.Layer(0);
+	background.Position(0.0);
+	background.End(500.0);
+	t.AddClip(&background);
+
+	std::vector<std::shared_ptr<Clip>> short_clips;
+	for (int index = 0; index < 200; index++) {
+		auto c = std::make_shared<Clip>(path1.str());
+		c->Layer(1 + index % 3);
+		c->Position(index * 1.0);
+		c->End(1.0);
+		t.AddClip(c.get());
+		short_clips.push_back(c);
+	}
+	t.Open();
+
+	// Only the clips at this time are opened
+	t.GetFrame(100 * 30 + 15);
+	CHECK(background.IsOpen());
+	CHECK(short_clips[100]->IsOpen());
+	CHECK_FALSE(short_clips[99]->IsOpen());
+	CHECK_FALSE(short_clips[150]->IsOpen());
+
+	// And closed, once they are no longer needed
+	t.GetFrame(150 * 30 + 15);
+	CHECK(background.IsOpen());
+	CHECK_FALSE(short_clips[100]->IsOpen());
+	CHECK(short_clips[150]->IsOpen());
+
+	// Moving a clip updates the frame ranges
+	short_clips[10]->Position(150.0);
+	t.GetFrame(150 * 30 + 16);
+	CHECK(short_clips[10]->IsOpen());
+
+	t.Close();
+	for (auto& c : short_clips)
+		t.RemoveClip(c.get());
+}
+
+TEST_CASE( "Open upcoming clips in the background", "[libopenshot][timeline]" )
+{
+	// Create a timeline (which opens the clips starting within 1 second)
+	Settings::Instance()->CLIP_LOOK_AHEAD_FRAMES = 30;
+	Timeline t(640, 480, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+
+	// Short (1 second) clips after each other
+	std::stringstream path1;
+	path1 << TEST_MEDIA_PATH << "interlaced.png";
+	std::vector<std::shared_ptr<Clip>> short_clips;
+	for (int index = 0; index < 20; index++) {
+		auto c = std::make_shared<Clip>(path1.str());
+		c->Layer(1);
+		c->Position(index * 1.0);
+		c->End(1.0);
+		t.AddClip(c.get());
+		short_clips.push_back(c);
+	}
+	t.Open();
+
+	// The next clip is prepared near the end of the current one, and is open once it's reached
+	t.GetFrame(10 * 30 + 20);
+	t.GetFrame(11 * 30 + 1);
+	CHECK(short_clips[11]->IsOpen());
+
+	// Prepared clips are closed again, once they no longer start soon
+	t.GetFrame(11 * 30 + 25);
+	t.GetFrame(5 * 30 + 1);
+	CHECK_FALSE(short_clips[11]->IsOpen());
+	CHECK_FALSE(short_clips[12]->IsOpen());
+	CHECK(short_clips[5]->IsOpen());
+
+	// And when the timeline is closed
+	t.GetFrame(5 * 30 + 25);
+	t.Close();
+	CHECK_FALSE(short_clips[6]->IsOpen());
+	for (auto& c : short_clips)
+		t.RemoveClip(c.get());
+	Settings::Instance()->CLIP_LOOK_AHEAD_FRAMES = 0;
+}
+
+TEST_CASE( "Audio-only mode", "[libopenshot][timeline]" )
+{
+	// Create a timeline (with a video and an image clip)
+	Timeline t(640, 480, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+	t.color.red = Keyframe(255.0);
+
+	std::stringstream path1;
+	path1 << TEST_MEDIA_PATH << "sintel_trailer-720p.mp4";
+	Clip clip_video(path1.str());
+	clip_video.Layer(0);
+	t.AddClip(&clip_video);
+
+	std::stringstream path2;
+	path2 << TEST_MEDIA_PATH << "front3.png";
+	Clip clip_image(path2.str());
+	clip_image.Layer(1);
+	t.AddClip(&clip_image);
+	t.Open();
+
+	// Normal frame
+	std::shared_ptr<Frame> f = t.GetFrame(50);
+	CHECK(f->has_image_data);
+	const std::vector<float> expected_samples(f->GetAudioSamples(0), f->GetAudioSamples(0) + f->GetAudioSamplesCount());
+
+	// Audio-only frames have no image, but the same audio
+	t.AudioOnly(true);
+	CHECK(t.AudioOnly());
+	ReaderBase* decoding_reader = static_cast<FrameMapper*>(clip_video.Reader())->Reader();
+	CHECK_FALSE(decoding_reader->info.has_video);
+	f = t.GetFrame(50);
+	CHECK_FALSE(f->has_image_data);
+	REQUIRE(f->GetAudioSamplesCount() == int(expected_samples.size()));
+	for (int s = 0; s < f->GetAudioSamplesCount(); s += 100)
+		CHECK(f->GetAudioSamples(0)[s] == Detail::Approx(expected_samples[s]).margin(0.001));
+
+	// Video decoding is restored
+	t.AudioOnly(false);
+	CHECK(decoding_reader->info.has_video);
+	CHECK(t.GetFrame(50)->has_image_data);
+
+	t.Close();
+}
+
+TEST_CASE( "Parallel layers", "[libopenshot][timeline]" )
+{
+	std::stringstream path1;
+	path1 << TEST_MEDIA_PATH << "test.mp4";
+	std::stringstream path2;
+	path2 << TEST_MEDIA_PATH << "front3.png";
+
+	// Render the same frames of a 3 layer timeline, with the layers rendered in parallel (or not)
+	auto render = [&](bool parallel_layers) {
+		Settings::Instance()->ENABLE_PARALLEL_LAYERS = parallel_layers;
+		Timeline t(640, 480, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+
+		Clip clip_video(path1.str());
+		clip_video.Layer(0);
+		t.AddClip(&clip_video);
+
+		Clip clip_overlay(path2.str());
+		clip_overlay.Layer(1);
+		clip_overlay.scale_x = Keyframe(0.5);
+		clip_overlay.scale_y = Keyframe(0.5);
+		t.AddClip(&clip_overlay);
+
+		Clip clip_corner(path2.str());
+		clip_corner.Layer(2);
+		clip_corner.location_x = Keyframe(0.25);
+		clip_corner.alpha = Keyframe(0.5);
+		t.AddClip(&clip_corner);
+		t.Open();
+
+		std::vector<QImage> images;
+		for (int64_t frame = 1; frame <= 5; frame++)
+			images.push_back(t.GetFrame(frame)->GetImage()->copy());
+		t.Close();
+		return images;
+	};
+
+	const std::vector<QImage> parallel = render(true);
+	const std::vector<QImage> serial = render(false);
+	Settings::Instance()->ENABLE_PARALLEL_LAYERS = true;
+
+	REQUIRE(parallel.size() == serial.size());
+	for (size_t index = 0; index < parallel.size(); index++)
+		CHECK(parallel[index] == serial[index]);
+}
+
+TEST_CASE( "Draft render quality", "[libopenshot][timeline]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "test.mp4";
+
+	Timeline t(640, 480, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+	CHECK(t.GetRenderQuality() == RENDER_QUALITY_FINAL);
+	CHECK_FALSE(t.IsDraftQuality());
+
+	Clip clip_video(path.str());
+	clip_video.rotation = Keyframe(10.0);
+	t.AddClip(&clip_video);
+	t.Open();
+	std::shared_ptr<Frame> final_frame = t.GetFrame(10);
+	QImage final_image = final_frame->GetImage()->copy();
+
+	// Draft frames are rendered again (not taken from the cache), at the same size
+	t.SetRenderQuality(RENDER_QUALITY_DRAFT);
+	CHECK(t.IsDraftQuality());
+	QImage draft_image = t.GetFrame(10)->GetImage()->copy();
+	CHECK(draft_image.size() == final_image.size());
+	CHECK(draft_image != final_image);
+
+	// Back to final quality (which re-uses the cached frames of the final quality)
+	t.SetRenderQuality(RENDER_QUALITY_FINAL);
+	CHECK(t.GetFrame(10) == final_frame);
+	t.ClearAllCache();
+	CHECK(t.GetFrame(10)->GetImage()->copy() == final_image);
+	t.Close();
+}
+
+TEST_CASE( "Nested timeline preview size and quality", "[libopenshot][timeline]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "front.png";
+
+	// A nested 1080p timeline
+	Timeline nested(1920, 1080, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+	Clip nested_clip(path.str());
+	nested.AddClip(&nested_clip);
+
+	// Shown in a smaller preview (at draft quality)
+	Timeline t(1920, 1080, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+	t.SetMaxSize(480, 270);
+	t.SetRenderQuality(RENDER_QUALITY_DRAFT);
+	Clip clip(&nested);
+	t.AddClip(&clip);
+	t.Open();
+	t.GetFrame(1);
+
+	// The nested timeline renders at the preview size (and quality)
+	CHECK(nested.preview_width == 480);
+	CHECK(nested.preview_height == 270);
+	CHECK(nested.IsDraftQuality());
+	CHECK(nested.GetFrame(1)->GetWidth() == 480);
+
+	// Scaling the clip up needs larger frames
+	clip.scale_x = Keyframe(2.0);
+	clip.scale_y = Keyframe(2.0);
+	t.SetRenderQuality(RENDER_QUALITY_FINAL);
+	t.ClearAllCache();
+	t.GetFrame(1);
+	CHECK(nested.preview_width == 960);
+	CHECK(nested.preview_height == 540);
+	CHECK_FALSE(nested.IsDraftQuality());
+	t.Close();
+}
+
+TEST_CASE( "Cached frames of previous preview sizes", "[libopenshot][timeline]" )
+{
+	std::stringstream path;
+	path << TEST_MEDIA_PATH << "front.png";
+
+	Timeline t(640, 360, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+	Clip clip(path.str());
+	t.AddClip(&clip);
+	t.Open();
+	std::shared_ptr<Frame> full_frame = t.GetFrame(1);
+	CHECK(full_frame->GetWidth() == 640);
+
+	// Smaller previews scale down the cached frames of larger sizes
+	t.SetMaxSize(320, 180);
+	CHECK(t.GetCache()->Count() == 0);
+	std::shared_ptr<Frame> small_frame = t.GetFrame(1);
+	CHECK(small_frame->GetWidth() == 320);
+	CHECK(small_frame->GetHeight() == 180);
+	CHECK(*small_frame->GetImage() == full_frame->GetImage()->scaled(320, 180, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+
+	// Changing back to a previous size re-uses its cached frames
+	t.SetMaxSize(640, 360);
+	CHECK(t.GetFrame(1) == full_frame);
+
+	// Edits remove the cached frames of all sizes
+	t.ClearAllCache();
+	t.SetMaxSize(320, 180);
+	CHECK(t.GetFrame(1) != small_frame);
+	t.Close();
+}
+
+TEST_CASE( "Settings overrides", "[libopenshot][timeline]" )
+{
+	Timeline t(640, 480, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+	Settings *s = Settings::Instance();
+
+	// Without overrides, the global Settings are used
+	CHECK(t.OmpThreads() == std::min(omp_get_num_procs(), std::max(2, s->OMP_THREADS)));
+	CHECK(t.FFThreads() == std::min(omp_get_num_procs(), std::max(2, s->FF_THREADS)));
+	CHECK(t.HardwareDecoder() == s->HARDWARE_DECODER);
+	CHECK(t.HighQualityScaling() == s->HIGH_QUALITY_SCALING);
+
+	// Overrides of this timeline only
+	t.omp_threads = 2;
+	t.ff_threads = 2;
+	t.hardware_decoder = 0;
+	t.high_quality_scaling = 1;
+	CHECK(t.OmpThreads() == std::min(omp_get_num_procs(), 2));
+	CHECK(t.FFThreads() == std::min(omp_get_num_procs(), 2));
+	CHECK(t.HardwareDecoder() == 0);
+	CHECK(t.HighQualityScaling());
+
+	Timeline t2(640, 480, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+	CHECK(t2.HardwareDecoder() == s->HARDWARE_DECODER);
+	CHECK(t2.HighQualityScaling() == s->HIGH_QUALITY_SCALING);
+}
+
+TEST_CASE( "Static frame reuse", "[libopenshot][timeline]" )
+{
+	std::stringstream path1;
+	path1 << TEST_MEDIA_PATH << "front3.png";
+	std::stringstream path2;
+	path2 << TEST_MEDIA_PATH << "test.mp4";
+
+	// Render the same frames of a slideshow (2 still images), with static frames re-used (or not)
+	auto render = [&](bool reuse, bool& shared) {
+		Settings::Instance()->ENABLE_STATIC_FRAME_REUSE = reuse;
+		Timeline t(640, 480, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+
+		Clip clip_background(path1.str());
+		clip_background.Layer(0);
+		t.AddClip(&clip_background);
+
+		Clip clip_overlay(path1.str());
+		clip_overlay.Layer(1);
+		clip_overlay.scale_x = Keyframe(0.5);
+		clip_overlay.scale_y = Keyframe(0.5);
+		clip_overlay.alpha = Keyframe(0.5);
+		t.AddClip(&clip_overlay);
+		t.Open();
+
+		std::vector<QImage> images;
+		std::vector<std::shared_ptr<Frame>> frames;
+		for (int64_t frame = 1; frame <= 5; frame++) {
+			frames.push_back(t.GetFrame(frame));
+			images.push_back(frames.back()->GetImage()->copy());
+		}
+		shared = frames[0]->GetImage()->constBits() == frames[4]->GetImage()->constBits();
+
+		// An animated keyframe (after clearing the cache) renders every frame again
+		clip_overlay.alpha.AddPoint(1, 0.0);
+		clip_overlay.alpha.AddPoint(10, 1.0);
+		t.ClearAllCache();
+		images.push_back(t.GetFrame(6)->GetImage()->copy());
+		images.push_back(t.GetFrame(7)->GetImage()->copy());
+		t.Close();
+		return images;
+	};
+
+	bool reused_shared = false;
+	bool rendered_shared = false;
+	const std::vector<QImage> reused = render(true, reused_shared);
+	const std::vector<QImage> rendered = render(false, rendered_shared);
+	Settings::Instance()->ENABLE_STATIC_FRAME_REUSE = true;
+
+	// The re-used frames share the same image buffer
+	CHECK(reused_shared);
+	CHECK_FALSE(rendered_shared);
+	REQUIRE(reused.size() == rendered.size());
+	for (size_t index = 0; index < reused.size(); index++)
+		CHECK(reused[index] == rendered[index]);
+	CHECK(reused[5] != reused[6]);
+
+	// Frames of a video are never re-used
+	Timeline t(640, 480, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+	Clip clip_video(path2.str());
+	t.AddClip(&clip_video);
+	t.Open();
+	std::shared_ptr<Frame> f1 = t.GetFrame(1);
+	std::shared_ptr<Frame> f2 = t.GetFrame(2);
+	CHECK(f1->GetImage()->constBits() != f2->GetImage()->constBits());
+	t.Close();
+}
+
+TEST_CASE( "Binary serialization", "[libopenshot][timeline]" )
+{
+	// Create a timeline (with a clip, an effect and an animated keyframe)
+	Timeline t1(640, 480, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+
+	std::stringstream path1;
+	path1 << TEST_MEDIA_PATH << "interlaced.png";
+	Clip clip1(path1.str());
+	clip1.Id("CLIP1");
+	clip1.Layer(2);
+	clip1.Position(5.5);
+	clip1.alpha = Keyframe();
+	clip1.alpha.AddPoint(1, 0.0);
+	clip1.alpha.AddPoint(100, 1.0, LINEAR);
+	Negate effect1;
+	clip1.AddEffect(&effect1);
+	t1.AddClip(&clip1);
+
+	// The binary serialization is smaller than the JSON, and holds the same values
+	std::string binary = t1.Binary();
+	CHECK(openshot::isBinaryJson(binary));
+	CHECK_FALSE(openshot::isBinaryJson(t1.Json()));
+	CHECK(binary.size() < t1.Json().size());
+	CHECK(openshot::binaryToJson(binary) == t1.JsonValue());
+
+	// Load it into another timeline
+	Timeline t2(640, 480, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+	t2.SetBinary(binary);
+	REQUIRE(t2.Clips().size() == 1);
+	Clip* clip2 = t2.GetClip("CLIP1");
+	REQUIRE(clip2 != nullptr);
+	CHECK(clip2->Layer() == 2);
+	CHECK(clip2->Position() == Detail::Approx(5.5));
+	CHECK(clip2->alpha.GetCount() == 2);
+	CHECK(clip2->alpha.GetValue(50) == Detail::Approx(clip1.alpha.GetValue(50)));
+	CHECK(clip2->Effects().size() == 1);
+
+	// Invalid data
+	CHECK_THROWS_AS(t2.SetBinary(binary.substr(0, binary.size() / 2)), InvalidJSON);
+	CHECK_THROWS_AS(t2.SetBinary("{}"), InvalidJSON);
+
+	t1.RemoveClip(&clip1);
+}
+
+TEST_CASE( "Snapshot", "[libopenshot][timeline]" )
+{
+	Timeline t(640, 480, Fraction(30, 1), 44100, 2, LAYOUT_STEREO);
+
+	std::stringstream path1;
+	path1 << TEST_MEDIA_PATH << "interlaced.png";
+	Clip clip1(path1.str());
+	clip1.Id("CLIP1");
+	clip1.Layer(1);
+	clip1.End(10);
+	t.AddClip(&clip1);
+	t.Open();
+
+	std::unique_ptr<Timeline> snapshot = t.Snapshot();
+	REQUIRE(snapshot->Clips().size() == 1);
+	CHECK(snapshot->GetClip("CLIP1") != &clip1);
+	CHECK(snapshot->info.width == 640);
+	CHECK_FALSE(snapshot->IsOpen());
+
+	// Edits of the timeline don't change the snapshot
+	t.ApplyJsonDiff("[{\"type\":\"update\",\"key\":[\"clips\",{\"id\":\"CLIP1\"}],\"value\":{\"id\":\"CLIP1\",\"layer\":4}}]");
+	t.ApplyJsonDiff("[{\"type\":\"delete\",\"key\":[\"clips\",{\"id\":\"CLIP1\"}],\"value\":{}}]");
+	CHECK(t.Clips().empty());
+	REQUIRE(snapshot->GetClip("CLIP1") != nullptr);
+	CHECK(snapshot->GetClip("CLIP1")->Layer() == 1);
+
+	// The snapshot renders its own frames
+	snapshot->Open();
+	std::shared_ptr<Frame> f = snapshot->GetFrame(1);
+	REQUIRE(f != nullptr);
+	CHECK(f->number == 1);
+	CHECK(f->GetWidth() == 640);
+	snapshot->Close();
+	t.Close();
+}
@@ -0,0 +1,82 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::WaveformRenderer
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <memory>
+#include <vector>
+
+#include <QColor>
+#include <QImage>
+
+#include "openshot_catch.h"
+
+#include "Frame.h"
+#include "WaveformRenderer.h"
+
+using namespace openshot;
+
+TEST_CASE( "Waveform spans", "[libopenshot][waveformrenderer]" )
+{
+	// A positive left channel, and a negative right channel
+	auto frame = std::make_shared<Frame>(1, 100, 2);
+	std::vector<float> left(100, 0.5), right(100, -0.5);
+	frame->AddAudio(true, 0, 0, left.data(), 100, 1.0);
+	frame->AddAudio(true, 1, 0, right.data(), 100, 1.0);
+
+	// Each channel is 200 rows high (with 20 rows between them), and spans from its center to the sample values
+	std::vector<int> spans = WaveformRenderer::GetSpans(*frame, 50, 420);
+	REQUIRE(spans.size() == 2 * 50 * 2);
+	CHECK(spans[0] == 50);
+	CHECK(spans[1] == 100);
+	CHECK(spans[100] == 320);
+	CHECK(spans[101] == 370);
+
+	// Frames without audio have no spans
+	Frame silent_frame(1, 720, 480, "#000000");
+	CHECK(WaveformRenderer::GetSpans(silent_frame, 50, 420).empty());
+}
+
+TEST_CASE( "Render and re-use waveform images", "[libopenshot][waveformrenderer]" )
+{
+	auto frame = std::make_shared<Frame>(1, 100, 1);
+	std::vector<float> samples(100, 0.5);
+	frame->AddAudio(true, 0, 0, samples.data(), 100, 1.0);
+
+	WaveformRenderer renderer;
+	std::shared_ptr<QImage> image = renderer.Render(frame, 200, 100, QColor(Qt::red));
+	CHECK(image->size() == QSize(200, 100));
+	CHECK(image->format() == QImage::Format_RGBA8888_Premultiplied);
+	CHECK(image->pixelColor(10, 10).alpha() == 0);
+	CHECK(image->pixelColor(10, 40) == QColor(Qt::red));
+	CHECK(image->pixelColor(10, 60).alpha() == 0);
+	CHECK(renderer.Reused() == 0);
+
+	// The same waveform (of another frame) re-uses the image
+	auto next_frame = std::make_shared<Frame>(2, 100, 1);
+	next_frame->AddAudio(true, 0, 0, samples.data(), 100, 1.0);
+	std::shared_ptr<QImage> next_image = renderer.Render(next_frame, 200, 100, QColor(Qt::red));
+	CHECK(renderer.Reused() == 1);
+	CHECK(next_image->constBits() == image->constBits());
+
+	// Modifying the image doesn't modify the cached image
+	next_image->setPixelColor(10, 10, QColor(Qt::blue));
+	CHECK(renderer.Render(frame, 200, 100, QColor(Qt::red))->pixelColor(10, 10).alpha() == 0);
+	CHECK(renderer.Reused() == 2);
+
+	// Another color (or size) renders a new image
+	CHECK(renderer.Render(frame, 200, 100, QColor(Qt::green))->pixelColor(10, 40) == QColor(Qt::green));
+	CHECK(renderer.Render(frame, 100, 100, QColor(Qt::green))->width() == 100);
+	CHECK(renderer.Reused() == 2);
+
+	// Frames without audio are black
+	auto silent_frame = std::make_shared<Frame>(3, 720, 480, "#000000");
+	CHECK(renderer.Render(silent_frame, 200, 100, QColor(Qt::red))->pixelColor(10, 10) == QColor(Qt::black));
+}
@@ -0,0 +1,73 @@
+/**
+ * @file
+ * @brief Unit tests for openshot::ZmqLogger
+ * @author Jonathan Thomas <jonathan@openshot.org>
+ *
+ * @ref License
+ */
+
+// Copyright (c) 2008-2019 OpenShot Studios, LLC
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "openshot_catch.h"
+
+#include "ZmqLogger.h"
+
+using namespace openshot;
+
+TEST_CASE( "Log from many threads", "[libopenshot][zmqlogger]" )
+{
+	ZmqLogger *logger = ZmqLogger::Instance();
+	logger->Path("output-zmqlogger.log");
+	logger->Enable(true);
+
+	// The messages are queued by each thread, and written by the logger thread
+	std::vector<std::thread> threads;
+	for (int thread = 0; thread < 4; thread++) {
+		threads.emplace_back([logger, thread]() {
+			for (int message = 0; message < 100; message++)
+				logger->AppendDebugMethod("ZmqLoggerTest", "thread", thread, "message", message);
+		});
+	}
+	for (auto& thread : threads)
+		thread.join();
+	logger->Flush();
+	logger->Enable(false);
+
+	// Each message is a line (unless the queue was full, which is reported)
+	std::ifstream log_file("output-zmqlogger.log");
+	std::string line;
+	int messages = 0;
+	bool dropped = false;
+	while (std::getline(log_file, line)) {
+		if (line.find("ZmqLoggerTest (thread=") == 0)
+			messages++;
+		if (line.find("ZmqLogger (queue full)") == 0)
+			dropped = true;
+	}
+	CHECK((messages == 400 || dropped));
+	CHECK(messages > 0);
+}
+
+TEST_CASE( "Format a message", "[libopenshot][zmqlogger]" )
+{
+	ZmqLogger *logger = ZmqLogger::Instance();
+	logger->Path("output-zmqlogger-format.log");
+	logger->Enable(true);
+	logger->AppendDebugMethod("ZmqLoggerFormat", "frame", 12, "", -1.0, "alpha", 0.5);
+	logger->Flush();
+	logger->Enable(false);
+
+	std::ifstream log_file("output-zmqlogger-format.log");
+	std::string line;
+	bool found = false;
+	while (std::getline(log_file, line))
+		found = found || line == "ZmqLoggerFormat (frame=12.0000, alpha=0.5000)";
+	CHECK(found);
+}